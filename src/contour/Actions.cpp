@@ -36,6 +36,7 @@ optional<Action> fromString(string const& name)
         mapAction<actions::CreateDebugDump>("CreateDebugDump"),
         mapAction<actions::DecreaseFontSize>("DecreaseFontSize"),
         mapAction<actions::DecreaseOpacity>("DecreaseOpacity"),
+        mapAction<actions::DumpTrace>("DumpTrace"),
         mapAction<actions::FocusNextSearchMatch>("FocusNextSearchMatch"),
         mapAction<actions::FocusPreviousSearchMatch>("FocusPreviousSearchMatch"),
         mapAction<actions::FollowHyperlink>("FollowHyperlink"),
@@ -68,6 +69,7 @@ optional<Action> fromString(string const& name)
         mapAction<actions::ToggleAllKeyMaps>("ToggleAllKeyMaps"),
         mapAction<actions::ToggleFullscreen>("ToggleFullscreen"),
         mapAction<actions::ToggleInputProtection>("ToggleInputProtection"),
+        mapAction<actions::ToggleRecording>("ToggleRecording"),
         mapAction<actions::ToggleStatusLine>("ToggleStatusLine"),
         mapAction<actions::ToggleTitleBar>("ToggleTitleBar"),
         mapAction<actions::TraceBreakAtEmptyQueue>("TraceBreakAtEmptyQueue"),
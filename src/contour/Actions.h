@@ -28,6 +28,16 @@ enum class CopyFormat
     PNG,
 };
 
+// Defines the file format to record the PTY output of a session in.
+enum class RecordingFormat
+{
+    // Records asciicast v2, to be played back by asciinema.
+    Asciicast,
+
+    // Records the bytes exactly as read, to be replayed by bench-headless.
+    Binary,
+};
+
 // clang-format off
 struct CancelSelection{};
 struct ChangeProfile{ std::string name; };
@@ -37,6 +47,7 @@ struct CopySelection{ CopyFormat format = CopyFormat::Text; };
 struct CreateDebugDump{};
 struct DecreaseFontSize{};
 struct DecreaseOpacity{};
+struct DumpTrace{};
 struct FocusNextSearchMatch{};
 struct FocusPreviousSearchMatch{};
 struct FollowHyperlink{};
@@ -69,6 +80,7 @@ struct SendChars{ std::string chars; };
 struct ToggleAllKeyMaps{};
 struct ToggleFullscreen{};
 struct ToggleInputProtection{};
+struct ToggleRecording{ RecordingFormat format = RecordingFormat::Asciicast; };
 struct ToggleStatusLine{};
 struct ToggleTitleBar{};
 struct TraceBreakAtEmptyQueue{};
@@ -91,6 +103,7 @@ using Action = std::variant<CancelSelection,
                             CreateDebugDump,
                             DecreaseFontSize,
                             DecreaseOpacity,
+                            DumpTrace,
                             FocusNextSearchMatch,
                             FocusPreviousSearchMatch,
                             FollowHyperlink,
@@ -123,6 +136,7 @@ using Action = std::variant<CancelSelection,
                             ToggleAllKeyMaps,
                             ToggleFullscreen,
                             ToggleInputProtection,
+                            ToggleRecording,
                             ToggleStatusLine,
                             ToggleTitleBar,
                             TraceBreakAtEmptyQueue,
@@ -156,6 +170,7 @@ DECLARE_ACTION_FMT(CopySelection)
 DECLARE_ACTION_FMT(CreateDebugDump)
 DECLARE_ACTION_FMT(DecreaseFontSize)
 DECLARE_ACTION_FMT(DecreaseOpacity)
+DECLARE_ACTION_FMT(DumpTrace)
 DECLARE_ACTION_FMT(FocusNextSearchMatch)
 DECLARE_ACTION_FMT(FocusPreviousSearchMatch)
 DECLARE_ACTION_FMT(FollowHyperlink)
@@ -188,6 +203,7 @@ DECLARE_ACTION_FMT(SendChars)
 DECLARE_ACTION_FMT(ToggleAllKeyMaps)
 DECLARE_ACTION_FMT(ToggleFullscreen)
 DECLARE_ACTION_FMT(ToggleInputProtection)
+DECLARE_ACTION_FMT(ToggleRecording)
 DECLARE_ACTION_FMT(ToggleStatusLine)
 DECLARE_ACTION_FMT(ToggleTitleBar)
 DECLARE_ACTION_FMT(TraceBreakAtEmptyQueue)
@@ -220,6 +236,7 @@ struct fmt::formatter<contour::actions::Action>: fmt::formatter<std::string>
         HANDLE_ACTION(CreateDebugDump);
         HANDLE_ACTION(DecreaseFontSize);
         HANDLE_ACTION(DecreaseOpacity);
+        HANDLE_ACTION(DumpTrace);
         HANDLE_ACTION(FocusNextSearchMatch);
         HANDLE_ACTION(FocusPreviousSearchMatch);
         HANDLE_ACTION(FollowHyperlink);
@@ -252,6 +269,7 @@ struct fmt::formatter<contour::actions::Action>: fmt::formatter<std::string>
         HANDLE_ACTION(ToggleAllKeyMaps);
         HANDLE_ACTION(ToggleFullscreen);
         HANDLE_ACTION(ToggleInputProtection);
+        HANDLE_ACTION(ToggleRecording);
         HANDLE_ACTION(ToggleStatusLine);
         HANDLE_ACTION(ToggleTitleBar);
         HANDLE_ACTION(TraceBreakAtEmptyQueue);
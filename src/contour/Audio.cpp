@@ -10,6 +10,8 @@
     #include <QtMultimedia/QMediaDevices>
 #endif
 
+#include <utility>
+
 using namespace contour;
 
 namespace
@@ -62,10 +64,19 @@ Audio::Audio()
     _audioSink = std::make_unique<QtAudioSink>(f);
 
     _audioSink->moveToThread(&_soundThread);
+    _audioBuffer.moveToThread(&_soundThread);
 
-    connect(_audioSink.get(), &QtAudioSink::stateChanged, this, &Audio::handleStateChanged);
+    // Synthesizes and plays on the sound thread, where the audio sink lives, rather than the caller's.
+    connect(_audioSink.get(), &QtAudioSink::stateChanged, _audioSink.get(), [this](QAudio::State state) {
+        handleStateChanged(state);
+    });
     qRegisterMetaType<std::vector<int>>();
-    connect(this, &Audio::play, this, &Audio::handlePlayback);
+    connect(this,
+            &Audio::play,
+            _audioSink.get(),
+            [this](int volume, int duration, std::vector<int> const& notes) {
+                handlePlayback(volume, duration, notes);
+            });
     _soundThread.start();
 }
 
@@ -77,22 +88,32 @@ Audio::~Audio()
 
 void Audio::fillBuffer(int volume, int duration, gsl::span<int const> notes)
 {
-    for (auto const i: notes)
-    {
-        auto b = createMusicalNote(volume, duration, i);
-        _byteArray.append(reinterpret_cast<char const*>(b.data()), static_cast<int>(2 * b.size()));
-    }
+    for (auto const note: notes)
+        _byteArray.append(cachedMusicalNote(volume, duration, note));
+}
+
+QByteArray const& Audio::cachedMusicalNote(int volume, int duration, int note)
+{
+    auto const key = NoteKey { volume, duration, note };
+    if (auto const i = _noteCache.find(key); i != _noteCache.end())
+        return i->second;
+
+    if (_noteCache.size() >= MaxCachedNotes)
+        _noteCache.clear();
+
+    auto const samples = createMusicalNote(volume, duration, note);
+    auto pcm =
+        QByteArray(reinterpret_cast<char const*>(samples.data()), static_cast<int>(2 * samples.size()));
+    return _noteCache.emplace(key, std::move(pcm)).first->second;
 }
 
 void Audio::handlePlayback(int volume, int duration, std::vector<int> const& notes)
 {
     Require(_audioSink);
-    if (_audioSink->state() == QAudio::State::ActiveState)
-    {
-        fillBuffer(volume, duration, gsl::span(notes.data(), notes.size()));
-        return;
-    }
     fillBuffer(volume, duration, gsl::span(notes.data(), notes.size()));
+    if (_audioSink->state() == QAudio::State::ActiveState)
+        return; // queued behind what is being played
+
     _audioBuffer.setBuffer(&_byteArray);
     _audioBuffer.open(QIODevice::ReadWrite);
     _audioSink->start(&_audioBuffer);
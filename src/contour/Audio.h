@@ -2,7 +2,9 @@
 
 #include <gsl/span>
 
+#include <map>
 #include <memory>
+#include <tuple>
 
 #include <qbuffer.h>
 #include <qthread.h>
@@ -36,8 +38,14 @@ class Audio: public QObject
 
   private:
     void fillBuffer(int volume, int duration, gsl::span<const int> notes);
+    QByteArray const& cachedMusicalNote(int volume, int duration, int note);
     static std::vector<std::int16_t> createMusicalNote(double volume, int duration, int note) noexcept;
 
+    // Synthesized notes by volume, duration and note, as melodies tend to repeat them.
+    using NoteKey = std::tuple<int, int, int>;
+    static constexpr size_t MaxCachedNotes = 64;
+    std::map<NoteKey, QByteArray> _noteCache;
+
     QByteArray _byteArray;
     QBuffer _audioBuffer;
     QThread _soundThread;
@@ -27,13 +27,16 @@
 
 #include <algorithm>
 #include <array>
+#include <charconv>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -67,6 +70,7 @@ using vtbackend::CellRGBColorAndAlphaPair;
 using vtbackend::ColumnCount;
 using vtbackend::Infinite;
 using vtbackend::LineCount;
+using vtbackend::MaxHistoryLineCount;
 using vtbackend::PageSize;
 
 using contour::actions::Action;
@@ -285,6 +289,33 @@ namespace
         return nullopt;
     }
 
+    optional<char32_t> parseCodepoint(string_view text)
+    {
+        if (text.size() > 2 && (text[0] == 'U' || text[0] == 'u') && text[1] == '+')
+            text.remove_prefix(2);
+
+        auto value = uint32_t { 0 };
+        auto const* const end = text.data() + text.size();
+        auto const [ptr, ec] = std::from_chars(text.data(), end, value, 16);
+        if (ec != std::errc {} || ptr != end || value > 0x10FFFF)
+            return nullopt;
+
+        return static_cast<char32_t>(value);
+    }
+
+    /// Parses a codepoint range, such as "U+E0A0-U+E0D4", or a single codepoint, such as "U+2665".
+    optional<vtrasterizer::CodepointRange> parseCodepointRange(string const& text)
+    {
+        auto const separator = text.find('-');
+        auto const first = parseCodepoint(string_view(text).substr(0, separator));
+        auto const last =
+            separator != string::npos ? parseCodepoint(string_view(text).substr(separator + 1)) : first;
+        if (!first || !last || *last < *first)
+            return nullopt;
+
+        return vtrasterizer::CodepointRange { *first, *last };
+    }
+
     void createFileIfNotExists(fs::path const& path)
     {
         if (!fs::is_regular_file(path))
@@ -496,7 +527,27 @@ namespace
         checkForSuperfluousKeys(root, "", usedKeys);
     }
 
-    optional<std::string> readFile(fs::path const& path)
+    // A file read while loading a configuration, telling whether that configuration became stale.
+    struct ConfigDependency
+    {
+        fs::path path;
+        optional<fs::file_time_type> lastWriteTime; // std::nullopt if the file did not exist
+        crispy::strong_hash hash { 0, 0, 0, 0 };   // of the file contents
+    };
+
+    // The dependencies of the configuration being loaded on this thread, if any.
+    thread_local vector<ConfigDependency>* recordedDependencies = nullptr;
+
+    optional<fs::file_time_type> lastWriteTime(fs::path const& path)
+    {
+        auto ec = std::error_code {};
+        auto const time = fs::last_write_time(path, ec);
+        if (ec)
+            return nullopt;
+        return time;
+    }
+
+    optional<std::string> readFileContents(fs::path const& path)
     {
         if (!fs::exists(path))
             return nullopt;
@@ -512,6 +563,46 @@ namespace
         return { text };
     }
 
+    ConfigDependency inspectDependency(fs::path const& path, optional<string> const& contents)
+    {
+        auto dependency = ConfigDependency { path, lastWriteTime(path) };
+        if (contents)
+            dependency.hash = crispy::strong_hash::compute(*contents);
+        return dependency;
+    }
+
+    // Reads the file, recording it as dependency of the configuration being loaded, even if missing.
+    optional<std::string> readFile(fs::path const& path)
+    {
+        auto text = readFileContents(path);
+        if (recordedDependencies)
+            recordedDependencies->emplace_back(inspectDependency(path, text));
+        return text;
+    }
+
+    bool isUpToDate(ConfigDependency const& dependency)
+    {
+        auto const time = lastWriteTime(dependency.path);
+        if (time == dependency.lastWriteTime)
+            return true;
+        if (!time || !dependency.lastWriteTime)
+            return false;
+
+        // Saved (or touched) without modifying it.
+        auto const contents = readFileContents(dependency.path);
+        return contents && crispy::strong_hash::compute(*contents) == dependency.hash;
+    }
+
+    // A configuration loaded before, along with the files it has been loaded from.
+    struct ConfigSnapshot
+    {
+        Config config;
+        vector<ConfigDependency> dependencies;
+    };
+
+    std::mutex configSnapshotsMutex;
+    std::unordered_map<std::string, ConfigSnapshot> configSnapshots; // keyed by the configuration file
+
     std::vector<fs::path> configHomes(string const& programName)
     {
         std::vector<fs::path> paths;
@@ -672,6 +763,10 @@ namespace
         auto uintValue = cursorConfig.cursorBlinkInterval.count();
         tryLoadChildRelative(usedKeys, rootNode, basePath, "blinking_interval", uintValue, configLog);
         cursorConfig.cursorBlinkInterval = chrono::milliseconds(uintValue);
+
+        uintValue = cursorConfig.cursorBlinkTimeout.count();
+        tryLoadChildRelative(usedKeys, rootNode, basePath, "blinking_timeout", uintValue, configLog);
+        cursorConfig.cursorBlinkTimeout = chrono::milliseconds(uintValue);
     }
 
     optional<vtbackend::Modifier> parseModifierKey(string const& key)
@@ -960,6 +1055,21 @@ namespace
             }
         }
 
+        if (holds_alternative<actions::ToggleRecording>(action))
+        {
+            if (auto node = parent["format"]; node && node.IsScalar())
+            {
+                usedKeys.emplace(prefix + ".format");
+                auto const formatString = toUpper(node.as<string>());
+                if (formatString == "BINARY")
+                    return actions::ToggleRecording { actions::RecordingFormat::Binary };
+                if (formatString != "ASCIICAST")
+                    errorLog()("Invalid format '{}' in ToggleRecording action. Defaulting to 'asciicast'.",
+                               node.as<string>());
+                return actions::ToggleRecording { actions::RecordingFormat::Asciicast };
+            }
+        }
+
         if (holds_alternative<actions::PasteClipboard>(action))
         {
             if (auto node = parent["strip"]; node && node.IsScalar())
@@ -1445,6 +1555,16 @@ namespace
             // Override with values from profile
             tryLoadChildRelative(usedKeys, profile, basePath, "ssh.port", ssh.port, logger);
             tryLoadChildRelative(usedKeys, profile, basePath, "ssh.forward_agent", ssh.forwardAgent, logger);
+            tryLoadChildRelative(usedKeys, profile, basePath, "ssh.compression", ssh.compression, logger);
+            tryLoadChildRelative(usedKeys, profile, basePath, "ssh.window_size", ssh.windowSize, logger);
+            tryLoadChildRelative(usedKeys, profile, basePath, "ssh.packet_size", ssh.packetSize, logger);
+            if (ssh.packetSize > vtpty::SshHostConfig::DefaultPacketSize)
+            {
+                // Servers do not need to accept larger packets, e.g. OpenSSH does not.
+                logger()("ssh.packet_size too large. Forcing {} bytes.",
+                         vtpty::SshHostConfig::DefaultPacketSize);
+                ssh.packetSize = vtpty::SshHostConfig::DefaultPacketSize;
+            }
             if (!tryLoadChildRelative(usedKeys, profile, basePath, "ssh.user", ssh.username, logger)
                 && ssh.username.empty())
                 ssh.username = vtpty::Process::userName();
@@ -1463,6 +1583,24 @@ namespace
         tryLoadChildRelative(usedKeys, profile, basePath, "fullscreen", terminalProfile.fullscreen, logger);
         tryLoadChildRelative(
             usedKeys, profile, basePath, "refresh_rate", terminalProfile.refreshRate.value, logger);
+        tryLoadChildRelative(
+            usedKeys, profile, basePath, "vsync_frame_pacing", terminalProfile.vsyncFramePacing, logger);
+        auto synchronizedOutputTimeout = terminalProfile.synchronizedOutputTimeout.count();
+        tryLoadChildRelative(
+            usedKeys, profile, basePath, "synchronized_output_timeout", synchronizedOutputTimeout, logger);
+        terminalProfile.synchronizedOutputTimeout = chrono::milliseconds(synchronizedOutputTimeout);
+        auto const loadThreadQos = [&](string const& key, crispy::thread_qos& qos) {
+            auto name = string(crispy::to_string(qos));
+            if (!tryLoadChildRelative(usedKeys, profile, basePath, key, name, logger))
+                return;
+            if (auto const value = crispy::parse_thread_qos(name))
+                qos = *value;
+            else
+                logger()("Invalid value for config entry {}: {}", key, name);
+        };
+        loadThreadQos("thread_priority.input", terminalProfile.threadPriority.input);
+        loadThreadQos("thread_priority.background", terminalProfile.threadPriority.background);
+        loadThreadQos("thread_priority.render", terminalProfile.threadPriority.render);
         tryLoadChildRelative(usedKeys,
                              profile,
                              basePath,
@@ -1759,7 +1897,7 @@ namespace
         auto const static renderModeMap = array {
             pair { "lcd"sv, text::render_mode::lcd },           pair { "light"sv, text::render_mode::light },
             pair { "gray"sv, text::render_mode::gray },         pair { ""sv, text::render_mode::gray },
-            pair { "monochrome"sv, text::render_mode::bitmap },
+            pair { "monochrome"sv, text::render_mode::bitmap }, pair { "sdf"sv, text::render_mode::sdf },
         };
 
         // NOLINTNEXTLINE(readability-qualified-auto)
@@ -1821,6 +1959,30 @@ namespace
                              "history.scroll_multiplier",
                              terminalProfile.historyScrollMultiplier,
                              logger);
+        tryLoadChildRelative(usedKeys,
+                             profile,
+                             basePath,
+                             "history.spill_to_disk",
+                             terminalProfile.historySpillToDisk,
+                             logger);
+        tryLoadChildRelative(usedKeys,
+                             profile,
+                             basePath,
+                             "history.memory_budget",
+                             terminalProfile.historyMemoryBudget,
+                             logger);
+        tryLoadChildRelative(usedKeys,
+                             profile,
+                             basePath,
+                             "history.search_index",
+                             terminalProfile.historySearchIndex,
+                             logger);
+        tryLoadChildRelative(usedKeys,
+                             profile,
+                             basePath,
+                             "history.persist",
+                             terminalProfile.historyPersist,
+                             logger);
 
         float floatValue = 1.0;
         tryLoadChildRelative(usedKeys, profile, basePath, "background.opacity", floatValue, logger);
@@ -1853,6 +2015,15 @@ namespace
                              terminalProfile.highlightDoubleClickedWord,
                              logger);
 
+        tryLoadChildRelative(usedKeys, profile, basePath, "search_regex", terminalProfile.searchRegex, logger);
+
+        tryLoadChildRelative(usedKeys,
+                             profile,
+                             basePath,
+                             "predictive_echo",
+                             terminalProfile.predictiveEcho,
+                             logger);
+
         parseCursorConfig(
             terminalProfile.inputModes.insert.cursor, profile["cursor"], usedKeys, basePath + ".cursor");
         usedKeys.emplace(basePath + ".cursor");
@@ -2044,15 +2215,91 @@ Config loadConfigFromFile(fs::path const& fileName)
     return config;
 }
 
+ProfileChanges diffProfiles(Config const& oldConfig,
+                            TerminalProfile const& oldProfile,
+                            Config const& newConfig,
+                            TerminalProfile const& newProfile)
+{
+    auto const sameHistoryLineCount = [](MaxHistoryLineCount a, MaxHistoryLineCount b) {
+        if (holds_alternative<Infinite>(a) || holds_alternative<Infinite>(b))
+            return a.index() == b.index();
+        return get<LineCount>(a) == get<LineCount>(b);
+    };
+
+    auto changes = ProfileChanges {};
+
+    changes.terminal = oldConfig.wordDelimiters != newConfig.wordDelimiters
+                       || oldConfig.bypassMouseProtocolModifiers != newConfig.bypassMouseProtocolModifiers
+                       || oldConfig.mouseBlockSelectionModifiers != newConfig.mouseBlockSelectionModifiers
+                       || oldConfig.maxImageColorRegisters != newConfig.maxImageColorRegisters
+                       || oldConfig.maxImageSize != newConfig.maxImageSize
+                       || oldConfig.maxImageMemory != newConfig.maxImageMemory
+                       || oldConfig.maxClipboardSize != newConfig.maxClipboardSize
+                       || oldConfig.sixelScrolling != newConfig.sixelScrolling
+                       || oldProfile.copyLastMarkRangeOffset != newProfile.copyLastMarkRangeOffset
+                       || oldProfile.terminalId != newProfile.terminalId
+                       || oldProfile.initialStatusDisplayType != newProfile.initialStatusDisplayType
+                       || oldProfile.highlightTimeout != newProfile.highlightTimeout
+                       || oldProfile.modalCursorScrollOff != newProfile.modalCursorScrollOff;
+
+    changes.cursor = oldProfile.inputModes.insert.cursor != newProfile.inputModes.insert.cursor;
+
+    changes.colors = oldProfile.colors != newProfile.colors;
+
+    changes.history = !sameHistoryLineCount(oldProfile.maxHistoryLineCount, newProfile.maxHistoryLineCount)
+                      || oldProfile.historySpillToDisk != newProfile.historySpillToDisk
+                      || oldProfile.historyMemoryBudget != newProfile.historyMemoryBudget
+                      || oldProfile.historySearchIndex != newProfile.historySearchIndex
+                      || oldProfile.historyPersist != newProfile.historyPersist;
+
+    changes.window =
+        oldProfile.maximized != newProfile.maximized || oldProfile.fullscreen != newProfile.fullscreen;
+
+    changes.display = oldProfile.backgroundBlur != newProfile.backgroundBlur
+                      || oldProfile.refreshRate.value != newProfile.refreshRate.value
+                      || oldProfile.vsyncFramePacing != newProfile.vsyncFramePacing
+                      || oldProfile.synchronizedOutputTimeout != newProfile.synchronizedOutputTimeout
+                      || oldProfile.threadPriority.input != newProfile.threadPriority.input
+                      || oldProfile.threadPriority.background != newProfile.threadPriority.background
+                      || oldProfile.hyperlinkDecoration.normal != newProfile.hyperlinkDecoration.normal
+                      || oldProfile.hyperlinkDecoration.hover != newProfile.hyperlinkDecoration.hover;
+
+    changes.fonts = oldProfile.fonts != newProfile.fonts;
+
+    return changes;
+}
+
 /**
- * @return success or failure of loading the config file.
+ * Loads the configuration file, reusing the configuration loaded from it before, unless it (or any other
+ * file read for loading it, such as color schemes) has been modified since.
+ *
+ * So that sessions reloading a live configuration, and any new window, do not need to parse it again.
  */
 void loadConfigFromFile(Config& config, fs::path const& fileName)
 {
+    auto const key = fileName.string();
+    {
+        auto const _ = std::lock_guard { configSnapshotsMutex };
+        if (auto const i = configSnapshots.find(key);
+            i != configSnapshots.end() && std::all_of(i->second.dependencies.begin(),
+                                                      i->second.dependencies.end(),
+                                                      isUpToDate))
+        {
+            configLog()("Reusing configuration loaded from file: {}", key);
+            config = i->second.config;
+            return;
+        }
+    }
+
+    auto dependencies = vector<ConfigDependency> {};
+    auto* const outerDependencies = std::exchange(recordedDependencies, &dependencies);
+    auto const restoreDependencies = crispy::finally { [&]() { recordedDependencies = outerDependencies; } };
+
     auto logger = configLog;
     logger()("Loading configuration from file: {} ", fileName.string());
     config.backingFilePath = fileName;
     createFileIfNotExists(config.backingFilePath);
+    readFile(fileName); // recorded before parsing it, so that modifying it meanwhile makes it stale
     auto usedKeys = UsedKeys {};
     YAML::Node doc;
     try
@@ -2129,6 +2376,7 @@ void loadConfigFromFile(Config& config, fs::path const& fileName)
     tryLoadValue(usedKeys, doc, "spawn_new_process", config.spawnNewProcess, logger);
 
     tryLoadValue(usedKeys, doc, "live_config", config.live, logger);
+    tryLoadValue(usedKeys, doc, "max_clipboard_size", config.maxClipboardSize, logger);
 
     if (auto const loggingNode = doc["logging"]; loggingNode && loggingNode.IsMap())
     {
@@ -2141,7 +2389,7 @@ void loadConfigFromFile(Config& config, fs::path const& fileName)
             {
                 auto const tag = tagNode.as<string>();
                 usedKeys.emplace("logging.tags." + tag);
-                logstore::enable(tag);
+                logstore::enable(tag); // may be a pattern, such as "vt.*"
             }
         }
     }
@@ -2152,6 +2400,11 @@ void loadConfigFromFile(Config& config, fs::path const& fileName)
     auto logFilePath = ""s;
     tryLoadValue(usedKeys, doc, "logging.file", logFilePath, logger);
 
+    // Formats and writes log messages on a background thread, so that logging barely slows down the terminal.
+    auto logAsynchronous = false;
+    tryLoadValue(usedKeys, doc, "logging.asynchronous", logAsynchronous, logger);
+    logstore::sink::console().set_asynchronous(logAsynchronous);
+
     if (logEnabled)
     {
         logFilePath =
@@ -2161,6 +2414,7 @@ void loadConfigFromFile(Config& config, fs::path const& fileName)
         if (!logFilePath.empty())
         {
             config.loggingSink = make_shared<logstore::sink>(logEnabled, make_shared<ofstream>(logFilePath));
+            config.loggingSink->set_asynchronous(logAsynchronous);
             logstore::set_sink(*config.loggingSink);
         }
     }
@@ -2169,6 +2423,7 @@ void loadConfigFromFile(Config& config, fs::path const& fileName)
     tryLoadValue(usedKeys, doc, "images.sixel_register_count", config.maxImageColorRegisters, logger);
     tryLoadValue(usedKeys, doc, "images.max_width", config.maxImageSize.width, logger);
     tryLoadValue(usedKeys, doc, "images.max_height", config.maxImageSize.height, logger);
+    tryLoadValue(usedKeys, doc, "images.max_memory", config.maxImageMemory, logger);
 
     if (auto colorschemes = doc["color_schemes"]; colorschemes)
     {
@@ -2194,6 +2449,8 @@ void loadConfigFromFile(Config& config, fs::path const& fileName)
             config.renderingBackend = RenderingBackend::OpenGL;
         else if (renderingBackendStr == "SOFTWARE"sv)
             config.renderingBackend = RenderingBackend::Software;
+        else if (renderingBackendStr == "NATIVE"sv)
+            config.renderingBackend = RenderingBackend::Native;
         else if (renderingBackendStr != ""sv && renderingBackendStr != "DEFAULT"sv)
             errorLog()("Unknown renderer: {}.", renderingBackendStr);
     }
@@ -2201,6 +2458,27 @@ void loadConfigFromFile(Config& config, fs::path const& fileName)
     tryLoadValue(
         usedKeys, doc, "renderer.tile_hashtable_slots", config.textureAtlasHashtableSlots.value, logger);
     tryLoadValue(usedKeys, doc, "renderer.tile_cache_count", config.textureAtlasTileCount.value, logger);
+    tryLoadValue(usedKeys, doc, "renderer.tile_cache_memory", config.textureAtlasMemory, logger);
+    tryLoadValue(usedKeys, doc, "renderer.gpu_memory_budget", config.gpuMemoryBudget, logger);
+    tryLoadValue(usedKeys, doc, "renderer.async_glyphs", config.asyncGlyphs, logger);
+    tryLoadValue(usedKeys, doc, "renderer.render_thread", config.renderThread, logger);
+
+    if (auto const rendererNode = doc["renderer"]; rendererNode && rendererNode.IsMap())
+    {
+        if (auto const rangesNode = rendererNode["prewarm_glyphs"]; rangesNode && rangesNode.IsSequence())
+        {
+            usedKeys.emplace("renderer.prewarm_glyphs");
+            config.prewarmedCodepoints.clear();
+            for (auto const& rangeNode: rangesNode)
+            {
+                auto const text = rangeNode.as<string>();
+                if (auto const range = parseCodepointRange(text))
+                    config.prewarmedCodepoints.emplace_back(*range);
+                else
+                    errorLog()("Invalid codepoint range in renderer.prewarm_glyphs: {}", text);
+            }
+        }
+    }
     tryLoadValue(usedKeys, doc, "renderer.tile_direct_mapping", config.textureAtlasDirectMapping, logger);
 
     if (doc["mock_font_locator"].IsSequence())
@@ -2236,6 +2514,16 @@ void loadConfigFromFile(Config& config, fs::path const& fileName)
         config.ptyBufferObjectSize = 1024 * 256;
     }
 
+    tryLoadValue(usedKeys, doc, "pty_reader_thread", config.ptyReaderThread, logger);
+    tryLoadValue(usedKeys, doc, "parse_slice_size", config.parseSliceSize, logger);
+    tryLoadValue(usedKeys, doc, "pty_io_uring", config.ptyIoUring, logger);
+    tryLoadValue(usedKeys, doc, "pty_write_queue_size", config.ptyWriteQueueSize, logger);
+    tryLoadValue(usedKeys, doc, "pty_stdout_ring_size", config.ptyStdoutRingSize, logger);
+    tryLoadValue(usedKeys, doc, "pty_reactor", config.ptyReactor, logger);
+    tryLoadValue(usedKeys, doc, "pty_reactor_threads", config.ptyReactorThreads, logger);
+    tryLoadValue(usedKeys, doc, "warm_shells", config.warmShells, logger);
+    tryLoadValue(usedKeys, doc, "metrics_endpoint", config.metricsEndpoint, logger);
+
     tryLoadValue(usedKeys, doc, "reflow_on_resize", config.reflowOnResize, logger);
 
     tryLoadValue(usedKeys, doc, "default_profile", config.defaultProfileName, logger);
@@ -2295,7 +2583,12 @@ void loadConfigFromFile(Config& config, fs::path const& fileName)
             }
     }
 
+    config.inputMappings.compile();
+
     checkForSuperfluousKeys(doc, usedKeys);
+
+    auto const _ = std::lock_guard { configSnapshotsMutex };
+    configSnapshots[key] = ConfigSnapshot { config, std::move(dependencies) };
 }
 
 optional<std::string> readConfigFile(std::string const& filename)
@@ -22,6 +22,7 @@
 #include <crispy/StrongLRUHashtable.h>
 #include <crispy/assert.h>
 #include <crispy/size.h>
+#include <crispy/thread_qos.h>
 
 #include <chrono>
 #include <filesystem>
@@ -31,6 +32,7 @@
 #include <system_error>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 namespace contour::config
 {
@@ -66,6 +68,19 @@ struct InputMappings
     std::vector<KeyInputMapping> keyMappings;
     std::vector<CharInputMapping> charMappings;
     std::vector<MouseInputMapping> mouseMappings;
+
+    // The mappings above, compiled for resolving input events by compile().
+    vtbackend::InputBindingTable<vtbackend::Key, ActionList> keyTable;
+    vtbackend::InputBindingTable<char32_t, ActionList> charTable;
+    vtbackend::InputBindingTable<vtbackend::MouseButton, ActionList> mouseTable;
+
+    /// (Re-)compiles the lookup tables, to be called after modifying the mappings.
+    void compile()
+    {
+        keyTable = vtbackend::InputBindingTable<vtbackend::Key, ActionList> { keyMappings };
+        charTable = vtbackend::InputBindingTable<char32_t, ActionList> { charMappings };
+        mouseTable = vtbackend::InputBindingTable<vtbackend::MouseButton, ActionList> { mouseMappings };
+    }
 };
 
 namespace helper
@@ -121,11 +136,23 @@ std::vector<actions::Action> const* apply(
     return nullptr;
 }
 
+template <typename Input>
+std::vector<actions::Action> const* apply(vtbackend::InputBindingTable<Input, ActionList> const& table,
+                                          Input input,
+                                          vtbackend::Modifiers modifiers,
+                                          uint8_t actualModeFlags)
+{
+    return table.find(input, modifiers, actualModeFlags);
+}
+
 struct CursorConfig
 {
     vtbackend::CursorShape cursorShape { vtbackend::CursorShape::Block };
     vtbackend::CursorDisplay cursorDisplay { vtbackend::CursorDisplay::Steady };
     std::chrono::milliseconds cursorBlinkInterval;
+    std::chrono::milliseconds cursorBlinkTimeout { 15000 };
+
+    bool operator==(CursorConfig const&) const noexcept = default;
 };
 
 struct InputModeConfig
@@ -137,11 +164,15 @@ struct DualColorConfig
 {
     vtbackend::ColorPalette darkMode {};
     vtbackend::ColorPalette lightMode {};
+
+    bool operator==(DualColorConfig const&) const noexcept = default;
 };
 
 struct SimpleColorConfig
 {
     vtbackend::ColorPalette colors {};
+
+    bool operator==(SimpleColorConfig const&) const noexcept = default;
 };
 
 using ColorConfig = std::variant<SimpleColorConfig, DualColorConfig>;
@@ -157,6 +188,16 @@ struct TerminalProfile
     bool sizeIndicatorOnResize = true;
     bool mouseHideWhileTyping = true;
     vtbackend::RefreshRate refreshRate = { 0.0 }; // 0=auto
+    bool vsyncFramePacing = false;
+    std::chrono::milliseconds synchronizedOutputTimeout { 1000 }; // 0 = never render before it ends
+
+    // Scheduling classes of the session's threads.
+    struct
+    {
+        crispy::thread_qos input = crispy::thread_qos::Interactive;  // while the session is visible
+        crispy::thread_qos background = crispy::thread_qos::Utility; // while the session is not visible
+        crispy::thread_qos render = crispy::thread_qos::Interactive;
+    } threadPriority;
     vtbackend::LineOffset copyLastMarkRangeOffset = vtbackend::LineOffset(0);
 
     std::string wmClass;
@@ -175,6 +216,10 @@ struct TerminalProfile
 
     vtbackend::MaxHistoryLineCount maxHistoryLineCount;
     vtbackend::LineCount historyScrollMultiplier = vtbackend::LineCount(3);
+    bool historySpillToDisk = false;
+    size_t historyMemoryBudget = 64; // in MiB
+    bool historySearchIndex = true;
+    bool historyPersist = false; // restores the primary screen's lines of the last session on start
     ScrollBarPosition scrollbarPosition = ScrollBarPosition::Right;
     vtbackend::StatusDisplayPosition statusDisplayPosition = vtbackend::StatusDisplayPosition::Bottom;
     bool syncWindowTitleWithHostWritableStatusDisplay = false;
@@ -206,6 +251,8 @@ struct TerminalProfile
     std::chrono::milliseconds smoothLineScrolling { 100 };
     std::chrono::milliseconds highlightTimeout { 300 };
     bool highlightDoubleClickedWord = true;
+    bool searchRegex = false;
+    bool predictiveEcho = false;
     vtbackend::StatusDisplayType initialStatusDisplayType = vtbackend::StatusDisplayType::None;
 
     vtbackend::Opacity backgroundOpacity; // value between 0 (fully transparent) and 0xFF (fully visible).
@@ -231,11 +278,36 @@ struct TerminalProfile
     std::map<vtbackend::DECMode, bool> frozenModes;
 };
 
+/// Tells which parts of a profile, along with the configuration it is used with, differ between two
+/// configurations, so that reloading the configuration reapplies just those.
+struct ProfileChanges
+{
+    bool terminal = false; // terminal behavior, such as its ID, word delimiters or image limits
+    bool cursor = false;   // cursor shape, display and blinking
+    bool colors = false;   // color palettes, to be re-resolved
+    bool history = false;  // scrollback size, spilling to disk and search index
+    bool window = false;   // whether the window is maximized or fullscreen
+    bool display = false;  // background blur, refresh rate, frame pacing and hyperlink decorations
+    bool fonts = false;    // font descriptions, invalidating the glyph caches
+
+    /// @returns changes covering everything, for applying a profile for the first time.
+    [[nodiscard]] static constexpr ProfileChanges all() noexcept
+    {
+        return { true, true, true, true, true, true, true };
+    }
+
+    [[nodiscard]] constexpr bool any() const noexcept
+    {
+        return terminal || cursor || colors || history || window || display || fonts;
+    }
+};
+
 enum class RenderingBackend
 {
     Default,
     Software,
     OpenGL,
+    Native, // the platform's native graphics API (Vulkan, Metal, Direct3D), if built with the QRhi renderer
 };
 
 // NB: All strings in here must be UTF8-encoded.
@@ -268,6 +340,30 @@ struct Config
     /// This value is automatically adjusted if too small.
     crispy::lru_capacity textureAtlasTileCount = crispy::lru_capacity { 4000 };
 
+    /// Maximum GPU memory the texture atlas may occupy, unless more is needed to render a full page.
+    size_t textureAtlasMemory = 64; // in MiB
+
+    /// Maximum GPU memory of all windows together, evicting what is cheapest to recreate when exceeded.
+    size_t gpuMemoryBudget = 0; // in MiB, or 0 for no limit
+
+    /// Shapes and rasterizes glyphs on a worker thread, rendering them a frame later instead of stalling.
+    bool asyncGlyphs = false;
+
+    /// Forces the Qt Quick scene graph to render on its own thread, decoupled from the GUI thread.
+    bool renderThread = false;
+
+    /// Codepoints to shape and rasterize in the background when fonts are loaded,
+    /// so that e.g. a shell prompt full of symbols does not cause glyph cache misses once displayed.
+    std::vector<vtrasterizer::CodepointRange> prewarmedCodepoints = {
+        { 0x0020, 0x007E }, // US-ASCII
+        { 0x00A0, 0x00FF }, // Latin-1 supplement
+        { 0x2500, 0x259F }, // box drawing, block elements
+        { 0xE0A0, 0xE0D4 }, // Powerline symbols
+        { 0xE5FA, 0xE6B5 }, // Nerd Font: Seti-UI and custom icons
+        { 0xE700, 0xE7C5 }, // Nerd Font: Devicons
+        { 0xF000, 0xF2E0 }, // Nerd Font: Font Awesome
+    };
+
     // Configures the size of the PTY read buffer.
     // Changing this value may result in better or worse throughput performance.
     //
@@ -279,6 +375,34 @@ struct Config
     // Defaults to 1 MB, that's roughly 10k lines when column count is 100.
     size_t ptyBufferObjectSize = 1024lu * 1024lu;
 
+    // Reads from the PTY on a dedicated thread, so that reading and parsing can overlap.
+    bool ptyReaderThread = false;
+
+    // Number of bytes of output parsed at a time before letting input and rendering in, or 0 for no limit.
+    size_t parseSliceSize = 64lu * 1024lu;
+
+    // Reads from the PTY via io_uring (Linux only), saving a system call per chunk read.
+    bool ptyIoUring = false;
+
+    // Input queued for writing to the PTY at most, while the application does not read it.
+    size_t ptyWriteQueueSize = vtpty::DefaultWriteQueueSize;
+
+    // Size of the shared memory ring offered to cooperating clients for their output (Linux only), or 0.
+    size_t ptyStdoutRingSize = 0;
+
+    // Serves the PTYs of all sessions by reactor threads (Linux only), instead of threads per session.
+    bool ptyReactor = false;
+
+    // Number of reactor threads, or 0 for one per CPU core.
+    size_t ptyReactorThreads = 1;
+
+    // Number of shells per profile spawned in advance (Unix only), for new terminals to adopt.
+    size_t warmShells = 0;
+
+    // Endpoint serving the metrics of all sessions in the OpenMetrics format, or empty for none,
+    // see MetricsServer::listen().
+    std::string metricsEndpoint;
+
     bool reflowOnResize = true;
 
     std::unordered_map<std::string, vtbackend::ColorPalette> colorschemes;
@@ -331,10 +455,19 @@ struct Config
     bool sixelScrolling = true;
     vtbackend::ImageSize maxImageSize = {}; // default to runtime system screen size.
     unsigned maxImageColorRegisters = 4096;
+    size_t maxImageMemory = 256; // in MiB
+
+    size_t maxClipboardSize = 16; // in MiB
 
     std::set<std::string> experimentalFeatures;
 };
 
+/// Compares @p oldProfile used with @p oldConfig against @p newProfile used with @p newConfig.
+[[nodiscard]] ProfileChanges diffProfiles(Config const& oldConfig,
+                                          TerminalProfile const& oldProfile,
+                                          Config const& newConfig,
+                                          TerminalProfile const& newProfile);
+
 std::filesystem::path configHome();
 std::filesystem::path configHome(std::string const& programName);
 
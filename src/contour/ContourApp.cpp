@@ -2,6 +2,7 @@
 #include <contour/CaptureScreen.h>
 #include <contour/Config.h>
 #include <contour/ContourApp.h>
+#include <contour/RemoteServer.h>
 
 #include <vtbackend/Capabilities.h>
 #include <vtbackend/Functions.h>
@@ -160,6 +161,7 @@ ContourApp::ContourApp(): app("contour", "Contour Terminal Emulator", CONTOUR_VE
     link("contour.generate.config", bind(&ContourApp::configAction, this));
     link("contour.generate.integration", bind(&ContourApp::integrationAction, this));
     link("contour.info.vt", bind(&ContourApp::infoVT, this));
+    link("contour.serve-remote", bind(&ContourApp::serveRemoteAction, this));
 }
 
 template <typename Callback>
@@ -274,6 +276,18 @@ int ContourApp::captureAction()
         return EXIT_FAILURE;
 }
 
+int ContourApp::serveRemoteAction()
+{
+    auto settings = contour::RemoteServerSettings {};
+    settings.pageSize.lines =
+        vtbackend::LineCount::cast_from(parameters().get<unsigned>("contour.serve-remote.lines"));
+    settings.pageSize.columns =
+        vtbackend::ColumnCount::cast_from(parameters().get<unsigned>("contour.serve-remote.columns"));
+    settings.maxHistoryLineCount =
+        vtbackend::LineCount::cast_from(parameters().get<unsigned>("contour.serve-remote.history"));
+    return contour::serveRemote(settings);
+}
+
 int ContourApp::parserTableAction()
 {
     vtparser::parserTableDot(std::cout);
@@ -383,6 +397,18 @@ crispy::cli::command ContourApp::parameterDefinition() const
                                   "FILE",
                                   CLI::presence::Required },
                 } },
+            CLI::command {
+                "serve-remote",
+                "Runs the login shell in a headless terminal, and streams its screen to a remote client on "
+                "standard output, reading the client's input from standard input, e.g. via ssh.",
+                {
+                    CLI::option {
+                        "lines", CLI::value { 25u }, "Initial number of lines of the screen.", "COUNT" },
+                    CLI::option {
+                        "columns", CLI::value { 80u }, "Initial number of columns of the screen.", "COUNT" },
+                    CLI::option {
+                        "history", CLI::value { 1000u }, "Number of lines kept in the scrollback.", "COUNT" },
+                } },
             CLI::command {
                 "set",
                 "Sets various aspects of the connected terminal.",
@@ -5,13 +5,20 @@
 
 #include <vtpty/Process.h>
 
+#include <vtrasterizer/TextRenderer.h>
+
 #include <text_shaper/font_locator.h>
+#include <text_shaper/font_locator_provider.h>
 
 #include <crispy/CLI.h>
 #include <crispy/logstore.h>
+#include <crispy/trace.h>
 #include <crispy/utils.h>
 
+#include <QtCore/QDataStream>
 #include <QtCore/QProcess>
+#include <QtCore/QProcessEnvironment>
+#include <QtCore/QStandardPaths>
 #if !defined(__APPLE__) && !defined(_WIN32)
     #include <QtDBus/QDBusConnection>
 #endif
@@ -19,16 +26,21 @@
 #include <QtGui/QGuiApplication>
 #include <QtGui/QStyleHints>
 #include <QtGui/QSurfaceFormat>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
 #include <QtQml/QQmlApplicationEngine>
 #include <QtQml/QQmlContext>
 #include <QtWidgets/QApplication>
 
 #include <filesystem>
 #include <iostream>
+#include <optional>
+#include <utility>
 #include <vector>
 
 using std::bind;
 using std::cerr;
+using std::cout;
 using std::get;
 using std::holds_alternative;
 using std::make_unique;
@@ -49,10 +61,62 @@ namespace CLI = crispy::cli;
 namespace contour
 {
 
+namespace
+{
+    // Bumped whenever the layout of a request changes, so that a client and a server of different
+    // versions do not misinterpret each other, but the client falls back to starting itself.
+    constexpr auto ServerProtocolVersion = qint32 { 2 };
+
+    // What a client requests from the server.
+    enum class ServerRequest : qint32
+    {
+        OpenWindow,
+        SessionResourceUsage,
+    };
+
+    // Time the client waits for the server to confirm that it opened the window,
+    // before starting on its own instead.
+    constexpr auto ServerReplyTimeout = 2000; // ms
+
+    QString serverSocketName()
+    {
+#if defined(_WIN32)
+        return QStringLiteral("contour-server-") + QString::fromStdString(Process::userName());
+#else
+        // The runtime directory is private to the user, unlike the temp directory used for plain names.
+        auto const runtimeDirectory = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+        return runtimeDirectory + QStringLiteral("/contour-server.sock");
+#endif
+    }
+
+    // Replaces the program to be run in the shell, as given on the command line.
+    void overrideShellCommand(vtpty::Process::ExecInfo& shell, string exe, vector<string> const& verbatim)
+    {
+        if (verbatim.empty() && exe.empty())
+            return;
+
+        shell.arguments.clear();
+        if (!exe.empty())
+        {
+            shell.program = std::move(exe);
+            for (auto const& i: verbatim)
+                shell.arguments.emplace_back(i);
+        }
+        else
+        {
+            shell.program = verbatim.front();
+            for (size_t i = 1; i < verbatim.size(); ++i)
+                shell.arguments.emplace_back(verbatim.at(i));
+        }
+    }
+} // namespace
+
 ContourGuiApp::ContourGuiApp(): _sessionManager(*this)
 {
     link("contour.terminal", bind(&ContourGuiApp::terminalGuiAction, this));
     link("contour.font-locator", bind(&ContourGuiApp::fontConfigAction, this));
+    link("contour.play", bind(&ContourGuiApp::playAction, this));
+    link("contour.info.sessions", bind(&ContourGuiApp::infoSessionsAction, this));
 }
 
 int ContourGuiApp::run(int argc, char const* argv[])
@@ -60,6 +124,14 @@ int ContourGuiApp::run(int argc, char const* argv[])
     _argc = argc;
     _argv = argv;
 
+    // Records the startup phases and writes them as Chrome trace JSON to the given file.
+    if (auto const* path = getenv("CONTOUR_TRACE"); path && *path)
+        crispy::trace_recorder::global().enable(path);
+
+    // Records the spans of the parse and render hot paths right from the start, to be written by DumpTrace.
+    if (auto const* value = getenv("CONTOUR_FLIGHT_RECORDER"); value && *value && *value != '0')
+        crispy::flight_recorder::global().setEnabled(true);
+
     return ContourApp::run(argc, argv);
 }
 
@@ -67,6 +139,35 @@ crispy::cli::command ContourGuiApp::parameterDefinition() const
 {
     auto command = ContourApp::parameterDefinition();
 
+    command.children.insert(
+        command.children.begin(),
+        CLI::command {
+            "play",
+            "Plays back a recording of PTY output in a window, rendering it as a running session would, "
+            "and prints the frames rendered, dropped frames, frame render times, GPU uploads, and the "
+            "peak RSS at exit. This is for benchmarking the rendering.",
+            CLI::option_list {
+                CLI::option { "config",
+                              CLI::value { contour::config::defaultConfigFilePath() },
+                              "Path to configuration file to load at startup.",
+                              "FILE" },
+                CLI::option {
+                    "profile", CLI::value { ""s }, "Terminal Profile to load (overriding config).", "NAME" },
+                CLI::option { "debug",
+                              CLI::value { ""s },
+                              "Enables debug logging, using a comma (,) seperated list of tags.",
+                              "TAGS" },
+                CLI::option { "speed",
+                              CLI::value { "max"s },
+                              "Plays back as fast as the session takes the output (max), or with the timing "
+                              "it has been recorded with (realtime).",
+                              "SPEED" },
+            },
+            CLI::command_list {},
+            CLI::command_select::Explicit,
+            CLI::verbatim { "FILE",
+                            "Recording to play back, raw or recorded by contour (terminal record FILE)." } });
+
     command.children.insert(
         command.children.begin(),
         CLI::command {
@@ -103,11 +204,21 @@ crispy::cli::command ContourGuiApp::parameterDefinition() const
                               "Enables debug logging, using a comma (,) seperated list of tags.",
                               "TAGS" },
                 CLI::option { "live-config", CLI::value { false }, "Enables live config reloading." },
+                CLI::option { "server",
+                              CLI::value { false },
+                              "Keeps running in the background without a window, opening a new window "
+                              "whenever contour is invoked again, instead of that invocation starting up "
+                              "on its own." },
                 CLI::option {
                     "dump-state-at-exit",
                     CLI::value { ""s },
                     "Dumps internal state at exit into the given directory. This is for debugging contour.",
                     "PATH" },
+                CLI::option { "record",
+                              CLI::value { ""s },
+                              "Records the PTY output of the first session into FILE, as asciicast v2 if "
+                              "FILE ends with .cast, and exactly as read otherwise.",
+                              "FILE" },
                 CLI::option { "early-exit-threshold",
                               CLI::value { 6u },
                               "If the spawned process exits earlier than the given threshold seconds, an "
@@ -144,6 +255,14 @@ crispy::cli::command ContourGuiApp::parameterDefinition() const
             CLI::verbatim { "PROGRAM ARGS...",
                             "Executes given program instead of the one provided in the configuration." } });
 
+    // Running instances are only reachable through the server's socket, which the GUI app serves.
+    for (auto& child: command.children)
+        if (child.name == "info")
+            child.children.emplace_back(CLI::command {
+                "sessions",
+                "Prints the resources (PTY throughput, CPU time, and memory) each session of the running "
+                "server uses. The CPU loads are measured since the previous invocation." });
+
     return command;
 }
 
@@ -154,7 +273,11 @@ std::chrono::seconds ContourGuiApp::earlyExitThreshold() const
 
 string ContourGuiApp::profileName() const
 {
-    if (auto profile = parameters().get<string>("contour.terminal.profile"); !profile.empty())
+    if (!_requestedProfileName.empty())
+        return _requestedProfileName;
+
+    auto const profileKey = _playback ? "contour.play.profile"s : "contour.terminal.profile"s;
+    if (auto profile = parameters().get<string>(profileKey); !profile.empty())
         return profile;
 
     if (!_config.defaultProfileName.empty())
@@ -174,6 +297,14 @@ std::optional<fs::path> ContourGuiApp::dumpStateAtExit() const
     return fs::path(path);
 }
 
+std::optional<fs::path> ContourGuiApp::takeRecordingPath()
+{
+    auto const path = parameters().get<std::string>("contour.terminal.record");
+    if (path.empty() || std::exchange(_recordingPathTaken, true))
+        return std::nullopt;
+    return fs::path(path);
+}
+
 void ContourGuiApp::onExit(TerminalSession& session)
 {
     if (auto const* localProcess = dynamic_cast<vtpty::Process const*>(&session.terminal().device()))
@@ -217,8 +348,11 @@ bool ContourGuiApp::loadConfig(string const& target)
 
     auto const configPath = QString::fromStdString(flags.get<string>(prefix + "config"));
 
-    _config = configPath.isEmpty() ? contour::config::loadConfig()
-                                   : contour::config::loadConfigFromFile(configPath.toStdString());
+    {
+        auto const _ = crispy::trace_scope("ContourGuiApp.loadConfig");
+        _config = configPath.isEmpty() ? contour::config::loadConfig()
+                                       : contour::config::loadConfigFromFile(configPath.toStdString());
+    }
 
     _config.live = _config.live || parameters().boolean("contour.terminal.live-config");
 
@@ -245,25 +379,11 @@ bool ContourGuiApp::loadConfig(string const& target)
     if (configFailures)
         return EXIT_FAILURE;
 
-    // Possibly override shell to be executed
-    auto exe = flags.get<string>("contour.terminal.execute");
-    if (!flags.verbatim.empty() || !exe.empty())
-    {
-        auto& shell = profile->shell;
-        shell.arguments.clear();
-        if (!exe.empty())
-        {
-            shell.program = std::move(exe);
-            for (auto i: flags.verbatim)
-                shell.arguments.emplace_back(i);
-        }
-        else
-        {
-            shell.program = flags.verbatim.front();
-            for (size_t i = 1; i < flags.verbatim.size(); ++i)
-                shell.arguments.emplace_back(flags.verbatim.at(i));
-        }
-    }
+    // Possibly override shell to be executed, unless the verbatim arguments name the recording to play back.
+    if (!_playback)
+        overrideShellCommand(profile->shell,
+                             flags.get<string>("contour.terminal.execute"),
+                             vector<string>(flags.verbatim.begin(), flags.verbatim.end()));
 
     if (auto const wmClass = flags.get<string>("contour.terminal.class"); !wmClass.empty())
         _config.profile(profileName())->wmClass = wmClass;
@@ -290,9 +410,48 @@ int ContourGuiApp::fontConfigAction()
     return EXIT_SUCCESS;
 }
 
+int ContourGuiApp::playAction()
+{
+    auto const& flags = parameters();
+
+    auto const speedName = flags.get<string>("contour.play.speed");
+    auto const speed = parsePlaybackSpeed(speedName);
+    if (!speed)
+    {
+        cerr << fmt::format("Invalid speed '{}'. Use max or realtime.\n", speedName);
+        return EXIT_FAILURE;
+    }
+
+    if (flags.verbatim.size() != 1)
+    {
+        cerr << "Expected exactly one recording to play back.\n";
+        return EXIT_FAILURE;
+    }
+
+    auto const path = fs::path(string(flags.verbatim.front()));
+    auto recording = Playback::load(path);
+    if (!recording)
+    {
+        cerr << fmt::format("Could not read recording: {}\n", path.string());
+        return EXIT_FAILURE;
+    }
+
+    _playback = make_unique<Playback>(std::move(*recording), *speed);
+    auto const rv = terminalGuiAction();
+    cout << _playback->summary();
+    return rv;
+}
+
 int ContourGuiApp::terminalGuiAction()
 {
-    if (!loadConfig("terminal"))
+    // Playing back runs on its own, in one window of its own.
+    auto const serverMode = !_playback && parameters().boolean("contour.terminal.server");
+
+    // Hand the window over to a running server, skipping all of the startup below.
+    if (!serverMode && !_playback && requestWindowFromServer())
+        return EXIT_SUCCESS;
+
+    if (!loadConfig(_playback ? "play" : "terminal"))
         return EXIT_FAILURE;
 
     switch (_config.renderingBackend)
@@ -303,6 +462,12 @@ int ContourGuiApp::terminalGuiAction()
         case config::RenderingBackend::Software:
             QGuiApplication::setAttribute(Qt::AA_UseSoftwareOpenGL, true);
             break;
+        case config::RenderingBackend::Native:
+#if !defined(CONTOUR_RHI_RENDERER)
+            errorLog()("The native rendering backend is not supported by this build, using OpenGL instead.");
+            _config.renderingBackend = config::RenderingBackend::OpenGL;
+#endif
+            break;
         case config::RenderingBackend::Default:
             // Don't do anything.
             break;
@@ -315,6 +480,12 @@ int ContourGuiApp::terminalGuiAction()
         return EXIT_FAILURE;
     }
 
+    // Creating the font locator starts enumerating the installed fonts in the background,
+    // in parallel with starting the terminal session and its shell.
+    // The fonts located with the previous start are mostly taken from the cache, though.
+    text::font_locator_provider::get().set_cache_directory(localStateDir() / "fonts");
+    (void) vtrasterizer::createFontLocator(profile->fonts.fontLocator);
+
     vector<string> qtArgsStore;
     vector<char const*> qtArgsPtr;
     qtArgsPtr.push_back(_argv[0]);
@@ -347,6 +518,16 @@ int ContourGuiApp::terminalGuiAction()
 
     auto qtArgsCount = static_cast<int>(qtArgsPtr.size());
 
+    auto qtSetupTrace = std::optional<crispy::trace_scope> { std::in_place, "ContourGuiApp.setupQt" };
+
+    // Renders on the scene graph's own thread, unless a render loop has been picked explicitly.
+    if (_config.renderThread && qEnvironmentVariableIsEmpty("QSG_RENDER_LOOP"))
+        qputenv("QSG_RENDER_LOOP", "threaded");
+
+    // Lets the windows opened by the server share their GL resources, e.g. shader programs.
+    if (serverMode)
+        QGuiApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+
     // NB: We use QApplication over QGuiApplication because we want to use SystemTrayIcon.
     QApplication app(qtArgsCount, (char**) qtArgsPtr.data());
 
@@ -372,10 +553,10 @@ int ContourGuiApp::terminalGuiAction()
 #endif
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-    // Enforce OpenGL over any other. As much as I'd love to provide other backends, too.
-    // We currently only support OpenGL.
-    // If anyone feels happy about it, I'd love to at least provide Vulkan. ;-)
-    QQuickWindow::setGraphicsApi(QSGRendererInterface::OpenGL);
+    // Enforce OpenGL over any other, unless the native backend was asked for, in which case Qt picks
+    // the platform's preferred graphics API (or the one set via QSG_RHI_BACKEND), rendered to via QRhi.
+    if (_config.renderingBackend != config::RenderingBackend::Native)
+        QQuickWindow::setGraphicsApi(QSGRendererInterface::OpenGL);
 #endif
 
     QGuiApplication::setWindowIcon(QIcon(":/contour/logo-256.png"));
@@ -384,6 +565,18 @@ int ContourGuiApp::terminalGuiAction()
 
     ensureTermInfoFile();
 
+    _memoryPressure = make_unique<MemoryPressureMonitor>();
+    connect(_memoryPressure.get(), &MemoryPressureMonitor::memoryLow, this, [this]() {
+        _sessionManager.trimMemory();
+    });
+
+    if (!_config.metricsEndpoint.empty())
+    {
+        _metricsServer = make_unique<MetricsServer>(_sessionManager);
+        if (!_metricsServer->listen(_config.metricsEndpoint))
+            _metricsServer.reset();
+    }
+
     // clang-format off
     qmlRegisterType<display::TerminalDisplay>("Contour.Terminal", 1, 0, "ContourTerminal");
     qmlRegisterUncreatableType<TerminalSession>("Contour.Terminal", 1, 0, "TerminalSession", "Use factory.");
@@ -400,24 +593,28 @@ int ContourGuiApp::terminalGuiAction()
     // auto const TBC = "\033[g";
     // printf("\r%s        %s                        %s\r", TBC, HTS, HTS);
 
-    // Spawn initial window.
-    newWindow();
+    qtSetupTrace.reset();
 
-    if (auto const& bell = config().profile().bell.sound; bell == "off")
+    if (serverMode)
     {
-        if (auto* bellAudioOutput = _qmlEngine->rootObjects().first()->findChild<QObject*>("BellAudioOutput");
-            bellAudioOutput)
-            bellAudioOutput->setProperty("muted", true);
+        // The server keeps running without any window, until explicitly quit.
+        QGuiApplication::setQuitOnLastWindowClosed(false);
+        if (!startServer())
+            return EXIT_FAILURE;
     }
-    else if (bell != "default")
+    else
     {
-        QUrl const path(bell.c_str());
-        if (auto* bellObject = _qmlEngine->rootObjects().first()->findChild<QObject*>("Bell"); bellObject)
-            bellObject->setProperty("source", path);
+        // Spawn initial window.
+        auto const _ = crispy::trace_scope("ContourGuiApp.newWindow");
+        newWindow();
     }
 
     auto rv = QApplication::exec();
 
+    _server.reset();
+    _metricsServer.reset();
+    _memoryPressure.reset();
+
     if (_exitStatus.has_value())
     {
 #if defined(VTPTY_LIBSSH2)
@@ -499,7 +696,243 @@ void ContourGuiApp::ensureTermInfoFile()
 void ContourGuiApp::newWindow()
 {
     _qmlEngine->load(resolveResource("ui/main.qml"));
+
+    if (_qmlEngine->rootObjects().isEmpty())
+        return;
+
+    // The bell's media player is only created with the first bell, from the terminal's properties.
+    auto* window = _qmlEngine->rootObjects().last();
+    auto* terminal = window->findChild<QObject*>("Terminal");
+    if (!terminal)
+        return;
+
+    if (auto const& bell = profile().bell.sound; bell == "off")
+        terminal->setProperty("bellMuted", true);
+    else if (bell != "default")
+        terminal->setProperty("bellSoundSource", QUrl(bell.c_str()));
+}
+
+// {{{ server mode
+// A request consists of the protocol version and the ServerRequest.
+//
+// A window request continues with the profile name, working directory, program to execute (along with
+// the verbatim arguments), and the environment of the client. The server answers with a single byte,
+// which is non-zero if it opened the window.
+//
+// A resource usage request consists of nothing more. The server answers with the table of the
+// resources each of its sessions uses, as a string.
+
+bool ContourGuiApp::requestWindowFromServer() const
+{
+    auto socket = QLocalSocket {};
+    socket.connectToServer(serverSocketName());
+    if (!socket.waitForConnected(ServerReplyTimeout))
+        return false;
+
+    auto const& flags = parameters();
+    auto workingDirectory = flags.get<string>("contour.terminal.working-directory");
+    if (workingDirectory.empty())
+        workingDirectory = fs::current_path().string();
+
+    auto verbatim = QStringList {};
+    for (auto const arg: flags.verbatim)
+        verbatim.append(QString::fromUtf8(arg.data(), static_cast<int>(arg.size())));
+
+    auto request = QByteArray {};
+    {
+        auto out = QDataStream { &request, QIODevice::WriteOnly };
+        out << ServerProtocolVersion << static_cast<qint32>(ServerRequest::OpenWindow)
+            << QString::fromStdString(flags.get<string>("contour.terminal.profile"))
+            << QString::fromStdString(workingDirectory)
+            << QString::fromStdString(flags.get<string>("contour.terminal.execute")) << verbatim
+            << QProcessEnvironment::systemEnvironment().toStringList();
+    }
+
+    socket.write(request);
+    if (!socket.waitForBytesWritten(ServerReplyTimeout) || !socket.waitForReadyRead(ServerReplyTimeout))
+        return false;
+
+    auto const reply = socket.read(1);
+    return !reply.isEmpty() && reply.front() != 0;
+}
+
+std::optional<string> ContourGuiApp::requestResourceUsageFromServer() const
+{
+    auto socket = QLocalSocket {};
+    socket.connectToServer(serverSocketName());
+    if (!socket.waitForConnected(ServerReplyTimeout))
+        return std::nullopt;
+
+    auto request = QByteArray {};
+    {
+        auto out = QDataStream { &request, QIODevice::WriteOnly };
+        out << ServerProtocolVersion << static_cast<qint32>(ServerRequest::SessionResourceUsage);
+    }
+    socket.write(request);
+    if (!socket.waitForBytesWritten(ServerReplyTimeout))
+        return std::nullopt;
+
+    auto in = QDataStream { &socket };
+    auto report = QString {};
+    do
+    {
+        if (!socket.waitForReadyRead(ServerReplyTimeout))
+            return std::nullopt;
+        in.startTransaction();
+        in >> report;
+    } while (!in.commitTransaction());
+
+    return report.toStdString();
+}
+
+int ContourGuiApp::infoSessionsAction()
+{
+    auto const report = requestResourceUsageFromServer();
+    if (!report)
+    {
+        cerr << "No contour server is running. Only the sessions of a server (started by "
+                "`contour server`) can be inspected.\n";
+        return EXIT_FAILURE;
+    }
+
+    fmt::print("{}", *report);
+    return EXIT_SUCCESS;
+}
+
+bool ContourGuiApp::startServer()
+{
+    auto const name = serverSocketName();
+
+    // Only a socket no one listens on anymore, left over from a server that did not exit cleanly,
+    // may be removed.
+    {
+        auto probe = QLocalSocket {};
+        probe.connectToServer(name);
+        if (probe.waitForConnected(ServerReplyTimeout))
+        {
+            errorLog()("Another contour server is already listening on {}.", name.toStdString());
+            return false;
+        }
+    }
+    QLocalServer::removeServer(name);
+
+    _server = make_unique<QLocalServer>();
+    _server->setSocketOptions(QLocalServer::UserAccessOption);
+    if (!_server->listen(name))
+    {
+        errorLog()("Could not listen on {}. {}", name.toStdString(), _server->errorString().toStdString());
+        return false;
+    }
+
+    connect(_server.get(), &QLocalServer::newConnection, this, [this]() {
+        while (auto* socket = _server->nextPendingConnection())
+        {
+            connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+            connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { serveClient(*socket); });
+        }
+    });
+
+    displayLog()("Serving window requests on {}.", name.toStdString());
+    return true;
+}
+
+void ContourGuiApp::serveClient(QLocalSocket& socket)
+{
+    auto in = QDataStream { &socket };
+    in.startTransaction();
+
+    auto version = qint32 {};
+    auto request = qint32 {};
+    auto profileName = QString {};
+    auto workingDirectory = QString {};
+    auto execute = QString {};
+    auto verbatim = QStringList {};
+    auto environment = QStringList {};
+    auto const isRequest = [&](ServerRequest kind) {
+        return version == ServerProtocolVersion && request == static_cast<qint32>(kind);
+    };
+    in >> version;
+    if (version == ServerProtocolVersion)
+        in >> request;
+    if (isRequest(ServerRequest::OpenWindow))
+        in >> profileName >> workingDirectory >> execute >> verbatim >> environment;
+
+    if (!in.commitTransaction())
+        return; // Wait for the remainder of the request.
+
+    if (isRequest(ServerRequest::SessionResourceUsage))
+    {
+        auto reply = QByteArray {};
+        {
+            auto out = QDataStream { &reply, QIODevice::WriteOnly };
+            out << QString::fromStdString(_sessionManager.resourceUsageReport());
+        }
+        socket.write(reply);
+        socket.flush();
+        socket.disconnectFromServer();
+        return;
+    }
+
+    auto const opened = isRequest(ServerRequest::OpenWindow)
+                        && openRequestedWindow(profileName.toStdString(),
+                                               workingDirectory.toStdString(),
+                                               execute.toStdString(),
+                                               verbatim,
+                                               environment);
+
+    socket.write(opened ? "\1" : "\0", 1);
+    socket.flush();
+    socket.disconnectFromServer();
+}
+
+bool ContourGuiApp::openRequestedWindow(string profileName,
+                                        string workingDirectory,
+                                        string execute,
+                                        QStringList const& verbatim,
+                                        QStringList const& environment)
+{
+    // The profile and its shell are only overridden for as long as the window's session is created.
+    _requestedProfileName = std::move(profileName);
+    auto* profile = _config.profile(this->profileName());
+    if (!profile)
+    {
+        errorLog()("Cannot open requested window. No such profile: '{}'.", this->profileName());
+        _requestedProfileName.clear();
+        return false;
+    }
+
+    auto const configuredShell = profile->shell;
+    auto& shell = profile->shell;
+
+    if (!workingDirectory.empty())
+        shell.workingDirectory = fs::path(workingDirectory);
+
+    auto args = vector<string> {};
+    for (auto const& arg: verbatim)
+        args.emplace_back(arg.toStdString());
+    overrideShellCommand(shell, std::move(execute), args);
+
+    // The configured environment takes precedence over the one of the client.
+    shell.env.clear();
+    for (auto const& entry: environment)
+    {
+        auto const separator = entry.indexOf('=');
+        if (separator > 0)
+            shell.env[entry.left(separator).toStdString()] = entry.mid(separator + 1).toStdString();
+    }
+    for (auto const& [name, value]: configuredShell.env)
+        shell.env[name] = value;
+
+    {
+        auto const _ = crispy::trace_scope("ContourGuiApp.newWindow");
+        newWindow();
+    }
+
+    profile->shell = configuredShell;
+    _requestedProfileName.clear();
+    return true;
 }
+// }}}
 
 void ContourGuiApp::showNotification(std::string_view title, std::string_view content)
 {
@@ -3,18 +3,27 @@
 
 #include <contour/Config.h>
 #include <contour/ContourApp.h>
+#include <contour/MemoryPressure.h>
+#include <contour/MetricsServer.h>
+#include <contour/Playback.h>
 #include <contour/TerminalSessionManager.h>
 #include <contour/helper.h>
 
 #include <vtpty/Process.h>
 #include <vtpty/SshSession.h>
 
+#include <crispy/thread_pool.h>
+
+#include <QtCore/QStringList>
 #include <QtDBus/QDBusVariant>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
 #include <QtQml/QQmlApplicationEngine>
 
 #include <filesystem>
 #include <memory>
 #include <optional>
+#include <string>
 
 namespace contour
 {
@@ -50,8 +59,14 @@ class ContourGuiApp: public QObject, public ContourApp
 
     std::optional<std::filesystem::path> dumpStateAtExit() const;
 
+    /// @returns the file to record the PTY output of the first session into, once only.
+    std::optional<std::filesystem::path> takeRecordingPath();
+
     void onExit(TerminalSession& session);
 
+    /// @returns the recording played back by `contour play`, or nullptr if not playing back.
+    [[nodiscard]] Playback* playback() noexcept { return _playback.get(); }
+
     config::Config& config() noexcept { return _config; }
     config::Config const& config() const noexcept { return _config; }
     config::TerminalProfile const& profile() const noexcept
@@ -66,6 +81,9 @@ class ContourGuiApp: public QObject, public ContourApp
 
     TerminalSessionManager& sessionsManager() noexcept { return _sessionManager; }
 
+    /// Thread pool for background work, shared by all sessions and their displays.
+    crispy::thread_pool& threadPool() noexcept { return _threadPool; }
+
     std::chrono::seconds earlyExitThreshold() const;
 
     std::string programPath() const { return _argv[0]; }
@@ -80,8 +98,24 @@ class ContourGuiApp: public QObject, public ContourApp
     bool loadConfig(std::string const& target);
     int terminalGuiAction();
     int fontConfigAction();
+    int playAction();
+    int infoSessionsAction();
+
+    // Asks a running server to open the window instead, returning whether it did.
+    [[nodiscard]] bool requestWindowFromServer() const;
+    // Asks a running server for the resources used by its sessions, see TerminalSessionManager.
+    [[nodiscard]] std::optional<std::string> requestResourceUsageFromServer() const;
+    bool startServer();
+    void serveClient(QLocalSocket& socket);
+    bool openRequestedWindow(std::string profileName,
+                             std::string workingDirectory,
+                             std::string execute,
+                             QStringList const& verbatim,
+                             QStringList const& environment);
 
     config::Config _config;
+    crispy::thread_pool _threadPool;     // outlives the sessions using it
+    std::unique_ptr<Playback> _playback; // outlives the session reading it, if playing back
     TerminalSessionManager _sessionManager;
 
     int _argc = 0;
@@ -91,6 +125,12 @@ class ContourGuiApp: public QObject, public ContourApp
     vtbackend::ColorPreference _colorPreference = vtbackend::ColorPreference::Dark;
 
     std::unique_ptr<QQmlApplicationEngine> _qmlEngine;
+
+    std::unique_ptr<MemoryPressureMonitor> _memoryPressure; // trims all sessions when running low on memory
+    std::unique_ptr<QLocalServer> _server; // listening for window requests, in server mode only
+    std::unique_ptr<MetricsServer> _metricsServer; // serving the metrics of all sessions, if configured
+    std::string _requestedProfileName; // profile of the window being opened on behalf of a client
+    bool _recordingPathTaken = false;  // by the first session, such that later windows are not recorded
 };
 
 } // namespace contour
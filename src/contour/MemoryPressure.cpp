@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <contour/MemoryPressure.h>
+
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#if defined(__linux__)
+    #include <QtCore/QSocketNotifier>
+
+    #include <cerrno>
+    #include <cstring>
+
+    #include <fcntl.h>
+    #include <unistd.h>
+#elif defined(_WIN32)
+    #include <QtCore/QTimer>
+    #include <QtCore/QWinEventNotifier>
+
+    #include <Windows.h>
+#endif
+
+using namespace std::string_view_literals;
+
+namespace contour
+{
+
+namespace
+{
+#if defined(__linux__)
+    // Some task stalling on memory for 150ms within 2 seconds, the shortest window unprivileged
+    // processes may create triggers for.
+    constexpr auto PressureTrigger = "some 150000 2000000"sv;
+
+    // Returns the PSI file of the cgroup (v2) this process runs in, or an empty string if unknown.
+    std::string cgroupPressureFile()
+    {
+        auto cgroups = std::ifstream("/proc/self/cgroup");
+        for (auto line = std::string {}; std::getline(cgroups, line);)
+            if (line.starts_with("0::"))
+                return "/sys/fs/cgroup" + line.substr(3) + "/memory.pressure";
+        return {};
+    }
+
+    int openPressureTrigger(std::string const& path)
+    {
+        auto const fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+            return -1;
+
+        if (::write(fd, PressureTrigger.data(), PressureTrigger.size() + 1) < 0)
+        {
+            memoryLog()("Failed to set memory pressure trigger on {}. {}", path, strerror(errno));
+            ::close(fd);
+            return -1;
+        }
+
+        memoryLog()("Monitoring memory pressure of {}.", path);
+        return fd;
+    }
+#endif
+} // namespace
+
+MemoryPressureMonitor::MemoryPressureMonitor(QObject* parent): QObject(parent)
+{
+#if defined(__linux__)
+    for (auto const& path: { cgroupPressureFile(), std::string("/proc/pressure/memory") })
+        if (!path.empty() && (_pressureFd = openPressureTrigger(path)) >= 0)
+            break;
+    if (_pressureFd < 0)
+        return;
+
+    _pressureNotifier = std::make_unique<QSocketNotifier>(_pressureFd, QSocketNotifier::Exception);
+    connect(_pressureNotifier.get(), &QSocketNotifier::activated, this, &MemoryPressureMonitor::notify);
+#elif defined(__APPLE__)
+    _pressureSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE,
+                                             0,
+                                             DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL,
+                                             dispatch_get_main_queue());
+    if (!_pressureSource)
+        return;
+
+    dispatch_set_context(_pressureSource, this);
+    dispatch_source_set_event_handler_f(_pressureSource, [](void* context) {
+        static_cast<MemoryPressureMonitor*>(context)->notify();
+    });
+    dispatch_resume(_pressureSource);
+#elif defined(_WIN32)
+    _lowMemoryHandle = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+    if (!_lowMemoryHandle)
+        return;
+
+    _lowMemoryNotifier = std::make_unique<QWinEventNotifier>(_lowMemoryHandle);
+    connect(_lowMemoryNotifier.get(), &QWinEventNotifier::activated, this, [this]() {
+        // The handle remains signaled for as long as the system is low on memory.
+        _lowMemoryNotifier->setEnabled(false);
+        notify();
+        QTimer::singleShot(MinimumInterval, this, [this]() { _lowMemoryNotifier->setEnabled(true); });
+    });
+#endif
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor()
+{
+#if defined(__linux__)
+    _pressureNotifier.reset();
+    if (_pressureFd >= 0)
+        ::close(_pressureFd);
+#elif defined(__APPLE__)
+    if (_pressureSource)
+    {
+        dispatch_source_cancel(_pressureSource);
+        dispatch_release(_pressureSource);
+    }
+#elif defined(_WIN32)
+    _lowMemoryNotifier.reset();
+    if (_lowMemoryHandle)
+        CloseHandle(_lowMemoryHandle);
+#endif
+}
+
+bool MemoryPressureMonitor::active() const noexcept
+{
+#if defined(__linux__)
+    return _pressureFd >= 0;
+#elif defined(__APPLE__)
+    return _pressureSource != nullptr;
+#elif defined(_WIN32)
+    return _lowMemoryHandle != nullptr;
+#else
+    return false;
+#endif
+}
+
+void MemoryPressureMonitor::notify()
+{
+    auto const now = std::chrono::steady_clock::now();
+    if (now - _lastNotification < MinimumInterval)
+        return;
+
+    _lastNotification = now;
+    memoryLog()("Running low on memory.");
+    emit memoryLow();
+}
+
+} // namespace contour
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <crispy/logstore.h>
+
+#include <QtCore/QObject>
+
+#include <chrono>
+#include <memory>
+
+#if defined(__APPLE__)
+    #include <dispatch/dispatch.h>
+#endif
+
+class QSocketNotifier;
+class QWinEventNotifier;
+
+namespace contour
+{
+
+auto const inline memoryLog =
+    logstore::category("gui.memory", "Logs memory pressure events and the memory reclaimed on them.");
+
+/**
+ * Notifies about the system running low on memory.
+ *
+ * On Linux, this is a PSI memory stall trigger, on the cgroup Contour runs in if possible,
+ * such that memory limits of containers and systemd scopes are taken into account, too.
+ * On macOS, it is a memory pressure dispatch source, and on Windows a low memory resource notification.
+ * Where none of these is available, memoryLow() is simply never emitted.
+ */
+class MemoryPressureMonitor: public QObject
+{
+    Q_OBJECT
+
+  public:
+    /// Notifications arriving more often are dropped, as trimming again right away would reclaim little.
+    static constexpr auto MinimumInterval = std::chrono::seconds(10);
+
+    explicit MemoryPressureMonitor(QObject* parent = nullptr);
+    ~MemoryPressureMonitor() override;
+
+    /// Tests whether memory pressure is being monitored on this system.
+    [[nodiscard]] bool active() const noexcept;
+
+  signals:
+    /// Emitted on the GUI thread when running low on memory.
+    void memoryLow();
+
+  private:
+    void notify();
+
+    std::chrono::steady_clock::time_point _lastNotification {};
+
+#if defined(__linux__)
+    int _pressureFd = -1; // PSI trigger, signaling POLLPRI on memory stalls
+    std::unique_ptr<QSocketNotifier> _pressureNotifier;
+#elif defined(__APPLE__)
+    dispatch_source_t _pressureSource = nullptr;
+#elif defined(_WIN32)
+    void* _lowMemoryHandle = nullptr; // signaled for as long as the system is low on memory
+    std::unique_ptr<QWinEventNotifier> _lowMemoryNotifier;
+#endif
+};
+
+} // namespace contour
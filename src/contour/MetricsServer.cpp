@@ -0,0 +1,345 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <contour/MetricsServer.h>
+#include <contour/TerminalSession.h>
+#include <contour/TerminalSessionManager.h>
+#include <contour/display/TerminalDisplay.h>
+
+#include <vtrasterizer/GpuMemoryBudget.h>
+
+#include <crispy/allocation_counter.h>
+#include <crispy/openmetrics.h>
+
+#include <QtNetwork/QHostAddress>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+using std::string;
+using std::string_view;
+
+namespace contour
+{
+
+namespace
+{
+    // Requests larger than this are not scrapes, and are closed rather than buffered any further.
+    constexpr auto MaxRequestSize = 8 * 1024;
+
+    constexpr auto LocalSocketPrefix = string_view("unix:");
+
+    double secondsOf(std::chrono::nanoseconds value)
+    {
+        return std::chrono::duration<double>(value).count();
+    }
+
+    void collectSession(crispy::openmetrics_writer& out, TerminalSession& session)
+    {
+        using Labels = crispy::openmetrics_writer::label_set;
+        auto const labels = Labels { { "session", std::to_string(session.id()) } };
+        auto const labeled = [&](string_view name, string value) {
+            auto result = labels;
+            result.emplace_back(name, std::move(value));
+            return result;
+        };
+        auto& terminal = session.terminal();
+
+        // {{{ PTY and CPU time
+        auto const usage = session.resourceUsage();
+        out.counter("contour_pty_read_bytes",
+                    "Bytes of PTY output parsed.",
+                    labels,
+                    static_cast<double>(terminal.parsedBytes()));
+        out.gauge("contour_pty_read_bytes_per_second",
+                  "Rate of PTY output parsed, over the last sample interval.",
+                  labels,
+                  static_cast<double>(usage.ptyBytesPerSecond));
+        out.counter("contour_parse_cpu_seconds",
+                    "CPU time spent parsing PTY output.",
+                    labels,
+                    secondsOf(usage.parseCpuTime));
+        out.counter("contour_render_cpu_seconds",
+                    "CPU time spent rendering frames.",
+                    labels,
+                    secondsOf(usage.renderCpuTime));
+        out.gauge("contour_flooded",
+                  "Whether the screen is flooded with output, building only few frames.",
+                  labels,
+                  terminal.flooded() ? 1.0 : 0.0);
+        // }}}
+
+        // {{{ input
+        auto const input = terminal.inputWriteStats();
+        out.counter("contour_input_events",
+                    "Key, mouse, and focus events having generated input.",
+                    labels,
+                    static_cast<double>(input.events));
+        out.counter("contour_input_writes",
+                    "Writes of input to the PTY.",
+                    labels,
+                    static_cast<double>(input.writes));
+        if (auto const latency = terminal.inputLatency())
+        {
+            auto const quantiles =
+                std::array { std::pair { 0.5, secondsOf(latency->keyToPresentP50) },
+                             std::pair { 0.99, secondsOf(latency->keyToPresentP99) } };
+            out.summary("contour_input_latency_seconds",
+                        "Time from a key press to the frame showing its echo presented, of recent keys.",
+                        labels,
+                        quantiles,
+                        latency->count);
+        }
+        // }}}
+
+        // {{{ memory and pools
+        auto const [images, ptyBuffers] = [&]() {
+            auto const _ = std::scoped_lock { terminal };
+            return std::pair { terminal.imagePoolStats(), terminal.ptyBufferStats() };
+        }();
+        out.gauge("contour_history_bytes",
+                  "Memory held by the lines of both screens, scrollback included.",
+                  labels,
+                  static_cast<double>(usage.historyBytes));
+        out.gauge("contour_image_bytes",
+                  "Decoded pixel data of the images alive.",
+                  labels,
+                  static_cast<double>(images.bytes));
+        out.gauge("contour_images", "Images alive.", labels, static_cast<double>(images.images));
+        out.counter("contour_image_duplicates",
+                    "Images created with the pixels of an image alive, sharing them instead.",
+                    labels,
+                    static_cast<double>(images.duplicates));
+        out.counter("contour_image_evictions",
+                    "Images evicted for exceeding the memory budget.",
+                    labels,
+                    static_cast<double>(images.evictions));
+        out.gauge("contour_pty_buffers",
+                  "Buffer objects the PTY output is read into.",
+                  labeled("state", "live"),
+                  static_cast<double>(ptyBuffers.liveBuffers));
+        out.gauge("contour_pty_buffers",
+                  "Buffer objects the PTY output is read into.",
+                  labeled("state", "unused"),
+                  static_cast<double>(ptyBuffers.unusedBuffers));
+        out.gauge("contour_pty_buffer_bytes",
+                  "Capacity of the buffer objects the PTY output is read into.",
+                  labeled("state", "live"),
+                  static_cast<double>(ptyBuffers.pinnedBytes));
+        out.gauge("contour_pty_buffer_bytes",
+                  "Capacity of the buffer objects the PTY output is read into.",
+                  labeled("state", "unused"),
+                  static_cast<double>(ptyBuffers.unusedBytes));
+        out.counter("contour_pty_buffer_allocations",
+                    "Buffer objects handed out to read PTY output into.",
+                    labels,
+                    static_cast<double>(ptyBuffers.allocations));
+        out.counter("contour_pty_buffer_reuses",
+                    "Buffer objects handed out by recycling a released one.",
+                    labels,
+                    static_cast<double>(ptyBuffers.reuses));
+
+        if constexpr (crispy::allocations_counted)
+        {
+            auto const allocations = terminal.allocationStats();
+            for (auto const& [scope, stats]: { std::pair { "input", allocations.input.total },
+                                               std::pair { "frames", allocations.frames.total } })
+            {
+                out.counter("contour_allocations",
+                            "Heap allocations made while processing input or building frames.",
+                            labeled("scope", scope),
+                            static_cast<double>(stats.count));
+                out.counter("contour_allocated_bytes",
+                            "Bytes of the heap allocations made while processing input or building frames.",
+                            labeled("scope", scope),
+                            static_cast<double>(stats.bytes));
+            }
+        }
+        // }}}
+
+        // {{{ rendering
+        auto const* display = session.display();
+        if (!display)
+            return;
+
+        out.histogram("contour_frame_render_seconds",
+                      "Time it takes to render a frame.",
+                      labels,
+                      display->renderTimeHistogram());
+
+        auto const caches = display->renderCacheStats();
+        out.counter("contour_shaping_cache_lookups",
+                    "Text runs looking up their shaping result.",
+                    labels,
+                    static_cast<double>(caches.shapingLookups));
+        out.counter("contour_shaping_cache_misses",
+                    "Text runs shaped, as not cached.",
+                    labels,
+                    static_cast<double>(caches.shapingMisses));
+        out.counter("contour_atlas_tile_hits",
+                    "Glyph tiles found in the texture atlas.",
+                    labels,
+                    static_cast<double>(caches.atlasHits));
+        out.counter("contour_atlas_tile_misses",
+                    "Glyph tiles rasterized, as not found in the texture atlas.",
+                    labels,
+                    static_cast<double>(caches.atlasMisses));
+        out.counter("contour_line_tile_cache_hits",
+                    "Unchanged lines replayed from the tiles recorded for them.",
+                    labels,
+                    static_cast<double>(caches.lineTileHits));
+        out.counter("contour_line_tile_cache_misses",
+                    "Lines rendered from scratch.",
+                    labels,
+                    static_cast<double>(caches.lineTileMisses));
+        // }}}
+    }
+} // namespace
+
+MetricsServer::MetricsServer(TerminalSessionManager& sessions, QObject* parent):
+    QObject(parent), _sessions { sessions }
+{
+}
+
+MetricsServer::~MetricsServer() = default;
+
+bool MetricsServer::listen(string_view endpoint)
+{
+    if (endpoint.starts_with(LocalSocketPrefix))
+    {
+        auto const name = QString::fromUtf8(endpoint.substr(LocalSocketPrefix.size()).data(),
+                                            static_cast<int>(endpoint.size() - LocalSocketPrefix.size()));
+        QLocalServer::removeServer(name);
+        _localServer = std::make_unique<QLocalServer>();
+        _localServer->setSocketOptions(QLocalServer::UserAccessOption);
+        if (!_localServer->listen(name))
+        {
+            errorLog()("Could not serve metrics on {}. {}",
+                       name.toStdString(),
+                       _localServer->errorString().toStdString());
+            _localServer.reset();
+            return false;
+        }
+        connect(_localServer.get(), &QLocalServer::newConnection, this, [this]() {
+            while (auto* socket = _localServer->nextPendingConnection())
+                accept(socket);
+        });
+        metricsLog()("Serving metrics on {}.", name.toStdString());
+        return true;
+    }
+
+    auto address = QHostAddress(QHostAddress::LocalHost);
+    auto portText = endpoint;
+    if (auto const colon = endpoint.rfind(':'); colon != string_view::npos)
+    {
+        auto const host = QString::fromUtf8(endpoint.data(), static_cast<int>(colon));
+        address = host == QStringLiteral("localhost") ? QHostAddress(QHostAddress::LocalHost)
+                                                      : QHostAddress(host);
+        portText = endpoint.substr(colon + 1);
+    }
+    auto portValid = false;
+    auto const port =
+        QString::fromUtf8(portText.data(), static_cast<int>(portText.size())).toUShort(&portValid);
+    if (!portValid || !address.isLoopback())
+    {
+        errorLog()("Invalid metrics endpoint: {}. Expected [HOST:]PORT, with HOST being a loopback address, "
+                   "or unix:PATH.",
+                   endpoint);
+        return false;
+    }
+
+    _tcpServer = std::make_unique<QTcpServer>();
+    if (!_tcpServer->listen(address, port))
+    {
+        errorLog()("Could not serve metrics on {}. {}", endpoint, _tcpServer->errorString().toStdString());
+        _tcpServer.reset();
+        return false;
+    }
+    connect(_tcpServer.get(), &QTcpServer::newConnection, this, [this]() {
+        while (auto* socket = _tcpServer->nextPendingConnection())
+            accept(socket);
+    });
+    metricsLog()("Serving metrics on http://{}:{}/metrics.", address.toString().toStdString(), port);
+    return true;
+}
+
+template <typename Socket>
+void MetricsServer::accept(Socket* socket)
+{
+    auto request = std::make_shared<QByteArray>();
+    connect(socket, &Socket::disconnected, socket, &QObject::deleteLater);
+    connect(socket, &Socket::readyRead, this, [this, socket, request]() {
+        *request += socket->readAll();
+        if (!respond(*socket, *request) && request->size() <= MaxRequestSize)
+            return; // Wait for the remainder of the request.
+
+        socket->flush();
+        if constexpr (std::is_same_v<Socket, QLocalSocket>)
+            socket->disconnectFromServer();
+        else
+            socket->disconnectFromHost();
+    });
+}
+
+bool MetricsServer::respond(QIODevice& connection, QByteArray const& request) const
+{
+    auto const headerEnd = request.indexOf("\r\n\r\n");
+    if (headerEnd < 0)
+        return false;
+
+    auto const requestLine = request.left(request.indexOf("\r\n")).split(' ');
+    auto const method = requestLine.value(0);
+    auto const path = requestLine.value(1);
+
+    auto status = QByteArray("200 OK");
+    auto contentType = QByteArray("application/openmetrics-text; version=1.0.0; charset=utf-8");
+    auto body = QByteArray {};
+    if (method != "GET" && method != "HEAD")
+        status = "405 Method Not Allowed";
+    else if (path != "/metrics" && !path.startsWith("/metrics?"))
+        status = "404 Not Found";
+    else
+        body = QByteArray::fromStdString(collect());
+
+    if (!status.startsWith("200"))
+    {
+        contentType = "text/plain; charset=utf-8";
+        body = status + '\n';
+    }
+    metricsLog()("{} {}: {}", method.toStdString(), path.toStdString(), status.toStdString());
+
+    auto response = "HTTP/1.1 " + status + "\r\nContent-Type: " + contentType + "\r\nContent-Length: "
+                    + QByteArray::number(body.size()) + "\r\nConnection: close\r\n\r\n";
+    if (method != "HEAD")
+        response += body;
+    connection.write(response);
+    return true;
+}
+
+string MetricsServer::collect() const
+{
+    auto out = crispy::openmetrics_writer {};
+    out.gauge("contour_sessions", "Terminal sessions.", {}, static_cast<double>(_sessions.count()));
+
+    auto const gpuMemory = _sessions.gpuMemoryBudget().usage();
+    for (auto const& [use, name]: { std::pair { vtrasterizer::GpuMemoryUse::Atlas, "atlas" },
+                                    std::pair { vtrasterizer::GpuMemoryUse::Images, "images" },
+                                    std::pair { vtrasterizer::GpuMemoryUse::Framebuffers, "framebuffers" } })
+        out.gauge("contour_gpu_memory_bytes",
+                  "GPU memory used by the render targets of all displays.",
+                  { { "use", name } },
+                  static_cast<double>(gpuMemory[use]));
+
+    for (auto* session: _sessions.sessions())
+        collectSession(out, *session);
+
+    return out.str();
+}
+
+} // namespace contour
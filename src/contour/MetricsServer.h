@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <crispy/logstore.h>
+
+#include <QtCore/QObject>
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+class QByteArray;
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+
+namespace contour
+{
+
+class TerminalSessionManager;
+
+auto const inline metricsLog =
+    logstore::category("gui.metrics", "Logs the metrics endpoint and the scrapes it serves.");
+
+/**
+ * Serves the metrics of all sessions in the OpenMetrics text format, to be scraped by e.g. Prometheus,
+ * so that performance regressions across versions and fleets show up in existing monitoring.
+ *
+ * The endpoint answers HTTP GET requests for /metrics, either on a TCP port of the loopback interface,
+ * or on a local socket (a Unix domain socket, or a named pipe on Windows). No other interfaces are
+ * listened on, as the metrics are served without authentication.
+ *
+ * Metrics are only collected when scraped, from the counters the sessions and their displays keep anyway,
+ * so that the endpoint costs nothing in between.
+ */
+class MetricsServer: public QObject
+{
+    Q_OBJECT
+
+  public:
+    explicit MetricsServer(TerminalSessionManager& sessions, QObject* parent = nullptr);
+    ~MetricsServer() override;
+
+    /// Starts listening on @p endpoint, which is either "[HOST:]PORT" with HOST being a loopback address
+    /// (127.0.0.1 by default), or "unix:PATH" for a local socket.
+    ///
+    /// @returns whether the endpoint is being listened on.
+    bool listen(std::string_view endpoint);
+
+    /// @returns the metrics of all sessions in the OpenMetrics text format.
+    [[nodiscard]] std::string collect() const;
+
+  private:
+    template <typename Socket>
+    void accept(Socket* socket);
+
+    // Answers the HTTP request received so far, unless incomplete, returning whether it did.
+    bool respond(QIODevice& connection, QByteArray const& request) const;
+
+    TerminalSessionManager& _sessions;
+    std::unique_ptr<QTcpServer> _tcpServer;
+    std::unique_ptr<QLocalServer> _localServer;
+};
+
+} // namespace contour
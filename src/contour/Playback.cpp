@@ -0,0 +1,273 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <contour/Playback.h>
+
+#include <crispy/utils.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+    #include <Windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+namespace contour
+{
+
+namespace
+{
+    /// @returns the peak resident set size of the process in bytes, if known.
+    std::optional<uint64_t> peakResidentSetSize() noexcept
+    {
+#if defined(_WIN32)
+        auto counters = PROCESS_MEMORY_COUNTERS {};
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return std::nullopt;
+        return static_cast<uint64_t>(counters.PeakWorkingSetSize);
+#else
+        auto usage = rusage {};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return std::nullopt;
+    #if defined(__APPLE__)
+        return static_cast<uint64_t>(usage.ru_maxrss);
+    #else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+    #endif
+#endif
+    }
+
+    std::string formatDuration(Playback::clock::duration duration)
+    {
+        auto const micros = duration_cast<microseconds>(duration).count();
+        return fmt::format("{:.3f} ms", static_cast<double>(micros) / 1000.0);
+    }
+
+    Playback::clock::duration percentile(std::vector<Playback::clock::duration> const& sorted, double p)
+    {
+        if (sorted.empty())
+            return {};
+        auto const index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+        return sorted[index];
+    }
+} // namespace
+
+std::optional<PlaybackSpeed> parsePlaybackSpeed(std::string_view name)
+{
+    auto lowerName = std::string(name);
+    std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    if (lowerName == "max")
+        return PlaybackSpeed::Max;
+    if (lowerName == "realtime")
+        return PlaybackSpeed::Realtime;
+    return std::nullopt;
+}
+
+// {{{ Playback
+Playback::Playback(vtbackend::Recording recording, PlaybackSpeed speed):
+    _speed { speed }, _recording { std::move(recording) }
+{
+}
+
+std::optional<vtbackend::Recording> Playback::load(std::filesystem::path const& path)
+{
+    auto file = std::ifstream(path, std::ios::binary);
+    if (!file.good())
+        return std::nullopt;
+    auto contents = std::stringstream {};
+    contents << file.rdbuf();
+    auto const data = contents.str();
+
+    if (auto recording = vtbackend::decodeRecording(data))
+        return recording;
+
+    // Raw PTY output, e.g. captured by `script`, carries no timing, and is delivered at once.
+    return vtbackend::Recording {
+        .pageSize = {},
+        .events = { vtbackend::RecordingEvent { .output = data } },
+    };
+}
+
+std::unique_ptr<vtpty::Pty> Playback::takePty(vtbackend::PageSize pageSize)
+{
+    if (!_recording)
+        return nullptr;
+
+    // Resizes are not played back, as the page size is the window's to decide.
+    auto events = std::vector<vtbackend::RecordingEvent> {};
+    for (auto& event: _recording->events)
+        if (!event.resize && !event.output.empty())
+            events.emplace_back(std::move(event));
+    _recording.reset();
+
+    return std::make_unique<PlaybackPty>(*this, std::move(events), _speed, pageSize);
+}
+
+void Playback::outputDelivered(clock::time_point now, size_t bytes)
+{
+    auto const _ = std::lock_guard { _mutex };
+    if (_bytesDelivered == 0)
+        _start = now;
+    _end = now;
+    _bytesDelivered += bytes;
+    if (!_outputPendingSince)
+        _outputPendingSince = now;
+}
+
+void Playback::frameRendered(clock::time_point start,
+                             clock::time_point end,
+                             uint64_t uploadedBytes,
+                             milliseconds refreshInterval)
+{
+    auto done = std::function<void()> {};
+    {
+        auto const _ = std::lock_guard { _mutex };
+        if (!_uploadedBytesAtStart)
+            _uploadedBytesAtStart = uploadedBytes;
+        _uploadedBytes = uploadedBytes - *_uploadedBytesAtStart;
+
+        if (_bytesDelivered != 0)
+            _renderTimes.emplace_back(end - start);
+
+        // Output waiting for more than a refresh interval to be rendered missed the frames in between.
+        // Output delivered while rendering this frame is left to the next one.
+        if (_outputPendingSince && *_outputPendingSince <= start)
+        {
+            if (refreshInterval.count() > 0)
+                _droppedFrames += static_cast<uint64_t>((start - *_outputPendingSince) / refreshInterval);
+            _outputPendingSince.reset();
+        }
+
+        done = std::move(_done);
+        _done = nullptr;
+    }
+    if (done)
+        done();
+}
+
+void Playback::finishAfterNextFrame(std::function<void()> done)
+{
+    auto const _ = std::lock_guard { _mutex };
+    _done = std::move(done);
+}
+
+std::string Playback::summary() const
+{
+    auto const _ = std::lock_guard { _mutex };
+
+    auto renderTimes = _renderTimes;
+    std::sort(renderTimes.begin(), renderTimes.end());
+    auto const playTime = std::chrono::duration<double>(_end - _start).count();
+    auto const framesPerSecond = playTime > 0 ? static_cast<double>(renderTimes.size()) / playTime : 0.0;
+    auto const peakRss = peakResidentSetSize();
+
+    auto output = std::string {};
+    output += fmt::format("Played back {} of output in {:.3f} s ({}).\n",
+                          crispy::humanReadableBytes(_bytesDelivered),
+                          playTime,
+                          _speed == PlaybackSpeed::Max ? "max speed" : "realtime");
+    output += fmt::format(
+        "{:<18}: {} ({:.1f} per second)\n", "frames rendered", renderTimes.size(), framesPerSecond);
+    output += fmt::format("{:<18}: {}\n", "dropped frames", _droppedFrames);
+    output += fmt::format("{:<18}: p50 {}, p90 {}, p99 {}, max {}\n",
+                          "frame render time",
+                          formatDuration(percentile(renderTimes, 0.5)),
+                          formatDuration(percentile(renderTimes, 0.9)),
+                          formatDuration(percentile(renderTimes, 0.99)),
+                          formatDuration(renderTimes.empty() ? clock::duration {} : renderTimes.back()));
+    output += fmt::format("{:<18}: {}\n", "GPU uploads", crispy::humanReadableBytes(_uploadedBytes));
+    output += fmt::format("{:<18}: {}\n",
+                          "peak RSS",
+                          peakRss ? crispy::humanReadableBytes(*peakRss) : std::string("unknown"));
+    return output;
+}
+// }}}
+
+// {{{ PlaybackPty
+PlaybackPty::PlaybackPty(Playback& playback,
+                         std::vector<vtbackend::RecordingEvent> events,
+                         PlaybackSpeed speed,
+                         vtbackend::PageSize pageSize):
+    MockViewPty { pageSize }, _playback { playback }, _events { std::move(events) }, _speed { speed }
+{
+    if (_speed != PlaybackSpeed::Max || _events.size() < 2)
+        return;
+
+    // At full speed, the output is delivered in reads as large as the session asks for.
+    auto output = std::string {};
+    for (auto const& event: _events)
+        output += event.output;
+    _events = { vtbackend::RecordingEvent { .output = std::move(output) } };
+}
+
+std::optional<std::tuple<std::string_view, bool>> PlaybackPty::read(
+    crispy::buffer_object<char>& storage, std::optional<std::chrono::milliseconds> timeout, size_t size)
+{
+    if (stdoutBuffer().empty())
+    {
+        auto lock = std::unique_lock { _mutex };
+        if (_closing || _nextEvent == _events.size())
+            return { std::tuple { std::string_view {}, false } }; // end of the recording
+
+        if (_speed == PlaybackSpeed::Realtime)
+        {
+            auto const due = _start + _events[_nextEvent].time;
+            auto const until = timeout ? std::min(due, Playback::clock::now() + *timeout) : due;
+            _condition.wait_until(lock, until, [&]() { return _wakeup || _closing; });
+            _wakeup = false;
+            if (_closing)
+                return { std::tuple { std::string_view {}, false } };
+            if (Playback::clock::now() < due)
+            {
+                errno = EAGAIN;
+                return std::nullopt;
+            }
+        }
+        setReadData(_events[_nextEvent++].output);
+    }
+
+    auto result = MockViewPty::read(storage, timeout, size);
+    if (result)
+        _playback.outputDelivered(Playback::clock::now(), std::get<0>(*result).size());
+    return result;
+}
+
+void PlaybackPty::wakeupReader()
+{
+    {
+        auto const _ = std::lock_guard { _mutex };
+        _wakeup = true;
+    }
+    _condition.notify_all();
+}
+
+void PlaybackPty::start()
+{
+    _start = Playback::clock::now();
+    MockViewPty::start();
+}
+
+void PlaybackPty::close()
+{
+    {
+        auto const _ = std::lock_guard { _mutex };
+        _closing = true;
+    }
+    _condition.notify_all();
+    MockViewPty::close();
+}
+// }}}
+
+} // namespace contour
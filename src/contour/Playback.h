@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <vtbackend/SessionRecorder.h>
+
+#include <vtpty/MockViewPty.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace contour
+{
+
+enum class PlaybackSpeed
+{
+    Max,      // delivers the output as fast as the session takes it
+    Realtime, // delivers the output with the timing it has been recorded with
+};
+
+/// @returns the speed named @p name (case insensitive), i.e. "max" or "realtime".
+[[nodiscard]] std::optional<PlaybackSpeed> parsePlaybackSpeed(std::string_view name);
+
+/**
+ * Plays back a recording of PTY output in a session, see `contour play`, and measures rendering it.
+ *
+ * The session reads the recording from a MockViewPty instead of a process, such that everything
+ * beyond the PTY runs as usual: parsing, rendering, and uploading to the GPU. Rendering the same
+ * recording with different themes, fonts, or configurations therefore is a deterministic benchmark.
+ */
+class Playback
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    Playback(vtbackend::Recording recording, PlaybackSpeed speed);
+
+    /// Loads the recording @p path, either recorded by a SessionRecorder or raw PTY output.
+    [[nodiscard]] static std::optional<vtbackend::Recording> load(std::filesystem::path const& path);
+
+    /// @returns the PTY playing back the recording, or nullptr if it has been taken already,
+    ///          as only the first session plays it back.
+    [[nodiscard]] std::unique_ptr<vtpty::Pty> takePty(vtbackend::PageSize pageSize);
+
+    /// Accounts the PTY delivering output to the session, to be called on the thread reading it.
+    void outputDelivered(clock::time_point now, size_t bytes);
+
+    /// Accounts a frame rendered, to be called on the render thread.
+    void frameRendered(clock::time_point start,
+                       clock::time_point end,
+                       uint64_t uploadedBytes,
+                       std::chrono::milliseconds refreshInterval);
+
+    /// Invokes @p done once the next frame has been rendered, i.e. the one showing the end of the recording.
+    void finishAfterNextFrame(std::function<void()> done);
+
+    /// @returns the frames rendered, their render times, dropped frames, GPU uploads, and the peak RSS.
+    [[nodiscard]] std::string summary() const;
+
+  private:
+    PlaybackSpeed _speed;
+    std::optional<vtbackend::Recording> _recording; // until taken by the PTY to play it back
+
+    mutable std::mutex _mutex;
+    clock::time_point _start {}; // of delivering the first output
+    clock::time_point _end {};   // of delivering the last output
+    uint64_t _bytesDelivered = 0;
+    std::optional<clock::time_point> _outputPendingSince; // output delivered, but not rendered yet
+    std::vector<clock::duration> _renderTimes;            // of the frames rendered while playing back
+    uint64_t _droppedFrames = 0;
+    std::optional<uint64_t> _uploadedBytesAtStart; // as reported with the first frame
+    uint64_t _uploadedBytes = 0;                   // since the first frame
+    std::function<void()> _done;                   // see finishAfterNextFrame()
+};
+
+/// Delivers the output of a recording as a PTY would, see Playback.
+class PlaybackPty final: public vtpty::MockViewPty
+{
+  public:
+    PlaybackPty(Playback& playback,
+                std::vector<vtbackend::RecordingEvent> events,
+                PlaybackSpeed speed,
+                vtbackend::PageSize pageSize);
+
+    [[nodiscard]] std::optional<std::tuple<std::string_view, bool>> read(
+        crispy::buffer_object<char>& storage,
+        std::optional<std::chrono::milliseconds> timeout,
+        size_t size) override;
+    void wakeupReader() override;
+
+    void start() override;
+    void close() override;
+
+  private:
+    Playback& _playback;
+    std::vector<vtbackend::RecordingEvent> _events; // the output events to deliver
+    size_t _nextEvent = 0;
+    PlaybackSpeed _speed;
+    Playback::clock::time_point _start {};
+
+    // Wakes up a reader waiting for the next event to be due.
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _wakeup = false;
+    bool _closing = false;
+};
+
+} // namespace contour
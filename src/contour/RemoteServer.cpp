@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <contour/RemoteServer.h>
+
+#include <vtbackend/RemoteRendering.h>
+#include <vtbackend/Settings.h>
+#include <vtbackend/Terminal.h>
+
+#include <vtpty/Process.h>
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+
+#if defined(_WIN32)
+    #include <fcntl.h>
+    #include <io.h>
+#endif
+
+using std::chrono::steady_clock;
+
+namespace contour
+{
+
+namespace
+{
+    // What the other threads hand over to the one serving the client.
+    //
+    // It is shared with the thread reading standard input, which is never joined,
+    // as it may remain blocked in reading until the process exits.
+    struct Mailbox
+    {
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::string received;       // from the client, not yet handled
+        bool disconnected = false;  // the client closed standard input
+        bool screenUpdated = false; // since the last frame was sent
+        bool closed = false;        // the shell exited
+
+        template <typename F>
+        void post(F update)
+        {
+            {
+                auto const _ = std::lock_guard { mutex };
+                update(*this);
+            }
+            wakeup.notify_one();
+        }
+    };
+
+    class RemoteServer: public vtbackend::Terminal::NullEvents
+    {
+      public:
+        explicit RemoteServer(RemoteServerSettings const& settings):
+            _terminal { *this,
+                        createShell(settings.pageSize),
+                        [&]() {
+                            auto terminalSettings = vtbackend::Settings {};
+                            terminalSettings.pageSize = settings.pageSize;
+                            terminalSettings.maxHistoryLineCount = settings.maxHistoryLineCount;
+                            return terminalSettings;
+                        }(),
+                        steady_clock::now() }
+        {
+        }
+
+        RemoteServer(RemoteServer const&) = delete;
+        RemoteServer& operator=(RemoteServer const&) = delete;
+        RemoteServer(RemoteServer&&) = delete;
+        RemoteServer& operator=(RemoteServer&&) = delete;
+        ~RemoteServer() override = default;
+
+        int run();
+
+        void renderBufferUpdated() override { screenUpdated(); }
+        void screenUpdated() override
+        {
+            _mailbox->post([](Mailbox& mailbox) { mailbox.screenUpdated = true; });
+        }
+
+      private:
+        static std::unique_ptr<vtpty::Pty> createShell(vtbackend::PageSize pageSize)
+        {
+            auto shell = vtpty::Process::loginShell(false);
+            auto const program = shell.front();
+            shell.erase(shell.begin());
+            return std::make_unique<vtpty::Process>(program,
+                                                    shell,
+                                                    vtpty::Process::homeDirectory(),
+                                                    vtpty::Process::Environment {},
+                                                    false,
+                                                    vtpty::createPty(pageSize, std::nullopt));
+        }
+
+        void handle(vtbackend::RemoteMessageReader::Message const& message);
+        void sendFrame();
+
+        std::shared_ptr<Mailbox> _mailbox = std::make_shared<Mailbox>();
+        vtbackend::Terminal _terminal;
+        vtbackend::RemoteMessageReader _reader;
+        vtbackend::RemoteFrameEncoder _encoder;
+        vtbackend::RemoteFramePacer _pacer;
+        std::string _output;
+        std::optional<uint64_t> _sentFrameID;
+    };
+
+    int RemoteServer::run()
+    {
+        _terminal.device().start();
+
+        auto terminalThread = std::thread([this]() {
+            while (_terminal.processInputOnce())
+                ;
+            _mailbox->post([](Mailbox& mailbox) { mailbox.closed = true; });
+        });
+
+        std::thread([mailbox = _mailbox]() {
+            auto buffer = std::array<char, 4096> {};
+            while (auto const n = std::fread(buffer.data(), 1, buffer.size(), stdin))
+                mailbox->post([&](Mailbox& m) { m.received.append(buffer.data(), n); });
+            mailbox->post([](Mailbox& m) { m.disconnected = true; });
+        }).detach();
+
+        auto received = std::string {};
+        auto frameDue = true; // such that the client gets the initial screen right away
+        auto exitCode = EXIT_SUCCESS;
+        while (true)
+        {
+            {
+                auto lock = std::unique_lock { _mailbox->mutex };
+                auto const ready = [&]() {
+                    return !_mailbox->received.empty() || _mailbox->disconnected || _mailbox->closed
+                           || (!frameDue && _mailbox->screenUpdated);
+                };
+                if (auto const next = _pacer.nextFrameTime(); frameDue && next)
+                    _mailbox->wakeup.wait_until(lock, *next, ready);
+                else
+                    _mailbox->wakeup.wait(lock, ready);
+
+                received.swap(_mailbox->received);
+                frameDue = frameDue || std::exchange(_mailbox->screenUpdated, false);
+                if (_mailbox->disconnected || _mailbox->closed)
+                    break;
+            }
+
+            _reader.feed(received);
+            received.clear();
+            while (auto const message = _reader.next())
+                handle(*message);
+
+            if (auto const next = _pacer.nextFrameTime(); frameDue && next && steady_clock::now() >= *next)
+            {
+                sendFrame();
+                frameDue = false;
+                if (std::ferror(stdout))
+                {
+                    exitCode = EXIT_FAILURE;
+                    break;
+                }
+            }
+        }
+
+        if (!_mailbox->closed)
+            _terminal.device().close();
+        terminalThread.join();
+        return exitCode;
+    }
+
+    void RemoteServer::handle(vtbackend::RemoteMessageReader::Message const& message)
+    {
+        switch (message.type)
+        {
+            case vtbackend::RemoteMessage::Input: _terminal.sendRawInput(message.payload); break;
+            case vtbackend::RemoteMessage::Resize:
+                if (auto const pageSize = vtbackend::decodeRemoteResize(message.payload))
+                {
+                    auto const _ = std::scoped_lock { _terminal };
+                    if (*pageSize != _terminal.pageSize())
+                        _terminal.resizeScreen(*pageSize);
+                }
+                break;
+            case vtbackend::RemoteMessage::FrameAck:
+                if (auto const frameID = vtbackend::decodeRemoteFrameAck(message.payload))
+                    _pacer.frameAcknowledged(*frameID, steady_clock::now());
+                break;
+            case vtbackend::RemoteMessage::Frame:
+            case vtbackend::RemoteMessage::Image:
+            case vtbackend::RemoteMessage::ForgetImages: break;
+        }
+    }
+
+    void RemoteServer::sendFrame()
+    {
+        auto const now = steady_clock::now();
+        _terminal.tick(now);
+        _terminal.refreshRenderBuffer();
+
+        auto const renderBuffer = _terminal.renderBuffer();
+        auto const& frame = renderBuffer.get();
+        if (_sentFrameID == frame.frameID)
+            return;
+
+        _output.clear();
+        _encoder.encode(frame, _output);
+        std::fwrite(_output.data(), 1, _output.size(), stdout);
+        std::fflush(stdout);
+
+        _pacer.frameSent(frame.frameID, now);
+        _sentFrameID = frame.frameID;
+    }
+} // namespace
+
+int serveRemote(RemoteServerSettings const& settings)
+{
+#if defined(_WIN32)
+    // The protocol is binary, and must not have its line endings translated.
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    try
+    {
+        auto server = RemoteServer { settings };
+        return server.run();
+    }
+    catch (std::exception const& e)
+    {
+        std::cerr << "Failed to serve the terminal remotely. " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+}
+
+} // namespace contour
@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <vtbackend/primitives.h>
+
+namespace contour
+{
+
+struct RemoteServerSettings
+{
+    vtbackend::PageSize pageSize { vtbackend::LineCount(25), vtbackend::ColumnCount(80) };
+    vtbackend::LineCount maxHistoryLineCount = vtbackend::LineCount(1000);
+};
+
+/// Runs the login shell in a headless terminal, and serves it to a remote client.
+///
+/// The render buffers of the terminal are streamed to standard output, and the client's input
+/// is read from standard input, both by the remote rendering protocol (see vtbackend::RemoteMessage).
+/// The connection is thereby left to whatever runs this command, e.g. `ssh host contour serve-remote`.
+///
+/// @returns the exit code, once the shell has exited or the client has closed the connection.
+int serveRemote(RemoteServerSettings const& settings);
+
+} // namespace contour
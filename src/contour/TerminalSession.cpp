@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <contour/ContourGuiApp.h>
+#include <contour/MemoryPressure.h>
 #include <contour/TerminalSession.h>
 #include <contour/display/TerminalDisplay.h>
 #include <contour/helper.h>
@@ -12,8 +13,10 @@
 #include <vtpty/Pty.h>
 #include <vtpty/SshSession.h>
 
+#include <crispy/App.h>
 #include <crispy/StackTrace.h>
 #include <crispy/assert.h>
+#include <crispy/trace.h>
 
 #include <QtCore/QDebug>
 #include <QtCore/QFileInfo>
@@ -34,6 +37,7 @@
 #include <filesystem>
 #include <fstream>
 #include <limits>
+#include <set>
 
 #if !defined(_WIN32)
     #include <pthread.h>
@@ -128,9 +132,15 @@ namespace
         settings.pageSize = profile.terminalSize;
         settings.ptyBufferObjectSize = config.ptyBufferObjectSize;
         settings.ptyReadBufferSize = config.ptyReadBufferSize;
+        settings.ptyReaderThread = config.ptyReaderThread;
+        settings.parseSliceSize = config.parseSliceSize;
         settings.maxHistoryLineCount = profile.maxHistoryLineCount;
+        settings.historySpillToDisk = profile.historySpillToDisk;
+        settings.historyMemoryBudget = profile.historyMemoryBudget * 1024 * 1024;
+        settings.historySearchIndex = profile.historySearchIndex;
         settings.copyLastMarkRangeOffset = profile.copyLastMarkRangeOffset;
         settings.cursorBlinkInterval = profile.inputModes.insert.cursor.cursorBlinkInterval;
+        settings.cursorBlinkTimeout = profile.inputModes.insert.cursor.cursorBlinkTimeout;
         settings.cursorShape = profile.inputModes.insert.cursor.cursorShape;
         settings.cursorDisplay = profile.inputModes.insert.cursor.cursorDisplay;
         settings.smoothLineScrolling = profile.smoothLineScrolling;
@@ -138,6 +148,8 @@ namespace
         settings.mouseProtocolBypassModifiers = config.bypassMouseProtocolModifiers;
         settings.maxImageSize = config.maxImageSize;
         settings.maxImageRegisterCount = config.maxImageColorRegisters;
+        settings.maxImageMemory = config.maxImageMemory * 1024 * 1024;
+        settings.maxClipboardSize = config.maxClipboardSize * 1024 * 1024;
         settings.statusDisplayType = profile.initialStatusDisplayType;
         settings.statusDisplayPosition = profile.statusDisplayPosition;
         settings.syncWindowTitleWithHostWritableStatusDisplay =
@@ -145,14 +157,27 @@ namespace
         if (auto const* p = preferredColorPalette(profile.colors, colorPreference))
             settings.colorPalette = *p;
         settings.refreshRate = profile.refreshRate;
+        settings.vsyncFramePacing = profile.vsyncFramePacing;
+        settings.synchronizedOutputTimeout = profile.synchronizedOutputTimeout;
+        settings.inputThreadQos = profile.threadPriority.input;
+        settings.detachedInputThreadQos = profile.threadPriority.background;
         settings.primaryScreen.allowReflowOnResize = config.reflowOnResize;
         settings.highlightDoubleClickedWord = profile.highlightDoubleClickedWord;
+        settings.searchRegex = profile.searchRegex;
+        settings.predictiveEcho = profile.predictiveEcho;
         settings.highlightTimeout = profile.highlightTimeout;
         settings.frozenModes = profile.frozenModes;
 
         return settings;
     }
 
+    // Snapshot files of the sessions of this process persisting their history, one per profile.
+    std::set<fs::path>& claimedHistorySnapshots()
+    {
+        static auto paths = std::set<fs::path> {};
+        return paths;
+    }
+
     int createSessionId()
     {
         static int nextSessionId = 1;
@@ -204,14 +229,24 @@ TerminalSession::TerminalSession(unique_ptr<vtpty::Pty> pty, ContourGuiApp& app)
                 SLOT(onConfigReload()));
     }
     _musicalNotesBuffer.reserve(16);
+    _terminal.setInputBatching(true);
     _profile = *_config.profile(_profileName); // XXX do it again. but we've to be more efficient here
-    configureTerminal();
+    configureTerminal(config::ProfileChanges::all());
 }
 
 TerminalSession::~TerminalSession()
 {
     sessionLog()("Destroying terminal session.");
+    if (_historySnapshot)
+    {
+        saveHistorySnapshot();
+        claimedHistorySnapshots().erase(_historySnapshot->path());
+    }
     _terminating = true;
+    if (_reactorInputId)
+        _ioReactor->remove(*_reactorInputId);
+    if (_reactorExitId)
+        _ioReactor->remove(*_reactorExitId);
     _terminal.device().wakeupReader();
     if (_exitWatcherThread->isRunning())
         _exitWatcherThread->terminate();
@@ -224,6 +259,7 @@ void TerminalSession::detachDisplay(display::TerminalDisplay& display)
     sessionLog()("Detaching display from session.");
     Require(_display == &display);
     _display = nullptr;
+    _terminal.setDetached(true);
 }
 
 void TerminalSession::attachDisplay(display::TerminalDisplay& newDisplay)
@@ -244,6 +280,7 @@ void TerminalSession::attachDisplay(display::TerminalDisplay& newDisplay)
         _terminal.resizeScreen(_terminal.pageSize(), pixels);
         _terminal.setRefreshRate(_display->refreshRate());
     }
+    _terminal.setDetached(!newDisplay.visibleToUser());
 
     {
         auto const _ = std::scoped_lock { _onClosedMutex };
@@ -262,11 +299,77 @@ void TerminalSession::scheduleRedraw()
 void TerminalSession::start()
 {
     sessionLog()("Starting terminal session.");
-    _terminal.device().start();
+    if (auto const path = _app.takeRecordingPath())
+    {
+        if (_terminal.startRecording(*path, vtbackend::recordingFormatOf(*path)))
+            sessionLog()("Recording the PTY output into {}.", path->string());
+        else
+            errorLog()("Failed to record the PTY output into {}.", path->string());
+    }
+    {
+        auto const _ = crispy::trace_scope("TerminalSession.start (PTY)");
+        _terminal.device().start();
+    }
+    if (startOnReactor())
+        return;
     _screenUpdateThread = make_unique<std::thread>(bind(&TerminalSession::mainLoop, this));
     _exitWatcherThread->start(QThread::LowPriority);
 }
 
+bool TerminalSession::startOnReactor()
+{
+    // The reactor reads the PTY itself, and the reader thread would just be in its way.
+    auto reactor = _app.sessionsManager().ioReactor();
+    auto const readinessHandle = _terminal.device().readinessHandle();
+    if (!reactor || _config.ptyReaderThread || readinessHandle == -1)
+        return false;
+
+    _reactorInputId = reactor->add(readinessHandle, [this]() { return processInputOnReactor(); });
+    if (!_reactorInputId)
+        return false;
+    _ioReactor = std::move(reactor);
+
+    if (auto const closedHandle = _terminal.device().closedHandle(); closedHandle != -1)
+        _reactorExitId = _ioReactor->add(closedHandle, [this]() {
+            sessionLog()("Terminal device closed (process exited).");
+            postToObject(this, [this]() { onClosed(); });
+            return crispy::io_reactor::disposition::Remove;
+        });
+    if (!_reactorExitId)
+        _exitWatcherThread->start(QThread::LowPriority);
+
+    sessionLog()("Serving PTY by the reactor.");
+    return true;
+}
+
+crispy::io_reactor::disposition TerminalSession::processInputOnReactor()
+{
+    using crispy::io_reactor;
+
+    if (_terminating)
+        return io_reactor::disposition::Remove;
+
+    if (!_terminal.processAvailableInput(ReactorInputBudget))
+    {
+        sessionLog()("Reactor stops serving PTY (PTY closed).");
+        onClosed();
+        return io_reactor::disposition::Remove;
+    }
+
+    // Tracing halted the execution, which setExecutionMode() resumes.
+    if (_terminal.executionMode() == ExecutionMode::Waiting)
+        return io_reactor::disposition::Suspend;
+
+    return io_reactor::disposition::Rearm;
+}
+
+void TerminalSession::setExecutionMode(ExecutionMode mode)
+{
+    _terminal.setExecutionMode(mode);
+    if (_reactorInputId)
+        _ioReactor->resume(*_reactorInputId);
+}
+
 void TerminalSession::mainLoop()
 {
     setThreadName("Terminal.Loop");
@@ -301,6 +404,12 @@ void TerminalSession::terminate()
 // {{{ Events implementations
 void TerminalSession::bell()
 {
+    // Plays a burst of bells once, instead of restarting the bell sound for each of them.
+    auto const now = steady_clock::now();
+    if (now - _lastBell < BellCoalescingInterval)
+        return;
+    _lastBell = now;
+
     emit onBell(_profile.bell.volume);
 
     if (_profile.bell.alert)
@@ -313,7 +422,7 @@ void TerminalSession::bufferChanged(vtbackend::ScreenType type)
         return;
 
     _currentScreenType = type;
-    emit isScrollbarVisibleChanged();
+    notifyPropertiesChanged(ScrollbarVisibilityChange);
     _display->post([this, type]() { _display->bufferChanged(type); });
 }
 
@@ -332,7 +441,7 @@ void TerminalSession::screenUpdated()
     if (_lastHistoryLineCount != _terminal.currentScreen().historyLineCount())
     {
         _lastHistoryLineCount = _terminal.currentScreen().historyLineCount();
-        emit historyLineCountChanged(unbox(_lastHistoryLineCount));
+        notifyPropertiesChanged(HistoryLineCountChange);
     }
 
     scheduleRedraw();
@@ -341,8 +450,16 @@ void TerminalSession::screenUpdated()
 void TerminalSession::flushInput()
 {
     terminal().flushInput();
-    if (terminal().hasInput() && _display)
-        _display->post(bind(&TerminalSession::flushInput, this));
+    if (!terminal().hasInput() || !_display || _inputFlushScheduled)
+        return;
+
+    // The PTY's write queue is full, so retry once the application had the chance to read some of it,
+    // rather than spinning on the event loop.
+    _inputFlushScheduled = true;
+    QTimer::singleShot(InputFlushRetryInterval, this, [this]() {
+        _inputFlushScheduled = false;
+        flushInput();
+    });
 }
 
 void TerminalSession::renderBufferUpdated()
@@ -409,7 +526,63 @@ void TerminalSession::updateColorPreference(vtbackend::ColorPreference preferenc
         return;
 
     _currentColorPreference = preference;
-    if (auto const* colorPalette = preferredColorPalette(_profile.colors, preference))
+    applyColorPalette();
+}
+
+void TerminalSession::trimMemory()
+{
+    auto const trimmed = [this]() {
+        auto const _ = std::scoped_lock { _terminal };
+        return _terminal.trimMemory();
+    }();
+    memoryLog()("Trimmed memory of session {}: {} history lines compacted, {} KiB released.",
+                _id,
+                trimmed.compactedLines,
+                trimmed.releasedBytes / 1024);
+
+    if (_display)
+        _display->trimCaches();
+}
+
+TerminalSession::ResourceUsage TerminalSession::resourceUsage()
+{
+    auto usage = ResourceUsage {
+        .ptyBytesPerSecond = _terminal.floodStats().bytesPerSecond,
+        .parseCpuTime = _terminal.parseCpuTime(),
+        .renderCpuTime = chrono::nanoseconds(_renderCpuTime.load(std::memory_order_relaxed)),
+    };
+
+    auto const now = steady_clock::now();
+    if (auto const elapsed = chrono::duration<double>(now - _cpuTimeSample.time).count(); elapsed >= 1.0)
+    {
+        auto const loadSince = [&](chrono::nanoseconds before, chrono::nanoseconds after) {
+            return chrono::duration<double>(after - before).count() / elapsed;
+        };
+        _parseCpuLoad = loadSince(_cpuTimeSample.parse, usage.parseCpuTime);
+        _renderCpuLoad = loadSince(_cpuTimeSample.render, usage.renderCpuTime);
+        _cpuTimeSample = { .time = now, .parse = usage.parseCpuTime, .render = usage.renderCpuTime };
+    }
+    usage.parseCpuLoad = _parseCpuLoad;
+    usage.renderCpuLoad = _renderCpuLoad;
+
+    {
+        auto const _ = std::scoped_lock { _terminal };
+        usage.historyBytes = _terminal.primaryScreen().grid().memoryStats().bytes()
+                             + _terminal.alternateScreen().grid().memoryStats().bytes();
+        usage.imageBytes = _terminal.imagePoolStats().bytes;
+    }
+
+    auto const& gpuMemoryBudget = _app.sessionsManager().gpuMemoryBudget();
+    usage.atlasBytes = gpuMemoryBudget.usage(gpuMemoryAccountName())[vtrasterizer::GpuMemoryUse::Atlas];
+    if (auto const atlasBytes = gpuMemoryBudget.usage()[vtrasterizer::GpuMemoryUse::Atlas]; atlasBytes)
+        usage.atlasShare = static_cast<double>(usage.atlasBytes) / static_cast<double>(atlasBytes);
+
+    return usage;
+}
+
+void TerminalSession::applyColorPalette()
+{
+    if (auto const* colorPalette = preferredColorPalette(_profile.colors, _currentColorPreference))
     {
         _terminal.resetColorPalette(*colorPalette);
 
@@ -443,7 +616,39 @@ void TerminalSession::executePendingBufferCapture(bool allow, bool remember)
     if (!allow)
         return;
 
-    _terminal.primaryScreen().captureBuffer(capture.lines, capture.logical);
+    // Only the snapshot is taken under the terminal lock, so that the PTY parser is
+    // not blocked while the captured text is being transferred.
+    auto lines = [&]() {
+        auto const _ = std::scoped_lock { _terminal };
+        return _terminal.primaryScreen().captureBufferSnapshot(capture.lines, capture.logical);
+    }();
+
+    if (_bufferCapture)
+        errorLog()("Buffer capture requested while replying the previous one. Abandoning the previous one.");
+    _bufferCapture.emplace(std::move(lines), capture.logical);
+    continueBufferCapture();
+}
+
+void TerminalSession::continueBufferCapture()
+{
+    // Encodes (and thus buffers) the captured text only as fast as the application reads it.
+    _terminal.flushInput();
+    auto replies = std::string {};
+    while (_bufferCapture && _terminal.pendingInputBytes() < BufferCaptureWatermark)
+    {
+        replies.clear();
+        _bufferCapture->encode(replies, BufferCaptureWatermark);
+        _terminal.reply(replies);
+        _terminal.flushInput();
+        if (_bufferCapture->finished())
+            _bufferCapture.reset();
+    }
+
+    if (_bufferCapture)
+    {
+        QTimer::singleShot(InputFlushRetryInterval, this, [this]() { continueBufferCapture(); });
+        return;
+    }
 
     displayLog()("requestCaptureBuffer: Finished. Waking up I/O thread.");
     flushInput();
@@ -538,7 +743,10 @@ void TerminalSession::copyToClipboard(std::string_view data)
     if (!_display)
         return;
 
-    _display->post([this, data = string(data)]() { _display->copyToClipboard(data); });
+    // Converted right away, such that the (possibly large) contents are not copied once more,
+    // but shared with the GUI thread.
+    auto text = QString::fromUtf8(data.data(), static_cast<int>(data.size()));
+    _display->post([this, text = std::move(text)]() { _display->copyToClipboard(text); });
 }
 
 void TerminalSession::openDocument(std::string_view fileOrUrl)
@@ -612,6 +820,19 @@ void TerminalSession::onClosed()
 
     emit sessionClosed(*this);
 
+    if (auto* playback = _app.playback(); playback && _display)
+    {
+        // The window is closed only once the end of the recording has been rendered.
+        playback->finishAfterNextFrame([this]() {
+            postToObject(this, [this]() {
+                if (_display)
+                    _display->closeDisplay();
+            });
+        });
+        _display->scheduleRedraw();
+        return;
+    }
+
     if (diff < _app.earlyExitThreshold())
     {
         // auto const w = _terminal.pageSize().columns.as<int>();
@@ -664,24 +885,25 @@ void TerminalSession::pasteFromClipboard(unsigned count, bool strip)
 
 void TerminalSession::onSelectionCompleted()
 {
+    // The selection is converted chunk-wise, such that a huge selection is not held twice in memory.
+    auto const selectedText = [this]() {
+        auto text = QString {};
+        terminal().extractSelectionText([&](std::string_view chunk) {
+            text += QString::fromUtf8(chunk.data(), static_cast<int>(chunk.size()));
+        });
+        return text;
+    };
+
     switch (_config.onMouseSelection)
     {
         case config::SelectionAction::CopyToSelectionClipboard:
             if (QClipboard* clipboard = QGuiApplication::clipboard();
                 clipboard != nullptr && clipboard->supportsSelection())
-            {
-                string const text = terminal().extractSelectionText();
-                clipboard->setText(QString::fromUtf8(text.c_str(), static_cast<int>(text.size())),
-                                   QClipboard::Selection);
-            }
+                clipboard->setText(selectedText(), QClipboard::Selection);
             break;
         case config::SelectionAction::CopyToClipboard:
             if (QClipboard* clipboard = QGuiApplication::clipboard(); clipboard != nullptr)
-            {
-                string const text = terminal().extractSelectionText();
-                clipboard->setText(QString::fromUtf8(text.c_str(), static_cast<int>(text.size())),
-                                   QClipboard::Clipboard);
-            }
+                clipboard->setText(selectedText(), QClipboard::Clipboard);
             break;
         case config::SelectionAction::Nothing: break;
     }
@@ -754,9 +976,42 @@ void TerminalSession::inputModeChanged(vtbackend::ViMode mode)
     }
 }
 
-void TerminalSession::onScrollOffsetChanged(vtbackend::ScrollOffset value)
+void TerminalSession::onScrollOffsetChanged(vtbackend::ScrollOffset /*value*/)
+{
+    notifyPropertiesChanged(ScrollOffsetChange);
+}
+
+void TerminalSession::notifyPropertiesChanged(uint8_t changes)
+{
+    // Only the first change since the last round of notifications schedules the next one.
+    if (_pendingPropertyChanges.fetch_or(changes) != 0)
+        return;
+
+    QMetaObject::invokeMethod(
+        this,
+        [this]() {
+            auto const nextNotification = _lastPropertyNotification + terminal().refreshInterval().value;
+            auto const now = steady_clock::now();
+            if (now >= nextNotification)
+                emitPropertyNotifications();
+            else
+                QTimer::singleShot(chrono::duration_cast<chrono::milliseconds>(nextNotification - now),
+                                   this,
+                                   [this]() { emitPropertyNotifications(); });
+        },
+        Qt::QueuedConnection);
+}
+
+void TerminalSession::emitPropertyNotifications()
 {
-    emit scrollOffsetChanged(unbox(value));
+    _lastPropertyNotification = steady_clock::now();
+    auto const changes = _pendingPropertyChanges.exchange(0);
+    if (changes & HistoryLineCountChange)
+        emit historyLineCountChanged(historyLineCount());
+    if (changes & ScrollOffsetChange)
+        emit scrollOffsetChanged(scrollOffset());
+    if (changes & ScrollbarVisibilityChange)
+        emit isScrollbarVisibleChanged();
 }
 // }}}
 // {{{ Input Events
@@ -777,7 +1032,7 @@ void TerminalSession::sendKeyEvent(Key key, Modifiers modifiers, KeyboardEventTy
     if (eventType != KeyboardEventType::Release)
     {
         if (auto const* actions =
-                config::apply(_config.inputMappings.keyMappings, key, modifiers, matchModeFlags()))
+                config::apply(_config.inputMappings.keyTable, key, modifiers, matchModeFlags()))
         {
             executeAllActions(*actions);
             return;
@@ -809,7 +1064,7 @@ void TerminalSession::sendCharEvent(
     if (eventType != KeyboardEventType::Release)
     {
         if (auto const* actions =
-                config::apply(_config.inputMappings.charMappings, value, modifiers, matchModeFlags()))
+                config::apply(_config.inputMappings.charTable, value, modifiers, matchModeFlags()))
         {
             executeAllActions(*actions);
             return;
@@ -825,6 +1080,9 @@ void TerminalSession::sendMousePressEvent(Modifiers modifiers,
     auto const uiHandledHint = false;
     inputLog()("Mouse press received: {} {}\n", modifiers, button);
 
+    // Button transitions are applied exactly where they happened in between the mouse moves.
+    flushMouseEvents();
+
     terminal().tick(steady_clock::now());
 
     if (terminal().sendMousePressEvent(modifiers, button, pixelPosition, uiHandledHint))
@@ -835,29 +1093,89 @@ void TerminalSession::sendMousePressEvent(Modifiers modifiers,
                                        : modifiers;
 
     if (auto const* actions =
-            config::apply(_config.inputMappings.mouseMappings, button, sanitizedModifier, matchModeFlags()))
+            config::apply(_config.inputMappings.mouseTable, button, sanitizedModifier, matchModeFlags()))
         executeAllActions(*actions);
 }
 
 void TerminalSession::sendMouseMoveEvent(vtbackend::Modifiers modifiers,
                                          vtbackend::CellLocation pos,
                                          vtbackend::PixelCoordinate pixelPosition)
+{
+    // The wheel steps received before are to be applied at the position they have been received at.
+    if (!_pendingWheelSteps.empty())
+        flushMouseEvents();
+
+    _pendingMouseMove = PendingMouseMove { modifiers, pos, pixelPosition };
+    scheduleMouseEventsFlush();
+}
+
+void TerminalSession::sendMouseWheelEvent(Modifiers modifiers,
+                                          MouseButton button,
+                                          PixelCoordinate pixelPosition)
+{
+    if (!_pendingWheelSteps.empty() && _pendingWheelSteps.back().button == button
+        && _pendingWheelSteps.back().modifiers == modifiers)
+    {
+        ++_pendingWheelSteps.back().count;
+        _pendingWheelSteps.back().pixelPosition = pixelPosition;
+    }
+    else
+        _pendingWheelSteps.emplace_back(PendingWheelSteps { modifiers, button, pixelPosition });
+    scheduleMouseEventsFlush();
+}
+
+void TerminalSession::sendMouseReleaseEvent(Modifiers modifiers,
+                                            MouseButton button,
+                                            PixelCoordinate pixelPosition)
+{
+    flushMouseEvents();
+
+    terminal().tick(steady_clock::now());
+
+    auto const uiHandledHint = false;
+    terminal().sendMouseReleaseEvent(modifiers, button, pixelPosition, uiHandledHint);
+    scheduleRedraw();
+}
+
+void TerminalSession::scheduleMouseEventsFlush()
+{
+    if (_mouseEventsFlushScheduled)
+        return;
+
+    // Applied after the input events already queued, i.e. the ones delivered along with this one.
+    _mouseEventsFlushScheduled = true;
+    QTimer::singleShot(0, this, [this]() { flushMouseEvents(); });
+}
+
+void TerminalSession::flushMouseEvents()
+{
+    _mouseEventsFlushScheduled = false;
+
+    if (auto const move = std::exchange(_pendingMouseMove, std::nullopt))
+        applyMouseMove(*move);
+
+    for (auto const& steps: std::exchange(_pendingWheelSteps, {}))
+        for (auto i = 0; i < steps.count; ++i)
+            sendMousePressEvent(steps.modifiers, steps.button, steps.pixelPosition);
+}
+
+void TerminalSession::applyMouseMove(PendingMouseMove const& move)
 {
     // NB: This translation depends on the display's margin, so maybe
     //     the display should provide the translation?
 
-    if (!(pos < terminal().pageSize()))
+    if (!(move.position < terminal().pageSize()))
         return;
 
     terminal().tick(steady_clock::now());
 
     auto constexpr UiHandledHint = false;
-    terminal().sendMouseMoveEvent(modifiers, pos, pixelPosition, UiHandledHint);
+    terminal().sendMouseMoveEvent(move.modifiers, move.position, move.pixelPosition, UiHandledHint);
 
-    if (pos != _currentMousePosition)
+    if (move.position != _currentMousePosition)
     {
         // Change cursor shape only when changing grid cell.
-        _currentMousePosition = pos;
+        _currentMousePosition = move.position;
         if (terminal().isMouseHoveringHyperlink())
             _display->setMouseCursorShape(MouseCursorShape::PointingHand);
         else
@@ -865,17 +1183,6 @@ void TerminalSession::sendMouseMoveEvent(vtbackend::Modifiers modifiers,
     }
 }
 
-void TerminalSession::sendMouseReleaseEvent(Modifiers modifiers,
-                                            MouseButton button,
-                                            PixelCoordinate pixelPosition)
-{
-    terminal().tick(steady_clock::now());
-
-    auto const uiHandledHint = false;
-    terminal().sendMouseReleaseEvent(modifiers, button, pixelPosition, uiHandledHint);
-    scheduleRedraw();
-}
-
 void TerminalSession::sendFocusInEvent()
 {
     // as per Qt-documentation, some platform implementations reset the cursor when leaving the
@@ -920,6 +1227,12 @@ void TerminalSession::cursorPositionChanged()
 {
     QGuiApplication::inputMethod()->update(Qt::ImCursorRectangle);
 }
+
+void TerminalSession::scheduleInputFlush()
+{
+    // Runs after the input events already queued, such that a burst of them is written at once.
+    QTimer::singleShot(0, this, [this]() { flushInput(); });
+}
 // }}}
 // {{{ Actions
 bool TerminalSession::operator()(actions::CancelSelection)
@@ -1006,6 +1319,27 @@ bool TerminalSession::operator()(actions::DecreaseOpacity)
     return true;
 }
 
+bool TerminalSession::operator()(actions::DumpTrace)
+{
+    auto& recorder = crispy::flight_recorder::global();
+    if (!recorder.enabled())
+    {
+        // Recording hot paths costs a little, so it only starts when asked for the first time.
+        recorder.setEnabled(true);
+        sessionLog()("Flight recorder enabled. Request DumpTrace again to write the recorded spans.");
+        return true;
+    }
+
+    auto const now = chrono::system_clock::now().time_since_epoch();
+    auto const seconds = chrono::duration_cast<chrono::seconds>(now).count();
+    auto const path = fs::temp_directory_path() / fmt::format("contour-trace-{}.json", seconds);
+    if (recorder.dump(path))
+        sessionLog()("Flight recorder spans written to {}.", path.string());
+    else
+        errorLog()("Failed to write flight recorder spans to {}.", path.string());
+    return true;
+}
+
 bool TerminalSession::operator()(actions::FocusNextSearchMatch)
 {
     if (_terminal.state().viCommands.jumpToNextMatch(1))
@@ -1251,6 +1585,36 @@ bool TerminalSession::operator()(actions::ToggleInputProtection)
     return true;
 }
 
+bool TerminalSession::operator()(actions::ToggleRecording recording)
+{
+    if (auto const path = _terminal.recordingPath())
+    {
+        if (auto const stats = _terminal.stopRecording())
+            sessionLog()("Recorded {} events with {} bytes of PTY output into {}.",
+                         stats->events,
+                         stats->bytes,
+                         path->string());
+        return true;
+    }
+
+    auto const binary = recording.format == actions::RecordingFormat::Binary;
+    auto const path = fs::temp_directory_path()
+                      / fmt::format("contour-recording-{}-{}.{}",
+                                    _id,
+                                    std::chrono::duration_cast<std::chrono::seconds>(
+                                        std::chrono::system_clock::now().time_since_epoch())
+                                        .count(),
+                                    binary ? "rec" : "cast");
+    if (!_terminal.startRecording(path, binary ? vtbackend::RecordingFormat::Binary
+                                               : vtbackend::RecordingFormat::Asciicast))
+    {
+        errorLog()("Failed to record the PTY output into {}.", path.string());
+        return true;
+    }
+    sessionLog()("Recording the PTY output into {}.", path.string());
+    return true;
+}
+
 bool TerminalSession::operator()(actions::ToggleStatusLine)
 {
     auto const l = scoped_lock { _terminal };
@@ -1278,25 +1642,25 @@ bool TerminalSession::operator()(actions::ToggleTitleBar)
 // {{{ Trace debug mode
 bool TerminalSession::operator()(actions::TraceBreakAtEmptyQueue)
 {
-    _terminal.setExecutionMode(ExecutionMode::BreakAtEmptyQueue);
+    setExecutionMode(ExecutionMode::BreakAtEmptyQueue);
     return true;
 }
 
 bool TerminalSession::operator()(actions::TraceEnter)
 {
-    _terminal.setExecutionMode(ExecutionMode::Waiting);
+    setExecutionMode(ExecutionMode::Waiting);
     return true;
 }
 
 bool TerminalSession::operator()(actions::TraceLeave)
 {
-    _terminal.setExecutionMode(ExecutionMode::Normal);
+    setExecutionMode(ExecutionMode::Normal);
     return true;
 }
 
 bool TerminalSession::operator()(actions::TraceStep)
 {
-    _terminal.setExecutionMode(ExecutionMode::SingleStep);
+    setExecutionMode(ExecutionMode::SingleStep);
     return true;
 }
 // }}}
@@ -1337,8 +1701,33 @@ bool TerminalSession::reloadConfig(config::Config newConfig, string const& profi
                  newConfig.backingFilePath.string(), profileName);
     // clang-format on
 
+    auto const* newProfile = newConfig.profile(profileName);
+    if (profileName != _profileName || !newProfile)
+    {
+        _config = std::move(newConfig);
+        activateProfile(profileName);
+        return true;
+    }
+
+    // Only reapply what has changed, so that e.g. changing a color does not discard the glyph caches.
+    auto const changes = config::diffProfiles(_config, _profile, newConfig, *newProfile);
+    sessionLog()("Configuration changes: terminal={}, cursor={}, colors={}, history={}, window={}, "
+                 "display={}, fonts={}",
+                 changes.terminal,
+                 changes.cursor,
+                 changes.colors,
+                 changes.history,
+                 changes.window,
+                 changes.display,
+                 changes.fonts);
+
     _config = std::move(newConfig);
-    activateProfile(profileName);
+    _profile = *_config.profile(profileName);
+    if (!changes.any())
+        return true;
+
+    configureTerminal(changes);
+    configureDisplay(changes);
 
     return true;
 }
@@ -1424,42 +1813,102 @@ void TerminalSession::activateProfile(string const& newProfileName)
     sessionLog()("Changing profile to {}.", newProfileName);
     _profileName = newProfileName;
     _profile = *newProfile;
-    configureTerminal();
-    configureDisplay();
+    configureTerminal(config::ProfileChanges::all());
+    configureDisplay(config::ProfileChanges::all());
 }
 
-void TerminalSession::configureTerminal()
+void TerminalSession::configureTerminal(config::ProfileChanges const& changes)
 {
     auto const l = scoped_lock { _terminal };
     sessionLog()("Configuring terminal.");
 
-    _terminal.setWordDelimiters(_config.wordDelimiters);
-    _terminal.setMouseProtocolBypassModifiers(_config.bypassMouseProtocolModifiers);
-    _terminal.setMouseBlockSelectionModifiers(_config.mouseBlockSelectionModifiers);
-    _terminal.setLastMarkRangeOffset(_profile.copyLastMarkRangeOffset);
-
-    sessionLog()("Setting terminal ID to {}.", _profile.terminalId);
-    _terminal.setTerminalId(_profile.terminalId);
-    _terminal.setMaxImageColorRegisters(_config.maxImageColorRegisters);
-    _terminal.setMaxImageSize(_config.maxImageSize);
-    _terminal.setMode(vtbackend::DECMode::NoSixelScrolling, !_config.sixelScrolling);
-    _terminal.setStatusDisplay(_profile.initialStatusDisplayType);
-    sessionLog()("maxImageSize={}, sixelScrolling={}", _config.maxImageSize, _config.sixelScrolling);
+    if (changes.terminal)
+    {
+        _terminal.setWordDelimiters(_config.wordDelimiters);
+        _terminal.setMouseProtocolBypassModifiers(_config.bypassMouseProtocolModifiers);
+        _terminal.setMouseBlockSelectionModifiers(_config.mouseBlockSelectionModifiers);
+        _terminal.setLastMarkRangeOffset(_profile.copyLastMarkRangeOffset);
+
+        sessionLog()("Setting terminal ID to {}.", _profile.terminalId);
+        _terminal.setTerminalId(_profile.terminalId);
+        _terminal.setMaxImageColorRegisters(_config.maxImageColorRegisters);
+        _terminal.setMaxImageSize(_config.maxImageSize);
+        _terminal.setMaxImageMemory(_config.maxImageMemory * 1024 * 1024);
+        _terminal.settings().maxClipboardSize = _config.maxClipboardSize * 1024 * 1024;
+        _terminal.setMode(vtbackend::DECMode::NoSixelScrolling, !_config.sixelScrolling);
+        _terminal.setStatusDisplay(_profile.initialStatusDisplayType);
+        sessionLog()("maxImageSize={}, sixelScrolling={}", _config.maxImageSize, _config.sixelScrolling);
+        _terminal.setHighlightTimeout(_profile.highlightTimeout);
+        _terminal.viewport().setScrollOff(_profile.modalCursorScrollOff);
+    }
 
     // XXX
     // if (!terminalView.renderer().renderTargetAvailable())
     //     return;
 
-    configureCursor(_profile.inputModes.insert.cursor);
-    updateColorPreference(_app.colorPreference());
-    _terminal.setMaxHistoryLineCount(_profile.maxHistoryLineCount);
-    _terminal.setHighlightTimeout(_profile.highlightTimeout);
-    _terminal.viewport().setScrollOff(_profile.modalCursorScrollOff);
+    if (changes.cursor)
+        configureCursor(_profile.inputModes.insert.cursor);
+
+    if (changes.colors)
+    {
+        // Re-resolves the palette even if the color preference did not change.
+        _currentColorPreference = _app.colorPreference();
+        applyColorPalette();
+    }
+
+    if (changes.history)
+    {
+        _terminal.setMaxHistoryLineCount(_profile.maxHistoryLineCount);
+        _terminal.setHistorySpill(_profile.historySpillToDisk, _profile.historyMemoryBudget * 1024 * 1024);
+        _terminal.setHistorySearchIndex(_profile.historySearchIndex);
+        configureHistorySnapshots();
+    }
+}
+
+void TerminalSession::configureHistorySnapshots()
+{
+    if (_profile.historyPersist == !!_historySnapshot)
+        return;
+
+    if (!_profile.historyPersist)
+    {
+        saveHistorySnapshot();
+        claimedHistorySnapshots().erase(_historySnapshot->path());
+        _historySnapshotTimer.reset();
+        _historySnapshot.reset();
+        return;
+    }
+
+    auto path = crispy::app::instance()->localStateDir() / "sessions" / (_profileName + ".snapshot");
+    if (!claimedHistorySnapshots().insert(path).second)
+    {
+        sessionLog()("History of profile {} is persisted by another session already.", _profileName);
+        return;
+    }
+
+    {
+        auto const _ = std::scoped_lock { _terminal };
+        if (auto const lines = restoreGridSnapshot(_terminal.primaryScreen().grid(), path))
+            sessionLog()("Restored {} lines of history from {}.", *lines, path.string());
+    }
+
+    _historySnapshot = make_unique<GridSnapshotWriter>(std::move(path));
+    _historySnapshotTimer = make_unique<QTimer>();
+    connect(_historySnapshotTimer.get(), &QTimer::timeout, this, [this]() { saveHistorySnapshot(); });
+    _historySnapshotTimer->start(HistorySnapshotInterval);
+}
+
+void TerminalSession::saveHistorySnapshot()
+{
+    // Only the lines scrolled into the history since the last snapshot are written.
+    auto const _ = std::scoped_lock { _terminal };
+    (void) _historySnapshot->write(_terminal.primaryScreen().grid());
 }
 
 void TerminalSession::configureCursor(config::CursorConfig const& cursorConfig)
 {
     _terminal.setCursorBlinkingInterval(cursorConfig.cursorBlinkInterval);
+    _terminal.setCursorBlinkTimeout(cursorConfig.cursorBlinkTimeout);
     _terminal.setCursorDisplay(cursorConfig.cursorDisplay);
     _terminal.setCursorShape(cursorConfig.cursorShape);
 
@@ -1469,13 +1918,29 @@ void TerminalSession::configureCursor(config::CursorConfig const& cursorConfig)
 }
 
 void TerminalSession::configureDisplay()
+{
+    configureDisplay(config::ProfileChanges::all());
+}
+
+void TerminalSession::configureDisplay(config::ProfileChanges const& changes)
 {
     if (!_display)
         return;
 
     sessionLog()("Configuring display.");
-    _display->setBlurBehind(_profile.backgroundBlur);
 
+    if (changes.display)
+    {
+        _display->setBlurBehind(_profile.backgroundBlur);
+        _terminal.setRefreshRate(_display->refreshRate());
+        _terminal.setVsyncFramePacing(_profile.vsyncFramePacing);
+        _terminal.setSynchronizedOutputTimeout(_profile.synchronizedOutputTimeout);
+        _terminal.setInputThreadQos(_profile.threadPriority.input, _profile.threadPriority.background);
+        _display->setHyperlinkDecoration(_profile.hyperlinkDecoration.normal,
+                                         _profile.hyperlinkDecoration.hover);
+    }
+
+    if (changes.terminal)
     {
         auto const dpr = _display->contentScale();
         auto const qActualScreenSize = _display->window()->screen()->size() * dpr;
@@ -1484,19 +1949,22 @@ void TerminalSession::configureDisplay()
         _terminal.setMaxImageSize(actualScreenSize, actualScreenSize);
     }
 
-    if (_profile.maximized)
-        _display->setWindowMaximized();
-    else
-        _display->setWindowNormal();
-
-    if (_profile.fullscreen != _display->isFullScreen())
-        _display->toggleFullScreen();
+    if (changes.window)
+    {
+        if (_profile.maximized)
+            _display->setWindowMaximized();
+        else
+            _display->setWindowNormal();
 
-    _terminal.setRefreshRate(_display->refreshRate());
-    _display->setFonts(_profile.fonts);
-    adaptToWidgetSize();
+        if (_profile.fullscreen != _display->isFullScreen())
+            _display->toggleFullScreen();
+    }
 
-    _display->setHyperlinkDecoration(_profile.hyperlinkDecoration.normal, _profile.hyperlinkDecoration.hover);
+    if (changes.fonts)
+    {
+        _display->setFonts(_profile.fonts);
+        adaptToWidgetSize();
+    }
 
     setWindowTitle(_terminal.windowTitle());
 }
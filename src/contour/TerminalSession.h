@@ -6,10 +6,12 @@
 #include <contour/Config.h>
 #include <contour/helper.h>
 
+#include <vtbackend/GridSnapshot.h>
 #include <vtbackend/Terminal.h>
 
 #include <vtrasterizer/Renderer.h>
 
+#include <crispy/io_reactor.h>
 #include <crispy/point.h>
 
 #include <fmt/format.h>
@@ -17,10 +19,16 @@
 #include <QtCore/QAbstractItemModel>
 #include <QtCore/QFileSystemWatcher>
 #include <QtCore/QThread>
+#include <QtCore/QTimer>
 #include <QtQml/QJSValue>
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <memory>
+#include <optional>
 #include <thread>
+#include <vector>
 
 #include <qcolor.h>
 
@@ -227,6 +235,39 @@ class TerminalSession: public QAbstractItemModel, public vtbackend::Terminal::Ev
 
     void updateColorPreference(vtbackend::ColorPreference preference);
 
+    /// Releases the memory not needed for the terminal's contents right now,
+    /// as well as the cold entries of the display's caches, e.g. when running low on memory.
+    void trimMemory();
+
+    /// Resources used by a single session, telling apart the sessions sharing the one process.
+    struct ResourceUsage
+    {
+        uint64_t ptyBytesPerSecond = 0;            // of output parsed, over the last sample interval
+        double parseCpuLoad = 0;                   // CPUs busy parsing output, e.g. 0.5 for half of one
+        double renderCpuLoad = 0;                  // CPUs busy rendering
+        std::chrono::nanoseconds parseCpuTime {};  // since the session started
+        std::chrono::nanoseconds renderCpuTime {}; // since the session started
+        size_t historyBytes = 0;                   // lines of both screens, scrollback included
+        size_t imageBytes = 0;                     // decoded pixels of the images alive
+        size_t atlasBytes = 0;                     // GPU memory of the display's texture atlas
+        double atlasShare = 0;                     // of the atlas memory of all displays of the process
+    };
+
+    /// @returns the resources used by this session.
+    ///
+    /// The CPU loads are measured in between two invocations at least a second apart, and
+    /// invocations in between return the loads measured last.
+    [[nodiscard]] ResourceUsage resourceUsage();
+
+    /// Accounts for @p time of CPU time spent rendering this session, as measured by its display.
+    void addRenderCpuTime(std::chrono::nanoseconds time) noexcept
+    {
+        _renderCpuTime.fetch_add(time.count(), std::memory_order_relaxed);
+    }
+
+    /// @returns the name of the GPU memory account of the display of this session.
+    [[nodiscard]] std::string gpuMemoryAccountName() const { return fmt::format("session {}", _id); }
+
     // vtbackend::Events
     //
     void requestCaptureBuffer(vtbackend::LineCount lineCount, bool logical) override;
@@ -253,6 +294,7 @@ class TerminalSession: public QAbstractItemModel, public vtbackend::Terminal::Ev
     void playSound(vtbackend::Sequence::Parameters const& params) override;
     void requestShowHostWritableStatusLine() override;
     void cursorPositionChanged() override;
+    void scheduleInputFlush() override;
 
     bool isClosed() const noexcept { return _onClosedHandled; }
 
@@ -278,6 +320,14 @@ class TerminalSession: public QAbstractItemModel, public vtbackend::Terminal::Ev
                                vtbackend::MouseButton button,
                                vtbackend::PixelCoordinate pixelPosition);
 
+    /// Sends a single step of the mouse wheel, as if the given wheel button had been pressed.
+    ///
+    /// Mouse moves and wheel steps are applied once per event loop iteration, in the order received,
+    /// such that the many events delivered at once by high polling rate mice are processed together.
+    void sendMouseWheelEvent(vtbackend::Modifiers modifiers,
+                             vtbackend::MouseButton button,
+                             vtbackend::PixelCoordinate pixelPosition);
+
     void sendFocusInEvent();
     void sendFocusOutEvent();
 
@@ -290,6 +340,7 @@ class TerminalSession: public QAbstractItemModel, public vtbackend::Terminal::Ev
     bool operator()(actions::CreateDebugDump);
     bool operator()(actions::DecreaseFontSize);
     bool operator()(actions::DecreaseOpacity);
+    bool operator()(actions::DumpTrace);
     bool operator()(actions::FollowHyperlink);
     bool operator()(actions::FocusNextSearchMatch);
     bool operator()(actions::FocusPreviousSearchMatch);
@@ -322,6 +373,7 @@ class TerminalSession: public QAbstractItemModel, public vtbackend::Terminal::Ev
     bool operator()(actions::ToggleAllKeyMaps);
     bool operator()(actions::ToggleFullscreen);
     bool operator()(actions::ToggleInputProtection);
+    bool operator()(actions::ToggleRecording);
     bool operator()(actions::ToggleStatusLine);
     bool operator()(actions::ToggleTitleBar);
     bool operator()(actions::TraceBreakAtEmptyQueue);
@@ -390,11 +442,35 @@ class TerminalSession: public QAbstractItemModel, public vtbackend::Terminal::Ev
     void followHyperlink(vtbackend::HyperlinkInfo const& hyperlink);
     void setFontSize(text::font_size size);
     void setDefaultCursor();
-    void configureTerminal();
+    void configureTerminal(config::ProfileChanges const& changes);
+    void configureDisplay(config::ProfileChanges const& changes);
+    void applyColorPalette();
     void configureCursor(config::CursorConfig const& cursorConfig);
     uint8_t matchModeFlags() const;
     void flushInput();
+    void scheduleMouseEventsFlush();
+    void flushMouseEvents();
+
+    // Qt property notifications raised by terminal events, which may arrive from the terminal thread
+    // for nearly every line of output, and are therefore coalesced into one round per frame.
+    enum PropertyChange : uint8_t
+    {
+        HistoryLineCountChange = 0x01,
+        ScrollOffsetChange = 0x02,
+        ScrollbarVisibilityChange = 0x04,
+    };
+    void notifyPropertiesChanged(uint8_t changes);
+    void emitPropertyNotifications();
+    void applyMouseMove(PendingMouseMove const& move);
+    void continueBufferCapture();
+    void configureHistorySnapshots();
+    void saveHistorySnapshot();
     void mainLoop();
+    void setExecutionMode(vtbackend::ExecutionMode mode);
+
+    // Registers the PTY with the sessions' reactor instead of starting threads of its own, if enabled.
+    bool startOnReactor();
+    crispy::io_reactor::disposition processInputOnReactor();
 
     // private data
     //
@@ -410,6 +486,19 @@ class TerminalSession: public QAbstractItemModel, public vtbackend::Terminal::Ev
     int _accumulatedScrollX;
     int _accumulatedScrollY;
 
+    // {{{ resource accounting, see resourceUsage()
+    struct CpuTimeSample
+    {
+        std::chrono::steady_clock::time_point time;
+        std::chrono::nanoseconds parse {};
+        std::chrono::nanoseconds render {};
+    };
+    std::atomic<std::chrono::nanoseconds::rep> _renderCpuTime = 0;
+    CpuTimeSample _cpuTimeSample { .time = std::chrono::steady_clock::now() };
+    double _parseCpuLoad = 0;
+    double _renderCpuLoad = 0;
+    // }}}
+
     vtbackend::Terminal _terminal;
     bool _terminatedAndWaitingForKeyPress = false;
     display::TerminalDisplay* _display = nullptr;
@@ -420,6 +509,12 @@ class TerminalSession: public QAbstractItemModel, public vtbackend::Terminal::Ev
     std::thread::id _mainLoopThreadID {};
     std::unique_ptr<std::thread> _screenUpdateThread;
 
+    // Bytes of output parsed per turn on the reactor, before other sessions get theirs.
+    static constexpr size_t ReactorInputBudget = 256 * 1024;
+    std::shared_ptr<crispy::io_reactor> _ioReactor; // only set if served by it
+    std::optional<uint64_t> _reactorInputId;
+    std::optional<uint64_t> _reactorExitId;
+
     // state vars
     //
     vtbackend::ScreenType _currentScreenType = vtbackend::ScreenType::Primary;
@@ -427,16 +522,52 @@ class TerminalSession: public QAbstractItemModel, public vtbackend::Terminal::Ev
     bool _allowKeyMappings = true;
     Audio _audio;
     std::vector<int> _musicalNotesBuffer;
+    std::chrono::steady_clock::time_point _lastBell {};
+    static constexpr auto BellCoalescingInterval = std::chrono::milliseconds(100);
 
     vtbackend::LineCount _lastHistoryLineCount;
 
+    // Input not accepted by the PTY yet is retried to be written after this interval.
+    static constexpr auto InputFlushRetryInterval = std::chrono::milliseconds(5);
+    bool _inputFlushScheduled = false;
+
+    // Mouse moves and wheel steps received but not applied to the terminal yet, see sendMouseWheelEvent().
+    // Only the last of consecutive moves is applied, followed by the wheel steps received after it.
+    struct PendingMouseMove
+    {
+        vtbackend::Modifiers modifiers;
+        vtbackend::CellLocation position;
+        vtbackend::PixelCoordinate pixelPosition;
+    };
+    struct PendingWheelSteps
+    {
+        vtbackend::Modifiers modifiers;
+        vtbackend::MouseButton button;
+        vtbackend::PixelCoordinate pixelPosition;
+        int count = 1;
+    };
+    std::optional<PendingMouseMove> _pendingMouseMove;
+    std::vector<PendingWheelSteps> _pendingWheelSteps;
+    bool _mouseEventsFlushScheduled = false;
+    std::atomic<uint8_t> _pendingPropertyChanges = 0; // PropertyChange bits not notified about yet
+    std::chrono::steady_clock::time_point _lastPropertyNotification {};
+
     struct CaptureBufferRequest
     {
         vtbackend::LineCount lines;
         bool logical;
     };
     std::optional<CaptureBufferRequest> _pendingBufferCapture;
+
+    // The buffer capture being replied, with no more than this many bytes waiting to be written to the PTY.
+    std::optional<vtbackend::CapturedBufferEncoder> _bufferCapture;
+    static constexpr size_t BufferCaptureWatermark = 64 * 1024;
     std::optional<vtbackend::FontDef> _pendingFontChange;
+
+    // Persists the primary screen's lines while history.persist is enabled.
+    static constexpr auto HistorySnapshotInterval = std::chrono::seconds(5);
+    std::unique_ptr<vtbackend::GridSnapshotWriter> _historySnapshot;
+    std::unique_ptr<QTimer> _historySnapshotTimer;
     PermissionCache _rememberedPermissions;
     std::unique_ptr<QThread> _exitWatcherThread;
 
@@ -8,8 +8,11 @@
     #include <vtpty/SshSession.h>
 #endif
 
+#include <QtCore/QTimer>
 #include <QtQml/QQmlEngine>
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 
 using namespace std::string_literals;
@@ -20,19 +23,168 @@ using std::nullopt;
 namespace contour
 {
 
+namespace
+{
+    // Delay before spawning a shell in advance, so that it does not compete with starting up
+    // the terminal that has just been opened.
+    constexpr auto WarmShellDelay = std::chrono::milliseconds(1000);
+
+    std::string formatResourceUsage(TerminalSession::ResourceUsage const& usage)
+    {
+        return fmt::format("PTY {:.1f} KiB/s, parsing {:.0f}% CPU, rendering {:.0f}% CPU, "
+                           "history {:.1f} MiB, images {:.1f} MiB, atlas {:.0f}%",
+                           static_cast<double>(usage.ptyBytesPerSecond) / 1024.0,
+                           usage.parseCpuLoad * 100.0,
+                           usage.renderCpuLoad * 100.0,
+                           static_cast<double>(usage.historyBytes) / (1024.0 * 1024.0),
+                           static_cast<double>(usage.imageBytes) / (1024.0 * 1024.0),
+                           usage.atlasShare * 100.0);
+    }
+} // namespace
+
 TerminalSessionManager::TerminalSessionManager(ContourGuiApp& app): _app { app }, _earlyExitThreshold {}
 {
 }
 
+TerminalSessionManager::~TerminalSessionManager()
+{
+    for (auto& [profileName, shells]: _warmShells)
+        for (auto& shell: shells)
+            discardWarmShell(std::move(shell.process));
+}
+
 std::unique_ptr<vtpty::Pty> TerminalSessionManager::createPty()
 {
     auto const& profile = _app.config().profile(_app.profileName());
 
+    if (auto* playback = _app.playback())
+        if (auto pty = playback->takePty(profile->terminalSize))
+            return pty;
+
 #if defined(VTPTY_LIBSSH2)
     if (!profile->ssh.hostname.empty())
         return make_unique<vtpty::SshSession>(profile->ssh);
 #endif
-    return make_unique<vtpty::Process>(profile->shell, vtpty::createPty(profile->terminalSize, nullopt));
+    if (auto pty = adoptWarmShell(_app.profileName(), *profile))
+        return pty;
+
+    return createProcess(*profile);
+}
+
+std::unique_ptr<vtpty::Process> TerminalSessionManager::createProcess(config::TerminalProfile const& profile)
+{
+    auto const& config = _app.config();
+    return make_unique<vtpty::Process>(profile.shell,
+                                       vtpty::createPty(profile.terminalSize,
+                                                        nullopt,
+                                                        config.ptyIoUring,
+                                                        config.ptyWriteQueueSize,
+                                                        config.ptyStdoutRingSize));
+}
+
+std::unique_ptr<vtpty::Pty> TerminalSessionManager::adoptWarmShell(std::string const& profileName,
+                                                                   config::TerminalProfile const& profile)
+{
+    auto const i = _warmShells.find(profileName);
+    if (i == _warmShells.end())
+        return nullptr;
+
+    auto& shells = i->second;
+    auto const match = std::find_if(shells.begin(), shells.end(), [&](WarmShell const& shell) {
+        return shell.shell == profile.shell && shell.process->alive();
+    });
+    if (match == shells.end())
+        return nullptr;
+
+    auto process = std::move(match->process);
+    shells.erase(match);
+
+    // The shell has been waiting at the size configured back then, which may have changed since.
+    process->resizeScreen(profile.terminalSize);
+    sessionLog()("Adopting shell spawned in advance for profile '{}'.", profileName);
+    return process;
+}
+
+void TerminalSessionManager::scheduleWarmShells(std::string profileName)
+{
+#if !defined(_WIN32)
+    // Shells spawned in the background would only skew the measurements of playing back.
+    if (_app.config().warmShells == 0 || _app.playback())
+        return;
+
+    QTimer::singleShot(WarmShellDelay, this, [this, profileName = std::move(profileName)]() {
+        replenishWarmShells(profileName);
+    });
+#else
+    crispy::ignore_unused(profileName);
+#endif
+}
+
+void TerminalSessionManager::replenishWarmShells(std::string const& profileName)
+{
+    auto const* profile = _app.config().profile(profileName);
+    if (!profile || !profile->ssh.hostname.empty())
+        return;
+
+    // Replaces the shells that are out of date after a configuration change, or have exited meanwhile.
+    auto& shells = _warmShells[profileName];
+    for (auto i = shells.begin(); i != shells.end();)
+    {
+        if (i->shell == profile->shell && i->process->alive())
+        {
+            ++i;
+            continue;
+        }
+        discardWarmShell(std::move(i->process));
+        i = shells.erase(i);
+    }
+
+    if (shells.size() >= _app.config().warmShells)
+        return;
+
+    // Spawns one shell at a time, leaving some time in between for each to start up.
+    try
+    {
+        auto process = createProcess(*profile);
+        process->start();
+        shells.emplace_back(WarmShell { profile->shell, std::move(process) });
+        sessionLog()("Spawned shell in advance for profile '{}'.", profileName);
+    }
+    catch (std::exception const& e)
+    {
+        errorLog()("Could not spawn shell in advance for profile '{}'. {}", profileName, e.what());
+        return;
+    }
+
+    if (shells.size() < _app.config().warmShells)
+        scheduleWarmShells(profileName);
+}
+
+void TerminalSessionManager::discardWarmShell(std::unique_ptr<vtpty::Process> process)
+{
+    if (!process)
+        return;
+
+    // Closing the PTY hangs up the shell, which needs to exit for the process to be destroyed.
+    process->close();
+    process->terminate(vtpty::Process::TerminationHint::Hangup);
+}
+
+std::shared_ptr<crispy::io_reactor> TerminalSessionManager::ioReactor()
+{
+    auto const& config = _app.config();
+    if (!config.ptyReactor)
+        return nullptr;
+
+    if (!_ioReactor)
+    {
+        _ioReactor = crispy::io_reactor::create(config.ptyReactorThreads);
+        if (_ioReactor)
+            sessionLog()("Serving PTYs by {} reactor thread(s).", _ioReactor->threadCount());
+        else
+            sessionLog()("PTY reactor is not supported. Falling back to threads per session.");
+    }
+    return _ioReactor;
 }
 
 TerminalSession* TerminalSessionManager::createSession()
@@ -51,6 +203,9 @@ TerminalSession* TerminalSessionManager::createSession()
     // sessions. This will work around it, by explicitly claiming ownership of the object.
     QQmlEngine::setObjectOwnership(session, QQmlEngine::CppOwnership);
 
+    // Replaces the shell just adopted, or spawns the first ones in advance for the next terminals.
+    scheduleWarmShells(_app.profileName());
+
     return session;
 }
 
@@ -63,6 +218,7 @@ void TerminalSessionManager::removeSession(TerminalSession& thatSession)
     {
         _sessions.erase(i);
     }
+    _resourceUsage.erase(thatSession.id());
 
     // Notify app if all sessions have been killed to trigger app termination.
 }
@@ -73,14 +229,85 @@ void TerminalSessionManager::updateColorPreference(vtbackend::ColorPreference co
         session->updateColorPreference(preference);
 }
 
+void TerminalSessionManager::trimMemory()
+{
+    for (auto& session: _sessions)
+        session->trimMemory();
+}
+
+void TerminalSessionManager::refreshResourceUsage()
+{
+    for (auto* session: _sessions)
+        _resourceUsage[session->id()] = session->resourceUsage();
+
+    if (!_sessions.empty())
+        emit dataChanged(index(0),
+                         index(count() - 1),
+                         { PtyBytesPerSecondRole,
+                           ParseCpuLoadRole,
+                           RenderCpuLoadRole,
+                           HistoryBytesRole,
+                           ImageBytesRole,
+                           AtlasShareRole,
+                           ResourceUsageRole });
+}
+
+std::string TerminalSessionManager::resourceUsageReport()
+{
+    refreshResourceUsage();
+
+    auto report = fmt::format("{:>4}  {:<24}  {:>9}  {:>6}  {:>6}  {:>11}  {:>10}  {:>5}\n",
+                              "ID",
+                              "TITLE",
+                              "PTY KiB/s",
+                              "PARSE",
+                              "RENDER",
+                              "HISTORY MiB",
+                              "IMAGES MiB",
+                              "ATLAS");
+    for (auto const* session: _sessions)
+    {
+        auto const& usage = _resourceUsage.at(session->id());
+        auto const title = QString::fromStdString(session->terminal().windowTitle()).left(24);
+        report += fmt::format("{:>4}  {:<24}  {:>9.1f}  {:>5.0f}%  {:>5.0f}%  "
+                              "{:>11.1f}  {:>10.1f}  {:>4.0f}%\n",
+                              session->id(),
+                              title.toStdString(),
+                              static_cast<double>(usage.ptyBytesPerSecond) / 1024.0,
+                              usage.parseCpuLoad * 100.0,
+                              usage.renderCpuLoad * 100.0,
+                              static_cast<double>(usage.historyBytes) / (1024.0 * 1024.0),
+                              static_cast<double>(usage.imageBytes) / (1024.0 * 1024.0),
+                              usage.atlasShare * 100.0);
+    }
+    return report;
+}
+
 // {{{ QAbstractListModel
 QVariant TerminalSessionManager::data(const QModelIndex& index, int role) const
 {
-    crispy::ignore_unused(role);
+    if (index.row() < 0 || index.row() >= static_cast<int>(_sessions.size()))
+        return QVariant();
 
-    if (index.row() < static_cast<int>(_sessions.size()))
-        return QVariant(_sessions.at(static_cast<size_t>(index.row()))->id());
+    auto const* session = _sessions.at(static_cast<size_t>(index.row()));
+    if (role == Qt::DisplayRole)
+        return QVariant(session->id());
+    if (role == TitleRole)
+        return QVariant(QString::fromStdString(session->terminal().windowTitle()));
 
+    auto const i = _resourceUsage.find(session->id());
+    auto const usage = i != _resourceUsage.end() ? i->second : TerminalSession::ResourceUsage {};
+    switch (role)
+    {
+        case PtyBytesPerSecondRole: return QVariant(static_cast<qulonglong>(usage.ptyBytesPerSecond));
+        case ParseCpuLoadRole: return QVariant(usage.parseCpuLoad);
+        case RenderCpuLoadRole: return QVariant(usage.renderCpuLoad);
+        case HistoryBytesRole: return QVariant(static_cast<qulonglong>(usage.historyBytes));
+        case ImageBytesRole: return QVariant(static_cast<qulonglong>(usage.imageBytes));
+        case AtlasShareRole: return QVariant(usage.atlasShare);
+        case ResourceUsageRole: return QVariant(QString::fromStdString(formatResourceUsage(usage)));
+        default: break;
+    }
     return QVariant();
 }
 
@@ -90,6 +317,20 @@ int TerminalSessionManager::rowCount(const QModelIndex& parent) const
 
     return static_cast<int>(_sessions.size());
 }
+
+QHash<int, QByteArray> TerminalSessionManager::roleNames() const
+{
+    auto names = QAbstractListModel::roleNames();
+    names[TitleRole] = "title";
+    names[PtyBytesPerSecondRole] = "ptyBytesPerSecond";
+    names[ParseCpuLoadRole] = "parseCpuLoad";
+    names[RenderCpuLoadRole] = "renderCpuLoad";
+    names[HistoryBytesRole] = "historyBytes";
+    names[ImageBytesRole] = "imageBytes";
+    names[AtlasShareRole] = "atlasShare";
+    names[ResourceUsageRole] = "resourceUsage";
+    return names;
+}
 // }}}
 
 } // namespace contour
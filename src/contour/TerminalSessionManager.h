@@ -3,9 +3,17 @@
 #include <contour/TerminalSession.h>
 #include <contour/helper.h>
 
+#include <vtrasterizer/GpuMemoryBudget.h>
+#include <vtrasterizer/RenderResources.h>
+
+#include <crispy/io_reactor.h>
+
 #include <QtCore/QAbstractListModel>
 #include <QtQml/QQmlEngine>
 
+#include <map>
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace contour
@@ -23,7 +31,24 @@ class TerminalSessionManager: public QAbstractListModel
 #endif
 
   public:
+    /// Roles of the model, along with Qt::DisplayRole holding the session ID.
+    ///
+    /// The resource usage roles only change with refreshResourceUsage().
+    enum Role
+    {
+        TitleRole = Qt::UserRole + 1,
+        PtyBytesPerSecondRole,
+        ParseCpuLoadRole,
+        RenderCpuLoadRole,
+        HistoryBytesRole,
+        ImageBytesRole,
+        AtlasShareRole,
+        ResourceUsageRole, // the ones above summarized in one line of text, e.g. for the tab's tool tip
+    };
+    Q_ENUM(Role)
+
     TerminalSessionManager(ContourGuiApp& app);
+    ~TerminalSessionManager() override;
 
     Q_INVOKABLE contour::TerminalSession* createSession();
 
@@ -32,18 +57,60 @@ class TerminalSessionManager: public QAbstractListModel
     Q_INVOKABLE [[nodiscard]] QVariant data(const QModelIndex& index,
                                             int role = Qt::DisplayRole) const override;
     Q_INVOKABLE [[nodiscard]] int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    [[nodiscard]] QHash<int, QByteArray> roleNames() const override;
+
+    /// Measures the resources used by each session anew, and notifies the views showing them,
+    /// e.g. every second while a tool tip is shown.
+    Q_INVOKABLE void refreshResourceUsage();
+
+    /// @returns a table of the resources used by each session, measured anew.
+    [[nodiscard]] std::string resourceUsageReport();
 
     [[nodiscard]] int count() const noexcept { return static_cast<int>(_sessions.size()); }
+    [[nodiscard]] std::vector<TerminalSession*> const& sessions() const noexcept { return _sessions; }
 
     void updateColorPreference(vtbackend::ColorPreference const& preference);
 
+    /// Releases the memory that all sessions do not need right now, e.g. when running low on memory.
+    void trimMemory();
+
+    /// Render resources shared by the displays of all sessions, so that each session
+    /// does not load its own copy of the same fonts.
+    [[nodiscard]] vtrasterizer::RenderResourcePool& renderResources() noexcept { return _renderResources; }
+
+    /// The GPU memory budget the render targets of all displays account with.
+    [[nodiscard]] vtrasterizer::GpuMemoryBudget& gpuMemoryBudget() noexcept { return _gpuMemoryBudget; }
+
+    /// @returns the reactor serving the PTYs of all sessions, or nullptr if not enabled or not supported.
+    [[nodiscard]] std::shared_ptr<crispy::io_reactor> ioReactor();
+
   private:
     std::unique_ptr<vtpty::Pty> createPty();
+    std::unique_ptr<vtpty::Process> createProcess(config::TerminalProfile const& profile);
+
+    // Takes a shell spawned in advance for the given profile, if there is one matching its configuration.
+    std::unique_ptr<vtpty::Pty> adoptWarmShell(std::string const& profileName,
+                                               config::TerminalProfile const& profile);
+    void scheduleWarmShells(std::string profileName);
+    void replenishWarmShells(std::string const& profileName);
+    static void discardWarmShell(std::unique_ptr<vtpty::Process> process);
+
+    // A shell spawned in advance, along with the configuration it has been spawned with.
+    struct WarmShell
+    {
+        vtpty::Process::ExecInfo shell;
+        std::unique_ptr<vtpty::Process> process;
+    };
 
     ContourGuiApp& _app;
     std::chrono::seconds _earlyExitThreshold;
 
     std::vector<TerminalSession*> _sessions;
+    std::map<int, TerminalSession::ResourceUsage> _resourceUsage; // by session ID, see refreshResourceUsage()
+    vtrasterizer::RenderResourcePool _renderResources;
+    vtrasterizer::GpuMemoryBudget _gpuMemoryBudget; // outlives the render targets accounting with it
+    std::shared_ptr<crispy::io_reactor> _ioReactor; // shared with sessions outliving the manager
+    std::map<std::string, std::vector<WarmShell>> _warmShells; // by profile name
 };
 
 } // namespace contour
@@ -118,7 +118,8 @@ QImage Blur::blurGaussian(QImage imageToBlur)
     _context->makeCurrent(_surface);
     Require(_context->isValid());
 
-    if (imageToBlur != _imageToBlur)
+    // Comparing the cache keys, as comparing the images would compare every pixel.
+    if (imageToBlur.cacheKey() != _imageToBlur.cacheKey())
     {
         _iterations = 1;
         _imageToBlur = std::move(imageToBlur);
@@ -166,10 +167,14 @@ QImage Blur::blurGaussian(QImage imageToBlur)
 
 QImage Blur::blurDualKawase(QImage imageToBlur, int offset, int iterations)
 {
+    auto const inputs = KawaseInputs { imageToBlur.cacheKey(), imageToBlur.size(), offset, iterations };
+    if (inputs == _kawaseInputs)
+        return _kawaseResult;
+
     _context->makeCurrent(_surface);
 
     // Check to avoid unnecessary texture reallocation
-    if (iterations != _iterations || imageToBlur != _imageToBlur)
+    if (iterations != _iterations || imageToBlur.cacheKey() != _imageToBlur.cacheKey())
     {
         _iterations = iterations;
         _imageToBlur = std::move(imageToBlur);
@@ -220,9 +225,10 @@ QImage Blur::blurDualKawase(QImage imageToBlur, int offset, int iterations)
     glDeleteQueries(1, &gpuTimerQuery);
 #endif
 
-    auto image = _vectorFBO[0]->toImage();
+    _kawaseResult = _vectorFBO[0]->toImage();
+    _kawaseInputs = inputs;
     _context->doneCurrent();
-    return image;
+    return _kawaseResult;
 }
 
 void Blur::renderToFBO(QOpenGLFramebufferObject* targetFBO,
@@ -264,6 +270,7 @@ void Blur::initFBOTextures()
     }
 
     delete _textureToBlur;
+    _kawaseInputs.reset();
 
     _textureToBlur = new QOpenGLTexture(_imageToBlur.mirrored(), QOpenGLTexture::DontGenerateMipMaps);
     _textureToBlur->setWrapMode(QOpenGLTexture::ClampToEdge);
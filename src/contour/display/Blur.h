@@ -10,6 +10,8 @@
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QVector2D>
 
+#include <optional>
+
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
     #include <QtGui/QOpenGLExtraFunctions>
 
@@ -70,6 +72,20 @@ class Blur: protected QOpenGLExtraFunctions
     int _iterations = -1;
     QImage _imageToBlur;
 
+    // The inputs of the last dual Kawase blur, whose result is returned again for the same inputs,
+    // rather than rendering and reading it back again.
+    struct KawaseInputs
+    {
+        qint64 image; // QImage::cacheKey(), which copies of an image share until either is modified
+        QSize size;
+        int offset;
+        int iterations;
+
+        bool operator==(KawaseInputs const&) const = default;
+    };
+    std::optional<KawaseInputs> _kawaseInputs;
+    QImage _kawaseResult;
+
     // GPU timer
     GLuint64 _timerGPUElapsedTime {};
 
@@ -11,6 +11,7 @@
 #include <crispy/algorithm.h>
 #include <crispy/assert.h>
 #include <crispy/defines.h>
+#include <crispy/trace.h>
 #include <crispy/utils.h>
 
 #include <range/v3/all.hpp>
@@ -22,6 +23,7 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <cstring>
 #include <memory>
 #include <optional>
 #include <utility>
@@ -59,6 +61,10 @@ namespace ZAxisDepths
     constexpr GLfloat Text = 0.0f;
 } // namespace ZAxisDepths
 
+// Number of floats per instance of the text shader:
+// target rectangle (4), texture rectangle (4), color (4), z-axis depth and fragment selector (2).
+constexpr auto TextInstanceComponentCount = size_t { 14 };
+
 namespace
 {
     struct CRISPY_PACKED vec2 // NOLINT
@@ -230,70 +236,104 @@ atlas::AtlasBackend& OpenGLRenderer::textureScheduler()
 
 void OpenGLRenderer::initializeRectRendering()
 {
-    CHECKED_GL(glGenVertexArrays(1, &_rectVAO));
-    CHECKED_GL(glBindVertexArray(_rectVAO));
-
-    CHECKED_GL(glGenBuffers(1, &_rectVBO));
-    CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, _rectVBO));
-    CHECKED_GL(glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STREAM_DRAW));
-
     constexpr auto const BufferStride = 7 * sizeof(GLfloat);
     const auto* const VertexOffset = (void const*) (0 * sizeof(GLfloat)); // NOLINT
     const auto* const ColorOffset = (void const*) (3 * sizeof(GLfloat));  // NOLINT
 
-    // 0 (vec3): vertex buffer
-    CHECKED_GL(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, BufferStride, VertexOffset));
-    CHECKED_GL(glEnableVertexAttribArray(0));
+    for (auto& stream: _rectStreams)
+    {
+        CHECKED_GL(glGenVertexArrays(1, &stream.vao));
+        CHECKED_GL(glBindVertexArray(stream.vao));
 
-    // 1 (vec4): color buffer
-    CHECKED_GL(glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, BufferStride, ColorOffset));
-    CHECKED_GL(glEnableVertexAttribArray(1));
+        CHECKED_GL(glGenBuffers(1, &stream.vbo));
+        CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, stream.vbo));
+
+        // 0 (vec3): vertex buffer
+        CHECKED_GL(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, BufferStride, VertexOffset));
+        CHECKED_GL(glEnableVertexAttribArray(0));
+
+        // 1 (vec4): color buffer
+        CHECKED_GL(glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, BufferStride, ColorOffset));
+        CHECKED_GL(glEnableVertexAttribArray(1));
+    }
 
     CHECKED_GL(glBindVertexArray(0));
 }
 
 void OpenGLRenderer::initializeTextureRendering()
 {
-    CHECKED_GL(glGenVertexArrays(1, &_textVAO));
-    CHECKED_GL(glBindVertexArray(_textVAO));
+    for (auto& stream: _textStreams)
+        initializeTextInstanceArray(stream);
+    initializeTextInstanceArray(_retainedQuad);
 
-    constexpr auto const BufferStride = (3 + 4 + 4) * sizeof(GLfloat);
-    constexpr auto* const VertexOffset = (void const*) nullptr;
-    const auto* const TexCoordOffset = (void const*) (3 * sizeof(GLfloat)); // NOLINT
-    const auto* const ColorOffset = (void const*) (7 * sizeof(GLfloat));    // NOLINT
-
-    CHECKED_GL(glGenBuffers(1, &_textVBO));
-    CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, _textVBO));
-    CHECKED_GL(glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STREAM_DRAW));
-
-    // 0 (vec3): vertex buffer
-    CHECKED_GL(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, BufferStride, VertexOffset));
-    CHECKED_GL(glEnableVertexAttribArray(0));
-
-    // 1 (vec4): texture coordinates buffer
-    CHECKED_GL(glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, BufferStride, TexCoordOffset));
-    CHECKED_GL(glEnableVertexAttribArray(1));
-
-    // 2 (vec4): color buffer
-    CHECKED_GL(glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, BufferStride, ColorOffset));
-    CHECKED_GL(glEnableVertexAttribArray(2));
+    CHECKED_GL(glBindVertexArray(0));
+}
 
-    // setup EBO
-    // glGenBuffers(1, &_ebo);
-    // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
-    // static const GLuint indices[6] = { 0, 1, 3, 1, 2, 3 };
-    // glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+void OpenGLRenderer::initializeTextInstanceArray(StreamBuffer& stream)
+{
+    // Each tile is a single instance, whose quad is expanded from gl_VertexID by the vertex shader.
+    CHECKED_GL(glGenVertexArrays(1, &stream.vao));
+    CHECKED_GL(glBindVertexArray(stream.vao));
+
+    CHECKED_GL(glGenBuffers(1, &stream.vbo));
+    CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, stream.vbo));
+
+    // 0 (vec4): target rectangle
+    // 1 (vec4): texture rectangle
+    // 2 (vec4): color
+    // 3 (vec2): z-axis depth and fragment shader selector
+    for (GLuint attribute = 0; attribute < 4; ++attribute)
+    {
+        CHECKED_GL(glEnableVertexAttribArray(attribute));
+        CHECKED_GL(glVertexAttribDivisor(attribute, 1));
+    }
+    setTextInstanceOffset(0);
+}
 
-    // glVertexAttribDivisor(0, 1); // TODO: later for instanced rendering
+void OpenGLRenderer::setTextInstanceOffset(GLintptr offset)
+{
+    constexpr auto const BufferStride = TextInstanceComponentCount * sizeof(GLfloat);
+    auto const at = [offset](size_t component) {
+        return (void const*) (offset + static_cast<GLintptr>(component * sizeof(GLfloat))); // NOLINT
+    };
 
-    CHECKED_GL(glBindVertexArray(0));
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, BufferStride, at(0));
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, BufferStride, at(4));
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, BufferStride, at(8));
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, BufferStride, at(12));
 }
 
 OpenGLRenderer::~OpenGLRenderer()
 {
     displayLog()("~OpenGLRenderer");
-    CHECKED_GL(glDeleteVertexArrays(1, &_rectVAO));
-    CHECKED_GL(glDeleteBuffers(1, &_rectVBO));
+    for (auto const& [imageId, texture]: _imageTextures)
+        CHECKED_GL(glDeleteTextures(1, &texture.id));
+    destroyRetainedFramebuffer();
+    for (auto& readback: _screenshotReadbacks)
+    {
+        if (readback.fence)
+            CHECKED_GL(glDeleteSync(readback.fence));
+        if (readback.pbo)
+            CHECKED_GL(glDeleteBuffers(1, &readback.pbo));
+    }
+    if (_screenshotFramebuffer)
+        CHECKED_GL(glDeleteFramebuffers(1, &_screenshotFramebuffer));
+    if (_screenshotRenderbuffer)
+        CHECKED_GL(glDeleteRenderbuffers(1, &_screenshotRenderbuffer));
+    if (_uploadBuffer)
+        CHECKED_GL(glDeleteBuffers(1, &_uploadBuffer));
+    CHECKED_GL(glDeleteVertexArrays(1, &_retainedQuad.vao));
+    CHECKED_GL(glDeleteBuffers(1, &_retainedQuad.vbo));
+    for (auto* streams: { &_rectStreams, &_textStreams })
+    {
+        for (auto& stream: *streams)
+        {
+            if (stream.fence)
+                CHECKED_GL(glDeleteSync(stream.fence));
+            CHECKED_GL(glDeleteVertexArrays(1, &stream.vao));
+            CHECKED_GL(glDeleteBuffers(1, &stream.vbo));
+        }
+    }
 }
 
 void OpenGLRenderer::initialize()
@@ -306,6 +346,7 @@ void OpenGLRenderer::initialize()
     Q_ASSERT(rif->graphicsApi() == QSGRendererInterface::OpenGL);
 
     _initialized = true;
+    auto const _ = crispy::trace_scope("OpenGLRenderer.initialize");
 
     initializeOpenGLFunctions();
     CONSUME_GL_ERRORS();
@@ -411,6 +452,47 @@ void OpenGLRenderer::configureAtlas(atlas::ConfigureAtlas atlas)
     displayLog()("configureAtlas: {} {}", atlas.size, atlas.properties.format);
 }
 
+bool OpenGLRenderer::retainAtlas()
+{
+    // An atlas not yet created on the GPU holds nothing worth retaining.
+    auto const atlasBytes = _textureAtlas.textureSize.area() * 4;
+    if (!atlasBytes || _scheduledExecutions.configureAtlas)
+        return false;
+
+    // The atlas replacing this one is about as large, so retaining it must leave room for another one.
+    if (_gpuMemory && !_gpuMemory->fits(atlasBytes))
+        return false;
+
+    auto const _ = std::lock_guard { _retainedAtlasLock };
+    std::swap(_textureAtlas.textureSize, _retainedAtlas.textureSize);
+    std::swap(_textureAtlas.properties, _retainedAtlas.properties);
+    _swapAtlases = !_swapAtlases;
+    _atlasRetained = true;
+    displayLog()("retainAtlas: {}", _retainedAtlas.textureSize);
+    return true;
+}
+
+bool OpenGLRenderer::restoreAtlas()
+{
+    auto const _ = std::lock_guard { _retainedAtlasLock };
+    if (!_atlasRetained || _scheduledExecutions.configureAtlas)
+        return false;
+
+    std::swap(_textureAtlas.textureSize, _retainedAtlas.textureSize);
+    std::swap(_textureAtlas.properties, _retainedAtlas.properties);
+    _swapAtlases = !_swapAtlases;
+    displayLog()("restoreAtlas: {}", _textureAtlas.textureSize);
+    return true;
+}
+
+void OpenGLRenderer::discardRetainedAtlas()
+{
+    auto const _ = std::lock_guard { _retainedAtlasLock };
+    _atlasRetained = false;
+    _retainedAtlas.textureSize = {};
+    _retainedAtlas.properties = {};
+}
+
 void OpenGLRenderer::uploadTile(atlas::UploadTile tile)
 {
     // clang-format off
@@ -449,11 +531,6 @@ void OpenGLRenderer::renderTile(atlas::RenderTile tile)
     GLfloat const nw = tile.normalizedLocation.width;
     GLfloat const nh = tile.normalizedLocation.height;
 
-    // These two are currently not used.
-    // This used to be used for the z-plane into the 3D texture,
-    // but I've reverted back to a 2D texture atlas for now.
-    GLfloat const i = 0;
-
     // Tile dependant userdata.
     // This is current the fragment shader's selector that
     // determines how to operate on this tile (images vs gray-scale anti-aliased
@@ -467,27 +544,13 @@ void OpenGLRenderer::renderTile(atlas::RenderTile tile)
     GLfloat const ca = tile.color[3];
 
     // clang-format off
-    GLfloat const vertices[6 * 11] = {
-        // first triangle
-    // <X      Y      Z> <X        Y        I  U>  <R   G   B   A>
-        x,     y + s, z,  nx,      ny + nh, i, u,  cr, cg, cb, ca, // left top
-        x,     y,     z,  nx,      ny,      i, u,  cr, cg, cb, ca, // left bottom
-        x + r, y,     z,  nx + nw, ny,      i, u,  cr, cg, cb, ca, // right bottom
-
-        // second triangle
-        x,     y + s, z,  nx,      ny + nh, i, u,  cr, cg, cb, ca, // left top
-        x + r, y,     z,  nx + nw, ny,      i, u,  cr, cg, cb, ca, // right bottom
-        x + r, y + s, z,  nx + nw, ny + nh, i, u,  cr, cg, cb, ca, // right top
-
-        // buffer contains
-        // - 3 vertex coordinates (XYZ)
-        // - 4 texture coordinates (XYIU), I is unused currently, U selects which texture to use
-        // - 4 color values (RGBA)
+    GLfloat const instance[TextInstanceComponentCount] = {
+    // <X  Y  W  H>  <X   Y   W   H>  <R   G   B   A>  <Z  U>
+        x, y, r, s,  nx, ny, nw, nh,  cr, cg, cb, ca,  z, u,
     };
     // clang-format on
 
-    batch.renderTiles.emplace_back(tile);
-    crispy::copy(vertices, back_inserter(batch.buffer));
+    crispy::copy(instance, back_inserter(batch.buffer));
 }
 // }}}
 
@@ -514,10 +577,12 @@ struct ScopedRenderEnvironment
     GLuint savedVAO {};       // QML sets that before and uses it later, so we need to back it up, too.
     GLenum savedBlendSource {};
     GLenum savedBlendDestination {};
+    bool savedScissorTest; // Retained rendering scissors to the damaged area.
 
     ScopedRenderEnvironment(QOpenGLExtraFunctions& glIn):
         gl { glIn }, // clang-format off
-        savedBlend { gl.glIsEnabled(GL_BLEND) != GL_FALSE } // clang-format on
+        savedBlend { gl.glIsEnabled(GL_BLEND) != GL_FALSE },
+        savedScissorTest { gl.glIsEnabled(GL_SCISSOR_TEST) != GL_FALSE } // clang-format on
     {
         gl.glGetIntegerv(GL_VERTEX_ARRAY_BINDING, (GLint*) &savedVAO);
 
@@ -539,6 +604,10 @@ struct ScopedRenderEnvironment
         gl.glDepthFunc(savedDepthFunc);
         if (!savedBlend)
             gl.glDisable(GL_BLEND);
+        if (savedScissorTest)
+            gl.glEnable(GL_SCISSOR_TEST);
+        else
+            gl.glDisable(GL_SCISSOR_TEST);
 
         gl.glBindVertexArray(savedVAO);
         gl.glDepthMask(GL_TRUE);
@@ -549,14 +618,24 @@ void OpenGLRenderer::execute(std::chrono::steady_clock::time_point now)
 {
     Require(_initialized);
 
+    auto const traceSpan = crispy::trace_span("OpenGLRenderer.execute");
     auto const _ = ScopedRenderEnvironment { *this };
 
     auto const timeValue = uptime(now);
 
+    _currentStreamBuffer = (_currentStreamBuffer + 1) % StreamBufferCount;
+    ++_frameNumber;
+
+    // Model transformations cannot be applied when compositing the retained frame,
+    // so transformed items are rendered straight into the window.
+    auto const retained = _modelMatrix.isIdentity() && beginRetainedFrame();
+    if (!retained)
+        _retainedFrameValid = false;
+
     // displayLog()("execute {} rects, {} uploads, {} renders\n",
     //              _rectBuffer.size() / 7,
     //              _scheduledExecutions.uploadTiles.size(),
-    //              _scheduledExecutions.renderBatch.renderTiles.size());
+    //              _scheduledExecutions.renderBatch.buffer.size() / TextInstanceComponentCount);
 
     auto const mvp = _projectionMatrix * _viewMatrix * _modelMatrix;
 
@@ -568,21 +647,19 @@ void OpenGLRenderer::execute(std::chrono::steady_clock::time_point now)
             _rectShader->setUniformValue(_rectProjectionLocation, mvp);
             _rectShader->setUniformValue(_rectTimeLocation, timeValue);
 
-            glBindVertexArray(_rectVAO);
-            glBindBuffer(GL_ARRAY_BUFFER, _rectVBO);
-            glBufferData(GL_ARRAY_BUFFER,
-                         static_cast<GLsizeiptr>(_rectBuffer.size() * sizeof(GLfloat)),
-                         _rectBuffer.data(),
-                         GL_STREAM_DRAW);
-
+            auto& stream = _rectStreams[_currentStreamBuffer];
+            beginStream(stream, static_cast<GLsizeiptr>(_rectBuffer.size() * sizeof(GLfloat)));
+            writeStream(0, _rectBuffer);
             glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(_rectBuffer.size() / 7));
+            endStream(stream);
             glBindVertexArray(0);
         });
         _rectBuffer.clear();
     }
 
-    // potentially (re-)configure atlas
+    // potentially swap in the retained atlas, and (re-)configure atlas
     //
+    executeRetainedAtlas();
     if (_scheduledExecutions.configureAtlas)
         executeConfigureAtlas(*_scheduledExecutions.configureAtlas);
 
@@ -590,10 +667,9 @@ void OpenGLRenderer::execute(std::chrono::steady_clock::time_point now)
     //
     if (!_scheduledExecutions.uploadTiles.empty())
     {
-        _textureAtlas.gpuTexture.bind();
-        for (auto const& params: _scheduledExecutions.uploadTiles)
-            executeUploadTile(params);
-        _textureAtlas.gpuTexture.release();
+        _textureAtlas.gpuTexture->bind();
+        executeUploadTiles();
+        _textureAtlas.gpuTexture->release();
     }
 
     // render textures
@@ -602,39 +678,279 @@ void OpenGLRenderer::execute(std::chrono::steady_clock::time_point now)
         // TODO: only upload when it actually DOES change
         _textShader->setUniformValue(_textProjectionLocation, mvp);
         _textShader->setUniformValue(_textTimeLocation, timeValue);
+        executeDiscardImages();
         executeRenderTextures();
     });
 
-    if (_pendingScreenshotCallback)
+    if (retained)
+        presentRetainedFrame();
+    _damage.reset();
+
+    finishScreenshotReadbacks();
+    if (_pendingScreenshot)
+        startScreenshotReadback();
+
+    reportGpuMemoryUsage();
+}
+
+void OpenGLRenderer::reportGpuMemoryUsage()
+{
+    if (!_gpuMemory)
+        return;
+
+    auto const eviction = _gpuMemory->eviction();
+    auto usage = vtrasterizer::GpuMemoryUsage {};
+    for (auto i = _imageTextures.begin(); i != _imageTextures.end();)
     {
-        auto result = takeScreenshot();
-        _pendingScreenshotCallback.value()(result.second, result.first);
-        _pendingScreenshotCallback.reset();
+        auto const idle = i->second.lastDrawn != _frameNumber;
+        if (idle && eviction >= vtrasterizer::GpuEviction::IdleImages)
+        {
+            CHECKED_GL(glDeleteTextures(1, &i->second.id));
+            i = _imageTextures.erase(i);
+            continue;
+        }
+        usage[vtrasterizer::GpuMemoryUse::Images] += i->second.bytes;
+        if (idle)
+            usage.idleImageBytes += i->second.bytes;
+        ++i;
     }
+    {
+        auto const _ = std::lock_guard { _retainedAtlasLock };
+        if (_atlasRetained && !_swapAtlases && eviction >= vtrasterizer::GpuEviction::RetainedAtlas)
+        {
+            _atlasRetained = false;
+            _retainedAtlas.textureSize = {};
+            _retainedAtlas.properties = {};
+            _retainedAtlas.gpuTexture->destroy();
+        }
+        usage.retainedAtlasBytes = _retainedAtlas.textureSize.area() * 4;
+    }
+    usage[vtrasterizer::GpuMemoryUse::Atlas] =
+        _textureAtlas.textureSize.area() * 4 + usage.retainedAtlasBytes;
+    usage[vtrasterizer::GpuMemoryUse::Framebuffers] = _retainedSize.area() * 4;
+    _gpuMemory->report(usage);
+}
+
+bool OpenGLRenderer::createRetainedFramebuffer()
+{
+    destroyRetainedFramebuffer();
+
+    auto const width = unbox<GLsizei>(_renderTargetSize.width);
+    auto const height = unbox<GLsizei>(_renderTargetSize.height);
+
+    CHECKED_GL(glGenTextures(1, &_retainedTexture));
+    CHECKED_GL(glBindTexture(GL_TEXTURE_2D, _retainedTexture));
+    CHECKED_GL(
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    CHECKED_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    CHECKED_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    CHECKED_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    CHECKED_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    CHECKED_GL(glBindTexture(GL_TEXTURE_2D, 0));
+
+    CHECKED_GL(glGenFramebuffers(1, &_retainedFramebuffer));
+    CHECKED_GL(glBindFramebuffer(GL_FRAMEBUFFER, _retainedFramebuffer));
+    CHECKED_GL(
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _retainedTexture, 0));
+    auto const status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    CHECKED_GL(glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(_windowFramebuffer)));
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        errorLog()("Retained framebuffer incomplete (status 0x{:X}). Rendering directly into the window.",
+                   status);
+        destroyRetainedFramebuffer();
+        return false;
+    }
+
+    // The framebuffer's origin is its bottom left, hence the texture rectangle is flipped vertically.
+    auto const w = unbox<GLfloat>(_renderTargetSize.width);
+    auto const h = unbox<GLfloat>(_renderTargetSize.height);
+    auto const z = ZAxisDepths::Text;
+    auto const u = static_cast<GLfloat>(FRAGMENT_SELECTOR_IMAGE_BGRA);
+
+    // clang-format off
+    GLfloat const instance[TextInstanceComponentCount] = {
+    // <X  Y  W  H>  <X  Y  W   H>  <R  G  B  A>  <Z  U>
+        0, 0, w, h,  0, 1, 1, -1,   1, 1, 1, 1,   z, u,
+    };
+    // clang-format on
+
+    CHECKED_GL(glBindBuffer(GL_ARRAY_BUFFER, _retainedQuad.vbo));
+    CHECKED_GL(glBufferData(GL_ARRAY_BUFFER, sizeof(instance), instance, GL_STATIC_DRAW));
+
+    _retainedSize = _renderTargetSize;
+    return true;
+}
+
+void OpenGLRenderer::destroyRetainedFramebuffer()
+{
+    if (_retainedFramebuffer)
+        CHECKED_GL(glDeleteFramebuffers(1, &_retainedFramebuffer));
+    if (_retainedTexture)
+        CHECKED_GL(glDeleteTextures(1, &_retainedTexture));
+    _retainedFramebuffer = {};
+    _retainedTexture = {};
+    _retainedSize = {};
+    _retainedFrameValid = false;
+}
+
+bool OpenGLRenderer::beginRetainedFrame()
+{
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &_windowFramebuffer);
+
+    // Rendering the full frame each time is what is given up first when out of GPU memory,
+    // just before the atlas, as the glyphs are needed either way.
+    if (gpuEviction() >= vtrasterizer::GpuEviction::RetainedFrame)
+    {
+        destroyRetainedFramebuffer();
+        return false;
+    }
+
+    if (_retainedSize != _renderTargetSize)
+    {
+        auto const bytes = _renderTargetSize.area() * 4;
+        auto const releasedBytes = std::min(bytes, _retainedSize.area() * 4);
+        if (_gpuMemory && !_gpuMemory->fits(bytes - releasedBytes))
+        {
+            destroyRetainedFramebuffer();
+            return false;
+        }
+        if (!createRetainedFramebuffer())
+            return false;
+    }
+
+    CHECKED_GL(glBindFramebuffer(GL_FRAMEBUFFER, _retainedFramebuffer));
+
+    if (_damage && _retainedFrameValid)
+    {
+        // The damage is relative to the page, whereas the framebuffer's origin is the window's bottom left.
+        auto const top = static_cast<GLint>(_viewMatrix(1, 3)) + _damage->y;
+        auto const height = unbox<GLint>(_damage->height);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(0,
+                  unbox<GLint>(_renderTargetSize.height) - top - height,
+                  unbox<GLint>(_renderTargetSize.width),
+                  height);
+    }
+    else
+        glDisable(GL_SCISSOR_TEST);
+
+    std::array<GLfloat, 4> savedClearColor {};
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, savedClearColor.data());
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClearColor(savedClearColor[0], savedClearColor[1], savedClearColor[2], savedClearColor[3]);
+
+    // Accumulate the coverage in the alpha channel, too, so that the retained frame holds
+    // premultiplied colors that can be composited onto the window.
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    _retainedFrameValid = true;
+    return true;
+}
+
+void OpenGLRenderer::presentRetainedFrame()
+{
+    glDisable(GL_SCISSOR_TEST);
+    CHECKED_GL(glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(_windowFramebuffer)));
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    // The retained frame already has the view translation applied.
+    bound(*_textShader, [&]() {
+        _textShader->setUniformValue(_textProjectionLocation, _projectionMatrix);
+        glBindTexture(GL_TEXTURE_2D, _retainedTexture);
+        glBindVertexArray(_retainedQuad.vao);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, 1);
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    });
 }
 
 void OpenGLRenderer::executeRenderTextures()
 {
-    // upload vertices and render
+    // Stream the instances of all atlas tiles and images of this frame into a single buffer,
+    // with the atlas tiles rendered first in a single draw call, followed by one draw call per image.
     RenderBatch& batch = _scheduledExecutions.renderBatch;
-    if (!batch.renderTiles.empty())
+    auto instanceComponentCount = batch.buffer.size();
+    for (auto const& imageBatch: _imageBatches)
+        instanceComponentCount += imageBatch.buffer.size();
+
+    if (instanceComponentCount != 0)
     {
-        _textureAtlas.gpuTexture.bind();
-        glBindVertexArray(_textVAO);
+        auto& stream = _textStreams[_currentStreamBuffer];
+        beginStream(stream, static_cast<GLsizeiptr>(instanceComponentCount * sizeof(GLfloat)));
 
-        // upload buffer
-        glBindBuffer(GL_ARRAY_BUFFER, _textVBO);
-        glBufferData(GL_ARRAY_BUFFER,
-                     static_cast<GLsizei>(batch.buffer.size() * sizeof(GLfloat)),
-                     batch.buffer.data(),
-                     GL_STREAM_DRAW);
-        glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(batch.renderTiles.size() * 6));
+        if (!batch.buffer.empty())
+        {
+            _textureAtlas.gpuTexture->bind();
+            writeStream(0, batch.buffer);
+            setTextInstanceOffset(0);
+            glDrawArraysInstanced(
+                GL_TRIANGLES, 0, 6, static_cast<GLsizei>(batch.buffer.size() / TextInstanceComponentCount));
+            _textureAtlas.gpuTexture->release();
+        }
 
+        executeRenderImages(static_cast<GLintptr>(batch.buffer.size() * sizeof(GLfloat)));
+
+        endStream(stream);
         glBindVertexArray(0);
-        _textureAtlas.gpuTexture.release();
     }
 
     _scheduledExecutions.clear();
+    _imageBatches.clear();
+}
+
+void OpenGLRenderer::beginStream(StreamBuffer& stream, GLsizeiptr size)
+{
+    if (stream.fence)
+    {
+        // Only blocks if the GPU still reads the frame that was streamed into this buffer
+        // StreamBufferCount frames ago.
+        constexpr auto const Timeout = GLuint64 { 1'000'000'000 }; // 1 second, in nanoseconds
+        glClientWaitSync(stream.fence, GL_SYNC_FLUSH_COMMANDS_BIT, Timeout);
+        glDeleteSync(stream.fence);
+        stream.fence = {};
+    }
+
+    glBindVertexArray(stream.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.vbo);
+
+    // The buffer's storage is kept across frames and only reallocated when it needs to grow.
+    if (size > stream.capacity)
+    {
+        stream.capacity = std::max(size, 2 * stream.capacity);
+        glBufferData(GL_ARRAY_BUFFER, stream.capacity, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+void OpenGLRenderer::writeStream(GLintptr offset, std::vector<GLfloat> const& data)
+{
+    auto const size = static_cast<GLsizeiptr>(data.size() * sizeof(GLfloat));
+
+    // Writing unsynchronized is safe, as beginStream() waited for the GPU to be done with this buffer.
+    constexpr auto const Access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    if (void* target = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, Access))
+    {
+        std::memcpy(target, data.data(), static_cast<size_t>(size));
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    else
+        glBufferSubData(GL_ARRAY_BUFFER, offset, size, data.data());
+}
+
+void OpenGLRenderer::endStream(StreamBuffer& stream)
+{
+    stream.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void OpenGLRenderer::executeRetainedAtlas()
+{
+    auto const _ = std::lock_guard { _retainedAtlasLock };
+    if (std::exchange(_swapAtlases, false))
+        std::swap(_textureAtlas.gpuTexture, _retainedAtlas.gpuTexture);
+    if (!_atlasRetained && _retainedAtlas.gpuTexture->isCreated())
+        _retainedAtlas.gpuTexture->destroy();
 }
 
 void OpenGLRenderer::executeConfigureAtlas(atlas::ConfigureAtlas const& param)
@@ -647,100 +963,115 @@ void OpenGLRenderer::executeConfigureAtlas(atlas::ConfigureAtlas const& param)
     // _textureAtlas.textureSize = param.size;
     // _textureAtlas.properties = param.properties;
 
-    if (_textureAtlas.gpuTexture.isCreated())
-        _textureAtlas.gpuTexture.destroy();
+    if (_textureAtlas.gpuTexture->isCreated())
+        _textureAtlas.gpuTexture->destroy();
 
-    _textureAtlas.gpuTexture.setMipLevels(0);
-    _textureAtlas.gpuTexture.setAutoMipMapGenerationEnabled(false);
-    _textureAtlas.gpuTexture.setFormat(QOpenGLTexture::TextureFormat::RGBA8_UNorm);
-    _textureAtlas.gpuTexture.setSize(unbox<int>(param.size.width), unbox<int>(param.size.height));
-    _textureAtlas.gpuTexture.setMagnificationFilter(QOpenGLTexture::Filter::Nearest);
-    _textureAtlas.gpuTexture.setMinificationFilter(QOpenGLTexture::Filter::Nearest);
-    _textureAtlas.gpuTexture.setWrapMode(QOpenGLTexture::WrapMode::ClampToEdge);
-    _textureAtlas.gpuTexture.create();
-    Require(_textureAtlas.gpuTexture.isCreated());
+    _textureAtlas.gpuTexture->setMipLevels(0);
+    _textureAtlas.gpuTexture->setAutoMipMapGenerationEnabled(false);
+    _textureAtlas.gpuTexture->setFormat(QOpenGLTexture::TextureFormat::RGBA8_UNorm);
+    _textureAtlas.gpuTexture->setSize(unbox<int>(param.size.width), unbox<int>(param.size.height));
+    _textureAtlas.gpuTexture->setMagnificationFilter(QOpenGLTexture::Filter::Nearest);
+    _textureAtlas.gpuTexture->setMinificationFilter(QOpenGLTexture::Filter::Nearest);
+    _textureAtlas.gpuTexture->setWrapMode(QOpenGLTexture::WrapMode::ClampToEdge);
+    _textureAtlas.gpuTexture->create();
+    Require(_textureAtlas.gpuTexture->isCreated());
 
     QImage stubData(QSize(unbox<int>(param.size.width), unbox<int>(param.size.height)),
                     QImage::Format::Format_RGBA8888);
     stubData.fill(qRgba(0x00, 0xA0, 0x00, 0xC0));
-    _textureAtlas.gpuTexture.setData(stubData);
+    _textureAtlas.gpuTexture->setData(stubData);
 
     displayLog()(
         "GL configure atlas: {} {} GL texture Id {}", param.size, param.properties.format, textureAtlasId());
 }
 
-void OpenGLRenderer::executeUploadTile(atlas::UploadTile const& param)
+void OpenGLRenderer::executeUploadTiles()
 {
     Require(textureAtlasId() != 0);
 
-    // clang-format off
-    // displayLog()("-> uploadTile: tex {} location {} format {} size {}",
-    //              textureId, param.location, param.bitmapFormat, param.bitmapSize);
-    // clang-format on
+    auto& uploads = _scheduledExecutions.uploadTiles;
+    auto const tileWidth = unbox<int>(_textureAtlas.properties.tileSize.width);
+    auto const tileHeight = unbox<int>(_textureAtlas.properties.tileSize.height);
 
-    // {{{ Force RGBA as OpenGL ES cannot implicitly convert on the driver-side.
-    auto const* bitmapData = (void const*) param.bitmap.data();
-    auto bitmapConverted = atlas::Buffer();
-    switch (param.bitmapFormat)
-    {
-        case atlas::Format::Red: {
-            bitmapConverted.resize(param.bitmapSize.area() * 4);
-            bitmapData = bitmapConverted.data();
-            auto const* s = param.bitmap.data();
-            auto const* const e = param.bitmap.data() + param.bitmap.size();
-            auto* t = bitmapConverted.data();
-            while (s != e)
-            {
-                *t++ = *s++; // red
-                *t++ = 0x00; // green
-                *t++ = 0x00; // blue
-                *t++ = 0xFF; // alpha
-            }
-            break;
-        }
-        case atlas::Format::RGB: {
-            bitmapConverted.resize(param.bitmapSize.area() * 4);
-            bitmapData = bitmapConverted.data();
-            auto const* s = param.bitmap.data();
-            auto const* const e = param.bitmap.data() + param.bitmap.size();
-            auto* t = bitmapConverted.data();
-            while (s != e)
-            {
-                *t++ = *s++; // red
-                *t++ = *s++; // green
-                *t++ = *s++; // blue
-                *t++ = 0xFF; // alpha
-            }
-            break;
+    // Sort by atlas row, then column. The sort is stable, so that of multiple uploads to the same
+    // location within a frame, the latest one is written last.
+    std::stable_sort(uploads.begin(), uploads.end(), [](auto const& a, auto const& b) {
+        if (a.location.y.value != b.location.y.value)
+            return a.location.y.value < b.location.y.value;
+        return a.location.x.value < b.location.x.value;
+    });
+
+    // Tiles that are horizontally adjacent in the same atlas row form one contiguous region.
+    _uploadRegions.clear();
+    auto stagingSize = size_t { 0 };
+    for (size_t i = 0; i < uploads.size();)
+    {
+        auto region = UploadRegion { i, i + 1, uploads[i].location.x.value, uploads[i].location.y.value, 0 };
+        auto const adjacent = [&](atlas::UploadTile const& previous, atlas::UploadTile const& next) {
+            return next.location.y.value == region.y
+                   && next.location.x.value - previous.location.x.value <= tileWidth;
+        };
+        while (region.end < uploads.size() && adjacent(uploads[region.end - 1], uploads[region.end]))
+            ++region.end;
+        region.width = uploads[region.end - 1].location.x.value + tileWidth - region.x;
+        stagingSize += static_cast<size_t>(region.width * tileHeight) * 4;
+        _uploadRegions.emplace_back(region);
+        i = region.end;
+    }
+
+    // Stage all regions in a pixel buffer object, from which the driver can transfer them asynchronously.
+    if (!_uploadBuffer)
+        CHECKED_GL(glGenBuffers(1, &_uploadBuffer));
+    CHECKED_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _uploadBuffer));
+    CHECKED_GL(glBufferData(
+        GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(stagingSize), nullptr, GL_STREAM_DRAW));
+    auto* staging = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                                                           0,
+                                                           static_cast<GLsizeiptr>(stagingSize),
+                                                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (!staging)
+    {
+        errorLog()("Failed to map the atlas upload buffer. Skipping {} tile uploads.", uploads.size());
+        CHECKED_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+        return;
+    }
+
+    auto offset = size_t { 0 };
+    for (auto& region: _uploadRegions)
+    {
+        auto const pitch = static_cast<size_t>(region.width) * 4;
+        auto* target = staging + offset;
+        std::memset(target, 0, pitch * static_cast<size_t>(tileHeight));
+        for (auto i = region.begin; i < region.end; ++i)
+        {
+            auto const column = static_cast<size_t>(uploads[i].location.x.value - region.x);
+            writeTileAsRGBA(uploads[i], target + column * 4, pitch);
         }
-        case atlas::Format::RGBA:
-            // Already in expected format
-            break;
-    }
-        // }}}
-
-#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-    _textureAtlas.gpuTexture.setData(param.location.x.value,
-                                     param.location.y.value,
-                                     0, // z
-                                     unbox<int>(param.bitmapSize.width),
-                                     unbox<int>(param.bitmapSize.height),
-                                     0, // depth
-                                     QOpenGLTexture::PixelFormat::RGBA,
-                                     QOpenGLTexture::PixelType::UInt8,
-                                     bitmapData,
-                                     &_transferOptions);
-#else
-    glTexSubImage2D(GL_TEXTURE_2D,
-                    0, // level of detail
-                    param.location.x.value,
-                    param.location.y.value,
-                    unbox<GLsizei>(param.bitmapSize.width),
-                    unbox<GLsizei>(param.bitmapSize.height),
-                    GL_RGBA,          // source format
-                    GL_UNSIGNED_BYTE, // source type
-                    bitmapData);
-#endif
+        region.offset = offset;
+        offset += pitch * static_cast<size_t>(tileHeight);
+    }
+    CHECKED_GL(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+
+    for (auto const& region: _uploadRegions)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D,
+                        0, // level of detail
+                        region.x,
+                        region.y,
+                        region.width,
+                        tileHeight,
+                        GL_RGBA,                       // source format
+                        GL_UNSIGNED_BYTE,              // source type
+                        (void const*) (region.offset)); // NOLINT: offset into the upload buffer
+    }
+    CHECKED_GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
+    _uploadStats.lastTiles = uploads.size();
+    _uploadStats.lastRegions = _uploadRegions.size();
+    _uploadStats.lastBytes = stagingSize;
+    _uploadStats.totalTiles += uploads.size();
+    _uploadStats.totalRegions += _uploadRegions.size();
+    _uploadStats.totalBytes += stagingSize;
 }
 
 void OpenGLRenderer::renderRectangle(int ix, int iy, Width width, Height height, RGBAColor color)
@@ -769,6 +1100,85 @@ void OpenGLRenderer::renderRectangle(int ix, int iy, Width width, Height height,
     crispy::copy(vertices, back_inserter(_rectBuffer));
 }
 
+void OpenGLRenderer::renderImage(std::shared_ptr<vtbackend::Image const> image,
+                                 int ix,
+                                 int iy,
+                                 Width width,
+                                 Height height,
+                                 atlas::NormalizedTileLocation source)
+{
+    auto const x = static_cast<GLfloat>(ix);
+    auto const y = static_cast<GLfloat>(iy);
+    auto const z = ZAxisDepths::Text;
+    auto const r = unbox<GLfloat>(width);
+    auto const s = unbox<GLfloat>(height);
+    auto const nx = source.x;
+    auto const ny = source.y;
+    auto const nw = source.width;
+    auto const nh = source.height;
+    auto const u = static_cast<GLfloat>(FRAGMENT_SELECTOR_IMAGE_BGRA);
+
+    // clang-format off
+    GLfloat const instance[TextInstanceComponentCount] = {
+    // <X  Y  W  H>  <X   Y   W   H>  <R  G  B  A>  <Z  U>
+        x, y, r, s,  nx, ny, nw, nh,  1, 1, 1, 1,   z, u,
+    };
+    // clang-format on
+
+    // Fragments of the same image are usually rendered in sequence.
+    if (_imageBatches.empty() || _imageBatches.back().image->id() != image->id())
+        _imageBatches.emplace_back(ImageBatch { std::move(image), {} });
+
+    crispy::copy(instance, back_inserter(_imageBatches.back().buffer));
+}
+
+void OpenGLRenderer::discardImage(vtbackend::ImageId imageId)
+{
+    _discardedImages.emplace_back(imageId.value);
+}
+
+void OpenGLRenderer::executeDiscardImages()
+{
+    for (auto const imageId: _discardedImages)
+    {
+        if (auto const i = _imageTextures.find(imageId); i != _imageTextures.end())
+        {
+            CHECKED_GL(glDeleteTextures(1, &i->second.id));
+            _imageTextures.erase(i);
+        }
+    }
+    _discardedImages.clear();
+}
+
+void OpenGLRenderer::executeRenderImages(GLintptr offset)
+{
+    for (auto const& batch: _imageBatches)
+    {
+        auto const& image = *batch.image;
+        if (image.format() != vtbackend::ImageFormat::RGBA)
+            continue; // OpenGL ES cannot convert implicitly, and images are always decoded to RGBA.
+
+        auto i = _imageTextures.find(image.id().value);
+        if (i == _imageTextures.end())
+        {
+            auto const imageSize = QSize(unbox<int>(image.width()), unbox<int>(image.height()));
+            auto const textureId = createAndUploadImage(imageSize, image.format(), 1, image.data().data());
+            auto const texture = ImageTexture { .id = textureId, .bytes = image.data().size() };
+            i = _imageTextures.emplace(image.id().value, texture).first;
+        }
+        i->second.lastDrawn = _frameNumber;
+
+        glBindTexture(GL_TEXTURE_2D, i->second.id);
+        writeStream(offset, batch.buffer);
+        setTextInstanceOffset(offset);
+        glDrawArraysInstanced(
+            GL_TRIANGLES, 0, 6, static_cast<GLsizei>(batch.buffer.size() / TextInstanceComponentCount));
+        offset += static_cast<GLintptr>(batch.buffer.size() * sizeof(GLfloat));
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 optional<vtrasterizer::AtlasTextureScreenshot> OpenGLRenderer::readAtlas()
 {
     // NB: to get all atlas pages, call this from instance base id up to and including current
@@ -798,9 +1208,133 @@ optional<vtrasterizer::AtlasTextureScreenshot> OpenGLRenderer::readAtlas()
     return { std::move(output) };
 }
 
-void OpenGLRenderer::scheduleScreenshot(ScreenshotCallback callback)
+void OpenGLRenderer::scheduleScreenshot(ScreenshotCallback callback, ImageSize size)
+{
+    _pendingScreenshot = PendingScreenshot { std::move(callback), size };
+}
+
+void OpenGLRenderer::startScreenshotReadback()
+{
+    // With all readbacks in flight, the screenshot is taken from a later frame instead.
+    if (_screenshotReadbackCount == _screenshotReadbacks.size())
+        return;
+
+    auto const index = (_firstScreenshotReadback + _screenshotReadbackCount) % _screenshotReadbacks.size();
+    auto& readback = _screenshotReadbacks[index];
+
+    auto framebuffer = GLint {};
+    CHECKED_GL(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer));
+
+    auto const sourceSize = renderBufferSize();
+    auto size = _pendingScreenshot->size;
+    if (size.area() == 0)
+        size = sourceSize;
+    else if (size != sourceSize && prepareScreenshotScaler(size))
+    {
+        // Scale on the GPU, so that only the scaled pixels need to be transferred.
+        CHECKED_GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _screenshotFramebuffer));
+        CHECKED_GL(glBlitFramebuffer(0,
+                                     0,
+                                     unbox<GLint>(sourceSize.width),
+                                     unbox<GLint>(sourceSize.height),
+                                     0,
+                                     0,
+                                     unbox<GLint>(size.width),
+                                     unbox<GLint>(size.height),
+                                     GL_COLOR_BUFFER_BIT,
+                                     GL_LINEAR));
+        CHECKED_GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, _screenshotFramebuffer));
+    }
+    else
+        size = sourceSize;
+
+    // Reading into a pixel buffer object returns right away, while the GPU writes into it asynchronously.
+    auto const bytes = static_cast<GLsizeiptr>(size.area() * 4 /* RGBA */);
+    if (!readback.pbo)
+        CHECKED_GL(glGenBuffers(1, &readback.pbo));
+    CHECKED_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo));
+    CHECKED_GL(glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ));
+    CHECKED_GL(glReadPixels(
+        0, 0, unbox<GLsizei>(size.width), unbox<GLsizei>(size.height), GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    CHECKED_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    CHECKED_GL(readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    CHECKED_GL(glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(framebuffer)));
+
+    displayLog()("Reading back screenshot ({} of {}).", size, sourceSize);
+
+    readback.size = size;
+    readback.callback = std::move(_pendingScreenshot->callback);
+    _pendingScreenshot.reset();
+    ++_screenshotReadbackCount;
+}
+
+void OpenGLRenderer::finishScreenshotReadbacks()
 {
-    _pendingScreenshotCallback = std::move(callback);
+    // Readbacks are finished in the order they were started, which is the order their fences are signaled in.
+    while (_screenshotReadbackCount != 0)
+    {
+        auto& readback = _screenshotReadbacks[_firstScreenshotReadback];
+        if (glClientWaitSync(readback.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            return;
+
+        CHECKED_GL(glDeleteSync(readback.fence));
+        readback.fence = {};
+
+        auto const bytes = readback.size.area() * 4 /* RGBA */;
+        auto pixels = vector<uint8_t>();
+        CHECKED_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo));
+        if (auto const* mapped = static_cast<uint8_t const*>(
+                glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes), GL_MAP_READ_BIT)))
+        {
+            pixels.assign(mapped, mapped + bytes);
+            CHECKED_GL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+        }
+        else
+            errorLog()("Failed to map the screenshot readback buffer.");
+        CHECKED_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+        auto callback = std::move(readback.callback);
+        readback.callback = {};
+        _firstScreenshotReadback = (_firstScreenshotReadback + 1) % _screenshotReadbacks.size();
+        --_screenshotReadbackCount;
+
+        if (!pixels.empty())
+            callback(pixels, readback.size);
+    }
+}
+
+bool OpenGLRenderer::prepareScreenshotScaler(ImageSize size)
+{
+    if (_screenshotFramebuffer && _screenshotFramebufferSize == size)
+        return true;
+
+    if (!_screenshotFramebuffer)
+    {
+        CHECKED_GL(glGenFramebuffers(1, &_screenshotFramebuffer));
+        CHECKED_GL(glGenRenderbuffers(1, &_screenshotRenderbuffer));
+    }
+
+    auto framebuffer = GLint {};
+    CHECKED_GL(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer));
+    CHECKED_GL(glBindRenderbuffer(GL_RENDERBUFFER, _screenshotRenderbuffer));
+    CHECKED_GL(glRenderbufferStorage(
+        GL_RENDERBUFFER, GL_RGBA8, unbox<GLsizei>(size.width), unbox<GLsizei>(size.height)));
+    CHECKED_GL(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+    CHECKED_GL(glBindFramebuffer(GL_FRAMEBUFFER, _screenshotFramebuffer));
+    CHECKED_GL(glFramebufferRenderbuffer(
+        GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _screenshotRenderbuffer));
+    auto const status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    CHECKED_GL(glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(framebuffer)));
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        errorLog()("Screenshot framebuffer incomplete (status 0x{:X}). Taking it unscaled.", status);
+        _screenshotFramebufferSize = {};
+        return false;
+    }
+
+    _screenshotFramebufferSize = size;
+    return true;
 }
 
 pair<ImageSize, vector<uint8_t>> OpenGLRenderer::takeScreenshot()
@@ -824,8 +1358,16 @@ pair<ImageSize, vector<uint8_t>> OpenGLRenderer::takeScreenshot()
 }
 // }}}
 
-void OpenGLRenderer::inspect(std::ostream& /*output*/) const
+void OpenGLRenderer::inspect(std::ostream& output) const
 {
+    output << fmt::format("image textures: {}\n", _imageTextures.size());
+    output << fmt::format("atlas uploads: {} tiles in {} regions ({} KiB) last frame, "
+                          "{} tiles in {} regions in total\n",
+                          _uploadStats.lastTiles,
+                          _uploadStats.lastRegions,
+                          _uploadStats.lastBytes / 1024,
+                          _uploadStats.totalTiles,
+                          _uploadStats.totalRegions);
 }
 
 // {{{ background (image)
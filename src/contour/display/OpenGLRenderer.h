@@ -2,6 +2,7 @@
 #pragma once
 
 #include <contour/display/Blur.h>
+#include <contour/display/QuickRenderTarget.h>
 #include <contour/display/ShaderConfig.h>
 
 #include <vtbackend/Image.h>
@@ -26,18 +27,17 @@
 
 #include <QtQuick/QQuickWindow>
 
+#include <array>
 #include <chrono>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <unordered_map>
 
 namespace contour::display
 {
 
-class OpenGLRenderer final:
-    public vtrasterizer::RenderTarget,
-    public vtrasterizer::atlas::AtlasBackend,
-    public QOpenGLExtraFunctions
+class OpenGLRenderer final: public QuickRenderTarget, public QOpenGLExtraFunctions
 {
     using ImageSize = vtbackend::ImageSize;
 
@@ -65,27 +65,38 @@ class OpenGLRenderer final:
 
     ~OpenGLRenderer() override;
 
-    void setWindow(QQuickWindow* window) { _window = window; }
+    void setWindow(QQuickWindow* window) override { _window = window; }
 
     // AtlasBackend implementation
     [[nodiscard]] ImageSize atlasSize() const noexcept override;
     void configureAtlas(ConfigureAtlas atlas) override;
     void uploadTile(UploadTile tile) override;
     void renderTile(RenderTile tile) override;
+    [[nodiscard]] bool retainAtlas() override;
+    [[nodiscard]] bool restoreAtlas() override;
+    void discardRetainedAtlas() override;
 
     // RenderTarget implementation
     void setRenderSize(vtbackend::ImageSize targetSurfaceSize) override;
-    void setTranslation(float x, float y, float z) noexcept;
-    void setViewSize(vtbackend::ImageSize size) noexcept { _viewSize = size; }
-    void setModelMatrix(QMatrix4x4 matrix) noexcept;
+    void setTranslation(float x, float y, float z) noexcept override;
+    void setViewSize(vtbackend::ImageSize size) noexcept override { _viewSize = size; }
+    void setModelMatrix(QMatrix4x4 matrix) noexcept override;
     void setMargin(vtrasterizer::PageMargin margin) noexcept override;
     std::optional<AtlasTextureScreenshot> readAtlas() override;
     AtlasBackend& textureScheduler() override;
-    void scheduleScreenshot(ScreenshotCallback callback) override;
+    void scheduleScreenshot(ScreenshotCallback callback, ImageSize size) override;
     void renderRectangle(int x, int y, Width, Height, RGBAColor color) override;
+    void renderImage(std::shared_ptr<vtbackend::Image const> image,
+                     int x,
+                     int y,
+                     Width width,
+                     Height height,
+                     vtrasterizer::atlas::NormalizedTileLocation source) override;
+    void discardImage(vtbackend::ImageId imageId) override;
+    void setDamage(std::optional<vtrasterizer::DamagedArea> damage) override { _damage = damage; }
     void execute(std::chrono::steady_clock::time_point now) override;
 
-    std::pair<vtbackend::ImageSize, std::vector<uint8_t>> takeScreenshot();
+    std::pair<vtbackend::ImageSize, std::vector<uint8_t>> takeScreenshot() override;
 
     void clearCache() override;
 
@@ -99,10 +110,15 @@ class OpenGLRenderer final:
         return uptimeSecs;
     }
 
-    [[nodiscard]] constexpr bool initialized() const noexcept { return _initialized; }
+    [[nodiscard]] bool initialized() const noexcept override { return _initialized; }
+    [[nodiscard]] bool readbackPending() const noexcept override
+    {
+        return _pendingScreenshot || _screenshotReadbackCount != 0;
+    }
+    [[nodiscard]] uint64_t uploadedBytes() const noexcept override { return _uploadStats.totalBytes; }
 
   public slots:
-    void initialize();
+    void initialize() override;
 
   private:
     // private helper methods
@@ -121,10 +137,43 @@ class OpenGLRenderer final:
                                 int rowAlignment,
                                 uint8_t const* pixels);
 
+    // Vertex data is streamed through a ring of buffers, so that writing the vertices of a frame
+    // never has to wait for the GPU to finish reading the ones of the frames still in flight.
+    struct StreamBuffer
+    {
+        GLuint vao {};           // Vertex Array Object, covering the buffer object
+        GLuint vbo {};           // Buffer containing the streamed vertex data
+        GLsizeiptr capacity = 0; // Size in bytes of the storage allocated for vbo
+        GLsync fence {};         // Signaled once the GPU is done with the data last streamed into vbo
+    };
+    static constexpr size_t StreamBufferCount = 3;
+    using StreamBufferRing = std::array<StreamBuffer, StreamBufferCount>;
+
+    void beginStream(StreamBuffer& stream, GLsizeiptr size);
+    void writeStream(GLintptr offset, std::vector<GLfloat> const& data);
+    void endStream(StreamBuffer& stream);
+
     void executeRenderTextures();
+    void executeRetainedAtlas();
     void executeConfigureAtlas(ConfigureAtlas const& param);
-    void executeUploadTile(UploadTile const& param);
+    void executeUploadTiles();
     void executeRenderTile(RenderTile const& param);
+    void executeDiscardImages();
+    void executeRenderImages(GLintptr offset);
+    void setTextInstanceOffset(GLintptr offset);
+    void initializeTextInstanceArray(StreamBuffer& stream);
+
+    void startScreenshotReadback();
+    void finishScreenshotReadbacks();
+    bool prepareScreenshotScaler(ImageSize size);
+
+    bool createRetainedFramebuffer();
+    void destroyRetainedFramebuffer();
+    bool beginRetainedFrame();
+    void presentRetainedFrame();
+
+    // Evicts as requested by the GPU memory budget, and reports the memory used with the frame rendered.
+    void reportGpuMemoryUsage();
 
     //? void renderRectangle(int _x, int _y, int width, int height, QVector4D const& color);
 
@@ -135,15 +184,10 @@ class OpenGLRenderer final:
     // {{{ scheduling data
     struct RenderBatch
     {
-        std::vector<vtrasterizer::atlas::RenderTile> renderTiles;
-        std::vector<GLfloat> buffer;
+        std::vector<GLfloat> buffer; // per-tile instance data in the text shader's layout
         uint32_t userdata = 0;
 
-        void clear()
-        {
-            renderTiles.clear();
-            buffer.clear();
-        }
+        void clear() { buffer.clear(); }
     };
 
     struct Scheduler
@@ -163,6 +207,31 @@ class OpenGLRenderer final:
     Scheduler _scheduledExecutions;
     // }}}
 
+    // {{{ atlas uploads
+    // Horizontally adjacent tiles of an atlas row, uploaded with a single call.
+    struct UploadRegion
+    {
+        size_t begin; // index of the first upload of this region
+        size_t end;   // index past the last upload of this region
+        int x;
+        int y;
+        int width;
+        size_t offset = 0; // offset of this region's pixels into the upload buffer
+    };
+    std::vector<UploadRegion> _uploadRegions;
+    GLuint _uploadBuffer {}; // pixel buffer object staging the uploads of a frame
+
+    struct
+    {
+        size_t lastTiles = 0;
+        size_t lastRegions = 0;
+        size_t lastBytes = 0;
+        uint64_t totalTiles = 0;
+        uint64_t totalRegions = 0;
+        uint64_t totalBytes = 0;
+    } _uploadStats;
+    // }}}
+
     bool _initialized = false;
     std::chrono::steady_clock::time_point _startTime;
     vtbackend::ImageSize _viewSize;
@@ -173,6 +242,8 @@ class OpenGLRenderer final:
     QOpenGLPixelTransferOptions _transferOptions;
 
     vtrasterizer::PageMargin _margin {};
+    size_t _currentStreamBuffer = 0; // index into the stream buffer rings used by the current frame
+    uint64_t _frameNumber = 0;
 
     std::unique_ptr<QOpenGLShaderProgram> _textShader;
     int _textProjectionLocation = -1;
@@ -181,23 +252,31 @@ class OpenGLRenderer final:
 
     // private data members for rendering textures
     //
-    GLuint _textVAO {}; // Vertex Array Object, covering all buffer objects
-    GLuint _textVBO {}; // Buffer containing the vertex coordinates
+    StreamBufferRing _textStreams {}; // per-tile and per-image instance data
     // TODO: GLuint ebo_{};
 
     // index equals AtlasID
     struct AtlasAttributes
     {
-        QOpenGLTexture gpuTexture { QOpenGLTexture::Target::Target2D };
+        std::unique_ptr<QOpenGLTexture> gpuTexture =
+            std::make_unique<QOpenGLTexture>(QOpenGLTexture::Target::Target2D);
         ImageSize textureSize {};
         vtrasterizer::atlas::AtlasProperties properties {};
     };
     AtlasAttributes _textureAtlas {};
 
+    // The atlas of the fonts rendered with before, e.g. with another DPI, see retainAtlas().
+    // Its size and properties are swapped with the atlas in use right away, and its GPU texture
+    // with the next frame, as only the render thread may access the GPU.
+    AtlasAttributes _retainedAtlas {};
+    std::mutex _retainedAtlasLock;
+    bool _atlasRetained = false; // guarded by _retainedAtlasLock, as is _swapAtlases
+    bool _swapAtlases = false;   // swapping the GPU textures is pending
+
     [[nodiscard]] GLuint textureAtlasId() const noexcept
     {
-        assert(_textureAtlas.gpuTexture.textureId() != 0);
-        return _textureAtlas.gpuTexture.textureId();
+        assert(_textureAtlas.gpuTexture->textureId() != 0);
+        return _textureAtlas.gpuTexture->textureId();
     }
 
     // private data members for rendering filled rectangles
@@ -209,10 +288,63 @@ class OpenGLRenderer final:
     std::unique_ptr<QOpenGLShaderProgram> _rectShader;
     int _rectProjectionLocation = -1;
     int _rectTimeLocation = -1;
-    GLuint _rectVAO {};
-    GLuint _rectVBO {};
+    StreamBufferRing _rectStreams {};
+
+    // private data members for rendering images, each from its own texture
+    //
+    struct ImageBatch
+    {
+        std::shared_ptr<vtbackend::Image const> image; // kept alive until uploaded
+        std::vector<GLfloat> buffer;                   // instances in the text shader's layout
+    };
+    std::vector<ImageBatch> _imageBatches;
+    struct ImageTexture
+    {
+        GLuint id {};
+        size_t bytes = 0;
+        uint64_t lastDrawn = 0; // number of the frame the image was last drawn with
+    };
+    std::unordered_map<uint32_t, ImageTexture> _imageTextures; // image ID to its texture
+    std::vector<uint32_t> _discardedImages;
+
+    // private data members for retained rendering
+    //
+    // Frames are rendered into a retained framebuffer, redrawing only the damaged area,
+    // and then composited onto the window.
+    GLuint _retainedFramebuffer {};
+    GLuint _retainedTexture {};
+    ImageSize _retainedSize {};
+    bool _retainedFrameValid = false;
+    GLint _windowFramebuffer = 0;                        // framebuffer to composite the retained frame onto
+    StreamBuffer _retainedQuad {};                       // single text shader instance covering the window
+    std::optional<vtrasterizer::DamagedArea> _damage {}; // no value means everything is damaged
+
+    // private data members for screenshots
+    //
+    // Screenshots are read back asynchronously into a ring of pixel buffer objects, and handed to
+    // their callback once the GPU is done writing them into it, usually a frame or two later.
+    struct PendingScreenshot
+    {
+        ScreenshotCallback callback;
+        ImageSize size; // size to scale the screenshot to, or empty for the render buffer's size
+    };
+    std::optional<PendingScreenshot> _pendingScreenshot; // scheduled, but not read back yet
 
-    std::optional<ScreenshotCallback> _pendingScreenshotCallback;
+    struct ScreenshotReadback
+    {
+        GLuint pbo {};   // pixel buffer object the screenshot is read back into
+        GLsync fence {}; // signaled once the GPU is done writing into pbo
+        ImageSize size {};
+        ScreenshotCallback callback;
+    };
+    std::array<ScreenshotReadback, StreamBufferCount> _screenshotReadbacks {};
+    size_t _firstScreenshotReadback = 0; // index of the oldest readback in flight
+    size_t _screenshotReadbackCount = 0; // number of readbacks in flight
+
+    // Framebuffer that screenshots are scaled into, if scaled.
+    GLuint _screenshotFramebuffer {};
+    GLuint _screenshotRenderbuffer {};
+    ImageSize _screenshotFramebufferSize {};
 
     QQuickWindow* _window = nullptr;
 
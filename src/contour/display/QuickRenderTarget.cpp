@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <contour/display/QuickRenderTarget.h>
+
+#include <cstring>
+
+namespace atlas = vtrasterizer::atlas;
+
+namespace contour::display
+{
+
+void writeTileAsRGBA(atlas::UploadTile const& tile, uint8_t* target, size_t pitch)
+{
+    auto const width = unbox<size_t>(tile.bitmapSize.width);
+    auto const height = unbox<size_t>(tile.bitmapSize.height);
+    auto const componentCount = atlas::element_count(tile.bitmapFormat);
+    auto const* s = tile.bitmap.data();
+
+    for (size_t row = 0; row < height; ++row, target += pitch)
+    {
+        auto* t = target;
+        switch (tile.bitmapFormat)
+        {
+            case atlas::Format::Red:
+                for (size_t column = 0; column < width; ++column)
+                {
+                    *t++ = *s++; // red
+                    *t++ = 0x00; // green
+                    *t++ = 0x00; // blue
+                    *t++ = 0xFF; // alpha
+                }
+                break;
+            case atlas::Format::RGB:
+                for (size_t column = 0; column < width; ++column)
+                {
+                    *t++ = *s++; // red
+                    *t++ = *s++; // green
+                    *t++ = *s++; // blue
+                    *t++ = 0xFF; // alpha
+                }
+                break;
+            case atlas::Format::RGBA:
+                std::memcpy(t, s, width * componentCount);
+                s += width * componentCount;
+                break;
+        }
+    }
+}
+
+} // namespace contour::display
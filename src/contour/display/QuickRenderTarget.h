@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <vtbackend/primitives.h>
+
+#include <vtrasterizer/GpuMemoryBudget.h>
+#include <vtrasterizer/RenderTarget.h>
+#include <vtrasterizer/TextureAtlas.h>
+
+#include <QtGui/QMatrix4x4>
+#include <QtQuick/QQuickWindow>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace contour::display
+{
+
+/**
+ * Render target drawing the terminal into the scene graph of a QQuickWindow.
+ *
+ * This is what TerminalDisplay talks to, independent of the graphics API it renders with.
+ */
+class QuickRenderTarget: public vtrasterizer::RenderTarget, public vtrasterizer::atlas::AtlasBackend
+{
+  public:
+    virtual void setWindow(QQuickWindow* window) = 0;
+    virtual void setTranslation(float x, float y, float z) noexcept = 0;
+    virtual void setViewSize(vtbackend::ImageSize size) noexcept = 0;
+    virtual void setModelMatrix(QMatrix4x4 matrix) noexcept = 0;
+
+    [[nodiscard]] virtual bool initialized() const noexcept = 0;
+
+    /// Creates the graphics resources, to be called on the render thread once the window is ready.
+    virtual void initialize() = 0;
+
+    /// Tests whether the draw calls of a frame are recorded into the window's main render pass,
+    /// in which case execute() only prepares them, to be recorded by recordRenderPass().
+    ///
+    /// Otherwise, execute() draws right away, and must be called while the window's frame is rendered.
+    [[nodiscard]] virtual bool recordsIntoRenderPass() const noexcept { return false; }
+
+    /// Records the draw calls prepared by the last execute() into the window's main render pass.
+    virtual void recordRenderPass() {}
+
+    /// Tests whether a scheduled screenshot still needs more frames to be rendered to be delivered.
+    [[nodiscard]] virtual bool readbackPending() const noexcept { return false; }
+
+    virtual std::pair<vtbackend::ImageSize, std::vector<uint8_t>> takeScreenshot() = 0;
+
+    /// @returns the bytes of atlas tiles uploaded to the GPU so far, to be called on the render thread.
+    [[nodiscard]] virtual uint64_t uploadedBytes() const noexcept { return 0; }
+
+    /// Sets the account to report the GPU memory used to after each frame, and to evict as it requests.
+    void setGpuMemoryAccount(std::unique_ptr<vtrasterizer::GpuMemoryBudget::Account> account) noexcept
+    {
+        _gpuMemory = std::move(account);
+    }
+
+  protected:
+    [[nodiscard]] vtrasterizer::GpuEviction gpuEviction() const noexcept
+    {
+        return _gpuMemory ? _gpuMemory->eviction() : vtrasterizer::GpuEviction::None;
+    }
+
+    std::unique_ptr<vtrasterizer::GpuMemoryBudget::Account> _gpuMemory; // may be null
+};
+
+/// Writes the given tile's bitmap as RGBA with rows @p pitch bytes apart, as the atlas texture is RGBA,
+/// and not all graphics APIs (such as OpenGL ES) can convert implicitly on the driver-side.
+void writeTileAsRGBA(vtrasterizer::atlas::UploadTile const& tile, uint8_t* target, size_t pitch);
+
+} // namespace contour::display
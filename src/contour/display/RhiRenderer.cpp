@@ -0,0 +1,723 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <contour/display/RhiRenderer.h>
+#include <contour/helper.h>
+
+#include <vtrasterizer/TextureAtlas.h>
+
+#include <crispy/algorithm.h>
+#include <crispy/assert.h>
+#include <crispy/trace.h>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtGui/QImage>
+
+#include <rhi/qshader.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <utility>
+
+using std::array;
+using std::pair;
+using std::vector;
+
+using vtbackend::Height;
+using vtbackend::ImageSize;
+using vtbackend::RGBAColor;
+using vtbackend::Width;
+
+namespace chrono = std::chrono;
+namespace atlas = vtrasterizer::atlas;
+
+namespace contour::display
+{
+
+namespace
+{
+    // Number of floats per instance of the text shader:
+    // target rectangle (4), texture rectangle (4), color (4), z-axis depth and fragment selector (2).
+    constexpr auto TextInstanceComponentCount = size_t { 14 };
+
+    // Number of floats per vertex of the background shader: position (3) and color (4).
+    constexpr auto RectVertexComponentCount = size_t { 7 };
+
+    // Sizes of the std140 uniform blocks declared in shaders/rhi/*.glsl.
+    constexpr auto TextUniformsSize = quint32 { 80 }; // mat4 vs_projection, float pixel_x, float u_time
+    constexpr auto RectUniformsSize = quint32 { 80 }; // mat4 u_projection, float u_time
+    constexpr auto ProjectionSize = quint32 { 64 };
+
+    QShader loadShader(QString const& name)
+    {
+        QFile file(":/contour/display/shaders/rhi/" + name + ".qsb");
+        file.open(QFile::ReadOnly);
+        Require(file.isOpen());
+        auto shader = QShader::fromSerialized(file.readAll());
+        Require(shader.isValid());
+        return shader;
+    }
+
+    QRhiGraphicsPipeline::TargetBlend alphaBlending()
+    {
+        // The same as OpenGLRenderer's blending:
+        // glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE)
+        auto blend = QRhiGraphicsPipeline::TargetBlend {};
+        blend.enable = true;
+        blend.srcColor = QRhiGraphicsPipeline::SrcAlpha;
+        blend.dstColor = QRhiGraphicsPipeline::OneMinusSrcAlpha;
+        blend.srcAlpha = QRhiGraphicsPipeline::One;
+        blend.dstAlpha = QRhiGraphicsPipeline::One;
+        return blend;
+    }
+
+    QMatrix4x4 ortho(float left, float right, float bottom, float top)
+    {
+        constexpr float NearPlane = -1.0f;
+        constexpr float FarPlane = 1.0f;
+
+        QMatrix4x4 mat;
+        mat.ortho(left, right, bottom, top, NearPlane, FarPlane);
+        return mat;
+    }
+
+    template <typename T>
+    quint32 byteSize(vector<T> const& data) noexcept
+    {
+        return static_cast<quint32>(data.size() * sizeof(T));
+    }
+} // namespace
+
+RhiRenderer::RhiRenderer(vtbackend::ImageSize viewSize,
+                         vtbackend::ImageSize targetSurfaceSize,
+                         vtrasterizer::PageMargin margin):
+    _startTime { chrono::steady_clock::now() }, _viewSize { viewSize }, _margin { margin }
+{
+    setRenderSize(targetSurfaceSize);
+}
+
+RhiRenderer::~RhiRenderer()
+{
+    displayLog()("~RhiRenderer");
+}
+
+void RhiRenderer::setRenderSize(vtbackend::ImageSize targetSurfaceSize)
+{
+    if (_renderTargetSize == targetSurfaceSize)
+        return;
+
+    _renderTargetSize = targetSurfaceSize;
+    _projectionMatrix = ortho(/* left */ 0.0f,
+                              /* right */ unbox<float>(_renderTargetSize.width),
+                              /* bottom */ unbox<float>(_renderTargetSize.height),
+                              /* top */ 0.0f);
+
+    displayLog()("Setting render target size to {}.", _renderTargetSize);
+}
+
+void RhiRenderer::setTranslation(float x, float y, float z) noexcept
+{
+    _viewMatrix.setToIdentity();
+    _viewMatrix.translate(x, y, z);
+}
+
+void RhiRenderer::initialize()
+{
+    if (_initialized)
+        return;
+
+    Q_ASSERT(_window != nullptr);
+    _rhi = _window->rhi();
+    Require(_rhi != nullptr);
+    Require(_window->swapChain() != nullptr);
+
+    _initialized = true;
+    auto const _ = crispy::trace_scope("RhiRenderer.initialize");
+
+    _sampler.reset(_rhi->newSampler(QRhiSampler::Nearest,
+                                    QRhiSampler::Nearest,
+                                    QRhiSampler::None,
+                                    QRhiSampler::ClampToEdge,
+                                    QRhiSampler::ClampToEdge));
+    _sampler->create();
+
+    initializeRectRendering();
+    initializeTextRendering();
+
+    displayLog()("[FYI] QRhi backend        : {}", _rhi->backendName());
+    displayLog()("[FYI] QRhi device         : {}", _rhi->driverInfo().deviceName.toStdString());
+    displayLog()("[FYI] Widget size         : {} ({})", _renderTargetSize, _viewSize);
+}
+
+void RhiRenderer::initializeRectRendering()
+{
+    auto* swapChain = _window->swapChain();
+
+    _rectUniforms.reset(_rhi->newBuffer(QRhiBuffer::Dynamic, QRhiBuffer::UniformBuffer, RectUniformsSize));
+    _rectUniforms->create();
+
+    _rectResources.reset(_rhi->newShaderResourceBindings());
+    _rectResources->setBindings({ QRhiShaderResourceBinding::uniformBuffer(
+        0,
+        QRhiShaderResourceBinding::VertexStage | QRhiShaderResourceBinding::FragmentStage,
+        _rectUniforms.get()) });
+    _rectResources->create();
+
+    auto inputLayout = QRhiVertexInputLayout {};
+    inputLayout.setBindings({ QRhiVertexInputBinding(RectVertexComponentCount * sizeof(float)) });
+    inputLayout.setAttributes({
+        QRhiVertexInputAttribute(0, 0, QRhiVertexInputAttribute::Float3, 0),                 // vs_vertex
+        QRhiVertexInputAttribute(0, 1, QRhiVertexInputAttribute::Float4, 3 * sizeof(float)), // vs_colors
+    });
+
+    _rectPipeline.reset(_rhi->newGraphicsPipeline());
+    _rectPipeline->setShaderStages({
+        QRhiShaderStage(QRhiShaderStage::Vertex, loadShader("background.vert")),
+        QRhiShaderStage(QRhiShaderStage::Fragment, loadShader("background.frag")),
+    });
+    _rectPipeline->setTargetBlends({ alphaBlending() });
+    _rectPipeline->setVertexInputLayout(inputLayout);
+    _rectPipeline->setShaderResourceBindings(_rectResources.get());
+    _rectPipeline->setSampleCount(swapChain->sampleCount());
+    _rectPipeline->setRenderPassDescriptor(swapChain->renderPassDescriptor());
+    if (!_rectPipeline->create())
+    {
+        errorLog()("Failed to create the QRhi pipeline for rendering rectangles.");
+        _rectPipeline.reset();
+    }
+}
+
+void RhiRenderer::initializeTextRendering()
+{
+    auto* swapChain = _window->swapChain();
+
+    _textUniforms.reset(_rhi->newBuffer(QRhiBuffer::Dynamic, QRhiBuffer::UniformBuffer, TextUniformsSize));
+    _textUniforms->create();
+
+    // The atlas texture is only known once the atlas is configured, and bound in place of this one by then.
+    // The images' resources are layout-compatible with these, and thus rendered with the same pipeline.
+    _placeholderTexture.reset(_rhi->newTexture(QRhiTexture::RGBA8, QSize(1, 1)));
+    _placeholderTexture->create();
+    _textResources.reset(_rhi->newShaderResourceBindings());
+    bindTextResources(*_textResources, *_placeholderTexture);
+
+    // One instance per tile, of two triangles each, whose corners the vertex shader computes.
+    auto inputLayout = QRhiVertexInputLayout {};
+    inputLayout.setBindings({ QRhiVertexInputBinding(TextInstanceComponentCount * sizeof(float),
+                                                     QRhiVertexInputBinding::PerInstance) });
+    inputLayout.setAttributes({
+        QRhiVertexInputAttribute(0, 0, QRhiVertexInputAttribute::Float4, 0),                  // vs_rect
+        QRhiVertexInputAttribute(0, 1, QRhiVertexInputAttribute::Float4, 4 * sizeof(float)),  // vs_texRect
+        QRhiVertexInputAttribute(0, 2, QRhiVertexInputAttribute::Float4, 8 * sizeof(float)),  // vs_colors
+        QRhiVertexInputAttribute(0, 3, QRhiVertexInputAttribute::Float2, 12 * sizeof(float)), // vs_userdata
+    });
+
+    _textPipeline.reset(_rhi->newGraphicsPipeline());
+    _textPipeline->setShaderStages({
+        QRhiShaderStage(QRhiShaderStage::Vertex, loadShader("text.vert")),
+        QRhiShaderStage(QRhiShaderStage::Fragment, loadShader("text.frag")),
+    });
+    _textPipeline->setTargetBlends({ alphaBlending() });
+    _textPipeline->setVertexInputLayout(inputLayout);
+    _textPipeline->setShaderResourceBindings(_textResources.get());
+    _textPipeline->setSampleCount(swapChain->sampleCount());
+    _textPipeline->setRenderPassDescriptor(swapChain->renderPassDescriptor());
+    if (!_textPipeline->create())
+    {
+        errorLog()("Failed to create the QRhi pipeline for rendering textures.");
+        _textPipeline.reset();
+    }
+}
+
+void RhiRenderer::bindTextResources(QRhiShaderResourceBindings& resources, QRhiTexture& texture)
+{
+    resources.setBindings({
+        QRhiShaderResourceBinding::uniformBuffer(
+            0,
+            QRhiShaderResourceBinding::VertexStage | QRhiShaderResourceBinding::FragmentStage,
+            _textUniforms.get()),
+        QRhiShaderResourceBinding::sampledTexture(
+            1, QRhiShaderResourceBinding::FragmentStage, &texture, _sampler.get()),
+    });
+    resources.create();
+}
+
+// {{{ AtlasBackend impl
+void RhiRenderer::configureAtlas(atlas::ConfigureAtlas atlas)
+{
+    _scheduledConfigureAtlas.emplace(atlas);
+    _textureAtlas.textureSize = atlas.size;
+    _textureAtlas.properties = atlas.properties;
+
+    displayLog()("configureAtlas: {} {}", atlas.size, atlas.properties.format);
+}
+
+bool RhiRenderer::retainAtlas()
+{
+    // An atlas not yet created on the GPU holds nothing worth retaining.
+    auto const atlasBytes = _textureAtlas.textureSize.area() * 4;
+    if (!atlasBytes || _scheduledConfigureAtlas)
+        return false;
+
+    // The atlas replacing this one is about as large, so retaining it must leave room for another one.
+    if (_gpuMemory && !_gpuMemory->fits(atlasBytes))
+        return false;
+
+    auto const _ = std::lock_guard { _retainedAtlasLock };
+    std::swap(_textureAtlas.textureSize, _retainedAtlas.textureSize);
+    std::swap(_textureAtlas.properties, _retainedAtlas.properties);
+    _swapAtlases = !_swapAtlases;
+    _atlasRetained = true;
+    displayLog()("retainAtlas: {}", _retainedAtlas.textureSize);
+    return true;
+}
+
+bool RhiRenderer::restoreAtlas()
+{
+    auto const _ = std::lock_guard { _retainedAtlasLock };
+    if (!_atlasRetained || _scheduledConfigureAtlas)
+        return false;
+
+    std::swap(_textureAtlas.textureSize, _retainedAtlas.textureSize);
+    std::swap(_textureAtlas.properties, _retainedAtlas.properties);
+    _swapAtlases = !_swapAtlases;
+    displayLog()("restoreAtlas: {}", _textureAtlas.textureSize);
+    return true;
+}
+
+void RhiRenderer::discardRetainedAtlas()
+{
+    auto const _ = std::lock_guard { _retainedAtlasLock };
+    _atlasRetained = false;
+    _retainedAtlas.textureSize = {};
+    _retainedAtlas.properties = {};
+}
+
+void RhiRenderer::uploadTile(atlas::UploadTile tile)
+{
+    if (tile.bitmapSize.width > _textureAtlas.properties.tileSize.width
+        || tile.bitmapSize.height > _textureAtlas.properties.tileSize.height)
+        errorLog()("uploadTile: bitmap size {} exceeds tile size {}.",
+                   tile.bitmapSize,
+                   _textureAtlas.properties.tileSize);
+
+    _scheduledUploads.emplace_back(std::move(tile));
+}
+
+void RhiRenderer::renderTile(atlas::RenderTile tile)
+{
+    auto const x = static_cast<float>(tile.x.value);
+    auto const y = static_cast<float>(tile.y.value);
+    // tile bitmap size on target render surface, defaulting to the bitmap's size
+    auto const targetSize = ImageSize {
+        unbox(tile.targetSize.width) ? tile.targetSize.width : tile.bitmapSize.width,
+        unbox(tile.targetSize.height) ? tile.targetSize.height : tile.bitmapSize.height,
+    };
+    auto const r = unbox<float>(targetSize.width);
+    auto const s = unbox<float>(targetSize.height);
+    auto const z = 0.0f;
+
+    // normalized TexCoords
+    auto const nx = tile.normalizedLocation.x;
+    auto const ny = tile.normalizedLocation.y;
+    auto const nw = tile.normalizedLocation.width;
+    auto const nh = tile.normalizedLocation.height;
+
+    // the fragment shader's selector, determining how to render this tile
+    auto const u = static_cast<float>(tile.fragmentShaderSelector);
+
+    auto const [cr, cg, cb, ca] = tile.color;
+
+    // clang-format off
+    float const instance[TextInstanceComponentCount] = {
+    // <X  Y  W  H>  <X   Y   W   H>  <R   G   B   A>  <Z  U>
+        x, y, r, s,  nx, ny, nw, nh,  cr, cg, cb, ca,  z, u,
+    };
+    // clang-format on
+
+    crispy::copy(instance, back_inserter(_tileInstances));
+}
+// }}}
+
+// {{{ RenderTarget impl
+void RhiRenderer::renderRectangle(int ix, int iy, Width width, Height height, RGBAColor color)
+{
+    auto const x = static_cast<float>(ix);
+    auto const y = static_cast<float>(iy);
+    auto const z = 0.0f;
+    auto const r = unbox<float>(width);
+    auto const s = unbox<float>(height);
+    auto const [cr, cg, cb, ca] = atlas::normalize(color);
+
+    // clang-format off
+    float const vertices[6 * RectVertexComponentCount] = {
+        // first triangle
+        x,     y + s, z, cr, cg, cb, ca,
+        x,     y,     z, cr, cg, cb, ca,
+        x + r, y,     z, cr, cg, cb, ca,
+
+        // second triangle
+        x,     y + s, z, cr, cg, cb, ca,
+        x + r, y,     z, cr, cg, cb, ca,
+        x + r, y + s, z, cr, cg, cb, ca
+    };
+    // clang-format on
+
+    crispy::copy(vertices, back_inserter(_rectVertices));
+}
+
+void RhiRenderer::renderImage(std::shared_ptr<vtbackend::Image const> image,
+                              int ix,
+                              int iy,
+                              Width width,
+                              Height height,
+                              atlas::NormalizedTileLocation source)
+{
+    auto const x = static_cast<float>(ix);
+    auto const y = static_cast<float>(iy);
+    auto const z = 0.0f;
+    auto const r = unbox<float>(width);
+    auto const s = unbox<float>(height);
+    auto const nx = source.x;
+    auto const ny = source.y;
+    auto const nw = source.width;
+    auto const nh = source.height;
+    auto const u = static_cast<float>(FRAGMENT_SELECTOR_IMAGE_BGRA);
+
+    // clang-format off
+    float const instance[TextInstanceComponentCount] = {
+    // <X  Y  W  H>  <X   Y   W   H>  <R  G  B  A>  <Z  U>
+        x, y, r, s,  nx, ny, nw, nh,  1, 1, 1, 1,   z, u,
+    };
+    // clang-format on
+
+    // Fragments of the same image are usually rendered in sequence.
+    if (_imageBatches.empty() || _imageBatches.back().image->id() != image->id())
+        _imageBatches.emplace_back(ImageBatch { std::move(image), {} });
+
+    crispy::copy(instance, back_inserter(_imageBatches.back().buffer));
+}
+
+void RhiRenderer::discardImage(vtbackend::ImageId imageId)
+{
+    _discardedImages.emplace_back(imageId.value);
+}
+
+void RhiRenderer::scheduleScreenshot(ScreenshotCallback /*callback*/, ImageSize /*size*/)
+{
+    errorLog()("Screenshots are not supported by the QRhi renderer.");
+}
+
+pair<ImageSize, vector<uint8_t>> RhiRenderer::takeScreenshot()
+{
+    errorLog()("Screenshots are not supported by the QRhi renderer.");
+    return {};
+}
+
+void RhiRenderer::execute(chrono::steady_clock::time_point now)
+{
+    Require(_initialized);
+
+    auto const traceSpan = crispy::trace_span("RhiRenderer.execute");
+
+    // Resources can only be updated outside of a render pass, so this prepares the draw calls
+    // of this frame, and recordRenderPass() records them once the window's main render pass is begun.
+    _drawCalls.clear();
+    ++_frameNumber;
+    auto* updates = _rhi->nextResourceUpdateBatch();
+
+    // The clip space correction makes up for the graphics APIs' differing Y directions and depth ranges.
+    auto const mvp = _rhi->clipSpaceCorrMatrix() * _projectionMatrix * _viewMatrix * _modelMatrix;
+    auto const timeValue =
+        static_cast<float>(chrono::duration_cast<chrono::milliseconds>(now - _startTime).count()) / 1000.0f;
+    auto const atlasWidth = unbox<float>(_textureAtlas.textureSize.width);
+    auto const textParameters = array<float, 2> { atlasWidth != 0.0f ? 1.0f / atlasWidth : 0.0f, timeValue };
+
+    updates->updateDynamicBuffer(_rectUniforms.get(), 0, ProjectionSize, mvp.constData());
+    updates->updateDynamicBuffer(_rectUniforms.get(), ProjectionSize, sizeof(float), &timeValue);
+    updates->updateDynamicBuffer(_textUniforms.get(), 0, ProjectionSize, mvp.constData());
+    updates->updateDynamicBuffer(
+        _textUniforms.get(), ProjectionSize, sizeof(textParameters), textParameters.data());
+
+    executeRenderRectangles(*updates);
+
+    executeRetainedAtlas();
+    if (_scheduledConfigureAtlas)
+    {
+        executeConfigureAtlas(*updates, *_scheduledConfigureAtlas);
+        _scheduledConfigureAtlas.reset();
+    }
+
+    if (!_scheduledUploads.empty())
+        executeUploadTiles(*updates);
+
+    executeDiscardImages();
+    executeRenderTextures(*updates);
+
+    _window->swapChain()->currentFrameCommandBuffer()->resourceUpdate(updates);
+
+    reportGpuMemoryUsage();
+}
+
+void RhiRenderer::reportGpuMemoryUsage()
+{
+    if (!_gpuMemory)
+        return;
+
+    // Released textures are deferred by QRhi until the frames still using them are done.
+    auto const eviction = _gpuMemory->eviction();
+    auto usage = vtrasterizer::GpuMemoryUsage {};
+    for (auto i = _imageTextures.begin(); i != _imageTextures.end();)
+    {
+        auto const idle = i->second.lastDrawn != _frameNumber;
+        if (idle && eviction >= vtrasterizer::GpuEviction::IdleImages)
+        {
+            i = _imageTextures.erase(i);
+            continue;
+        }
+        usage[vtrasterizer::GpuMemoryUse::Images] += i->second.bytes;
+        if (idle)
+            usage.idleImageBytes += i->second.bytes;
+        ++i;
+    }
+    {
+        auto const _ = std::lock_guard { _retainedAtlasLock };
+        if (_atlasRetained && !_swapAtlases && eviction >= vtrasterizer::GpuEviction::RetainedAtlas)
+        {
+            _atlasRetained = false;
+            _retainedAtlas.textureSize = {};
+            _retainedAtlas.properties = {};
+            _retainedAtlas.gpuTexture.reset();
+        }
+        usage.retainedAtlasBytes = _retainedAtlas.textureSize.area() * 4;
+    }
+    usage[vtrasterizer::GpuMemoryUse::Atlas] =
+        _textureAtlas.textureSize.area() * 4 + usage.retainedAtlasBytes;
+    _gpuMemory->report(usage);
+}
+
+void RhiRenderer::recordRenderPass()
+{
+    if (_drawCalls.empty())
+        return;
+
+    auto* swapChain = _window->swapChain();
+    auto* commands = swapChain->currentFrameCommandBuffer();
+    auto const outputSize = swapChain->currentPixelSize();
+    auto const viewport =
+        QRhiViewport(0, 0, static_cast<float>(outputSize.width()), static_cast<float>(outputSize.height()));
+
+    for (auto const& drawCall: _drawCalls)
+    {
+        commands->setGraphicsPipeline(drawCall.pipeline);
+        commands->setViewport(viewport);
+        commands->setShaderResources(drawCall.resources);
+        auto const input = QRhiCommandBuffer::VertexInput { drawCall.vertices, drawCall.offset };
+        commands->setVertexInput(0, 1, &input);
+        commands->draw(drawCall.vertexCount, drawCall.instanceCount);
+    }
+    _drawCalls.clear();
+}
+
+void RhiRenderer::reserveVertexBuffer(std::unique_ptr<QRhiBuffer>& buffer, size_t size)
+{
+    if (buffer && buffer->size() >= size)
+        return;
+
+    // Grow geometrically, so that the buffer is not recreated on every frame drawing a little more.
+    auto const capacity = static_cast<quint32>(std::max(size, buffer ? 2 * size_t { buffer->size() } : size));
+    buffer.reset(_rhi->newBuffer(QRhiBuffer::Dynamic, QRhiBuffer::VertexBuffer, capacity));
+    if (!buffer->create())
+        errorLog()("Failed to create a QRhi vertex buffer of {} bytes.", capacity);
+}
+
+void RhiRenderer::executeRenderRectangles(QRhiResourceUpdateBatch& updates)
+{
+    if (_rectVertices.empty() || !_rectPipeline)
+    {
+        _rectVertices.clear();
+        return;
+    }
+
+    reserveVertexBuffer(_rectBuffer, byteSize(_rectVertices));
+    updates.updateDynamicBuffer(_rectBuffer.get(), 0, byteSize(_rectVertices), _rectVertices.data());
+    _drawCalls.emplace_back(DrawCall {
+        _rectPipeline.get(),
+        _rectResources.get(),
+        _rectBuffer.get(),
+        0,
+        static_cast<quint32>(_rectVertices.size() / RectVertexComponentCount),
+    });
+    _rectVertices.clear();
+}
+
+void RhiRenderer::executeRetainedAtlas()
+{
+    auto const _ = std::lock_guard { _retainedAtlasLock };
+    if (std::exchange(_swapAtlases, false))
+    {
+        std::swap(_textureAtlas.gpuTexture, _retainedAtlas.gpuTexture);
+        bindTextResources(*_textResources,
+                          _textureAtlas.gpuTexture ? *_textureAtlas.gpuTexture : *_placeholderTexture);
+    }
+    if (!_atlasRetained)
+        _retainedAtlas.gpuTexture.reset();
+}
+
+void RhiRenderer::executeConfigureAtlas(QRhiResourceUpdateBatch& updates, atlas::ConfigureAtlas const& param)
+{
+    Require(param.properties.format == atlas::Format::RGBA);
+
+    auto const size = QSize(unbox<int>(param.size.width), unbox<int>(param.size.height));
+    _textureAtlas.gpuTexture.reset(_rhi->newTexture(QRhiTexture::RGBA8, size));
+    Require(_textureAtlas.gpuTexture->create());
+
+    QImage stubData(size, QImage::Format::Format_RGBA8888);
+    stubData.fill(qRgba(0x00, 0xA0, 0x00, 0xC0));
+    updates.uploadTexture(_textureAtlas.gpuTexture.get(), stubData);
+
+    bindTextResources(*_textResources, *_textureAtlas.gpuTexture);
+
+    displayLog()("QRhi configure atlas: {} {}", param.size, param.properties.format);
+}
+
+void RhiRenderer::executeUploadTiles(QRhiResourceUpdateBatch& updates)
+{
+    if (!_textureAtlas.gpuTexture)
+    {
+        errorLog()("Skipping {} tile uploads to the unconfigured texture atlas.", _scheduledUploads.size());
+        _scheduledUploads.clear();
+        return;
+    }
+
+    // Tiles are uploaded in full, so that whatever was in the tile before is cleared.
+    auto const atlasWidth = unbox<int>(_textureAtlas.textureSize.width);
+    auto const atlasHeight = unbox<int>(_textureAtlas.textureSize.height);
+    auto const tileWidth = unbox<int>(_textureAtlas.properties.tileSize.width);
+    auto const tileHeight = unbox<int>(_textureAtlas.properties.tileSize.height);
+
+    // All uploads of this frame are copied into staging memory by QRhi, and transferred to the
+    // texture in one go once the resource updates are committed.
+    auto entries = vector<QRhiTextureUploadEntry> {};
+    entries.reserve(_scheduledUploads.size());
+    auto bytes = size_t { 0 };
+    for (auto const& tile: _scheduledUploads)
+    {
+        auto const x = tile.location.x.value;
+        auto const y = tile.location.y.value;
+        auto const bitmapWidth = unbox<int>(tile.bitmapSize.width);
+        auto const bitmapHeight = unbox<int>(tile.bitmapSize.height);
+        auto const width = std::min(std::max(tileWidth, bitmapWidth), atlasWidth - x);
+        auto const height = std::min(std::max(tileHeight, bitmapHeight), atlasHeight - y);
+        if (width <= 0 || height <= 0)
+            continue;
+
+        auto const pitch = static_cast<size_t>(width) * 4;
+        auto pixels = QByteArray(static_cast<qsizetype>(pitch * static_cast<size_t>(height)), '\0');
+        if (bitmapWidth <= width && bitmapHeight <= height)
+            writeTileAsRGBA(tile, reinterpret_cast<uint8_t*>(pixels.data()), pitch);
+        bytes += static_cast<size_t>(pixels.size());
+
+        auto description = QRhiTextureSubresourceUploadDescription(pixels);
+        description.setDestinationTopLeft(QPoint(x, y));
+        description.setSourceSize(QSize(width, height));
+        entries.emplace_back(0, 0, description);
+    }
+
+    if (!entries.empty())
+    {
+        auto upload = QRhiTextureUploadDescription {};
+        upload.setEntries(entries.data(), entries.data() + entries.size());
+        updates.uploadTexture(_textureAtlas.gpuTexture.get(), upload);
+    }
+
+    _uploadStats.lastTiles = _scheduledUploads.size();
+    _uploadStats.lastBytes = bytes;
+    _uploadStats.totalTiles += _scheduledUploads.size();
+    _uploadStats.totalBytes += bytes;
+    _scheduledUploads.clear();
+}
+
+void RhiRenderer::executeDiscardImages()
+{
+    for (auto const imageId: _discardedImages)
+        _imageTextures.erase(imageId);
+    _discardedImages.clear();
+}
+
+void RhiRenderer::executeRenderTextures(QRhiResourceUpdateBatch& updates)
+{
+    // Stream the instances of all atlas tiles and images of this frame into a single buffer,
+    // with the atlas tiles rendered first in a single draw call, followed by one draw call per image.
+    auto instanceBytes = byteSize(_tileInstances);
+    for (auto const& imageBatch: _imageBatches)
+        instanceBytes += byteSize(imageBatch.buffer);
+
+    if (instanceBytes != 0 && _textPipeline)
+    {
+        reserveVertexBuffer(_textBuffer, instanceBytes);
+
+        auto offset = quint32 { 0 };
+        auto const addDrawCall = [&](QRhiShaderResourceBindings* resources, vector<float> const& instances) {
+            updates.updateDynamicBuffer(_textBuffer.get(), offset, byteSize(instances), instances.data());
+            _drawCalls.emplace_back(DrawCall {
+                _textPipeline.get(),
+                resources,
+                _textBuffer.get(),
+                offset,
+                6,
+                static_cast<quint32>(instances.size() / TextInstanceComponentCount),
+            });
+            offset += byteSize(instances);
+        };
+
+        if (!_tileInstances.empty() && _textureAtlas.gpuTexture)
+            addDrawCall(_textResources.get(), _tileInstances);
+
+        for (auto const& batch: _imageBatches)
+        {
+            auto const& image = *batch.image;
+            if (image.format() != vtbackend::ImageFormat::RGBA)
+                continue; // Images are always decoded to RGBA.
+
+            auto i = _imageTextures.find(image.id().value);
+            if (i == _imageTextures.end())
+            {
+                auto const imageSize = QSize(unbox<int>(image.width()), unbox<int>(image.height()));
+                auto imageTexture = ImageTexture {};
+                imageTexture.texture.reset(_rhi->newTexture(QRhiTexture::RGBA8, imageSize));
+                if (!imageTexture.texture->create())
+                    continue;
+                auto const pixels = QByteArray(reinterpret_cast<char const*>(image.data().data()),
+                                               static_cast<qsizetype>(image.data().size()));
+                updates.uploadTexture(imageTexture.texture.get(),
+                                      QRhiTextureUploadDescription(QRhiTextureUploadEntry(
+                                          0, 0, QRhiTextureSubresourceUploadDescription(pixels))));
+
+                imageTexture.resources.reset(_rhi->newShaderResourceBindings());
+                bindTextResources(*imageTexture.resources, *imageTexture.texture);
+                imageTexture.bytes = image.data().size();
+                i = _imageTextures.emplace(image.id().value, std::move(imageTexture)).first;
+            }
+
+            i->second.lastDrawn = _frameNumber;
+            addDrawCall(i->second.resources.get(), batch.buffer);
+        }
+    }
+
+    _tileInstances.clear();
+    _imageBatches.clear();
+}
+// }}}
+
+void RhiRenderer::inspect(std::ostream& output) const
+{
+    output << fmt::format("QRhi backend: {}\n", _rhi ? _rhi->backendName() : "(uninitialized)");
+    output << fmt::format("image textures: {}\n", _imageTextures.size());
+    output << fmt::format("atlas uploads: {} tiles ({} KiB) last frame, {} tiles in total\n",
+                          _uploadStats.lastTiles,
+                          _uploadStats.lastBytes / 1024,
+                          _uploadStats.totalTiles);
+}
+
+} // namespace contour::display
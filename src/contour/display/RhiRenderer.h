@@ -0,0 +1,209 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <contour/display/QuickRenderTarget.h>
+
+#include <vtbackend/Image.h>
+#include <vtbackend/primitives.h>
+
+#include <vtrasterizer/RenderTarget.h>
+#include <vtrasterizer/TextureAtlas.h>
+
+#include <QtGui/QMatrix4x4>
+#include <QtQuick/QQuickWindow>
+
+#include <rhi/qrhi.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace contour::display
+{
+
+/**
+ * Render target drawing through the QRhi of the Qt Quick scene graph, and thus natively via Vulkan,
+ * Metal, or Direct3D, whichever the window renders with.
+ *
+ * It renders the same way as OpenGLRenderer does, using the same shaders: filled rectangles first,
+ * followed by all atlas tiles in a single instanced draw call, and one instanced draw call per image.
+ * The draw calls are recorded into the window's main render pass, on top of the scene.
+ *
+ * Unlike OpenGLRenderer, every frame is redrawn in full, custom shaders are not supported,
+ * and neither screenshots nor the atlas texture can be read back.
+ */
+class RhiRenderer final: public QuickRenderTarget
+{
+    using ImageSize = vtbackend::ImageSize;
+
+    using AtlasTextureScreenshot = vtrasterizer::AtlasTextureScreenshot;
+
+    using ConfigureAtlas = vtrasterizer::atlas::ConfigureAtlas;
+    using UploadTile = vtrasterizer::atlas::UploadTile;
+    using RenderTile = vtrasterizer::atlas::RenderTile;
+
+  public:
+    RhiRenderer(vtbackend::ImageSize viewSize,
+                vtbackend::ImageSize targetSurfaceSize,
+                vtrasterizer::PageMargin margin);
+
+    ~RhiRenderer() override;
+
+    void setWindow(QQuickWindow* window) override { _window = window; }
+
+    // AtlasBackend implementation
+    [[nodiscard]] ImageSize atlasSize() const noexcept override { return _textureAtlas.textureSize; }
+    void configureAtlas(ConfigureAtlas atlas) override;
+    void uploadTile(UploadTile tile) override;
+    void renderTile(RenderTile tile) override;
+    [[nodiscard]] bool retainAtlas() override;
+    [[nodiscard]] bool restoreAtlas() override;
+    void discardRetainedAtlas() override;
+
+    // RenderTarget implementation
+    void setRenderSize(vtbackend::ImageSize targetSurfaceSize) override;
+    void setTranslation(float x, float y, float z) noexcept override;
+    void setViewSize(vtbackend::ImageSize size) noexcept override { _viewSize = size; }
+    void setModelMatrix(QMatrix4x4 matrix) noexcept override { _modelMatrix = matrix; }
+    void setMargin(vtrasterizer::PageMargin margin) noexcept override { _margin = margin; }
+    std::optional<AtlasTextureScreenshot> readAtlas() override { return std::nullopt; }
+    AtlasBackend& textureScheduler() override { return *this; }
+    void scheduleScreenshot(ScreenshotCallback callback, ImageSize size) override;
+    void renderRectangle(int x, int y, Width, Height, RGBAColor color) override;
+    void renderImage(std::shared_ptr<vtbackend::Image const> image,
+                     int x,
+                     int y,
+                     Width width,
+                     Height height,
+                     vtrasterizer::atlas::NormalizedTileLocation source) override;
+    void discardImage(vtbackend::ImageId imageId) override;
+    void setDamage(std::optional<vtrasterizer::DamagedArea> /*damage*/) override {}
+    void execute(std::chrono::steady_clock::time_point now) override;
+
+    std::pair<vtbackend::ImageSize, std::vector<uint8_t>> takeScreenshot() override;
+
+    void clearCache() override {}
+
+    void inspect(std::ostream& output) const override;
+
+    [[nodiscard]] bool initialized() const noexcept override { return _initialized; }
+    void initialize() override;
+
+    [[nodiscard]] bool recordsIntoRenderPass() const noexcept override { return true; }
+    void recordRenderPass() override;
+
+    [[nodiscard]] uint64_t uploadedBytes() const noexcept override { return _uploadStats.totalBytes; }
+
+  private:
+    void initializeTextRendering();
+    void initializeRectRendering();
+
+    // Binds the uniforms and the given texture, as the text shader expects them.
+    void bindTextResources(QRhiShaderResourceBindings& resources, QRhiTexture& texture);
+
+    void executeRetainedAtlas();
+    void executeConfigureAtlas(QRhiResourceUpdateBatch& updates, ConfigureAtlas const& param);
+    void executeUploadTiles(QRhiResourceUpdateBatch& updates);
+    void executeDiscardImages();
+    void executeRenderRectangles(QRhiResourceUpdateBatch& updates);
+    void executeRenderTextures(QRhiResourceUpdateBatch& updates);
+
+    // Grows the given dynamic vertex buffer to hold at least the given number of bytes.
+    void reserveVertexBuffer(std::unique_ptr<QRhiBuffer>& buffer, size_t size);
+
+    // Evicts as requested by the GPU memory budget, and reports the memory used with the frame prepared.
+    void reportGpuMemoryUsage();
+
+    // A draw call prepared by execute(), to be recorded into the render pass.
+    struct DrawCall
+    {
+        QRhiGraphicsPipeline* pipeline = nullptr;
+        QRhiShaderResourceBindings* resources = nullptr;
+        QRhiBuffer* vertices = nullptr;
+        quint32 offset = 0; // offset into vertices, in bytes
+        quint32 vertexCount = 0;
+        quint32 instanceCount = 1;
+    };
+
+    bool _initialized = false;
+    QQuickWindow* _window = nullptr;
+    QRhi* _rhi = nullptr;
+    std::chrono::steady_clock::time_point _startTime;
+    vtbackend::ImageSize _viewSize;
+    vtbackend::ImageSize _renderTargetSize;
+    vtrasterizer::PageMargin _margin {};
+    QMatrix4x4 _projectionMatrix;
+    QMatrix4x4 _viewMatrix;
+    QMatrix4x4 _modelMatrix;
+    uint64_t _frameNumber = 0;
+
+    // scheduled by the renderer, and executed by the next execute()
+    std::optional<ConfigureAtlas> _scheduledConfigureAtlas;
+    std::vector<UploadTile> _scheduledUploads;
+    std::vector<float> _tileInstances; // per-tile instance data in the text shader's layout
+    std::vector<float> _rectVertices;  // triangles in the background shader's layout
+
+    struct ImageBatch
+    {
+        std::shared_ptr<vtbackend::Image const> image; // kept alive until uploaded
+        std::vector<float> buffer;                     // instances in the text shader's layout
+    };
+    std::vector<ImageBatch> _imageBatches;
+    std::vector<uint32_t> _discardedImages;
+
+    std::vector<DrawCall> _drawCalls;
+
+    std::unique_ptr<QRhiSampler> _sampler;
+
+    // filled rectangles
+    std::unique_ptr<QRhiBuffer> _rectUniforms;
+    std::unique_ptr<QRhiBuffer> _rectBuffer;
+    std::unique_ptr<QRhiShaderResourceBindings> _rectResources;
+    std::unique_ptr<QRhiGraphicsPipeline> _rectPipeline;
+
+    // atlas tiles and images
+    std::unique_ptr<QRhiBuffer> _textUniforms;
+    std::unique_ptr<QRhiBuffer> _textBuffer;
+    std::unique_ptr<QRhiShaderResourceBindings> _textResources; // binding the atlas texture
+    std::unique_ptr<QRhiTexture> _placeholderTexture;           // bound until the atlas is configured
+    std::unique_ptr<QRhiGraphicsPipeline> _textPipeline;
+
+    struct AtlasAttributes
+    {
+        std::unique_ptr<QRhiTexture> gpuTexture;
+        ImageSize textureSize {};
+        vtrasterizer::atlas::AtlasProperties properties {};
+    };
+    AtlasAttributes _textureAtlas {};
+
+    // The atlas of the fonts rendered with before, e.g. with another DPI, see retainAtlas().
+    // Its size and properties are swapped with the atlas in use right away, and its GPU texture
+    // with the next frame, as only the render thread may access the GPU.
+    AtlasAttributes _retainedAtlas {};
+    std::mutex _retainedAtlasLock;
+    bool _atlasRetained = false; // guarded by _retainedAtlasLock, as is _swapAtlases
+    bool _swapAtlases = false;   // swapping the GPU textures is pending
+
+    // Images are rendered each from its own texture, with the same pipeline as the atlas tiles.
+    struct ImageTexture
+    {
+        std::unique_ptr<QRhiTexture> texture;
+        std::unique_ptr<QRhiShaderResourceBindings> resources;
+        size_t bytes = 0;
+        uint64_t lastDrawn = 0; // number of the frame the image was last drawn with
+    };
+    std::unordered_map<uint32_t, ImageTexture> _imageTextures; // image ID to its texture
+
+    struct
+    {
+        size_t lastTiles = 0;
+        size_t lastBytes = 0;
+        uint64_t totalTiles = 0;
+        uint64_t totalBytes = 0;
+    } _uploadStats;
+};
+
+} // namespace contour::display
@@ -4,6 +4,9 @@
 #include <contour/ContourGuiApp.h>
 #include <contour/display/OpenGLRenderer.h>
 #include <contour/display/TerminalDisplay.h>
+#if defined(CONTOUR_RHI_RENDERER)
+    #include <contour/display/RhiRenderer.h>
+#endif
 #include <contour/helper.h>
 
 #include <vtbackend/Color.h>
@@ -12,7 +15,10 @@
 #include <vtpty/Pty.h>
 
 #include <crispy/App.h>
+#include <crispy/cpu_time.h>
 #include <crispy/logstore.h>
+#include <crispy/thread_qos.h>
+#include <crispy/trace.h>
 #include <crispy/utils.h>
 
 #include <fmt/chrono.h>
@@ -26,6 +32,7 @@
 #include <QtCore/QProcess>
 #include <QtCore/QRunnable>
 #include <QtCore/QStandardPaths>
+#include <QtCore/QThread>
 #include <QtCore/QTimer>
 #include <QtGui/QClipboard>
 #include <QtGui/QDesktopServices>
@@ -39,6 +46,7 @@
 
 #include <filesystem>
 #include <fstream>
+#include <mutex>
 #include <string_view>
 #include <tuple>
 #include <vector>
@@ -86,6 +94,9 @@ using actions::Action;
 // {{{ helper
 namespace
 {
+    // Interval at which the size changes of an interactive window resize are applied at most.
+    constexpr auto ResizeThrottleInterval = std::chrono::milliseconds(50);
+
 #if !defined(NDEBUG) && defined(GL_DEBUG_OUTPUT) && defined(CONTOUR_DEBUG_OPENGL)
     void glMessageCallback(GLenum _source,
                            GLenum _type,
@@ -206,6 +217,21 @@ namespace
         cerr << unhandledExceptionMessage(where, e) << endl;
     }
 
+    // Applies the scheduling class configured for rendering to the render thread, unless already applied.
+    // The render thread may be shared by the displays of several windows, which then share the last one.
+    void applyRenderThreadQos(crispy::thread_qos qos)
+    {
+        static thread_local auto applied = std::optional<crispy::thread_qos> {};
+        if (applied == qos)
+            return;
+
+        applied = qos;
+        auto const actual = crispy::set_current_thread_qos(qos);
+        displayLog()("Scheduling render thread as {} (requested {}).",
+                     actual ? crispy::to_string(*actual) : "unsupported",
+                     crispy::to_string(qos));
+    }
+
     // Returns the config file containing the user-configured DPI setting for KDE desktops.
     [[maybe_unused]] std::optional<fs::path> kcmFontsFilePath()
     {
@@ -228,6 +254,7 @@ TerminalDisplay::TerminalDisplay(QQuickItem* parent):
     _startTime { steady_clock::time_point::min() },
     _lastFontDPI { fontDPI() },
     _updateTimer(this),
+    _resizeTimer(this),
     _filesystemWatcher(this),
     _mediaPlayer(this)
 {
@@ -254,6 +281,10 @@ TerminalDisplay::TerminalDisplay(QQuickItem* parent):
 
     _updateTimer.setSingleShot(true);
     connect(&_updateTimer, &QTimer::timeout, this, &TerminalDisplay::scheduleRedraw, Qt::QueuedConnection);
+
+    _resizeTimer.setSingleShot(true);
+    _resizeTimer.setInterval(ResizeThrottleInterval);
+    connect(&_resizeTimer, &QTimer::timeout, this, &TerminalDisplay::applySizeChange);
 }
 
 TerminalDisplay::~TerminalDisplay()
@@ -294,15 +325,25 @@ void TerminalDisplay::setSession(TerminalSession* newSession)
     _renderer =
         make_unique<vtrasterizer::Renderer>(newSession->profile().terminalSize,
                                             sanitizeFontDescription(profile().fonts, fontDPI()),
+                                            newSession->app().sessionsManager().renderResources(),
                                             _session->terminal().colorPalette(),
                                             newSession->config().textureAtlasHashtableSlots,
                                             newSession->config().textureAtlasTileCount,
+                                            newSession->config().textureAtlasMemory * 1024 * 1024,
                                             newSession->config().textureAtlasDirectMapping,
                                             newSession->profile().hyperlinkDecoration.normal,
                                             newSession->profile().hyperlinkDecoration.hover
                                             // TODO: , WindowMargin(windowMargin_.left, windowMargin_.bottom);
         );
 
+    _renderer->setAsyncGlyphs(newSession->config().asyncGlyphs, [this]() {
+        post([this]() {
+            if (window())
+                window()->update();
+        });
+    });
+    _renderer->setPrewarmedCodepoints(newSession->config().prewarmedCodepoints);
+
     applyFontDPI();
     updateImplicitSize();
     updateMinimumSize();
@@ -321,6 +362,19 @@ vtbackend::PageSize TerminalDisplay::windowSize() const noexcept
 }
 
 void TerminalDisplay::sizeChanged()
+{
+    if (!_session || !_renderTarget)
+        return;
+
+    // Dragging a window edge changes the size many times a second, each of which would reflow the grid
+    // and let the application redraw upon SIGWINCH. Only the most recent size is applied once the timer
+    // fires, i.e. at a throttled cadence while dragging, and once more soon after the drag has settled.
+    // Until then, the last frame keeps being drawn at its previous size.
+    if (!_resizeTimer.isActive())
+        _resizeTimer.start();
+}
+
+void TerminalDisplay::applySizeChange()
 {
     if (!_session || !_renderTarget)
         return;
@@ -360,6 +414,10 @@ void TerminalDisplay::handleWindowChanged(QQuickWindow* newWindow)
 
         connect(this, &QQuickItem::widthChanged, this, &TerminalDisplay::sizeChanged, Qt::DirectConnection);
         connect(this, &QQuickItem::heightChanged, this, &TerminalDisplay::sizeChanged, Qt::DirectConnection);
+
+        connect(newWindow, &QWindow::visibilityChanged, this, &TerminalDisplay::onVisibilityChanged);
+        connect(this, &QQuickItem::visibleChanged, this, &TerminalDisplay::onVisibilityChanged);
+        onVisibilityChanged();
     }
     else
         displayLog()("Detaching widget {} from window.", (void*) this);
@@ -368,7 +426,7 @@ void TerminalDisplay::handleWindowChanged(QQuickWindow* newWindow)
 class CleanupJob: public QRunnable
 {
   public:
-    explicit CleanupJob(OpenGLRenderer* renderer): _renderer { renderer } {}
+    explicit CleanupJob(QuickRenderTarget* renderer): _renderer { renderer } {}
 
     void run() override
     {
@@ -377,7 +435,7 @@ class CleanupJob: public QRunnable
     }
 
   private:
-    OpenGLRenderer* _renderer;
+    QuickRenderTarget* _renderer;
 };
 
 void TerminalDisplay::releaseResources()
@@ -401,6 +459,33 @@ void TerminalDisplay::onRefreshRateChanged()
     _session->terminal().setRefreshRate(rate);
 }
 
+bool TerminalDisplay::visibleToUser() const noexcept
+{
+    if (!isVisible() || !window())
+        return false;
+
+    auto const visibility = window()->visibility();
+    return visibility != QWindow::Hidden && visibility != QWindow::Minimized;
+}
+
+void TerminalDisplay::onVisibilityChanged()
+{
+    if (!_session)
+        return;
+
+    // Hidden sessions keep processing their output, but skip everything needed for displaying it only.
+    auto const hidden = !visibleToUser();
+    if (hidden == _session->terminal().detached())
+        return;
+
+    _session->terminal().setDetached(hidden);
+
+    // Neither is anything needed for display until then, such as the lines' cell buffers kept for
+    // updating them quickly, so that a minimized window holds on to less memory than the visible ones.
+    if (hidden)
+        _session->trimMemory();
+}
+
 void TerminalDisplay::configureScreenHooks()
 {
     Require(window());
@@ -579,14 +664,24 @@ void TerminalDisplay::createRenderer()
                      windowSize.height());
     }
 
-    _renderTarget = new OpenGLRenderer(
-        _session->profile().textShader.value_or(builtinShaderConfig(ShaderClass::Text)),
-        _session->profile().backgroundShader.value_or(builtinShaderConfig(ShaderClass::Background)),
-        precalculatedViewSize,
-        precalculatedTargetSize,
-        textureTileSize,
-        viewportMargin);
+#if defined(CONTOUR_RHI_RENDERER)
+    // Windows rendering natively via Vulkan, Metal, or Direct3D are drawn into through their QRhi.
+    if (auto const api = window()->rendererInterface()->graphicsApi();
+        api != QSGRendererInterface::OpenGL && QSGRendererInterface::isApiRhiBased(api))
+        _renderTarget = new RhiRenderer(precalculatedViewSize, precalculatedTargetSize, viewportMargin);
+#endif
+    if (!_renderTarget)
+        _renderTarget = new OpenGLRenderer(
+            _session->profile().textShader.value_or(builtinShaderConfig(ShaderClass::Text)),
+            _session->profile().backgroundShader.value_or(builtinShaderConfig(ShaderClass::Background)),
+            precalculatedViewSize,
+            precalculatedTargetSize,
+            textureTileSize,
+            viewportMargin);
     _renderTarget->setWindow(window());
+    auto& gpuMemoryBudget = _session->app().sessionsManager().gpuMemoryBudget();
+    gpuMemoryBudget.setLimit(_session->config().gpuMemoryBudget * 1024 * 1024);
+    _renderTarget->setGpuMemoryAccount(gpuMemoryBudget.open(_session->gpuMemoryAccountName()));
     _renderer->setRenderTarget(*_renderTarget);
 
     connect(window(),
@@ -607,6 +702,19 @@ void TerminalDisplay::createRenderer()
             &TerminalDisplay::onAfterRendering,
             Qt::DirectConnection);
 
+    if (_renderTarget->recordsIntoRenderPass())
+        connect(window(),
+                &QQuickWindow::afterRenderPassRecording,
+                this,
+                &TerminalDisplay::onAfterRenderPassRecording,
+                Qt::DirectConnection);
+
+    connect(window(),
+            &QQuickWindow::frameSwapped,
+            this,
+            &TerminalDisplay::onFrameSwapped,
+            Qt::DirectConnection);
+
     configureScreenHooks();
     watchKdeDpiSetting();
 
@@ -644,11 +752,21 @@ QMatrix4x4 TerminalDisplay::createModelMatrix() const
 
 void TerminalDisplay::onBeforeRendering()
 {
-    if (_renderTarget->initialized())
-        return;
+    if (!_renderTarget->initialized())
+    {
+        logDisplayInfo();
+        _renderTarget->initialize();
+    }
 
-    logDisplayInfo();
-    _renderTarget->initialize();
+    // Render targets recording into the render pass must have updated their resources before the pass begins.
+    if (_renderTarget->recordsIntoRenderPass())
+        paint();
+}
+
+void TerminalDisplay::onAfterRenderPassRecording()
+{
+    if (_renderTarget)
+        _renderTarget->recordRenderPass();
 }
 
 void TerminalDisplay::paint()
@@ -665,8 +783,14 @@ void TerminalDisplay::paint()
     try
     {
 #if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-        window()->beginExternalCommands();
-        auto const _ = gsl::finally([this]() { window()->endExternalCommands(); });
+        // Commands recorded via QRhi do not count as external ones.
+        auto const external = !_renderTarget->recordsIntoRenderPass();
+        if (external)
+            window()->beginExternalCommands();
+        auto const _ = gsl::finally([this, external]() {
+            if (external)
+                window()->endExternalCommands();
+        });
 #endif
 
         [[maybe_unused]] auto const lastState = _state.fetchAndClear();
@@ -686,8 +810,29 @@ void TerminalDisplay::paint()
         }
 #endif
 
-        terminal().tick(steady_clock::now());
-        _renderer->render(terminal(), _renderingPressure);
+        auto const renderStart = steady_clock::now();
+        _renderingOnGuiThread.store(QThread::currentThread() == thread(), std::memory_order_relaxed);
+        applyRenderThreadQos(_session->profile().threadPriority.render);
+        auto const renderCpuStart = crispy::current_thread_cpu_time();
+        terminal().tick(renderStart);
+        _renderer->render(terminal(), terminal().flooded());
+        auto const renderEnd = steady_clock::now();
+        _renderTimings.record(renderEnd - renderStart);
+        if (auto* playback = _session->app().playback()) [[unlikely]]
+            playback->frameRendered(
+                renderStart, renderEnd, _renderTarget->uploadedBytes(), terminal().refreshInterval().value);
+        _session->addRenderCpuTime(crispy::current_thread_cpu_time() - renderCpuStart);
+        {
+            auto const _ = std::lock_guard { _renderCacheStatsMutex };
+            _renderCacheStats = _renderer->cacheStats();
+        }
+
+        // The startup trace is complete once the first frame has been rendered.
+        static auto firstFrame = std::once_flag {};
+        std::call_once(firstFrame, []() {
+            crispy::trace_recorder::global().recordInstant("first frame");
+            (void) crispy::trace_recorder::global().write();
+        });
         if (_doDumpState)
         {
             doDumpStateInternal();
@@ -714,11 +859,18 @@ void TerminalDisplay::onAfterRendering()
     // This method is called after the QML scene has been rendered.
     // We use this to schedule the next rendering frame, if needed.
     // This signal is emitted from the scene graph rendering thread
-    paint();
+    if (!_renderTarget || !_renderTarget->recordsIntoRenderPass())
+        paint();
+
+    // Screenshots are read back asynchronously, and only delivered by the frames rendered after them.
+    if (_renderTarget && _renderTarget->readbackPending() && window())
+        window()->update();
 
     if (!_state.finish())
     {
-        if (window())
+        if (auto const delay = terminal().frameThrottleDelay(); delay > chrono::milliseconds(0))
+            post([this, delay]() { _updateTimer.start(delay); });
+        else if (window())
             window()->update();
     }
 
@@ -740,6 +892,14 @@ void TerminalDisplay::onAfterRendering()
         post([this, timeout]() { _updateTimer.start(timeout); });
     }
 }
+
+void TerminalDisplay::onFrameSwapped()
+{
+    // This signal is emitted from the scene graph rendering thread, right after the swap,
+    // which with vertical synchronization returns at the vertical blank.
+    if (_session)
+        terminal().vsyncPresented(steady_clock::now());
+}
 // }}}
 
 // {{{ Qt Display Input Event handling & forwarding
@@ -1033,10 +1193,10 @@ vtbackend::FontDef TerminalDisplay::getFontDef()
     return getFontDefinition(*_renderer);
 }
 
-void TerminalDisplay::copyToClipboard(std::string_view data)
+void TerminalDisplay::copyToClipboard(QString const& text)
 {
     if (QClipboard* clipboard = QGuiApplication::clipboard(); clipboard != nullptr)
-        clipboard->setText(QString::fromUtf8(data.data(), static_cast<int>(data.size())));
+        clipboard->setText(text);
 }
 
 void TerminalDisplay::inspect()
@@ -1099,6 +1259,50 @@ void TerminalDisplay::doDumpStateInternal()
             auto os = std::stringstream {};
             terminal().currentScreen().inspect("Screen state dump.", os);
             _renderer->inspect(os);
+            if (auto const latency = terminal().inputLatency(); latency.has_value())
+                os << fmt::format("Input latency: {}\n", *latency);
+            else
+                os << "Input latency: not measured yet\n";
+            auto const inputWrites = terminal().inputWriteStats();
+            os << fmt::format("Input: {} events in {} writes ({} bytes), {:.1f} events/s, {:.1f} writes/s\n",
+                              inputWrites.events,
+                              inputWrites.writes,
+                              inputWrites.bytes,
+                              inputWrites.eventsPerSecond,
+                              inputWrites.writesPerSecond);
+            os << fmt::format("Output: {}{}\n",
+                              terminal().floodStats(),
+                              terminal().flooded() ? " (flooded)" : "");
+            os << fmt::format("PTY buffers: {}\n", terminal().ptyBufferStats());
+            if constexpr (crispy::allocations_counted)
+            {
+                auto const allocations = terminal().allocationStats();
+                auto const perMB =
+                    crispy::allocations_per_mb(allocations.input.total.count, allocations.parsedBytes);
+                os << fmt::format("Allocations processing output: {:.1f} per MB parsed, {}\n",
+                                  perMB,
+                                  allocations.input);
+                os << fmt::format("Allocations per frame built: {}\n", allocations.frames);
+            }
+            auto const synchronizedOutput = terminal().synchronizedOutputStats();
+            os << fmt::format("Synchronized output: {} batches, {} frames saved, {} timed out\n",
+                              synchronizedOutput.batches,
+                              synchronizedOutput.framesSaved,
+                              synchronizedOutput.timeouts);
+            os << fmt::format("Render thread: {}{}\n",
+                              _renderTimings.toString(),
+                              _renderingOnGuiThread ? " (on the GUI thread)" : "");
+            os << fmt::format("GUI thread frame requests: {}\n", _updateRequestTimings.toString());
+            auto const threadPool = _session->app().threadPool().stats();
+            os << fmt::format("Thread pool: {} threads, {} tasks run, {} stolen, {} cancelled, {} pending\n",
+                              threadPool.threadCount,
+                              threadPool.executed,
+                              threadPool.stolen,
+                              threadPool.cancelled,
+                              threadPool.pending);
+            _session->app().sessionsManager().gpuMemoryBudget().inspect(os);
+            terminal().device().inspect(os);
+            terminal().inspectSequenceStats(os);
             return os.str();
         }();
 
@@ -1139,6 +1343,8 @@ void TerminalDisplay::doDumpStateInternal()
     auto screenshotFilePath = targetDir / "screenshot.png";
     displayLog()("Saving screenshot to: {}", screenshotFilePath.generic_string());
     auto [size, image] = _renderTarget->takeScreenshot();
+    if (image.empty())
+        return;
     QImage(image.data(), size.width.as<int>(), size.height.as<int>(), QImage::Format_RGBA8888_Premultiplied)
         .mirrored(false, true)
         .save(QString::fromStdString(screenshotFilePath.string()));
@@ -1304,9 +1510,42 @@ void TerminalDisplay::scheduleRedraw()
         _lastHistoryLineCount = currentHistoryLineCount;
     }
 
+    // While flooded, frames are rendered at a lowered rate, such that rendering does not hold off parsing.
+    if (auto const delay = terminal().frameThrottleDelay(); delay > chrono::milliseconds(0))
+    {
+        post([this, delay]() {
+            if (!_updateTimer.isActive())
+                _updateTimer.start(delay);
+        });
+        return;
+    }
+
     // QCoreApplication::postEvent(this, new QEvent(QEvent::UpdateRequest));
     if (window())
-        post([this]() { window()->update(); });
+        post([this, requested = steady_clock::now()]() {
+            _updateRequestTimings.record(steady_clock::now() - requested);
+            window()->update();
+        });
+}
+
+void TerminalDisplay::FrameTimings::record(steady_clock::duration duration) noexcept
+{
+    auto const micros = static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(duration).count());
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalMicroseconds.fetch_add(micros, std::memory_order_relaxed);
+    if (micros > maxMicroseconds.load(std::memory_order_relaxed))
+        maxMicroseconds.store(micros, std::memory_order_relaxed);
+    seconds.observe(chrono::duration<double>(duration).count());
+}
+
+std::string TerminalDisplay::FrameTimings::toString() const
+{
+    auto const n = count.load(std::memory_order_relaxed);
+    auto const total = totalMicroseconds.load(std::memory_order_relaxed);
+    return fmt::format("{} frames, {} us average, {} us max",
+                       n,
+                       n != 0 ? total / n : 0,
+                       maxMicroseconds.load(std::memory_order_relaxed));
 }
 
 void TerminalDisplay::renderBufferUpdated()
@@ -1346,6 +1585,12 @@ void TerminalDisplay::discardImage(vtbackend::Image const& image)
 {
     _renderer->discardImage(image);
 }
+
+void TerminalDisplay::trimCaches()
+{
+    if (_renderer)
+        _renderer->trimCaches();
+}
 // }}}
 
 } // namespace contour::display
@@ -13,6 +13,7 @@
 #include <vtrasterizer/Renderer.h>
 
 #include <crispy/deferred.h>
+#include <crispy/openmetrics.h>
 
 #include <QtCore/QFileSystemWatcher>
 #include <QtCore/QPoint>
@@ -26,6 +27,7 @@
 #include <atomic>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <vector>
 
@@ -34,7 +36,7 @@
 namespace contour::display
 {
 
-class OpenGLRenderer;
+class QuickRenderTarget;
 
 // It currently just handles one terminal inside, but ideally later it can handle
 // multiple terminals in tabbed views as well tiled.
@@ -124,12 +126,23 @@ class TerminalDisplay: public QQuickItem
     [[nodiscard]] vtbackend::ImageSize pixelSize() const;
     [[nodiscard]] vtbackend::ImageSize cellSize() const;
 
+    // Render metrics, e.g. for exporting them, which may be read from any thread.
+    [[nodiscard]] crispy::histogram_snapshot renderTimeHistogram() const
+    {
+        return _renderTimings.seconds.snapshot();
+    }
+    [[nodiscard]] vtrasterizer::Renderer::CacheStats renderCacheStats() const
+    {
+        auto const _ = std::lock_guard { _renderCacheStatsMutex };
+        return _renderCacheStats;
+    }
+
     // general events
     void adaptToWidgetSize();
 
     // (user requested) actions
     vtbackend::FontDef getFontDef();
-    static void copyToClipboard(std::string_view /*_data*/);
+    static void copyToClipboard(QString const& text);
     void inspect();
     void notify(std::string_view /*_title*/, std::string_view /*_body*/);
     void resizeWindow(vtbackend::LineCount, vtbackend::ColumnCount);
@@ -154,6 +167,9 @@ class TerminalDisplay: public QQuickItem
     void discardImage(vtbackend::Image const&);
     // }}}
 
+    /// Evicts the cold entries of the renderer's caches when rendering the next frame.
+    void trimCaches();
+
     [[nodiscard]] std::optional<double> queryContentScaleOverride() const;
     [[nodiscard]] double contentScale() const;
 
@@ -161,6 +177,10 @@ class TerminalDisplay: public QQuickItem
 
     void releaseResources() override;
 
+    /// Tests whether this display can be seen, i.e. is visible and in a window that is neither
+    /// hidden nor minimized. The session's terminal is detached while its display cannot be seen.
+    [[nodiscard]] bool visibleToUser() const noexcept;
+
     [[nodiscard]] QString profileName() const { return QString::fromStdString(_profileName); }
     void setProfileName(QString const& name) { _profileName = name.toStdString(); }
 
@@ -172,11 +192,15 @@ class TerminalDisplay: public QQuickItem
 
     void handleWindowChanged(QQuickWindow* newWindow);
     void sizeChanged();
+    void applySizeChange();
     void cleanup();
 
     void onAfterRendering();
+    void onAfterRenderPassRecording();
+    void onFrameSwapped();
     void onScrollBarValueChanged(int value);
     void onRefreshRateChanged();
+    void onVisibilityChanged();
     void applyFontDPI();
     void onScreenChanged();
     void onDpiConfigChanged();
@@ -262,13 +286,15 @@ class TerminalDisplay: public QQuickItem
     mutable std::optional<double> _lastReportedContentScale;
 #endif
     std::unique_ptr<vtrasterizer::Renderer> _renderer;
-    bool _renderingPressure = false;
-    display::OpenGLRenderer* _renderTarget = nullptr;
+    display::QuickRenderTarget* _renderTarget = nullptr;
     bool _maximizedState = false;
 
     // update() timer used to animate the blinking cursor.
     QTimer _updateTimer;
 
+    // Coalesces the size changes of interactive window resizes, see sizeChanged().
+    QTimer _resizeTimer;
+
     RenderStateManager _state;
     bool _doDumpState = false;
 
@@ -277,6 +303,25 @@ class TerminalDisplay: public QQuickItem
 
     vtbackend::LineCount _lastHistoryLineCount = vtbackend::LineCount(0);
 
+    // Time spent per frame by one thread, written by that thread only and read for diagnostics.
+    struct FrameTimings
+    {
+        std::atomic<uint64_t> count = 0;
+        std::atomic<uint64_t> totalMicroseconds = 0;
+        std::atomic<uint64_t> maxMicroseconds = 0;
+        crispy::histogram seconds { { 0.0005, 0.001, 0.002, 0.004, 0.008, 0.016, 0.033, 0.066, 0.125 } };
+
+        void record(std::chrono::steady_clock::duration duration) noexcept;
+        [[nodiscard]] std::string toString() const;
+    };
+    FrameTimings _renderTimings;        // rendering the terminal, on the thread rendering the scene graph
+    FrameTimings _updateRequestTimings; // the GUI thread getting to requesting a frame after new output
+    std::atomic<bool> _renderingOnGuiThread = true;
+
+    // Taken after each frame rendered, as the renderer's caches may only be accessed while rendering.
+    mutable std::mutex _renderCacheStatsMutex;
+    vtrasterizer::Renderer::CacheStats _renderCacheStats {};
+
     // ======================================================================
 
 #if defined(CONTOUR_PERF_STATS)
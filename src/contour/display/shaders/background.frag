@@ -1,7 +1,9 @@
+#if !defined(CONTOUR_RHI) // declared by shaders/rhi/background.frag.glsl instead
 in highp vec4 fs_textColor;
 out highp vec4 outColor;
 
 uniform highp float u_time;
+#endif
 
 void main()
 {
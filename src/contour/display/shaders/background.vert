@@ -1,8 +1,12 @@
+#if !defined(CONTOUR_RHI) // declared by shaders/rhi/background.vert.glsl instead
 uniform highp mat4 u_projection;
+#endif
 layout (location = 0) in highp vec3 vs_vertex;    // target vertex coordinates
 layout (location = 1) in highp vec4 vs_colors;    // custom foreground colors
 
+#if !defined(CONTOUR_RHI)
 out mediump vec4 fs_textColor;
+#endif
 
 void main()
 {
@@ -0,0 +1,10 @@
+// Declarations of background.frag when compiled for QRhi (see RhiRenderer).
+
+layout (std140, binding = 0) uniform RectUniforms
+{
+    highp mat4 u_projection;
+    highp float u_time;
+};
+
+layout (location = 0) in highp vec4 fs_textColor;
+layout (location = 0) out highp vec4 outColor;
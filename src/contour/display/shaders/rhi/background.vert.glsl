@@ -0,0 +1,9 @@
+// Declarations of background.vert when compiled for QRhi (see RhiRenderer).
+
+layout (std140, binding = 0) uniform RectUniforms
+{
+    highp mat4 u_projection;    // projection matrix, including the graphics API's clip space correction
+    highp float u_time;
+};
+
+layout (location = 0) out mediump vec4 fs_textColor;
@@ -0,0 +1,17 @@
+// Declarations of text.frag when compiled for QRhi (see RhiRenderer).
+
+layout (std140, binding = 0) uniform TextUniforms
+{
+    highp mat4 vs_projection;
+    highp float pixel_x;
+    highp float u_time;
+};
+
+layout (binding = 1) uniform highp sampler2D fs_textureAtlas; // RGBA
+
+layout (location = 0) in highp vec4 fs_TexCoord;
+layout (location = 1) in highp vec4 fs_textColor;
+layout (location = 2) in highp vec4 fs_tileCoord;
+layout (location = 3) flat in highp vec4 fs_primitive;
+
+layout (location = 0) out highp vec4 fragColor;
@@ -0,0 +1,15 @@
+// Declarations of text.vert when compiled for QRhi (see RhiRenderer).
+
+layout (std140, binding = 0) uniform TextUniforms
+{
+    highp mat4 vs_projection;   // projection matrix, including the graphics API's clip space correction
+    highp float pixel_x;        // 1.0 / lcdAtlas.width
+    highp float u_time;
+};
+
+layout (location = 0) out highp vec4 fs_TexCoord;
+layout (location = 1) out highp vec4 fs_textColor;
+layout (location = 2) out highp vec4 fs_tileCoord;
+layout (location = 3) flat out highp vec4 fs_primitive;
+
+#define gl_VertexID gl_VertexIndex
@@ -1,14 +1,18 @@
+#if !defined(CONTOUR_RHI) // declared by shaders/rhi/text.frag.glsl instead
 uniform highp float pixel_x;                  // 1.0 / lcdAtlas.width
 uniform highp sampler2D fs_textureAtlas;      // RGBA
 uniform highp float u_time;
 
 in highp vec4 fs_TexCoord;
 in highp vec4 fs_textColor;
+in highp vec4 fs_tileCoord;
+flat in highp vec4 fs_primitive;
 
 // Dual source blending (since OpenGL 3.3)
 // layout (location = 0, index = 0) out highp vec4 color;
 // layout (location = 0, index = 1) out highp vec4 colorMask;
 out highp vec4 fragColor;
+#endif
 
 const highp vec4 TEST_PIXEL = vec4(1.0, 0.0, 0.0, 1.0); // test pixel for debugging
 
@@ -25,6 +29,15 @@ void renderGrayscaleGlyph()
     fragColor = sampled * fs_textColor;
 }
 
+// Renders a glyph from its signed distance field, with 0.5 being on the outline and larger values inside.
+// The outline is anti-aliased over one screen pixel, independent of the scale the glyph is drawn at.
+void renderDistanceFieldGlyph()
+{
+    highp float distance = texture(fs_textureAtlas, fs_TexCoord.xy).r - 0.5;
+    highp float coverage = clamp(distance / max(fwidth(distance), 1e-5) + 0.5, 0.0, 1.0);
+    fragColor = vec4(1.0, 1.0, 1.0, coverage) * fs_textColor;
+}
+
 // Renders an RGBA texture. This is used to render images (such as Sixel graphics or Emoji).
 void renderColoredRGBA()
 {
@@ -134,6 +147,63 @@ void renderLcdGlyph()
     fragColor = vec4(color.rgb, alpha);
 }
 
+// Computes the coverage of straight box drawing lines, pixel-exact to BoxDrawingRenderer's pixmaps.
+//
+// @param pixel     pixel column and row, counted from the bottom left
+// @param arms      line weight of the left, right, up, and down arm (none, light, heavy), 2 bits each
+// @param thickness light line thickness in pixels
+highp float boxDrawingLines(ivec2 pixel, ivec2 size, int arms, int thickness)
+{
+    // Heavy horizontal lines are twice as thick, heavy vertical lines three times.
+    int horizontalWeight = pixel.x < size.x / 2 ? arms & 3 : (arms >> 2) & 3;
+    int horizontalThickness = horizontalWeight == 2 ? 2 * thickness : thickness;
+    int y0 = size.y / 2 - horizontalThickness / 2;
+    bool horizontal = horizontalWeight != 0 && pixel.y >= y0 && pixel.y < y0 + horizontalThickness;
+
+    int verticalWeight = pixel.y < size.y / 2 ? (arms >> 6) & 3 : (arms >> 4) & 3;
+    int verticalThickness = verticalWeight == 2 ? 3 * thickness : thickness;
+    int x0 = size.x / 2 - verticalThickness / 2;
+    bool vertical = verticalWeight != 0 && pixel.x >= x0 && pixel.x < x0 + verticalThickness;
+
+    return horizontal || vertical ? 1.0 : 0.0;
+}
+
+// Computes the coverage of a rectangle given in eighths of the cell, counted from the top left.
+highp float boxDrawingBlock(ivec2 pixel, ivec2 size, int rect)
+{
+    ivec2 from = ivec2(rect & 15, (rect >> 4) & 15) * size / 8;
+    ivec2 to = ivec2((rect >> 8) & 15, (rect >> 12) & 15) * size / 8;
+    return all(greaterThanEqual(pixel, from)) && all(lessThan(pixel, to)) ? 1.0 : 0.0;
+}
+
+// Computes the anti-aliased coverage of a triangle spanning the whole cell, based at its left or right edge.
+highp float boxDrawingTriangle(highp vec2 position, int direction)
+{
+    highp float x = direction == 0 ? position.x : 1.0 - position.x;
+    highp float distance = 0.5 * (1.0 - x) - abs(position.y - 0.5);
+    return clamp(distance / max(fwidth(distance), 1e-5) + 0.5, 0.0, 1.0);
+}
+
+// Renders a box drawing character procedurally, which scales to any cell size without rasterization.
+void renderBoxDrawing()
+{
+    ivec2 size = ivec2(fs_tileCoord.zw + 0.5);
+    ivec2 pixel = min(ivec2(fs_tileCoord.xy * fs_tileCoord.zw), size - 1); // counted from the top left
+    int kind = int(fs_primitive.x);
+    int parameters = int(fs_primitive.y);
+    int thickness = int(fs_primitive.z);
+
+    highp float coverage = 0.0;
+    if (kind == BOX_DRAWING_LINES)
+        coverage = boxDrawingLines(ivec2(pixel.x, size.y - 1 - pixel.y), size, parameters, thickness);
+    else if (kind == BOX_DRAWING_BLOCK)
+        coverage = boxDrawingBlock(pixel, size, parameters);
+    else if (kind == BOX_DRAWING_TRIANGLE)
+        coverage = boxDrawingTriangle(fs_tileCoord.xy, parameters);
+
+    fragColor = vec4(1.0, 1.0, 1.0, coverage) * fs_textColor;
+}
+
 void main()
 {
     int selector = int(fs_TexCoord.w); // This is the RenderTile::userdata component.
@@ -149,6 +219,12 @@ void main()
         case FRAGMENT_SELECTOR_IMAGE_BGRA:
             renderColoredRGBA();
             break;
+        case FRAGMENT_SELECTOR_BOX_DRAWING:
+            renderBoxDrawing();
+            break;
+        case FRAGMENT_SELECTOR_GLYPH_SDF:
+            renderDistanceFieldGlyph();
+            break;
         case FRAGMENT_SELECTOR_GLYPH_ALPHA:
         default:
             renderGrayscaleGlyph();
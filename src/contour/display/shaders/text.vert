@@ -1,16 +1,32 @@
+#if !defined(CONTOUR_RHI) // declared by shaders/rhi/text.vert.glsl instead
 uniform highp mat4 vs_projection;                 // projection matrix (flips around the coordinate system)
+#endif
 
-layout (location = 0) in highp vec3 vs_vertex;    // target vertex coordinates
-layout (location = 1) in highp vec4 vs_texCoords; // 2D-atlas texture coordinates
+// Per-instance attributes, one instance per render tile.
+layout (location = 0) in highp vec4 vs_rect;      // target rectangle (x, y, width, height)
+layout (location = 1) in highp vec4 vs_texRect;   // normalized 2D-atlas texture rectangle
 layout (location = 2) in highp vec4 vs_colors;    // custom foreground colors
+layout (location = 3) in highp vec2 vs_userdata;  // z-axis depth and fragment shader selector
 
+#if !defined(CONTOUR_RHI)
 out highp vec4 fs_TexCoord;
 out highp vec4 fs_textColor;
+out highp vec4 fs_tileCoord;        // normalized position within the tile (x, y), and tile size in pixels
+flat out highp vec4 fs_primitive;   // procedural primitive (see FRAGMENT_SELECTOR_BOX_DRAWING)
+#endif
+
+// The two triangles making up a tile's quad, in units of the tile's extent.
+const highp vec2 Corners[6] = vec2[6](vec2(0.0, 1.0), vec2(0.0, 0.0), vec2(1.0, 0.0),  // first triangle
+                                      vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(1.0, 1.0)); // second triangle
 
 void main()
 {
-    gl_Position = vs_projection * vec4(vs_vertex.xyz, 1.0);
+    highp vec2 corner = Corners[gl_VertexID];
+
+    gl_Position = vs_projection * vec4(vs_rect.xy + corner * vs_rect.zw, vs_userdata.x, 1.0);
 
-    fs_TexCoord = vs_texCoords;
+    fs_TexCoord = vec4(vs_texRect.xy + corner * vs_texRect.zw, 0.0, vs_userdata.y);
     fs_textColor = vs_colors;
+    fs_tileCoord = vec4(corner, vs_rect.zw);
+    fs_primitive = vs_texRect;
 }
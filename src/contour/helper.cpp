@@ -431,7 +431,7 @@ void sendWheelEvent(QWheelEvent* event, TerminalSession& session)
         auto const pixelPosition =
             makeMousePixelPosition(event, session.profile().margins, session.contentScale());
 
-        session.sendMousePressEvent(modifier, button, pixelPosition);
+        session.sendMouseWheelEvent(modifier, button, pixelPosition);
         event->accept();
     }
 
@@ -449,7 +449,7 @@ void sendWheelEvent(QWheelEvent* event, TerminalSession& session)
         auto const pixelPosition =
             makeMousePixelPosition(event, session.profile().margins, session.contentScale());
 
-        session.sendMousePressEvent(modifier, button, pixelPosition);
+        session.sendMouseWheelEvent(modifier, button, pixelPosition);
         event->accept();
     }
 }
@@ -586,10 +586,12 @@ bool applyFontDescription(text::DPI dpi,
                           vtrasterizer::Renderer& renderer,
                           vtrasterizer::FontDescriptions fontDescriptions)
 {
+    // Compared as set, as otherwise unspecified font sizes would always tell the fonts to have changed.
+    fontDescriptions = sanitizeFontDescription(std::move(fontDescriptions), dpi);
     if (renderer.fontDescriptions() == fontDescriptions)
         return false;
 
-    renderer.setFonts(sanitizeFontDescription(std::move(fontDescriptions), dpi));
+    renderer.setFonts(std::move(fontDescriptions));
     renderer.updateFontMetrics();
 
     return true;
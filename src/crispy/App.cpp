@@ -283,12 +283,13 @@ void app::customizeLogStoreOutput()
             else
             {
                 // clang-format off
-                auto const now = chrono::system_clock::now();
+                // The time the message was logged at, which deferred messages are formatted after.
+                auto const time = msg.time();
                 auto const micros =
-                    duration_cast<chrono::microseconds>(now.time_since_epoch()).count() % 1'000'000;
+                    duration_cast<chrono::microseconds>(time.time_since_epoch()).count() % 1'000'000;
                 result += sgrTag;
                 result += fmt::format("[{:%Y-%m-%d %H:%M:%S}.{:06}] [{}]",
-                                      chrono::system_clock::now(),
+                                      time,
                                       micros,
                                       msg.get_category().name());
                 result += sgrReset;
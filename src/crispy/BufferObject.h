@@ -9,15 +9,18 @@
 #include <gsl/span_ext>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <cstdlib>
 #include <functional>
 #include <iterator>
-#include <list>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #define BUFFER_OBJECT_INLINE 1
 
@@ -30,6 +33,9 @@ class buffer_object;
 template <typename>
 class BufferFragment;
 
+template <typename>
+class buffer_object_pool;
+
 template <typename T>
 using buffer_object_release = std::function<void(buffer_object<T>*)>;
 
@@ -55,6 +61,8 @@ auto const inline bufferObjectLog = logstore::category("BufferObject",
  *   can start filling at the same offset again.
  *   The offset gets incremented only if new references have been added.
  * - This buffer does not grow or shrink.
+ * - The hot end is only ever moved forward (until reset), and may be advanced
+ *   by a PTY reader thread while another thread references already read data.
  */
 template <typename T>
 class buffer_object: public std::enable_shared_from_this<buffer_object<T>>
@@ -65,6 +73,14 @@ class buffer_object: public std::enable_shared_from_this<buffer_object<T>>
 
     static buffer_object_ptr<T> create(size_t capacity, buffer_object_release<T> release = {});
 
+    /// Constructs a buffer object within externally managed storage, using the remainder
+    /// of that storage past the buffer object itself as its data.
+    ///
+    /// The @p release callback must destroy the buffer object and take back the storage.
+    static buffer_object_ptr<T> create_at(void* storage,
+                                          size_t storageSize,
+                                          buffer_object_release<T> release);
+
     void reset() noexcept;
 
     [[nodiscard]] std::size_t capacity() const noexcept
@@ -94,8 +110,8 @@ class buffer_object: public std::enable_shared_from_this<buffer_object<T>>
     T const* begin() const noexcept { return data(); }
 
     /// Returns a pointer one byte past the last used byte.
-    T* hotEnd() noexcept { return _hotEnd; }
-    T const* hotEnd() const noexcept { return _hotEnd; }
+    T* hotEnd() noexcept { return _hotEnd.load(std::memory_order_relaxed); }
+    T const* hotEnd() const noexcept { return _hotEnd.load(std::memory_order_relaxed); }
 
     /// Returns a pointer one byte past the underlying storage's last byte.
     T* end() noexcept { return _end; }
@@ -104,6 +120,8 @@ class buffer_object: public std::enable_shared_from_this<buffer_object<T>>
     /// Advances the end of the used area by the given amount of bytes.
     gsl::span<T> advance(size_t n) noexcept;
 
+    /// Moves the end of the used area forward to the given pointer,
+    /// unless it is already past it.
     void advanceHotEndUntil(T const* ptr) noexcept;
 
     /// Appends the given amount of data to the buffer object
@@ -116,41 +134,98 @@ class buffer_object: public std::enable_shared_from_this<buffer_object<T>>
     void unlock() { _mutex.unlock(); }
 
   private:
+    [[nodiscard]] static buffer_object* construct(size_t capacity);
+    static void destroy(buffer_object* ptr) noexcept;
+
 #if !defined(BUFFER_OBJECT_INLINE)
     T* data_;
 #endif
-    T* _hotEnd;
+    std::atomic<T*> _hotEnd;
     T* _end;
+    buffer_object* _nextUnused = nullptr; // next in the list of unused buffer objects of a pool
 
     friend class BufferFragment<T>;
+    friend class buffer_object_pool<T>;
 
     std::mutex _mutex;
 };
 
+/// Counters of a buffer_object_pool's activity, summed up over all of its size classes.
+struct buffer_object_pool_stats
+{
+    uint64_t allocations; // buffer objects handed out
+    uint64_t reuses;      // allocations served by recycling a released buffer object
+    size_t liveBuffers;   // buffer objects still referenced, e.g. by buffer fragments
+    size_t pinnedBytes;   // capacity of the live buffer objects
+    size_t unusedBuffers; // released buffer objects kept for reuse
+    size_t unusedBytes;   // capacity of the unused buffer objects
+};
+
 /**
  * buffer_object_pool manages reusable buffer_object objects.
  *
  * buffer_object objects that are about to be disposed
  * are not gettings its resources deleted but ownership moved
  * back to buffer_object_pool.
+ *
+ * Buffer objects come in one or more size classes, each twice the size of the previous one.
+ * Buffer objects may be allocated and released from any thread without taking a lock:
+ * the unused buffer objects of each size class form a lock-free stack, which is pushed onto when
+ * releasing them, and taken as a whole when allocating, returning the remainder afterwards.
+ * This avoids the ABA problem of popping single entries, at the expense of concurrent allocations
+ * rarely missing unused buffer objects.
  */
 template <typename T>
 class buffer_object_pool
 {
   public:
-    explicit buffer_object_pool(size_t bufferSize = 4096);
+    explicit buffer_object_pool(size_t bufferSize = 4096, size_t sizeClasses = 1);
+    buffer_object_pool(buffer_object_pool const&) = delete;
+    buffer_object_pool& operator=(buffer_object_pool const&) = delete;
     ~buffer_object_pool();
 
+    /// Destroys all unused buffer objects.
     void releaseUnusedBuffers();
+
+    /// Destroys the unused buffer objects beyond the recent demand, i.e. all but those needed
+    /// to serve the peak number of live buffer objects since the last trim once again.
+    void trimUnusedBuffers();
+
     [[nodiscard]] size_t unusedBuffers() const noexcept;
-    [[nodiscard]] buffer_object_ptr<T> allocateBufferObject();
+    [[nodiscard]] size_t sizeClasses() const noexcept { return _sizeClasses.size(); }
+    [[nodiscard]] buffer_object_pool_stats stats() const noexcept;
 
-  private:
-    void release(buffer_object<T>* ptr);
+    /// @returns a buffer object of the smallest size class of at least @p minimumSize bytes,
+    ///          or of the largest size class if there is none.
+    [[nodiscard]] buffer_object_ptr<T> allocateBufferObject(size_t minimumSize = 0);
 
-    bool _reuseBuffers = true;
-    size_t _bufferSize;
-    std::list<buffer_object_ptr<T>> _unusedBuffers;
+  private:
+    struct size_class
+    {
+        size_t bufferSize = 0;
+        std::atomic<buffer_object<T>*> unused = nullptr; // top of the stack of unused buffer objects
+        std::atomic<size_t> unusedCount = 0;
+        std::atomic<size_t> liveCount = 0;
+        std::atomic<size_t> peakLiveCount = 0; // since the last trim
+        std::atomic<uint64_t> allocations = 0;
+        std::atomic<uint64_t> reuses = 0;
+    };
+
+    struct recycler
+    {
+        buffer_object_pool* pool;
+        size_class* sizeClass;
+        void operator()(buffer_object<T>* ptr) const noexcept { pool->release(*sizeClass, ptr); }
+    };
+
+    static void push(size_class& sizeClass, buffer_object<T>* first, buffer_object<T>* last) noexcept;
+    [[nodiscard]] buffer_object<T>* pop(size_class& sizeClass) noexcept;
+    void release(size_class& sizeClass, buffer_object<T>* ptr) noexcept;
+    size_t destroyAll(size_class& sizeClass, buffer_object<T>* first) noexcept;
+
+    std::vector<size_class> _sizeClasses;
+    std::atomic<size_t> _pinnedBytes = 0;
+    std::atomic<size_t> _unusedBytes = 0;
 };
 
 /**
@@ -236,25 +311,55 @@ buffer_object<T>::~buffer_object()
 }
 
 template <typename T>
-buffer_object_ptr<T> buffer_object<T>::create(size_t capacity, buffer_object_release<T> release)
+buffer_object<T>* buffer_object<T>::construct(size_t capacity)
 {
 #if defined(BUFFER_OBJECT_INLINE)
     auto const totalCapacity = nextPowerOfTwo(static_cast<uint32_t>(sizeof(buffer_object) + capacity));
     auto const nettoCapacity = totalCapacity - sizeof(buffer_object);
     auto ptr = (buffer_object*) malloc(totalCapacity);
     new (ptr) buffer_object(nettoCapacity);
-    return buffer_object_ptr<T>(ptr, std::move(release));
+    return ptr;
+#else
+    return new buffer_object<T>(nextPowerOfTwo(capacity));
+#endif
+}
+
+template <typename T>
+void buffer_object<T>::destroy(buffer_object* ptr) noexcept
+{
+#if defined(BUFFER_OBJECT_INLINE)
+    std::destroy_n(ptr, 1);
+    free(ptr);
 #else
-    return buffer_object_ptr<T>(new buffer_object<T>(nextPowerOfTwo(capacity)), std::move(release));
+    delete ptr;
 #endif
 }
 
+template <typename T>
+buffer_object_ptr<T> buffer_object<T>::create(size_t capacity, buffer_object_release<T> release)
+{
+    if (!release)
+        release = [](buffer_object* ptr) { destroy(ptr); };
+    return buffer_object_ptr<T>(construct(capacity), std::move(release));
+}
+
+template <typename T>
+buffer_object_ptr<T> buffer_object<T>::create_at(void* storage,
+                                                 size_t storageSize,
+                                                 buffer_object_release<T> release)
+{
+    assert(storageSize > sizeof(buffer_object));
+    auto* ptr = new (storage) buffer_object((storageSize - sizeof(buffer_object)) / sizeof(T));
+    return buffer_object_ptr<T>(ptr, std::move(release));
+}
+
 template <typename T>
 gsl::span<T const> buffer_object<T>::writeAtEnd(gsl::span<T const> data) noexcept
 {
-    assert(_hotEnd + data.size() <= _end);
-    memcpy(_hotEnd, data.data(), data.size());
-    return gsl::span<T const> { _hotEnd, data.size() };
+    auto* const target = hotEnd();
+    assert(target + data.size() <= _end);
+    memcpy(target, data.data(), data.size());
+    return gsl::span<T const> { target, data.size() };
 }
 
 template <typename T>
@@ -286,17 +391,20 @@ inline T const* buffer_object<T>::data() const noexcept
 template <typename T>
 inline gsl::span<T> buffer_object<T>::advance(size_t n) noexcept
 {
-    assert(_hotEnd + n <= _end);
-    auto result = gsl::span<T>(_hotEnd, _hotEnd + n);
-    _hotEnd += n;
-    return result;
+    auto* const start = _hotEnd.fetch_add(static_cast<std::ptrdiff_t>(n));
+    assert(start + n <= _end);
+    return gsl::span<T>(start, start + n);
 }
 
 template <typename T>
 inline void buffer_object<T>::advanceHotEndUntil(T const* ptr) noexcept
 {
-    assert(_hotEnd <= ptr && ptr <= _end);
-    _hotEnd = const_cast<T*>(ptr);
+    assert(data() <= ptr && ptr <= _end);
+    auto* current = hotEnd();
+    while (current < ptr && !_hotEnd.compare_exchange_weak(current, const_cast<T*>(ptr)))
+    {
+        // current has been reloaded; retry unless someone else moved past ptr already.
+    }
 }
 
 template <typename T>
@@ -335,65 +443,194 @@ inline std::size_t BufferFragment<T>::endOffset() const noexcept
 
 // {{{ BufferObjectPool implementation
 template <typename T>
-buffer_object_pool<T>::buffer_object_pool(size_t bufferSize): _bufferSize { bufferSize }
+buffer_object_pool<T>::buffer_object_pool(size_t bufferSize, size_t sizeClasses):
+    _sizeClasses(std::max(sizeClasses, size_t { 1 }))
 {
-    bufferObjectLog()("Creating BufferObject pool with chunk size {}",
-                      crispy::humanReadableBytes(bufferSize));
+    for (size_t i = 0; i < _sizeClasses.size(); ++i)
+        _sizeClasses[i].bufferSize = bufferSize << i;
+    bufferObjectLog()("Creating BufferObject pool with chunk size {} in {} size classes",
+                      crispy::humanReadableBytes(bufferSize),
+                      _sizeClasses.size());
 }
 
 template <typename T>
 buffer_object_pool<T>::~buffer_object_pool()
 {
-    _reuseBuffers = false;
+    releaseUnusedBuffers();
 }
 
 template <typename T>
 size_t buffer_object_pool<T>::unusedBuffers() const noexcept
 {
-    return _unusedBuffers.size();
+    auto count = size_t { 0 };
+    for (auto const& sizeClass: _sizeClasses)
+        count += sizeClass.unusedCount.load(std::memory_order_relaxed);
+    return count;
+}
+
+template <typename T>
+buffer_object_pool_stats buffer_object_pool<T>::stats() const noexcept
+{
+    auto stats = buffer_object_pool_stats {};
+    for (auto const& sizeClass: _sizeClasses)
+    {
+        stats.allocations += sizeClass.allocations.load(std::memory_order_relaxed);
+        stats.reuses += sizeClass.reuses.load(std::memory_order_relaxed);
+        stats.liveBuffers += sizeClass.liveCount.load(std::memory_order_relaxed);
+        stats.unusedBuffers += sizeClass.unusedCount.load(std::memory_order_relaxed);
+    }
+    stats.pinnedBytes = _pinnedBytes.load(std::memory_order_relaxed);
+    stats.unusedBytes = _unusedBytes.load(std::memory_order_relaxed);
+    return stats;
 }
 
 template <typename T>
 void buffer_object_pool<T>::releaseUnusedBuffers()
 {
-    _reuseBuffers = false;
-    _unusedBuffers.clear();
-    _reuseBuffers = true;
+    for (auto& sizeClass: _sizeClasses)
+        destroyAll(sizeClass, sizeClass.unused.exchange(nullptr, std::memory_order_acquire));
 }
 
 template <typename T>
-buffer_object_ptr<T> buffer_object_pool<T>::allocateBufferObject()
+void buffer_object_pool<T>::trimUnusedBuffers()
 {
-    if (_unusedBuffers.empty())
-        return buffer_object<T>::create(_bufferSize, [this](auto p) { release(p); });
+    auto trimmed = size_t { 0 };
+    for (auto& sizeClass: _sizeClasses)
+    {
+        auto const liveCount = sizeClass.liveCount.load(std::memory_order_relaxed);
+        auto const peakLiveCount = sizeClass.peakLiveCount.exchange(liveCount, std::memory_order_relaxed);
+        auto keep = peakLiveCount > liveCount ? peakLiveCount - liveCount : 0;
+
+        auto* first = sizeClass.unused.exchange(nullptr, std::memory_order_acquire);
+        if (!first)
+            continue;
+        if (!keep)
+        {
+            trimmed += destroyAll(sizeClass, first);
+            continue;
+        }
+
+        auto* last = first;
+        while (--keep && last->_nextUnused)
+            last = last->_nextUnused;
+        trimmed += destroyAll(sizeClass, std::exchange(last->_nextUnused, nullptr));
+        push(sizeClass, first, last);
+    }
 
-    buffer_object_ptr<T> buffer = std::move(_unusedBuffers.front());
-    if (bufferObjectLog)
-        bufferObjectLog()("Recycling BufferObject from pool: @{}.", (void*) buffer.get());
-    _unusedBuffers.pop_front();
-    return buffer;
+    if (trimmed && bufferObjectLog)
+        bufferObjectLog()("Trimmed {} unused BufferObjects beyond recent demand.", trimmed);
 }
 
 template <typename T>
-void buffer_object_pool<T>::release(buffer_object<T>* ptr)
+buffer_object_ptr<T> buffer_object_pool<T>::allocateBufferObject(size_t minimumSize)
 {
-    if (_reuseBuffers)
+    auto sizeClass = std::find_if(_sizeClasses.begin(), _sizeClasses.end(), [=](auto const& candidate) {
+        return candidate.bufferSize >= minimumSize;
+    });
+    if (sizeClass == _sizeClasses.end())
+        sizeClass = std::prev(_sizeClasses.end());
+
+    ++sizeClass->allocations;
+    auto const liveCount = ++sizeClass->liveCount;
+    auto& peakLiveCount = sizeClass->peakLiveCount;
+    auto peak = peakLiveCount.load(std::memory_order_relaxed);
+    while (peak < liveCount && !peakLiveCount.compare_exchange_weak(peak, liveCount))
     {
+        // peak has been reloaded; retry unless another allocation has raised it already.
+    }
+
+    auto* ptr = pop(*sizeClass);
+    if (ptr)
+    {
+        ++sizeClass->reuses;
         if (bufferObjectLog)
-            bufferObjectLog()("Releasing BufferObject from pool: @{}", (void*) ptr);
-        ptr->reset();
-        _unusedBuffers.emplace_back(ptr, [this](auto p) { release(p); });
+            bufferObjectLog()("Recycling BufferObject from pool: @{}.", (void*) ptr);
     }
     else
+        ptr = buffer_object<T>::construct(sizeClass->bufferSize);
+
+    _pinnedBytes += ptr->capacity();
+    return buffer_object_ptr<T>(ptr, recycler { this, &*sizeClass });
+}
+
+template <typename T>
+void buffer_object_pool<T>::push(size_class& sizeClass,
+                                 buffer_object<T>* first,
+                                 buffer_object<T>* last) noexcept
+{
+    auto* top = sizeClass.unused.load(std::memory_order_relaxed);
+    do
+        last->_nextUnused = top;
+    while (!sizeClass.unused.compare_exchange_weak(
+        top, first, std::memory_order_release, std::memory_order_relaxed));
+}
+
+template <typename T>
+buffer_object<T>* buffer_object_pool<T>::pop(size_class& sizeClass) noexcept
+{
+    // Taking the whole stack, other threads cannot pop and push back the same entries meanwhile.
+    auto* first = sizeClass.unused.exchange(nullptr, std::memory_order_acquire);
+    if (!first)
+        return nullptr;
+
+    if (auto* rest = std::exchange(first->_nextUnused, nullptr))
     {
-#if defined(BUFFER_OBJECT_INLINE)
-        std::destroy_n(ptr, 1);
-        free(ptr);
-#else
-        delete ptr;
-#endif
+        auto* last = rest;
+        while (last->_nextUnused)
+            last = last->_nextUnused;
+        push(sizeClass, rest, last);
     }
+    --sizeClass.unusedCount;
+    _unusedBytes -= first->capacity();
+    return first;
+}
+
+template <typename T>
+void buffer_object_pool<T>::release(size_class& sizeClass, buffer_object<T>* ptr) noexcept
+{
+    if (bufferObjectLog)
+        bufferObjectLog()("Releasing BufferObject from pool: @{}", (void*) ptr);
+    ptr->reset();
+    --sizeClass.liveCount;
+    _pinnedBytes -= ptr->capacity();
+    ++sizeClass.unusedCount;
+    _unusedBytes += ptr->capacity();
+    push(sizeClass, ptr, ptr);
+}
+
+template <typename T>
+size_t buffer_object_pool<T>::destroyAll(size_class& sizeClass, buffer_object<T>* first) noexcept
+{
+    auto count = size_t { 0 };
+    while (first)
+    {
+        auto* const next = first->_nextUnused;
+        _unusedBytes -= first->capacity();
+        buffer_object<T>::destroy(first);
+        first = next;
+        ++count;
+    }
+    sizeClass.unusedCount -= count;
+    return count;
 }
 // }}}
 
 } // namespace crispy
+
+template <>
+struct fmt::formatter<crispy::buffer_object_pool_stats>: fmt::formatter<std::string>
+{
+    auto format(crispy::buffer_object_pool_stats const& stats, format_context& ctx)
+        -> format_context::iterator
+    {
+        return formatter<std::string>::format(
+            fmt::format("{} live ({} pinned), {} unused ({}), {} allocations, {} reused",
+                        stats.liveBuffers,
+                        crispy::humanReadableBytes(stats.pinnedBytes),
+                        stats.unusedBuffers,
+                        crispy::humanReadableBytes(stats.unusedBytes),
+                        stats.allocations,
+                        stats.reuses),
+            ctx);
+    }
+};
@@ -3,7 +3,121 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 TEST_CASE("buffer_object", "[buffer_object]")
 {
     // TODO
 }
+
+TEST_CASE("buffer_object.advanceHotEndUntil")
+{
+    auto pool = crispy::buffer_object_pool<char>(4096);
+    auto buffer = pool.allocateBufferObject();
+
+    buffer->advance(10);
+    REQUIRE(buffer->bytesUsed() == 10);
+
+    // Never moves the hot end backwards, e.g. when a reader thread has already claimed more.
+    buffer->advanceHotEndUntil(buffer->data() + 4);
+    REQUIRE(buffer->bytesUsed() == 10);
+
+    buffer->advanceHotEndUntil(buffer->data() + 16);
+    REQUIRE(buffer->bytesUsed() == 16);
+}
+
+TEST_CASE("buffer_object_pool.sizeClasses")
+{
+    auto pool = crispy::buffer_object_pool<char>(1024, 3);
+    REQUIRE(pool.sizeClasses() == 3);
+
+    auto const small = pool.allocateBufferObject();
+    auto const medium = pool.allocateBufferObject(2000);
+    auto const large = pool.allocateBufferObject(4096);
+    auto const oversized = pool.allocateBufferObject(100000);
+    CHECK(small->capacity() >= 1024);
+    CHECK(small->capacity() < medium->capacity());
+    CHECK(medium->capacity() < large->capacity());
+    CHECK(oversized->capacity() == large->capacity());
+}
+
+TEST_CASE("buffer_object_pool.stats")
+{
+    auto pool = crispy::buffer_object_pool<char>(1024);
+    auto buffer = pool.allocateBufferObject();
+    auto const capacity = buffer->capacity();
+
+    auto fragment = buffer->ref(0, 0);
+    buffer.reset();
+    auto stats = pool.stats();
+    CHECK(stats.allocations == 1);
+    CHECK(stats.reuses == 0);
+    CHECK(stats.liveBuffers == 1);
+    CHECK(stats.pinnedBytes == capacity);
+    CHECK(stats.unusedBuffers == 0);
+
+    // Releasing the last reference recycles the buffer object.
+    fragment = {};
+    stats = pool.stats();
+    CHECK(stats.liveBuffers == 0);
+    CHECK(stats.pinnedBytes == 0);
+    CHECK(stats.unusedBuffers == 1);
+    CHECK(stats.unusedBytes == capacity);
+
+    buffer = pool.allocateBufferObject();
+    CHECK(buffer->bytesUsed() == 0);
+    stats = pool.stats();
+    CHECK(stats.allocations == 2);
+    CHECK(stats.reuses == 1);
+    CHECK(stats.unusedBuffers == 0);
+}
+
+TEST_CASE("buffer_object_pool.trimUnusedBuffers")
+{
+    auto pool = crispy::buffer_object_pool<char>(1024);
+    {
+        auto buffers = std::vector<crispy::buffer_object_ptr<char>> {};
+        for (auto i = 0; i < 8; ++i)
+            buffers.emplace_back(pool.allocateBufferObject());
+    }
+    REQUIRE(pool.unusedBuffers() == 8);
+
+    // Keeps as many buffer objects as have been in use at the peak since the last trim.
+    auto const live = pool.allocateBufferObject();
+    pool.trimUnusedBuffers();
+    CHECK(pool.unusedBuffers() == 7);
+
+    // With no demand since, all unused buffer objects are released.
+    pool.trimUnusedBuffers();
+    CHECK(pool.unusedBuffers() == 0);
+    CHECK(pool.stats().unusedBytes == 0);
+}
+
+TEST_CASE("buffer_object_pool.concurrent")
+{
+    auto pool = crispy::buffer_object_pool<char>(256, 2);
+    auto threads = std::vector<std::thread> {};
+    auto failures = std::atomic<int> { 0 };
+    for (auto t = 0; t < 4; ++t)
+        threads.emplace_back([&, t]() {
+            for (auto i = 0; i < 10000; ++i)
+            {
+                auto const a = pool.allocateBufferObject(static_cast<size_t>(i % 512));
+                auto const b = pool.allocateBufferObject();
+                a->advance(1)[0] = static_cast<char>(t);
+                b->advance(1)[0] = static_cast<char>(t);
+                if (a == b || a->data()[0] != static_cast<char>(t) || b->data()[0] != static_cast<char>(t))
+                    ++failures;
+            }
+        });
+    for (auto& thread: threads)
+        thread.join();
+
+    CHECK(failures == 0);
+    auto const stats = pool.stats();
+    CHECK(stats.allocations == 80000);
+    CHECK(stats.liveBuffers == 0);
+    CHECK(stats.unusedBuffers == stats.allocations - stats.reuses);
+}
@@ -3,7 +3,10 @@
 
 #include <crispy/assert.h>
 
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cstdint>
 #include <cstring>
 #include <string>
 #include <string_view>
@@ -18,9 +21,163 @@
     #include <crispy/FNV.h>
 #endif
 
+// Byte spans are hashed using AES rounds, in hardware where the target supports it.
+#if defined(__AES__) || (defined(_MSC_VER) && defined(_M_X64))
+    #include <immintrin.h>
+    #define CRISPY_STRONGHASH_AES_X86 1
+#elif defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO)
+    #include <arm_neon.h>
+    #define CRISPY_STRONGHASH_AES_ARM 1
+#endif
+
 namespace crispy
 {
 
+namespace detail
+{
+    // {{{ AES round, used to mix the state of strong_hash_stream
+    constexpr std::array<uint8_t, 256> makeAesSubstitutionBox() noexcept
+    {
+        auto const rotl8 = [](uint8_t x, int shift) -> uint8_t {
+            return static_cast<uint8_t>((x << shift) | (x >> (8 - shift)));
+        };
+
+        // Walks the multiplicative group of GF(2^8) by 3, along with its inverse by 3^-1.
+        auto box = std::array<uint8_t, 256> {};
+        uint8_t p = 1;
+        uint8_t q = 1;
+        do
+        {
+            p = static_cast<uint8_t>(p ^ (p << 1) ^ ((p & 0x80) ? 0x1B : 0));
+            q = static_cast<uint8_t>(q ^ (q << 1));
+            q = static_cast<uint8_t>(q ^ (q << 2));
+            q = static_cast<uint8_t>(q ^ (q << 4));
+            if (q & 0x80)
+                q ^= 0x09;
+            box[p] = static_cast<uint8_t>(q ^ rotl8(q, 1) ^ rotl8(q, 2) ^ rotl8(q, 3) ^ rotl8(q, 4) ^ 0x63);
+        } while (p != 1);
+        box[0] = 0x63;
+        return box;
+    }
+
+    constexpr inline std::array<uint8_t, 256> AesSubstitutionBox = makeAesSubstitutionBox();
+
+    /// Portable implementation of a single AES encryption round, as computed by AESENC,
+    /// i.e. ShiftRows and SubBytes, followed by MixColumns, and XOR with the round key.
+    constexpr std::array<uint8_t, 16> aesRoundPortable(std::array<uint8_t, 16> const& state,
+                                                       std::array<uint8_t, 16> const& roundKey) noexcept
+    {
+        auto const times2 = [](uint8_t x) -> uint8_t {
+            return static_cast<uint8_t>((x << 1) ^ ((x & 0x80) ? 0x1B : 0));
+        };
+
+        auto result = std::array<uint8_t, 16> {};
+        for (size_t column = 0; column < 4; ++column)
+        {
+            // The state is stored column by column, and row r is rotated left by r columns.
+            uint8_t a[4];
+            for (size_t row = 0; row < 4; ++row)
+                a[row] = AesSubstitutionBox[state[row + 4 * ((column + row) % 4)]];
+
+            auto const all = static_cast<uint8_t>(a[0] ^ a[1] ^ a[2] ^ a[3]);
+            for (size_t row = 0; row < 4; ++row)
+                result[row + 4 * column] = static_cast<uint8_t>(
+                    a[row] ^ all ^ times2(static_cast<uint8_t>(a[row] ^ a[(row + 1) % 4]))
+                    ^ roundKey[row + 4 * column]);
+        }
+        return result;
+    }
+
+#if defined(CRISPY_STRONGHASH_AES_X86)
+    using hash_lane = __m128i;
+
+    inline hash_lane loadLane(void const* data) noexcept
+    {
+        return _mm_loadu_si128(static_cast<__m128i const*>(data));
+    }
+    inline void storeLane(void* target, hash_lane lane) noexcept
+    {
+        _mm_storeu_si128(static_cast<__m128i*>(target), lane);
+    }
+    inline hash_lane xorLanes(hash_lane a, hash_lane b) noexcept { return _mm_xor_si128(a, b); }
+    inline hash_lane loadLane(uint64_t low, uint64_t high) noexcept
+    {
+        return _mm_set_epi64x(static_cast<int64_t>(high), static_cast<int64_t>(low));
+    }
+    inline hash_lane aesRound(hash_lane state, hash_lane roundKey) noexcept
+    {
+        return _mm_aesenc_si128(state, roundKey);
+    }
+#elif defined(CRISPY_STRONGHASH_AES_ARM)
+    using hash_lane = uint8x16_t;
+
+    inline hash_lane loadLane(void const* data) noexcept
+    {
+        return vld1q_u8(static_cast<uint8_t const*>(data));
+    }
+    inline void storeLane(void* target, hash_lane lane) noexcept
+    {
+        vst1q_u8(static_cast<uint8_t*>(target), lane);
+    }
+    inline hash_lane xorLanes(hash_lane a, hash_lane b) noexcept { return veorq_u8(a, b); }
+    inline hash_lane loadLane(uint64_t low, uint64_t high) noexcept
+    {
+        return vreinterpretq_u8_u64(vcombine_u64(vcreate_u64(low), vcreate_u64(high)));
+    }
+    inline hash_lane aesRound(hash_lane state, hash_lane roundKey) noexcept
+    {
+        // AESE XORs the key before ShiftRows and SubBytes, hence a zero key and the XOR at the end.
+        return veorq_u8(vaesmcq_u8(vaeseq_u8(state, vdupq_n_u8(0))), roundKey);
+    }
+#else
+    using hash_lane = std::array<uint8_t, 16>;
+
+    inline hash_lane loadLane(void const* data) noexcept
+    {
+        auto lane = hash_lane {};
+        std::memcpy(lane.data(), data, lane.size());
+        return lane;
+    }
+    inline void storeLane(void* target, hash_lane const& lane) noexcept
+    {
+        std::memcpy(target, lane.data(), lane.size());
+    }
+    inline hash_lane xorLanes(hash_lane a, hash_lane const& b) noexcept
+    {
+        for (size_t i = 0; i < a.size(); ++i)
+            a[i] ^= b[i];
+        return a;
+    }
+    inline hash_lane loadLane(uint64_t low, uint64_t high) noexcept
+    {
+        auto lane = hash_lane {};
+        for (size_t i = 0; i < sizeof(uint64_t); ++i)
+        {
+            lane[i] = static_cast<uint8_t>(low >> (8 * i));
+            lane[i + sizeof(uint64_t)] = static_cast<uint8_t>(high >> (8 * i));
+        }
+        return lane;
+    }
+    inline hash_lane aesRound(hash_lane const& state, hash_lane const& roundKey) noexcept
+    {
+        return aesRoundPortable(state, roundKey);
+    }
+#endif
+
+    /// Loads @p count (at most 8) bytes in little endian order, as they would be loaded into a lane.
+    inline uint64_t loadWord(void const* data, size_t count) noexcept
+    {
+        auto word = uint64_t { 0 };
+        if constexpr (std::endian::native == std::endian::little)
+            std::memcpy(&word, data, count);
+        else
+            for (size_t i = 0; i < count; ++i)
+                word |= uint64_t { static_cast<uint8_t const*>(data)[i] } << (8 * i);
+        return word;
+    }
+    // }}}
+} // namespace detail
+
 struct strong_hash
 {
     // some random seed
@@ -70,6 +227,71 @@ struct strong_hash
 #endif
 };
 
+/**
+ * Incrementally computes a strong_hash over a sequence of byte spans.
+ *
+ * The input is absorbed in blocks of 16 bytes by AES rounds, using AES-NI on x86-64 and
+ * the ARMv8 cryptography extension where available, and a portable implementation elsewhere.
+ * All implementations produce the same hashes, which only depend on the concatenated input,
+ * not on how it was split across update() calls.
+ *
+ * The hash is meant for cache keys, it is not a cryptographic hash.
+ */
+class strong_hash_stream
+{
+  public:
+    strong_hash_stream() noexcept;
+
+    strong_hash_stream& update(void const* data, size_t size) noexcept;
+
+    template <typename T>
+    strong_hash_stream& update(std::basic_string_view<T> text) noexcept
+    {
+        // Short texts, such as the few codepoints of a grid cell, are appended one character at a time.
+        if (text.size() * sizeof(T) >= BlockSize)
+            return update(text.data(), text.size() * sizeof(T));
+        for (T const ch: text)
+            update(ch);
+        return *this;
+    }
+
+    /// Mixes in the object representation of @p value, which therefore must not contain padding.
+    template <typename T>
+    strong_hash_stream& update(T const& value) noexcept
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if constexpr (sizeof(T) <= sizeof(uint64_t))
+        {
+            _totalSize += sizeof(T);
+            append(detail::loadWord(&value, sizeof(T)), sizeof(T));
+            return *this;
+        }
+        else
+            return update(&value, sizeof(value));
+    }
+
+    /// @returns the hash of all input so far. The stream can be continued afterwards.
+    [[nodiscard]] strong_hash finish() const noexcept;
+
+  private:
+    static constexpr size_t BlockSize = 16;
+
+    static void absorb(detail::hash_lane& first, detail::hash_lane& second, detail::hash_lane block) noexcept;
+
+    /// Appends the lowest @p count (at most 8) bytes of @p word to the pending block.
+    void append(uint64_t word, size_t count) noexcept;
+
+    detail::hash_lane _first;
+    detail::hash_lane _second;
+
+    // The pending block is kept in two words rather than in memory, so that
+    // small updates neither copy through memory nor stall reloading it.
+    uint64_t _pendingLow = 0;
+    uint64_t _pendingHigh = 0;
+    size_t _pendingSize = 0;
+    uint64_t _totalSize = 0;
+};
+
 inline strong_hash::strong_hash(uint32_t a, uint32_t b, uint32_t c, uint32_t d) noexcept:
 #if defined(STRONGHASH_USE_INTRINSICS)
     strong_hash(Intrinsics::xor128(Intrinsics::load32(a, b, c, d),
@@ -128,21 +350,13 @@ inline strong_hash operator*(strong_hash a, uint32_t b) noexcept
 template <typename T>
 strong_hash strong_hash::compute(std::basic_string_view<T> text) noexcept
 {
-    // return compute(value.data(), value.size());
-    auto hash = strong_hash(0, 0, 0, static_cast<uint32_t>(text.size()));
-    for (auto const codepoint: text)
-        hash = hash * codepoint; // StrongHash(0, 0, 0, static_cast<uint32_t>(codepoint));
-    return hash;
+    return strong_hash_stream {}.update(text).finish();
 }
 
 template <typename T, typename Alloc>
 strong_hash strong_hash::compute(std::basic_string<T, Alloc> const& text) noexcept
 {
-    // return compute(value.data(), value.size());
-    auto hash = strong_hash(0, 0, 0, static_cast<uint32_t>(text.size()));
-    for (T const codepoint: text)
-        hash = hash * static_cast<uint32_t>(codepoint);
-    return hash;
+    return compute(std::basic_string_view<T>(text));
 }
 
 template <typename T>
@@ -153,52 +367,112 @@ strong_hash strong_hash::compute(T const& value) noexcept
 
 inline strong_hash strong_hash::compute(void const* data, size_t n) noexcept
 {
-#if defined(STRONGHASH_USE_INTRINSICS)
-    static_assert(sizeof(__m128i) == 16);
-    auto constexpr ChunkSize = static_cast<int>(sizeof(__m128i));
+    return strong_hash_stream {}.update(data, n).finish();
+}
+
+// {{{ strong_hash_stream implementation
+namespace detail
+{
+    // Initial states and round keys, some random numbers.
+    constexpr inline std::array<uint8_t, 16> StrongHashStreamSeed = {
+        0x24, 0x3f, 0x6a, 0x88, 0x85, 0xa3, 0x08, 0xd3, 0x13, 0x19, 0x8a, 0x2e, 0x03, 0x70, 0x73, 0x44,
+    };
+    constexpr inline std::array<uint8_t, 16> StrongHashStreamKey = {
+        0xa4, 0x09, 0x38, 0x22, 0x29, 0x9f, 0x31, 0xd0, 0x08, 0x2e, 0xfa, 0x98, 0xec, 0x4e, 0x6c, 0x89,
+    };
+    constexpr inline std::array<uint8_t, 16> StrongHashStreamFinalKey = {
+        0x45, 0x28, 0x21, 0xe6, 0x38, 0xd0, 0x13, 0x77, 0xbe, 0x54, 0x66, 0xcf, 0x34, 0xe9, 0x0c, 0x6c,
+    };
+} // namespace detail
 
-    __m128i hashValue = Intrinsics::cvtsi64_si128(static_cast<long long>(n));
-    hashValue = Intrinsics::xor128(hashValue, Intrinsics::loadUnaligned((__m128i const*) defaultSeed.data()));
+inline strong_hash_stream::strong_hash_stream() noexcept:
+    _first { detail::loadLane(strong_hash::DefaultSeed.data()) },
+    _second { detail::loadLane(detail::StrongHashStreamSeed.data()) }
+{
+}
 
-    char const* inputPtr = (char const*) data;
-    for (int chunkIndex = 0; chunkIndex < static_cast<int>(n) / ChunkSize; chunkIndex++)
+inline void strong_hash_stream::absorb(detail::hash_lane& first,
+                                       detail::hash_lane& second,
+                                       detail::hash_lane block) noexcept
+{
+    // The two lanes absorb the block differently, so that a difference in one block
+    // cannot simply be cancelled out by the next block in both of them.
+    first = detail::aesRound(first, block);
+    second = detail::aesRound(detail::xorLanes(second, block),
+                              detail::loadLane(detail::StrongHashStreamKey.data()));
+}
+
+inline void strong_hash_stream::append(uint64_t word, size_t count) noexcept
+{
+    auto const shift = 8 * (_pendingSize % sizeof(uint64_t));
+    if (_pendingSize < sizeof(uint64_t))
     {
-        auto chunk = Intrinsics::loadUnaligned((Intrinsics::m128i const*) inputPtr);
+        _pendingLow |= word << shift;
+        if (shift)
+            _pendingHigh |= word >> (64 - shift);
+    }
+    else
+        _pendingHigh |= word << shift;
 
-        hashValue = Intrinsics::xor128(hashValue, chunk);
-        hashValue = Intrinsics::aesdec(hashValue, Intrinsics::setzero());
-        hashValue = Intrinsics::aesdec(hashValue, Intrinsics::setzero());
-        hashValue = Intrinsics::aesdec(hashValue, Intrinsics::setzero());
-        hashValue = Intrinsics::aesdec(hashValue, Intrinsics::setzero());
+    _pendingSize += count;
+    if (_pendingSize >= BlockSize)
+    {
+        absorb(_first, _second, detail::loadLane(_pendingLow, _pendingHigh));
 
-        inputPtr += ChunkSize;
+        // The bytes not fitting into the block anymore are carried over into the next one.
+        _pendingSize -= BlockSize;
+        _pendingLow = _pendingSize ? word >> (8 * (count - _pendingSize)) : 0;
+        _pendingHigh = 0;
     }
+}
+
+inline strong_hash_stream& strong_hash_stream::update(void const* data, size_t size) noexcept
+{
+    auto const* input = static_cast<uint8_t const*>(data);
+    _totalSize += size;
 
-    auto const remainingByteCount = n % ChunkSize;
-    if (remainingByteCount)
+    while (size)
     {
-        char lastChunk[ChunkSize] { 0 };
-        std::memcpy(lastChunk + ChunkSize - remainingByteCount, inputPtr, remainingByteCount);
-        __m128i chunk = Intrinsics::loadUnaligned((__m128i*) lastChunk);
-        hashValue = Intrinsics::xor128(hashValue, chunk);
-        hashValue = Intrinsics::aesdec(hashValue, Intrinsics::setzero());
-        hashValue = Intrinsics::aesdec(hashValue, Intrinsics::setzero());
-        hashValue = Intrinsics::aesdec(hashValue, Intrinsics::setzero());
-        hashValue = Intrinsics::aesdec(hashValue, Intrinsics::setzero());
+        if (!_pendingSize && size >= BlockSize)
+        {
+            absorb(_first, _second, detail::loadLane(input));
+            input += BlockSize;
+            size -= BlockSize;
+            continue;
+        }
+
+        auto const count = std::min({ size, sizeof(uint64_t), BlockSize - _pendingSize });
+        append(detail::loadWord(input, count), count);
+        input += count;
+        size -= count;
     }
+    return *this;
+}
 
-    return strong_hash { hashValue };
-#else
-    auto const* i = (uint8_t const*) data;
-    auto const* e = i + n;
-    auto const result = fnv<uint8_t, uint64_t>()(i, e);
-    auto constexpr A = 0;
-    auto constexpr B = 0;
-    auto const c = static_cast<uint32_t>((result >> 32) & 0xFFFFFFFFu);
-    auto const d = static_cast<uint32_t>(result & 0xFFFFFFFFu);
-    return strong_hash { A, B, c, d };
-#endif
+inline strong_hash strong_hash_stream::finish() const noexcept
+{
+    auto first = _first;
+    auto second = _second;
+
+    // The pending block is zero padded. The total size then tells apart inputs that
+    // only differ by that padding.
+    if (_pendingSize)
+        absorb(first, second, detail::loadLane(_pendingLow, _pendingHigh));
+    absorb(first, second, detail::loadLane(_totalSize, 0));
+
+    // Both lanes are diffused over all of their bytes before being combined, as otherwise their
+    // differences from the very same input byte may cancel each other out.
+    auto const key = detail::loadLane(detail::StrongHashStreamKey.data());
+    auto const finalKey = detail::loadLane(detail::StrongHashStreamFinalKey.data());
+    first = detail::aesRound(detail::aesRound(first, key), finalKey);
+    second = detail::aesRound(detail::aesRound(second, finalKey), key);
+    auto const result = detail::aesRound(detail::aesRound(detail::xorLanes(first, second), key), finalKey);
+
+    auto hash = strong_hash {};
+    detail::storeLane(&hash.value, result);
+    return hash;
 }
+// }}}
 
 inline std::string to_string(strong_hash const& hash)
 {
@@ -0,0 +1,761 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <crispy/StrongHash.h>
+#include <crispy/StrongLRUHashtable.h>
+#include <crispy/assert.h>
+#include <crispy/utils.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_AMD64)
+    #include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+#endif
+
+namespace crispy
+{
+
+// {{{ details
+namespace detail
+{
+    /// Bit mask of the matching control bytes within a group, iterated from the first to the last match.
+    ///
+    /// Each control byte is represented by 1 << Shift bits, of which only the lowest one may be set.
+    template <int Shift>
+    struct group_match
+    {
+        uint64_t mask;
+
+        explicit operator bool() const noexcept { return mask != 0; }
+
+        [[nodiscard]] uint32_t first() const noexcept
+        {
+            return static_cast<uint32_t>(std::countr_zero(mask)) >> Shift;
+        }
+
+        void dropFirst() noexcept { mask &= mask - 1; }
+    };
+
+    /// A group of 16 control bytes of strong_lru_flat_hashtable, probed at once.
+    struct control_group
+    {
+        static constexpr uint32_t Width = 16;
+
+        static constexpr uint8_t Empty = 0x80;
+        static constexpr uint8_t Deleted = 0xFE;
+
+#if defined(__SSE2__) || defined(__x86_64__) || defined(_M_AMD64)
+        using match = group_match<0>;
+
+        explicit control_group(uint8_t const* controls) noexcept:
+            bytes { _mm_loadu_si128(reinterpret_cast<__m128i const*>(controls)) }
+        {
+        }
+
+        [[nodiscard]] match matching(uint8_t value) const noexcept
+        {
+            return match { static_cast<uint32_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(value))))) };
+        }
+
+        // Empty and deleted control bytes are the only ones with the highest bit set.
+        [[nodiscard]] match emptyOrDeleted() const noexcept
+        {
+            return match { static_cast<uint32_t>(_mm_movemask_epi8(bytes)) };
+        }
+
+        __m128i bytes;
+#elif defined(__aarch64__) || defined(_M_ARM64)
+        using match = group_match<2>;
+
+        explicit control_group(uint8_t const* controls) noexcept: bytes { vld1q_u8(controls) } {}
+
+        [[nodiscard]] match matching(uint8_t value) const noexcept
+        {
+            return toMatch(vceqq_u8(bytes, vdupq_n_u8(value)));
+        }
+
+        [[nodiscard]] match emptyOrDeleted() const noexcept
+        {
+            return toMatch(vcltzq_s8(vreinterpretq_s8_u8(bytes)));
+        }
+
+        // Narrows each 8-bit lane to 4 bits, yielding a 64-bit mask with one nibble per byte.
+        static match toMatch(uint8x16_t lanes) noexcept
+        {
+            auto const nibbles =
+                vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(lanes), 4)), 0);
+            return match { nibbles & 0x1111111111111111ull };
+        }
+
+        uint8x16_t bytes;
+#else
+        using match = group_match<0>;
+
+        explicit control_group(uint8_t const* controls) noexcept
+        {
+            std::copy_n(controls, Width, bytes);
+        }
+
+        [[nodiscard]] match matching(uint8_t value) const noexcept
+        {
+            auto mask = uint64_t { 0 };
+            for (uint32_t i = 0; i < Width; ++i)
+                mask |= uint64_t { bytes[i] == value } << i;
+            return match { mask };
+        }
+
+        [[nodiscard]] match emptyOrDeleted() const noexcept
+        {
+            auto mask = uint64_t { 0 };
+            for (uint32_t i = 0; i < Width; ++i)
+                mask |= uint64_t { (bytes[i] & 0x80) != 0 } << i;
+            return match { mask };
+        }
+
+        uint8_t bytes[Width];
+#endif
+
+        [[nodiscard]] match empty() const noexcept { return matching(Empty); }
+    };
+} // namespace detail
+// }}}
+
+/**
+ * Alternative to strong_lru_hashtable, using open addressing and an approximated LRU order.
+ *
+ * Hash keys are looked up in a Swiss-table-style array of control bytes, probing groups of
+ * 16 of them at once (using SSE2 or NEON, if available) for 7 bits of the hash key, rather than
+ * following chains of entries with the same hash slot. The entries themselves are stored in a flat
+ * array, such that their indices are stable and between 1 and the capacity inclusive,
+ * as with strong_lru_hashtable.
+ *
+ * Instead of relinking a list on each access, accessed entries are merely marked as referenced.
+ * Once full, entries are evicted in CLOCK order: the first entry after the previously evicted one
+ * not referenced since its last visit is evicted, clearing the marks of those visited before.
+ * Hence, evicted entries are not necessarily the least recently used ones, so this hashtable
+ * must not be used where evicting an entry that is in use breaks correctness.
+ *
+ * The public interface matches the one of strong_lru_hashtable, such that caches can choose
+ * either implementation.
+ */
+template <typename Value>
+class strong_lru_flat_hashtable
+{
+  private:
+    strong_lru_flat_hashtable(strong_hashtable_size hashCount, lru_capacity entryCount, std::string name);
+
+  public:
+    using ptr = std::unique_ptr<strong_lru_flat_hashtable>;
+
+    [[nodiscard]] static ptr create(strong_hashtable_size hashCount,
+                                    lru_capacity entryCount,
+                                    std::string name = "");
+
+    /// Returns the actual number of entries currently hold in this hashtable.
+    [[nodiscard]] size_t size() const noexcept { return _size; }
+
+    /// Returns the maximum number of entries that can be stored in this hashtable.
+    [[nodiscard]] size_t capacity() const noexcept { return _capacity.value; }
+
+    /// Returns the total storage sized used by this object.
+    [[nodiscard]] size_t storageSize() const noexcept;
+
+    /// Returns gathered stats and clears the local stats state to start
+    /// counting from zero again.
+    lru_hashtable_stats fetchAndClearStats() noexcept;
+
+    /// Clears all entries from the hashtable.
+    void clear();
+
+    // Deletes the hash entry and its associated value from the LRU hashtable
+    void remove(strong_hash const& hash);
+
+    /// Evicts all entries not referenced since the CLOCK hand has passed them or since the last trim,
+    /// and clears the marks of the remaining ones, such that the next trim evicts those not referenced
+    /// until then. This is meant to release the memory of cold entries, e.g. when running low on memory.
+    ///
+    /// @returns the number of evicted entries.
+    size_t trim();
+
+    /// Touches a given hash key, marking it as recently used.
+    /// Nothing is done if the hash key was not found.
+    void touch(strong_hash const& hash) noexcept;
+
+    /// Returns the list of keys in this hash, the ones referenced since the last eviction first.
+    [[nodiscard]] std::vector<strong_hash> hashes() const;
+
+    /// Tests for the exitence of the given hash key in this hash table.
+    [[nodiscard]] bool contains(strong_hash const& hash) const noexcept;
+
+    /// Returns the value for the given hash key if found, nullptr otherwise.
+    [[nodiscard]] Value* try_get(strong_hash const& hash) noexcept;
+    [[nodiscard]] Value const* try_get(strong_hash const& hash) const noexcept;
+
+    /// Returns the value for the given hash key,
+    /// throwing std::out_of_range if hash key was not found.
+    [[nodiscard]] Value& at(strong_hash const& hash);
+
+    /// like at() but does not mark the entry as recently used.
+    [[nodiscard]] Value& peek(strong_hash const& hash);
+    [[nodiscard]] Value const& peek(strong_hash const& hash) const;
+
+    /// Returns the value for the given hash key, default-constructing it in case
+    /// if it wasn't in the hashtable just yet.
+    [[nodiscard]] Value& operator[](strong_hash const& hash) noexcept;
+
+    /// Assignes the given value to the given hash key.
+    /// If the hash key was not found, it is being created,
+    /// otherwise the value will be re-assigned with the new value.
+    Value& emplace(strong_hash const& hash, Value value) noexcept;
+
+    template <typename ValueConstructFn>
+    Value& emplace(strong_hash const& hash, ValueConstructFn constructValue) noexcept;
+
+    /// Conditionally creates a new item to the LRU-Cache iff its hash key
+    /// was not present yet.
+    ///
+    /// @retval true the hash key did not exist in hashtable yet, a new value was constructed.
+    /// @retval false The hash key is already in the hashtable, no entry was constructed.
+    template <typename ValueConstructFn>
+    [[nodiscard]] bool try_emplace(strong_hash const& hash, ValueConstructFn constructValue);
+
+    /// Always returns either the existing item by the given hash key, if found,
+    /// or a newly created one by invoking constructValue().
+    template <typename ValueConstructFn>
+    [[nodiscard]] Value& get_or_emplace(strong_hash const& hash, ValueConstructFn constructValue);
+
+    /// Like get_or_emplace but allows failure in @p constructValue call to cause the hash entry not
+    /// to be created, returning nullptr instead.
+    template <typename ValueConstructFn>
+    [[nodiscard]] Value* get_or_try_emplace(strong_hash const& hash, ValueConstructFn constructValue);
+
+    /// Retrieves the value stored at the given entry index.
+    [[nodiscard]] Value& valueAtEntryIndex(uint32_t entryIndex) noexcept
+    {
+        return *_entries[entryIndex].value;
+    }
+
+    /// Retrieves the value stored at the given entry index.
+    [[nodiscard]] Value const& valueAtEntryIndex(uint32_t entryIndex) const noexcept
+    {
+        return *_entries[entryIndex].value;
+    }
+
+    void inspect(std::ostream& output) const;
+
+  private:
+    using group = detail::control_group;
+
+    struct entry
+    {
+        strong_hash hashValue {};
+        uint32_t slot = 0;
+        std::optional<Value> value = std::nullopt;
+    };
+
+    struct probe
+    {
+        uint32_t group; // index of the first slot of the group
+        uint8_t control;
+    };
+
+    [[nodiscard]] probe probeStart(strong_hash const& hash) const noexcept;
+
+    // Returns the index of the entry with the given hash key, or 0 if not found.
+    [[nodiscard]] uint32_t findEntry(strong_hash const& hash) const noexcept;
+
+    // Returns the index of the entry with the given hash key, marking it as referenced,
+    // or if not found and force is set to true, the index of a newly created entry with a
+    // default-constructed value, otherwise 0.
+    [[nodiscard]] uint32_t lookup(strong_hash const& hash, bool force);
+
+    // Returns the index of an unused entry, evicting one if the hashtable is full,
+    // after having inserted it with the given hash key into the table.
+    [[nodiscard]] uint32_t allocateEntry(strong_hash const& hash);
+
+    // Evicts the next entry in CLOCK order and returns its index.
+    // Requires the hashtable to be full.
+    [[nodiscard]] uint32_t recycle();
+
+    void markReferenced(uint32_t entryIndex) noexcept
+    {
+        _referenced[(entryIndex - 1) / 64] |= uint64_t { 1 } << ((entryIndex - 1) % 64);
+    }
+
+    [[nodiscard]] bool isReferenced(uint32_t entryIndex) const noexcept
+    {
+        return (_referenced[(entryIndex - 1) / 64] >> ((entryIndex - 1) % 64)) & 1;
+    }
+
+    void insertSlot(uint32_t entryIndex);
+    void eraseSlot(uint32_t slot) noexcept;
+
+    // Reinserts all entries, dropping the tombstones left behind by erased slots.
+    void rehash();
+
+    lru_hashtable_stats _stats {};
+    uint32_t _slotMask;
+    uint32_t _size = 0;
+    uint32_t _tombstones = 0;
+    uint32_t _clockHand = 0; // position of the entry to be visited next for eviction, counting from 0
+    lru_capacity _capacity;
+    std::string _name;
+
+    std::vector<uint8_t> _controls;     // per slot: Empty, Deleted, or 7 bits of the hash key
+    std::vector<uint32_t> _slotEntries; // per slot: index of the entry it is occupied by
+    std::vector<entry> _entries;        // indexed from 1 to the capacity; the first one is unused
+    std::vector<uint32_t> _freeEntries; // indices of the unused entries
+
+    // Marks of the entries referenced since the CLOCK hand visited them last, one bit per entry.
+    // Kept apart from the entries, such that evictions sweep over them without touching the entries.
+    std::vector<uint64_t> _referenced;
+};
+
+// {{{ implementation
+
+template <typename Value>
+strong_lru_flat_hashtable<Value>::strong_lru_flat_hashtable(strong_hashtable_size hashCount,
+                                                            lru_capacity entryCount,
+                                                            std::string name):
+    _slotMask { std::max({ std::bit_ceil(hashCount.value),
+                           std::bit_ceil(entryCount.value + entryCount.value / 7 + 1),
+                           group::Width })
+                - 1 },
+    _capacity { entryCount },
+    _name { std::move(name) },
+    _controls(size_t { _slotMask } + 1, group::Empty),
+    _slotEntries(size_t { _slotMask } + 1, 0),
+    _entries(size_t { entryCount.value } + 1),
+    _referenced((size_t { entryCount.value } + 63) / 64, 0)
+{
+    Require(entryCount.value >= 2);
+
+    _freeEntries.reserve(entryCount.value);
+    for (uint32_t entryIndex = entryCount.value; entryIndex >= 1; --entryIndex)
+        _freeEntries.push_back(entryIndex);
+}
+
+template <typename Value>
+auto strong_lru_flat_hashtable<Value>::create(strong_hashtable_size hashCount,
+                                              lru_capacity entryCount,
+                                              std::string name) -> ptr
+{
+    return ptr(new strong_lru_flat_hashtable(hashCount, entryCount, std::move(name)));
+}
+
+template <typename Value>
+size_t strong_lru_flat_hashtable<Value>::storageSize() const noexcept
+{
+    return sizeof(strong_lru_flat_hashtable) + _controls.size() * sizeof(uint8_t)
+           + _slotEntries.size() * sizeof(uint32_t) + _entries.size() * sizeof(entry)
+           + _freeEntries.capacity() * sizeof(uint32_t) + _referenced.size() * sizeof(uint64_t);
+}
+
+template <typename Value>
+lru_hashtable_stats strong_lru_flat_hashtable<Value>::fetchAndClearStats() noexcept
+{
+    auto st = _stats;
+    _stats = lru_hashtable_stats {};
+    return st;
+}
+
+template <typename Value>
+void strong_lru_flat_hashtable<Value>::clear()
+{
+    for (auto& entry: _entries)
+        entry = {};
+    std::fill(_controls.begin(), _controls.end(), group::Empty);
+    std::fill(_referenced.begin(), _referenced.end(), 0);
+    _freeEntries.clear();
+    for (uint32_t entryIndex = _capacity.value; entryIndex >= 1; --entryIndex)
+        _freeEntries.push_back(entryIndex);
+    _size = 0;
+    _tombstones = 0;
+    _clockHand = 0;
+}
+
+template <typename Value>
+void strong_lru_flat_hashtable<Value>::remove(strong_hash const& hash)
+{
+    auto const entryIndex = findEntry(hash);
+    if (!entryIndex)
+        return;
+
+    auto& entry = _entries[entryIndex];
+    eraseSlot(entry.slot);
+    entry = {};
+    _freeEntries.push_back(entryIndex);
+    --_size;
+}
+
+template <typename Value>
+size_t strong_lru_flat_hashtable<Value>::trim()
+{
+    auto trimmed = size_t { 0 };
+    for (uint32_t entryIndex = 1; entryIndex <= _capacity.value; ++entryIndex)
+    {
+        auto& entry = _entries[entryIndex];
+        if (!entry.value || isReferenced(entryIndex))
+            continue;
+
+        eraseSlot(entry.slot);
+        entry = {};
+        _freeEntries.push_back(entryIndex);
+        --_size;
+        ++trimmed;
+    }
+    std::fill(_referenced.begin(), _referenced.end(), 0);
+    return trimmed;
+}
+
+template <typename Value>
+inline void strong_lru_flat_hashtable<Value>::touch(strong_hash const& hash) noexcept
+{
+    (void) lookup(hash, false);
+}
+
+template <typename Value>
+std::vector<strong_hash> strong_lru_flat_hashtable<Value>::hashes() const
+{
+    auto result = std::vector<strong_hash> {};
+    result.reserve(_size);
+    for (auto const referenced: { true, false })
+        for (uint32_t i = 0; i < _capacity.value; ++i)
+        {
+            // Starting with the entry to be evicted last.
+            auto const entryIndex = 1 + (_clockHand + _capacity.value - 1 - i) % _capacity.value;
+            auto const& entry = _entries[entryIndex];
+            if (entry.value && isReferenced(entryIndex) == referenced)
+                result.emplace_back(entry.hashValue);
+        }
+    Guarantee(result.size() == _size);
+    return result;
+}
+
+template <typename Value>
+inline bool strong_lru_flat_hashtable<Value>::contains(strong_hash const& hash) const noexcept
+{
+    return const_cast<strong_lru_flat_hashtable*>(this)->lookup(hash, false) != 0;
+}
+
+template <typename Value>
+inline Value* strong_lru_flat_hashtable<Value>::try_get(strong_hash const& hash) noexcept
+{
+    auto const entryIndex = lookup(hash, false);
+    if (!entryIndex)
+        return nullptr;
+    return &_entries[entryIndex].value.value();
+}
+
+template <typename Value>
+inline Value const* strong_lru_flat_hashtable<Value>::try_get(strong_hash const& hash) const noexcept
+{
+    return const_cast<strong_lru_flat_hashtable*>(this)->try_get(hash);
+}
+
+template <typename Value>
+inline Value& strong_lru_flat_hashtable<Value>::at(strong_hash const& hash)
+{
+    auto const entryIndex = lookup(hash, false);
+    if (!entryIndex)
+        throw std::out_of_range("hash not in table");
+    return *_entries[entryIndex].value;
+}
+
+template <typename Value>
+inline Value& strong_lru_flat_hashtable<Value>::peek(strong_hash const& hash)
+{
+    auto const entryIndex = findEntry(hash);
+    if (!entryIndex)
+        throw std::out_of_range("hash");
+    return *_entries[entryIndex].value;
+}
+
+template <typename Value>
+inline Value const& strong_lru_flat_hashtable<Value>::peek(strong_hash const& hash) const
+{
+    return const_cast<strong_lru_flat_hashtable*>(this)->peek(hash);
+}
+
+template <typename Value>
+inline Value& strong_lru_flat_hashtable<Value>::operator[](strong_hash const& hash) noexcept
+{
+    return *_entries[lookup(hash, true)].value;
+}
+
+template <typename Value>
+inline Value& strong_lru_flat_hashtable<Value>::emplace(strong_hash const& hash, Value value) noexcept
+{
+    return *_entries[lookup(hash, true)].value = std::move(value);
+}
+
+template <typename Value>
+template <typename ValueConstructFn>
+Value& strong_lru_flat_hashtable<Value>::emplace(strong_hash const& hash,
+                                                 ValueConstructFn constructValue) noexcept
+{
+    auto const entryIndex = lookup(hash, true);
+    _entries[entryIndex].value.emplace(constructValue(entryIndex));
+    return *_entries[entryIndex].value;
+}
+
+template <typename Value>
+template <typename ValueConstructFn>
+inline bool strong_lru_flat_hashtable<Value>::try_emplace(strong_hash const& hash,
+                                                          ValueConstructFn constructValue)
+{
+    if (contains(hash))
+        return false;
+
+    auto const entryIndex = allocateEntry(hash);
+    _entries[entryIndex].value.emplace(constructValue(entryIndex));
+    return true;
+}
+
+template <typename Value>
+template <typename ValueConstructFn>
+inline Value& strong_lru_flat_hashtable<Value>::get_or_emplace(strong_hash const& hash,
+                                                               ValueConstructFn constructValue)
+{
+    if (auto const entryIndex = lookup(hash, false))
+        return *_entries[entryIndex].value;
+
+    auto const entryIndex = allocateEntry(hash);
+    _entries[entryIndex].value.emplace(constructValue(entryIndex)); // TODO: not yet exception safe
+    return *_entries[entryIndex].value;
+}
+
+template <typename Value>
+template <typename ValueConstructFn>
+inline Value* strong_lru_flat_hashtable<Value>::get_or_try_emplace(strong_hash const& hash,
+                                                                   ValueConstructFn constructValue)
+{
+    if (auto const entryIndex = lookup(hash, false))
+        return &_entries[entryIndex].value.value();
+
+    auto const entryIndex = allocateEntry(hash);
+    std::optional<Value> constructedValue = constructValue(entryIndex);
+    if (!constructedValue)
+    {
+        remove(hash);
+        return nullptr;
+    }
+
+    // The entries never move, even if constructValue() inserted further ones.
+    auto& result = _entries[entryIndex].value;
+    result = std::move(constructedValue);
+    return &result.value();
+}
+
+template <typename Value>
+void strong_lru_flat_hashtable<Value>::inspect(std::ostream& output) const
+{
+    auto const humanReadableUtiliation = [](auto a, auto b) -> std::string {
+        auto const dr = (static_cast<double>(a) / static_cast<double>(b)) * 100.0;
+        if (dr >= 99.99)
+            return "100%";
+        else
+            return fmt::format("{:.02}%", dr);
+    };
+
+    auto const slotCount = _slotMask + 1;
+    output << fmt::format("=============================================================\n");
+    output << fmt::format("Hashtale: {}\n", _name);
+    output << fmt::format("-------------------------------------------------------------\n");
+    output << fmt::format("stats               : {}\n", _stats);
+    output << fmt::format("hash table capacity : {} ({} utilization, {} tombstones)\n",
+                          slotCount,
+                          humanReadableUtiliation(_size, slotCount),
+                          _tombstones);
+    output << fmt::format("entry count         : {}\n", _size);
+    output << fmt::format("entry capacity      : {} ({} utilization)\n",
+                          _capacity.value,
+                          humanReadableUtiliation(_size, _capacity.value));
+    output << fmt::format("-------------------------------------------------------------\n");
+}
+
+// {{{ helpers
+template <typename Value>
+inline auto strong_lru_flat_hashtable<Value>::probeStart(strong_hash const& hash) const noexcept -> probe
+{
+    // Spreads low entropy hash keys, such as small integers, over both slots and control bytes.
+    auto const mixed = hash.d() * 0x9E3779B1u;
+    return probe { (mixed & _slotMask) & ~(group::Width - 1), static_cast<uint8_t>(mixed >> 25) };
+}
+
+template <typename Value>
+uint32_t strong_lru_flat_hashtable<Value>::findEntry(strong_hash const& hash) const noexcept
+{
+    auto [groupStart, control] = probeStart(hash);
+    for (uint32_t step = group::Width;; step += group::Width)
+    {
+        auto const candidates = group(_controls.data() + groupStart);
+        for (auto match = candidates.matching(control); match; match.dropFirst())
+        {
+            auto const entryIndex = _slotEntries[groupStart + match.first()];
+            if (_entries[entryIndex].hashValue == hash)
+                return entryIndex;
+        }
+
+        // Inserting never skips a group with empty slots; hence, the hash key is not stored beyond.
+        if (candidates.empty() || step > _slotMask)
+            return 0;
+
+        // Triangular probing, visiting every group once.
+        groupStart = (groupStart + step) & _slotMask;
+    }
+}
+
+template <typename Value>
+uint32_t strong_lru_flat_hashtable<Value>::lookup(strong_hash const& hash, bool force)
+{
+    if (auto const entryIndex = findEntry(hash))
+    {
+        ++_stats.hits;
+        markReferenced(entryIndex);
+        return entryIndex;
+    }
+
+    ++_stats.misses;
+    if (!force)
+        return 0;
+
+    auto const entryIndex = allocateEntry(hash);
+    _entries[entryIndex].value.emplace();
+    return entryIndex;
+}
+
+template <typename Value>
+uint32_t strong_lru_flat_hashtable<Value>::allocateEntry(strong_hash const& hash)
+{
+    auto entryIndex = uint32_t { 0 };
+    if (_freeEntries.empty())
+        entryIndex = recycle();
+    else
+    {
+        entryIndex = _freeEntries.back();
+        _freeEntries.pop_back();
+        ++_size;
+    }
+
+    auto& entry = _entries[entryIndex];
+    entry.hashValue = hash;
+    entry.value.reset();
+    markReferenced(entryIndex);
+    insertSlot(entryIndex);
+    return entryIndex;
+}
+
+template <typename Value>
+uint32_t strong_lru_flat_hashtable<Value>::recycle()
+{
+    Require(_size == _capacity.value);
+
+    // Sweeps over the marks a word at a time, clearing those of the referenced entries passed by.
+    while (true)
+    {
+        auto const wordIndex = _clockHand / 64;
+        auto const remainingBits = _capacity.value - (wordIndex * 64);
+        auto const validBits = remainingBits >= 64 ? ~uint64_t { 0 } : (uint64_t { 1 } << remainingBits) - 1;
+        auto const visited = (~uint64_t { 0 } << (_clockHand % 64)) & validBits;
+        auto& marks = _referenced[wordIndex];
+
+        if (auto const candidates = ~marks & visited)
+        {
+            auto const position = static_cast<uint32_t>(std::countr_zero(candidates));
+            marks &= ~(visited & ((uint64_t { 1 } << position) - 1));
+            auto const entryIndex = wordIndex * 64 + position + 1;
+            _clockHand = entryIndex % _capacity.value;
+
+            auto& entry = _entries[entryIndex];
+            eraseSlot(entry.slot);
+            entry.value.reset();
+            ++_stats.recycles;
+            return entryIndex;
+        }
+
+        marks &= ~visited;
+        _clockHand = (wordIndex + 1) * 64;
+        if (_clockHand >= _capacity.value)
+            _clockHand = 0;
+    }
+}
+
+template <typename Value>
+void strong_lru_flat_hashtable<Value>::insertSlot(uint32_t entryIndex)
+{
+    // Keeps the number of tombstones low enough to not degrade misses into scanning the whole table.
+    if (_tombstones > (_slotMask + 1) / 8)
+        rehash();
+
+    auto& entry = _entries[entryIndex];
+    auto [groupStart, control] = probeStart(entry.hashValue);
+    for (uint32_t step = group::Width;; step += group::Width)
+    {
+        if (auto const match = group(_controls.data() + groupStart).emptyOrDeleted())
+        {
+            auto const slot = groupStart + match.first();
+            if (_controls[slot] == group::Deleted)
+                --_tombstones;
+            _controls[slot] = control;
+            _slotEntries[slot] = entryIndex;
+            entry.slot = slot;
+            return;
+        }
+
+        // The table holds fewer entries than slots, so there is always some free slot.
+        Require(step <= _slotMask);
+        groupStart = (groupStart + step) & _slotMask;
+    }
+}
+
+template <typename Value>
+void strong_lru_flat_hashtable<Value>::eraseSlot(uint32_t slot) noexcept
+{
+    // A group with empty slots never made an insertion skip it, so the slot may become empty again.
+    // Otherwise, lookups must continue probing beyond, which a tombstone tells them to do.
+    auto const groupStart = slot & ~(group::Width - 1);
+    if (group(_controls.data() + groupStart).empty())
+        _controls[slot] = group::Empty;
+    else
+    {
+        _controls[slot] = group::Deleted;
+        ++_tombstones;
+    }
+}
+
+template <typename Value>
+void strong_lru_flat_hashtable<Value>::rehash()
+{
+    // Entries may be stored while their values are yet to be constructed, so the slots tell which are.
+    auto storedEntries = std::vector<uint32_t> {};
+    storedEntries.reserve(_size);
+    for (uint32_t slot = 0; slot <= _slotMask; ++slot)
+        if (!(_controls[slot] & 0x80))
+            storedEntries.push_back(_slotEntries[slot]);
+
+    std::fill(_controls.begin(), _controls.end(), group::Empty);
+    _tombstones = 0;
+    for (auto const entryIndex: storedEntries)
+        insertSlot(entryIndex);
+}
+// }}}
+
+// }}}
+
+} // namespace crispy
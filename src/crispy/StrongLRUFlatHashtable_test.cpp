@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/StrongHash.h>
+#include <crispy/StrongLRUFlatHashtable.h>
+#include <crispy/StrongLRUHashtable.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <vector>
+
+using namespace crispy;
+using namespace std;
+
+namespace
+{
+strong_hash h(int v)
+{
+    return strong_hash(0, 0, 0, static_cast<uint32_t>(v));
+}
+
+// Differs from h() only in the components that are not used for probing.
+strong_hash collidingHash(int v)
+{
+    return strong_hash(0, 0, static_cast<uint32_t>(v), 0);
+}
+
+vector<uint32_t> sortedHashes(strong_lru_flat_hashtable<int> const& cache)
+{
+    auto result = vector<uint32_t> {};
+    for (auto const& hash: cache.hashes())
+        result.push_back(hash.d());
+    std::sort(result.begin(), result.end());
+    return result;
+}
+} // namespace
+
+TEST_CASE("strong_lru_flat_hashtable.operator_index")
+{
+    auto cachePtr = strong_lru_flat_hashtable<int>::create(strong_hashtable_size { 8 }, lru_capacity { 4 });
+    auto& cache = *cachePtr;
+
+    for (int i = 1; i <= 4; ++i)
+    {
+        cache[h(i)] = 2 * i;
+        REQUIRE(cache[h(i)] == 2 * i);
+    }
+    CHECK(cache.size() == 4);
+    CHECK(sortedHashes(cache) == vector<uint32_t> { 1, 2, 3, 4 });
+
+    // All entries are referenced, so the CLOCK hand clears their marks and evicts the first one.
+    cache[h(5)] = 10;
+    CHECK(cache.size() == 4);
+    CHECK(sortedHashes(cache) == vector<uint32_t> { 2, 3, 4, 5 });
+    CHECK(cache.fetchAndClearStats().recycles == 1);
+}
+
+TEST_CASE("strong_lru_flat_hashtable.eviction_spares_referenced")
+{
+    auto cachePtr = strong_lru_flat_hashtable<int>::create(strong_hashtable_size { 8 }, lru_capacity { 4 });
+    auto& cache = *cachePtr;
+    for (int i = 1; i <= 5; ++i)
+        cache[h(i)] = i; // evicts 1, clearing the marks of 2, 3 and 4
+
+    cache.touch(h(2));
+    cache[h(6)] = 6;
+    CHECK(sortedHashes(cache) == vector<uint32_t> { 2, 4, 5, 6 });
+}
+
+TEST_CASE("strong_lru_flat_hashtable.at")
+{
+    auto cachePtr = strong_lru_flat_hashtable<int>::create(strong_hashtable_size { 8 }, lru_capacity { 4 });
+    auto& cache = *cachePtr;
+    for (int i = 1; i <= 4; ++i)
+        cache[h(i)] = 2 * i;
+
+    CHECK_THROWS_AS(cache.at(h(-1)), std::out_of_range);
+    CHECK(cache.at(h(1)) == 2);
+    CHECK_THROWS_AS(cache.peek(h(-1)), std::out_of_range);
+    CHECK(cache.peek(h(4)) == 8);
+}
+
+TEST_CASE("strong_lru_flat_hashtable.remove_and_clear")
+{
+    auto cachePtr = strong_lru_flat_hashtable<int>::create(strong_hashtable_size { 8 }, lru_capacity { 4 });
+    auto& cache = *cachePtr;
+    for (int i = 1; i <= 4; ++i)
+        cache[h(i)] = i;
+
+    cache.remove(h(2));
+    cache.remove(h(-1));
+    CHECK(cache.size() == 3);
+    CHECK(!cache.contains(h(2)));
+    CHECK(sortedHashes(cache) == vector<uint32_t> { 1, 3, 4 });
+
+    // The freed entry is reused without evicting any other.
+    cache[h(5)] = 5;
+    CHECK(sortedHashes(cache) == vector<uint32_t> { 1, 3, 4, 5 });
+
+    cache.clear();
+    CHECK(cache.size() == 0);
+    CHECK(!cache.contains(h(1)));
+    CHECK(cache.hashes().empty());
+}
+
+TEST_CASE("strong_lru_flat_hashtable.trim")
+{
+    auto cachePtr = strong_lru_flat_hashtable<int>::create(strong_hashtable_size { 8 }, lru_capacity { 4 });
+    auto& cache = *cachePtr;
+    for (int i = 1; i <= 5; ++i)
+        cache[h(i)] = i; // evicts 1, clearing the marks of 2, 3 and 4
+    (void) cache.fetchAndClearStats();
+
+    // Only the entries referenced since the CLOCK hand has passed them are kept.
+    cache.touch(h(3));
+    CHECK(cache.trim() == 2);
+    CHECK(sortedHashes(cache) == vector<uint32_t> { 3, 5 });
+
+    // Trimming clears the marks, so that whatever is not referenced until the next trim is evicted then.
+    cache.touch(h(5));
+    CHECK(cache.trim() == 1);
+    CHECK(sortedHashes(cache) == vector<uint32_t> { 5 });
+
+    // The freed entries are reused without evicting any other.
+    for (int i = 6; i <= 8; ++i)
+        cache[h(i)] = i;
+    CHECK(sortedHashes(cache) == vector<uint32_t> { 5, 6, 7, 8 });
+    CHECK(cache.fetchAndClearStats().recycles == 0);
+}
+
+TEST_CASE("strong_lru_flat_hashtable.try_emplace")
+{
+    auto cachePtr = strong_lru_flat_hashtable<int>::create(strong_hashtable_size { 4 }, lru_capacity { 2 });
+    auto& cache = *cachePtr;
+
+    CHECK(cache.try_emplace(h(2), [](auto) { return 4; }));
+    CHECK(cache.try_emplace(h(3), [](auto) { return 6; }));
+    CHECK_FALSE(cache.try_emplace(h(2), [](auto) { return -1; }));
+    CHECK(cache.at(h(2)) == 4);
+    CHECK(cache.at(h(3)) == 6);
+}
+
+TEST_CASE("strong_lru_flat_hashtable.get_or_try_emplace")
+{
+    auto cachePtr = strong_lru_flat_hashtable<int>::create(strong_hashtable_size { 4 }, lru_capacity { 2 });
+    auto& cache = *cachePtr;
+
+    auto entryIndices = vector<uint32_t> {};
+    int* b = nullptr;
+    int* a = cache.get_or_try_emplace(h(1), [&](uint32_t entryIndex) -> optional<int> {
+        entryIndices.push_back(entryIndex);
+        b = cache.get_or_try_emplace(h(2), [&](uint32_t entryIndex) -> optional<int> {
+            entryIndices.push_back(entryIndex);
+            return { -2 };
+        });
+        return { -1 };
+    });
+    REQUIRE(a != nullptr);
+    REQUIRE(b != nullptr);
+    CHECK(*a == -1);
+    CHECK(*b == -2);
+
+    // Entry indices are distinct, and between 1 and the capacity inclusive.
+    REQUIRE(entryIndices.size() == 2);
+    CHECK(entryIndices[0] != entryIndices[1]);
+    for (auto const entryIndex: entryIndices)
+        CHECK((1 <= entryIndex && entryIndex <= 2));
+    CHECK(cache.valueAtEntryIndex(entryIndices[0]) == -1);
+
+    // Failing construction leaves no entry behind.
+    CHECK(cache.get_or_try_emplace(h(3), [](auto) -> optional<int> { return nullopt; }) == nullptr);
+    CHECK(!cache.contains(h(3)));
+    CHECK(cache.size() == 1);
+}
+
+TEST_CASE("strong_lru_flat_hashtable.colliding_hashes")
+{
+    // All keys probe the same first group, overflowing into the following ones.
+    auto cachePtr = strong_lru_flat_hashtable<int>::create(strong_hashtable_size { 64 }, lru_capacity { 40 });
+    auto& cache = *cachePtr;
+    for (int i = 1; i <= 40; ++i)
+        cache[collidingHash(i)] = i;
+    for (int i = 1; i <= 40; ++i)
+    {
+        REQUIRE(cache.contains(collidingHash(i)));
+        CHECK(cache.peek(collidingHash(i)) == i);
+    }
+
+    // Removing from the full first group leaves tombstones, which lookups must probe past.
+    for (int i = 1; i <= 40; i += 2)
+        cache.remove(collidingHash(i));
+    for (int i = 1; i <= 40; ++i)
+        CHECK(cache.contains(collidingHash(i)) == (i % 2 == 0));
+}
+
+TEST_CASE("strong_lru_flat_hashtable.matches_reference")
+{
+    // Compares against a plain map under random churn, including evictions and removals.
+    auto cachePtr = strong_lru_flat_hashtable<int>::create(strong_hashtable_size { 32 }, lru_capacity { 50 });
+    auto& cache = *cachePtr;
+    auto rng = std::mt19937 { 42 };
+    for (int i = 0; i < 20000; ++i)
+    {
+        auto const key = static_cast<int>(rng() % 200);
+        if (rng() % 4 == 0)
+            cache.remove(h(key));
+        else
+        {
+            auto const& value = cache.get_or_emplace(h(key), [&](auto) { return key; });
+            REQUIRE(value == key);
+        }
+        REQUIRE(cache.size() <= cache.capacity());
+        REQUIRE(cache.hashes().size() == cache.size());
+    }
+    for (auto const& hash: cache.hashes())
+        CHECK(cache.peek(hash) == static_cast<int>(hash.d()));
+}
@@ -32,9 +32,9 @@ namespace detail
 
 struct lru_hashtable_stats
 {
-    uint32_t hits;
-    uint32_t misses;
-    uint32_t recycles;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t recycles;
 };
 } // namespace crispy
 
@@ -113,6 +113,9 @@ class strong_lru_hashtable
     /// counting from zero again.
     lru_hashtable_stats fetchAndClearStats() noexcept;
 
+    /// Returns the stats gathered since created, or since last cleared by fetchAndClearStats().
+    [[nodiscard]] lru_hashtable_stats const& stats() const noexcept { return _stats; }
+
     /// Clears all entries from the hashtable.
     void clear();
 
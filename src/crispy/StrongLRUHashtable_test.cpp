@@ -5,8 +5,12 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <cstring>
 #include <iostream>
+#include <random>
+#include <set>
 #include <string_view>
+#include <vector>
 
 using namespace crispy;
 using namespace std;
@@ -74,6 +78,142 @@ TEST_CASE("strong_hash", "")
     REQUIRE(a != f);
 }
 
+TEST_CASE("strong_hash.aes_round", "")
+{
+    CHECK(detail::AesSubstitutionBox[0x00] == 0x63);
+    CHECK(detail::AesSubstitutionBox[0x01] == 0x7C);
+    CHECK(detail::AesSubstitutionBox[0x53] == 0xED);
+    CHECK(detail::AesSubstitutionBox[0xFF] == 0x16);
+
+    // The hardware implementation, if any, must match the portable one.
+    auto rng = std::mt19937 { 42 };
+    for (int i = 0; i < 1000; ++i)
+    {
+        auto state = std::array<uint8_t, 16> {};
+        auto key = std::array<uint8_t, 16> {};
+        for (auto& byte: state)
+            byte = static_cast<uint8_t>(rng());
+        for (auto& byte: key)
+            byte = static_cast<uint8_t>(rng());
+
+        auto actual = std::array<uint8_t, 16> {};
+        auto const lane = detail::aesRound(detail::loadLane(state.data()), detail::loadLane(key.data()));
+        detail::storeLane(actual.data(), lane);
+        REQUIRE(actual == detail::aesRoundPortable(state, key));
+    }
+}
+
+TEST_CASE("strong_hash.stable", "")
+{
+    // Hashes are the same on all platforms, whether computed in hardware or not.
+    CHECK(to_string(strong_hash::compute(""sv)) == "B579AFC0DCA677608F8559ECBE1D0356");
+    CHECK(to_string(strong_hash::compute("abc"sv)) == "21F85C1665C4655E1D36D1121CE3CE30");
+}
+
+TEST_CASE("strong_hash_stream.split", "")
+{
+    auto const text = "The quick brown fox jumps over the lazy dog, twice: the quick brown fox."sv;
+    auto const expected = strong_hash::compute(text);
+
+    for (size_t first = 0; first <= text.size(); ++first)
+    {
+        for (size_t second = first; second <= text.size(); second += 7)
+        {
+            auto stream = strong_hash_stream {};
+            stream.update(text.substr(0, first));
+            stream.update(text.substr(first, second - first));
+            stream.update(text.substr(second));
+            REQUIRE(stream.finish() == expected);
+        }
+    }
+
+    // Values of different sizes straddle the block boundaries at different offsets.
+    auto bytes = std::vector<uint8_t> {};
+    auto values = strong_hash_stream {};
+    for (uint32_t i = 0; i < 50; ++i)
+    {
+        auto const append = [&](auto value) {
+            values.update(value);
+            auto const* first = reinterpret_cast<uint8_t const*>(&value);
+            bytes.insert(bytes.end(), first, first + sizeof(value));
+        };
+        append(static_cast<uint8_t>(i));
+        append(i * 0x01020304u);
+        append(static_cast<uint16_t>(i * 3));
+        append(uint64_t { i } * 0x0102030405060708u);
+        REQUIRE(values.finish() == strong_hash::compute(bytes.data(), bytes.size()));
+    }
+
+    // Finishing does not end the stream.
+    auto stream = strong_hash_stream {};
+    stream.update(text.substr(0, 20));
+    CHECK(stream.finish() == strong_hash::compute(text.substr(0, 20)));
+    stream.update(text.substr(20));
+    CHECK(stream.finish() == expected);
+}
+
+TEST_CASE("strong_hash_stream.distinct", "")
+{
+    auto hashes = std::set<std::string> {};
+    auto const insert = [&](void const* data, size_t size) {
+        return hashes.insert(to_string(strong_hash::compute(data, size))).second;
+    };
+
+    // All inputs of up to two bytes, and runs of zeros that only differ by their length.
+    for (unsigned i = 0; i < 65536; ++i)
+    {
+        auto const bytes = std::array<uint8_t, 2> { static_cast<uint8_t>(i), static_cast<uint8_t>(i >> 8) };
+        REQUIRE(insert(bytes.data(), 2));
+        if (i < 256)
+            REQUIRE(insert(bytes.data(), 1));
+    }
+    auto const zeros = std::array<uint8_t, 64> {};
+    for (size_t size = 0; size <= zeros.size(); ++size)
+        if (size != 1 && size != 2)
+            REQUIRE(insert(zeros.data(), size));
+}
+
+TEST_CASE("strong_hash_stream.avalanche", "")
+{
+    // Flipping a single input bit must flip each output bit with a probability of about one half.
+    auto rng = std::mt19937 { 7 };
+    auto flips = std::array<int, 128> {};
+    auto samples = 0;
+    for (int i = 0; i < 64; ++i)
+    {
+        auto input = std::array<uint8_t, 20> {};
+        for (auto& byte: input)
+            byte = static_cast<uint8_t>(rng());
+        auto original = std::array<uint32_t, 4> {};
+        auto const originalHash = strong_hash::compute(input.data(), input.size());
+        std::memcpy(original.data(), &originalHash, sizeof(originalHash));
+
+        for (size_t bit = 0; bit < input.size() * 8; ++bit)
+        {
+            input[bit / 8] ^= static_cast<uint8_t>(1u << (bit % 8));
+            auto changed = std::array<uint32_t, 4> {};
+            auto const changedHash = strong_hash::compute(input.data(), input.size());
+            std::memcpy(changed.data(), &changedHash, sizeof(changedHash));
+            input[bit / 8] ^= static_cast<uint8_t>(1u << (bit % 8));
+
+            for (size_t k = 0; k < 4; ++k)
+            {
+                auto const diff = original[k] ^ changed[k];
+                for (size_t j = 0; j < 32; ++j)
+                    flips[k * 32 + j] += (diff >> j) & 1;
+            }
+            ++samples;
+        }
+    }
+
+    for (auto const count: flips)
+    {
+        auto const probability = static_cast<double>(count) / samples;
+        CHECK(probability > 0.45);
+        CHECK(probability < 0.55);
+    }
+}
+
 TEST_CASE("strong_lru_hashtable.operator_index", "")
 {
     auto cachePtr = strong_lru_hashtable<int>::create(strong_hashtable_size { 8 }, lru_capacity { 4 });
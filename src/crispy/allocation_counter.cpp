@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/allocation_counter.h>
+
+#include <cstdlib>
+#include <new>
+
+namespace crispy
+{
+
+#if defined(CONTOUR_COUNT_ALLOCATIONS)
+namespace
+{
+    constinit thread_local allocation_stats threadAllocations {};
+    std::atomic<uint64_t> processAllocationCount = 0;
+    std::atomic<uint64_t> processAllocationBytes = 0;
+} // namespace
+
+allocation_stats thread_allocations() noexcept
+{
+    return threadAllocations;
+}
+
+allocation_stats process_allocations() noexcept
+{
+    return { .count = processAllocationCount.load(std::memory_order_relaxed),
+             .bytes = processAllocationBytes.load(std::memory_order_relaxed) };
+}
+#else
+allocation_stats thread_allocations() noexcept
+{
+    return {};
+}
+
+allocation_stats process_allocations() noexcept
+{
+    return {};
+}
+#endif
+
+} // namespace crispy
+
+#if defined(CONTOUR_COUNT_ALLOCATIONS)
+// The array and nothrow forms of operator new, as well as all forms of operator delete,
+// end up in these with the standard libraries. Over-aligned allocations are not counted.
+void* operator new(size_t size)
+{
+    ++crispy::threadAllocations.count;
+    crispy::threadAllocations.bytes += size;
+    crispy::processAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    crispy::processAllocationBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+#endif
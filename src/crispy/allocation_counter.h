@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <crispy/utils.h>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace crispy
+{
+
+/// Tests whether heap allocations are counted, i.e. whether built with CONTOUR_COUNT_ALLOCATIONS.
+///
+/// Counting replaces the global operator new, and therefore cannot be combined with mimalloc.
+#if defined(CONTOUR_COUNT_ALLOCATIONS)
+constexpr inline bool allocations_counted = true;
+#else
+constexpr inline bool allocations_counted = false;
+#endif
+
+struct allocation_stats
+{
+    uint64_t count = 0; // allocations made via the global operator new
+    uint64_t bytes = 0; // bytes requested by them
+
+    allocation_stats& operator+=(allocation_stats const& other) noexcept
+    {
+        count += other.count;
+        bytes += other.bytes;
+        return *this;
+    }
+
+    [[nodiscard]] allocation_stats operator-(allocation_stats const& other) const noexcept
+    {
+        return { .count = count - other.count, .bytes = bytes - other.bytes };
+    }
+};
+
+/// @returns the allocations made per MiB of the @p bytes processed with them.
+[[nodiscard]] constexpr double allocations_per_mb(uint64_t allocations, uint64_t bytes) noexcept
+{
+    return bytes != 0 ? static_cast<double>(allocations) * 1024 * 1024 / static_cast<double>(bytes) : 0.0;
+}
+
+/// @returns the allocations made by the calling thread so far, or none if not counted.
+[[nodiscard]] allocation_stats thread_allocations() noexcept;
+
+/// @returns the allocations made by all threads so far, or none if not counted.
+[[nodiscard]] allocation_stats process_allocations() noexcept;
+
+/**
+ * Accumulates the allocations made within a recurring scope, such as building a frame.
+ *
+ * The scope is counted on one thread at a time via allocation_scope, whereas stats() may be
+ * invoked from any thread.
+ */
+class allocation_counter
+{
+  public:
+    struct snapshot
+    {
+        uint64_t samples = 0;   // scopes counted
+        allocation_stats total; // made within all of them
+        allocation_stats last;  // made within the last of them
+    };
+
+    void add(allocation_stats const& stats) noexcept
+    {
+        _samples.fetch_add(1, std::memory_order_relaxed);
+        _count.fetch_add(stats.count, std::memory_order_relaxed);
+        _bytes.fetch_add(stats.bytes, std::memory_order_relaxed);
+        _lastCount.store(stats.count, std::memory_order_relaxed);
+        _lastBytes.store(stats.bytes, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] snapshot stats() const noexcept
+    {
+        return {
+            .samples = _samples.load(std::memory_order_relaxed),
+            .total = { .count = _count.load(std::memory_order_relaxed),
+                       .bytes = _bytes.load(std::memory_order_relaxed) },
+            .last = { .count = _lastCount.load(std::memory_order_relaxed),
+                      .bytes = _lastBytes.load(std::memory_order_relaxed) },
+        };
+    }
+
+  private:
+    std::atomic<uint64_t> _samples = 0;
+    std::atomic<uint64_t> _count = 0;
+    std::atomic<uint64_t> _bytes = 0;
+    std::atomic<uint64_t> _lastCount = 0;
+    std::atomic<uint64_t> _lastBytes = 0;
+};
+
+/// Adds the allocations the calling thread makes during its lifetime to an allocation_counter.
+///
+/// Compiles to nothing unless allocations are counted.
+class allocation_scope
+{
+  public:
+    explicit allocation_scope(allocation_counter& counter) noexcept: _counter { counter }
+    {
+        if constexpr (allocations_counted)
+            _start = thread_allocations();
+    }
+
+    ~allocation_scope()
+    {
+        if constexpr (allocations_counted)
+            _counter.add(thread_allocations() - _start);
+    }
+
+    allocation_scope(allocation_scope const&) = delete;
+    allocation_scope(allocation_scope&&) = delete;
+    allocation_scope& operator=(allocation_scope const&) = delete;
+    allocation_scope& operator=(allocation_scope&&) = delete;
+
+  private:
+    allocation_counter& _counter;
+    allocation_stats _start;
+};
+
+} // namespace crispy
+
+template <>
+struct fmt::formatter<crispy::allocation_stats>: fmt::formatter<std::string>
+{
+    auto format(crispy::allocation_stats const& stats, format_context& ctx) -> format_context::iterator
+    {
+        return formatter<std::string>::format(
+            fmt::format("{} allocations ({})", stats.count, crispy::humanReadableBytes(stats.bytes)), ctx);
+    }
+};
+
+template <>
+struct fmt::formatter<crispy::allocation_counter::snapshot>: fmt::formatter<std::string>
+{
+    auto format(crispy::allocation_counter::snapshot const& stats, format_context& ctx)
+        -> format_context::iterator
+    {
+        return formatter<std::string>::format(
+            fmt::format("last {}, {:.1f} allocations on average over {}",
+                        stats.last,
+                        stats.samples != 0
+                            ? static_cast<double>(stats.total.count) / static_cast<double>(stats.samples)
+                            : 0.0,
+                        stats.samples),
+            ctx);
+    }
+};
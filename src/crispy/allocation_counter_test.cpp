@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/allocation_counter.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <memory>
+
+namespace
+{
+// Keeps allocations observable, as compilers may elide them otherwise.
+void* volatile allocationSink = nullptr;
+} // namespace
+
+TEST_CASE("allocation_scope.counts_thread_allocations", "[allocation_counter]")
+{
+    auto counter = crispy::allocation_counter {};
+    {
+        auto const _ = crispy::allocation_scope { counter };
+        auto const memory = std::make_unique<std::array<char, 100>>();
+        allocationSink = memory.get();
+    }
+    {
+        auto const _ = crispy::allocation_scope { counter };
+    }
+
+    auto const stats = counter.stats();
+    if constexpr (crispy::allocations_counted)
+    {
+        CHECK(stats.samples == 2);
+        CHECK(stats.total.count == 1);
+        CHECK(stats.total.bytes == 100);
+        CHECK(stats.last.count == 0);
+    }
+    else
+    {
+        // Scopes compile to nothing.
+        CHECK(stats.samples == 0);
+        CHECK(stats.total.count == 0);
+    }
+}
+
+TEST_CASE("allocation_counter.process_allocations", "[allocation_counter]")
+{
+    auto const before = crispy::process_allocations();
+    auto const memory = std::make_unique<std::array<char, 64>>();
+    allocationSink = memory.get();
+    auto const after = crispy::process_allocations();
+
+    if constexpr (crispy::allocations_counted)
+        CHECK((after - before).count >= 1);
+    else
+        CHECK((after - before).count == 0);
+}
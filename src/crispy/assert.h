@@ -65,6 +65,7 @@ namespace detail
                 fail_handler()(text, message, file, line);
             else
                 fmt::print("[{}:{}] {} {}\n", file, line, message, text);
+            logstore::flush();
         }
         catch (...)
         {
@@ -101,6 +102,7 @@ inline void set_fail_handler(fail_handler_t handler)
         fatalLog(location)("Fatal error. {}", message);
     else
         fatalLog(location)("Fatal error.");
+    logstore::flush();
     std::abort();
 }
 
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/base64.h>
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #define CRISPY_BASE64_X86_DISPATCH 1
+    #include <immintrin.h>
+#elif defined(__AVX2__)
+    #define CRISPY_BASE64_AVX2 1
+    #include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    #define CRISPY_BASE64_NEON 1
+    #include <arm_neon.h>
+#endif
+
+namespace crispy::base64::detail
+{
+
+namespace
+{
+    // Decodes blocks of 4 characters at a time.
+    size_t decodeBlocksScalar(char const* input, size_t size, char* output) noexcept
+    {
+        auto decoded = size_t { 0 };
+        for (; decoded + 4 <= size; decoded += 4)
+        {
+            auto const* in = reinterpret_cast<uint8_t const*>(input + decoded);
+            auto const a = IndexMap[in[0]];
+            auto const b = IndexMap[in[1]];
+            auto const c = IndexMap[in[2]];
+            auto const d = IndexMap[in[3]];
+            if ((a | b | c | d) > 63)
+                break;
+            *output++ = static_cast<char>(a << 2 | b >> 4);
+            *output++ = static_cast<char>(b << 4 | c >> 2);
+            *output++ = static_cast<char>(c << 6 | d);
+        }
+        return decoded;
+    }
+
+    // The vectorized decoders translate characters to their sextets by looking up their nibbles,
+    // as described by Wojciech Muła and Daniel Lemire in "Faster Base64 Encoding and Decoding
+    // Using AVX2 Instructions": Looking up the high and the low nibble in a table each yields bit sets,
+    // which intersect for invalid characters only, whereas the high nibble (and whether the character
+    // is '/') selects the offset to add for translating the character.
+
+    // clang-format off
+    constexpr uint8_t LowNibbleClasses[16] = {
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+    };
+    constexpr uint8_t HighNibbleClasses[16] = {
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+    };
+    constexpr int8_t Offsets[16] = {
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+    };
+    // clang-format on
+
+#if defined(CRISPY_BASE64_X86_DISPATCH) || defined(CRISPY_BASE64_AVX2)
+    #if defined(CRISPY_BASE64_X86_DISPATCH)
+        #define CRISPY_BASE64_TARGET(name) __attribute__((target(name)))
+    #else
+        #define CRISPY_BASE64_TARGET(name)
+    #endif
+
+    #if defined(CRISPY_BASE64_X86_DISPATCH)
+    // Decodes blocks of 16 characters into 12 bytes at a time.
+    CRISPY_BASE64_TARGET("ssse3")
+    size_t decodeBlocksSSSE3(char const* input, size_t size, char* output) noexcept
+    {
+        auto const lowNibbleClasses = _mm_loadu_si128(reinterpret_cast<__m128i const*>(LowNibbleClasses));
+        auto const highNibbleClasses = _mm_loadu_si128(reinterpret_cast<__m128i const*>(HighNibbleClasses));
+        auto const offsets = _mm_loadu_si128(reinterpret_cast<__m128i const*>(Offsets));
+        auto const nibbleMask = _mm_set1_epi8(0x0F);
+        auto const slash = _mm_set1_epi8('/');
+        auto const packPairs = _mm_set1_epi32(0x01400140);
+        auto const packQuads = _mm_set1_epi32(0x00011000);
+        auto const extractBytes = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+        auto decoded = size_t { 0 };
+        for (; decoded + 16 <= size; decoded += 16)
+        {
+            auto const chars = _mm_loadu_si128(reinterpret_cast<__m128i const*>(input + decoded));
+            auto const highNibbles = _mm_and_si128(_mm_srli_epi32(chars, 4), nibbleMask);
+            auto const lowNibbles = _mm_and_si128(chars, nibbleMask);
+            auto const classes = _mm_and_si128(_mm_shuffle_epi8(lowNibbleClasses, lowNibbles),
+                                               _mm_shuffle_epi8(highNibbleClasses, highNibbles));
+            if (_mm_movemask_epi8(_mm_cmpgt_epi8(classes, _mm_setzero_si128())))
+                break;
+
+            auto const offset =
+                _mm_shuffle_epi8(offsets, _mm_add_epi8(_mm_cmpeq_epi8(chars, slash), highNibbles));
+            auto const sextets = _mm_add_epi8(chars, offset);
+            auto const words = _mm_madd_epi16(_mm_maddubs_epi16(sextets, packPairs), packQuads);
+            auto const bytes = _mm_shuffle_epi8(words, extractBytes);
+
+            alignas(16) char block[16];
+            _mm_store_si128(reinterpret_cast<__m128i*>(block), bytes);
+            std::memcpy(output, block, 12);
+            output += 12;
+        }
+        return decoded + decodeBlocksScalar(input + decoded, size - decoded, output);
+    }
+    #endif
+
+    // Decodes blocks of 32 characters into 24 bytes at a time.
+    CRISPY_BASE64_TARGET("avx2")
+    size_t decodeBlocksAVX2(char const* input, size_t size, char* output) noexcept
+    {
+        auto const lowNibbleClasses =
+            _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const*>(LowNibbleClasses)));
+        auto const highNibbleClasses =
+            _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const*>(HighNibbleClasses)));
+        auto const offsets =
+            _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const*>(Offsets)));
+        auto const nibbleMask = _mm256_set1_epi8(0x0F);
+        auto const slash = _mm256_set1_epi8('/');
+        auto const packPairs = _mm256_set1_epi32(0x01400140);
+        auto const packQuads = _mm256_set1_epi32(0x00011000);
+        auto const extractBytes = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                   2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+        auto const joinLanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+        auto decoded = size_t { 0 };
+        for (; decoded + 32 <= size; decoded += 32)
+        {
+            auto const chars = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(input + decoded));
+            auto const highNibbles = _mm256_and_si256(_mm256_srli_epi32(chars, 4), nibbleMask);
+            auto const lowNibbles = _mm256_and_si256(chars, nibbleMask);
+            auto const classes = _mm256_and_si256(_mm256_shuffle_epi8(lowNibbleClasses, lowNibbles),
+                                                  _mm256_shuffle_epi8(highNibbleClasses, highNibbles));
+            if (_mm256_movemask_epi8(_mm256_cmpgt_epi8(classes, _mm256_setzero_si256())))
+                break;
+
+            auto const offset =
+                _mm256_shuffle_epi8(offsets, _mm256_add_epi8(_mm256_cmpeq_epi8(chars, slash), highNibbles));
+            auto const sextets = _mm256_add_epi8(chars, offset);
+            auto const words = _mm256_madd_epi16(_mm256_maddubs_epi16(sextets, packPairs), packQuads);
+            auto const bytes =
+                _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(words, extractBytes), joinLanes);
+
+            alignas(32) char block[32];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(block), bytes);
+            std::memcpy(output, block, 24);
+            output += 24;
+        }
+        return decoded + decodeBlocksScalar(input + decoded, size - decoded, output);
+    }
+#endif
+
+#if defined(CRISPY_BASE64_NEON)
+    // @returns the sextets of the given characters, with the high bit of invalid ones set.
+    uint8x16_t translate(uint8x16_t chars, uint8x16_t& invalid) noexcept
+    {
+        auto const highNibbles = vshrq_n_u8(chars, 4);
+        auto const lowNibbles = vandq_u8(chars, vdupq_n_u8(0x0F));
+        auto const classes = vandq_u8(vqtbl1q_u8(vld1q_u8(LowNibbleClasses), lowNibbles),
+                                      vqtbl1q_u8(vld1q_u8(HighNibbleClasses), highNibbles));
+        invalid = vorrq_u8(invalid, classes);
+        auto const offset = vqtbl1q_u8(vreinterpretq_u8_s8(vld1q_s8(Offsets)),
+                                       vaddq_u8(vceqq_u8(chars, vdupq_n_u8('/')), highNibbles));
+        return vaddq_u8(chars, offset);
+    }
+
+    // Decodes blocks of 64 characters into 48 bytes at a time, deinterleaving the 4 sextets of each group.
+    size_t decodeBlocksNEON(char const* input, size_t size, char* output) noexcept
+    {
+        auto decoded = size_t { 0 };
+        for (; decoded + 64 <= size; decoded += 64)
+        {
+            auto const chars = vld4q_u8(reinterpret_cast<uint8_t const*>(input + decoded));
+            auto invalid = vdupq_n_u8(0);
+            auto const a = translate(chars.val[0], invalid);
+            auto const b = translate(chars.val[1], invalid);
+            auto const c = translate(chars.val[2], invalid);
+            auto const d = translate(chars.val[3], invalid);
+            if (vmaxvq_u8(invalid) != 0)
+                break;
+
+            auto bytes = uint8x16x3_t {};
+            bytes.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+            bytes.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+            bytes.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+            vst3q_u8(reinterpret_cast<uint8_t*>(output), bytes);
+            output += 48;
+        }
+        return decoded + decodeBlocksScalar(input + decoded, size - decoded, output);
+    }
+#endif
+} // namespace
+
+size_t decodeBlocks(char const* input, size_t size, char* output) noexcept
+{
+#if defined(CRISPY_BASE64_X86_DISPATCH)
+    static auto const dispatched = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return &decodeBlocksAVX2;
+        if (__builtin_cpu_supports("ssse3"))
+            return &decodeBlocksSSSE3;
+        return &decodeBlocksScalar;
+    }();
+    return dispatched(input, size, output);
+#elif defined(CRISPY_BASE64_AVX2)
+    return decodeBlocksAVX2(input, size, output);
+#elif defined(CRISPY_BASE64_NEON)
+    return decodeBlocksNEON(input, size, output);
+#else
+    return decodeBlocksScalar(input, size, output);
+#endif
+}
+
+} // namespace crispy::base64::detail
@@ -45,6 +45,13 @@ namespace detail
             s += c;
         return s;
     }
+
+    /// Decodes whole blocks of base64 characters, vectorized using AVX2, SSSE3, or NEON, if available.
+    /// Stops before the first block containing any padding or other character not in the alphabet.
+    ///
+    /// @returns the number of input characters decoded, which is a multiple of 4,
+    ///          with 3 bytes written to @p output for every 4 characters.
+    size_t decodeBlocks(char const* input, size_t size, char* output) noexcept;
 } // namespace detail
 
 struct encoder_state
@@ -234,11 +241,91 @@ size_t decode(std::string_view input, Output output)
     return decode(input.begin(), input.end(), output);
 }
 
+/// State of decoding base64 input that arrives in chunks.
+struct decoder_state
+{
+    uint32_t pending = 0;  // sextets of the current, incomplete group
+    uint8_t count = 0;     // number of sextets pending
+    bool finished = false; // padding or another character not in the alphabet has been seen
+};
+
+/// @returns the number of bytes that decoding @p size more characters writes at most,
+///          including the bytes written by finish().
+constexpr size_t decodedSizeBound(decoder_state const& state, size_t size) noexcept
+{
+    return (state.count + size) / 4 * 3 + 2;
+}
+
+/// Decodes the next chunk of base64 input into @p output, continuing where the last chunk left off.
+///
+/// Decoding ends at the first padding or other character not in the alphabet,
+/// ignoring any further input.
+///
+/// @returns the number of bytes written, see decodedSizeBound().
+inline size_t decode(decoder_state& state, std::string_view input, char* output) noexcept
+{
+    auto* out = output;
+    auto const* in = input.data();
+    auto const* const end = in + input.size();
+
+    auto const step = [&](char ch) {
+        auto const value = detail::IndexMap[static_cast<uint8_t>(ch)];
+        if (value > 63)
+        {
+            state.finished = true;
+            return;
+        }
+        state.pending = state.pending << 6 | value;
+        if (++state.count == 4)
+        {
+            *out++ = static_cast<char>(state.pending >> 16);
+            *out++ = static_cast<char>(state.pending >> 8);
+            *out++ = static_cast<char>(state.pending);
+            state.pending = 0;
+            state.count = 0;
+        }
+    };
+
+    while (in != end && state.count != 0 && !state.finished)
+        step(*in++);
+
+    if (!state.finished)
+    {
+        auto const decoded = detail::decodeBlocks(in, static_cast<size_t>(end - in), out);
+        in += decoded;
+        out += decoded / 4 * 3;
+    }
+
+    while (in != end && !state.finished)
+        step(*in++);
+
+    return static_cast<size_t>(out - output);
+}
+
+/// Writes the bytes of the last incomplete group, resetting the state for new input.
+///
+/// @returns the number of bytes written, which is at most 2.
+inline size_t finish(decoder_state& state, char* output) noexcept
+{
+    auto written = size_t { 0 };
+    if (state.count == 2)
+        output[written++] = static_cast<char>(state.pending >> 4);
+    else if (state.count == 3)
+    {
+        output[written++] = static_cast<char>(state.pending >> 10);
+        output[written++] = static_cast<char>(state.pending >> 2);
+    }
+    state = decoder_state {};
+    return written;
+}
+
 inline std::string decode(std::string_view input)
 {
-    std::string output;
-    output.resize(decodeLength(input));
-    output.resize(decode(input, output.data()));
+    auto state = decoder_state {};
+    auto output = std::string(decodedSizeBound(state, input.size()), '\0');
+    auto size = decode(state, input, output.data());
+    size += finish(state, output.data() + size);
+    output.resize(size);
     return output;
 }
 
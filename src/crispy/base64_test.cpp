@@ -22,3 +22,73 @@ TEST_CASE("base64.decode", "[base64]")
     CHECK("abcd" == base64::decode("YWJjZA=="));
     CHECK("foo:bar" == base64::decode("Zm9vOmJhcg=="));
 }
+
+namespace
+{
+
+std::string randomBytes(size_t size, uint32_t seed)
+{
+    auto bytes = std::string(size, '\0');
+    for (auto& byte: bytes)
+    {
+        seed = seed * 1664525 + 1013904223;
+        byte = static_cast<char>(seed >> 24);
+    }
+    return bytes;
+}
+
+} // namespace
+
+TEST_CASE("base64.decode.long", "[base64]")
+{
+    // Long enough inputs for the vectorized decoders, with unaligned tails.
+    for (auto const size: { 47, 48, 49, 95, 96, 97, 1000, 4099 })
+    {
+        auto const bytes = randomBytes(static_cast<size_t>(size), static_cast<uint32_t>(size));
+        CHECK(base64::decode(base64::encode(bytes)) == bytes);
+    }
+}
+
+TEST_CASE("base64.decode.invalid", "[base64]")
+{
+    auto const bytes = randomBytes(300, 1);
+    auto encoded = base64::encode(bytes);
+
+    // Decoding stops at the first character not in the alphabet, even within vectorized blocks.
+    for (auto const position: { 0, 1, 2, 3, 40, 41, 100, 201, 299 })
+    {
+        auto invalid = encoded;
+        invalid[static_cast<size_t>(position)] = '\n';
+        auto const decoded = base64::decode(invalid);
+        auto const expected =
+            base64::decode(std::string_view(encoded).substr(0, static_cast<size_t>(position)));
+        CHECK(decoded == expected);
+        CHECK(decoded == bytes.substr(0, decoded.size()));
+    }
+
+    CHECK(base64::decode("YWJj\xffYWJj") == "abc");
+    CHECK(base64::decode("YQ==YWJj") == "a");
+}
+
+TEST_CASE("base64.decode.chunked", "[base64]")
+{
+    auto const bytes = randomBytes(2000, 2);
+    auto const encoded = base64::encode(bytes);
+
+    for (auto const chunkSize: { 1, 3, 5, 64, 333 })
+    {
+        auto state = base64::decoder_state {};
+        auto decoded = std::string {};
+        for (size_t offset = 0; offset < encoded.size(); offset += static_cast<size_t>(chunkSize))
+        {
+            auto const chunk = std::string_view(encoded).substr(offset, static_cast<size_t>(chunkSize));
+            auto const size = decoded.size();
+            decoded.resize(size + base64::decodedSizeBound(state, chunk.size()));
+            decoded.resize(size + base64::decode(state, chunk, decoded.data() + size));
+        }
+        auto const size = decoded.size();
+        decoded.resize(size + 2);
+        decoded.resize(size + base64::finish(state, decoded.data() + size));
+        CHECK(decoded == bytes);
+    }
+}
@@ -0,0 +1,297 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <crispy/ring.h>
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace crispy
+{
+
+/**
+ * Vector-like sequence container, storing its elements in fixed-size blocks, like a deque.
+ *
+ * Growing the container allocates new blocks rather than reallocating and moving the elements,
+ * so the addresses of elements are stable, and push_back() and pop_front() are O(1).
+ * Blocks freed by pop_front() are reused for new elements at the back.
+ */
+template <typename T, typename Allocator = std::allocator<T>>
+class chunked_vector // NOLINT(readability-identifier-naming)
+{
+    using allocator_traits = std::allocator_traits<Allocator>;
+
+  public:
+    /// Number of elements per block, aiming at 16 KiB sized blocks.
+    static constexpr size_t BlockSize = std::max(size_t { 16 }, std::bit_floor(16384 / sizeof(T)));
+
+    using value_type = T;
+    using allocator_type = Allocator;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = T const&;
+
+    template <typename Container, typename U>
+    class basic_iterator;
+    using iterator = basic_iterator<chunked_vector, T>;
+    using const_iterator = basic_iterator<chunked_vector const, T const>;
+
+    chunked_vector() = default;
+    explicit chunked_vector(size_t count) { resize(count); }
+    chunked_vector(size_t count, T const& value) { resize(count, value); }
+
+    chunked_vector(chunked_vector const& other): _allocator { other._allocator }
+    {
+        reserve(other.size());
+        for (auto const& value: other)
+            emplace_back(value);
+    }
+
+    chunked_vector(chunked_vector&& other) noexcept:
+        _allocator { std::move(other._allocator) },
+        _blocks { std::move(other._blocks) },
+        _first { std::exchange(other._first, 0) },
+        _size { std::exchange(other._size, 0) }
+    {
+    }
+
+    chunked_vector& operator=(chunked_vector const& other)
+    {
+        if (this != &other)
+        {
+            auto copy = chunked_vector(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    chunked_vector& operator=(chunked_vector&& other) noexcept
+    {
+        auto moved = chunked_vector(std::move(other));
+        swap(moved);
+        return *this;
+    }
+
+    ~chunked_vector()
+    {
+        clear();
+        for (T* block: _blocks)
+            allocator_traits::deallocate(_allocator, block, BlockSize);
+    }
+
+    void swap(chunked_vector& other) noexcept
+    {
+        std::swap(_allocator, other._allocator);
+        std::swap(_blocks, other._blocks);
+        std::swap(_first, other._first);
+        std::swap(_size, other._size);
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return _size; }
+    [[nodiscard]] bool empty() const noexcept { return _size == 0; }
+    [[nodiscard]] size_t capacity() const noexcept { return _blocks.size() * BlockSize - _first; }
+
+    [[nodiscard]] T& operator[](size_t i) noexcept { return *slot(i); }
+    [[nodiscard]] T const& operator[](size_t i) const noexcept { return *slot(i); }
+
+    [[nodiscard]] T& front() noexcept { return *slot(0); }
+    [[nodiscard]] T const& front() const noexcept { return *slot(0); }
+    [[nodiscard]] T& back() noexcept { return *slot(_size - 1); }
+    [[nodiscard]] T const& back() const noexcept { return *slot(_size - 1); }
+
+    [[nodiscard]] iterator begin() noexcept { return iterator { this, 0 }; }
+    [[nodiscard]] iterator end() noexcept { return iterator { this, static_cast<difference_type>(_size) }; }
+    [[nodiscard]] const_iterator begin() const noexcept { return const_iterator { this, 0 }; }
+    [[nodiscard]] const_iterator end() const noexcept
+    {
+        return const_iterator { this, static_cast<difference_type>(_size) };
+    }
+
+    /// Allocates the blocks for up to @p count elements, without touching existing ones.
+    void reserve(size_t count)
+    {
+        while (capacity() < count)
+            _blocks.push_back(allocator_traits::allocate(_allocator, BlockSize));
+    }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        if (_first + _size == _blocks.size() * BlockSize)
+            _blocks.push_back(allocator_traits::allocate(_allocator, BlockSize));
+        T* const target = slot(_size);
+        allocator_traits::construct(_allocator, target, std::forward<Args>(args)...);
+        ++_size;
+        return *target;
+    }
+
+    void push_back(T const& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    void pop_back() noexcept
+    {
+        assert(!empty());
+        allocator_traits::destroy(_allocator, slot(_size - 1));
+        --_size;
+    }
+
+    void pop_front() noexcept
+    {
+        assert(!empty());
+        allocator_traits::destroy(_allocator, slot(0));
+        --_size;
+        if (++_first == BlockSize)
+        {
+            // Recycle the now unused first block for elements to be appended.
+            std::rotate(_blocks.begin(), std::next(_blocks.begin()), _blocks.end());
+            _first = 0;
+        }
+    }
+
+    /// Erases the element at @p pos, which is O(1) for the first and last element.
+    iterator erase(const_iterator pos)
+    {
+        auto const index = static_cast<size_t>(pos.index());
+        if (index == 0)
+            pop_front();
+        else
+        {
+            for (auto i = index; i + 1 < _size; ++i)
+                *slot(i) = std::move(*slot(i + 1));
+            pop_back();
+        }
+        return iterator { this, static_cast<difference_type>(index) };
+    }
+
+    void resize(size_t count)
+    {
+        reserve(count);
+        while (_size > count)
+            pop_back();
+        while (_size < count)
+            emplace_back();
+    }
+
+    void resize(size_t count, T const& value)
+    {
+        reserve(count);
+        while (_size > count)
+            pop_back();
+        while (_size < count)
+            emplace_back(value);
+    }
+
+    /// Destroys all elements, keeping the allocated blocks.
+    void clear() noexcept
+    {
+        while (!empty())
+            pop_back();
+        _first = 0;
+    }
+
+  private:
+    [[nodiscard]] T* slot(size_t i) const noexcept
+    {
+        auto const index = _first + i;
+        return _blocks[index / BlockSize] + index % BlockSize;
+    }
+
+    [[no_unique_address]] Allocator _allocator {};
+    std::vector<T*> _blocks;
+    size_t _first = 0; // index of the first element in the first block
+    size_t _size = 0;
+};
+
+template <typename T, typename Allocator>
+template <typename Container, typename U>
+class chunked_vector<T, Allocator>::basic_iterator
+{
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::remove_const_t<U>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = U*;
+    using reference = U&;
+
+    basic_iterator() = default;
+    basic_iterator(Container* container, difference_type index) noexcept:
+        _container { container }, _index { index }
+    {
+    }
+
+    // Allows converting iterators to const_iterators.
+    template <typename OtherContainer, typename OtherU>
+    basic_iterator(basic_iterator<OtherContainer, OtherU> const& other) noexcept:
+        _container { other.container() }, _index { other.index() }
+    {
+    }
+
+    [[nodiscard]] Container* container() const noexcept { return _container; }
+    [[nodiscard]] difference_type index() const noexcept { return _index; }
+
+    U& operator*() const noexcept { return (*_container)[static_cast<size_t>(_index)]; }
+    U* operator->() const noexcept { return &**this; }
+    U& operator[](difference_type n) const noexcept { return *(*this + n); }
+
+    basic_iterator& operator++() noexcept
+    {
+        ++_index;
+        return *this;
+    }
+    basic_iterator operator++(int) noexcept { return basic_iterator { _container, _index++ }; }
+    basic_iterator& operator--() noexcept
+    {
+        --_index;
+        return *this;
+    }
+    basic_iterator operator--(int) noexcept { return basic_iterator { _container, _index-- }; }
+
+    basic_iterator& operator+=(difference_type n) noexcept
+    {
+        _index += n;
+        return *this;
+    }
+    basic_iterator& operator-=(difference_type n) noexcept
+    {
+        _index -= n;
+        return *this;
+    }
+
+    friend basic_iterator operator+(basic_iterator i, difference_type n) noexcept { return i += n; }
+    friend basic_iterator operator+(difference_type n, basic_iterator i) noexcept { return i += n; }
+    friend basic_iterator operator-(basic_iterator i, difference_type n) noexcept { return i -= n; }
+    friend difference_type operator-(basic_iterator const& a, basic_iterator const& b) noexcept
+    {
+        return a._index - b._index;
+    }
+
+    friend bool operator==(basic_iterator const& a, basic_iterator const& b) noexcept
+    {
+        return a._index == b._index;
+    }
+    friend auto operator<=>(basic_iterator const& a, basic_iterator const& b) noexcept
+    {
+        return a._index <=> b._index;
+    }
+
+  private:
+    Container* _container = nullptr;
+    difference_type _index = 0;
+};
+
+/// Ring buffer over fixed-size blocks of elements, see chunked_vector.
+///
+/// Unlike ring<T>, growing it never reallocates nor moves the existing elements,
+/// which makes appending to large rings O(1), and references to the elements stay valid.
+template <typename T>
+using chunked_ring = ring<T, chunked_vector>;
+
+} // namespace crispy
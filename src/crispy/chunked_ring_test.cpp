@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/chunked_ring.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using crispy::chunked_ring;
+using crispy::chunked_vector;
+
+namespace
+{
+constexpr auto BlockSize = chunked_vector<std::string>::BlockSize;
+} // namespace
+
+TEST_CASE("chunked_vector.push_back")
+{
+    auto v = chunked_vector<std::string> {};
+    for (size_t i = 0; i < 3 * BlockSize + 1; ++i)
+        v.push_back(std::to_string(i));
+
+    REQUIRE(v.size() == 3 * BlockSize + 1);
+    for (size_t i = 0; i < v.size(); ++i)
+        REQUIRE(v[i] == std::to_string(i));
+    REQUIRE(v.front() == "0");
+    REQUIRE(v.back() == std::to_string(3 * BlockSize));
+    REQUIRE(std::distance(v.begin(), v.end()) == static_cast<std::ptrdiff_t>(v.size()));
+}
+
+TEST_CASE("chunked_vector.stable_addresses")
+{
+    auto v = chunked_vector<std::string> {};
+    v.emplace_back("first");
+    auto const* const first = &v.front();
+    for (size_t i = 0; i < 4 * BlockSize; ++i)
+        v.emplace_back("more");
+    REQUIRE(&v.front() == first);
+    REQUIRE(*first == "first");
+}
+
+TEST_CASE("chunked_vector.pop_front")
+{
+    auto v = chunked_vector<std::string> {};
+    for (size_t i = 0; i < 2 * BlockSize; ++i)
+        v.push_back(std::to_string(i));
+    auto const capacity = v.capacity() + BlockSize;
+
+    // Popping from the front and pushing to the back keeps recycling the same blocks.
+    for (size_t i = 2 * BlockSize; i < 10 * BlockSize; ++i)
+    {
+        v.pop_front();
+        v.push_back(std::to_string(i));
+        REQUIRE(v.front() == std::to_string(i - 2 * BlockSize + 1));
+        REQUIRE(v.back() == std::to_string(i));
+    }
+    REQUIRE(v.size() == 2 * BlockSize);
+    REQUIRE(v.capacity() <= capacity);
+}
+
+TEST_CASE("chunked_vector.erase")
+{
+    auto v = chunked_vector<int>(5, 0);
+    std::iota(v.begin(), v.end(), 0);
+    v.erase(std::next(v.begin(), 2));
+    REQUIRE(std::vector<int>(v.begin(), v.end()) == std::vector<int> { 0, 1, 3, 4 });
+    v.erase(v.begin());
+    REQUIRE(std::vector<int>(v.begin(), v.end()) == std::vector<int> { 1, 3, 4 });
+}
+
+TEST_CASE("chunked_vector.resize")
+{
+    auto v = chunked_vector<std::string>(2, "x");
+    v.resize(BlockSize + 2, "y");
+    REQUIRE(v.size() == BlockSize + 2);
+    REQUIRE(v[1] == "x");
+    REQUIRE(v[2] == "y");
+    v.resize(1);
+    REQUIRE(v.size() == 1);
+    REQUIRE(v.front() == "x");
+    v.clear();
+    REQUIRE(v.empty());
+}
+
+TEST_CASE("chunked_vector.copy_move")
+{
+    auto v = chunked_vector<std::string> {};
+    for (size_t i = 0; i < BlockSize + 3; ++i)
+        v.push_back(std::to_string(i));
+    v.pop_front();
+
+    auto copy = v;
+    REQUIRE(std::equal(copy.begin(), copy.end(), v.begin(), v.end()));
+
+    auto moved = std::move(copy);
+    REQUIRE(std::equal(moved.begin(), moved.end(), v.begin(), v.end()));
+
+    v = moved;
+    REQUIRE(v.size() == BlockSize + 2);
+    REQUIRE(v.front() == "1");
+}
+
+TEST_CASE("chunked_ring.rotate")
+{
+    auto r = chunked_ring<int>(3, 0);
+    std::iota(r.begin(), r.end(), 1);
+    r.rotate_left(1);
+    REQUIRE(r[0] == 2);
+    REQUIRE(r[1] == 3);
+    REQUIRE(r[2] == 1);
+    REQUIRE(r[-1] == 1);
+    r.rotate_right(2);
+    REQUIRE(r[0] == 3);
+
+    r.rezero();
+    REQUIRE(r.zero_index() == 0);
+    REQUIRE(std::vector<int>(r.begin(), r.end()) == std::vector<int> { 3, 1, 2 });
+}
+
+TEST_CASE("chunked_ring.grow")
+{
+    auto r = chunked_ring<int> {};
+    for (auto i = 0; i < static_cast<int>(3 * BlockSize); ++i)
+        r.emplace_back(i);
+    auto const* const first = &r[0];
+
+    r.rotate_left(5);
+    r.resize(4 * BlockSize);
+    REQUIRE(r.zero_index() == 0);
+    REQUIRE(r.size() == 4 * BlockSize);
+    REQUIRE(r[0] == 5);
+    REQUIRE(r[static_cast<long>(3 * BlockSize) - 1] == 4);
+    REQUIRE(&r[0] == first); // rezeroing moved the values, but not the slots
+
+    r.pop_front();
+    REQUIRE(r[0] == 6);
+}
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/cpu_time.h>
+
+#if defined(_WIN32)
+    #include <Windows.h>
+#else
+    #include <time.h>
+#endif
+
+namespace crispy
+{
+
+std::chrono::nanoseconds current_thread_cpu_time() noexcept
+{
+#if defined(_WIN32)
+    auto creationTime = FILETIME {};
+    auto exitTime = FILETIME {};
+    auto kernelTime = FILETIME {};
+    auto userTime = FILETIME {};
+    if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+        return std::chrono::nanoseconds::zero();
+
+    // FILETIME counts in units of 100 nanoseconds.
+    auto const ticksOf = [](FILETIME const& time) {
+        return (static_cast<long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return std::chrono::nanoseconds((ticksOf(kernelTime) + ticksOf(userTime)) * 100);
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    auto time = timespec {};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0)
+        return std::chrono::nanoseconds::zero();
+    return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+#else
+    return std::chrono::nanoseconds::zero();
+#endif
+}
+
+} // namespace crispy
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <chrono>
+
+namespace crispy
+{
+
+/// @returns the CPU time the calling thread has spent so far, in user and kernel mode together,
+///          or zero if the platform does not tell.
+///
+/// Unlike the wall-clock time, this does not count the time the thread has been waiting or preempted,
+/// so that the share of the process' CPU time each of its threads (or whatever they work on) takes
+/// can be told apart.
+[[nodiscard]] std::chrono::nanoseconds current_thread_cpu_time() noexcept;
+
+} // namespace crispy
@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/cpu_time.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST_CASE("cpu_time.current_thread")
+{
+    auto const start = crispy::current_thread_cpu_time();
+
+    // Waiting does not take CPU time.
+    std::this_thread::sleep_for(50ms);
+    auto const afterSleep = crispy::current_thread_cpu_time();
+    CHECK(afterSleep - start < 25ms);
+
+    // Spinning does.
+    auto const spinUntil = std::chrono::steady_clock::now() + 20ms;
+    while (std::chrono::steady_clock::now() < spinUntil)
+        ;
+    CHECK(crispy::current_thread_cpu_time() - afterSleep >= 10ms);
+}
+
+TEST_CASE("cpu_time.per_thread")
+{
+    // Another thread's CPU time is not accounted to the calling one.
+    auto const start = crispy::current_thread_cpu_time();
+    auto other = std::chrono::nanoseconds {};
+    std::thread([&]() {
+        auto const spinUntil = std::chrono::steady_clock::now() + 20ms;
+        while (std::chrono::steady_clock::now() < spinUntil)
+            ;
+        other = crispy::current_thread_cpu_time();
+    }).join();
+    CHECK(other >= 10ms);
+    CHECK(crispy::current_thread_cpu_time() - start < 10ms);
+}
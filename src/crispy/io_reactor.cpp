@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/io_reactor.h>
+#include <crispy/logstore.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#if defined(__linux__)
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+
+    #include <pthread.h>
+#endif
+
+namespace crispy
+{
+
+#if defined(__linux__)
+
+namespace
+{
+    constexpr auto StopId = uint64_t { 0 };
+} // namespace
+
+std::unique_ptr<io_reactor> io_reactor::create(size_t threadCount)
+{
+    auto const epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll < 0)
+        return nullptr;
+    auto epollFd = file_descriptor::from_native(epoll);
+
+    auto const stop = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop < 0)
+        return nullptr;
+    auto stopFd = file_descriptor::from_native(stop);
+
+    // Level-triggered and never rearmed, so that every thread is told to stop.
+    auto event = epoll_event {};
+    event.events = EPOLLIN;
+    event.data.u64 = StopId;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &event) != 0)
+        return nullptr;
+
+    auto reactor = std::unique_ptr<io_reactor>(new io_reactor(std::move(epollFd), std::move(stopFd)));
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < threadCount; ++i)
+        reactor->_threads.emplace_back(&io_reactor::run, reactor.get());
+    return reactor;
+}
+
+io_reactor::io_reactor(file_descriptor epollFd, file_descriptor stopFd) noexcept:
+    _epollFd { std::move(epollFd) }, _stopFd { std::move(stopFd) }
+{
+}
+
+io_reactor::~io_reactor()
+{
+    auto const value = eventfd_t { 1 };
+    [[maybe_unused]] auto const _ = ::write(_stopFd, &value, sizeof(value));
+    for (auto& thread: _threads)
+        thread.join();
+}
+
+bool io_reactor::arm(int fd, uint64_t id, bool added) noexcept
+{
+    auto event = epoll_event {};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = id;
+    return epoll_ctl(_epollFd, added ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+std::optional<uint64_t> io_reactor::add(int fd, handler onReadable)
+{
+    auto const _ = std::lock_guard { _mutex };
+    auto const id = _nextId++;
+    if (!arm(fd, id, false))
+    {
+        errorLog()("Failed to register file descriptor {} with the I/O reactor. {}", fd, strerror(errno));
+        return std::nullopt;
+    }
+    _registrations.emplace(id, std::make_shared<registration>(registration { fd, std::move(onReadable) }));
+    return id;
+}
+
+void io_reactor::resume(uint64_t id)
+{
+    auto const _ = std::lock_guard { _mutex };
+    auto const i = _registrations.find(id);
+    if (i == _registrations.end())
+        return;
+
+    // The running handler may be about to suspend it, which dispatch() then overrides.
+    auto& target = *i->second;
+    if (target.running)
+        target.resumed = true;
+    else if (std::exchange(target.suspended, false))
+        arm(target.fd, id, true);
+}
+
+void io_reactor::remove(uint64_t id)
+{
+    auto lock = std::unique_lock { _mutex };
+    auto const i = _registrations.find(id);
+    if (i == _registrations.end())
+        return;
+
+    auto const target = i->second;
+    _registrations.erase(i);
+    epoll_ctl(_epollFd, EPOLL_CTL_DEL, target->fd, nullptr);
+
+    if (target->running && target->thread != std::this_thread::get_id())
+        _handlerReturned.wait(lock, [&]() { return !target->running; });
+}
+
+void io_reactor::run() noexcept
+{
+    pthread_setname_np(pthread_self(), "io_reactor");
+
+    // With more than one thread, ready file descriptors are taken one at a time, so that the others
+    // are left to idle threads rather than waiting for a busy one to get to them.
+    auto events = std::array<epoll_event, 16> {};
+    auto const batchSize = _threads.size() == 1 ? static_cast<int>(events.size()) : 1;
+
+    for (;;)
+    {
+        auto const count = epoll_wait(_epollFd, events.data(), batchSize, -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            errorLog()("I/O reactor failed waiting for file descriptors. {}", strerror(errno));
+            return;
+        }
+
+        for (auto i = 0; i < count; ++i)
+        {
+            if (events[static_cast<size_t>(i)].data.u64 == StopId)
+                return;
+            dispatch(events[static_cast<size_t>(i)].data.u64);
+        }
+    }
+}
+
+void io_reactor::dispatch(uint64_t id)
+{
+    auto target = std::shared_ptr<registration> {};
+    {
+        auto const _ = std::lock_guard { _mutex };
+        auto const i = _registrations.find(id);
+        if (i == _registrations.end())
+            return; // removed after it had been reported ready
+        target = i->second;
+        target->running = true;
+        target->thread = std::this_thread::get_id();
+    }
+
+    auto const next = target->onReadable();
+
+    {
+        auto const _ = std::lock_guard { _mutex };
+        target->running = false;
+        auto const resumed = std::exchange(target->resumed, false);
+        if (_registrations.count(id) != 0)
+        {
+            switch (next)
+            {
+                case disposition::Rearm: arm(target->fd, id, true); break;
+                case disposition::Suspend:
+                    if (!resumed)
+                        target->suspended = true;
+                    else
+                        arm(target->fd, id, true);
+                    break;
+                case disposition::Remove:
+                    _registrations.erase(id);
+                    epoll_ctl(_epollFd, EPOLL_CTL_DEL, target->fd, nullptr);
+                    break;
+            }
+        }
+    }
+    _handlerReturned.notify_all();
+}
+
+#else
+
+std::unique_ptr<io_reactor> io_reactor::create(size_t /*threadCount*/)
+{
+    return nullptr;
+}
+
+io_reactor::io_reactor(file_descriptor epollFd, file_descriptor stopFd) noexcept:
+    _epollFd { std::move(epollFd) }, _stopFd { std::move(stopFd) }
+{
+}
+
+io_reactor::~io_reactor() = default;
+
+std::optional<uint64_t> io_reactor::add(int /*fd*/, handler /*onReadable*/)
+{
+    return std::nullopt;
+}
+
+void io_reactor::resume(uint64_t /*id*/)
+{
+}
+
+void io_reactor::remove(uint64_t /*id*/)
+{
+}
+
+#endif
+
+} // namespace crispy
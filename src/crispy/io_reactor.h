@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <crispy/file_descriptor.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace crispy
+{
+
+/**
+ * io_reactor multiplexes many file descriptors onto a fixed number of threads, invoking a handler
+ * on one of them whenever a registered file descriptor becomes readable, using epoll on Linux.
+ *
+ * Each registration is armed for a single readiness notification at a time, which is waited for again
+ * only once its handler returned. So a handler never runs concurrently with itself, and a handler
+ * doing a bounded amount of work per invocation lets the others take their turn, as readiness
+ * is reported in the order the file descriptors became (or stayed) ready again.
+ */
+class io_reactor
+{
+  public:
+    /// Tells what to do with a registration after its handler returned.
+    enum class disposition
+    {
+        Rearm,   // wait for the file descriptor to become readable again
+        Suspend, // do not invoke the handler again until resume()d
+        Remove,  // unregister the file descriptor
+    };
+
+    using handler = std::function<disposition()>;
+
+    /// Creates a reactor running @p threadCount threads, or as many as there are CPU cores if 0.
+    ///
+    /// @returns nullptr if not supported, i.e. on other platforms than Linux.
+    [[nodiscard]] static std::unique_ptr<io_reactor> create(size_t threadCount);
+
+    io_reactor(io_reactor const&) = delete;
+    io_reactor& operator=(io_reactor const&) = delete;
+    io_reactor(io_reactor&&) = delete;
+    io_reactor& operator=(io_reactor&&) = delete;
+
+    /// Stops and joins the threads, without invoking any more handlers.
+    ~io_reactor();
+
+    [[nodiscard]] size_t threadCount() const noexcept { return _threads.size(); }
+
+    /// Registers @p fd to invoke @p onReadable on one of the threads whenever it becomes readable.
+    ///
+    /// The file descriptor must stay open until it has been removed.
+    ///
+    /// @returns the ID of the registration, or std::nullopt if the file descriptor cannot be waited for.
+    [[nodiscard]] std::optional<uint64_t> add(int fd, handler onReadable);
+
+    /// Arms a registration suspended by its handler again.
+    void resume(uint64_t id);
+
+    /// Unregisters @p id, waiting for its handler to return if it is running on another thread.
+    void remove(uint64_t id);
+
+  private:
+    struct registration
+    {
+        int fd;
+        handler onReadable;
+        bool running = false;
+        bool suspended = false;
+        bool resumed = false;      // resume() has been called while the handler was running
+        std::thread::id thread {}; // the thread running the handler, if running
+    };
+
+    explicit io_reactor(file_descriptor epollFd, file_descriptor stopFd) noexcept;
+
+    void run() noexcept;
+    void dispatch(uint64_t id);
+    bool arm(int fd, uint64_t id, bool added) noexcept; // with _mutex locked
+
+    file_descriptor _epollFd;
+    file_descriptor _stopFd; // becomes readable, for all threads, once the reactor is being destroyed
+    std::vector<std::thread> _threads;
+
+    std::mutex _mutex;
+    std::condition_variable _handlerReturned;
+    std::unordered_map<uint64_t, std::shared_ptr<registration>> _registrations;
+    uint64_t _nextId = 1;
+};
+
+} // namespace crispy
@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/io_reactor.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <fcntl.h>
+
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+using crispy::io_reactor;
+using disposition = crispy::io_reactor::disposition;
+
+namespace
+{
+
+struct pipe_pair
+{
+    crispy::file_descriptor reader;
+    crispy::file_descriptor writer;
+
+    pipe_pair()
+    {
+        int fds[2];
+        REQUIRE(pipe(fds) == 0);
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        reader = crispy::file_descriptor::from_native(fds[0]);
+        writer = crispy::file_descriptor::from_native(fds[1]);
+    }
+
+    void send(std::string_view text) const
+    {
+        REQUIRE(::write(writer, text.data(), text.size()) == static_cast<ssize_t>(text.size()));
+    }
+
+    // Reads up to @p limit bytes of what is available.
+    [[nodiscard]] std::string receive(size_t limit = 4096) const
+    {
+        auto buffer = std::array<char, 4096> {};
+        auto const rv = ::read(reader, buffer.data(), std::min(limit, buffer.size()));
+        return rv > 0 ? std::string(buffer.data(), static_cast<size_t>(rv)) : std::string {};
+    }
+};
+
+template <typename Predicate>
+bool eventually(Predicate predicate)
+{
+    for (auto i = 0; i < 500; ++i)
+    {
+        if (predicate())
+            return true;
+        std::this_thread::sleep_for(2ms);
+    }
+    return false;
+}
+
+} // namespace
+
+TEST_CASE("io_reactor.readable", "[io_reactor]")
+{
+    auto reactor = io_reactor::create(1);
+    if (!reactor)
+        return; // not supported on this platform
+
+    auto const pipe = pipe_pair {};
+    auto received = std::string {};
+    auto mutex = std::mutex {};
+    auto const id = reactor->add(pipe.reader, [&]() {
+        auto const _ = std::lock_guard { mutex };
+        received += pipe.receive();
+        return disposition::Rearm;
+    });
+    REQUIRE(id.has_value());
+
+    pipe.send("hello");
+    CHECK(eventually([&]() {
+        auto const _ = std::lock_guard { mutex };
+        return received == "hello";
+    }));
+    pipe.send(", world");
+    CHECK(eventually([&]() {
+        auto const _ = std::lock_guard { mutex };
+        return received == "hello, world";
+    }));
+
+    reactor->remove(*id);
+}
+
+TEST_CASE("io_reactor.fairness", "[io_reactor]")
+{
+    auto reactor = io_reactor::create(1);
+    if (!reactor)
+        return;
+
+    // Reading a single byte per invocation, the busy pipe must not starve the quiet one.
+    auto const busy = pipe_pair {};
+    auto const quiet = pipe_pair {};
+    auto busyBytes = std::atomic<size_t> { 0 };
+    auto quietBytes = std::atomic<size_t> { 0 };
+    auto busyBytesSeenByQuiet = std::atomic<size_t> { 0 };
+
+    busy.send(std::string(1000, 'x'));
+    auto const busyId = reactor->add(busy.reader, [&]() {
+        busyBytes += busy.receive(1).size();
+        return disposition::Rearm;
+    });
+    auto const quietId = reactor->add(quiet.reader, [&]() {
+        quietBytes += quiet.receive(1).size();
+        busyBytesSeenByQuiet = busyBytes.load();
+        return disposition::Rearm;
+    });
+    REQUIRE(busyId.has_value());
+    REQUIRE(quietId.has_value());
+
+    quiet.send("q");
+    REQUIRE(eventually([&]() { return quietBytes == 1; }));
+    CHECK(busyBytesSeenByQuiet < 1000);
+    CHECK(eventually([&]() { return busyBytes == 1000; }));
+
+    reactor->remove(*busyId);
+    reactor->remove(*quietId);
+}
+
+TEST_CASE("io_reactor.suspend", "[io_reactor]")
+{
+    auto reactor = io_reactor::create(2);
+    if (!reactor)
+        return;
+
+    auto const pipe = pipe_pair {};
+    auto calls = std::atomic<int> { 0 };
+    auto const id = reactor->add(pipe.reader, [&]() {
+        ++calls;
+        return disposition::Suspend; // without reading, which would invoke it again right away if rearmed
+    });
+    REQUIRE(id.has_value());
+
+    pipe.send("x");
+    REQUIRE(eventually([&]() { return calls == 1; }));
+    std::this_thread::sleep_for(20ms);
+    CHECK(calls == 1);
+
+    reactor->resume(*id);
+    CHECK(eventually([&]() { return calls == 2; }));
+    std::this_thread::sleep_for(20ms);
+    CHECK(calls == 2);
+
+    reactor->remove(*id);
+}
+
+TEST_CASE("io_reactor.remove", "[io_reactor]")
+{
+    auto reactor = io_reactor::create(2);
+    if (!reactor)
+        return;
+
+    auto const pipe = pipe_pair {};
+    auto running = std::atomic<bool> { false };
+    auto returned = std::atomic<bool> { false };
+    auto const id = reactor->add(pipe.reader, [&]() {
+        running = true;
+        std::this_thread::sleep_for(50ms);
+        returned = true;
+        return disposition::Rearm;
+    });
+    REQUIRE(id.has_value());
+
+    pipe.send("x");
+    REQUIRE(eventually([&]() { return running.load(); }));
+
+    // Waits for the running handler, which is not invoked again, although the pipe stays readable.
+    reactor->remove(*id);
+    CHECK(returned);
+    running = false;
+    std::this_thread::sleep_for(20ms);
+    CHECK(!running);
+}
+
+TEST_CASE("io_reactor.remove_by_handler", "[io_reactor]")
+{
+    auto reactor = io_reactor::create(1);
+    if (!reactor)
+        return;
+
+    auto const first = pipe_pair {};
+    auto const second = pipe_pair {};
+    auto calls = std::atomic<int> { 0 };
+    auto secondId = std::atomic<uint64_t> { 0 };
+    auto const firstId = reactor->add(first.reader, [&]() {
+        ++calls;
+        return disposition::Remove;
+    });
+    auto const id = reactor->add(second.reader, [&]() {
+        ++calls;
+        reactor->remove(secondId); // from within its own handler, which must not wait for itself
+        return disposition::Rearm;
+    });
+    REQUIRE(firstId.has_value());
+    REQUIRE(id.has_value());
+    secondId = *id;
+
+    first.send("x");
+    second.send("y");
+    REQUIRE(eventually([&]() { return calls == 2; }));
+    std::this_thread::sleep_for(20ms);
+    CHECK(calls == 2);
+}
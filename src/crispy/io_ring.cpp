@@ -0,0 +1,235 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/io_ring.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
+namespace crispy
+{
+
+#if defined(__linux__)
+
+namespace
+{
+    template <typename T>
+    T* at(void* base, size_t offset) noexcept
+    {
+        return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+    }
+
+    // The ring heads and tails are shared with the kernel, and synchronized with it by acquire/release.
+    unsigned loadAcquire(unsigned* value) noexcept
+    {
+        return std::atomic_ref<unsigned>(*value).load(std::memory_order_acquire);
+    }
+
+    void storeRelease(unsigned* value, unsigned newValue) noexcept
+    {
+        std::atomic_ref<unsigned>(*value).store(newValue, std::memory_order_release);
+    }
+} // namespace
+
+std::unique_ptr<io_ring> io_ring::create(unsigned entries)
+{
+    auto params = io_uring_params {};
+    auto const fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0)
+        return nullptr;
+
+    auto ringFd = file_descriptor::from_native(fd);
+
+    // Waiting with a timeout requires IORING_FEAT_EXT_ARG (Linux 5.11).
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG))
+        return nullptr;
+
+    auto rings = mapping {};
+    rings.size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                          params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    rings.data =
+        mmap(nullptr, rings.size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (rings.data == MAP_FAILED)
+        return nullptr;
+
+    auto sqes = mapping {};
+    sqes.size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes.data =
+        mmap(nullptr, sqes.size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes.data == MAP_FAILED)
+    {
+        munmap(rings.data, rings.size);
+        return nullptr;
+    }
+
+    auto ring = std::unique_ptr<io_ring>(new io_ring(std::move(ringFd), rings, sqes));
+    ring->_sqHead = at<unsigned>(rings.data, params.sq_off.head);
+    ring->_sqTail = at<unsigned>(rings.data, params.sq_off.tail);
+    ring->_sqMask = *at<unsigned>(rings.data, params.sq_off.ring_mask);
+    ring->_sqArray = at<unsigned>(rings.data, params.sq_off.array);
+    ring->_sqEntries = params.sq_entries;
+    ring->_cqHead = at<unsigned>(rings.data, params.cq_off.head);
+    ring->_cqTail = at<unsigned>(rings.data, params.cq_off.tail);
+    ring->_cqMask = *at<unsigned>(rings.data, params.cq_off.ring_mask);
+    ring->_cqes = at<void>(rings.data, params.cq_off.cqes);
+    return ring;
+}
+
+io_ring::io_ring(file_descriptor fd, mapping rings, mapping entries) noexcept:
+    _fd { std::move(fd) }, _rings { rings }, _entries { entries }
+{
+}
+
+io_ring::~io_ring()
+{
+    munmap(_entries.data, _entries.size);
+    munmap(_rings.data, _rings.size);
+}
+
+bool io_ring::register_buffer(void* data, size_t size) noexcept
+{
+    auto const buffer = iovec { data, size };
+    return syscall(__NR_io_uring_register, _fd.get(), IORING_REGISTER_BUFFERS, &buffer, 1) == 0;
+}
+
+bool io_ring::read(int fd, void* target, unsigned size, uint64_t user_data) noexcept
+{
+    return queue(IORING_OP_READ, fd, target, size, user_data);
+}
+
+bool io_ring::read_fixed(int fd, void* target, unsigned size, uint64_t user_data) noexcept
+{
+    return queue(IORING_OP_READ_FIXED, fd, target, size, user_data);
+}
+
+bool io_ring::write(int fd, void const* source, unsigned size, uint64_t user_data) noexcept
+{
+    return queue(IORING_OP_WRITE, fd, source, size, user_data);
+}
+
+bool io_ring::write_fixed(int fd, void const* source, unsigned size, uint64_t user_data) noexcept
+{
+    return queue(IORING_OP_WRITE_FIXED, fd, source, size, user_data);
+}
+
+bool io_ring::queue(uint8_t opcode, int fd, void const* data, unsigned size, uint64_t user_data) noexcept
+{
+    auto const tail = *_sqTail;
+    if (tail - loadAcquire(_sqHead) >= _sqEntries)
+        return false;
+
+    auto const index = tail & _sqMask;
+    auto* const sqe = static_cast<io_uring_sqe*>(_entries.data) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = size;
+    sqe->off = static_cast<uint64_t>(-1); // at the current file position, as for pipes and terminals
+    sqe->user_data = user_data;
+    _sqArray[index] = index;
+    storeRelease(_sqTail, tail + 1);
+    return true;
+}
+
+unsigned io_ring::unsubmitted() const noexcept
+{
+    return *_sqTail - loadAcquire(_sqHead);
+}
+
+int io_ring::submit_and_wait(std::optional<std::chrono::milliseconds> timeout) noexcept
+{
+    auto ts = __kernel_timespec {};
+    auto arg = io_uring_getevents_arg {};
+    if (timeout)
+    {
+        ts.tv_sec = timeout->count() / 1000;
+        ts.tv_nsec = (timeout->count() % 1000) * 1'000'000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+
+    auto const rv = syscall(__NR_io_uring_enter,
+                            _fd.get(),
+                            unsubmitted(),
+                            1,
+                            IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                            &arg,
+                            sizeof(arg));
+    if (rv < 0)
+        return -errno;
+
+    // Having submitted anything, the kernel reports the number of submitted entries rather than timeouts.
+    return *_cqHead == loadAcquire(_cqTail) ? -ETIME : 0;
+}
+
+std::optional<io_ring::completion> io_ring::pop_completion() noexcept
+{
+    auto const head = *_cqHead;
+    if (head == loadAcquire(_cqTail))
+        return std::nullopt;
+
+    auto const& cqe = static_cast<io_uring_cqe const*>(_cqes)[head & _cqMask];
+    auto const result = completion { cqe.user_data, cqe.res };
+    storeRelease(_cqHead, head + 1);
+    return result;
+}
+
+#else
+
+std::unique_ptr<io_ring> io_ring::create(unsigned /*entries*/)
+{
+    // io_uring is specific to Linux.
+    return nullptr;
+}
+
+io_ring::~io_ring() = default;
+
+bool io_ring::register_buffer(void* /*data*/, size_t /*size*/) noexcept
+{
+    return false;
+}
+
+bool io_ring::read(int /*fd*/, void* /*target*/, unsigned /*size*/, uint64_t /*user_data*/) noexcept
+{
+    return false;
+}
+
+bool io_ring::read_fixed(int /*fd*/, void* /*target*/, unsigned /*size*/, uint64_t /*user_data*/) noexcept
+{
+    return false;
+}
+
+bool io_ring::write(int /*fd*/, void const* /*source*/, unsigned /*size*/, uint64_t /*user_data*/) noexcept
+{
+    return false;
+}
+
+bool io_ring::write_fixed(int /*fd*/,
+                          void const* /*source*/,
+                          unsigned /*size*/,
+                          uint64_t /*user_data*/) noexcept
+{
+    return false;
+}
+
+int io_ring::submit_and_wait(std::optional<std::chrono::milliseconds> /*timeout*/) noexcept
+{
+    return -ENOSYS;
+}
+
+std::optional<io_ring::completion> io_ring::pop_completion() noexcept
+{
+    return std::nullopt;
+}
+
+#endif
+
+} // namespace crispy
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <crispy/file_descriptor.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace crispy
+{
+
+/**
+ * io_ring is a minimal wrapper around a Linux io_uring instance, queueing reads and writes against
+ * file descriptors and waiting for their completions, using the raw system calls.
+ *
+ * Queued reads are submitted with the very system call that waits for completions,
+ * so a stream of reads costs a single system call per chunk, instead of one for waiting
+ * for the file descriptor to become readable plus one for reading from it.
+ *
+ * An io_ring must only be used by a single thread at a time.
+ */
+class io_ring
+{
+  public:
+    struct completion
+    {
+        uint64_t user_data;
+        int32_t result; // number of bytes read or written, or negated errno
+    };
+
+    /// Creates a ring with room for @p entries queued operations.
+    ///
+    /// @returns nullptr if io_uring is unavailable, e.g. on other platforms, older kernels,
+    ///          or when it is disabled by the system or a sandbox.
+    [[nodiscard]] static std::unique_ptr<io_ring> create(unsigned entries);
+
+    io_ring(io_ring const&) = delete;
+    io_ring& operator=(io_ring const&) = delete;
+    io_ring(io_ring&&) = delete;
+    io_ring& operator=(io_ring&&) = delete;
+    ~io_ring();
+
+    /// Registers the given memory, which must outlive the ring, for use by read_fixed() and write_fixed().
+    bool register_buffer(void* data, size_t size) noexcept;
+
+    /// Queues a read of up to @p size bytes from @p fd into @p target.
+    ///
+    /// @returns false if the submission queue is full.
+    bool read(int fd, void* target, unsigned size, uint64_t user_data) noexcept;
+
+    /// Queues a read like read(), but into the memory previously registered by register_buffer().
+    bool read_fixed(int fd, void* target, unsigned size, uint64_t user_data) noexcept;
+
+    /// Queues a write of up to @p size bytes from @p source to @p fd.
+    ///
+    /// The source must stay untouched until the write completed.
+    ///
+    /// @returns false if the submission queue is full.
+    bool write(int fd, void const* source, unsigned size, uint64_t user_data) noexcept;
+
+    /// Queues a write like write(), but from the memory previously registered by register_buffer().
+    bool write_fixed(int fd, void const* source, unsigned size, uint64_t user_data) noexcept;
+
+    /// Submits all queued operations and waits for at least one completion, or until the timeout passed.
+    ///
+    /// @returns 0 on success, or the negated errno, e.g. -ETIME on timeout, or -EINTR.
+    int submit_and_wait(std::optional<std::chrono::milliseconds> timeout) noexcept;
+
+    /// @returns the next completion, if any, removing it from the completion queue.
+    [[nodiscard]] std::optional<completion> pop_completion() noexcept;
+
+  private:
+    struct mapping
+    {
+        void* data = nullptr;
+        size_t size = 0;
+    };
+
+    io_ring(file_descriptor fd, mapping rings, mapping entries) noexcept;
+
+    [[nodiscard]] unsigned unsubmitted() const noexcept;
+
+    bool queue(uint8_t opcode, int fd, void const* data, unsigned size, uint64_t user_data) noexcept;
+
+    file_descriptor _fd;
+    mapping _rings;   // submission and completion queue rings, sharing a single mapping
+    mapping _entries; // submission queue entries
+
+    // Pointers into _rings, as told by the kernel on setup.
+    unsigned* _sqHead = nullptr;
+    unsigned* _sqTail = nullptr;
+    unsigned _sqMask = 0;
+    unsigned* _sqArray = nullptr;
+    unsigned* _cqHead = nullptr;
+    unsigned* _cqTail = nullptr;
+    unsigned _cqMask = 0;
+    void* _cqes = nullptr;
+
+    unsigned _sqEntries = 0;
+};
+
+} // namespace crispy
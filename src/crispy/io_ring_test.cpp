@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/io_ring.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+using crispy::io_ring;
+
+TEST_CASE("io_ring.read", "[io_ring]")
+{
+    auto ring = io_ring::create(4);
+    if (!ring)
+        return; // io_uring is not available on this system
+
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    auto const reader = crispy::file_descriptor::from_native(fds[0]);
+    auto const writer = crispy::file_descriptor::from_native(fds[1]);
+
+    auto buffer = std::array<char, 16> {};
+    REQUIRE(ring->read(reader, buffer.data(), buffer.size(), 42));
+
+    // Nothing to read yet.
+    CHECK(ring->submit_and_wait(10ms) == -ETIME);
+    CHECK(!ring->pop_completion().has_value());
+
+    REQUIRE(::write(writer, "hello", 5) == 5);
+    CHECK(ring->submit_and_wait(std::nullopt) == 0);
+    auto const completion = ring->pop_completion();
+    REQUIRE(completion.has_value());
+    CHECK(completion->user_data == 42);
+    REQUIRE(completion->result == 5);
+    CHECK(std::string_view(buffer.data(), 5) == "hello");
+    CHECK(!ring->pop_completion().has_value());
+}
+
+TEST_CASE("io_ring.read_fixed", "[io_ring]")
+{
+    auto ring = io_ring::create(4);
+    if (!ring)
+        return; // io_uring is not available on this system
+
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    auto const reader = crispy::file_descriptor::from_native(fds[0]);
+    auto const writer = crispy::file_descriptor::from_native(fds[1]);
+
+    auto buffer = std::array<char, 32> {};
+    if (!ring->register_buffer(buffer.data(), buffer.size()))
+        return; // e.g. exceeding RLIMIT_MEMLOCK
+
+    // Reads into different parts of the registered memory complete independently.
+    REQUIRE(ring->read_fixed(reader, buffer.data() + 16, 16, 2));
+    REQUIRE(::write(writer, "abc", 3) == 3);
+    CHECK(ring->submit_and_wait(std::nullopt) == 0);
+    auto const completion = ring->pop_completion();
+    REQUIRE(completion.has_value());
+    CHECK(completion->user_data == 2);
+    REQUIRE(completion->result == 3);
+    CHECK(std::string_view(buffer.data() + 16, 3) == "abc");
+}
+
+TEST_CASE("io_ring.end_of_file", "[io_ring]")
+{
+    auto ring = io_ring::create(4);
+    if (!ring)
+        return; // io_uring is not available on this system
+
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    auto const reader = crispy::file_descriptor::from_native(fds[0]);
+    auto writer = crispy::file_descriptor::from_native(fds[1]);
+
+    auto buffer = std::array<char, 16> {};
+    REQUIRE(ring->read(reader, buffer.data(), buffer.size(), 1));
+    writer.close();
+    CHECK(ring->submit_and_wait(std::nullopt) == 0);
+    auto const completion = ring->pop_completion();
+    REQUIRE(completion.has_value());
+    CHECK(completion->result == 0);
+}
+
+TEST_CASE("io_ring.write", "[io_ring]")
+{
+    auto ring = io_ring::create(4);
+    if (!ring)
+        return; // io_uring is not available on this system
+
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    auto const reader = crispy::file_descriptor::from_native(fds[0]);
+    auto const writer = crispy::file_descriptor::from_native(fds[1]);
+    REQUIRE(fcntl(writer, F_SETFL, O_NONBLOCK) == 0);
+
+    // Fill up the pipe, so that the write has to wait for it to become writable.
+    auto filler = std::vector<char>(1024 * 1024, 'x');
+    auto const filled = ::write(writer, filler.data(), filler.size());
+    REQUIRE(filled > 0);
+
+    REQUIRE(ring->write(writer, "hello", 5, 7));
+    CHECK(ring->submit_and_wait(10ms) == -ETIME);
+
+    // Draining the pipe lets the write complete.
+    auto drained = ssize_t { 0 };
+    while (drained < filled)
+    {
+        auto const rv = ::read(reader, filler.data(), filler.size());
+        REQUIRE(rv > 0);
+        drained += rv;
+    }
+    CHECK(ring->submit_and_wait(std::nullopt) == 0);
+    auto const completion = ring->pop_completion();
+    REQUIRE(completion.has_value());
+    CHECK(completion->user_data == 7);
+    REQUIRE(completion->result == 5);
+
+    auto buffer = std::array<char, 16> {};
+    REQUIRE(::read(reader, buffer.data(), buffer.size()) == 5);
+    CHECK(std::string_view(buffer.data(), 5) == "hello");
+}
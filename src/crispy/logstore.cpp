@@ -1,9 +1,336 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <crispy/logstore.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <thread>
+
 namespace logstore
 {
 
+namespace
+{
+    // {{{ deferred message rings
+    // Each logging thread owns a lock-free single producer, single consumer ring of deferred messages,
+    // which the background thread drains, merging the messages of all rings by their time.
+    //
+    // Records are aligned to 8 bytes and never wrap around, but are preceded by a record of size 0
+    // telling the consumer to continue at the start of the ring, if they do not fit to its end.
+
+    constexpr size_t RingCapacity = 1024 * 1024;
+    constexpr size_t RecordAlignment = 8;
+
+    struct record_header
+    {
+        uint32_t size; // of the whole record, including this header, or 0 if skipping to the start
+        category const* origin;
+        sink* target;
+        source_location location;
+        message_builder::clock::time_point time;
+    };
+
+    static_assert(std::is_trivially_copyable_v<record_header>);
+
+    record_header readHeader(char const* record) noexcept
+    {
+        auto header = record_header { 0, nullptr, nullptr, source_location::current(), {} };
+        std::memcpy(&header, record, sizeof(header));
+        return header;
+    }
+
+    message_builder::clock::time_point readTime(char const* record) noexcept
+    {
+        auto time = message_builder::clock::time_point {};
+        std::memcpy(&time, record + offsetof(record_header, time), sizeof(time));
+        return time;
+    }
+
+    constexpr size_t alignRecord(size_t size) noexcept
+    {
+        return (size + RecordAlignment - 1) & ~(RecordAlignment - 1);
+    }
+
+    struct message_ring
+    {
+        std::unique_ptr<char[]> data = std::make_unique<char[]>(RingCapacity);
+
+        // Total numbers of bytes consumed and produced.
+        alignas(64) std::atomic<uint64_t> head = 0;
+        alignas(64) std::atomic<uint64_t> tail = 0;
+
+        std::atomic<uint64_t> dropped = 0;
+        std::atomic<bool> abandoned = false; // the producing thread exited
+
+        /// Stores a record of the given header and payload.
+        ///
+        /// @returns the number of bytes in use, or std::nullopt if the ring is full.
+        std::optional<size_t> push(record_header header, std::string_view payload) noexcept
+        {
+            auto const size = alignRecord(sizeof(record_header) + payload.size());
+            if (size > RingCapacity / 2)
+                return std::nullopt;
+
+            auto const current = tail.load(std::memory_order_relaxed);
+            auto const offset = current % RingCapacity;
+            auto const skip = offset + size > RingCapacity ? RingCapacity - offset : 0;
+            auto const used = current - head.load(std::memory_order_acquire);
+            if (used + skip + size > RingCapacity)
+                return std::nullopt;
+
+            if (skip)
+            {
+                auto const marker = uint32_t { 0 };
+                std::memcpy(data.get() + offset, &marker, sizeof(marker));
+            }
+
+            header.size = static_cast<uint32_t>(size);
+            auto* const target = data.get() + (current + skip) % RingCapacity;
+            std::memcpy(target, &header, sizeof(header));
+            std::memcpy(target + sizeof(header), payload.data(), payload.size());
+            tail.store(current + skip + size, std::memory_order_release);
+            return used + skip + size;
+        }
+
+        /// @returns the oldest record, if any, skipping to the start of the ring as needed.
+        char const* front() noexcept
+        {
+            auto const current = head.load(std::memory_order_relaxed);
+            if (current == tail.load(std::memory_order_acquire))
+                return nullptr;
+
+            auto const offset = current % RingCapacity;
+            auto size = uint32_t {};
+            std::memcpy(&size, data.get() + offset, sizeof(size));
+            if (size != 0)
+                return data.get() + offset;
+
+            head.store(current + RingCapacity - offset, std::memory_order_release);
+            return front();
+        }
+
+        void pop(uint32_t size) noexcept
+        {
+            head.store(head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+        }
+    };
+
+    // Set once the dispatcher is being destroyed, after which messages are written right away.
+    std::atomic<bool> dispatcherShutDown = false;
+
+    // Messages logged by formatters and writers are written right away, too.
+    thread_local bool onDispatcherThread = false;
+
+    /// Owns the background thread formatting and writing the deferred messages.
+    class dispatcher
+    {
+      public:
+        static dispatcher& get()
+        {
+            static dispatcher instance;
+            return instance;
+        }
+
+        static bool running() noexcept { return _running.load(std::memory_order_acquire); }
+
+        dispatcher(dispatcher const&) = delete;
+        dispatcher& operator=(dispatcher const&) = delete;
+        dispatcher(dispatcher&&) = delete;
+        dispatcher& operator=(dispatcher&&) = delete;
+
+        ~dispatcher()
+        {
+            dispatcherShutDown.store(true, std::memory_order_release);
+            {
+                auto const _ = std::lock_guard(_mutex);
+                _stopping = true;
+            }
+            _wakeup.notify_one();
+            _thread.join();
+            _running.store(false, std::memory_order_release);
+        }
+
+        std::shared_ptr<message_ring> registerRing()
+        {
+            auto ring = std::make_shared<message_ring>();
+            auto const _ = std::lock_guard(_ringsMutex);
+            _rings.push_back(ring);
+            return ring;
+        }
+
+        void wake() noexcept { _wakeup.notify_one(); }
+
+        /// Waits for all messages that have been queued so far to be written.
+        void flush()
+        {
+            if (onDispatcherThread)
+                return;
+
+            auto lock = std::unique_lock(_mutex);
+            auto const generation = ++_requested;
+            _wakeup.notify_one();
+            _flushed.wait(lock, [&]() { return _completed >= generation || _stopping; });
+        }
+
+      private:
+        dispatcher(): _thread { [this]() { run(); } } { _running.store(true, std::memory_order_release); }
+
+        void run()
+        {
+            onDispatcherThread = true;
+            auto lock = std::unique_lock(_mutex);
+            for (;;)
+            {
+                _wakeup.wait_for(lock, std::chrono::milliseconds(10), [&]() {
+                    return _requested != _completed || _stopping;
+                });
+                auto const generation = _requested;
+                auto const stopping = _stopping;
+                lock.unlock();
+
+                drain();
+
+                lock.lock();
+                _completed = generation;
+                _flushed.notify_all();
+                if (stopping)
+                    return;
+            }
+        }
+
+        /// Writes all queued messages, oldest first.
+        void drain()
+        {
+            auto rings = [&]() {
+                auto const _ = std::lock_guard(_ringsMutex);
+                std::erase_if(_rings, [](auto const& ring) {
+                    return ring->abandoned.load(std::memory_order_acquire) && !ring->front()
+                           && !ring->dropped.load(std::memory_order_relaxed);
+                });
+                return _rings;
+            }();
+
+            for (;;)
+            {
+                message_ring* oldestRing = nullptr;
+                char const* oldest = nullptr;
+                for (auto const& ring: rings)
+                {
+                    auto const* record = ring->front();
+                    if (record && (!oldest || readTime(record) < readTime(oldest)))
+                    {
+                        oldestRing = ring.get();
+                        oldest = record;
+                    }
+                }
+                if (!oldest)
+                    break;
+
+                auto const header = readHeader(oldest);
+                // The payload is padded to the record alignment, which decoding the segments ignores.
+                write(header, std::string_view(oldest + sizeof(header), header.size - sizeof(header)));
+                oldestRing->pop(header.size);
+            }
+
+            for (auto const& ring: rings)
+                if (auto const dropped = ring->dropped.exchange(0, std::memory_order_relaxed))
+                    errorLog()("{} log messages were dropped, as they were logged faster than written.",
+                               dropped);
+        }
+
+        static void write(record_header const& header, std::string_view payload)
+        {
+            try
+            {
+                auto text = std::string {};
+                detail::decodeSegments(text, payload);
+                auto const message =
+                    message_builder(*header.origin, header.location, header.time, std::move(text));
+                header.target->write(message);
+            }
+            catch (std::exception const& e)
+            {
+                std::cerr << "Failed to write log message: " << e.what() << '\n';
+            }
+        }
+
+        static inline std::atomic<bool> _running = false;
+
+        std::mutex _ringsMutex;
+        std::vector<std::shared_ptr<message_ring>> _rings;
+
+        std::mutex _mutex;
+        std::condition_variable _wakeup;
+        std::condition_variable _flushed;
+        uint64_t _requested = 0;
+        uint64_t _completed = 0;
+        bool _stopping = false;
+
+        std::thread _thread;
+    };
+
+    /// Marks the ring of the current thread as abandoned as the thread exits.
+    struct thread_ring
+    {
+        std::shared_ptr<message_ring> ring;
+
+        thread_ring(): ring { dispatcher::get().registerRing() } {}
+        thread_ring(thread_ring const&) = delete;
+        thread_ring& operator=(thread_ring const&) = delete;
+        thread_ring(thread_ring&&) = delete;
+        thread_ring& operator=(thread_ring&&) = delete;
+        ~thread_ring() { ring->abandoned.store(true, std::memory_order_release); }
+    };
+    // }}}
+} // namespace
+
+namespace detail
+{
+    void decodeSegments(std::string& output, std::string_view input)
+    {
+        auto const* current = input.data();
+        auto const* const end = current + input.size();
+        // Each segment is at least as large as its decoder, whereas the padding is smaller.
+        while (end - current >= static_cast<std::ptrdiff_t>(sizeof(segment_decoder)))
+        {
+            auto const decoder = decodeValue<segment_decoder>(current);
+            if (!decoder)
+                break;
+            current = decoder(output, current);
+        }
+    }
+
+    void enqueue(message_builder const& message)
+    {
+        auto& category = message.get_category();
+        auto const header =
+            record_header { 0, &category, &category.sink(), message.location(), message.time() };
+
+        if (onDispatcherThread || dispatcherShutDown.load(std::memory_order_acquire))
+        {
+            auto text = std::string {};
+            decodeSegments(text, message.text());
+            category.sink().write(message_builder(category, header.location, header.time, std::move(text)));
+            return;
+        }
+
+        thread_local auto const current = thread_ring {};
+        auto const used = current.ring->push(header, message.text());
+        if (!used)
+            current.ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        else if (*used > RingCapacity / 2)
+            dispatcher::get().wake();
+    }
+} // namespace detail
+
+void flush()
+{
+    if (dispatcher::running())
+        dispatcher::get().flush();
+}
+
 sink::sink(bool enabled, writer wr): _enabled { enabled }, _writer { std::move(wr) }
 {
 }
@@ -24,6 +351,20 @@ sink::sink(bool enabled, std::shared_ptr<std::ostream> f):
 {
 }
 
+sink::~sink()
+{
+    // Deferred messages refer to their sink.
+    if (_asynchronous)
+        flush();
+}
+
+void sink::set_asynchronous(bool asynchronous)
+{
+    if (_asynchronous && !asynchronous)
+        flush();
+    _asynchronous = asynchronous;
+}
+
 sink& sink::console()
 {
     static auto instance = sink(false, std::cout);
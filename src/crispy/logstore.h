@@ -8,12 +8,17 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <iterator>
 #include <memory>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 #if defined __has_include
@@ -33,12 +38,28 @@
 //     #define LOGSTORE_HAS_EXPERIMENTAL_SOURCE_LOCATION 1
 // #endif
 
+// Categories of a level below this one are compiled out, see leveled_category.
+#if !defined(LOGSTORE_MINIMUM_LEVEL)
+    #define LOGSTORE_MINIMUM_LEVEL Trace
+#endif
+
 namespace logstore
 {
 
 class category;
+class message_builder;
 class sink;
 
+/// Verbosity of a logging category.
+enum class level
+{
+    Trace,
+    Debug,
+    Info,
+};
+
+constexpr inline level MinimumLevel = level::LOGSTORE_MINIMUM_LEVEL;
+
 class source_location_custom
 {
   public:
@@ -70,49 +91,190 @@ using source_location = source_location_custom;
     #endif
 #endif
 
-class message_builder
+namespace detail
 {
-  private:
-    category const& _category;
-    source_location _location;
-    std::string _buffer;
+    // {{{ deferred formatting
+    // Messages to asynchronous sinks are not formatted by the logging thread, but encoded into segments,
+    // each led by the function decoding and formatting it, followed by the format string and the arguments.
+    // Arithmetic and enum arguments are stored as they are, and strings by their contents.
+    // Segments with any other arguments are formatted right away.
+    using segment_decoder = char const* (*) (std::string& output, char const* input);
+
+    template <typename T>
+    constexpr bool IsDeferredText = std::is_convertible_v<T const&, std::string_view>;
+
+    template <typename T>
+    constexpr bool IsDeferredValue = std::is_arithmetic_v<T> || std::is_enum_v<T>;
+
+    template <typename T>
+    using deferred_type = std::conditional_t<IsDeferredText<T>, std::string_view, T>;
 
+    template <typename T>
+    void encodeValue(std::string& output, T const& value)
+    {
+        output.append(reinterpret_cast<char const*>(&value), sizeof(value));
+    }
+
+    inline void encodeText(std::string& output, std::string_view text)
+    {
+        encodeValue(output, static_cast<uint32_t>(text.size()));
+        output.append(text);
+    }
+
+    template <typename T>
+    T decodeValue(char const*& input)
+    {
+        T value;
+        std::memcpy(&value, input, sizeof(value));
+        input += sizeof(value);
+        return value;
+    }
+
+    inline std::string_view decodeText(char const*& input)
+    {
+        auto const size = decodeValue<uint32_t>(input);
+        auto const text = std::string_view(input, size);
+        input += size;
+        return text;
+    }
+
+    inline char const* decodeLiteral(std::string& output, char const* input)
+    {
+        output += decodeText(input);
+        return input;
+    }
+
+    template <typename... T>
+    char const* decodeFormatted(std::string& output, char const* input)
+    {
+        auto const format = decodeText(input);
+        auto const values = std::tuple<T...> { [&]() {
+            if constexpr (std::is_same_v<T, std::string_view>)
+                return decodeText(input);
+            else
+                return decodeValue<T>(input);
+        }()... };
+        std::apply(
+            [&](auto const&... args) {
+                fmt::vformat_to(std::back_inserter(output), format, fmt::make_format_args(args...));
+            },
+            values);
+        return input;
+    }
+
+    inline void encodeLiteral(std::string& output, std::string_view text)
+    {
+        encodeValue(output, segment_decoder { &decodeLiteral });
+        encodeText(output, text);
+    }
+
+    template <typename... T>
+    void encodeFormatted(std::string& output, std::string_view format, T const&... args)
+    {
+        if constexpr (((IsDeferredText<T> || IsDeferredValue<T>) &&...))
+        {
+            encodeValue(output, segment_decoder { &decodeFormatted<deferred_type<T>...> });
+            encodeText(output, format);
+            (
+                [&]() {
+                    if constexpr (IsDeferredText<T>)
+                        encodeText(output, std::string_view(args));
+                    else
+                        encodeValue(output, args);
+                }(),
+                ...);
+        }
+        else
+            encodeLiteral(output, fmt::vformat(format, fmt::make_format_args(args...)));
+    }
+
+    /// Formats the segments of a deferred message.
+    void decodeSegments(std::string& output, std::string_view input);
+
+    /// Queues a deferred message to be formatted and written by the background thread.
+    void enqueue(message_builder const& message);
+    // }}}
+} // namespace detail
+
+class message_builder
+{
   public:
+    using clock = std::chrono::system_clock;
+
     explicit message_builder(category const& cat, source_location loc = source_location::current());
 
+    /// Constructs an already built message, as passed to formatters for deferred messages.
+    /// It is not written to any sink on destruction.
+    message_builder(category const& cat, source_location loc, clock::time_point time, std::string text);
+
+    message_builder(message_builder const&) = delete;
+    message_builder& operator=(message_builder const&) = delete;
+    message_builder(message_builder&&) = delete;
+    message_builder& operator=(message_builder&&) = delete;
+
     [[nodiscard]] category const& get_category() const noexcept { return _category; }
     [[nodiscard]] source_location const& location() const noexcept { return _location; }
 
+    /// Time at which the message was built, rather than when it has been formatted.
+    [[nodiscard]] clock::time_point time() const noexcept { return _time; }
+
+    /// The message text, or the encoded message while still building a deferred message.
     [[nodiscard]] std::string const& text() const noexcept { return _buffer; }
 
+    [[nodiscard]] bool deferred() const noexcept { return _mode == mode::Deferred; }
+
     message_builder& append(std::string_view msg)
     {
-        _buffer += msg;
+        if (_mode == mode::Immediate)
+            _buffer += msg;
+        else if (_mode == mode::Deferred)
+            detail::encodeLiteral(_buffer, msg);
         return *this;
     }
 
     template <typename... T>
     message_builder& append(fmt::format_string<T...> fmt, T&&... args)
     {
-        _buffer += fmt::vformat(fmt, fmt::make_format_args(args...));
-        return *this;
+        auto const view = fmt::string_view(fmt);
+        return format(std::string_view(view.data(), view.size()), args...);
     }
 
-    message_builder& operator()(std::string const& msg)
-    {
-        _buffer += msg;
-        return *this;
-    }
+    message_builder& operator()(std::string const& msg) { return append(std::string_view(msg)); }
+
     template <typename... T>
     message_builder& operator()(std::string_view fmt, T&&... args)
     {
-        _buffer += fmt::vformat(fmt, fmt::make_format_args(args...));
-        return *this;
+        return format(fmt, args...);
     }
 
     [[nodiscard]] std::string message() const;
 
     ~message_builder();
+
+  private:
+    enum class mode : uint8_t
+    {
+        Disabled,  // neither formatted nor written
+        Immediate, // formatted right away
+        Deferred,  // encoded, to be formatted by the background thread
+        Built,     // already built, not to be written again
+    };
+
+    template <typename... T>
+    message_builder& format(std::string_view fmt, T const&... args)
+    {
+        if (_mode == mode::Immediate)
+            _buffer += fmt::vformat(fmt, fmt::make_format_args(args...));
+        else if (_mode == mode::Deferred)
+            detail::encodeFormatted(_buffer, fmt, args...);
+        return *this;
+    }
+
+    category const& _category;
+    source_location _location;
+    clock::time_point _time;
+    mode _mode;
+    std::string _buffer;
 };
 
 /// Defines a logging category, such as: error, warning, metrics, vt.backend, or renderer.
@@ -144,7 +306,10 @@ class category
     [[nodiscard]] std::string_view description() const noexcept { return _description; }
 
     [[nodiscard]] bool is_enabled() const noexcept { return _state == state::Enabled; }
-    void enable(bool enabled = true) noexcept { _state = enabled ? state::Enabled : state::Disabled; }
+    void enable(bool enabled = true) noexcept
+    {
+        _state = enabled && _compiledIn ? state::Enabled : state::Disabled;
+    }
     void disable() noexcept { _state = state::Disabled; }
 
     [[nodiscard]] bool visible() const noexcept { return _visibility == visibility::Public; }
@@ -170,6 +335,13 @@ class category
 
     static std::string defaultFormatter(message_builder const& message);
 
+  protected:
+    category(std::string_view name,
+             std::string_view desc,
+             state state,
+             visibility visibility,
+             bool compiledIn) noexcept;
+
   private:
     std::string_view _name;
     std::string_view _description;
@@ -177,8 +349,36 @@ class category
     visibility _visibility;
     formatter _formatter;
     std::reference_wrapper<logstore::sink> _sink;
+    bool _compiledIn = true;
 };
 
+/// Logging category of the given verbosity, which is compiled out entirely if below
+/// LOGSTORE_MINIMUM_LEVEL, such that it can never be enabled, and checking it is a compile time constant.
+///
+/// Log statements guarded by the category, as in `if (ptyInLog) ptyInLog()(...)`,
+/// are then eliminated altogether, including the evaluation of their arguments.
+template <level Level>
+class leveled_category: public category
+{
+  public:
+    static constexpr bool CompiledIn = Level >= MinimumLevel;
+
+    leveled_category(std::string_view name,
+                     std::string_view desc,
+                     state state = state::Disabled,
+                     visibility visibility = visibility::Public) noexcept:
+        category(name, desc, CompiledIn ? state : state::Disabled, visibility, CompiledIn)
+    {
+    }
+
+    [[nodiscard]] bool is_enabled() const noexcept { return CompiledIn && category::is_enabled(); }
+
+    operator bool() const noexcept { return is_enabled(); }
+};
+
+using trace_category = leveled_category<level::Trace>;
+using debug_category = leveled_category<level::Debug>;
+
 /// Logging sink API.
 ///
 /// Such as the console, a log file, or UDP endpoint.
@@ -190,13 +390,26 @@ class sink
     sink(bool enabled, writer writer);
     sink(bool enabled, std::ostream& output);
     sink(bool enabled, std::shared_ptr<std::ostream> f);
+    sink(sink const&) = default;
+    sink& operator=(sink const&) = default;
+    ~sink();
 
+    /// Replaces the writer, which must not happen while deferred messages are pending.
     void set_writer(writer writer);
 
     /// Writes given built message to this sink.
     void write(message_builder const& message);
 
     void set_enabled(bool enabled) { _enabled = enabled; }
+    [[nodiscard]] bool enabled() const noexcept { return _enabled; }
+
+    /// Defers formatting and writing of messages to a background thread.
+    ///
+    /// Logging threads then merely store the format strings and arguments of their messages
+    /// into a per thread lock-free ring, dropping messages rather than blocking if it is full.
+    /// Formatters and the writer are then called on the background thread.
+    void set_asynchronous(bool asynchronous);
+    [[nodiscard]] bool asynchronous() const noexcept { return _asynchronous; }
 
     /// Retrieves reference to standard debug-logging sink.
     static sink& console();
@@ -204,6 +417,7 @@ class sink
 
   private:
     bool _enabled;
+    bool _asynchronous = false;
     writer _writer;
 };
 
@@ -211,10 +425,45 @@ std::vector<std::reference_wrapper<category>>& get();
 category* get(std::string_view categoryName);
 void set_sink(sink& sink);
 void set_formatter(category::formatter const& f);
-void enable(std::string_view categoryName, bool enabled = true);
-void disable(std::string_view categoryName);
+void enable(std::string_view pattern, bool enabled = true);
+void disable(std::string_view pattern);
 void configure(std::string_view filterString);
 
+/// Waits until all deferred messages that have been logged so far have been written.
+void flush();
+
+namespace detail
+{
+    /// Tests if @p name matches @p pattern, in which '*' matches any sequence of characters.
+    constexpr bool matches(std::string_view pattern, std::string_view name) noexcept
+    {
+        auto const star = pattern.find('*');
+        if (star == std::string_view::npos)
+            return pattern == name;
+        if (name.substr(0, star) != pattern.substr(0, star))
+            return false;
+        pattern.remove_prefix(star + 1);
+        name.remove_prefix(star);
+        for (;;)
+        {
+            if (matches(pattern, name))
+                return true;
+            if (name.empty())
+                return false;
+            name.remove_prefix(1);
+        }
+    }
+
+    /// Tests if a category is selected by the given filter pattern.
+    /// Patterns with wildcards only select visible categories, whereas hidden ones must be named.
+    inline bool selects(std::string_view pattern, category const& category) noexcept
+    {
+        if (pattern.find('*') != std::string_view::npos && !category.visible())
+            return false;
+        return matches(pattern, category.name());
+    }
+} // namespace detail
+
 // {{{ implementation
 inline std::string message_builder::message() const
 {
@@ -254,18 +503,23 @@ inline void set_formatter(category::formatter const& f)
         cat.get().set_formatter(f);
 }
 
-inline void enable(std::string_view categoryName, bool enabled)
+inline void enable(std::string_view pattern, bool enabled)
 {
     for (auto const& cat: get())
-        if (cat.get().name() == categoryName)
+        if (detail::selects(pattern, cat.get()))
             cat.get().enable(enabled);
 }
 
-inline void disable(std::string_view categoryName)
+inline void disable(std::string_view pattern)
 {
-    enable(categoryName, false);
+    enable(pattern, false);
 }
 
+/// Configures the enabled categories by a comma separated list of filter patterns.
+///
+/// A pattern names a category, or matches multiple visible ones by wildcards ('*'), such as "vt.*".
+/// Patterns prefixed with '-' exclude the categories matched so far, such as in "vt.*,-vt.trace.*".
+/// The special filter "all" enables all categories, including the hidden ones.
 inline void configure(std::string_view filterString)
 {
     if (filterString == "all")
@@ -278,37 +532,68 @@ inline void configure(std::string_view filterString)
         auto const filters = crispy::split(filterString, ',');
         for (auto& category: logstore::get())
         {
-            category.get().enable(crispy::any_of(filters, [&](std::string_view filterPattern) -> bool {
-                if (filterPattern.back() != '*')
-                    return category.get().name() == filterPattern;
-                // TODO: '*' excludes hidden categories
-                return std::equal(std::begin(filterPattern),
-                                  std::prev(end(filterPattern)),
-                                  std::begin(category.get().name()));
-            }));
+            auto enabled = false;
+            for (auto filterPattern: filters)
+            {
+                auto const exclude = !filterPattern.empty() && filterPattern.front() == '-';
+                if (exclude)
+                    filterPattern.remove_prefix(1);
+                if (!filterPattern.empty() && detail::selects(filterPattern, category.get()))
+                    enabled = !exclude;
+            }
+            category.get().enable(enabled);
         }
     }
 }
 
 inline message_builder::message_builder(logstore::category const& cat, source_location location):
-    _category { cat }, _location { location }
+    _category { cat }, _location { location }, _mode { mode::Disabled }
+{
+    if (!_category.is_enabled() || !_category.sink().enabled())
+        return;
+    _time = clock::now();
+    _mode = _category.sink().asynchronous() ? mode::Deferred : mode::Immediate;
+}
+
+inline message_builder::message_builder(logstore::category const& cat,
+                                        source_location location,
+                                        clock::time_point time,
+                                        std::string text):
+    _category { cat },
+    _location { location },
+    _time { time },
+    _mode { mode::Built },
+    _buffer { std::move(text) }
 {
 }
 
 inline message_builder::~message_builder()
 {
-    _category.sink().write(*this);
+    if (_mode == mode::Deferred)
+        detail::enqueue(*this);
+    else if (_mode == mode::Immediate)
+        _category.sink().write(*this);
 }
 
 inline category::category(std::string_view name,
                           std::string_view desc,
                           state state,
                           visibility visibility) noexcept:
+    category(name, desc, state, visibility, true)
+{
+}
+
+inline category::category(std::string_view name,
+                          std::string_view desc,
+                          state state,
+                          visibility visibility,
+                          bool compiledIn) noexcept:
     _name { name },
     _description { desc },
     _state { state },
     _visibility { visibility },
-    _sink { logstore::sink::console() }
+    _sink { logstore::sink::console() },
+    _compiledIn { compiledIn }
 {
     assert(std::none_of(get().begin(), get().end(), [&](category const& x) { return x.name() == _name; }));
     get().emplace_back(*this);
@@ -316,6 +601,9 @@ inline category::category(std::string_view name,
 
 inline category::~category()
 {
+    // Deferred messages refer to their category.
+    flush();
+
     for (auto i = get().begin(), e = get().end(); i != e; ++i)
     {
         if (&i->get() == this)
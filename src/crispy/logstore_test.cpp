@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/logstore.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using logstore::category;
+
+namespace
+{
+
+struct counted
+{
+    int value;
+};
+
+int formatCount = 0; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+} // namespace
+
+template <>
+struct fmt::formatter<counted>: fmt::formatter<int>
+{
+    auto format(counted c, format_context& ctx) const
+    {
+        ++formatCount;
+        return fmt::formatter<int>::format(c.value, ctx);
+    }
+};
+
+namespace
+{
+
+auto selectedLog = category("test.logstore.selected", "");
+auto otherLog = category("test.logstore.other", "");
+auto hiddenLog =
+    category("test.logstore.hidden", "", category::state::Disabled, category::visibility::Hidden);
+
+/// Collects the messages written to a sink.
+struct collector
+{
+    std::vector<std::string> lines;
+    logstore::sink sink { true, [this](std::string_view text) {
+                             lines.emplace_back(text);
+                         } };
+
+    category& target;
+
+    explicit collector(category& cat, bool asynchronous): target { cat }
+    {
+        sink.set_asynchronous(asynchronous);
+        cat.set_sink(sink);
+        cat.set_formatter([](logstore::message_builder const& message) { return message.text(); });
+        cat.enable();
+    }
+
+    ~collector()
+    {
+        sink.set_asynchronous(false);
+        target.set_sink(logstore::sink::console());
+        target.disable();
+    }
+};
+
+/// Restores the enabled state of all categories.
+struct enabled_states
+{
+    std::map<std::string_view, bool> states;
+
+    enabled_states()
+    {
+        for (auto const& cat: logstore::get())
+            states[cat.get().name()] = cat.get().is_enabled();
+    }
+
+    ~enabled_states()
+    {
+        for (auto const& cat: logstore::get())
+            cat.get().enable(states[cat.get().name()]);
+    }
+};
+
+std::vector<std::string> log(bool asynchronous)
+{
+    auto output = collector(selectedLog, asynchronous);
+    auto const temporary = [] { return std::string("temporary"); };
+    selectedLog()("{} {} {} {:.1f} {}", 42, 'c', temporary(), 2.5, true);
+    selectedLog()("literal {}");
+    selectedLog().append("{:>4}", -1).append("|").append("{} {}", std::string_view("view"), "text");
+    selectedLog()("type {}", counted { 7 });
+    logstore::flush();
+    return output.lines;
+}
+
+} // namespace
+
+TEST_CASE("logstore.deferred")
+{
+    auto const immediate = log(false);
+    auto const deferred = log(true);
+    REQUIRE(immediate.size() == 4);
+    CHECK(immediate[0] == "42 c temporary 2.5 true");
+    CHECK(immediate[1] == "literal {}");
+    CHECK(immediate[2] == "  -1|view text");
+    CHECK(immediate[3] == "type 7");
+    CHECK(deferred == immediate);
+}
+
+TEST_CASE("logstore.disabled")
+{
+    auto output = collector(selectedLog, true);
+    selectedLog.disable();
+    formatCount = 0;
+    selectedLog()("{}", counted { 1 });
+    logstore::flush();
+    CHECK(formatCount == 0);
+    CHECK(output.lines.empty());
+}
+
+TEST_CASE("logstore.threads")
+{
+    constexpr auto ThreadCount = 4;
+    constexpr auto MessageCount = 1000;
+
+    auto output = collector(selectedLog, true);
+    auto threads = std::vector<std::thread> {};
+    for (auto thread = 0; thread < ThreadCount; ++thread)
+        threads.emplace_back([thread]() {
+            for (auto i = 0; i < MessageCount; ++i)
+                selectedLog()("{} {}", thread, i);
+        });
+    for (auto& thread: threads)
+        thread.join();
+    logstore::flush();
+
+    REQUIRE(output.lines.size() == ThreadCount * MessageCount);
+    auto next = std::vector<int>(ThreadCount, 0);
+    for (auto const& line: output.lines)
+    {
+        auto const separator = line.find(' ');
+        auto const thread = std::stoi(line.substr(0, separator));
+        REQUIRE(std::stoi(line.substr(separator + 1)) == next[thread]++);
+    }
+}
+
+TEST_CASE("logstore.configure")
+{
+    auto const _ = enabled_states();
+
+    logstore::configure("test.logstore.*");
+    CHECK(selectedLog.is_enabled());
+    CHECK(otherLog.is_enabled());
+    CHECK(!hiddenLog.is_enabled());
+
+    logstore::configure("test.*.selected");
+    CHECK(selectedLog.is_enabled());
+    CHECK(!otherLog.is_enabled());
+
+    logstore::configure("test.logstore.*,-*.other,test.logstore.hidden");
+    CHECK(selectedLog.is_enabled());
+    CHECK(!otherLog.is_enabled());
+    CHECK(hiddenLog.is_enabled());
+
+    logstore::configure("all");
+    CHECK(otherLog.is_enabled());
+    CHECK(hiddenLog.is_enabled());
+
+    logstore::disable("test.logstore.*");
+    CHECK(!selectedLog.is_enabled());
+    CHECK(hiddenLog.is_enabled());
+}
+
+TEST_CASE("logstore.level")
+{
+    auto traceLog = logstore::trace_category("test.logstore.trace", "", category::state::Enabled);
+    CHECK(traceLog.is_enabled() == (logstore::MinimumLevel == logstore::level::Trace));
+    traceLog.enable();
+    CHECK(static_cast<bool>(traceLog) == logstore::trace_category::CompiledIn);
+}
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/mapped_buffer_pool.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if !defined(_WIN32)
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace crispy
+{
+
+namespace
+{
+    auto const mappedBufferLog = logstore::category("MappedBuffer",
+                                                    "Logs file-backed buffer object activity.",
+                                                    logstore::category::state::Disabled,
+                                                    logstore::category::visibility::Hidden);
+}
+
+#if defined(_WIN32)
+
+std::unique_ptr<mapped_buffer_pool> mapped_buffer_pool::create(std::filesystem::path const& /*directory*/,
+                                                               size_t /*bufferSize*/)
+{
+    // Not implemented for Windows (yet).
+    return nullptr;
+}
+
+mapped_buffer_pool::~mapped_buffer_pool() = default;
+
+bool mapped_buffer_pool::mapChunk()
+{
+    return false;
+}
+
+void mapped_buffer_pool::release(buffer_object<char>* buffer)
+{
+    std::destroy_at(buffer);
+}
+
+#else
+
+std::unique_ptr<mapped_buffer_pool> mapped_buffer_pool::create(std::filesystem::path const& directory,
+                                                               size_t bufferSize)
+{
+    auto pathTemplate = (directory / "contour-scrollback-XXXXXX").string();
+    auto const fd = ::mkstemp(pathTemplate.data());
+    if (fd == -1)
+    {
+        errorLog()("Failed to create scrollback spill file in {}. {}", directory.string(), strerror(errno));
+        return nullptr;
+    }
+
+    // The file is only ever accessed through this process' mappings.
+    ::unlink(pathTemplate.c_str());
+
+    auto const pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    auto const alignedBufferSize = (bufferSize + pageSize - 1) / pageSize * pageSize;
+
+    mappedBufferLog()("Created scrollback spill file {} with buffer size {}.", pathTemplate, alignedBufferSize);
+    return std::unique_ptr<mapped_buffer_pool>(
+        new mapped_buffer_pool(file_descriptor::from_native(fd), alignedBufferSize));
+}
+
+mapped_buffer_pool::~mapped_buffer_pool()
+{
+    for (auto const& [address, size]: _chunks)
+        ::munmap(address, size);
+}
+
+bool mapped_buffer_pool::mapChunk()
+{
+    auto const chunkSize = _bufferSize * BuffersPerChunk;
+    auto const offset = _fileSize;
+
+    if (::ftruncate(_fd, static_cast<off_t>(offset + chunkSize)) != 0)
+    {
+        errorLog()("Failed to grow scrollback spill file to {} bytes. {}", offset + chunkSize, strerror(errno));
+        return false;
+    }
+
+    auto* const address =
+        ::mmap(nullptr, chunkSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, static_cast<off_t>(offset));
+    if (address == MAP_FAILED)
+    {
+        errorLog()("Failed to map scrollback spill file. {}", strerror(errno));
+        return false;
+    }
+
+    _fileSize += chunkSize;
+    _chunks.emplace_back(address, chunkSize);
+
+    // Push in reverse, such that buffers are handed out in file order.
+    for (auto i = BuffersPerChunk; i > 0; --i)
+        _unusedBuffers.push_back(static_cast<char*>(address) + ((i - 1) * _bufferSize));
+
+    mappedBufferLog()("Mapped scrollback spill file chunk at offset {} ({} bytes).", offset, chunkSize);
+    return true;
+}
+
+void mapped_buffer_pool::release(buffer_object<char>* buffer)
+{
+    std::destroy_at(buffer);
+    auto const _ = std::scoped_lock { _mutex };
+    _unusedBuffers.push_back(buffer);
+}
+
+#endif
+
+mapped_buffer_pool::mapped_buffer_pool(file_descriptor fd, size_t bufferSize) noexcept:
+    _fd { std::move(fd) }, _bufferSize { bufferSize }
+{
+}
+
+size_t mapped_buffer_pool::fileSize() const noexcept
+{
+    auto const _ = std::scoped_lock { _mutex };
+    return _fileSize;
+}
+
+buffer_object_ptr<char> mapped_buffer_pool::allocateBufferObject()
+{
+    void* storage = nullptr;
+    {
+        auto const _ = std::scoped_lock { _mutex };
+        if (_unusedBuffers.empty() && !mapChunk())
+            return nullptr;
+        storage = _unusedBuffers.back();
+        _unusedBuffers.pop_back();
+    }
+    return buffer_object<char>::create_at(storage, _bufferSize, [this](auto* p) { release(p); });
+}
+
+} // namespace crispy
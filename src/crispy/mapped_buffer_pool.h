@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <crispy/BufferObject.h>
+#include <crispy/file_descriptor.h>
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace crispy
+{
+
+/**
+ * mapped_buffer_pool hands out buffer_object<char> objects living in a memory-mapped temporary file.
+ *
+ * Unlike heap memory, the pages of these buffers are backed by the (already unlinked) file,
+ * so the kernel is free to write them back and drop them from memory whenever it wants to,
+ * without the need for any swap space, and faults them back in once they are accessed again.
+ *
+ * The file only ever grows, in chunks of multiple buffers at once,
+ * and buffers that are no longer referenced are reused for subsequent allocations.
+ */
+class mapped_buffer_pool
+{
+  public:
+    /// Creates a pool backed by a new temporary file within the given directory.
+    ///
+    /// @returns nullptr if the file could not be created or mapped, e.g. on unsupported platforms.
+    [[nodiscard]] static std::unique_ptr<mapped_buffer_pool> create(std::filesystem::path const& directory,
+                                                                    size_t bufferSize);
+
+    mapped_buffer_pool(mapped_buffer_pool const&) = delete;
+    mapped_buffer_pool& operator=(mapped_buffer_pool const&) = delete;
+    mapped_buffer_pool(mapped_buffer_pool&&) = delete;
+    mapped_buffer_pool& operator=(mapped_buffer_pool&&) = delete;
+    ~mapped_buffer_pool();
+
+    /// @returns the size of the storage of each buffer object, including the buffer object itself.
+    [[nodiscard]] size_t bufferSize() const noexcept { return _bufferSize; }
+
+    /// @returns the number of bytes the backing file has grown to.
+    [[nodiscard]] size_t fileSize() const noexcept;
+
+    /// @returns a file-backed buffer object, or nullptr if the backing file cannot grow any further.
+    [[nodiscard]] buffer_object_ptr<char> allocateBufferObject();
+
+  private:
+    mapped_buffer_pool(file_descriptor fd, size_t bufferSize) noexcept;
+
+    bool mapChunk();
+    void release(buffer_object<char>* buffer);
+
+    static constexpr size_t BuffersPerChunk = 16;
+
+    file_descriptor _fd;
+    size_t _bufferSize;
+    std::mutex mutable _mutex; // Guards the members below, as buffers may be released from any thread.
+    size_t _fileSize = 0;
+    std::vector<std::pair<void*, size_t>> _chunks;
+    std::vector<void*> _unusedBuffers;
+};
+
+} // namespace crispy
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/mapped_buffer_pool.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <string_view>
+
+using crispy::mapped_buffer_pool;
+using namespace std::string_view_literals;
+
+#if !defined(_WIN32)
+
+TEST_CASE("mapped_buffer_pool.allocate")
+{
+    auto pool = mapped_buffer_pool::create(std::filesystem::temp_directory_path(), 1000);
+    REQUIRE(pool);
+    CHECK(pool->bufferSize() >= 1000);
+    CHECK(pool->fileSize() == 0);
+
+    auto buffer = pool->allocateBufferObject();
+    REQUIRE(buffer);
+    CHECK(pool->fileSize() > 0);
+    CHECK(buffer->capacity() == pool->bufferSize() - sizeof(crispy::buffer_object<char>));
+
+    auto const text = "Hello, World"sv;
+    buffer->writeAtEnd(gsl::span<char const>(text.data(), text.size()));
+    buffer->advance(text.size());
+    auto const fragment = buffer->ref(0, text.size());
+    buffer.reset();
+
+    // The fragment keeps the buffer alive.
+    CHECK(fragment.view() == text);
+}
+
+TEST_CASE("mapped_buffer_pool.reuse")
+{
+    auto pool = mapped_buffer_pool::create(std::filesystem::temp_directory_path(), 4096);
+    REQUIRE(pool);
+
+    auto* const first = pool->allocateBufferObject().get();
+    auto const fileSize = pool->fileSize();
+
+    // Released buffers are handed out again, without growing the file.
+    auto second = pool->allocateBufferObject();
+    CHECK(second.get() == first);
+    CHECK(second->bytesUsed() == 0);
+    CHECK(pool->fileSize() == fileSize);
+}
+
+#endif
@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/openmetrics.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace crispy
+{
+
+namespace
+{
+    // Escapes label values and help texts, the former of which are quoted.
+    std::string escaped(std::string_view text, bool quoted)
+    {
+        auto result = std::string {};
+        result.reserve(text.size());
+        for (auto const ch: text)
+        {
+            if (ch == '\\')
+                result += "\\\\";
+            else if (ch == '\n')
+                result += "\\n";
+            else if (ch == '"' && quoted)
+                result += "\\\"";
+            else
+                result += ch;
+        }
+        return result;
+    }
+
+    std::string formatNumber(double value)
+    {
+        if (std::isinf(value))
+            return value > 0 ? "+Inf" : "-Inf";
+        if (std::isnan(value))
+            return "NaN";
+        return fmt::format("{}", value);
+    }
+
+    // Appends the sample @p name with @p labels, along with @p extraLabel (e.g. the bucket bound) if given.
+    void appendSample(std::string& output,
+                      std::string_view name,
+                      openmetrics_writer::label_set const& labels,
+                      double value,
+                      std::pair<std::string_view, std::string> const* extraLabel = nullptr)
+    {
+        output += name;
+        if (!labels.empty() || extraLabel)
+        {
+            output += '{';
+            auto first = true;
+            auto const appendLabel = [&](std::string_view labelName, std::string_view labelValue) {
+                if (!first)
+                    output += ',';
+                first = false;
+                output += fmt::format("{}=\"{}\"", labelName, escaped(labelValue, true));
+            };
+            for (auto const& [labelName, labelValue]: labels)
+                appendLabel(labelName, labelValue);
+            if (extraLabel)
+                appendLabel(extraLabel->first, extraLabel->second);
+            output += '}';
+        }
+        output += ' ';
+        output += formatNumber(value);
+        output += '\n';
+    }
+} // namespace
+
+// {{{ histogram
+histogram::histogram(std::vector<double> bounds):
+    _bounds { std::move(bounds) }, _counts { std::make_unique<std::atomic<uint64_t>[]>(_bounds.size() + 1) }
+{
+}
+
+void histogram::observe(double value) noexcept
+{
+    auto const bucket = std::lower_bound(_bounds.begin(), _bounds.end(), value) - _bounds.begin();
+    _counts[static_cast<size_t>(bucket)].fetch_add(1, std::memory_order_relaxed);
+
+    auto sum = _sum.load(std::memory_order_relaxed);
+    while (!_sum.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed))
+        ;
+}
+
+histogram_snapshot histogram::snapshot() const
+{
+    auto result = histogram_snapshot { .bounds = _bounds, .counts = {}, .sum = 0 };
+    result.counts.reserve(_bounds.size() + 1);
+    auto total = uint64_t { 0 };
+    for (size_t i = 0; i <= _bounds.size(); ++i)
+    {
+        total += _counts[i].load(std::memory_order_relaxed);
+        result.counts.push_back(total);
+    }
+    result.sum = _sum.load(std::memory_order_relaxed);
+    return result;
+}
+// }}}
+
+// {{{ openmetrics_writer
+openmetrics_writer::metric& openmetrics_writer::metricNamed(std::string_view name,
+                                                            std::string_view type,
+                                                            std::string_view help)
+{
+    auto const i =
+        std::find_if(_metrics.begin(), _metrics.end(), [&](auto const& m) { return m.name == name; });
+    if (i != _metrics.end())
+        return *i;
+    return _metrics.emplace_back(
+        metric { .name = std::string(name), .type = type, .help = escaped(help, false), .samples = {} });
+}
+
+void openmetrics_writer::gauge(std::string_view name,
+                               std::string_view help,
+                               label_set const& labels,
+                               double value)
+{
+    appendSample(metricNamed(name, "gauge", help).samples, name, labels, value);
+}
+
+void openmetrics_writer::counter(std::string_view name,
+                                 std::string_view help,
+                                 label_set const& labels,
+                                 double value)
+{
+    appendSample(metricNamed(name, "counter", help).samples, fmt::format("{}_total", name), labels, value);
+}
+
+void openmetrics_writer::histogram(std::string_view name,
+                                   std::string_view help,
+                                   label_set const& labels,
+                                   histogram_snapshot const& histogram)
+{
+    auto& samples = metricNamed(name, "histogram", help).samples;
+    auto const bucketName = fmt::format("{}_bucket", name);
+    for (size_t i = 0; i < histogram.counts.size(); ++i)
+    {
+        auto const bound = i < histogram.bounds.size() ? histogram.bounds[i] : INFINITY;
+        auto const le = std::pair<std::string_view, std::string> { "le", formatNumber(bound) };
+        appendSample(samples, bucketName, labels, static_cast<double>(histogram.counts[i]), &le);
+    }
+    appendSample(samples, fmt::format("{}_count", name), labels, static_cast<double>(histogram.count()));
+    appendSample(samples, fmt::format("{}_sum", name), labels, histogram.sum);
+}
+
+void openmetrics_writer::summary(std::string_view name,
+                                 std::string_view help,
+                                 label_set const& labels,
+                                 std::span<std::pair<double, double> const> quantiles,
+                                 uint64_t count)
+{
+    auto& samples = metricNamed(name, "summary", help).samples;
+    for (auto const& [quantile, value]: quantiles)
+    {
+        auto const label = std::pair<std::string_view, std::string> { "quantile", formatNumber(quantile) };
+        appendSample(samples, name, labels, value, &label);
+    }
+    appendSample(samples, fmt::format("{}_count", name), labels, static_cast<double>(count));
+}
+
+std::string openmetrics_writer::str() const
+{
+    auto output = std::string {};
+    for (auto const& metric: _metrics)
+    {
+        output += fmt::format("# TYPE {} {}\n", metric.name, metric.type);
+        output += fmt::format("# HELP {} {}\n", metric.name, metric.help);
+        output += metric.samples;
+    }
+    output += "# EOF\n";
+    return output;
+}
+// }}}
+
+} // namespace crispy
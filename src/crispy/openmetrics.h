@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace crispy
+{
+
+/// Counts of a histogram at one point in time, with cumulative buckets, as exposed by OpenMetrics.
+struct histogram_snapshot
+{
+    std::vector<double> bounds;   // upper bound of each bucket, ascending, excluding +Inf
+    std::vector<uint64_t> counts; // observations up to each bound, followed by all of them (+Inf)
+    double sum = 0;
+
+    [[nodiscard]] uint64_t count() const noexcept { return counts.empty() ? 0 : counts.back(); }
+};
+
+/**
+ * Histogram of observations into buckets of fixed bounds, e.g. the time it takes to render a frame.
+ *
+ * Observations may be made concurrently with each other and with taking snapshots,
+ * and cost a few relaxed atomic increments only.
+ */
+class histogram
+{
+  public:
+    /// @param bounds upper bounds of the buckets in ascending order, with an implicit +Inf one after.
+    explicit histogram(std::vector<double> bounds);
+
+    void observe(double value) noexcept;
+
+    [[nodiscard]] histogram_snapshot snapshot() const;
+
+  private:
+    std::vector<double> _bounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> _counts; // per bucket, not cumulative, +Inf being last
+    std::atomic<double> _sum = 0;
+};
+
+/**
+ * Writes metrics in the OpenMetrics text exposition format, see https://openmetrics.io.
+ *
+ * The samples of a metric may be added in any order with those of others, e.g. session by session,
+ * as they are grouped by metric when written. The first sample of a metric determines its type and help.
+ */
+class openmetrics_writer
+{
+  public:
+    using label_set = std::vector<std::pair<std::string_view, std::string>>;
+
+    /// Adds a sample of the gauge @p name, e.g. the bytes of memory used right now.
+    void gauge(std::string_view name, std::string_view help, label_set const& labels, double value);
+
+    /// Adds a sample of the counter @p name, which is only ever increasing, e.g. the bytes read so far.
+    /// The sample is named with the suffix "_total" appended.
+    void counter(std::string_view name, std::string_view help, label_set const& labels, double value);
+
+    /// Adds the buckets, count, and sum of the histogram @p name.
+    void histogram(std::string_view name,
+                   std::string_view help,
+                   label_set const& labels,
+                   histogram_snapshot const& histogram);
+
+    /// Adds the count and the given quantiles of the summary @p name, e.g. percentiles of latencies.
+    void summary(std::string_view name,
+                 std::string_view help,
+                 label_set const& labels,
+                 std::span<std::pair<double, double> const> quantiles, // quantile and its value
+                 uint64_t count);
+
+    /// @returns all metrics added, terminated by "# EOF".
+    [[nodiscard]] std::string str() const;
+
+  private:
+    struct metric
+    {
+        std::string name;
+        std::string_view type;
+        std::string help;
+        std::string samples; // lines of text
+    };
+
+    metric& metricNamed(std::string_view name, std::string_view type, std::string_view help);
+
+    std::vector<metric> _metrics; // in the order first added
+};
+
+} // namespace crispy
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/openmetrics.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+TEST_CASE("openmetrics.histogram")
+{
+    auto histogram = crispy::histogram({ 0.25, 0.5 });
+    histogram.observe(0.125);
+    histogram.observe(0.25); // bounds are inclusive
+    histogram.observe(0.375);
+    histogram.observe(1.0);
+
+    auto const snapshot = histogram.snapshot();
+    CHECK(snapshot.counts == std::vector<uint64_t> { 2, 3, 4 });
+    CHECK(snapshot.count() == 4);
+    CHECK(snapshot.sum == 1.75);
+}
+
+TEST_CASE("openmetrics.histogram.concurrent")
+{
+    auto histogram = crispy::histogram({ 1.0 });
+    auto threads = std::vector<std::thread> {};
+    for (auto i = 0; i < 4; ++i)
+        threads.emplace_back([&]() {
+            for (auto k = 0; k < 1000; ++k)
+                histogram.observe(2.0);
+        });
+    for (auto& thread: threads)
+        thread.join();
+
+    auto const snapshot = histogram.snapshot();
+    CHECK(snapshot.count() == 4000);
+    CHECK(snapshot.counts.front() == 0);
+    CHECK(snapshot.sum == 8000.0);
+}
+
+TEST_CASE("openmetrics.writer")
+{
+    auto writer = crispy::openmetrics_writer {};
+    writer.counter("contour_pty_bytes", "PTY output read.", { { "session", "1" } }, 1024);
+    writer.gauge("contour_history_bytes", "Memory of the \\ history.", { { "session", "1" } }, 2048);
+    writer.counter("contour_pty_bytes", "PTY output read.", { { "session", "2\"" } }, 7);
+
+    auto histogram = crispy::histogram({ 0.5 });
+    histogram.observe(0.25);
+    writer.histogram("contour_frame_seconds", "Frame time.", {}, histogram.snapshot());
+
+    auto const quantiles = std::array { std::pair { 0.5, 0.002 } };
+    writer.summary("contour_latency_seconds", "Latency.", { { "session", "1" } }, quantiles, 3);
+
+    CHECK(writer.str()
+          == "# TYPE contour_pty_bytes counter\n"
+             "# HELP contour_pty_bytes PTY output read.\n"
+             "contour_pty_bytes_total{session=\"1\"} 1024\n"
+             "contour_pty_bytes_total{session=\"2\\\"\"} 7\n"
+             "# TYPE contour_history_bytes gauge\n"
+             "# HELP contour_history_bytes Memory of the \\\\ history.\n"
+             "contour_history_bytes{session=\"1\"} 2048\n"
+             "# TYPE contour_frame_seconds histogram\n"
+             "# HELP contour_frame_seconds Frame time.\n"
+             "contour_frame_seconds_bucket{le=\"0.5\"} 1\n"
+             "contour_frame_seconds_bucket{le=\"+Inf\"} 1\n"
+             "contour_frame_seconds_count 1\n"
+             "contour_frame_seconds_sum 0.25\n"
+             "# TYPE contour_latency_seconds summary\n"
+             "# HELP contour_latency_seconds Latency.\n"
+             "contour_latency_seconds{session=\"1\",quantile=\"0.5\"} 0.002\n"
+             "contour_latency_seconds_count{session=\"1\"} 3\n"
+             "# EOF\n");
+}
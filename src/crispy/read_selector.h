@@ -74,6 +74,29 @@ class posix_read_selector
         _fds.erase(std::remove(_fds.begin(), _fds.end(), fd), _fds.end());
     }
 
+    /// Registers @p fd to be waited for becoming writable, too, telling so via take_writable().
+    void want_write(int fd) noexcept
+    {
+        assert(fd >= 0);
+        assert(std::count(_writers.begin(), _writers.end(), fd) == 0);
+        _writers.push_back(fd);
+    }
+
+    void cancel_write(int fd) noexcept
+    {
+        _writers.erase(std::remove(_writers.begin(), _writers.end(), fd), _writers.end());
+    }
+
+    /// @returns whether @p fd has become writable during the last wait_one(), forgetting about it.
+    [[nodiscard]] bool take_writable(int fd) noexcept
+    {
+        auto const i = std::find(_writable.begin(), _writable.end(), fd);
+        if (i == _writable.end())
+            return false;
+        _writable.erase(i);
+        return true;
+    }
+
     void wakeup() noexcept
     {
         if (_breakPipeWriter.is_open())
@@ -88,6 +111,7 @@ class posix_read_selector
     {
         assert(!_fds.empty());
 
+        _writable.clear();
         if (auto const fd = try_pop_pending(); fd.has_value())
             return fd;
 
@@ -103,6 +127,12 @@ class posix_read_selector
             if (fd > maxfd)
                 maxfd = fd;
         }
+        for (auto const fd: _writers)
+        {
+            FD_SET(fd, &_writer);
+            if (fd > maxfd)
+                maxfd = fd;
+        }
 
         auto tv = std::unique_ptr<timeval>();
         if (timeout.has_value())
@@ -129,6 +159,10 @@ class posix_read_selector
             if (FD_ISSET(fd, &_reader))
                 _pending.push_back(fd);
 
+        for (int fd: _writers)
+            if (FD_ISSET(fd, &_writer))
+                _writable.push_back(fd);
+
         return try_pop_pending();
     }
 
@@ -151,6 +185,8 @@ class posix_read_selector
     fd_set _writer {};
     fd_set _except {};
     std::vector<int> _fds;
+    std::vector<int> _writers;
+    std::vector<int> _writable;
     std::deque<int> _pending;
     file_descriptor _breakPipeReader;
     file_descriptor _breakPipeWriter;
@@ -171,16 +207,34 @@ class epoll_read_selector
     void cancel_read(int fd) noexcept;
     [[nodiscard]] size_t size() const noexcept;
 
+    /// Registers @p fd to be waited for becoming writable, too, telling so via take_writable().
+    void want_write(int fd) noexcept;
+    void cancel_write(int fd) noexcept;
+
+    /// @returns whether @p fd has become writable during the last wait_one(), forgetting about it.
+    [[nodiscard]] bool take_writable(int fd) noexcept;
+
     void wakeup() const noexcept;
     std::optional<int> wait_one(std::optional<std::chrono::milliseconds> timeout = std::nullopt) noexcept;
 
+    /// @returns the epoll instance, which itself becomes readable while any registered file descriptor
+    ///          is ready or a wakeup() is pending, so that many selectors can be waited for at once.
+    [[nodiscard]] int native_handle() const noexcept { return _epollFd; }
+
   private:
     std::optional<int> try_pop_pending() noexcept;
+    [[nodiscard]] uint32_t events_of(int fd) const noexcept;
+
+    // Applies a change of the registered readers or writers to the epoll instance.
+    template <typename Change>
+    void update(int fd, Change change) noexcept;
 
   private:
     file_descriptor _epollFd;
     file_descriptor _eventFd;
-    size_t _size = 0;
+    std::vector<int> _readers;
+    std::vector<int> _writers;
+    std::vector<int> _writable;
     std::deque<int> _pending;
 };
 
@@ -195,29 +249,65 @@ inline epoll_read_selector::epoll_read_selector()
     epoll_ctl(_epollFd, EPOLL_CTL_ADD, _eventFd, &event);
 }
 
-// NOLINTNEXTLINE(readability-make-member-function-const)
-inline void epoll_read_selector::want_read(int fd) noexcept
+inline uint32_t epoll_read_selector::events_of(int fd) const noexcept
+{
+    auto events = uint32_t { 0 };
+    if (std::find(_readers.begin(), _readers.end(), fd) != _readers.end())
+        events |= EPOLLIN;
+    if (std::find(_writers.begin(), _writers.end(), fd) != _writers.end())
+        events |= EPOLLOUT;
+    return events;
+}
+
+template <typename Change>
+void epoll_read_selector::update(int fd, Change change) noexcept
 {
+    auto const before = events_of(fd);
+    change();
     auto event = epoll_event {};
-    event.events = EPOLLIN;
+    event.events = events_of(fd);
     event.data.fd = fd;
-    epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event);
-    _size++;
+
+    if (before == 0)
+        epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event);
+    else if (event.events == 0)
+        epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, &event);
+    else if (event.events != before)
+        epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &event);
+}
+
+inline void epoll_read_selector::want_read(int fd) noexcept
+{
+    update(fd, [&]() { _readers.push_back(fd); });
 }
 
-// NOLINTNEXTLINE(readability-make-member-function-const)
 inline void epoll_read_selector::cancel_read(int fd) noexcept
 {
-    auto event = epoll_event {};
-    event.events = EPOLLIN;
-    event.data.fd = fd;
-    epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, &event);
-    _size--;
+    update(fd, [&]() { _readers.erase(std::remove(_readers.begin(), _readers.end(), fd), _readers.end()); });
+}
+
+inline void epoll_read_selector::want_write(int fd) noexcept
+{
+    update(fd, [&]() { _writers.push_back(fd); });
+}
+
+inline void epoll_read_selector::cancel_write(int fd) noexcept
+{
+    update(fd, [&]() { _writers.erase(std::remove(_writers.begin(), _writers.end(), fd), _writers.end()); });
+}
+
+inline bool epoll_read_selector::take_writable(int fd) noexcept
+{
+    auto const i = std::find(_writable.begin(), _writable.end(), fd);
+    if (i == _writable.end())
+        return false;
+    _writable.erase(i);
+    return true;
 }
 
 inline size_t epoll_read_selector::size() const noexcept
 {
-    return _size;
+    return _readers.size();
 }
 
 inline void epoll_read_selector::wakeup() const noexcept
@@ -241,6 +331,7 @@ inline std::optional<int> epoll_read_selector::try_pop_pending() noexcept
 inline std::optional<int> epoll_read_selector::wait_one(
     std::optional<std::chrono::milliseconds> timeout) noexcept
 {
+    _writable.clear();
     if (auto const fd = try_pop_pending(); fd.has_value())
         return fd;
 
@@ -271,9 +362,14 @@ inline std::optional<int> epoll_read_selector::wait_one(
             {
                 eventfd_t dummy {};
                 piped = ::read(_eventFd, &dummy, sizeof(dummy)) > 0;
+                continue;
             }
-            else
-                _pending.push_back(events[i].data.fd);
+
+            auto const fd = events[i].data.fd;
+            if (events[i].events & EPOLLOUT)
+                _writable.push_back(fd);
+            if ((events[i].events & ~EPOLLOUT) && (events_of(fd) & EPOLLIN))
+                _pending.push_back(fd);
         }
 
         if (auto fd = try_pop_pending(); fd.has_value())
@@ -0,0 +1,755 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/regex_dfa.h>
+
+#include <algorithm>
+#include <ranges>
+#include <utility>
+
+namespace crispy
+{
+
+namespace
+{
+    using codepoint_range = std::pair<char32_t, char32_t>;
+
+    constexpr char32_t MaxCodepoint = 0x10FFFF;
+    constexpr int MaxRepetition = 1000;
+
+    struct regex_node
+    {
+        enum class kind : uint8_t
+        {
+            ranges, // matches a single codepoint within any of the ranges
+            concat,
+            alternate,
+            repeat, // matches children.front() between min and max (or infinitely many, if negative) times
+        };
+
+        kind type = kind::concat;
+        std::vector<codepoint_range> ranges {};
+        std::vector<regex_node> children {};
+        int min = 0;
+        int max = 0;
+    };
+
+    [[nodiscard]] bool nullable(regex_node const& node)
+    {
+        switch (node.type)
+        {
+            case regex_node::kind::ranges: return false;
+            case regex_node::kind::concat: return std::ranges::all_of(node.children, nullable);
+            case regex_node::kind::alternate: return std::ranges::any_of(node.children, nullable);
+            case regex_node::kind::repeat: return node.min == 0 || nullable(node.children.front());
+        }
+        return false;
+    }
+
+    [[nodiscard]] std::vector<codepoint_range> normalized(std::vector<codepoint_range> ranges)
+    {
+        std::ranges::sort(ranges);
+        auto output = std::vector<codepoint_range> {};
+        for (auto const& range: ranges)
+        {
+            if (!output.empty() && range.first <= output.back().second + 1)
+                output.back().second = std::max(output.back().second, range.second);
+            else
+                output.emplace_back(range);
+        }
+        return output;
+    }
+
+    [[nodiscard]] std::vector<codepoint_range> complemented(std::vector<codepoint_range> const& ranges)
+    {
+        auto output = std::vector<codepoint_range> {};
+        auto next = char32_t { 0 };
+        for (auto const& range: normalized(ranges))
+        {
+            if (next < range.first)
+                output.emplace_back(next, range.first - 1);
+            next = range.second + 1;
+        }
+        if (next <= MaxCodepoint)
+            output.emplace_back(next, MaxCodepoint);
+        return output;
+    }
+
+    // Adds the other case of all ASCII letters within the given ranges.
+    void foldCase(std::vector<codepoint_range>& ranges)
+    {
+        auto const count = ranges.size();
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto const [first, last] = ranges[i];
+            if (first <= U'z' && last >= U'a')
+                ranges.emplace_back(std::max(first, U'a') - 32, std::min(last, U'z') - 32);
+            if (first <= U'Z' && last >= U'A')
+                ranges.emplace_back(std::max(first, U'A') + 32, std::min(last, U'Z') + 32);
+        }
+    }
+
+    // {{{ UTF-8 encoding of codepoint ranges
+
+    // A sequence of byte ranges, matching the UTF-8 encoding of a range of codepoints.
+    struct byte_sequence
+    {
+        std::array<std::pair<uint8_t, uint8_t>, 4> ranges;
+        size_t length;
+    };
+
+    [[nodiscard]] size_t encodeUtf8(char32_t codepoint, std::array<uint8_t, 4>& bytes) noexcept
+    {
+        if (codepoint < 0x80)
+        {
+            bytes[0] = static_cast<uint8_t>(codepoint);
+            return 1;
+        }
+        if (codepoint < 0x800)
+        {
+            bytes[0] = static_cast<uint8_t>(0xC0 | (codepoint >> 6));
+            bytes[1] = static_cast<uint8_t>(0x80 | (codepoint & 0x3F));
+            return 2;
+        }
+        if (codepoint < 0x10000)
+        {
+            bytes[0] = static_cast<uint8_t>(0xE0 | (codepoint >> 12));
+            bytes[1] = static_cast<uint8_t>(0x80 | ((codepoint >> 6) & 0x3F));
+            bytes[2] = static_cast<uint8_t>(0x80 | (codepoint & 0x3F));
+            return 3;
+        }
+        bytes[0] = static_cast<uint8_t>(0xF0 | (codepoint >> 18));
+        bytes[1] = static_cast<uint8_t>(0x80 | ((codepoint >> 12) & 0x3F));
+        bytes[2] = static_cast<uint8_t>(0x80 | ((codepoint >> 6) & 0x3F));
+        bytes[3] = static_cast<uint8_t>(0x80 | (codepoint & 0x3F));
+        return 4;
+    }
+
+    // Splits the given range of codepoints into ranges whose UTF-8 encodings only differ
+    // in a suffix of continuation bytes that covers their full range, such that each of them
+    // can be matched by a single sequence of byte ranges.
+    void appendByteSequences(char32_t first, char32_t last, std::vector<byte_sequence>& output)
+    {
+        // Surrogates cannot be encoded.
+        if (first <= 0xDFFF && last >= 0xD800)
+        {
+            if (first < 0xD800)
+                appendByteSequences(first, 0xD7FF, output);
+            if (last > 0xDFFF)
+                appendByteSequences(0xE000, last, output);
+            return;
+        }
+
+        // Encodings of different lengths cannot share a sequence.
+        for (auto const boundary: { char32_t { 0x80 }, char32_t { 0x800 }, char32_t { 0x10000 } })
+        {
+            if (first < boundary && last >= boundary)
+            {
+                appendByteSequences(first, boundary - 1, output);
+                appendByteSequences(boundary, last, output);
+                return;
+            }
+        }
+
+        auto firstBytes = std::array<uint8_t, 4> {};
+        auto lastBytes = std::array<uint8_t, 4> {};
+        auto const length = encodeUtf8(first, firstBytes);
+        for (size_t i = 1; i < length; ++i)
+        {
+            auto const mask = (char32_t { 1 } << (6 * i)) - 1;
+            if ((first & ~mask) == (last & ~mask))
+                continue;
+            if ((first & mask) != 0)
+            {
+                appendByteSequences(first, first | mask, output);
+                appendByteSequences((first | mask) + 1, last, output);
+                return;
+            }
+            if ((last & mask) != mask)
+            {
+                appendByteSequences(first, (last & ~mask) - 1, output);
+                appendByteSequences(last & ~mask, last, output);
+                return;
+            }
+        }
+
+        (void) encodeUtf8(last, lastBytes);
+        auto sequence = byte_sequence { {}, length };
+        for (size_t i = 0; i < length; ++i)
+            sequence.ranges[i] = { firstBytes[i], lastBytes[i] };
+        output.emplace_back(sequence);
+    }
+
+    // }}}
+
+    class regex_parser
+    {
+      public:
+        explicit regex_parser(std::u32string_view pattern): _pattern { pattern } {}
+
+        [[nodiscard]] result<regex_node, std::string> parse()
+        {
+            if (_pattern.starts_with(U"(?i)"))
+            {
+                ignoreCase = true;
+                _pos = 4;
+            }
+            if (consume(U'^'))
+                anchorBegin = true;
+
+            auto node = parseAlternation();
+            if (!node)
+                return failure { std::move(_error) };
+            if (_pos < _pattern.size())
+                return failure { "Unmatched ')' at offset " + std::to_string(_pos) + "." };
+            if ((anchorBegin || anchorEnd) && node->type == regex_node::kind::alternate)
+                return failure { std::string("Anchors cannot be combined with a top-level alternation.") };
+            return std::move(*node);
+        }
+
+        bool ignoreCase = false;
+        bool anchorBegin = false;
+        bool anchorEnd = false;
+
+      private:
+        [[nodiscard]] bool atEnd() const noexcept { return _pos >= _pattern.size(); }
+        [[nodiscard]] char32_t peek() const noexcept { return atEnd() ? 0 : _pattern[_pos]; }
+
+        bool consume(char32_t ch) noexcept
+        {
+            if (atEnd() || _pattern[_pos] != ch)
+                return false;
+            ++_pos;
+            return true;
+        }
+
+        std::nullopt_t fail(std::string message)
+        {
+            if (_error.empty())
+                _error = std::move(message) + " at offset " + std::to_string(_pos) + ".";
+            return std::nullopt;
+        }
+
+        [[nodiscard]] regex_node makeRanges(std::vector<codepoint_range> ranges) const
+        {
+            if (ignoreCase)
+                foldCase(ranges);
+            return regex_node { .type = regex_node::kind::ranges, .ranges = normalized(std::move(ranges)) };
+        }
+
+        std::optional<regex_node> parseAlternation()
+        {
+            auto first = parseConcat();
+            if (!first || peek() != U'|')
+                return first;
+
+            auto node = regex_node { .type = regex_node::kind::alternate };
+            node.children.emplace_back(std::move(*first));
+            while (consume(U'|'))
+            {
+                auto next = parseConcat();
+                if (!next)
+                    return std::nullopt;
+                node.children.emplace_back(std::move(*next));
+            }
+            return node;
+        }
+
+        std::optional<regex_node> parseConcat()
+        {
+            auto node = regex_node { .type = regex_node::kind::concat };
+            while (!atEnd() && peek() != U'|' && peek() != U')')
+            {
+                auto next = parseRepetition();
+                if (!next)
+                    return std::nullopt;
+                node.children.emplace_back(std::move(*next));
+            }
+            if (node.children.size() == 1)
+                return std::move(node.children.front());
+            return node;
+        }
+
+        std::optional<regex_node> parseRepetition()
+        {
+            auto node = parseAtom();
+            while (node && !atEnd())
+            {
+                auto bounds = std::pair { 0, 0 };
+                if (consume(U'*'))
+                    bounds = { 0, -1 };
+                else if (consume(U'+'))
+                    bounds = { 1, -1 };
+                else if (consume(U'?'))
+                    bounds = { 0, 1 };
+                else if (auto const parsedBounds = parseBounds())
+                    bounds = *parsedBounds;
+                else if (!_error.empty())
+                    return std::nullopt;
+                else
+                    break;
+
+                auto repeated = regex_node {
+                    .type = regex_node::kind::repeat, .min = bounds.first, .max = bounds.second
+                };
+                repeated.children.emplace_back(std::move(*node));
+                node = std::move(repeated);
+            }
+            return node;
+        }
+
+        // Parses a bounded repetition, or leaves the pattern untouched if there is none.
+        std::optional<std::pair<int, int>> parseBounds()
+        {
+            auto const start = _pos;
+            auto const parseNumber = [this]() -> std::optional<int> {
+                auto value = std::optional<int> {};
+                while (!atEnd() && peek() >= U'0' && peek() <= U'9')
+                {
+                    auto const digit = static_cast<int>(peek() - U'0');
+                    value = std::min(value.value_or(0) * 10 + digit, MaxRepetition + 1);
+                    ++_pos;
+                }
+                return value;
+            };
+
+            if (!consume(U'{'))
+                return std::nullopt;
+            auto const min = parseNumber();
+            auto max = min;
+            if (min && consume(U','))
+                max = atEnd() || peek() != U'}' ? parseNumber() : std::optional { -1 };
+            if (!min || !max || !consume(U'}'))
+            {
+                // Not a repetition, so that the brace is matched literally.
+                _pos = start;
+                return std::nullopt;
+            }
+            if (*min > MaxRepetition || *max > MaxRepetition)
+                return fail("Repetition count exceeds " + std::to_string(MaxRepetition));
+            if (*max >= 0 && *max < *min)
+                return fail("Invalid repetition range");
+            return std::pair { *min, *max };
+        }
+
+        std::optional<regex_node> parseAtom()
+        {
+            switch (auto const ch = peek(); ch)
+            {
+                case U'(': {
+                    ++_pos;
+                    if (consume(U'?') && !consume(U':'))
+                        return fail("Unsupported group syntax");
+                    ++_depth;
+                    auto node = parseAlternation();
+                    --_depth;
+                    if (!node)
+                        return std::nullopt;
+                    if (!consume(U')'))
+                        return fail("Missing ')'");
+                    return node;
+                }
+                case U'[': ++_pos; return parseClass();
+                case U'.': ++_pos; return makeRanges({ { 0, MaxCodepoint } });
+                case U'\\': {
+                    ++_pos;
+                    auto ranges = std::vector<codepoint_range> {};
+                    if (!parseEscape(ranges))
+                        return std::nullopt;
+                    return makeRanges(std::move(ranges));
+                }
+                case U'*':
+                case U'+':
+                case U'?': return fail("Nothing to repeat");
+                case U'$':
+                    if (_pos + 1 != _pattern.size() || _depth != 0)
+                        return fail("'$' is only supported at the end of the pattern");
+                    ++_pos;
+                    anchorEnd = true;
+                    return regex_node { .type = regex_node::kind::concat };
+                case U'^': return fail("'^' is only supported at the beginning of the pattern");
+                default: ++_pos; return makeRanges({ { ch, ch } });
+            }
+        }
+
+        // Parses the escape sequence following a backslash, adding the ranges it matches.
+        bool parseEscape(std::vector<codepoint_range>& ranges)
+        {
+            static auto const digits = std::vector<codepoint_range> { { U'0', U'9' } };
+            static auto const words = std::vector<codepoint_range> {
+                { U'0', U'9' }, { U'A', U'Z' }, { U'_', U'_' }, { U'a', U'z' }
+            };
+            static auto const spaces = std::vector<codepoint_range> { { U'\t', U'\r' }, { U' ', U' ' } };
+
+            if (atEnd())
+            {
+                (void) fail("Trailing backslash");
+                return false;
+            }
+
+            auto const add = [&](std::vector<codepoint_range> const& more) {
+                ranges.insert(ranges.end(), more.begin(), more.end());
+            };
+            auto const ch = _pattern[_pos++];
+            switch (ch)
+            {
+                case U'd': add(digits); break;
+                case U'D': add(complemented(digits)); break;
+                case U'w': add(words); break;
+                case U'W': add(complemented(words)); break;
+                case U's': add(spaces); break;
+                case U'S': add(complemented(spaces)); break;
+                case U't': ranges.emplace_back(U'\t', U'\t'); break;
+                case U'n': ranges.emplace_back(U'\n', U'\n'); break;
+                case U'r': ranges.emplace_back(U'\r', U'\r'); break;
+                default:
+                    // Letters and digits are reserved for escape sequences yet to be supported.
+                    if ((ch >= U'0' && ch <= U'9') || (ch >= U'A' && ch <= U'Z')
+                        || (ch >= U'a' && ch <= U'z'))
+                    {
+                        --_pos;
+                        (void) fail("Unsupported escape sequence");
+                        return false;
+                    }
+                    ranges.emplace_back(ch, ch);
+                    break;
+            }
+            return true;
+        }
+
+        // Parses a character class following the opening bracket.
+        std::optional<regex_node> parseClass()
+        {
+            auto const negated = consume(U'^');
+            auto ranges = std::vector<codepoint_range> {};
+
+            // Parses a single class member, or an escape that matches multiple characters.
+            auto const parseMember = [&](std::vector<codepoint_range>& escaped) -> std::optional<char32_t> {
+                if (!consume(U'\\'))
+                    return _pattern[_pos++];
+                if (!parseEscape(escaped))
+                    return std::nullopt;
+                if (escaped.size() != 1 || escaped.front().first != escaped.front().second)
+                    return std::nullopt;
+                auto const ch = escaped.front().first;
+                escaped.clear();
+                return ch;
+            };
+
+            for (auto first = true;; first = false)
+            {
+                if (atEnd())
+                    return fail("Missing ']'");
+                if (!first && consume(U']'))
+                    break;
+
+                auto escaped = std::vector<codepoint_range> {};
+                auto const low = parseMember(escaped);
+                if (!low)
+                {
+                    if (!_error.empty())
+                        return std::nullopt;
+                    ranges.insert(ranges.end(), escaped.begin(), escaped.end());
+                    continue;
+                }
+
+                auto high = *low;
+                if (_pos + 1 < _pattern.size() && peek() == U'-' && _pattern[_pos + 1] != U']')
+                {
+                    ++_pos;
+                    auto const parsedHigh = parseMember(escaped);
+                    if (!parsedHigh || *parsedHigh < *low)
+                        return fail("Invalid character range");
+                    high = *parsedHigh;
+                }
+                ranges.emplace_back(*low, high);
+            }
+
+            if (ignoreCase)
+                foldCase(ranges);
+            if (negated)
+                ranges = complemented(ranges);
+            return regex_node { .type = regex_node::kind::ranges, .ranges = normalized(std::move(ranges)) };
+        }
+
+        std::u32string_view _pattern;
+        size_t _pos = 0;
+        size_t _depth = 0; // number of groups the parser is within
+        std::string _error;
+    };
+
+} // namespace
+
+/// Builds the NFA of a parsed pattern, Thompson-style, from the end of the pattern towards its beginning.
+class regex_compiler
+{
+  public:
+    using nfa_state = regex_dfa::nfa_state;
+
+    // Upper bound of NFA states, to keep patterns such as `(a{1000}){1000}` at bay.
+    static constexpr size_t MaxNfaStates = 1 << 16;
+
+    explicit regex_compiler(std::vector<nfa_state>& states): _states { states } {}
+
+    [[nodiscard]] bool overflowed() const noexcept { return _overflow; }
+
+    // Emits the states matching @p node, continuing with the state @p next.
+    // @returns the first of the emitted states.
+    int compile(regex_node const& node, int next)
+    {
+        if (_overflow)
+            return next;
+
+        switch (node.type)
+        {
+            case regex_node::kind::ranges: return compileRanges(node.ranges, next);
+            case regex_node::kind::concat:
+                for (auto const& child: node.children | std::views::reverse)
+                    next = compile(child, next);
+                return next;
+            case regex_node::kind::alternate: {
+                auto first = compile(node.children.back(), next);
+                for (auto const& child: node.children | std::views::reverse | std::views::drop(1))
+                    first = emitSplit(compile(child, next), first);
+                return first;
+            }
+            case regex_node::kind::repeat: {
+                auto const& child = node.children.front();
+                auto first = next;
+                if (node.max < 0)
+                {
+                    auto const loop = emitSplit(0, next);
+                    auto const body = compile(child, loop);
+                    if (!_overflow)
+                        _states[static_cast<size_t>(loop)].out = body;
+                    first = loop;
+                }
+                else
+                    for (auto i = node.min; i < node.max; ++i)
+                        first = emitSplit(compile(child, first), next);
+                for (auto i = 0; i < node.min; ++i)
+                    first = compile(child, first);
+                return first;
+            }
+        }
+        return next;
+    }
+
+    int emit(nfa_state state)
+    {
+        if (_states.size() >= MaxNfaStates)
+        {
+            _overflow = true;
+            return 0;
+        }
+        _states.emplace_back(state);
+        return static_cast<int>(_states.size() - 1);
+    }
+
+    int emitSplit(int out, int out2)
+    {
+        return emit(nfa_state { .type = nfa_state::kind::split, .out = out, .out2 = out2 });
+    }
+
+  private:
+    int compileRanges(std::vector<codepoint_range> const& ranges, int next)
+    {
+        auto sequences = std::vector<byte_sequence> {};
+        for (auto const& [first, last]: ranges)
+            appendByteSequences(first, last, sequences);
+
+        // A range state that never matches, for classes not matching anything at all.
+        auto start = sequences.empty() ? emitRange(1, 0, next) : -1;
+        for (auto const& sequence: sequences)
+        {
+            auto chain = next;
+            for (auto i = sequence.length; i > 0; --i)
+                chain = emitRange(sequence.ranges[i - 1].first, sequence.ranges[i - 1].second, chain);
+            start = start < 0 ? chain : emitSplit(chain, start);
+        }
+        return start;
+    }
+
+    int emitRange(uint8_t low, uint8_t high, int next)
+    {
+        return emit(nfa_state { .type = nfa_state::kind::byte_range, .low = low, .high = high, .out = next });
+    }
+
+    std::vector<nfa_state>& _states;
+    bool _overflow = false;
+};
+
+result<regex_dfa, std::string> regex_dfa::compile(std::u32string_view pattern)
+{
+    auto parser = regex_parser { pattern };
+    auto node = parser.parse();
+    if (!node)
+        return failure { std::move(node).error() };
+    if (nullable(*node))
+        return failure { std::string("Pattern matches empty text.") };
+
+    auto dfa = regex_dfa {};
+    dfa._anchorBegin = parser.anchorBegin;
+    dfa._anchorEnd = parser.anchorEnd;
+
+    auto compiler = regex_compiler { dfa._nfa };
+    auto const accept = compiler.emit(nfa_state { .type = nfa_state::kind::accept });
+    dfa._anchoredStart = compiler.compile(*node, accept);
+
+    // The unanchored start skips any number of bytes before matching the pattern.
+    dfa._unanchoredStart = compiler.emitSplit(0, dfa._anchoredStart);
+    auto const skip = compiler.emit(nfa_state {
+        .type = nfa_state::kind::byte_range, .low = 0x00, .high = 0xFF, .out = dfa._unanchoredStart });
+    if (compiler.overflowed())
+        return failure { std::string("Pattern is too large.") };
+    dfa._nfa[static_cast<size_t>(dfa._unanchoredStart)].out = skip;
+
+    return dfa;
+}
+
+bool regex_dfa::contains(std::string_view text) const
+{
+    auto state = startState(_anchorBegin);
+    for (auto const ch: text)
+    {
+        state = step(state, static_cast<uint8_t>(ch));
+        if (_dfa[static_cast<size_t>(state)].dead)
+            return false;
+        if (!_anchorEnd && _dfa[static_cast<size_t>(state)].accepting)
+            return true;
+    }
+    return _dfa[static_cast<size_t>(state)].accepting;
+}
+
+std::optional<regex_dfa::match> regex_dfa::find(std::string_view text, size_t from) const
+{
+    if (from >= text.size() || (_anchorBegin && from != 0) || !contains(text.substr(from)))
+        return std::nullopt;
+
+    for (auto begin = from; begin < text.size(); ++begin)
+    {
+        // Matches can only begin at the first byte of a UTF-8 sequence.
+        if ((static_cast<uint8_t>(text[begin]) & 0xC0) == 0x80)
+            continue;
+        if (auto const end = longestMatchAt(text, begin))
+            return match { begin, *end };
+        if (_anchorBegin)
+            break;
+    }
+    return std::nullopt;
+}
+
+std::optional<regex_dfa::match> regex_dfa::rfind(std::string_view text, size_t from) const
+{
+    if (text.empty() || !contains(text))
+        return std::nullopt;
+
+    for (auto begin = _anchorBegin ? 0 : std::min(from, text.size() - 1);; --begin)
+    {
+        if ((static_cast<uint8_t>(text[begin]) & 0xC0) != 0x80)
+            if (auto const end = longestMatchAt(text, begin))
+                return match { begin, *end };
+        if (begin == 0)
+            break;
+    }
+    return std::nullopt;
+}
+
+std::optional<size_t> regex_dfa::longestMatchAt(std::string_view text, size_t begin) const
+{
+    auto end = std::optional<size_t> {};
+    auto state = startState(true);
+    for (auto i = begin; i < text.size(); ++i)
+    {
+        state = step(state, static_cast<uint8_t>(text[i]));
+        auto const& current = _dfa[static_cast<size_t>(state)];
+        if (current.dead)
+            break;
+        if (current.accepting && (!_anchorEnd || i + 1 == text.size()))
+            end = i + 1;
+    }
+    return end;
+}
+
+int regex_dfa::startState(bool anchored) const
+{
+    auto& start = _dfaStart[anchored ? 1 : 0];
+    if (start < 0)
+    {
+        auto const state = addState(closure({ anchored ? _anchoredStart : _unanchoredStart }));
+        _dfaStart[anchored ? 1 : 0] = state;
+        return state;
+    }
+    return start;
+}
+
+int regex_dfa::step(int state, uint8_t byte) const
+{
+    if (auto const next = _dfa[static_cast<size_t>(state)].next[byte]; next >= 0)
+        return next;
+
+    auto targets = std::vector<int> {};
+    for (auto const s: _dfaSets[static_cast<size_t>(state)])
+        if (auto const& nfaState = _nfa[static_cast<size_t>(s)];
+            nfaState.type == nfa_state::kind::byte_range && nfaState.low <= byte && byte <= nfaState.high)
+            targets.push_back(nfaState.out);
+
+    // The cache may get flushed while adding the new state, invalidating the current one.
+    auto const flushes = _dfaFlushes;
+    auto const next = addState(closure(std::move(targets)));
+    if (flushes == _dfaFlushes)
+        _dfa[static_cast<size_t>(state)].next[byte] = next;
+    return next;
+}
+
+int regex_dfa::addState(std::vector<int> nfaStates) const
+{
+    if (auto const i = _dfaIndex.find(nfaStates); i != _dfaIndex.end())
+        return i->second;
+
+    if (_dfa.size() >= MaxDfaStates)
+    {
+        _dfa.clear();
+        _dfaSets.clear();
+        _dfaIndex.clear();
+        _dfaStart = { -1, -1 };
+        ++_dfaFlushes;
+    }
+
+    auto state = dfa_state {};
+    state.next.fill(-1);
+    state.dead = nfaStates.empty();
+    state.accepting = std::ranges::any_of(
+        nfaStates, [this](int s) { return _nfa[static_cast<size_t>(s)].type == nfa_state::kind::accept; });
+
+    auto const id = static_cast<int>(_dfa.size());
+    _dfa.emplace_back(state);
+    _dfaSets.emplace_back(nfaStates);
+    _dfaIndex.emplace(std::move(nfaStates), id);
+    return id;
+}
+
+std::vector<int> regex_dfa::closure(std::vector<int> pending) const
+{
+    auto visited = std::vector<bool>(_nfa.size());
+    auto output = std::vector<int> {};
+    while (!pending.empty())
+    {
+        auto const s = pending.back();
+        pending.pop_back();
+        if (visited[static_cast<size_t>(s)])
+            continue;
+        visited[static_cast<size_t>(s)] = true;
+
+        auto const& state = _nfa[static_cast<size_t>(s)];
+        if (state.type == nfa_state::kind::split)
+        {
+            pending.push_back(state.out2);
+            pending.push_back(state.out);
+        }
+        else
+            output.push_back(s);
+    }
+    std::ranges::sort(output);
+    return output;
+}
+
+} // namespace crispy
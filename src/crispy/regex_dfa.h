@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <crispy/result.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace crispy
+{
+
+/**
+ * regex_dfa is a regular expression, compiled into an automaton that runs directly over UTF-8 text.
+ *
+ * The pattern is compiled into a byte-level NFA once, from which DFA states are built lazily
+ * (and cached) while matching, so that each byte of text is looked at only once per match attempt,
+ * with no backtracking involved.
+ *
+ * The supported syntax is:
+ * - literal characters, `.` (any character), and character classes such as `[a-z_]` or `[^0-9]`
+ * - the escapes `\d`, `\w`, `\s` (and their negations `\D`, `\W`, `\S`), `\t`, `\n`, `\r`,
+ *   and any escaped punctuation, e.g. `\[` or `\.`
+ * - groups `(...)` and `(?:...)`, as well as alternations `a|b`
+ * - the repetitions `*`, `+`, `?`, `{n}`, `{n,}`, and `{n,m}`
+ * - `^` at the beginning and `$` at the end of the pattern, anchoring it to the beginning/end of the text
+ * - a leading `(?i)` for matching ASCII letters case insensitively
+ *
+ * Patterns that match the empty text are rejected, as only non-empty matches can ever be found.
+ *
+ * Matching is not thread-safe, as even the const member functions extend the DFA state cache.
+ */
+class regex_dfa
+{
+  public:
+    /// The byte offsets of a match within the text.
+    struct match
+    {
+        size_t begin;
+        size_t end;
+
+        constexpr bool operator==(match const&) const noexcept = default;
+    };
+
+    /// Compiles the given pattern.
+    ///
+    /// @returns the compiled pattern or a message describing why the pattern is invalid.
+    [[nodiscard]] static result<regex_dfa, std::string> compile(std::u32string_view pattern);
+
+    /// Tests whether the pattern matches anywhere within the given UTF-8 text.
+    [[nodiscard]] bool contains(std::string_view text) const;
+
+    /// @returns the leftmost-longest match that begins at or after the byte offset @p from.
+    [[nodiscard]] std::optional<match> find(std::string_view text, size_t from = 0) const;
+
+    /// @returns the rightmost (longest) match that begins at or before the byte offset @p from.
+    [[nodiscard]] std::optional<match> rfind(std::string_view text,
+                                             size_t from = std::string_view::npos) const;
+
+    /// @returns the number of DFA states built so far.
+    [[nodiscard]] size_t stateCount() const noexcept { return _dfa.size(); }
+
+  private:
+    struct nfa_state
+    {
+        enum class kind : uint8_t
+        {
+            byte_range, // consumes a byte within [low, high], continuing with out
+            split,      // continues with both, out and out2, without consuming any input
+            accept,
+        };
+
+        kind type;
+        uint8_t low = 0;
+        uint8_t high = 0;
+        int out = 0;
+        int out2 = 0;
+    };
+
+    struct dfa_state
+    {
+        std::array<int, 256> next; // transitions by input byte, or -1 if not built yet
+        bool accepting = false;
+        bool dead = false;
+    };
+
+    friend class regex_compiler;
+
+    // Upper bound of DFA states to cache, after which the cache is flushed.
+    static constexpr size_t MaxDfaStates = 1024;
+
+    regex_dfa() = default;
+
+    [[nodiscard]] int startState(bool anchored) const;
+    [[nodiscard]] int step(int state, uint8_t byte) const;
+    [[nodiscard]] int addState(std::vector<int> nfaStates) const;
+    [[nodiscard]] std::vector<int> closure(std::vector<int> pending) const;
+    [[nodiscard]] std::optional<size_t> longestMatchAt(std::string_view text, size_t begin) const;
+
+    std::vector<nfa_state> _nfa;
+    int _anchoredStart = 0;
+    int _unanchoredStart = 0;
+    bool _anchorBegin = false;
+    bool _anchorEnd = false;
+
+    // The lazily built DFA, with each state representing a set of NFA states.
+    mutable std::vector<dfa_state> _dfa;
+    mutable std::vector<std::vector<int>> _dfaSets;
+    mutable std::map<std::vector<int>, int> _dfaIndex;
+    mutable std::array<int, 2> _dfaStart { -1, -1 };
+    mutable size_t _dfaFlushes = 0;
+};
+
+} // namespace crispy
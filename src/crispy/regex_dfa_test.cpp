@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/regex_dfa.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+using crispy::regex_dfa;
+using match = regex_dfa::match;
+
+namespace
+{
+
+regex_dfa compiled(std::u32string_view pattern)
+{
+    auto regex = regex_dfa::compile(pattern);
+    REQUIRE(regex.has_value());
+    return std::move(regex).value();
+}
+
+} // namespace
+
+TEST_CASE("regex_dfa.literal")
+{
+    auto const regex = compiled(U"error");
+    CHECK(regex.contains("build error: oops"));
+    CHECK_FALSE(regex.contains("build err0r: oops"));
+    CHECK(regex.find("error and error") == match { 0, 5 });
+    CHECK(regex.find("error and error", 1) == match { 10, 15 });
+    CHECK(regex.rfind("error and error") == match { 10, 15 });
+    CHECK(regex.rfind("error and error", 9) == match { 0, 5 });
+    CHECK(regex.find("") == std::nullopt);
+}
+
+TEST_CASE("regex_dfa.classes_and_repetition")
+{
+    auto const regex = compiled(U"error\\[E\\d+\\]");
+    CHECK(regex.find("src/main.rs: error[E0308]: mismatched types") == match { 13, 25 });
+    CHECK_FALSE(regex.contains("error[E]"));
+    CHECK_FALSE(regex.contains("error[e0308]"));
+
+    auto const hex = compiled(U"0x[0-9a-fA-F]{2,4}");
+    CHECK(hex.find("at 0xDEADBEEF") == match { 3, 9 });
+    CHECK_FALSE(hex.contains("0xG1"));
+
+    auto const negated = compiled(U"\"[^\"]*\"");
+    CHECK(negated.find("say \"hi\" and \"ho\"") == match { 4, 8 });
+}
+
+TEST_CASE("regex_dfa.alternation_and_groups")
+{
+    auto const regex = compiled(U"(?:warn|error)(ing)?:");
+    CHECK(regex.find("a warning: b") == match { 2, 10 });
+    CHECK(regex.find("an error: b") == match { 3, 9 });
+    CHECK_FALSE(regex.contains("a warn b"));
+}
+
+TEST_CASE("regex_dfa.leftmost_longest")
+{
+    auto const regex = compiled(U"a+|b");
+    CHECK(regex.find("xbaaa") == match { 1, 2 });
+    CHECK(regex.find("xaaab") == match { 1, 4 });
+}
+
+TEST_CASE("regex_dfa.anchors")
+{
+    auto const begin = compiled(U"^\\$ ");
+    CHECK(begin.find("$ ls") == match { 0, 2 });
+    CHECK_FALSE(begin.contains("echo $ ls"));
+    CHECK(begin.find("$ ls", 1) == std::nullopt);
+
+    auto const end = compiled(U"\\d+$");
+    CHECK(end.find("12 34") == match { 3, 5 });
+    CHECK_FALSE(end.contains("12 34 "));
+}
+
+TEST_CASE("regex_dfa.utf8")
+{
+    auto const dot = compiled(U"a.c");
+    CHECK(dot.find("xa\xC3\xA4" "c") == match { 1, 5 });
+    CHECK(dot.find("a\xE2\x82\xAC" "c") == match { 0, 5 });
+    CHECK(dot.find("a\xF0\x9F\x98\x80" "c") == match { 0, 6 });
+    CHECK_FALSE(dot.contains("ac"));
+
+    // Matches never begin within a UTF-8 sequence.
+    auto const cls = compiled(U"[ä-ö]+");
+    CHECK(cls.find("\xC3\xA4\xC3\xB6!") == match { 0, 4 });
+    CHECK(cls.rfind("\xC3\xA4\xC3\xB6!", 3) == match { 2, 4 });
+
+    auto const literal = compiled(U"€\\d");
+    CHECK(literal.find("5\xE2\x82\xAC 3\xE2\x82\xAC" "4") == match { 6, 10 });
+}
+
+TEST_CASE("regex_dfa.ignore_case")
+{
+    auto const regex = compiled(U"(?i)error [a-c]");
+    CHECK(regex.contains("ERROR B"));
+    CHECK(regex.contains("Error c"));
+    CHECK_FALSE(regex.contains("ERROR D"));
+
+    auto const negated = compiled(U"(?i)[^a]");
+    CHECK_FALSE(negated.contains("aA"));
+}
+
+TEST_CASE("regex_dfa.invalid")
+{
+    for (auto const* pattern: { U"(abc", U"abc)", U"[abc", U"*a", U"a{3,2}", U"a{1001}", U"\\q", U"a$b",
+                                U"a^", U"^a|b", U"a*", U"(?<x>a)", U"a\\" })
+        CHECK(regex_dfa::compile(pattern).is_error());
+
+    // Braces not forming a repetition are matched literally.
+    auto const braces = compiled(U"fn main() {");
+    CHECK(braces.contains("fn main {"));
+}
+
+TEST_CASE("regex_dfa.state_cache")
+{
+    // Requires more DFA states than are cached at once.
+    auto const regex = compiled(U"[ab]*a[ab]{14}c");
+    auto text = std::string {};
+    auto seed = uint32_t { 1 };
+    for (auto i = 0; i < 20000; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        text += (seed >> 16) & 1 ? 'a' : 'b';
+    }
+    CHECK_FALSE(regex.contains(text));
+    CHECK(regex.stateCount() <= 1024);
+    CHECK(regex.contains(text + "ab" + std::string(13, 'b') + "c"));
+}
@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+namespace crispy
+{
+
+/**
+ * Memory resource handing out fixed-size blocks from larger contiguous slabs.
+ *
+ * Allocations of exactly block_size() bytes are served from the slabs, all other allocations
+ * are forwarded to the upstream resource. Freed blocks are reused in LIFO order, so that
+ * a block that has just been released is the next one to be handed out again while still hot in cache.
+ * Fresh slabs hand out their blocks in address order, so that subsequently allocated blocks
+ * are adjacent in memory.
+ *
+ * Changing the block size retires the current slabs. Retired slabs keep serving their
+ * outstanding blocks and are returned to upstream as soon as their last block is deallocated.
+ *
+ * This resource is not thread-safe.
+ */
+class slab_resource final: public std::pmr::memory_resource // NOLINT(readability-identifier-naming)
+{
+  public:
+    static constexpr size_t DefaultBlocksPerSlab = 64;
+
+    explicit slab_resource(size_t blockSize,
+                           size_t blocksPerSlab = DefaultBlocksPerSlab,
+                           std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept:
+        _blockSize { blockSize }, _blocksPerSlab { std::max(blocksPerSlab, size_t { 1 }) }, _upstream { upstream }
+    {
+    }
+
+    slab_resource(slab_resource const&) = delete;
+    slab_resource& operator=(slab_resource const&) = delete;
+    slab_resource(slab_resource&&) = delete;
+    slab_resource& operator=(slab_resource&&) = delete;
+
+    ~slab_resource() override
+    {
+        for (auto const& slab: _slabs)
+            _upstream->deallocate(slab.data, slab.size, Alignment);
+    }
+
+    [[nodiscard]] size_t block_size() const noexcept { return _blockSize; }
+    [[nodiscard]] size_t slab_count() const noexcept { return _slabs.size(); }
+    [[nodiscard]] size_t blocks_in_use() const noexcept { return _blocksInUse; }
+
+    /// @returns the number of bytes currently allocated from upstream for the slabs.
+    [[nodiscard]] size_t bytes_reserved() const noexcept
+    {
+        auto total = size_t { 0 };
+        for (auto const& slab: _slabs)
+            total += slab.size;
+        return total;
+    }
+
+    /// Changes the size of the blocks handed out by subsequent allocations.
+    ///
+    /// Blocks of the previous size remain valid until they are deallocated.
+    void set_block_size(size_t blockSize)
+    {
+        if (blockSize == _blockSize)
+            return;
+
+        _blockSize = blockSize;
+        ++_generation;
+        _freeList = nullptr;
+        release_slabs_if([](slab_info const& slab) { return slab.used == 0; });
+    }
+
+    /// Returns all slabs without any block in use back to upstream.
+    void release_unused()
+    {
+        auto const unused = [this](slab_info const& slab) {
+            return slab.used == 0 && slab.generation == _generation;
+        };
+
+        // Drop the free blocks of the slabs about to be released from the free list.
+        free_block* kept = nullptr;
+        free_block** tail = &kept;
+        for (auto* block = _freeList; block; block = block->next)
+        {
+            if (!unused(*find_slab(block)))
+            {
+                *tail = block;
+                tail = &block->next;
+            }
+        }
+        *tail = nullptr;
+        _freeList = kept;
+
+        release_slabs_if(unused);
+    }
+
+  private:
+    static constexpr size_t Alignment = alignof(std::max_align_t);
+
+    struct free_block
+    {
+        free_block* next;
+    };
+
+    struct slab_info
+    {
+        std::byte* data;
+        size_t size;
+        size_t generation;
+        size_t used;
+
+        [[nodiscard]] bool contains(void const* p) const noexcept
+        {
+            return data <= static_cast<std::byte const*>(p) && static_cast<std::byte const*>(p) < data + size;
+        }
+    };
+
+    [[nodiscard]] size_t block_stride() const noexcept
+    {
+        auto const size = std::max(_blockSize, sizeof(free_block));
+        return (size + Alignment - 1) / Alignment * Alignment;
+    }
+
+    [[nodiscard]] bool is_slab_allocation(size_t bytes, size_t alignment) const noexcept
+    {
+        return bytes == _blockSize && bytes != 0 && alignment <= Alignment;
+    }
+
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        if (!is_slab_allocation(bytes, alignment))
+            return _upstream->allocate(bytes, alignment);
+
+        if (!_freeList)
+            allocate_slab();
+
+        auto* block = _freeList;
+        _freeList = block->next;
+        ++find_slab(block)->used;
+        ++_blocksInUse;
+        return block;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        auto* const slab = find_slab(p);
+        if (!slab)
+        {
+            _upstream->deallocate(p, bytes, alignment);
+            return;
+        }
+
+        --slab->used;
+        --_blocksInUse;
+        if (slab->generation == _generation)
+            _freeList = new (p) free_block { _freeList };
+        else if (slab->used == 0)
+        {
+            _upstream->deallocate(slab->data, slab->size, Alignment);
+            _slabs.erase(_slabs.begin() + (slab - _slabs.data()));
+        }
+    }
+
+    [[nodiscard]] bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    void allocate_slab()
+    {
+        auto const stride = block_stride();
+        auto const size = stride * _blocksPerSlab;
+        auto* const data = static_cast<std::byte*>(_upstream->allocate(size, Alignment));
+
+        // Keep the slabs ordered by address for the lookup in find_slab().
+        auto const i = std::upper_bound(
+            _slabs.begin(), _slabs.end(), data, [](std::byte* a, slab_info const& b) { return a < b.data; });
+        _slabs.insert(i, slab_info { data, size, _generation, 0 });
+
+        // Push in reverse, such that blocks are handed out in address order.
+        for (auto k = _blocksPerSlab; k > 0; --k)
+            _freeList = new (data + (k - 1) * stride) free_block { _freeList };
+    }
+
+    [[nodiscard]] slab_info* find_slab(void const* p) noexcept
+    {
+        auto const i = std::upper_bound(_slabs.begin(), _slabs.end(), p, [](void const* a, slab_info const& b) {
+            return static_cast<std::byte const*>(a) < b.data;
+        });
+        if (i == _slabs.begin())
+            return nullptr;
+        auto* const candidate = &*std::prev(i);
+        return candidate->contains(p) ? candidate : nullptr;
+    }
+
+    template <typename Predicate>
+    void release_slabs_if(Predicate predicate)
+    {
+        auto const i = std::remove_if(_slabs.begin(), _slabs.end(), [&](slab_info const& slab) {
+            if (!predicate(slab))
+                return false;
+            _upstream->deallocate(slab.data, slab.size, Alignment);
+            return true;
+        });
+        _slabs.erase(i, _slabs.end());
+    }
+
+    size_t _blockSize;
+    size_t _blocksPerSlab;
+    std::pmr::memory_resource* _upstream;
+    std::vector<slab_info> _slabs;
+    free_block* _freeList = nullptr;
+    size_t _generation = 0;
+    size_t _blocksInUse = 0;
+};
+
+} // namespace crispy
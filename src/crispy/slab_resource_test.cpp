@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/slab_resource.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <vector>
+
+using crispy::slab_resource;
+
+TEST_CASE("slab_resource.adjacent_blocks")
+{
+    auto resource = slab_resource(32, 4);
+    auto* a = static_cast<std::byte*>(resource.allocate(32));
+    auto* b = static_cast<std::byte*>(resource.allocate(32));
+    REQUIRE(resource.slab_count() == 1);
+    REQUIRE(resource.blocks_in_use() == 2);
+    CHECK(b == a + 32);
+
+    resource.deallocate(b, 32);
+    resource.deallocate(a, 32);
+    CHECK(resource.blocks_in_use() == 0);
+    CHECK(resource.slab_count() == 1);
+}
+
+TEST_CASE("slab_resource.recycles_last_freed_block")
+{
+    auto resource = slab_resource(32, 4);
+    auto* a = resource.allocate(32);
+    auto* b = resource.allocate(32);
+    resource.deallocate(a, 32);
+    CHECK(resource.allocate(32) == a);
+    resource.deallocate(a, 32);
+    resource.deallocate(b, 32);
+}
+
+TEST_CASE("slab_resource.grows_by_slab")
+{
+    auto resource = slab_resource(16, 2);
+    auto blocks = std::vector<void*> {};
+    for (int i = 0; i < 5; ++i)
+        blocks.push_back(resource.allocate(16));
+    CHECK(resource.slab_count() == 3);
+    CHECK(resource.bytes_reserved() == 3 * 2 * 16);
+
+    for (auto* block: blocks)
+        resource.deallocate(block, 16);
+    CHECK(resource.slab_count() == 3);
+
+    resource.release_unused();
+    CHECK(resource.slab_count() == 0);
+    CHECK(resource.bytes_reserved() == 0);
+}
+
+TEST_CASE("slab_resource.release_unused_keeps_used_slabs")
+{
+    auto resource = slab_resource(16, 2);
+    auto* a = resource.allocate(16);
+    auto* b = resource.allocate(16);
+    auto* c = resource.allocate(16);
+    REQUIRE(resource.slab_count() == 2);
+
+    resource.deallocate(a, 16);
+    resource.deallocate(b, 16);
+    resource.release_unused();
+    CHECK(resource.slab_count() == 1);
+
+    // The free block next to c is still handed out.
+    auto* d = resource.allocate(16);
+    CHECK(resource.slab_count() == 1);
+    resource.deallocate(d, 16);
+    resource.deallocate(c, 16);
+}
+
+TEST_CASE("slab_resource.other_sizes_go_upstream")
+{
+    auto resource = slab_resource(32, 4);
+    auto* p = resource.allocate(64);
+    CHECK(resource.slab_count() == 0);
+    CHECK(resource.blocks_in_use() == 0);
+    resource.deallocate(p, 64);
+}
+
+TEST_CASE("slab_resource.set_block_size")
+{
+    auto resource = slab_resource(32, 4);
+    auto* a = resource.allocate(32);
+    resource.set_block_size(48);
+    CHECK(resource.slab_count() == 1);
+
+    auto* b = resource.allocate(48);
+    CHECK(resource.slab_count() == 2);
+
+    // The retired slab is released with its last block.
+    resource.deallocate(a, 32);
+    CHECK(resource.slab_count() == 1);
+    resource.deallocate(b, 48);
+    CHECK(resource.blocks_in_use() == 0);
+}
+
+TEST_CASE("slab_resource.pmr_vector")
+{
+    auto resource = slab_resource(sizeof(uint32_t) * 80);
+    {
+        auto cells = std::pmr::vector<uint32_t>(&resource);
+        cells.reserve(80);
+        cells.resize(80, 42);
+        CHECK(resource.blocks_in_use() == 1);
+    }
+    CHECK(resource.blocks_in_use() == 0);
+}
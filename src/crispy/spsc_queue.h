@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+namespace crispy
+{
+
+/**
+ * Bounded lock-free queue for exactly one producer thread and one consumer thread.
+ *
+ * The producer only ever writes the tail index and the consumer only ever writes the head index,
+ * so both sides get along without any atomic read-modify-write operations.
+ * The two indices live on separate cache lines to avoid false sharing between the threads.
+ *
+ * @p Capacity must be a power of two.
+ */
+template <typename T, size_t Capacity>
+class spsc_queue // NOLINT(readability-identifier-naming)
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+  public:
+    using value_type = T;
+
+    spsc_queue() = default;
+    spsc_queue(spsc_queue const&) = delete;
+    spsc_queue& operator=(spsc_queue const&) = delete;
+    spsc_queue(spsc_queue&&) = delete;
+    spsc_queue& operator=(spsc_queue&&) = delete;
+    ~spsc_queue() = default;
+
+    [[nodiscard]] static constexpr size_t capacity() noexcept { return Capacity; }
+
+    /// Enqueues @p value unless the queue is full.
+    ///
+    /// Must only be called from the producer thread.
+    ///
+    /// @retval true  the value has been enqueued.
+    /// @retval false the queue is full and @p value is left untouched.
+    [[nodiscard]] bool try_push(T&& value) noexcept
+    {
+        auto const tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        _slots[tail % Capacity] = std::move(value);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Dequeues the oldest value, if any.
+    ///
+    /// Must only be called from the consumer thread.
+    [[nodiscard]] std::optional<T> try_pop() noexcept
+    {
+        auto const head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire))
+            return std::nullopt;
+        auto value = std::optional<T> { std::move(_slots[head % Capacity]) };
+        _slots[head % Capacity] = T {};
+        _head.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    /// @returns an approximation of the number of queued values.
+    ///
+    /// The result is exact when called from either the producer or the consumer
+    /// with respect to that side's own operations.
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+    [[nodiscard]] bool full() const noexcept { return size() == Capacity; }
+
+  private:
+    static constexpr size_t CacheLineSize = 64;
+
+    alignas(CacheLineSize) std::atomic<size_t> _head = 0;
+    alignas(CacheLineSize) std::atomic<size_t> _tail = 0;
+    alignas(CacheLineSize) std::array<T, Capacity> _slots {};
+};
+
+} // namespace crispy
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/spsc_queue.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <thread>
+
+using crispy::spsc_queue;
+
+TEST_CASE("spsc_queue.push_pop")
+{
+    auto queue = spsc_queue<int, 4> {};
+    REQUIRE(queue.empty());
+    REQUIRE(!queue.try_pop().has_value());
+
+    REQUIRE(queue.try_push(1));
+    REQUIRE(queue.try_push(2));
+    REQUIRE(queue.size() == 2);
+
+    REQUIRE(queue.try_pop() == 1);
+    REQUIRE(queue.try_pop() == 2);
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("spsc_queue.full")
+{
+    auto queue = spsc_queue<int, 2> {};
+    REQUIRE(queue.try_push(1));
+    REQUIRE(queue.try_push(2));
+    REQUIRE(queue.full());
+    REQUIRE(!queue.try_push(3));
+
+    REQUIRE(queue.try_pop() == 1);
+    REQUIRE(queue.try_push(3));
+    REQUIRE(queue.try_pop() == 2);
+    REQUIRE(queue.try_pop() == 3);
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("spsc_queue.releases_popped_values")
+{
+    auto queue = spsc_queue<std::shared_ptr<int>, 2> {};
+    auto value = std::make_shared<int>(42);
+    REQUIRE(queue.try_push(std::shared_ptr<int>(value)));
+    REQUIRE(value.use_count() == 2);
+
+    auto popped = queue.try_pop();
+    REQUIRE(popped.has_value());
+    popped.reset();
+    REQUIRE(value.use_count() == 1);
+}
+
+TEST_CASE("spsc_queue.threaded")
+{
+    constexpr auto Count = 100'000;
+    auto queue = spsc_queue<int, 64> {};
+
+    auto producer = std::thread([&]() {
+        for (int i = 0; i < Count; ++i)
+            while (!queue.try_push(int(i)))
+                std::this_thread::yield();
+    });
+
+    auto expected = 0;
+    while (expected < Count)
+    {
+        if (auto const value = queue.try_pop(); value.has_value())
+        {
+            REQUIRE(*value == expected);
+            ++expected;
+        }
+        else
+            std::this_thread::yield();
+    }
+
+    producer.join();
+    REQUIRE(queue.empty());
+}
@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/thread_pool.h>
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace crispy
+{
+
+namespace
+{
+    // The pool and queue index of the thread pool thread this is running on, if any.
+    thread_local thread_pool const* currentPool = nullptr;
+    thread_local size_t currentQueue = 0;
+} // namespace
+
+thread_pool::thread_pool(size_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    _queues.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+        _queues.emplace_back(std::make_unique<worker_queue>());
+
+    _threads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+        _threads.emplace_back(&thread_pool::run, this, i);
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        auto const _ = std::lock_guard { _sleepMutex };
+        _stopping = true;
+    }
+    _wakeup.notify_all();
+    for (auto& thread: _threads)
+        thread.join();
+}
+
+void thread_pool::post(task work, priority prio)
+{
+    enqueue(entry { std::move(work), std::nullopt }, prio);
+}
+
+void thread_pool::post(task work, cancellation_token token, priority prio)
+{
+    enqueue(entry { std::move(work), std::move(token) }, prio);
+}
+
+void thread_pool::enqueue(entry item, priority prio)
+{
+    auto const index = currentPool == this
+                           ? currentQueue
+                           : _nextQueue.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+    {
+        auto& queue = *_queues[index];
+        auto const _ = std::lock_guard { queue.mutex };
+        queue.tasks[static_cast<size_t>(prio)].emplace_back(std::move(item));
+    }
+    {
+        auto const _ = std::lock_guard { _sleepMutex };
+        ++_pending;
+    }
+    _wakeup.notify_one();
+}
+
+std::optional<thread_pool::entry> thread_pool::take(size_t self)
+{
+    auto const takeFrom = [&](size_t index, size_t prio) -> std::optional<entry> {
+        auto& queue = *_queues[index];
+        auto const _ = std::lock_guard { queue.mutex };
+        auto& tasks = queue.tasks[prio];
+        if (tasks.empty())
+            return std::nullopt;
+        // The own queue is worked on in order, while stealing takes the most recently posted task,
+        // which is the least likely to be taken by its owner soon.
+        auto item = std::optional<entry> {};
+        if (index == self)
+        {
+            item = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        else
+        {
+            item = std::move(tasks.back());
+            tasks.pop_back();
+        }
+        return item;
+    };
+
+    for (auto const prio: { priority::Interactive, priority::Background })
+    {
+        if (auto item = takeFrom(self, static_cast<size_t>(prio)))
+            return item;
+        for (size_t i = 1; i < _queues.size(); ++i)
+        {
+            if (auto item = takeFrom((self + i) % _queues.size(), static_cast<size_t>(prio)))
+            {
+                _stolen.fetch_add(1, std::memory_order_relaxed);
+                return item;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+void thread_pool::execute(entry& item)
+{
+    {
+        auto const _ = std::lock_guard { _sleepMutex };
+        --_pending;
+    }
+
+    if (item.token && item.token->cancelled())
+    {
+        _cancelled.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    item.work();
+    _executed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void thread_pool::run(size_t self)
+{
+    currentPool = this;
+    currentQueue = self;
+
+    while (true)
+    {
+        if (auto item = take(self))
+        {
+            execute(*item);
+            continue;
+        }
+
+        auto lock = std::unique_lock { _sleepMutex };
+        _wakeup.wait(lock, [this]() { return _stopping || _pending != 0; });
+        if (_stopping)
+            return;
+    }
+}
+
+void thread_pool::parallel_for(size_t begin,
+                               size_t end,
+                               size_t grainSize,
+                               std::function<void(size_t first, size_t last)> const& body)
+{
+    if (begin >= end)
+        return;
+
+    grainSize = std::max<size_t>(grainSize, 1);
+    auto const chunkCount = (end - begin + grainSize - 1) / grainSize;
+    if (chunkCount == 1)
+    {
+        body(begin, end);
+        return;
+    }
+
+    // Helpers may only start after all chunks have been done, and must then not touch the body anymore.
+    struct shared_state
+    {
+        std::atomic<size_t> nextChunk = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t doneChunks = 0; // with mutex locked
+        std::exception_ptr error;
+    };
+    auto const state = std::make_shared<shared_state>();
+
+    auto const work = [state, begin, end, grainSize, chunkCount, &body]() {
+        while (true)
+        {
+            auto const chunk = state->nextChunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= chunkCount)
+                return;
+            auto const first = begin + (chunk * grainSize);
+            try
+            {
+                body(first, std::min(first + grainSize, end));
+            }
+            catch (...)
+            {
+                auto const _ = std::lock_guard { state->mutex };
+                if (!state->error)
+                    state->error = std::current_exception();
+            }
+            auto const _ = std::lock_guard { state->mutex };
+            if (++state->doneChunks == chunkCount)
+                state->done.notify_one();
+        }
+    };
+
+    auto const helperCount = std::min(chunkCount - 1, _threads.size());
+    for (size_t i = 0; i < helperCount; ++i)
+        post(work, priority::Interactive);
+
+    work();
+
+    auto lock = std::unique_lock { state->mutex };
+    state->done.wait(lock, [&]() { return state->doneChunks == chunkCount; });
+    if (state->error)
+        std::rethrow_exception(state->error);
+}
+
+thread_pool::statistics thread_pool::stats() const noexcept
+{
+    auto result = statistics {};
+    result.threadCount = _threads.size();
+    result.executed = _executed.load(std::memory_order_relaxed);
+    result.stolen = _stolen.load(std::memory_order_relaxed);
+    result.cancelled = _cancelled.load(std::memory_order_relaxed);
+    {
+        auto const _ = std::lock_guard { _sleepMutex };
+        result.pending = _pending;
+    }
+    return result;
+}
+
+} // namespace crispy
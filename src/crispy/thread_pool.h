@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace crispy
+{
+
+/**
+ * Flag shared by a task and whoever posted it, to ask the task to stop early.
+ *
+ * Copies refer to the same flag. Tasks that have not started yet are skipped once cancelled,
+ * whereas running tasks are expected to poll cancelled() at convenient points.
+ */
+class cancellation_token
+{
+  public:
+    cancellation_token(): _cancelled { std::make_shared<std::atomic<bool>>(false) } {}
+
+    void cancel() const noexcept { _cancelled->store(true, std::memory_order_relaxed); }
+    [[nodiscard]] bool cancelled() const noexcept { return _cancelled->load(std::memory_order_relaxed); }
+
+  private:
+    std::shared_ptr<std::atomic<bool>> _cancelled;
+};
+
+/**
+ * thread_pool runs posted tasks on a fixed number of threads, to be shared by all users of
+ * background execution instead of each of them spawning their own threads.
+ *
+ * Each thread has its own queue, which tasks posted from that thread go into, and which
+ * it takes the tasks from in order. Threads running out of tasks steal from the other end
+ * of the other threads' queues. Interactive tasks are always taken before background ones.
+ */
+class thread_pool
+{
+  public:
+    enum class priority
+    {
+        Interactive, // worked on right away, e.g. for the next frame to be rendered
+        Background,  // worked on whenever there is nothing interactive to do
+    };
+
+    using task = std::function<void()>;
+
+    // Counters since construction, e.g. to be shown in diagnostics.
+    struct statistics
+    {
+        size_t threadCount = 0;
+        uint64_t executed = 0;  // tasks run to completion
+        uint64_t stolen = 0;    // tasks taken from another thread's queue
+        uint64_t cancelled = 0; // tasks skipped as cancelled before they started
+        size_t pending = 0;     // tasks waiting to be run
+    };
+
+    /// Starts @p threadCount threads, or as many as there are CPU cores if 0.
+    explicit thread_pool(size_t threadCount = 0);
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator=(thread_pool const&) = delete;
+    thread_pool(thread_pool&&) = delete;
+    thread_pool& operator=(thread_pool&&) = delete;
+
+    /// Stops and joins the threads, waiting for running tasks to return
+    /// while dropping the ones that have not started yet.
+    ~thread_pool();
+
+    [[nodiscard]] size_t threadCount() const noexcept { return _threads.size(); }
+
+    /// Queues @p work to be run on one of the threads.
+    void post(task work, priority prio = priority::Background);
+
+    /// Queues @p work to be run on one of the threads, unless @p token is cancelled before it started.
+    void post(task work, cancellation_token token, priority prio = priority::Background);
+
+    /// Invokes @p body(first, last) for consecutive subranges of [begin, end) of @p grainSize indices
+    /// at most, concurrently on the calling thread and the pool's threads, returning once all are done.
+    ///
+    /// May also be called from within a task. The first exception thrown by the body is rethrown.
+    void parallel_for(size_t begin,
+                      size_t end,
+                      size_t grainSize,
+                      std::function<void(size_t first, size_t last)> const& body);
+
+    [[nodiscard]] statistics stats() const noexcept;
+
+  private:
+    struct entry
+    {
+        task work;
+        std::optional<cancellation_token> token;
+    };
+
+    struct worker_queue
+    {
+        std::mutex mutex;
+        std::array<std::deque<entry>, 2> tasks; // indexed by priority
+    };
+
+    void enqueue(entry item, priority prio);
+    std::optional<entry> take(size_t self);
+    void execute(entry& item);
+    void run(size_t self);
+
+    std::vector<std::unique_ptr<worker_queue>> _queues;
+    std::vector<std::thread> _threads;
+    std::atomic<size_t> _nextQueue = 0; // round-robin queue for tasks posted from other threads
+
+    std::mutex mutable _sleepMutex;
+    std::condition_variable _wakeup;
+    size_t _pending = 0; // with _sleepMutex locked
+    bool _stopping = false;
+
+    std::atomic<uint64_t> _executed = 0;
+    std::atomic<uint64_t> _stolen = 0;
+    std::atomic<uint64_t> _cancelled = 0;
+};
+
+} // namespace crispy
@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/thread_pool.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+using crispy::cancellation_token;
+using crispy::thread_pool;
+
+TEST_CASE("thread_pool.post", "[thread_pool]")
+{
+    auto pool = thread_pool(4);
+    CHECK(pool.threadCount() == 4);
+
+    auto constexpr TaskCount = 1000;
+    auto counter = std::atomic<int> { 0 };
+    auto done = std::promise<void> {};
+    for (auto i = 0; i < TaskCount; ++i)
+        pool.post([&]() {
+            if (++counter == TaskCount)
+                done.set_value();
+        });
+    done.get_future().wait();
+
+    CHECK(counter == TaskCount);
+}
+
+TEST_CASE("thread_pool.priority", "[thread_pool]")
+{
+    auto pool = thread_pool(1);
+
+    // Keep the only thread busy until all tasks have been posted.
+    auto started = std::promise<void> {};
+    auto release = std::promise<void> {};
+    pool.post([&, future = release.get_future().share()]() {
+        started.set_value();
+        future.wait();
+    });
+    started.get_future().wait();
+
+    auto mutex = std::mutex {};
+    auto order = std::vector<int> {};
+    auto done = std::promise<void> {};
+    auto const record = [&](int value) {
+        auto const _ = std::lock_guard { mutex };
+        order.push_back(value);
+        if (order.size() == 4)
+            done.set_value();
+    };
+    pool.post([&]() { record(1); }, thread_pool::priority::Background);
+    pool.post([&]() { record(2); }, thread_pool::priority::Background);
+    pool.post([&]() { record(3); }, thread_pool::priority::Interactive);
+    pool.post([&]() { record(4); }, thread_pool::priority::Interactive);
+
+    release.set_value();
+    done.get_future().wait();
+
+    CHECK(order == std::vector<int> { 3, 4, 1, 2 });
+}
+
+TEST_CASE("thread_pool.cancellation", "[thread_pool]")
+{
+    auto pool = thread_pool(1);
+
+    auto release = std::promise<void> {};
+    pool.post([future = release.get_future().share()]() { future.wait(); });
+
+    auto const token = cancellation_token {};
+    auto ran = std::atomic<bool> { false };
+    pool.post([&]() { ran = true; }, token);
+    token.cancel();
+    CHECK(token.cancelled());
+
+    auto done = std::promise<void> {};
+    pool.post([&]() { done.set_value(); });
+    release.set_value();
+    done.get_future().wait();
+
+    CHECK(!ran);
+    CHECK(pool.stats().cancelled == 1);
+}
+
+TEST_CASE("thread_pool.parallel_for", "[thread_pool]")
+{
+    auto pool = thread_pool(4);
+
+    SECTION("covers the range exactly once")
+    {
+        // Catch2's assertions are not thread-safe, so the subranges are checked afterwards.
+        auto visits = std::vector<std::atomic<int>>(10'007);
+        auto invalidRanges = std::atomic<int> { 0 };
+        pool.parallel_for(0, visits.size(), 100, [&](size_t first, size_t last) {
+            if (first >= last || last - first > 100)
+                ++invalidRanges;
+            for (auto i = first; i < last; ++i)
+                ++visits[i];
+        });
+        CHECK(invalidRanges == 0);
+        auto const total = std::accumulate(
+            visits.begin(), visits.end(), 0, [](int sum, auto const& visit) { return sum + visit.load(); });
+        CHECK(total == 10'007);
+        CHECK(std::all_of(visits.begin(), visits.end(), [](auto const& visit) { return visit == 1; }));
+    }
+
+    SECTION("empty range")
+    {
+        auto called = false;
+        pool.parallel_for(5, 5, 1, [&](size_t, size_t) { called = true; });
+        CHECK(!called);
+    }
+
+    SECTION("nested within a task")
+    {
+        auto sum = std::atomic<size_t> { 0 };
+        auto done = std::promise<void> {};
+        pool.post([&]() {
+            pool.parallel_for(0, 1000, 10, [&](size_t first, size_t last) {
+                for (auto i = first; i < last; ++i)
+                    sum += i;
+            });
+            done.set_value();
+        });
+        done.get_future().wait();
+        CHECK(sum == 999 * 1000 / 2);
+    }
+
+    SECTION("rethrows")
+    {
+        CHECK_THROWS_AS(pool.parallel_for(0,
+                                          100,
+                                          1,
+                                          [](size_t first, size_t) {
+                                              if (first == 42)
+                                                  throw std::runtime_error("42");
+                                          }),
+                        std::runtime_error);
+    }
+}
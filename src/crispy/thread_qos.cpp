@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/thread_qos.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <utility>
+
+#if defined(__APPLE__)
+    #include <pthread.h>
+    #include <sys/qos.h>
+#elif defined(__linux__)
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+
+    #include <pthread.h>
+    #include <sched.h>
+    #include <unistd.h>
+#elif defined(_WIN32)
+    #include <Windows.h>
+    #include <avrt.h>
+#endif
+
+namespace crispy
+{
+
+namespace
+{
+    constexpr auto Names = std::array {
+        std::pair { thread_qos::Background, std::string_view("background") },
+        std::pair { thread_qos::Utility, std::string_view("utility") },
+        std::pair { thread_qos::Default, std::string_view("default") },
+        std::pair { thread_qos::Interactive, std::string_view("interactive") },
+        std::pair { thread_qos::Realtime, std::string_view("realtime") },
+    };
+
+#if defined(__linux__)
+    // Nice value of Interactive threads, applied only if RLIMIT_NICE (or CAP_SYS_NICE) permits it.
+    //
+    // Other classes keep the nice value at 0, and are told apart by their policy instead, as unprivileged
+    // threads may always switch back from SCHED_BATCH, but never lower their nice value back to 0.
+    constexpr auto InteractiveNiceValue = -5;
+
+    // Switching back from SCHED_IDLE is subject to RLIMIT_NICE, too, which permits nice values down to
+    // 20 minus its limit, and is 0 by default.
+    bool mayLeaveIdlePolicy() noexcept
+    {
+        auto limit = rlimit {};
+        return geteuid() == 0 || (getrlimit(RLIMIT_NICE, &limit) == 0 && limit.rlim_cur >= 20);
+    }
+
+    bool setPolicy(int policy, int priority) noexcept
+    {
+        auto param = sched_param {};
+        param.sched_priority = priority;
+        return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+    }
+
+    bool setNice(int value) noexcept
+    {
+        auto const tid = static_cast<id_t>(syscall(SYS_gettid));
+        return setpriority(PRIO_PROCESS, tid, value) == 0;
+    }
+#elif defined(_WIN32)
+    // The MMCSS task the calling thread has joined, to be left when applying another class.
+    thread_local HANDLE mmcssTask = nullptr;
+
+    void leaveMmcssTask() noexcept
+    {
+        if (mmcssTask)
+            AvRevertMmThreadCharacteristics(std::exchange(mmcssTask, nullptr));
+    }
+#endif
+} // namespace
+
+std::optional<thread_qos> set_current_thread_qos(thread_qos qos) noexcept
+{
+#if defined(__APPLE__)
+    // Real-time scheduling would require the Mach time constraint policy along with a known frame budget.
+    auto const qosClass = [&]() {
+        switch (qos)
+        {
+            case thread_qos::Background: return QOS_CLASS_BACKGROUND;
+            case thread_qos::Utility: return QOS_CLASS_UTILITY;
+            case thread_qos::Default: return QOS_CLASS_DEFAULT;
+            case thread_qos::Interactive:
+            case thread_qos::Realtime: break;
+        }
+        return QOS_CLASS_USER_INTERACTIVE;
+    }();
+    if (pthread_set_qos_class_self_np(qosClass, 0) != 0)
+        return std::nullopt;
+    return std::min(qos, thread_qos::Interactive);
+#elif defined(__linux__)
+    switch (qos)
+    {
+        case thread_qos::Realtime:
+            if (setPolicy(SCHED_RR, sched_get_priority_min(SCHED_RR)))
+                return thread_qos::Realtime;
+            [[fallthrough]];
+        case thread_qos::Interactive:
+            if (!setPolicy(SCHED_OTHER, 0))
+                return std::nullopt;
+            if (setNice(InteractiveNiceValue))
+                return thread_qos::Interactive;
+            return thread_qos::Default;
+        case thread_qos::Default:
+        case thread_qos::Utility:
+        case thread_qos::Background: break;
+    }
+    auto const policy = qos == thread_qos::Background && mayLeaveIdlePolicy() ? SCHED_IDLE
+                        : qos != thread_qos::Default                          ? SCHED_BATCH
+                                                                              : SCHED_OTHER;
+    if (!setPolicy(policy, 0))
+        return std::nullopt;
+    setNice(0); // in case it was Interactive before
+    return qos;
+#elif defined(_WIN32)
+    leaveMmcssTask();
+    if (qos == thread_qos::Realtime)
+    {
+        // The "Games" task is boosted for as long as its threads use less than their share of the CPU.
+        auto taskIndex = DWORD { 0 };
+        mmcssTask = AvSetMmThreadCharacteristicsW(L"Games", &taskIndex);
+        if (mmcssTask)
+            return thread_qos::Realtime;
+    }
+
+    auto const priority = [&]() {
+        switch (qos)
+        {
+            case thread_qos::Background: return THREAD_PRIORITY_LOWEST;
+            case thread_qos::Utility: return THREAD_PRIORITY_BELOW_NORMAL;
+            case thread_qos::Default: return THREAD_PRIORITY_NORMAL;
+            case thread_qos::Interactive:
+            case thread_qos::Realtime: break;
+        }
+        return THREAD_PRIORITY_ABOVE_NORMAL;
+    }();
+    if (!SetThreadPriority(GetCurrentThread(), priority))
+        return std::nullopt;
+    return std::min(qos, thread_qos::Interactive);
+#else
+    (void) qos;
+    return std::nullopt;
+#endif
+}
+
+std::optional<thread_qos> parse_thread_qos(std::string_view name) noexcept
+{
+    auto const equalsIgnoreCase = [](std::string_view a, std::string_view b) {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+    };
+    for (auto const& [qos, qosName]: Names)
+        if (equalsIgnoreCase(name, qosName))
+            return qos;
+    return std::nullopt;
+}
+
+std::string_view to_string(thread_qos qos) noexcept
+{
+    for (auto const& [value, name]: Names)
+        if (value == qos)
+            return name;
+    return "default";
+}
+
+} // namespace crispy
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+namespace crispy
+{
+
+/**
+ * Scheduling class of a thread, from the least to the most latency sensitive.
+ *
+ * The classes map onto the QoS classes on macOS, onto the scheduling policies and nice values
+ * on Linux, and onto the thread priorities and MMCSS (the Multimedia Class Scheduler Service) on Windows.
+ */
+enum class thread_qos
+{
+    Background,  // may be delayed arbitrarily while anything else wants to run, e.g. inactive sessions
+    Utility,     // throughput matters, latency does not, e.g. searching the scrollback
+    Default,     // what threads start with
+    Interactive, // the user is waiting for it, e.g. reading input and rendering
+    Realtime,    // Interactive, but scheduled real-time where the platform permits it to unprivileged users
+};
+
+/// Applies @p qos to the calling thread, replacing whatever class has been applied to it before.
+///
+/// Classes the platform does not permit to the process fall back to the nearest one below it,
+/// e.g. Realtime to Interactive if the real-time priority limit (RLIMIT_RTPRIO) of the process is 0.
+///
+/// @returns the class actually applied, or std::nullopt if the platform does not support any.
+std::optional<thread_qos> set_current_thread_qos(thread_qos qos) noexcept;
+
+/// @returns the class named @p name (case insensitive), e.g. "interactive".
+[[nodiscard]] std::optional<thread_qos> parse_thread_qos(std::string_view name) noexcept;
+
+[[nodiscard]] std::string_view to_string(thread_qos qos) noexcept;
+
+} // namespace crispy
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/thread_qos.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <optional>
+#include <thread>
+
+using crispy::thread_qos;
+
+TEST_CASE("thread_qos.parse")
+{
+    CHECK(crispy::parse_thread_qos("Interactive") == thread_qos::Interactive);
+    CHECK(crispy::parse_thread_qos("background") == thread_qos::Background);
+    CHECK(!crispy::parse_thread_qos("fast").has_value());
+    CHECK(crispy::parse_thread_qos(crispy::to_string(thread_qos::Realtime)) == thread_qos::Realtime);
+}
+
+TEST_CASE("thread_qos.demote_and_restore")
+{
+    // Threads demoted (e.g. for sessions in the background) can always be restored without privileges.
+    auto background = std::optional<thread_qos> {};
+    auto restored = std::optional<thread_qos> {};
+    auto realtime = std::optional<thread_qos> {};
+    std::thread([&]() {
+        background = crispy::set_current_thread_qos(thread_qos::Background);
+        restored = crispy::set_current_thread_qos(thread_qos::Default);
+        realtime = crispy::set_current_thread_qos(thread_qos::Realtime);
+    }).join();
+
+#if defined(__APPLE__) || defined(__linux__) || defined(_WIN32)
+    CHECK(background == thread_qos::Background);
+    CHECK(restored == thread_qos::Default);
+    CHECK(realtime.has_value());
+#endif
+}
@@ -0,0 +1,270 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/trace.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <optional>
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+namespace crispy
+{
+
+namespace
+{
+    /// Returns a small number identifying the calling thread, in order of first use.
+    uint64_t currentThreadId() noexcept
+    {
+        static auto nextThreadId = std::atomic<uint64_t> { 1 };
+        thread_local auto const threadId = nextThreadId.fetch_add(1);
+        return threadId;
+    }
+
+    void appendJsonString(std::string& output, std::string_view text)
+    {
+        output += '"';
+        for (char const ch: text)
+        {
+            switch (ch)
+            {
+                case '"': output += "\\\""; break;
+                case '\\': output += "\\\\"; break;
+                default:
+                    if (static_cast<unsigned char>(ch) < 0x20)
+                        output += fmt::format("\\u{:04x}", static_cast<unsigned>(ch));
+                    else
+                        output += ch;
+                    break;
+            }
+        }
+        output += '"';
+    }
+
+    /// Appends a complete ("X") event, or if @p duration is not given, an instant ("i") event.
+    void appendJsonEvent(std::string& output,
+                         std::string_view name,
+                         uint64_t threadId,
+                         trace_recorder::clock::duration start,
+                         std::optional<trace_recorder::clock::duration> duration)
+    {
+        output += "\n{\"name\":";
+        appendJsonString(output, name);
+        output += fmt::format(",\"ph\":\"{}\",\"ts\":{},\"pid\":1,\"tid\":{}",
+                              duration ? "X" : "i",
+                              duration_cast<microseconds>(start).count(),
+                              threadId);
+        if (duration)
+            output += fmt::format(",\"dur\":{}}}", duration_cast<microseconds>(*duration).count());
+        else
+            output += ",\"s\":\"p\"}";
+    }
+
+    bool writeFile(std::filesystem::path const& outputFile, std::string const& contents)
+    {
+        auto file = std::ofstream(outputFile, std::ios::binary | std::ios::trunc);
+        file << contents;
+        return file.good();
+    }
+} // namespace
+
+trace_recorder& trace_recorder::global()
+{
+    auto static instance = trace_recorder {};
+    return instance;
+}
+
+trace_recorder::~trace_recorder()
+{
+    (void) write();
+}
+
+void trace_recorder::enable(std::filesystem::path outputFile)
+{
+    auto const _ = std::lock_guard { _mutex };
+    _outputFile = std::move(outputFile);
+    _enabled.store(true, std::memory_order_relaxed);
+}
+
+void trace_recorder::record(std::string_view name, clock::time_point start, clock::time_point end)
+{
+    if (!enabled())
+        return;
+
+    auto const threadId = currentThreadId();
+    auto const _ = std::lock_guard { _mutex };
+    _events.emplace_back(event { std::string(name), threadId, start, end - start, false });
+}
+
+void trace_recorder::recordInstant(std::string_view name)
+{
+    if (!enabled())
+        return;
+
+    auto const now = clock::now();
+    auto const threadId = currentThreadId();
+    auto const _ = std::lock_guard { _mutex };
+    _events.emplace_back(event { std::string(name), threadId, now, clock::duration::zero(), true });
+}
+
+std::vector<trace_recorder::event> trace_recorder::events() const
+{
+    auto const _ = std::lock_guard { _mutex };
+    return _events;
+}
+
+std::string trace_recorder::toJson() const
+{
+    auto output = std::string { "{\"traceEvents\":[" };
+    auto first = true;
+    for (auto const& event: events())
+    {
+        if (!first)
+            output += ',';
+        first = false;
+        appendJsonEvent(output,
+                        event.name,
+                        event.threadId,
+                        event.start - _epoch,
+                        event.instant ? std::nullopt : std::optional { event.duration });
+    }
+    output += "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return output;
+}
+
+bool trace_recorder::write() const
+{
+    auto const outputFile = [this]() {
+        auto const _ = std::lock_guard { _mutex };
+        return _outputFile;
+    }();
+    if (!enabled() || outputFile.empty())
+        return false;
+
+    return writeFile(outputFile, toJson());
+}
+
+// {{{ flight_recorder
+namespace
+{
+    auto nextFlightRecorderId = std::atomic<uint64_t> { 1 };
+}
+
+/// Ring buffer of spans, written by a single thread and read by any.
+///
+/// Each slot is guarded by a sequence number, which is odd while the slot is being written.
+/// Readers skip slots that are being written or changed while they were read.
+/// All slot members are atomics, so that reading concurrently to writing is well defined.
+struct flight_recorder::ring
+{
+    struct slot
+    {
+        std::atomic<uint64_t> sequence = 0; // 0 if never written
+        std::atomic<char const*> name = nullptr;
+        std::atomic<size_t> nameLength = 0;
+        std::atomic<clock::rep> start = 0;
+        std::atomic<clock::rep> duration = 0;
+    };
+
+    uint64_t threadId;
+    uint64_t count = 0; // number of spans ever written, only accessed by the owning thread
+    std::array<slot, Capacity> slots {};
+};
+
+flight_recorder& flight_recorder::global()
+{
+    auto static instance = flight_recorder {};
+    return instance;
+}
+
+flight_recorder::flight_recorder(): _id { nextFlightRecorderId.fetch_add(1) }
+{
+}
+
+flight_recorder::~flight_recorder() = default;
+
+flight_recorder::ring& flight_recorder::ringOfCurrentThread() noexcept
+{
+    // Recorder IDs are never reused, so that entries of destroyed recorders can never match.
+    thread_local auto rings = std::vector<std::pair<uint64_t, ring*>> {};
+    for (auto const& [id, ring]: rings)
+        if (id == _id)
+            return *ring;
+
+    auto const _ = std::lock_guard { _mutex };
+    auto& ring = *_rings.emplace_back(std::make_unique<flight_recorder::ring>());
+    ring.threadId = currentThreadId();
+    rings.emplace_back(_id, &ring);
+    return ring;
+}
+
+void flight_recorder::record(std::string_view name, clock::time_point start, clock::time_point end) noexcept
+{
+    if (!enabled())
+        return;
+
+    auto& ring = ringOfCurrentThread();
+    auto& slot = ring.slots[ring.count % Capacity];
+    auto const sequence = 2 * ++ring.count;
+
+    slot.sequence.store(sequence - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name.data(), std::memory_order_relaxed);
+    slot.nameLength.store(name.size(), std::memory_order_relaxed);
+    slot.start.store((start - _epoch).count(), std::memory_order_relaxed);
+    slot.duration.store((end - start).count(), std::memory_order_relaxed);
+    slot.sequence.store(sequence, std::memory_order_release);
+}
+
+std::vector<flight_recorder::span> flight_recorder::spans() const
+{
+    auto result = std::vector<span> {};
+    auto const _ = std::lock_guard { _mutex };
+    for (auto const& ring: _rings)
+    {
+        for (auto const& slot: ring->slots)
+        {
+            auto const sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == 0 || sequence % 2 != 0)
+                continue;
+            auto const recorded = span {
+                std::string_view(slot.name.load(std::memory_order_relaxed),
+                                 slot.nameLength.load(std::memory_order_relaxed)),
+                ring->threadId,
+                _epoch + clock::duration(slot.start.load(std::memory_order_relaxed)),
+                clock::duration(slot.duration.load(std::memory_order_relaxed)),
+            };
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+                result.emplace_back(recorded);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](span const& a, span const& b) { return a.start < b.start; });
+    return result;
+}
+
+std::string flight_recorder::toJson() const
+{
+    auto output = std::string { "{\"traceEvents\":[" };
+    auto first = true;
+    for (auto const& span: spans())
+    {
+        if (!first)
+            output += ',';
+        first = false;
+        appendJsonEvent(output, span.name, span.threadId, span.start - _epoch, span.duration);
+    }
+    output += "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return output;
+}
+
+bool flight_recorder::dump(std::filesystem::path const& outputFile) const
+{
+    return writeFile(outputFile, toJson());
+}
+// }}}
+
+} // namespace crispy
@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace crispy
+{
+
+/**
+ * Records the durations of named phases, such as the steps of the application startup,
+ * along with the thread they ran on.
+ *
+ * The recorded phases are written in the Chrome trace event format,
+ * which can be viewed in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * A recorder does not record anything until it has been enabled, so that tracing costs
+ * next to nothing unless asked for.
+ */
+class trace_recorder
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    struct event
+    {
+        std::string name;
+        uint64_t threadId;        // small number identifying the recording thread within the process
+        clock::time_point start;
+        clock::duration duration; // zero for instant events
+        bool instant;
+    };
+
+    /// Returns the recorder shared by the whole process.
+    [[nodiscard]] static trace_recorder& global();
+
+    trace_recorder() = default;
+    ~trace_recorder();
+
+    trace_recorder(trace_recorder const&) = delete;
+    trace_recorder& operator=(trace_recorder const&) = delete;
+    trace_recorder(trace_recorder&&) = delete;
+    trace_recorder& operator=(trace_recorder&&) = delete;
+
+    /// Starts recording. The recorded events are written to @p outputFile on destruction.
+    void enable(std::filesystem::path outputFile);
+
+    [[nodiscard]] bool enabled() const noexcept { return _enabled.load(std::memory_order_relaxed); }
+
+    /// Records a phase that ran on the calling thread from @p start until @p end.
+    void record(std::string_view name, clock::time_point start, clock::time_point end);
+
+    /// Records a point in time on the calling thread, such as the first frame being shown.
+    void recordInstant(std::string_view name);
+
+    [[nodiscard]] std::vector<event> events() const;
+
+    /// Returns all recorded events as Chrome trace event JSON.
+    [[nodiscard]] std::string toJson() const;
+
+    /// Writes all recorded events to the output file.
+    ///
+    /// @retval false the recorder is not enabled or the file could not be written.
+    bool write() const;
+
+  private:
+    std::atomic<bool> _enabled = false;
+    clock::time_point const _epoch = clock::now(); // time stamps are written relative to this
+
+    mutable std::mutex _mutex; // guards the members below
+    std::filesystem::path _outputFile;
+    std::vector<event> _events;
+};
+
+/// Records the lifetime of this object as a phase, if the recorder is enabled.
+class trace_scope
+{
+  public:
+    /// @param name name of the phase, which must outlive this object, e.g. a string literal.
+    explicit trace_scope(std::string_view name, trace_recorder& recorder = trace_recorder::global()) noexcept:
+        _recorder { recorder.enabled() ? &recorder : nullptr }, _name { name }
+    {
+        if (_recorder)
+            _start = trace_recorder::clock::now();
+    }
+
+    ~trace_scope()
+    {
+        if (_recorder)
+            _recorder->record(_name, _start, trace_recorder::clock::now());
+    }
+
+    trace_scope(trace_scope const&) = delete;
+    trace_scope& operator=(trace_scope const&) = delete;
+    trace_scope(trace_scope&&) = delete;
+    trace_scope& operator=(trace_scope&&) = delete;
+
+  private:
+    trace_recorder* _recorder;
+    std::string_view _name;
+    trace_recorder::clock::time_point _start {};
+};
+
+/**
+ * Continuously records the spans of hot code paths, such as parsing and rendering,
+ * so that they can be inspected after an intermittent hitch has already happened.
+ *
+ * Each thread records into its own fixed size ring buffer without taking any lock,
+ * overwriting its oldest spans once the buffer is full.
+ * Only registering a thread's ring buffer, on the first span it records, takes a lock.
+ *
+ * A flight recorder does not record anything until it has been enabled,
+ * so that a disabled span costs a single relaxed atomic load.
+ */
+class flight_recorder
+{
+  public:
+    using clock = trace_recorder::clock;
+
+    /// Number of most recent spans kept per thread.
+    static constexpr size_t Capacity = 4096;
+
+    struct span
+    {
+        std::string_view name;
+        uint64_t threadId;
+        clock::time_point start;
+        clock::duration duration;
+    };
+
+    /// Returns the flight recorder shared by the whole process.
+    [[nodiscard]] static flight_recorder& global();
+
+    flight_recorder();
+    ~flight_recorder();
+
+    flight_recorder(flight_recorder const&) = delete;
+    flight_recorder& operator=(flight_recorder const&) = delete;
+    flight_recorder(flight_recorder&&) = delete;
+    flight_recorder& operator=(flight_recorder&&) = delete;
+
+    void setEnabled(bool enabled) noexcept { _enabled.store(enabled, std::memory_order_relaxed); }
+    [[nodiscard]] bool enabled() const noexcept { return _enabled.load(std::memory_order_relaxed); }
+
+    /// Records a span that ran on the calling thread from @p start until @p end.
+    ///
+    /// @param name name of the span, which must outlive the recorder, e.g. a string literal.
+    void record(std::string_view name, clock::time_point start, clock::time_point end) noexcept;
+
+    /// Returns a snapshot of the spans currently held by all ring buffers, ordered by their start.
+    ///
+    /// Spans may be recorded concurrently. Those overwritten while taking the snapshot are left out.
+    [[nodiscard]] std::vector<span> spans() const;
+
+    /// Returns the spans currently held as Chrome trace event JSON.
+    [[nodiscard]] std::string toJson() const;
+
+    /// Writes the spans currently held to @p outputFile, as Chrome trace event JSON.
+    bool dump(std::filesystem::path const& outputFile) const;
+
+  private:
+    struct ring;
+
+    ring& ringOfCurrentThread() noexcept;
+
+    uint64_t const _id; // identifies this recorder in the per-thread ring buffer lookup
+    std::atomic<bool> _enabled = false;
+    clock::time_point const _epoch = clock::now(); // time stamps are written relative to this
+
+    mutable std::mutex _mutex;                // guards registering ring buffers, not recording into them
+    std::vector<std::unique_ptr<ring>> _rings; // never shrinks, rings outlive their threads
+};
+
+/// Records the lifetime of this object as a span into the flight recorder, if it is enabled.
+class trace_span
+{
+  public:
+    /// @param name name of the span, which must outlive the recorder, e.g. a string literal.
+    explicit trace_span(std::string_view name,
+                        flight_recorder& recorder = flight_recorder::global()) noexcept:
+        _recorder { recorder.enabled() ? &recorder : nullptr }, _name { name }
+    {
+        if (_recorder)
+            _start = flight_recorder::clock::now();
+    }
+
+    ~trace_span()
+    {
+        if (_recorder)
+            _recorder->record(_name, _start, flight_recorder::clock::now());
+    }
+
+    trace_span(trace_span const&) = delete;
+    trace_span& operator=(trace_span const&) = delete;
+    trace_span(trace_span&&) = delete;
+    trace_span& operator=(trace_span&&) = delete;
+
+  private:
+    flight_recorder* _recorder;
+    std::string_view _name;
+    flight_recorder::clock::time_point _start {};
+};
+
+} // namespace crispy
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <crispy/trace.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+using crispy::flight_recorder;
+using crispy::trace_recorder;
+using crispy::trace_scope;
+using crispy::trace_span;
+
+TEST_CASE("trace_recorder.disabled")
+{
+    auto recorder = trace_recorder {};
+    {
+        auto const _ = trace_scope("phase", recorder);
+    }
+    recorder.recordInstant("instant");
+    CHECK(recorder.events().empty());
+    CHECK_FALSE(recorder.write());
+}
+
+TEST_CASE("trace_recorder.scope")
+{
+    auto const path = std::filesystem::temp_directory_path() / "crispy_trace_test.json";
+    auto recorder = trace_recorder {};
+    recorder.enable(path);
+
+    {
+        auto const _ = trace_scope("outer", recorder);
+        std::thread([&]() { auto const _ = trace_scope("worker", recorder); }).join();
+    }
+    recorder.recordInstant("first \"frame\"");
+
+    auto const events = recorder.events();
+    REQUIRE(events.size() == 3);
+    CHECK(events[0].name == "worker");
+    CHECK(events[1].name == "outer");
+    CHECK(events[0].threadId != events[1].threadId);
+    CHECK(events[1].start <= events[0].start);
+    CHECK(events[0].duration <= events[1].duration);
+    CHECK(events[2].instant);
+    CHECK(events[2].threadId == events[1].threadId);
+
+    auto const json = recorder.toJson();
+    CHECK(json.find(R"("name":"outer","ph":"X")") != std::string::npos);
+    CHECK(json.find(R"("name":"first \"frame\"","ph":"i")") != std::string::npos);
+
+    REQUIRE(recorder.write());
+    auto file = std::ifstream(path);
+    CHECK(std::string(std::istreambuf_iterator<char>(file), {}) == json);
+    file.close();
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("flight_recorder.disabled")
+{
+    auto recorder = flight_recorder {};
+    {
+        auto const _ = trace_span("span", recorder);
+    }
+    CHECK(recorder.spans().empty());
+}
+
+TEST_CASE("flight_recorder.wraps_around")
+{
+    auto recorder = flight_recorder {};
+    recorder.setEnabled(true);
+
+    auto const start = flight_recorder::clock::now();
+    for (auto i = 0u; i < flight_recorder::Capacity + 10; ++i)
+        recorder.record(i < 10 ? "old" : "new",
+                        start + std::chrono::microseconds(i),
+                        start + std::chrono::microseconds(i + 1));
+
+    auto const spans = recorder.spans();
+    REQUIRE(spans.size() == flight_recorder::Capacity);
+    CHECK(spans.front().name == "new");
+    CHECK(spans.front().start == start + std::chrono::microseconds(10));
+    CHECK(spans.back().duration == std::chrono::microseconds(1));
+
+    recorder.setEnabled(false);
+    recorder.record("ignored", start, start);
+    CHECK(recorder.spans().size() == flight_recorder::Capacity);
+}
+
+TEST_CASE("flight_recorder.threads")
+{
+    auto recorder = flight_recorder {};
+    recorder.setEnabled(true);
+
+    auto threads = std::vector<std::thread> {};
+    for (auto i = 0; i < 4; ++i)
+        threads.emplace_back([&]() {
+            for (auto k = 0; k < 1000; ++k)
+            {
+                auto const _ = trace_span("worker", recorder);
+            }
+        });
+    // Taking snapshots while the threads are recording must only ever yield complete spans.
+    for (auto i = 0; i < 10; ++i)
+        for (auto const& span: recorder.spans())
+            CHECK(span.name == "worker");
+    for (auto& thread: threads)
+        thread.join();
+
+    auto const spans = recorder.spans();
+    CHECK(spans.size() == 4000);
+    CHECK(recorder.toJson().find(R"("name":"worker","ph":"X")") != std::string::npos);
+}
@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <text_shaper/cached_font_locator.h>
+
+#include <crispy/FNV.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <system_error>
+
+using std::string;
+using std::string_view;
+
+namespace fs = std::filesystem;
+
+namespace text
+{
+
+namespace
+{
+    constexpr auto CacheFileHeader = string_view { "contour-font-cache 1" };
+
+    // Identifies the state of the given font directories by the modification times of them and of
+    // their subdirectories, which change whenever a font file is added to or removed from them.
+    string fingerprintOf(std::vector<fs::path> const& directories)
+    {
+        auto const hash = crispy::fnv<char> {};
+        auto memory = hash.basis();
+        auto const add = [&](fs::path const& path) {
+            auto ec = std::error_code {};
+            auto const modified = fs::last_write_time(path, ec);
+            auto const ticks = ec ? 0 : modified.time_since_epoch().count();
+            auto const entry = fmt::format("{} {}\n", path.string(), ticks);
+            memory = hash(memory, string_view { entry });
+        };
+
+        for (auto const& directory: directories)
+        {
+            add(directory);
+            auto ec = std::error_code {};
+            auto i = fs::recursive_directory_iterator(
+                directory, fs::directory_options::skip_permission_denied, ec);
+            for (; !ec && i != fs::recursive_directory_iterator(); i.increment(ec))
+                if (i->is_directory(ec))
+                    add(i->path());
+        }
+        return fmt::format("{:016x}", memory);
+    }
+
+    string keyOf(font_description const& description)
+    {
+        return fmt::format("{}\t{}\t{}\t{}\t{}",
+                           description.familyName,
+                           static_cast<int>(description.weight),
+                           static_cast<int>(description.slant),
+                           static_cast<int>(description.spacing),
+                           description.strictSpacing ? 1 : 0);
+    }
+
+    // Splits the given line into the given number of tab separated fields, the last one taking the rest.
+    std::vector<string_view> splitFields(string_view line, size_t count)
+    {
+        auto fields = std::vector<string_view> {};
+        while (fields.size() + 1 < count)
+        {
+            auto const tab = line.find('\t');
+            if (tab == string_view::npos)
+                break;
+            fields.push_back(line.substr(0, tab));
+            line.remove_prefix(tab + 1);
+        }
+        fields.push_back(line);
+        return fields;
+    }
+
+    template <typename T>
+    std::optional<T> parseInteger(string_view text)
+    {
+        auto value = T {};
+        auto const [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (ec != std::errc {} || end != text.data() + text.size())
+            return std::nullopt;
+        return value;
+    }
+
+    // Parses "<collection index>\t<weight or ->\t<slant or ->\t<path>".
+    std::optional<font_path> parseFontPath(string_view line)
+    {
+        auto const fields = splitFields(line, 4);
+        if (fields.size() != 4 || fields[3].empty())
+            return std::nullopt;
+
+        auto const collectionIndex = parseInteger<int>(fields[0]);
+        if (!collectionIndex)
+            return std::nullopt;
+
+        auto path = font_path { string { fields[3] }, *collectionIndex };
+        if (fields[1] != "-")
+        {
+            auto const weight = parseInteger<int>(fields[1]);
+            if (!weight)
+                return std::nullopt;
+            path.weight = static_cast<font_weight>(*weight);
+        }
+        if (fields[2] != "-")
+        {
+            auto const slant = parseInteger<int>(fields[2]);
+            if (!slant)
+                return std::nullopt;
+            path.slant = static_cast<font_slant>(*slant);
+        }
+        return path;
+    }
+
+    // Tests whether the given located fonts can be persisted, as fonts in memory cannot be.
+    bool persistable(string const& key, font_source_list const& sources)
+    {
+        return key.find('\n') == string::npos && std::ranges::all_of(sources, [](auto const& source) {
+                   auto const* path = std::get_if<font_path>(&source);
+                   return path && path->value.find('\n') == string::npos;
+               });
+    }
+} // namespace
+
+cached_font_locator::cached_font_locator(std::unique_ptr<font_locator> locator, fs::path cacheFile):
+    _locator { std::move(locator) }, _cacheFile { std::move(cacheFile) }
+{
+    if (_cacheFile.empty())
+        return;
+
+    auto const directories = _locator->font_directories();
+    if (directories.empty())
+        return;
+
+    _fingerprint = fingerprintOf(directories);
+    load();
+}
+
+font_source_list cached_font_locator::locate(font_description const& description)
+{
+    auto const key = keyOf(description);
+
+    auto const _ = std::lock_guard { _mutex };
+    if (auto const i = _located.find(key); i != _located.end())
+    {
+        locatorLog()("Using cached font chain for: {}", description);
+        return i->second;
+    }
+
+    auto sources = _locator->locate(description);
+    auto const persist = persistable(key, sources);
+    _located.emplace(key, sources);
+    if (persist)
+        save();
+    return sources;
+}
+
+void cached_font_locator::invalidate()
+{
+    auto const _ = std::lock_guard { _mutex };
+    locatorLog()("Fonts changed. Discarding {} cached font chains.", _located.size());
+    _located.clear();
+    auto ec = std::error_code {};
+    if (!_cacheFile.empty())
+        fs::remove(_cacheFile, ec);
+}
+
+void cached_font_locator::load()
+{
+    auto input = std::ifstream(_cacheFile);
+    if (!input.good())
+        return;
+
+    auto line = string {};
+    if (!std::getline(input, line) || line != CacheFileHeader)
+        return;
+    if (!std::getline(input, line) || line != "fingerprint " + _fingerprint)
+    {
+        locatorLog()("Font directories changed. Discarding font cache {}.", _cacheFile.string());
+        return;
+    }
+
+    // Entries are "locate <description key>", followed by one "font <font path>" line per font.
+    auto located = std::map<string, font_source_list> {};
+    auto* sources = static_cast<font_source_list*>(nullptr);
+    while (std::getline(input, line))
+    {
+        auto const text = string_view { line };
+        if (text.starts_with("locate "))
+            sources = &located[string { text.substr(7) }];
+        else if (auto const path = text.starts_with("font ") ? parseFontPath(text.substr(5)) : std::nullopt;
+                 path && sources)
+            sources->emplace_back(*path);
+        else
+        {
+            locatorLog()("Malformed font cache {}. Ignoring it.", _cacheFile.string());
+            return;
+        }
+    }
+
+    // Fonts removed without any directory being modified, e.g. on another volume, are located again.
+    std::erase_if(located, [](auto const& entry) {
+        return std::ranges::any_of(entry.second, [](auto const& source) {
+            auto ec = std::error_code {};
+            return !fs::exists(std::get<font_path>(source).value, ec);
+        });
+    });
+
+    locatorLog()("Loaded {} font chains from font cache {}.", located.size(), _cacheFile.string());
+    _located = std::move(located);
+}
+
+void cached_font_locator::save() const
+{
+    if (_fingerprint.empty())
+        return;
+
+    // Written to a temporary file first, such that concurrently starting instances never read half of it.
+    auto ec = std::error_code {};
+    fs::create_directories(_cacheFile.parent_path(), ec);
+    auto const temporaryFile = fs::path { _cacheFile.string() + ".tmp" };
+    {
+        auto output = std::ofstream(temporaryFile, std::ios::trunc);
+        output << CacheFileHeader << '\n' << "fingerprint " << _fingerprint << '\n';
+        for (auto const& [key, sources]: _located)
+        {
+            if (!persistable(key, sources))
+                continue;
+            output << "locate " << key << '\n';
+            for (auto const& source: sources)
+            {
+                auto const& path = std::get<font_path>(source);
+                output << fmt::format("font {}\t{}\t{}\t{}\n",
+                                      path.collectionIndex,
+                                      path.weight ? fmt::format("{}", static_cast<int>(*path.weight)) : "-",
+                                      path.slant ? fmt::format("{}", static_cast<int>(*path.slant)) : "-",
+                                      path.value);
+            }
+        }
+        if (!output.good())
+        {
+            locatorLog()("Failed to write font cache {}.", _cacheFile.string());
+            fs::remove(temporaryFile, ec);
+            return;
+        }
+    }
+    fs::rename(temporaryFile, _cacheFile, ec);
+}
+
+} // namespace text
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <text_shaper/font.h>
+#include <text_shaper/font_locator.h>
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace text
+{
+
+/**
+ * Font locator remembering the fonts located by another one, in memory and on disk.
+ *
+ * Locating fonts is slow on a cold start with all platform APIs, as they scan the installed fonts
+ * first, whereas the same few font descriptions are located with every start.
+ * Results are therefore persisted into a cache file, in the same format for all locators wrapped.
+ *
+ * The cache file is discarded as soon as any of the wrapped locator's font directories has been
+ * modified since it got written, i.e. when fonts have been installed or removed.
+ * Only located fonts are cached, whereas all() and resolve() are forwarded to the wrapped locator.
+ */
+class cached_font_locator: public font_locator
+{
+  public:
+    /// @param locator   the locator to cache the results of
+    /// @param cacheFile file to persist the results to, or an empty path to keep them in memory only
+    cached_font_locator(std::unique_ptr<font_locator> locator, std::filesystem::path cacheFile);
+
+    [[nodiscard]] font_source_list locate(font_description const& description) override;
+    [[nodiscard]] font_source_list all() override { return _locator->all(); }
+    [[nodiscard]] font_source_list resolve(gsl::span<const char32_t> codepoints) override
+    {
+        return _locator->resolve(codepoints);
+    }
+    [[nodiscard]] std::vector<std::filesystem::path> font_directories() const override
+    {
+        return _locator->font_directories();
+    }
+
+    /// Forgets all fonts located so far, e.g. when fonts have been (un)registered.
+    /// May be invoked from any thread.
+    void invalidate();
+
+  private:
+    void load();
+    void save() const;
+
+    std::unique_ptr<font_locator> _locator;
+    std::filesystem::path _cacheFile;
+    std::string _fingerprint; // of the font directories, empty if they are unknown
+
+    mutable std::mutex _mutex;
+    std::map<std::string, font_source_list> _located; // keyed by font description
+};
+
+} // namespace text
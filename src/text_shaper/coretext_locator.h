@@ -14,6 +14,7 @@ class coretext_locator: public font_locator
     [[nodiscard]] font_source_list locate(font_description const& description) override;
     [[nodiscard]] font_source_list all() override;
     [[nodiscard]] font_source_list resolve(gsl::span<const char32_t> codepoints) override;
+    [[nodiscard]] std::vector<std::filesystem::path> font_directories() const override;
 
   private:
     struct Private;
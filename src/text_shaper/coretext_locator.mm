@@ -141,4 +141,10 @@ namespace text
     {
         return {};
     }
+
+    std::vector<std::filesystem::path> coretext_locator::font_directories() const
+    {
+        auto const home = std::filesystem::path { [NSHomeDirectory() UTF8String] };
+        return { "/System/Library/Fonts", "/Library/Fonts", home / "Library/Fonts" };
+    }
 }
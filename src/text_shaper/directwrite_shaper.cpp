@@ -4,6 +4,7 @@
 
 #include <algorithm>
 #include <string>
+#include <unordered_map>
 
 // {{{ TODO: replace with libunicode
 #include <codecvt>
@@ -46,6 +47,17 @@ namespace
         const auto width = _textureBounds.right - _textureBounds.left;
         const auto height = _textureBounds.bottom - _textureBounds.top;
 
+        if (_targetFormat == bitmap_format::rgb)
+        {
+            // The ClearType texture already is RGB, hence written into the output as is.
+            auto const size = static_cast<UINT32>(height * width * 3);
+            if (size != 0)
+                _glyphAnalysis->CreateAlphaTexture(
+                    DWRITE_TEXTURE_CLEARTYPE_3x1, &_textureBounds, &*_it, size);
+            _it += size;
+            return;
+        }
+
         std::vector<uint8_t> tmp;
         tmp.resize(height * width * 3);
 
@@ -98,6 +110,13 @@ namespace
     {
         return pt * (96.0 / 72.0);
     }
+
+    // Tests whether the script analysis of a run in the given script depends on the run's text.
+    constexpr bool isContextualScript(unicode::Script script) noexcept
+    {
+        using unicode::Script;
+        return script == Script::Common || script == Script::Inherited || script == Script::Unknown;
+    }
 } // namespace
 
 struct DxFontInfo
@@ -109,6 +128,13 @@ struct DxFontInfo
 
     // Owning pointer
     IDWriteFontFace5* fontFace;
+
+    // The font file and description the font has been requested with, to not load it again.
+    std::string sourcePath;
+    font_description requestedDescription;
+
+    // Rendering mode recommended for the font's size, determined on first rasterization.
+    optional<DWRITE_RENDERING_MODE> renderingMode;
 };
 
 struct directwrite_shaper::Private
@@ -122,6 +148,12 @@ struct directwrite_shaper::Private
     std::unordered_map<font_key, DxFontInfo> fonts;
     std::unordered_map<font_key, bool> fontsHasColor;
 
+    // Script analyses of runs in a script other than a contextual one (see isContextualScript()),
+    // as these are the same for every run in that script.
+    std::unordered_map<unicode::Script, DWRITE_SCRIPT_ANALYSIS> scriptAnalyses;
+
+    ComPtr<IDWriteRenderingParams> renderingParams;
+
     font_key nextFontKey;
 
     Private(DPI dpi, font_locator& _locator): dpi_ { dpi }, locator_ { &_locator }
@@ -132,6 +164,7 @@ struct directwrite_shaper::Private
         ComPtr<IDWriteTextAnalyzer> analyzer;
         hr = factory->CreateTextAnalyzer(&analyzer);
         analyzer.As(&textAnalyzer);
+        factory->CreateRenderingParams(&renderingParams);
 
         wchar_t locale[LOCALE_NAME_MAX_LENGTH];
         GetUserDefaultLocaleName(locale, sizeof(locale));
@@ -156,6 +189,12 @@ struct directwrite_shaper::Private
 
         auto const& sourcePath = std::get<font_path>(_source);
 
+        // Fallback fonts are requested again whenever text is shaped that the primary font lacks glyphs for.
+        for (auto&& [fontKey, fontInfo]: fonts)
+            if (fontInfo.sourcePath == sourcePath.value && fontInfo.size.pt == _size.pt
+                && fontInfo.requestedDescription == _description)
+                return fontKey;
+
         std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> wStringConverter;
         std::wstring wSourcePath = wStringConverter.from_bytes(sourcePath.value);
 
@@ -231,6 +270,9 @@ struct directwrite_shaper::Private
         fontInfo.description.familyName = wStringConverter.to_bytes(resolvedFamilyName);
         fontInfo.description.wFamilyName = resolvedFamilyName;
         fontInfo.size = _size;
+        fontInfo.fontUnitsPerEm = dwMetrics.designUnitsPerEm;
+        fontInfo.sourcePath = sourcePath.value;
+        fontInfo.requestedDescription = _description;
         fontInfo.metrics.lineHeight = int(ceil(lineHeight * dipScalar));
         fontInfo.metrics.ascender = int(ceil(dwMetrics.ascent * dipScalar));
         fontInfo.metrics.descender = int(ceil(dwMetrics.descent * dipScalar));
@@ -310,8 +352,8 @@ void directwrite_shaper::shape(font_key _font,
 
     WCHAR const* textString = wText.c_str();
     UINT32 textLength = wText.size();
-    DxFontInfo fontInfo = d->fonts.at(_font);
-    IDWriteFontFace5* fontFace = fontInfo.fontFace;
+    DxFontInfo const* fontInfo = &d->fonts.at(_font);
+    IDWriteFontFace5* fontFace = fontInfo->fontFace;
 
     vector<UINT16> glyphIndices;
     vector<INT32> glyphDesignUnitAdvances;
@@ -335,21 +377,18 @@ void directwrite_shaper::shape(font_key _font,
         // "Simple" shaping assumes every character has the exact same width which can be calculate from the
         // metrics.
         //  This saves us from the need of expensive shaping operation.
-        DWRITE_FONT_METRICS1 metrics {};
-        fontFace->GetMetrics(&metrics);
-
         glyphDesignUnitAdvances.resize(textLength);
-        USHORT designUnitsPerEm = metrics.designUnitsPerEm;
+        auto const designUnitsPerEm = fontInfo->fontUnitsPerEm;
         fontFace->GetDesignGlyphAdvances(
             textLength, &glyphIndices.at(glyphStart), &glyphDesignUnitAdvances.at(glyphStart), false);
 
         for (size_t i = glyphStart; i < textLength; i++)
         {
             const auto cellWidth = static_cast<double>((float) glyphDesignUnitAdvances.at(i))
-                                   / designUnitsPerEm * ptToEm(fontInfo.size.pt) * d->pixelPerDip();
+                                   / designUnitsPerEm * ptToEm(fontInfo->size.pt) * d->pixelPerDip();
             glyph_position gpos {};
             gpos.presentation = _presentation;
-            gpos.glyph = glyph_key { fontInfo.size, _font, glyph_index { glyphIndices.at(i) } };
+            gpos.glyph = glyph_key { fontInfo->size, _font, glyph_index { glyphIndices.at(i) } };
             gpos.advance.x = static_cast<int>(cellWidth);
             _result.emplace_back(gpos);
         }
@@ -361,7 +400,14 @@ void directwrite_shaper::shape(font_key _font,
         dwrite_analysis_wrapper analysisWrapper(wText, d->userLocale);
 
         // Script analysis
-        d->textAnalyzer->AnalyzeScript(&analysisWrapper, 0, wText.size(), &analysisWrapper);
+        if (auto const i = d->scriptAnalyses.find(_script); i != d->scriptAnalyses.end())
+            analysisWrapper.script = i->second;
+        else
+        {
+            d->textAnalyzer->AnalyzeScript(&analysisWrapper, 0, wText.size(), &analysisWrapper);
+            if (!isContextualScript(_script))
+                d->scriptAnalyses.emplace(_script, analysisWrapper.script);
+        }
 
         UINT32 actualGlyphCount = 0;
         UINT32 maxGlyphCount = textLength;
@@ -399,12 +445,12 @@ void directwrite_shaper::shape(font_key _font,
                 if (sources.size() > 0)
                 {
                     optional<font_key> fontKeyOpt =
-                        d->add_font(sources[0], fontInfo.description, fontInfo.size);
+                        d->add_font(sources[0], fontInfo->description, fontInfo->size);
                     if (fontKeyOpt.has_value())
                     {
                         _font = fontKeyOpt.value();
-                        fontInfo = d->fonts.at(_font);
-                        fontFace = fontInfo.fontFace;
+                        fontInfo = &d->fonts.at(_font);
+                        fontFace = fontInfo->fontFace;
                     }
                 }
                 continue;
@@ -435,7 +481,7 @@ void directwrite_shaper::shape(font_key _font,
                                                       &glyphProps.at(0),
                                                       actualGlyphCount,
                                                       fontFace,
-                                                      fontInfo.size.pt,
+                                                      fontInfo->size.pt,
                                                       0, // isSideways,
                                                       0, // isRightToLeft
                                                       &analysisWrapper.script,
@@ -449,7 +495,7 @@ void directwrite_shaper::shape(font_key _font,
         for (size_t i = glyphStart; i < actualGlyphCount; i++)
         {
             glyph_position gpos {};
-            gpos.glyph = glyph_key { fontInfo.size, _font, glyph_index { glyphIndices.at(i) } };
+            gpos.glyph = glyph_key { fontInfo->size, _font, glyph_index { glyphIndices.at(i) } };
             gpos.offset.x = static_cast<int>(glyphOffsets.at(i).advanceOffset);
             // gpos.offset.y = static_cast<int>(static_cast<double>(pos[i].y_offset) / 64.0f);
 
@@ -462,7 +508,7 @@ void directwrite_shaper::shape(font_key _font,
 
 std::optional<rasterized_glyph> directwrite_shaper::rasterize(glyph_key _glyph, render_mode _mode)
 {
-    DxFontInfo const& fontInfo = d->fonts.at(_glyph.font);
+    DxFontInfo& fontInfo = d->fonts.at(_glyph.font);
     IDWriteFontFace5* fontFace = fontInfo.fontFace;
     float const fontEmSize = ptToEm(_glyph.size.pt);
 
@@ -480,19 +526,25 @@ std::optional<rasterized_glyph> directwrite_shaper::rasterize(glyph_key _glyph,
     glyphRun.isSideways = false;
     glyphRun.bidiLevel = 0;
 
-    ComPtr<IDWriteRenderingParams> renderingParams;
-    d->factory->CreateRenderingParams(&renderingParams);
-
-    DWRITE_RENDERING_MODE renderingMode;
-    auto hr = fontFace->GetRecommendedRenderingMode(fontEmSize,
-                                                    d->pixelPerDip(),
-                                                    DWRITE_MEASURING_MODE::DWRITE_MEASURING_MODE_NATURAL,
-                                                    renderingParams.Get(),
-                                                    &renderingMode);
-    if (FAILED(hr))
-    {
-        renderingMode = DWRITE_RENDERING_MODE_NATURAL_SYMMETRIC;
-    }
+    auto const recommendedRenderingMode = [&]() {
+        DWRITE_RENDERING_MODE renderingMode;
+        auto hr = fontFace->GetRecommendedRenderingMode(fontEmSize,
+                                                        d->pixelPerDip(),
+                                                        DWRITE_MEASURING_MODE::DWRITE_MEASURING_MODE_NATURAL,
+                                                        d->renderingParams.Get(),
+                                                        &renderingMode);
+        if (FAILED(hr))
+        {
+            renderingMode = DWRITE_RENDERING_MODE_NATURAL_SYMMETRIC;
+        }
+        return renderingMode;
+    };
+
+    // Glyphs are rasterized at the font's own size, unless scaled, hence its mode is worth keeping.
+    auto const atFontSize = _glyph.size.pt == fontInfo.size.pt;
+    if (atFontSize && !fontInfo.renderingMode)
+        fontInfo.renderingMode = recommendedRenderingMode();
+    auto const renderingMode = atFontSize ? *fontInfo.renderingMode : recommendedRenderingMode();
 
     ComPtr<IDWriteGlyphRunAnalysis> glyphAnalysis;
     rasterized_glyph output {};
@@ -516,71 +568,67 @@ std::optional<rasterized_glyph> directwrite_shaper::rasterize(glyph_key _glyph,
 
     auto const [width, height] = output.bitmapSize;
 
-    IDWriteFactory2* factory2;
-    IDWriteColorGlyphRunEnumerator* glyphRunEnumerator;
-    if (SUCCEEDED(d->factory->QueryInterface(IID_PPV_ARGS(&factory2))))
+    // IDWriteFactory7 derives from IDWriteFactory2, which is what translates color glyph runs.
+    ComPtr<IDWriteColorGlyphRunEnumerator> glyphRunEnumerator;
+    auto hr = d->factory->TranslateColorGlyphRun(0.0f,
+                                                 0.0f,
+                                                 &glyphRun,
+                                                 nullptr,
+                                                 DWRITE_MEASURING_MODE::DWRITE_MEASURING_MODE_NATURAL,
+                                                 nullptr,
+                                                 0,
+                                                 &glyphRunEnumerator);
+
+    if (hr == DWRITE_E_NOCOLOR)
     {
-        hr = factory2->TranslateColorGlyphRun(0.0f,
-                                              0.0f,
-                                              &glyphRun,
-                                              nullptr,
-                                              DWRITE_MEASURING_MODE::DWRITE_MEASURING_MODE_NATURAL,
-                                              nullptr,
-                                              0,
-                                              &glyphRunEnumerator);
-
-        if (hr == DWRITE_E_NOCOLOR)
-        {
-            output.bitmap.resize(*height * *width * 3);
-            output.format = bitmap_format::rgb;
+        output.bitmap.resize(*height * *width * 3);
+        output.format = bitmap_format::rgb;
 
-            auto t = output.bitmap.begin();
+        auto t = output.bitmap.begin();
 
-            renderGlyphRunToBitmap(glyphAnalysis.Get(), textureBounds, DWRITE_COLOR_F {}, output.format, t);
+        renderGlyphRunToBitmap(glyphAnalysis.Get(), textureBounds, DWRITE_COLOR_F {}, output.format, t);
 
-            return output;
-        }
-        else
-        {
-            output.bitmap.resize(*height * *width * 4);
-            output.format = bitmap_format::rgba;
-
-            d->fontsHasColor.at(_glyph.font) = true;
-            while (true)
-            {
-                BOOL haveRun;
-                glyphRunEnumerator->MoveNext(&haveRun);
-                if (!haveRun)
-                    break;
-
-                DWRITE_COLOR_GLYPH_RUN const* colorRun;
-                hr = glyphRunEnumerator->GetCurrentRun(&colorRun);
-                if (FAILED(hr))
-                {
-                    break;
-                }
+        return output;
+    }
 
-                ComPtr<IDWriteGlyphRunAnalysis> colorGlyphsAnalysis;
+    if (FAILED(hr))
+        return nullopt;
 
-                d->factory->CreateGlyphRunAnalysis(&colorRun->glyphRun,
-                                                   d->pixelPerDip(),
-                                                   nullptr,
-                                                   renderingMode,
-                                                   DWRITE_MEASURING_MODE::DWRITE_MEASURING_MODE_NATURAL,
-                                                   0.0f,
-                                                   0.0f,
-                                                   &colorGlyphsAnalysis);
+    output.bitmap.resize(*height * *width * 4);
+    output.format = bitmap_format::rgba;
 
-                auto t = output.bitmap.begin();
-                auto const color = colorRun->paletteIndex == 0xFFFF ? DWRITE_COLOR_F {} : colorRun->runColor;
-                renderGlyphRunToBitmap(colorGlyphsAnalysis.Get(), textureBounds, color, output.format, t);
-            }
+    d->fontsHasColor.at(_glyph.font) = true;
+    while (true)
+    {
+        BOOL haveRun;
+        glyphRunEnumerator->MoveNext(&haveRun);
+        if (!haveRun)
+            break;
 
-            return output;
+        DWRITE_COLOR_GLYPH_RUN const* colorRun;
+        hr = glyphRunEnumerator->GetCurrentRun(&colorRun);
+        if (FAILED(hr))
+        {
+            break;
         }
+
+        ComPtr<IDWriteGlyphRunAnalysis> colorGlyphsAnalysis;
+
+        d->factory->CreateGlyphRunAnalysis(&colorRun->glyphRun,
+                                           d->pixelPerDip(),
+                                           nullptr,
+                                           renderingMode,
+                                           DWRITE_MEASURING_MODE::DWRITE_MEASURING_MODE_NATURAL,
+                                           0.0f,
+                                           0.0f,
+                                           &colorGlyphsAnalysis);
+
+        auto t = output.bitmap.begin();
+        auto const color = colorRun->paletteIndex == 0xFFFF ? DWRITE_COLOR_F {} : colorRun->runColor;
+        renderGlyphRunToBitmap(colorGlyphsAnalysis.Get(), textureBounds, color, output.format, t);
     }
 
-    return nullopt;
+    return output;
 }
 
 void directwrite_shaper::set_dpi(DPI dpi)
@@ -596,7 +644,10 @@ void directwrite_shaper::set_locator(font_locator& _locator)
 
 void directwrite_shaper::clear_cache()
 {
-    // TODO: clear the cache
+    // Recommended rendering modes depend on the DPI.
+    for (auto&& [fontKey, fontInfo]: d->fonts)
+        fontInfo.renderingMode.reset();
+    d->scriptAnalyses.clear();
 }
 
 optional<glyph_position> directwrite_shaper::shape(font_key _font, char32_t _codepoint)
@@ -279,7 +279,8 @@ enum class render_mode
     gray,   //!< gray-scale anti-aliasing
     light,  //!< gray-scale anti-aliasing for optimized for LCD screens
     lcd,    //!< LCD-optimized anti-aliasing
-    color   //!< embedded color bitmaps are preferred
+    color,  //!< embedded color bitmaps are preferred
+    sdf,    //!< signed distance fields, anti-aliased by the shader at any scale
 };
 // NOLINTEND(readability-identifier-naming)
 
@@ -499,6 +500,7 @@ struct fmt::formatter<text::render_mode>: fmt::formatter<std::string_view>
             case text::render_mode::light: name = "Light"; break;
             case text::render_mode::lcd: name = "LCD"; break;
             case text::render_mode::color: name = "Color"; break;
+            case text::render_mode::sdf: name = "SDF"; break;
         }
         return fmt::formatter<string_view>::format(name, ctx);
     }
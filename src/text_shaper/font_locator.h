@@ -8,6 +8,7 @@
 #include <gsl/span>
 #include <gsl/span_ext>
 
+#include <filesystem>
 #include <optional>
 #include <variant>
 #include <vector>
@@ -69,6 +70,12 @@ class font_locator
      * codepoint sequence.
      */
     [[nodiscard]] virtual font_source_list resolve(gsl::span<const char32_t> codepoints) = 0;
+
+    /**
+     * Returns the directories the fonts located are installed in, as far as known,
+     * such that located fonts can be cached for as long as these remain unmodified.
+     */
+    [[nodiscard]] virtual std::vector<std::filesystem::path> font_directories() const { return {}; }
 };
 
 } // namespace text
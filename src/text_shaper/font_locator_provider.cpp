@@ -7,22 +7,66 @@
 
 #include <memory>
 
+#if defined(__APPLE__)
+    #include <CoreFoundation/CoreFoundation.h>
+    #include <CoreText/CoreText.h>
+#endif
+
 namespace text
 {
 
 using std::make_unique;
 
+namespace
+{
+    // Returns the file to persist the fonts located by the given locator in, if any.
+    std::filesystem::path cacheFileOf(std::filesystem::path const& directory, char const* locator)
+    {
+        return directory.empty() ? directory : directory / (std::string(locator) + ".cache");
+    }
+
+#if defined(__APPLE__)
+    void onRegisteredFontsChanged(CFNotificationCenterRef /*center*/,
+                                  void* observer,
+                                  CFNotificationName /*name*/,
+                                  void const* /*object*/,
+                                  CFDictionaryRef /*userInfo*/)
+    {
+        static_cast<cached_font_locator*>(observer)->invalidate();
+    }
+#endif
+} // namespace
+
 font_locator_provider& font_locator_provider::get()
 {
     auto static instance = font_locator_provider {};
     return instance;
 }
 
+font_locator_provider::~font_locator_provider()
+{
+#if defined(__APPLE__)
+    if (_coretext)
+        CFNotificationCenterRemoveEveryObserver(CFNotificationCenterGetLocalCenter(), _coretext.get());
+#endif
+}
+
 #if defined(__APPLE__)
 font_locator& font_locator_provider::coretext()
 {
     if (!_coretext)
-        _coretext = make_unique<coretext_locator>();
+    {
+        _coretext = make_unique<cached_font_locator>(make_unique<coretext_locator>(),
+                                                     cacheFileOf(_cacheDirectory, "coretext"));
+
+        // Fonts (un)registered while running, e.g. by a font manager, are not located from the cache.
+        CFNotificationCenterAddObserver(CFNotificationCenterGetLocalCenter(),
+                                        _coretext.get(),
+                                        &onRegisteredFontsChanged,
+                                        kCTFontManagerRegisteredFontsChangedNotification,
+                                        nullptr,
+                                        CFNotificationSuspensionBehaviorDeliverImmediately);
+    }
 
     return *_coretext;
 }
@@ -41,7 +85,8 @@ font_locator& font_locator_provider::directwrite()
 font_locator& font_locator_provider::fontconfig()
 {
     if (!_fontconfig)
-        _fontconfig = make_unique<fontconfig_locator>();
+        _fontconfig = make_unique<cached_font_locator>(make_unique<fontconfig_locator>(),
+                                                       cacheFileOf(_cacheDirectory, "fontconfig"));
 
     return *_fontconfig;
 }
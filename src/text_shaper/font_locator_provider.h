@@ -1,8 +1,10 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
 
+#include <text_shaper/cached_font_locator.h>
 #include <text_shaper/font_locator.h>
 
+#include <filesystem>
 #include <memory>
 
 namespace text
@@ -13,6 +15,11 @@ class font_locator_provider
   public:
     static font_locator_provider& get();
 
+    ~font_locator_provider();
+
+    /// Sets the directory to persist located fonts in, to be invoked before any locator is used.
+    void set_cache_directory(std::filesystem::path directory) { _cacheDirectory = std::move(directory); }
+
 #if defined(__APPLE__)
     font_locator& coretext();
 #endif
@@ -25,15 +32,17 @@ class font_locator_provider
     font_locator& mock();
 
   private:
+    std::filesystem::path _cacheDirectory;
+
 #if defined(__APPLE__)
-    std::unique_ptr<font_locator> _coretext {};
+    std::unique_ptr<cached_font_locator> _coretext {};
 #endif
 
 #if defined(_WIN32)
     std::unique_ptr<font_locator> _directwrite {};
 #endif
 
-    std::unique_ptr<font_locator> _fontconfig {};
+    std::unique_ptr<cached_font_locator> _fontconfig {};
     std::unique_ptr<font_locator> _mock {};
 };
 
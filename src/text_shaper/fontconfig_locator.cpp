@@ -3,11 +3,14 @@
 #include <text_shaper/fontconfig_locator.h>
 
 #include <crispy/assert.h>
+#include <crispy/trace.h>
 
 #include <range/v3/view/iota.hpp>
 
 #include <fontconfig/fontconfig.h>
 
+#include <cstdlib>
+#include <future>
 #include <string_view>
 
 using std::nullopt;
@@ -129,21 +132,29 @@ namespace
 
 struct fontconfig_locator::Private
 {
-    // currently empty, maybe later something (such as caching)?
-    FcConfig* ftConfig = nullptr;
-
-    Private()
+    // Loading the configuration scans all installed fonts, which is slow on a cold start.
+    // It therefore runs on a background thread until a font is first located,
+    // e.g. while the shell is being started.
+    std::shared_future<FcConfig*> loadedConfig;
+
+    Private():
+        loadedConfig { std::async(std::launch::async, []() {
+                           auto const _ = crispy::trace_scope("fontconfig.loadConfigAndFonts");
+                           FcInit();
+                           return FcInitLoadConfigAndFonts(); // Most convenient of all the alternatives
+                       }).share() }
     {
-        FcInit();
-        ftConfig = FcInitLoadConfigAndFonts(); // Most convenient of all the alternatives
     }
 
     ~Private()
     {
         locatorLog()("~fontconfig_locator.dtor");
-        FcConfigDestroy(ftConfig);
+        FcConfigDestroy(ftConfig());
         FcFini();
     }
+
+    /// Returns the configuration, waiting for it to be loaded if necessary.
+    [[nodiscard]] FcConfig* ftConfig() const { return loadedConfig.get(); }
 };
 
 fontconfig_locator::fontconfig_locator():
@@ -195,12 +206,12 @@ font_source_list fontconfig_locator::locate(font_description const& description)
     if (description.slant != font_slant::normal)
         FcPatternAddInteger(pat.get(), FC_SLANT, fcSlant(description.slant));
 
-    FcConfigSubstitute(_d->ftConfig, pat.get(), FcMatchPattern);
+    FcConfigSubstitute(_d->ftConfig(), pat.get(), FcMatchPattern);
     FcDefaultSubstitute(pat.get());
 
     FcResult result = FcResultNoMatch;
     auto fs = unique_ptr<FcFontSet, void (*)(FcFontSet*)>(
-        FcFontSort(_d->ftConfig, pat.get(), /*unicode-trim*/ FcTrue, /*FcCharSet***/ nullptr, &result),
+        FcFontSort(_d->ftConfig(), pat.get(), /*unicode-trim*/ FcTrue, /*FcCharSet***/ nullptr, &result),
         [](auto p) { FcFontSetDestroy(p); });
 
     if (!fs || result != FcResultMatch)
@@ -330,7 +341,7 @@ font_source_list fontconfig_locator::all()
         FC_WEIGHT,
         FC_WIDTH,
         NULL);
-    FcFontSet* fs = FcFontList(_d->ftConfig, pat, os);
+    FcFontSet* fs = FcFontList(_d->ftConfig(), pat, os);
 
     font_source_list output;
 
@@ -373,4 +384,36 @@ font_source_list fontconfig_locator::resolve(gsl::span<const char32_t> /*codepoi
     return {}; // TODO
 }
 
+std::vector<std::filesystem::path> fontconfig_locator::font_directories() const
+{
+#if defined(_WIN32)
+    return {}; // fontconfig is configured by the package manager it is installed with
+#else
+    // The default directories are listed rather than asked for, as fontconfig would first need
+    // to finish loading its configuration, which is what caching located fonts is meant to avoid.
+    auto const env = [](char const* name) -> std::filesystem::path {
+        auto const* value = std::getenv(name);
+        return value ? value : "";
+    };
+    auto const home = env("HOME");
+    if (home.empty())
+        return {};
+
+    #if defined(__APPLE__)
+    return { "/System/Library/Fonts", "/Library/Fonts", home / "Library/Fonts" };
+    #else
+    auto const dataHome = !env("XDG_DATA_HOME").empty() ? env("XDG_DATA_HOME") : home / ".local/share";
+    auto const configHome = !env("XDG_CONFIG_HOME").empty() ? env("XDG_CONFIG_HOME") : home / ".config";
+    return {
+        "/usr/share/fonts",
+        "/usr/local/share/fonts",
+        dataHome / "fonts",
+        home / ".fonts",
+        "/etc/fonts", // the configuration, e.g. aliases and rejected fonts
+        configHome / "fontconfig",
+    };
+    #endif
+#endif
+}
+
 } // namespace text
@@ -0,0 +1,233 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <text_shaper/glyph_cache.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <system_error>
+
+#if !defined(_WIN32)
+    #include <pwd.h>
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+using std::nullopt;
+using std::optional;
+
+namespace text
+{
+
+namespace
+{
+    constexpr auto FileMagic = std::array<uint8_t, 4> { 'C', 'G', 'C', 1 }; // bump on format changes
+
+    constexpr auto FileHeaderSize = FileMagic.size() + sizeof(crispy::strong_hash);
+
+    // Number of bytes of new glyphs after which they are written to disk without waiting for flush().
+    constexpr auto FlushThreshold = size_t { 256 * 1024 };
+
+    // Precedes the bitmap of each glyph in the cache file.
+    struct record_header
+    {
+        uint32_t index;
+        uint32_t width;
+        uint32_t height;
+        int32_t x;
+        int32_t y;
+        uint32_t format;
+        uint32_t bitmapSize;
+    };
+
+    template <typename T>
+    void append(std::vector<uint8_t>& output, T const& value)
+    {
+        auto const* bytes = reinterpret_cast<uint8_t const*>(&value);
+        output.insert(output.end(), bytes, bytes + sizeof(T));
+    }
+
+    std::vector<uint8_t> createFileHeader(crispy::strong_hash const& key)
+    {
+        auto header = std::vector<uint8_t>(FileMagic.begin(), FileMagic.end());
+        append(header, key);
+        return header;
+    }
+
+    constexpr bool isValidFormat(uint32_t format) noexcept
+    {
+        return format <= static_cast<uint32_t>(bitmap_format::distance_field);
+    }
+} // namespace
+
+glyph_cache::glyph_cache(fs::path directory, crispy::strong_hash key):
+    _path { std::move(directory) / (crispy::to_string(key) + ".glyphs") }, _key { key }
+{
+    load();
+}
+
+glyph_cache::~glyph_cache()
+{
+    flushLocked();
+}
+
+std::shared_ptr<glyph_cache> glyph_cache::open(fs::path const& directory, crispy::strong_hash key)
+{
+    static auto mutex = std::mutex {};
+    static auto caches = std::map<fs::path, std::weak_ptr<glyph_cache>> {};
+
+    auto const _ = std::lock_guard { mutex };
+    std::erase_if(caches, [](auto const& entry) { return entry.second.expired(); });
+
+    auto& cache = caches[directory / (crispy::to_string(key) + ".glyphs")];
+    if (auto shared = cache.lock())
+        return shared;
+
+    auto shared = std::make_shared<glyph_cache>(directory, key);
+    cache = shared;
+    return shared;
+}
+
+fs::path glyph_cache::default_directory()
+{
+    auto const cacheHome = []() -> fs::path {
+        if (auto const* p = getenv("XDG_CACHE_HOME"); p && *p)
+            return fs::path(p);
+#if defined(_WIN32)
+        if (auto const* p = getenv("LOCALAPPDATA"); p && *p)
+            return fs::path(p);
+#else
+        if (passwd const* pw = getpwuid(getuid()); pw && pw->pw_dir)
+            return fs::path(pw->pw_dir) / ".cache";
+#endif
+        return fs::temp_directory_path();
+    }();
+
+    return cacheHome / "contour" / "glyphs";
+}
+
+void glyph_cache::load()
+{
+    _data = createFileHeader(_key);
+    _flushedSize = 0;
+    _offsets.clear();
+
+    auto file = std::ifstream(_path, std::ios::binary);
+    if (!file.good())
+        return;
+
+    auto contents = std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {});
+    if (contents.size() < FileHeaderSize || !std::equal(_data.begin(), _data.end(), contents.begin()))
+    {
+        rasterizerLog()("Ignoring invalid glyph cache file {}.", _path.string());
+        return;
+    }
+
+    // Index all complete records. A partially written trailing record is dropped.
+    auto offset = FileHeaderSize;
+    while (offset + sizeof(record_header) <= contents.size())
+    {
+        auto record = record_header {};
+        std::memcpy(&record, contents.data() + offset, sizeof(record));
+        auto const end = offset + sizeof(record_header) + record.bitmapSize;
+        auto const expectedBitmapSize = uint64_t { pixel_size(static_cast<bitmap_format>(record.format)) }
+                                        * record.width * record.height;
+        if (!isValidFormat(record.format) || record.bitmapSize != expectedBitmapSize
+            || end > contents.size())
+            break;
+        _offsets[record.index] = offset;
+        offset = end;
+    }
+
+    contents.resize(offset);
+    _data = std::move(contents);
+    _flushedSize = _data.size();
+
+    rasterizerLog()("Loaded {} glyphs from glyph cache file {}.", _offsets.size(), _path.string());
+}
+
+size_t glyph_cache::size() const
+{
+    auto const _ = std::lock_guard { _mutex };
+    return _offsets.size();
+}
+
+optional<rasterized_glyph> glyph_cache::get(glyph_index index) const
+{
+    auto const _ = std::lock_guard { _mutex };
+    auto const i = _offsets.find(index.value);
+    if (i == _offsets.end())
+        return nullopt;
+
+    auto record = record_header {};
+    std::memcpy(&record, _data.data() + i->second, sizeof(record));
+    auto const* bitmap = _data.data() + i->second + sizeof(record);
+
+    auto glyph = rasterized_glyph {};
+    glyph.index = index;
+    glyph.bitmapSize.width = vtbackend::Width::cast_from(record.width);
+    glyph.bitmapSize.height = vtbackend::Height::cast_from(record.height);
+    glyph.position.x = record.x;
+    glyph.position.y = record.y;
+    glyph.format = static_cast<bitmap_format>(record.format);
+    glyph.bitmap.assign(bitmap, bitmap + record.bitmapSize);
+    return glyph;
+}
+
+void glyph_cache::put(glyph_index index, rasterized_glyph const& glyph)
+{
+    auto const _ = std::lock_guard { _mutex };
+    if (_offsets.count(index.value))
+        return;
+
+    auto const record = record_header {
+        index.value,
+        unbox<uint32_t>(glyph.bitmapSize.width),
+        unbox<uint32_t>(glyph.bitmapSize.height),
+        static_cast<int32_t>(glyph.position.x),
+        static_cast<int32_t>(glyph.position.y),
+        static_cast<uint32_t>(glyph.format),
+        static_cast<uint32_t>(glyph.bitmap.size()),
+    };
+
+    _offsets[index.value] = _data.size();
+    append(_data, record);
+    _data.insert(_data.end(), glyph.bitmap.begin(), glyph.bitmap.end());
+
+    if (_data.size() - _flushedSize >= FlushThreshold)
+        flushLocked();
+}
+
+void glyph_cache::flush()
+{
+    auto const _ = std::lock_guard { _mutex };
+    flushLocked();
+}
+
+void glyph_cache::flushLocked()
+{
+    if (_flushedSize == _data.size())
+        return;
+
+    auto ec = std::error_code {};
+    fs::create_directories(_path.parent_path(), ec);
+
+    // A file without valid contents is rewritten from scratch, otherwise only new glyphs are appended.
+    auto const mode = std::ios::binary | (_flushedSize == 0 ? std::ios::trunc : std::ios::app);
+    auto file = std::ofstream(_path, mode);
+    file.write(reinterpret_cast<char const*>(_data.data() + _flushedSize),
+               static_cast<std::streamsize>(_data.size() - _flushedSize));
+    if (!file.good())
+    {
+        rasterizerLog()("Failed to write glyph cache file {}.", _path.string());
+        return;
+    }
+
+    _flushedSize = _data.size();
+}
+
+} // namespace text
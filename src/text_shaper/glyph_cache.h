@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <text_shaper/font.h>
+#include <text_shaper/shaper.h>
+
+#include <crispy/StrongHash.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace text
+{
+
+/**
+ * Persists rasterized glyphs of a single font face on disk, across application launches.
+ *
+ * Each cache file belongs to a key that should identify everything the rasterized bitmaps depend on,
+ * such as the font file and its modification time, the font size, DPI, and render mode.
+ * Since the file name is derived from that key, a changed font file simply maps to a new cache file.
+ *
+ * The whole file is read when the cache is created.
+ * Glyphs added afterwards are appended to the file by flush(), or at the latest on destruction.
+ *
+ * Caches obtained via get() are shared by all shapers of the process using the same font face,
+ * e.g. across terminal windows, and are therefore safe to be used from multiple threads.
+ */
+class glyph_cache
+{
+  public:
+    glyph_cache(std::filesystem::path directory, crispy::strong_hash key);
+    ~glyph_cache();
+
+    glyph_cache(glyph_cache const&) = delete;
+    glyph_cache& operator=(glyph_cache const&) = delete;
+    glyph_cache(glyph_cache&&) = delete;
+    glyph_cache& operator=(glyph_cache&&) = delete;
+
+    /// Returns the cache for the given key, shared with all other users of that key in this process.
+    [[nodiscard]] static std::shared_ptr<glyph_cache> open(std::filesystem::path const& directory,
+                                                           crispy::strong_hash key);
+
+    /// Returns the default directory to store glyph caches in, below the user's cache directory.
+    [[nodiscard]] static std::filesystem::path default_directory();
+
+    [[nodiscard]] std::filesystem::path const& path() const noexcept { return _path; }
+
+    /// Returns the number of glyphs available.
+    [[nodiscard]] size_t size() const;
+
+    [[nodiscard]] std::optional<rasterized_glyph> get(glyph_index index) const;
+
+    void put(glyph_index index, rasterized_glyph const& glyph);
+
+    /// Writes all glyphs added since the last flush to disk.
+    void flush();
+
+  private:
+    void load();
+    void flushLocked();
+
+    std::filesystem::path _path;
+    crispy::strong_hash _key;
+
+    mutable std::mutex _mutex; // guards all members below
+
+    std::vector<uint8_t> _data;                    // file contents, including unflushed glyphs
+    size_t _flushedSize = 0;                       // number of bytes of _data present on disk
+    std::unordered_map<unsigned, size_t> _offsets; // glyph index to offset of its record in _data
+};
+
+} // namespace text
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <text_shaper/font.h>
 #include <text_shaper/font_locator.h>
+#include <text_shaper/glyph_cache.h>
 #include <text_shaper/open_shaper.h>
 
 #include <crispy/algorithm.h>
@@ -24,15 +25,20 @@
 #include FT_ERRORS_H
 #include FT_FREETYPE_H
 #include FT_LCD_FILTER_H
+#include FT_MODULE_H
 // clang-format on
 
 #include <fontconfig/fontconfig.h>
 
 #include <harfbuzz/hb-ft.h>
+#include <harfbuzz/hb-ot.h>
 #include <harfbuzz/hb.h>
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <filesystem>
+#include <map>
 #include <sstream>
 #include <stdexcept>
 #include <tuple>
@@ -104,6 +110,17 @@ using ft_face_ptr = unique_ptr<FT_FaceRec_, void (*)(FT_FaceRec_*)>;
 
 auto constexpr MissingGlyphId = 0xFFFDu;
 
+// Denotes that none of a font's fallback fonts has a glyph for a codepoint.
+auto constexpr NoFallbackFont = std::numeric_limits<size_t>::max();
+
+// Glyphs of the ASCII range, for fonts that map ASCII one-to-one to glyphs with fixed advances.
+struct AsciiGlyphTable // NOLINT(readability-identifier-naming)
+{
+    bool usable = false;                    // whether ASCII text can be shaped without HarfBuzz at all
+    std::array<glyph_index, 128> glyphs {}; // glyph index for each codepoint, 0 if missing
+    int advance = 0;                        // horizontal advance shared by all glyphs
+};
+
 struct HbFontInfo // NOLINT(readability-identifier-naming)
 {
     font_source primary;
@@ -113,6 +130,12 @@ struct HbFontInfo // NOLINT(readability-identifier-naming)
     hb_font_ptr hbFont;
     std::optional<font_metrics> metrics {};
     font_description description {};
+    std::optional<AsciiGlyphTable> asciiGlyphs {}; // lazily created, depends on the font description
+    std::map<render_mode, std::shared_ptr<glyph_cache>> glyphCaches {}; // on-disk cache per render mode
+
+    // Index into fallbacks of the first usable fallback font with a glyph for a codepoint,
+    // or NoFallbackFont. Lazily filled for the codepoints missing in the primary font.
+    std::unordered_map<char32_t, size_t> fallbackCoverage {};
 };
 
 namespace
@@ -138,11 +161,48 @@ namespace
     }
     // clang-format on
 
+    /// Identifies the contents of the given font source, such that it changes whenever the font file does.
+    optional<crispy::strong_hash> fontSourceHash(font_source const& source)
+    {
+        if (auto const* memory = std::get_if<font_memory_ref>(&source))
+            return crispy::strong_hash::compute(memory->data.data(), memory->data.size());
+
+        auto const& path = get<font_path>(source);
+        auto ec = std::error_code {};
+        auto const fileSize = std::filesystem::file_size(path.value, ec);
+        if (ec)
+            return nullopt;
+        auto const lastWriteTime = std::filesystem::last_write_time(path.value, ec);
+        if (ec)
+            return nullopt;
+        auto const mtime = static_cast<uint64_t>(lastWriteTime.time_since_epoch().count());
+        return crispy::strong_hash::compute(path.value)
+               * crispy::strong_hash::compute(static_cast<uint64_t>(fileSize))
+               * crispy::strong_hash::compute(mtime)
+               * static_cast<uint32_t>(path.collectionIndex);
+    }
+
     constexpr bool glyphMissing(text::glyph_position const& gp) noexcept
     {
         return gp.glyph.index.value == 0;
     }
 
+    /// Tests for Unicode's Default_Ignorable_Code_Point property, i.e. codepoints a font does not need
+    /// to have a glyph for, such as variation selectors and joiners.
+    constexpr bool isDefaultIgnorable(char32_t codepoint) noexcept
+    {
+        constexpr auto Ranges = std::array<std::pair<char32_t, char32_t>, 17> { {
+            { 0x00AD, 0x00AD },   { 0x034F, 0x034F },   { 0x061C, 0x061C },   { 0x115F, 0x1160 },
+            { 0x17B4, 0x17B5 },   { 0x180B, 0x180F },   { 0x200B, 0x200F },   { 0x202A, 0x202E },
+            { 0x2060, 0x206F },   { 0x3164, 0x3164 },   { 0xFE00, 0xFE0F },   { 0xFEFF, 0xFEFF },
+            { 0xFFA0, 0xFFA0 },   { 0xFFF0, 0xFFF8 },   { 0x1BCA0, 0x1BCA3 }, { 0x1D173, 0x1D17A },
+            { 0xE0000, 0xE0FFF },
+        } };
+        return std::any_of(Ranges.begin(), Ranges.end(), [codepoint](auto const& range) {
+            return range.first <= codepoint && codepoint <= range.second;
+        });
+    }
+
     constexpr int ftRenderFlag(render_mode mode) noexcept
     {
         switch (mode)
@@ -152,10 +212,16 @@ namespace
             case render_mode::lcd: return FT_LOAD_TARGET_LCD;
             case render_mode::color: return FT_LOAD_COLOR;
             case render_mode::gray: return FT_LOAD_DEFAULT;
+            case render_mode::sdf: return FT_LOAD_NO_HINTING; // hinting is specific to the rasterized size
         }
         return FT_LOAD_DEFAULT;
     }
 
+// FreeType renders signed distance fields since version 2.11.
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 11)
+    #define TEXT_SHAPER_FT_SDF_SUPPORTED 1
+#endif
+
     constexpr FT_Render_Mode ftRenderMode(render_mode mode) noexcept
     {
         switch (mode)
@@ -165,10 +231,20 @@ namespace
             case render_mode::light: return FT_RENDER_MODE_LIGHT;
             case render_mode::lcd: return FT_RENDER_MODE_LCD;
             case render_mode::color: return FT_RENDER_MODE_NORMAL; break;
+#if defined(TEXT_SHAPER_FT_SDF_SUPPORTED)
+            case render_mode::sdf: return FT_RENDER_MODE_SDF;
+#else
+            case render_mode::sdf: return FT_RENDER_MODE_NORMAL;
+#endif
         }
         return FT_RENDER_MODE_NORMAL;
     }
 
+    // Distance in pixels covered by signed distance fields on either side of the outline.
+    // FreeType's default of 8 pixels would pad every glyph beyond its grid cell,
+    // whereas 2 pixels suffice for the shader to anti-alias the outline at up to about four times the size.
+    constexpr FT_Int SdfSpread = 2;
+
     constexpr hb_script_t mapScriptToHarfbuzzScript(unicode::Script script)
     {
         using unicode::Script;
@@ -319,6 +395,72 @@ namespace
                 gpos.glyph.index = glyph_index { missingGlyph };
     }
 
+    /// Tests whether shaping ASCII text with the given font could yield anything but the
+    /// nominal glyph of each codepoint, advanced by the same width.
+    AsciiGlyphTable createAsciiGlyphTable(HbFontInfo const& fontInfo)
+    {
+        auto table = AsciiGlyphTable {};
+        table.glyphs.fill(glyph_index { 0 });
+
+        // Any substitution (e.g. ligatures) or positioning (e.g. kerning) feature could apply to ASCII,
+        // regardless of which ones the font description enables explicitly,
+        // as HarfBuzz also applies a set of default features.
+        hb_face_t* hbFace = hb_font_get_face(fontInfo.hbFont.get());
+        if (hb_ot_layout_has_substitution(hbFace) || hb_ot_layout_has_positioning(hbFace)
+            || FT_HAS_KERNING(fontInfo.ftFace.get()))
+            return table;
+
+        auto advance = optional<hb_position_t> {};
+        for (char32_t codepoint = 0x20; codepoint < 0x7F; ++codepoint)
+        {
+            hb_codepoint_t glyph = 0;
+            if (!hb_font_get_nominal_glyph(fontInfo.hbFont.get(), codepoint, &glyph))
+                continue; // missing glyphs are left to the regular shaping path and its font fallback
+
+            auto const glyphAdvance = hb_font_get_glyph_h_advance(fontInfo.hbFont.get(), glyph);
+            if (advance.has_value() && *advance != glyphAdvance)
+                return table; // not a fixed-width font
+
+            advance = glyphAdvance;
+            table.glyphs[codepoint] = glyph_index { glyph };
+        }
+
+        table.usable = advance.has_value();
+        table.advance = static_cast<int>(static_cast<double>(advance.value_or(0)) / 64.0f);
+        return table;
+    }
+
+    /// Shapes the given text by table lookup only, if it consists of printable ASCII
+    /// that the font covers entirely.
+    bool tryShapeAscii(font_key font,
+                       HbFontInfo const& fontInfo,
+                       AsciiGlyphTable const& table,
+                       unicode::PresentationStyle presentation,
+                       u32string_view codepoints,
+                       shape_result& result)
+    {
+        if (!table.usable)
+            return false;
+
+        for (char32_t const codepoint: codepoints)
+            if (codepoint < 0x20 || codepoint >= 0x7F || !table.glyphs[codepoint].value)
+                return false;
+
+        result.reserve(result.size() + codepoints.size());
+        for (char32_t const codepoint: codepoints)
+        {
+            glyph_position gpos {};
+            gpos.glyph = glyph_key { fontInfo.size, font, table.glyphs[codepoint] };
+#if defined(GLYPH_KEY_DEBUG)
+            gpos.glyph.text = std::u32string(1, codepoint);
+#endif
+            gpos.advance.x = table.advance;
+            gpos.presentation = presentation;
+            result.emplace_back(gpos);
+        }
+        return true;
+    }
+
     void prepareBuffer(hb_buffer_t* hbBuf,
                        u32string_view codepoints,
                        gsl::span<unsigned> clusters,
@@ -404,10 +546,34 @@ struct open_shaper::Private // {{{
     // Blacklisted font files as we tried them already and failed.
     std::vector<std::string> blacklistedSources;
 
+    // Fonts returned by load_font_deferred() that have not been used yet.
+    struct DeferredFont
+    {
+        font_description description;
+        font_size size;
+        font_key fallback;
+
+        bool operator==(DeferredFont const& other) const
+        {
+            return description == other.description && size.pt == other.size.pt
+                   && fallback == other.fallback;
+        }
+    };
+    unordered_map<font_key, DeferredFont> deferredFonts;
+
+    // All fonts ever returned by load_font_deferred(), so that the same request yields the same key.
+    vector<pair<DeferredFont, font_key>> deferredFontKeys;
+
     // The key (for caching) should be composed out of:
     // (file_path, file_mtime, font_weight, font_slant, pixel_size)
 
     unordered_map<glyph_key, rasterized_glyph> glyphs;
+
+    // Mip chains of color bitmap glyphs by the strike they got decoded from, identified by
+    // the font source and its pixel size, and thus shared by all font sizes picking that strike.
+    using StrikeGlyphKey = std::tuple<string, FT_UShort, FT_UShort, uint32_t>;
+    std::map<StrikeGlyphKey, std::shared_ptr<glyph_mip_chain const>> strikeGlyphs;
+
     hb_buffer_ptr hbBuf;
     font_key nextFontKey;
 
@@ -456,6 +622,59 @@ struct open_shaper::Private // {{{
         return key;
     }
 
+    /// Returns the font info of the given font, loading it first if it has been deferred.
+    HbFontInfo& fontInfoOf(font_key key)
+    {
+        if (auto deferred = deferredFonts.extract(key))
+            loadDeferredFont(key, deferred.mapped());
+
+        Require(fontKeyToHbFontInfoMapping.count(key) == 1);
+        return fontKeyToHbFontInfoMapping.at(key);
+    }
+
+    void loadDeferredFont(font_key key, DeferredFont const& deferred)
+    {
+        auto description = deferred.description;
+        auto sources = locator->locate(description);
+        auto ftFacePtrOpt = optional<ft_face_ptr> {};
+        if (!sources.empty())
+            ftFacePtrOpt = loadFace(sources[0], deferred.size, dpi, ft);
+        if (!ftFacePtrOpt.has_value())
+        {
+            HbFontInfo const& fallbackFontInfo = fontInfoOf(deferred.fallback);
+            locatorLog()(
+                "Using {} in place of unavailable font {}.", fallbackFontInfo.description, description);
+            description = fallbackFontInfo.description;
+            sources = fallbackFontInfo.fallbacks;
+            sources.insert(sources.begin(), fallbackFontInfo.primary);
+            ftFacePtrOpt = loadFace(sources[0], deferred.size, dpi, ft);
+            Require(ftFacePtrOpt.has_value());
+        }
+
+        auto ftFacePtr = std::move(ftFacePtrOpt.value());
+        auto hbFontPtr =
+            hb_font_ptr(hb_ft_font_create_referenced(ftFacePtr.get()), [](auto p) { hb_font_destroy(p); });
+
+        auto const primary = sources[0];
+        sources.erase(sources.begin()); // remove primary font from list
+
+        auto fontInfo = HbFontInfo {
+            primary, std::move(sources), deferred.size, std::move(ftFacePtr), std::move(hbFontPtr)
+        };
+        fontInfo.description = description;
+
+        auto const sourceId = identifierOf(primary);
+        auto const sourceInfo = FontInfo { sourceId, deferred.size, description.weight };
+        fontPathAndSizeToKeyMapping.try_emplace(sourceInfo, key);
+        fontKeyToHbFontInfoMapping.emplace(pair { key, std::move(fontInfo) });
+        locatorLog()("Loading deferred font: key={}, id=\"{}\" size={} dpi {} {}",
+                     key,
+                     sourceId,
+                     deferred.size,
+                     dpi,
+                     metrics(key));
+    }
+
     font_metrics metrics(font_key key)
     {
         Require(fontKeyToHbFontInfoMapping.count(key) == 1);
@@ -489,6 +708,77 @@ struct open_shaper::Private // {{{
 
         if (auto const ec = FT_Library_SetLcdFilter(ft, FT_LCD_FILTER_DEFAULT); ec != FT_Err_Ok)
             errorLog()("freetype: Failed to set LCD filter. {}", ftErrorStr(ec));
+
+#if defined(TEXT_SHAPER_FT_SDF_SUPPORTED)
+        for (auto const* module: { "sdf", "bsdf" })
+            if (auto const ec = FT_Property_Set(ft, module, "spread", &SdfSpread); ec != FT_Err_Ok)
+                errorLog()("freetype: Failed to set {} spread. {}", module, ftErrorStr(ec));
+#endif
+    }
+
+    /// Returns the on-disk cache of glyphs rasterized with the given font and render mode, if available.
+    glyph_cache* glyphCacheFor(HbFontInfo& fontInfo, render_mode mode)
+    {
+        auto& cache = fontInfo.glyphCaches[mode];
+        if (cache)
+            return cache.get();
+
+        auto const sourceHash = fontSourceHash(fontInfo.primary);
+        if (!sourceHash)
+            return nullptr;
+
+        // Everything but the glyph index the rasterized bitmap depends on.
+        auto const key = *sourceHash * crispy::strong_hash::compute(fontInfo.size.pt)
+                         * static_cast<uint32_t>(dpi.x) * static_cast<uint32_t>(dpi.y)
+                         * static_cast<uint32_t>(mode);
+        cache = glyph_cache::open(glyph_cache::default_directory(), key);
+        return cache.get();
+    }
+
+    /// Returns the key of the given glyph of a color bitmap font in strikeGlyphs.
+    static StrikeGlyphKey strikeGlyphKeyOf(HbFontInfo const& fontInfo, glyph_index index)
+    {
+        auto const& metrics = fontInfo.ftFace->size->metrics;
+        return { identifierOf(fontInfo.primary), metrics.x_ppem, metrics.y_ppem, index.value };
+    }
+
+    /// Returns the key of the given fallback font of @p fontInfo, loading it if needed,
+    /// or nullopt if it cannot be loaded or is unsuitable due to its spacing.
+    optional<font_key> usableFallbackFont(HbFontInfo const& fontInfo, size_t index)
+    {
+        optional<font_key> fallbackKeyOpt =
+            getOrCreateKeyForFont(fontInfo.fallbacks[index], fontInfo.size, fontInfo.description.weight);
+        if (!fallbackKeyOpt.has_value())
+            return nullopt;
+
+        // Skip if main font is monospace but fallbacks font is not.
+        if (fontInfo.description.strictSpacing && fontInfo.description.spacing != font_spacing::proportional)
+        {
+            Require(fontKeyToHbFontInfoMapping.count(fallbackKeyOpt.value()) == 1);
+            HbFontInfo const& fallbackFontInfo = fontKeyToHbFontInfoMapping.at(fallbackKeyOpt.value());
+            bool const fontIsMonospace = fallbackFontInfo.ftFace->face_flags & FT_FACE_FLAG_FIXED_WIDTH;
+            if (!fontIsMonospace)
+                return nullopt;
+        }
+
+        return fallbackKeyOpt;
+    }
+
+    /// Returns the index of the first usable fallback font of @p fontInfo with a glyph for the given
+    /// codepoint, or NoFallbackFont if there is none.
+    size_t fallbackFontFor(HbFontInfo& fontInfo, char32_t codepoint)
+    {
+        if (auto const i = fontInfo.fallbackCoverage.find(codepoint); i != fontInfo.fallbackCoverage.end())
+            return i->second;
+
+        auto coveringFont = NoFallbackFont;
+        for (size_t index = 0; index < fontInfo.fallbacks.size() && coveringFont == NoFallbackFont; ++index)
+            if (auto const fallbackKey = usableFallbackFont(fontInfo, index))
+                if (FT_Get_Char_Index(fontKeyToHbFontInfoMapping.at(*fallbackKey).ftFace.get(), codepoint))
+                    coveringFont = index;
+
+        fontInfo.fallbackCoverage.emplace(codepoint, coveringFont);
+        return coveringFont;
     }
 
     bool tryShapeWithFallback(font_key font,
@@ -506,25 +796,29 @@ struct open_shaper::Private // {{{
         if (tryShape(font, fontInfo, hbBuf, hbFont, script, presentation, codepoints, clusters, result))
             return true;
 
-        for (font_source const& fallbackFont: fontInfo.fallbacks)
+        // Fallback fonts before the first one covering each codepoint missing in the primary font
+        // are bound to fail as well, and are therefore not even tried.
+        auto firstCandidate = size_t { 0 };
+        for (char32_t const codepoint: codepoints)
         {
-            result.resize(initialResultOffset); // rollback to initial size
+            if (isDefaultIgnorable(codepoint) || FT_Get_Char_Index(fontInfo.ftFace.get(), codepoint))
+                continue;
+            firstCandidate = max(firstCandidate, fallbackFontFor(fontInfo, codepoint));
+            if (firstCandidate == NoFallbackFont)
+            {
+                textShapingLog()("No fallback font has a glyph for U+{:04X}.",
+                                 static_cast<unsigned>(codepoint));
+                return false;
+            }
+        }
 
-            optional<font_key> fallbackKeyOpt =
-                getOrCreateKeyForFont(fallbackFont, fontInfo.size, fontInfo.description.weight);
+        for (size_t index = firstCandidate; index < fontInfo.fallbacks.size(); ++index)
+        {
+            optional<font_key> fallbackKeyOpt = usableFallbackFont(fontInfo, index);
             if (!fallbackKeyOpt.has_value())
                 continue;
 
-            // Skip if main font is monospace but fallbacks font is not.
-            if (fontInfo.description.strictSpacing
-                && fontInfo.description.spacing != font_spacing::proportional)
-            {
-                Require(fontKeyToHbFontInfoMapping.count(fallbackKeyOpt.value()) == 1);
-                HbFontInfo const& fallbackFontInfo = fontKeyToHbFontInfoMapping.at(fallbackKeyOpt.value());
-                bool const fontIsMonospace = fallbackFontInfo.ftFace->face_flags & FT_FACE_FLAG_FIXED_WIDTH;
-                if (!fontIsMonospace)
-                    continue;
-            }
+            result.resize(initialResultOffset); // rollback to initial size
 
             Require(fontKeyToHbFontInfoMapping.count(fallbackKeyOpt.value()) == 1);
             HbFontInfo& fallbackFontInfo = fontKeyToHbFontInfoMapping.at(fallbackKeyOpt.value());
@@ -574,6 +868,9 @@ void open_shaper::clear_cache()
                  _d->fontKeyToHbFontInfoMapping.size());
     _d->fontPathAndSizeToKeyMapping.clear();
     _d->fontKeyToHbFontInfoMapping.clear();
+    _d->deferredFonts.clear();
+    _d->deferredFontKeys.clear();
+    _d->strikeGlyphs.clear();
 }
 
 optional<font_key> open_shaper::load_font(font_description const& description, font_size size)
@@ -591,14 +888,29 @@ optional<font_key> open_shaper::load_font(font_description const& description, f
     HbFontInfo& fontInfo = _d->fontKeyToHbFontInfoMapping.at(*fontKeyOpt);
     fontInfo.fallbacks = std::move(sources);
     fontInfo.description = description;
+    fontInfo.asciiGlyphs.reset();
 
     return fontKeyOpt;
 }
 
+font_key open_shaper::load_font_deferred(font_description const& description,
+                                         font_size size,
+                                         font_key fallback)
+{
+    auto const deferred = Private::DeferredFont { description, size, fallback };
+    for (auto const& [request, key]: _d->deferredFontKeys)
+        if (request == deferred)
+            return key;
+
+    auto const key = _d->create_font_key();
+    _d->deferredFonts.emplace(key, deferred);
+    _d->deferredFontKeys.emplace_back(deferred, key);
+    return key;
+}
+
 font_metrics open_shaper::metrics(font_key key) const
 {
-    Require(_d->fontKeyToHbFontInfoMapping.count(key) == 1);
-    HbFontInfo& fontInfo = _d->fontKeyToHbFontInfoMapping.at(key);
+    HbFontInfo& fontInfo = _d->fontInfoOf(key);
     if (fontInfo.metrics.has_value())
         return fontInfo.metrics.value();
 
@@ -609,8 +921,7 @@ font_metrics open_shaper::metrics(font_key key) const
 
 optional<glyph_position> open_shaper::shape(font_key font, char32_t codepoint)
 {
-    Require(_d->fontKeyToHbFontInfoMapping.count(font) == 1);
-    HbFontInfo& fontInfo = _d->fontKeyToHbFontInfoMapping.at(font);
+    HbFontInfo& fontInfo = _d->fontInfoOf(font);
 
     glyph_index glyphIndex { FT_Get_Char_Index(fontInfo.ftFace.get(), codepoint) };
     if (!glyphIndex.value)
@@ -651,14 +962,24 @@ void open_shaper::shape(font_key font,
 {
     assert(clusters.size() == codepoints.size());
     textShapingLog()("Shaping using font key: {}, text: \"{}\"", font, unicode::convert_to<char>(codepoints));
-    if (!_d->fontKeyToHbFontInfoMapping.count(font))
+    if (!_d->fontKeyToHbFontInfoMapping.count(font) && !_d->deferredFonts.count(font))
         textShapingLog()("Font not found? {}", font);
 
-    Require(_d->fontKeyToHbFontInfoMapping.count(font) == 1);
-    HbFontInfo& fontInfo = _d->fontKeyToHbFontInfoMapping.at(font);
+    HbFontInfo& fontInfo = _d->fontInfoOf(font);
     hb_font_t* hbFont = fontInfo.hbFont.get();
     hb_buffer_t* hbBuf = _d->hbBuf.get();
 
+    if (!fontInfo.asciiGlyphs.has_value())
+    {
+        fontInfo.asciiGlyphs = createAsciiGlyphTable(fontInfo);
+        textShapingLog()("Font key {} {} shaping ASCII without HarfBuzz.",
+                         font,
+                         fontInfo.asciiGlyphs->usable ? "supports" : "does not support");
+    }
+
+    if (tryShapeAscii(font, fontInfo, *fontInfo.asciiGlyphs, presentation, codepoints, result))
+        return;
+
     if (textShapingLog)
     {
         auto logMessage = textShapingLog();
@@ -721,8 +1042,19 @@ void open_shaper::shape(font_key font,
 optional<rasterized_glyph> open_shaper::rasterize(glyph_key glyph, render_mode mode)
 {
     auto const font = glyph.font;
-    auto* ftFace = _d->fontKeyToHbFontInfoMapping.at(font).ftFace.get();
+    auto& fontInfo = _d->fontInfoOf(font);
+    auto* ftFace = fontInfo.ftFace.get();
     auto const glyphIndex = glyph.index;
+
+    if (FT_HAS_COLOR(ftFace))
+        if (auto const i = _d->strikeGlyphs.find(Private::strikeGlyphKeyOf(fontInfo, glyphIndex));
+            i != _d->strikeGlyphs.end() && i->second)
+            return i->second->levels.front();
+
+    auto* const glyphCache = _d->glyphCacheFor(fontInfo, mode);
+    if (glyphCache)
+        if (auto cachedGlyph = glyphCache->get(glyphIndex))
+            return cachedGlyph;
     auto const flags = static_cast<FT_Int32>(ftRenderFlag(mode) | (FT_HAS_COLOR(ftFace) ? FT_LOAD_COLOR : 0));
 
     FT_Error ec = FT_Load_Glyph(ftFace, glyphIndex.value, flags);
@@ -746,9 +1078,18 @@ optional<rasterized_glyph> open_shaper::rasterize(glyph_key glyph, render_mode m
     }
 
     // NB: colored fonts are bitmap fonts, they do not need rendering
+    auto distanceField = false;
     if (!FT_HAS_COLOR(ftFace))
     {
-        if (FT_Render_Glyph(ftFace->glyph, ftRenderMode(mode)) != FT_Err_Ok)
+        auto renderMode = ftRenderMode(mode);
+        distanceField = mode == render_mode::sdf && renderMode != FT_RENDER_MODE_NORMAL;
+        if (distanceField && FT_Render_Glyph(ftFace->glyph, renderMode) != FT_Err_Ok)
+        {
+            rasterizerLog()("Failed to render distance field of glyph {}. Falling back to coverage.", glyph);
+            distanceField = false;
+            renderMode = FT_RENDER_MODE_NORMAL;
+        }
+        if (!distanceField && FT_Render_Glyph(ftFace->glyph, renderMode) != FT_Err_Ok)
         {
             rasterizerLog()("Failed to rasterize glyph {}.", glyph);
             return nullopt;
@@ -791,7 +1132,7 @@ optional<rasterized_glyph> open_shaper::rasterize(glyph_key glyph, render_mode m
             break;
         }
         case FT_PIXEL_MODE_GRAY: {
-            output.format = bitmap_format::alpha_mask;
+            output.format = distanceField ? bitmap_format::distance_field : bitmap_format::alpha_mask;
             output.bitmap.resize(unbox<size_t>(output.bitmapSize.height)
                                  * unbox<size_t>(output.bitmapSize.width));
 
@@ -871,7 +1212,24 @@ optional<rasterized_glyph> open_shaper::rasterize(glyph_key glyph, render_mode m
     if (rasterizerLog)
         rasterizerLog()("rasterize {} to {}", glyph, output);
 
+    if (glyphCache)
+        glyphCache->put(glyphIndex, output);
+
     return output;
 }
 
+std::shared_ptr<glyph_mip_chain const> open_shaper::mip_chain(glyph_key glyph, render_mode mode)
+{
+    auto const& fontInfo = _d->fontInfoOf(glyph.font);
+    if (!FT_HAS_COLOR(fontInfo.ftFace.get()))
+        return shaper::mip_chain(glyph, mode);
+
+    // Color bitmap fonts render all font sizes picking the same strike to the same bitmap,
+    // so this decodes each glyph and builds its mip chain once for all of them.
+    auto& chain = _d->strikeGlyphs[Private::strikeGlyphKeyOf(fontInfo, glyph.index)];
+    if (!chain)
+        chain = shaper::mip_chain(glyph, mode);
+    return chain;
+}
+
 } // namespace text
@@ -29,6 +29,10 @@ class open_shaper: public shaper
     [[nodiscard]] std::optional<font_key> load_font(font_description const& description,
                                                     font_size size) override;
 
+    [[nodiscard]] font_key load_font_deferred(font_description const& description,
+                                              font_size size,
+                                              font_key fallback) override;
+
     [[nodiscard]] font_metrics metrics(font_key key) const override;
 
     void shape(font_key font,
@@ -42,6 +46,9 @@ class open_shaper: public shaper
 
     [[nodiscard]] std::optional<rasterized_glyph> rasterize(glyph_key glyph, render_mode mode) override;
 
+    [[nodiscard]] std::shared_ptr<glyph_mip_chain const> mip_chain(glyph_key glyph,
+                                                                    render_mode mode) override;
+
   private:
     struct Private;
     std::unique_ptr<Private, void (*)(Private*)> _d;
@@ -7,6 +7,10 @@
 
 #include <range/v3/view/iota.hpp>
 
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -22,53 +26,141 @@ namespace text
 
 namespace
 {
+    // Averages the pixels of the given area of the input bitmap into the output pixel @p d.
+    // Color components of RGBA bitmaps are weighted by their alpha, so that the color of
+    // transparent pixels does not bleed into the edges of the glyph.
     template <std::size_t NumComponents>
-    constexpr void scaleDownExplicit(vector<uint8_t> const& inputBitmap,
-                                     vtbackend::ImageSize inputSize,
-                                     vtbackend::ImageSize outputSize,
-                                     size_t factor,
-                                     vector<uint8_t>& outputBitmap) noexcept
+    void averageArea(rasterized_glyph const& input,
+                     size_t x0,
+                     size_t y0,
+                     size_t x1,
+                     size_t y1,
+                     uint8_t* d) noexcept
     {
+        auto constexpr Premultiplied = NumComponents == 4;
+        auto const pitch = unbox<size_t>(input.bitmapSize.width) * NumComponents;
+
+        std::array<unsigned int, NumComponents> components { {} };
+        unsigned int count = 0;
+        for (auto y = y0; y < y1; y++)
+        {
+            uint8_t const* p = input.bitmap.data() + (y * pitch) + (x0 * NumComponents);
+            for (auto x = x0; x < x1; x++, count++, p += NumComponents)
+            {
+                auto const weight = Premultiplied ? unsigned { p[3] } : 1u;
+                for (size_t i = 0; i < NumComponents; ++i)
+                    components[i] += Premultiplied && i != 3 ? p[i] * weight : p[i];
+            }
+        }
+
+        if (!count)
+            return;
+
+        if constexpr (Premultiplied)
+        {
+            auto const alpha = components[3];
+            for (size_t i = 0; i < 3; ++i)
+                d[i] = alpha ? static_cast<uint8_t>(components[i] / alpha) : 0;
+            d[3] = static_cast<uint8_t>(alpha / count);
+        }
+        else
+        {
+            for (size_t i = 0; i < NumComponents; ++i)
+                d[i] = static_cast<uint8_t>(components[i] / count);
+        }
+    }
+
+    // Area-averages the input bitmap down to the given output size, with each output pixel
+    // covering ratio input pixels in both dimensions.
+    template <std::size_t NumComponents>
+    void scaleDownExplicit(rasterized_glyph const& input,
+                           vtbackend::ImageSize outputSize,
+                           double ratio,
+                           vector<uint8_t>& outputBitmap) noexcept
+    {
+        auto const inputWidth = unbox<size_t>(input.bitmapSize.width);
+        auto const inputHeight = unbox<size_t>(input.bitmapSize.height);
+        // Returns the input pixel the output pixel i starts at, clamped to the given limit.
+        auto const edge = [ratio](size_t i, size_t limit) {
+            return min(limit, static_cast<size_t>(std::lround(static_cast<double>(i) * ratio)));
+        };
+
         outputBitmap.resize(outputSize.area() * NumComponents);
         uint8_t* d = outputBitmap.data();
-        for (size_t i = 0, sr = 0; i < *outputSize.height; i++, sr += factor)
+        for (size_t i = 0; i < *outputSize.height; i++)
         {
-            for (size_t j = 0, sc = 0; j < *outputSize.width; j++, sc += factor, d += 4)
+            auto const y0 = edge(i, inputHeight - 1);
+            auto const y1 = max(y0 + 1, edge(i + 1, inputHeight));
+            for (size_t j = 0; j < *outputSize.width; j++, d += NumComponents)
             {
-                // calculate area average
-                std::array<unsigned int, NumComponents> components { {} };
-                unsigned int count = 0;
-                for (size_t y = sr; y < min(sr + factor, unbox<size_t>(inputSize.height)); y++)
-                {
-                    uint8_t const* p = inputBitmap.data() + (y * unbox<size_t>(inputSize.width) * 4) + sc * 4;
-                    for (auto x = sc; x < min(sc + factor, unbox<size_t>(inputSize.width)); x++, count++)
-                    {
-                        for (size_t i = 0; i < NumComponents; ++i)
-                            components[i] += *(p++);
-                    }
-                }
-
-                if (count)
-                {
-                    for (size_t i = 0; i < NumComponents; ++i)
-                        d[i] = static_cast<uint8_t>(components[i] / count);
-                }
+                auto const x0 = edge(j, inputWidth - 1);
+                auto const x1 = max(x0 + 1, edge(j + 1, inputWidth));
+                averageArea<NumComponents>(input, x0, y0, x1, y1, d);
             }
         }
     }
 
+    vector<uint8_t> scaleDown(rasterized_glyph const& input, vtbackend::ImageSize outputSize, double ratio)
+    {
+        vector<uint8_t> dest;
+        switch (input.format)
+        {
+            case bitmap_format::rgba: scaleDownExplicit<4>(input, outputSize, ratio, dest); break;
+            case bitmap_format::rgb: scaleDownExplicit<3>(input, outputSize, ratio, dest); break;
+            case bitmap_format::alpha_mask:
+            case bitmap_format::distance_field: scaleDownExplicit<1>(input, outputSize, ratio, dest); break;
+        }
+        return dest;
+    }
+
 } // namespace
 
-tuple<rasterized_glyph, float> scale(rasterized_glyph const& bitmap, vtbackend::ImageSize boundingBox)
+glyph_mip_chain make_mip_chain(rasterized_glyph glyph)
 {
+    auto chain = glyph_mip_chain {};
+    chain.levels.emplace_back(std::move(glyph));
+
+    while (*chain.levels.back().bitmapSize.width > 1 && *chain.levels.back().bitmapSize.height > 1)
+    {
+        auto const& previous = chain.levels.back();
+        auto level = rasterized_glyph {};
+        level.index = previous.index;
+        level.format = previous.format;
+        level.position = previous.position;
+        level.bitmapSize = vtbackend::ImageSize { previous.bitmapSize.width / vtbackend::Width(2),
+                                                  previous.bitmapSize.height / vtbackend::Height(2) };
+        level.bitmap = scaleDown(previous, level.bitmapSize, 2.0);
+        chain.levels.emplace_back(std::move(level));
+    }
+
+    return chain;
+}
+
+rasterized_glyph const& glyph_mip_chain::level_for(vtbackend::ImageSize boundingBox) const noexcept
+{
+    assert(!levels.empty());
+
+    // The smallest level still covering the bounding box, such that scaling it down is at most halving it.
+    for (auto i = levels.size() - 1; i > 0; --i)
+        if (levels[i].bitmapSize.width >= boundingBox.width
+            || levels[i].bitmapSize.height >= boundingBox.height)
+            return levels[i];
+    return levels.front();
+}
+
+tuple<rasterized_glyph, float> scale(glyph_mip_chain const& chain, vtbackend::ImageSize boundingBox)
+{
+    auto const& original = chain.levels.front();
+    auto const& bitmap = chain.level_for(boundingBox);
+
     // NB: We're only supporting down-scaling.
-    assert(bitmap.bitmapSize.width >= boundingBox.width);
-    assert(bitmap.bitmapSize.height >= boundingBox.height);
+    assert(original.bitmapSize.width >= boundingBox.width);
+    assert(original.bitmapSize.height >= boundingBox.height);
 
     auto const ratioX = unbox<double>(bitmap.bitmapSize.width) / unbox<double>(boundingBox.width);
     auto const ratioY = unbox<double>(bitmap.bitmapSize.height) / unbox<double>(boundingBox.height);
-    auto const ratio = max(ratioX, ratioY);
-    auto const factor = static_cast<unsigned>(ceil(ratio));
+    auto const ratio = max(1.0, max(ratioX, ratioY));
+    auto const factor = unbox<double>(original.bitmapSize.width) / unbox<double>(bitmap.bitmapSize.width);
 
     // Adjust new image size to respect ratio.
     auto const newSize = vtbackend::ImageSize {
@@ -76,68 +168,39 @@ tuple<rasterized_glyph, float> scale(rasterized_glyph const& bitmap, vtbackend::
         vtbackend::Height::cast_from(unbox<double>(bitmap.bitmapSize.height) / ratio)
     };
 
-    rasterizerLog()("scaling {} from {} to {}, ratio {}x{} ({}), factor {}",
+    rasterizerLog()("scaling {} from {} (level {}x of {}) to {}, ratio {}x{} ({})",
                     bitmap.format,
                     bitmap.bitmapSize,
+                    factor,
+                    original.bitmapSize,
                     newSize,
                     ratioX,
                     ratioY,
-                    ratio,
-                    factor);
-
-    vector<uint8_t> dest;
-    switch (bitmap.format)
-    {
-        case bitmap_format::rgba:
-            scaleDownExplicit<4>(bitmap.bitmap, bitmap.bitmapSize, newSize, factor, dest);
-            break;
-        case bitmap_format::rgb:
-            scaleDownExplicit<3>(bitmap.bitmap, bitmap.bitmapSize, newSize, factor, dest);
-            break;
-        case bitmap_format::alpha_mask:
-            scaleDownExplicit<1>(bitmap.bitmap, bitmap.bitmapSize, newSize, factor, dest);
-            break;
-    }
-
-    // for (unsigned i = 0, sr = 0; i < *newSize.height; i++, sr += factor)
-    // {
-    //     for (unsigned j = 0, sc = 0; j < *newSize.width; j++, sc += factor, d += 4)
-    //     {
-    //         // calculate area average
-    //         unsigned int r = 0, g = 0, b = 0, a = 0, count = 0;
-    //         for (unsigned y = sr; y < min(sr + factor, bitmap.bitmapSize.height.as<unsigned>()); y++)
-    //         {
-    //             uint8_t const* p = bitmap.bitmap.data() + (y * *bitmap.bitmapSize.width * 4) + sc * 4;
-    //             for (unsigned x = sc; x < min(sc + factor, bitmap.bitmapSize.width.as<unsigned>());
-    //                  x++, count++)
-    //             {
-    //                 b += *(p++);
-    //                 g += *(p++);
-    //                 r += *(p++);
-    //                 a += *(p++);
-    //             }
-    //         }
-    //
-    //         if (count)
-    //         {
-    //             d[0] = static_cast<uint8_t>(b / count);
-    //             d[1] = static_cast<uint8_t>(g / count);
-    //             d[2] = static_cast<uint8_t>(r / count);
-    //             d[3] = static_cast<uint8_t>(a / count);
-    //         }
-    //     }
-    // }
+                    ratio);
 
     auto output = rasterized_glyph {};
+    output.index = original.index;
     output.format = bitmap.format;
     output.bitmapSize = newSize;
-    output.position = bitmap.position; // TODO Actually, left/top position should be adjusted
-    output.bitmap = std::move(dest);
+    output.bitmap = scaleDown(bitmap, newSize, ratio);
     output.position.x = unbox<int>(boundingBox.width - output.bitmapSize.width) / 2;
     output.position.y =
         unbox<int>(output.bitmapSize.height) + unbox<int>(boundingBox.height - output.bitmapSize.height) / 4;
 
-    return { output, factor };
+    return { output, static_cast<float>(factor * ratio) };
+}
+
+tuple<rasterized_glyph, float> scale(rasterized_glyph const& bitmap, vtbackend::ImageSize boundingBox)
+{
+    return scale(make_mip_chain(bitmap), boundingBox);
+}
+
+std::shared_ptr<glyph_mip_chain const> shaper::mip_chain(glyph_key glyph, render_mode mode)
+{
+    auto rasterizedGlyph = rasterize(glyph, mode);
+    if (!rasterizedGlyph)
+        return nullptr;
+    return std::make_shared<glyph_mip_chain const>(make_mip_chain(std::move(*rasterizedGlyph)));
 }
 
 } // namespace text
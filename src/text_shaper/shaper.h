@@ -19,6 +19,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -37,7 +38,8 @@ enum class bitmap_format
 {
     alpha_mask,
     rgb,
-    rgba
+    rgba,
+    distance_field, //!< 8-bit signed distance to the glyph outline, with 128 being on the outline
 };
 // NOLINTEND(readability-identifier-naming)
 
@@ -48,6 +50,7 @@ constexpr size_t pixel_size(bitmap_format format) noexcept
         case bitmap_format::rgba: return 4;
         case bitmap_format::rgb: return 3;
         case bitmap_format::alpha_mask: return 1;
+        case bitmap_format::distance_field: return 1;
     }
     return 1;
 }
@@ -68,8 +71,26 @@ struct rasterized_glyph
     }
 };
 
+/// A bitmap glyph along with successively halved levels of it, down to a single pixel,
+/// for scaling it down to any size without resampling the full-sized bitmap every time.
+struct glyph_mip_chain
+{
+    std::vector<rasterized_glyph> levels; // levels.front() is the original bitmap
+
+    /// Returns the smallest level still covering the given bounding box.
+    [[nodiscard]] rasterized_glyph const& level_for(vtbackend::ImageSize boundingBox) const noexcept;
+};
+
+[[nodiscard]] glyph_mip_chain make_mip_chain(rasterized_glyph glyph);
+
+/// Scales the given bitmap down to fit into the bounding box, returning the scaled glyph
+/// along with the factor it got scaled down by.
 std::tuple<rasterized_glyph, float> scale(rasterized_glyph const& bitmap, vtbackend::ImageSize boundingBox);
 
+/// Scales the glyph of the given mip chain down to fit into the bounding box, starting from the
+/// level closest to it.
+std::tuple<rasterized_glyph, float> scale(glyph_mip_chain const& chain, vtbackend::ImageSize boundingBox);
+
 struct glyph_position
 {
     glyph_key glyph;
@@ -116,6 +137,19 @@ class shaper
     [[nodiscard]] virtual std::optional<font_key> load_font(font_description const& description,
                                                             font_size size) = 0;
 
+    /**
+     * Returns a font matching the given font description, which is located and loaded on its first use
+     * rather than right away, or the font @p fallback if no such font can be loaded.
+     *
+     * Shapers that cannot defer loading fonts load it right away.
+     */
+    [[nodiscard]] virtual font_key load_font_deferred(font_description const& description,
+                                                      font_size size,
+                                                      font_key fallback)
+    {
+        return load_font(description, size).value_or(fallback);
+    }
+
     /**
      * Retrieves global font metrics of font identified by @p key.
      */
@@ -151,6 +185,18 @@ class shaper
      * @param mode  render technique to use.
      */
     [[nodiscard]] virtual std::optional<rasterized_glyph> rasterize(glyph_key glyph, render_mode mode) = 0;
+
+    /**
+     * Rasterizes the glyph as rasterize() does, along with its mip chain for scaling it down.
+     *
+     * Shapers may share the returned chain between all font sizes rasterizing to the same bitmap,
+     * as color bitmap fonts do for the sizes using the same strike, so that scaling such glyphs
+     * to another size does neither decode nor build the chain again.
+     *
+     * @param glyph glyph identifier.
+     * @param mode  render technique to use.
+     */
+    [[nodiscard]] virtual std::shared_ptr<glyph_mip_chain const> mip_chain(glyph_key glyph, render_mode mode);
 };
 
 } // end namespace text
@@ -167,6 +213,7 @@ struct fmt::formatter<text::bitmap_format>: fmt::formatter<std::string_view>
             case text::bitmap_format::alpha_mask: name = "alpha_mask"; break;
             case text::bitmap_format::rgb: name = "rgb"; break;
             case text::bitmap_format::rgba: name = "rgba"; break;
+            case text::bitmap_format::distance_field: name = "distance_field"; break;
         }
         return formatter<string_view>::format(name, ctx);
     }
@@ -2,13 +2,10 @@
 #include <vtbackend/Capabilities.h>
 
 #include <crispy/escape.h>
+#include <crispy/sort.h>
 
-#include <range/v3/action/sort.hpp>
-#include <range/v3/action/transform.hpp>
-#include <range/v3/algorithm/copy.hpp>
-#include <range/v3/view/concat.hpp>
-#include <range/v3/view/transform.hpp>
-
+#include <algorithm>
+#include <array>
 #include <sstream>
 
 using std::nullopt;
@@ -396,107 +393,265 @@ namespace
         String { Undefined, "Sync"sv, "Sync=\033[?2026%?%p1%{1}%-%tl%eh"sv }
     ); // }}}
     // clang-format on
+
+    // {{{ index
+    constexpr auto NoCapability = uint16_t(-1);
+
+    // FNV-1a, as the keys are short, with MurmurHash3's finalizer mixing its high bits into the low ones
+    // that select the slot. Termcap codes hash the same as their two characters.
+    constexpr uint32_t hashKey(std::string_view key) noexcept
+    {
+        auto hash = uint32_t { 2166136261u };
+        for (char const ch: key)
+            hash = (hash ^ static_cast<uint8_t>(ch)) * 16777619u;
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6bu;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35u;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    constexpr uint32_t hashKey(Code code) noexcept
+    {
+        auto const chars = std::array { char(code.code >> 8), char(code.code & 0xFF) };
+        return hashKey(std::string_view(chars.data(), chars.size()));
+    }
+
+    constexpr size_t slotCountFor(size_t count) noexcept
+    {
+        auto slotCount = size_t { 1 };
+        while (slotCount < 2 * count)
+            slotCount *= 2;
+        return slotCount;
+    }
+
+    // The capabilities of one type, indexed by their terminfo name and by their termcap code.
+    //
+    // Both indexes are hash tables built at compile time, mapping to the position of the capability,
+    // by open addressing at a load of at most one half, such that lookups take a hash and a probe or two.
+    template <typename T, size_t N>
+    struct IndexedCapabilities
+    {
+        static_assert(N < NoCapability);
+        static constexpr size_t SlotCount = slotCountFor(N);
+        using Slots = std::array<uint16_t, SlotCount>; // positions into capabilities, if not NoCapability
+
+        std::array<Cap<T>, N> capabilities;
+        std::array<Cap<T>, N> sortedByName; // for generating the terminfo file
+        Slots byName {};
+        Slots byCode {};
+
+        constexpr explicit IndexedCapabilities(std::array<Cap<T>, N> const& caps):
+            capabilities { caps }, sortedByName { caps }
+        {
+            crispy::sort(sortedByName);
+
+            byName.fill(NoCapability);
+            byCode.fill(NoCapability);
+            for (auto i = uint16_t { 0 }; i < N; ++i)
+            {
+                // The first capability defined for a key is kept, as the lookups used to find that one.
+                if (!capabilities[i].name.empty())
+                    if (auto& slot = byName[probe(byName, capabilities[i].name)]; slot == NoCapability)
+                        slot = i;
+                if (capabilities[i].code != Undefined)
+                    if (auto& slot = byCode[probe(byCode, capabilities[i].code)]; slot == NoCapability)
+                        slot = i;
+            }
+        }
+
+        [[nodiscard]] constexpr uint16_t find(Code code) const noexcept
+        {
+            return byCode[probe(byCode, code)];
+        }
+
+        [[nodiscard]] constexpr uint16_t findByName(std::string_view name) const noexcept
+        {
+            return byName[probe(byName, name)];
+        }
+
+        // Finds the first capability defined with either the given terminfo name or termcap code,
+        // as NoCapability is larger than any position.
+        [[nodiscard]] constexpr uint16_t find(std::string_view nameOrCode) const noexcept
+        {
+            auto const byNamePosition = findByName(nameOrCode);
+            auto const byCodePosition = nameOrCode.size() == 2 ? find(Code(nameOrCode)) : NoCapability;
+            return std::min(byNamePosition, byCodePosition);
+        }
+
+      private:
+        [[nodiscard]] static constexpr std::string_view keyOf(Cap<T> const& cap, std::string_view) noexcept
+        {
+            return cap.name;
+        }
+        [[nodiscard]] static constexpr Code keyOf(Cap<T> const& cap, Code) noexcept { return cap.code; }
+
+        // @returns the slot holding the key, or the empty one it is to be inserted at.
+        template <typename Key>
+        [[nodiscard]] constexpr size_t probe(Slots const& slots, Key key) const noexcept
+        {
+            auto i = size_t { hashKey(key) } % SlotCount;
+            while (slots[i] != NoCapability && !(keyOf(capabilities[slots[i]], key) == key))
+                i = (i + 1) % SlotCount;
+            return i;
+        }
+    };
+
+    constexpr auto Booleans = IndexedCapabilities { BooleanCaps };
+    constexpr auto Numericals = IndexedCapabilities { NumericalCaps };
+    constexpr auto Strings = IndexedCapabilities { StringCaps };
+
+    static_assert(Strings.find("RGB"sv) != NoCapability);
+    static_assert(Strings.find("bl"_tcap) == Strings.find("bel"sv));
+    static_assert(Booleans.find("xx"sv) == NoCapability);
+    // }}}
+
+    std::string hexEncoded(std::string_view value)
+    {
+        auto output = std::string {};
+        output.reserve(2 * value.size());
+        for (char const ch: value)
+            output += fmt::format("{:02X}", static_cast<unsigned>(static_cast<uint8_t>(ch)));
+        return output;
+    }
+
+    // The XTGETTCAP reply payloads of all capabilities, hex-encoded, spelled by their terminfo name
+    // and by their termcap code, encoded once for all the queries of applications starting up.
+    struct Replies
+    {
+        template <size_t N>
+        using Payloads = std::array<std::array<std::string, 2>, N>; // by name, and by code
+
+        Payloads<BooleanCaps.size()> booleans;
+        Payloads<NumericalCaps.size()> numericals;
+        Payloads<StringCaps.size()> strings;
+
+        template <typename T, size_t N, typename F>
+        static void encode(Payloads<N>& payloads, IndexedCapabilities<T, N> const& caps, F encodedValue)
+        {
+            for (size_t i = 0; i < N; ++i)
+            {
+                auto const& cap = caps.capabilities[i];
+                auto const value = encodedValue(cap.value);
+                payloads[i][0] = hexEncoded(cap.name) + value;
+                if (cap.code != Undefined)
+                    payloads[i][1] = cap.code.hex() + value;
+            }
+        }
+
+        Replies()
+        {
+            encode(booleans, Booleans, [](bool) { return std::string {}; });
+            encode(numericals, Numericals, [](unsigned value) {
+                // Numbers are sent as their hexadecimal digits, padded to an even count.
+                auto hexValue = fmt::format("{:X}", value);
+                if (hexValue.size() % 2)
+                    hexValue.insert(hexValue.begin(), '0');
+                return "=" + hexValue;
+            });
+            encode(strings, Strings, [](std::string_view value) { return "=" + hexEncoded(value); });
+        }
+    };
+
+    Replies const& replies()
+    {
+        static auto const cache = Replies {};
+        return cache;
+    }
+
+    template <typename T, size_t N>
+    std::string_view replyOf(IndexedCapabilities<T, N> const& caps,
+                             Replies::Payloads<N> const& payloads,
+                             uint16_t index,
+                             std::string_view nameOrCode)
+    {
+        auto const byName = caps.capabilities[index].name == nameOrCode;
+        return payloads[index][byName ? 0 : 1];
+    }
 } // namespace
 
 bool StaticDatabase::booleanCapability(Code code) const
 {
-    for (auto const& cap: BooleanCaps)
-        if (cap.code.code == code.code)
-            return cap.value;
-
-    return false;
+    auto const i = Booleans.find(code);
+    return i != NoCapability && Booleans.capabilities[i].value;
 }
 
 unsigned StaticDatabase::numericCapability(Code code) const
 {
-    for (auto const& cap: NumericalCaps)
-        if (cap.code.code == code.code)
-            return cap.value;
-
-    return Npos;
+    auto const i = Numericals.find(code);
+    return i != NoCapability ? Numericals.capabilities[i].value : Npos;
 }
 
 string_view StaticDatabase::stringCapability(Code code) const
 {
-    for (auto const& cap: StringCaps)
-        if (cap.code.code == code.code)
-            return cap.value;
-
-    return {};
+    auto const i = Strings.find(code);
+    return i != NoCapability ? Strings.capabilities[i].value : string_view {};
 }
 
 bool StaticDatabase::booleanCapability(string_view name) const
 {
-    for (auto const tcap: BooleanCaps)
-        if (tcap.name == name || tcap.code == name)
-            return tcap.value;
-
-    return false;
+    auto const i = Booleans.find(name);
+    return i != NoCapability && Booleans.capabilities[i].value;
 }
 
 unsigned StaticDatabase::numericCapability(string_view name) const
 {
-    for (auto const tcap: NumericalCaps)
-        if (tcap.name == name || tcap.code == name)
-            return tcap.value;
-
-    return Npos;
+    auto const i = Numericals.find(name);
+    return i != NoCapability ? Numericals.capabilities[i].value : Npos;
 }
 
 string_view StaticDatabase::stringCapability(string_view name) const
 {
-    for (auto const tcap: StringCaps)
-        if (tcap.name == name || tcap.code == name)
-            return tcap.value;
-
-    return {};
+    auto const i = Strings.find(name);
+    return i != NoCapability ? Strings.capabilities[i].value : string_view {};
 }
 
 optional<Code> StaticDatabase::codeFromName(string_view name) const
 {
-    for (auto const& cap: NumericalCaps)
-        if (cap.name == name)
-            return cap.code;
+    if (auto const i = Numericals.findByName(name); i != NoCapability)
+        return Numericals.capabilities[i].code;
 
-    for (auto const& cap: BooleanCaps)
-        if (cap.name == name)
-            return cap.code;
+    if (auto const i = Booleans.findByName(name); i != NoCapability)
+        return Booleans.capabilities[i].code;
 
-    for (auto const& cap: StringCaps)
-        if (cap.name == name)
-            return cap.code;
-
-    // using ranges::views::concat;
-    // using ranges::views::transform;
-    // auto const tr = transform([](auto cap) { return std::pair { cap.name, cap.code }; });
-    // for (auto const cap: concat(numericalCaps | tr, booleanCaps | tr, stringCaps | tr))
-    //     if (cap.first == name)
-    //         return cap.second;
+    if (auto const i = Strings.findByName(name); i != NoCapability)
+        return Strings.capabilities[i].code;
 
     return nullopt;
 }
 
-string StaticDatabase::terminfo() const
+string_view StaticDatabase::hexEncodedReply(string_view name) const
 {
-    using namespace ranges;
+    auto const& cache = replies();
+
+    if (auto const i = Booleans.find(name); i != NoCapability && Booleans.capabilities[i].value)
+        return replyOf(Booleans, cache.booleans, i, name);
 
-    auto booleans = copy(BooleanCaps);
-    auto numbers = copy(NumericalCaps);
-    auto strings = copy(StringCaps);
+    if (auto const i = Numericals.find(name); i != NoCapability)
+        return replyOf(Numericals, cache.numericals, i, name);
 
+    if (auto const i = Strings.find(name); i != NoCapability && !Strings.capabilities[i].value.empty())
+        return replyOf(Strings, cache.strings, i, name);
+
+    return {};
+}
+
+string StaticDatabase::terminfo() const
+{
     std::stringstream output;
 
     output << "contour|Contour Terminal Emulator,\n";
 
-    for (auto const& cap: move(booleans) | actions::sort)
+    for (auto const& cap: Booleans.sortedByName)
         if (!cap.name.empty() && cap.value)
             output << "    " << cap.name << ",\n";
 
-    for (auto const& cap: move(numbers) | actions::sort)
+    for (auto const& cap: Numericals.sortedByName)
         if (!cap.name.empty())
             output << "    " << cap.name << "#" << cap.value << ",\n";
 
-    for (auto const& cap: move(strings) | actions::sort)
+    for (auto const& cap: Strings.sortedByName)
         if (!cap.name.empty())
             output << "    " << cap.name << "=" << crispy::escape(cap.value, crispy::numeric_escape::Octal)
                    << ",\n";
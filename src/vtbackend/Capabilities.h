@@ -99,6 +99,14 @@ class StaticDatabase: public Database
 
     [[nodiscard]] std::optional<Code> codeFromName(std::string_view name) const override;
 
+    /// @returns the payload of the XTGETTCAP reply for the capability @p name, a terminfo name or
+    ///          termcap code, that is the name followed by "=" and the value unless it is a boolean,
+    ///          hex-encoded, or an empty string if there is no such capability.
+    ///
+    /// The capabilities are found by a hash index built at compile time, and the payloads of all
+    /// of them are encoded once, on first use.
+    [[nodiscard]] std::string_view hexEncodedReply(std::string_view name) const;
+
     [[nodiscard]] std::string terminfo() const override;
 };
 
@@ -32,3 +32,23 @@ TEST_CASE("Capabilities.get")
     auto const bce = tcap.numericCapability("bce");
     REQUIRE(bce);
 }
+
+TEST_CASE("Capabilities.hexEncodedReply")
+{
+    vtbackend::capabilities::StaticDatabase tcap;
+
+    // Spelled as queried, by terminfo name or termcap code.
+    CHECK(tcap.hexEncodedReply("bel") == "62656C=5E47");
+    CHECK(tcap.hexEncodedReply("bl") == "626C=5E47");
+
+    // Booleans carry no value, and numbers are sent as an even count of hexadecimal digits.
+    CHECK(tcap.hexEncodedReply("am") == "616D");
+    CHECK(tcap.hexEncodedReply("colors") == "636F6C6F7273=0100");
+    CHECK(tcap.hexEncodedReply("it") == "6974=08");
+
+    // Capabilities without a termcap code are found by their terminfo name only.
+    CHECK(tcap.hexEncodedReply("RGB") == "524742=382F382F38");
+
+    CHECK(tcap.hexEncodedReply("xx").empty());
+    CHECK(tcap.hexEncodedReply("").empty());
+}
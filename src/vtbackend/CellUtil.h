@@ -4,13 +4,52 @@
 #include <vtbackend/CellFlags.h>
 #include <vtbackend/Color.h>
 #include <vtbackend/ColorPalette.h>
+#include <vtbackend/UnicodeTable.h>
 #include <vtbackend/cell/CellConcept.h>
 
-#include <libunicode/width.h>
-
 namespace vtbackend::CellUtil
 {
 
+namespace detail
+{
+    template <typename Colors>
+    [[nodiscard]] inline RGBColorPair makeColors(Colors const& colors,
+                                                 bool useBrightColors,
+                                                 CellFlags cellFlags,
+                                                 bool reverseVideo,
+                                                 Color foregroundColor,
+                                                 Color backgroundColor,
+                                                 bool blinkingState,
+                                                 bool rapidBlinkState) noexcept
+    {
+        auto const fgMode = (cellFlags & CellFlag::Faint)                       ? ColorMode::Dimmed
+                            : ((cellFlags & CellFlag::Bold) && useBrightColors) ? ColorMode::Bright
+                                                                                : ColorMode::Normal;
+
+        auto constexpr BgMode = ColorMode::Normal;
+
+        auto const [fgColorTarget, bgColorTarget] =
+            reverseVideo ? std::pair { ColorTarget::Background, ColorTarget::Foreground }
+                         : std::pair { ColorTarget::Foreground, ColorTarget::Background };
+
+        auto rgbColors = RGBColorPair { apply(colors, foregroundColor, fgColorTarget, fgMode),
+                                        apply(colors, backgroundColor, bgColorTarget, BgMode) };
+
+        if (cellFlags & CellFlag::Inverse)
+            rgbColors = rgbColors.swapped();
+
+        if (cellFlags & CellFlag::Hidden)
+            rgbColors = rgbColors.allBackground();
+
+        if ((cellFlags & CellFlag::Blinking) && !blinkingState)
+            return rgbColors.allBackground();
+        if ((cellFlags & CellFlag::RapidBlinking) && !rapidBlinkState)
+            return rgbColors.allBackground();
+
+        return rgbColors;
+    }
+} // namespace detail
+
 [[nodiscard]] inline RGBColorPair makeColors(ColorPalette const& colorPalette,
                                              CellFlags cellFlags,
                                              bool reverseVideo,
@@ -19,31 +58,33 @@ namespace vtbackend::CellUtil
                                              bool blinkingState,
                                              bool rapidBlinkState) noexcept
 {
-    auto const fgMode = (cellFlags & CellFlag::Faint)                                    ? ColorMode::Dimmed
-                        : ((cellFlags & CellFlag::Bold) && colorPalette.useBrightColors) ? ColorMode::Bright
-                                                                                         : ColorMode::Normal;
-
-    auto constexpr BgMode = ColorMode::Normal;
-
-    auto const [fgColorTarget, bgColorTarget] =
-        reverseVideo ? std::pair { ColorTarget::Background, ColorTarget::Foreground }
-                     : std::pair { ColorTarget::Foreground, ColorTarget::Background };
-
-    auto rgbColors = RGBColorPair { apply(colorPalette, foregroundColor, fgColorTarget, fgMode),
-                                    apply(colorPalette, backgroundColor, bgColorTarget, BgMode) };
-
-    if (cellFlags & CellFlag::Inverse)
-        rgbColors = rgbColors.swapped();
-
-    if (cellFlags & CellFlag::Hidden)
-        rgbColors = rgbColors.allBackground();
-
-    if ((cellFlags & CellFlag::Blinking) && !blinkingState)
-        return rgbColors.allBackground();
-    if ((cellFlags & CellFlag::RapidBlinking) && !rapidBlinkState)
-        return rgbColors.allBackground();
+    return detail::makeColors(colorPalette,
+                              colorPalette.useBrightColors,
+                              cellFlags,
+                              reverseVideo,
+                              foregroundColor,
+                              backgroundColor,
+                              blinkingState,
+                              rapidBlinkState);
+}
 
-    return rgbColors;
+/// Same as above, but resolving the colors by table lookup.
+[[nodiscard]] inline RGBColorPair makeColors(ColorLookupTable const& colors,
+                                             CellFlags cellFlags,
+                                             bool reverseVideo,
+                                             Color foregroundColor,
+                                             Color backgroundColor,
+                                             bool blinkingState,
+                                             bool rapidBlinkState) noexcept
+{
+    return detail::makeColors(colors,
+                              colors.useBrightColors(),
+                              cellFlags,
+                              reverseVideo,
+                              foregroundColor,
+                              backgroundColor,
+                              blinkingState,
+                              rapidBlinkState);
 }
 
 [[nodiscard]] inline RGBColor makeUnderlineColor(ColorPalette const& colorPalette,
@@ -99,7 +140,7 @@ CRISPY_REQUIRES(CellConcept<Cell>)
         {
             case 0xFE0E: return 1;
             case 0xFE0F: return 2;
-            default: return unicode::width(codepoint);
+            default: return UnicodeTable::width(codepoint);
         }
     }();
 
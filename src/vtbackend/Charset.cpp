@@ -1,6 +1,10 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <vtbackend/Charset.h>
 
+#include <libunicode/convert.h>
+
+#include <algorithm>
+
 namespace vtbackend
 {
 
@@ -279,4 +283,63 @@ CharsetMap const* charsetMap(CharsetId id) noexcept
     return nullptr;
 }
 
+namespace
+{
+    // The UTF-8 encodings of the characters of a charset, for translating runs of text in bulk.
+    struct Utf8CharsetMap
+    {
+        CharsetMap const* map = nullptr;
+        std::array<std::array<char, 4>, 128> bytes {};
+        std::array<uint8_t, 128> sizes {};
+    };
+
+    Utf8CharsetMap createUtf8CharsetMap(CharsetId id)
+    {
+        auto result = Utf8CharsetMap { .map = charsetMap(id) };
+        for (size_t code = 0; code < result.map->size(); ++code)
+        {
+            auto const utf8 = unicode::convert_to<char>((*result.map)[code]);
+            std::copy_n(utf8.begin(), std::min(utf8.size(), size_t { 4 }), result.bytes[code].begin());
+            result.sizes[code] = static_cast<uint8_t>(std::min(utf8.size(), size_t { 4 }));
+        }
+        result.bytes[0x7F][0] = ' '; // as mapped by CharsetMapping::map()
+        result.sizes[0x7F] = 1;
+        return result;
+    }
+
+    Utf8CharsetMap const& utf8CharsetMap(CharsetMap const* map)
+    {
+        static auto const maps = std::array {
+            createUtf8CharsetMap(CharsetId::Special),
+            createUtf8CharsetMap(CharsetId::British),
+            createUtf8CharsetMap(CharsetId::Dutch),
+            createUtf8CharsetMap(CharsetId::Finnish),
+            createUtf8CharsetMap(CharsetId::French),
+            createUtf8CharsetMap(CharsetId::FrenchCanadian),
+            createUtf8CharsetMap(CharsetId::German),
+            createUtf8CharsetMap(CharsetId::NorwegianDanish),
+            createUtf8CharsetMap(CharsetId::Spanish),
+            createUtf8CharsetMap(CharsetId::Swedish),
+            createUtf8CharsetMap(CharsetId::Swiss),
+            createUtf8CharsetMap(CharsetId::USASCII),
+        };
+        auto const i = std::find_if(maps.begin(), maps.end(), [&](auto const& m) { return m.map == map; });
+        return i != maps.end() ? *i : maps.back();
+    }
+} // namespace
+
+void CharsetMapping::translate(std::string_view text, std::string& output) const
+{
+    auto const& table = utf8CharsetMap(_tables[static_cast<size_t>(_selectedTable)]);
+    output.reserve(output.size() + (text.size() * 3));
+    for (char const ch: text)
+    {
+        auto const code = static_cast<uint8_t>(ch);
+        if (code < 0x80)
+            output.append(table.bytes[code].data(), table.sizes[code]);
+        else
+            output.push_back(ch);
+    }
+}
+
 } // namespace vtbackend
@@ -4,6 +4,8 @@
 #include <fmt/format.h>
 
 #include <array>
+#include <string>
+#include <string_view>
 
 namespace vtbackend
 {
@@ -96,6 +98,15 @@ class CharsetMapping
         return isSelected(_tableForNextGraphic, id);
     }
 
+    /// @returns whether the next graphic character is translated by another table than the ones following.
+    [[nodiscard]] bool singleShiftPending() const noexcept { return _tableForNextGraphic != _selectedTable; }
+
+    /// Appends @p text, translated by the selected table, to @p output as UTF-8.
+    ///
+    /// Only US-ASCII characters are translated. All other bytes (e.g. of UTF-8 encoded non-ASCII text)
+    /// are passed through as they are. Single shifts are not applied.
+    void translate(std::string_view text, std::string& output) const;
+
     // Selects a given designated character set into the table G0, G1, G2, or G3.
     void select(CharsetTable table, CharsetId id) noexcept
     {
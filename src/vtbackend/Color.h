@@ -158,6 +158,8 @@ struct RGBColorPair
         // All same color components as foreground.
         return { background, background };
     }
+
+    constexpr bool operator==(RGBColorPair const&) const noexcept = default;
 };
 
 constexpr RGBColorPair mix(RGBColorPair a, RGBColorPair b, float t = 0.5) noexcept
@@ -365,9 +367,11 @@ constexpr Color DefaultColor() noexcept
 
 struct CellForegroundColor
 {
+    constexpr bool operator==(CellForegroundColor const&) const noexcept = default;
 };
 struct CellBackgroundColor
 {
+    constexpr bool operator==(CellBackgroundColor const&) const noexcept = default;
 };
 using CellRGBColor = std::variant<RGBColor, CellForegroundColor, CellBackgroundColor>;
 
@@ -375,6 +379,8 @@ struct CellRGBColorPair
 {
     CellRGBColor foreground;
     CellRGBColor background;
+
+    bool operator==(CellRGBColorPair const&) const noexcept = default;
 };
 
 struct CellRGBColorAndAlphaPair
@@ -383,12 +389,16 @@ struct CellRGBColorAndAlphaPair
     float foregroundAlpha = 1.0f;
     CellRGBColor background;
     float backgroundAlpha = 1.0f;
+
+    bool operator==(CellRGBColorAndAlphaPair const&) const noexcept = default;
 };
 
 struct CursorColor
 {
     CellRGBColor color = CellForegroundColor {};
     CellRGBColor textOverrideColor = CellBackgroundColor {};
+
+    bool operator==(CursorColor const&) const noexcept = default;
 };
 
 // {{{ Opacity
@@ -134,4 +134,80 @@ RGBColor apply(ColorPalette const& colorPalette, Color color, ColorTarget target
     crispy::unreachable();
 }
 
+namespace
+{
+    std::array<RGBColor, 4> defaultColorsOf(ColorPalette const& colorPalette) noexcept
+    {
+        return { colorPalette.defaultForeground,
+                 colorPalette.defaultForegroundBright,
+                 colorPalette.defaultForegroundDimmed,
+                 colorPalette.defaultBackground };
+    }
+} // namespace
+
+ColorLookupTable::ColorLookupTable(ColorPalette const& colorPalette) noexcept:
+    _palette { colorPalette.palette },
+    _defaultColors { defaultColorsOf(colorPalette) },
+    _useBrightColors { colorPalette.useBrightColors },
+    _built { true }
+{
+    auto const colorAt = [](size_t index) {
+        if (index < 256)
+            return Color::Indexed(static_cast<uint8_t>(index));
+        if (index < 256 + 8)
+            return Color(static_cast<BrightColor>(index - 256));
+        return DefaultColor();
+    };
+
+    for (auto const target: { ColorTarget::Foreground, ColorTarget::Background })
+        for (auto const mode: { ColorMode::Dimmed, ColorMode::Normal, ColorMode::Bright })
+            for (size_t index = 0; index < ColorCount; ++index)
+                _colors[static_cast<size_t>(target)][static_cast<size_t>(mode)][index] =
+                    vtbackend::apply(colorPalette, colorAt(index), target, mode);
+}
+
+bool ColorLookupTable::builtFrom(ColorPalette const& colorPalette) const noexcept
+{
+    return _built && _useBrightColors == colorPalette.useBrightColors && _palette == colorPalette.palette
+           && _defaultColors == defaultColorsOf(colorPalette);
+}
+
+namespace
+{
+    bool sameBackgroundImage(BackgroundImage const* a, BackgroundImage const* b) noexcept
+    {
+        if (!a || !b)
+            return a == b;
+        return a->hash == b->hash && a->opacity == b->opacity && a->blur == b->blur;
+    }
+} // namespace
+
+bool operator==(ColorPalette const& a, ColorPalette const& b) noexcept
+{
+    // clang-format off
+    return a.useBrightColors == b.useBrightColors
+        && a.palette == b.palette
+        && a.defaultForeground == b.defaultForeground
+        && a.defaultForegroundBright == b.defaultForegroundBright
+        && a.defaultForegroundDimmed == b.defaultForegroundDimmed
+        && a.defaultBackground == b.defaultBackground
+        && a.cursor == b.cursor
+        && a.mouseForeground == b.mouseForeground
+        && a.mouseBackground == b.mouseBackground
+        && a.hyperlinkDecoration.normal == b.hyperlinkDecoration.normal
+        && a.hyperlinkDecoration.hover == b.hyperlinkDecoration.hover
+        && a.inputMethodEditor == b.inputMethodEditor
+        && sameBackgroundImage(a.backgroundImage.get(), b.backgroundImage.get())
+        && a.yankHighlight == b.yankHighlight
+        && a.searchHighlight == b.searchHighlight
+        && a.searchHighlightFocused == b.searchHighlightFocused
+        && a.wordHighlight == b.wordHighlight
+        && a.wordHighlightCurrent == b.wordHighlightCurrent
+        && a.selection == b.selection
+        && a.normalModeCursorline == b.normalModeCursorline
+        && a.indicatorStatusLine == b.indicatorStatusLine
+        && a.indicatorStatusLineInactive == b.indicatorStatusLineInactive;
+    // clang-format on
+}
+
 } // namespace vtbackend
@@ -145,6 +145,70 @@ enum class ColorMode
 
 RGBColor apply(ColorPalette const& colorPalette, Color color, ColorTarget target, ColorMode mode) noexcept;
 
+/**
+ * Holds the result of apply() for all colors but RGB colors, as resolved against a color palette,
+ * such that resolving the colors of a cell is a table lookup in the common case.
+ *
+ * The table must be rebuilt whenever the palette's colors change, see builtFrom().
+ */
+class ColorLookupTable
+{
+  public:
+    ColorLookupTable() = default;
+    explicit ColorLookupTable(ColorPalette const& colorPalette) noexcept;
+
+    /// Indicates whether or not the table has been built from the colors of the given palette.
+    [[nodiscard]] bool builtFrom(ColorPalette const& colorPalette) const noexcept;
+
+    [[nodiscard]] bool useBrightColors() const noexcept { return _useBrightColors; }
+
+    [[nodiscard]] RGBColor apply(Color color, ColorTarget target, ColorMode mode) const noexcept
+    {
+        if (color.type() == ColorType::RGB)
+            return color.rgb();
+        return _colors[static_cast<size_t>(target)][static_cast<size_t>(mode)][indexOf(color)];
+    }
+
+  private:
+    // Indexed colors, followed by the 8 bright colors, followed by the default color.
+    static constexpr size_t ColorCount = 256 + 8 + 1;
+
+    [[nodiscard]] static size_t indexOf(Color color) noexcept
+    {
+        switch (color.type())
+        {
+            case ColorType::Indexed: return color.index();
+            case ColorType::Bright: return 256 + (color.index() & 7);
+            case ColorType::RGB:
+            case ColorType::Undefined:
+            case ColorType::Default: break;
+        }
+        return ColorCount - 1;
+    }
+
+    // The palette colors this table has been built from, see builtFrom().
+    ColorPalette::Palette _palette {};
+    std::array<RGBColor, 4> _defaultColors {};
+    bool _useBrightColors = false;
+    bool _built = false;
+
+    // Indexed by ColorTarget, ColorMode, and indexOf().
+    std::array<std::array<std::array<RGBColor, ColorCount>, 3>, 2> _colors {};
+};
+
+/// Same as apply() with the palette @p colors has been built from.
+[[nodiscard]] inline RGBColor apply(ColorLookupTable const& colors,
+                                    Color color,
+                                    ColorTarget target,
+                                    ColorMode mode) noexcept
+{
+    return colors.apply(color, target, mode);
+}
+
+/// Compares the colors of two palettes, with background images being equal if their hashes
+/// and their configuration are.
+bool operator==(ColorPalette const& a, ColorPalette const& b) noexcept;
+
 } // namespace vtbackend
 
 // {{{ fmtlib custom formatter support
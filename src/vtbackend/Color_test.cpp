@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <vtbackend/Color.h>
+#include <vtbackend/ColorPalette.h>
 
 #include <catch2/catch_test_macros.hpp>
 
@@ -33,3 +34,51 @@ TEST_CASE("Color.RGB", "[Color]")
     CHECK(rgb.green == 0x34);
     CHECK(rgb.blue == 0x56);
 }
+
+TEST_CASE("ColorPalette.equality", "[Color]")
+{
+    auto const a = ColorPalette {};
+    auto b = ColorPalette {};
+    CHECK(a == b);
+
+    b.palette[42] = 0x123456_rgb;
+    CHECK(!(a == b));
+
+    b = a;
+    b.cursor.color = 0xFF0000_rgb;
+    CHECK(!(a == b));
+
+    b = a;
+    b.selection.backgroundAlpha = 0.5f;
+    CHECK(!(a == b));
+
+    b = a;
+    b.backgroundImage = std::make_shared<BackgroundImage const>();
+    CHECK(!(a == b));
+}
+
+TEST_CASE("ColorLookupTable", "[Color]")
+{
+    auto palette = ColorPalette {};
+    palette.palette[3] = 0x112233_rgb;
+    palette.defaultForegroundDimmed = 0x444444_rgb;
+
+    auto const colors = ColorLookupTable { palette };
+    CHECK(colors.builtFrom(palette));
+
+    auto const samples = {
+        Color::Indexed(3), Color::Indexed(200), Color(BrightColor::Cyan), Color(0x123456_rgb), DefaultColor(),
+    };
+    for (auto const target: { ColorTarget::Foreground, ColorTarget::Background })
+        for (auto const mode: { ColorMode::Dimmed, ColorMode::Normal, ColorMode::Bright })
+            for (auto const color: samples)
+                CHECK(colors.apply(color, target, mode) == apply(palette, color, target, mode));
+
+    // The table is to be rebuilt once the palette changes.
+    palette.palette[3] = 0x332211_rgb;
+    CHECK(!colors.builtFrom(palette));
+    palette.palette[3] = 0x112233_rgb;
+    palette.defaultBackground = 0x101010_rgb;
+    CHECK(!colors.builtFrom(palette));
+    CHECK(!ColorLookupTable {}.builtFrom(ColorPalette {}));
+}
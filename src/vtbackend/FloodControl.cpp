@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/FloodControl.h>
+
+#include <algorithm>
+
+namespace vtbackend
+{
+
+void FloodControl::outputParsed(size_t bytes, duration parseTime, clock::time_point now) noexcept
+{
+    _parseTimeSinceFrame.fetch_add(parseTime.count());
+
+    // A gap in the output ends the current sample, without the gap being part of any sample.
+    auto const lastOutput = clock::time_point(duration(_lastOutput.exchange(now.time_since_epoch().count())));
+    if (now - lastOutput >= SampleInterval)
+    {
+        _sampleStart = now;
+        _sampleBytes = 0;
+        _floodStart = {};
+        _flooded = false;
+    }
+
+    _sampleBytes += bytes;
+    auto const elapsed = now - _sampleStart;
+    if (elapsed < SampleInterval)
+        return;
+
+    auto const seconds = std::chrono::duration<double>(elapsed).count();
+    auto const bytesPerSecond = static_cast<uint64_t>(static_cast<double>(_sampleBytes) / seconds);
+    _bytesPerSecond = bytesPerSecond;
+    if (bytesPerSecond >= FloodBytesPerSecond)
+    {
+        if (_floodStart == clock::time_point {})
+            _floodStart = _sampleStart;
+        if (now - _floodStart >= FloodDuration)
+            _flooded = true;
+    }
+    else if (bytesPerSecond < FloodBytesPerSecond / 2 || !_flooded)
+    {
+        _floodStart = {};
+        _flooded = false;
+    }
+
+    _sampleStart = now;
+    _sampleBytes = 0;
+}
+
+void FloodControl::frameBuilt(clock::time_point now) noexcept
+{
+    _lastFrame = now.time_since_epoch().count();
+    _parseTimePerFrame = _parseTimeSinceFrame.exchange(0);
+}
+
+bool FloodControl::flooded(clock::time_point now) const noexcept
+{
+    return _flooded && now - clock::time_point(duration(_lastOutput.load())) < SampleInterval;
+}
+
+FloodControl::duration FloodControl::frameDelay(clock::time_point now) const noexcept
+{
+    if (!flooded(now))
+        return duration::zero();
+
+    auto const nextFrame = clock::time_point(duration(_lastFrame.load())) + FloodFrameInterval;
+    return std::max(nextFrame - now, duration::zero());
+}
+
+FloodControl::Stats FloodControl::stats(clock::time_point now) const noexcept
+{
+    auto const idle = now - clock::time_point(duration(_lastOutput.load())) >= SampleInterval;
+    return Stats {
+        flooded(now),
+        idle ? 0 : _bytesPerSecond.load(),
+        duration(_parseTimePerFrame.load()),
+    };
+}
+
+} // namespace vtbackend
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vtbackend
+{
+
+/**
+ * Detects the terminal being flooded with output, e.g. from `cat`ing a huge file,
+ * in which case only few frames are to be rendered, letting the parser run unthrottled.
+ *
+ * The rate of the output is measured over consecutive sample intervals. The terminal is
+ * considered flooded once the rate stayed above FloodBytesPerSecond for FloodDuration,
+ * and no longer so once it dropped below half of it, or no output arrived for a sample interval.
+ *
+ * outputParsed() may be called from one thread (the one parsing the output), while all other
+ * methods may be called from any thread.
+ */
+class FloodControl
+{
+  public:
+    using clock = std::chrono::steady_clock;
+    using duration = clock::duration;
+
+    /// Output rate from which on the terminal is considered flooded.
+    static constexpr uint64_t FloodBytesPerSecond = 4 * 1024 * 1024;
+
+    /// Interval the output rate is measured over.
+    static constexpr auto SampleInterval = std::chrono::milliseconds(250);
+
+    /// Time the output rate must stay above FloodBytesPerSecond for the terminal to be considered flooded.
+    static constexpr auto FloodDuration = std::chrono::milliseconds(500);
+
+    /// Minimum time between two frames while flooded, i.e. rendering at most 10 frames per second.
+    static constexpr auto FloodFrameInterval = std::chrono::milliseconds(100);
+
+    struct Stats
+    {
+        bool flooded;
+        uint64_t bytesPerSecond;    // output rate measured over the last sample interval
+        duration parseTimePerFrame; // time spent parsing output in between the last two frames
+    };
+
+    /// Informs about @p bytes of output having been parsed at @p now, taking @p parseTime.
+    void outputParsed(size_t bytes, duration parseTime, clock::time_point now) noexcept;
+
+    /// Informs about a frame having been built at @p now.
+    void frameBuilt(clock::time_point now) noexcept;
+
+    [[nodiscard]] bool flooded(clock::time_point now) const noexcept;
+
+    /// @returns how long to wait at @p now before building the next frame, which is zero unless flooded.
+    [[nodiscard]] duration frameDelay(clock::time_point now) const noexcept;
+
+    [[nodiscard]] Stats stats(clock::time_point now) const noexcept;
+
+  private:
+    // Only accessed by the thread parsing the output.
+    clock::time_point _sampleStart {};
+    uint64_t _sampleBytes = 0;
+    clock::time_point _floodStart {}; // start of the output rate exceeding the threshold, if it does
+
+    std::atomic<bool> _flooded = false;
+    std::atomic<uint64_t> _bytesPerSecond = 0;
+    std::atomic<clock::rep> _lastOutput = 0; // times since the clock's epoch
+    std::atomic<clock::rep> _lastFrame = 0;
+    std::atomic<clock::rep> _parseTimeSinceFrame = 0;
+    std::atomic<clock::rep> _parseTimePerFrame = 0;
+};
+
+} // namespace vtbackend
+
+template <>
+struct fmt::formatter<vtbackend::FloodControl::Stats>: fmt::formatter<std::string>
+{
+    auto format(vtbackend::FloodControl::Stats const& stats, format_context& ctx) -> format_context::iterator
+    {
+        return formatter<std::string>::format(
+            fmt::format("{:.1f} MB/s, {:.1f} ms parse/frame",
+                        static_cast<double>(stats.bytesPerSecond) / (1024.0 * 1024.0),
+                        std::chrono::duration<double, std::milli>(stats.parseTimePerFrame).count()),
+            ctx);
+    }
+};
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/FloodControl.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+
+using namespace std::chrono_literals;
+using vtbackend::FloodControl;
+
+namespace
+{
+
+auto const start = FloodControl::clock::time_point {} + 1h;
+
+// Feeds output at the given rate in chunks of 10ms from @p from until @p to.
+void feed(FloodControl& floodControl,
+          size_t bytesPerSecond,
+          FloodControl::clock::duration from,
+          FloodControl::clock::duration to)
+{
+    for (auto t = from; t < to; t += 10ms)
+        floodControl.outputParsed(bytesPerSecond / 100, 1ms, start + t);
+}
+
+} // namespace
+
+TEST_CASE("FloodControl.idle", "[FloodControl]")
+{
+    auto floodControl = FloodControl {};
+    CHECK(!floodControl.flooded(start));
+    CHECK(floodControl.frameDelay(start) == 0ms);
+    CHECK(floodControl.stats(start).bytesPerSecond == 0);
+
+    // Interactive output rates never flood.
+    feed(floodControl, 64 * 1024, 0ms, 2s);
+    CHECK(!floodControl.flooded(start + 2s));
+    CHECK(floodControl.stats(start + 2s).bytesPerSecond > 0);
+}
+
+TEST_CASE("FloodControl.sustained", "[FloodControl]")
+{
+    auto constexpr Rate = 2 * FloodControl::FloodBytesPerSecond;
+    auto floodControl = FloodControl {};
+
+    // Short bursts do not flood.
+    feed(floodControl, Rate, 0ms, 400ms);
+    CHECK(!floodControl.flooded(start + 400ms));
+
+    feed(floodControl, Rate, 400ms, 1s);
+    CHECK(floodControl.flooded(start + 1s));
+    CHECK(floodControl.stats(start + 1s).flooded);
+
+    // While flooded, frames are rendered at a lowered rate.
+    floodControl.frameBuilt(start + 1s);
+    CHECK(floodControl.frameDelay(start + 1s) == FloodControl::FloodFrameInterval);
+    CHECK(floodControl.frameDelay(start + 1s + 60ms) == FloodControl::FloodFrameInterval - 60ms);
+    CHECK(floodControl.frameDelay(start + 1s + 200ms) == 0ms);
+
+    // The parse time in between two frames is accumulated.
+    floodControl.outputParsed(1024, 2ms, start + 1s + 5ms);
+    floodControl.outputParsed(1024, 3ms, start + 1s + 8ms);
+    floodControl.frameBuilt(start + 1s + 10ms);
+    CHECK(floodControl.stats(start + 1s + 10ms).parseTimePerFrame == 5ms);
+
+    // Output stopping ends the flood.
+    CHECK(!floodControl.flooded(start + 2s));
+    CHECK(floodControl.frameDelay(start + 2s) == 0ms);
+}
+
+TEST_CASE("FloodControl.hysteresis", "[FloodControl]")
+{
+    auto floodControl = FloodControl {};
+    feed(floodControl, 2 * FloodControl::FloodBytesPerSecond, 0ms, 1s);
+    REQUIRE(floodControl.flooded(start + 1s));
+
+    // Rates slightly below the threshold keep the terminal flooded.
+    feed(floodControl, FloodControl::FloodBytesPerSecond * 3 / 4, 1s, 2s);
+    CHECK(floodControl.flooded(start + 2s));
+
+    feed(floodControl, FloodControl::FloodBytesPerSecond / 4, 2s, 3s);
+    CHECK(!floodControl.flooded(start + 3s));
+}
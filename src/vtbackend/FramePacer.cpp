@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/FramePacer.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace vtbackend
+{
+
+namespace
+{
+    // Frames are not presented at every vertical blank, so the time between two presented frames
+    // is taken as a multiple of the vertical blank interval, up to this many.
+    constexpr auto MaxVsyncIntervalsBetweenFrames = 8;
+} // namespace
+
+void FramePacer::reset() noexcept
+{
+    _lastVsync.store(0);
+    _interval.store(0);
+}
+
+void FramePacer::vsyncPresented(clock::time_point now) noexcept
+{
+    auto const current = now.time_since_epoch().count();
+    auto const last = _lastVsync.exchange(current);
+    if (last == 0 || current <= last)
+        return;
+
+    auto const elapsed = current - last;
+    auto const interval = _interval.load();
+    if (interval == 0)
+    {
+        if (duration(elapsed) <= MaxVsyncInterval)
+            _interval.store(elapsed);
+        return;
+    }
+
+    auto const intervals =
+        std::max(std::lround(static_cast<double>(elapsed) / static_cast<double>(interval)), 1L);
+    if (intervals > MaxVsyncIntervalsBetweenFrames)
+        return;
+
+    // Smoothes out the jitter of the times the display reports frames as presented at.
+    auto const sample = elapsed / intervals;
+    _interval.store(interval + (sample - interval) / 8);
+}
+
+void FramePacer::frameBuilt(duration buildTime) noexcept
+{
+    // Follows increases immediately but decreases slowly, so that occasional slow frames are accounted for.
+    auto const sample = buildTime.count();
+    auto const current = _buildTime.load();
+    _buildTime.store(sample >= current ? sample : current - (current - sample) / 8);
+}
+
+std::optional<FramePacer::clock::time_point> FramePacer::nextDeadline(
+    clock::time_point now, clock::time_point lastBuild) const noexcept
+{
+    auto const interval = vsyncInterval();
+    auto const lastVsync = clock::time_point(duration(_lastVsync.load()));
+    if (interval <= duration::zero() || now - lastVsync > MaxVsyncAge)
+        return std::nullopt;
+
+    // When to start building the frame to be shown at the first vertical blank after now.
+    auto const lead = buildTime() + RenderMargin;
+    auto deadline = lastVsync + ((now - lastVsync) / interval + 1) * interval - lead;
+
+    // Starting to build within the render margin past the deadline still makes it in time,
+    // any later it is the next vertical blank to build the frame for.
+    while (deadline + RenderMargin < now)
+        deadline += interval;
+
+    // Only a single frame is built for each vertical blank.
+    while (lastBuild >= deadline)
+        deadline += interval;
+
+    return deadline;
+}
+
+} // namespace vtbackend
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+
+namespace vtbackend
+{
+
+/**
+ * Paces the building of render buffers to the vertical blanks of the display.
+ *
+ * The display feeds the times it presented frames at, from which the phase and interval of its
+ * vertical blanks are estimated. Together with the measured time it takes to build a frame,
+ * this yields the deadline for building the frame to be shown at the next vertical blank:
+ * building it earlier would show stale contents, or build frames that are replaced before ever
+ * being shown, and building it later would miss the vertical blank.
+ *
+ * vsyncPresented() may be called from one thread (the render thread), while frameBuilt() and
+ * nextDeadline() may be called from another one (the thread building the render buffers).
+ */
+class FramePacer
+{
+  public:
+    using clock = std::chrono::steady_clock;
+    using duration = clock::duration;
+
+    /// Time reserved in addition to the build time, for the renderer to draw the frame.
+    static constexpr auto RenderMargin = std::chrono::milliseconds(2);
+
+    /// Longest vertical blank interval accepted, corresponding to a refresh rate of 10 Hz.
+    static constexpr auto MaxVsyncInterval = std::chrono::milliseconds(100);
+
+    /// Without a frame presented for this long, the phase of the vertical blanks is considered unknown,
+    /// as the display does not present frames while idle.
+    static constexpr auto MaxVsyncAge = std::chrono::seconds(1);
+
+    /// Forgets about the vertical blanks, e.g. after the display's refresh rate has changed.
+    void reset() noexcept;
+
+    /// Informs about a frame having been presented at @p now, i.e. at a vertical blank.
+    void vsyncPresented(clock::time_point now) noexcept;
+
+    /// Informs about a frame having taken @p buildTime to be built.
+    void frameBuilt(duration buildTime) noexcept;
+
+    /// @returns the estimated interval of the display's vertical blanks, or zero if not known yet.
+    [[nodiscard]] duration vsyncInterval() const noexcept { return duration(_interval.load()); }
+
+    /// @returns the estimated time it takes to build a frame.
+    [[nodiscard]] duration buildTime() const noexcept { return duration(_buildTime.load()); }
+
+    /// Computes when to start building the next frame, such that it is ready just in time
+    /// for the next vertical blank it can still be shown at.
+    ///
+    /// @param now        the current time
+    /// @param lastBuild  the time the most recent frame was started to be built at
+    ///
+    /// @returns the deadline, which lies in the past if the frame is due,
+    ///          or std::nullopt if the vertical blanks are not known.
+    [[nodiscard]] std::optional<clock::time_point> nextDeadline(
+        clock::time_point now, clock::time_point lastBuild) const noexcept;
+
+  private:
+    std::atomic<clock::rep> _lastVsync = 0; // time since the clock's epoch, zero if none presented yet
+    std::atomic<clock::rep> _interval = 0;  // zero until two frames have been presented
+    std::atomic<clock::rep> _buildTime = 0; // decaying maximum of recent build times
+};
+
+} // namespace vtbackend
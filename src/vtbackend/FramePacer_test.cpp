@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/FramePacer.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+
+using namespace std::chrono_literals;
+using vtbackend::FramePacer;
+
+namespace
+{
+
+auto const start = FramePacer::clock::time_point {} + 1h;
+
+} // namespace
+
+TEST_CASE("FramePacer.unsynchronized", "[FramePacer]")
+{
+    auto pacer = FramePacer {};
+    CHECK(!pacer.nextDeadline(start, {}).has_value());
+
+    // A single presented frame does not tell the vertical blank interval yet.
+    pacer.vsyncPresented(start);
+    CHECK(pacer.vsyncInterval() == 0ms);
+    CHECK(!pacer.nextDeadline(start + 1ms, {}).has_value());
+
+    // Pacing stops once the display has been idle for a while.
+    pacer.vsyncPresented(start + 10ms);
+    CHECK(pacer.vsyncInterval() == 10ms);
+    CHECK(pacer.nextDeadline(start + 11ms, {}).has_value());
+    CHECK(!pacer.nextDeadline(start + 10ms + FramePacer::MaxVsyncAge + 1ms, {}).has_value());
+
+    pacer.reset();
+    CHECK(!pacer.nextDeadline(start + 11ms, {}).has_value());
+}
+
+TEST_CASE("FramePacer.interval", "[FramePacer]")
+{
+    auto pacer = FramePacer {};
+    pacer.vsyncPresented(start);
+    pacer.vsyncPresented(start + 10ms);
+
+    // Frames skipping vertical blanks still refine the interval.
+    pacer.vsyncPresented(start + 30ms + 800us);
+    CHECK(pacer.vsyncInterval() == 10ms + 50us);
+
+    // Gaps of too many vertical blanks are ignored.
+    pacer.vsyncPresented(start + 1s);
+    CHECK(pacer.vsyncInterval() == 10ms + 50us);
+}
+
+TEST_CASE("FramePacer.deadline", "[FramePacer]")
+{
+    auto pacer = FramePacer {};
+    pacer.vsyncPresented(start);
+    pacer.vsyncPresented(start + 10ms);
+    pacer.frameBuilt(3ms);
+
+    // Vertical blanks are at start + 10ms * N, frames are to be started build time plus margin earlier.
+    auto const lead = 3ms + FramePacer::RenderMargin;
+    CHECK(pacer.nextDeadline(start + 11ms, {}) == start + 20ms - lead);
+    CHECK(pacer.nextDeadline(start + 20ms - lead, {}) == start + 20ms - lead);
+
+    // Within the render margin past the deadline, the frame still makes it in time.
+    CHECK(pacer.nextDeadline(start + 20ms - lead + 1ms, {}) == start + 20ms - lead);
+
+    // Too late for the upcoming vertical blank, the frame is built for the one thereafter.
+    CHECK(pacer.nextDeadline(start + 19ms, {}) == start + 30ms - lead);
+
+    // A frame is only built once per vertical blank.
+    CHECK(pacer.nextDeadline(start + 16ms, start + 15ms) == start + 30ms - lead);
+}
+
+TEST_CASE("FramePacer.buildTime", "[FramePacer]")
+{
+    auto pacer = FramePacer {};
+    pacer.frameBuilt(2ms);
+    CHECK(pacer.buildTime() == 2ms);
+
+    // Slow frames are accounted for immediately, faster ones only gradually.
+    pacer.frameBuilt(10ms);
+    CHECK(pacer.buildTime() == 10ms);
+    pacer.frameBuilt(2ms);
+    CHECK(pacer.buildTime() == 9ms);
+}
@@ -151,6 +151,7 @@ constexpr inline auto RCOLORMOUSEBG = FunctionDocumentation { .mnemonic = "RCOLO
 constexpr inline auto RCOLORMOUSEFG = FunctionDocumentation { .mnemonic = "RCOLORMOUSEFG", .comment = "Reset mouse foreground color." };
 constexpr inline auto RCOLPAL = FunctionDocumentation { .mnemonic = "RCOLPAL", .comment = "Reset color full palette or entry" };
 constexpr inline auto SETCOLPAL = FunctionDocumentation { .mnemonic = "SETCOLPAL", .comment = "Set/Query color palette" };
+constexpr inline auto SEMANTICPROMPT = FunctionDocumentation { .mnemonic = "SEMANTICPROMPT", .comment = "Shell integration marks." };
 constexpr inline auto SETCWD = FunctionDocumentation { .mnemonic = "SETCWD", .comment = "Set current working directory" };
 constexpr inline auto SETFONT = FunctionDocumentation { .mnemonic = "SETFONT", .comment = "Get or set font." };
 constexpr inline auto SETFONTALL = FunctionDocumentation { .mnemonic = "SETFONTALL", .comment = "Get or set all font faces, styles, size." };
@@ -611,6 +612,7 @@ constexpr inline auto RCOLORHIGHLIGHTFG = detail::OSC(119, VTExtension::XTerm, d
 constexpr inline auto RCOLORMOUSEBG     = detail::OSC(114, VTExtension::XTerm, documentation::RCOLORMOUSEBG);
 constexpr inline auto RCOLORMOUSEFG     = detail::OSC(113, VTExtension::XTerm, documentation::RCOLORMOUSEFG);
 constexpr inline auto RCOLPAL           = detail::OSC(104, VTExtension::XTerm, documentation::RCOLPAL);
+constexpr inline auto SEMANTICPROMPT    = detail::OSC(133, VTExtension::Unknown, documentation::SEMANTICPROMPT);
 constexpr inline auto SETCOLPAL         = detail::OSC(4, VTExtension::XTerm, documentation::SETCOLPAL);
 constexpr inline auto SETCWD            = detail::OSC(7, VTExtension::XTerm, documentation::SETCWD);
 constexpr inline auto SETFONT           = detail::OSC(50, VTExtension::XTerm, documentation::SETFONT);
@@ -771,6 +773,7 @@ constexpr static auto allFunctionsArray() noexcept
         RCOLORHIGHLIGHTFG,
         RCOLORHIGHLIGHTBG,
         NOTIFY,
+        SEMANTICPROMPT,
         DUMPSTATE,
     };
     return funcs;
@@ -805,7 +808,34 @@ class SupportedSequences
 
     [[nodiscard]] constexpr auto cend() const noexcept { return cbegin() + _lastIndex; }
 
+    /// Number of distinct final symbols per function category in the selection index.
+    static constexpr size_t FinalSymbolCount = 128;
+    static constexpr size_t IndexSize = (static_cast<size_t>(FunctionCategory::DCS) + 1) * FinalSymbolCount;
+
+    [[nodiscard]] static constexpr size_t indexKey(FunctionCategory category, char finalSymbol) noexcept
+    {
+        return static_cast<size_t>(category) * FinalSymbolCount + static_cast<uint8_t>(finalSymbol);
+    }
+
+    /// Rebuilds the (category, final symbol) index into the sorted active sequences.
+    ///
+    /// This relies on the active sequences being sorted by category and final symbol first,
+    /// such that each index slot maps to a contiguous range.
+    constexpr void rebuildIndex() noexcept
+    {
+        auto i = size_t { 0 };
+        for (size_t key = 0; key <= IndexSize; ++key)
+        {
+            while (i < _lastIndex
+                   && indexKey(_supportedSequences[i].category, _supportedSequences[i].finalSymbol) < key)
+                ++i;
+            _index[key] = static_cast<uint16_t>(i);
+        }
+    }
+
   public:
+    SupportedSequences() noexcept { rebuildIndex(); }
+
     [[nodiscard]] constexpr gsl::span<FunctionDefinition const> allSequences() const noexcept
     {
         return gsl::span<FunctionDefinition const>(cbegin(), _supportedSequences.size());
@@ -830,6 +860,7 @@ class SupportedSequences
         crispy::sort(
             availableDefinition,
             [](FunctionDefinition const& a, FunctionDefinition const& b) constexpr { return compare(a, b); });
+        rebuildIndex();
     }
 
     CRISPY_CONSTEXPR void disableSequence(FunctionDefinition seq) noexcept
@@ -840,6 +871,7 @@ class SupportedSequences
             // Move the disabled sequence to the end of array, keep the rest of active sequences sorted
             std::rotate(seqIter, seqIter + 1, _supportedSequences.data() + _supportedSequences.size());
             --_lastIndex;
+            rebuildIndex();
         }
     }
 
@@ -856,12 +888,22 @@ class SupportedSequences
             crispy::sort(arr, [](FunctionDefinition const& a, FunctionDefinition const& b) constexpr {
                 return compare(a, b);
             });
+            rebuildIndex();
         }
     }
 
+    /// Selects the active FunctionDefinition matching the given selector.
+    ///
+    /// @return the matching FunctionDefinition or nullptr if none matched.
+    [[nodiscard]] FunctionDefinition const* select(FunctionSelector const& selector) const noexcept;
+
   private:
     std::array<FunctionDefinition, allFunctionsArray().size()> _supportedSequences = allFunctions();
     size_t _lastIndex = allFunctions().size(); // No of total active sequences
+
+    /// Maps indexKey(category, finalSymbol) to the first active sequence with that key.
+    /// The range for a given key is therefore [_index[key], _index[key + 1]).
+    std::array<uint16_t, IndexSize + 1> _index {};
 };
 
 /// Selects a FunctionDefinition based on a FunctionSelector.
@@ -917,6 +959,21 @@ inline FunctionDefinition const* selectOSCommand(int id,
     return select({ FunctionCategory::OSC, 0, id, 0, 0 }, availableDefinition);
 }
 
+inline FunctionDefinition const* SupportedSequences::select(FunctionSelector const& selector) const noexcept
+{
+    if (static_cast<uint8_t>(selector.finalSymbol) >= FinalSymbolCount)
+        return nullptr;
+
+    // Only the (usually very few) definitions sharing category and final symbol need to be searched.
+    auto const key = indexKey(selector.category, selector.finalSymbol);
+    auto const first = static_cast<size_t>(_index[key]);
+    auto const last = static_cast<size_t>(_index[key + 1]);
+    if (first == last)
+        return nullptr;
+
+    return vtbackend::select(selector, activeSequences().subspan(first, last - first));
+}
+
 } // namespace vtbackend
 
 template <>
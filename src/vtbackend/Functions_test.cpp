@@ -96,3 +96,30 @@ TEST_CASE("Functions.EnableAndDisable", "[Functions]")
     REQUIRE(f);
     CHECK(*f == DECSLRM);
 }
+
+TEST_CASE("Functions.IndexedSelect", "[Functions]")
+{
+    SupportedSequences availableSequences;
+
+    // Every active definition must be found via the index exactly as via the binary search.
+    for (auto const& definition: availableSequences.activeSequences())
+    {
+        auto const argc = definition.category == FunctionCategory::OSC
+                              ? static_cast<int>(definition.maximumParameters)
+                              : static_cast<int>(definition.minimumParameters);
+        auto const selector = FunctionSelector {
+            definition.category, definition.leader, argc, definition.intermediate, definition.finalSymbol
+        };
+        INFO(fmt::format("{}", definition));
+        CHECK(availableSequences.select(selector)
+              == vtbackend::select(selector, availableSequences.activeSequences()));
+    }
+
+    // The index must follow enabling and disabling of sequences.
+    auto const selector = FunctionSelector { FunctionCategory::CSI, 0, 2, 0, 's' };
+    availableSequences.disableSequence(DECSLRM);
+    CHECK(availableSequences.select(selector) == nullptr);
+    availableSequences.enableSequence(DECSLRM);
+    REQUIRE(availableSequences.select(selector) != nullptr);
+    CHECK(*availableSequences.select(selector) == DECSLRM);
+}
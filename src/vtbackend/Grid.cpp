@@ -1,14 +1,27 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <vtbackend/Grid.h>
+#include <vtbackend/cell/CompactCell.h>
 #include <vtbackend/primitives.h>
 
 #include <crispy/assert.h>
 #include <crispy/logstore.h>
+#include <crispy/utils.h>
 
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <optional>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 using std::max;
 using std::min;
@@ -19,7 +32,7 @@ using std::vector;
 namespace vtbackend
 {
 
-auto const inline gridLog = logstore::category(
+auto const inline gridLog = logstore::trace_category(
     "vt.grid", "Grid related", logstore::category::state::Disabled, logstore::category::visibility::Hidden);
 
 namespace detail
@@ -37,7 +50,8 @@ namespace detail
     Lines<Cell> createLines(PageSize pageSize,
                             LineCount maxHistoryLineCount,
                             bool reflowOnResize,
-                            GraphicsAttributes initialSGR)
+                            GraphicsAttributes initialSGR,
+                            std::pmr::memory_resource* cellResource)
     {
         auto const defaultLineFlags = reflowOnResize ? LineFlag::Wrappable : LineFlag::None;
         auto const totalLineCount = unbox<size_t>(pageSize.lines + maxHistoryLineCount);
@@ -46,7 +60,8 @@ namespace detail
         lines.reserve(totalLineCount);
 
         for ([[maybe_unused]] auto const _: ranges::views::iota(0u, totalLineCount))
-            lines.emplace_back(defaultLineFlags, TrivialLineBuffer { pageSize.columns, initialSGR });
+            lines.emplace_back(
+                defaultLineFlags, TrivialLineBuffer { pageSize.columns, initialSGR }, cellResource);
 
         return lines;
     }
@@ -96,6 +111,369 @@ namespace detail
         return LineCount::cast_from(i);
     }
 
+    /**
+     * Moves the logical line made up of the trivial lines lines[begin] up to lines[end - 1] into targetLines,
+     * reflowed to the given column count as trivial lines, by slicing their text and attribute runs
+     * rather than inflating them just to be wrapped anew.
+     *
+     * @returns number of inserted lines, or std::nullopt if the logical line is to be reflowed cell-wise
+     *          (leaving the lines untouched), e.g. as it contains blank columns within,
+     *          or a wide character would be split.
+     */
+    template <typename Cell>
+    std::optional<LineCount> reflowTrivialLogicalLine(
+        Lines<Cell>& targetLines, Lines<Cell>& lines, int begin, int end, ColumnCount newColumnCount)
+    {
+        // Only lines filled up to their width continue in the next line without blank columns in between.
+        auto columnCount = size_t { 0 };
+        auto lastLineStart = size_t { 0 };
+        auto ascii = true;
+        for (auto i = begin; i != end; ++i)
+        {
+            if (!lines[i].isTrivialBuffer())
+                return std::nullopt;
+            auto const& buffer = lines[i].trivialBuffer();
+            if (i + 1 != end && buffer.usedColumns != buffer.displayWidth)
+                return std::nullopt;
+            lastLineStart = columnCount;
+            columnCount += unbox<size_t>(buffer.usedColumns);
+            ascii = ascii && buffer.isAscii();
+        }
+
+        // The text of the logical line, which is referenced directly if the lines' texts are adjacent
+        // in the same buffer object (e.g. as written by the application in one go), or copied otherwise.
+        auto text = crispy::BufferFragment<char> {};
+        auto textSize = size_t { 0 };
+        auto contiguous = true;
+        for (auto i = begin; i != end; ++i)
+        {
+            auto const& fragment = lines[i].trivialBuffer().text;
+            if (fragment.empty())
+                continue;
+            if (text.empty())
+                text = fragment;
+            else if (fragment.owner() == text.owner() && text.data() + text.size() == fragment.data())
+                text.growBy(fragment.size());
+            else
+                contiguous = false;
+            textSize += fragment.size();
+        }
+        if (!contiguous)
+        {
+            auto buffer = crispy::buffer_object<char>::create(textSize);
+            auto target = buffer->advance(textSize);
+            auto offset = size_t { 0 };
+            for (auto i = begin; i != end; ++i)
+            {
+                auto const source = lines[i].trivialBuffer().text.view();
+                std::copy(source.begin(), source.end(), target.begin() + static_cast<std::ptrdiff_t>(offset));
+                offset += source.size();
+            }
+            text = buffer->ref(0, textSize);
+        }
+
+        // Byte offsets and attribute runs of the logical line, indexed by (or starting at) logical columns.
+        auto byteOffsets = std::vector<size_t> {};
+        auto runs = std::vector<TrivialLineSpan> {};
+        {
+            auto columnBase = 0;
+            auto byteBase = size_t { 0 };
+            for (auto i = begin; i != end; ++i)
+            {
+                auto const& buffer = lines[i].trivialBuffer();
+                auto const addRun = [&](int column, GraphicsAttributes const& attributes, HyperlinkId link) {
+                    if (runs.empty() || runs.back().attributes != attributes || runs.back().hyperlink != link)
+                        runs.emplace_back(TrivialLineSpan { ColumnOffset(column), attributes, link });
+                };
+                if (buffer.usedColumns > ColumnCount(0))
+                {
+                    addRun(columnBase, buffer.textAttributes, buffer.hyperlink);
+                    for (auto const& span: buffer.spans)
+                        addRun(columnBase + unbox(span.start), span.attributes, span.hyperlink);
+                }
+                if (!ascii)
+                    for (auto column = 0; column < unbox(buffer.usedColumns); ++column)
+                        byteOffsets.push_back(byteBase + buffer.byteOffsetAt(ColumnOffset(column)));
+                columnBase += unbox(buffer.usedColumns);
+                byteBase += buffer.text.size();
+            }
+        }
+        auto const byteOffsetAt = [&](size_t column) {
+            return column >= columnCount ? textSize : ascii ? column : byteOffsets[column];
+        };
+
+        // Trailing blanks are only insignificant at the end of the logical line.
+        while (columnCount > lastLineStart && byteOffsetAt(columnCount - 1) + 1 == textSize
+               && text.view()[textSize - 1] == ' ')
+        {
+            --columnCount;
+            --textSize;
+        }
+        if (columnCount == 0)
+            return std::nullopt;
+        while (!runs.empty() && unbox<size_t>(runs.back().start) >= columnCount)
+            runs.pop_back();
+
+        auto const& lastBuffer = lines[end - 1].trivialBuffer();
+        auto const baseFlags = lines[begin].flags().without(LineFlag::Wrapped);
+        auto const width = unbox<size_t>(newColumnCount);
+
+        auto newLines = std::vector<Line<Cell>> {};
+        newLines.reserve((columnCount + width - 1) / width);
+        auto run = runs.begin();
+        for (auto start = size_t { 0 }; start < columnCount; start += width)
+        {
+            auto const stop = std::min(start + width, columnCount);
+            auto const startByte = byteOffsetAt(start);
+            auto const byteCount = byteOffsetAt(stop) - startByte;
+            if (!ascii && start > 0 && byteOffsets[start] == byteOffsets[start - 1])
+                return std::nullopt; // wide character split
+            while (std::next(run) != runs.end() && unbox<size_t>(std::next(run)->start) <= start)
+                ++run;
+
+            auto buffer = TrivialLineBuffer { newColumnCount, run->attributes, lastBuffer.fillAttributes };
+            buffer.hyperlink = run->hyperlink;
+            buffer.usedColumns = ColumnCount::cast_from(stop - start);
+            buffer.text =
+                crispy::BufferFragment<char>(text.owner(), text.span().subspan(startByte, byteCount));
+            if (byteCount != stop - start)
+            {
+                if (byteCount > std::numeric_limits<uint16_t>::max())
+                    return std::nullopt;
+                buffer.columnOffsets.reserve(stop - start);
+                for (auto column = start; column < stop; ++column)
+                    buffer.columnOffsets.push_back(static_cast<uint16_t>(byteOffsets[column] - startByte));
+            }
+            for (auto next = std::next(run); next != runs.end() && unbox<size_t>(next->start) < stop; ++next)
+            {
+                auto const column = ColumnOffset::cast_from(unbox<size_t>(next->start) - start);
+                buffer.spans.emplace_back(TrivialLineSpan { column, next->attributes, next->hyperlink });
+            }
+            if (buffer.spans.size() > TrivialLineBuffer::MaxSpans)
+                return std::nullopt;
+
+            auto const wrappedFlag = newLines.empty() ? LineFlag::None : LineFlag::Wrapped;
+            newLines.emplace_back(baseFlags | wrappedFlag, std::move(buffer), lines[begin].cellResource());
+        }
+
+        for (auto& line: newLines)
+            targetLines.emplace_back(std::move(line));
+        return LineCount::cast_from(newLines.size());
+    }
+
+    /**
+     * Moves the logical line made up of lines[begin] and the lines wrapped into it (up to lines[end - 1])
+     * into targetLines, reflowed to the given column count.
+     *
+     * Unlike the reflow in Grid::resize(), the lines may be laid out for any column count.
+     *
+     * The source lines are only read or moved from, and any new cells are allocated from the default
+     * memory resource rather than the lines' cell resource, such that disjoint ranges of the same lines
+     * can be reflowed concurrently.
+     *
+     * @returns number of inserted lines
+     */
+    template <typename Cell>
+    LineCount reflowLogicalLine(
+        Lines<Cell>& targetLines, Lines<Cell>& lines, int begin, int end, ColumnCount newColumnCount)
+    {
+        using LineBuffer = typename Line<Cell>::InflatedBuffer;
+
+        // Moves the given line into targetLines, truncated or filled up to newColumnCount.
+        auto const appendResized = [&](Line<Cell>& line) {
+            if (line.isTrivialBuffer())
+            {
+                line.trivialBuffer().displayWidth = newColumnCount;
+                targetLines.emplace_back(std::move(line));
+            }
+            else if (line.size() == newColumnCount)
+                targetLines.emplace_back(std::move(line));
+            else
+            {
+                auto const cells = line.cells().first(unbox<size_t>(std::min(line.size(), newColumnCount)));
+                auto buffer = LineBuffer(cells.begin(), cells.end());
+                buffer.resize(unbox<size_t>(newColumnCount));
+                targetLines.emplace_back(line.flags(), std::move(buffer));
+            }
+        };
+
+        auto& firstLine = lines[begin];
+
+        if (end - begin == 1 && firstLine.isTrivialBuffer()
+            && firstLine.trivialBuffer().usedColumns <= newColumnCount)
+        {
+            appendResized(firstLine);
+            return LineCount(1);
+        }
+
+        if (!firstLine.wrappable())
+        {
+            for (auto i = begin; i != end; ++i)
+                appendResized(lines[i]);
+            return LineCount::cast_from(end - begin);
+        }
+
+        if (auto const count = reflowTrivialLogicalLine(targetLines, lines, begin, end, newColumnCount))
+            return *count;
+
+        auto logicalLineBuffer = LineBuffer {};
+        for (auto i = begin; i != end; ++i)
+        {
+            auto const& line = lines[i];
+            auto const inflated =
+                line.isTrivialBuffer() ? inflate<Cell>(line.trivialBuffer()) : LineBuffer {};
+            auto cells = line.isTrivialBuffer() ? gsl::span<Cell const>(inflated) : line.cells();
+
+            // Trailing blanks are only insignificant at the end of the logical line.
+            if (i + 1 == end)
+                while (!cells.empty() && cells.back().empty())
+                    cells = cells.first(cells.size() - 1);
+
+            logicalLineBuffer.insert(logicalLineBuffer.end(), cells.begin(), cells.end());
+        }
+
+        if (logicalLineBuffer.empty())
+        {
+            appendResized(firstLine);
+            return LineCount(1);
+        }
+
+        return addNewWrappedLines(targetLines,
+                                  newColumnCount,
+                                  std::move(logicalLineBuffer),
+                                  firstLine.flags().without(LineFlag::Wrapped),
+                                  true);
+    }
+
+    /// Reflows all logical lines within lines[begin] up to lines[end - 1] into targetLines.
+    template <typename Cell>
+    void reflowLogicalLinesSequential(
+        Lines<Cell>& targetLines, Lines<Cell>& lines, int begin, int end, ColumnCount newColumnCount)
+    {
+        for (auto i = begin; i < end;)
+        {
+            auto next = i + 1;
+            while (next < end && lines[next].wrapped())
+                ++next;
+            reflowLogicalLine(targetLines, lines, i, next, newColumnCount);
+            i = next;
+        }
+    }
+
+    /// Reflows all logical lines within lines[begin] up to lines[end - 1] into targetLines,
+    /// with large ranges being split at logical line boundaries and reflowed concurrently.
+    ///
+    /// lines[begin] must start a logical line, and lines[end] must not be wrapped into lines[end - 1].
+    template <typename Cell>
+    void reflowLogicalLines(
+        Lines<Cell>& targetLines, Lines<Cell>& lines, int begin, int end, ColumnCount newColumnCount)
+    {
+        auto constexpr MinLinesPerTask = 16 * 1024;
+
+        auto const taskCount = std::min<int>(
+            std::max(1U, std::thread::hardware_concurrency()), std::max(1, (end - begin) / MinLinesPerTask));
+        if (taskCount <= 1)
+        {
+            reflowLogicalLinesSequential(targetLines, lines, begin, end, newColumnCount);
+            return;
+        }
+
+        auto splits = std::vector<int> { begin };
+        for (auto k = 1; k < taskCount; ++k)
+        {
+            auto split = begin + static_cast<int>(static_cast<int64_t>(end - begin) * k / taskCount);
+            while (split > splits.back() && lines[split].wrapped())
+                --split;
+            if (split > splits.back())
+                splits.push_back(split);
+        }
+        splits.push_back(end);
+
+        // The first range is reflowed on the calling thread, and directly into targetLines.
+        auto results = std::vector<Lines<Cell>>(splits.size() - 2);
+        auto tasks = std::vector<std::future<void>>();
+        tasks.reserve(results.size());
+        for (size_t k = 0; k < results.size(); ++k)
+            tasks.emplace_back(std::async(std::launch::async, [&, k]() {
+                reflowLogicalLinesSequential(results[k], lines, splits[k + 1], splits[k + 2], newColumnCount);
+            }));
+
+        reflowLogicalLinesSequential(targetLines, lines, splits[0], splits[1], newColumnCount);
+
+        for (size_t k = 0; k < results.size(); ++k)
+        {
+            tasks[k].get();
+            for (auto& line: results[k])
+                targetLines.emplace_back(std::move(line));
+        }
+    }
+
+    // Returns the codepoints of the line's cells as indexed by SearchIndex, without inflating the line.
+    template <typename Cell>
+    u32string searchIndexText(Line<Cell> const& line)
+    {
+        if (line.isTrivialBuffer())
+            return unicode::convert_to<char32_t>(line.trivialBuffer().text.view());
+
+        auto text = u32string {};
+        text.reserve(line.inflatedBuffer().size());
+        for (auto const& cell: line.inflatedBuffer())
+            text.push_back(cell.codepointCount() ? cell.codepoint(0) : 0);
+        return text;
+    }
+
+    void hashAttributes(crispy::strong_hash_stream& hash, GraphicsAttributes const& attributes)
+    {
+        hash.update(attributes.foregroundColor.content)
+            .update(attributes.backgroundColor.content)
+            .update(attributes.underlineColor.content)
+            .update(static_cast<uint32_t>(attributes.flags.value()));
+    }
+
+    // Hashes everything of the line that is rendered, in whichever representation it is stored.
+    // A line that has merely been inflated since is therefore considered modified.
+    template <typename Cell>
+    crispy::strong_hash hashLineContents(Line<Cell> const& line)
+    {
+        auto hash = crispy::strong_hash_stream {};
+        hash.update(static_cast<uint32_t>(line.flags().value()));
+        if (line.isTrivialBuffer())
+        {
+            auto const& buffer = line.trivialBuffer();
+            hash.update(uint32_t { 0 })
+                .update(unbox<uint32_t>(buffer.displayWidth))
+                .update(unbox<uint32_t>(buffer.usedColumns))
+                .update(unbox<uint16_t>(buffer.hyperlink))
+                .update(static_cast<uint32_t>(buffer.text.size()))
+                .update(buffer.text.view());
+            hashAttributes(hash, buffer.textAttributes);
+            hashAttributes(hash, buffer.fillAttributes);
+            for (auto const& span: buffer.spans)
+            {
+                hash.update(unbox<uint32_t>(span.start)).update(unbox<uint16_t>(span.hyperlink));
+                hashAttributes(hash, span.attributes);
+            }
+            return hash.finish();
+        }
+
+        hash.update(uint32_t { 1 }).update(static_cast<uint32_t>(line.inflatedBuffer().size()));
+        for (auto const& cell: line.inflatedBuffer())
+        {
+            auto const codepointCount = cell.codepointCount();
+            hash.update(static_cast<uint32_t>(codepointCount));
+            for (size_t i = 0; i < codepointCount; ++i)
+                hash.update(cell.codepoint(i));
+            hash.update(cell.foregroundColor().content)
+                .update(cell.backgroundColor().content)
+                .update(cell.underlineColor().content)
+                .update(static_cast<uint32_t>(cell.flags().value()))
+                .update(static_cast<uint32_t>(cell.width()))
+                .update(unbox<uint16_t>(cell.hyperlink()))
+                .update(reinterpret_cast<uintptr_t>(cell.imageFragment().get()));
+        }
+        return hash.finish();
+    }
+
 } // namespace detail
 // {{{ Grid impl
 template <typename Cell>
@@ -104,6 +482,8 @@ Grid<Cell>::Grid(PageSize pageSize, bool reflowOnResize, MaxHistoryLineCount max
     _pageSize { pageSize },
     _reflowOnResize { reflowOnResize },
     _historyLimit { maxHistoryLineCount },
+    _cellPool { std::make_unique<crispy::slab_resource>(cellBlockSize(pageSize.columns)) },
+    _scrollbackTextPool { std::make_unique<crispy::buffer_object_pool<char>>(ScrollbackTextBufferSize) },
     _lines { detail::createLines<Cell>(
         pageSize,
         [maxHistoryLineCount]() -> LineCount {
@@ -113,8 +493,10 @@ Grid<Cell>::Grid(PageSize pageSize, bool reflowOnResize, MaxHistoryLineCount max
                 return LineCount::cast_from(0);
         }(),
         reflowOnResize,
-        GraphicsAttributes {}) },
-    _linesUsed { pageSize.lines }
+        GraphicsAttributes {},
+        _cellPool.get()) },
+    _linesUsed { pageSize.lines },
+    _dirtyLines(unbox<size_t>(pageSize.lines), true)
 {
     verifyState();
 }
@@ -124,18 +506,588 @@ CRISPY_REQUIRES(CellConcept<Cell>)
 void Grid<Cell>::setMaxHistoryLineCount(MaxHistoryLineCount maxHistoryLineCount)
 {
     verifyState();
+    unfoldCommandOutputs();
     rezeroBuffers();
     _historyLimit = maxHistoryLineCount;
     _lines.resize(unbox<size_t>(_pageSize.lines + this->maxHistoryLineCount()));
     _linesUsed = min(_linesUsed, _pageSize.lines + this->maxHistoryLineCount());
+    adoptCellPool();
+    markAllLinesDirty();
+    invalidateLineIds();
+    discardCommandBlocks();
     verifyState();
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::setHistorySpill(bool enabled, size_t memoryBudget)
+{
+    _historySpill = enabled;
+    _historyMemoryBudget = memoryBudget;
+
+    // Once created, the pool is never destroyed before the grid, as lines may still reference the file.
+    if (enabled && !_spillPool)
+    {
+        auto ec = std::error_code {};
+        auto const directory = std::filesystem::temp_directory_path(ec);
+        if (ec)
+            errorLog()("Cannot spill scrollback to disk. No temporary directory found. {}", ec.message());
+        else
+            _spillPool = crispy::mapped_buffer_pool::create(
+                directory, ScrollbackTextBufferSize + sizeof(crispy::buffer_object<char>));
+    }
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::setSearchIndexEnabled(bool enabled)
+{
+    _searchIndexEnabled = enabled;
+    _searchIndex.reset(0);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::invalidateLineIds() noexcept
+{
+    // Lines also enter the history when the page shrinks, so that line ids have to be kept positive.
+    _linesScrolledIntoHistory = std::max(_linesScrolledIntoHistory, unbox<uint64_t>(historyLineCount()));
+    ++_lineIdGeneration;
+    _searchIndex.reset(0);
+    invalidateMarkIndex();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::updateSearchIndex()
+{
+    auto const historyEnd = lineId(LineOffset(0));
+    auto const historyBegin = lineId(-boxed_cast<LineOffset>(historyLineCount()));
+
+    if (_searchIndex.empty() || _searchIndex.endLine() < historyBegin || _searchIndex.endLine() > historyEnd)
+        _searchIndex.reset(historyBegin);
+    else
+        _searchIndex.dropBefore(historyBegin);
+
+    if (_searchIndex.endLine() == historyEnd)
+        return;
+
+    gridLog()("Indexing history lines {}..{} for search.", _searchIndex.endLine(), historyEnd);
+    while (_searchIndex.endLine() < historyEnd)
+    {
+        auto const& line = _lines[unbox<long>(lineOffsetOf(_searchIndex.endLine()))];
+        _searchIndex.addLine(detail::searchIndexText(line), line.wrapped());
+    }
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::updateMarkIndex() const
+{
+    auto const historyEnd = lineId(LineOffset(0));
+    auto const historyBegin = lineId(-boxed_cast<LineOffset>(historyLineCount()));
+
+    if (_markIndexEnd < historyBegin || _markIndexEnd > historyEnd)
+    {
+        _markedHistoryLines.clear();
+        _markIndexEnd = historyBegin;
+    }
+    while (!_markedHistoryLines.empty() && _markedHistoryLines.front() < historyBegin)
+        _markedHistoryLines.pop_front();
+
+    for (; _markIndexEnd < historyEnd; ++_markIndexEnd)
+        if (_lines[unbox<long>(lineOffsetOf(_markIndexEnd))].marked())
+            _markedHistoryLines.push_back(_markIndexEnd);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+std::optional<LineOffset> Grid<Cell>::findMarkedLineAbove(LineOffset line) const
+{
+    for (auto i = std::min(line, boxed_cast<LineOffset>(_pageSize.lines)) - 1; i >= LineOffset(0); --i)
+        if (lineAt(i).marked())
+            return i;
+
+    updateMarkIndex();
+    auto const i = std::lower_bound(_markedHistoryLines.begin(), _markedHistoryLines.end(), lineId(line));
+    if (i == _markedHistoryLines.begin())
+        return std::nullopt;
+    return lineOffsetOf(*std::prev(i));
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+std::optional<LineOffset> Grid<Cell>::findMarkedLineBelow(LineOffset line, LineOffset bottom) const
+{
+    if (line < LineOffset(-1))
+    {
+        updateMarkIndex();
+        auto const i = std::upper_bound(_markedHistoryLines.begin(), _markedHistoryLines.end(), lineId(line));
+        if (i != _markedHistoryLines.end())
+        {
+            if (lineOffsetOf(*i) > bottom)
+                return std::nullopt;
+            return lineOffsetOf(*i);
+        }
+    }
+
+    for (auto i = std::max(line + 1, LineOffset(0)); i <= bottom; ++i)
+        if (lineAt(i).marked())
+            return i;
+    return std::nullopt;
+}
+
+// {{{ command blocks
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::startCommandPrompt(LineOffset line)
+{
+    auto const id = lineId(line);
+
+    // Blocks at or below the new prompt have been overwritten (e.g. by clearing the screen).
+    while (!_commandBlocks.empty() && _commandBlocks.back().block.promptLine >= id)
+    {
+        for (auto& folded: _commandBlocks.back().foldedLines)
+            discardLine(folded);
+        _commandBlocks.pop_back();
+    }
+
+    // A command interrupted without the shell telling it is finished where the next prompt starts.
+    if (!_commandBlocks.empty() && _commandBlocks.back().block.running())
+        _commandBlocks.back().block.endLine = std::max(id, *_commandBlocks.back().block.outputLine);
+
+    _commandBlocks.emplace_back(CommandBlockEntry { .block = CommandBlock { .promptLine = id } });
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::startCommandInput(LineOffset line)
+{
+    if (!_commandBlocks.empty() && !_commandBlocks.back().block.outputLine)
+    {
+        auto& block = _commandBlocks.back().block;
+        block.commandLine = std::max(lineId(line), block.promptLine);
+    }
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::startCommandOutput(LineOffset line)
+{
+    // Shells marking the output only still get their commands indexed.
+    if (_commandBlocks.empty() || _commandBlocks.back().block.outputLine)
+        startCommandPrompt(line);
+
+    auto& block = _commandBlocks.back().block;
+    block.outputLine = std::max(lineId(line), block.promptLine);
+    block.outputBytes = 0;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::finishCommand(LineOffset endLine, std::optional<int> exitCode)
+{
+    if (_commandBlocks.empty() || !_commandBlocks.back().block.running())
+        return;
+
+    auto& block = _commandBlocks.back().block;
+    block.endLine = std::max(lineId(endLine), *block.outputLine);
+    block.exitCode = exitCode;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+CommandBlock const* Grid<Cell>::lastCommandBlock() const noexcept
+{
+    // The most recent block is usually the prompt of the next command, which has not been run yet.
+    for (auto i = _commandBlocks.size(); i > 0 && i + 2 > _commandBlocks.size(); --i)
+        if (_commandBlocks[i - 1].block.outputLine)
+            return &_commandBlocks[i - 1].block;
+    return nullptr;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+CommandBlock const* Grid<Cell>::commandBlockAt(LineOffset line) const noexcept
+{
+    auto const index = commandBlockIndexAt(line);
+    return index ? &_commandBlocks[*index].block : nullptr;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+std::optional<size_t> Grid<Cell>::commandBlockIndexAt(LineOffset line) const noexcept
+{
+    auto const i = std::upper_bound(
+        _commandBlocks.begin(), _commandBlocks.end(), lineId(line), [](uint64_t id, auto const& entry) {
+            return id < entry.block.promptLine;
+        });
+    if (i == _commandBlocks.begin())
+        return std::nullopt;
+    return static_cast<size_t>(std::distance(_commandBlocks.begin(), i) - 1);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+std::optional<LineOffset> Grid<Cell>::findFailedCommandAbove(LineOffset line) const noexcept
+{
+    auto const id = lineId(line);
+    for (auto i = _commandBlocks.rbegin(); i != _commandBlocks.rend(); ++i)
+        if (i->block.promptLine < id && i->block.failed())
+            return lineOffsetOf(i->block.promptLine);
+    return std::nullopt;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+std::optional<LineOffset> Grid<Cell>::findFailedCommandBelow(LineOffset line,
+                                                             LineOffset bottom) const noexcept
+{
+    auto const id = lineId(line);
+    for (auto const& entry: _commandBlocks)
+    {
+        if (entry.block.promptLine > lineId(bottom))
+            break;
+        if (entry.block.promptLine > id && entry.block.failed())
+            return lineOffsetOf(entry.block.promptLine);
+    }
+    return std::nullopt;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+std::vector<LineTextSnapshot> Grid<Cell>::commandOutputSnapshot(CommandBlock const& block,
+                                                                LineOffset bottom) const
+{
+    auto snapshot = std::vector<LineTextSnapshot> {};
+    if (!block.outputLine)
+        return snapshot;
+
+    for (auto const& entry: _commandBlocks)
+        if (&entry.block == &block)
+            for (auto const& line: entry.foldedLines)
+                snapshot.emplace_back(line.textSnapshot());
+
+    auto const top = lineOffsetOf(*block.outputLine);
+    if (block.endLine)
+        bottom = std::min(bottom, lineOffsetOf(*block.endLine) - 1);
+    for (auto line = top; line <= bottom; ++line)
+        snapshot.emplace_back(lineAt(line).textSnapshot());
+    return snapshot;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+std::optional<LineOffset> Grid<Cell>::toggleCommandOutputFold(LineOffset line)
+{
+    auto const index = commandBlockIndexAt(line);
+    if (!index)
+        return std::nullopt;
+
+    if (*_commandBlocks[*index].block.foldedLines != 0)
+        unfoldCommandOutput(*index);
+    else if (!foldCommandOutput(*index))
+        return std::nullopt;
+
+    auto const promptLine = lineOffsetOf(_commandBlocks[*index].block.promptLine);
+    trimCommandBlocks();
+    return promptLine;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+bool Grid<Cell>::foldCommandOutput(size_t index)
+{
+    auto& entry = _commandBlocks[index];
+    auto& block = entry.block;
+    if (!block.outputLine)
+        return false;
+
+    // Only history lines are folded, and only those having been reflowed already.
+    auto const top = lineOffsetOf(*block.outputLine);
+    auto const bottom = std::min(block.endLine ? lineOffsetOf(*block.endLine) : LineOffset(0), LineOffset(0));
+    auto const count = boxed_cast<LineCount>(bottom - top);
+    auto const reflowedTop =
+        -boxed_cast<LineOffset>(historyLineCount()) + boxed_cast<LineOffset>(unreflowedHistoryLineCount());
+    if (count <= LineCount(0) || top < reflowedTop)
+        return false;
+
+    entry.foldedLines.reserve(unbox<size_t>(count));
+    for (auto i = top; i < bottom; ++i)
+        entry.foldedLines.emplace_back(std::move(_lines[unbox<long>(i)]));
+
+    // The lines below are moved up into the gap, and the ring is rotated such that they are back at their
+    // offsets, with the older lines following next to them, and the slots left free after the main page.
+    for (auto i = unbox<long>(top); i < unbox<long>(_pageSize.lines) - unbox<long>(count); ++i)
+        _lines[i] = std::move(_lines[i + unbox<long>(count)]);
+    rotateBuffersRight(count);
+    _linesUsed -= count;
+
+    // The lines above have moved down, which gives them new ids.
+    shiftCommandBlocks(unbox<int64_t>(count), index);
+    block.promptLine += unbox<uint64_t>(count);
+    if (block.commandLine)
+        *block.commandLine += unbox<uint64_t>(count);
+    *block.outputLine += unbox<uint64_t>(count);
+    block.foldedLines = count;
+
+    markAllLinesDirty();
+    invalidateLineIds();
+    verifyState();
+    return true;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::unfoldCommandOutput(size_t index)
+{
+    auto& block = _commandBlocks[index].block;
+    auto& folded = _commandBlocks[index].foldedLines;
+    auto const gap = lineOffsetOf(*block.outputLine);
+
+    // Make room for the folded lines, dropping the oldest lines if the history is full.
+    auto const linesAvailable = LineCount::cast_from(_lines.size()) - _linesUsed;
+    auto const linesMissing = LineCount::cast_from(folded.size()) - linesAvailable;
+    if (linesMissing > LineCount(0))
+    {
+        if (std::holds_alternative<Infinite>(_historyLimit))
+        {
+            for (auto i = 0; i < unbox<int>(linesMissing); ++i)
+                _lines.emplace_back(defaultLineFlags(),
+                                    TrivialLineBuffer { _pageSize.columns, GraphicsAttributes() },
+                                    _cellPool.get());
+        }
+        else
+        {
+            // Folded lines that would end up above the top of the history are dropped right away.
+            auto const linesAbove = boxed_cast<LineCount>(gap) + historyLineCount();
+            auto const foldedDropped = std::max(linesMissing - linesAbove, LineCount(0));
+            for (auto i = 0; i < unbox<int>(foldedDropped); ++i)
+                discardLine(folded[static_cast<size_t>(i)]);
+            folded.erase(folded.begin(), folded.begin() + unbox<long>(foldedDropped));
+
+            auto const linesDropped = linesMissing - foldedDropped;
+            for (auto i = 0; i < unbox<int>(linesDropped); ++i)
+                discardLine(_lines[-unbox<long>(historyLineCount()) + i]);
+            _linesUsed -= linesDropped;
+            _unreflowedHistoryLines = std::max(_unreflowedHistoryLines - linesDropped, LineCount(0));
+        }
+    }
+
+    // Reverses the steps of foldCommandOutput().
+    auto const count = LineCount::cast_from(folded.size());
+    if (count > LineCount(0))
+    {
+        rotateBuffersLeft(count);
+        for (auto i = unbox<long>(_pageSize.lines) - 1; i >= unbox<long>(gap); --i)
+            _lines[i] = std::move(_lines[i - unbox<long>(count)]);
+        for (auto i = size_t { 0 }; i < folded.size(); ++i)
+            _lines[unbox<long>(gap) - unbox<long>(count) + static_cast<long>(i)] = std::move(folded[i]);
+        _linesUsed += count;
+    }
+
+    shiftCommandBlocks(-unbox<int64_t>(count), index);
+    block.promptLine -= unbox<uint64_t>(count);
+    if (block.commandLine)
+        *block.commandLine -= unbox<uint64_t>(count);
+    *block.outputLine -= unbox<uint64_t>(count);
+    block.foldedLines = LineCount(0);
+    folded.clear();
+
+    markAllLinesDirty();
+    invalidateLineIds();
+    verifyState();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::unfoldCommandOutputs()
+{
+    for (auto i = _commandBlocks.size(); i > 0; --i)
+        if (*_commandBlocks[i - 1].block.foldedLines != 0)
+            unfoldCommandOutput(i - 1);
+    trimCommandBlocks();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::discardCommandBlocks()
+{
+    for (auto& entry: _commandBlocks)
+        for (auto& line: entry.foldedLines)
+            discardLine(line);
+    _commandBlocks.clear();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::trimCommandBlocks()
+{
+    auto const historyBegin = lineId(-boxed_cast<LineOffset>(historyLineCount()));
+    while (!_commandBlocks.empty() && _commandBlocks.front().block.promptLine < historyBegin)
+    {
+        for (auto& line: _commandBlocks.front().foldedLines)
+            discardLine(line);
+        _commandBlocks.pop_front();
+    }
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::shiftCommandBlocks(int64_t delta, size_t end)
+{
+    auto const shift = [delta](uint64_t& id) {
+        id = static_cast<uint64_t>(static_cast<int64_t>(id) + delta);
+    };
+    for (auto i = size_t { 0 }; i < end; ++i)
+    {
+        auto& block = _commandBlocks[i].block;
+        shift(block.promptLine);
+        for (auto* id: { &block.commandLine, &block.outputLine, &block.endLine })
+            if (*id)
+                shift(**id);
+    }
+}
+// }}}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+LineOffset Grid<Cell>::nextSearchCandidate(LineOffset line, u32string_view text)
+{
+    if (!_searchIndexEnabled || *line >= 0)
+        return line;
+
+    // A logical line continuing into the main page is not fully indexed, and thus never ruled out.
+    auto tailTop = LineOffset(0);
+    while (isLineWrapped(tailTop))
+        --tailTop;
+    if (line >= tailTop)
+        return line;
+
+    updateSearchIndex();
+    auto const candidate = _searchIndex.nextCandidate(lineId(line), text);
+    if (!candidate)
+        return tailTop;
+    return std::min(tailTop, lineOffsetOf(*candidate));
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+std::optional<LineOffset> Grid<Cell>::previousSearchCandidate(LineOffset line, u32string_view text)
+{
+    if (!_searchIndexEnabled || *line >= 0)
+        return line;
+
+    updateSearchIndex();
+    auto const candidate = _searchIndex.previousCandidate(lineId(line), text);
+    if (!candidate)
+        return std::nullopt;
+    return lineOffsetOf(*candidate);
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Grid<Cell>::clearHistory()
 {
+    for (auto i = -*historyLineCount(); i < 0; ++i)
+        discardLine(_lines[i]);
+    _scrollbackText.reset();
+    _recentTexts = {};
+    _scrollbackTextHeapBuffers = 0;
+    if (_discardedLines.empty())
+        releaseUnusedStorage();
+    _unreflowedHistoryLines = LineCount(0);
+
     _linesUsed = _pageSize.lines;
+    markAllLinesDirty();
+    invalidateLineIds();
+    discardCommandBlocks();
+    verifyState();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::discardLine(Line<Cell>& line)
+{
+    if (line.isTrivialBuffer() && line.trivialBuffer().text.empty() && line.trivialBuffer().spans.empty())
+    {
+        line.reset(defaultLineFlags(), GraphicsAttributes {});
+        return;
+    }
+
+    auto const width = line.size();
+    _discardedLines.emplace_back(std::move(line));
+    line =
+        Line<Cell>(defaultLineFlags(), TrivialLineBuffer { width, GraphicsAttributes {} }, _cellPool.get());
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+bool Grid<Cell>::releaseDiscardedLines(size_t maxLineCount)
+{
+    if (_discardedLines.empty())
+        return false;
+
+    for (size_t i = 0; i < maxLineCount && !_discardedLines.empty(); ++i)
+        _discardedLines.pop_back();
+    if (!_discardedLines.empty())
+        return true;
+
+    _discardedLines = {};
+    releaseUnusedStorage();
+    return false;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::trimMemory()
+{
+    compactColdLines(historyLineCount());
+    releaseRetiredLineBuffers();
+    _discardedLines = {};
+    releaseUnusedStorage();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::releaseUnusedStorage()
+{
+    _cellPool->release_unused();
+    if constexpr (std::is_same_v<Cell, CompactCell>)
+        releaseUnusedCellExtras();
+    _scrollbackTextPool->releaseUnusedBuffers();
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::restoreHistory(std::vector<Line<Cell>> lines)
+{
+    if (lines.empty())
+        return;
+
+    unfoldCommandOutputs();
+
+    // The lines are scrolled into the history through the top of the main page, which is set aside.
+    auto const pageHeight = unbox<size_t>(_pageSize.lines);
+    auto page = vector<Line<Cell>> {};
+    page.reserve(pageHeight);
+    for (auto i = 0; i < unbox<int>(_pageSize.lines); ++i)
+        page.emplace_back(std::move(_lines[i]));
+
+    for (size_t start = 0; start < lines.size(); start += pageHeight)
+    {
+        auto const count = min(pageHeight, lines.size() - start);
+        for (size_t i = 0; i < count; ++i)
+            _lines[static_cast<int>(i)] = std::move(lines[start + i]);
+        scrollUp(LineCount::cast_from(count));
+    }
+
+    for (size_t i = 0; i < pageHeight; ++i)
+        _lines[static_cast<int>(i)] = std::move(page[i]);
+
+    markAllLinesDirty();
+    invalidateLineIds();
+    discardCommandBlocks();
     verifyState();
 }
 
@@ -187,6 +1139,7 @@ CRISPY_REQUIRES(CellConcept<Cell>)
 Line<Cell>& Grid<Cell>::lineAt(LineOffset line) noexcept
 {
     // Require(*line < *_pageSize.lines);
+    markLineDirty(line);
     return _lines[unbox<long>(line)];
 }
 
@@ -195,7 +1148,7 @@ CRISPY_REQUIRES(CellConcept<Cell>)
 Line<Cell> const& Grid<Cell>::lineAt(LineOffset line) const noexcept
 {
     // Require(*line < *_pageSize.lines);
-    return const_cast<Grid&>(*this).lineAt(line);
+    return _lines[unbox<long>(line)];
 }
 
 template <typename Cell>
@@ -224,6 +1177,7 @@ CRISPY_REQUIRES(CellConcept<Cell>)
 gsl::span<Line<Cell>> Grid<Cell>::pageAtScrollOffset(ScrollOffset scrollOffset)
 {
     Require(unbox<LineCount>(scrollOffset) <= historyLineCount());
+    markAllLinesDirty();
 
     int const offset = -*scrollOffset;
     Line<Cell>* startLine = &_lines[offset];
@@ -302,6 +1256,17 @@ std::string Grid<Cell>::lineTextTrimmed(LineOffset lineOffset) const
     return output;
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+std::vector<LineTextSnapshot> Grid<Cell>::textSnapshot(LineOffset top, LineOffset bottom) const
+{
+    auto snapshot = std::vector<LineTextSnapshot> {};
+    snapshot.reserve(static_cast<size_t>(std::max(unbox(bottom) - unbox(top) + 1, 0)));
+    for (auto line = top; line <= bottom; ++line)
+        snapshot.emplace_back(lineAt(line).textSnapshot());
+    return snapshot;
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 std::string Grid<Cell>::lineText(Line<Cell> const& line) const
@@ -379,11 +1344,26 @@ int Grid<Cell>::computeLogicalLineNumberFromBottom(LineCount n) const noexcept
 }
 // }}}
 // {{{ Grid impl: scrolling
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+crispy::buffer_object_ptr<char> Grid<Cell>::allocateScrollbackText()
+{
+    if (_historySpill && _spillPool
+        && _scrollbackTextHeapBuffers * ScrollbackTextBufferSize >= _historyMemoryBudget)
+        if (auto buffer = _spillPool->allocateBufferObject())
+            return buffer;
+
+    if (_scrollbackTextPool->unusedBuffers() == 0)
+        ++_scrollbackTextHeapBuffers;
+    return _scrollbackTextPool->allocateBufferObject();
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 LineCount Grid<Cell>::scrollUp(LineCount linesCountToScrollUp, GraphicsAttributes defaultAttributes) noexcept
 {
     verifyState();
+    markAllLinesDirty();
     // Number of lines in the ring buffer that are not yet
     // used by the grid system.
     auto const linesAvailable = LineCount::cast_from(_lines.size() - unbox<size_t>(_linesUsed));
@@ -394,7 +1374,8 @@ LineCount Grid<Cell>::scrollUp(LineCount linesCountToScrollUp, GraphicsAttribute
         for ([[maybe_unused]] auto const _: ranges::views::iota(0, linesToAllocate))
         {
             _lines.emplace_back(defaultLineFlags(),
-                                TrivialLineBuffer { _pageSize.columns, GraphicsAttributes() });
+                                TrivialLineBuffer { _pageSize.columns, GraphicsAttributes() },
+                                _cellPool.get());
         }
         return scrollUp(linesCountToScrollUp, defaultAttributes);
     }
@@ -402,13 +1383,17 @@ LineCount Grid<Cell>::scrollUp(LineCount linesCountToScrollUp, GraphicsAttribute
     {
         // TODO: ensure explicit test for this case
         rotateBuffersLeft(linesCountToScrollUp);
+        _unreflowedHistoryLines = std::max(_unreflowedHistoryLines - linesCountToScrollUp, LineCount(0));
 
         // Initialize (/reset) new lines.
         for (auto y = boxed_cast<LineOffset>(_pageSize.lines - linesCountToScrollUp);
              y < boxed_cast<LineOffset>(_pageSize.lines);
              ++y)
-            lineAt(y).reset(defaultLineFlags(), defaultAttributes);
+            resetLineDeferred(y, defaultAttributes);
 
+        _linesScrolledIntoHistory += unbox<uint64_t>(linesCountToScrollUp);
+        trimCommandBlocks();
+        compactColdLines(linesCountToScrollUp);
         return linesCountToScrollUp;
     }
     else
@@ -432,17 +1417,101 @@ LineCount Grid<Cell>::scrollUp(LineCount linesCountToScrollUp, GraphicsAttribute
         {
             auto const incrementCount = linesCountToScrollUp - linesAppendCount;
             rotateBuffersLeft(incrementCount);
+            _unreflowedHistoryLines = std::max(_unreflowedHistoryLines - incrementCount, LineCount(0));
 
             // Initialize (/reset) new lines.
             for (auto y = boxed_cast<LineOffset>(_pageSize.lines - linesCountToScrollUp);
                  y < boxed_cast<LineOffset>(_pageSize.lines);
                  ++y)
-                lineAt(y).reset(defaultLineFlags(), defaultAttributes);
+                resetLineDeferred(y, defaultAttributes);
         }
+        _linesScrolledIntoHistory += unbox<uint64_t>(linesCountToScrollUp);
+        trimCommandBlocks();
+        compactColdLines(linesCountToScrollUp);
         return LineCount::cast_from(linesAppendCount);
     }
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::resetLineDeferred(LineOffset lineOffset, GraphicsAttributes attributes)
+{
+    auto& line = lineAt(lineOffset);
+    if (line.isInflatedBuffer() && _retiredLineBuffers.size() < unbox<size_t>(_pageSize.lines))
+    {
+        auto const columns = line.size();
+        _retiredLineBuffers.emplace_back(std::move(line.inflatedBuffer()));
+        line.reset(defaultLineFlags(), attributes, columns);
+    }
+    else
+        line.reset(defaultLineFlags(), attributes);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::compactColdLines(LineCount scrolledLines)
+{
+    auto const storeText = [this](std::string_view text) -> std::optional<crispy::BufferFragment<char>> {
+        if (text.empty())
+            return crispy::BufferFragment<char> {};
+        auto& recent = recentTextSlot(text);
+        if (!recent.text.empty())
+        {
+            ++_dedupedLineCount;
+            return recent.text;
+        }
+        if (text.size() > ScrollbackTextBufferSize)
+            return std::nullopt;
+        if (!_scrollbackText || _scrollbackText->bytesAvailable() < text.size())
+            _scrollbackText = allocateScrollbackText();
+        if (_scrollbackText->bytesAvailable() < text.size())
+            return std::nullopt;
+        auto const offset = _scrollbackText->bytesUsed();
+        _scrollbackText->writeAtEnd(gsl::span<char const>(text.data(), text.size()));
+        _scrollbackText->advance(text.size());
+        recent.text = _scrollbackText->ref(offset, text.size());
+        return recent.text;
+    };
+
+    auto const coldStart =
+        std::max(-boxed_cast<LineOffset>(scrolledLines), -boxed_cast<LineOffset>(historyLineCount()));
+    for (auto line = coldStart; line < LineOffset(0); ++line)
+    {
+        auto& coldLine = lineAt(line);
+        if (coldLine.isInflatedBuffer())
+        {
+            if (coldLine.deflate(storeText))
+                ++_reclaimedLineCount;
+        }
+        else if (auto& text = coldLine.trivialBuffer().text; !text.empty())
+        {
+            // Lines written as trivial lines right away still reference the text as it has been read.
+            auto& recent = recentTextSlot(text.view());
+            if (recent.text.empty())
+                recent.text = text;
+            else if (recent.text.data() != text.data())
+            {
+                text = recent.text;
+                ++_dedupedLineCount;
+            }
+        }
+    }
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+auto Grid<Cell>::recentTextSlot(std::string_view text) noexcept -> RecentText&
+{
+    auto const hash = std::hash<std::string_view> {}(text);
+    auto& slot = _recentTexts[hash % RecentTextCount];
+    if (slot.hash != hash || slot.text.view() != text)
+    {
+        slot.hash = hash;
+        slot.text = {};
+    }
+    return slot;
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 LineCount Grid<Cell>::scrollUp(LineCount n, GraphicsAttributes defaultAttributes, Margin margin) noexcept
@@ -450,6 +1519,7 @@ LineCount Grid<Cell>::scrollUp(LineCount n, GraphicsAttributes defaultAttributes
     verifyState();
     Require(0 <= *margin.horizontal.from && *margin.horizontal.to < *_pageSize.columns);
     Require(0 <= *margin.vertical.from && *margin.vertical.to < *_pageSize.lines);
+    markAllLinesDirty();
 
     // these two booleans could be cached and updated whenever margin updates,
     // so not even this needs to be computed for the general case.
@@ -467,13 +1537,9 @@ LineCount Grid<Cell>::scrollUp(LineCount n, GraphicsAttributes defaultAttributes
         // scroll up only inside vertical margin with full horizontal extend
         auto const marginHeight = LineCount(margin.vertical.length());
         auto const n2 = std::min(n, marginHeight);
-        if (*n2 && n2 < marginHeight)
-        {
-            // rotate line attribs
-            for (auto topLineOffset = *margin.vertical.from; topLineOffset <= *margin.vertical.to - *n2;
-                 ++topLineOffset)
-                _lines[topLineOffset] = std::move(_lines[topLineOffset + *n2]);
-        }
+
+        // Rotate the lines scrolled out at the top into the bottom of the margin, where they are reused.
+        rotateLinesUp(margin.vertical.from, margin.vertical.to, n2);
 
         auto const topEmptyLineNr = *margin.vertical.to - *n2 + 1;
         auto const bottomLineNumber = *margin.vertical.to;
@@ -522,6 +1588,7 @@ void Grid<Cell>::scrollDown(LineCount vN, GraphicsAttributes const& defaultAttri
 {
     verifyState();
     Require(vN >= LineCount(0));
+    markAllLinesDirty();
 
     // these two booleans could be cached and updated whenever margin updates,
     // so not even this needs to be computed for the general case.
@@ -543,7 +1610,10 @@ void Grid<Cell>::scrollDown(LineCount vN, GraphicsAttributes const& defaultAttri
         // move all lines up by N lines
         // bottom N lines are wiped out
 
+        unfoldCommandOutputs();
         rotateBuffersRight(n);
+        invalidateLineIds();
+        discardCommandBlocks();
 
         for (Line<Cell>& line: mainPage().subspan(0, unbox<size_t>(n)))
             line.reset(defaultLineFlags(), defaultAttributes);
@@ -553,10 +1623,7 @@ void Grid<Cell>::scrollDown(LineCount vN, GraphicsAttributes const& defaultAttri
     if (fullHorizontal) // => but ont fully vertical
     {
         // scroll down only inside vertical margin with full horizontal extend
-        auto a = std::next(begin(_lines), *margin.vertical.from);
-        auto b = std::next(begin(_lines), *margin.vertical.to + 1 - *n);
-        auto c = std::next(begin(_lines), *margin.vertical.to + 1);
-        std::rotate(a, b, c);
+        rotateLinesDown(margin.vertical.from, margin.vertical.to, n);
         for (auto const i: ranges::views::iota(*margin.vertical.from, *margin.vertical.from + *n))
             _lines[i].reset(defaultLineFlags(), defaultAttributes);
     }
@@ -612,8 +1679,17 @@ void Grid<Cell>::reset()
 {
     _linesUsed = _pageSize.lines;
     _lines.rotate_right(_lines.zero_index());
-    for (int i = 0; i < unbox(_pageSize.lines); ++i)
-        _lines[i].reset(defaultLineFlags(), GraphicsAttributes {});
+    for (auto& line: _lines)
+        discardLine(line);
+    _scrollbackText.reset();
+    _recentTexts = {};
+    _scrollbackTextHeapBuffers = 0;
+    if (_discardedLines.empty())
+        releaseUnusedStorage();
+    _unreflowedHistoryLines = LineCount(0);
+    markAllLinesDirty();
+    invalidateLineIds();
+    discardCommandBlocks();
     verifyState();
 }
 
@@ -650,7 +1726,8 @@ CellLocation Grid<Cell>::growLines(LineCount newHeight, CellLocation cursor)
     auto const linesToFill = max(0, *newTotalLineCount - *currentTotalLineCount);
 
     for ([[maybe_unused]] auto const _: ranges::views::iota(0, linesToFill))
-        _lines.emplace_back(wrappableFlag, TrivialLineBuffer { _pageSize.columns, GraphicsAttributes {} });
+        _lines.emplace_back(
+            wrappableFlag, TrivialLineBuffer { _pageSize.columns, GraphicsAttributes {} }, _cellPool.get());
 
     _pageSize.lines += totalLinesToExtend;
     _linesUsed = min(_linesUsed + totalLinesToExtend, LineCount::cast_from(_lines.size()));
@@ -671,6 +1748,9 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
 
     gridLog()("resize {} -> {} (cursor {})", _pageSize, newSize, currentCursorPos);
 
+    // Lines are moved around, which command blocks cannot follow.
+    unfoldCommandOutputs();
+
     // Growing in line count with scrollback lines present will move
     // the scrollback lines into the visible area.
     //
@@ -730,7 +1810,27 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
         return CellLocation {};
     };
 
-    auto const growColumns = [this, wrapPending](ColumnCount newColumnCount) -> CellLocation {
+    // Only the main page and the most recent history lines are reflowed right away.
+    // Any older history lines are left as they are, and reflowed lazily by reflowHistoryFrom().
+    auto const reflowColumns = _reflowOnResize && newSize.columns != _pageSize.columns;
+    auto reflowStart = -boxed_cast<LineOffset>(historyLineCount());
+    if (newSize.columns != _pageSize.columns)
+    {
+        if (!reflowColumns)
+            reflowHistory();
+        else
+        {
+            auto const reflowLineCount = std::max({ newSize.lines, _pageSize.lines, HistoryReflowChunkSize });
+            reflowStart = std::max(-boxed_cast<LineOffset>(historyLineCount()),
+                                   -boxed_cast<LineOffset>(reflowLineCount));
+            reflowHistoryFrom(reflowStart);
+            while (reflowStart > -boxed_cast<LineOffset>(historyLineCount()) && lineAt(reflowStart).wrapped())
+                --reflowStart;
+        }
+    }
+    auto const unreflowedLines = boxed_cast<LineCount>(reflowStart) + historyLineCount();
+
+    auto const growColumns = [this, wrapPending, reflowStart](ColumnCount newColumnCount) -> CellLocation {
         using LineBuffer = typename Line<Cell>::InflatedBuffer;
 
         if (!_reflowOnResize)
@@ -776,7 +1876,10 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
                     gridLog()("{} |> \"{}\"", msg, Line<Cell>(lineFlags, logicalLineBuffer).toUtf8());
                 };
 
-            for (int i = -*historyLineCount(); i < *_pageSize.lines; ++i)
+            for (int i = -*historyLineCount(); i < *reflowStart; ++i)
+                grownLines.emplace_back(std::move(_lines[i]));
+
+            for (int i = *reflowStart; i < *_pageSize.lines; ++i)
             {
                 auto& line = _lines[i];
                 // logLogicalLine(line.flags(), fmt::format("Line[{:>2}]: next line: \"{}\"", i,
@@ -844,8 +1947,9 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
         }
     };
 
-    auto const shrinkColumns =
-        [this](ColumnCount newColumnCount, LineCount /*newLineCount*/, CellLocation cursor) -> CellLocation {
+    auto const shrinkColumns = [this, reflowStart](ColumnCount newColumnCount,
+                                                   LineCount /*newLineCount*/,
+                                                   CellLocation cursor) -> CellLocation {
         using LineBuffer = typename Line<Cell>::InflatedBuffer;
 
         if (!_reflowOnResize)
@@ -894,7 +1998,13 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
             Require(totalLineCount == unbox<size_t>(this->totalLineCount()));
 
             auto numLinesWritten = LineCount(0);
-            for (auto i = -*historyLineCount(); i < *_pageSize.lines; ++i)
+            for (auto i = -*historyLineCount(); i < *reflowStart; ++i)
+            {
+                shrinkedLines.emplace_back(std::move(_lines[i]));
+                numLinesWritten++;
+            }
+
+            for (auto i = *reflowStart; i < *_pageSize.lines; ++i)
             {
                 auto& line = _lines[i];
 
@@ -967,21 +2077,95 @@ CellLocation Grid<Cell>::resize(PageSize newSize, CellLocation currentCursorPos,
         case comparison::Less: cursor = shrinkColumns(newSize.columns, newSize.lines, cursor); break;
         case comparison::Equal: break;
     }
+    if (reflowColumns)
+        _unreflowedHistoryLines = unreflowedLines;
+
+    if (_cellPool->block_size() != cellBlockSize(_pageSize.columns))
+    {
+        // Lines have been reflowed into new buffers.
+        _cellPool->set_block_size(cellBlockSize(_pageSize.columns));
+        adoptCellPool();
+    }
 
     // grow/shrink lines
     switch (crispy::strongCompare(newSize.lines, _pageSize.lines))
     {
-        case comparison::Greater: cursor += growLines(newSize.lines, cursor); break;
+        case comparison::Greater:
+            // Growing may pull history lines into the main page, which must be laid out by then.
+            reflowHistoryFrom(-boxed_cast<LineOffset>(newSize.lines - _pageSize.lines));
+            cursor += growLines(newSize.lines, cursor);
+            break;
         case comparison::Less: cursor += shrinkLines(newSize.lines, cursor); break;
         case comparison::Equal: break;
     }
 
     Ensures(_pageSize == newSize);
+    markAllLinesDirty();
+    invalidateLineIds();
+    discardCommandBlocks();
     verifyState();
 
     return cursor;
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::reflowHistoryFrom(LineOffset top)
+{
+    auto const historyTop = -boxed_cast<LineOffset>(historyLineCount());
+    auto const unreflowedEnd = historyTop + boxed_cast<LineOffset>(unreflowedHistoryLineCount());
+    if (top >= unreflowedEnd)
+        return;
+
+    // Each pass moves all lines into a new buffer, so rather reflow a whole chunk at once.
+    auto start =
+        std::max(historyTop, std::min(top, unreflowedEnd - boxed_cast<LineOffset>(HistoryReflowChunkSize)));
+    while (start > historyTop && lineAt(start).wrapped())
+        --start;
+
+    gridLog()("reflow history lines {}..{} to {} columns", start, unreflowedEnd, _pageSize.columns);
+
+    // The lines below keep their offsets, and command blocks only ever refer to those,
+    // so that their line ids only change if the ids of all lines are moved.
+    auto const linesScrolledIntoHistory = _linesScrolledIntoHistory;
+
+    Lines<Cell> reflowedLines;
+    reflowedLines.reserve(_lines.size());
+
+    for (auto i = *historyTop; i < *start; ++i)
+        reflowedLines.emplace_back(std::move(_lines[i]));
+
+    detail::reflowLogicalLines(reflowedLines, _lines, *start, *unreflowedEnd, _pageSize.columns);
+
+    for (auto i = *unreflowedEnd; i < *_pageSize.lines; ++i)
+        reflowedLines.emplace_back(std::move(_lines[i]));
+
+    auto const linesUsed = LineCount::cast_from(reflowedLines.size());
+    while (reflowedLines.size() < _lines.size())
+        reflowedLines.emplace_back(defaultLineFlags(),
+                                   TrivialLineBuffer { _pageSize.columns, GraphicsAttributes {} },
+                                   _cellPool.get());
+
+    // Reflowing into more lines may exceed the history limit, in which case the oldest lines are dropped.
+    auto overflow = LineCount(0);
+    if (auto const* maxLineCount = std::get_if<LineCount>(&_historyLimit))
+        overflow = std::max(linesUsed - _pageSize.lines - *maxLineCount, LineCount(0));
+    for (auto i = 0; i < *overflow; ++i)
+        reflowedLines[i].reset(defaultLineFlags(), GraphicsAttributes {});
+
+    _lines = std::move(reflowedLines);
+    _linesUsed = linesUsed - overflow;
+    _unreflowedHistoryLines = std::max(boxed_cast<LineCount>(start - historyTop) - overflow, LineCount(0));
+    rotateBuffersLeft(linesUsed - _pageSize.lines);
+    adoptCellPool();
+    markAllLinesDirty();
+    invalidateLineIds();
+    shiftCommandBlocks(static_cast<int64_t>(_linesScrolledIntoHistory - linesScrolledIntoHistory),
+                       _commandBlocks.size());
+
+    verifyState();
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Grid<Cell>::clampHistory()
@@ -1013,11 +2197,138 @@ void Grid<Cell>::appendNewLines(LineCount count, GraphicsAttributes attr)
     if (auto const n = std::min(count, _pageSize.lines); *n > 0)
     {
         generate_n(back_inserter(_lines), *n, [&]() {
-            return Line<Cell>(wrappableFlag, TrivialLineBuffer { _pageSize.columns, attr, attr });
+            return Line<Cell>(
+                wrappableFlag, TrivialLineBuffer { _pageSize.columns, attr, attr }, _cellPool.get());
         });
         clampHistory();
     }
 }
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+GridMemoryStats Grid<Cell>::memoryStats() const
+{
+    auto stats = GridMemoryStats {};
+    auto sharedTexts = std::unordered_set<char const*> {};
+    for (auto const& line: _lines)
+    {
+        if (line.isTrivialBuffer())
+        {
+            auto const& buffer = line.trivialBuffer();
+            ++stats.trivialLines;
+            stats.trivialLineBytes += sizeof(line) + buffer.columnOffsets.capacity() * sizeof(uint16_t)
+                                      + buffer.spans.capacity() * sizeof(TrivialLineSpan);
+            if (sharedTexts.insert(buffer.text.data()).second)
+                stats.trivialTextBytes += buffer.text.size();
+            else
+                stats.sharedTextBytes += buffer.text.size();
+        }
+        else
+        {
+            auto const& cells = line.inflatedBuffer();
+            ++stats.inflatedLines;
+            stats.inflatedLineBytes += sizeof(line) + cells.capacity() * sizeof(Cell);
+            if constexpr (requires(Cell const& cell) { cell.hasExtra(); })
+                stats.cellExtras += static_cast<size_t>(std::count_if(
+                    cells.begin(), cells.end(), [](Cell const& cell) { return cell.hasExtra(); }));
+        }
+    }
+    for (auto const& cells: _retiredLineBuffers)
+        stats.retiredLineBytes += cells.capacity() * sizeof(Cell);
+    stats.cellPoolBytes = _cellPool->bytes_reserved();
+    stats.cellPoolUsedBytes = _cellPool->blocks_in_use() * _cellPool->block_size();
+    stats.scrollbackText = _scrollbackTextPool->stats();
+    stats.spilledBytes = _spillPool ? _spillPool->fileSize() : 0;
+    return stats;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::markHyperlinks(std::vector<bool>& referenced) const
+{
+    auto const mark = [&](HyperlinkId id) {
+        if (id.value < referenced.size())
+            referenced[id.value] = true;
+    };
+    for (auto const& line: _lines)
+    {
+        if (line.isTrivialBuffer())
+        {
+            auto const& buffer = line.trivialBuffer();
+            mark(buffer.hyperlink);
+            for (auto const& span: buffer.spans)
+                mark(span.hyperlink);
+        }
+        else
+        {
+            for (auto const& cell: line.inflatedBuffer())
+                mark(cell.hyperlink());
+        }
+    }
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::clearUnchangedDirtyLines()
+{
+    if (_lineHashes.size() != _dirtyLines.size())
+        _lineHashes.assign(_dirtyLines.size(), crispy::strong_hash {});
+
+    for (size_t line = 0; line < _dirtyLines.size(); ++line)
+    {
+        if (!_dirtyLines[line])
+            continue;
+        auto const hash = detail::hashLineContents(std::as_const(*this).lineAt(LineOffset::cast_from(line)));
+        if (hash == _lineHashes[line])
+            _dirtyLines[line] = false;
+        else
+            _lineHashes[line] = hash;
+    }
+    _lineHashesCurrent = true;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Grid<Cell>::inspect(std::ostream& os) const
+{
+    auto const trivialLineCount =
+        std::count_if(_lines.begin(), _lines.end(), [](auto const& line) { return line.isTrivialBuffer(); });
+
+    os << "Grid:\n";
+    os << fmt::format("trivial lines        : {} of {}\n", trivialLineCount, _lines.size());
+    os << fmt::format("reclaimed lines      : {}\n", _reclaimedLineCount);
+    os << fmt::format("deduped lines        : {}\n", _dedupedLineCount);
+    os << fmt::format("unreflowed lines     : {}\n", unreflowedHistoryLineCount());
+    os << fmt::format("retired line buffers : {}\n", _retiredLineBuffers.size());
+    os << fmt::format("discarded lines      : {}\n", _discardedLines.size());
+    os << fmt::format("cell pool            : {} slabs, {} blocks in use\n",
+                      _cellPool->slab_count(),
+                      _cellPool->blocks_in_use());
+
+    auto const stats = memoryStats();
+    auto const bytes = [](size_t count) {
+        return crispy::humanReadableBytes(static_cast<long double>(count));
+    };
+    auto const perLine = [&](size_t count, size_t lines) {
+        return lines ? bytes(count / lines) : bytes(0);
+    };
+    os << fmt::format("trivial line memory  : {} ({} text, {} shared), {} per line\n",
+                      bytes(stats.trivialLineBytes + stats.trivialTextBytes),
+                      bytes(stats.trivialTextBytes),
+                      bytes(stats.sharedTextBytes),
+                      perLine(stats.trivialLineBytes + stats.trivialTextBytes, stats.trivialLines));
+    os << fmt::format("inflated line memory : {}, {} per line, {} cell extras\n",
+                      bytes(stats.inflatedLineBytes),
+                      perLine(stats.inflatedLineBytes, stats.inflatedLines),
+                      stats.cellExtras);
+    os << fmt::format("cell pool memory     : {} reserved, {} used\n",
+                      bytes(stats.cellPoolBytes),
+                      bytes(stats.cellPoolUsedBytes));
+    os << fmt::format("scrollback text      : {} pinned, {} unused, {} spilled\n",
+                      bytes(stats.scrollbackText.pinnedBytes),
+                      bytes(stats.scrollbackText.unusedBytes),
+                      bytes(stats.spilledBytes));
+}
 // }}}
 // {{{ dumpGrid impl
 template <typename Cell>
@@ -1128,8 +2439,10 @@ bool Grid<Cell>::cellEmptyOrContainsOneOf(CellLocation position, u32string_view
     // Word selection may be off by one
     position.column = min(position.column, boxed_cast<ColumnOffset>(pageSize().columns - 1));
 
-    auto const& cell = at(position.line, position.column);
-    return CellUtil::empty(cell) || delimiters.find(cell.codepoint(0)) != std::u32string_view::npos;
+    // Trivial lines are inspected without being inflated, as word-wise motions test many cells in a row.
+    auto const& line = lineAt(position.line);
+    return line.cellEmptyAt(position.column)
+           || delimiters.find(line.leadingCodepointAt(position.column).first) != std::u32string_view::npos;
 }
 
 template <typename Cell>
@@ -1195,3 +2508,7 @@ template std::string vtbackend::dumpGrid<vtbackend::CompactCell>(
 template class vtbackend::Grid<vtbackend::SimpleCell>;
 template std::string vtbackend::dumpGrid<vtbackend::SimpleCell>(
     vtbackend::Grid<vtbackend::SimpleCell> const&);
+
+#include <vtbackend/cell/FlatCell.h>
+template class vtbackend::Grid<vtbackend::FlatCell>;
+template std::string vtbackend::dumpGrid<vtbackend::FlatCell>(vtbackend::Grid<vtbackend::FlatCell> const&);
@@ -3,13 +3,19 @@
 
 #include <vtbackend/GraphicsAttributes.h>
 #include <vtbackend/Line.h>
+#include <vtbackend/SearchIndex.h>
 #include <vtbackend/cell/CellConcept.h>
 #include <vtbackend/primitives.h>
 
+#include <crispy/BufferObject.h>
+#include <crispy/StrongHash.h>
 #include <crispy/algorithm.h>
 #include <crispy/assert.h>
+#include <crispy/chunked_ring.h>
 #include <crispy/defines.h>
-#include <crispy/ring.h>
+#include <crispy/mapped_buffer_pool.h>
+#include <crispy/regex_dfa.h>
+#include <crispy/slab_resource.h>
 
 #include <libunicode/convert.h>
 
@@ -21,8 +27,13 @@
 #include <gsl/span_ext>
 
 #include <algorithm>
+#include <array>
+#include <deque>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace vtbackend
 {
@@ -101,14 +112,35 @@ constexpr bool operator!=(Margin const& a, PageSize b) noexcept
 }
 // }}}
 
+// Chunked, such that growing the (possibly infinite) history never moves the existing lines.
 template <typename Cell>
-using Lines = crispy::ring<Line<Cell>>;
+using Lines = crispy::chunked_ring<Line<Cell>>;
 
 struct RenderPassHints
 {
     bool containsBlinkingCells = false;
 };
 
+/**
+ * A shell command, as delimited by the shell integration marks of OSC 133:
+ * the start of its prompt (A), of its command line (B), of its output (C), and its end (D).
+ *
+ * Lines are referred to by their line ids (see Grid::lineId()).
+ */
+struct CommandBlock
+{
+    uint64_t promptLine = 0;
+    std::optional<uint64_t> commandLine;
+    std::optional<uint64_t> outputLine;   // the first line of the output, once the command is run
+    std::optional<uint64_t> endLine;      // the line past the output, once the command has finished
+    std::optional<int> exitCode;          // as reported by the shell when the command finished, if at all
+    size_t outputBytes = 0;               // of text written while the command was running
+    LineCount foldedLines = LineCount(0); // of the output, taken out of the grid right above outputLine
+
+    [[nodiscard]] bool running() const noexcept { return outputLine.has_value() && !endLine.has_value(); }
+    [[nodiscard]] bool failed() const noexcept { return exitCode.value_or(0) != 0; }
+};
+
 /**
  * Represents a logical grid line, i.e. a sequence lines that were written without
  * an explicit linefeed, triggering an auto-wrap.
@@ -255,7 +287,117 @@ struct LogicalLine
         return std::nullopt;
     }
 
+    // Searches from left to right for a match of the given regular expression,
+    // which is matched against the text of the whole logical line.
+    [[nodiscard]] std::optional<vtbackend::CellLocation> search(crispy::regex_dfa const& regex,
+                                                                ColumnOffset startPosition) const
+    {
+        if (lines.size() == 1 && lines.front().get().isTrivialBuffer())
+        {
+            // Runs over the text as stored, without inflating the line.
+            auto const& buffer = lines.front().get().trivialBuffer();
+            auto const match = regex.find(buffer.text.view(), buffer.byteOffsetAt(startPosition));
+            if (!match)
+                return std::nullopt;
+            return CellLocation { top, buffer.columnAt(match->begin) };
+        }
+
+        auto const text = utf8Text();
+        auto const& columns = text.columns;
+        auto const from = std::lower_bound(columns.begin(), columns.end(), unbox<size_t>(startPosition));
+        auto const match = regex.find(text.text, static_cast<size_t>(std::distance(columns.begin(), from)));
+        if (!match)
+            return std::nullopt;
+        return locationOf(text.columns[match->begin]);
+    }
+
+    // Searches from right to left for a match of the given regular expression,
+    // which is matched against the text of the whole logical line.
+    [[nodiscard]] std::optional<vtbackend::CellLocation> searchReverse(crispy::regex_dfa const& regex,
+                                                                       ColumnOffset startPosition) const
+    {
+        if (lines.size() == 1 && lines.front().get().isTrivialBuffer())
+        {
+            auto const& buffer = lines.front().get().trivialBuffer();
+            if (buffer.text.empty())
+                return std::nullopt;
+            auto const from = std::min(buffer.byteOffsetAt(startPosition), buffer.text.size() - 1);
+            auto const match = regex.rfind(buffer.text.view(), from);
+            if (!match)
+                return std::nullopt;
+            return CellLocation { top, buffer.columnAt(match->begin) };
+        }
+
+        auto const text = utf8Text();
+        auto const& columns = text.columns;
+        auto const lineLength = unbox<size_t>(lines.front().get().size());
+        auto const startColumn = ((lines.size() - 1) * lineLength) + unbox<size_t>(startPosition);
+        auto const end = std::upper_bound(columns.begin(), columns.end(), startColumn);
+        if (end == columns.begin())
+            return std::nullopt;
+        auto const from = static_cast<size_t>(std::distance(columns.begin(), end)) - 1;
+        auto const match = regex.rfind(text.text, from);
+        if (!match)
+            return std::nullopt;
+        return locationOf(text.columns[match->begin]);
+    }
+
   private:
+    struct Utf8Text
+    {
+        std::string text;
+        std::vector<size_t> columns; // for each byte of text, the column it belongs to
+    };
+
+    // Composes the UTF-8 text of the logical line, with columns counted across all of its lines.
+    // Unused cells are represented by spaces, except for those ending the logical line.
+    [[nodiscard]] Utf8Text utf8Text() const
+    {
+        auto output = Utf8Text {};
+        auto const lineLength = unbox<size_t>(lines.front().get().size());
+        for (size_t i = 0; i < lines.size(); ++i)
+        {
+            Line<Cell> const& line = lines[i].get();
+            auto const base = i * lineLength;
+            auto const isLast = i + 1 == lines.size();
+            if (line.isTrivialBuffer())
+            {
+                auto const& buffer = line.trivialBuffer();
+                for (size_t byte = 0; byte < buffer.text.size(); ++byte)
+                    output.columns.push_back(base + unbox<size_t>(buffer.columnAt(byte)));
+                output.text += buffer.text.view();
+                auto const endColumn = isLast ? size_t { 0 } : lineLength;
+                for (auto column = unbox<size_t>(buffer.usedColumns); column < endColumn; ++column)
+                {
+                    output.text += ' ';
+                    output.columns.push_back(base + column);
+                }
+                continue;
+            }
+
+            auto const& cells = line.inflatedBuffer();
+            auto end = cells.size();
+            while (isLast && end > 0 && cells[end - 1].codepointCount() == 0)
+                --end;
+            for (size_t column = 0; column < end;)
+            {
+                auto const& cell = cells[column];
+                auto const bytes = cell.codepointCount() ? cell.toUtf8() : std::string(" ");
+                output.text += bytes;
+                output.columns.insert(output.columns.end(), bytes.size(), base + column);
+                column += std::max(size_t { 1 }, static_cast<size_t>(cell.width()));
+            }
+        }
+        return output;
+    }
+
+    [[nodiscard]] CellLocation locationOf(size_t column) const noexcept
+    {
+        auto const lineLength = unbox<size_t>(lines.front().get().size());
+        return CellLocation { top + LineOffset::cast_from(column / lineLength),
+                              ColumnOffset::cast_from(column % lineLength) };
+    }
+
     // Finds the maximum number of charecters of searchText that can be matched from right end of line
     [[nodiscard]] size_t searchPartialMatch(std::u32string_view searchText,
                                             const Line<Cell>& line) const noexcept
@@ -555,6 +697,29 @@ struct ReverseLogicalLines
     }
 };
 
+/// Memory used by the lines of a grid, as reported by Grid::memoryStats().
+struct GridMemoryStats
+{
+    size_t trivialLines = 0;
+    size_t trivialLineBytes = 0; // line objects, and their column layouts and attribute spans
+    size_t trivialTextBytes = 0; // text of trivial lines, referenced in buffer objects
+    size_t sharedTextBytes = 0;  // text of trivial lines sharing it with another line, not stored again
+    size_t inflatedLines = 0;
+    size_t inflatedLineBytes = 0; // line objects and their cells
+    size_t cellExtras = 0;        // cells of inflated lines that have a CellExtra allocated
+    size_t cellPoolBytes = 0;     // reserved by the slabs of the cell pool
+    size_t cellPoolUsedBytes = 0; // of the cell pool's blocks in use
+    size_t retiredLineBytes = 0;  // cells of retired line buffers
+    crispy::buffer_object_pool_stats scrollbackText {}; // of lines packed into trivial line buffers
+    size_t spilledBytes = 0; // scrollback text written to the spill file
+
+    [[nodiscard]] size_t lines() const noexcept { return trivialLines + inflatedLines; }
+    [[nodiscard]] size_t bytes() const noexcept
+    {
+        return trivialLineBytes + trivialTextBytes + inflatedLineBytes + retiredLineBytes;
+    }
+};
+
 /**
  * Manages the screen grid buffer (main screen + scrollback history).
  *
@@ -604,6 +769,18 @@ class Grid
 
     void setMaxHistoryLineCount(MaxHistoryLineCount maxHistoryLineCount);
 
+    /// Configures spilling the text of packed scrollback lines into a memory-mapped temporary file.
+    ///
+    /// Once the scrollback text held in heap memory exceeds @p memoryBudget bytes, the text of
+    /// any further packed lines is written to the file instead, leaving it up to the kernel
+    /// to page it out and fault it back in when scrolling back.
+    void setHistorySpill(bool enabled, size_t memoryBudget);
+    [[nodiscard]] bool historySpill() const noexcept { return _historySpill; }
+
+    /// Configures maintaining a trigram index over the history lines' text, see nextSearchCandidate().
+    void setSearchIndexEnabled(bool enabled);
+    [[nodiscard]] bool searchIndexEnabled() const noexcept { return _searchIndexEnabled; }
+
     [[nodiscard]] LineCount totalLineCount() const noexcept
     {
         return maxHistoryLineCount() + _pageSize.lines;
@@ -624,6 +801,24 @@ class Grid
     ///
     /// @returns updated cursor position.
     [[nodiscard]] CellLocation resize(PageSize newSize, CellLocation currentCursorPos, bool wrapPending);
+
+    /// Ensures that all lines from @p top down to the bottom of the main page are laid out
+    /// for the current page width.
+    ///
+    /// Resizing with reflow only reflows the main page and the most recent history lines right away.
+    /// Older history lines keep the column count they were last laid out for (i.e. their size)
+    /// until they are reflowed by this function, which must be called before accessing them
+    /// cell-wise, e.g. when rendering a viewport scrolled into the history or when searching.
+    void reflowHistoryFrom(LineOffset top);
+
+    /// Reflows all history lines not yet laid out for the current page width.
+    void reflowHistory() { reflowHistoryFrom(-boxed_cast<LineOffset>(historyLineCount())); }
+
+    /// @returns the number of oldest history lines that may not be laid out for the current page width yet.
+    [[nodiscard]] LineCount unreflowedHistoryLineCount() const noexcept
+    {
+        return std::min(_unreflowedHistoryLines, historyLineCount());
+    }
     // }}}
 
     // {{{ Line API
@@ -641,6 +836,12 @@ class Grid
     [[nodiscard]] std::string lineTextTrimmed(LineOffset line) const;
     [[nodiscard]] std::string lineText(Line<Cell> const& line) const;
 
+    /// Takes a snapshot of the text of the lines from @p top to @p bottom (inclusive).
+    ///
+    /// Stored lines share their text with the snapshot, so that this is cheap enough to be done
+    /// while holding the terminal lock, processing the text only after having released it.
+    [[nodiscard]] std::vector<LineTextSnapshot> textSnapshot(LineOffset top, LineOffset bottom) const;
+
     void setLineText(LineOffset line, std::string_view text);
 
     // void resetLine(LineOffset line, GraphicsAttributes attribs) noexcept
@@ -668,6 +869,7 @@ class Grid
 
     [[nodiscard]] LogicalLines<Cell> logicalLines()
     {
+        markAllLinesDirty();
         return LogicalLines<Cell> { boxed_cast<LineOffset>(-historyLineCount()),
                                     boxed_cast<LineOffset>(_pageSize.lines - 1),
                                     _lines };
@@ -675,11 +877,18 @@ class Grid
 
     [[nodiscard]] LogicalLines<Cell> logicalLinesFrom(LineOffset offset)
     {
-        return LogicalLines<Cell> { offset, boxed_cast<LineOffset>(_pageSize.lines - 1), _lines };
+        return logicalLinesFrom(offset, boxed_cast<LineOffset>(_pageSize.lines - 1));
+    }
+
+    [[nodiscard]] LogicalLines<Cell> logicalLinesFrom(LineOffset offset, LineOffset bottomMostLine)
+    {
+        markAllLinesDirty();
+        return LogicalLines<Cell> { offset, bottomMostLine, _lines };
     }
 
     [[nodiscard]] ReverseLogicalLines<Cell> logicalLinesReverse()
     {
+        markAllLinesDirty();
         return ReverseLogicalLines<Cell> { boxed_cast<LineOffset>(-historyLineCount()),
                                            boxed_cast<LineOffset>(_pageSize.lines - 1),
                                            _lines };
@@ -687,14 +896,212 @@ class Grid
 
     [[nodiscard]] ReverseLogicalLines<Cell> logicalLinesReverseFrom(LineOffset offset)
     {
-        return ReverseLogicalLines<Cell> { boxed_cast<LineOffset>(-historyLineCount()), offset, _lines };
+        return logicalLinesReverseFrom(offset, boxed_cast<LineOffset>(-historyLineCount()));
+    }
+
+    [[nodiscard]] ReverseLogicalLines<Cell> logicalLinesReverseFrom(LineOffset offset, LineOffset topMostLine)
+    {
+        markAllLinesDirty();
+        return ReverseLogicalLines<Cell> { topMostLine, offset, _lines };
+    }
+
+    // {{{ line ids
+    /// @returns an identifier of @p line that remains valid while lines are scrolled into the history,
+    ///          until lineIdGeneration() changes.
+    [[nodiscard]] uint64_t lineId(LineOffset line) const noexcept
+    {
+        return _linesScrolledIntoHistory + static_cast<uint64_t>(unbox<int64_t>(line));
+    }
+
+    /// @returns the current offset of the line identified by @p id, see lineId().
+    [[nodiscard]] LineOffset lineOffsetOf(uint64_t id) const noexcept
+    {
+        return LineOffset::cast_from(static_cast<int64_t>(id - _linesScrolledIntoHistory));
+    }
+
+    /// Changes whenever lines are moved other than by being scrolled into the history, e.g. by reflow.
+    [[nodiscard]] uint64_t lineIdGeneration() const noexcept { return _lineIdGeneration; }
+    // }}}
+
+    // {{{ search index
+    /// @returns the first line at or below @p line that may contain @p text.
+    ///
+    /// History lines the search index rules out are skipped, whereas main page lines are never ruled out.
+    /// The returned line is either @p line or the top line of a logical line.
+    [[nodiscard]] LineOffset nextSearchCandidate(LineOffset line, std::u32string_view text);
+
+    /// @returns the last line at or above @p line that may contain @p text,
+    ///          or std::nullopt if the search index rules out all lines from the top down to @p line.
+    ///
+    /// The returned line is either @p line or the bottom line of a logical line.
+    [[nodiscard]] std::optional<LineOffset> previousSearchCandidate(LineOffset line,
+                                                                    std::u32string_view text);
+    // }}}
+
+    // {{{ mark index
+    /// @returns the nearest marked line above @p line, if any.
+    ///
+    /// Marked history lines are looked up in an index of their line ids, which is extended lazily
+    /// by the lines that have been scrolled into the history since, whereas main page lines are scanned.
+    [[nodiscard]] std::optional<LineOffset> findMarkedLineAbove(LineOffset line) const;
+
+    /// @returns the nearest marked line below @p line, but not below @p bottom, if any.
+    [[nodiscard]] std::optional<LineOffset> findMarkedLineBelow(LineOffset line, LineOffset bottom) const;
+
+    /// Invalidates the mark index, which must be called when the mark of a history line is changed.
+    void invalidateMarkIndex() noexcept
+    {
+        _markedHistoryLines.clear();
+        _markIndexEnd = 0;
     }
+    // }}}
+
+    // {{{ command blocks
+    // The command blocks of the shell integration (OSC 133) are indexed in the order of their prompts.
+    // As they refer to lines by their ids, they are discarded whenever line ids are invalidated
+    // other than by lazily reflowing old history lines, e.g. by resizing the grid.
+
+    /// Starts a new command block with its prompt at @p line (OSC 133 A).
+    void startCommandPrompt(LineOffset line);
+
+    /// Notes @p line as where the command line of the current command block starts (OSC 133 B).
+    void startCommandInput(LineOffset line);
+
+    /// Notes @p line as where the output of the command being run starts (OSC 133 C).
+    void startCommandOutput(LineOffset line);
+
+    /// Finishes the command being run, with its output ending right above @p endLine (OSC 133 D).
+    void finishCommand(LineOffset endLine, std::optional<int> exitCode);
+
+    /// Accounts for @p bytes of text written while a command is being run.
+    void countCommandOutput(size_t bytes) noexcept
+    {
+        if (!_commandBlocks.empty() && _commandBlocks.back().block.running())
+            _commandBlocks.back().block.outputBytes += bytes;
+    }
+
+    [[nodiscard]] size_t commandBlockCount() const noexcept { return _commandBlocks.size(); }
+
+    /// @returns the most recent command block that has been run, if any.
+    [[nodiscard]] CommandBlock const* lastCommandBlock() const noexcept;
+
+    /// @returns the command block @p line belongs to, if any.
+    [[nodiscard]] CommandBlock const* commandBlockAt(LineOffset line) const noexcept;
+
+    /// @returns the prompt line of the nearest failed command above @p line, if any.
+    [[nodiscard]] std::optional<LineOffset> findFailedCommandAbove(LineOffset line) const noexcept;
+
+    /// @returns the prompt line of the nearest failed command below @p line, but not below @p bottom.
+    [[nodiscard]] std::optional<LineOffset> findFailedCommandBelow(LineOffset line,
+                                                                   LineOffset bottom) const noexcept;
+
+    /// @returns the text of the output of @p block, including its folded lines, but not below @p bottom.
+    [[nodiscard]] std::vector<LineTextSnapshot> commandOutputSnapshot(CommandBlock const& block,
+                                                                      LineOffset bottom) const;
+
+    /// Folds the output of the command block @p line belongs to, or unfolds it if folded already.
+    ///
+    /// Folded lines are taken out of the grid, such that neither rendering nor searching
+    /// visits them anymore, and put back in place when being unfolded.
+    /// Only output lines that have been scrolled into the history are folded.
+    ///
+    /// @returns the prompt line of the command block, if its output has been folded or unfolded.
+    std::optional<LineOffset> toggleCommandOutputFold(LineOffset line);
+    // }}}
+
+    // {{{ dirty line tracking
+    /// Marks the given line as modified since the last render pass.
+    ///
+    /// A modified history line may be visible at any scroll offset, so that all lines are marked instead.
+    void markLineDirty(LineOffset line) noexcept
+    {
+        if (*line < 0)
+            markAllLinesDirty();
+        else if (unbox<size_t>(line) < _dirtyLines.size())
+            _dirtyLines[unbox<size_t>(line)] = true;
+    }
+
+    void markAllLinesDirty() noexcept { _dirtyLines.assign(unbox<size_t>(_pageSize.lines), true); }
+
+    /// @returns for each line of the main page whether or not it has been modified since the last
+    ///          call to clearDirtyLines(), by writes, erases, scrolling, or any other mutable access.
+    [[nodiscard]] std::vector<bool> const& dirtyLines() const noexcept { return _dirtyLines; }
+
+    [[nodiscard]] bool isLineDirty(LineOffset line) const noexcept
+    {
+        return 0 <= *line && unbox<size_t>(line) < _dirtyLines.size() && _dirtyLines[unbox<size_t>(line)];
+    }
+
+    void clearDirtyLines() noexcept
+    {
+        // Lines cleared without being hashed may have changed since their last hash.
+        if (!_lineHashesCurrent)
+            _lineHashes.clear();
+        _lineHashesCurrent = false;
+        _dirtyLines.assign(unbox<size_t>(_pageSize.lines), false);
+    }
+
+    /// Clears the dirty bit of the lines that show the same contents as when they were last passed
+    /// through here, e.g. because a full-screen application has redrawn them identically.
+    ///
+    /// To be called right before the dirty lines are consumed (and cleared) by a render pass.
+    void clearUnchangedDirtyLines();
+    // }}}
 
     // {{{ buffer manipulation
 
     /// Completely deletes all scrollback lines.
     void clearHistory();
 
+    /// Appends @p lines to the history, as if they had been scrolled into it, e.g. to restore the
+    /// scrollback of a previous session. The main page is left as is.
+    ///
+    /// The lines are expected to be laid out for the current page width already.
+    void restoreHistory(std::vector<Line<Cell>> lines);
+
+    /// @returns the number of inflated lines that have been packed back into trivial line buffers
+    ///          when being scrolled into the history.
+    [[nodiscard]] size_t reclaimedLineCount() const noexcept { return _reclaimedLineCount; }
+
+    /// @returns the number of history lines that share their text with another line of the same contents,
+    ///          rather than storing a copy of their own.
+    [[nodiscard]] size_t dedupedLineCount() const noexcept { return _dedupedLineCount; }
+
+    /// Destroys the cells of the inflated lines that have been reset by scrolling up since the last call.
+    ///
+    /// Scrolling up, and therefore clearing the screen, only swaps these lines' cell buffers
+    /// for trivial ones, such that a full redraw of a TUI application does not have to wait for
+    /// each cell to be destroyed. This is meant to be called when there is no input to be processed.
+    void releaseRetiredLineBuffers() noexcept { _retiredLineBuffers.clear(); }
+
+    [[nodiscard]] size_t retiredLineBufferCount() const noexcept { return _retiredLineBuffers.size(); }
+
+    /// Packs the history lines inflated again since they have been scrolled into it back into trivial
+    /// line buffers where possible, destroys all retired and discarded lines, and returns the storage
+    /// not used by any line anymore to the system. This is meant to be called when running low on memory.
+    void trimMemory();
+
+    /// Destroys up to @p maxLineCount of the lines that have been discarded by clearHistory() or reset(),
+    /// and gives the memory back to the system once the last of them is gone.
+    ///
+    /// Clearing the history only swaps its lines for blank ones, such that clearing a history of
+    /// a million lines does not have to wait for each of them to be destroyed.
+    /// This is meant to be called repeatedly when there is no input to be processed.
+    ///
+    /// @returns whether there are discarded lines left to be destroyed.
+    bool releaseDiscardedLines(size_t maxLineCount);
+
+    [[nodiscard]] size_t discardedLineCount() const noexcept { return _discardedLines.size(); }
+
+    /// @returns the memory used by the lines of the main page and the history, without inflating them.
+    [[nodiscard]] GridMemoryStats memoryStats() const;
+
+    /// Marks the hyperlinks referenced by the main page and the history in @p referenced, indexed by ID.
+    void markHyperlinks(std::vector<bool>& referenced) const;
+
+    /// Writes statistics about the grid's line storage to @p os.
+    void inspect(std::ostream& os) const;
+
     /// Scrolls up by @p n lines within the given margin.
     ///
     /// @param n number of lines to scroll up within the given margin.
@@ -721,10 +1128,17 @@ class Grid
     // {{{ Rendering API
     /// Renders the full screen by passing every grid cell to the callback.
     template <typename RendererT>
-    [[nodiscard]] RenderPassHints render(
-        RendererT&& render,
-        ScrollOffset scrollOffset = {},
-        HighlightSearchMatches highlightSearchMatches = HighlightSearchMatches::Yes) const;
+    [[nodiscard]] RenderPassHints render(RendererT&& render, ScrollOffset scrollOffset = {}) const;
+
+    /// Renders the @p count screen lines starting at screen line @p first by passing their grid cells
+    /// to the callback, without finishing the render pass.
+    ///
+    /// Distinct line ranges of the same page may be rendered concurrently.
+    template <typename RendererT>
+    [[nodiscard]] RenderPassHints renderLines(RendererT&& render,
+                                              ScrollOffset scrollOffset,
+                                              LineOffset first,
+                                              LineCount count) const;
 
     /// Takes text-screenshot of the main page.
     [[nodiscard]] std::string renderMainPageText() const;
@@ -796,6 +1210,65 @@ class Grid
     void appendNewLines(LineCount count, GraphicsAttributes attr);
     void clampHistory();
 
+    // @returns the offset of the blank cells at the end of the given cells, i.e. those being empty
+    //          and using the default attributes, though never the first cell.
+    [[nodiscard]] static size_t blankTailStart(gsl::span<Cell const> cells) noexcept
+    {
+        auto const isBlank = [](Cell const& cell) {
+            return cell.codepointCount() == 0 && cell.flags().none()
+                   && cell.backgroundColor() == DefaultColor() && cell.hyperlink() == HyperlinkId {}
+                   && !cell.imageFragment();
+        };
+        auto end = cells.size();
+        while (end > 1 && isBlank(cells[end - 1]))
+            --end;
+        return end;
+    }
+
+    // Resets the given main page line, retiring its inflated cell buffer rather than destroying it.
+    void resetLineDeferred(LineOffset line, GraphicsAttributes attributes);
+
+    // Packs the lines that have just left the main page into trivial line buffers, if possible,
+    // with their text stored in scrollback text buffers, as history lines are not edited anymore.
+    // They are inflated again lazily, once anyone needs to access their cells.
+    // Lines of the same text as a recently compacted one share that line's text.
+    void compactColdLines(LineCount scrolledLines);
+
+    [[nodiscard]] crispy::buffer_object_ptr<char> allocateScrollbackText();
+
+    // Invoked whenever lines are moved other than by scrolling new lines into the history,
+    // which invalidates all line ids as well as the search index, which is rebuilt on the next search.
+    void invalidateLineIds() noexcept;
+
+    // Indexes the history lines that have been scrolled into the history since the last update.
+    void updateSearchIndex();
+
+    // Brings the mark index up to date with the lines having been scrolled into (or out of) the history.
+    void updateMarkIndex() const;
+
+    // A command block along with the output lines folded away.
+    struct CommandBlockEntry
+    {
+        CommandBlock block;
+        std::vector<Line<Cell>> foldedLines;
+    };
+
+    [[nodiscard]] std::optional<size_t> commandBlockIndexAt(LineOffset line) const noexcept;
+    bool foldCommandOutput(size_t index);
+    void unfoldCommandOutput(size_t index);
+
+    // Puts all folded output lines back into the grid, ahead of moving lines around other than by scrolling.
+    void unfoldCommandOutputs();
+
+    // Discards all command blocks, along with their folded output lines.
+    void discardCommandBlocks();
+
+    // Discards the command blocks whose prompt has been scrolled out of the history.
+    void trimCommandBlocks();
+
+    // Moves the line ids of the command blocks before @p end by @p delta lines.
+    void shiftCommandBlocks(int64_t delta, size_t end);
+
     // {{{ buffer helpers
     void resizeBuffers(PageSize newSize)
     {
@@ -811,6 +1284,41 @@ class Grid
     void rotateBuffersLeft(LineCount count) noexcept { _lines.rotate_left(unbox<size_t>(count)); }
 
     void rotateBuffersRight(LineCount count) noexcept { _lines.rotate_right(unbox<size_t>(count)); }
+
+    // Rotates the main page lines within [top, bottom] up (or down) by count lines.
+    // Only the line objects are moved around, their cells stay where they are.
+    void rotateLinesUp(LineOffset top, LineOffset bottom, LineCount count) noexcept
+    {
+        auto const first = std::next(_lines.begin(), *top);
+        auto const last = std::next(_lines.begin(), *bottom + 1);
+        std::rotate(first, std::next(first, *std::min(count, boxed_cast<LineCount>(bottom - top + 1))), last);
+    }
+
+    void rotateLinesDown(LineOffset top, LineOffset bottom, LineCount count) noexcept
+    {
+        auto const first = std::next(_lines.begin(), *top);
+        auto const last = std::next(_lines.begin(), *bottom + 1);
+        std::rotate(first, std::prev(last, *std::min(count, boxed_cast<LineCount>(bottom - top + 1))), last);
+    }
+
+    [[nodiscard]] static size_t cellBlockSize(ColumnCount columns) noexcept
+    {
+        return unbox<size_t>(columns) * sizeof(Cell);
+    }
+
+    // Swaps @p line for a blank line of the same width, keeping the old one in _discardedLines
+    // unless there is nothing to be destroyed.
+    void discardLine(Line<Cell>& line);
+
+    // Returns the memory that is not used by any line anymore to the system.
+    void releaseUnusedStorage();
+
+    // Makes all lines allocate their cells from this grid's cell pool when being inflated.
+    void adoptCellPool() noexcept
+    {
+        for (auto& line: _lines)
+            line.setCellResource(_cellPool.get());
+    }
     // }}}
 
     // private fields
@@ -819,6 +1327,51 @@ class Grid
     bool _reflowOnResize = false;
     MaxHistoryLineCount _historyLimit;
 
+    // Slab allocator for the cells of inflated lines, with blocks sized to hold exactly one line.
+    // Lines that are reset give back their block, which is then reused by the next line to be inflated.
+    // Heap allocated, such that the lines' references to it remain valid when the grid is moved.
+    std::unique_ptr<crispy::slab_resource> _cellPool;
+
+    // Cell buffers of inflated lines that have been reset by scrolling (e.g. when clearing the screen),
+    // which are only destroyed by releaseRetiredLineBuffers(). At most one page worth of lines is kept.
+    std::vector<InflatedLineBuffer<Cell>> _retiredLineBuffers;
+
+    // Lines swapped out by clearHistory() and reset(), destroyed in batches by releaseDiscardedLines().
+    crispy::chunked_vector<Line<Cell>> _discardedLines;
+
+    // Number of inflated lines packed back into trivial line buffers by compactColdLines().
+    size_t _reclaimedLineCount = 0;
+
+    // Text storage for lines packed by compactColdLines(), written to sequentially.
+    // Buffers are recycled once all lines referencing them have been reset.
+    static constexpr size_t ScrollbackTextBufferSize = 64 * 1024;
+    std::unique_ptr<crispy::buffer_object_pool<char>> _scrollbackTextPool;
+    size_t _scrollbackTextHeapBuffers = 0;
+
+    // File-backed scrollback text storage, used instead of the heap once it has exceeded the memory budget.
+    // Created on demand, and kept alive for as long as the grid, as lines may still reference it.
+    bool _historySpill = false;
+    size_t _historyMemoryBudget = 0;
+    std::unique_ptr<crispy::mapped_buffer_pool> _spillPool;
+
+    crispy::buffer_object_ptr<char> _scrollbackText;
+
+    // Texts of recently compacted lines, looked up by their hash, such that runs of repetitive output
+    // (e.g. progress bars redrawn in place, repeated warnings) are stored only once. A direct-mapped
+    // cache suffices, as repetitions tend to be close to each other.
+    struct RecentText
+    {
+        size_t hash = 0;
+        crispy::BufferFragment<char> text {};
+    };
+    static constexpr size_t RecentTextCount = 64;
+    std::array<RecentText, RecentTextCount> _recentTexts {};
+    size_t _dedupedLineCount = 0;
+
+    // @returns the cache slot of @p text, holding either the text of a recently compacted line equal to it,
+    //          or no text, to be filled in by the caller.
+    RecentText& recentTextSlot(std::string_view text) noexcept;
+
     // Number of lines is at least the sum of _maxHistoryLineCount + _pageSize.lines,
     // because shrinking the page height does not necessarily
     // have to resize the array (as optimization).
@@ -826,6 +1379,32 @@ class Grid
 
     // Number of lines used in the Lines buffer.
     LineCount _linesUsed;
+
+    // One bit per main page line, set when the line is accessed mutably, see markLineDirty().
+    std::vector<bool> _dirtyLines;
+
+    // Per main page line, the content hash as of the last clearUnchangedDirtyLines() the line was dirty in.
+    std::vector<crispy::strong_hash> _lineHashes;
+    bool _lineHashesCurrent = false;
+
+    // Number of the oldest history lines that are to be reflowed lazily, see reflowHistoryFrom().
+    // The most recent history lines, as well as each lazily reflowed range, span at least this many lines.
+    static constexpr auto HistoryReflowChunkSize = LineCount(1000);
+    LineCount _unreflowedHistoryLines = LineCount(0);
+
+    // Number of lines ever scrolled into the history, such that the line at offset k
+    // is identified by _linesScrolledIntoHistory + k, see lineId().
+    uint64_t _linesScrolledIntoHistory = 0;
+    uint64_t _lineIdGeneration = 0;
+    bool _searchIndexEnabled = false;
+    SearchIndex _searchIndex;
+
+    // Ascending ids of the marked history lines, with all history lines up to _markIndexEnd indexed.
+    mutable std::deque<uint64_t> _markedHistoryLines;
+    mutable uint64_t _markIndexEnd = 0;
+
+    // Command blocks of the shell integration, in ascending order of their prompt lines' ids.
+    std::deque<CommandBlockEntry> _commandBlocks;
 };
 
 template <typename Cell>
@@ -861,42 +1440,66 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 template <typename RendererT>
 [[nodiscard]] RenderPassHints Grid<Cell>::render(
+    RendererT&& render, // NOLINT(cppcoreguidelines-missing-std-forward)
+    ScrollOffset scrollOffset) const
+{
+    auto const hints = renderLines(render, scrollOffset, LineOffset(0), _pageSize.lines);
+    render.finish();
+    return hints;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+template <typename RendererT>
+[[nodiscard]] RenderPassHints Grid<Cell>::renderLines(
     RendererT&& render, // NOLINT(cppcoreguidelines-missing-std-forward)
     ScrollOffset scrollOffset,
-    HighlightSearchMatches highlightSearchMatches) const
+    LineOffset first,
+    LineCount count) const
 {
     assert(!scrollOffset || unbox<LineCount>(scrollOffset) <= historyLineCount());
+    assert(*first >= 0 && boxed_cast<LineCount>(first) + count <= _pageSize.lines);
 
-    auto y = LineOffset(0);
+    auto y = first;
     auto hints = RenderPassHints {};
-    for (int i = -*scrollOffset, e = i + *_pageSize.lines; i != e; ++i, ++y)
+    for (int i = *first - *scrollOffset, e = i + *count; i != e; ++i, ++y)
     {
         auto x = ColumnOffset(0);
         Line<Cell> const& line = _lines[i];
-        // NB: trivial liner rendering only works trivially if we don't do cell-based operations
-        // on the text. Therefore, we only move to the trivial fast path here if we don't want to
-        // highlight search matches.
-        if (line.isTrivialBuffer() && highlightSearchMatches == HighlightSearchMatches::No)
+        // Search matches are highlighted by the renderer, within trivial lines, too.
+        if (line.isTrivialBuffer())
         {
-            auto const cellFlags = line.trivialBuffer().textAttributes.flags;
+            auto const cellFlags = line.trivialBuffer().textFlags();
             hints.containsBlinkingCells = hints.containsBlinkingCells || (cellFlags & CellFlag::Blinking)
                                           || (cellFlags & CellFlag::RapidBlinking);
             render.renderTrivialLine(line.trivialBuffer(), y);
         }
         else
         {
+            // Renderers that can take the blank cells at the end of the line at once get them so,
+            // which saves most of the work on very wide pages with only short lines of text.
+            auto const cells = line.cells();
+            auto const blankTail = [&]() -> size_t {
+                if constexpr (requires { render.renderBlankCells(cells, y, x); })
+                    return blankTailStart(cells);
+                else
+                    return cells.size();
+            }();
+
             render.startLine(y);
-            for (Cell const& cell: line.cells())
+            for (Cell const& cell: cells.first(blankTail))
             {
                 hints.containsBlinkingCells = hints.containsBlinkingCells
                                               || (cell.flags() & CellFlag::Blinking)
                                               || (cell.flags() & CellFlag::RapidBlinking);
                 render.renderCell(cell, y, x++);
             }
+            if constexpr (requires { render.renderBlankCells(cells, y, x); })
+                if (blankTail < cells.size())
+                    render.renderBlankCells(cells.subspan(blankTail), y, x);
             render.endLine();
         }
     }
-    render.finish();
     return hints;
 }
 // }}}
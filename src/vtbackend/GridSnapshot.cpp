@@ -0,0 +1,459 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/GridSnapshot.h>
+#include <vtbackend/Line.h>
+
+#include <crispy/BufferObject.h>
+#include <crispy/logstore.h>
+
+#include <libunicode/convert.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+using std::nullopt;
+using std::optional;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace fs = std::filesystem;
+
+namespace vtbackend
+{
+
+namespace
+{
+    // The values are stored in host byte order, as snapshots are not meant to be moved to other machines.
+    constexpr auto Magic = std::array<char, 8> { 'C', 'T', 'G', 'R', 'I', 'D', 'S', 'N' };
+    constexpr auto Version = uint32_t { 1 };
+
+    struct Header
+    {
+        std::array<char, 8> magic = Magic;
+        uint32_t version = Version;
+        uint32_t reserved = 0;
+        uint64_t historyLineCount = 0; // records following the header
+        uint64_t pageOffset = 0;       // file offset of the main page line records
+        uint64_t pageLineCount = 0;
+        uint64_t endOffset = 0; // file offset past the last record, with anything following it being stale
+    };
+
+    static_assert(std::is_trivially_copyable_v<Header>);
+
+    enum class RecordKind : uint8_t
+    {
+        Trivial = 0, // text with attribute runs, as held by a TrivialLineBuffer
+        Cells = 1,   // attributes and text of each cell
+    };
+
+    // Records a full rewrite once the file holds twice the history lines of the grid, but not below this.
+    constexpr auto MinHistoryLinesToRewrite = uint64_t { 4096 };
+
+    // {{{ encoding
+    template <typename T>
+    void put(string& output, T value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        output.append(reinterpret_cast<char const*>(&value), sizeof(value));
+    }
+
+    void putAttributes(string& output, GraphicsAttributes const& attributes)
+    {
+        put(output, attributes.foregroundColor.content);
+        put(output, attributes.backgroundColor.content);
+        put(output, attributes.underlineColor.content);
+        put(output, attributes.flags.value());
+    }
+
+    void putTrivial(string& output, TrivialLineBuffer const& buffer, string_view text)
+    {
+        put(output, RecordKind::Trivial);
+        put(output, unbox<uint32_t>(buffer.displayWidth));
+        putAttributes(output, buffer.textAttributes);
+        putAttributes(output, buffer.fillAttributes);
+        put(output, unbox<uint32_t>(buffer.usedColumns));
+        put(output, static_cast<uint32_t>(buffer.spans.size()));
+        put(output, static_cast<uint32_t>(buffer.columnOffsets.size()));
+        for (auto const& span: buffer.spans)
+        {
+            put(output, unbox<uint32_t>(span.start));
+            putAttributes(output, span.attributes);
+        }
+        for (auto const offset: buffer.columnOffsets)
+            put(output, offset);
+        output.append(text);
+    }
+
+    template <typename Cell>
+    void putCells(string& output, InflatedLineBuffer<Cell> const& cells)
+    {
+        put(output, RecordKind::Cells);
+        put(output, static_cast<uint32_t>(cells.size()));
+        for (Cell const& cell: cells)
+        {
+            auto const text = cell.toUtf8();
+            putAttributes(output,
+                          GraphicsAttributes { cell.foregroundColor(),
+                                               cell.backgroundColor(),
+                                               cell.underlineColor(),
+                                               cell.flags() });
+            put(output, static_cast<uint8_t>(cell.width()));
+            put(output, static_cast<uint16_t>(text.size()));
+            output.append(text);
+        }
+    }
+
+    template <typename Cell>
+    void putLine(string& output, Line<Cell> const& line)
+    {
+        auto const start = output.size();
+        put(output, uint32_t { 0 }); // record size, including itself
+        put(output, line.flags().value());
+
+        if (line.isTrivialBuffer())
+        {
+            // TODO: Keep the hyperlinks, once they are persisted as well.
+            putTrivial(output, line.trivialBuffer(), line.trivialBuffer().text.view());
+        }
+        else
+        {
+            auto text = string {};
+            if (auto const buffer = deflate<Cell>(line.inflatedBuffer(), text))
+                putTrivial(output, *buffer, text);
+            else
+                putCells(output, line.inflatedBuffer());
+        }
+
+        auto const size = static_cast<uint32_t>(output.size() - start);
+        std::memcpy(output.data() + start, &size, sizeof(size));
+    }
+    // }}}
+
+    // {{{ decoding
+    /// Reads the values of a single record, failing on anything past its end.
+    class RecordReader
+    {
+      public:
+        RecordReader(char const* data, size_t size) noexcept: _data { data }, _size { size } {}
+
+        template <typename T>
+        [[nodiscard]] bool get(T& value) noexcept
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            if (_size - _offset < sizeof(T))
+                return false;
+            std::memcpy(&value, _data + _offset, sizeof(T));
+            _offset += sizeof(T);
+            return true;
+        }
+
+        [[nodiscard]] bool getAttributes(GraphicsAttributes& attributes) noexcept
+        {
+            auto flags = CellFlags {}.value();
+            if (!get(attributes.foregroundColor.content) || !get(attributes.backgroundColor.content)
+                || !get(attributes.underlineColor.content) || !get(flags))
+                return false;
+            attributes.flags = CellFlags::from_value(flags);
+            return true;
+        }
+
+        [[nodiscard]] bool skip(size_t count) noexcept
+        {
+            if (_size - _offset < count)
+                return false;
+            _offset += count;
+            return true;
+        }
+
+        [[nodiscard]] size_t offset() const noexcept { return _offset; }
+        [[nodiscard]] size_t remaining() const noexcept { return _size - _offset; }
+
+      private:
+        char const* _data;
+        size_t _size;
+        size_t _offset = 0;
+    };
+
+    template <typename Cell>
+    optional<Line<Cell>> getTrivial(RecordReader& record,
+                                    LineFlags flags,
+                                    crispy::buffer_object<char>& file,
+                                    size_t recordOffset,
+                                    ColumnCount columns)
+    {
+        auto displayWidth = uint32_t {};
+        auto buffer = TrivialLineBuffer {};
+        auto usedColumns = uint32_t {};
+        auto spanCount = uint32_t {};
+        auto offsetCount = uint32_t {};
+        if (!record.get(displayWidth) || !record.getAttributes(buffer.textAttributes)
+            || !record.getAttributes(buffer.fillAttributes) || !record.get(usedColumns)
+            || !record.get(spanCount) || !record.get(offsetCount))
+            return nullopt;
+        if (usedColumns > displayWidth || spanCount > TrivialLineBuffer::MaxSpans
+            || (offsetCount != 0 && offsetCount != usedColumns))
+            return nullopt;
+        buffer.displayWidth = ColumnCount::cast_from(displayWidth);
+        buffer.usedColumns = ColumnCount::cast_from(usedColumns);
+
+        buffer.spans.resize(spanCount);
+        for (auto& span: buffer.spans)
+        {
+            auto start = uint32_t {};
+            if (!record.get(start) || !record.getAttributes(span.attributes))
+                return nullopt;
+            span.start = ColumnOffset::cast_from(start);
+        }
+        for (size_t i = 1; i < buffer.spans.size(); ++i)
+            if (buffer.spans[i].start <= buffer.spans[i - 1].start)
+                return nullopt;
+        if (!buffer.spans.empty()
+            && (buffer.spans.front().start < ColumnOffset(0)
+                || buffer.spans.back().start > boxed_cast<ColumnOffset>(buffer.usedColumns)))
+            return nullopt;
+
+        buffer.columnOffsets.resize(offsetCount);
+        for (auto& offset: buffer.columnOffsets)
+            if (!record.get(offset))
+                return nullopt;
+
+        auto const textSize = record.remaining();
+        if (offsetCount == 0 && textSize != usedColumns)
+            return nullopt;
+        if (!std::is_sorted(buffer.columnOffsets.begin(), buffer.columnOffsets.end())
+            || (!buffer.columnOffsets.empty()
+                && (buffer.columnOffsets.front() != 0 || buffer.columnOffsets.back() >= textSize)))
+            return nullopt;
+        buffer.text = file.ref(recordOffset + record.offset(), textSize);
+
+        if (buffer.usedColumns <= columns)
+        {
+            buffer.displayWidth = columns;
+            return Line<Cell> { flags, std::move(buffer) };
+        }
+
+        // Truncated to the page width, the same way as when resizing without reflow.
+        auto line = Line<Cell> { flags, std::move(buffer) };
+        (void) line.inflatedBuffer();
+        line.resize(columns);
+        return line;
+    }
+
+    template <typename Cell>
+    optional<Line<Cell>> getCells(RecordReader& record,
+                                  LineFlags flags,
+                                  crispy::buffer_object<char> const& file,
+                                  size_t recordOffset,
+                                  ColumnCount columns)
+    {
+        auto cellCount = uint32_t {};
+        if (!record.get(cellCount) || cellCount > record.remaining())
+            return nullopt;
+
+        auto cells = InflatedLineBuffer<Cell>(cellCount);
+        for (Cell& cell: cells)
+        {
+            auto attributes = GraphicsAttributes {};
+            auto width = uint8_t {};
+            auto textSize = uint16_t {};
+            if (!record.getAttributes(attributes) || !record.get(width) || !record.get(textSize))
+                return nullopt;
+            auto const textOffset = record.offset();
+            if (!record.skip(textSize))
+                return nullopt;
+
+            auto const codepoints = unicode::convert_to<char32_t>(
+                string_view(file.data() + recordOffset + textOffset, textSize));
+            if (codepoints.empty())
+            {
+                cell.reset(attributes);
+                cell.setWidth(width);
+                continue;
+            }
+            cell.write(attributes, codepoints.front(), width);
+            for (size_t i = 1; i < codepoints.size(); ++i)
+                (void) cell.appendCharacter(codepoints[i]);
+        }
+
+        auto line = Line<Cell> { flags, std::move(cells) };
+        line.resize(columns);
+        return line;
+    }
+
+    template <typename Cell>
+    optional<Line<Cell>> getLine(crispy::buffer_object<char>& file,
+                                 size_t& offset,
+                                 uint64_t endOffset,
+                                 ColumnCount columns)
+    {
+        auto recordSize = uint32_t {};
+        if (endOffset - offset < sizeof(recordSize))
+            return nullopt;
+        std::memcpy(&recordSize, file.data() + offset, sizeof(recordSize));
+        if (recordSize < sizeof(recordSize) || endOffset - offset < recordSize)
+            return nullopt;
+
+        auto record = RecordReader { file.data() + offset, recordSize };
+        auto const recordOffset = offset;
+        offset += recordSize;
+
+        auto flags = LineFlags {}.value();
+        auto kind = RecordKind {};
+        if (!record.skip(sizeof(recordSize)) || !record.get(flags) || !record.get(kind))
+            return nullopt;
+
+        switch (kind)
+        {
+            case RecordKind::Trivial:
+                return getTrivial<Cell>(record, LineFlags::from_value(flags), file, recordOffset, columns);
+            case RecordKind::Cells:
+                return getCells<Cell>(record, LineFlags::from_value(flags), file, recordOffset, columns);
+        }
+        return nullopt;
+    }
+    // }}}
+} // namespace
+
+template <typename Cell>
+bool GridSnapshotWriter::write(Grid<Cell> const& grid)
+{
+    auto const historyBegin = grid.lineId(-boxed_cast<LineOffset>(grid.historyLineCount()));
+    auto const historyEnd = grid.lineId(LineOffset(0));
+    auto const rewrite = !_file.is_open() || grid.lineIdGeneration() != _lineIdGeneration
+                         || _historyEnd < historyBegin || historyEnd < _historyEnd
+                         || _historyLineCount + (historyEnd - _historyEnd)
+                                > 2 * std::max(unbox<uint64_t>(grid.historyLineCount()),
+                                               MinHistoryLinesToRewrite);
+
+    if (rewrite)
+    {
+        _file.close();
+        _file.clear();
+        auto ec = std::error_code {};
+        fs::create_directories(_path.parent_path(), ec);
+        _file.open(_path, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+        if (!_file.is_open())
+        {
+            errorLog()("Failed to write terminal snapshot to {}.", _path.string());
+            return false;
+        }
+        _lineIdGeneration = grid.lineIdGeneration();
+        _historyEnd = historyBegin;
+        _historyLineCount = 0;
+        _pageOffset = sizeof(Header);
+        _page.clear();
+        _file.write(string(sizeof(Header), '\0').data(), sizeof(Header));
+    }
+
+    // Trailing empty lines of the main page are of no use to be restored.
+    auto pageLineCount = unbox<int>(grid.pageSize().lines);
+    while (pageLineCount > 0 && grid.lineAt(LineOffset(pageLineCount - 1)).empty())
+        --pageLineCount;
+
+    auto page = string {};
+    for (auto line = 0; line < pageLineCount; ++line)
+        putLine(page, grid.lineAt(LineOffset(line)));
+
+    if (!rewrite && _historyEnd == historyEnd && page == _page)
+        return true;
+
+    auto history = string {};
+    for (auto id = _historyEnd; id < historyEnd; ++id)
+        putLine(history, grid.lineAt(grid.lineOffsetOf(id)));
+
+    auto header = Header {};
+    header.historyLineCount = _historyLineCount + (historyEnd - _historyEnd);
+    header.pageOffset = _pageOffset + history.size();
+    header.pageLineCount = static_cast<uint64_t>(pageLineCount);
+    header.endOffset = header.pageOffset + page.size();
+
+    // The header is updated last, such that it describes consistent records
+    // until the new records have been written.
+    _file.seekp(static_cast<std::streamoff>(_pageOffset));
+    _file.write(history.data(), static_cast<std::streamsize>(history.size()));
+    _file.write(page.data(), static_cast<std::streamsize>(page.size()));
+    _file.flush();
+    _file.seekp(0);
+    _file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    _file.flush();
+    if (!_file.good())
+    {
+        errorLog()("Failed to write terminal snapshot to {}.", _path.string());
+        _file.close();
+        return false;
+    }
+
+    _historyEnd = historyEnd;
+    _historyLineCount = header.historyLineCount;
+    _pageOffset = header.pageOffset;
+    _page = std::move(page);
+    return true;
+}
+
+template <typename Cell>
+optional<LineCount> restoreGridSnapshot(Grid<Cell>& grid, fs::path const& path)
+{
+    auto ec = std::error_code {};
+    auto const fileSize = fs::file_size(path, ec);
+    if (ec || fileSize < sizeof(Header) || fileSize > std::numeric_limits<uint32_t>::max() / 2)
+        return nullopt;
+
+    auto input = std::ifstream(path, std::ios::binary);
+    auto file = crispy::buffer_object<char>::create(fileSize);
+    input.read(file->data(), static_cast<std::streamsize>(fileSize));
+    if (!input)
+        return nullopt;
+    file->advance(fileSize);
+
+    auto header = Header {};
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.magic != Magic || header.version != Version || header.endOffset > fileSize
+        || header.pageOffset > header.endOffset || header.pageOffset < sizeof(Header))
+        return nullopt;
+
+    // Stops at the first unreadable record, keeping the lines read until then.
+    auto const columns = grid.pageSize().columns;
+    auto const lineCount = header.historyLineCount + header.pageLineCount;
+    auto lines = vector<Line<Cell>> {};
+    lines.reserve(static_cast<size_t>(std::min(lineCount, header.endOffset / uint64_t { sizeof(uint32_t) })));
+    auto offset = size_t { sizeof(Header) };
+    while (lines.size() < lineCount)
+    {
+        auto line = getLine<Cell>(*file, offset, header.endOffset, columns);
+        if (!line)
+        {
+            errorLog()("Terminal snapshot {} is corrupt after {} lines.", path.string(), lines.size());
+            break;
+        }
+        lines.emplace_back(std::move(*line));
+    }
+
+    auto const restored = LineCount::cast_from(lines.size());
+    grid.restoreHistory(std::move(lines));
+    return restored;
+}
+
+} // namespace vtbackend
+
+#include <vtbackend/cell/CompactCell.h>
+template bool vtbackend::GridSnapshotWriter::write<vtbackend::CompactCell>(
+    Grid<vtbackend::CompactCell> const&);
+template std::optional<vtbackend::LineCount> vtbackend::restoreGridSnapshot<vtbackend::CompactCell>(
+    Grid<vtbackend::CompactCell>&, std::filesystem::path const&);
+
+#include <vtbackend/cell/SimpleCell.h>
+template bool vtbackend::GridSnapshotWriter::write<vtbackend::SimpleCell>(
+    Grid<vtbackend::SimpleCell> const&);
+template std::optional<vtbackend::LineCount> vtbackend::restoreGridSnapshot<vtbackend::SimpleCell>(
+    Grid<vtbackend::SimpleCell>&, std::filesystem::path const&);
+
+#include <vtbackend/cell/FlatCell.h>
+template bool vtbackend::GridSnapshotWriter::write<vtbackend::FlatCell>(Grid<vtbackend::FlatCell> const&);
+template std::optional<vtbackend::LineCount> vtbackend::restoreGridSnapshot<vtbackend::FlatCell>(
+    Grid<vtbackend::FlatCell>&, std::filesystem::path const&);
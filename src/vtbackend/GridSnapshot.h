@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <vtbackend/Grid.h>
+#include <vtbackend/primitives.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+
+namespace vtbackend
+{
+
+/**
+ * Persists the lines of a grid in a compact binary file, such that the scrollback of a session
+ * can be restored after a restart.
+ *
+ * The file starts with a fixed-size header, followed by one self-contained record per history line,
+ * in the order the lines have been scrolled into the history, and the records of the main page lines.
+ * Records hold the line's text in one piece, along with its attribute runs, the same way a
+ * TrivialLineBuffer does, so that restored lines reference the text within the loaded file
+ * rather than being parsed into cells. Only lines that cannot be stored as such are recorded cell-wise.
+ *
+ * As history lines do not change anymore, each write only appends the lines scrolled into
+ * the history since the last write, overwriting the main page lines written last time,
+ * and then updates the header. The file is rewritten as a whole only if the history has been
+ * rearranged (e.g. reflowed or cleared) or if it holds twice as many lines as the history by now.
+ *
+ * Hyperlinks, images, and the state of the terminal other than its lines are not persisted, as they
+ * belong to the application that produced them, which is not running anymore once the lines are restored.
+ */
+class GridSnapshotWriter
+{
+  public:
+    explicit GridSnapshotWriter(std::filesystem::path path): _path { std::move(path) } {}
+
+    [[nodiscard]] std::filesystem::path const& path() const noexcept { return _path; }
+
+    /// Writes the lines of @p grid that have changed since the last call.
+    ///
+    /// @returns false if the file could not be written.
+    template <typename Cell>
+    bool write(Grid<Cell> const& grid);
+
+    /// @returns the number of history lines held by the file.
+    [[nodiscard]] uint64_t historyLineCount() const noexcept { return _historyLineCount; }
+
+  private:
+    std::filesystem::path _path;
+    std::fstream _file;
+    uint64_t _lineIdGeneration = 0;
+    uint64_t _historyEnd = 0;       // line id following the last history line written
+    uint64_t _historyLineCount = 0; // number of history lines written
+    uint64_t _pageOffset = 0;       // file offset following the last history line written
+    std::string _page;              // records of the main page lines written last
+};
+
+/// Appends the lines of the snapshot at @p path to the history of @p grid, laid out for its page width.
+///
+/// @returns the number of lines restored, or std::nullopt if the file is not a readable snapshot.
+template <typename Cell>
+std::optional<LineCount> restoreGridSnapshot(Grid<Cell>& grid, std::filesystem::path const& path);
+
+} // namespace vtbackend
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/Grid.h>
+#include <vtbackend/GridSnapshot.h>
+#include <vtbackend/cell/CellConfig.h>
+#include <vtbackend/primitives.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+
+using namespace vtbackend;
+using namespace std::string_view_literals;
+
+using Cell = PrimaryScreenCell;
+
+namespace
+{
+
+auto snapshotPath(std::string_view name)
+{
+    auto path = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove(path);
+    return path;
+}
+
+} // namespace
+
+TEST_CASE("GridSnapshot.roundtrip", "[grid]")
+{
+    auto const path = snapshotPath("vtbackend_snapshot_roundtrip.bin");
+    auto grid = Grid<Cell>(PageSize { LineCount(3), ColumnCount(5) }, true, LineCount(10));
+    grid.setLineText(LineOffset(0), "ABC"sv);
+    grid.useCellAt(LineOffset(0), ColumnOffset(1)).setForegroundColor(Color::Indexed(IndexedColor::Red));
+    grid.lineAt(LineOffset(0)).setMarked(true);
+    grid.useCellAt(LineOffset(1), ColumnOffset(0)).setCharacter('a');
+    grid.useCellAt(LineOffset(1), ColumnOffset(2)).setCharacter('c');
+    grid.scrollUp(LineCount(2));
+    grid.setLineText(LineOffset(0), "12345"sv);
+
+    auto writer = GridSnapshotWriter { path };
+    REQUIRE(writer.write(grid));
+    CHECK(writer.historyLineCount() == 2);
+
+    // The trailing empty lines of the main page are not restored.
+    auto restored = Grid<Cell>(PageSize { LineCount(2), ColumnCount(5) }, true, LineCount(10));
+    restored.setLineText(LineOffset(0), "xyz"sv);
+    CHECK(restoreGridSnapshot(restored, path) == LineCount(3));
+    REQUIRE(restored.historyLineCount() == LineCount(3));
+    CHECK(restored.lineText(LineOffset(-3)) == "ABC  ");
+    CHECK(restored.lineText(LineOffset(-2)) == "a c  ");
+    CHECK(restored.lineText(LineOffset(-1)) == "12345");
+    CHECK(restored.lineText(LineOffset(0)) == "xyz  ");
+    CHECK(restored.lineAt(LineOffset(-3)).marked());
+    CHECK(restored.lineAt(LineOffset(-3)).inflatedBuffer()[1].foregroundColor()
+          == Color::Indexed(IndexedColor::Red));
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("GridSnapshot.incremental", "[grid]")
+{
+    auto const path = snapshotPath("vtbackend_snapshot_incremental.bin");
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(5) }, true, Infinite());
+    auto writer = GridSnapshotWriter { path };
+
+    grid.setLineText(LineOffset(0), "line0"sv);
+    grid.scrollUp(LineCount(1));
+    REQUIRE(writer.write(grid));
+    auto const firstSize = std::filesystem::file_size(path);
+
+    // Only the lines scrolled into the history since are appended.
+    for (auto i = 1; i <= 3; ++i)
+    {
+        grid.setLineText(LineOffset(0), "line" + std::to_string(i));
+        grid.scrollUp(LineCount(1));
+    }
+    REQUIRE(writer.write(grid));
+    CHECK(writer.historyLineCount() == 4);
+    CHECK(std::filesystem::file_size(path) > firstSize);
+
+    auto restored = Grid<Cell>(PageSize { LineCount(2), ColumnCount(5) }, true, Infinite());
+    CHECK(restoreGridSnapshot(restored, path) == LineCount(4));
+    for (auto i = 0; i < 4; ++i)
+        CHECK(restored.lineText(LineOffset(i - 4)) == "line" + std::to_string(i));
+
+    // Clearing the history rewrites the file.
+    grid.clearHistory();
+    REQUIRE(writer.write(grid));
+    CHECK(writer.historyLineCount() == 0);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("GridSnapshot.invalid", "[grid]")
+{
+    auto const path = snapshotPath("vtbackend_snapshot_invalid.bin");
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(5) }, true, LineCount(10));
+    CHECK(!restoreGridSnapshot(grid, path).has_value());
+
+    std::ofstream(path, std::ios::binary) << std::string(100, 'x');
+    CHECK(!restoreGridSnapshot(grid, path).has_value());
+    CHECK(grid.historyLineCount() == LineCount(0));
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/Grid.h>
+#include <vtbackend/cell/CompactCell.h>
+#include <vtbackend/cell/SimpleCell.h>
+#include <vtbackend/primitives.h>
+
+#include <fmt/format.h>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_template_test_macros.hpp>
+
+#include <array>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace vtbackend;
+
+namespace
+{
+
+auto constexpr PageSizes = std::array { PageSize { LineCount(25), ColumnCount(80) },
+                                        PageSize { LineCount(60), ColumnCount(200) } };
+
+std::string lineText(int line, ColumnCount columns)
+{
+    auto text = fmt::format("{:04} ", line);
+    while (text.size() < unbox<size_t>(columns))
+        text += "The quick brown fox jumps over the lazy dog. ";
+    text.resize(unbox<size_t>(columns));
+    return text;
+}
+
+template <typename Cell>
+Grid<Cell> filledGrid(PageSize pageSize, LineCount historyLines)
+{
+    auto grid = Grid<Cell>(pageSize, true, LineCount(10000));
+    auto const totalLines = unbox<int>(pageSize.lines + historyLines);
+    for (auto i = 0; i < totalLines; ++i)
+    {
+        if (i >= unbox<int>(pageSize.lines))
+            grid.scrollUp(LineCount(1));
+        auto const line = std::min(i, unbox<int>(pageSize.lines) - 1);
+        grid.setLineText(LineOffset(line), lineText(i, pageSize.columns));
+    }
+    return grid;
+}
+
+} // namespace
+
+TEMPLATE_TEST_CASE("Grid.scrollUp", "[!benchmark][grid]", SimpleCell, CompactCell)
+{
+    for (auto const pageSize: PageSizes)
+    {
+        auto grid = filledGrid<TestType>(pageSize, LineCount(0));
+        auto const bottom = pageSize.lines.as<LineOffset>() - 1;
+        auto const right = pageSize.columns.as<ColumnOffset>() - 1;
+        auto const fullMargin = Margin { Margin::Vertical { LineOffset(0), bottom },
+                                         Margin::Horizontal { ColumnOffset(0), right } };
+        auto const verticalMargin =
+            Margin { Margin::Vertical { LineOffset(1), bottom - 1 }, fullMargin.horizontal };
+        auto const boxMargin = Margin { verticalMargin.vertical,
+                                        Margin::Horizontal { ColumnOffset(10), right - 10 } };
+
+        BENCHMARK(fmt::format("{} without margins", pageSize))
+        {
+            return grid.scrollUp(LineCount(1), GraphicsAttributes {}, fullMargin);
+        };
+        BENCHMARK(fmt::format("{} with vertical margins", pageSize))
+        {
+            return grid.scrollUp(LineCount(1), GraphicsAttributes {}, verticalMargin);
+        };
+        BENCHMARK(fmt::format("{} with vertical and horizontal margins", pageSize))
+        {
+            return grid.scrollUp(LineCount(1), GraphicsAttributes {}, boxMargin);
+        };
+    }
+}
+
+TEMPLATE_TEST_CASE("Grid.resize", "[!benchmark][grid]", SimpleCell, CompactCell)
+{
+    for (auto const pageSize: PageSizes)
+    {
+        auto const narrower = PageSize { pageSize.lines, pageSize.columns - 7 };
+        auto name = fmt::format("{} reflow to {}", pageSize, narrower);
+        BENCHMARK_ADVANCED(std::move(name))(Catch::Benchmark::Chronometer meter)
+        {
+            auto grids = std::vector<Grid<TestType>> {};
+            for (auto i = 0; i < meter.runs(); ++i)
+                grids.emplace_back(filledGrid<TestType>(pageSize, LineCount(1000)));
+            auto const cursor = CellLocation { pageSize.lines.as<LineOffset>() - 1, ColumnOffset(0) };
+            meter.measure(
+                [&](int i) { return grids[static_cast<size_t>(i)].resize(narrower, cursor, false); });
+        };
+    }
+}
+
+TEMPLATE_TEST_CASE("LogicalLine.search", "[!benchmark][grid]", SimpleCell, CompactCell)
+{
+    for (auto const pageSize: PageSizes)
+    {
+        auto grid = filledGrid<TestType>(pageSize, LineCount(1000));
+        BENCHMARK(fmt::format("{} with 1000 history lines", pageSize))
+        {
+            auto matches = 0;
+            for (auto const& line: grid.logicalLines())
+                if (line.search(U"lazy cat", ColumnOffset(0)))
+                    ++matches;
+            return matches;
+        };
+    }
+}
@@ -9,6 +9,8 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <algorithm>
+
 using namespace vtbackend;
 using namespace std::string_literals;
 using namespace std::string_view_literals;
@@ -170,6 +172,370 @@ TEST_CASE("Grid.writeAndScrollUp", "[grid]")
     CHECK(grid.lineText(LineOffset(1)) == "     ");
 }
 
+TEST_CASE("Grid.cellPool", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(5) }, true, LineCount(3));
+    auto& line0 = grid.lineAt(LineOffset(0));
+    auto& line1 = grid.lineAt(LineOffset(1));
+
+    auto* const cellResource = line0.inflatedBuffer().get_allocator().resource();
+    CHECK(cellResource != std::pmr::get_default_resource());
+    CHECK(line1.inflatedBuffer().get_allocator().resource() == cellResource);
+
+    // Resetting a line gives its cells back to the next line to be inflated.
+    auto const* const cells0 = line0.inflatedBuffer().data();
+    line0.reset(line0.flags(), GraphicsAttributes {});
+    REQUIRE(line0.isTrivialBuffer());
+    CHECK(line0.inflatedBuffer().data() == cells0);
+
+    // Lines keep using the pool after having been reflowed into a different width.
+    (void) grid.resize(PageSize { LineCount(2), ColumnCount(7) }, CellLocation {}, false);
+    auto& resizedLine = grid.lineAt(LineOffset(1));
+    resizedLine.reset(resizedLine.flags(), GraphicsAttributes {}, ColumnCount(7));
+    CHECK(resizedLine.inflatedBuffer().get_allocator().resource() == cellResource);
+    CHECK(resizedLine.inflatedBuffer().size() == 7);
+}
+
+TEST_CASE("Grid.retiredLineBuffers", "[grid]")
+{
+    // Without history, like the alternate screen.
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(5) }, false, LineCount(0));
+    grid.lineAt(LineOffset(0)).fill(ColumnOffset(0), GraphicsAttributes {}, "ab");
+    grid.lineAt(LineOffset(1)).fill(ColumnOffset(0), GraphicsAttributes {}, "cd");
+
+    // Clearing the page swaps in trivial lines, keeping the cell buffers until released.
+    (void) grid.scrollUp(LineCount(2));
+    CHECK(grid.lineAt(LineOffset(0)).isTrivialBuffer());
+    CHECK(grid.lineAt(LineOffset(1)).isTrivialBuffer());
+    CHECK(grid.lineAt(LineOffset(0)).empty());
+    CHECK(grid.lineAt(LineOffset(1)).empty());
+    CHECK(grid.retiredLineBufferCount() == 2);
+
+    grid.releaseRetiredLineBuffers();
+    CHECK(grid.retiredLineBufferCount() == 0);
+}
+
+TEST_CASE("Grid.compactColdLines", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(5) }, true, LineCount(10));
+    grid.setLineText(LineOffset(0), "ABC"sv);
+    grid.useCellAt(LineOffset(0), ColumnOffset(1)).setForegroundColor(Color::Indexed(IndexedColor::Red));
+    grid.useCellAt(LineOffset(1), ColumnOffset(0)).setCharacter('a');
+    grid.useCellAt(LineOffset(1), ColumnOffset(2)).setCharacter('c');
+
+    // Lines are packed as soon as they leave the main page.
+    grid.scrollUp(LineCount(2));
+    auto& packedLine = grid.lineAt(LineOffset(-2));
+    REQUIRE(packedLine.isTrivialBuffer());
+    CHECK(packedLine.trivialBuffer().text.view() == "ABC");
+    CHECK(packedLine.trivialBuffer().spans.size() == 2);
+    CHECK(grid.lineText(LineOffset(-2)) == "ABC  ");
+
+    // Gaps within the text cannot be represented by a trivial line buffer.
+    CHECK(grid.lineAt(LineOffset(-1)).isInflatedBuffer());
+    CHECK(grid.reclaimedLineCount() == 1);
+
+    // Lines that have never been inflated do not count as reclaimed.
+    grid.scrollUp(LineCount(2));
+    CHECK(grid.lineAt(LineOffset(-2)).isTrivialBuffer());
+    CHECK(grid.lineAt(LineOffset(-1)).isTrivialBuffer());
+    CHECK(grid.reclaimedLineCount() == 1);
+
+    // Packed lines are inflated back into the very same cells.
+    auto const& cells = packedLine.inflatedBuffer();
+    CHECK(cells[0].foregroundColor() == DefaultColor());
+    CHECK(cells[1].foregroundColor() == Color::Indexed(IndexedColor::Red));
+    CHECK(cells[2].foregroundColor() == DefaultColor());
+    CHECK(cells[3].empty());
+}
+
+TEST_CASE("Grid.compactColdLines.dedup", "[grid]")
+{
+    // A progress bar redrawn in place, before each time a new line starts.
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(5) }, true, LineCount(10));
+    for (auto i = 0; i < 4; ++i)
+    {
+        grid.setLineText(LineOffset(0), "#"sv);
+        grid.setLineText(LineOffset(0), "##"sv);
+        grid.scrollUp(LineCount(1));
+    }
+
+    auto const& first = grid.lineAt(LineOffset(-4));
+    auto const& last = grid.lineAt(LineOffset(-1));
+    REQUIRE(first.isTrivialBuffer());
+    REQUIRE(last.isTrivialBuffer());
+    CHECK(first.trivialBuffer().text.data() == last.trivialBuffer().text.data());
+    CHECK(grid.lineText(LineOffset(-1)) == "##   ");
+    CHECK(grid.reclaimedLineCount() == 4);
+    CHECK(grid.dedupedLineCount() == 3);
+
+    auto const stats = grid.memoryStats();
+    CHECK(stats.trivialTextBytes == 2);
+    CHECK(stats.sharedTextBytes == 3 * 2);
+}
+
+TEST_CASE("Grid.trimMemory", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(5) }, true, LineCount(10));
+    grid.setLineText(LineOffset(0), "ABC"sv);
+    grid.useCellAt(LineOffset(0), ColumnOffset(1)).setForegroundColor(Color::Indexed(IndexedColor::Red));
+    grid.scrollUp(LineCount(2));
+    REQUIRE(grid.lineAt(LineOffset(-2)).isTrivialBuffer());
+
+    // Lines inflated again in the history, e.g. by looking at them, are packed back.
+    (void) grid.lineAt(LineOffset(-2)).inflatedBuffer();
+    REQUIRE(grid.lineAt(LineOffset(-2)).isInflatedBuffer());
+    grid.trimMemory();
+    CHECK(grid.lineAt(LineOffset(-2)).isTrivialBuffer());
+    CHECK(grid.lineText(LineOffset(-2)) == "ABC  ");
+    CHECK(grid.reclaimedLineCount() == 2);
+
+    auto const stats = grid.memoryStats();
+    CHECK(stats.retiredLineBytes == 0);
+    CHECK(stats.scrollbackText.unusedBuffers == 0);
+}
+
+TEST_CASE("Grid.memoryStats", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(5) }, true, LineCount(0));
+    grid.setLineText(LineOffset(0), "ABC"sv);
+    grid.useCellAt(LineOffset(1), ColumnOffset(0)).setCharacter('e');
+    (void) grid.useCellAt(LineOffset(1), ColumnOffset(0)).appendCharacter(0x0301); // combining acute
+
+    auto const stats = grid.memoryStats();
+    CHECK(stats.trivialLines == stats.lines() - 1);
+    CHECK(stats.trivialTextBytes == 3);
+    CHECK(stats.inflatedLines == 1);
+    CHECK(stats.inflatedLineBytes >= 5 * sizeof(Cell));
+    CHECK(stats.cellExtras == 1);
+    CHECK(stats.bytes() >= stats.trivialTextBytes + stats.inflatedLineBytes);
+}
+
+TEST_CASE("Grid.historySpill", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(5) }, true, LineCount(10));
+    grid.setHistorySpill(true, 0);
+    CHECK(grid.historySpill());
+
+    grid.setLineText(LineOffset(0), "ABC"sv);
+    grid.setLineText(LineOffset(1), "DE"sv);
+    grid.scrollUp(LineCount(4));
+
+    // Spilled lines are packed as usual and read back from the file transparently.
+    REQUIRE(grid.lineAt(LineOffset(-4)).isTrivialBuffer());
+    REQUIRE(grid.lineAt(LineOffset(-3)).isTrivialBuffer());
+    CHECK(grid.lineText(LineOffset(-4)) == "ABC  ");
+    CHECK(grid.lineText(LineOffset(-3)) == "DE   ");
+
+    grid.setHistorySpill(false, 0);
+    CHECK(!grid.historySpill());
+    CHECK(grid.lineText(LineOffset(-4)) == "ABC  ");
+
+    grid.clearHistory();
+    CHECK(grid.historyLineCount() == LineCount(0));
+}
+
+TEST_CASE("Grid.clearHistory.discardedLines", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(5) }, true, LineCount(10));
+    for (auto i = 0; i < 6; ++i)
+    {
+        grid.setLineText(LineOffset(1), fmt::format("line{}", i));
+        grid.scrollUp(LineCount(1));
+    }
+    REQUIRE(grid.historyLineCount() == LineCount(6));
+
+    // The history is cleared right away, while its lines are destroyed later on, in batches.
+    // The initially blank line has nothing to be destroyed, and is therefore not kept.
+    grid.clearHistory();
+    CHECK(grid.historyLineCount() == LineCount(0));
+    CHECK(grid.lineText(LineOffset(0)) == "line5");
+    CHECK(grid.discardedLineCount() == 5);
+
+    CHECK(grid.releaseDiscardedLines(3));
+    CHECK(grid.discardedLineCount() == 2);
+    CHECK(!grid.releaseDiscardedLines(3));
+    CHECK(grid.discardedLineCount() == 0);
+}
+
+TEST_CASE("Grid.scrollUp.margin", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(5), ColumnCount(3) }, true, LineCount(10));
+    for (auto i = 0; i < 5; ++i)
+        grid.setLineText(LineOffset(i), fmt::format("{}{}{}", i, i, i));
+    auto const* const cells2 = grid.lineAt(LineOffset(2)).inflatedBuffer().data();
+    auto const margin = Margin { Margin::Vertical { LineOffset(1), LineOffset(3) },
+                                 Margin::Horizontal { ColumnOffset(0), ColumnOffset(2) } };
+
+    // Scrolling within full-width margins moves the lines, but not their cells.
+    CHECK(grid.scrollUp(LineCount(1), GraphicsAttributes {}, margin) == LineCount(0));
+    CHECK(grid.historyLineCount() == LineCount(0));
+    CHECK(grid.lineText(LineOffset(0)) == "000");
+    CHECK(grid.lineText(LineOffset(1)) == "222");
+    CHECK(grid.lineText(LineOffset(2)) == "333");
+    CHECK(grid.lineText(LineOffset(3)) == "   ");
+    CHECK(grid.lineText(LineOffset(4)) == "444");
+    CHECK(grid.lineAt(LineOffset(1)).inflatedBuffer().data() == cells2);
+
+    grid.scrollDown(LineCount(1), GraphicsAttributes {}, margin);
+    CHECK(grid.lineText(LineOffset(1)) == "   ");
+    CHECK(grid.lineText(LineOffset(2)) == "222");
+    CHECK(grid.lineText(LineOffset(3)) == "333");
+    CHECK(grid.lineText(LineOffset(4)) == "444");
+    CHECK(grid.lineAt(LineOffset(2)).inflatedBuffer().data() == cells2);
+}
+
+TEST_CASE("Grid.markIndex", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(5) }, true, LineCount(3));
+    grid.lineAt(LineOffset(0)).setMarked(true);
+    (void) grid.scrollUp(LineCount(1));
+    CHECK(grid.findMarkedLineAbove(LineOffset(2)) == LineOffset(-1));
+
+    grid.lineAt(LineOffset(1)).setMarked(true);
+    (void) grid.scrollUp(LineCount(1));
+    CHECK(grid.findMarkedLineAbove(LineOffset(2)) == LineOffset(0));
+    CHECK(grid.findMarkedLineAbove(LineOffset(0)) == LineOffset(-2));
+    CHECK(!grid.findMarkedLineAbove(LineOffset(-2)).has_value());
+    CHECK(grid.findMarkedLineBelow(LineOffset(-2), LineOffset(0)) == LineOffset(0));
+    CHECK(grid.findMarkedLineBelow(LineOffset(-3), LineOffset(0)) == LineOffset(-2));
+    CHECK(!grid.findMarkedLineBelow(LineOffset(0), LineOffset(1)).has_value());
+
+    // The first marked line leaves the history.
+    (void) grid.scrollUp(LineCount(2));
+    CHECK(grid.findMarkedLineAbove(LineOffset(2)) == LineOffset(-2));
+    CHECK(!grid.findMarkedLineAbove(LineOffset(-2)).has_value());
+
+    grid.lineAt(LineOffset(-1)).setMarked(true);
+    grid.invalidateMarkIndex();
+    CHECK(grid.findMarkedLineAbove(LineOffset(0)) == LineOffset(-1));
+}
+
+TEST_CASE("Grid.dirtyLines", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(4), ColumnCount(3) }, true, LineCount(10));
+    auto const dirtyLineCount = [&]() {
+        return std::count(grid.dirtyLines().begin(), grid.dirtyLines().end(), true);
+    };
+
+    // A new grid has not been rendered yet.
+    CHECK(dirtyLineCount() == 4);
+    grid.clearDirtyLines();
+    CHECK(dirtyLineCount() == 0);
+
+    // Reading leaves the lines clean.
+    auto const& constGrid = grid;
+    CHECK(constGrid.lineText(LineOffset(1)) == "   ");
+    CHECK(constGrid.lineAt(LineOffset(2)).empty());
+    CHECK(dirtyLineCount() == 0);
+
+    grid.setLineText(LineOffset(1), "ABC");
+    grid.useCellAt(LineOffset(3), ColumnOffset(2)).setCharacter(U'X');
+    CHECK(dirtyLineCount() == 2);
+    CHECK(!grid.isLineDirty(LineOffset(0)));
+    CHECK(grid.isLineDirty(LineOffset(1)));
+    CHECK(!grid.isLineDirty(LineOffset(2)));
+    CHECK(grid.isLineDirty(LineOffset(3)));
+
+    // Scrolling moves all lines.
+    grid.clearDirtyLines();
+    grid.scrollUp(LineCount(1));
+    CHECK(dirtyLineCount() == 4);
+
+    // Modifying history lines marks all lines, as they may be shown at any scroll offset.
+    grid.clearDirtyLines();
+    grid.lineAt(LineOffset(-1)).setMarked(true);
+    CHECK(dirtyLineCount() == 4);
+
+    grid.clearDirtyLines();
+    (void) grid.resize(PageSize { LineCount(5), ColumnCount(3) }, CellLocation {}, false);
+    CHECK(grid.dirtyLines().size() == 5);
+    CHECK(dirtyLineCount() == 5);
+}
+
+TEST_CASE("Grid.clearUnchangedDirtyLines", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(3), ColumnCount(3) }, true, LineCount(10));
+    auto const render = [&]() {
+        grid.clearUnchangedDirtyLines();
+        auto const dirtyLines = grid.dirtyLines();
+        grid.clearDirtyLines();
+        return dirtyLines;
+    };
+    auto const redraw = [&](LineOffset line, char32_t ch, Color color) {
+        for (auto column = 0; column < 3; ++column)
+        {
+            auto& cell = grid.useCellAt(line, ColumnOffset(column));
+            cell.setCharacter(ch);
+            cell.setForegroundColor(color);
+        }
+    };
+
+    // Lines not hashed before are modified.
+    redraw(LineOffset(0), U'A', Color::Indexed(IndexedColor::Red));
+    redraw(LineOffset(1), U'B', Color::Indexed(IndexedColor::Red));
+    CHECK(render() == std::vector<bool> { true, true, true });
+
+    // Rewriting a line with the same contents and attributes leaves it unmodified.
+    redraw(LineOffset(0), U'A', Color::Indexed(IndexedColor::Red));
+    redraw(LineOffset(1), U'B', Color::Indexed(IndexedColor::Green));
+    CHECK(render() == std::vector<bool> { false, true, false });
+
+    // Changes undone before the next render pass are no modification either.
+    redraw(LineOffset(1), U'X', Color::Indexed(IndexedColor::Green));
+    redraw(LineOffset(1), U'B', Color::Indexed(IndexedColor::Green));
+    CHECK(render() == std::vector<bool> { false, false, false });
+
+    // A render pass not comparing the lines forgets their contents.
+    redraw(LineOffset(0), U'Y', Color::Indexed(IndexedColor::Red));
+    grid.clearDirtyLines();
+    redraw(LineOffset(0), U'A', Color::Indexed(IndexedColor::Red));
+    CHECK(render() == std::vector<bool> { true, false, false });
+
+    // Scrolling shows other contents on the lines that were not empty.
+    grid.scrollUp(LineCount(1));
+    auto const dirtyLines = render();
+    CHECK(dirtyLines[0]);
+    CHECK(dirtyLines[1]);
+}
+
+TEST_CASE("Grid.searchIndex", "[grid]")
+{
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(8) }, true, LineCount(1000));
+    for (auto i = 0; i < 300; ++i)
+    {
+        grid.setLineText(LineOffset(1), i == 150 ? "needle" : "filler");
+        grid.scrollUp(LineCount(1));
+    }
+    auto const historyTop = -boxed_cast<LineOffset>(grid.historyLineCount());
+    auto needleLine = historyTop;
+    while (grid.lineTextTrimmed(needleLine) != "needle")
+        ++needleLine;
+
+    // Without the search index, all lines are candidates.
+    CHECK(grid.nextSearchCandidate(historyTop, U"needle") == historyTop);
+    CHECK(grid.previousSearchCandidate(LineOffset(-1), U"needle") == LineOffset(-1));
+
+    grid.setSearchIndexEnabled(true);
+    auto const next = grid.nextSearchCandidate(historyTop, U"needle");
+    CHECK(historyTop < next);
+    CHECK(next <= needleLine);
+    auto const previous = grid.previousSearchCandidate(LineOffset(-1), U"needle");
+    REQUIRE(previous.has_value());
+    CHECK(needleLine <= *previous);
+    CHECK(*previous < LineOffset(-1));
+
+    // Main page lines are never ruled out.
+    CHECK(grid.nextSearchCandidate(historyTop, U"absent") == LineOffset(0));
+    CHECK(grid.previousSearchCandidate(LineOffset(-1), U"absent") == std::nullopt);
+    CHECK(grid.nextSearchCandidate(LineOffset(1), U"absent") == LineOffset(1));
+
+    // Lines scrolled into the history later on are indexed as well.
+    grid.setLineText(LineOffset(1), "absent");
+    grid.scrollUp(LineCount(2));
+    CHECK(grid.previousSearchCandidate(LineOffset(-1), U"absent") == LineOffset(-1));
+}
+
 TEST_CASE("iteratorAt", "[grid]")
 {
     auto grid = Grid<Cell>(PageSize { LineCount(3), ColumnCount(3) }, true, LineCount(0));
@@ -838,6 +1204,112 @@ TEST_CASE("Grid.reflow.tripple", "[grid]")
     }
 }
 
+TEST_CASE("Grid.reflow.lazy_history", "[grid]")
+{
+    auto constexpr HistoryLineCount = 1500;
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(4) }, true, LineCount(10000));
+    grid.setLineText(LineOffset(0), "ABCD"sv);
+    grid.setLineText(LineOffset(1), "ABCD"sv);
+    for (auto i = 0; i < HistoryLineCount; ++i)
+    {
+        grid.scrollUp(LineCount(1));
+        grid.setLineText(LineOffset(1), "ABCD"sv);
+    }
+    REQUIRE(grid.historyLineCount() == LineCount(HistoryLineCount));
+
+    // Only the main page and the most recent history lines are reflowed right away.
+    (void) grid.resize(PageSize { LineCount(2), ColumnCount(2) }, CellLocation { LineOffset(1), {} }, false);
+    auto const unreflowedLineCount = grid.unreflowedHistoryLineCount();
+    REQUIRE(unreflowedLineCount > LineCount(0));
+    REQUIRE(unreflowedLineCount < LineCount(HistoryLineCount));
+    auto const historyTop = -boxed_cast<LineOffset>(grid.historyLineCount());
+    CHECK(grid.lineAt(historyTop).size() == ColumnCount(4));
+    CHECK(grid.lineAt(LineOffset(-1)).size() == ColumnCount(2));
+    CHECK(grid.lineText(LineOffset(-2)) == "AB");
+    CHECK(grid.lineText(LineOffset(-1)) == "CD");
+    CHECK(grid.lineAt(LineOffset(-1)).wrapped());
+
+    // The remaining history lines are reflowed on demand.
+    grid.reflowHistory();
+    CHECK(grid.unreflowedHistoryLineCount() == LineCount(0));
+    CHECK(grid.historyLineCount() == LineCount(2 * HistoryLineCount + 2));
+    auto const newHistoryTop = -boxed_cast<LineOffset>(grid.historyLineCount());
+    CHECK(grid.lineText(newHistoryTop) == "AB");
+    CHECK(grid.lineText(newHistoryTop + LineOffset(1)) == "CD");
+    CHECK(!grid.lineAt(newHistoryTop).wrapped());
+    CHECK(grid.lineAt(newHistoryTop + LineOffset(1)).wrapped());
+    CHECK(grid.lineAt(newHistoryTop).size() == ColumnCount(2));
+}
+
+TEST_CASE("Grid.reflow.lazy_history_parallel", "[grid]")
+{
+    // Large enough for the history to be reflowed by multiple tasks, where available.
+    auto constexpr LogicalLineCount = 40'000;
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(4) }, true, LineCount(200'000));
+    for (auto i = 0; i < LogicalLineCount; ++i)
+    {
+        grid.scrollUp(LineCount(2));
+        grid.setLineText(LineOffset(0), "ABCD"sv);
+        grid.setLineText(LineOffset(1), "EF"sv);
+        grid.lineAt(LineOffset(1)).setWrapped(true);
+    }
+
+    (void) grid.resize(PageSize { LineCount(2), ColumnCount(2) }, CellLocation { LineOffset(1), {} }, false);
+    REQUIRE(grid.unreflowedHistoryLineCount() > LineCount(0));
+
+    grid.reflowHistory();
+    CHECK(grid.unreflowedHistoryLineCount() == LineCount(0));
+
+    // Each logical line "ABCDEF" is now made up of three lines, regardless of where the history was split.
+    // The history starts with the two initially blank lines, and the main page holds "CD" and "EF".
+    CHECK(grid.historyLineCount() == LineCount(3 * LogicalLineCount));
+    for (auto line = -boxed_cast<LineOffset>(grid.historyLineCount()) + LineOffset(4); line < LineOffset(2);
+         line += LineOffset(3))
+    {
+        INFO(fmt::format("line {}", line));
+        REQUIRE(grid.lineText(line - LineOffset(2)) == "AB");
+        REQUIRE(grid.lineText(line - LineOffset(1)) == "CD");
+        REQUIRE(grid.lineText(line) == "EF");
+        REQUIRE(!grid.lineAt(line - LineOffset(2)).wrapped());
+        REQUIRE(grid.lineAt(line - LineOffset(1)).wrapped());
+        REQUIRE(grid.lineAt(line).wrapped());
+    }
+}
+
+TEST_CASE("Grid.reflow.lazy_history_trivial", "[grid]")
+{
+    auto constexpr LogicalLineCount = 1000;
+    auto grid = Grid<Cell>(PageSize { LineCount(2), ColumnCount(4) }, true, LineCount(10000));
+    for (auto i = 0; i < LogicalLineCount; ++i)
+    {
+        grid.scrollUp(LineCount(2));
+        grid.setLineText(LineOffset(0), "ABCD"sv);
+        grid.useCellAt(LineOffset(0), ColumnOffset(3)).setForegroundColor(Color::Indexed(IndexedColor::Red));
+        grid.setLineText(LineOffset(1), "EF"sv);
+        grid.lineAt(LineOffset(1)).setWrapped(true);
+    }
+
+    (void) grid.resize(PageSize { LineCount(2), ColumnCount(3) }, CellLocation { LineOffset(1), {} }, false);
+    REQUIRE(grid.unreflowedHistoryLineCount() > LineCount(0));
+    grid.reflowHistory();
+
+    // The history's trivial lines are sliced into trivial lines again, keeping their attributes.
+    auto const top = -boxed_cast<LineOffset>(grid.historyLineCount()) + LineOffset(2);
+    auto const& first = grid.lineAt(top);
+    auto const& second = grid.lineAt(top + LineOffset(1));
+    REQUIRE(first.isTrivialBuffer());
+    REQUIRE(second.isTrivialBuffer());
+    CHECK(grid.lineText(top) == "ABC");
+    CHECK(grid.lineText(top + LineOffset(1)) == "DEF");
+    CHECK(!first.wrapped());
+    CHECK(second.wrapped());
+    CHECK(first.trivialBuffer().textAttributes.foregroundColor == DefaultColor());
+    CHECK(second.trivialBuffer().textAttributes.foregroundColor == Color::Indexed(IndexedColor::Red));
+    REQUIRE(second.trivialBuffer().spans.size() == 1);
+    CHECK(second.trivialBuffer().spans[0].start == ColumnOffset(1));
+    CHECK(second.trivialBuffer().spans[0].attributes.foregroundColor == DefaultColor());
+}
+
 TEST_CASE("Grid infinite", "[grid]")
 {
     auto gridFinite = Grid<Cell>(PageSize { LineCount(2), ColumnCount(8) }, true, LineCount(0));
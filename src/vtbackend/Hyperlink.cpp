@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/Hyperlink.h>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace vtbackend
+{
+
+std::shared_ptr<HyperlinkInfo> HyperlinkStorage::hyperlinkById(HyperlinkId id) noexcept
+{
+    if (id.value < _links.size())
+        return _links[id.value];
+    return {};
+}
+
+std::shared_ptr<HyperlinkInfo const> HyperlinkStorage::hyperlinkById(HyperlinkId id) const noexcept
+{
+    if (id.value < _links.size())
+        return _links[id.value];
+    return {};
+}
+
+HyperlinkId HyperlinkStorage::acquire(std::string userId, URI uri)
+{
+    auto& index = userId.empty() ? _idsByUri[uri] : _idsByUserId[userId];
+    if (auto const& link = hyperlinkById(index); link && link->uri == uri)
+        return index;
+
+    auto id = HyperlinkId {};
+    if (!_freeIds.empty())
+    {
+        id = _freeIds.back();
+        _freeIds.pop_back();
+    }
+    else if (_links.size() <= std::numeric_limits<uint16_t>::max())
+    {
+        id = HyperlinkId::cast_from(_links.size());
+        _links.emplace_back();
+    }
+    else
+        return HyperlinkId {};
+
+    // An application reusing its ID for another URI starts a new hyperlink,
+    // which the ID refers to from now on, while cells keep referring to the old one.
+    index = id;
+    _links[id.value] = std::make_shared<HyperlinkInfo>(HyperlinkInfo { std::move(userId), std::move(uri) });
+    ++_size;
+    return id;
+}
+
+void HyperlinkStorage::collect(std::vector<bool> const& referenced)
+{
+    for (size_t i = 1; i < _links.size(); ++i)
+    {
+        auto& link = _links[i];
+        if (!link || (i < referenced.size() && referenced[i]))
+            continue;
+
+        auto const id = HyperlinkId::cast_from(i);
+        auto& index = link->userId.empty() ? _idsByUri : _idsByUserId;
+        if (auto const entry = index.find(link->userId.empty() ? link->uri : link->userId);
+            entry != index.end() && entry->second == id)
+            index.erase(entry);
+
+        link.reset();
+        _freeIds.push_back(id);
+        --_size;
+    }
+
+    _collectThreshold = std::max(InitialCollectThreshold, 2 * _size);
+}
+
+} // namespace vtbackend
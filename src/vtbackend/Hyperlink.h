@@ -1,10 +1,11 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
 
-#include <crispy/LRUCache.h>
-
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <boxed-cpp/boxed.hpp>
 
@@ -70,41 +71,44 @@ using HyperlinkId = boxed::boxed<uint16_t, detail::HyperlinkTag>;
 
 bool is_local(HyperlinkInfo const& hyperlink);
 
-using HyperlinkCache = crispy::lru_cache<HyperlinkId, std::shared_ptr<HyperlinkInfo>>;
-
-struct HyperlinkStorage
+/**
+ * Hyperlinks by their ID, as referenced by cells and lines.
+ *
+ * Hyperlinks are kept for as long as any cell or line may still refer to them, no matter how deep
+ * in the history. Once their number reaches a threshold, the terminal marks the IDs still referenced,
+ * and collect() frees the others for their IDs to be reused. The threshold grows along with the number
+ * of hyperlinks remaining, so that the cost of marking is spread over the hyperlinks created meanwhile.
+ */
+class HyperlinkStorage
 {
-    HyperlinkCache cache { 1024 };
-    HyperlinkId nextHyperlinkId = HyperlinkId(1);
-
-    std::shared_ptr<HyperlinkInfo> hyperlinkById(HyperlinkId id) noexcept
-    {
-        if (!!id)
-            if (auto* href = cache.try_get(id))
-                return *href;
-        return {};
-    }
-
-    std::shared_ptr<HyperlinkInfo const> hyperlinkById(HyperlinkId id) const noexcept
-    {
-        if (!!id)
-            if (auto* href = cache.try_get(id))
-                return *href;
-        return {};
-    }
-
-    HyperlinkId hyperlinkIdByUserId(std::string const& id) noexcept
-    {
-        for (auto& href: cache)
-        {
-            if (href.value->userId == id)
-            {
-                cache.touch(href.key);
-                return href.key;
-            }
-        }
-        return HyperlinkId {};
-    }
+  public:
+    // Number of hyperlinks at which the unreferenced ones are collected the first time.
+    static constexpr size_t InitialCollectThreshold = 1024;
+
+    [[nodiscard]] std::shared_ptr<HyperlinkInfo> hyperlinkById(HyperlinkId id) noexcept;
+    [[nodiscard]] std::shared_ptr<HyperlinkInfo const> hyperlinkById(HyperlinkId id) const noexcept;
+
+    /// @returns the ID of the hyperlink with the application provided @p userId and @p uri,
+    ///          reusing the one with the same user ID and URI (or the same URI if no user ID is given),
+    ///          or the null ID if all IDs are in use.
+    [[nodiscard]] HyperlinkId acquire(std::string userId, URI uri);
+
+    /// @returns the number of hyperlinks stored.
+    [[nodiscard]] size_t size() const noexcept { return _size; }
+
+    /// Tests whether the unreferenced hyperlinks are to be collected before acquiring another one.
+    [[nodiscard]] bool needsCollection() const noexcept { return _size >= _collectThreshold; }
+
+    /// Frees the hyperlinks whose IDs are not marked as referenced in @p referenced, indexed by ID.
+    void collect(std::vector<bool> const& referenced);
+
+  private:
+    std::vector<std::shared_ptr<HyperlinkInfo>> _links = { nullptr }; // indexed by ID, null if unused
+    std::vector<HyperlinkId> _freeIds;
+    std::unordered_map<std::string, HyperlinkId> _idsByUserId;
+    std::unordered_map<URI, HyperlinkId> _idsByUri; // of hyperlinks without user ID
+    size_t _size = 0;
+    size_t _collectThreshold = InitialCollectThreshold;
 };
 
 } // namespace vtbackend
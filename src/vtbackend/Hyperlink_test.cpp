@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/Hyperlink.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+using vtbackend::HyperlinkId;
+using vtbackend::HyperlinkStorage;
+
+TEST_CASE("HyperlinkStorage.acquire", "[hyperlink]")
+{
+    auto storage = HyperlinkStorage {};
+
+    auto const a = storage.acquire("", "https://a");
+    auto const b = storage.acquire("", "https://b");
+    CHECK(a != HyperlinkId {});
+    CHECK(a != b);
+    CHECK(storage.hyperlinkById(a)->uri == "https://a");
+    CHECK(storage.hyperlinkById(b)->uri == "https://b");
+    CHECK(!storage.hyperlinkById(HyperlinkId {}));
+
+    SECTION("deduplicates by URI")
+    {
+        CHECK(storage.acquire("", "https://a") == a);
+        CHECK(storage.size() == 2);
+    }
+
+    SECTION("deduplicates by user ID and URI")
+    {
+        auto const c = storage.acquire("id", "https://a");
+        CHECK(c != a);
+        CHECK(storage.acquire("id", "https://a") == c);
+        CHECK(storage.hyperlinkById(c)->userId == "id");
+
+        // The same ID with another URI makes another hyperlink.
+        auto const d = storage.acquire("id", "https://d");
+        CHECK(d != c);
+        CHECK(storage.acquire("id", "https://d") == d);
+        CHECK(storage.size() == 4);
+    }
+}
+
+TEST_CASE("HyperlinkStorage.collect", "[hyperlink]")
+{
+    auto storage = HyperlinkStorage {};
+    auto ids = std::vector<HyperlinkId> {};
+    for (auto i = 0u; i < HyperlinkStorage::InitialCollectThreshold; ++i)
+    {
+        REQUIRE(!storage.needsCollection());
+        ids.push_back(storage.acquire("", "https://" + std::to_string(i)));
+    }
+    CHECK(storage.needsCollection());
+
+    auto referenced = std::vector<bool>(65536);
+    referenced[ids.front().value] = true;
+    referenced[ids.back().value] = true;
+    storage.collect(referenced);
+
+    CHECK(storage.size() == 2);
+    CHECK(!storage.needsCollection());
+    CHECK(storage.hyperlinkById(ids.front())->uri == "https://0");
+    CHECK(!storage.hyperlinkById(ids.at(1)));
+
+    // Freed IDs are reused, and their URIs are not found in the index anymore.
+    auto const reused = storage.acquire("", "https://1");
+    CHECK(reused.value < ids.back().value);
+    CHECK(storage.hyperlinkById(reused)->uri == "https://1");
+    CHECK(storage.acquire("", "https://0") == ids.front());
+}
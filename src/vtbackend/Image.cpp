@@ -5,6 +5,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <mutex>
 
 using std::copy;
 using std::make_shared;
@@ -48,6 +49,22 @@ ImagePool::ImagePool(OnImageRemove onImageRemove, ImageId nextImageId):
 {
 }
 
+Image::Data toRGBA(Image::Data const& rgb, ImageSize size)
+{
+    auto const pixelCount = min(size.area(), rgb.size() / 3);
+    auto rgba = Image::Data(pixelCount * 4);
+    auto const* source = rgb.data();
+    auto* target = rgba.data();
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        *target++ = *source++;
+        *target++ = *source++;
+        *target++ = *source++;
+        *target++ = 0xFF;
+    }
+    return rgba;
+}
+
 Image::Data RasterizedImage::fragment(CellLocation pos) const
 {
     // TODO: respect alignment hint
@@ -83,8 +100,6 @@ Image::Data RasterizedImage::fragment(CellLocation pos) const
     //             availableHeight,
     //             *this);
 
-    // TODO: if input format is (RGB | PNG), transform to RGBA
-
     auto* target = fragData.data();
 
     for (int y = 0; y < availableHeight; ++y)
@@ -118,10 +133,57 @@ Image::Data RasterizedImage::fragment(CellLocation pos) const
 
 shared_ptr<Image const> ImagePool::create(ImageFormat format, ImageSize size, Image::Data&& data)
 {
-    // TODO: This operation should be idempotent, i.e. if that image has been created already, return a
-    // reference to that.
+    // Images are kept as RGBA only, as their fragments and the renderers expect.
+    if (format == ImageFormat::RGB)
+    {
+        data = toRGBA(data, size);
+        format = ImageFormat::RGBA;
+    }
+
+    auto const hash = crispy::strong_hash::compute(data.data(), data.size())
+                      * crispy::strong_hash::compute(size);
+    auto existing = shared_ptr<Image const> {};
+    {
+        // Not held while releasing images, as their removers take it, too.
+        auto const _ = std::scoped_lock { _contentIndex->mutex };
+        if (auto const i = _contentIndex->images.find(hash); i != _contentIndex->images.end())
+            existing = i->second.lock();
+    }
+
+    // The data is compared as well, as the hash is fast rather than collision resistant.
+    if (existing && existing->size() == size && existing->data() == data)
+    {
+        ++_stats->duplicates;
+        _stats->bytesSaved += data.size();
+        return existing;
+    }
+
     auto const id = _nextImageId++;
-    return make_shared<Image>(id, format, std::move(data), size, _onImageRemove);
+    auto const bytes = data.size();
+    ++_stats->images;
+    _stats->bytes += bytes;
+    auto remover = [stats = _stats,
+                    contentIndex = _contentIndex,
+                    hash,
+                    bytes,
+                    onImageRemove = _onImageRemove](Image const* image) {
+        --stats->images;
+        stats->bytes -= bytes;
+        {
+            // Unless a newer image of the same hash took its place meanwhile.
+            auto const _ = std::scoped_lock { contentIndex->mutex };
+            if (auto const i = contentIndex->images.find(hash);
+                i != contentIndex->images.end() && i->second.expired())
+                contentIndex->images.erase(i);
+        }
+        onImageRemove(image);
+    };
+    auto image = make_shared<Image const>(id, format, std::move(data), size, std::move(remover));
+    {
+        auto const _ = std::scoped_lock { _contentIndex->mutex };
+        _contentIndex->images[hash] = image;
+    }
+    return image;
 }
 
 shared_ptr<RasterizedImage> rasterize(shared_ptr<Image const> image,
@@ -162,6 +224,7 @@ void ImagePool::inspect(ostream& os) const
 {
     os << "Image pool:\n";
     os << fmt::format("global image stats: {}\n", ImageStats::get());
+    os << fmt::format("pool image stats: {} (budget: {} KiB)\n", *_stats, _memoryBudget / 1024);
     _imageNameToImageCache.inspect(os);
 }
 
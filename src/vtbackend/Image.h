@@ -11,7 +11,10 @@
 
 #include <cstdint>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace vtbackend
@@ -87,6 +90,9 @@ class Image: public std::enable_shared_from_this<Image>
     OnImageRemove _onImageRemove;
 };
 
+/// Converts RGB pixel data of the given size into fully opaque RGBA pixel data.
+[[nodiscard]] Image::Data toRGBA(Image::Data const& rgb, ImageSize size);
+
 /// Image resize hints are used to properly fit/fill the area to place the image onto.
 enum class ImageResize
 {
@@ -221,9 +227,23 @@ inline bool operator<(ImageFragment const& a, ImageFragment const& b) noexcept
                && a.offset() < b.offset());
 }
 
+/// Statistics of the images created by a single ImagePool that are still alive.
+struct ImagePoolStats
+{
+    size_t images = 0;     //!< number of images alive
+    size_t bytes = 0;      //!< decoded pixel data held by these images
+    size_t evictions = 0;  //!< number of images evicted due to exceeding the memory budget
+    size_t duplicates = 0; //!< number of images created with the same pixels as an image alive
+    size_t bytesSaved = 0; //!< pixel data not held twice thanks to reusing these images
+};
+
 /// Highlevel Image Storage Pool.
 ///
 /// Stores RGBA images in host memory, also taking care of eviction.
+///
+/// Images are kept alive by the grid cells displaying them. The pool therefore only accounts for
+/// the memory used by its images, leaving it to the screen to evict the least recently displayed
+/// images once the memory budget is exceeded, see overBudget().
 class ImagePool
 {
   public:
@@ -232,9 +252,25 @@ class ImagePool
     ImagePool(
         OnImageRemove onImageRemove = [](auto) {}, ImageId nextImageId = ImageId(1));
 
-    /// Creates an RGBA image of given size in pixels.
+    /// Creates an RGBA image of given size in pixels, converting RGB data to RGBA.
+    ///
+    /// If an image with the same size and pixels is alive already, that one is returned instead,
+    /// such that applications redrawing the same image over and over again neither hold its pixels
+    /// more than once, nor have the renderer upload them again, as it caches them by image ID.
     std::shared_ptr<Image const> create(ImageFormat format, ImageSize pixelSize, Image::Data&& data);
 
+    /// Sets the number of bytes of decoded pixel data the images of this pool should not exceed.
+    void setMemoryBudget(size_t bytes) noexcept { _memoryBudget = bytes; }
+    [[nodiscard]] size_t memoryBudget() const noexcept { return _memoryBudget; }
+
+    /// Tests whether the pixel data of the images alive exceeds the memory budget.
+    [[nodiscard]] bool overBudget() const noexcept { return _stats->bytes > _memoryBudget; }
+
+    /// Records that @p count images have been evicted, i.e. removed from the grid cells displaying them.
+    void recordEvictions(size_t count) noexcept { _stats->evictions += count; }
+
+    [[nodiscard]] ImagePoolStats const& stats() const noexcept { return *_stats; }
+
     // named image access
     //
     void link(std::string const& name, std::shared_ptr<Image const> imageRef);
@@ -250,11 +286,29 @@ class ImagePool
 
     using NameToImageIdCache = crispy::strong_lru_cache<std::string, std::shared_ptr<Image const>>;
 
+    struct ContentHasher
+    {
+        size_t operator()(crispy::strong_hash const& hash) const noexcept { return hash.d(); }
+    };
+
+    // The images alive by the hash of their size and pixels, shared with the images' removers to
+    // forget them once destroyed, which may happen on other threads, e.g. when releasing render buffers.
+    struct ContentIndex
+    {
+        std::mutex mutex;
+        std::unordered_map<crispy::strong_hash, std::weak_ptr<Image const>, ContentHasher> images;
+    };
+
     // data members
     //
     ImageId _nextImageId;                      //!< ID for next image to be put into the pool
     NameToImageIdCache _imageNameToImageCache; //!< keeps mapping from name to raw image
     OnImageRemove _onImageRemove;              //!< Callback to be invoked when image gets removed from pool.
+    size_t _memoryBudget = std::numeric_limits<size_t>::max(); //!< Maximum bytes of pixel data.
+
+    // Shared with the pool's images, which may outlive the pool, to account for their destruction.
+    std::shared_ptr<ImagePoolStats> _stats = std::make_shared<ImagePoolStats>();
+    std::shared_ptr<ContentIndex> _contentIndex = std::make_shared<ContentIndex>();
 };
 
 } // namespace vtbackend
@@ -287,6 +341,22 @@ struct fmt::formatter<vtbackend::ImageStats>: formatter<std::string>
     }
 };
 
+template <>
+struct fmt::formatter<vtbackend::ImagePoolStats>: formatter<std::string>
+{
+    auto format(vtbackend::ImagePoolStats const& stats, format_context& ctx) -> format_context::iterator
+    {
+        return formatter<std::string>::format(
+            fmt::format("{} images, {} KiB, {} evicted, {} duplicates reused saving {} KiB",
+                        stats.images,
+                        stats.bytes / 1024,
+                        stats.evictions,
+                        stats.duplicates,
+                        stats.bytesSaved / 1024),
+            ctx);
+    }
+};
+
 template <>
 struct fmt::formatter<std::shared_ptr<vtbackend::Image const>>: fmt::formatter<std::string>
 {
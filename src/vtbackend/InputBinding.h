@@ -6,6 +6,11 @@
 
 #include <fmt/format.h>
 
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
 namespace vtbackend
 {
 
@@ -55,6 +60,78 @@ bool operator<(InputBinding<I, O> const& a, InputBinding<I, O> const& b) noexcep
     return false;
 }
 
+/**
+ * Input bindings compiled into a lookup table, resolving an input event by a single lookup,
+ * no matter how many bindings there are.
+ *
+ * The bindings are partitioned by input and modifiers, each into a row of the first matching
+ * binding for each combination of the actual mode flags, having resolved the MatchModes of
+ * the bindings to bit masks at construction.
+ */
+template <typename Input, typename Binding>
+class InputBindingTable
+{
+  public:
+    using binding_type = InputBinding<Input, Binding>;
+
+    /// Number of combinations of the MatchModes flags.
+    static constexpr size_t ModeCount = 128;
+    static_assert(MatchModes::Trace < ModeCount && ModeCount <= 2 * MatchModes::Trace);
+
+    InputBindingTable() = default;
+
+    /// Compiles the given bindings, of which the first one matching an input event wins.
+    explicit InputBindingTable(std::vector<binding_type> bindings): _bindings { std::move(bindings) }
+    {
+        for (size_t i = 0; i < _bindings.size(); ++i)
+        {
+            auto const& binding = _bindings[i];
+            auto const [entry, inserted] = _rowIndices.try_emplace(key(binding.input, binding.modifiers));
+            if (inserted)
+            {
+                entry->second = static_cast<uint32_t>(_rows.size());
+                _rows.emplace_back(); // No binding in any mode, yet.
+            }
+
+            auto& row = _rows[entry->second];
+            auto const enabled = binding.modes.enabled();
+            auto const disabled = binding.modes.disabled();
+            for (unsigned modes = 0; modes < ModeCount; ++modes)
+                if (row[modes] == NoBinding && (modes & enabled) == enabled && (modes & disabled) == 0)
+                    row[modes] = static_cast<uint32_t>(i);
+        }
+    }
+
+    [[nodiscard]] std::vector<binding_type> const& bindings() const noexcept { return _bindings; }
+
+    /// @returns the binding for the given input event, or nullptr if there is none.
+    [[nodiscard]] Binding const* find(Input input, Modifiers modifiers, uint8_t actualModeFlags) const
+    {
+        auto const entry = _rowIndices.find(key(input, modifiers));
+        if (entry == _rowIndices.end())
+            return nullptr;
+        auto const index = _rows[entry->second][actualModeFlags % ModeCount];
+        return index != NoBinding ? &_bindings[index].binding : nullptr;
+    }
+
+  private:
+    static constexpr uint32_t NoBinding = UINT32_MAX;
+
+    struct row: std::array<uint32_t, ModeCount>
+    {
+        row() { this->fill(NoBinding); }
+    };
+
+    static uint64_t key(Input input, Modifiers modifiers) noexcept
+    {
+        return static_cast<uint64_t>(input) << 32 | modifiers.value();
+    }
+
+    std::vector<binding_type> _bindings;
+    std::unordered_map<uint64_t, uint32_t> _rowIndices;
+    std::vector<row> _rows;
+};
+
 } // namespace vtbackend
 
 template <typename I, typename O>
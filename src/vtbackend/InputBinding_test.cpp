@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/InputBinding.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <vector>
+
+using namespace vtbackend;
+
+namespace
+{
+
+using Binding = InputBinding<char32_t, int>;
+using Table = InputBindingTable<char32_t, int>;
+
+bool matches(MatchModes expected, uint8_t actualModeFlags)
+{
+    return (actualModeFlags & expected.enabled()) == expected.enabled()
+           && (actualModeFlags & expected.disabled()) == 0;
+}
+
+// Finds the first matching binding, as the table is supposed to, but by testing all the bindings.
+int const* findLinear(std::vector<Binding> const& bindings,
+                      char32_t input,
+                      Modifiers modifiers,
+                      uint8_t actualModeFlags)
+{
+    for (auto const& binding: bindings)
+        if (binding.input == input && binding.modifiers == modifiers
+            && matches(binding.modes, actualModeFlags))
+            return &binding.binding;
+    return nullptr;
+}
+
+} // namespace
+
+TEST_CASE("InputBindingTable.modes")
+{
+    auto const ctrl = Modifiers { Modifier::Control };
+    auto const table = Table { {
+        Binding { MatchModes { MatchModes::AlternateScreen, 0 }, ctrl, U'c', 1 },
+        Binding { MatchModes { 0, MatchModes::Select }, ctrl, U'c', 2 },
+        Binding { MatchModes {}, ctrl, U'c', 3 },
+        Binding { MatchModes {}, Modifiers {}, U'c', 4 },
+    } };
+
+    CHECK(*table.find(U'c', ctrl, MatchModes::AlternateScreen | MatchModes::Select) == 1);
+    CHECK(*table.find(U'c', ctrl, MatchModes::AppCursor) == 2);
+    CHECK(*table.find(U'c', ctrl, MatchModes::Select) == 3);
+    CHECK(*table.find(U'c', Modifiers {}, MatchModes::Select) == 4);
+    CHECK(table.find(U'c', Modifiers { Modifier::Alt }, 0) == nullptr);
+    CHECK(table.find(U'd', ctrl, 0) == nullptr);
+}
+
+TEST_CASE("InputBindingTable.first_match_wins")
+{
+    auto rng = std::mt19937 { 42 };
+    auto const random = [&](unsigned n) {
+        return static_cast<unsigned>(rng() % n);
+    };
+
+    auto bindings = std::vector<Binding> {};
+    for (auto i = 0; i < 500; ++i)
+    {
+        auto const enabled = static_cast<uint8_t>(random(Table::ModeCount) & random(Table::ModeCount));
+        auto const disabled =
+            static_cast<uint8_t>(random(Table::ModeCount) & random(Table::ModeCount) & ~enabled);
+        bindings.push_back(Binding { MatchModes { enabled, disabled },
+                                     Modifiers::from_value(random(8)),
+                                     static_cast<char32_t>(U'a' + random(16)),
+                                     i });
+    }
+
+    auto const table = Table { bindings };
+    for (auto input = U'a'; input < U'a' + 17; ++input)
+        for (auto modifiers = 0u; modifiers < 8; ++modifiers)
+            for (auto modes = 0u; modes < Table::ModeCount; ++modes)
+            {
+                auto const* const expected =
+                    findLinear(bindings, input, Modifiers::from_value(modifiers), uint8_t(modes));
+                auto const* const actual =
+                    table.find(input, Modifiers::from_value(modifiers), uint8_t(modes));
+                REQUIRE((expected ? *expected : -1) == (actual ? *actual : -1));
+            }
+}
@@ -24,6 +24,52 @@ using namespace std;
 namespace vtbackend
 {
 
+namespace
+{
+    constexpr auto KeyCount = static_cast<size_t>(Key::Numpad_9) + 1;
+
+    // Shift, Alt, Control, and Super, i.e. the modifiers the frontend reports, each combination
+    // of which has its key encodings precomputed.
+    constexpr auto EncodedModifierCount = 16u;
+
+    /// The input sequence of a key event, encoded without allocating, either at compile time or at runtime.
+    struct EncodedKey
+    {
+        // Holds the longest sequence, ESC CSI 57441 ; 255 : 3 u, for modifiers made of Modifier bits.
+        std::array<char, 15> bytes {};
+        uint8_t size = 0;
+
+        [[nodiscard]] constexpr bool empty() const noexcept { return size == 0; }
+        [[nodiscard]] constexpr std::string_view view() const noexcept { return { bytes.data(), size }; }
+
+        constexpr EncodedKey& operator+=(char ch) noexcept
+        {
+            if (size < bytes.size())
+                bytes[size++] = ch;
+            return *this;
+        }
+
+        constexpr EncodedKey& operator+=(std::string_view text) noexcept
+        {
+            for (auto const ch: text)
+                *this += ch;
+            return *this;
+        }
+
+        constexpr EncodedKey& operator+=(unsigned number) noexcept
+        {
+            auto digits = std::array<char, 10> {};
+            auto count = size_t { 0 };
+            do
+                digits[count++] = static_cast<char>('0' + number % 10);
+            while (number /= 10);
+            while (count != 0)
+                *this += digits[--count];
+            return *this;
+        }
+    };
+} // namespace
+
 string to_string(Modifiers modifiers)
 {
     return fmt::format("{}", modifiers);
@@ -115,135 +161,191 @@ bool StandardKeyboardInputGenerator::generateChar(char32_t characterEvent,
     return true;
 }
 
-std::string StandardKeyboardInputGenerator::select(Modifiers modifiers, FunctionKeyMapping mapping) const
+namespace
 {
-    auto const prefix = modifiers.contains(Modifier::Alt) ? "\033" : ""s;
+    struct FunctionKeyMapping
+    {
+        std::string_view std {};
+        std::string_view mods {};      // with "{}" standing for the modifier parameter
+        std::string_view appCursor {}; // in application cursor keys mode
+        std::string_view appKeypad {}; // in application keypad mode
+    };
 
-    if (applicationCursorKeys() && !mapping.appCursor.empty())
-        return prefix + std::string(mapping.appCursor);
+    /// @returns the sequences of @p key in the legacy input protocol, all empty if it has none.
+    constexpr FunctionKeyMapping legacyKeyMapping(Key key, Modifiers modifiers) noexcept
+    {
+        // clang-format off
+        switch (key)
+        {
+            case Key::F1: return { .std = ESC "OP", .mods = ESC "O{}P" };
+            case Key::F2: return { .std = ESC "OQ", .mods = ESC "O{}Q" };
+            case Key::F3: return { .std = ESC "OR", .mods = ESC "O{}R" };
+            case Key::F4: return { .std = ESC "OS", .mods = ESC "O{}S" };
+            case Key::F5: return { .std = CSI "15~", .mods = CSI "15;{}~" };
+            case Key::F6: return { .std = CSI "17~", .mods = CSI "17;{}~" };
+            case Key::F7: return { .std = CSI "18~", .mods = CSI "18;{}~" };
+            case Key::F8: return { .std = CSI "19~", .mods = CSI "19;{}~" };
+            case Key::F9: return { .std = CSI "20~", .mods = CSI "20;{}~" };
+            case Key::F10: return { .std = CSI "21~", .mods = CSI "21;{}~" };
+            case Key::F11: return { .std = CSI "23~", .mods = CSI "23;{}~" };
+            case Key::F12: return { .std = CSI "24~", .mods = CSI "24;{}~" };
+            case Key::F13: return { .std = CSI "25~", .mods = CSI "25;{}~" };
+            case Key::F14: return { .std = CSI "26~", .mods = CSI "26;{}~" };
+            case Key::F15: return { .std = CSI "28~", .mods = CSI "28;{}~" };
+            case Key::F16: return { .std = CSI "29~", .mods = CSI "29;{}~" };
+            case Key::F17: return { .std = CSI "31~", .mods = CSI "31;{}~" };
+            case Key::F18: return { .std = CSI "32~", .mods = CSI "32;{}~" };
+            case Key::F19: return { .std = CSI "33~", .mods = CSI "33;{}~" };
+            case Key::F20: return { .std = CSI "34~", .mods = CSI "34;{}~" };
+            case Key::F21: return { .std = CSI "35~", .mods = CSI "35;{}~" };
+            case Key::F22: return { .std = CSI "36~", .mods = CSI "36;{}~" };
+            case Key::F23: return { .std = CSI "37~", .mods = CSI "37;{}~" };
+            case Key::F24: return { .std = CSI "38~", .mods = CSI "38;{}~" };
+            case Key::F25: return { .std = CSI "39~", .mods = CSI "39;{}~" };
+            case Key::F26: return { .std = CSI "40~", .mods = CSI "40;{}~" };
+            case Key::F27: return { .std = CSI "41~", .mods = CSI "41;{}~" };
+            case Key::F28: return { .std = CSI "42~", .mods = CSI "42;{}~" };
+            case Key::F29: return { .std = CSI "43~", .mods = CSI "43;{}~" };
+            case Key::F30: return { .std = CSI "44~", .mods = CSI "44;{}~" };
+            case Key::F31: return { .std = CSI "45~", .mods = CSI "45;{}~" };
+            case Key::F32: return { .std = CSI "46~", .mods = CSI "46;{}~" };
+            case Key::F33: return { .std = CSI "47~", .mods = CSI "47;{}~" };
+            case Key::F34: return { .std = CSI "48~", .mods = CSI "48;{}~" };
+            case Key::F35: return { .std = CSI "49~", .mods = CSI "49;{}~" };
+            case Key::Enter: return { .std = "\r" };
+            case Key::Tab: return { .std = "\t" };
+            case Key::Backspace:
+                // Well accepted hack to distinguish between Backspace nad Ctrl+Backspace,
+                // - Backspace is emitting 0x7f,
+                // - Ctrl+Backspace is emitting 0x08
+                return { .std = modifiers & Modifier::Control ? "\x08" : "\x7F" };
+            case Key::UpArrow: return { .std = CSI "A", .mods = CSI "1;{}A", .appCursor = SS3 "A" };
+            case Key::DownArrow: return { .std = CSI "B", .mods = CSI "1;{}B", .appCursor = SS3 "B" };
+            case Key::RightArrow: return { .std = CSI "C", .mods = CSI "1;{}C", .appCursor = SS3 "C" };
+            case Key::LeftArrow: return { .std = CSI "D", .mods = CSI "1;{}D", .appCursor = SS3 "D" };
+            case Key::Home: return { .std = CSI "H", .mods = CSI "1;{}H", .appCursor = SS3 "H" };
+            case Key::End: return { .std = CSI "F", .mods = CSI "1;{}F", .appCursor = SS3 "F" };
+            case Key::PageUp: return { .std = CSI "5~", .mods = CSI "5;{}~", .appKeypad = CSI "5~" };
+            case Key::PageDown: return { .std = CSI "6~", .mods = CSI "6;{}~", .appKeypad = CSI "6~" };
+            case Key::Insert: return { .std = CSI "2~", .mods = CSI "2;{}~" };
+            case Key::Delete: return { .std = CSI "3~", .mods = CSI "3;{}~" };
+            case Key::Numpad_Enter:    return { .std = "\r", .appKeypad = SS3 "M" };
+            case Key::Numpad_Multiply: return { .std = "*",  .appKeypad = SS3 "j" };
+            case Key::Numpad_Add:      return { .std = "+",  .appKeypad = SS3 "k" };
+            case Key::Numpad_Subtract: return { .std = "-",  .appKeypad = SS3 "m" };
+            case Key::Numpad_Decimal:  return { .std = ".",  .appKeypad = CSI "3~" };
+            case Key::Numpad_Divide:   return { .std = "/",  .appKeypad = SS3 "o" };
+            case Key::Numpad_0:        return { .std = "0",  .appKeypad = CSI "2~" };
+            case Key::Numpad_1:        return { .std = "1",  .appKeypad = SS3 "F" };
+            case Key::Numpad_2:        return { .std = "2",  .appKeypad = CSI "B" };
+            case Key::Numpad_3:        return { .std = "3",  .appKeypad = CSI "6~" };
+            case Key::Numpad_4:        return { .std = "4",  .appKeypad = CSI "D" };
+            case Key::Numpad_5:        return { .std = "5",  .appKeypad = CSI "E" };
+            case Key::Numpad_6:        return { .std = "6",  .appKeypad = CSI "C" };
+            case Key::Numpad_7:        return { .std = "7",  .appKeypad = SS3 "H" };
+            case Key::Numpad_8:        return { .std = "8",  .appKeypad = CSI "A" };
+            case Key::Numpad_9:        return { .std = "9",  .appKeypad = CSI "5~" };
+            case Key::Numpad_Equal:    return { .std = "=",  .appKeypad = SS3 "X" };
+            default: return {};
+        }
+        // clang-format on
+    }
 
-    if (applicationKeypad() && !mapping.appKeypad.empty())
-        return prefix + std::string(mapping.appKeypad);
+    /// @returns the input sequence of @p key in the legacy input protocol, or an empty one if it has none.
+    constexpr EncodedKey encodeLegacyKey(Key key,
+                                         Modifiers modifiers,
+                                         KeyMode cursorKeysMode,
+                                         KeyMode numpadKeysMode) noexcept
+    {
+        auto result = EncodedKey {};
 
-    if (modifiers && !mapping.mods.empty())
-        return prefix + crispy::replace(mapping.mods, "{}"sv, makeVirtualTerminalParam(modifiers));
+        if (key == Key::Escape)
+            return result += ESC;
 
-    return prefix + std::string(mapping.std);
-}
+        auto const mapping = legacyKeyMapping(key, modifiers);
+        if (mapping.std.empty())
+            return result;
+
+        if (modifiers.contains(Modifier::Alt))
+            result += ESC;
+
+        if (cursorKeysMode == KeyMode::Application && !mapping.appCursor.empty())
+            return result += mapping.appCursor;
+
+        if (numpadKeysMode == KeyMode::Application && !mapping.appKeypad.empty())
+            return result += mapping.appKeypad;
+
+        if (modifiers && !mapping.mods.empty())
+        {
+            auto const placeholder = mapping.mods.find("{}");
+            result += mapping.mods.substr(0, placeholder);
+            result += static_cast<unsigned>(makeVirtualTerminalParam(modifiers));
+            return result += mapping.mods.substr(placeholder + 2);
+        }
+
+        return result += mapping.std;
+    }
+
+    struct LegacyKeyEncodings
+    {
+        std::array<EncodedKey, EncodedModifierCount> normal; // indexed by the modifiers
+        std::array<EncodedKey, 2> appCursor;                 // indexed by Alt being pressed
+        std::array<EncodedKey, 2> appKeypad;                 // indexed by Alt being pressed
+    };
+
+    constexpr auto legacyKeyEncodings = []() constexpr {
+        auto encodings = std::array<LegacyKeyEncodings, KeyCount> {};
+        for (auto keyIndex = size_t { 0 }; keyIndex < KeyCount; ++keyIndex)
+        {
+            auto const key = static_cast<Key>(keyIndex);
+            auto const mapping = legacyKeyMapping(key, Modifiers {});
+            auto& keyEncodings = encodings[keyIndex];
+            for (auto i = 0u; i < EncodedModifierCount; ++i)
+                keyEncodings.normal[i] =
+                    encodeLegacyKey(key, Modifiers::from_value(i), KeyMode::Normal, KeyMode::Normal);
+            // Only keys with sequences of their own in either application mode are looked up there.
+            for (auto const alt: { 0u, 1u })
+            {
+                auto const modifiers = alt ? Modifiers { Modifier::Alt } : Modifiers {};
+                if (!mapping.appCursor.empty())
+                    keyEncodings.appCursor[alt] =
+                        encodeLegacyKey(key, modifiers, KeyMode::Application, KeyMode::Normal);
+                if (!mapping.appKeypad.empty())
+                    keyEncodings.appKeypad[alt] =
+                        encodeLegacyKey(key, modifiers, KeyMode::Normal, KeyMode::Application);
+            }
+        }
+        return encodings;
+    }();
+
+    static_assert(legacyKeyEncodings[static_cast<size_t>(Key::F5)].normal[Modifier::Shift].view()
+                  == CSI "15;2~");
+    static_assert(legacyKeyEncodings[static_cast<size_t>(Key::UpArrow)].appCursor[1].view() == ESC SS3 "A");
+} // namespace
 
 bool StandardKeyboardInputGenerator::generateKey(Key key, Modifiers modifiers, KeyboardEventType eventType)
 {
     if (eventType == KeyboardEventType::Release)
         return false;
 
-    // clang-format off
-    switch (key)
-    {
-        case Key::F1: append(select(modifiers, { .std = ESC "OP", .mods = ESC "O{}P" })); break;
-        case Key::F2: append(select(modifiers, { .std = ESC "OQ", .mods = ESC "O{}Q" })); break;
-        case Key::F3: append(select(modifiers, { .std = ESC "OR", .mods = ESC "O{}R" })); break;
-        case Key::F4: append(select(modifiers, { .std = ESC "OS", .mods = ESC "O{}S" })); break;
-        case Key::F5: append(select(modifiers, { .std = CSI "15~", .mods = CSI "15;{}~" })); break;
-        case Key::F6: append(select(modifiers, { .std = CSI "17~", .mods = CSI "17;{}~" })); break;
-        case Key::F7: append(select(modifiers, { .std = CSI "18~", .mods = CSI "18;{}~" })); break;
-        case Key::F8: append(select(modifiers, { .std = CSI "19~", .mods = CSI "19;{}~" })); break;
-        case Key::F9: append(select(modifiers, { .std = CSI "20~", .mods = CSI "20;{}~" })); break;
-        case Key::F10: append(select(modifiers, { .std = CSI "21~", .mods = CSI "21;{}~" })); break;
-        case Key::F11: append(select(modifiers, { .std = CSI "23~", .mods = CSI "23;{}~" })); break;
-        case Key::F12: append(select(modifiers, { .std = CSI "24~", .mods = CSI "24;{}~" })); break;
-        case Key::F13: append(select(modifiers, { .std = CSI "25~", .mods = CSI "25;{}~" })); break;
-        case Key::F14: append(select(modifiers, { .std = CSI "26~", .mods = CSI "26;{}~" })); break;
-        case Key::F15: append(select(modifiers, { .std = CSI "28~", .mods = CSI "28;{}~" })); break;
-        case Key::F16: append(select(modifiers, { .std = CSI "29~", .mods = CSI "29;{}~" })); break;
-        case Key::F17: append(select(modifiers, { .std = CSI "31~", .mods = CSI "31;{}~" })); break;
-        case Key::F18: append(select(modifiers, { .std = CSI "32~", .mods = CSI "32;{}~" })); break;
-        case Key::F19: append(select(modifiers, { .std = CSI "33~", .mods = CSI "33;{}~" })); break;
-        case Key::F20: append(select(modifiers, { .std = CSI "34~", .mods = CSI "34;{}~" })); break;
-        case Key::F21: append(select(modifiers, { .std = CSI "35~", .mods = CSI "35;{}~" })); break;
-        case Key::F22: append(select(modifiers, { .std = CSI "36~", .mods = CSI "36;{}~" })); break;
-        case Key::F23: append(select(modifiers, { .std = CSI "37~", .mods = CSI "37;{}~" })); break;
-        case Key::F24: append(select(modifiers, { .std = CSI "38~", .mods = CSI "38;{}~" })); break;
-        case Key::F25: append(select(modifiers, { .std = CSI "39~", .mods = CSI "39;{}~" })); break;
-        case Key::F26: append(select(modifiers, { .std = CSI "40~", .mods = CSI "40;{}~" })); break;
-        case Key::F27: append(select(modifiers, { .std = CSI "41~", .mods = CSI "41;{}~" })); break;
-        case Key::F28: append(select(modifiers, { .std = CSI "42~", .mods = CSI "42;{}~" })); break;
-        case Key::F29: append(select(modifiers, { .std = CSI "43~", .mods = CSI "43;{}~" })); break;
-        case Key::F30: append(select(modifiers, { .std = CSI "44~", .mods = CSI "44;{}~" })); break;
-        case Key::F31: append(select(modifiers, { .std = CSI "45~", .mods = CSI "45;{}~" })); break;
-        case Key::F32: append(select(modifiers, { .std = CSI "46~", .mods = CSI "46;{}~" })); break;
-        case Key::F33: append(select(modifiers, { .std = CSI "47~", .mods = CSI "47;{}~" })); break;
-        case Key::F34: append(select(modifiers, { .std = CSI "48~", .mods = CSI "48;{}~" })); break;
-        case Key::F35: append(select(modifiers, { .std = CSI "49~", .mods = CSI "49;{}~" })); break;
-        case Key::Escape: append("\033"); break;
-        case Key::Enter: append(select(modifiers, { .std = "\r" })); break;
-        case Key::Tab: append(select(modifiers, { .std = "\t" })); break;
-        case Key::Backspace:
-            // Well accepted hack to distinguish between Backspace nad Ctrl+Backspace,
-            // - Backspace is emitting 0x7f,
-            // - Ctrl+Backspace is emitting 0x08
-            append(select(modifiers, { .std = modifiers & Modifier::Control ? "\x08" : "\x7F" })); break;
-        case Key::UpArrow: append(select(modifiers, { .std = CSI "A", .mods = CSI "1;{}A", .appCursor = SS3 "A" })); break;
-        case Key::DownArrow: append(select(modifiers, { .std = CSI "B", .mods = CSI "1;{}B", .appCursor = SS3 "B" })); break;
-        case Key::RightArrow: append(select(modifiers, { .std = CSI "C", .mods = CSI "1;{}C", .appCursor = SS3 "C" })); break;
-        case Key::LeftArrow: append(select(modifiers, { .std = CSI "D", .mods = CSI "1;{}D", .appCursor = SS3 "D" })); break;
-        case Key::Home: append(select(modifiers, { .std = CSI "H", .mods = CSI "1;{}H", .appCursor = SS3 "H" })); break;
-        case Key::End: append(select(modifiers, { .std = CSI "F", .mods = CSI "1;{}F", .appCursor = SS3 "F" })); break;
-        case Key::PageUp: append(select(modifiers, { .std = CSI "5~", .mods = CSI "5;{}~", .appKeypad = CSI "5~" })); break;
-        case Key::PageDown: append(select(modifiers, { .std = CSI "6~", .mods = CSI "6;{}~", .appKeypad = CSI "6~" })); break;
-        case Key::Insert: append(select(modifiers, { .std = CSI "2~", .mods = CSI "2;{}~" })); break;
-        case Key::Delete: append(select(modifiers, { .std = CSI "3~", .mods = CSI "3;{}~" })); break;
-        case Key::Numpad_Enter:    append(select(modifiers, { .std = "\r", .appKeypad = SS3 "M" })); break;
-        case Key::Numpad_Multiply: append(select(modifiers, { .std = "*",  .appKeypad = SS3 "j" })); break;
-        case Key::Numpad_Add:      append(select(modifiers, { .std = "+",  .appKeypad = SS3 "k" })); break;
-        case Key::Numpad_Subtract: append(select(modifiers, { .std = "-",  .appKeypad = SS3 "m" })); break;
-        case Key::Numpad_Decimal:  append(select(modifiers, { .std = ".",  .appKeypad = CSI "3~" })); break;
-        case Key::Numpad_Divide:   append(select(modifiers, { .std = "/",  .appKeypad = SS3 "o" })); break;
-        case Key::Numpad_0:        append(select(modifiers, { .std = "0",  .appKeypad = CSI "2~" })); break;
-        case Key::Numpad_1:        append(select(modifiers, { .std = "1",  .appKeypad = SS3 "F" })); break;
-        case Key::Numpad_2:        append(select(modifiers, { .std = "2",  .appKeypad = CSI "B" })); break;
-        case Key::Numpad_3:        append(select(modifiers, { .std = "3",  .appKeypad = CSI "6~" })); break;
-        case Key::Numpad_4:        append(select(modifiers, { .std = "4",  .appKeypad = CSI "D" })); break;
-        case Key::Numpad_5:        append(select(modifiers, { .std = "5",  .appKeypad = CSI "E" })); break;
-        case Key::Numpad_6:        append(select(modifiers, { .std = "6",  .appKeypad = CSI "C" })); break;
-        case Key::Numpad_7:        append(select(modifiers, { .std = "7",  .appKeypad = SS3 "H" })); break;
-        case Key::Numpad_8:        append(select(modifiers, { .std = "8",  .appKeypad = CSI "A" })); break;
-        case Key::Numpad_9:        append(select(modifiers, { .std = "9",  .appKeypad = CSI "5~" })); break;
-        case Key::Numpad_Equal:    append(select(modifiers, { .std = "=",  .appKeypad = SS3 "X" })); break;
-        // {{{ unsupported keys in legacy input protocol
-        case Key::MediaPlay:
-        case Key::MediaStop:
-        case Key::MediaPrevious:
-        case Key::MediaNext:
-        case Key::MediaPause:
-        case Key::MediaTogglePlayPause:
-        case Key::VolumeUp:
-        case Key::VolumeDown:
-        case Key::VolumeMute:
-        case Key::LeftShift:
-        case Key::RightShift:
-        case Key::LeftControl:
-        case Key::RightControl:
-        case Key::LeftAlt:
-        case Key::RightAlt:
-        case Key::LeftSuper:
-        case Key::RightSuper:
-        case Key::LeftHyper:
-        case Key::RightHyper:
-        case Key::LeftMeta:
-        case Key::RightMeta:
-        case Key::IsoLevel3Shift:
-        case Key::IsoLevel5Shift:
-        case Key::CapsLock:
-        case Key::ScrollLock:
-        case Key::NumLock:
-        case Key::PrintScreen:
-        case Key::Pause:
-        case Key::Menu:
-            return false;
-        // }}}
-    }
-    // clang-format on
+    auto const& encodings = legacyKeyEncodings[static_cast<size_t>(key)];
+    auto const alt = modifiers.contains(Modifier::Alt) ? 1 : 0;
+
+    auto const encoded = [&]() {
+        if (applicationCursorKeys() && !encodings.appCursor[alt].empty())
+            return encodings.appCursor[alt];
+        if (applicationKeypad() && !encodings.appKeypad[alt].empty())
+            return encodings.appKeypad[alt];
+        if (modifiers.value() < EncodedModifierCount)
+            return encodings.normal[modifiers.value()];
+        return encodeLegacyKey(key, modifiers, _cursorKeysMode, _numpadKeysMode);
+    }();
+
+    // Media keys, modifier keys, and the like have no sequence in the legacy input protocol.
+    if (encoded.empty())
+        return false;
 
+    append(encoded.view());
     return true;
 }
 // }}}
@@ -440,6 +542,44 @@ constexpr pair<unsigned, char> mapKey(Key key) noexcept
     crispy::unreachable();
 }
 
+/// @returns the CSI u input sequence of @p key, along with the event type if @p reportEventType is set.
+constexpr EncodedKey encodeExtendedKey(Key key,
+                                       Modifiers modifiers,
+                                       KeyboardEventType eventType,
+                                       bool reportEventType) noexcept
+{
+    auto const [code, function] = mapKey(key);
+    auto result = EncodedKey {};
+    result += CSI;
+    result += code;
+    if (reportEventType)
+    {
+        result += ';';
+        result += modifiers.value();
+        result += ':';
+        result += encodeEventType(eventType);
+    }
+    else if (modifiers.any())
+    {
+        result += ';';
+        result += 1 + modifiers.value();
+    }
+    return result += function;
+}
+
+// The CSI u input sequences of all keys without reporting event types, indexed by key and modifiers.
+constexpr auto extendedKeyEncodings = []() constexpr {
+    auto encodings = std::array<std::array<EncodedKey, EncodedModifierCount>, KeyCount> {};
+    for (auto keyIndex = size_t { 0 }; keyIndex < KeyCount; ++keyIndex)
+        for (auto i = 0u; i < EncodedModifierCount; ++i)
+            encodings[keyIndex][i] = encodeExtendedKey(
+                static_cast<Key>(keyIndex), Modifiers::from_value(i), KeyboardEventType::Press, false);
+    return encodings;
+}();
+
+static_assert(extendedKeyEncodings[static_cast<size_t>(Key::F13)][Modifier::Control].view()
+              == CSI "57376;5u");
+
 constexpr bool isModifierKey(Key key) noexcept
 {
     // clang-format off
@@ -494,13 +634,11 @@ bool ExtendedKeyboardInputGenerator::generateKey(Key key, Modifiers modifiers, K
     if (isModifierKey(key) && !enabled(KeyboardEventFlag::ReportAllKeysAsEscapeCodes))
         return false;
 
-    auto const [code, function] = mapKey(key);
-    auto const encodedModifiers = encodeModifiers(modifiers, eventType);
-    auto controlSequence = fmt::format("\033[{}", code);
-    if (!encodedModifiers.empty())
-        controlSequence += fmt::format(";{}", encodedModifiers);
-    controlSequence += function;
-    append(controlSequence);
+    auto const reportEventType = enabled(KeyboardEventFlag::ReportEventTypes);
+    if (!reportEventType && modifiers.value() < EncodedModifierCount)
+        append(extendedKeyEncodings[static_cast<size_t>(key)][modifiers.value()].view());
+    else
+        append(encodeExtendedKey(key, modifiers, eventType, reportEventType).view());
 
     return true;
 }
@@ -273,15 +273,6 @@ class StandardKeyboardInputGenerator: public KeyboardInputGenerator
     }
 
   protected:
-    struct FunctionKeyMapping
-    {
-        std::string_view std {};
-        std::string_view mods {};
-        std::string_view appCursor {};
-        std::string_view appKeypad {};
-    };
-
-    [[nodiscard]] std::string select(Modifiers modifier, FunctionKeyMapping mapping) const;
     void append(char ch) { _pendingSequence += ch; }
     void append(std::string_view sequence) { _pendingSequence += sequence; }
 
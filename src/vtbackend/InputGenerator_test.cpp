@@ -133,6 +133,55 @@ TEST_CASE("InputGenerator.all(Ctrl + A..Z)", "[terminal,input]")
     }
 }
 
+TEST_CASE("StandardKeyboardInputGenerator.functionKeys", "[terminal,input]")
+{
+    auto input = StandardKeyboardInputGenerator {};
+
+    input.generateKey(Key::F5, Modifier::None, KeyboardEventType::Press);
+    CHECK(escape(input.take()) == escape("\033[15~"sv));
+
+    input.generateKey(Key::F1, Modifiers { Modifier::Shift, Modifier::Control }, KeyboardEventType::Press);
+    CHECK(escape(input.take()) == escape("\033O6P"sv));
+
+    input.generateKey(Key::Delete, Modifier::Alt, KeyboardEventType::Press);
+    CHECK(escape(input.take()) == escape("\033\033[3;3~"sv));
+
+    input.generateKey(Key::Backspace, Modifier::Control, KeyboardEventType::Press);
+    CHECK(escape(input.take()) == escape("\x08"sv));
+
+    // Modifiers beyond Shift, Alt, Control, and Super are encoded as well.
+    input.generateKey(Key::F12, Modifiers { Modifier::Shift, Modifier::NumLock }, KeyboardEventType::Press);
+    CHECK(escape(input.take()) == escape("\033[24;130~"sv));
+
+    CHECK(!input.generateKey(Key::MediaPlay, Modifier::None, KeyboardEventType::Press));
+    CHECK(!input.generateKey(Key::F5, Modifier::None, KeyboardEventType::Release));
+    CHECK(input.take().empty());
+}
+
+TEST_CASE("StandardKeyboardInputGenerator.applicationModes", "[terminal,input]")
+{
+    auto input = StandardKeyboardInputGenerator {};
+    input.setCursorKeysMode(KeyMode::Application);
+    input.setApplicationKeypadMode(true);
+
+    // Application mode sequences ignore all modifiers but Alt.
+    input.generateKey(Key::UpArrow, Modifier::Shift, KeyboardEventType::Press);
+    CHECK(escape(input.take()) == escape("\033OA"sv));
+
+    input.generateKey(Key::Home, Modifier::Alt, KeyboardEventType::Press);
+    CHECK(escape(input.take()) == escape("\033\033OH"sv));
+
+    input.generateKey(Key::PageUp, Modifier::Control, KeyboardEventType::Press);
+    CHECK(escape(input.take()) == escape("\033[5~"sv));
+
+    input.generateKey(Key::Numpad_Enter, Modifier::None, KeyboardEventType::Press);
+    CHECK(escape(input.take()) == escape("\033OM"sv));
+
+    // Keys without application mode sequences are encoded as usual.
+    input.generateKey(Key::Insert, Modifier::Shift, KeyboardEventType::Press);
+    CHECK(escape(input.take()) == escape("\033[2;2~"sv));
+}
+
 // {{{ ExtendedKeyboardInputGenerator
 
 TEST_CASE("ExtendedKeyboardInputGenerator.CSIu.Ctrl+L", "[terminal,input]")
@@ -171,4 +220,24 @@ TEST_CASE("ExtendedKeyboardInputGenerator.CSIu.Escape", "[terminal,input]")
     REQUIRE(escape(input.take()) == escape("\033[27;1:3u"sv));
 }
 
+TEST_CASE("ExtendedKeyboardInputGenerator.CSIu.functionKeys", "[terminal,input]")
+{
+    auto input = ExtendedKeyboardInputGenerator {};
+    input.enter(KeyboardEventFlag::DisambiguateEscapeCodes);
+
+    input.generateKey(Key::F13, Modifier::Control, KeyboardEventType::Press);
+    REQUIRE(escape(input.take()) == escape("\033[57376;5u"sv));
+
+    input.generateKey(Key::LeftArrow, Modifier::None, KeyboardEventType::Press);
+    REQUIRE(escape(input.take()) == escape("\033[1D"sv));
+
+    input.generateKey(
+        Key::PageDown, Modifiers { Modifier::Super, Modifier::Hyper }, KeyboardEventType::Press);
+    REQUIRE(escape(input.take()) == escape("\033[6;25~"sv));
+
+    input.flags().enable(KeyboardEventFlag::ReportEventTypes);
+    input.generateKey(Key::F13, Modifier::Control, KeyboardEventType::Repeat);
+    REQUIRE(escape(input.take()) == escape("\033[57376;4:2u"sv));
+}
+
 // }}}
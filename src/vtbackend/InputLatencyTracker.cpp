@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/InputLatencyTracker.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace vtbackend
+{
+
+namespace
+{
+    template <typename Projection>
+    InputLatencyTracker::duration percentile(std::deque<InputLatencyTracker::Sample> const& samples,
+                                             double fraction,
+                                             Projection projection)
+    {
+        auto values = std::vector<InputLatencyTracker::duration> {};
+        values.reserve(samples.size());
+        for (auto const& sample: samples)
+            values.emplace_back(projection(sample));
+
+        auto const index = std::min(values.size() - 1, static_cast<size_t>(fraction * double(values.size())));
+        std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+        return values[index];
+    }
+} // namespace
+
+void InputLatencyTracker::keySent(clock::time_point now)
+{
+    auto const _ = std::lock_guard { _mutex };
+    if (_stage.load() != Stage::Idle && now - _keyTime < ProbeTimeout)
+        return;
+
+    _keyTime = now;
+    _stage = Stage::KeySent;
+}
+
+void InputLatencyTracker::outputRead(clock::time_point now)
+{
+    if (_stage.load(std::memory_order_relaxed) != Stage::KeySent)
+        return;
+
+    auto const _ = std::lock_guard { _mutex };
+    if (_stage.load() != Stage::KeySent)
+        return;
+
+    _readTime = now;
+    _stage = Stage::OutputRead;
+}
+
+void InputLatencyTracker::outputParsed()
+{
+    if (_stage.load(std::memory_order_relaxed) != Stage::OutputRead)
+        return;
+
+    auto const _ = std::lock_guard { _mutex };
+    if (_stage.load() == Stage::OutputRead)
+        _stage = Stage::OutputParsed;
+}
+
+void InputLatencyTracker::frameBuilt(uint64_t frameID)
+{
+    if (_stage.load(std::memory_order_relaxed) != Stage::OutputParsed)
+        return;
+
+    auto const _ = std::lock_guard { _mutex };
+    if (_stage.load() != Stage::OutputParsed)
+        return;
+
+    _frameID = frameID;
+    _stage = Stage::FrameBuilt;
+}
+
+void InputLatencyTracker::frameSwapped(uint64_t frameID, clock::time_point now)
+{
+    if (_stage.load(std::memory_order_relaxed) != Stage::FrameBuilt)
+        return;
+
+    auto const _ = std::lock_guard { _mutex };
+    if (_stage.load() != Stage::FrameBuilt || frameID < _frameID)
+        return;
+
+    _swapTime = now;
+    _stage = Stage::FrameSwapped;
+}
+
+void InputLatencyTracker::framePresented(uint64_t frameID, clock::time_point now)
+{
+    if (_stage.load(std::memory_order_relaxed) != Stage::FrameSwapped)
+        return;
+
+    auto const _ = std::lock_guard { _mutex };
+    if (_stage.load() != Stage::FrameSwapped || frameID < _frameID)
+        return;
+
+    if (_samples.size() == MaxSamples)
+        _samples.pop_front();
+    _samples.emplace_back(Sample { _readTime - _keyTime, _swapTime - _keyTime, now - _keyTime });
+    _stage = Stage::Idle;
+}
+
+std::optional<InputLatencyTracker::Summary> InputLatencyTracker::summary() const
+{
+    auto const _ = std::lock_guard { _mutex };
+    if (_samples.empty())
+        return std::nullopt;
+
+    return Summary {
+        _samples.size(),
+        percentile(_samples, 0.50, [](Sample const& sample) { return sample.keyToRead; }),
+        percentile(_samples, 0.50, [](Sample const& sample) { return sample.keyToSwap; }),
+        percentile(_samples, 0.50, [](Sample const& sample) { return sample.keyToPresent; }),
+        percentile(_samples, 0.99, [](Sample const& sample) { return sample.keyToPresent; }),
+    };
+}
+
+} // namespace vtbackend
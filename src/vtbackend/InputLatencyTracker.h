@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace vtbackend
+{
+
+/**
+ * Measures the latency from a key event to the presentation of the frame showing its effect.
+ *
+ * A key event starts a probe, unless one is already in flight. The probe then follows
+ * the first PTY read after the key has been written to the application, the first frame
+ * built after that output has been parsed, the swap of that frame to the front buffer,
+ * and finally the presentation of that frame (or a later one) by the renderer.
+ *
+ * Since the first read following a key event is not guaranteed to carry the key's echo,
+ * the measured latency is an approximation, which however is accurate for interactive typing.
+ *
+ * All methods may be called from any thread. Except for keySent(), they only take a lock
+ * when they advance the probe in flight.
+ */
+class InputLatencyTracker
+{
+  public:
+    using clock = std::chrono::steady_clock;
+    using duration = clock::duration;
+
+    /// Number of most recent probes the summary is computed from.
+    static constexpr size_t MaxSamples = 256;
+
+    /// A probe that is not completed within this time is abandoned by the next key event,
+    /// e.g. when the application does not echo the key.
+    static constexpr auto ProbeTimeout = std::chrono::seconds(1);
+
+    struct Sample
+    {
+        duration keyToRead;
+        duration keyToSwap;
+        duration keyToPresent;
+    };
+
+    struct Summary
+    {
+        size_t count;
+        duration keyToReadP50;
+        duration keyToSwapP50;
+        duration keyToPresentP50;
+        duration keyToPresentP99;
+    };
+
+    /// Starts a probe at @p now, if none is in flight.
+    void keySent(clock::time_point now);
+
+    /// Informs the probe about output having been read from the PTY.
+    void outputRead(clock::time_point now);
+
+    /// Informs the probe about all output read so far having been parsed.
+    void outputParsed();
+
+    /// Informs the probe about the frame @p frameID having been built, reflecting all output parsed so far.
+    void frameBuilt(uint64_t frameID);
+
+    /// Informs the probe about the frame @p frameID having been swapped to the front buffer.
+    void frameSwapped(uint64_t frameID, clock::time_point now);
+
+    /// Informs the probe about the frame @p frameID having been presented, completing the probe.
+    void framePresented(uint64_t frameID, clock::time_point now);
+
+    /// @returns the percentiles of the most recent probes, or std::nullopt if no probe completed yet.
+    [[nodiscard]] std::optional<Summary> summary() const;
+
+  private:
+    enum class Stage
+    {
+        Idle,
+        KeySent,
+        OutputRead,
+        OutputParsed,
+        FrameBuilt,
+        FrameSwapped,
+    };
+
+    std::atomic<Stage> _stage = Stage::Idle; // read without the lock to skip non-advancing calls
+
+    mutable std::mutex _mutex; // guards all members below and writing _stage
+    clock::time_point _keyTime {};
+    clock::time_point _readTime {};
+    clock::time_point _swapTime {};
+    uint64_t _frameID = 0;
+    std::deque<Sample> _samples;
+};
+
+} // namespace vtbackend
+
+template <>
+struct fmt::formatter<vtbackend::InputLatencyTracker::Summary>: fmt::formatter<std::string>
+{
+    auto format(vtbackend::InputLatencyTracker::Summary const& summary, format_context& ctx)
+        -> format_context::iterator
+    {
+        auto const ms = [](auto value) {
+            return std::chrono::duration<double, std::milli>(value).count();
+        };
+        return formatter<std::string>::format(
+            fmt::format("key-to-present p50 {:.1f} ms, p99 {:.1f} ms "
+                        "(key-to-read p50 {:.1f} ms, key-to-swap p50 {:.1f} ms, {} samples)",
+                        ms(summary.keyToPresentP50),
+                        ms(summary.keyToPresentP99),
+                        ms(summary.keyToReadP50),
+                        ms(summary.keyToSwapP50),
+                        summary.count),
+            ctx);
+    }
+};
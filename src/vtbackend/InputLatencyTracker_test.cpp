@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/InputLatencyTracker.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+
+using namespace std::chrono_literals;
+using vtbackend::InputLatencyTracker;
+
+namespace
+{
+
+auto const start = InputLatencyTracker::clock::time_point {} + 1h;
+
+void probe(InputLatencyTracker& tracker, uint64_t frameID, std::chrono::milliseconds latency)
+{
+    auto const keyTime = start + frameID * 1s;
+    tracker.keySent(keyTime);
+    tracker.outputRead(keyTime + 1ms);
+    tracker.outputParsed();
+    tracker.frameBuilt(frameID);
+    tracker.frameSwapped(frameID, keyTime + 2ms);
+    tracker.framePresented(frameID, keyTime + latency);
+}
+
+} // namespace
+
+TEST_CASE("InputLatencyTracker.empty", "[InputLatencyTracker]")
+{
+    auto tracker = InputLatencyTracker {};
+    CHECK(!tracker.summary().has_value());
+
+    // Frames without a preceding key event are not measured.
+    tracker.outputRead(start);
+    tracker.outputParsed();
+    tracker.frameBuilt(1);
+    tracker.frameSwapped(1, start);
+    tracker.framePresented(1, start);
+    CHECK(!tracker.summary().has_value());
+}
+
+TEST_CASE("InputLatencyTracker.stages", "[InputLatencyTracker]")
+{
+    auto tracker = InputLatencyTracker {};
+    tracker.keySent(start);
+
+    // A frame built before the output has been parsed does not reflect the key event.
+    tracker.outputRead(start + 1ms);
+    tracker.frameBuilt(1);
+    tracker.frameSwapped(1, start + 2ms);
+    tracker.framePresented(1, start + 3ms);
+    CHECK(!tracker.summary().has_value());
+
+    // Further key events do not restart the probe in flight.
+    tracker.keySent(start + 4ms);
+
+    tracker.outputParsed();
+    tracker.frameBuilt(2);
+    tracker.frameSwapped(2, start + 5ms);
+    tracker.framePresented(1, start + 6ms); // an earlier frame being presented again
+    CHECK(!tracker.summary().has_value());
+    tracker.framePresented(3, start + 7ms);
+
+    auto const summary = tracker.summary();
+    REQUIRE(summary.has_value());
+    CHECK(summary->count == 1);
+    CHECK(summary->keyToReadP50 == 1ms);
+    CHECK(summary->keyToSwapP50 == 5ms);
+    CHECK(summary->keyToPresentP50 == 7ms);
+    CHECK(summary->keyToPresentP99 == 7ms);
+}
+
+TEST_CASE("InputLatencyTracker.timeout", "[InputLatencyTracker]")
+{
+    auto tracker = InputLatencyTracker {};
+    tracker.keySent(start);
+
+    // The application did not echo the first key, so the probe restarts with a later one.
+    auto const later = start + InputLatencyTracker::ProbeTimeout + 1ms;
+    tracker.keySent(later);
+    tracker.outputRead(later + 1ms);
+    tracker.outputParsed();
+    tracker.frameBuilt(1);
+    tracker.frameSwapped(1, later + 2ms);
+    tracker.framePresented(1, later + 3ms);
+
+    auto const summary = tracker.summary();
+    REQUIRE(summary.has_value());
+    CHECK(summary->keyToPresentP50 == 3ms);
+}
+
+TEST_CASE("InputLatencyTracker.percentiles", "[InputLatencyTracker]")
+{
+    auto tracker = InputLatencyTracker {};
+    for (auto i = 1; i <= 100; ++i)
+        probe(tracker, static_cast<uint64_t>(i), std::chrono::milliseconds(i));
+
+    auto const summary = tracker.summary();
+    REQUIRE(summary.has_value());
+    CHECK(summary->count == 100);
+    CHECK(summary->keyToPresentP50 == 51ms);
+    CHECK(summary->keyToPresentP99 == 100ms);
+
+    // Only the most recent samples are kept.
+    for (auto i = 101; i <= 100 + int(InputLatencyTracker::MaxSamples); ++i)
+        probe(tracker, static_cast<uint64_t>(i), 10ms);
+    CHECK(tracker.summary()->count == InputLatencyTracker::MaxSamples);
+    CHECK(tracker.summary()->keyToPresentP99 == 10ms);
+}
@@ -1,11 +1,13 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <vtbackend/GraphicsAttributes.h>
 #include <vtbackend/Line.h>
+#include <vtbackend/UnicodeTable.h>
 #include <vtbackend/primitives.h>
 
-#include <libunicode/grapheme_segmenter.h>
 #include <libunicode/utf8.h>
-#include <libunicode/width.h>
+
+#include <algorithm>
+#include <limits>
 
 using std::get;
 using std::holds_alternative;
@@ -14,13 +16,111 @@ using std::min;
 namespace vtbackend
 {
 
+std::optional<std::vector<uint16_t>> TrivialLineBuffer::computeColumnOffsets(std::string_view text,
+                                                                               ColumnCount usedColumns)
+{
+    auto offsets = std::vector<uint16_t> {};
+
+    if (std::all_of(text.begin(), text.end(), [](char ch) { return static_cast<uint8_t>(ch) < 0x80; }))
+    {
+        if (text.size() != unbox<size_t>(usedColumns))
+            return std::nullopt;
+        return offsets;
+    }
+
+    if (text.size() > std::numeric_limits<uint16_t>::max())
+        return std::nullopt;
+
+    offsets.reserve(unbox<size_t>(usedColumns));
+
+    // Mirrors the grapheme cluster segmentation and width computation of inflate().
+    auto lastChar = char32_t { 0 };
+    auto utf8DecoderState = unicode::utf8_decoder_state {};
+    auto codepointStart = size_t { 0 };
+    auto pending = false;
+
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        if (!pending)
+            codepointStart = i;
+
+        auto const r = unicode::from_utf8(utf8DecoderState, static_cast<uint8_t>(text[i]));
+        pending = holds_alternative<unicode::Incomplete>(r);
+        if (pending)
+            continue;
+
+        auto const nextChar = holds_alternative<unicode::Success>(r) ? get<unicode::Success>(r).value
+                                                                     : char32_t { 0xFFFD };
+
+        if (offsets.empty() || UnicodeTable::breakable(lastChar, nextChar))
+        {
+            auto const width = std::max(1, static_cast<int>(UnicodeTable::width(nextChar)));
+            offsets.insert(offsets.end(), static_cast<size_t>(width), static_cast<uint16_t>(codepointStart));
+        }
+
+        lastChar = nextChar;
+    }
+
+    if (pending || offsets.size() != unbox<size_t>(usedColumns))
+        return std::nullopt;
+
+    return offsets;
+}
+
+std::optional<std::vector<uint16_t>> TrivialLineBuffer::columnOffsetsAppending(std::string_view chars,
+                                                                                 ColumnCount cellCount) const
+{
+    auto appendedOffsets = computeColumnOffsets(chars, cellCount);
+    if (!appendedOffsets)
+        return std::nullopt;
+
+    if (isAscii() && appendedOffsets->empty())
+        return appendedOffsets;
+
+    auto const textSize = text.size();
+    if (textSize + chars.size() > std::numeric_limits<uint16_t>::max())
+        return std::nullopt;
+
+    if (textSize != 0)
+    {
+        // The appended text must not extend the last grapheme cluster of the existing text.
+        auto const view = text.view();
+        auto lastStart = textSize - 1;
+        while (lastStart > 0 && (static_cast<uint8_t>(view[lastStart]) & 0xC0) == 0x80)
+            --lastStart;
+        auto const lastChar = unicode::convert_to<char32_t>(view.substr(lastStart));
+        auto const firstChar =
+            unicode::convert_to<char32_t>(chars.substr(0, std::min(chars.size(), size_t { 4 })));
+        if (lastChar.empty() || firstChar.empty()
+            || !UnicodeTable::breakable(lastChar.back(), firstChar.front()))
+            return std::nullopt;
+    }
+
+    auto offsets = std::vector<uint16_t> {};
+    offsets.reserve(unbox<size_t>(usedColumns + cellCount));
+    if (isAscii())
+        for (size_t i = 0; i < textSize; ++i)
+            offsets.push_back(static_cast<uint16_t>(i));
+    else
+        offsets = columnOffsets;
+
+    if (appendedOffsets->empty())
+        for (size_t i = 0; i < chars.size(); ++i)
+            offsets.push_back(static_cast<uint16_t>(textSize + i));
+    else
+        for (auto const offset: *appendedOffsets)
+            offsets.push_back(static_cast<uint16_t>(textSize + offset));
+
+    return offsets;
+}
+
 template <typename Cell>
 typename Line<Cell>::InflatedBuffer Line<Cell>::reflow(ColumnCount newColumnCount)
 {
     using crispy::comparison;
     if (isTrivialBuffer())
     {
-        switch (crispy::strongCompare(newColumnCount, ColumnCount::cast_from(trivialBuffer().text.size())))
+        switch (crispy::strongCompare(newColumnCount, trivialBuffer().usedColumns))
         {
             case comparison::Greater: trivialBuffer().displayWidth = newColumnCount; return {};
             case comparison::Equal: return {};
@@ -95,6 +195,114 @@ inline void Line<Cell>::resize(ColumnCount count)
     inflatedBuffer().resize(unbox<size_t>(count));
 }
 
+template <typename Cell>
+void Line<Cell>::fillRange(ColumnOffset start,
+                           ColumnCount count,
+                           GraphicsAttributes const& attributes,
+                           char32_t codepoint,
+                           uint8_t width)
+{
+    auto prototype = Cell { attributes };
+    prototype.write(attributes, codepoint, width);
+    auto const cells = useRange(start, count);
+    std::fill(cells.begin(), cells.end(), prototype);
+}
+
+template <typename Cell>
+void Line<Cell>::eraseRange(ColumnOffset start, ColumnCount count, GraphicsAttributes const& attributes)
+{
+    if (start == ColumnOffset(0) && count == size())
+    {
+        // Keeps (or turns) the line trivial, without touching any cells.
+        reset(_flags, attributes);
+        return;
+    }
+
+    auto const cells = useRange(start, count);
+    std::fill(cells.begin(), cells.end(), Cell { attributes });
+}
+
+template <typename Cell>
+void Line<Cell>::copyRange(Line const& source,
+                           ColumnOffset sourceStart,
+                           ColumnCount count,
+                           ColumnOffset targetStart)
+{
+    auto const& sourceCells = source.inflatedBuffer();
+    auto const first = sourceCells.begin() + unbox<long>(sourceStart);
+    auto const last = first + unbox<long>(count);
+    auto const target = useRange(targetStart, count);
+
+    if (&source == this && targetStart > sourceStart)
+        std::copy_backward(first, last, target.end());
+    else
+        std::copy(first, last, target.begin());
+}
+
+template <typename Cell>
+void Line<Cell>::insertCells(ColumnOffset start,
+                             ColumnOffset rightMargin,
+                             ColumnCount count,
+                             GraphicsAttributes const& attributes)
+{
+    auto const n = std::min(unbox<long>(count), unbox<long>(rightMargin - start) + 1);
+    if (n <= 0)
+        return;
+
+    if (isTrivialBuffer())
+    {
+        // Only blank cells are being shifted, so that nothing changes.
+        auto const& buffer = trivialBuffer();
+        if (start >= boxed_cast<ColumnOffset>(buffer.usedColumns) && buffer.fillAttributes == attributes)
+            return;
+    }
+
+    auto& buffer = inflatedBuffer();
+    auto const first = buffer.begin() + unbox<long>(start);
+    auto const last = buffer.begin() + unbox<long>(rightMargin) + 1;
+    std::move_backward(first, last - n, last);
+    fillRange(start, ColumnCount::cast_from(n), attributes, L' ', 1);
+}
+
+template <typename Cell>
+void Line<Cell>::deleteCells(ColumnOffset start,
+                             ColumnOffset rightMargin,
+                             ColumnCount count,
+                             GraphicsAttributes const& attributes)
+{
+    auto const n = std::min(unbox<long>(count), unbox<long>(rightMargin - start) + 1);
+    if (n <= 0)
+        return;
+
+    if (isTrivialBuffer())
+    {
+        // No text is following the deleted columns, so that the text merely ends earlier (if at all).
+        auto& buffer = trivialBuffer();
+        if (unbox<long>(buffer.usedColumns) <= unbox<long>(start) + n && buffer.fillAttributes == attributes)
+        {
+            if (start < boxed_cast<ColumnOffset>(buffer.usedColumns) && !buffer.isContinuationAt(start))
+            {
+                buffer.text = crispy::BufferFragment<char>(
+                    buffer.text.owner(), buffer.text.span().subspan(0, buffer.byteOffsetAt(start)));
+                if (!buffer.isAscii())
+                    buffer.columnOffsets.resize(unbox<size_t>(start));
+                while (!buffer.spans.empty() && buffer.spans.back().start >= start)
+                    buffer.spans.pop_back();
+                buffer.usedColumns = boxed_cast<ColumnCount>(start);
+                return;
+            }
+            if (start >= boxed_cast<ColumnOffset>(buffer.usedColumns))
+                return;
+        }
+    }
+
+    auto& buffer = inflatedBuffer();
+    auto const first = buffer.begin() + unbox<long>(start);
+    auto const last = buffer.begin() + unbox<long>(rightMargin) + 1;
+    std::move(first + n, last, first);
+    fillRange(rightMargin - ColumnOffset::cast_from(n - 1), ColumnCount::cast_from(n), attributes, L' ', 1);
+}
+
 template <typename Cell>
 gsl::span<Cell const> Line<Cell>::trim_blank_right() const noexcept
 {
@@ -157,17 +365,51 @@ std::string Line<Cell>::toUtf8Trimmed(bool stripLeadingSpaces, bool stripTrailin
 }
 
 template <typename Cell>
-InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input)
+LineTextSnapshot Line<Cell>::textSnapshot() const
+{
+    if (isTrivialBuffer())
+        return LineTextSnapshot { _flags, trivialBuffer().text, {} };
+
+    return LineTextSnapshot { _flags, {}, toUtf8Trimmed(false, true) };
+}
+
+template <typename Cell>
+InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input, std::pmr::memory_resource* cellResource)
 {
     static constexpr char32_t ReplacementCharacter { 0xFFFD };
 
-    auto columns = InflatedLineBuffer<Cell> {};
+    auto columns = InflatedLineBuffer<Cell> { cellResource };
     columns.reserve(unbox<size_t>(input.displayWidth));
 
+    if (input.isAscii())
+    {
+        // Each byte occupies exactly one column, so the cells of a run are copied from one cell
+        // holding the run's attributes, and then only get their character written.
+        input.forEachRun([&](ColumnOffset start,
+                             std::string_view text,
+                             GraphicsAttributes const& attributes,
+                             HyperlinkId hyperlink) {
+            assert(unbox<size_t>(start) == columns.size());
+            columns.insert(columns.end(), text.size(), Cell { attributes, hyperlink });
+            auto* cell = columns.data() + unbox<size_t>(start);
+            for (char const ch: text)
+                (cell++)->writeTextOnly(static_cast<char32_t>(static_cast<uint8_t>(ch)), 1);
+        });
+        assert(columns.size() == unbox<size_t>(input.usedColumns));
+        if (auto const width = unbox<size_t>(input.displayWidth); columns.size() < width)
+            columns.insert(columns.end(), width - columns.size(), Cell { input.fillAttributes });
+        return columns;
+    }
+
     auto lastChar = char32_t { 0 };
     auto utf8DecoderState = unicode::utf8_decoder_state {};
     auto gapPending = 0;
 
+    // Attributes of the run of text currently being unpacked.
+    auto const* textAttributes = &input.textAttributes;
+    auto hyperlink = input.hyperlink;
+    auto nextSpan = input.spans.begin();
+
     for (char const ch: input.text.view())
     {
         unicode::ConvertResult const r = unicode::from_utf8(utf8DecoderState, static_cast<uint8_t>(ch));
@@ -177,18 +419,23 @@ InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input)
         auto const nextChar =
             holds_alternative<unicode::Success>(r) ? get<unicode::Success>(r).value : ReplacementCharacter;
 
-        if (unicode::grapheme_segmenter::breakable(lastChar, nextChar))
+        if (UnicodeTable::breakable(lastChar, nextChar))
         {
             while (gapPending > 0)
             {
-                columns.emplace_back(input.textAttributes.with(CellFlag::WideCharContinuation),
-                                     input.hyperlink);
+                columns.emplace_back(textAttributes->with(CellFlag::WideCharContinuation), hyperlink);
                 --gapPending;
             }
-            auto const charWidth = unicode::width(nextChar);
+            while (nextSpan != input.spans.end() && unbox<size_t>(nextSpan->start) <= columns.size())
+            {
+                textAttributes = &nextSpan->attributes;
+                hyperlink = nextSpan->hyperlink;
+                ++nextSpan;
+            }
+            auto const charWidth = UnicodeTable::width(nextChar);
             columns.emplace_back(Cell {});
-            columns.back().setHyperlink(input.hyperlink);
-            columns.back().write(input.textAttributes, nextChar, static_cast<uint8_t>(charWidth));
+            columns.back().setHyperlink(hyperlink);
+            columns.back().write(*textAttributes, nextChar, static_cast<uint8_t>(charWidth));
             gapPending = charWidth - 1;
         }
         else
@@ -201,8 +448,8 @@ InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input)
                 auto const n = min(extendedWidth, cellsAvailable);
                 for (int i = 1; i < n; ++i)
                 {
-                    columns.emplace_back(Cell { input.textAttributes });
-                    columns.back().setHyperlink(input.hyperlink);
+                    columns.emplace_back(Cell { *textAttributes });
+                    columns.back().setHyperlink(hyperlink);
                 }
             }
         }
@@ -211,7 +458,7 @@ InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input)
 
     while (gapPending > 0)
     {
-        columns.emplace_back(Cell { input.textAttributes, input.hyperlink });
+        columns.emplace_back(Cell { *textAttributes, hyperlink });
         --gapPending;
     }
 
@@ -223,10 +470,108 @@ InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input)
 
     return columns;
 }
+
+template <typename Cell>
+std::optional<TrivialLineBuffer> deflate(InflatedLineBuffer<Cell> const& input, std::string& text)
+{
+    auto const attributesOf = [](Cell const& cell) {
+        return GraphicsAttributes {
+            cell.foregroundColor(), cell.backgroundColor(), cell.underlineColor(), cell.flags()
+        };
+    };
+
+    text.clear();
+    if (input.empty())
+        return std::nullopt;
+
+    // Trailing empty cells make up the fill area.
+    auto usedColumns = input.size();
+    while (usedColumns > 0 && input[usedColumns - 1].codepointCount() == 0
+           && !input[usedColumns - 1].isFlagEnabled(CellFlag::WideCharContinuation))
+        --usedColumns;
+
+    auto const fillAttributes = attributesOf(usedColumns < input.size() ? input[usedColumns] : input.back());
+    for (auto column = usedColumns; column < input.size(); ++column)
+    {
+        Cell const& cell = input[column];
+        if (!!cell.hyperlink() || cell.imageFragment() || attributesOf(cell) != fillAttributes)
+            return std::nullopt;
+    }
+
+    auto output = TrivialLineBuffer { ColumnCount::cast_from(input.size()),
+                                      fillAttributes,
+                                      fillAttributes,
+                                      HyperlinkId {},
+                                      ColumnCount::cast_from(usedColumns) };
+    auto offsets = std::vector<uint16_t> {};
+    offsets.reserve(usedColumns);
+
+    for (size_t column = 0; column < usedColumns;)
+    {
+        Cell const& cell = input[column];
+        if (cell.codepointCount() == 0 || cell.imageFragment()
+            || cell.isFlagEnabled(CellFlag::WideCharContinuation))
+            return std::nullopt;
+
+        auto const attributes = attributesOf(cell);
+        auto const hyperlink = cell.hyperlink();
+        if (column == 0)
+        {
+            output.textAttributes = attributes;
+            output.hyperlink = hyperlink;
+        }
+        else if (attributes != output.lastAttributes() || hyperlink != output.lastHyperlink())
+        {
+            if (output.spans.size() == TrivialLineBuffer::MaxSpans)
+                return std::nullopt;
+            output.spans.emplace_back(TrivialLineSpan { ColumnOffset::cast_from(column), attributes, hyperlink });
+        }
+
+        auto const width = std::max(size_t { 1 }, static_cast<size_t>(cell.width()));
+        if (column + width > usedColumns)
+            return std::nullopt;
+        for (size_t i = 1; i < width; ++i)
+        {
+            Cell const& continuation = input[column + i];
+            if (continuation.codepointCount() != 0 || continuation.hyperlink() != hyperlink
+                || continuation.imageFragment()
+                || attributesOf(continuation) != attributes.with(CellFlag::WideCharContinuation))
+                return std::nullopt;
+        }
+
+        offsets.insert(offsets.end(), width, static_cast<uint16_t>(text.size()));
+        for (size_t i = 0; i < cell.codepointCount(); ++i)
+        {
+            auto const codepoint = cell.codepoint(i);
+            if (codepoint < 0x80)
+                text.push_back(static_cast<char>(codepoint));
+            else
+                text += unicode::convert_to<char>(codepoint);
+        }
+        column += width;
+    }
+
+    // Only accept the line if it is inflated back into the very same cells.
+    auto columnOffsets = TrivialLineBuffer::computeColumnOffsets(text, output.usedColumns);
+    if (!columnOffsets || (!columnOffsets->empty() && *columnOffsets != offsets))
+        return std::nullopt;
+    output.columnOffsets = std::move(*columnOffsets);
+
+    return output;
+}
 } // end namespace vtbackend
 
 #include <vtbackend/cell/CompactCell.h>
 template class vtbackend::Line<vtbackend::CompactCell>;
+template std::optional<vtbackend::TrivialLineBuffer> vtbackend::deflate<vtbackend::CompactCell>(
+    vtbackend::InflatedLineBuffer<vtbackend::CompactCell> const&, std::string&);
 
 #include <vtbackend/cell/SimpleCell.h>
 template class vtbackend::Line<vtbackend::SimpleCell>;
+template std::optional<vtbackend::TrivialLineBuffer> vtbackend::deflate<vtbackend::SimpleCell>(
+    vtbackend::InflatedLineBuffer<vtbackend::SimpleCell> const&, std::string&);
+
+#include <vtbackend/cell/FlatCell.h>
+template class vtbackend::Line<vtbackend::FlatCell>;
+template std::optional<vtbackend::TrivialLineBuffer> vtbackend::deflate<vtbackend::FlatCell>(
+    vtbackend::InflatedLineBuffer<vtbackend::FlatCell> const&, std::string&);
@@ -16,7 +16,12 @@
 #include <gsl/span>
 #include <gsl/span_ext>
 
+#include <algorithm>
+#include <cctype>
+#include <memory_resource>
+#include <optional>
 #include <string>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -42,10 +47,33 @@ template <typename T> struct OptionalProperty<T, true> { T value; };
 // clang-format on
 
 /**
- * Line storage with call columns sharing the same SGR attributes.
+ * A run of columns within a TrivialLineBuffer using other attributes than the ones before it.
+ *
+ * The run spans from its start column until the start column of the next run,
+ * or until the end of the used columns.
+ */
+struct TrivialLineSpan
+{
+    ColumnOffset start;
+    GraphicsAttributes attributes;
+    HyperlinkId hyperlink {};
+};
+
+/**
+ * Line storage for text that has been written without cell-wise editing.
+ *
+ * The text starts with textAttributes and hyperlink, and may switch to other attributes in a few spans
+ * (e.g. colored `ls` or compiler diagnostics), while the unused columns are filled with fillAttributes.
+ *
+ * The text is UTF-8 encoded. As long as it is US-ASCII only, each byte occupies exactly one column.
+ * Otherwise columnOffsets holds the precomputed column layout of the text,
+ * so that the line does not need to be inflated in order to be inspected.
  */
 struct TrivialLineBuffer
 {
+    // Maximum number of attribute spans before a line is rather inflated.
+    static constexpr size_t MaxSpans = 15;
+
     ColumnCount displayWidth;
     GraphicsAttributes textAttributes;
     GraphicsAttributes fillAttributes = textAttributes;
@@ -54,30 +82,231 @@ struct TrivialLineBuffer
     ColumnCount usedColumns {};
     crispy::BufferFragment<char> text {};
 
+    // For each used column, the byte offset into text of the grapheme cluster occupying it.
+    // Wide grapheme clusters therefore occupy multiple consecutive entries of the same value.
+    // Empty if text is US-ASCII only.
+    std::vector<uint16_t> columnOffsets {};
+
+    // Attribute runs following the initial run using textAttributes, ordered by start column.
+    std::vector<TrivialLineSpan> spans {};
+
     void reset(GraphicsAttributes attributes) noexcept
     {
         textAttributes = attributes;
         fillAttributes = attributes;
         hyperlink = {};
         usedColumns = {};
-        text.reset();
+        text = {};
+        columnOffsets.clear();
+        spans.clear();
+    }
+
+    /// Computes the column layout for the given UTF-8 text, as it would be inflated.
+    ///
+    /// @returns an empty vector if the text is US-ASCII only,
+    ///          or std::nullopt if the text does not occupy exactly @p usedColumns columns
+    ///          or is too large to be indexed.
+    [[nodiscard]] static std::optional<std::vector<uint16_t>> computeColumnOffsets(std::string_view text,
+                                                                                   ColumnCount usedColumns);
+
+    /// Computes the column layout of this line's text with the given UTF-8 text appended,
+    /// under the condition that the appended text starts a new grapheme cluster.
+    ///
+    /// @returns the new layout (empty if all text is US-ASCII only),
+    ///          or std::nullopt if the text cannot be appended as such.
+    [[nodiscard]] std::optional<std::vector<uint16_t>> columnOffsetsAppending(std::string_view chars,
+                                                                              ColumnCount cellCount) const;
+
+    [[nodiscard]] bool isAscii() const noexcept { return columnOffsets.empty(); }
+
+    /// @returns the attributes of the last run of text.
+    [[nodiscard]] GraphicsAttributes const& lastAttributes() const noexcept
+    {
+        return spans.empty() ? textAttributes : spans.back().attributes;
+    }
+
+    /// @returns the hyperlink of the last run of text.
+    [[nodiscard]] HyperlinkId lastHyperlink() const noexcept
+    {
+        return spans.empty() ? hyperlink : spans.back().hyperlink;
+    }
+
+    /// @returns the attributes used at the given column.
+    [[nodiscard]] GraphicsAttributes const& attributesAt(ColumnOffset column) const noexcept
+    {
+        if (column >= boxed_cast<ColumnOffset>(usedColumns))
+            return fillAttributes;
+        auto const* span = spanAt(column);
+        return span ? span->attributes : textAttributes;
+    }
+
+    /// @returns the hyperlink used at the given column.
+    [[nodiscard]] HyperlinkId hyperlinkAt(ColumnOffset column) const noexcept
+    {
+        if (column >= boxed_cast<ColumnOffset>(usedColumns))
+            return {};
+        auto const* span = spanAt(column);
+        return span ? span->hyperlink : hyperlink;
+    }
+
+    /// @returns the union of the cell flags used by all runs of text.
+    [[nodiscard]] CellFlags textFlags() const noexcept
+    {
+        auto flags = textAttributes.flags;
+        for (auto const& span: spans)
+            flags |= span.attributes.flags;
+        return flags;
+    }
+
+    /// Invokes @p callback(startColumn, text, attributes, hyperlink) for each run of text.
+    template <typename Callback>
+    void forEachRun(Callback const& callback) const
+    {
+        auto start = ColumnOffset(0);
+        auto const* attributes = &textAttributes;
+        auto runHyperlink = hyperlink;
+        for (auto const& span: spans)
+        {
+            auto const startByte = byteOffsetAt(start);
+            callback(start,
+                     text.view().substr(startByte, byteOffsetAt(span.start) - startByte),
+                     *attributes,
+                     runHyperlink);
+            start = span.start;
+            attributes = &span.attributes;
+            runHyperlink = span.hyperlink;
+        }
+        callback(start, text.view().substr(byteOffsetAt(start)), *attributes, runHyperlink);
+    }
+
+    /// @returns the byte offset into text of the grapheme cluster at the given column,
+    ///          or the text size if the column is not used.
+    [[nodiscard]] size_t byteOffsetAt(ColumnOffset column) const noexcept
+    {
+        if (column >= boxed_cast<ColumnOffset>(usedColumns))
+            return text.size();
+        if (isAscii())
+            return unbox<size_t>(column);
+        return columnOffsets[unbox<size_t>(column)];
+    }
+
+    /// @returns the (leading) column of the grapheme cluster containing the given byte offset into text.
+    [[nodiscard]] ColumnOffset columnAt(size_t byteOffset) const noexcept
+    {
+        if (isAscii())
+            return ColumnOffset::cast_from(byteOffset);
+        auto const i = std::prev(std::upper_bound(columnOffsets.begin(), columnOffsets.end(), byteOffset));
+        return ColumnOffset::cast_from(
+            std::distance(columnOffsets.begin(), std::lower_bound(columnOffsets.begin(), i, *i)));
+    }
+
+    /// Tests whether the given column is the second (or later) column of a wide grapheme cluster.
+    [[nodiscard]] bool isContinuationAt(ColumnOffset column) const noexcept
+    {
+        auto const i = unbox<size_t>(column);
+        return !isAscii() && i > 0 && i < columnOffsets.size() && columnOffsets[i] == columnOffsets[i - 1];
+    }
+
+    /// @returns the UTF-8 text of the grapheme cluster starting at the given column,
+    ///          or an empty string if the column is unused or continues a wide grapheme cluster.
+    [[nodiscard]] std::string_view textAt(ColumnOffset column) const noexcept
+    {
+        if (column >= boxed_cast<ColumnOffset>(usedColumns) || isContinuationAt(column))
+            return {};
+        if (isAscii())
+            return text.view().substr(unbox<size_t>(column), 1);
+        auto const start = columnOffsets[unbox<size_t>(column)];
+        auto const next = std::upper_bound(columnOffsets.begin(), columnOffsets.end(), start);
+        auto const end = next != columnOffsets.end() ? size_t { *next } : text.size();
+        return text.view().substr(start, end - start);
+    }
+
+    /// @returns the number of columns occupied by the grapheme cluster starting at the given column.
+    [[nodiscard]] uint8_t widthAt(ColumnOffset column) const noexcept
+    {
+        if (isAscii() || column >= boxed_cast<ColumnOffset>(usedColumns) || isContinuationAt(column))
+            return 1;
+        auto const i = columnOffsets.begin() + unbox<long>(column);
+        return static_cast<uint8_t>(std::distance(i, std::upper_bound(i, columnOffsets.end(), *i)));
+    }
+
+  private:
+    [[nodiscard]] TrivialLineSpan const* spanAt(ColumnOffset column) const noexcept
+    {
+        auto const i = std::upper_bound(
+            spans.begin(), spans.end(), column, [](ColumnOffset c, TrivialLineSpan const& span) {
+                return c < span.start;
+            });
+        return i == spans.begin() ? nullptr : &*std::prev(i);
     }
 };
 
 template <typename Cell>
-using InflatedLineBuffer = std::vector<Cell>;
+using InflatedLineBuffer = std::pmr::vector<Cell>;
 
-/// Unpacks a TrivialLineBuffer into an InflatedLineBuffer<Cell>.
+/// Unpacks a TrivialLineBuffer into an InflatedLineBuffer<Cell>
+/// whose cells are allocated from the given memory resource.
+template <typename Cell>
+InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input,
+                                 std::pmr::memory_resource* cellResource = std::pmr::get_default_resource());
+
+/// Packs an InflatedLineBuffer<Cell> back into a TrivialLineBuffer, writing its UTF-8 text into @p text.
+///
+/// The text of the returned buffer is left empty, for the caller to point it to a stored copy of @p text.
+///
+/// @returns std::nullopt if the cells cannot be represented by a TrivialLineBuffer,
+///          e.g. because of images, gaps within the text, or too many attribute changes.
 template <typename Cell>
-InflatedLineBuffer<Cell> inflate(TrivialLineBuffer const& input);
+std::optional<TrivialLineBuffer> deflate(InflatedLineBuffer<Cell> const& input, std::string& text);
 
 template <typename Cell>
 using LineStorage = std::variant<TrivialLineBuffer, InflatedLineBuffer<Cell>>;
 
+/**
+ * Copy of the text of a line that stays valid independently of the line it has been taken from.
+ *
+ * The text of a trivial line is shared with the line's stored buffer rather than copied,
+ * so that a snapshot of many (mostly stored) lines can be taken cheaply while holding the terminal lock,
+ * and then be processed after releasing it.
+ */
+struct LineTextSnapshot
+{
+    LineFlags flags {};
+    crispy::BufferFragment<char> storedText {};
+    std::string ownText {};
+
+    /// @returns the line's UTF-8 text, without the unused columns at the end of the line.
+    [[nodiscard]] std::string_view text() const noexcept
+    {
+        return ownText.empty() ? storedText.view() : std::string_view(ownText);
+    }
+
+    /// @returns the line's UTF-8 text, with leading and/or trailing whitespace stripped off.
+    [[nodiscard]] std::string_view trimmedText(bool stripLeadingSpaces = true,
+                                               bool stripTrailingSpaces = true) const noexcept
+    {
+        auto result = text();
+        if (stripTrailingSpaces)
+            while (!result.empty() && std::isspace(static_cast<unsigned char>(result.back())))
+                result.remove_suffix(1);
+        if (stripLeadingSpaces)
+            while (!result.empty() && std::isspace(static_cast<unsigned char>(result.front())))
+                result.remove_prefix(1);
+        return result;
+    }
+
+    [[nodiscard]] bool wrapped() const noexcept { return (flags & LineFlag::Wrapped).any(); }
+};
+
 /**
  * Line<Cell> API.
  *
- * TODO: Use custom allocator for ensuring cache locality of Cells to sibling lines.
+ * The cells of an inflated line are allocated from the line's cell resource,
+ * which the owning Grid points to its slab allocator so that the cells of sibling lines
+ * stay close to each other in memory.
+ * Like the std::pmr containers, a line keeps its cell resource when being assigned to,
+ * and a copy constructed line uses the default resource.
+ *
  * TODO: Make the line optimization work.
  */
 template <typename Cell>
@@ -85,10 +314,20 @@ class Line
 {
   public:
     Line() = default;
-    Line(Line const&) = default;
+    Line(Line const& other): _storage { other._storage }, _flags { other._flags } {}
     Line(Line&&) noexcept = default;
-    Line& operator=(Line const&) = default;
-    Line& operator=(Line&&) noexcept = default;
+    Line& operator=(Line const& other)
+    {
+        _storage = other._storage;
+        _flags = other._flags;
+        return *this;
+    }
+    Line& operator=(Line&& other) noexcept
+    {
+        _storage = std::move(other._storage);
+        _flags = other._flags;
+        return *this;
+    }
 
     using TrivialBuffer = TrivialLineBuffer;
     using InflatedBuffer = InflatedLineBuffer<Cell>;
@@ -98,9 +337,25 @@ class Line
     using reverse_iterator = typename InflatedBuffer::reverse_iterator;
     using const_iterator = typename InflatedBuffer::const_iterator;
 
-    Line(LineFlags flags, TrivialBuffer buffer): _storage { std::move(buffer) }, _flags { flags } {}
+    Line(LineFlags flags,
+         TrivialBuffer buffer,
+         std::pmr::memory_resource* cellResource = std::pmr::get_default_resource()):
+        _storage { std::move(buffer) }, _flags { flags }, _cellResource { cellResource }
+    {
+    }
+
+    Line(LineFlags flags, InflatedBuffer buffer):
+        _storage { std::move(buffer) },
+        _flags { flags },
+        _cellResource { std::get<InflatedBuffer>(_storage).get_allocator().resource() }
+    {
+    }
 
-    Line(LineFlags flags, InflatedBuffer buffer): _storage { std::move(buffer) }, _flags { flags } {}
+    /// Sets the memory resource to allocate the cells from when this line gets inflated.
+    ///
+    /// An already inflated buffer keeps its own allocation.
+    void setCellResource(std::pmr::memory_resource* cellResource) noexcept { _cellResource = cellResource; }
+    [[nodiscard]] std::pmr::memory_resource* cellResource() const noexcept { return _cellResource; }
 
     void reset(LineFlags flags, GraphicsAttributes attributes) noexcept
     {
@@ -173,6 +428,42 @@ class Line
             (i++)->reset();
     }
 
+    /// Fills the @p count columns starting at @p start with the given character.
+    ///
+    /// The cell is constructed once and then copied into the range, which the standard library
+    /// turns into a plain memory fill for trivially copyable cell types.
+    void fillRange(ColumnOffset start,
+                   ColumnCount count,
+                   GraphicsAttributes const& attributes,
+                   char32_t codepoint,
+                   uint8_t width);
+
+    /// Resets the @p count columns starting at @p start to empty cells using the given attributes.
+    void eraseRange(ColumnOffset start, ColumnCount count, GraphicsAttributes const& attributes);
+
+    /// Copies @p count cells of @p source, starting at @p sourceStart, into this line at @p targetStart.
+    ///
+    /// The source may be this line itself, with both ranges overlapping.
+    void copyRange(Line const& source, ColumnOffset sourceStart, ColumnCount count, ColumnOffset targetStart);
+
+    /// Inserts @p count blank cells at @p start, shifting the cells up to @p rightMargin to the right.
+    ///
+    /// Cells shifted beyond @p rightMargin are discarded. A trivial line is only inflated if
+    /// it actually has text to be shifted.
+    void insertCells(ColumnOffset start,
+                     ColumnOffset rightMargin,
+                     ColumnCount count,
+                     GraphicsAttributes const& attributes);
+
+    /// Deletes @p count cells at @p start, shifting the cells up to @p rightMargin to the left
+    /// and filling the vacated cells on the right with blanks.
+    ///
+    /// A trivial line is only inflated if text follows the deleted cells.
+    void deleteCells(ColumnOffset start,
+                     ColumnOffset rightMargin,
+                     ColumnCount count,
+                     GraphicsAttributes const& attributes);
+
     [[nodiscard]] ColumnCount size() const noexcept
     {
         if (isTrivialBuffer())
@@ -211,22 +502,49 @@ class Line
         {
             Require(ColumnOffset(0) <= column);
             Require(column < ColumnOffset::cast_from(size()));
-            return unbox<size_t>(column) >= trivialBuffer().text.size()
-                   || trivialBuffer().text[column.as<size_t>()] == 0x20;
+            auto const text = trivialBuffer().textAt(column);
+            return text.empty() || text == " ";
         }
         return inflatedBuffer().at(unbox<size_t>(column)).empty();
     }
 
+    /// @returns the first codepoint of the cell at the given column (or 0 if it holds none),
+    ///          along with the number of codepoints it holds, without inflating a trivial line.
+    [[nodiscard]] std::pair<char32_t, size_t> leadingCodepointAt(ColumnOffset column) const noexcept
+    {
+        if (!isTrivialBuffer())
+        {
+            auto const& cell = inflatedBuffer().at(unbox<size_t>(column));
+            auto const count = cell.codepointCount();
+            return { count != 0 ? cell.codepoint(0) : char32_t { 0 }, count };
+        }
+
+        auto const text = trivialBuffer().textAt(column);
+        if (text.empty())
+            return { 0, 0 };
+
+        // Decodes the first UTF-8 sequence, and counts the ones following it by their leading bytes.
+        auto const isContinuationByte = [](char ch) {
+            return (static_cast<uint8_t>(ch) & 0xC0) == 0x80;
+        };
+        auto const lead = static_cast<uint8_t>(text.front());
+        auto const length = lead < 0x80 ? size_t { 1 } : lead < 0xE0 ? size_t { 2 } : lead < 0xF0 ? 3 : 4;
+        auto codepoint = static_cast<char32_t>(length == 1 ? lead : lead & (0x7Fu >> length));
+        for (size_t i = 1; i < length && i < text.size(); ++i)
+            codepoint = (codepoint << 6) | (static_cast<uint8_t>(text[i]) & 0x3Fu);
+        auto const continuationBytes = std::count_if(text.begin(), text.end(), isContinuationByte);
+        auto const count = text.size() - static_cast<size_t>(continuationBytes);
+        return { codepoint, count };
+    }
+
     [[nodiscard]] uint8_t cellWidthAt(ColumnOffset column) const noexcept
     {
-#if 0 // TODO: This optimization - but only when we return actual widths and not always 1.
         if (isTrivialBuffer())
         {
             Require(ColumnOffset(0) <= column);
             Require(column < ColumnOffset::cast_from(size()));
-            return 1; // TODO: When trivial line is to support Unicode, this should be adapted here.
+            return trivialBuffer().widthAt(column);
         }
-#endif
         return inflatedBuffer().at(unbox<size_t>(column)).width();
     }
 
@@ -275,6 +593,9 @@ class Line
     [[nodiscard]] std::string toUtf8Trimmed() const;
     [[nodiscard]] std::string toUtf8Trimmed(bool stripLeadingSpaces, bool stripTrailingSpaces) const;
 
+    /// Takes a snapshot of this line's text, without inflating it.
+    [[nodiscard]] LineTextSnapshot textSnapshot() const;
+
     // Returns a reference to this mutable grid-line buffer.
     //
     // If this line has been stored in an optimized state, then
@@ -282,6 +603,32 @@ class Line
     [[nodiscard]] InflatedBuffer& inflatedBuffer();
     [[nodiscard]] InflatedBuffer const& inflatedBuffer() const;
 
+    // Packs this line's cells back into a TrivialBuffer, if they can be represented as such.
+    //
+    // @p storeText is invoked with the line's UTF-8 text and returns a fragment holding a copy of it,
+    // or std::nullopt if it cannot store the text.
+    //
+    // @returns whether or not this line is stored as TrivialBuffer now.
+    template <typename StoreText>
+    bool deflate(StoreText const& storeText)
+    {
+        if (isTrivialBuffer())
+            return true;
+
+        auto text = std::string {};
+        auto buffer = vtbackend::deflate<Cell>(std::get<InflatedBuffer>(_storage), text);
+        if (!buffer)
+            return false;
+
+        auto fragment = std::optional<crispy::BufferFragment<char>> { storeText(std::string_view(text)) };
+        if (!fragment)
+            return false;
+
+        buffer->text = std::move(*fragment);
+        _storage = std::move(*buffer);
+        return true;
+    }
+
     [[nodiscard]] TrivialBuffer& trivialBuffer() noexcept { return std::get<TrivialBuffer>(_storage); }
     [[nodiscard]] TrivialBuffer const& trivialBuffer() const noexcept
     {
@@ -303,15 +650,9 @@ class Line
         {
             auto const u8Text = unicode::convert_to<char>(text);
             TrivialBuffer const& buffer = trivialBuffer();
-            if (!buffer.usedColumns)
+            if (buffer.textAt(startColumn).empty())
                 return false;
-            auto const column = std::min(startColumn, boxed_cast<ColumnOffset>(buffer.usedColumns - 1));
-            if (text.size() > static_cast<size_t>(column.value - buffer.usedColumns.value))
-                return false;
-            auto const resultIndex = buffer.text.view()
-                                         .substr(unbox<size_t>(column))
-                                         .find(std::string_view(u8Text), unbox<size_t>(column));
-            return resultIndex == 0;
+            return buffer.text.view().substr(buffer.byteOffsetAt(startColumn)).starts_with(u8Text);
         }
         else
         {
@@ -345,9 +686,10 @@ class Line
             if (!buffer.usedColumns)
                 return std::nullopt;
             auto const column = std::min(startColumn, boxed_cast<ColumnOffset>(buffer.usedColumns - 1));
-            auto const resultIndex = buffer.text.view().find(std::string_view(u8Text), unbox<size_t>(column));
+            auto const resultIndex =
+                buffer.text.view().find(std::string_view(u8Text), buffer.byteOffsetAt(column));
             if (resultIndex != std::string_view::npos)
-                return SearchResult { ColumnOffset::cast_from(resultIndex) };
+                return SearchResult { buffer.columnAt(resultIndex) };
             else
                 return std::nullopt; // Not found, so stay with initial column as result.
         }
@@ -391,9 +733,9 @@ class Line
                 return std::nullopt;
             auto const column = std::min(startColumn, boxed_cast<ColumnOffset>(buffer.usedColumns - 1));
             auto const resultIndex =
-                buffer.text.view().rfind(std::string_view(u8Text), unbox<size_t>(column));
+                buffer.text.view().rfind(std::string_view(u8Text), buffer.byteOffsetAt(column));
             if (resultIndex != std::string_view::npos)
-                return SearchResult { ColumnOffset::cast_from(resultIndex) };
+                return SearchResult { buffer.columnAt(resultIndex) };
             else
                 return std::nullopt; // Not found, so stay with initial column as result.
         }
@@ -426,13 +768,14 @@ class Line
   private:
     Storage _storage;
     LineFlags _flags;
+    std::pmr::memory_resource* _cellResource = std::pmr::get_default_resource();
 };
 
 template <typename Cell>
 inline typename Line<Cell>::InflatedBuffer& Line<Cell>::inflatedBuffer()
 {
     if (auto trivialbuffer = std::get_if<TrivialBuffer>(&_storage))
-        _storage = inflate<Cell>(*trivialbuffer);
+        _storage = inflate<Cell>(*trivialbuffer, _cellResource);
     return std::get<InflatedBuffer>(_storage);
 }
 
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/Line.h>
+#include <vtbackend/cell/CompactCell.h>
+#include <vtbackend/cell/SimpleCell.h>
+
+#include <crispy/BufferObject.h>
+
+#include <fmt/format.h>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_template_test_macros.hpp>
+
+#include <array>
+#include <string>
+
+using namespace vtbackend;
+
+TEMPLATE_TEST_CASE("Line.inflate", "[!benchmark][Line]", SimpleCell, CompactCell)
+{
+    for (auto const columns: std::array { ColumnCount(80), ColumnCount(200) })
+    {
+        auto const text = std::string(unbox<size_t>(columns), 'x');
+        auto pool = crispy::buffer_object_pool<char>(text.size());
+        auto bufferObject = pool.allocateBufferObject();
+        bufferObject->writeAtEnd(text);
+
+        auto sgr = GraphicsAttributes {};
+        sgr.foregroundColor = Color::Indexed(IndexedColor::Yellow);
+        auto const fragment = bufferObject->ref(0, text.size());
+        auto const trivial = TrivialLineBuffer { columns, sgr, sgr, HyperlinkId {}, columns, fragment };
+
+        BENCHMARK(fmt::format("{} columns", columns))
+        {
+            return inflate<TestType>(trivial);
+        };
+    }
+}
@@ -215,3 +215,196 @@ TEST_CASE("Line.inflate.Unicode.FamilyEmoji", "[Line]")
     REQUIRE(cell.backgroundColor() == fillSGR.backgroundColor);
     REQUIRE(cell.underlineColor() == fillSGR.underlineColor);
 }
+
+TEST_CASE("Line.trivial.Unicode.columnOffsets", "[Line]")
+{
+    auto constexpr DisplayWidth = ColumnCount(8);
+    auto constexpr UsedColumnCount = ColumnCount(7);
+    auto const testTextUtf8 = unicode::convert_to<char>(U"│ ✅aéb"sv);
+
+    auto pool = buffer_object_pool<char>(32);
+    auto bufferObject = pool.allocateBufferObject();
+    bufferObject->writeAtEnd(testTextUtf8);
+    auto const bufferFragment = bufferObject->ref(0, testTextUtf8.size());
+
+    auto columnOffsets = TrivialLineBuffer::computeColumnOffsets(testTextUtf8, UsedColumnCount);
+    REQUIRE(columnOffsets.has_value());
+    CHECK(*columnOffsets == std::vector<uint16_t> { 0, 3, 4, 4, 7, 8, 10 });
+    CHECK(!TrivialLineBuffer::computeColumnOffsets(testTextUtf8, UsedColumnCount + 1).has_value());
+    CHECK(TrivialLineBuffer::computeColumnOffsets("abc", ColumnCount(3)).value().empty());
+
+    auto const sgr = GraphicsAttributes {};
+    auto const line = Line<Cell>(
+        LineFlag::None,
+        TrivialLineBuffer {
+            DisplayWidth, sgr, sgr, HyperlinkId {}, UsedColumnCount, bufferFragment, std::move(*columnOffsets) });
+
+    CHECK(line.cellWidthAt(ColumnOffset(0)) == 1);
+    CHECK(line.cellWidthAt(ColumnOffset(2)) == 2);
+    CHECK(line.cellWidthAt(ColumnOffset(3)) == 1);
+    CHECK(!line.cellEmptyAt(ColumnOffset(0)));
+    CHECK(line.cellEmptyAt(ColumnOffset(1)));
+    CHECK(line.cellEmptyAt(ColumnOffset(3))); // wide character continuation
+    CHECK(!line.cellEmptyAt(ColumnOffset(6)));
+    CHECK(line.cellEmptyAt(ColumnOffset(7)));
+    CHECK(line.trivialBuffer().textAt(ColumnOffset(5)) == "é");
+
+    using CodepointAndCount = std::pair<char32_t, size_t>;
+    CHECK(line.leadingCodepointAt(ColumnOffset(0)) == CodepointAndCount { U'│', 1 });
+    CHECK(line.leadingCodepointAt(ColumnOffset(1)) == CodepointAndCount { U' ', 1 });
+    CHECK(line.leadingCodepointAt(ColumnOffset(2)) == CodepointAndCount { U'✅', 1 });
+    CHECK(line.leadingCodepointAt(ColumnOffset(3)) == CodepointAndCount { 0, 0 });
+    CHECK(line.leadingCodepointAt(ColumnOffset(5)) == CodepointAndCount { U'é', 1 });
+    CHECK(line.leadingCodepointAt(ColumnOffset(7)) == CodepointAndCount { 0, 0 });
+
+    CHECK(line.search(U"éb", ColumnOffset(0)).value().column == ColumnOffset(5));
+    CHECK(line.searchReverse(U"a", ColumnOffset(7)).value().column == ColumnOffset(4));
+    CHECK(line.matchTextAt(U"✅a", ColumnOffset(2)));
+    CHECK(!line.matchTextAt(U"a", ColumnOffset(3)));
+
+    // The line must have stayed trivial for all of the above.
+    CHECK(line.isTrivialBuffer());
+
+    auto const inflated = inflate<Cell>(line.trivialBuffer());
+    CHECK(inflated.size() == unbox<size_t>(DisplayWidth));
+    CHECK(inflated[2].width() == 2);
+    CHECK(inflated[5].toUtf8() == "é");
+}
+
+TEST_CASE("Line.trivial.spans", "[Line]")
+{
+    auto constexpr DisplayWidth = ColumnCount(8);
+    auto constexpr TestText = "abcdef"sv;
+
+    auto pool = buffer_object_pool<char>(32);
+    auto bufferObject = pool.allocateBufferObject();
+    bufferObject->writeAtEnd(TestText);
+    auto const bufferFragment = bufferObject->ref(0, TestText.size());
+
+    auto const sgr = GraphicsAttributes {};
+    auto red = GraphicsAttributes {};
+    red.foregroundColor = Color::Indexed(IndexedColor::Red);
+    auto bold = GraphicsAttributes {};
+    bold.flags |= CellFlag::Bold;
+
+    auto trivial = TrivialLineBuffer { DisplayWidth, sgr, sgr, HyperlinkId {}, ColumnCount(6), bufferFragment };
+    trivial.spans.emplace_back(TrivialLineSpan { ColumnOffset(2), red, HyperlinkId(1) });
+    trivial.spans.emplace_back(TrivialLineSpan { ColumnOffset(4), bold });
+
+    CHECK(trivial.attributesAt(ColumnOffset(1)) == sgr);
+    CHECK(trivial.attributesAt(ColumnOffset(2)) == red);
+    CHECK(trivial.attributesAt(ColumnOffset(3)) == red);
+    CHECK(trivial.attributesAt(ColumnOffset(5)) == bold);
+    CHECK(trivial.hyperlinkAt(ColumnOffset(3)) == HyperlinkId(1));
+    CHECK(trivial.hyperlinkAt(ColumnOffset(4)) == HyperlinkId {});
+    CHECK(trivial.textFlags().contains(CellFlag::Bold));
+
+    auto runs = std::vector<std::pair<ColumnOffset, std::string>> {};
+    trivial.forEachRun([&](ColumnOffset start, std::string_view text, GraphicsAttributes const&, HyperlinkId) {
+        runs.emplace_back(start, std::string(text));
+    });
+    REQUIRE(runs.size() == 3);
+    CHECK(runs[0] == std::pair { ColumnOffset(0), "ab"s });
+    CHECK(runs[1] == std::pair { ColumnOffset(2), "cd"s });
+    CHECK(runs[2] == std::pair { ColumnOffset(4), "ef"s });
+
+    auto const inflated = inflate<Cell>(trivial);
+    REQUIRE(inflated.size() == unbox<size_t>(DisplayWidth));
+    CHECK(inflated[1].foregroundColor() == sgr.foregroundColor);
+    CHECK(inflated[2].foregroundColor() == red.foregroundColor);
+    CHECK(inflated[3].hyperlink() == HyperlinkId(1));
+    CHECK(inflated[4].isFlagEnabled(CellFlag::Bold));
+    CHECK(!inflated[6].isFlagEnabled(CellFlag::Bold));
+    for (size_t i = 0; i < TestText.size(); ++i)
+    {
+        CHECK(inflated[i].codepoint(0) == static_cast<char32_t>(TestText[i]));
+        CHECK(inflated[i].width() == 1);
+    }
+    CHECK(inflated[6].empty());
+    CHECK(inflated[7].empty());
+}
+
+TEST_CASE("Line.ranges", "[Line]")
+{
+    auto constexpr DisplayWidth = ColumnCount(6);
+    auto bold = GraphicsAttributes {};
+    bold.flags = CellFlag::Bold;
+
+    auto line = Line<Cell>(LineFlag::None, TrivialLineBuffer { DisplayWidth, GraphicsAttributes {} });
+    line.fill(ColumnOffset(0), GraphicsAttributes {}, "abcdef");
+
+    line.fillRange(ColumnOffset(1), ColumnCount(2), bold, U'x', 1);
+    CHECK(line.toUtf8() == "axxdef");
+    CHECK(line.inflatedBuffer()[2].isFlagEnabled(CellFlag::Bold));
+    CHECK(!line.inflatedBuffer()[3].isFlagEnabled(CellFlag::Bold));
+
+    // Overlapping copies within the same line, in both directions.
+    line.copyRange(line, ColumnOffset(0), ColumnCount(3), ColumnOffset(2));
+    CHECK(line.toUtf8() == "axaxxf");
+    line.copyRange(line, ColumnOffset(2), ColumnCount(4), ColumnOffset(0));
+    CHECK(line.toUtf8() == "axxfxf");
+    CHECK(line.inflatedBuffer()[1].isFlagEnabled(CellFlag::Bold));
+    CHECK(!line.inflatedBuffer()[3].isFlagEnabled(CellFlag::Bold));
+
+    auto other = Line<Cell>(LineFlag::None, TrivialLineBuffer { DisplayWidth, GraphicsAttributes {} });
+    other.copyRange(line, ColumnOffset(0), ColumnCount(2), ColumnOffset(4));
+    CHECK(other.toUtf8() == "    ax");
+
+    line.eraseRange(ColumnOffset(1), ColumnCount(2), GraphicsAttributes {});
+    CHECK(line.toUtf8() == "a  fxf");
+    CHECK(!line.inflatedBuffer()[1].isFlagEnabled(CellFlag::Bold));
+
+    line.eraseRange(ColumnOffset(0), DisplayWidth, GraphicsAttributes {});
+    CHECK(line.isTrivialBuffer());
+    CHECK(line.toUtf8() == "      ");
+}
+
+TEST_CASE("Line.insertCells_deleteCells", "[Line]")
+{
+    auto constexpr DisplayWidth = ColumnCount(6);
+    auto constexpr RightMargin = ColumnOffset(4);
+
+    auto line = Line<Cell>(LineFlag::None, TrivialLineBuffer { DisplayWidth, GraphicsAttributes {} });
+    line.fill(ColumnOffset(0), GraphicsAttributes {}, "abcdef");
+
+    line.insertCells(ColumnOffset(1), RightMargin, ColumnCount(2), GraphicsAttributes {});
+    CHECK(line.toUtf8() == "a  bcf");
+
+    line.deleteCells(ColumnOffset(0), RightMargin, ColumnCount(2), GraphicsAttributes {});
+    CHECK(line.toUtf8() == " bc  f");
+
+    // The number of cells is limited by the right margin.
+    line.deleteCells(ColumnOffset(2), RightMargin, ColumnCount(10), GraphicsAttributes {});
+    CHECK(line.toUtf8() == " b   f");
+}
+
+TEST_CASE("Line.insertCells_deleteCells.trivial", "[Line]")
+{
+    auto constexpr DisplayWidth = ColumnCount(10);
+    auto constexpr RightMargin = ColumnOffset(9);
+    auto text = "abcdef"sv;
+    auto pool = buffer_object_pool<char>(32);
+    auto bufferObject = pool.allocateBufferObject();
+    bufferObject->writeAtEnd(text);
+
+    auto const sgr = GraphicsAttributes {};
+    auto const trivial =
+        TrivialLineBuffer { DisplayWidth, sgr, sgr, HyperlinkId {}, ColumnCount(6), bufferObject->ref(0, 6) };
+    auto line = Line<Cell>(LineFlag::None, trivial);
+
+    // Shifting blank cells only.
+    line.insertCells(ColumnOffset(7), RightMargin, ColumnCount(2), sgr);
+    line.deleteCells(ColumnOffset(6), RightMargin, ColumnCount(1), sgr);
+    CHECK(line.isTrivialBuffer());
+    CHECK(line.toUtf8() == "abcdef    ");
+
+    // Deleting the end of the text.
+    line.deleteCells(ColumnOffset(4), RightMargin, ColumnCount(3), sgr);
+    CHECK(line.isTrivialBuffer());
+    CHECK(line.toUtf8() == "abcd      ");
+
+    // Text following the deleted cells needs to be moved.
+    line.deleteCells(ColumnOffset(1), RightMargin, ColumnCount(1), sgr);
+    CHECK(line.isInflatedBuffer());
+    CHECK(line.toUtf8() == "acd       ");
+}
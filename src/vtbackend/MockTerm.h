@@ -69,10 +69,14 @@ class MockTerm: public Terminal::NullEvents
     void writeToScreen(std::u32string_view text) { writeToScreen(unicode::convert_to<char>(text)); }
 
     std::string windowTitle;
+    std::string clipboardData;
+    size_t inputFlushesScheduled = 0;
     Terminal terminal;
 
     // Events overrides
     void setWindowTitle(std::string_view title) override { windowTitle = title; }
+    void copyToClipboard(std::string_view data) override { clipboardData = data; }
+    void scheduleInputFlush() override { ++inputFlushesScheduled; }
 
     static vtbackend::Settings createSettings(PageSize pageSize,
                                               LineCount maxHistoryLineCount,
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/PredictiveEcho.h>
+
+#include <algorithm>
+
+namespace vtbackend
+{
+
+std::optional<CellLocation> PredictiveEcho::nextPosition(CellLocation cursor) const noexcept
+{
+    if (_awaitingOutput || _awaitingLineEntered)
+        return std::nullopt;
+    if (_predictions.empty())
+        return cursor;
+    auto const& last = _predictions.back().position;
+    return CellLocation { last.line, last.column + 1 };
+}
+
+void PredictiveEcho::predict(char32_t codepoint, CellLocation position, clock::time_point now)
+{
+    _predictions.emplace_back(Prediction { codepoint, position, now });
+}
+
+void PredictiveEcho::inputSent(bool lineEntered) noexcept
+{
+    _awaitingOutput = true;
+    if (lineEntered)
+        _awaitingLineEntered = false;
+}
+
+bool PredictiveEcho::expire(clock::time_point now) noexcept
+{
+    if (_predictions.empty() || now - _predictions.front().time < ConfirmationTimeout)
+        return false;
+
+    rollback();
+    _awaitingLineEntered = true;
+    return true;
+}
+
+void PredictiveEcho::rollback() noexcept
+{
+    _predictions.clear();
+}
+
+std::optional<PredictiveEcho::clock::time_point> PredictiveEcho::expiry() const noexcept
+{
+    if (_predictions.empty())
+        return std::nullopt;
+    return _predictions.front().time + ConfirmationTimeout;
+}
+
+PredictiveEcho::Prediction const* PredictiveEcho::predictionAt(CellLocation position) const noexcept
+{
+    auto const i = std::find_if(_predictions.begin(), _predictions.end(), [&](Prediction const& prediction) {
+        return prediction.position == position;
+    });
+    return i != _predictions.end() ? &*i : nullptr;
+}
+
+} // namespace vtbackend
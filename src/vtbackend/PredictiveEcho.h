@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <vtbackend/primitives.h>
+
+#include <chrono>
+#include <deque>
+#include <optional>
+
+namespace vtbackend
+{
+
+/**
+ * Predicts the echo of printable characters typed, such that they can be shown right away
+ * on high-latency connections, before the application has echoed them.
+ *
+ * Predictions are made at the cursor, and only while no other input than predicted characters
+ * is awaiting its effect. Each time output has been parsed, the predictions are reconciled with
+ * the screen: once the cursor has passed a prediction's cell, the prediction has been confirmed
+ * if the cell shows the predicted character, and otherwise all predictions are rolled back.
+ *
+ * Predictions are rolled back as well when not confirmed in time, e.g. at a password prompt
+ * with echo turned off. No further predictions are made then until the next line is entered.
+ *
+ * The positions are grid coordinates of the main page.
+ */
+class PredictiveEcho
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /// Predictions not confirmed within this time are rolled back.
+    static constexpr auto ConfirmationTimeout = std::chrono::seconds(1);
+
+    struct Prediction
+    {
+        char32_t codepoint;
+        CellLocation position;
+        clock::time_point time;
+    };
+
+    /// @returns the position to predict the next character at, given the cursor position,
+    ///          or std::nullopt if no prediction can be made right now.
+    [[nodiscard]] std::optional<CellLocation> nextPosition(CellLocation cursor) const noexcept;
+
+    /// Predicts @p codepoint to be echoed at @p position, as returned by nextPosition().
+    void predict(char32_t codepoint, CellLocation position, clock::time_point now);
+
+    /// Informs about input having been sent that could not be predicted, e.g. cursor movements.
+    ///
+    /// The current predictions are kept, but no further ones are made until output has arrived.
+    void inputSent(bool lineEntered) noexcept;
+
+    /// Reconciles the predictions with the screen after output has been parsed.
+    ///
+    /// @param codepointAt  returns the leading codepoint of the cell at the given position, 0 if empty
+    ///
+    /// @returns whether or not any prediction has been confirmed or rolled back.
+    template <typename CodepointAt>
+    bool reconcile(CodepointAt const& codepointAt, CellLocation cursor);
+
+    /// Rolls back the predictions not confirmed in time.
+    ///
+    /// @returns whether or not any prediction has been rolled back.
+    bool expire(clock::time_point now) noexcept;
+
+    /// Rolls back all predictions, e.g. because the alternate screen has been entered.
+    void rollback() noexcept;
+
+    /// @returns the time the oldest prediction is rolled back at, or std::nullopt without predictions.
+    [[nodiscard]] std::optional<clock::time_point> expiry() const noexcept;
+
+    /// @returns whether there is neither a prediction nor other input awaiting its effect.
+    [[nodiscard]] bool idle() const noexcept { return _predictions.empty() && !_awaitingOutput; }
+
+    [[nodiscard]] std::deque<Prediction> const& predictions() const noexcept { return _predictions; }
+
+    /// @returns the prediction at the given position, if any.
+    [[nodiscard]] Prediction const* predictionAt(CellLocation position) const noexcept;
+
+  private:
+    std::deque<Prediction> _predictions;
+    bool _awaitingOutput = false;      // other input has been sent, of which the effect is unknown
+    bool _awaitingLineEntered = false; // predictions have not been confirmed in time
+};
+
+template <typename CodepointAt>
+bool PredictiveEcho::reconcile(CodepointAt const& codepointAt, CellLocation cursor)
+{
+    auto changed = false;
+    while (!_predictions.empty())
+    {
+        auto const& prediction = _predictions.front();
+        auto const codepoint = codepointAt(prediction.position);
+        auto const cursorPassed =
+            cursor.line != prediction.position.line || cursor.column > prediction.position.column;
+        if (!cursorPassed)
+            break; // Not written yet, though the cell may show something else meanwhile (e.g. a suggestion).
+        if (codepoint != prediction.codepoint && !(prediction.codepoint == U' ' && codepoint == 0))
+        {
+            rollback();
+            _awaitingLineEntered = true;
+            return true;
+        }
+        _predictions.pop_front();
+        changed = true;
+    }
+
+    if (_predictions.empty())
+        _awaitingOutput = false;
+    return changed;
+}
+
+} // namespace vtbackend
@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/PredictiveEcho.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+using namespace std::chrono_literals;
+using vtbackend::CellLocation;
+using vtbackend::ColumnOffset;
+using vtbackend::LineOffset;
+using vtbackend::PredictiveEcho;
+
+namespace
+{
+
+auto const start = PredictiveEcho::clock::time_point {} + 1h;
+
+auto at(int column)
+{
+    return CellLocation { LineOffset(0), ColumnOffset(column) };
+}
+
+// Simulates the screen showing the given text at the beginning of the top line.
+struct Screen
+{
+    std::u32string text;
+
+    char32_t operator()(CellLocation position) const
+    {
+        auto const column = static_cast<size_t>(*position.column);
+        return position.line == LineOffset(0) && column < text.size() ? text[column] : 0;
+    }
+
+    [[nodiscard]] CellLocation cursor() const { return at(static_cast<int>(text.size())); }
+};
+
+void type(PredictiveEcho& echo, Screen const& screen, std::u32string_view text)
+{
+    for (auto const ch: text)
+    {
+        auto const position = echo.nextPosition(screen.cursor());
+        REQUIRE(position.has_value());
+        echo.predict(ch, *position, start);
+    }
+}
+
+} // namespace
+
+TEST_CASE("PredictiveEcho.confirm", "[PredictiveEcho]")
+{
+    auto echo = PredictiveEcho {};
+    auto screen = Screen { U"$ " };
+    type(echo, screen, U"ls");
+    CHECK(echo.predictions().size() == 2);
+    CHECK(echo.predictionAt(at(3))->codepoint == U's');
+
+    // The echo arrives one character at a time.
+    screen.text = U"$ l";
+    CHECK(echo.reconcile(screen, screen.cursor()));
+    REQUIRE(echo.predictions().size() == 1);
+    CHECK(echo.predictions().front().position == at(3));
+
+    CHECK(!echo.reconcile(screen, screen.cursor()));
+
+    screen.text = U"$ ls";
+    CHECK(echo.reconcile(screen, screen.cursor()));
+    CHECK(echo.predictions().empty());
+    CHECK(echo.nextPosition(screen.cursor()) == at(4));
+}
+
+TEST_CASE("PredictiveEcho.mismatch", "[PredictiveEcho]")
+{
+    auto echo = PredictiveEcho {};
+    auto screen = Screen { U"$ " };
+    type(echo, screen, U"ab");
+
+    // Cells not written yet may show something else, e.g. a suggestion of the shell.
+    CHECK(!echo.reconcile([](CellLocation) { return U'x'; }, screen.cursor()));
+    CHECK(echo.predictions().size() == 2);
+
+    screen.text = U"$ A";
+    CHECK(echo.reconcile(screen, screen.cursor()));
+    CHECK(echo.predictions().empty());
+
+    // No more predictions until the next line is entered.
+    CHECK(!echo.nextPosition(screen.cursor()).has_value());
+    echo.inputSent(true);
+    CHECK(!echo.nextPosition(screen.cursor()).has_value());
+    screen.text = U"$ ";
+    (void) echo.reconcile(screen, screen.cursor());
+    CHECK(echo.nextPosition(screen.cursor()) == at(2));
+}
+
+TEST_CASE("PredictiveEcho.otherInput", "[PredictiveEcho]")
+{
+    auto echo = PredictiveEcho {};
+    auto screen = Screen { U"$ " };
+    echo.inputSent(false);
+    CHECK(!echo.nextPosition(screen.cursor()).has_value());
+
+    // The effect of the other input is known once output has arrived.
+    (void) echo.reconcile(screen, screen.cursor());
+    CHECK(echo.nextPosition(screen.cursor()) == at(2));
+}
+
+TEST_CASE("PredictiveEcho.expire", "[PredictiveEcho]")
+{
+    auto echo = PredictiveEcho {};
+    auto screen = Screen { U"Password: " };
+    type(echo, screen, U"secret");
+    CHECK(echo.expiry() == start + PredictiveEcho::ConfirmationTimeout);
+
+    CHECK(!echo.expire(start + PredictiveEcho::ConfirmationTimeout - 1ms));
+    CHECK(echo.predictions().size() == 6);
+
+    CHECK(echo.expire(start + PredictiveEcho::ConfirmationTimeout));
+    CHECK(echo.predictions().empty());
+    CHECK(!echo.expiry().has_value());
+    CHECK(!echo.nextPosition(screen.cursor()).has_value());
+}
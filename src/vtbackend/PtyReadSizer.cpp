@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/PtyReadSizer.h>
+
+#include <algorithm>
+
+namespace vtbackend
+{
+
+PtyReadSizer::PtyReadSizer(size_t minSize, size_t maxSize) noexcept:
+    _minSize { minSize }, _maxSize { std::max(minSize, maxSize) }, _readSize { minSize }
+{
+}
+
+bool PtyReadSizer::bytesRead(size_t bytes, clock::time_point now) noexcept
+{
+    auto const previousSize = _readSize;
+
+    // After a pause in the output, the next output is most likely a reaction to user input.
+    if (now - _lastRead >= IdleInterval)
+    {
+        _readSize = _minSize;
+        _sampleStart = now;
+        _sampleBytes = 0;
+    }
+    _lastRead = now;
+
+    _sampleBytes += bytes;
+    auto const elapsed = now - _sampleStart;
+    if (elapsed < SampleInterval)
+        return _readSize != previousSize;
+
+    _bytesPerSecond =
+        static_cast<size_t>(static_cast<double>(_sampleBytes) / std::chrono::duration<double>(elapsed).count());
+
+    // Grows while more than two reads worth of output arrives per sample interval,
+    // and shrinks while less than a quarter of a read does.
+    if (_sampleBytes >= 2 * _readSize)
+        _readSize = std::min(2 * _readSize, _maxSize);
+    else if (_sampleBytes < _readSize / 4)
+        _readSize = std::max(_readSize / 2, _minSize);
+
+    _sampleStart = now;
+    _sampleBytes = 0;
+    return _readSize != previousSize;
+}
+
+} // namespace vtbackend
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace vtbackend
+{
+
+/**
+ * Adapts the number of bytes to request per PTY read to the observed output rate.
+ *
+ * Reads are small while the session is interactive, so that a single read never fills a huge
+ * parse batch, delaying the echo of the next key press. During sustained output, the read size
+ * grows geometrically, reducing the number of reads (and parse batches) per byte of output,
+ * and shrinks back the same way once the output calms down, or right away after it stopped.
+ *
+ * All methods must be called from the thread reading from the PTY.
+ */
+class PtyReadSizer
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /// Interval the output rate is measured over.
+    static constexpr auto SampleInterval = std::chrono::milliseconds(16);
+
+    /// Without any output for this long, the session is considered interactive again.
+    static constexpr auto IdleInterval = std::chrono::milliseconds(100);
+
+    PtyReadSizer(size_t minSize, size_t maxSize) noexcept;
+
+    [[nodiscard]] size_t readSize() const noexcept { return _readSize; }
+    [[nodiscard]] size_t minSize() const noexcept { return _minSize; }
+    [[nodiscard]] size_t maxSize() const noexcept { return _maxSize; }
+
+    /// @returns the number of bytes per second measured over the last completed sample interval.
+    [[nodiscard]] size_t bytesPerSecond() const noexcept { return _bytesPerSecond; }
+
+    /// Informs about @p bytes having been read at @p now.
+    ///
+    /// @returns true if the read size has been adapted.
+    bool bytesRead(size_t bytes, clock::time_point now) noexcept;
+
+  private:
+    size_t _minSize;
+    size_t _maxSize;
+    size_t _readSize;
+    size_t _bytesPerSecond = 0;
+    clock::time_point _sampleStart {};
+    clock::time_point _lastRead {};
+    size_t _sampleBytes = 0;
+};
+
+} // namespace vtbackend
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/PtyReadSizer.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+
+using namespace std::chrono_literals;
+using vtbackend::PtyReadSizer;
+
+namespace
+{
+
+auto const start = PtyReadSizer::clock::time_point {} + 1h;
+
+} // namespace
+
+TEST_CASE("PtyReadSizer.interactive", "[PtyReadSizer]")
+{
+    auto sizer = PtyReadSizer { 4096, 65536 };
+    CHECK(sizer.readSize() == 4096);
+
+    // Key echoes now and then keep the read size at its minimum.
+    for (auto t = 0ms; t < 2s; t += 50ms)
+        CHECK(!sizer.bytesRead(3, start + t));
+    CHECK(sizer.readSize() == 4096);
+}
+
+TEST_CASE("PtyReadSizer.sustained", "[PtyReadSizer]")
+{
+    auto sizer = PtyReadSizer { 4096, 65536 };
+
+    // Sustained output grows the read size geometrically, up to its maximum.
+    auto t = 0ms;
+    auto adaptations = 0;
+    for (; t < 200ms; t += 1ms)
+        adaptations += sizer.bytesRead(sizer.readSize(), start + t) ? 1 : 0;
+    CHECK(sizer.readSize() == 65536);
+    CHECK(adaptations == 4);
+    CHECK(sizer.bytesPerSecond() > 0);
+
+    // Slowing output shrinks it back step by step, once the sample still containing the burst completed.
+    sizer.bytesRead(100, start + t + 20ms);
+    CHECK(sizer.readSize() == 65536);
+    sizer.bytesRead(100, start + t + 40ms);
+    CHECK(sizer.readSize() == 32768);
+    sizer.bytesRead(100, start + t + 60ms);
+    CHECK(sizer.readSize() == 16384);
+
+    // A pause in the output resets it right away.
+    CHECK(sizer.bytesRead(100, start + t + 1s));
+    CHECK(sizer.readSize() == 4096);
+}
+
+TEST_CASE("PtyReadSizer.bounds", "[PtyReadSizer]")
+{
+    // A maximum below the minimum degenerates to a fixed read size.
+    auto sizer = PtyReadSizer { 4096, 1024 };
+    CHECK(sizer.maxSize() == 4096);
+    for (auto t = 0ms; t < 100ms; t += 1ms)
+        CHECK(!sizer.bytesRead(4096, start + t));
+    CHECK(sizer.readSize() == 4096);
+}
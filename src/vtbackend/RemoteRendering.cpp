@@ -0,0 +1,662 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/RemoteRendering.h>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace vtbackend
+{
+
+namespace
+{
+    constexpr uint64_t HashBasis = 14695981039346656037llu; // of 64-bit FNV-1a
+    constexpr uint64_t HashPrime = 1099511628211llu;
+
+    // Bits of the flags byte of a cell, the upper four bits holding its width.
+    constexpr uint8_t GroupStartBit = 0x01;
+    constexpr uint8_t GroupEndBit = 0x02;
+    constexpr uint8_t SameAttributesBit = 0x04; // as the cell before, thus omitted
+    constexpr uint8_t ImageBit = 0x08;
+
+    void putVarint(std::string& output, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        output.push_back(static_cast<char>(value));
+    }
+
+    void putSigned(std::string& output, int64_t value)
+    {
+        putVarint(output, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void putByte(std::string& output, uint8_t value)
+    {
+        output.push_back(static_cast<char>(value));
+    }
+
+    void putColor(std::string& output, RGBColor color)
+    {
+        putByte(output, color.red);
+        putByte(output, color.green);
+        putByte(output, color.blue);
+    }
+
+    void putAttributes(std::string& output, RenderAttributes const& attributes)
+    {
+        putColor(output, attributes.foregroundColor);
+        putColor(output, attributes.backgroundColor);
+        putColor(output, attributes.decorationColor);
+        putVarint(output, attributes.flags.value());
+    }
+
+    bool operator==(RenderAttributes const& a, RenderAttributes const& b) noexcept
+    {
+        return a.foregroundColor == b.foregroundColor && a.backgroundColor == b.backgroundColor
+               && a.decorationColor == b.decorationColor && a.flags == b.flags;
+    }
+
+    // Reads the values of a payload, failing once any of them exceeds it.
+    class PayloadReader
+    {
+      public:
+        explicit PayloadReader(std::string_view data): _data { data } {}
+
+        [[nodiscard]] bool failed() const noexcept { return _failed; }
+        [[nodiscard]] bool atEnd() const noexcept { return _data.empty(); }
+
+        uint64_t varint()
+        {
+            auto value = uint64_t { 0 };
+            for (auto shift = 0; shift < 64; shift += 7)
+            {
+                if (_data.empty())
+                    break;
+                auto const byte = static_cast<uint8_t>(_data.front());
+                _data.remove_prefix(1);
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                    return value;
+            }
+            _failed = true;
+            return 0;
+        }
+
+        int64_t signedVarint()
+        {
+            auto const value = varint();
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+
+        // Reads a varint that is to fit into T, such as a count or a size.
+        template <typename T>
+        T bounded()
+        {
+            auto const value = varint();
+            if (value > static_cast<uint64_t>(std::numeric_limits<T>::max()))
+            {
+                _failed = true;
+                return {};
+            }
+            return static_cast<T>(value);
+        }
+
+        int signedInt()
+        {
+            auto const value = signedVarint();
+            if (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max())
+            {
+                _failed = true;
+                return 0;
+            }
+            return static_cast<int>(value);
+        }
+
+        uint8_t byte()
+        {
+            if (_data.empty())
+            {
+                _failed = true;
+                return 0;
+            }
+            auto const value = static_cast<uint8_t>(_data.front());
+            _data.remove_prefix(1);
+            return value;
+        }
+
+        std::string_view bytes(size_t count)
+        {
+            if (count > _data.size())
+            {
+                _failed = true;
+                _data = {};
+                return {};
+            }
+            auto const value = _data.substr(0, count);
+            _data.remove_prefix(count);
+            return value;
+        }
+
+        RGBColor color()
+        {
+            auto const red = byte();
+            auto const green = byte();
+            auto const blue = byte();
+            return RGBColor { red, green, blue };
+        }
+
+        RenderAttributes attributes()
+        {
+            auto result = RenderAttributes {};
+            result.foregroundColor = color();
+            result.backgroundColor = color();
+            result.decorationColor = color();
+            result.flags = CellFlags::from_value(bounded<CellFlags::value_type>());
+            return result;
+        }
+
+      private:
+        std::string_view _data;
+        bool _failed = false;
+    };
+
+    uint64_t hashImage(Image const& image)
+    {
+        auto hash = HashBasis;
+        for (auto const byte: image.data())
+            hash = (hash ^ byte) * HashPrime;
+        auto const format = static_cast<unsigned>(image.format());
+        for (auto const value: { format, unbox(image.width()), unbox(image.height()) })
+            hash = (hash ^ value) * HashPrime;
+        return hash;
+    }
+} // namespace
+
+// {{{ framing
+void appendRemoteMessage(std::string& output, RemoteMessage type, std::string_view payload)
+{
+    putByte(output, static_cast<uint8_t>(type));
+    putVarint(output, payload.size());
+    output.append(payload);
+}
+
+std::string encodeRemoteFrameAck(uint64_t frameID)
+{
+    auto payload = std::string {};
+    putVarint(payload, frameID);
+    return payload;
+}
+
+std::optional<uint64_t> decodeRemoteFrameAck(std::string_view payload)
+{
+    auto reader = PayloadReader { payload };
+    auto const frameID = reader.varint();
+    if (reader.failed() || !reader.atEnd())
+        return std::nullopt;
+    return frameID;
+}
+
+std::string encodeRemoteResize(PageSize pageSize)
+{
+    auto payload = std::string {};
+    putVarint(payload, unbox<uint64_t>(pageSize.lines));
+    putVarint(payload, unbox<uint64_t>(pageSize.columns));
+    return payload;
+}
+
+std::optional<PageSize> decodeRemoteResize(std::string_view payload)
+{
+    auto reader = PayloadReader { payload };
+    auto const lines = reader.bounded<int>();
+    auto const columns = reader.bounded<int>();
+    if (reader.failed() || !reader.atEnd() || lines == 0 || columns == 0)
+        return std::nullopt;
+    return PageSize { LineCount(lines), ColumnCount(columns) };
+}
+
+void RemoteMessageReader::feed(std::string_view data)
+{
+    if (_offset != 0)
+    {
+        _buffer.erase(0, _offset);
+        _offset = 0;
+    }
+    _buffer.append(data);
+}
+
+std::optional<RemoteMessageReader::Message> RemoteMessageReader::next()
+{
+    auto const pending = std::string_view(_buffer).substr(_offset);
+    if (pending.empty())
+        return std::nullopt;
+
+    auto size = uint64_t { 0 };
+    auto headerSize = size_t { 1 };
+    for (auto shift = 0;; shift += 7, ++headerSize)
+    {
+        if (headerSize >= pending.size() || shift >= 64)
+            return std::nullopt;
+        auto const byte = static_cast<uint8_t>(pending[headerSize]);
+        size |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            break;
+    }
+    ++headerSize;
+
+    if (size > pending.size() - headerSize)
+        return std::nullopt;
+
+    _offset += headerSize + size;
+    return Message { .type = static_cast<RemoteMessage>(pending[0]),
+                     .payload = pending.substr(headerSize, size) };
+}
+// }}}
+
+// {{{ RemoteFrameEncoder
+void RemoteFrameEncoder::encode(RenderBuffer const& frame, std::string& output)
+{
+    auto const outputSize = output.size();
+
+    for (auto& [offset, indices]: _screenLines)
+    {
+        indices.first.clear();
+        indices.second.clear();
+    }
+    for (size_t i = 0; i < frame.cells.size(); ++i)
+        _screenLines[unbox(frame.cells[i].position.line)].first.push_back(i);
+    for (size_t i = 0; i < frame.lines.size(); ++i)
+        _screenLines[unbox(frame.lines[i].lineOffset)].second.push_back(i);
+
+    _changedLines.clear();
+    _removedLines.clear();
+    auto changedCount = size_t { 0 };
+    for (auto const& [offset, indices]: _screenLines)
+    {
+        if (indices.first.empty() && indices.second.empty())
+        {
+            if (_sentLines.erase(offset))
+                _removedLines.push_back(offset);
+            continue;
+        }
+
+        _linePayload.clear();
+        encodeLine(frame, indices.first, indices.second, _linePayload, output);
+
+        auto& sent = _sentLines[offset];
+        if (sent == _linePayload)
+        {
+            ++_stats.linesUnchanged;
+            continue;
+        }
+
+        sent = _linePayload;
+        putSigned(_changedLines, offset);
+        putVarint(_changedLines, _linePayload.size());
+        _changedLines.append(_linePayload);
+        ++changedCount;
+        ++_stats.linesSent;
+    }
+
+    _framePayload.clear();
+    putVarint(_framePayload, frame.frameID);
+    putByte(_framePayload, frame.cursor ? 1 : 0);
+    if (frame.cursor)
+    {
+        putSigned(_framePayload, unbox(frame.cursor->position.line));
+        putSigned(_framePayload, unbox(frame.cursor->position.column));
+        putByte(_framePayload, static_cast<uint8_t>(frame.cursor->shape));
+        putVarint(_framePayload, static_cast<uint64_t>(frame.cursor->width));
+    }
+    putVarint(_framePayload, changedCount);
+    _framePayload.append(_changedLines);
+    putVarint(_framePayload, _removedLines.size());
+    for (auto const offset: _removedLines)
+        putSigned(_framePayload, offset);
+
+    appendRemoteMessage(output, RemoteMessage::Frame, _framePayload);
+
+    ++_stats.frames;
+    _stats.bytes += output.size() - outputSize;
+}
+
+void RemoteFrameEncoder::encodeLine(RenderBuffer const& frame,
+                                    std::vector<size_t> const& cells,
+                                    std::vector<size_t> const& lines,
+                                    std::string& payload,
+                                    std::string& output)
+{
+    putVarint(payload, cells.size());
+    RenderAttributes const* previousAttributes = nullptr;
+    for (auto const index: cells)
+    {
+        auto const& cell = frame.cells[index];
+        auto const* image = frame.imageOf(cell);
+        auto const sameAttributes = previousAttributes && *previousAttributes == cell.attributes;
+
+        auto bits = static_cast<uint8_t>(std::min<uint8_t>(cell.width, 15) << 4);
+        if (cell.groupStart)
+            bits |= GroupStartBit;
+        if (cell.groupEnd)
+            bits |= GroupEndBit;
+        if (sameAttributes)
+            bits |= SameAttributesBit;
+        if (image)
+            bits |= ImageBit;
+
+        putSigned(payload, unbox(cell.position.column));
+        putByte(payload, bits);
+        putVarint(payload, cell.codepointCount);
+        for (auto const codepoint: frame.codepointsOf(cell))
+            putVarint(payload, codepoint);
+        if (!sameAttributes)
+            putAttributes(payload, cell.attributes);
+        if (image)
+            encodeImage(*image, payload, output);
+
+        previousAttributes = &cell.attributes;
+    }
+
+    putVarint(payload, lines.size());
+    for (auto const index: lines)
+    {
+        auto const& line = frame.lines[index];
+        putVarint(payload, line.text.size());
+        payload.append(line.text);
+        putVarint(payload, unbox<uint64_t>(line.usedColumns));
+        putVarint(payload, unbox<uint64_t>(line.displayWidth));
+        putAttributes(payload, line.textAttributes);
+        putAttributes(payload, line.fillAttributes);
+    }
+}
+
+void RemoteFrameEncoder::encodeImage(ImageFragment const& fragment, std::string& payload, std::string& output)
+{
+    auto const& rasterized = fragment.rasterizedImage();
+    auto const& image = rasterized.image();
+
+    auto hashIter = _imageHashes.find(unbox(image.id()));
+    if (hashIter == _imageHashes.end())
+    {
+        if (_imageHashes.size() >= ImageCacheCapacity)
+            _imageHashes.clear();
+        hashIter = _imageHashes.emplace(unbox(image.id()), hashImage(image)).first;
+    }
+    auto const hash = hashIter->second;
+
+    if (!_sentImages.contains(hash))
+    {
+        if (_sentImages.size() >= ImageCacheCapacity)
+        {
+            // The client keeps the images of the lines it shows, but forgets how to refer to them.
+            appendRemoteMessage(output, RemoteMessage::ForgetImages, {});
+            _sentImages.clear();
+        }
+
+        auto imagePayload = std::string {};
+        putVarint(imagePayload, hash);
+        putByte(imagePayload, static_cast<uint8_t>(image.format()));
+        putVarint(imagePayload, unbox<uint64_t>(image.width()));
+        putVarint(imagePayload, unbox<uint64_t>(image.height()));
+        putVarint(imagePayload, image.data().size());
+        imagePayload.append(reinterpret_cast<char const*>(image.data().data()), image.data().size());
+        appendRemoteMessage(output, RemoteMessage::Image, imagePayload);
+
+        _sentImages.insert(hash);
+        ++_stats.imagesSent;
+    }
+
+    putVarint(payload, hash);
+    putByte(payload, static_cast<uint8_t>(rasterized.alignmentPolicy()));
+    putByte(payload, static_cast<uint8_t>(rasterized.resizePolicy()));
+    putVarint(payload, rasterized.defaultColor().value);
+    putVarint(payload, unbox<uint64_t>(rasterized.cellSpan().lines));
+    putVarint(payload, unbox<uint64_t>(rasterized.cellSpan().columns));
+    putVarint(payload, unbox<uint64_t>(rasterized.cellSize().width));
+    putVarint(payload, unbox<uint64_t>(rasterized.cellSize().height));
+    putSigned(payload, unbox(fragment.offset().line));
+    putSigned(payload, unbox(fragment.offset().column));
+}
+
+void RemoteFrameEncoder::reset()
+{
+    _sentLines.clear();
+    _sentImages.clear();
+}
+// }}}
+
+// {{{ RemoteFrameDecoder
+bool RemoteFrameDecoder::apply(RemoteMessageReader::Message const& message)
+{
+    switch (message.type)
+    {
+        case RemoteMessage::Frame: return applyFrame(message.payload);
+        case RemoteMessage::Image: return applyImage(message.payload);
+        case RemoteMessage::ForgetImages: _images.clear(); return true;
+        case RemoteMessage::FrameAck:
+        case RemoteMessage::Input:
+        case RemoteMessage::Resize: break;
+    }
+    return false;
+}
+
+bool RemoteFrameDecoder::applyImage(std::string_view payload)
+{
+    auto reader = PayloadReader { payload };
+    auto const hash = reader.varint();
+    auto const format = reader.byte();
+    auto const width = reader.bounded<unsigned>();
+    auto const height = reader.bounded<unsigned>();
+    auto const data = reader.bytes(reader.bounded<size_t>());
+    if (reader.failed() || !reader.atEnd() || format > static_cast<uint8_t>(ImageFormat::RGBA))
+        return false;
+
+    auto const size = ImageSize { Width(width), Height(height) };
+    auto const bytesPerPixel = format == static_cast<uint8_t>(ImageFormat::RGBA) ? 4 : 3;
+    if (data.size() != size.area() * bytesPerPixel)
+        return false;
+
+    _images[hash] = std::make_shared<Image>(ImageId(_nextImageId++),
+                                            static_cast<ImageFormat>(format),
+                                            Image::Data(data.begin(), data.end()),
+                                            size,
+                                            [](Image const*) {});
+    return true;
+}
+
+bool RemoteFrameDecoder::applyFrame(std::string_view payload)
+{
+    auto reader = PayloadReader { payload };
+    auto const frameID = reader.varint();
+
+    auto cursor = std::optional<RenderCursor> {};
+    if (reader.byte())
+    {
+        auto& value = cursor.emplace();
+        value.position.line = LineOffset(reader.signedInt());
+        value.position.column = ColumnOffset(reader.signedInt());
+        auto const shape = reader.byte();
+        if (shape > static_cast<uint8_t>(CursorShape::Bar))
+            return false;
+        value.shape = static_cast<CursorShape>(shape);
+        value.width = reader.bounded<int>();
+    }
+
+    auto changedLines = std::vector<std::pair<int, Line>> {};
+    auto const changedCount = reader.bounded<size_t>();
+    for (size_t i = 0; i < changedCount && !reader.failed(); ++i)
+    {
+        auto const offset = reader.signedInt();
+        auto lineReader = PayloadReader { reader.bytes(reader.bounded<size_t>()) };
+        auto& line = changedLines.emplace_back(offset, Line {}).second;
+
+        auto rasterized = std::shared_ptr<RasterizedImage const> {};
+        auto const cellCount = lineReader.bounded<size_t>();
+        for (size_t k = 0; k < cellCount && !lineReader.failed(); ++k)
+        {
+            auto cell = RenderCell {};
+            cell.position.line = LineOffset(offset);
+            cell.position.column = ColumnOffset(lineReader.signedInt());
+            auto const bits = lineReader.byte();
+            cell.width = static_cast<uint8_t>(bits >> 4);
+            cell.groupStart = bits & GroupStartBit;
+            cell.groupEnd = bits & GroupEndBit;
+
+            cell.codepointsOffset = static_cast<uint32_t>(line.codepoints.size());
+            cell.codepointCount = lineReader.bounded<uint32_t>();
+            for (uint32_t n = 0; n < cell.codepointCount && !lineReader.failed(); ++n)
+                line.codepoints.push_back(lineReader.bounded<char32_t>());
+
+            if (!(bits & SameAttributesBit))
+                cell.attributes = lineReader.attributes();
+            else if (!line.cells.empty())
+                cell.attributes = line.cells.back().attributes;
+            else
+                return false;
+
+            if (bits & ImageBit)
+            {
+                auto const hash = lineReader.varint();
+                auto const alignment = static_cast<ImageAlignment>(lineReader.byte());
+                auto const resize = static_cast<ImageResize>(lineReader.byte());
+                auto const defaultColor = RGBAColor { lineReader.bounded<uint32_t>() };
+                auto const spanLines = LineCount(lineReader.bounded<int>());
+                auto const spanColumns = ColumnCount(lineReader.bounded<int>());
+                auto const cellWidth = Width(lineReader.bounded<unsigned>());
+                auto const cellHeight = Height(lineReader.bounded<unsigned>());
+                auto const fragmentLine = LineOffset(lineReader.signedInt());
+                auto const fragmentColumn = ColumnOffset(lineReader.signedInt());
+
+                auto const image = _images.find(hash);
+                if (image == _images.end())
+                    return false;
+
+                auto const cellSpan = GridSize { .lines = spanLines, .columns = spanColumns };
+                auto const cellSize = ImageSize { cellWidth, cellHeight };
+
+                // Consecutive cells mostly show fragments of the same rasterized image.
+                if (!rasterized || rasterized->imagePointer() != image->second
+                    || rasterized->alignmentPolicy() != alignment || rasterized->resizePolicy() != resize
+                    || rasterized->defaultColor().value != defaultColor.value
+                    || rasterized->cellSpan().lines != cellSpan.lines
+                    || rasterized->cellSpan().columns != cellSpan.columns
+                    || !(rasterized->cellSize() == cellSize))
+                    rasterized = std::make_shared<RasterizedImage>(
+                        image->second, alignment, resize, defaultColor, cellSpan, cellSize);
+
+                cell.imageIndex = static_cast<uint32_t>(line.images.size());
+                line.images.emplace_back(std::make_shared<ImageFragment>(
+                    rasterized, CellLocation { .line = fragmentLine, .column = fragmentColumn }));
+            }
+
+            line.cells.push_back(cell);
+        }
+
+        auto const lineCount = lineReader.bounded<size_t>();
+        for (size_t k = 0; k < lineCount && !lineReader.failed(); ++k)
+        {
+            auto const text = lineReader.bytes(lineReader.bounded<size_t>());
+            line.text.append(text);
+
+            auto& renderLine = line.lines.emplace_back();
+            renderLine.text = text; // refers to the payload until the line is stored
+            renderLine.lineOffset = LineOffset(offset);
+            renderLine.usedColumns = ColumnCount(lineReader.bounded<int>());
+            renderLine.displayWidth = ColumnCount(lineReader.bounded<int>());
+            renderLine.textAttributes = lineReader.attributes();
+            renderLine.fillAttributes = lineReader.attributes();
+        }
+
+        if (lineReader.failed() || !lineReader.atEnd())
+            return false;
+    }
+
+    auto removedLines = std::vector<int> {};
+    auto const removedCount = reader.bounded<size_t>();
+    for (size_t i = 0; i < removedCount && !reader.failed(); ++i)
+        removedLines.push_back(reader.signedInt());
+
+    if (reader.failed() || !reader.atEnd())
+        return false;
+
+    for (auto& [offset, line]: changedLines)
+    {
+        // Only now that the line is stored, its text no longer moves (as short strings do).
+        auto& stored = _lines[offset] = std::move(line);
+        auto textOffset = size_t { 0 };
+        for (auto& renderLine: stored.lines)
+        {
+            renderLine.text = std::string_view(stored.text).substr(textOffset, renderLine.text.size());
+            textOffset += renderLine.text.size();
+        }
+    }
+    for (auto const offset: removedLines)
+        _lines.erase(offset);
+    _cursor = cursor;
+    _frameID = frameID;
+    return true;
+}
+
+void RemoteFrameDecoder::fill(RenderBuffer& output) const
+{
+    output.clear();
+    for (auto const& [offset, line]: _lines)
+    {
+        for (auto const& decoded: line.cells)
+        {
+            auto& cell = output.cells.emplace_back(decoded);
+            cell.imageIndex = RenderCell::NoImage;
+            output.assignCodepoints(
+                cell, std::u32string_view(line.codepoints.data() + decoded.codepointsOffset,
+                                          decoded.codepointCount));
+            if (decoded.imageIndex != RenderCell::NoImage)
+                output.assignImage(cell, line.images[decoded.imageIndex]);
+        }
+        output.lines.insert(output.lines.end(), line.lines.begin(), line.lines.end());
+    }
+    output.cursor = _cursor;
+    output.frameID = _frameID;
+}
+// }}}
+
+// {{{ RemoteFramePacer
+void RemoteFramePacer::frameSent(uint64_t frameID, clock::time_point now)
+{
+    _inFlight.emplace_back(frameID, now);
+    _lastSent = now;
+}
+
+void RemoteFramePacer::frameAcknowledged(uint64_t frameID, clock::time_point now)
+{
+    // Acknowledgements are cumulative, and the latest frame acknowledged has waited the least.
+    auto const acknowledged = std::find_if(
+        _inFlight.rbegin(), _inFlight.rend(), [frameID](auto const& sent) { return sent.first <= frameID; });
+    if (acknowledged == _inFlight.rend())
+        return;
+
+    auto const sample = now - acknowledged->second;
+    if (_roundTripTime == clock::duration::zero())
+        _roundTripTime = sample;
+    else
+        _roundTripTime = (_roundTripTime * 7 + sample) / 8;
+
+    _inFlight.erase(_inFlight.begin(), acknowledged.base());
+}
+
+std::optional<RemoteFramePacer::clock::time_point> RemoteFramePacer::nextFrameTime() const noexcept
+{
+    if (_inFlight.size() >= MaxFramesInFlight)
+        return std::nullopt;
+    return _lastSent + frameInterval();
+}
+
+RemoteFramePacer::clock::duration RemoteFramePacer::frameInterval() const noexcept
+{
+    return std::clamp<clock::duration>(_roundTripTime / MaxFramesInFlight, MinimumInterval, MaximumInterval);
+}
+// }}}
+
+} // namespace vtbackend
@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <vtbackend/Image.h>
+#include <vtbackend/RenderBuffer.h>
+#include <vtbackend/primitives.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace vtbackend
+{
+
+/**
+ * Messages of the remote rendering protocol.
+ *
+ * With remote rendering, the server runs the terminal (PTY, parser, and grid), and streams its
+ * render buffers to the client, which only renders them. Each render buffer is sent as the difference
+ * to the one sent before, i.e. only the screen lines that changed, along with the cursor.
+ * Images are sent once, and referred to by the hash of their pixels afterwards.
+ *
+ * Messages are framed as a type byte, followed by the size of the payload and the payload.
+ * All integers are LEB128 varints, signed ones zigzag-encoded, unless stated otherwise.
+ */
+enum class RemoteMessage : uint8_t
+{
+    // server to client
+    Frame = 1,        //!< the changed screen lines and the cursor of a render buffer
+    Image = 2,        //!< the pixels of an image, sent before the first frame showing it
+    ForgetImages = 3, //!< all images sent so far are no longer referred to
+
+    // client to server
+    FrameAck = 16, //!< the ID of the last frame received, to measure the round-trip time by
+    Input = 17,    //!< bytes to write to the PTY verbatim, i.e. encoded keyboard and mouse input
+    Resize = 18,   //!< the page size of the client's display
+};
+
+/// Appends a message of @p type with @p payload to @p output.
+void appendRemoteMessage(std::string& output, RemoteMessage type, std::string_view payload);
+
+[[nodiscard]] std::string encodeRemoteFrameAck(uint64_t frameID);
+[[nodiscard]] std::optional<uint64_t> decodeRemoteFrameAck(std::string_view payload);
+
+[[nodiscard]] std::string encodeRemoteResize(PageSize pageSize);
+[[nodiscard]] std::optional<PageSize> decodeRemoteResize(std::string_view payload);
+
+/// Splits the byte stream received from the other end into messages.
+class RemoteMessageReader
+{
+  public:
+    struct Message
+    {
+        RemoteMessage type;
+        std::string_view payload;
+    };
+
+    /// Appends @p data received to what is still to be split into messages.
+    void feed(std::string_view data);
+
+    /// @returns the next complete message, valid until feed() or next() is invoked again,
+    ///          or nothing if the data received so far does not complete it yet.
+    [[nodiscard]] std::optional<Message> next();
+
+  private:
+    std::string _buffer;
+    size_t _offset = 0; // of the first byte not consumed yet
+};
+
+/**
+ * Encodes render buffers into frame messages, each containing only what the client lacks.
+ */
+class RemoteFrameEncoder
+{
+  public:
+    /// Number of distinct images the client is expected to hold at most.
+    static constexpr size_t ImageCacheCapacity = 256;
+
+    struct Stats
+    {
+        uint64_t frames = 0;
+        uint64_t linesSent = 0;      // screen lines sent, as they changed
+        uint64_t linesUnchanged = 0; // screen lines not sent, as the client has them already
+        uint64_t imagesSent = 0;
+        uint64_t bytes = 0; // of all messages encoded
+    };
+
+    /// Appends the messages updating the client to show @p frame to @p output.
+    void encode(RenderBuffer const& frame, std::string& output);
+
+    /// Forgets what has been sent, such that the next frame is sent in full, e.g. to a new client.
+    void reset();
+
+    [[nodiscard]] Stats const& stats() const noexcept { return _stats; }
+
+  private:
+    void encodeLine(RenderBuffer const& frame,
+                    std::vector<size_t> const& cells,
+                    std::vector<size_t> const& lines,
+                    std::string& payload,
+                    std::string& output);
+    void encodeImage(ImageFragment const& fragment, std::string& payload, std::string& output);
+
+    std::map<int, std::string> _sentLines;               // encoded screen lines by line offset
+    std::unordered_map<uint32_t, uint64_t> _imageHashes; // by ImageId, to hash each image once
+    std::unordered_set<uint64_t> _sentImages;            // hashes of the images the client holds
+    Stats _stats;
+
+    // Reused for each frame, such that encoding does not allocate once warmed up.
+    std::map<int, std::pair<std::vector<size_t>, std::vector<size_t>>> _screenLines;
+    std::string _linePayload;
+    std::string _changedLines; // the changed lines of the frame, each prefixed by offset and size
+    std::vector<int> _removedLines;
+    std::string _framePayload;
+};
+
+/**
+ * Decodes the messages of a RemoteFrameEncoder back into render buffers.
+ */
+class RemoteFrameDecoder
+{
+  public:
+    /// Applies a message received from the server.
+    ///
+    /// @retval false the message is malformed or not sent by servers, in which case the connection
+    ///               is to be closed, as the frames decoded may no longer match the server's.
+    bool apply(RemoteMessageReader::Message const& message);
+
+    [[nodiscard]] uint64_t frameID() const noexcept { return _frameID; }
+
+    /// Replaces the contents of @p output with the frame decoded last.
+    ///
+    /// The texts of its lines refer to this decoder, and remain valid until the next apply().
+    void fill(RenderBuffer& output) const;
+
+  private:
+    struct Line
+    {
+        std::vector<RenderCell> cells; // referring to the codepoints and images below
+        std::vector<char32_t> codepoints;
+        std::vector<std::shared_ptr<ImageFragment>> images;
+        std::vector<RenderLine> lines; // referring to the text below
+        std::string text;
+    };
+
+    bool applyFrame(std::string_view payload);
+    bool applyImage(std::string_view payload);
+
+    std::map<int, Line> _lines; // by line offset
+    std::optional<RenderCursor> _cursor;
+    uint64_t _frameID = 0;
+    std::unordered_map<uint64_t, std::shared_ptr<Image const>> _images; // by hash
+    uint32_t _nextImageId = 1;
+};
+
+/**
+ * Paces the frames sent to a remote client by the round-trip time of the connection.
+ *
+ * Sending each frame the terminal produces would queue up frames on slow links, delaying the
+ * most recent one. Instead, at most MaxFramesInFlight frames are sent before the client
+ * acknowledged one, with a frame interval of the (smoothed) round-trip time divided by that.
+ * Everything changing in between is batched into the next frame sent.
+ */
+class RemoteFramePacer
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr size_t MaxFramesInFlight = 2;
+    static constexpr auto MinimumInterval = std::chrono::milliseconds(16);
+    static constexpr auto MaximumInterval = std::chrono::milliseconds(500);
+
+    void frameSent(uint64_t frameID, clock::time_point now);
+
+    /// Informs about the client having received all frames up to @p frameID at @p now.
+    void frameAcknowledged(uint64_t frameID, clock::time_point now);
+
+    /// @returns the earliest time the next frame may be sent,
+    ///          or nothing while waiting for the client to acknowledge a frame.
+    [[nodiscard]] std::optional<clock::time_point> nextFrameTime() const noexcept;
+
+    /// @returns the smoothed round-trip time, or zero if not measured yet.
+    [[nodiscard]] clock::duration roundTripTime() const noexcept { return _roundTripTime; }
+
+    [[nodiscard]] clock::duration frameInterval() const noexcept;
+
+  private:
+    std::vector<std::pair<uint64_t, clock::time_point>> _inFlight; // frame IDs and send times
+    clock::duration _roundTripTime {};
+    clock::time_point _lastSent {};
+};
+
+} // namespace vtbackend
@@ -0,0 +1,284 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/RemoteRendering.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+using namespace std::chrono_literals;
+using namespace std::string_view_literals;
+using namespace vtbackend;
+
+namespace
+{
+
+auto const start = RemoteFramePacer::clock::time_point {} + 1h;
+
+void addText(RenderBuffer& frame, int line, std::u32string_view text)
+{
+    for (auto column = 0; column < static_cast<int>(text.size()); ++column)
+    {
+        auto& cell = frame.cells.emplace_back();
+        cell.position = CellLocation { .line = LineOffset(line), .column = ColumnOffset(column) };
+        cell.attributes.foregroundColor = RGBColor { 0xC0, 0xC0, 0xC0 };
+        cell.groupStart = column == 0;
+        cell.groupEnd = column + 1 == static_cast<int>(text.size());
+        frame.assignCodepoints(cell, text.substr(column, 1));
+    }
+}
+
+// Decodes all messages of @p stream into @p decoder, and returns their types.
+std::string transfer(std::string const& stream, RemoteFrameDecoder& decoder)
+{
+    auto reader = RemoteMessageReader {};
+    reader.feed(stream);
+    auto types = std::string {};
+    while (auto const message = reader.next())
+    {
+        CHECK(decoder.apply(*message));
+        types.push_back(static_cast<char>(message->type));
+    }
+    return types;
+}
+
+std::u32string textOf(RenderBuffer const& frame, int line)
+{
+    auto text = std::u32string {};
+    for (auto const& cell: frame.cells)
+        if (cell.position.line == LineOffset(line))
+            text += frame.codepointsOf(cell);
+    return text;
+}
+
+} // namespace
+
+TEST_CASE("RemoteMessageReader.partial", "[RemoteRendering]")
+{
+    auto stream = std::string {};
+    appendRemoteMessage(stream, RemoteMessage::Input, "ls\r"sv);
+    appendRemoteMessage(
+        stream, RemoteMessage::Resize, encodeRemoteResize(PageSize { LineCount(25), ColumnCount(300) }));
+
+    // Messages only complete once all of their bytes arrived.
+    auto reader = RemoteMessageReader {};
+    for (auto const byte: stream.substr(0, stream.size() - 1))
+    {
+        reader.feed(std::string_view(&byte, 1));
+        if (auto const message = reader.next())
+        {
+            CHECK(message->type == RemoteMessage::Input);
+            CHECK(message->payload == "ls\r"sv);
+        }
+    }
+    CHECK(!reader.next().has_value());
+
+    reader.feed(stream.substr(stream.size() - 1));
+    auto const resize = reader.next();
+    REQUIRE(resize.has_value());
+    CHECK(resize->type == RemoteMessage::Resize);
+    auto const pageSize = decodeRemoteResize(resize->payload);
+    REQUIRE(pageSize.has_value());
+    CHECK(pageSize->lines == LineCount(25));
+    CHECK(pageSize->columns == ColumnCount(300));
+    CHECK(!reader.next().has_value());
+
+    CHECK(decodeRemoteFrameAck(encodeRemoteFrameAck(1234567)) == 1234567);
+    CHECK(!decodeRemoteFrameAck("\x80"sv).has_value());
+}
+
+TEST_CASE("RemoteFrameEncoder.changed_lines_only", "[RemoteRendering]")
+{
+    auto encoder = RemoteFrameEncoder {};
+    auto decoder = RemoteFrameDecoder {};
+    auto decoded = RenderBuffer {};
+
+    auto frame = RenderBuffer {};
+    frame.frameID = 1;
+    addText(frame, 0, U"hello");
+    addText(frame, 1, U"world");
+    frame.lines.push_back(RenderLine { .text = "trivial",
+                                       .lineOffset = LineOffset(2),
+                                       .usedColumns = ColumnCount(7),
+                                       .displayWidth = ColumnCount(80) });
+    frame.cursor =
+        RenderCursor { .position = CellLocation { .line = LineOffset(1), .column = ColumnOffset(5) },
+                       .shape = CursorShape::Bar };
+
+    auto stream = std::string {};
+    encoder.encode(frame, stream);
+    CHECK(encoder.stats().linesSent == 3);
+    CHECK(transfer(stream, decoder) == std::string(1, static_cast<char>(RemoteMessage::Frame)));
+
+    decoder.fill(decoded);
+    CHECK(decoded.frameID == 1);
+    CHECK(textOf(decoded, 0) == U"hello");
+    CHECK(textOf(decoded, 1) == U"world");
+    CHECK(decoded.cells[0].groupStart);
+    CHECK(decoded.cells[4].groupEnd);
+    CHECK(decoded.cells[4].attributes.foregroundColor == RGBColor { 0xC0, 0xC0, 0xC0 });
+    REQUIRE(decoded.lines.size() == 1);
+    CHECK(decoded.lines[0].text == "trivial");
+    CHECK(decoded.lines[0].displayWidth == ColumnCount(80));
+    REQUIRE(decoded.cursor.has_value());
+    CHECK(decoded.cursor->position.column == ColumnOffset(5));
+    CHECK(decoded.cursor->shape == CursorShape::Bar);
+
+    // Only the line changed is sent again, and the trivial line no longer shown is removed.
+    auto const fullSize = stream.size();
+    frame.clear();
+    frame.frameID = 2;
+    addText(frame, 0, U"hello");
+    addText(frame, 1, U"there");
+
+    stream.clear();
+    encoder.encode(frame, stream);
+    CHECK(encoder.stats().linesSent == 4);
+    CHECK(encoder.stats().linesUnchanged == 1);
+    CHECK(stream.size() < fullSize);
+    transfer(stream, decoder);
+
+    decoder.fill(decoded);
+    CHECK(decoded.frameID == 2);
+    CHECK(textOf(decoded, 0) == U"hello");
+    CHECK(textOf(decoded, 1) == U"there");
+    CHECK(decoded.lines.empty());
+    CHECK(!decoded.cursor.has_value());
+
+    // After a reset, a new client gets the full frame.
+    encoder.reset();
+    auto newDecoder = RemoteFrameDecoder {};
+    stream.clear();
+    encoder.encode(frame, stream);
+    transfer(stream, newDecoder);
+    newDecoder.fill(decoded);
+    CHECK(textOf(decoded, 0) == U"hello");
+    CHECK(textOf(decoded, 1) == U"there");
+}
+
+TEST_CASE("RemoteFrameEncoder.images", "[RemoteRendering]")
+{
+    auto const image = std::make_shared<Image>(ImageId(42),
+                                               ImageFormat::RGBA,
+                                               Image::Data(2 * 2 * 4, 0x7F),
+                                               ImageSize { Width(2), Height(2) },
+                                               [](Image const*) {});
+    auto const rasterized = std::make_shared<RasterizedImage>(image,
+                                                              ImageAlignment::MiddleCenter,
+                                                              ImageResize::ResizeToFit,
+                                                              RGBAColor {},
+                                                              GridSize { LineCount(1), ColumnCount(2) },
+                                                              ImageSize { Width(1), Height(2) });
+
+    auto frame = RenderBuffer {};
+    frame.frameID = 1;
+    for (auto line = 0; line < 2; ++line)
+    {
+        for (auto column = 0; column < 2; ++column)
+        {
+            auto& cell = frame.cells.emplace_back();
+            cell.position = CellLocation { .line = LineOffset(line), .column = ColumnOffset(column) };
+            frame.assignImage(cell,
+                              std::make_shared<ImageFragment>(
+                                  rasterized, CellLocation { .line = {}, .column = ColumnOffset(column) }));
+        }
+    }
+
+    auto encoder = RemoteFrameEncoder {};
+    auto decoder = RemoteFrameDecoder {};
+    auto stream = std::string {};
+    encoder.encode(frame, stream);
+
+    // The pixels are sent once, ahead of the frame referring to them.
+    auto const expectedTypes =
+        std::string { static_cast<char>(RemoteMessage::Image), static_cast<char>(RemoteMessage::Frame) };
+    CHECK(transfer(stream, decoder) == expectedTypes);
+    CHECK(encoder.stats().imagesSent == 1);
+
+    auto decoded = RenderBuffer {};
+    decoder.fill(decoded);
+    REQUIRE(decoded.cells.size() == 4);
+    auto const* fragment = decoded.imageOf(decoded.cells[3]);
+    REQUIRE(fragment != nullptr);
+    CHECK(fragment->offset().column == ColumnOffset(1));
+    CHECK(fragment->rasterizedImage().cellSize() == ImageSize { Width(1), Height(2) });
+    CHECK(fragment->rasterizedImage().image().data() == image->data());
+
+    // Changed lines showing the same image refer to it by its hash only.
+    frame.frameID = 2;
+    frame.cells[0].attributes.flags = CellFlag::Bold;
+    stream.clear();
+    encoder.encode(frame, stream);
+    CHECK(transfer(stream, decoder) == std::string(1, static_cast<char>(RemoteMessage::Frame)));
+    CHECK(encoder.stats().imagesSent == 1);
+}
+
+TEST_CASE("RemoteFrameDecoder.malformed", "[RemoteRendering]")
+{
+    auto decoder = RemoteFrameDecoder {};
+    CHECK(!decoder.apply({ .type = RemoteMessage::Frame, .payload = "\x01\x00\x01"sv }));
+    CHECK(!decoder.apply({ .type = RemoteMessage::Input, .payload = "x"sv }));
+
+    // A frame referring to an image never sent.
+    auto frame = RenderBuffer {};
+    auto const image = std::make_shared<Image>(ImageId(1),
+                                               ImageFormat::RGB,
+                                               Image::Data(3, 0),
+                                               ImageSize { Width(1), Height(1) },
+                                               [](Image const*) {});
+    auto const rasterized = std::make_shared<RasterizedImage>(image,
+                                                              ImageAlignment::MiddleCenter,
+                                                              ImageResize::ResizeToFit,
+                                                              RGBAColor {},
+                                                              GridSize { LineCount(1), ColumnCount(1) },
+                                                              ImageSize { Width(1), Height(1) });
+    auto& cell = frame.cells.emplace_back();
+    frame.assignImage(cell, std::make_shared<ImageFragment>(rasterized, CellLocation {}));
+
+    auto stream = std::string {};
+    RemoteFrameEncoder {}.encode(frame, stream);
+    auto reader = RemoteMessageReader {};
+    reader.feed(stream);
+    REQUIRE(reader.next()->type == RemoteMessage::Image);
+    auto const frameMessage = reader.next();
+    REQUIRE(frameMessage.has_value());
+    CHECK(!decoder.apply(*frameMessage));
+    CHECK(decoder.frameID() == 0);
+}
+
+TEST_CASE("RemoteFramePacer.round_trip_time", "[RemoteRendering]")
+{
+    auto pacer = RemoteFramePacer {};
+    CHECK(pacer.nextFrameTime() <= start);
+
+    // Without acknowledgements, at most two frames are in flight.
+    pacer.frameSent(1, start);
+    REQUIRE(pacer.nextFrameTime().has_value());
+    CHECK(*pacer.nextFrameTime() == start + RemoteFramePacer::MinimumInterval);
+    pacer.frameSent(2, start + 20ms);
+    CHECK(!pacer.nextFrameTime().has_value());
+
+    // Acknowledgements are cumulative.
+    pacer.frameAcknowledged(2, start + 220ms);
+    CHECK(pacer.roundTripTime() == 200ms);
+    CHECK(pacer.frameInterval() == 100ms);
+    CHECK(pacer.nextFrameTime() == start + 120ms);
+
+    // The round-trip time is smoothed.
+    pacer.frameSent(3, start + 300ms);
+    pacer.frameAcknowledged(3, start + 340ms);
+    CHECK(pacer.roundTripTime() == 180ms);
+
+    // Acknowledgements of frames no longer in flight are ignored.
+    pacer.frameAcknowledged(3, start + 900ms);
+    CHECK(pacer.roundTripTime() == 180ms);
+
+    // Fast links are paced to the minimum interval.
+    for (uint64_t i = 4; i < 40; ++i)
+    {
+        pacer.frameSent(i, start + 1s);
+        pacer.frameAcknowledged(i, start + 1s + 1ms);
+    }
+    CHECK(pacer.frameInterval() == RemoteFramePacer::MinimumInterval);
+}
@@ -3,30 +3,52 @@
 
 #include <fmt/format.h>
 
-#include <mutex>
+#include <iterator>
 
 namespace vtbackend
 {
 
-bool RenderDoubleBuffer::swapBuffers(std::chrono::steady_clock::time_point now) noexcept
+void RenderBuffer::append(RenderBuffer& other)
 {
-    // If the terminal thread (writer) cannot try_lock (w/o wait time)
-    // the front buffer, it'll just flush back buffer instead of swapping
-    // buffers as the front buffer is apparently still in use by the
-    // renderer thread and we want to avoid render-thread imposed
-    // wait times in the terminal thread as much as possible.
+    auto const codepointsOffset = static_cast<uint32_t>(codepoints.size());
+    auto const imagesOffset = static_cast<uint32_t>(images.size());
 
-    if (!readerLock.try_lock())
-        return false;
+    cells.reserve(cells.size() + other.cells.size());
+    for (auto cell: other.cells)
+    {
+        cell.codepointsOffset += codepointsOffset;
+        if (cell.imageIndex != RenderCell::NoImage)
+            cell.imageIndex += imagesOffset;
+        cells.emplace_back(cell);
+    }
 
-    auto const _ = std::lock_guard<decltype(readerLock)>(readerLock, std::adopt_lock);
+    lines.insert(lines.end(), other.lines.begin(), other.lines.end());
+    codepoints.insert(codepoints.end(), other.codepoints.begin(), other.codepoints.end());
+    images.insert(images.end(),
+                  std::make_move_iterator(other.images.begin()),
+                  std::make_move_iterator(other.images.end()));
+}
 
-    for (;;)
+RenderBufferRef RenderTripleBuffer::frontBuffer() const noexcept
+{
+    // Only take over the published buffer if it holds a frame not acquired yet,
+    // otherwise the reader would go back to an older frame.
+    if (publishedBufferIndex.load(std::memory_order_relaxed) & FreshFrame)
     {
-        auto current = currentBackBufferIndex.load();
-        if (currentBackBufferIndex.compare_exchange_weak(current, (current + 1) % 2))
-            break;
+        auto const published = publishedBufferIndex.exchange(frontBufferIndex.load(std::memory_order_relaxed),
+                                                             std::memory_order_acq_rel);
+        frontBufferIndex.store(static_cast<uint8_t>(published & ~FreshFrame), std::memory_order_relaxed);
     }
+    return RenderBufferRef(buffers[frontBufferIndex.load(std::memory_order_relaxed)]);
+}
+
+bool RenderTripleBuffer::swapBuffers(std::chrono::steady_clock::time_point now) noexcept
+{
+    // The buffer received in exchange is either the reader's former front buffer, or a frame
+    // published before that the reader skipped. Either way, the reader is done with it.
+    auto const published = static_cast<uint8_t>(backBufferIndex.load(std::memory_order_relaxed) | FreshFrame);
+    auto const free = publishedBufferIndex.exchange(published, std::memory_order_acq_rel);
+    backBufferIndex.store(static_cast<uint8_t>(free & ~FreshFrame), std::memory_order_relaxed);
 
     lastUpdate = now;
     state = RenderBufferState::WaitingForRefresh;
@@ -4,6 +4,7 @@
 #include <vtbackend/CellFlags.h>
 #include <vtbackend/Color.h>
 #include <vtbackend/Grid.h>
+#include <vtbackend/Hyperlink.h>
 #include <vtbackend/Image.h>
 #include <vtbackend/primitives.h>
 
@@ -11,10 +12,14 @@
 
 #include <gsl/pointers>
 
+#include <array>
 #include <atomic>
 #include <chrono>
-#include <mutex>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <optional>
+#include <string_view>
 #include <vector>
 
 namespace vtbackend
@@ -31,11 +36,20 @@ struct RenderAttributes
 /**
  * Renderable representation of a grid cell with color-altering pre-applied and
  * additional information for cell ranges that can be text-shaped together.
+ *
+ * The codepoints and the image fragment of a cell are held by the RenderBuffer containing it,
+ * such that filling a frame does not allocate per cell.
+ *
+ * @see RenderBuffer::codepointsOf()
+ * @see RenderBuffer::imageOf()
  */
 struct RenderCell
 {
-    std::u32string codepoints;
-    std::shared_ptr<ImageFragment> image;
+    static constexpr uint32_t NoImage = std::numeric_limits<uint32_t>::max();
+
+    uint32_t codepointsOffset = 0; // index of the first codepoint within RenderBuffer::codepoints
+    uint32_t codepointCount = 0;
+    uint32_t imageIndex = NoImage; // index within RenderBuffer::images
     CellLocation position;
     RenderAttributes attributes;
     uint8_t width = 1;
@@ -57,6 +71,28 @@ struct RenderLine
     RenderAttributes fillAttributes;
 };
 
+/**
+ * Locates where a single screen line starts within the cells and lines of a RenderBuffer.
+ *
+ * A screen line spans all cells and lines up to where the next screen line starts.
+ */
+struct RenderedLineLocation
+{
+    size_t firstCell = 0;
+    size_t firstLine = 0;
+};
+
+/**
+ * A run of consecutive cells of a screen line that have been rendered with the same hyperlink.
+ */
+struct RenderedHyperlinkSpan
+{
+    HyperlinkId hyperlink {};
+    LineOffset line {};
+    ColumnOffset first {};
+    ColumnOffset last {};
+};
+
 struct RenderCursor
 {
     CellLocation position;
@@ -71,30 +107,64 @@ struct RenderBuffer
     std::optional<RenderCursor> cursor {};
     uint64_t frameID {};
 
+    std::vector<char32_t> codepoints {};                    // codepoints of all cells, back to back
+    std::vector<std::shared_ptr<ImageFragment>> images {}; // image fragments of all cells showing one
+
+    [[nodiscard]] std::u32string_view codepointsOf(RenderCell const& cell) const noexcept
+    {
+        return { codepoints.data() + cell.codepointsOffset, cell.codepointCount };
+    }
+
+    [[nodiscard]] ImageFragment const* imageOf(RenderCell const& cell) const noexcept
+    {
+        return cell.imageIndex != RenderCell::NoImage ? images[cell.imageIndex].get() : nullptr;
+    }
+
+    /// Appends @p text to the codepoints of this buffer and makes @p cell refer to it.
+    void assignCodepoints(RenderCell& cell, std::u32string_view text)
+    {
+        cell.codepointsOffset = static_cast<uint32_t>(codepoints.size());
+        cell.codepointCount = static_cast<uint32_t>(text.size());
+        codepoints.insert(codepoints.end(), text.begin(), text.end());
+    }
+
+    /// Appends @p image to the images of this buffer and makes @p cell refer to it, unless it is empty.
+    void assignImage(RenderCell& cell, std::shared_ptr<ImageFragment> image)
+    {
+        if (!image)
+            return;
+        cell.imageIndex = static_cast<uint32_t>(images.size());
+        images.emplace_back(std::move(image));
+    }
+
+    /// Appends the cells and lines of @p other, along with their codepoints and images.
+    ///
+    /// The images of @p other are moved from, the cursor and frame ID of this buffer are kept.
+    void append(RenderBuffer& other);
+
+    // Keeps the capacity of all containers, so that refilling the buffer does not allocate.
     void clear()
     {
         cells.clear();
         lines.clear();
+        codepoints.clear();
+        images.clear();
         cursor.reset();
     }
 };
 
-/// Lock-guarded handle to a read-only RenderBuffer object.
+/// Handle to the read-only RenderBuffer object most recently published to the reader.
+///
+/// The buffer stays untouched by the writer until the reader acquires the next one.
 ///
 /// @see RenderBuffer
 struct RenderBufferRef
 {
     gsl::not_null<RenderBuffer const*> buffer;
-    gsl::not_null<std::mutex*> guard;
 
     [[nodiscard]] RenderBuffer const& get() const noexcept { return *buffer; }
 
-    RenderBufferRef(RenderBuffer const& buf, std::mutex& lock): buffer { &buf }, guard { &lock }
-    {
-        guard->lock();
-    }
-
-    ~RenderBufferRef() { guard->unlock(); }
+    explicit RenderBufferRef(RenderBuffer const& buf): buffer { &buf } {}
 };
 
 /// Reflects the current state of a RenderDoubleBuffer object.
@@ -117,28 +187,42 @@ constexpr std::string_view to_string(RenderBufferState state) noexcept
     return "INVALID";
 }
 
-struct RenderDoubleBuffer
+/// Hands render buffers over from the terminal thread (writer) to the render thread (reader)
+/// without either of them ever waiting for the other.
+///
+/// Of the three buffers, one is owned by the writer, one by the reader, and the third
+/// holds the most recently published frame. Publishing and acquiring a frame each exchange
+/// the index of the owned buffer with the one of the third buffer, so that the writer always has
+/// a free buffer to fill, and the reader always gets the latest completed frame.
+struct RenderTripleBuffer
 {
-    std::mutex mutable readerLock;
-    std::atomic<size_t> currentBackBufferIndex = 0;
-    std::array<RenderBuffer, 2> buffers {};
+    static constexpr size_t BufferCount = 3;
+
+    std::array<RenderBuffer, BufferCount> buffers {};
     std::atomic<RenderBufferState> state = RenderBufferState::WaitingForRefresh;
     std::chrono::steady_clock::time_point lastUpdate {};
 
-    RenderBuffer& backBuffer() noexcept { return buffers[currentBackBufferIndex]; }
+    RenderBuffer& backBuffer() noexcept { return buffers[backBufferIndex.load(std::memory_order_relaxed)]; }
 
-    RenderBufferRef frontBuffer() const
-    {
-        // if (state == RenderBufferState::TrySwapBuffers)
-        //     const_cast<RenderDoubleBuffer*>(this)->swapBuffers(lastUpdate);
-        RenderBuffer const& frontBuffer = buffers.at((currentBackBufferIndex + 1) % 2);
-        return RenderBufferRef(frontBuffer, readerLock);
-    }
+    /// Acquires the most recently published frame, or the previously acquired one if none was
+    /// published since. May only be invoked by the reader thread.
+    RenderBufferRef frontBuffer() const noexcept;
 
     void clear() { backBuffer().clear(); }
 
-    // Swaps front with back buffer. May only be invoked by the writer thread.
+    /// Publishes the back buffer to the reader and takes over a free buffer as the new back buffer.
+    /// May only be invoked by the writer thread.
+    ///
+    /// @retval true always, as publishing never has to wait for the reader.
     bool swapBuffers(std::chrono::steady_clock::time_point now) noexcept;
+
+  private:
+    // Set in the published index of a frame that the reader did not acquire yet.
+    static constexpr uint8_t FreshFrame = 0x80;
+
+    std::atomic<uint8_t> backBufferIndex = 0;              // owned by the writer
+    mutable std::atomic<uint8_t> frontBufferIndex = 1;     // owned by the reader
+    mutable std::atomic<uint8_t> publishedBufferIndex = 2; // buffer exchanged by writer and reader
 };
 
 } // namespace vtbackend
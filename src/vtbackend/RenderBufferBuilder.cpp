@@ -4,25 +4,28 @@
 #include <vtbackend/Color.h>
 #include <vtbackend/ColorPalette.h>
 #include <vtbackend/RenderBufferBuilder.h>
+#include <vtbackend/UnicodeTable.h>
 
 #include <crispy/utils.h>
 
 #include <libunicode/convert.h>
 #include <libunicode/utf8_grapheme_segmenter.h>
 
+#include <algorithm>
+#include <iterator>
+
 using namespace std;
 
 namespace vtbackend
 {
 
-using crispy::beginsWith;
 
 namespace
 {
     ColumnCount graphemeClusterWidth(std::u32string_view cluster) noexcept
     {
         assert(!cluster.empty());
-        auto baseWidth = ColumnCount::cast_from(unicode::width(cluster[0]));
+        auto baseWidth = ColumnCount::cast_from(UnicodeTable::width(cluster[0]));
         for (size_t i = 1; i < cluster.size(); ++i)
             if (auto const codepoint = cluster[i]; codepoint == 0xFE0F)
                 return ColumnCount(2);
@@ -51,20 +54,12 @@ namespace
     }
 
     RGBColorPair makeColors(ColorPalette const& colorPalette,
-                            CellFlags cellFlags,
-                            bool reverseVideo,
-                            Color foregroundColor,
-                            Color backgroundColor,
+                            RGBColorPair sgrColors,
                             bool selected,
                             bool isCursor,
                             bool isCursorLine,
-                            bool isHighlighted,
-                            bool blink,
-                            bool rapidBlink) noexcept
+                            bool isHighlighted) noexcept
     {
-        auto sgrColors = CellUtil::makeColors(
-            colorPalette, cellFlags, reverseVideo, foregroundColor, backgroundColor, blink, rapidBlink);
-
         if (isCursorLine)
             sgrColors = makeRGBColorPair(sgrColors, colorPalette.normalModeCursorline);
 
@@ -124,6 +119,38 @@ RenderBufferBuilder<Cell>::RenderBufferBuilder(Terminal const& terminal,
 
     if (_cursorPosition)
         output.cursor = renderCursor();
+
+    // The selection is taken apart into the selected columns of each line shown, once per frame.
+    if (_includeSelection && terminal.isSelectionAvailable())
+    {
+        auto const& selection = *terminal.selector();
+        _selectionTop = terminal.viewport().translateScreenToGridCoordinate(CellLocation {}).line;
+        _selectedColumns.resize(unbox<size_t>(terminal.pageSize().lines));
+        for (size_t i = 0; i < _selectedColumns.size(); ++i)
+            _selectedColumns[i] = selection.rangeAt(_selectionTop + LineOffset::cast_from(i));
+        if (std::none_of(_selectedColumns.begin(), _selectedColumns.end(), [](auto const& range) {
+                return range.has_value();
+            }))
+            _selectedColumns.clear();
+    }
+
+    // Matches of regular expressions are not highlighted, as they cannot be found by plain text comparison.
+    auto const& searchMode = terminal.state().searchMode;
+    if (_highlightSearchMatches != HighlightSearchMatches::No && !searchMode.pattern.empty()
+        && !searchMode.isRegex())
+    {
+        _searchPattern = searchMode.pattern;
+        _searchPatternUtf8 = unicode::convert_to<char>(u32string_view(_searchPattern));
+    }
+}
+
+template <typename Cell>
+optional<ColumnRange> RenderBufferBuilder<Cell>::selectedColumns(LineOffset gridLine) const noexcept
+{
+    auto const index = unbox<size_t>(gridLine - _selectionTop);
+    if (gridLine < _selectionTop || index >= _selectedColumns.size())
+        return nullopt;
+    return _selectedColumns[index];
 }
 
 template <typename Cell>
@@ -150,7 +177,7 @@ optional<RenderCursor> RenderBufferBuilder<Cell>::renderCursor() const
 
 template <typename Cell>
 RenderCell RenderBufferBuilder<Cell>::makeRenderCellExplicit(ColorPalette const& colorPalette,
-                                                             u32string graphemeCluster,
+                                                             u32string_view graphemeCluster,
                                                              ColumnCount width,
                                                              CellFlags flags,
                                                              RGBColor fg,
@@ -167,7 +194,7 @@ RenderCell RenderBufferBuilder<Cell>::makeRenderCellExplicit(ColorPalette const&
     renderCell.position.line = line;
     renderCell.position.column = column;
     renderCell.width = unbox<uint8_t>(width);
-    renderCell.codepoints = std::move(graphemeCluster);
+    _output->assignCodepoints(renderCell, graphemeCluster);
     return renderCell;
 }
 
@@ -190,7 +217,7 @@ RenderCell RenderBufferBuilder<Cell>::makeRenderCellExplicit(ColorPalette const&
     renderCell.position.column = column;
     renderCell.width = 1;
     if (codepoint)
-        renderCell.codepoints.push_back(codepoint);
+        _output->assignCodepoints(renderCell, u32string_view(&codepoint, 1));
     return renderCell;
 }
 
@@ -212,15 +239,22 @@ RenderCell RenderBufferBuilder<Cell>::makeRenderCell(ColorPalette const& colorPa
     renderCell.position.column = column;
     renderCell.width = screenCell.width();
 
-    if (screenCell.codepointCount() != 0)
-    {
-        for (size_t i = 0; i < screenCell.codepointCount(); ++i)
-            renderCell.codepoints.push_back(screenCell.codepoint(i));
-    }
+    renderCell.codepointsOffset = static_cast<uint32_t>(_output->codepoints.size());
+    renderCell.codepointCount = static_cast<uint32_t>(screenCell.codepointCount());
+    for (size_t i = 0; i < screenCell.codepointCount(); ++i)
+        _output->codepoints.push_back(screenCell.codepoint(i));
 
-    renderCell.image = screenCell.imageFragment();
+    _output->assignImage(renderCell, screenCell.imageFragment());
 
-    if (auto href = hyperlinks.hyperlinkById(screenCell.hyperlink()))
+    auto const href = [&]() -> std::shared_ptr<HyperlinkInfo const> {
+        if (!screenCell.hyperlink())
+            return nullptr;
+        if (!_hyperlinkMutex)
+            return hyperlinks.hyperlinkById(screenCell.hyperlink());
+        auto const _ = std::lock_guard { *_hyperlinkMutex };
+        return hyperlinks.hyperlinkById(screenCell.hyperlink());
+    }();
+    if (href)
     {
         auto const& color = href->state == HyperlinkState::Hover ? colorPalette.hyperlinkDecoration.hover
                                                                  : colorPalette.hyperlinkDecoration.normal;
@@ -251,24 +285,42 @@ RGBColorPair RenderBufferBuilder<Cell>::makeColorsForCell(CellLocation gridPosit
             && _output->cursor->shape == CursorShape::Block;
     // clang-format on
 
-    auto const selected =
-        _includeSelection && _terminal->isSelected(CellLocation { gridPosition.line, gridPosition.column });
+    auto const selected = isSelected(gridPosition);
     auto const highlighted =
         _terminal->isHighlighted(CellLocation { gridPosition.line, gridPosition.column });
-    auto const blink = _terminal->blinkState();
-    auto const rapidBlink = _terminal->rapidBlinkState();
 
     return makeColors(_terminal->colorPalette(),
-                      cellFlags,
-                      _reverseVideo,
-                      foregroundColor,
-                      backgroundColor,
+                      styleColors(cellFlags, foregroundColor, backgroundColor),
                       selected,
                       paintCursor,
                       _useCursorlineColoring,
-                      highlighted,
-                      blink,
-                      rapidBlink);
+                      highlighted);
+}
+
+template <typename Cell>
+RGBColorPair RenderBufferBuilder<Cell>::styleColors(CellFlags cellFlags,
+                                                    Color foregroundColor,
+                                                    Color backgroundColor) const noexcept
+{
+    auto const hash = (uint64_t { foregroundColor.content } * 0x9E3779B1u)
+                      ^ (uint64_t { backgroundColor.content } * 0x85EBCA77u) ^ cellFlags.value();
+    auto& entry = _styleCache[(hash ^ (hash >> 17)) % StyleCacheSize];
+    if (entry.valid && entry.flags == cellFlags && entry.foregroundColor == foregroundColor
+        && entry.backgroundColor == backgroundColor)
+        return entry.colors;
+
+    entry.valid = true;
+    entry.flags = cellFlags;
+    entry.foregroundColor = foregroundColor;
+    entry.backgroundColor = backgroundColor;
+    entry.colors = CellUtil::makeColors(_terminal->colorLookupTable(),
+                                        cellFlags,
+                                        _reverseVideo,
+                                        foregroundColor,
+                                        backgroundColor,
+                                        _terminal->blinkState(),
+                                        _terminal->rapidBlinkState());
+    return entry.colors;
 }
 
 template <typename Cell>
@@ -335,6 +387,10 @@ void RenderBufferBuilder<Cell>::renderTrivialLine(TrivialLineBuffer const& lineB
     // No need to call isCursorLine(lineOffset) because lines containing a cursor are always inflated.
     _useCursorlineColoring = false;
 
+    beginLine(lineOffset, &lineBuffer);
+    if (_reusingLine)
+        return;
+
     auto const frontIndex = _output->cells.size();
 
     // Visual selection can alter colors for some columns in this line.
@@ -345,8 +401,13 @@ void RenderBufferBuilder<Cell>::renderTrivialLine(TrivialLineBuffer const& lineB
     // which affects background/foreground color again.
     // We're not testing for cursor shape (which should be done in order to be 100% correct)
     // because it's not really draining performance.
-    bool const canRenderViaSimpleLine =
-        (!_terminal->isSelected(lineOffset) || !_includeSelection) && !gridLineContainsCursor(lineOffset);
+    //
+    // A render line carries a single set of text attributes, so lines with multiple
+    // attribute spans are rendered cell-wise, too.
+    auto const lineStart = _terminal->viewport().translateScreenToGridCoordinate(CellLocation { lineOffset });
+    bool const canRenderViaSimpleLine = !selectedColumns(lineStart.line)
+                                        && !gridLineContainsCursor(lineOffset) && lineBuffer.spans.empty()
+                                        && !containsSearchMatch(lineBuffer.text.view());
 
     if (canRenderViaSimpleLine)
     {
@@ -362,14 +423,19 @@ void RenderBufferBuilder<Cell>::renderTrivialLine(TrivialLineBuffer const& lineB
     auto const pageColumnsEnd = boxed_cast<ColumnOffset>(_terminal->pageSize().columns);
 
     // render text
-    _searchPatternOffset = 0;
-    renderUtf8Text(CellLocation { lineOffset, ColumnOffset(0) },
-                   lineBuffer.textAttributes,
-                   lineBuffer.text.view(),
-                   true);
-
-    // {{{ fill the remaining empty cells
-    for (auto columnOffset = textMargin; columnOffset < pageColumnsEnd; ++columnOffset)
+    lineBuffer.forEachRun([&](ColumnOffset start,
+                              std::string_view text,
+                              GraphicsAttributes const& attributes,
+                              HyperlinkId /*hyperlink*/) {
+        renderUtf8Text(CellLocation { lineOffset, start }, attributes, text);
+    });
+
+    // {{{ fill the remaining empty cells, unless they would not show anything but the default background
+    auto const fillEnd = lineBuffer.fillAttributes == GraphicsAttributes {} && textMargin > ColumnOffset(0)
+                                 && !blankCellsPaintedOver(lineOffset, textMargin)
+                             ? textMargin
+                             : pageColumnsEnd;
+    for (auto columnOffset = textMargin; columnOffset < fillEnd; ++columnOffset)
     {
         auto const pos = CellLocation { lineOffset, columnOffset };
         auto const gridPosition = _terminal->viewport().translateScreenToGridCoordinate(pos);
@@ -386,6 +452,8 @@ void RenderBufferBuilder<Cell>::renderTrivialLine(TrivialLineBuffer const& lineB
     }
     // }}}
 
+    highlightSearchMatches();
+
     auto const backIndex = _output->cells.size() - 1;
 
     _output->cells[frontIndex].groupStart = true;
@@ -393,97 +461,215 @@ void RenderBufferBuilder<Cell>::renderTrivialLine(TrivialLineBuffer const& lineB
 }
 
 template <typename Cell>
-template <typename T>
-void RenderBufferBuilder<Cell>::matchSearchPattern(T const& cellText)
+bool RenderBufferBuilder<Cell>::containsSearchMatch(std::string_view text) const noexcept
 {
-    if (_highlightSearchMatches == HighlightSearchMatches::No)
-        return;
+    return !_searchPatternUtf8.empty() && text.find(_searchPatternUtf8) != std::string_view::npos;
+}
 
-    auto const& searchMode = _terminal->state().searchMode;
-    if (searchMode.pattern.empty())
+template <typename Cell>
+void RenderBufferBuilder<Cell>::highlightSearchMatches()
+{
+    if (_searchPattern.empty())
         return;
 
-    auto const isFullMatch = [&]() -> bool {
-        if constexpr (std::is_same_v<Cell, T>)
+    // Concatenates the codepoints of the current line's cells, except for the cells covered by wide
+    // characters, remembering for each codepoint the cell it belongs to. Empty cells never match.
+    auto& cells = _output->cells;
+    _lineText.clear();
+    _lineTextCells.clear();
+    for (auto i = _lineFrontIndex; i < cells.size(); i += std::max(size_t { cells[i].width }, size_t { 1 }))
+    {
+        if (cells[i].codepointCount == 0)
         {
-            return !CellUtil::beginsWith(u32string_view(searchMode.pattern.data() + _searchPatternOffset,
-                                                        searchMode.pattern.size() - _searchPatternOffset),
-                                         cellText);
+            _lineText.push_back(char32_t { 0 });
+            _lineTextCells.push_back(i);
         }
-        else
+        for (auto const codepoint: _output->codepointsOf(cells[i]))
         {
-            return crispy::beginsWith(u32string_view(searchMode.pattern.data() + _searchPatternOffset,
-                                                     searchMode.pattern.size() - _searchPatternOffset),
-                                      cellText);
+            _lineText.push_back(codepoint);
+            _lineTextCells.push_back(i);
         }
-    }();
+    }
 
-    if (isFullMatch)
+    auto const text = u32string_view(_lineText);
+    auto const viCursor =
+        _terminal->viewport().translateGridToScreenCoordinate(_terminal->state().viCommands.cursorPosition);
+    for (auto match = text.find(_searchPattern); match != u32string_view::npos;
+         match = text.find(_searchPattern, match + _searchPattern.size()))
     {
-        // match fail
-        _searchPatternOffset = 0;
-        return;
+        auto const first = _lineTextCells[match];
+        auto const lastCell = _lineTextCells[match + _searchPattern.size() - 1];
+        auto const last = std::min(lastCell + std::max(size_t { cells[lastCell].width }, size_t { 1 }),
+                                   cells.size());
+
+        auto const isFocusedMatch =
+            CellLocationRange { cells[first].position, cells[last - 1].position }.contains(viCursor);
+
+        auto const highlightColors = [&]() -> CellRGBColorAndAlphaPair {
+            if (isFocusedMatch)
+            {
+                if (_terminal->state().searchMode.initiatedByDoubleClick)
+                    return _terminal->colorPalette().wordHighlightCurrent;
+                else
+                    return _terminal->colorPalette().searchHighlightFocused;
+            }
+            else
+            {
+                if (_terminal->state().searchMode.initiatedByDoubleClick)
+                    return _terminal->colorPalette().wordHighlight;
+                else
+                    return _terminal->colorPalette().searchHighlight;
+            }
+        }();
+
+        for (auto i = first; i < last; ++i)
+        {
+            auto& cellAttributes = cells[i].attributes;
+            auto const actualColors =
+                RGBColorPair { cellAttributes.foregroundColor, cellAttributes.backgroundColor };
+            auto const searchMatchColors = makeRGBColorPair(actualColors, highlightColors);
+
+            cellAttributes.backgroundColor = searchMatchColors.background;
+            cellAttributes.foregroundColor = searchMatchColors.foreground;
+        }
     }
+}
+
+template <typename Cell>
+void RenderBufferBuilder<Cell>::startLine(LineOffset line)
+{
+    _lineNr = line;
+    _prevWidth = 0;
+    _prevHasCursor = false;
+
+    _useCursorlineColoring = isCursorLine(line);
+
+    beginLine(line, nullptr);
+}
+
+template <typename Cell>
+void RenderBufferBuilder<Cell>::finish()
+{
+    _reusingLine = false;
+
+    if (_lineLocations)
+        _lineLocations->push_back(RenderedLineLocation { _output->cells.size(), _output->lines.size() });
+}
+
+template <typename Cell>
+void RenderBufferBuilder<Cell>::reuseLines(RenderBuffer& previousFrame,
+                                           std::vector<RenderedLineLocation> const& previousLocations,
+                                           std::vector<bool> const& staleLines,
+                                           LineOffset lineShift) noexcept
+{
+    _previousFrame = &previousFrame;
+    _previousLocations = &previousLocations;
+    _staleLines = &staleLines;
+    _lineShift = lineShift;
+}
+
+template <typename Cell>
+void RenderBufferBuilder<Cell>::trackLineLocations(std::vector<RenderedLineLocation>& locations) noexcept
+{
+    _lineLocations = &locations;
+}
+
+template <typename Cell>
+void RenderBufferBuilder<Cell>::trackHyperlinkSpans(
+    std::vector<RenderedHyperlinkSpan>& spans,
+    std::vector<RenderedHyperlinkSpan> const& previousSpans) noexcept
+{
+    _hyperlinkSpans = &spans;
+    _previousHyperlinkSpans = &previousSpans;
+}
 
-    if constexpr (std::is_same_v<Cell, T>)
-        _searchPatternOffset += cellText.codepointCount();
+template <typename Cell>
+void RenderBufferBuilder<Cell>::addHyperlinkCell(HyperlinkId hyperlink, LineOffset line, ColumnOffset column)
+{
+    if (!_hyperlinkSpans || hyperlink.value == 0)
+        return;
+
+    auto& spans = *_hyperlinkSpans;
+    if (!spans.empty() && spans.back().hyperlink == hyperlink && spans.back().line == line
+        && spans.back().last + 1 == column)
+        spans.back().last = column;
     else
-        _searchPatternOffset += cellText.size();
+        spans.push_back(RenderedHyperlinkSpan { hyperlink, line, column, column });
+}
 
-    if (_searchPatternOffset < searchMode.pattern.size())
-        return; // match incomplete
+template <typename Cell>
+bool RenderBufferBuilder<Cell>::isReusableLine(LineOffset line) const noexcept
+{
+    auto const previousLine = line + _lineShift;
+    return _previousFrame && *previousLine >= 0
+           && unbox<size_t>(previousLine) + 1 < _previousLocations->size()
+           && unbox<size_t>(previousLine) < _staleLines->size()
+           && !(*_staleLines)[unbox<size_t>(previousLine)];
+}
 
-    // match complete
+template <typename Cell>
+void RenderBufferBuilder<Cell>::beginLine(LineOffset line, TrivialLineBuffer const* lineBuffer)
+{
+    if (_lineLocations)
+        _lineLocations->push_back(RenderedLineLocation { _output->cells.size(), _output->lines.size() });
 
-    auto const offsetIntoFront = _output->cells.size() - _searchPatternOffset;
+    _lineFrontIndex = _output->cells.size();
+    _reusingLine = false;
+    if (!isReusableLine(line))
+        return;
 
-    auto const isFocusedMatch =
-        CellLocationRange {
-            _output->cells[offsetIntoFront].position,
-            _output->cells.back().position,
-        }
-            .contains(_terminal->viewport().translateGridToScreenCoordinate(
-                _terminal->state().viCommands.cursorPosition));
+    // The same grid line may have been shown on another screen line, if the viewport has been scrolled.
+    auto const previousLine = unbox<size_t>(line + _lineShift);
+    auto const& from = (*_previousLocations)[previousLine];
+    auto const& to = (*_previousLocations)[previousLine + 1];
+    auto const renderedAsCells = to.firstCell > from.firstCell && to.firstLine == from.firstLine;
+    auto const renderedAsLine = to.firstCell == from.firstCell && to.firstLine == from.firstLine + 1;
 
-    auto highlightColors = [&]() -> CellRGBColorAndAlphaPair {
-        // Oh yeah, this can be optimized :)
-        if (isFocusedMatch)
+    if (renderedAsCells)
+    {
+        // The codepoints and images are carried over into this frame's storage along with the cells.
+        for (auto i = from.firstCell; i < to.firstCell; ++i)
         {
-            if (_terminal->state().searchMode.initiatedByDoubleClick)
-                return _terminal->colorPalette().wordHighlightCurrent;
-            else
-                return _terminal->colorPalette().searchHighlightFocused;
+            auto cell = _previousFrame->cells[i];
+            cell.position.line -= _lineShift;
+            _output->assignCodepoints(cell, _previousFrame->codepointsOf(cell));
+            if (cell.imageIndex != RenderCell::NoImage)
+            {
+                auto image = std::move(_previousFrame->images[cell.imageIndex]);
+                cell.imageIndex = RenderCell::NoImage;
+                _output->assignImage(cell, std::move(image));
+            }
+            _output->cells.emplace_back(cell);
         }
-        else
+        if (_hyperlinkSpans && _previousHyperlinkSpans)
         {
-            if (_terminal->state().searchMode.initiatedByDoubleClick)
-                return _terminal->colorPalette().wordHighlight;
-            else
-                return _terminal->colorPalette().searchHighlight;
+            auto const& previousSpans = *_previousHyperlinkSpans;
+            auto i = std::lower_bound(previousSpans.begin(),
+                                      previousSpans.end(),
+                                      line + _lineShift,
+                                      [](RenderedHyperlinkSpan const& span, LineOffset value) {
+                                          return span.line < value;
+                                      });
+            for (; i != previousSpans.end() && i->line == line + _lineShift; ++i)
+                _hyperlinkSpans->push_back(RenderedHyperlinkSpan { i->hyperlink, line, i->first, i->last });
         }
-    }();
+        _reusingLine = true;
+        return;
+    }
 
-    for (size_t i = offsetIntoFront; i < _output->cells.size(); ++i)
+    // A render line merely refers to the text of the trivial line buffer it has been created from,
+    // so it must still be the very same buffer.
+    if (renderedAsLine && lineBuffer)
     {
-        auto& cellAttributes = _output->cells[i].attributes;
-        auto const actualColors =
-            RGBColorPair { cellAttributes.foregroundColor, cellAttributes.backgroundColor };
-        auto const searchMatchColors = makeRGBColorPair(actualColors, highlightColors);
-
-        cellAttributes.backgroundColor = searchMatchColors.background;
-        cellAttributes.foregroundColor = searchMatchColors.foreground;
+        auto& renderLine = _previousFrame->lines[from.firstLine];
+        auto const text = lineBuffer->text.view();
+        if (renderLine.text.data() == text.data() && renderLine.text.size() == text.size())
+        {
+            renderLine.lineOffset -= _lineShift;
+            _output->lines.emplace_back(std::move(renderLine));
+            _reusingLine = true;
+        }
     }
-    _searchPatternOffset = 0;
-}
-
-template <typename Cell>
-void RenderBufferBuilder<Cell>::startLine(LineOffset line) noexcept
-{
-    _lineNr = line;
-    _prevWidth = 0;
-    _prevHasCursor = false;
-
-    _useCursorlineColoring = isCursorLine(line);
 }
 
 template <typename Cell>
@@ -497,8 +683,13 @@ bool RenderBufferBuilder<Cell>::isCursorLine(LineOffset line) const noexcept
 }
 
 template <typename Cell>
-void RenderBufferBuilder<Cell>::endLine() noexcept
+void RenderBufferBuilder<Cell>::endLine()
 {
+    if (_reusingLine)
+        return;
+
+    highlightSearchMatches();
+
     if (!_output->cells.empty())
     {
         _output->cells.back().groupEnd = true;
@@ -508,8 +699,7 @@ void RenderBufferBuilder<Cell>::endLine() noexcept
 template <typename Cell>
 ColumnCount RenderBufferBuilder<Cell>::renderUtf8Text(CellLocation screenPosition,
                                                       GraphicsAttributes textAttributes,
-                                                      std::string_view text,
-                                                      bool allowMatchSearchPattern)
+                                                      std::string_view text)
 {
     auto columnCountRendered = ColumnCount(0);
 
@@ -559,9 +749,6 @@ ColumnCount RenderBufferBuilder<Cell>::renderUtf8Text(CellLocation screenPositio
         _lineNr = screenPosition.line;
         _prevWidth = 0;
         _prevHasCursor = false;
-
-        if (allowMatchSearchPattern)
-            matchSearchPattern(u32string_view(graphemeCluster));
     }
     return columnCountRendered;
 }
@@ -583,7 +770,7 @@ bool RenderBufferBuilder<Cell>::tryRenderInputMethodEditor(CellLocation screenPo
             _output->cells.back().groupEnd = true;
 
         _inputMethodSkipColumns =
-            renderUtf8Text(screenPosition, textAttributes, _inputMethodData.preeditString, false);
+            renderUtf8Text(screenPosition, textAttributes, _inputMethodData.preeditString);
         if (_inputMethodSkipColumns > ColumnCount(0))
         {
             _output->cursor->position.column += ColumnOffset::cast_from(_inputMethodSkipColumns);
@@ -601,15 +788,47 @@ bool RenderBufferBuilder<Cell>::tryRenderInputMethodEditor(CellLocation screenPo
     return true;
 }
 
+template <typename Cell>
+bool RenderBufferBuilder<Cell>::tryRenderPredictedEcho(CellLocation screenPosition, CellLocation gridPosition)
+{
+    auto const* prediction = _predictiveEcho ? _predictiveEcho->predictionAt(gridPosition) : nullptr;
+    if (!prediction)
+        return false;
+
+    auto textAttributes = GraphicsAttributes {};
+    textAttributes.flags.enable(CellFlag::Underline);
+
+    if (!_output->cells.empty())
+        _output->cells.back().groupEnd = true;
+
+    auto const text = unicode::convert_to<char>(prediction->codepoint);
+    (void) renderUtf8Text(screenPosition, textAttributes, text);
+    _output->cells.back().groupStart = true;
+    _output->cells.back().groupEnd = true;
+
+    // The cursor shows where the next character typed is echoed.
+    auto const outputPosition = CellLocation { _baseLine + screenPosition.line, screenPosition.column };
+    if (_output->cursor && _output->cursor->position == outputPosition)
+        ++_output->cursor->position.column;
+
+    return true;
+}
+
 template <typename Cell>
 void RenderBufferBuilder<Cell>::renderCell(Cell const& screenCell, LineOffset line, ColumnOffset column)
 {
+    if (_reusingLine)
+        return;
+
     auto const screenPosition = CellLocation { line, column };
     auto const gridPosition = _terminal->viewport().translateScreenToGridCoordinate(screenPosition);
 
     if (tryRenderInputMethodEditor(screenPosition, gridPosition))
         return;
 
+    if (tryRenderPredictedEcho(screenPosition, gridPosition))
+        return;
+
     auto /*const*/ [fg, bg] = makeColorsForCell(
         gridPosition, screenCell.flags(), screenCell.foregroundColor(), screenCell.backgroundColor());
 
@@ -623,11 +842,37 @@ void RenderBufferBuilder<Cell>::renderCell(Cell const& screenCell, LineOffset li
                                                bg,
                                                _baseLine + line,
                                                column));
+    addHyperlinkCell(screenCell.hyperlink(), line, column);
 
     if (column == ColumnOffset(0))
         _output->cells.back().groupStart = true;
+}
+
+template <typename Cell>
+void RenderBufferBuilder<Cell>::renderBlankCells(gsl::span<Cell const> cells,
+                                                 LineOffset line,
+                                                 ColumnOffset column)
+{
+    if (_reusingLine)
+        return;
 
-    matchSearchPattern(screenCell);
+    if (!blankCellsPaintedOver(line, column))
+        return;
+
+    for (Cell const& cell: cells)
+        renderCell(cell, line, column++);
+}
+
+template <typename Cell>
+bool RenderBufferBuilder<Cell>::blankCellsPaintedOver(LineOffset line, ColumnOffset column) const noexcept
+{
+    auto const gridPosition =
+        _terminal->viewport().translateScreenToGridCoordinate(CellLocation { line, column });
+    return _useCursorlineColoring || gridLineContainsCursor(line) || selectedColumns(gridPosition.line)
+           || _terminal->hasHighlight() || !_searchPattern.empty()
+           || (_predictiveEcho && !_predictiveEcho->predictions().empty())
+           || makeColorsForCell(gridPosition, CellFlags {}, DefaultColor(), DefaultColor()).background
+                  != _terminal->colorPalette().defaultBackground;
 }
 
 } // namespace vtbackend
@@ -637,3 +882,6 @@ template class vtbackend::RenderBufferBuilder<vtbackend::CompactCell>;
 
 #include <vtbackend/cell/SimpleCell.h>
 template class vtbackend::RenderBufferBuilder<vtbackend::SimpleCell>;
+
+#include <vtbackend/cell/FlatCell.h>
+template class vtbackend::RenderBufferBuilder<vtbackend::FlatCell>;
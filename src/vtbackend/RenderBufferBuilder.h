@@ -7,8 +7,13 @@
 #include <vtbackend/primitives.h>
 
 #include <gsl/pointers>
+#include <gsl/span>
 
+#include <array>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <vector>
 
 namespace vtbackend
 {
@@ -37,8 +42,16 @@ class RenderBufferBuilder
     ///
     /// @see renderTrivialLine
     void renderCell(Cell const& cell, LineOffset line, ColumnOffset column);
-    void startLine(LineOffset line) noexcept;
-    void endLine() noexcept;
+
+    /// Renders the blank cells at the end of a non-trivial line, starting at @p column,
+    /// which are empty and use the default attributes, in place of rendering them using renderCell().
+    ///
+    /// The cells are only rendered if anything is painted over them, such as the cursor,
+    /// a selection, or reverse video. Otherwise they would only show the default background.
+    void renderBlankCells(gsl::span<Cell const> cells, LineOffset line, ColumnOffset column);
+
+    void startLine(LineOffset line);
+    void endLine();
 
     /// Renders a trivial line.
     ///
@@ -51,40 +64,91 @@ class RenderBufferBuilder
     void renderTrivialLine(TrivialLineBuffer const& lineBuffer, LineOffset lineOffset);
 
     /// This call is guaranteed to be invoked when the the full page has been rendered.
-    void finish() noexcept {}
+    void finish();
+
+    /// Takes over the lines of a previously rendered frame that did not change since,
+    /// instead of rendering them again.
+    ///
+    /// @param previousFrame      frame rendered with the same settings, its cells and lines are moved from
+    /// @param previousLocations  where each screen line is located within @p previousFrame
+    /// @param staleLines         screen lines of @p previousFrame that must not be taken over
+    /// @param lineShift          number of lines the previous frame's screen lines are below
+    ///                           the screen lines showing the same grid lines in this one,
+    ///                           i.e. how far the viewport has been scrolled down in the meantime
+    void reuseLines(RenderBuffer& previousFrame,
+                    std::vector<RenderedLineLocation> const& previousLocations,
+                    std::vector<bool> const& staleLines,
+                    LineOffset lineShift = LineOffset(0)) noexcept;
+
+    /// Records where each screen line is rendered to within the output into @p locations,
+    /// followed by the location of the end of the page.
+    void trackLineLocations(std::vector<RenderedLineLocation>& locations) noexcept;
+
+    /// Records the runs of cells rendered with a hyperlink into @p spans, ordered by screen line.
+    ///
+    /// The runs of lines taken over from the previous frame are taken over from @p previousSpans.
+    void trackHyperlinkSpans(std::vector<RenderedHyperlinkSpan>& spans,
+                             std::vector<RenderedHyperlinkSpan> const& previousSpans) noexcept;
+
+    /// Serializes the hyperlink lookups of this builder through @p mutex, such that builders sharing it
+    /// may render distinct lines of the same page concurrently.
+    ///
+    /// Looking up a hyperlink updates the recency of the terminal's hyperlink cache.
+    void shareHyperlinkLookups(std::mutex& mutex) noexcept { _hyperlinkMutex = &mutex; }
+
+    /// Renders the characters predicted to be echoed in place of the grid cells they are predicted at,
+    /// moving the cursor past them.
+    void showPredictedEcho(PredictiveEcho const& predictiveEcho) noexcept
+    {
+        _predictiveEcho = &predictiveEcho;
+    }
 
   private:
     [[nodiscard]] bool isCursorLine(LineOffset line) const noexcept;
 
+    [[nodiscard]] bool isReusableLine(LineOffset line) const noexcept;
+
+    // Tests whether anything is painted over blank cells of the given screen line from the given column on,
+    // such that they cannot be left out.
+    [[nodiscard]] bool blankCellsPaintedOver(LineOffset line, ColumnOffset column) const noexcept;
+
+    // Records the start of the given screen line and takes it over from the previous frame, if possible.
+    void beginLine(LineOffset line, TrivialLineBuffer const* lineBuffer);
+
+    // Records a cell of the given screen line as rendered with the given hyperlink, if being tracked.
+    void addHyperlinkCell(HyperlinkId hyperlink, LineOffset line, ColumnOffset column);
+
     [[nodiscard]] std::optional<RenderCursor> renderCursor() const;
 
-    [[nodiscard]] static RenderCell makeRenderCellExplicit(ColorPalette const& colorPalette,
-                                                           std::u32string graphemeCluster,
-                                                           ColumnCount width,
-                                                           CellFlags flags,
-                                                           RGBColor fg,
-                                                           RGBColor bg,
-                                                           Color ul,
-                                                           LineOffset line,
-                                                           ColumnOffset column);
-
-    [[nodiscard]] static RenderCell makeRenderCellExplicit(ColorPalette const& colorPalette,
-                                                           char32_t codepoint,
-                                                           CellFlags flags,
-                                                           RGBColor fg,
-                                                           RGBColor bg,
-                                                           Color ul,
-                                                           LineOffset line,
-                                                           ColumnOffset column);
+    // The functions constructing a RenderCell store its codepoints and image in the output buffer.
+
+    [[nodiscard]] RenderCell makeRenderCellExplicit(ColorPalette const& colorPalette,
+                                                    std::u32string_view graphemeCluster,
+                                                    ColumnCount width,
+                                                    CellFlags flags,
+                                                    RGBColor fg,
+                                                    RGBColor bg,
+                                                    Color ul,
+                                                    LineOffset line,
+                                                    ColumnOffset column);
+
+    [[nodiscard]] RenderCell makeRenderCellExplicit(ColorPalette const& colorPalette,
+                                                    char32_t codepoint,
+                                                    CellFlags flags,
+                                                    RGBColor fg,
+                                                    RGBColor bg,
+                                                    Color ul,
+                                                    LineOffset line,
+                                                    ColumnOffset column);
 
     /// Constructs a RenderCell for the given screen Cell.
-    [[nodiscard]] static RenderCell makeRenderCell(ColorPalette const& colorPalette,
-                                                   HyperlinkStorage const& hyperlinks,
-                                                   Cell const& cell,
-                                                   RGBColor fg,
-                                                   RGBColor bg,
-                                                   LineOffset line,
-                                                   ColumnOffset column);
+    [[nodiscard]] RenderCell makeRenderCell(ColorPalette const& colorPalette,
+                                            HyperlinkStorage const& hyperlinks,
+                                            Cell const& cell,
+                                            RGBColor fg,
+                                            RGBColor bg,
+                                            LineOffset line,
+                                            ColumnOffset column);
 
     /// Constructs the final foreground/background colors to be displayed on the screen.
     ///
@@ -94,6 +158,14 @@ class RenderBufferBuilder
                                                  Color foregroundColor,
                                                  Color backgroundColor) const noexcept;
 
+    /// Resolves the colors of the given cell style, as configured by SGR, into RGB colors.
+    ///
+    /// Screens use only few distinct styles at a time, so the result is cached per style
+    /// for the lifetime of this builder (i.e. for a single frame).
+    [[nodiscard]] RGBColorPair styleColors(CellFlags cellFlags,
+                                           Color foregroundColor,
+                                           Color backgroundColor) const noexcept;
+
     [[nodiscard]] RenderLine createRenderLine(TrivialLineBuffer const& lineBuffer,
                                               LineOffset lineOffset) const;
 
@@ -101,14 +173,32 @@ class RenderBufferBuilder
         CellLocation gridPosition, GraphicsAttributes graphicsAttributes) const noexcept;
 
     [[nodiscard]] bool tryRenderInputMethodEditor(CellLocation screenPosition, CellLocation gridPosition);
+    [[nodiscard]] bool tryRenderPredictedEcho(CellLocation screenPosition, CellLocation gridPosition);
 
     ColumnCount renderUtf8Text(CellLocation screenPosition,
                                GraphicsAttributes attributes,
-                               std::string_view text,
-                               bool allowMatchSearchPattern);
+                               std::string_view text);
+
+    /// Tests whether the given UTF-8 text of a trivial line contains a search match to be highlighted.
+    [[nodiscard]] bool containsSearchMatch(std::string_view text) const noexcept;
+
+    /// Highlights the search matches within the cells rendered for the current line.
+    ///
+    /// The line's text is searched as a whole once the line has been rendered,
+    /// rather than by matching the search pattern against each cell as it is rendered.
+    void highlightSearchMatches();
+
+    /// Tests whether the given grid position is selected, as of when this builder was constructed.
+    [[nodiscard]] bool isSelected(CellLocation gridPosition) const noexcept
+    {
+        if (_selectedColumns.empty())
+            return false;
+        auto const range = selectedColumns(gridPosition.line);
+        return range && range->fromColumn <= gridPosition.column && gridPosition.column <= range->toColumn;
+    }
 
-    template <typename T>
-    void matchSearchPattern(T const& cellText);
+    /// @returns the selected columns of the given grid line, if any.
+    [[nodiscard]] std::optional<ColumnRange> selectedColumns(LineOffset gridLine) const noexcept;
 
     /// Tests if the given screen line offset does contain a cursor (either ANSI cursor or vi cursor, if
     /// shown) and returns false otherwise, which guarantees that no cursor is to be rendered
@@ -119,6 +209,18 @@ class RenderBufferBuilder
     enum class State { Gap, Sequence };
     // clang-format on
 
+    struct StyleColors
+    {
+        bool valid = false;
+        CellFlags flags {};
+        Color foregroundColor {};
+        Color backgroundColor {};
+        RGBColorPair colors {};
+    };
+
+    // Number of entries of the direct-mapped style cache.
+    static constexpr size_t StyleCacheSize = 64;
+
     gsl::not_null<RenderBuffer*> _output;
     gsl::not_null<Terminal const*> _terminal;
     std::optional<CellLocation> _cursorPosition;
@@ -127,15 +229,42 @@ class RenderBufferBuilder
     HighlightSearchMatches _highlightSearchMatches;
     InputMethodData _inputMethodData;
     bool _includeSelection;
+
+    // The selected columns of each grid line shown, from _selectionTop on, taken from the selection once.
+    // Empty if nothing is selected, so that testing whether cells are selected costs nothing then.
+    LineOffset _selectionTop {};
+    std::vector<std::optional<ColumnRange>> _selectedColumns;
     ColumnCount _inputMethodSkipColumns = ColumnCount(0);
+    PredictiveEcho const* _predictiveEcho = nullptr;
 
     int _prevWidth = 0;
     bool _prevHasCursor = false;
     LineOffset _lineNr = LineOffset(0);
     bool _useCursorlineColoring = false;
 
-    // Offset into the search pattern that has been already matched.
-    size_t _searchPatternOffset = 0;
+    // The search pattern to highlight, if any, along with its UTF-8 form for searching trivial lines.
+    std::u32string _searchPattern;
+    std::string _searchPatternUtf8;
+
+    // Index of the current line's first cell, and the line's text as searched by highlightSearchMatches(),
+    // along with the index of the cell each codepoint belongs to.
+    size_t _lineFrontIndex = 0;
+    std::u32string _lineText;
+    std::vector<size_t> _lineTextCells;
+
+    std::mutex* _hyperlinkMutex = nullptr;
+
+    RenderBuffer* _previousFrame = nullptr;
+    std::vector<RenderedLineLocation> const* _previousLocations = nullptr;
+    std::vector<bool> const* _staleLines = nullptr;
+    LineOffset _lineShift {};
+    std::vector<RenderedLineLocation>* _lineLocations = nullptr;
+    std::vector<RenderedHyperlinkSpan>* _hyperlinkSpans = nullptr;
+    std::vector<RenderedHyperlinkSpan> const* _previousHyperlinkSpans = nullptr;
+    bool _reusingLine = false; // Whether the current line has been taken over from the previous frame.
+
+    // Resolved colors of recently rendered cell styles.
+    mutable std::array<StyleColors, StyleCacheSize> _styleCache {};
 };
 
 } // namespace vtbackend
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/RenderBuffer.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace vtbackend;
+
+namespace
+{
+
+void publish(RenderTripleBuffer& tripleBuffer, uint64_t frameID)
+{
+    tripleBuffer.backBuffer().frameID = frameID;
+    CHECK(tripleBuffer.swapBuffers(std::chrono::steady_clock::now()));
+}
+
+} // namespace
+
+TEST_CASE("RenderTripleBuffer.latest_frame", "[RenderBuffer]")
+{
+    auto tripleBuffer = RenderTripleBuffer {};
+
+    publish(tripleBuffer, 1);
+    CHECK(tripleBuffer.frontBuffer().get().frameID == 1);
+
+    // Without a new frame, the reader keeps the frame acquired last.
+    CHECK(tripleBuffer.frontBuffer().get().frameID == 1);
+
+    // Frames published in the meantime are skipped in favor of the latest one.
+    publish(tripleBuffer, 2);
+    publish(tripleBuffer, 3);
+    auto const front = tripleBuffer.frontBuffer();
+    CHECK(front.get().frameID == 3);
+
+    // The writer never gets the buffer held by the reader.
+    for (uint64_t i = 4; i < 10; ++i)
+    {
+        CHECK(&tripleBuffer.backBuffer() != &front.get());
+        publish(tripleBuffer, i);
+    }
+    CHECK(front.get().frameID == 3);
+    CHECK(tripleBuffer.frontBuffer().get().frameID == 9);
+}
+
+TEST_CASE("RenderTripleBuffer.threads", "[RenderBuffer]")
+{
+    auto tripleBuffer = RenderTripleBuffer {};
+    auto constexpr FrameCount = uint64_t { 100'000 };
+
+    auto writer = std::thread([&]() {
+        for (uint64_t i = 1; i <= FrameCount; ++i)
+        {
+            auto& back = tripleBuffer.backBuffer();
+            back.frameID = i;
+            back.cells.resize(i % 7); // fill with contents that a torn read would reveal
+            back.lines.resize(i % 7);
+            tripleBuffer.swapBuffers(std::chrono::steady_clock::now());
+        }
+    });
+
+    auto lastFrameID = uint64_t { 0 };
+    while (lastFrameID != FrameCount)
+    {
+        auto const front = tripleBuffer.frontBuffer();
+        auto const& buffer = front.get();
+        REQUIRE(buffer.frameID >= lastFrameID);
+        REQUIRE(buffer.cells.size() == buffer.frameID % 7);
+        REQUIRE(buffer.lines.size() == buffer.frameID % 7);
+        lastFrameID = buffer.frameID;
+    }
+    writer.join();
+}
@@ -3,6 +3,7 @@
 #include <vtbackend/InputGenerator.h>
 #include <vtbackend/Screen.h>
 #include <vtbackend/Terminal.h>
+#include <vtbackend/UnicodeTable.h>
 #include <vtbackend/VTType.h>
 #include <vtbackend/VTWriter.h>
 #include <vtbackend/logging.h>
@@ -18,13 +19,15 @@
 
 #include <libunicode/convert.h>
 #include <libunicode/emoji_segmenter.h>
-#include <libunicode/grapheme_segmenter.h>
+#include <libunicode/utf8.h>
 #include <libunicode/word_segmenter.h>
 
 #include <range/v3/view/iota.hpp>
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <iterator>
 #include <sstream>
@@ -42,7 +45,6 @@ using namespace std::string_view_literals;
 using crispy::escape;
 using crispy::for_each;
 using crispy::times;
-using crispy::toHexString;
 
 using gsl::span;
 
@@ -374,13 +376,6 @@ string_view Screen<Cell>::tryEmplaceChars(string_view chars, size_t cellCount) n
     if (!isFullHorizontalMargins())
         return chars;
 
-    // In case the charset has been altered, no
-    // optimization can be applied.
-    // Unless we're storing the charset in the TrivialLineBuffer, too.
-    // But for now that's too rare to be beneficial.
-    if (!_cursor.charsets.isSelected(CharsetId::USASCII))
-        return chars;
-
     crlfIfWrapPending();
 
     auto const columnsAvailable = pageSize().columns.value - _cursor.position.column.value;
@@ -390,6 +385,15 @@ string_view Screen<Cell>::tryEmplaceChars(string_view chars, size_t cellCount) n
         // With AutoWrap on, we can only emplace if it fits the line.
         return chars;
 
+    // A single shift (SS2, SS3) applies to the next character only, which is left to the cell-wise path.
+    if (_cursor.charsets.singleShiftPending())
+        return chars;
+
+    // In case the charset has been altered (e.g. to DEC Special Graphics for line drawing by ncurses),
+    // the text is translated, and kept in a buffer of its own.
+    if (!_cursor.charsets.isSelected(CharsetId::USASCII))
+        return emplaceTranslatedChars(chars, cellCount) ? chars.substr(chars.size()) : chars;
+
     if (_cursor.position.column.value == 0)
     {
         if (currentLine().empty())
@@ -407,17 +411,154 @@ string_view Screen<Cell>::tryEmplaceChars(string_view chars, size_t cellCount) n
         // We can append the chars to a pre-existing non-empty line.
         assert(static_cast<int>(cellCount) <= columnsAvailable);
         auto& lineBuffer = currentLine().trivialBuffer();
+        auto const usedColumns = lineBuffer.usedColumns + ColumnCount::cast_from(cellCount);
+        auto columnOffsets =
+            TrivialLineBuffer::computeColumnOffsets(chars, ColumnCount::cast_from(cellCount));
+        if (!columnOffsets || !columnOffsets->empty() || !lineBuffer.isAscii())
+        {
+            // Non-ASCII text is involved. The appended text may also join the last grapheme cluster.
+            columnOffsets = TrivialLineBuffer::computeColumnOffsets(
+                std::string_view(lineBuffer.text.data(), lineBuffer.text.size() + chars.size()), usedColumns);
+            if (!columnOffsets)
+                return chars;
+        }
         lineBuffer.text.growBy(chars.size());
-        lineBuffer.usedColumns += ColumnCount::cast_from(cellCount);
+        lineBuffer.usedColumns = usedColumns;
+        lineBuffer.columnOffsets = std::move(*columnOffsets);
         advanceCursorAfterWrite(ColumnCount::cast_from(cellCount));
         _terminal->currentPtyBuffer()->advanceHotEndUntil(chars.data() + chars.size());
         chars.remove_prefix(chars.size());
         return chars;
     }
 
+    if (currentLine().isTrivialBuffer() && !currentLine().empty()
+        && _cursor.position.column == boxed_cast<ColumnOffset>(currentLine().trivialBuffer().usedColumns))
+    {
+        // Text following translated text is copied next to it, such that the line remains trivial.
+        auto const appended = currentLine().trivialBuffer().text.owner() == _terminal->translatedTextBuffer()
+                                  ? appendTranslatedTextToCurrentLine(chars, cellCount)
+                                  : appendTextRunToCurrentLine(chars, cellCount);
+        if (appended)
+            chars.remove_prefix(chars.size());
+    }
+
     return chars;
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+bool Screen<Cell>::emplaceTranslatedChars(string_view chars, size_t cellCount) noexcept
+{
+    auto& line = currentLine();
+    if (!line.isTrivialBuffer())
+        return false;
+
+    _translatedText.clear();
+    _cursor.charsets.translate(chars, _translatedText);
+
+    if (!line.empty())
+        return _cursor.position.column == boxed_cast<ColumnOffset>(line.trivialBuffer().usedColumns)
+               && appendTranslatedTextToCurrentLine(_translatedText, cellCount);
+
+    if (_cursor.position.column.value != 0)
+        return false;
+
+    auto columnOffsets =
+        TrivialLineBuffer::computeColumnOffsets(_translatedText, ColumnCount::cast_from(cellCount));
+    if (!columnOffsets)
+        return false;
+    auto text = _terminal->storeTranslatedText(_translatedText);
+    if (!text)
+        return false;
+
+    line.setBuffer(TrivialLineBuffer { line.trivialBuffer().displayWidth,
+                                       _cursor.graphicsRendition,
+                                       line.trivialBuffer().fillAttributes,
+                                       _cursor.hyperlink,
+                                       ColumnCount::cast_from(cellCount),
+                                       std::move(*text),
+                                       std::move(*columnOffsets) });
+    advanceCursorAfterWrite(ColumnCount::cast_from(cellCount));
+    return true;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+bool Screen<Cell>::appendTranslatedTextToCurrentLine(string_view text, size_t cellCount) noexcept
+{
+    auto& lineBuffer = currentLine().trivialBuffer();
+    auto const attributesChanged = lineBuffer.lastAttributes() != _cursor.graphicsRendition
+                                   || lineBuffer.lastHyperlink() != _cursor.hyperlink;
+    if (attributesChanged && lineBuffer.spans.size() >= TrivialLineBuffer::MaxSpans)
+        return false;
+
+    auto columnOffsets = lineBuffer.columnOffsetsAppending(text, ColumnCount::cast_from(cellCount));
+    if (!columnOffsets)
+        return false;
+
+    // The text is appended in place if the line's text ends where the next translated text is stored.
+    auto const& buffer = _terminal->translatedTextBuffer();
+    if (buffer && lineBuffer.text.owner() == buffer
+        && lineBuffer.text.data() + lineBuffer.text.size() == buffer->hotEnd()
+        && text.size() <= buffer->bytesAvailable())
+    {
+        (void) buffer->writeAtEnd(text);
+        lineBuffer.text.growBy(text.size());
+    }
+    else if (auto moved = _terminal->storeTranslatedText(lineBuffer.text.view(), text))
+        lineBuffer.text = std::move(*moved);
+    else
+        return false;
+
+    if (attributesChanged)
+        lineBuffer.spans.emplace_back(TrivialLineSpan { boxed_cast<ColumnOffset>(lineBuffer.usedColumns),
+                                                        _cursor.graphicsRendition,
+                                                        _cursor.hyperlink });
+
+    lineBuffer.usedColumns += ColumnCount::cast_from(cellCount);
+    lineBuffer.columnOffsets = std::move(*columnOffsets);
+    advanceCursorAfterWrite(ColumnCount::cast_from(cellCount));
+    return true;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+bool Screen<Cell>::appendTextRunToCurrentLine(string_view chars, size_t cellCount) noexcept
+{
+    // The text has been interrupted by other sequences (most likely SGR) since the
+    // current line's text. If nothing references the bytes in between, which is the case
+    // if the line's text ends right at the hot end of the current PTY buffer,
+    // we can move the new text next to the line's text and keep the line trivial.
+    auto& lineBuffer = currentLine().trivialBuffer();
+    auto const& buffer = _terminal->currentPtyBuffer();
+    auto const* const textEnd = lineBuffer.text.data() + lineBuffer.text.size();
+    if (lineBuffer.text.owner() != buffer || textEnd != buffer->hotEnd() || chars.data() <= textEnd
+        || chars.data() + chars.size() > buffer->end())
+        return false;
+
+    auto const attributesChanged = lineBuffer.lastAttributes() != _cursor.graphicsRendition
+                                   || lineBuffer.lastHyperlink() != _cursor.hyperlink;
+    if (attributesChanged && lineBuffer.spans.size() >= TrivialLineBuffer::MaxSpans)
+        return false;
+
+    auto columnOffsets = lineBuffer.columnOffsetsAppending(chars, ColumnCount::cast_from(cellCount));
+    if (!columnOffsets)
+        return false;
+
+    if (attributesChanged)
+        lineBuffer.spans.emplace_back(TrivialLineSpan { boxed_cast<ColumnOffset>(lineBuffer.usedColumns),
+                                                        _cursor.graphicsRendition,
+                                                        _cursor.hyperlink });
+
+    std::memmove(buffer->hotEnd(), chars.data(), chars.size());
+    lineBuffer.text.growBy(chars.size());
+    lineBuffer.usedColumns += ColumnCount::cast_from(cellCount);
+    lineBuffer.columnOffsets = std::move(*columnOffsets);
+    advanceCursorAfterWrite(ColumnCount::cast_from(cellCount));
+    buffer->advanceHotEndUntil(textEnd + chars.size());
+    return true;
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 size_t Screen<Cell>::emplaceCharsIntoCurrentLine(string_view chars, size_t cellCount) noexcept
@@ -427,16 +568,22 @@ size_t Screen<Cell>::emplaceCharsIntoCurrentLine(string_view chars, size_t cellC
     assert(cellCount <= static_cast<size_t>(columnsAvailable));
 
     Line<Cell>& line = currentLine();
+
+    // Only use fastpath if the currently line hasn't been inflated already.
+    // Because we might lose prior-written textual/SGR information otherwise.
+    auto columnOffsets = std::optional<std::vector<uint16_t>> {};
     if (line.isTrivialBuffer() && line.empty())
+        columnOffsets = TrivialLineBuffer::computeColumnOffsets(chars, ColumnCount::cast_from(cellCount));
+
+    if (columnOffsets)
     {
-        // Only use fastpath if the currently line hasn't been inflated already.
-        // Because we might lose prior-written textual/SGR information otherwise.
         line.setBuffer(TrivialLineBuffer { line.trivialBuffer().displayWidth,
                                            _cursor.graphicsRendition,
                                            line.trivialBuffer().fillAttributes,
                                            _cursor.hyperlink,
                                            ColumnCount::cast_from(cellCount),
-                                           crispy::BufferFragment { _terminal->currentPtyBuffer(), chars } });
+                                           crispy::BufferFragment { _terminal->currentPtyBuffer(), chars },
+                                           std::move(*columnOffsets) });
         advanceCursorAfterWrite(ColumnCount::cast_from(cellCount));
     }
     else
@@ -485,11 +632,25 @@ void Screen<Cell>::writeText(string_view text, size_t cellCount)
 
     assert(cellCount <= static_cast<size_t>(pageSize().columns.value - _cursor.position.column.value));
 
+    auto const textSize = text.size();
     text = tryEmplaceChars(text, cellCount);
     if (text.empty())
+    {
+        _grid.countCommandOutput(textSize);
+        return;
+    }
+
+    // The line could not be kept trivial, so the text is written into the line's cells instead.
+    if (writeTextRunToCurrentLine(text, cellCount))
+    {
+        _grid.countCommandOutput(textSize);
         return;
+    }
+
+    // The text emplaced is counted here, and the rest by writeText(char32_t) it is passed to.
+    _grid.countCommandOutput(textSize - text.size());
 
-    // Making use of the optimized code path for the input characters did NOT work, so we need to first
+    // Making use of the optimized code paths for the input characters did NOT work, so we need to first
     // convert UTF-8 to UTF-32 codepoints (reusing the logic in VT parser) and pass these codepoints
     // to the grapheme cluster processor.
 
@@ -497,6 +658,72 @@ void Screen<Cell>::writeText(string_view text, size_t cellCount)
         _state->parser.printUtf8Byte(ch);
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+bool Screen<Cell>::writeTextRunToCurrentLine(string_view text, size_t cellCount)
+{
+    if (!isFullHorizontalMargins())
+        return false;
+
+    crlfIfWrapPending();
+
+    if (cellCount > pageSize().columns.as<size_t>() - _cursor.position.column.as<size_t>())
+        return false;
+
+    // Decode the whole run upfront, so that the resulting grapheme clusters can be written
+    // cell by cell without taking the detour through the VT parser for each codepoint.
+    static constexpr char32_t ReplacementCharacter { 0xFFFD };
+    auto& codepoints = _textRunCodepoints;
+    codepoints.clear();
+    auto utf8DecoderState = unicode::utf8_decoder_state {};
+    for (char const ch: text)
+    {
+        unicode::ConvertResult const r = unicode::from_utf8(utf8DecoderState, static_cast<uint8_t>(ch));
+        if (holds_alternative<unicode::Incomplete>(r))
+            continue;
+        codepoints += holds_alternative<unicode::Success>(r) ? get<unicode::Success>(r).value
+                                                             : ReplacementCharacter;
+    }
+    if (utf8DecoderState.expectedLength != 0)
+        return false; // The text ends within a UTF-8 sequence, which is left to the VT parser.
+
+    auto& line = currentLine();
+    auto preceding = precedingGraphicCharacter();
+    for (size_t i = 0; i < codepoints.size(); ++i)
+    {
+        if (_cursor.wrapPending)
+        {
+            // The run happened not to fit after all (e.g. a wide character at the right margin).
+            for (auto const codepoint: std::u32string_view(codepoints).substr(i))
+                writeTextInternal(codepoint);
+            return true;
+        }
+
+        auto const codepoint = _cursor.charsets.map(codepoints[i]);
+        if (UnicodeTable::breakable(preceding, codepoint))
+        {
+            auto const column = _cursor.position.column;
+            Cell& cell = line.useCellAt(column);
+            if (cell.isFlagEnabled(CellFlag::WideCharContinuation) && column > ColumnOffset(0))
+                line.useCellAt(column - 1).reset(); // Erase the left half of the wide char.
+
+            cell.write(_cursor.graphicsRendition,
+                       codepoint,
+                       static_cast<uint8_t>(UnicodeTable::width(codepoint)),
+                       _cursor.hyperlink);
+            _lastCursorPosition = _cursor.position;
+            clearAndAdvance(cell.width());
+        }
+        else if (auto const extendedWidth = usePreviousCell().appendCharacter(codepoint); extendedWidth > 0)
+            clearAndAdvance(extendedWidth);
+        preceding = codepoints[i];
+    }
+
+    _terminal->markCellDirty(_lastCursorPosition);
+    resetInstructionCounter();
+    return true;
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::writeTextEnd()
@@ -548,6 +775,8 @@ void Screen<Cell>::writeText(char32_t codepoint)
         _pendingCharTraceLog += unicode::convert_to<char>(codepoint);
 #endif
 
+    _grid.countCommandOutput(codepoint < 0x80 ? 1 : codepoint < 0x800 ? 2 : codepoint < 0x10000 ? 3 : 4);
+
     return writeTextInternal(codepoint);
 }
 
@@ -559,7 +788,7 @@ void Screen<Cell>::writeTextInternal(char32_t sourceCodepoint)
 
     char32_t const codepoint = _cursor.charsets.map(sourceCodepoint);
 
-    if (unicode::grapheme_segmenter::breakable(precedingGraphicCharacter(), codepoint))
+    if (UnicodeTable::breakable(precedingGraphicCharacter(), codepoint))
     {
         writeCharToCurrentAndAdvance(codepoint);
     }
@@ -597,7 +826,7 @@ void Screen<Cell>::writeCharToCurrentAndAdvance(char32_t codepoint) noexcept
 
     cell.write(_cursor.graphicsRendition,
                codepoint,
-               static_cast<uint8_t>(unicode::width(codepoint)),
+               static_cast<uint8_t>(UnicodeTable::width(codepoint)),
                _cursor.hyperlink);
 
     _lastCursorPosition = _cursor.position;
@@ -646,18 +875,22 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 std::string Screen<Cell>::screenshot(function<string(LineOffset)> const& postLine) const
 {
-    auto result = std::stringstream {};
-    auto writer = VTWriter(result);
-
-    for (int const line: ::ranges::views::iota(0, *pageSize().lines))
+    auto result = std::string {};
     {
-        writer.write(_grid.lineAt(LineOffset(line)));
-        if (postLine)
-            writer.write(postLine(LineOffset(line)));
-        writer.crlf();
+        auto writer = VTWriter(result);
+        for (int const line: ::ranges::views::iota(0, *pageSize().lines))
+        {
+            writer.write(_grid.lineAt(LineOffset(line)));
+            if (postLine)
+            {
+                writer.resetGraphicsRendition();
+                writer.write(postLine(LineOffset(line)));
+            }
+            writer.crlf();
+        }
+        writer.resetGraphicsRendition();
     }
-
-    return result.str();
+    return result;
 }
 
 template <typename Cell>
@@ -670,13 +903,7 @@ optional<LineOffset> Screen<Cell>::findMarkerUpwards(LineOffset startLine) const
     if (*startLine <= -*historyLineCount())
         return nullopt;
 
-    startLine = min(startLine, boxed_cast<LineOffset>(pageSize().lines - 1));
-
-    for (LineOffset i = startLine - 1; i >= -boxed_cast<LineOffset>(historyLineCount()); --i)
-        if (_grid.lineAt(i).marked())
-            return { i };
-
-    return nullopt;
+    return _grid.findMarkedLineAbove(min(startLine, boxed_cast<LineOffset>(pageSize().lines - 1)));
 }
 
 template <typename Cell>
@@ -690,13 +917,7 @@ optional<LineOffset> Screen<Cell>::findMarkerDownwards(LineOffset startLine) con
                                 -boxed_cast<LineOffset>(historyLineCount()),
                                 +boxed_cast<LineOffset>(pageSize().lines) - 1);
 
-    auto const bottom = LineOffset(0);
-
-    for (LineOffset i = top + 1; i <= bottom; ++i)
-        if (_grid.lineAt(i).marked())
-            return { i };
-
-    return nullopt;
+    return _grid.findMarkedLineBelow(top, LineOffset(0));
 }
 
 // {{{ tabs related
@@ -1265,22 +1486,11 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::insertChars(LineOffset lineOffset, ColumnCount columnsToInsert)
 {
-    auto const sanitizedN =
-        min(*columnsToInsert, *margin().horizontal.to - *logicalCursorPosition().column + 1);
-
-    auto column0 = _grid.lineAt(lineOffset).inflatedBuffer().begin() + *realCursorPosition().column;
-    auto column1 =
-        _grid.lineAt(lineOffset).inflatedBuffer().begin() + *margin().horizontal.to - sanitizedN + 1;
-    auto column2 = _grid.lineAt(lineOffset).inflatedBuffer().begin() + *margin().horizontal.to + 1;
-
-    rotate(column0, column1, column2);
-
-    for (Cell& cell:
-         _grid.lineAt(lineOffset)
-             .useRange(boxed_cast<ColumnOffset>(_cursor.position.column), ColumnCount::cast_from(sanitizedN)))
-    {
-        cell.write(_cursor.graphicsRendition, L' ', 1);
-    }
+    _grid.lineAt(lineOffset)
+        .insertCells(realCursorPosition().column,
+                     margin().horizontal.to,
+                     columnsToInsert,
+                     _cursor.graphicsRendition);
 }
 
 template <typename Cell>
@@ -1323,13 +1533,6 @@ void Screen<Cell>::copyArea(Rect sourceArea, int page, CellLocation targetTopLef
         // Copy to its own location => no-op.
         return;
 
-    auto const [x0, xInc, xEnd] = [&]() {
-        if (*targetTopLeft.column > *sourceArea.left) // moving right
-            return std::tuple { *sourceArea.right - *sourceArea.left, -1, -1 };
-        else
-            return std::tuple { 0, +1, *sourceArea.right - *sourceArea.left + 1 };
-    }();
-
     auto const [y0, yInc, yEnd] = [&]() {
         if (*targetTopLeft.line > *sourceArea.top) // moving down
             return std::tuple { *sourceArea.bottom - *sourceArea.top, -1, -1 };
@@ -1337,16 +1540,14 @@ void Screen<Cell>::copyArea(Rect sourceArea, int page, CellLocation targetTopLef
             return std::tuple { 0, +1, *sourceArea.bottom - *sourceArea.top + 1 };
     }();
 
+    // Overlapping columns within the same line are taken care of by copyRange().
+    auto const columnCount = ColumnCount::cast_from(*sourceArea.right - *sourceArea.left + 1);
     for (auto y = y0; y != yEnd; y += yInc)
     {
-        for (auto x = x0; x != xEnd; x += xInc)
-        {
-            Cell const& sourceCell =
-                at(LineOffset::cast_from(*sourceArea.top + y), ColumnOffset::cast_from(sourceArea.left + x));
-            Cell& targetCell = at(LineOffset::cast_from(targetTopLeft.line + y),
-                                  ColumnOffset::cast_from(targetTopLeft.column + x));
-            targetCell = sourceCell;
-        }
+        auto const& sourceLine = _grid.lineAt(LineOffset::cast_from(*sourceArea.top + y));
+        auto& targetLine = _grid.lineAt(LineOffset::cast_from(targetTopLeft.line + y));
+        targetLine.copyRange(
+            sourceLine, ColumnOffset::cast_from(*sourceArea.left), columnCount, targetTopLeft.column);
     }
 }
 
@@ -1361,14 +1562,8 @@ void Screen<Cell>::eraseArea(int top, int left, int bottom, int right)
         return;
 
     for (int y = top; y <= bottom; ++y)
-    {
-        for (Cell& cell: grid()
-                             .lineAt(LineOffset::cast_from(y))
-                             .useRange(ColumnOffset(left), ColumnCount(right - left + 1)))
-        {
-            cell.write(_cursor.graphicsRendition, L' ', 1);
-        }
-    }
+        _grid.lineAt(LineOffset::cast_from(y))
+            .fillRange(ColumnOffset(left), ColumnCount(right - left + 1), _cursor.graphicsRendition, L' ', 1);
 }
 
 template <typename Cell>
@@ -1379,17 +1574,14 @@ void Screen<Cell>::fillArea(char32_t ch, int top, int left, int bottom, int righ
     if (!(32 <= ch && ch <= 126) && !(160 <= ch && ch <= 255))
         return;
 
-    auto const w = static_cast<uint8_t>(unicode::width(ch));
+    auto const w = static_cast<uint8_t>(UnicodeTable::width(ch));
     for (int y = top; y <= bottom; ++y)
-    {
-        for (Cell& cell:
-             grid()
-                 .lineAt(LineOffset::cast_from(y))
-                 .useRange(ColumnOffset::cast_from(left), ColumnCount::cast_from(right - left + 1)))
-        {
-            cell.write(cursor().graphicsRendition, ch, w);
-        }
-    }
+        _grid.lineAt(LineOffset::cast_from(y))
+            .fillRange(ColumnOffset::cast_from(left),
+                       ColumnCount::cast_from(right - left + 1),
+                       cursor().graphicsRendition,
+                       ch,
+                       w);
 }
 
 template <typename Cell>
@@ -1416,20 +1608,8 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::deleteChars(LineOffset lineOffset, ColumnOffset column, ColumnCount columnsToDelete)
 {
-    auto& line = _grid.lineAt(lineOffset);
-    auto lineBuffer = line.cells();
-
-    Cell* left = const_cast<Cell*>(lineBuffer.data() + column.as<size_t>());
-    Cell* right = const_cast<Cell*>(lineBuffer.data() + *margin().horizontal.to + 1);
-    long const n = min(columnsToDelete.as<long>(), static_cast<long>(std::distance(left, right)));
-    Cell* mid = left + n;
-
-    rotate(left, mid, right);
-
-    for (Cell& cell: gsl::make_span(right - n, right))
-    {
-        cell.write(_cursor.graphicsRendition, L' ', 1);
-    }
+    _grid.lineAt(lineOffset)
+        .deleteCells(column, margin().horizontal.to, columnsToDelete, _cursor.graphicsRendition);
 }
 
 template <typename Cell>
@@ -1471,23 +1651,14 @@ CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::hyperlink(string id, string uri)
 {
     if (uri.empty())
-        _cursor.hyperlink = {};
-    else
     {
-        if (!id.empty())
-        {
-            _cursor.hyperlink = _state->hyperlinks.hyperlinkIdByUserId(id);
-            if (_cursor.hyperlink != HyperlinkId {})
-                return;
-        }
-        _cursor.hyperlink = _state->hyperlinks.nextHyperlinkId++;
-        _state->hyperlinks.cache.emplace(
-            _cursor.hyperlink, make_shared<HyperlinkInfo>(HyperlinkInfo { std::move(id), std::move(uri) }));
+        _cursor.hyperlink = {};
+        return;
     }
-    // TODO:
-    // Care about eviction.
-    // Move hyperlink store into ScreenBuffer, so it gets reset upon every switch into
-    // alternate screen (not for main screen!)
+
+    if (_state->hyperlinks.needsCollection())
+        _terminal->collectHyperlinks();
+    _cursor.hyperlink = _state->hyperlinks.acquire(std::move(id), std::move(uri));
 }
 
 template <typename Cell>
@@ -1597,13 +1768,95 @@ void Screen<Cell>::notify(string const& title, string const& content)
     _terminal->notify(title, content);
 }
 
+CapturedBufferEncoder::CapturedBufferEncoder(std::vector<LineTextSnapshot> lines, bool logicalLines):
+    _lines { std::move(lines) }, _logicalLines { logicalLines }
+{
+}
+
+void CapturedBufferEncoder::push(std::string& output, std::string_view data)
+{
+    if (data.empty())
+        return;
+    if (_chunkSize == 0) // initiate chunk
+        output += fmt::format("\033^{};", CaptureBufferCode);
+    else if (_chunkSize + data.size() >= MaxChunkSize)
+    {
+        vtCaptureBufferLog()("Transferred chunk of {} bytes.", _chunkSize);
+        output += "\033\\"; // ST
+        output += fmt::format("\033^{};", CaptureBufferCode);
+        _chunkSize = 0;
+    }
+    output += data;
+    _chunkSize += data.size();
+}
+
+void CapturedBufferEncoder::encode(std::string& output, size_t budget)
+{
+    auto const end = output.size() + budget;
+    while (!_finished && output.size() < end)
+    {
+        if (!_remainingText.empty())
+        {
+            // Chunks are split at UTF-8 sequence boundaries only.
+            auto const isContinuationByte = [&](size_t i) {
+                return (static_cast<uint8_t>(_remainingText[i]) & 0xC0) == 0x80;
+            };
+            auto n = std::min(_remainingText.size(), MaxChunkSize - 1);
+            while (n > 1 && n < _remainingText.size() && isContinuationByte(n))
+                --n;
+            push(output, _remainingText.substr(0, n));
+            _remainingText.remove_prefix(n);
+            if (_remainingText.empty())
+                _newlinePending = true;
+            continue;
+        }
+
+        if (_nextLine == _lines.size())
+        {
+            if (_newlinePending)
+                push(output, "\n"sv);
+            if (_chunkSize != 0)
+                output += "\033\\"; // ST
+            vtCaptureBufferLog()("Capturing buffer finished.");
+            output += fmt::format("\033^{};\033\\", CaptureBufferCode); // mark the end
+            _lines.clear();
+            _finished = true;
+            break;
+        }
+
+        auto const& line = _lines[_nextLine++];
+        auto const text = line.trimmedText(false, true);
+        if (text.empty())
+        {
+            vtCaptureBufferLog()("Skipping blank line");
+            continue;
+        }
+
+        // Logical lines continue on wrapped lines, so the line break is only emitted once it is known
+        // that the next line to be captured does not continue the current one.
+        if (_newlinePending && !(_logicalLines && line.wrapped()))
+            push(output, "\n"sv);
+        _newlinePending = false;
+
+        vtCaptureBufferLog()("NL ({} len)", text.size());
+        _remainingText = text;
+    }
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::captureBuffer(LineCount lineCount, bool logicalLines)
+{
+    replyCapturedBuffer(captureBufferSnapshot(lineCount, logicalLines), logicalLines);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+std::vector<LineTextSnapshot> Screen<Cell>::captureBufferSnapshot(LineCount lineCount, bool logicalLines)
 {
     // TODO: Unit test case! (for ensuring line numbering and limits are working as expected)
 
-    auto capturedBuffer = std::string();
+    _grid.reflowHistory();
 
     // TODO: when capturing lineCount < screenSize.lines, start at the lowest non-empty line.
     auto const relativeStartLine =
@@ -1611,59 +1864,26 @@ void Screen<Cell>::captureBuffer(LineCount lineCount, bool logicalLines)
                      : unbox(pageSize().lines - lineCount);
     auto const startLine =
         LineOffset::cast_from(clamp(relativeStartLine, -unbox(historyLineCount()), unbox(pageSize().lines)));
+    auto const bottomLine = boxed_cast<LineOffset>(pageSize().lines - 1);
 
     vtCaptureBufferLog()("Capture buffer: {} lines {}", lineCount, logicalLines ? "logical" : "actual");
-
-    size_t constexpr MaxChunkSize = 4096;
-    size_t currentChunkSize = 0;
-    auto const pushContent = [&](auto const data) -> void {
-        if (data.empty())
-            return;
-        if (currentChunkSize == 0) // initiate chunk
-            _terminal->reply("\033^{};", CaptureBufferCode);
-        else if (currentChunkSize + data.size() >= MaxChunkSize)
-        {
-            vtCaptureBufferLog()("Transferred chunk of {} bytes.", currentChunkSize);
-            _terminal->reply("\033\\"); // ST
-            _terminal->reply("\033^{};", CaptureBufferCode);
-            currentChunkSize = 0;
-        }
-        _terminal->reply(data);
-        currentChunkSize += data.size();
-    };
-    LineOffset const bottomLine = boxed_cast<LineOffset>(pageSize().lines - 1);
     vtCaptureBufferLog()("Capturing buffer. top: {}, bottom: {}", relativeStartLine, bottomLine);
 
-    for (LineOffset line = startLine; line <= bottomLine; ++line)
-    {
-        if (logicalLines && _grid.lineAt(line).wrapped() && !capturedBuffer.empty())
-            capturedBuffer.pop_back();
+    return _grid.textSnapshot(startLine, bottomLine);
+}
 
-        auto const& lineBuffer = _grid.lineAt(line);
-        auto lineCellsTrimmed = lineBuffer.trim_blank_right();
-        if (lineCellsTrimmed.empty())
-        {
-            vtCaptureBufferLog()("Skipping blank line {}", line);
-            continue;
-        }
-        auto const tl = lineCellsTrimmed.size();
-        while (!lineCellsTrimmed.empty())
-        {
-            auto const available = MaxChunkSize - currentChunkSize;
-            auto const n = min(available, lineCellsTrimmed.size());
-            for (auto const& cell: lineCellsTrimmed.subspan(0, n))
-                pushContent(cell.toUtf8());
-            lineCellsTrimmed = lineCellsTrimmed.subspan(n);
-        }
-        vtCaptureBufferLog()("NL ({} len)", tl);
-        pushContent("\n"sv);
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::replyCapturedBuffer(std::vector<LineTextSnapshot> lines, bool logicalLines)
+{
+    auto encoder = CapturedBufferEncoder { std::move(lines), logicalLines };
+    auto replies = std::string {};
+    while (!encoder.finished())
+    {
+        replies.clear();
+        encoder.encode(replies, CapturedBufferEncoder::MaxChunkSize);
+        _terminal->reply(replies);
     }
-
-    if (currentChunkSize != 0)
-        _terminal->reply("\033\\"); // ST
-
-    vtCaptureBufferLog()("Capturing buffer finished.");
-    _terminal->reply("\033^{};\033\\", CaptureBufferCode); // mark the end
 }
 
 template <typename Cell>
@@ -1795,6 +2015,38 @@ void Screen<Cell>::setMark()
     currentLine().setMarked(true);
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::startCommandPrompt()
+{
+    // Prompts are marked, too, such that jumping between them works the same as with SETMARK.
+    setMark();
+    _grid.startCommandPrompt(_cursor.position.line);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::startCommandInput()
+{
+    _grid.startCommandInput(_cursor.position.line);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::startCommandOutput()
+{
+    _grid.startCommandOutput(_cursor.position.line);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::finishCommand(std::optional<int> exitCode)
+{
+    // Output not ending in a newline still ends on the cursor's line.
+    auto const endLine = _cursor.position.line + (_cursor.position.column.value != 0 ? 1 : 0);
+    _grid.finishCommand(endLine, exitCode);
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::saveModes(std::vector<DECMode> const& modes)
@@ -1920,6 +2172,9 @@ void Screen<Cell>::sixelImage(ImageSize pixelSize, Image::Data&& rgbaData)
 
     if (!_terminal->isModeEnabled(DECMode::SixelCursorNextToGraphic))
         linefeed(topLeft.column);
+
+    if (_state->imagePool.overBudget())
+        evictImages();
 }
 
 template <typename Cell>
@@ -2003,6 +2258,33 @@ void Screen<Cell>::renderImage(shared_ptr<Image const> image,
     moveCursorToColumn(topLeft.column);
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::evictImages()
+{
+    auto& imagePool = _state->imagePool;
+    auto const imagesBefore = imagePool.stats().images;
+
+    for (auto line = -boxed_cast<LineOffset>(_grid.historyLineCount()); line < LineOffset(0); ++line)
+    {
+        if (!imagePool.overBudget())
+            break;
+
+        auto& gridLine = _grid.lineAt(line);
+        if (gridLine.isTrivialBuffer())
+            continue; // trivial lines do not hold images
+
+        for (Cell& cell: gridLine.inflatedBuffer())
+            if (cell.imageFragment())
+                cell.setCharacter(0);
+    }
+
+    auto const evicted = imagesBefore - imagePool.stats().images;
+    imagePool.recordEvictions(evicted);
+    if (evicted)
+        imageLog()("Evicted {} images from history. {}", evicted, imagePool.stats());
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::requestDynamicColor(DynamicColorName name)
@@ -2212,17 +2494,8 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 void Screen<Cell>::requestCapability(std::string_view name)
 {
-    if (booleanCapability(name))
-        _terminal->reply("\033P1+r{}\033\\", toHexString(name));
-    else if (auto const value = numericCapability(name); value != Database::Npos)
-    {
-        auto hexValue = fmt::format("{:X}", value);
-        if (hexValue.size() % 2)
-            hexValue.insert(hexValue.begin(), '0');
-        _terminal->reply("\033P1+r{}={}\033\\", toHexString(name), hexValue);
-    }
-    else if (auto const value = stringCapability(name); !value.empty())
-        _terminal->reply("\033P1+r{}={}\033\\", toHexString(name), asHex(value));
+    if (auto const reply = hexEncodedReply(name); !reply.empty())
+        _terminal->reply("\033P1+r{}\033\\", reply);
     else
         _terminal->reply("\033P0+r\033\\");
 }
@@ -2348,6 +2621,18 @@ void Screen<Cell>::inspect(std::string const& message, std::ostream& os) const
                            _grid.lineAt(lineNo).flags());
     });
     hline();
+    _grid.inspect(os);
+    hline();
+    auto const cellExtras = cellExtraPoolStats();
+    os << fmt::format("cell extras          : {} in use, {} slabs, {} reserved\n",
+                      cellExtras.extrasInUse,
+                      cellExtras.slabCount,
+                      crispy::humanReadableBytes(static_cast<long double>(cellExtras.bytesReserved)));
+    auto const ptyBuffers = _terminal->ptyBufferStats();
+    os << fmt::format("PTY buffer objects   : {} live, {} pinned, {} unused\n",
+                      ptyBuffers.liveBuffers,
+                      crispy::humanReadableBytes(static_cast<long double>(ptyBuffers.pinnedBytes)),
+                      crispy::humanReadableBytes(static_cast<long double>(ptyBuffers.unusedBytes)));
     _state->imagePool.inspect(os);
     hline();
 
@@ -2700,8 +2985,34 @@ namespace impl
             return Color {};
         }
 
+        /// SGR target accumulating the changes of a whole SGR sequence in the given attributes,
+        /// such that these are stored back to the cursor only once rather than per parameter.
+        class GraphicsAttributesDelta
+        {
+          public:
+            explicit GraphicsAttributesDelta(GraphicsAttributes& attributes) noexcept:
+                _attributes { attributes }
+            {
+            }
+
+            void setGraphicsRendition(GraphicsRendition rendition) noexcept
+            {
+                if (rendition == GraphicsRendition::Reset)
+                    _attributes = {};
+                else
+                    _attributes.flags = CellUtil::makeCellFlags(rendition, _attributes.flags);
+            }
+
+            void setForegroundColor(Color color) noexcept { _attributes.foregroundColor = color; }
+            void setBackgroundColor(Color color) noexcept { _attributes.backgroundColor = color; }
+            void setUnderlineColor(Color color) noexcept { _attributes.underlineColor = color; }
+
+          private:
+            GraphicsAttributes& _attributes;
+        };
+
         template <typename Target>
-        CRISPY_REQUIRES((CellConcept<Target> || std::is_same_v<Target, Terminal>) )
+        CRISPY_REQUIRES((CellConcept<Target> || std::is_same_v<Target, GraphicsAttributesDelta>) )
         ApplyResult applySGR(Target& target, Sequence const& seq, size_t parameterStart, size_t parameterEnd)
         {
             if (parameterStart == parameterEnd)
@@ -3078,7 +3389,11 @@ namespace impl
             auto const& params = seq.intermediateCharacters();
             if (auto const splits = crispy::split(params, ';'); splits.size() == 2 && splits[0] == "c")
             {
-                terminal.copyToClipboard(crispy::base64::decode(splits[1]));
+                // The sequencer decodes the contents while receiving them, see Sequencer::putOSC().
+                if (splits[1].empty())
+                    terminal.copyToClipboard(seq.dataString());
+                else
+                    terminal.copyToClipboard(crispy::base64::decode(splits[1]));
                 return ApplyResult::Ok;
             }
             else
@@ -3098,6 +3413,36 @@ namespace impl
                 return ApplyResult::Unsupported;
         }
 
+        template <typename Cell>
+        ApplyResult SEMANTICPROMPT(Sequence const& seq, Screen<Cell>& screen)
+        {
+            // OSC 133 ; A ST                  prompt start
+            // OSC 133 ; B ST                  command start (end of prompt)
+            // OSC 133 ; C ST                  command executed (start of output)
+            // OSC 133 ; D [; exit code] ST    command finished
+            //
+            // Any further parameters (e.g. "aid=..." of some shells) are ignored.
+            auto const& value = seq.intermediateCharacters();
+            auto const params = crispy::split(value, ';');
+            if (params.empty() || params[0].size() != 1)
+                return ApplyResult::Invalid;
+
+            switch (params[0][0])
+            {
+                case 'A': screen.startCommandPrompt(); return ApplyResult::Ok;
+                case 'B': screen.startCommandInput(); return ApplyResult::Ok;
+                case 'C': screen.startCommandOutput(); return ApplyResult::Ok;
+                case 'D': {
+                    auto exitCode = std::optional<int> {};
+                    if (params.size() > 1)
+                        exitCode = crispy::to_integer<10, int>(params[1]);
+                    screen.finishCommand(exitCode);
+                    return ApplyResult::Ok;
+                }
+                default: return ApplyResult::Unsupported;
+            }
+        }
+
         template <typename Cell>
         ApplyResult SETCWD(Sequence const& seq, Screen<Cell>& screen)
         {
@@ -3398,7 +3743,7 @@ void Screen<Cell>::processSequence(Sequence const& seq)
 #if defined(LIBTERMINAL_LOG_TRACE)
     if (vtTraceSequenceLog)
     {
-        if (auto const* fd = seq.functionDefinition(_terminal->activeSequences()))
+        if (auto const* fd = seq.functionDefinition(_terminal->supportedSequences()))
         {
             vtTraceSequenceLog()("Processing {:<14} {}", fd->documentation.mnemonic, seq.text());
         }
@@ -3411,11 +3756,25 @@ void Screen<Cell>::processSequence(Sequence const& seq)
     //         seq.functionDefinition() ? seq.functionDefinition()->comment : ""sv);
 
     _terminal->state().instructionCounter++;
-    if (FunctionDefinition const* funcSpec = seq.functionDefinition(_terminal->activeSequences());
+    if (FunctionDefinition const* funcSpec = seq.functionDefinition(_terminal->supportedSequences());
         funcSpec != nullptr)
+    {
+#if defined(LIBTERMINAL_SEQUENCE_STATS)
+        auto const start = std::chrono::steady_clock::now();
         applyAndLog(*funcSpec, seq);
-    else if (vtParserLog)
-        vtParserLog()("Unknown VT sequence: {}", seq);
+        _terminal->state().sequenceStats.record(*funcSpec, seq, std::chrono::steady_clock::now() - start);
+#else
+        applyAndLog(*funcSpec, seq);
+#endif
+    }
+    else
+    {
+#if defined(LIBTERMINAL_SEQUENCE_STATS)
+        _terminal->state().sequenceStats.recordUnknown();
+#endif
+        if (vtParserLog)
+            vtParserLog()("Unknown VT sequence: {}", seq);
+    }
 }
 
 template <typename Cell>
@@ -3742,7 +4101,13 @@ ApplyResult Screen<Cell>::apply(FunctionDefinition const& function, Sequence con
         case SCOSC: saveCursor(); break;
         case SD: scrollDown(seq.param_or<LineCount>(0, LineCount { 1 })); break;
         case SETMARK: setMark(); break;
-        case SGR: return impl::applySGR(*_terminal, seq, 0, seq.parameterCount());
+        case SGR: {
+            auto attributes = _cursor.graphicsRendition;
+            auto delta = impl::GraphicsAttributesDelta { attributes };
+            auto const result = impl::applySGR(delta, seq, 0, seq.parameterCount());
+            _cursor.graphicsRendition = attributes;
+            return result;
+        }
         case SM: {
             ApplyResult r = ApplyResult::Ok;
             crispy::for_each(crispy::times(seq.parameterCount()), [&](size_t i) {
@@ -3875,6 +4240,7 @@ ApplyResult Screen<Cell>::apply(FunctionDefinition const& function, Sequence con
         case RCOLORHIGHLIGHTFG: resetDynamicColor(DynamicColorName::HighlightForegroundColor); break;
         case RCOLORHIGHLIGHTBG: resetDynamicColor(DynamicColorName::HighlightBackgroundColor); break;
         case NOTIFY: return impl::NOTIFY(seq, *this);
+        case SEMANTICPROMPT: return impl::SEMANTICPROMPT(seq, *this);
         case DUMPSTATE: inspect(); break;
 
         // hooks
@@ -3925,6 +4291,9 @@ unique_ptr<ParserExtension> Screen<Cell>::hookSixel(Sequence const& seq)
                                              clamp(_terminal->state().maxImageRegisterCount, 0u, 16384u))
             : _terminal->state().imageColorPalette);
 
+    _lastSixelPreview = std::chrono::steady_clock::now();
+    _sixelImageBuilder->setBandCompleteHandler([this]() { sixelPreview(); });
+
     return make_unique<SixelParser>(*_sixelImageBuilder, [this]() {
         {
             sixelImage(_sixelImageBuilder->size(), std::move(_sixelImageBuilder->data()));
@@ -3932,6 +4301,45 @@ unique_ptr<ParserExtension> Screen<Cell>::hookSixel(Sequence const& seq)
     });
 }
 
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+void Screen<Cell>::sixelPreview()
+{
+    auto const now = std::chrono::steady_clock::now();
+    if (now - _lastSixelPreview < _terminal->refreshInterval().value)
+        return;
+    _lastSixelPreview = now;
+
+    auto const pixelSize = _sixelImageBuilder->completedSize();
+    if (!*pixelSize.height)
+        return;
+
+    // Place the preview where sixelImage() will place the final image, without scrolling or moving
+    // the cursor. Lines not yet fitting onto the page are left to the final image.
+    auto const autoScrollAtBottomMargin = !_terminal->isModeEnabled(DECMode::NoSixelScrolling);
+    auto const topLeft = autoScrollAtBottomMargin ? logicalCursorPosition() : CellLocation {};
+    auto const cellSize = _state->cellPixelSize;
+    auto const lineCount =
+        min(LineCount::cast_from(ceilf(float(*pixelSize.height) / float(*cellSize.height))),
+            pageSize().lines - topLeft.line.as<LineCount>());
+    auto const columnCount =
+        min(ColumnCount::cast_from(ceilf(float(*pixelSize.width) / float(*cellSize.width))),
+            pageSize().columns - topLeft.column.as<ColumnCount>());
+    if (!*lineCount || !*columnCount)
+        return;
+
+    auto const extent = GridSize { lineCount, columnCount };
+    auto imageRef = uploadImage(ImageFormat::RGBA, pixelSize, _sixelImageBuilder->completedData());
+    auto const rasterizedImage = make_shared<RasterizedImage>(
+        std::move(imageRef), ImageAlignment::TopStart, ImageResize::NoResize, RGBAColor {}, extent, cellSize);
+    for (GridSize::Offset const offset: extent)
+    {
+        Cell& cell = at(topLeft + offset);
+        cell.setImageFragment(rasterizedImage, CellLocation { offset.line, offset.column });
+        cell.setHyperlink(_cursor.hyperlink);
+    }
+}
+
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 unique_ptr<ParserExtension> Screen<Cell>::hookSTP(Sequence const& /*seq*/)
@@ -4009,24 +4417,45 @@ unique_ptr<ParserExtension> Screen<Cell>::hookDECRQSS(Sequence const& /*seq*/)
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 optional<CellLocation> Screen<Cell>::search(std::u32string_view searchText, CellLocation startPosition)
+{
+    return search(searchText, startPosition, boxed_cast<LineOffset>(pageSize().lines) - 1);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+optional<CellLocation> Screen<Cell>::search(std::u32string_view searchText,
+                                            CellLocation startPosition,
+                                            LineOffset bottomMostLine)
 {
     // TODO use LogicalLines to spawn logical lines for improving the search on wrapped lines.
 
     if (searchText.empty())
         return nullopt;
 
+    _grid.reflowHistoryFrom(startPosition.line);
+
     // First try match at start location.
     if (_grid.lineAt(startPosition.line).matchTextAt(searchText, startPosition.column))
         return startPosition;
 
-    // Search reverse until found or exhausted.
-    auto lines = _grid.logicalLinesFrom(startPosition.line);
-    for (auto& line: lines)
+    // Search until found or exhausted, skipping the history lines ruled out by the search index.
+    auto lines = _grid.logicalLinesFrom(startPosition.line, bottomMostLine);
+    for (auto line = lines.begin(); line != lines.end();)
     {
-        auto result = line.search(searchText, startPosition.column);
+        if (auto const candidate = _grid.nextSearchCandidate(line->top, searchText); candidate != line->top)
+        {
+            if (candidate > bottomMostLine)
+                return nullopt;
+            lines = _grid.logicalLinesFrom(candidate, bottomMostLine);
+            line = lines.begin();
+            startPosition.column = ColumnOffset(0);
+            continue;
+        }
+        auto result = line->search(searchText, startPosition.column);
         if (result.has_value())
             return result; // new match found
         startPosition.column = ColumnOffset(0);
+        ++line;
     }
     return nullopt;
 }
@@ -4034,24 +4463,95 @@ optional<CellLocation> Screen<Cell>::search(std::u32string_view searchText, Cell
 template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 optional<CellLocation> Screen<Cell>::searchReverse(std::u32string_view searchText, CellLocation startPosition)
+{
+    return searchReverse(searchText, startPosition, -boxed_cast<LineOffset>(historyLineCount()));
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+optional<CellLocation> Screen<Cell>::searchReverse(std::u32string_view searchText,
+                                                   CellLocation startPosition,
+                                                   LineOffset topMostLine)
 {
     // TODO use LogicalLinesReverse to spawn logical lines for improving the search on wrapped lines.
 
     if (searchText.empty())
         return nullopt;
 
+    _grid.reflowHistory();
+
     // First try match at start location.
     if (_grid.lineAt(startPosition.line).matchTextAt(searchText, startPosition.column))
         return startPosition;
 
-    // Search reverse until found or exhausted.
-    auto lines = _grid.logicalLinesReverseFrom(startPosition.line);
-    for (auto const& line: lines)
+    // Search reverse until found or exhausted, skipping the history lines ruled out by the search index.
+    auto lines = _grid.logicalLinesReverseFrom(startPosition.line, topMostLine);
+    for (auto line = lines.begin(); line != lines.end();)
     {
-        auto result = line.searchReverse(searchText, startPosition.column);
+        auto const candidate = _grid.previousSearchCandidate((*line).bottom, searchText);
+        if (!candidate || *candidate < topMostLine)
+            return nullopt;
+        if (*candidate != (*line).bottom)
+        {
+            lines = _grid.logicalLinesReverseFrom(*candidate, topMostLine);
+            line = lines.begin();
+            startPosition.column = boxed_cast<ColumnOffset>(pageSize().columns) - 1;
+            continue;
+        }
+        auto result = (*line).searchReverse(searchText, startPosition.column);
         if (result.has_value())
             return result; // new match found
         startPosition.column = boxed_cast<ColumnOffset>(pageSize().columns) - 1;
+        ++line;
+    }
+    return nullopt;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+optional<CellLocation> Screen<Cell>::search(crispy::regex_dfa const& regex, CellLocation startPosition)
+{
+    return search(regex, startPosition, boxed_cast<LineOffset>(pageSize().lines) - 1);
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+optional<CellLocation> Screen<Cell>::search(crispy::regex_dfa const& regex,
+                                            CellLocation startPosition,
+                                            LineOffset bottomMostLine)
+{
+    _grid.reflowHistoryFrom(startPosition.line);
+
+    // The search index only knows about literal text, so that no lines can be skipped here.
+    for (auto const& line: _grid.logicalLinesFrom(startPosition.line, bottomMostLine))
+    {
+        if (auto result = line.search(regex, startPosition.column))
+            return result;
+        startPosition.column = ColumnOffset(0);
+    }
+    return nullopt;
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+optional<CellLocation> Screen<Cell>::searchReverse(crispy::regex_dfa const& regex, CellLocation startPosition)
+{
+    return searchReverse(regex, startPosition, -boxed_cast<LineOffset>(historyLineCount()));
+}
+
+template <typename Cell>
+CRISPY_REQUIRES(CellConcept<Cell>)
+optional<CellLocation> Screen<Cell>::searchReverse(crispy::regex_dfa const& regex,
+                                                   CellLocation startPosition,
+                                                   LineOffset topMostLine)
+{
+    _grid.reflowHistory();
+
+    for (auto const& line: _grid.logicalLinesReverseFrom(startPosition.line, topMostLine))
+    {
+        if (auto result = line.searchReverse(regex, startPosition.column))
+            return result;
+        startPosition.column = boxed_cast<ColumnOffset>(pageSize().columns) - 1;
     }
     return nullopt;
 }
@@ -4073,3 +4573,6 @@ template class vtbackend::Screen<vtbackend::CompactCell>;
 
 #include <vtbackend/cell/SimpleCell.h>
 template class vtbackend::Screen<vtbackend::SimpleCell>;
+
+#include <vtbackend/cell/FlatCell.h>
+template class vtbackend::Screen<vtbackend::FlatCell>;
@@ -17,6 +17,7 @@
 
 #include <crispy/algorithm.h>
 #include <crispy/logstore.h>
+#include <crispy/regex_dfa.h>
 #include <crispy/size.h>
 #include <crispy/utils.h>
 
@@ -28,11 +29,13 @@
 #include <gsl/pointers>
 
 #include <algorithm>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace vtbackend
@@ -56,6 +59,8 @@ class ScreenBase: public SequenceHandler
     [[nodiscard]] virtual bool isCellEmpty(CellLocation position) const noexcept = 0;
     [[nodiscard]] virtual bool compareCellTextAt(CellLocation position, char codepoint) const noexcept = 0;
     [[nodiscard]] virtual std::string cellTextAt(CellLocation position) const noexcept = 0;
+    [[nodiscard]] virtual std::pair<char32_t, size_t> leadingCodepointAt(
+        CellLocation position) const noexcept = 0;
     [[nodiscard]] virtual LineFlags lineFlagsAt(LineOffset line) const noexcept = 0;
     virtual void enableLineFlags(LineOffset lineOffset, LineFlags flags, bool enable) noexcept = 0;
     [[nodiscard]] virtual bool isLineFlagEnabledAt(LineOffset line, LineFlags flags) const noexcept = 0;
@@ -69,6 +74,9 @@ class ScreenBase: public SequenceHandler
     [[nodiscard]] virtual std::shared_ptr<HyperlinkInfo const> hyperlinkAt(
         CellLocation pos) const noexcept = 0;
     virtual void inspect(std::string const& message, std::ostream& os) const = 0;
+
+    /// Marks the hyperlinks referenced by the lines and cursors of this screen in @p referenced.
+    virtual void markHyperlinks(std::vector<bool>& referenced) const = 0;
     virtual void moveCursorTo(LineOffset line, ColumnOffset column) = 0; // CUP
     virtual void updateCursorIterator() noexcept = 0;
 
@@ -76,12 +84,49 @@ class ScreenBase: public SequenceHandler
                                                              CellLocation startPosition) = 0;
     [[nodiscard]] virtual std::optional<CellLocation> searchReverse(std::u32string_view searchText,
                                                                     CellLocation startPosition) = 0;
+    [[nodiscard]] virtual std::optional<CellLocation> search(crispy::regex_dfa const& regex,
+                                                             CellLocation startPosition) = 0;
+    [[nodiscard]] virtual std::optional<CellLocation> searchReverse(crispy::regex_dfa const& regex,
+                                                                    CellLocation startPosition) = 0;
 
   protected:
     Cursor _cursor {};
     Cursor _savedCursor {};
 };
 
+/**
+ * Encodes captured lines into the replies to a buffer capture request, `PM 314 ; <text> ST` each,
+ * terminated by an empty one.
+ *
+ * The replies are encoded a bounded number of bytes at a time, so that capturing the whole history
+ * can be streamed at the pace the application reads it, instead of being buffered as a whole.
+ */
+class CapturedBufferEncoder
+{
+  public:
+    /// Maximum number of bytes of captured text per reply.
+    static constexpr size_t MaxChunkSize = 4096;
+
+    CapturedBufferEncoder(std::vector<LineTextSnapshot> lines, bool logicalLines);
+
+    /// Appends the next replies, of at least @p budget bytes unless finished, to @p output.
+    void encode(std::string& output, size_t budget);
+
+    /// Tells whether all replies, including the terminating one, have been encoded.
+    [[nodiscard]] bool finished() const noexcept { return _finished; }
+
+  private:
+    void push(std::string& output, std::string_view data);
+
+    std::vector<LineTextSnapshot> _lines;
+    bool _logicalLines;
+    size_t _nextLine = 0;
+    std::string_view _remainingText; // of the line being encoded
+    bool _newlinePending = false;
+    size_t _chunkSize = 0; // of the reply being encoded, if any
+    bool _finished = false;
+};
+
 /**
  * Terminal Screen.
  *
@@ -130,11 +175,9 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
 
     /// Renders the full screen by passing every grid cell to the callback.
     template <typename Renderer>
-    RenderPassHints render(Renderer&& render,
-                           ScrollOffset scrollOffset = {},
-                           HighlightSearchMatches highlightSearchMatches = HighlightSearchMatches::Yes) const
+    RenderPassHints render(Renderer&& render, ScrollOffset scrollOffset = {}) const
     {
-        return _grid.render(std::forward<Renderer>(render), scrollOffset, highlightSearchMatches);
+        return _grid.render(std::forward<Renderer>(render), scrollOffset);
     }
 
     /// Renders the full screen as text into the given string. Each line will be terminated by LF.
@@ -219,6 +262,12 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
     void reverseIndex(); // RI
 
     void setMark();
+
+    // Shell integration (OSC 133), see Grid::startCommandPrompt() and friends.
+    void startCommandPrompt();
+    void startCommandInput();
+    void startCommandOutput();
+    void finishCommand(std::optional<int> exitCode);
     void setScrollSpeed(int speed);      // DECSSCLS
     void deviceStatusReport();           // DSR
     void reportCursorPosition();         // CPR
@@ -239,6 +288,14 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
 
     void captureBuffer(LineCount lineCount, bool logicalLines);
 
+    /// Takes a snapshot of the lines to be captured, which requires the terminal to be locked.
+    [[nodiscard]] std::vector<LineTextSnapshot> captureBufferSnapshot(LineCount lineCount, bool logicalLines);
+
+    /// Replies the captured lines to the application, which may be done without holding the terminal lock.
+    ///
+    /// @see CapturedBufferEncoder for replying them at the pace the application reads them instead.
+    void replyCapturedBuffer(std::vector<LineTextSnapshot> lines, bool logicalLines);
+
     void setForegroundColor(Color color);
     void setBackgroundColor(Color color);
     void setUnderlineColor(Color color);
@@ -282,6 +339,13 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
                      ImageResize resizePolicy,
                      bool autoScroll);
 
+    /// Releases the images referenced by the oldest history lines for as long as the image pool
+    /// exceeds its memory budget.
+    ///
+    /// Images are owned by the grid cells displaying them, so the least recently displayed images
+    /// are the ones furthest up in the history. Lines of the main page are never touched.
+    void evictImages();
+
     void inspect(std::string const& message, std::ostream& os) const override;
 
     // for DECSC and DECRC
@@ -412,6 +476,28 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
     [[nodiscard]] std::optional<CellLocation> searchReverse(std::u32string_view searchText,
                                                             CellLocation startPosition) override;
 
+    /// Searches like search(), but only through the logical lines starting at or above @p bottomMostLine.
+    [[nodiscard]] std::optional<CellLocation> search(std::u32string_view searchText,
+                                                     CellLocation startPosition,
+                                                     LineOffset bottomMostLine);
+
+    /// Searches like searchReverse(), but only through the logical lines ending at or below @p topMostLine.
+    [[nodiscard]] std::optional<CellLocation> searchReverse(std::u32string_view searchText,
+                                                            CellLocation startPosition,
+                                                            LineOffset topMostLine);
+
+    /// Searches for the given regular expression, matching it against the text of each logical line.
+    [[nodiscard]] std::optional<CellLocation> search(crispy::regex_dfa const& regex,
+                                                     CellLocation startPosition) override;
+    [[nodiscard]] std::optional<CellLocation> searchReverse(crispy::regex_dfa const& regex,
+                                                            CellLocation startPosition) override;
+    [[nodiscard]] std::optional<CellLocation> search(crispy::regex_dfa const& regex,
+                                                     CellLocation startPosition,
+                                                     LineOffset bottomMostLine);
+    [[nodiscard]] std::optional<CellLocation> searchReverse(crispy::regex_dfa const& regex,
+                                                            CellLocation startPosition,
+                                                            LineOffset topMostLine);
+
     [[nodiscard]] Cell& usePreviousCell() noexcept
     {
         return useCellAt(_lastCursorPosition.line, _lastCursorPosition.column);
@@ -427,6 +513,8 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
     [[nodiscard]] Line<Cell>& currentLine() noexcept
     {
 #if defined(LIBTERMINAL_CACHE_CURRENT_LINE_POINTER)
+        // The cached pointer bypasses the grid's dirty line tracking.
+        _grid.markLineDirty(_cursor.position.line);
         return *_currentLine;
 #else
         return _grid.lineAt(_cursor.position.line);
@@ -515,8 +603,18 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
 
     [[nodiscard]] bool compareCellTextAt(CellLocation position, char codepoint) const noexcept override
     {
-        auto const& cell = _grid.lineAt(position.line).inflatedBuffer().at(position.column.as<size_t>());
-        return CellUtil::compareText(cell, codepoint);
+        auto const [leadingCodepoint, count] = leadingCodepointAt(position);
+        if (count != 1)
+            return codepoint == 0 && count == 0;
+        return leadingCodepoint == static_cast<char32_t>(codepoint);
+    }
+
+    /// @returns the first codepoint of the given cell (or 0 if it holds none), along with the number
+    ///          of codepoints it holds, without inflating its line.
+    [[nodiscard]] std::pair<char32_t, size_t> leadingCodepointAt(
+        CellLocation position) const noexcept override
+    {
+        return _grid.lineAt(position.line).leadingCodepointAt(position.column);
     }
 
     // IMPORTANT: Invokig inflatedBuffer() is expensive. This function should be invoked with caution.
@@ -533,6 +631,8 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
     void enableLineFlags(LineOffset lineOffset, LineFlags flags, bool enable) noexcept override
     {
         _grid.lineAt(lineOffset).setFlag(flags, enable);
+        if (*lineOffset < 0 && flags.contains(LineFlag::Marked))
+            _grid.invalidateMarkIndex();
     }
 
     [[nodiscard]] bool isLineFlagEnabledAt(LineOffset line, LineFlags flags) const noexcept override
@@ -565,7 +665,7 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
         if (line.isTrivialBuffer())
         {
             TrivialLineBuffer const& lineBuffer = line.trivialBuffer();
-            return lineBuffer.hyperlink;
+            return lineBuffer.hyperlinkAt(position.column);
         }
         return at(position).hyperlink();
     }
@@ -577,6 +677,14 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
 
     [[nodiscard]] HyperlinkStorage const& hyperlinks() const noexcept { return _state->hyperlinks; }
 
+    void markHyperlinks(std::vector<bool>& referenced) const override
+    {
+        _grid.markHyperlinks(referenced);
+        for (auto const id: { _cursor.hyperlink, _savedCursor.hyperlink })
+            if (id.value < referenced.size())
+                referenced[id.value] = true;
+    }
+
     void resetInstructionCounter() noexcept { _state->instructionCounter = 0; }
     [[nodiscard]] uint64_t instructionCounter() const noexcept { return _state->instructionCounter; }
     [[nodiscard]] char32_t precedingGraphicCharacter() const noexcept
@@ -605,7 +713,21 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
     /// @returns the string view of the UTF-8 text that could not be emplaced.
     std::string_view tryEmplaceChars(std::string_view chars, size_t cellCount) noexcept;
     size_t emplaceCharsIntoCurrentLine(std::string_view chars, size_t cellCount) noexcept;
+    [[nodiscard]] bool appendTextRunToCurrentLine(std::string_view chars, size_t cellCount) noexcept;
+
+    /// Emplaces the given characters translated by the selected charset (e.g. DEC Special Graphics)
+    /// into the current trivial line, storing the translated text by Terminal::storeTranslatedText().
+    [[nodiscard]] bool emplaceTranslatedChars(std::string_view chars, size_t cellCount) noexcept;
+
+    /// Appends a copy of the given (translated) UTF-8 text to the current trivial line,
+    /// moving the line's text along into the terminal's buffer for translated text if need be.
+    [[nodiscard]] bool appendTranslatedTextToCurrentLine(std::string_view text, size_t cellCount) noexcept;
     [[nodiscard]] bool isContiguousToCurrentLine(std::string_view continuationChars) const noexcept;
+
+    /// Writes the given UTF-8 text, known to fit into the current line, into the line's cells in one go.
+    ///
+    /// @returns false if the text cannot be written in bulk, having applied at most a pending line wrap.
+    [[nodiscard]] bool writeTextRunToCurrentLine(std::string_view text, size_t cellCount);
     void advanceCursorAfterWrite(ColumnCount n) noexcept;
 
     void clearAllTabs();
@@ -629,6 +751,10 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
 
     [[nodiscard]] std::unique_ptr<ParserExtension> hookSTP(Sequence const& seq);
     [[nodiscard]] std::unique_ptr<ParserExtension> hookSixel(Sequence const& seq);
+
+    /// Displays the sixel bands decoded so far, at most once per refresh interval, while the image is
+    /// still being transmitted. The final image replaces the preview once the DCS is terminated.
+    void sixelPreview();
     [[nodiscard]] std::unique_ptr<ParserExtension> hookDECRQSS(Sequence const& seq);
     [[nodiscard]] std::unique_ptr<ParserExtension> hookXTGETTCAP(Sequence const& seq);
 
@@ -644,6 +770,13 @@ class Screen final: public ScreenBase, public capabilities::StaticDatabase
     Line<Cell>* _currentLine = nullptr;
 #endif
     std::unique_ptr<SixelImageBuilder> _sixelImageBuilder;
+    std::chrono::steady_clock::time_point _lastSixelPreview {};
+
+    // Scratch buffer for the decoded codepoints of writeTextRunToCurrentLine().
+    std::u32string _textRunCodepoints;
+
+    // Scratch buffer for the text translated by emplaceTranslatedChars().
+    std::string _translatedText;
 
 #if defined(LIBTERMINAL_LOG_TRACE)
     std::atomic<bool> _logCharTrace = true;
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/MockTerm.h>
+#include <vtbackend/Screen.h>
+#include <vtbackend/primitives.h>
+
+#include <fmt/format.h>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <chrono>
+#include <string>
+
+using namespace vtbackend;
+
+// The screens use the configured PrimaryScreenCell, whereas the Grid benchmarks cover each cell type.
+
+namespace
+{
+
+auto constexpr PageSizes = std::array { PageSize { LineCount(25), ColumnCount(80) },
+                                        PageSize { LineCount(60), ColumnCount(200) } };
+
+// Fills the page with colored text, as typically shown by e.g. a compiler or a directory listing.
+void writeTypicalPage(MockTerm<>& mc)
+{
+    auto const pageSize = mc.terminal.pageSize();
+    auto text = std::string {};
+    for (auto line = 0; line < unbox<int>(pageSize.lines); ++line)
+    {
+        if (line != 0)
+            text += "\r\n";
+        auto column = 0;
+        for (auto word = 0; column + 10 <= unbox<int>(pageSize.columns); ++word, column += 10)
+            text += fmt::format("\033[{}m{:>9} ", 31 + (line + word) % 7, line * 100 + word);
+        text += "\033[m";
+    }
+    mc.writeToScreen(text);
+}
+
+} // namespace
+
+TEST_CASE("Screen.insertChars_deleteChars", "[!benchmark][screen]")
+{
+    for (auto const pageSize: PageSizes)
+    {
+        auto mc = MockTerm { pageSize };
+        writeTypicalPage(mc);
+        auto& screen = mc.terminal.primaryScreen();
+        mc.writeToScreen("\033[1;5H");
+
+        BENCHMARK(fmt::format("{} ICH+DCH on each line", pageSize))
+        {
+            for (auto line = 0; line < unbox<int>(pageSize.lines); ++line)
+            {
+                screen.insertChars(LineOffset(line), ColumnCount(8));
+                screen.deleteChars(LineOffset(line), ColumnOffset(4), ColumnCount(8));
+            }
+        };
+    }
+}
+
+TEST_CASE("Screen.fillArea", "[!benchmark][screen]")
+{
+    for (auto const pageSize: PageSizes)
+    {
+        auto mc = MockTerm { pageSize };
+        writeTypicalPage(mc);
+        auto& screen = mc.terminal.primaryScreen();
+        auto const bottom = unbox<int>(pageSize.lines) - 1;
+        auto const right = unbox<int>(pageSize.columns) - 1;
+
+        BENCHMARK(fmt::format("{} full page", pageSize))
+        {
+            screen.fillArea(U'x', 0, 0, bottom, right);
+        };
+        BENCHMARK(fmt::format("{} inner rectangle", pageSize))
+        {
+            screen.fillArea(U'x', 2, 10, bottom - 2, right - 10);
+        };
+    }
+}
+
+TEST_CASE("RenderBufferBuilder", "[!benchmark][screen]")
+{
+    for (auto const pageSize: PageSizes)
+    {
+        auto mc = MockTerm { pageSize };
+        mc.terminal.tick(std::chrono::steady_clock::now());
+        writeTypicalPage(mc);
+        mc.terminal.refreshRenderBuffer();
+
+        // Toggling reverse video changes how every line renders, so no line of earlier frames is reused.
+        auto reverseVideo = false;
+        BENCHMARK(fmt::format("{} full page", pageSize))
+        {
+            reverseVideo = !reverseVideo;
+            mc.writeToScreen(reverseVideo ? "\033[?5h" : "\033[?5l");
+            return mc.terminal.refreshRenderBuffer();
+        };
+
+        auto counter = 0;
+        BENCHMARK(fmt::format("{} one modified line", pageSize))
+        {
+            mc.writeToScreen(fmt::format("\033[5;1H{:>9}", ++counter));
+            return mc.terminal.refreshRenderBuffer();
+        };
+    }
+}
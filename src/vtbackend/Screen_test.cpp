@@ -136,6 +136,80 @@ MockTerm<vtpty::MockPty> screenForDECRA()
 // }}}
 
 // {{{ writeText
+// Non-ASCII text is kept in trivial lines, too.
+TEST_CASE("writeText.bulk.Unicode", "[screen]")
+{
+    auto mock = MockTerm(PageSize { LineCount(3), ColumnCount(8) }, LineCount(2));
+    auto& screen = mock.terminal.primaryScreen();
+    mock.writeToScreen("\u2502 \u2705ab\r\n");
+    logScreenText(screen, "final state");
+    CHECK(screen.grid().lineAt(LineOffset(0)).isTrivialBuffer());
+    CHECK(screen.grid().lineAt(LineOffset(0)).cellWidthAt(ColumnOffset(2)) == 2);
+    CHECK(screen.grid().lineText(LineOffset(0)) == "\u2502 \u2705ab  ");
+    CHECK(screen.cursor().position == CellLocation { LineOffset(1), ColumnOffset(0) });
+}
+
+// Non-ASCII text that cannot be kept in a trivial line is written into the line's cells in bulk.
+TEST_CASE("writeText.bulk.Unicode_inflated", "[screen]")
+{
+    auto mock = MockTerm(PageSize { LineCount(3), ColumnCount(8) }, LineCount(2));
+    auto& screen = mock.terminal.primaryScreen();
+    mock.writeToScreen("abcdefgh\033[1;3H\u4E2D\u6587e\u0301");
+    logScreenText(screen, "final state");
+    CHECK_FALSE(screen.grid().lineAt(LineOffset(0)).isTrivialBuffer());
+    CHECK(screen.grid().lineText(LineOffset(0)) == "ab\u4E2D\u6587e\u0301h");
+    CHECK(screen.at(LineOffset(0), ColumnOffset(2)).width() == 2);
+    CHECK(screen.at(LineOffset(0), ColumnOffset(3)).isFlagEnabled(CellFlag::WideCharContinuation));
+    CHECK(screen.at(LineOffset(0), ColumnOffset(6)).codepointCount() == 2);
+    CHECK(screen.cursor().position == CellLocation { LineOffset(0), ColumnOffset(7) });
+}
+
+// Text interrupted by SGR sequences is kept in a trivial line with attribute spans.
+TEST_CASE("writeText.bulk.SGR_spans", "[screen]")
+{
+    auto mock = MockTerm(PageSize { LineCount(3), ColumnCount(8) }, LineCount(2));
+    auto& screen = mock.terminal.primaryScreen();
+    mock.writeToScreen("ab\033[31mcd\033[mef\r\n");
+    logScreenText(screen, "final state");
+
+    auto const& line = screen.grid().lineAt(LineOffset(0));
+    REQUIRE(line.isTrivialBuffer());
+    CHECK(line.trivialBuffer().text.view() == "abcdef");
+    CHECK(line.trivialBuffer().spans.size() == 2);
+
+    CHECK(screen.grid().lineText(LineOffset(0)) == "abcdef  ");
+    CHECK(screen.at(LineOffset(0), ColumnOffset(1)).foregroundColor() == DefaultColor());
+    CHECK(screen.at(LineOffset(0), ColumnOffset(2)).foregroundColor() == Color::Indexed(IndexedColor::Red));
+    CHECK(screen.at(LineOffset(0), ColumnOffset(3)).foregroundColor() == Color::Indexed(IndexedColor::Red));
+    CHECK(screen.at(LineOffset(0), ColumnOffset(4)).foregroundColor() == DefaultColor());
+}
+
+// Text written in DEC Special Graphics (as by ncurses for line drawing) is kept in a trivial line, too.
+TEST_CASE("writeText.bulk.DEC_special_graphics", "[screen]")
+{
+    auto mock = MockTerm(PageSize { LineCount(3), ColumnCount(8) }, LineCount(2));
+    auto& screen = mock.terminal.primaryScreen();
+    mock.writeToScreen("\033(0lqq\033(B ab \033(0k\033(B\r\n");
+    logScreenText(screen, "final state");
+
+    auto const& line = screen.grid().lineAt(LineOffset(0));
+    REQUIRE(line.isTrivialBuffer());
+    CHECK(line.trivialBuffer().text.view() == "\u250C\u2500\u2500 ab \u2510");
+    CHECK(screen.grid().lineText(LineOffset(0)) == "\u250C\u2500\u2500 ab \u2510 ");
+    CHECK(screen.cursor().position == CellLocation { LineOffset(1), ColumnOffset(0) });
+}
+
+// A single shift (SS2/SS3) applies to the next character only, which is written cell by cell.
+TEST_CASE("writeText.bulk.single_shift", "[screen]")
+{
+    auto mock = MockTerm(PageSize { LineCount(3), ColumnCount(8) }, LineCount(2));
+    auto& screen = mock.terminal.primaryScreen();
+    mock.writeToScreen("\033(0\033Nqq");
+    logScreenText(screen, "final state");
+    CHECK(screen.grid().lineText(LineOffset(0)) == "q\u2500      ");
+    CHECK(screen.cursor().position == CellLocation { LineOffset(0), ColumnOffset(2) });
+}
+
 // AutoWrap disabled: text length is less then available columns in line.
 TEST_CASE("writeText.bulk.A.1", "[screen]")
 {
@@ -2715,6 +2789,55 @@ TEST_CASE("captureBuffer", "[screen]")
     }
 }
 
+TEST_CASE("captureBufferSnapshot", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(3), ColumnCount(5) }, LineCount { 5 } };
+    auto& screen = mock.terminal.primaryScreen();
+    mock.writeToScreen("abc\r\nde");
+
+    auto const lines = screen.captureBufferSnapshot(LineCount(3), false);
+    REQUIRE(lines.size() == 3);
+
+    // The snapshot is unaffected by later changes to the screen.
+    mock.writeToScreen("\033[HXYZ\033[2;1H\033[1mF");
+    CHECK(lines[0].trimmedText() == "abc");
+    CHECK(lines[1].trimmedText() == "de");
+    CHECK(lines[2].trimmedText().empty());
+
+    screen.replyCapturedBuffer(lines, false);
+    CHECK(e(mock.terminal.peekInput()) == e("\033^314;abc\nde\n\033\\\033^314;\033\\"));
+}
+
+TEST_CASE("CapturedBufferEncoder", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(5) }, LineCount { 5 } };
+    auto& screen = mock.terminal.primaryScreen();
+    mock.writeToScreen("12345\r\n67890\r\nABCDE\r\nFGHIJ\r\nKLMNO");
+
+    // Encoding a few bytes at a time yields the same replies as encoding them all at once.
+    auto encoder = CapturedBufferEncoder { screen.captureBufferSnapshot(LineCount(5), false), false };
+    auto replies = std::string {};
+    auto steps = 0;
+    while (!encoder.finished())
+    {
+        auto const size = replies.size();
+        encoder.encode(replies, 3);
+        CHECK(replies.size() > size);
+        ++steps;
+    }
+    CHECK(steps > 1);
+    CHECK(e(replies) == e("\033^314;12345\n67890\nABCDE\nFGHIJ\nKLMNO\n\033\\\033^314;\033\\"));
+}
+
+TEST_CASE("screenshot", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(3) } };
+    mock.writeToScreen("\033[31mAB\r\nCD\033[m");
+
+    // The graphics rendition is carried across lines, and trailing blank cells are skipped.
+    CHECK(e(mock.terminal.primaryScreen().screenshot()) == e("\033[31mAB\r\nCD\r\n\033[m"));
+}
+
 TEST_CASE("render into history", "[screen]")
 {
     auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(5) }, LineCount { 5 } };
@@ -3024,6 +3147,59 @@ TEST_CASE("searchReverse", "[screen]")
     }
 }
 
+TEST_CASE("searchRegex", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(3), ColumnCount(8) }, LineCount(10) };
+    mock.writeToScreen("x E42 y\r\n"); // -2: history
+    mock.writeToScreen("E7\r\n");      // -1: history
+    mock.writeToScreen("zzz E1234 q"); //  0: main screen, wrapping into the next line
+    mock.writeToScreen("\r\nend");     //  2: main screen
+
+    auto& screen = mock.terminal.primaryScreen();
+    REQUIRE(screen.historyLineCount() == LineCount(2));
+
+    auto const compile = [](std::u32string_view pattern) {
+        auto regex = crispy::regex_dfa::compile(pattern);
+        REQUIRE(regex.has_value());
+        return std::move(regex).value();
+    };
+    auto const number = compile(U"E\\d+");
+
+    for (bool const inflate: { false, true })
+    {
+        INFO(fmt::format("Perform tests via {}", inflate ? "inflated buffer" : "stored buffer"));
+        if (inflate)
+            for (auto lineOffset = LineOffset(-2); lineOffset < LineOffset(3); ++lineOffset)
+                (void) screen.grid().lineAt(lineOffset).inflatedBuffer();
+
+        CHECK(screen.search(number, CellLocation { LineOffset(-2), ColumnOffset(0) })
+              == CellLocation { LineOffset(-2), ColumnOffset(2) });
+        CHECK(screen.search(number, CellLocation { LineOffset(-2), ColumnOffset(3) })
+              == CellLocation { LineOffset(-1), ColumnOffset(0) });
+        CHECK(screen.search(number, CellLocation { LineOffset(-1), ColumnOffset(1) })
+              == CellLocation { LineOffset(0), ColumnOffset(4) });
+        CHECK(!screen.search(number, CellLocation { LineOffset(0), ColumnOffset(5) }).has_value());
+
+        CHECK(screen.searchReverse(number, CellLocation { LineOffset(2), ColumnOffset(7) })
+              == CellLocation { LineOffset(0), ColumnOffset(4) });
+        CHECK(screen.searchReverse(number, CellLocation { LineOffset(0), ColumnOffset(3) })
+              == CellLocation { LineOffset(-1), ColumnOffset(0) });
+
+        // Matches may span the lines of a logical line.
+        CHECK(screen.search(compile(U"3\\d q"), CellLocation { LineOffset(-2), ColumnOffset(0) })
+              == CellLocation { LineOffset(0), ColumnOffset(7) });
+        CHECK(screen.search(compile(U"\\d q$"), CellLocation { LineOffset(-2), ColumnOffset(0) })
+              == CellLocation { LineOffset(1), ColumnOffset(0) });
+
+        // Anchors refer to the beginning and end of logical lines.
+        CHECK(screen.search(compile(U"^E\\d+$"), CellLocation { LineOffset(-2), ColumnOffset(0) })
+              == CellLocation { LineOffset(-1), ColumnOffset(0) });
+
+        // The bounded search only looks at the logical lines starting at or above the given line.
+        CHECK(!screen.search(number, CellLocation { LineOffset(-2), ColumnOffset(3) }, LineOffset(-2)));
+    }
+}
+
 TEST_CASE("findMarkerDownwards", "[screen]")
 {
     auto mock = MockTerm { PageSize { LineCount(3), ColumnCount(4) }, LineCount(10) };
@@ -3306,8 +3482,13 @@ TEST_CASE("XTGETTCAP")
     auto const queryStr = fmt::format("\033P+q{:02X}{:02X}{:02X}\033\\", 'R', 'G', 'B');
     mock.writeToScreen(queryStr);
     INFO(fmt::format("Reply data: {}", mock.terminal.peekInput()));
-    // "\033P1+r8/8/8\033\\"
-    // TODO: CHECK(...)
+    CHECK(e(mock.terminal.peekInput()) == e("\033P1+r524742=382F382F38\033\\"));
+    mock.resetReplyData();
+
+    // Several capabilities queried at once, by terminfo name and by termcap code, and an unknown one.
+    mock.writeToScreen("\033P+q636F6C6F7273;626C;7878\033\\");
+    CHECK(e(mock.terminal.peekInput())
+          == e("\033P1+r636F6C6F7273=0100\033\\\033P1+r626C=5E47\033\\\033P0+r\033\\"));
 }
 
 TEST_CASE("setMaxHistoryLineCount", "[screen]")
@@ -3685,6 +3866,99 @@ TEST_CASE("Sixel.status_line", "[screen]")
     }
 }
 
+TEST_CASE("Sixel.progressive", "[screen]")
+{
+    auto const pageSize = PageSize { LineCount(11), ColumnCount(11) };
+    auto mock = MockTerm { pageSize, LineCount(11) };
+    mock.terminal.setCellPixelSize(ImageSize { Width(10), Height(10) });
+    mock.terminal.setRefreshRate(RefreshRate { 1'000'000.0 }); // do not throttle previews
+
+    // Transmit the first four sixel bands (24 pixel rows) only.
+    auto splitOffset = size_t { 0 };
+    for (int band = 0; band < 4; ++band)
+        splitOffset = chessBoard.find('-', splitOffset) + 1;
+    mock.writeToScreen(chessBoard.substr(0, splitOffset));
+
+    auto const& screen = mock.terminal.primaryScreen();
+    CHECK(screen.cursor().position == CellLocation { LineOffset(0), ColumnOffset(0) });
+    for (auto line = LineOffset(0); line < LineOffset(3); ++line)
+        for (auto column = ColumnOffset(0); column < ColumnOffset(10); ++column)
+            CHECK(screen.at(line, column).imageFragment());
+    CHECK(!screen.at(LineOffset(3), ColumnOffset(0)).imageFragment());
+
+    // The final image replaces the preview.
+    mock.writeToScreen(chessBoard.substr(splitOffset));
+    CHECK(screen.cursor().position.line == LineOffset(10));
+    for (auto line = LineOffset(0); line < LineOffset(10); ++line)
+    {
+        auto const fragment = screen.at(line, ColumnOffset(0)).imageFragment();
+        REQUIRE(fragment);
+        CHECK(fragment->rasterizedImage().cellSpan().lines == LineCount(10));
+        CHECK(fragment->data() == (line.value % 2 ? white10x10 : black10x10));
+    }
+}
+
+TEST_CASE("Sixel.evict_history_images", "[screen]")
+{
+    auto const pageSize = PageSize { LineCount(5), ColumnCount(11) };
+    auto mock = MockTerm { pageSize, LineCount(40) };
+    mock.terminal.setCellPixelSize(ImageSize { Width(10), Height(10) });
+    mock.terminal.setMode(DECMode::NoSixelScrolling, false);
+    mock.terminal.setMaxImageMemory(50'000); // room for one 100x100 RGBA image
+
+    auto const& imagePool = mock.terminal.state().imagePool;
+
+    mock.writeToScreen(chessBoard);
+    REQUIRE(imagePool.stats().images == 1);
+    CHECK(imagePool.stats().bytes == 100 * 100 * 4);
+
+    // The second image scrolls the first one into the history, where it gets evicted.
+    // Its squares are red rather than white, as identical images would be shared instead.
+    auto redChessBoard = chessBoard;
+    redChessBoard.replace(redChessBoard.find("#1;2;100;100;100"), 16, "#1;2;100;0;0");
+    mock.writeToScreen(redChessBoard);
+    CHECK(imagePool.stats().images == 1);
+    CHECK(imagePool.stats().evictions == 1);
+    CHECK(!imagePool.overBudget());
+
+    auto const& screen = mock.terminal.primaryScreen();
+    auto const oldestLine = -boxed_cast<LineOffset>(screen.historyLineCount());
+    CHECK(!screen.at(oldestLine, ColumnOffset(0)).imageFragment());
+    CHECK(screen.at(LineOffset(0), ColumnOffset(0)).imageFragment());
+}
+
+TEST_CASE("Sixel.deduplicate_images", "[screen]")
+{
+    auto const pageSize = PageSize { LineCount(5), ColumnCount(11) };
+    auto mock = MockTerm { pageSize, LineCount(40) };
+    mock.terminal.setCellPixelSize(ImageSize { Width(10), Height(10) });
+    mock.terminal.setMode(DECMode::NoSixelScrolling, false);
+
+    auto const& imagePool = mock.terminal.state().imagePool;
+    auto const& screen = mock.terminal.primaryScreen();
+
+    // Drawing the same image again reuses the image alive already, keeping its image ID.
+    mock.writeToScreen(chessBoard);
+    auto const firstImage = screen.at(LineOffset(0), ColumnOffset(0)).imageFragment();
+    REQUIRE(firstImage);
+    auto const firstImageId = firstImage->rasterizedImage().image().id();
+    mock.writeToScreen(chessBoard);
+    CHECK(imagePool.stats().images == 1);
+    CHECK(imagePool.stats().bytes == 100 * 100 * 4);
+    CHECK(imagePool.stats().duplicates == 1);
+    CHECK(imagePool.stats().bytesSaved == 100 * 100 * 4);
+    auto const secondImage = screen.at(LineOffset(0), ColumnOffset(0)).imageFragment();
+    REQUIRE(secondImage);
+    CHECK(secondImage->rasterizedImage().image().id() == firstImageId);
+
+    // Images differing in their pixels are not shared.
+    auto redChessBoard = chessBoard;
+    redChessBoard.replace(redChessBoard.find("#1;2;100;100;100"), 16, "#1;2;100;0;0");
+    mock.writeToScreen(redChessBoard);
+    CHECK(imagePool.stats().images == 2);
+    CHECK(imagePool.stats().duplicates == 1);
+}
+
 TEST_CASE("DECSTR", "[screen]")
 {
     // Create a 10x3x5 grid and render a 7x5 image causing one a line-scroll by one.
@@ -3757,3 +4031,61 @@ TEST_CASE("LS1 and LS0", "[screen]")
 // TODO: DeviceStatusReport
 // TODO: SendDeviceAttributes
 // TODO: SendTerminalId
+
+TEST_CASE("CellExtraPool", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(3), ColumnCount(8) }, LineCount(10) };
+    auto const extrasBefore = cellExtraPoolStats().extrasInUse;
+
+    // Bold text requires a CellExtra for each of its cells.
+    mock.writeToScreen("\033[1mHELLO\033[m");
+    CHECK(cellExtraPoolStats().extrasInUse >= extrasBefore + 5);
+    CHECK(cellExtraPoolStats().bytesReserved > 0);
+
+    // Erasing the cells returns their extras back into the pool.
+    mock.writeToScreen("\033[2J\033[3J");
+    CHECK(cellExtraPoolStats().extrasInUse == extrasBefore);
+}
+
+TEST_CASE("OSC.133.command_blocks", "[screen]")
+{
+    auto mock = MockTerm { PageSize { LineCount(2), ColumnCount(10) }, LineCount(10) };
+    auto& grid = mock.terminal.primaryScreen().grid();
+
+    mock.writeToScreen("\033]133;A\033\\$ \033]133;B\033\\false\r\n\033]133;C\033\\"); // -3
+    mock.writeToScreen("out1\r\nout2\r\n\033]133;D;1\033\\");                         // -2, -1
+    mock.writeToScreen("\033]133;A\033\\$ \033]133;B\033\\true\r\n\033]133;C\033\\");  //  0
+    mock.writeToScreen("\033]133;D;0\033\\\033]133;A\033\\$ ");                        //  1
+
+    REQUIRE(grid.historyLineCount() == LineCount(3));
+    CHECK(grid.commandBlockCount() == 3);
+
+    auto const* last = grid.lastCommandBlock();
+    REQUIRE(last != nullptr);
+    CHECK(last->exitCode == 0);
+    CHECK(!last->failed());
+
+    auto const* failed = grid.commandBlockAt(LineOffset(-2));
+    REQUIRE(failed != nullptr);
+    CHECK(failed->failed());
+    CHECK(failed->outputBytes == 8);
+    CHECK(grid.commandOutputSnapshot(*failed, LineOffset(1)).size() == 2);
+
+    CHECK(grid.findFailedCommandAbove(LineOffset(1)) == LineOffset(-3));
+    CHECK(!grid.findFailedCommandBelow(LineOffset(-3), LineOffset(1)).has_value());
+
+    // Folding takes the output out of the history, and unfolding puts it back in place.
+    CHECK(grid.toggleCommandOutputFold(LineOffset(-2)) == LineOffset(-1));
+    CHECK(grid.historyLineCount() == LineCount(1));
+    CHECK(grid.lineTextTrimmed(LineOffset(-1)) == "$ false");
+    CHECK(grid.lineTextTrimmed(LineOffset(0)) == "$ true");
+    CHECK(grid.commandBlockAt(LineOffset(-1))->foldedLines == LineCount(2));
+    CHECK(grid.commandOutputSnapshot(*grid.commandBlockAt(LineOffset(-1)), LineOffset(1)).size() == 2);
+
+    CHECK(grid.toggleCommandOutputFold(LineOffset(-1)) == LineOffset(-3));
+    CHECK(grid.historyLineCount() == LineCount(3));
+    CHECK(grid.lineTextTrimmed(LineOffset(-3)) == "$ false");
+    CHECK(grid.lineTextTrimmed(LineOffset(-2)) == "out1");
+    CHECK(grid.lineTextTrimmed(LineOffset(-1)) == "out2");
+    CHECK(grid.lineTextTrimmed(LineOffset(0)) == "$ true");
+}
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/SearchIndex.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace vtbackend
+{
+
+namespace
+{
+    constexpr uint64_t trigramHash(char32_t a, char32_t b, char32_t c) noexcept
+    {
+        // Codepoints are at most 21 bits wide, so that a trigram fits into 63 bits.
+        auto const key = (uint64_t { a } << 42) | (uint64_t { b } << 21) | uint64_t { c };
+        return key * 0x9E3779B97F4A7C15llu;
+    }
+
+    template <typename Filter>
+    constexpr std::array<size_t, 2> filterBits(uint64_t hash) noexcept
+    {
+        constexpr auto Mask = (std::size(Filter {}) * 64) - 1;
+        return { static_cast<size_t>(hash >> 50) & Mask, static_cast<size_t>(hash >> 36) & Mask };
+    }
+} // namespace
+
+void SearchIndex::reset(uint64_t nextLine) noexcept
+{
+    _blocks.clear();
+    _endLine = nextLine;
+    _tail = {};
+}
+
+void SearchIndex::addLine(std::u32string_view text, bool wrapped)
+{
+    if (_blocks.empty() || (!wrapped && _endLine - _blocks.back().firstLine >= MinLinesPerBlock))
+        _blocks.emplace_back(Block { _endLine });
+
+    auto& filter = _blocks.back().filter;
+    auto window = wrapped ? _tail : std::array<char32_t, 2> {};
+    for (auto const codepoint: text)
+    {
+        // Trigrams with unmatchable cells can never be part of a match.
+        if (window[0] && window[1] && codepoint)
+            for (auto const bit: filterBits<Filter>(trigramHash(window[0], window[1], codepoint)))
+                filter[bit / 64] |= uint64_t { 1 } << (bit % 64);
+        window = { window[1], codepoint };
+    }
+    _tail = window;
+    ++_endLine;
+}
+
+void SearchIndex::dropBefore(uint64_t line)
+{
+    while (!_blocks.empty() && blockEnd(0) <= line)
+        _blocks.pop_front();
+}
+
+std::optional<uint64_t> SearchIndex::nextCandidate(uint64_t line, std::u32string_view text) const
+{
+    if (text.size() < 3 || line < firstLine() || line >= _endLine)
+        return line;
+
+    for (auto i = blockIndexOf(line); i < _blocks.size(); ++i)
+        if (mayContain(_blocks[i].filter, text))
+            return std::max(line, _blocks[i].firstLine);
+
+    return std::nullopt;
+}
+
+std::optional<uint64_t> SearchIndex::previousCandidate(uint64_t line, std::u32string_view text) const
+{
+    if (text.size() < 3 || line < firstLine() || line >= _endLine)
+        return line;
+
+    for (auto i = blockIndexOf(line) + 1; i > 0; --i)
+        if (mayContain(_blocks[i - 1].filter, text))
+            return std::min(line, blockEnd(i - 1) - 1);
+
+    return std::nullopt;
+}
+
+uint64_t SearchIndex::blockEnd(size_t index) const noexcept
+{
+    return index + 1 < _blocks.size() ? _blocks[index + 1].firstLine : _endLine;
+}
+
+size_t SearchIndex::blockIndexOf(uint64_t line) const noexcept
+{
+    auto const i = std::upper_bound(
+        _blocks.begin(), _blocks.end(), line, [](uint64_t a, Block const& b) { return a < b.firstLine; });
+    return static_cast<size_t>(std::distance(_blocks.begin(), i)) - 1;
+}
+
+bool SearchIndex::mayContain(Filter const& filter, std::u32string_view text) noexcept
+{
+    for (size_t i = 2; i < text.size(); ++i)
+        for (auto const bit: filterBits<Filter>(trigramHash(text[i - 2], text[i - 1], text[i])))
+            if (!(filter[bit / 64] & (uint64_t { 1 } << (bit % 64))))
+                return false;
+    return true;
+}
+
+} // namespace vtbackend
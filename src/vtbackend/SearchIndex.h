@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string_view>
+
+namespace vtbackend
+{
+
+/**
+ * Trigram index over the text of a sequence of lines, used to rule out lines that cannot contain a given
+ * search term without having to look at them.
+ *
+ * Lines are identified by consecutive numbers and grouped into blocks of at least MinLinesPerBlock lines.
+ * A block only ever ends in front of a line that starts a new logical line, such that no logical line
+ * spans two blocks. Each block records the trigrams of its text in a fixed size Bloom filter, so a block
+ * may only contain the search term if all of the term's trigrams are recorded.
+ *
+ * The index yields false positives but never false negatives.
+ */
+class SearchIndex
+{
+  public:
+    static constexpr size_t MinLinesPerBlock = 64;
+
+    [[nodiscard]] bool empty() const noexcept { return _blocks.empty(); }
+    [[nodiscard]] size_t blockCount() const noexcept { return _blocks.size(); }
+
+    /// @returns the first line that is indexed.
+    [[nodiscard]] uint64_t firstLine() const noexcept { return empty() ? _endLine : _blocks.front().firstLine; }
+
+    /// @returns the line past the last indexed line, which is the line to be added next.
+    [[nodiscard]] uint64_t endLine() const noexcept { return _endLine; }
+
+    /// Drops all blocks and continues indexing with line @p nextLine.
+    void reset(uint64_t nextLine) noexcept;
+
+    /// Indexes the text of the line endLine().
+    ///
+    /// @param text     one codepoint per cell, with 0 for cells that cannot be matched (e.g. empty cells)
+    /// @param wrapped  whether the line continues the logical line of the previously added line
+    void addLine(std::u32string_view text, bool wrapped);
+
+    /// Drops all blocks that only contain lines before @p line.
+    void dropBefore(uint64_t line);
+
+    /// @returns the first line at or after @p line that may contain @p text,
+    ///          or std::nullopt if no line from @p line up to endLine() does.
+    ///          Lines that are not indexed always may contain @p text.
+    [[nodiscard]] std::optional<uint64_t> nextCandidate(uint64_t line, std::u32string_view text) const;
+
+    /// @returns the last line at or before @p line that may contain @p text,
+    ///          or std::nullopt if no line from firstLine() down to @p line does.
+    ///          Lines that are not indexed always may contain @p text.
+    [[nodiscard]] std::optional<uint64_t> previousCandidate(uint64_t line, std::u32string_view text) const;
+
+  private:
+    static constexpr size_t FilterBits = 16384;
+    using Filter = std::array<uint64_t, FilterBits / 64>;
+
+    struct Block
+    {
+        uint64_t firstLine;
+        Filter filter {};
+    };
+
+    [[nodiscard]] uint64_t blockEnd(size_t index) const noexcept;
+    [[nodiscard]] size_t blockIndexOf(uint64_t line) const noexcept;
+    [[nodiscard]] static bool mayContain(Filter const& filter, std::u32string_view text) noexcept;
+
+    std::deque<Block> _blocks;
+    uint64_t _endLine = 0;
+
+    // The last two codepoints added, carried over into lines continuing the same logical line.
+    std::array<char32_t, 2> _tail {};
+};
+
+} // namespace vtbackend
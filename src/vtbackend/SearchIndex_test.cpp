@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/SearchIndex.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+using namespace std;
+using namespace vtbackend;
+
+namespace
+{
+
+void addLines(SearchIndex& index, size_t count, u32string_view text = U"some filler text")
+{
+    for (size_t i = 0; i < count; ++i)
+        index.addLine(text, false);
+}
+
+} // namespace
+
+TEST_CASE("SearchIndex.empty", "[SearchIndex]")
+{
+    auto index = SearchIndex {};
+    index.reset(100);
+    CHECK(index.empty());
+    CHECK(index.firstLine() == 100);
+    CHECK(index.endLine() == 100);
+    CHECK(index.nextCandidate(100, U"needle") == 100u);
+    CHECK(index.previousCandidate(99, U"needle") == 99u);
+}
+
+TEST_CASE("SearchIndex.blocks", "[SearchIndex]")
+{
+    auto index = SearchIndex {};
+    index.reset(10);
+    addLines(index, SearchIndex::MinLinesPerBlock);
+    CHECK(index.blockCount() == 1);
+
+    // Wrapped lines never start a new block.
+    index.addLine(U"continued", true);
+    CHECK(index.blockCount() == 1);
+
+    addLines(index, 1);
+    CHECK(index.blockCount() == 2);
+    CHECK(index.firstLine() == 10);
+    CHECK(index.endLine() == 10 + SearchIndex::MinLinesPerBlock + 2);
+
+    index.dropBefore(10 + SearchIndex::MinLinesPerBlock);
+    CHECK(index.blockCount() == 2);
+    index.dropBefore(10 + SearchIndex::MinLinesPerBlock + 1);
+    CHECK(index.blockCount() == 1);
+    CHECK(index.firstLine() == 10 + SearchIndex::MinLinesPerBlock + 1);
+}
+
+TEST_CASE("SearchIndex.candidates", "[SearchIndex]")
+{
+    auto constexpr N = SearchIndex::MinLinesPerBlock;
+
+    auto index = SearchIndex {};
+    index.reset(0);
+    // Blocks [0, N), [N, 2N) with the needle, and [2N, 3N).
+    addLines(index, N);
+    addLines(index, N / 2);
+    index.addLine(U"the needle is here", false);
+    addLines(index, N / 2 - 1);
+    addLines(index, N);
+    REQUIRE(index.blockCount() == 3);
+
+    CHECK(index.nextCandidate(0, U"needle") == N);
+    CHECK(index.nextCandidate(N + 5, U"needle") == N + 5);
+    CHECK(index.nextCandidate(2 * N, U"needle") == nullopt);
+    CHECK(index.previousCandidate(3 * N - 1, U"needle") == 2 * N - 1);
+    CHECK(index.previousCandidate(N + 3, U"needle") == N + 3);
+    CHECK(index.previousCandidate(N - 1, U"needle") == nullopt);
+
+    // Search terms without trigrams may be anywhere.
+    CHECK(index.nextCandidate(2 * N, U"ne") == 2 * N);
+
+    // Lines that are not indexed may always contain the search term.
+    CHECK(index.nextCandidate(3 * N, U"needle") == 3 * N);
+}
+
+TEST_CASE("SearchIndex.wrapped", "[SearchIndex]")
+{
+    auto constexpr N = SearchIndex::MinLinesPerBlock;
+
+    auto index = SearchIndex {};
+    index.reset(0);
+    addLines(index, N);
+    index.addLine(U"split nee", false);
+    index.addLine(U"dle", true);
+    addLines(index, N);
+    index.addLine(U"not a nee", false);
+    index.addLine(U"dle", false);
+
+    CHECK(index.nextCandidate(0, U"needle") == N);
+    CHECK(index.nextCandidate(2 * N, U"needle") == nullopt);
+}
+
+TEST_CASE("SearchIndex.unmatchable_cells", "[SearchIndex]")
+{
+    auto constexpr N = SearchIndex::MinLinesPerBlock;
+
+    auto index = SearchIndex {};
+    index.reset(0);
+    addLines(index, N);
+    index.addLine(u32string_view(U"ab\0c", 4), false);
+
+    CHECK(index.nextCandidate(0, U"abc") == nullopt);
+}
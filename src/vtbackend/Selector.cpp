@@ -74,6 +74,18 @@ bool Selection::containsLine(LineOffset line) const noexcept
     return crispy::ascending(_from.line, line, _to.line) || crispy::ascending(_to.line, line, _from.line);
 }
 
+optional<Selection::Range> Selection::rangeAt(LineOffset line) const noexcept
+{
+    auto const [from, to] = _from <= _to ? pair { _from, _to } : pair { _to, _from };
+    if (line < from.line || to.line < line)
+        return nullopt;
+
+    auto const rightMargin = boxed_cast<ColumnOffset>(_helper.pageSize().columns - 1);
+    return Range { line,
+                   line == from.line ? from.column : ColumnOffset(0),
+                   line == to.line ? min(to.column, rightMargin) : rightMargin };
+}
+
 bool Selection::intersects(Rect area) const noexcept
 {
     // TODO: make me more efficient
@@ -248,6 +260,16 @@ bool RectangularSelection::intersects(Rect area) const noexcept
     return area.top.as<LineOffset>() < from.line && to.line < area.bottom.as<LineOffset>();
 }
 
+optional<Selection::Range> RectangularSelection::rangeAt(LineOffset line) const noexcept
+{
+    auto const [from, to] = orderedPoints(_from, _to);
+    if (line < from.line || to.line < line)
+        return nullopt;
+
+    auto const rightMargin = boxed_cast<ColumnOffset>(_helper.pageSize().columns - 1);
+    return Range { line, from.column, min(to.column, rightMargin) };
+}
+
 vector<Selection::Range> RectangularSelection::ranges() const
 {
     auto const [from, to] = orderedPoints(_from, _to);
@@ -11,6 +11,7 @@
 #include <fmt/format.h>
 
 #include <functional>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -91,6 +92,11 @@ class Selection
     [[nodiscard]] bool containsLine(LineOffset line) const noexcept;
     [[nodiscard]] virtual bool intersects(Rect area) const noexcept;
 
+    /// @returns the columns of the given line that contains() holds true for, if any.
+    ///
+    /// Columns beyond the right margin are not included.
+    [[nodiscard]] virtual std::optional<Range> rangeAt(LineOffset line) const noexcept;
+
     [[nodiscard]] ViMode viMode() const noexcept { return _viMode; }
 
     /// Tests whether the a selection is currently in progress.
@@ -127,6 +133,7 @@ class RectangularSelection: public Selection
                          OnSelectionUpdated onSelectionUpdated);
     [[nodiscard]] bool contains(CellLocation coord) const noexcept override;
     [[nodiscard]] bool intersects(Rect area) const noexcept override;
+    [[nodiscard]] std::optional<Range> rangeAt(LineOffset line) const noexcept override;
     [[nodiscard]] std::vector<Range> ranges() const override;
 };
 
@@ -255,3 +255,35 @@ TEST_CASE("Selector.Rectangular", "[selector]")
 {
     // TODO
 }
+
+TEST_CASE("Selector.rangeAt", "[selector]")
+{
+    auto term = MockTerm(PageSize { LineCount(4), ColumnCount(6) }, LineCount(5));
+    auto& screen = term.terminal.primaryScreen();
+    auto selectionHelper = TestSelectionHelper(screen);
+
+    // The selected columns of each line are exactly the cells contained in the selection.
+    auto const checkRanges = [](Selection const& selector) {
+        for (auto line = LineOffset(-1); line <= LineOffset(4); ++line)
+        {
+            auto const range = selector.rangeAt(line);
+            for (auto column = ColumnOffset(0); column < ColumnOffset(6); ++column)
+            {
+                auto const inRange = range && range->fromColumn <= column && column <= range->toColumn;
+                CHECK(inRange == selector.contains(CellLocation { line, column }));
+            }
+        }
+    };
+
+    auto linear = LinearSelection(selectionHelper, CellLocation { LineOffset(2), ColumnOffset(1) }, []() {});
+    (void) linear.extend(CellLocation { LineOffset(0), ColumnOffset(4) });
+    checkRanges(linear);
+    CHECK(!linear.rangeAt(LineOffset(3)).has_value());
+    CHECK(linear.rangeAt(LineOffset(1))->fromColumn == ColumnOffset(0));
+    CHECK(linear.rangeAt(LineOffset(1))->toColumn == ColumnOffset(5));
+
+    auto rectangular =
+        RectangularSelection(selectionHelper, CellLocation { LineOffset(1), ColumnOffset(4) }, []() {});
+    (void) rectangular.extend(CellLocation { LineOffset(3), ColumnOffset(2) });
+    checkRanges(rectangular);
+}
@@ -258,6 +258,12 @@ class Sequence
         return select(selector(), availableDefinitions);
     }
 
+    [[nodiscard]] FunctionDefinition const* functionDefinition(
+        SupportedSequences const& supportedSequences) const noexcept
+    {
+        return supportedSequences.select(selector());
+    }
+
     /// Converts a FunctionSpinto a FunctionSelector, applicable for finding the corresponding
     /// FunctionDefinition.
     [[nodiscard]] FunctionSelector selector() const noexcept
@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/SequenceStats.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+namespace vtbackend
+{
+
+namespace
+{
+    // allFunctions() returns a copy each time, so keep one to index into.
+    auto const& sortedFunctions()
+    {
+        static auto const functions = allFunctions();
+        return functions;
+    }
+
+    size_t indexOf(FunctionDefinition const& function)
+    {
+        auto const& functions = sortedFunctions();
+        auto const i = std::lower_bound(
+            functions.begin(), functions.end(), function, [](auto const& a, auto const& b) {
+                return compare(a, b) < 0;
+            });
+        assert(i != functions.end() && *i == function);
+        return static_cast<size_t>(std::distance(functions.begin(), i));
+    }
+} // namespace
+
+SequenceStats::SequenceStats(): _entries(sortedFunctions().size())
+{
+}
+
+void SequenceStats::record(FunctionDefinition const& function,
+                           Sequence const& seq,
+                           std::chrono::nanoseconds time)
+{
+    auto& entry = _entries[indexOf(function)];
+    ++entry.count;
+    entry.parameters += seq.parameterCount();
+    entry.dataBytes += seq.dataString().size();
+    entry.time += time;
+}
+
+SequenceStats::Entry const& SequenceStats::operator[](FunctionDefinition const& function) const
+{
+    return _entries[indexOf(function)];
+}
+
+void SequenceStats::inspect(std::ostream& output, vtparser::ParserStats const& parser) const
+{
+    auto const percentOf = [](uint64_t part, uint64_t total) {
+        return total != 0 ? 100.0 * static_cast<double>(part) / static_cast<double>(total) : 0.0;
+    };
+
+    output << "VT sequence statistics:\n";
+    output << fmt::format("  parsed: {} bytes, {} as bulk text ({:.1f}%), {} as bulk control strings "
+                          "({:.1f}%), {} via the state machine ({:.1f}%)\n",
+                          parser.total(),
+                          parser.bulkTextBytes,
+                          percentOf(parser.bulkTextBytes, parser.total()),
+                          parser.bulkControlStringBytes,
+                          percentOf(parser.bulkControlStringBytes, parser.total()),
+                          parser.stateMachineBytes,
+                          percentOf(parser.stateMachineBytes, parser.total()));
+
+    auto order = std::vector<size_t>(_entries.size());
+    std::iota(order.begin(), order.end(), size_t { 0 });
+    std::erase_if(order, [&](size_t i) { return _entries[i].count == 0; });
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return _entries[a].time > _entries[b].time;
+    });
+
+    auto const totalTime = std::accumulate(
+        _entries.begin(), _entries.end(), std::chrono::nanoseconds {}, [](auto sum, Entry const& entry) {
+            return sum + entry.time;
+        });
+
+    output << fmt::format("  {:<14} {:>12} {:>12} {:>12} {:>12} {:>7} {:>10}\n",
+                          "function",
+                          "count",
+                          "parameters",
+                          "data bytes",
+                          "time (us)",
+                          "time %",
+                          "ns/call");
+    for (auto const i: order)
+    {
+        auto const& entry = _entries[i];
+        output << fmt::format("  {:<14} {:>12} {:>12} {:>12} {:>12} {:>6.1f}% {:>10}\n",
+                              sortedFunctions()[i].documentation.mnemonic,
+                              entry.count,
+                              entry.parameters,
+                              entry.dataBytes,
+                              entry.time.count() / 1000,
+                              percentOf(static_cast<uint64_t>(entry.time.count()),
+                                        static_cast<uint64_t>(totalTime.count())),
+                              entry.time.count() / static_cast<int64_t>(entry.count));
+    }
+    if (_unknownCount != 0)
+        output << fmt::format("  {:<14} {:>12}\n", "(unknown)", _unknownCount);
+}
+
+} // namespace vtbackend
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <vtbackend/Functions.h>
+#include <vtbackend/Sequence.h>
+
+#include <vtparser/Parser.h>
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace vtbackend
+{
+
+/**
+ * Execution counters of the VT sequences processed by a terminal, one per FunctionDefinition.
+ *
+ * These are only collected when built with LIBTERMINAL_SEQUENCE_STATS, as timing each and every
+ * sequence costs a clock read on the hot path. They tell which sequences a workload is dominated by,
+ * and so which handlers are worth optimizing.
+ */
+class SequenceStats
+{
+  public:
+    struct Entry
+    {
+        uint64_t count = 0;
+        uint64_t parameters = 0; // numeric parameters passed, summed up over all invocations
+        uint64_t dataBytes = 0;  // bytes of the data strings (OSC, DCS) passed
+        std::chrono::nanoseconds time {};
+    };
+
+    SequenceStats();
+
+    /// Records an invocation of @p function for @p seq, having taken @p time to execute.
+    void record(FunctionDefinition const& function, Sequence const& seq, std::chrono::nanoseconds time);
+
+    /// Records a sequence not matching any (enabled) function.
+    void recordUnknown() noexcept { ++_unknownCount; }
+
+    [[nodiscard]] Entry const& operator[](FunctionDefinition const& function) const;
+    [[nodiscard]] uint64_t unknownCount() const noexcept { return _unknownCount; }
+
+    /// Writes the counters of all functions invoked, along with the parser's, to @p output,
+    /// starting with the functions taking the most time in total.
+    void inspect(std::ostream& output, vtparser::ParserStats const& parser) const;
+
+  private:
+    std::vector<Entry> _entries; // indexed like allFunctions()
+    uint64_t _unknownCount = 0;
+};
+
+} // namespace vtbackend
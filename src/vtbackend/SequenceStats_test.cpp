@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/SequenceStats.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <sstream>
+
+using namespace std::chrono_literals;
+using vtbackend::Sequence;
+using vtbackend::SequenceParameterBuilder;
+using vtbackend::SequenceStats;
+
+namespace
+{
+
+Sequence makeCUP()
+{
+    auto seq = Sequence {};
+    seq.setCategory(vtbackend::FunctionCategory::CSI);
+    seq.setFinalChar('H');
+    auto builder = SequenceParameterBuilder { seq.parameters() };
+    builder.multiplyBy10AndAdd(2);
+    builder.nextParameter();
+    builder.multiplyBy10AndAdd(3);
+    builder.fixiate();
+    return seq;
+}
+
+} // namespace
+
+TEST_CASE("SequenceStats.record", "[SequenceStats]")
+{
+    auto stats = SequenceStats {};
+    auto const cup = makeCUP();
+    stats.record(vtbackend::CUP, cup, 100ns);
+    stats.record(vtbackend::CUP, cup, 50ns);
+
+    auto const& entry = stats[vtbackend::CUP];
+    CHECK(entry.count == 2);
+    CHECK(entry.parameters == 4);
+    CHECK(entry.dataBytes == 0);
+    CHECK(entry.time == 150ns);
+
+    CHECK(stats[vtbackend::SGR].count == 0);
+}
+
+TEST_CASE("SequenceStats.inspect", "[SequenceStats]")
+{
+    auto stats = SequenceStats {};
+    auto seq = Sequence {};
+    seq.setCategory(vtbackend::FunctionCategory::OSC);
+    seq.dataString() = "title";
+    stats.record(vtbackend::SETTITLE, seq, 2us);
+    stats.record(vtbackend::CUP, makeCUP(), 1us);
+    stats.recordUnknown();
+
+    auto output = std::ostringstream {};
+    stats.inspect(output, vtparser::ParserStats { .bulkTextBytes = 90, .stateMachineBytes = 10 });
+    auto const text = output.str();
+
+    CHECK(text.find("100 bytes, 90 as bulk text (90.0%)") != std::string::npos);
+    CHECK(text.find("SGR") == std::string::npos);
+    CHECK(text.find("(unknown)") != std::string::npos);
+
+    // Sorted by the total time taken.
+    auto const title = text.find("SETTITLE");
+    auto const cup = text.find("CUP");
+    REQUIRE(title != std::string::npos);
+    REQUIRE(cup != std::string::npos);
+    CHECK(title < cup);
+}
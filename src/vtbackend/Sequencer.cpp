@@ -6,6 +6,8 @@
 #include <vtbackend/logging.h>
 #include <vtbackend/primitives.h>
 
+#include <algorithm>
+#include <string>
 #include <string_view>
 
 using std::get;
@@ -17,6 +19,12 @@ using namespace std::string_view_literals;
 namespace vtbackend
 {
 
+namespace
+{
+    // Prefix of OSC 52 setting the clipboard, which is followed by the base64 encoded contents.
+    constexpr auto ClipboardPrefix = "52;c;"sv;
+} // namespace
+
 Sequencer::Sequencer(Terminal& terminal): _terminal { terminal }, _parameterBuilder { _sequence.parameters() }
 {
 }
@@ -105,17 +113,91 @@ void Sequencer::startOSC()
 
 void Sequencer::putOSC(char ch)
 {
-    if (_sequence.intermediateCharacters().size() + 1 < Sequence::MaxOscLength)
-        _sequence.intermediateCharacters().push_back(ch);
+    if (_decodingClipboard)
+    {
+        decodeClipboard(string_view(&ch, 1));
+        return;
+    }
+
+    auto& data = _sequence.intermediateCharacters();
+    if (data.size() + 1 < Sequence::MaxOscLength)
+        data.push_back(ch);
+    _decodingClipboard = data == ClipboardPrefix;
+}
+
+void Sequencer::putOSC(string_view chars)
+{
+    if (!_decodingClipboard)
+    {
+        auto& data = _sequence.intermediateCharacters();
+        if (data.size() < ClipboardPrefix.size())
+        {
+            // Collect up to the prefix of OSC 52 first, to tell whether to decode what follows.
+            auto const prefixLength = std::min(chars.size(), ClipboardPrefix.size() - data.size());
+            data.append(chars.substr(0, prefixLength));
+            chars.remove_prefix(prefixLength);
+            _decodingClipboard = data == ClipboardPrefix;
+        }
+        if (!_decodingClipboard)
+        {
+            if (data.size() + 1 < Sequence::MaxOscLength)
+                data.append(chars.substr(0, Sequence::MaxOscLength - 1 - data.size()));
+            return;
+        }
+    }
+
+    decodeClipboard(chars);
+}
+
+void Sequencer::decodeClipboard(string_view chars)
+{
+    if (_clipboardDecoder.finished)
+        return;
+
+    auto& output = _sequence.dataString();
+    auto const size = output.size();
+    auto const bound = crispy::base64::decodedSizeBound(_clipboardDecoder, chars.size());
+    auto const maxSize = _terminal.settings().maxClipboardSize;
+    if (size + bound > maxSize)
+    {
+        // Rejected as a whole rather than truncated, without buffering any of the remainder.
+        if (vtParserLog)
+            vtParserLog()("Rejecting OSC 52 clipboard data exceeding {} bytes.", maxSize);
+        _clipboardDecoder.finished = true;
+        _clipboardRejected = true;
+        std::string().swap(output);
+        return;
+    }
+
+    output.resize(size + bound);
+    output.resize(size + crispy::base64::decode(_clipboardDecoder, chars, output.data() + size));
 }
 
 void Sequencer::dispatchOSC()
 {
+    if (_clipboardRejected)
+    {
+        clear();
+        return;
+    }
+
+    if (_decodingClipboard)
+    {
+        auto& output = _sequence.dataString();
+        auto const size = output.size();
+        output.resize(size + 2);
+        output.resize(size + crispy::base64::finish(_clipboardDecoder, output.data() + size));
+    }
+
     auto const [code, skipCount] = vtparser::extractCodePrefix(_sequence.intermediateCharacters());
     _parameterBuilder.set(static_cast<Sequence::Parameter>(code));
     _sequence.intermediateCharacters().erase(0, skipCount);
     handleSequence();
     clear();
+
+    // Do not hold on to the memory of large clipboard contents.
+    if (_sequence.dataString().capacity() > Sequence::MaxOscLength)
+        _sequence.dataString().shrink_to_fit();
 }
 
 void Sequencer::hook(char finalChar)
@@ -133,6 +215,19 @@ void Sequencer::put(char ch)
         _hookedParser->pass(ch);
 }
 
+void Sequencer::put(string_view chars)
+{
+    if (!_hookedParser)
+        return;
+
+    // Hand out a reference to the PTY buffer rather than a copy, if the data lives in there.
+    auto const& buffer = _terminal.currentPtyBuffer();
+    if (buffer->data() <= chars.data() && chars.data() + chars.size() <= buffer->end())
+        _hookedParser->pass(crispy::BufferFragment<char> { buffer, chars });
+    else
+        _hookedParser->pass(chars);
+}
+
 void Sequencer::unhook()
 {
     if (_hookedParser)
@@ -10,6 +10,8 @@
 #include <vtparser/ParserEvents.h>
 #include <vtparser/ParserExtension.h>
 
+#include <crispy/base64.h>
+
 #include <libunicode/convert.h>
 #include <libunicode/utf8.h>
 
@@ -142,9 +144,11 @@ class Sequencer
     void dispatchCSI(char finalChar);
     void startOSC();
     void putOSC(char ch);
+    void putOSC(std::string_view chars);
     void dispatchOSC();
     void hook(char finalChar);
     void put(char ch);
+    void put(std::string_view chars);
     void unhook();
     void startAPC() {}
     void putAPC(char) {}
@@ -162,6 +166,7 @@ class Sequencer
 
   private:
     void handleSequence();
+    void decodeClipboard(std::string_view chars);
 
     // private data
     //
@@ -171,6 +176,11 @@ class Sequencer
 
     std::unique_ptr<ParserExtension> _hookedParser;
     std::unique_ptr<SixelImageBuilder> _sixelImageBuilder;
+
+    // OSC 52 clipboard data is decoded while being received, see decodeClipboard().
+    bool _decodingClipboard = false;
+    bool _clipboardRejected = false; // the contents exceed Settings::maxClipboardSize
+    crispy::base64::decoder_state _clipboardDecoder {};
 };
 
 // {{{ inlines
@@ -178,6 +188,9 @@ inline void Sequencer::clear() noexcept
 {
     _sequence.clearExceptParameters();
     _parameterBuilder.reset();
+    _decodingClipboard = false;
+    _clipboardRejected = false;
+    _clipboardDecoder = {};
 }
 
 inline void Sequencer::paramDigit(char ch) noexcept
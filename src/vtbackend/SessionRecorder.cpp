@@ -0,0 +1,605 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/SessionRecorder.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+using namespace std::string_view_literals;
+
+namespace vtbackend
+{
+
+namespace
+{
+    constexpr auto BinaryMagic = "CTREC\x01"sv;
+    constexpr auto OutputRecord = 'o';
+    constexpr auto ResizeRecord = 'r';
+
+    // Events queued before the queue (and the one being written) needs to grow.
+    constexpr size_t InitialQueueCapacity = 256;
+
+    void putVarint(std::string& output, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        output.push_back(static_cast<char>(value));
+    }
+
+    void putUtf8(std::string& output, char32_t codepoint)
+    {
+        if (codepoint < 0x80)
+            output.push_back(static_cast<char>(codepoint));
+        else if (codepoint < 0x800)
+        {
+            output.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+            output.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        }
+        else if (codepoint < 0x10000)
+        {
+            output.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+            output.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        }
+        else
+        {
+            output.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+            output.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        }
+    }
+
+    // Length of the UTF-8 sequence starting at the beginning of @p data, 0 if it is invalid,
+    // or the negated number of bytes it has so far if it is incomplete.
+    int utf8SequenceLength(std::string_view data) noexcept
+    {
+        auto const lead = static_cast<uint8_t>(data[0]);
+        auto const length = lead < 0x80   ? 1
+                            : lead < 0xC2 ? 0 // continuation bytes, and overlong encodings of ASCII
+                            : lead < 0xE0 ? 2
+                            : lead < 0xF0 ? 3
+                            : lead < 0xF5 ? 4
+                                          : 0;
+        if (length <= 1)
+            return length;
+
+        // Rejects overlong encodings, surrogates, and codepoints past U+10FFFF by the second byte.
+        auto const [low, high] = lead == 0xE0   ? std::pair { 0xA0, 0xBF }
+                                 : lead == 0xED ? std::pair { 0x80, 0x9F }
+                                 : lead == 0xF0 ? std::pair { 0x90, 0xBF }
+                                 : lead == 0xF4 ? std::pair { 0x80, 0x8F }
+                                                : std::pair { 0x80, 0xBF };
+        for (auto i = 1; i < length; ++i)
+        {
+            if (i == static_cast<int>(data.size()))
+                return -i;
+            auto const byte = static_cast<uint8_t>(data[static_cast<size_t>(i)]);
+            if (i == 1 ? (byte < low || byte > high) : (byte & 0xC0) != 0x80)
+                return 0;
+        }
+        return length;
+    }
+
+    void putJsonString(std::string& output, std::string_view text)
+    {
+        output.push_back('"');
+        for (auto const ch: text)
+        {
+            switch (ch)
+            {
+                case '"': output += "\\\""; break;
+                case '\\': output += "\\\\"; break;
+                case '\b': output += "\\b"; break;
+                case '\f': output += "\\f"; break;
+                case '\n': output += "\\n"; break;
+                case '\r': output += "\\r"; break;
+                case '\t': output += "\\t"; break;
+                default:
+                    if (static_cast<uint8_t>(ch) < 0x20 || ch == 0x7F)
+                        output += fmt::format("\\u{:04x}", static_cast<unsigned>(ch));
+                    else
+                        output.push_back(ch);
+                    break;
+            }
+        }
+        output.push_back('"');
+    }
+
+    std::string formatPageSize(PageSize pageSize)
+    {
+        return fmt::format("{}x{}", pageSize.columns.value, pageSize.lines.value);
+    }
+
+    // {{{ decoding
+    class BinaryReader
+    {
+      public:
+        explicit BinaryReader(std::string_view data): _data { data } {}
+
+        [[nodiscard]] bool failed() const noexcept { return _failed; }
+        [[nodiscard]] bool atEnd() const noexcept { return _data.empty(); }
+
+        uint64_t varint()
+        {
+            auto value = uint64_t { 0 };
+            for (auto shift = 0; shift < 64; shift += 7)
+            {
+                if (_data.empty())
+                    break;
+                auto const byte = static_cast<uint8_t>(_data.front());
+                _data.remove_prefix(1);
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                    return value;
+            }
+            _failed = true;
+            return 0;
+        }
+
+        char byte()
+        {
+            if (_data.empty())
+            {
+                _failed = true;
+                return 0;
+            }
+            auto const value = _data.front();
+            _data.remove_prefix(1);
+            return value;
+        }
+
+        std::string_view bytes(uint64_t count)
+        {
+            if (count > _data.size())
+            {
+                _failed = true;
+                return {};
+            }
+            auto const value = _data.substr(0, count);
+            _data.remove_prefix(count);
+            return value;
+        }
+
+        PageSize pageSize()
+        {
+            auto const columns = varint();
+            auto const lines = varint();
+            if (columns > std::numeric_limits<int>::max() || lines > std::numeric_limits<int>::max())
+                _failed = true;
+            return PageSize { LineCount::cast_from(_failed ? 0 : lines),
+                              ColumnCount::cast_from(_failed ? 0 : columns) };
+        }
+
+      private:
+        std::string_view _data;
+        bool _failed = false;
+    };
+
+    std::optional<Recording> decodeBinary(std::string_view contents)
+    {
+        auto reader = BinaryReader(contents.substr(BinaryMagic.size()));
+        auto recording = Recording { .pageSize = reader.pageSize(), .events = {} };
+        auto time = std::chrono::microseconds {};
+        while (!reader.failed() && !reader.atEnd())
+        {
+            auto const type = reader.byte();
+            time += std::chrono::microseconds(reader.varint());
+            auto& event = recording.events.emplace_back(RecordingEvent { .time = time });
+            if (type == OutputRecord)
+                event.output = reader.bytes(reader.varint());
+            else if (type == ResizeRecord)
+                event.resize = reader.pageSize();
+            else
+                return std::nullopt;
+        }
+        if (reader.failed())
+            return std::nullopt;
+        return recording;
+    }
+
+    // Reads the values of one line of an asciicast file, being a JSON object or array.
+    class JsonReader
+    {
+      public:
+        explicit JsonReader(std::string_view line): _data { line } {}
+
+        bool consume(char expected)
+        {
+            skipSpace();
+            if (_data.empty() || _data.front() != expected)
+                return false;
+            _data.remove_prefix(1);
+            return true;
+        }
+
+        std::optional<double> number()
+        {
+            skipSpace();
+            auto const end = std::find_if(_data.begin(), _data.end(), [](char ch) {
+                return !(std::isdigit(static_cast<unsigned char>(ch)) || ch == '.' || ch == '-' || ch == '+'
+                         || ch == 'e' || ch == 'E');
+            });
+            auto const text = std::string(_data.begin(), end);
+            if (text.empty())
+                return std::nullopt;
+            _data.remove_prefix(text.size());
+            try
+            {
+                return std::stod(text);
+            }
+            catch (...)
+            {
+                return std::nullopt;
+            }
+        }
+
+        std::optional<std::string> string()
+        {
+            if (!consume('"'))
+                return std::nullopt;
+            auto result = std::string {};
+            while (!_data.empty())
+            {
+                auto const ch = _data.front();
+                _data.remove_prefix(1);
+                if (ch == '"')
+                    return result;
+                if (ch != '\\')
+                {
+                    result.push_back(ch);
+                    continue;
+                }
+                if (_data.empty())
+                    return std::nullopt;
+                auto const escaped = _data.front();
+                _data.remove_prefix(1);
+                switch (escaped)
+                {
+                    case 'b': result.push_back('\b'); break;
+                    case 'f': result.push_back('\f'); break;
+                    case 'n': result.push_back('\n'); break;
+                    case 'r': result.push_back('\r'); break;
+                    case 't': result.push_back('\t'); break;
+                    case 'u': {
+                        auto codepoint = hex4();
+                        if (!codepoint)
+                            return std::nullopt;
+                        if (*codepoint >= 0xD800 && *codepoint < 0xDC00 && _data.starts_with("\\u"))
+                        {
+                            _data.remove_prefix(2);
+                            auto const low = hex4();
+                            if (!low || *low < 0xDC00 || *low > 0xDFFF)
+                                return std::nullopt;
+                            codepoint = 0x10000 + ((*codepoint - 0xD800) << 10) + (*low - 0xDC00);
+                        }
+                        putUtf8(result, *codepoint);
+                        break;
+                    }
+                    default: result.push_back(escaped); break;
+                }
+            }
+            return std::nullopt;
+        }
+
+        // Skips to the value of the member @p name of an object, searching it textually.
+        bool member(std::string_view name)
+        {
+            auto const key = fmt::format("\"{}\"", name);
+            auto const position = _data.find(key);
+            if (position == std::string_view::npos)
+                return false;
+            _data.remove_prefix(position + key.size());
+            return consume(':');
+        }
+
+      private:
+        void skipSpace()
+        {
+            while (!_data.empty() && (_data.front() == ' ' || _data.front() == '\t' || _data.front() == '\r'))
+                _data.remove_prefix(1);
+        }
+
+        std::optional<char32_t> hex4()
+        {
+            auto value = unsigned { 0 };
+            if (_data.size() < 4
+                || std::from_chars(_data.data(), _data.data() + 4, value, 16).ptr != _data.data() + 4)
+                return std::nullopt;
+            _data.remove_prefix(4);
+            return static_cast<char32_t>(value);
+        }
+
+        std::string_view _data;
+    };
+
+    std::optional<PageSize> parsePageSize(std::string_view text)
+    {
+        auto columns = 0;
+        auto lines = 0;
+        auto const separator = text.find('x');
+        auto const* const end = text.data() + text.size();
+        if (separator == std::string_view::npos
+            || std::from_chars(text.data(), text.data() + separator, columns).ec != std::errc {}
+            || std::from_chars(text.data() + separator + 1, end, lines).ec != std::errc {})
+            return std::nullopt;
+        return PageSize { LineCount(lines), ColumnCount(columns) };
+    }
+
+    std::optional<Recording> decodeAsciicast(std::string_view contents)
+    {
+        auto const headerEnd = std::min(contents.find('\n'), contents.size());
+        auto const header = contents.substr(0, headerEnd);
+        auto const dimension = [&](std::string_view name) {
+            auto reader = JsonReader(header);
+            return reader.member(name) ? reader.number() : std::nullopt;
+        };
+        auto const version = dimension("version");
+        auto const width = dimension("width");
+        auto const height = dimension("height");
+        if (version != 2.0 || !width || !height)
+            return std::nullopt;
+
+        auto recording =
+            Recording { .pageSize = PageSize { LineCount(static_cast<int>(*height)),
+                                               ColumnCount(static_cast<int>(*width)) },
+                        .events = {} };
+        contents.remove_prefix(std::min(headerEnd + 1, contents.size()));
+        while (!contents.empty())
+        {
+            auto const lineEnd = std::min(contents.find('\n'), contents.size());
+            auto reader = JsonReader(contents.substr(0, lineEnd));
+            contents.remove_prefix(std::min(lineEnd + 1, contents.size()));
+            if (!reader.consume('['))
+                continue; // empty line
+
+            auto const time = reader.number();
+            auto const type = reader.consume(',') ? reader.string() : std::nullopt;
+            auto data = reader.consume(',') ? reader.string() : std::nullopt;
+            if (!time || !type || !data || !reader.consume(']'))
+                return std::nullopt;
+
+            auto event = RecordingEvent { .time = std::chrono::microseconds(std::llround(*time * 1e6)) };
+            if (*type == "o")
+                event.output = std::move(*data);
+            else if (*type == "r")
+            {
+                event.resize = parsePageSize(*data);
+                if (!event.resize)
+                    return std::nullopt;
+            }
+            else
+                continue; // input or markers
+            recording.events.emplace_back(std::move(event));
+        }
+        return recording;
+    }
+    // }}}
+} // namespace
+
+RecordingFormat recordingFormatOf(std::filesystem::path const& path)
+{
+    return path.extension() == ".cast" ? RecordingFormat::Asciicast : RecordingFormat::Binary;
+}
+
+std::unique_ptr<SessionRecorder> SessionRecorder::create(std::filesystem::path path,
+                                                         RecordingFormat format,
+                                                         PageSize pageSize,
+                                                         clock::time_point start)
+{
+    auto file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+    if (!file.good())
+        return nullptr;
+    return std::unique_ptr<SessionRecorder>(
+        new SessionRecorder(std::move(path), std::move(file), format, pageSize, start));
+}
+
+SessionRecorder::SessionRecorder(std::filesystem::path path,
+                                 std::ofstream file,
+                                 RecordingFormat format,
+                                 PageSize pageSize,
+                                 clock::time_point start):
+    _path { std::move(path) },
+    _file { std::move(file) },
+    _format { format },
+    _start { start },
+    _lastEventTime { start }
+{
+    switch (_format)
+    {
+        case RecordingFormat::Asciicast: {
+            auto const now = std::chrono::system_clock::now().time_since_epoch();
+            auto const timestamp = std::chrono::duration_cast<std::chrono::seconds>(now);
+            _encoded = fmt::format(R"({{"version": 2, "width": {}, "height": {}, "timestamp": {}}})"
+                                   "\n",
+                                   pageSize.columns.value,
+                                   pageSize.lines.value,
+                                   timestamp.count());
+            break;
+        }
+        case RecordingFormat::Binary:
+            _encoded = BinaryMagic;
+            putVarint(_encoded, static_cast<uint64_t>(pageSize.columns.value));
+            putVarint(_encoded, static_cast<uint64_t>(pageSize.lines.value));
+            break;
+    }
+    _file.write(_encoded.data(), static_cast<std::streamsize>(_encoded.size()));
+    _bytesWritten = _encoded.size();
+
+    _queue.reserve(InitialQueueCapacity);
+    _writing.reserve(InitialQueueCapacity);
+    _writer = std::thread(&SessionRecorder::writerLoop, this);
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    {
+        auto const _ = std::lock_guard { _mutex };
+        _quit = true;
+    }
+    _condition.notify_all();
+    _writer.join();
+
+    // Whatever remained incomplete is not going to be completed anymore.
+    if (_format == RecordingFormat::Asciicast && !_incompleteUtf8.empty())
+        write(Event { .time = _lastEventTime, .data = {}, .copiedData = {}, .resize = std::nullopt });
+}
+
+void SessionRecorder::output(crispy::BufferFragment<char> data, clock::time_point now)
+{
+    push(Event { .time = now, .data = std::move(data), .copiedData = {}, .resize = std::nullopt });
+}
+
+void SessionRecorder::output(std::string_view data, clock::time_point now)
+{
+    push(Event { .time = now, .data = {}, .copiedData = std::string(data), .resize = std::nullopt });
+}
+
+void SessionRecorder::resize(PageSize pageSize, clock::time_point now)
+{
+    push(Event { .time = now, .data = {}, .copiedData = {}, .resize = pageSize });
+}
+
+void SessionRecorder::push(Event event)
+{
+    {
+        auto const _ = std::lock_guard { _mutex };
+        _bytesRecorded += event.data.size() + event.copiedData.size();
+        ++_eventsRecorded;
+        _queue.emplace_back(std::move(event));
+    }
+    _condition.notify_all();
+}
+
+void SessionRecorder::flush()
+{
+    auto lock = std::unique_lock { _mutex };
+    _condition.wait(lock, [this]() { return _eventsWritten == _eventsRecorded; });
+}
+
+SessionRecorder::Stats SessionRecorder::stats() const
+{
+    auto const _ = std::lock_guard { _mutex };
+    return Stats { .events = _eventsRecorded, .bytes = _bytesRecorded, .bytesWritten = _bytesWritten };
+}
+
+void SessionRecorder::writerLoop()
+{
+    auto lock = std::unique_lock { _mutex };
+    while (true)
+    {
+        _condition.wait(lock, [this]() { return !_queue.empty() || _quit; });
+        if (_queue.empty())
+            break;
+
+        std::swap(_queue, _writing);
+        lock.unlock();
+
+        auto bytesWritten = size_t { 0 };
+        for (auto const& event: _writing)
+        {
+            write(event);
+            bytesWritten += _encoded.size();
+        }
+        _file.flush();
+
+        // Gives the buffer objects referenced back to the pool.
+        auto const eventsWritten = _writing.size();
+        _writing.clear();
+
+        lock.lock();
+        _eventsWritten += eventsWritten;
+        _bytesWritten += bytesWritten;
+        _condition.notify_all();
+    }
+}
+
+void SessionRecorder::write(Event const& event)
+{
+    _encoded.clear();
+    auto const data = !event.copiedData.empty() ? std::string_view(event.copiedData) : event.data.view();
+    switch (_format)
+    {
+        case RecordingFormat::Asciicast: {
+            auto const time = std::chrono::duration<double>(event.time - _start).count();
+            if (event.resize)
+            {
+                _encoded += fmt::format("[{:.6f}, \"r\", \"{}\"]\n", time, formatPageSize(*event.resize));
+                break;
+            }
+            _encoded += fmt::format("[{:.6f}, \"o\", ", time);
+            writeAsciicastOutput(data);
+            _encoded += "]\n";
+            break;
+        }
+        case RecordingFormat::Binary: {
+            auto const delta =
+                std::chrono::duration_cast<std::chrono::microseconds>(event.time - _lastEventTime).count();
+            _encoded.push_back(event.resize ? ResizeRecord : OutputRecord);
+            putVarint(_encoded, static_cast<uint64_t>(std::max(decltype(delta) { 0 }, delta)));
+            if (event.resize)
+            {
+                putVarint(_encoded, static_cast<uint64_t>(event.resize->columns.value));
+                putVarint(_encoded, static_cast<uint64_t>(event.resize->lines.value));
+            }
+            else
+            {
+                putVarint(_encoded, data.size());
+                _encoded += data;
+            }
+            // Rounding down each delta would let the times drift.
+            _lastEventTime += std::chrono::microseconds(delta);
+            break;
+        }
+    }
+    _file.write(_encoded.data(), static_cast<std::streamsize>(_encoded.size()));
+}
+
+void SessionRecorder::writeAsciicastOutput(std::string_view data)
+{
+    // asciicast holds text, thus invalid UTF-8 is replaced, and sequences split across reads are joined.
+    auto text = std::string(std::exchange(_incompleteUtf8, {}));
+    text.reserve(text.size() + data.size());
+    text += data;
+
+    auto valid = std::string {};
+    valid.reserve(text.size());
+    auto remaining = std::string_view(text);
+    while (!remaining.empty())
+    {
+        auto const length = utf8SequenceLength(remaining);
+        if (length < 0 && !data.empty())
+        {
+            _incompleteUtf8 = remaining;
+            break;
+        }
+        if (length <= 0)
+        {
+            valid += "\xEF\xBF\xBD"; // U+FFFD REPLACEMENT CHARACTER
+            remaining.remove_prefix(1);
+            continue;
+        }
+        valid += remaining.substr(0, static_cast<size_t>(length));
+        remaining.remove_prefix(static_cast<size_t>(length));
+    }
+    putJsonString(_encoded, valid);
+}
+
+std::optional<Recording> decodeRecording(std::string_view contents)
+{
+    if (contents.starts_with(BinaryMagic))
+        return decodeBinary(contents);
+    if (contents.starts_with('{'))
+        return decodeAsciicast(contents);
+    return std::nullopt;
+}
+
+} // namespace vtbackend
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <vtbackend/primitives.h>
+
+#include <crispy/BufferObject.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace vtbackend
+{
+
+/// File formats the PTY output of a session is recorded in.
+enum class RecordingFormat : uint8_t
+{
+    Asciicast, // asciicast v2, to be played back by asciinema, holding the output as UTF-8 text only
+    Binary,    // the bytes exactly as read, e.g. to be replayed by bench-headless
+};
+
+/// @returns the format of recordings named @p path, i.e. Asciicast for ".cast" files, and Binary otherwise.
+[[nodiscard]] RecordingFormat recordingFormatOf(std::filesystem::path const& path);
+
+/// An event of a recording, at its time since the recording started.
+struct RecordingEvent
+{
+    std::chrono::microseconds time {};
+    std::string output;             // PTY output, unless resized
+    std::optional<PageSize> resize; // the page size resized to
+};
+
+struct Recording
+{
+    PageSize pageSize;                  // when the recording started
+    std::vector<RecordingEvent> events; // in the order recorded
+};
+
+/**
+ * Records everything the PTY delivers to a session, along with when it did, into a file.
+ *
+ * The output is not copied, but referenced within the buffer objects it has been read into,
+ * and handed to a background thread writing it. Recording output therefore only costs appending
+ * a BufferFragment to a queue, such that it adds next to nothing to parsing.
+ *
+ * The binary format starts with the magic "CTREC", a version byte (1), and the columns and lines
+ * of the page. Each record then consists of a type byte ('o' for output, 'r' for a resize),
+ * the microseconds passed since the previous record, and its payload: the size and bytes of the output,
+ * or the columns and lines resized to. All numbers are LEB128 varints.
+ */
+class SessionRecorder
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    struct Stats
+    {
+        uint64_t events = 0;       // output and resizes recorded
+        uint64_t bytes = 0;        // of output recorded
+        uint64_t bytesWritten = 0; // to the file so far, in either format
+    };
+
+    /// Starts recording into @p path, replacing any file there.
+    ///
+    /// @returns the recorder, or nullptr if @p path could not be created.
+    [[nodiscard]] static std::unique_ptr<SessionRecorder> create(std::filesystem::path path,
+                                                                 RecordingFormat format,
+                                                                 PageSize pageSize,
+                                                                 clock::time_point start = clock::now());
+
+    SessionRecorder(SessionRecorder const&) = delete;
+    SessionRecorder& operator=(SessionRecorder const&) = delete;
+
+    /// Stops recording, once everything recorded has been written.
+    ~SessionRecorder();
+
+    [[nodiscard]] std::filesystem::path const& path() const noexcept { return _path; }
+    [[nodiscard]] RecordingFormat format() const noexcept { return _format; }
+
+    /// Records the PTY output @p data, referencing it until written.
+    ///
+    /// The bytes referenced must not be modified anymore, i.e. lie before the hot end of their buffer object.
+    void output(crispy::BufferFragment<char> data, clock::time_point now);
+
+    /// Records the PTY output @p data, copying it.
+    void output(std::string_view data, clock::time_point now);
+
+    void resize(PageSize pageSize, clock::time_point now);
+
+    /// Waits for everything recorded so far to be written.
+    void flush();
+
+    [[nodiscard]] Stats stats() const;
+
+  private:
+    struct Event
+    {
+        clock::time_point time;
+        crispy::BufferFragment<char> data;
+        std::string copiedData; // if the output has not been read into a buffer object
+        std::optional<PageSize> resize;
+    };
+
+    SessionRecorder(std::filesystem::path path,
+                    std::ofstream file,
+                    RecordingFormat format,
+                    PageSize pageSize,
+                    clock::time_point start);
+
+    void push(Event event);
+    void writerLoop();
+    void write(Event const& event);
+    void writeAsciicastOutput(std::string_view data);
+
+    std::filesystem::path _path;
+    std::ofstream _file;
+    RecordingFormat _format;
+    clock::time_point _start;
+    clock::time_point _lastEventTime; // of the event written last, that binary records are relative to
+    std::string _encoded;             // the records being written, reused across events
+    std::string _incompleteUtf8;      // trailing bytes of a UTF-8 sequence continued by the next output
+
+    // Shared with the writer thread.
+    mutable std::mutex _mutex;
+    std::condition_variable _condition;
+    std::vector<Event> _queue;   // recorded, but not yet taken by the writer thread
+    std::vector<Event> _writing; // being written by the writer thread
+    uint64_t _eventsRecorded = 0;
+    uint64_t _eventsWritten = 0;
+    uint64_t _bytesRecorded = 0;
+    uint64_t _bytesWritten = 0;
+    bool _quit = false;
+    std::thread _writer;
+};
+
+/// Decodes the recording @p contents, written in either format.
+///
+/// @returns the recording, or std::nullopt if @p contents is not a recording, or is malformed.
+[[nodiscard]] std::optional<Recording> decodeRecording(std::string_view contents);
+
+} // namespace vtbackend
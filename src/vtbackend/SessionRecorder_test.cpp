@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/SessionRecorder.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace std::chrono_literals;
+using namespace std::string_view_literals;
+using namespace vtbackend;
+
+namespace
+{
+
+auto const start = SessionRecorder::clock::time_point {} + 1h;
+auto const pageSize = PageSize { LineCount(25), ColumnCount(80) };
+
+std::string readFile(std::filesystem::path const& path)
+{
+    auto file = std::ifstream(path, std::ios::binary);
+    auto contents = std::stringstream {};
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// Records some output split across buffer fragments, a resize, and more output, and decodes the file.
+Recording recordAndDecode(RecordingFormat format, std::string_view firstOutput, std::string_view secondOutput)
+{
+    auto const path = std::filesystem::temp_directory_path()
+                      / (format == RecordingFormat::Asciicast ? "contour-recording-test.cast"
+                                                              : "contour-recording-test.rec");
+    {
+        auto recorder = SessionRecorder::create(path, format, pageSize, start);
+        REQUIRE(recorder);
+
+        auto const buffer = crispy::buffer_object<char>::create(64);
+        auto const stored = buffer->writeAtEnd(gsl::span<char const>(firstOutput.data(), firstOutput.size()));
+        buffer->advance(stored.size());
+        recorder->output(buffer->ref(0, 2), start + 100ms);
+        recorder->output(buffer->ref(2, stored.size() - 2), start + 100ms + 1500us);
+        recorder->resize(PageSize { LineCount(30), ColumnCount(100) }, start + 2s);
+        recorder->output(secondOutput, start + 2s + 250ms);
+        recorder->flush();
+
+        auto const stats = recorder->stats();
+        CHECK(stats.events == 4);
+        CHECK(stats.bytes == firstOutput.size() + secondOutput.size());
+        CHECK(stats.bytesWritten == std::filesystem::file_size(path));
+    }
+
+    auto const recording = decodeRecording(readFile(path));
+    std::filesystem::remove(path);
+    REQUIRE(recording.has_value());
+    return *recording;
+}
+
+} // namespace
+
+TEST_CASE("SessionRecorder.binary", "[SessionRecorder]")
+{
+    // The binary format keeps the bytes exactly as read, even if they are no valid UTF-8.
+    auto const recording = recordAndDecode(RecordingFormat::Binary, "\033[1mbold\xFF\033[m", "\r\n\xE2\x94");
+    CHECK(recording.pageSize == pageSize);
+    REQUIRE(recording.events.size() == 4);
+    CHECK(recording.events[0].time == 100ms);
+    CHECK(recording.events[0].output == "\033["sv);
+    CHECK(recording.events[1].time == 100ms + 1500us);
+    CHECK(recording.events[1].output == "1mbold\xFF\033[m"sv);
+    CHECK(recording.events[2].time == 2s);
+    CHECK(recording.events[2].resize == PageSize { LineCount(30), ColumnCount(100) });
+    CHECK(recording.events[3].time == 2s + 250ms);
+    CHECK(recording.events[3].output == "\r\n\xE2\x94"sv);
+}
+
+TEST_CASE("SessionRecorder.asciicast", "[SessionRecorder]")
+{
+    // UTF-8 sequences split across reads are joined, and invalid bytes are replaced.
+    auto const recording =
+        recordAndDecode(RecordingFormat::Asciicast, "\033[1m\"quoted\" \xE2\x94", "\x80\xFF\t\\");
+    CHECK(recording.pageSize == pageSize);
+    REQUIRE(recording.events.size() == 4);
+    CHECK(recording.events[0].time == 100ms);
+    CHECK(recording.events[0].output == "\033["sv);
+    CHECK(recording.events[1].output == "1m\"quoted\" "sv);
+    CHECK(recording.events[2].resize == PageSize { LineCount(30), ColumnCount(100) });
+    CHECK(recording.events[3].time == 2s + 250ms);
+    CHECK(recording.events[3].output == "\xE2\x94\x80\xEF\xBF\xBD\t\\"sv);
+}
+
+TEST_CASE("SessionRecorder.decode", "[SessionRecorder]")
+{
+    auto const cast = "{\"version\": 2, \"width\": 120, \"height\": 40, \"env\": {\"TERM\": \"xterm\"}}\n"
+                      "[0.5, \"o\", \"\\u001b[H\\ud83d\\ude00\"]\n"
+                      "[0.75, \"i\", \"q\"]\n"sv;
+    auto const recording = decodeRecording(cast);
+    REQUIRE(recording.has_value());
+    CHECK(recording->pageSize == PageSize { LineCount(40), ColumnCount(120) });
+    REQUIRE(recording->events.size() == 1);
+    CHECK(recording->events[0].time == 500ms);
+    CHECK(recording->events[0].output == "\033[H\xF0\x9F\x98\x80"sv);
+
+    // Raw PTY output is no recording, nor are truncated ones.
+    CHECK(!decodeRecording("\033[H\033[2J"sv).has_value());
+    CHECK(!decodeRecording("CTREC\x01\x50\x19o\x00\x10"sv).has_value());
+    CHECK(!decodeRecording("{\"version\": 1, \"width\": 80, \"height\": 25}\n"sv).has_value());
+
+    CHECK(recordingFormatOf("session.cast") == RecordingFormat::Asciicast);
+    CHECK(recordingFormatOf("session.rec") == RecordingFormat::Binary);
+}
@@ -5,6 +5,8 @@
 #include <vtbackend/VTType.h>
 #include <vtbackend/primitives.h>
 
+#include <crispy/thread_qos.h>
+
 #include <chrono>
 #include <map>
 
@@ -38,8 +40,20 @@ struct Settings
     PageSize pageSize = PageSize { LineCount(25), ColumnCount(80) };
 
     MaxHistoryLineCount maxHistoryLineCount;
+    // Spills the text of old scrollback lines into a memory-mapped temporary file,
+    // once the scrollback text held in memory exceeds the given budget (in bytes).
+    bool historySpillToDisk = false;
+    size_t historyMemoryBudget = 64lu * 1024lu * 1024lu;
+    // Maintains a trigram index over the scrollback lines, to skip the lines that cannot match
+    // when searching the scrollback.
+    bool historySearchIndex = true;
     ImageSize maxImageSize { Width(800), Height(600) };
+    // Number of bytes of decoded image data to keep alive, before evicting images from the history.
+    size_t maxImageMemory = 256lu * 1024lu * 1024lu;
     unsigned maxImageRegisterCount = 256;
+    // Number of bytes of decoded OSC 52 clipboard contents to accept. Larger contents are rejected
+    // as a whole. The contents are decoded while being received and are not subject to other OSC limits.
+    size_t maxClipboardSize = 16lu * 1024lu * 1024lu;
     StatusDisplayType statusDisplayType = StatusDisplayType::None;
     StatusDisplayPosition statusDisplayPosition = StatusDisplayPosition::Bottom;
     bool syncWindowTitleWithHostWritableStatusDisplay = true;
@@ -49,8 +63,20 @@ struct Settings
     bool usePrivateColorRegisters = false;
 
     std::chrono::milliseconds cursorBlinkInterval = std::chrono::milliseconds { 500 };
+
+    // Time without keyboard input after which a blinking cursor stops blinking and is shown steadily,
+    // such that an idle terminal does not wake up for blinking anymore. Zero lets the cursor blink forever.
+    std::chrono::milliseconds cursorBlinkTimeout { 15000 };
     RefreshRate refreshRate = { 30.0 };
 
+    // Whether render buffers are refreshed just in time for the display's vertical blanks,
+    // as reported via Terminal::vsyncPresented(), instead of at the fixed refresh rate.
+    bool vsyncFramePacing = false;
+
+    // Time after which the screen is rendered anyway while synchronized output (DEC mode 2026) is active,
+    // for applications never ending it. Zero disables the timeout.
+    std::chrono::milliseconds synchronizedOutputTimeout { 1000 };
+
     // Defines the time to wait before the terminal executes the line feed (LF) command.
     // This is used to implement the DECSCLM (slow scroll) mode.
     std::chrono::milliseconds smoothLineScrolling { 100 };
@@ -64,6 +90,17 @@ struct Settings
     //
     // This value must be integer-devisable by 16.
     size_t ptyReadBufferSize = 4096;
+    // Reads from the PTY on a dedicated thread, handing the filled buffer objects over to the
+    // parsing thread via a lock-free queue, so that reading and parsing can overlap.
+    bool ptyReaderThread = false;
+    // Scheduling classes of the threads reading and processing the PTY's output, while attached to a
+    // display, and while detached from it (see Terminal::setDetached()).
+    crispy::thread_qos inputThreadQos = crispy::thread_qos::Interactive;
+    crispy::thread_qos detachedInputThreadQos = crispy::thread_qos::Utility;
+    // Number of bytes parsed at most while holding the terminal lock, which is released in between,
+    // such that key events and render buffer refreshes do not wait for a large read to be parsed.
+    // Zero parses each read at once.
+    size_t parseSliceSize = 64lu * 1024lu;
     std::u32string wordDelimiters;
     Modifiers mouseProtocolBypassModifiers = Modifier::Shift;
     Modifiers mouseBlockSelectionModifiers = Modifier::Control;
@@ -72,6 +109,11 @@ struct Settings
     std::chrono::milliseconds highlightTimeout = std::chrono::milliseconds { 150 };
     bool highlightDoubleClickedWord = true;
     // TODO: ^^^ make also use of it. probably rename to how VScode has named it.
+    // Treats search terms as regular expressions rather than literal text, see crispy::regex_dfa.
+    bool searchRegex = false;
+    // Shows printable characters typed right away at the cursor, before the application echoes them,
+    // for connections with a high latency, see PredictiveEcho.
+    bool predictiveEcho = false;
 
     struct PrimaryScreen
     {
@@ -2,6 +2,8 @@
 #include <vtbackend/SixelParser.h>
 
 #include <algorithm>
+#include <array>
+#include <cstring>
 
 using std::clamp;
 using std::fill;
@@ -158,9 +160,7 @@ void SixelParser::parse(char value)
                 paramShiftAndAddDigit(toDigit(value));
             else if (isSixel(value))
             {
-                auto const sixel = toSixel(value);
-                for (unsigned i = 0; i < _params[0]; ++i)
-                    _events.render(sixel);
+                _events.renderRepeated(toSixel(value), _params[0]);
                 transitionTo(State::Ground);
             }
             else
@@ -389,32 +389,6 @@ RGBAColor SixelImageBuilder::at(CellLocation coord) const noexcept
     return RGBAColor { color[0], color[1], color[2], color[3] };
 }
 
-void SixelImageBuilder::write(CellLocation const& coord, RGBColor const& value) noexcept
-{
-    if (unbox(coord.line) >= 0 && unbox(coord.line) < unbox<int>(_maxSize.height) && unbox(coord.column) >= 0
-        && unbox(coord.column) < unbox<int>(_maxSize.width))
-    {
-        if (!_explicitSize)
-        {
-            if (unbox(coord.line) >= unbox<int>(_size.height))
-                _size.height = Height::cast_from(coord.line.as<unsigned int>() + _aspectRatio);
-            if (unbox(coord.column) >= unbox<int>(_size.width))
-                _size.width = Width::cast_from(coord.column + 1);
-        }
-
-        for (unsigned int i = 0; i < _aspectRatio; ++i)
-        {
-            auto const base = (coord.line.as<unsigned int>() + i)
-                                  * unbox((_explicitSize ? _size.width : _maxSize.width)) * 4u
-                              + unbox<unsigned int>(coord.column) * 4u;
-            _buffer[base + 0] = value.red;
-            _buffer[base + 1] = value.green;
-            _buffer[base + 2] = value.blue;
-            _buffer[base + 3] = 0xFF;
-        }
-    }
-}
-
 void SixelImageBuilder::setColor(unsigned index, RGBColor const& color)
 {
     _colors->setColor(index, color);
@@ -436,6 +410,30 @@ void SixelImageBuilder::newline()
     if (unbox<unsigned int>(_sixelCursor.line) + _sixelBandHeight
         < unbox(_explicitSize ? _size.height : _maxSize.height))
         _sixelCursor.line = LineOffset::cast_from(_sixelCursor.line.as<unsigned int>() + _sixelBandHeight);
+
+    if (_onBandComplete)
+        _onBandComplete();
+}
+
+ImageSize SixelImageBuilder::completedSize() const noexcept
+{
+    auto const heightLimit = _explicitSize ? _size.height : _maxSize.height;
+    auto const completedHeight = Height::cast_from(_sixelCursor.line.as<unsigned int>());
+    return ImageSize { _size.width, min(completedHeight, heightLimit) };
+}
+
+SixelImageBuilder::Buffer SixelImageBuilder::completedData() const
+{
+    auto const size = completedSize();
+    auto const stride = unbox<size_t>(_explicitSize ? _size.width : _maxSize.width) * 4;
+    auto const rowLength = unbox<size_t>(size.width) * 4;
+
+    Buffer data(size.area() * 4);
+    for (size_t row = 0; row < unbox<size_t>(size.height); ++row)
+        std::copy_n(_buffer.begin() + static_cast<ptrdiff_t>(row * stride),
+                    rowLength,
+                    data.begin() + static_cast<ptrdiff_t>(row * rowLength));
+    return data;
 }
 
 void SixelImageBuilder::setRaster(unsigned int pan, unsigned int pad, optional<ImageSize> imageSize)
@@ -456,20 +454,53 @@ void SixelImageBuilder::setRaster(unsigned int pan, unsigned int pad, optional<I
 
 void SixelImageBuilder::render(int8_t sixel)
 {
-    // TODO: respect aspect ratio!
-    auto const x = _sixelCursor.column;
-    if (unbox(x) < unbox<int>((_explicitSize ? _size.width : _maxSize.width)))
+    renderRepeated(sixel, 1);
+}
+
+void SixelImageBuilder::renderRepeated(int8_t sixel, unsigned count)
+{
+    // The buffer is laid out with the maximum width as row stride until the image size is known.
+    auto const stride = unbox<int>(_explicitSize ? _size.width : _maxSize.width);
+    auto const heightLimit = unbox<int>(_explicitSize ? _size.height : _maxSize.height);
+    auto const x = unbox(_sixelCursor.column);
+    if (x < 0 || x >= stride)
+        return;
+
+    // Clip the run once, rather than checking the bounds of every single pixel.
+    auto const spanWidth = static_cast<int>(min(count, static_cast<unsigned>(stride - x)));
+    _sixelCursor.column += spanWidth;
+
+    if (sixel == 0)
+        return;
+
+    auto const color = currentColor();
+    auto const pixel = std::array<uint8_t, 4> { color.red, color.green, color.blue, 0xFF };
+
+    for (int i = 0; i < 6; ++i)
     {
-        for (unsigned int i = 0; i < 6; ++i)
+        if ((sixel & (1 << i)) == 0)
+            continue;
+
+        auto const y = unbox(_sixelCursor.line) + i * static_cast<int>(_aspectRatio);
+        if (y < 0 || y >= heightLimit)
+            continue;
+
+        if (!_explicitSize)
+        {
+            if (y >= unbox<int>(_size.height))
+                _size.height = Height::cast_from(min(y + static_cast<int>(_aspectRatio), heightLimit));
+            if (x + spanWidth > unbox<int>(_size.width))
+                _size.width = Width::cast_from(x + spanWidth);
+        }
+
+        // Each pin is stretched vertically by the aspect ratio, filling one contiguous row span each.
+        auto const rowEnd = min(y + static_cast<int>(_aspectRatio), heightLimit);
+        for (auto row = y; row < rowEnd; ++row)
         {
-            auto const y = _sixelCursor.line + static_cast<int>(i * _aspectRatio);
-            auto const pos = CellLocation { y, x };
-            auto const pin = 1 << i;
-            auto const pinned = (sixel & pin) != 0;
-            if (pinned)
-                write(pos, currentColor());
+            auto* target = _buffer.data() + (static_cast<size_t>(row * stride) + static_cast<size_t>(x)) * 4;
+            for (int n = 0; n < spanWidth; ++n, target += 4)
+                std::memcpy(target, pixel.data(), pixel.size());
         }
-        _sixelCursor.column++;
     }
 }
 
@@ -483,18 +514,16 @@ void SixelImageBuilder::finalize()
     }
     if (!_explicitSize)
     {
-        Buffer tempBuffer(static_cast<size_t>(_size.height.value * _size.width.value) * 4);
-        for (auto i = 0u; i < unbox(_size.height); ++i)
-        {
-            for (auto j = 0u; j < unbox(_size.width); ++j)
-            {
-                std::copy_n(_buffer.begin() + i * unbox<long>(_maxSize.width) * 4,
-                            _size.width.value * 4,
-                            tempBuffer.begin() + i * unbox<long>(_size.width) * 4);
-            }
-        }
+        // Compact the rows from the maximum width stride down to the actual image width,
+        // copying each row exactly once.
+        auto const sourceStride = unbox<size_t>(_maxSize.width) * 4;
+        auto const targetStride = unbox<size_t>(_size.width) * 4;
+        Buffer tempBuffer(_size.area() * 4);
+        for (size_t row = 0; row < unbox<size_t>(_size.height); ++row)
+            std::copy_n(_buffer.begin() + static_cast<ptrdiff_t>(row * sourceStride),
+                        targetStride,
+                        tempBuffer.begin() + static_cast<ptrdiff_t>(row * targetStride));
         _buffer.swap(tempBuffer);
-        _explicitSize = false;
     }
 }
 
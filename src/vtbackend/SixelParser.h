@@ -9,6 +9,7 @@
 #include <crispy/range.h>
 
 #include <array>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string_view>
@@ -66,6 +67,13 @@ class SixelParser: public ParserExtension
         /// renders a given sixel at the current sixel-cursor position.
         virtual void render(int8_t sixel) = 0;
 
+        /// renders a given sixel @p count times, starting at the current sixel-cursor position.
+        virtual void renderRepeated(int8_t sixel, unsigned count)
+        {
+            for (unsigned i = 0; i < count; ++i)
+                render(sixel);
+        }
+
         /// Finalizes the image by optimizing the underlying storage to its minimal dimension in storage.
         virtual void finalize() = 0;
     };
@@ -94,7 +102,9 @@ class SixelParser: public ParserExtension
     }
 
     // ParserExtension overrides
+    using ParserExtension::pass;
     void pass(char ch) override;
+    void pass(std::string_view chars) override { parseFragment(chars); }
     void finalize() override;
 
   private:
@@ -165,12 +175,21 @@ class SixelImageBuilder: public SixelParser::Events
     void newline() override;
     void setRaster(unsigned int pan, unsigned int pad, std::optional<ImageSize> imageSize) override;
     void render(int8_t sixel) override;
+    void renderRepeated(int8_t sixel, unsigned count) override;
     void finalize() override;
 
     [[nodiscard]] CellLocation const& sixelCursor() const noexcept { return _sixelCursor; }
 
-  private:
-    void write(CellLocation const& coord, RGBColor const& value) noexcept;
+    /// Sets the handler to be invoked whenever a sixel band has been completed, i.e. on every newline,
+    /// allowing partially transmitted images to be displayed progressively.
+    using OnBandComplete = std::function<void()>;
+    void setBandCompleteHandler(OnBandComplete handler) { _onBandComplete = std::move(handler); }
+
+    /// @returns the size in pixels of the image data made up by the sixel bands completed so far.
+    [[nodiscard]] ImageSize completedSize() const noexcept;
+
+    /// @returns a copy of the RGBA data of the sixel bands completed so far, sized to completedSize().
+    [[nodiscard]] Buffer completedData() const;
 
   private:
     ImageSize const _maxSize;
@@ -185,6 +204,7 @@ class SixelImageBuilder: public SixelParser::Events
     unsigned int _aspectRatio;
     // Height of sixel band in pixels
     unsigned int _sixelBandHeight;
+    OnBandComplete _onBandComplete;
 };
 
 } // namespace vtbackend
@@ -237,6 +237,37 @@ TEST_CASE("SixelParser.rep", "[sixel]")
     }
 }
 
+TEST_CASE("SixelParser.rep_clipped", "[sixel]")
+{
+    auto constexpr DefaultColor = RGBAColor { 0, 0, 0, 0xFF };
+    auto constexpr PinColor = RGBColor { 0x10, 0x20, 0x30 };
+    auto ib = SixelImageBuilder(
+        ImageSize { Width(6), Height(8) }, 1, 1, DefaultColor, std::make_shared<SixelColorPalette>(16, 256));
+    ib.setRaster(2, 1, ImageSize { Width(6), Height(4) }); // aspect ratio 2:1, 6x8 pixels
+    auto sp = SixelParser { ib };
+
+    ib.setColor(0, PinColor);
+
+    // Run of pins 0 and 2, starting at column 2 and exceeding the image width.
+    sp.parseFragment("??!10D");
+
+    CHECK(ib.sixelCursor() == CellLocation { LineOffset(0), ColumnOffset(6) });
+
+    for (int x = 0; x < ib.size().width.as<int>(); ++x)
+    {
+        for (int y = 0; y < ib.size().height.as<int>(); ++y)
+        {
+            INFO(fmt::format("x={}, y={}", x, y));
+            auto const& actualColor = ib.at(CellLocation { LineOffset(y), ColumnOffset(x) });
+            auto const pinned = x >= 2 && (y == 0 || y == 1 || y == 4 || y == 5);
+            if (pinned)
+                CHECK(actualColor.rgb() == PinColor);
+            else
+                CHECK(actualColor == DefaultColor);
+        }
+    }
+}
+
 TEST_CASE("SixelParser.setAndUseColor", "[sixel]")
 {
     auto constexpr PinColors = std::array<RGBAColor, 5> { RGBAColor { 255, 255, 255, 255 },
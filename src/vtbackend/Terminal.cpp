@@ -2,6 +2,7 @@
 #include <vtbackend/ControlCode.h>
 #include <vtbackend/Functions.h>
 #include <vtbackend/InputGenerator.h>
+#include <vtbackend/InputLatencyTracker.h>
 #include <vtbackend/RenderBuffer.h>
 #include <vtbackend/RenderBufferBuilder.h>
 #include <vtbackend/Terminal.h>
@@ -12,7 +13,9 @@
 #include <vtpty/MockPty.h>
 
 #include <crispy/assert.h>
+#include <crispy/cpu_time.h>
 #include <crispy/escape.h>
+#include <crispy/trace.h>
 #include <crispy/utils.h>
 
 #include <libunicode/convert.h>
@@ -25,6 +28,10 @@
 
 #include <chrono>
 #include <cstdlib>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <thread>
 #include <utility>
 #include <variant>
 
@@ -129,11 +136,16 @@ Terminal::Terminal(Events& eventListener,
     _settings { _factorySettings },
     _state { *this },
     _currentTime { now },
-    _ptyBufferPool { crispy::nextPowerOfTwo(_settings.ptyBufferObjectSize) },
+    _ptyBufferPool { crispy::nextPowerOfTwo(_settings.ptyBufferObjectSize), PtyBufferSizeClasses },
+    _lastPtyBufferTrim { now },
     _currentPtyBuffer { _ptyBufferPool.allocateBufferObject() },
-    _ptyReadBufferSize { crispy::nextPowerOfTwo(_settings.ptyReadBufferSize) },
+    _ptyReadSizer { std::min(MinPtyReadSize, crispy::nextPowerOfTwo(_settings.ptyReadBufferSize)),
+                    std::min(MaxPtyReadSizeFactor * crispy::nextPowerOfTwo(_settings.ptyReadBufferSize),
+                             LargePtyBufferFactor * crispy::nextPowerOfTwo(_settings.ptyBufferObjectSize)
+                                 / MinPtyReadsPerBuffer) },
     _pty { std::move(pty) },
     _lastCursorBlink { now },
+    _lastCursorActivity { now },
     _primaryScreen { *this,
                      &_state.mainScreenMargin,
                      _settings.pageSize,
@@ -158,8 +170,11 @@ Terminal::Terminal(Events& eventListener,
     _currentScreen { &_primaryScreen },
     _viewport { *this, std::bind(&Terminal::onViewportChanged, this) },
     _traceHandler { *this },
+    _sequenceHandler { &_primaryScreen },
     _selectionHelper { this },
-    _refreshInterval { _settings.refreshRate }
+    _refreshInterval { _settings.refreshRate },
+    _inputThreadQos { _settings.inputThreadQos },
+    _detachedInputThreadQos { _settings.detachedInputThreadQos }
 {
     _state.savedColorPalettes.reserve(MaxColorPaletteSaveStackSize);
 
@@ -173,6 +188,16 @@ Terminal::Terminal(Events& eventListener,
 
     for (auto const& [mode, frozen]: _settings.frozenModes)
         freezeMode(mode, frozen);
+
+    if (_settings.historySpillToDisk)
+        setHistorySpill(true, _settings.historyMemoryBudget);
+    setHistorySearchIndex(_settings.historySearchIndex);
+}
+
+Terminal::~Terminal()
+{
+    stopSearchThread();
+    stopPtyReader();
 }
 
 void Terminal::onViewportChanged()
@@ -188,6 +213,7 @@ void Terminal::setRefreshRate(RefreshRate refreshRate)
 {
     _settings.refreshRate = refreshRate;
     _refreshInterval = RefreshInterval { refreshRate };
+    _framePacer.reset();
 }
 
 void Terminal::setLastMarkRangeOffset(LineOffset value) noexcept
@@ -195,39 +221,323 @@ void Terminal::setLastMarkRangeOffset(LineOffset value) noexcept
     _settings.copyLastMarkRangeOffset = value;
 }
 
-vtpty::Pty::ReadResult Terminal::readFromPty()
+std::optional<std::chrono::milliseconds> Terminal::ptyReadTimeout() const noexcept
 {
-    auto const timeout =
+    if (_discardedLinesPending)
+        return std::chrono::milliseconds(0); // keep destroying discarded lines in between reads
 #if defined(LIBTERMINAL_PASSIVE_RENDER_BUFFER_UPDATE)
-        (_renderBuffer.state == RenderBufferState::WaitingForRefresh && !_screenDirty)
-            ? std::optional { _refreshInterval.value }
-            : std::chrono::milliseconds(0);
+    if (_detached)
+        return std::nullopt; // nothing to refresh until attached again
+    if (_renderBuffer.state != RenderBufferState::WaitingForRefresh)
+        return std::chrono::milliseconds(0);
+    if (!_screenDirty)
+        return _refreshInterval.value;
+    if (auto const delay = frameThrottleDelay(); delay > std::chrono::milliseconds(0))
+        return delay;
+
+    // Wait for output until it is time to refresh the render buffer for the next vertical blank.
+    return nextRefreshDelay().value_or(std::chrono::milliseconds(0));
 #else
-        std::optional<std::chrono::milliseconds> { std::nullopt };
+    return std::nullopt;
 #endif
+}
+
+std::optional<std::chrono::steady_clock::time_point> Terminal::nextRefreshDeadline() const noexcept
+{
+    if (!_settings.vsyncFramePacing)
+        return std::nullopt;
+    return _framePacer.nextDeadline(std::chrono::steady_clock::now(), _lastRefreshStart.load());
+}
+
+bool Terminal::flooded() const noexcept
+{
+    return isPrimaryScreen() && _floodControl.flooded(std::chrono::steady_clock::now());
+}
+
+std::chrono::milliseconds Terminal::frameThrottleDelay() const noexcept
+{
+    if (!isPrimaryScreen())
+        return std::chrono::milliseconds(0);
+    return std::chrono::ceil<std::chrono::milliseconds>(
+        _floodControl.frameDelay(std::chrono::steady_clock::now()));
+}
+
+void Terminal::releaseDiscardedLines()
+{
+    auto pending = _primaryScreen.grid().releaseDiscardedLines(DiscardedLinesPerTurn);
+    pending = _alternateScreen.grid().releaseDiscardedLines(DiscardedLinesPerTurn) || pending;
+    pending = _hostWritableStatusLineScreen.grid().releaseDiscardedLines(DiscardedLinesPerTurn) || pending;
+    pending = _indicatorStatusScreen.grid().releaseDiscardedLines(DiscardedLinesPerTurn) || pending;
+    _discardedLinesPending = pending;
+}
+
+void Terminal::collectHyperlinks()
+{
+    auto referenced = std::vector<bool>(size_t { std::numeric_limits<uint16_t>::max() } + 1);
+    _primaryScreen.markHyperlinks(referenced);
+    _alternateScreen.markHyperlinks(referenced);
+    _hostWritableStatusLineScreen.markHyperlinks(referenced);
+    _indicatorStatusScreen.markHyperlinks(referenced);
+    referenced[_hoveringHyperlinkId.load().value] = true;
 
-    // Request a new Buffer Object if the current one cannot sufficiently
-    // store a single text line.
-    if (_currentPtyBuffer->bytesAvailable() < unbox<size_t>(_settings.pageSize.columns))
+    auto const before = _state.hyperlinks.size();
+    _state.hyperlinks.collect(referenced);
+    terminalLog()("Collected {} of {} hyperlinks.", before - _state.hyperlinks.size(), before);
+}
+
+void Terminal::inspectSequenceStats([[maybe_unused]] std::ostream& output) const
+{
+#if defined(LIBTERMINAL_SEQUENCE_STATS)
+    auto const l = std::lock_guard { *this };
+    _state.sequenceStats.inspect(output, _state.parser.stats());
+#endif
+}
+
+FloodControl::Stats Terminal::floodStats() const noexcept
+{
+    auto stats = _floodControl.stats(std::chrono::steady_clock::now());
+    stats.flooded = stats.flooded && isPrimaryScreen();
+    return stats;
+}
+
+std::optional<std::chrono::milliseconds> Terminal::nextRefreshDelay() const noexcept
+{
+    auto const deadline = nextRefreshDeadline();
+    if (!deadline)
+        return std::nullopt;
+    auto const delay = *deadline - std::chrono::steady_clock::now();
+    return std::max(std::chrono::ceil<std::chrono::milliseconds>(delay), std::chrono::milliseconds(0));
+}
+
+std::optional<vtpty::Pty::ScatteredRead> Terminal::readFromPty()
+{
+    return readFromPty(_currentPtyBuffer, _nextPtyBuffer, ptyReadTimeout());
+}
+
+std::optional<vtpty::Pty::ScatteredRead> Terminal::readFromPty(
+    crispy::buffer_object_ptr<char> const& buffer,
+    crispy::buffer_object_ptr<char>& nextBuffer,
+    std::optional<std::chrono::milliseconds> timeout)
+{
+    auto const readSize = _ptyReadSizer.readSize();
+    auto readResult = std::optional<vtpty::Pty::ScatteredRead> {};
+    if (buffer->bytesAvailable() >= readSize)
     {
-        if (vtpty::ptyInLog)
-            vtpty::ptyInLog()("Only {} bytes left in TBO. Allocating new buffer from pool.",
-                              _currentPtyBuffer->bytesAvailable());
-        _currentPtyBuffer = _ptyBufferPool.allocateBufferObject();
+        if (auto const result = _pty->read(*buffer, timeout, readSize); result)
+            readResult = vtpty::Pty::ScatteredRead { std::get<0>(*result), {}, std::get<1>(*result) };
+    }
+    else
+    {
+        // Rather than wasting the tail of the buffer object, reads continue into the next one.
+        if (!nextBuffer)
+        {
+            if (vtpty::ptyInLog)
+                vtpty::ptyInLog()("Only {} bytes left in TBO. Continuing reads into a new buffer from pool.",
+                                  buffer->bytesAvailable());
+            nextBuffer = allocatePtyBuffer();
+        }
+        readResult = _pty->readScattered(*buffer, *nextBuffer, timeout, readSize);
     }
 
-    return _pty->read(*_currentPtyBuffer, timeout, _ptyReadBufferSize);
+    if (readResult)
+        adaptPtyReadSize(readResult->head.size() + readResult->tail.size());
+    return readResult;
+}
+
+void Terminal::adaptPtyReadSize(size_t bytesRead)
+{
+    auto const previousSize = _ptyReadSizer.readSize();
+    if (_ptyReadSizer.bytesRead(bytesRead, std::chrono::steady_clock::now()) && vtpty::ptyInLog)
+        vtpty::ptyInLog()("Adapting PTY read size from {} to {} bytes at {} KB/s.",
+                          previousSize,
+                          _ptyReadSizer.readSize(),
+                          _ptyReadSizer.bytesPerSecond() / 1024);
+}
+
+crispy::buffer_object_ptr<char> Terminal::allocatePtyBuffer()
+{
+    // Large reads would fill a regular buffer object after only a few of them.
+    auto buffer = _ptyBufferPool.allocateBufferObject(_ptyReadSizer.readSize() * MinPtyReadsPerBuffer);
+    if (vtpty::ptyInLog)
+        vtpty::ptyInLog()("Allocated buffer object of {} bytes for reads of {} bytes.",
+                          buffer->capacity(),
+                          _ptyReadSizer.readSize());
+    return buffer;
+}
+
+// {{{ PTY reader thread
+void Terminal::ptyReaderLoop()
+{
+    auto buffer = allocatePtyBuffer();
+    auto nextBuffer = crispy::buffer_object_ptr<char> {};
+    auto appliedQos = std::optional<crispy::thread_qos> {};
+
+    while (!_ptyReaderQuit)
+    {
+        applyInputThreadQos(appliedQos);
+        auto const readResult = readFromPty(buffer, nextBuffer, std::nullopt);
+        if (!readResult)
+        {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            pushPtyChunk(PtyChunk { buffer, {}, false, errno });
+            break;
+        }
+
+        auto const& [head, tail, fromStdoutFastPipe] = *readResult;
+        if (head.empty() && tail.empty())
+        {
+            pushPtyChunk(PtyChunk { buffer });
+            break;
+        }
+        _inputLatency.outputRead(std::chrono::steady_clock::now());
+
+        // Claim the bytes read, as the parser thread may still reference them
+        // while the next read already goes into the same buffer object.
+        if (!head.empty())
+        {
+            buffer->advance(head.size());
+            pushPtyChunk(PtyChunk { buffer, head, fromStdoutFastPipe });
+        }
+        if (!tail.empty())
+        {
+            buffer = std::exchange(nextBuffer, nullptr);
+            buffer->advance(tail.size());
+            pushPtyChunk(PtyChunk { buffer, tail, fromStdoutFastPipe });
+        }
+    }
+}
+
+void Terminal::pushPtyChunk(PtyChunk chunk)
+{
+    while (!_ptyChunks.try_push(std::move(chunk)))
+    {
+        // The parser is lagging behind. Wait for it to make room.
+        auto lock = std::unique_lock { _ptyChunkMutex };
+        _ptyChunkCondition.wait(lock, [this]() { return !_ptyChunks.full() || _ptyReaderQuit; });
+        if (_ptyReaderQuit)
+            return;
+    }
+
+    // Taking the lock pairs with the consumer evaluating its wait predicate, so the wakeup is not lost.
+    {
+        auto const _ = std::lock_guard { _ptyChunkMutex };
+    }
+    _ptyChunkCondition.notify_all();
 }
 
+void Terminal::wakeupPtyChunkConsumer()
+{
+    if (!_settings.ptyReaderThread)
+        return;
+
+    {
+        auto const _ = std::lock_guard { _ptyChunkMutex };
+        _ptyChunkConsumerWakeup = true;
+    }
+    _ptyChunkCondition.notify_all();
+}
+
+void Terminal::stopPtyReader()
+{
+    if (!_ptyReaderThread.joinable())
+        return;
+
+    {
+        auto const _ = std::lock_guard { _ptyChunkMutex };
+        _ptyReaderQuit = true;
+    }
+    _ptyChunkCondition.notify_all();
+    _pty->wakeupReader();
+    _ptyReaderThread.join();
+}
+
+bool Terminal::processPtyChunks()
+{
+    if (!_ptyReaderThread.joinable())
+        _ptyReaderThread = std::thread(&Terminal::ptyReaderLoop, this);
+
+    {
+        auto lock = std::unique_lock { _ptyChunkMutex };
+        auto const ready = [this]() {
+            return !_ptyChunks.empty() || std::exchange(_ptyChunkConsumerWakeup, false);
+        };
+        if (auto const timeout = ptyReadTimeout(); timeout.has_value())
+            _ptyChunkCondition.wait_for(lock, *timeout, ready);
+        else
+            _ptyChunkCondition.wait(lock, ready);
+    }
+
+    // Only drain what is there right now, so that the terminal lock is not held indefinitely
+    // while the reader thread keeps up with the parser.
+    auto const chunkCount = _ptyChunks.size();
+    if (chunkCount == 0)
+    {
+        // Nothing to be parsed, so take the chance to destroy the cells of recently cleared lines,
+        // and the next batch of the lines discarded by clearing the history.
+        auto const _ = std::lock_guard { *this };
+        _primaryScreen.grid().releaseRetiredLineBuffers();
+        _alternateScreen.grid().releaseRetiredLineBuffers();
+        if (_discardedLinesPending)
+            releaseDiscardedLines();
+        return true;
+    }
+
+    auto parsedBytes = size_t { 0 };
+    auto parseStart = std::chrono::steady_clock::time_point {};
+    auto const parseCpuStart = crispy::current_thread_cpu_time();
+    {
+        auto const _ = std::lock_guard { *this };
+        parseStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < chunkCount; ++i)
+        {
+            auto chunk = _ptyChunks.try_pop();
+            if (chunk->data.empty())
+            {
+                if (chunk->errorCode != 0)
+                    terminalLog()("PTY read failed. {}", strerror(chunk->errorCode));
+                else
+                    terminalLog()("PTY read returned with zero bytes. Closing PTY.");
+                _pty->close();
+                return false;
+            }
+
+            _state.usingStdoutFastPipe = chunk->fromStdoutFastPipe;
+            if (_recorder) [[unlikely]]
+                recordPtyOutput(chunk->buffer, chunk->data);
+            _currentPtyBuffer = std::move(chunk->buffer);
+            parseInSlices(chunk->data);
+            parsedBytes += chunk->data.size();
+        }
+        reconcilePredictedEcho();
+    }
+    auto const parseEnd = std::chrono::steady_clock::now();
+    _parseCpuTime.fetch_add((crispy::current_thread_cpu_time() - parseCpuStart).count(),
+                            std::memory_order_relaxed);
+    _floodControl.outputParsed(parsedBytes, parseEnd - parseStart, parseEnd);
+    _inputLatency.outputParsed();
+    _parsedBytes.fetch_add(parsedBytes, std::memory_order_relaxed);
+
+    // Let the reader thread know there is room in the queue again.
+    {
+        auto const _ = std::lock_guard { _ptyChunkMutex };
+    }
+    _ptyChunkCondition.notify_all();
+
+    return true;
+}
+// }}}
+
 void Terminal::setExecutionMode(ExecutionMode mode)
 {
     auto _ = std::unique_lock(_state.breakMutex);
     _state.executionMode = mode;
     _state.breakCondition.notify_one();
     _pty->wakeupReader();
+    wakeupPtyChunkConsumer();
 }
 
-bool Terminal::processInputOnce()
+bool Terminal::prepareToReadInput(bool mayBlock)
 {
     // clang-format off
     switch (_state.executionMode.load())
@@ -240,14 +550,16 @@ bool Terminal::processInputOnce()
             {
                 auto const _ = std::lock_guard { *this };
                 _traceHandler.flushAllPending();
-                return true;
+                return false;
             }
             break;
         case ExecutionMode::Waiting:
         {
+            if (!mayBlock)
+                return false;
             auto lock = std::unique_lock(_state.breakMutex);
             _state.breakCondition.wait(lock, [this]() { return _state.executionMode != ExecutionMode::Waiting; });
-            return true;
+            return false;
         }
         case ExecutionMode::SingleStep:
             if (!_traceHandler.pendingSequences().empty())
@@ -255,45 +567,223 @@ bool Terminal::processInputOnce()
                 auto const _ = std::lock_guard { *this };
                 _state.executionMode = ExecutionMode::Waiting;
                 _traceHandler.flushOne();
-                return true;
+                return false;
             }
             break;
     }
     // clang-format on
 
-    auto const readResult = readFromPty();
+    // Execution mode changes requested by setExecutionMode() take effect from the next read on.
+    updateSequenceHandler();
+    return true;
+}
+
+void Terminal::updateSequenceHandler() noexcept
+{
+    if (_state.executionMode.load() == ExecutionMode::Normal)
+        _sequenceHandler = &activeDisplay();
+    else
+        _sequenceHandler = &_traceHandler;
+}
 
+std::optional<size_t> Terminal::parsePtyRead(std::optional<vtpty::Pty::ScatteredRead> const& readResult)
+{
     if (!readResult)
     {
         if (errno == EINTR || errno == EAGAIN)
-            return true;
+            return 0;
 
         terminalLog()("PTY read failed. {}", strerror(errno));
         _pty->close();
-        return false;
+        return std::nullopt;
     }
-    string_view const buf = std::get<0>(*readResult);
-    _state.usingStdoutFastPipe = std::get<1>(*readResult);
+    auto const& [head, tail, fromStdoutFastPipe] = *readResult;
+    _state.usingStdoutFastPipe = fromStdoutFastPipe;
+    _inputLatency.outputRead(std::chrono::steady_clock::now());
 
-    if (buf.empty())
+    if (head.empty() && tail.empty())
     {
         terminalLog()("PTY read returned with zero bytes. Closing PTY.");
         _pty->close();
+        return std::nullopt;
+    }
+
+    auto parseStart = std::chrono::steady_clock::time_point {};
+    auto const parseCpuStart = crispy::current_thread_cpu_time();
+    {
+        auto const _ = std::lock_guard { *this };
+        parseStart = std::chrono::steady_clock::now();
+        if (_recorder) [[unlikely]]
+            recordPtyOutput(_currentPtyBuffer, head);
+        parseInSlices(head);
+        if (!tail.empty())
+        {
+            // The read continued into the next buffer object, which the rest is referenced from.
+            _currentPtyBuffer = std::exchange(_nextPtyBuffer, nullptr);
+            if (_recorder) [[unlikely]]
+                recordPtyOutput(_currentPtyBuffer, tail);
+            parseInSlices(tail);
+        }
+        reconcilePredictedEcho();
+    }
+    auto const parseEnd = std::chrono::steady_clock::now();
+    _parseCpuTime.fetch_add((crispy::current_thread_cpu_time() - parseCpuStart).count(),
+                            std::memory_order_relaxed);
+    _floodControl.outputParsed(head.size() + tail.size(), parseEnd - parseStart, parseEnd);
+    _inputLatency.outputParsed();
+    _parsedBytes.fetch_add(head.size() + tail.size(), std::memory_order_relaxed);
+
+    return head.size() + tail.size();
+}
+
+void Terminal::recordPtyOutput(crispy::buffer_object_ptr<char> const& buffer, std::string_view data)
+{
+    auto const now = std::chrono::steady_clock::now();
+    if (data.data() < buffer->data() || data.data() + data.size() > buffer->end())
+    {
+        // Not read into the buffer object, e.g. if the PTY handed out its own memory.
+        _recorder->output(data, now);
+        return;
+    }
+
+    // Neither the next read nor the parser (moving text next to the line's text) may overwrite these bytes.
+    buffer->advanceHotEndUntil(data.data() + data.size());
+    _recorder->output(crispy::BufferFragment<char>(buffer, data), now);
+}
+
+bool Terminal::startRecording(std::filesystem::path const& path, RecordingFormat format)
+{
+    auto recorder = SessionRecorder::create(path, format, pageSize());
+    if (!recorder)
+    {
+        terminalLog()("Could not create the recording {}.", path.string());
         return false;
     }
 
+    // The previous recording is completed outside of the lock, so as to not keep the parser waiting.
     {
         auto const _ = std::lock_guard { *this };
-        _state.parser.parseFragment(buf);
+        std::swap(_recorder, recorder);
     }
+    terminalLog()("Recording PTY output into {}.", path.string());
+    return true;
+}
 
-    if (!_state.modes.enabled(DECMode::BatchedRendering))
+std::optional<SessionRecorder::Stats> Terminal::stopRecording()
+{
+    auto recorder = std::unique_ptr<SessionRecorder> {};
+    {
+        auto const _ = std::lock_guard { *this };
+        std::swap(_recorder, recorder);
+    }
+    if (!recorder)
+        return std::nullopt;
+
+    recorder->flush();
+    auto const stats = recorder->stats();
+    terminalLog()("Recorded {} bytes of PTY output into {}.", stats.bytes, recorder->path().string());
+    return stats;
+}
+
+std::optional<std::filesystem::path> Terminal::recordingPath() const
+{
+    auto const _ = std::lock_guard { *this };
+    if (!_recorder)
+        return std::nullopt;
+    return _recorder->path();
+}
+
+void Terminal::parseInSlices(std::string_view data)
+{
+    auto const sliceSize = _settings.parseSliceSize != 0 ? _settings.parseSliceSize : data.size();
+    while (data.size() > sliceSize)
+    {
+        _state.parser.parseFragment(data.substr(0, sliceSize));
+        data.remove_prefix(sliceSize);
+
+        // Give the GUI thread a chance to take the lock for keyboard input or rendering.
+        unlock();
+        std::this_thread::yield();
+        lock();
+    }
+    _state.parser.parseFragment(data);
+}
+
+void Terminal::inputProcessed()
+{
+    if (_renderBufferUpdateEnabled)
         screenUpdated();
+    else
+        ++_deferredScreenUpdates;
 
 #if defined(LIBTERMINAL_PASSIVE_RENDER_BUFFER_UPDATE)
     ensureFreshRenderBuffer();
 #endif
+}
+
+bool Terminal::processInputOnce()
+{
+    auto const traceSpan = crispy::trace_span("Terminal.processInputOnce");
+    auto const allocations = crispy::allocation_scope { _inputAllocations };
+
+    applyInputThreadQos(_processingThreadQos);
+
+    if (!prepareToReadInput(true))
+        return true;
+
+    if (_settings.ptyReaderThread)
+    {
+        if (!processPtyChunks())
+            return false;
+        inputProcessed();
+        return true;
+    }
 
+    auto const parsedBytes = parsePtyRead(readFromPty());
+    if (!parsedBytes)
+        return false;
+    if (*parsedBytes != 0)
+        inputProcessed();
+    else if (_discardedLinesPending)
+    {
+        auto const _ = std::lock_guard { *this };
+        releaseDiscardedLines();
+    }
+    return true;
+}
+
+void Terminal::applyInputThreadQos(std::optional<crispy::thread_qos>& applied) const
+{
+    auto const qos = _detached ? _detachedInputThreadQos.load() : _inputThreadQos.load();
+    if (applied == qos)
+        return;
+
+    applied = qos;
+    auto const actual = crispy::set_current_thread_qos(qos);
+    terminalLog()("Scheduling input thread as {} (requested {}).",
+                  actual ? crispy::to_string(*actual) : "unsupported",
+                  crispy::to_string(qos));
+}
+
+bool Terminal::processAvailableInput(size_t budget)
+{
+    auto const traceSpan = crispy::trace_span("Terminal.processAvailableInput");
+    assert(!_settings.ptyReaderThread);
+
+    auto processedBytes = size_t { 0 };
+    while (processedBytes < budget && prepareToReadInput(false))
+    {
+        auto const parsedBytes =
+            parsePtyRead(readFromPty(_currentPtyBuffer, _nextPtyBuffer, std::chrono::milliseconds(0)));
+        if (!parsedBytes)
+            return false;
+        if (*parsedBytes == 0)
+            break;
+        processedBytes += *parsedBytes;
+    }
+
+    if (processedBytes != 0)
+        inputProcessed();
     return true;
 }
 
@@ -308,6 +798,7 @@ void Terminal::breakLoopAndRefreshRenderBuffer()
     //     return;
 
     _pty->wakeupReader();
+    wakeupPtyChunkConsumer();
 }
 
 bool Terminal::refreshRenderBuffer(bool locked)
@@ -321,12 +812,25 @@ bool Terminal::ensureFreshRenderBuffer(bool locked)
 {
     if (!_renderBufferUpdateEnabled)
     {
-        // _renderBuffer.state = RenderBufferState::WaitingForRefresh;
-        return false;
+        // Applications not ending synchronized output in time get their screen updates shown anyway.
+        auto const deadline = synchronizedOutputDeadline();
+        if (!deadline || _currentTime < *deadline || !endSynchronizedOutputBatch())
+            return false;
+        ++_synchronizedOutputTimeouts;
+        _renderBuffer.state = RenderBufferState::RefreshBuffersAndTrySwap;
     }
 
-    auto const elapsed = _currentTime - _renderBuffer.lastUpdate;
-    auto const avoidRefresh = elapsed < _refreshInterval.value;
+    // Nobody would see the render buffer, and it is refreshed when attached again.
+    if (_detached)
+        return false;
+
+    auto const avoidRefresh = [&]() {
+        if (frameThrottleDelay() > std::chrono::milliseconds(0))
+            return true;
+        if (auto const deadline = nextRefreshDeadline())
+            return std::chrono::steady_clock::now() < *deadline;
+        return _currentTime - _renderBuffer.lastUpdate < _refreshInterval.value;
+    }();
 
     switch (_renderBuffer.state.load())
     {
@@ -336,12 +840,16 @@ bool Terminal::ensureFreshRenderBuffer(bool locked)
             _renderBuffer.state = RenderBufferState::RefreshBuffersAndTrySwap;
             [[fallthrough]];
         case RenderBufferState::RefreshBuffersAndTrySwap: {
+            auto const _ = crispy::trace_span("Terminal.ensureFreshRenderBuffer");
             auto& backBuffer = _renderBuffer.backBuffer();
             auto const lastCursorPos = backBuffer.cursor;
+            auto const refreshStart = std::chrono::steady_clock::now();
+            _lastRefreshStart = refreshStart;
             if (!locked)
                 fillRenderBuffer(_renderBuffer.backBuffer(), true);
             else
                 fillRenderBufferInternal(_renderBuffer.backBuffer(), true);
+            _framePacer.frameBuilt(std::chrono::steady_clock::now() - refreshStart);
             auto const cursorChanged =
                 lastCursorPos.has_value() != backBuffer.cursor.has_value()
                 || (backBuffer.cursor.has_value() && backBuffer.cursor->position != lastCursorPos->position);
@@ -351,7 +859,9 @@ bool Terminal::ensureFreshRenderBuffer(bool locked)
             [[fallthrough]];
         }
         case RenderBufferState::TrySwapBuffers: {
-            [[maybe_unused]] auto const success = _renderBuffer.swapBuffers(_currentTime);
+            auto const success = _renderBuffer.swapBuffers(_currentTime);
+            if (success)
+                _inputLatency.frameSwapped(_lastFrameID, std::chrono::steady_clock::now());
 
 #if defined(CONTOUR_PERF_STATS)
             logRenderBufferSwap(success, _lastFrameID);
@@ -438,13 +948,24 @@ void Terminal::fillRenderBuffer(RenderBuffer& output, bool includeSelection)
 
 void Terminal::fillRenderBufferInternal(RenderBuffer& output, bool includeSelection)
 {
+    auto const allocations = crispy::allocation_scope { _frameAllocations };
     verifyState();
 
+    if (!_colorLookupTable.builtFrom(colorPalette()))
+        _colorLookupTable = ColorLookupTable { colorPalette() };
+
+    // Keep the former contents around, such that unchanged lines can be taken over from them.
+    std::swap(output.cells, _previousFrame.cells);
+    std::swap(output.lines, _previousFrame.lines);
+    std::swap(output.codepoints, _previousFrame.codepoints);
+    std::swap(output.images, _previousFrame.images);
     output.clear();
 
     _changes.store(0);
     _screenDirty = false;
     ++_lastFrameID;
+    _inputLatency.frameBuilt(_lastFrameID);
+    _floodControl.frameBuilt(std::chrono::steady_clock::now());
 
 #if defined(CONTOUR_PERF_STATS)
     if (TerminalLog)
@@ -469,40 +990,258 @@ void Terminal::fillRenderBufferInternal(RenderBuffer& output, bool includeSelect
                                      : state().viCommands.cursorPosition };
 
     if (isPrimaryScreen())
-        _lastRenderPassHints =
-            _primaryScreen.render(RenderBufferBuilder<PrimaryScreenCell> { *this,
-                                                                           output,
-                                                                           baseLine,
-                                                                           mainDisplayReverseVideo,
-                                                                           HighlightSearchMatches::Yes,
-                                                                           _inputMethodData,
-                                                                           theCursorPosition,
-                                                                           includeSelection },
-                                  _viewport.scrollOffset(),
-                                  highlightSearchMatches);
+    {
+        // History lines are reflowed lazily after resizing, so ensure the ones in view are.
+        _primaryScreen.grid().reflowHistoryFrom(-boxed_cast<LineOffset>(_viewport.scrollOffset()));
+        if (unbox(_viewport.scrollOffset()) > unbox(_primaryScreen.historyLineCount()))
+            _viewport.scrollToTop();
+    }
+
+    if (isPrimaryScreen())
+        _lastRenderPassHints = fillRenderBufferMainDisplay(_primaryScreen,
+                                                            output,
+                                                            baseLine,
+                                                            mainDisplayReverseVideo,
+                                                            highlightSearchMatches,
+                                                            theCursorPosition,
+                                                            includeSelection);
     else
-        _lastRenderPassHints =
-            _alternateScreen.render(RenderBufferBuilder<AlternateScreenCell> { *this,
-                                                                               output,
-                                                                               baseLine,
-                                                                               mainDisplayReverseVideo,
-                                                                               HighlightSearchMatches::Yes,
-                                                                               _inputMethodData,
-                                                                               theCursorPosition,
-                                                                               includeSelection },
-                                    _viewport.scrollOffset(),
-                                    highlightSearchMatches);
+        _lastRenderPassHints = fillRenderBufferMainDisplay(_alternateScreen,
+                                                            output,
+                                                            baseLine,
+                                                            mainDisplayReverseVideo,
+                                                            highlightSearchMatches,
+                                                            theCursorPosition,
+                                                            includeSelection);
 
     if (_settings.statusDisplayPosition == StatusDisplayPosition::Bottom)
     {
         baseLine += pageSize().lines.as<LineOffset>();
         fillRenderBufferStatusLine(output, includeSelection, baseLine);
     }
+
+    _previousFrame.clear();
+}
+
+bool Terminal::RenderedFrame::rendersLike(RenderedFrame const& other) const noexcept
+{
+    // Only the colors used for rendering plain grid cells matter, as the cursor, selections,
+    // and search matches are rendered anew anyway.
+    // clang-format off
+    return primaryScreen == other.primaryScreen
+        && lineIdGeneration == other.lineIdGeneration
+        && pageSize == other.pageSize
+        && baseLine == other.baseLine
+        && reverseVideo == other.reverseVideo
+        && blink == other.blink
+        && rapidBlink == other.rapidBlink
+        && colors.useBrightColors == other.colors.useBrightColors
+        && colors.palette == other.colors.palette
+        && colors.defaultForeground == other.colors.defaultForeground
+        && colors.defaultForegroundBright == other.colors.defaultForegroundBright
+        && colors.defaultForegroundDimmed == other.colors.defaultForegroundDimmed
+        && colors.defaultBackground == other.colors.defaultBackground
+        && colors.hyperlinkDecoration.normal == other.colors.hyperlinkDecoration.normal
+        && colors.hyperlinkDecoration.hover == other.colors.hyperlinkDecoration.hover;
+    // clang-format on
+}
+
+template <typename Cell>
+RenderPassHints Terminal::fillRenderBufferMainDisplay(Screen<Cell>& screen,
+                                                      RenderBuffer& output,
+                                                      LineOffset baseLine,
+                                                      bool reverseVideo,
+                                                      HighlightSearchMatches highlightSearchMatches,
+                                                      optional<CellLocation> cursorPosition,
+                                                      bool includeSelection)
+{
+    auto frameState = RenderedFrame {};
+    frameState.reusable = !_selection && !_highlightRange && _state.searchMode.pattern.empty()
+                          && _inputMethodData.preeditString.empty();
+    frameState.primaryScreen = isPrimaryScreen();
+    frameState.scrollOffset = _viewport.scrollOffset();
+    frameState.lineIdGeneration = screen.grid().lineIdGeneration();
+    frameState.topLineId = screen.grid().lineId(-boxed_cast<LineOffset>(frameState.scrollOffset));
+    frameState.pageSize = screen.pageSize();
+    frameState.baseLine = baseLine;
+    frameState.reverseVideo = isModeEnabled(DECMode::ReverseVideo);
+    frameState.blink = blinkState();
+    frameState.rapidBlink = rapidBlinkState();
+    frameState.colors = colorPalette();
+    if (_predictiveEcho.expire(std::chrono::steady_clock::now()))
+        predictedEchoChanged();
+    if (auto const mousePosition = currentMouseGridPosition())
+        frameState.hoveringHyperlink = screen.hyperlinkIdAt(*mousePosition);
+
+    // Record the lines modified since the last frame as stale in the render buffers they are still shown in.
+    // Lines redrawn with identical contents (as full-screen applications frequently do) are not modified.
+    screen.grid().clearUnchangedDirtyLines();
+    auto const& dirtyLines = screen.grid().dirtyLines();
+    for (auto& frame: _renderedFrames)
+    {
+        frame.reusable = frame.reusable && frame.rendersLike(frameState);
+        if (!frame.reusable)
+            continue;
+        auto const viewportOffset = unbox<size_t>(frame.scrollOffset);
+        for (size_t line = 0; line < dirtyLines.size(); ++line)
+            if (dirtyLines[line] && line + viewportOffset < frame.staleLines.size())
+                frame.staleLines[line + viewportOffset] = true;
+
+        // Only the lines showing the hyperlink hovered before or now are decorated differently.
+        if (frame.hoveringHyperlink != frameState.hoveringHyperlink)
+            for (auto const& span: frame.hyperlinkSpans)
+                if ((span.hyperlink == frame.hoveringHyperlink
+                     || span.hyperlink == frameState.hoveringHyperlink)
+                    && unbox<size_t>(span.line) < frame.staleLines.size())
+                    frame.staleLines[unbox<size_t>(span.line)] = true;
+    }
+    screen.grid().clearDirtyLines();
+
+    // The lines showing a cursor depend on more than just their grid cells.
+    // The frame described by staleLines has shown the grid lines of this one shift lines further down.
+    auto const markCursorLines = [&](std::vector<bool>& staleLines, LineOffset shift) {
+        auto const mark = [&](LineOffset line) {
+            line += shift;
+            if (0 <= *line && unbox<size_t>(line) < staleLines.size())
+                staleLines[unbox<size_t>(line)] = true;
+        };
+        auto const cursorLine = screen.cursor().position.line;
+        mark(cursorLine);
+        mark(cursorLine + boxed_cast<LineOffset>(frameState.scrollOffset));
+        if (cursorPosition)
+            mark(cursorPosition->line + boxed_cast<LineOffset>(frameState.scrollOffset));
+        for (auto const& prediction: _predictiveEcho.predictions())
+            mark(prediction.position.line + boxed_cast<LineOffset>(frameState.scrollOffset));
+    };
+
+    RenderedFrame* frame = nullptr;
+    for (size_t i = 0; i < _renderBuffer.buffers.size(); ++i)
+        if (&output == &_renderBuffer.buffers[i])
+            frame = &_renderedFrames[i];
+
+    auto const reuseLines = frame && frame->reusable && frameState.reusable;
+    auto const lineShift =
+        reuseLines ? LineOffset::cast_from(static_cast<int64_t>(frameState.topLineId - frame->topLineId))
+                   : LineOffset(0);
+    auto previousLocations = std::vector<RenderedLineLocation> {};
+    auto previousHyperlinkSpans = std::vector<RenderedHyperlinkSpan> {};
+    if (frame)
+    {
+        if (reuseLines)
+        {
+            markCursorLines(frame->staleLines, lineShift);
+            previousLocations = std::move(frame->lineLocations);
+            previousHyperlinkSpans = std::move(frame->hyperlinkSpans);
+        }
+        frame->lineLocations.clear();
+        frame->hyperlinkSpans.clear();
+    }
+
+    auto const makeBuilder = [&](RenderBuffer& target,
+                                 std::vector<RenderedLineLocation>& lineLocations,
+                                 std::vector<RenderedHyperlinkSpan>& hyperlinkSpans) {
+        auto builder = RenderBufferBuilder<Cell> { *this,
+                                                   target,
+                                                   baseLine,
+                                                   reverseVideo,
+                                                   highlightSearchMatches,
+                                                   _inputMethodData,
+                                                   cursorPosition,
+                                                   includeSelection };
+        if (reuseLines)
+            builder.reuseLines(_previousFrame, previousLocations, frame->staleLines, lineShift);
+        if (frameState.primaryScreen && !_predictiveEcho.predictions().empty())
+            builder.showPredictedEcho(_predictiveEcho);
+        if (frame)
+        {
+            builder.trackLineLocations(lineLocations);
+            builder.trackHyperlinkSpans(hyperlinkSpans, previousHyperlinkSpans);
+        }
+        return builder;
+    };
+
+    // Large pages are split into bands of consecutive lines, each rendered on its own thread.
+    // The bands only read the terminal state, except for looking up hyperlinks, which is serialized,
+    // and for taking over the lines of the previous frame, which are distinct for each band.
+    auto constexpr MinCellsPerBand = 16 * 1024;
+    auto static const hardwareConcurrency =
+        static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+    auto const pageLines = unbox<int>(frameState.pageSize.lines);
+    auto const bandCount = std::min({ hardwareConcurrency,
+                                      std::max(1, pageLines * unbox<int>(frameState.pageSize.columns)
+                                                      / MinCellsPerBand),
+                                      std::max(1, pageLines) });
+    auto const bandStart = [&](int band) {
+        return LineOffset::cast_from(pageLines * band / bandCount);
+    };
+    auto const bandLineCount = [&](int band) {
+        return boxed_cast<LineCount>(bandStart(band + 1) - bandStart(band));
+    };
+
+    auto hyperlinkMutex = std::mutex {};
+    auto lineLocations = std::vector<RenderedLineLocation> {};
+    auto& outputLineLocations = frame ? frame->lineLocations : lineLocations;
+    auto hyperlinkSpans = std::vector<RenderedHyperlinkSpan> {};
+    auto& outputHyperlinkSpans = frame ? frame->hyperlinkSpans : hyperlinkSpans;
+
+    _renderBands.resize(static_cast<size_t>(bandCount - 1));
+    auto tasks = std::vector<std::future<RenderPassHints>>();
+    tasks.reserve(_renderBands.size());
+    for (auto k = 1; k < bandCount; ++k)
+    {
+        auto& band = _renderBands[static_cast<size_t>(k - 1)];
+        band.buffer.clear();
+        band.lineLocations.clear();
+        band.hyperlinkSpans.clear();
+        tasks.emplace_back(std::async(std::launch::async, [&, k]() {
+            auto builder = makeBuilder(band.buffer, band.lineLocations, band.hyperlinkSpans);
+            builder.shareHyperlinkLookups(hyperlinkMutex);
+            return screen.grid().renderLines(
+                builder, frameState.scrollOffset, bandStart(k), bandLineCount(k));
+        }));
+    }
+
+    // The first band is rendered on the calling thread, and directly into the output.
+    auto builder = makeBuilder(output, outputLineLocations, outputHyperlinkSpans);
+    if (bandCount > 1)
+        builder.shareHyperlinkLookups(hyperlinkMutex);
+    auto hints = screen.grid().renderLines(builder, frameState.scrollOffset, bandStart(0), bandLineCount(0));
+
+    for (auto k = 1; k < bandCount; ++k)
+    {
+        auto& band = _renderBands[static_cast<size_t>(k - 1)];
+        auto const bandHints = tasks[static_cast<size_t>(k - 1)].get();
+        hints.containsBlinkingCells = hints.containsBlinkingCells || bandHints.containsBlinkingCells;
+
+        if (frame)
+            for (auto const& location: band.lineLocations)
+                outputLineLocations.push_back(RenderedLineLocation {
+                    output.cells.size() + location.firstCell, output.lines.size() + location.firstLine });
+        outputHyperlinkSpans.insert(
+            outputHyperlinkSpans.end(), band.hyperlinkSpans.begin(), band.hyperlinkSpans.end());
+        output.append(band.buffer);
+
+        // The band rendering the cursor line may have moved the cursor past the input method's preedit text.
+        if (output.cursor && bandStart(k) <= output.cursor->position.line - baseLine
+            && output.cursor->position.line - baseLine < bandStart(k + 1))
+            output.cursor = band.buffer.cursor;
+    }
+    builder.finish();
+
+    if (frame)
+    {
+        frameState.lineLocations = std::move(frame->lineLocations);
+        frameState.hyperlinkSpans = std::move(frame->hyperlinkSpans);
+        frameState.staleLines.assign(unbox<size_t>(frameState.pageSize.lines), false);
+        markCursorLines(frameState.staleLines, LineOffset(0));
+        *frame = std::move(frameState);
+    }
+
+    return hints;
 }
 
 LineCount Terminal::fillRenderBufferStatusLine(RenderBuffer& output, bool includeSelection, LineOffset base)
 {
-    auto const mainDisplayReverseVideo = isModeEnabled(vtbackend::DECMode::ReverseVideo);
     switch (_state.statusDisplayType)
     {
         case StatusDisplayType::None:
@@ -510,31 +1249,96 @@ LineCount Terminal::fillRenderBufferStatusLine(RenderBuffer& output, bool includ
             return LineCount(0);
         case StatusDisplayType::Indicator:
             updateIndicatorStatusLine();
-            _indicatorStatusScreen.render(RenderBufferBuilder<StatusDisplayCell> { *this,
-                                                                                   output,
-                                                                                   base,
-                                                                                   !mainDisplayReverseVideo,
-                                                                                   HighlightSearchMatches::No,
-                                                                                   InputMethodData {},
-                                                                                   nullopt,
-                                                                                   includeSelection },
-                                          ScrollOffset(0));
+            fillRenderBufferStatusDisplay(_indicatorStatusScreen, output, includeSelection, base);
             return _indicatorStatusScreen.pageSize().lines;
         case StatusDisplayType::HostWritable:
-            _hostWritableStatusLineScreen.render(
-                RenderBufferBuilder<StatusDisplayCell> { *this,
-                                                         output,
-                                                         base,
-                                                         !mainDisplayReverseVideo,
-                                                         HighlightSearchMatches::No,
-                                                         InputMethodData {},
-                                                         nullopt,
-                                                         includeSelection },
-                ScrollOffset(0));
+            fillRenderBufferStatusDisplay(_hostWritableStatusLineScreen, output, includeSelection, base);
             return _hostWritableStatusLineScreen.pageSize().lines;
     }
     crispy::unreachable();
 }
+
+void Terminal::fillRenderBufferStatusDisplay(Screen<StatusDisplayCell>& screen,
+                                             RenderBuffer& output,
+                                             bool includeSelection,
+                                             LineOffset base)
+{
+    auto const reverseVideo = !isModeEnabled(vtbackend::DECMode::ReverseVideo);
+
+    auto lineState = RenderedStatusLine {};
+    lineState.reusable = !_selection;
+    lineState.type = _state.statusDisplayType;
+    lineState.pageSize = screen.pageSize();
+    lineState.baseLine = base;
+    lineState.reverseVideo = reverseVideo;
+    lineState.blink = blinkState();
+    lineState.rapidBlink = rapidBlinkState();
+    lineState.colors = colorPalette();
+
+    // Same as for the main display, except that the status line has no cursor to be rendered.
+    screen.grid().clearUnchangedDirtyLines();
+    auto const& dirtyLines = screen.grid().dirtyLines();
+    for (auto& rendered: _renderedStatusLines)
+    {
+        rendered.reusable = rendered.reusable && rendered.rendersLike(lineState);
+        if (!rendered.reusable)
+            continue;
+        for (size_t line = 0; line < dirtyLines.size() && line < rendered.staleLines.size(); ++line)
+            if (dirtyLines[line])
+                rendered.staleLines[line] = true;
+    }
+    screen.grid().clearDirtyLines();
+
+    RenderedStatusLine* rendered = nullptr;
+    for (size_t i = 0; i < _renderBuffer.buffers.size(); ++i)
+        if (&output == &_renderBuffer.buffers[i])
+            rendered = &_renderedStatusLines[i];
+
+    auto builder = RenderBufferBuilder<StatusDisplayCell> { *this,
+                                                            output,
+                                                            base,
+                                                            reverseVideo,
+                                                            HighlightSearchMatches::No,
+                                                            InputMethodData {},
+                                                            nullopt,
+                                                            includeSelection };
+    auto previousLocations = std::vector<RenderedLineLocation> {};
+    if (rendered)
+    {
+        if (rendered->reusable && lineState.reusable)
+        {
+            previousLocations = std::move(rendered->lineLocations);
+            builder.reuseLines(_previousFrame, previousLocations, rendered->staleLines);
+        }
+        builder.trackLineLocations(lineState.lineLocations);
+    }
+
+    screen.render(builder, ScrollOffset(0));
+
+    if (rendered)
+    {
+        lineState.staleLines.assign(unbox<size_t>(lineState.pageSize.lines), false);
+        *rendered = std::move(lineState);
+    }
+}
+
+bool Terminal::RenderedStatusLine::rendersLike(RenderedStatusLine const& other) const noexcept
+{
+    // clang-format off
+    return type == other.type
+        && pageSize == other.pageSize
+        && baseLine == other.baseLine
+        && reverseVideo == other.reverseVideo
+        && blink == other.blink
+        && rapidBlink == other.rapidBlink
+        && colors.useBrightColors == other.colors.useBrightColors
+        && colors.palette == other.colors.palette
+        && colors.defaultForeground == other.colors.defaultForeground
+        && colors.defaultForegroundBright == other.colors.defaultForegroundBright
+        && colors.defaultForegroundDimmed == other.colors.defaultForegroundDimmed
+        && colors.defaultBackground == other.colors.defaultBackground;
+    // clang-format on
+}
 // }}}
 
 void Terminal::updateIndicatorStatusLine()
@@ -546,48 +1350,53 @@ void Terminal::updateIndicatorStatusLine()
         verifyState();
     } };
 
-    auto const colors =
+    auto line = IndicatorStatusLine {};
+    line.colors =
         _state.focused ? colorPalette().indicatorStatusLine : colorPalette().indicatorStatusLineInactive;
+    line.columns = _indicatorStatusScreen.pageSize().columns;
 
-    // Prepare old status line's cursor position and some other flags.
-    _indicatorStatusScreen.moveCursorTo({}, {});
-    _indicatorStatusScreen.cursor().graphicsRendition.foregroundColor = colors.foreground;
-    _indicatorStatusScreen.cursor().graphicsRendition.backgroundColor = colors.background;
+    auto const add = [&](std::string text, optional<Color> foregroundColor = nullopt, bool bold = false) {
+        line.left.emplace_back(IndicatorStatusSegment { std::move(text), foregroundColor, bold });
+    };
 
-    // Run status-line update.
-    // We cannot use VT writing here, because we shall not interfere with the application's VT state.
-    // TODO: Future improvement would be to allow full VT sequence support for the Indicator-status-line,
-    // such that we can pass display-control partially over to some user/thirdparty configuration.
-    _indicatorStatusScreen.clearLine();
-    _indicatorStatusScreen.writeTextFromExternal(
-        fmt::format(" {} │ {}", _state.terminalId, modeString(inputHandler().mode())));
+    add(fmt::format(" {}", _state.terminalId));
+    add(fmt::format(" │ {}", modeString(inputHandler().mode())));
 
     if (!_state.searchMode.pattern.empty() || _state.inputHandler.isEditingSearch())
-        _indicatorStatusScreen.writeTextFromExternal(" SEARCH");
+        add(" SEARCH");
 
     if (!allowInput())
-    {
-        _indicatorStatusScreen.cursor().graphicsRendition.foregroundColor = BrightColor::Red;
-        _indicatorStatusScreen.cursor().graphicsRendition.flags.enable(CellFlag::Bold);
-        _indicatorStatusScreen.writeTextFromExternal(" (PROTECTED)");
-        _indicatorStatusScreen.cursor().graphicsRendition.foregroundColor = colors.foreground;
-        _indicatorStatusScreen.cursor().graphicsRendition.flags.disable(CellFlag::Bold);
-    }
+        add(" (PROTECTED)", Color(BrightColor::Red), true);
 
     if (_state.executionMode != ExecutionMode::Normal)
     {
-        _indicatorStatusScreen.writeTextFromExternal(" | ");
-        _indicatorStatusScreen.cursor().graphicsRendition.foregroundColor = BrightColor::Yellow;
-        _indicatorStatusScreen.cursor().graphicsRendition.flags |= CellFlag::Bold;
-        _indicatorStatusScreen.writeTextFromExternal("TRACING");
+        add(" | ");
+        add("TRACING", Color(BrightColor::Yellow), true);
         if (!_traceHandler.pendingSequences().empty())
-            _indicatorStatusScreen.writeTextFromExternal(
-                fmt::format(" (#{}): {}",
+            add(fmt::format(" (#{}): {}",
                             _traceHandler.pendingSequences().size(),
                             _traceHandler.pendingSequences().front()));
+    }
+
+    if (auto const stats = floodStats(); stats.flooded)
+    {
+        add(" | ");
+        add("FLOOD", Color(BrightColor::Yellow), true);
+        add(fmt::format(" {}", stats));
+    }
 
-        _indicatorStatusScreen.cursor().graphicsRendition.foregroundColor = colors.foreground;
-        _indicatorStatusScreen.cursor().graphicsRendition.flags.disable(CellFlag::Bold);
+    if (auto const pasteSize = _pasteSize.load(); pasteSize >= PasteProgressThreshold)
+    {
+        if (auto const pending = std::min(pendingInputBytes(), pasteSize); pending != 0)
+        {
+            add(" | ");
+            add("PASTE", Color(BrightColor::Yellow), true);
+            add(fmt::format(" {}% ({:.1f} MB left)",
+                            100 * (pasteSize - pending) / pasteSize,
+                            static_cast<double>(pending) / (1024.0 * 1024.0)));
+        }
+        else
+            _pasteSize = 0;
     }
 
     // TODO: Disabled for now, but generally I want that functionality, but configurable somehow.
@@ -600,50 +1409,107 @@ void Terminal::updateIndicatorStatusLine()
         auto const text =
             codepointText(isPrimaryScreen() ? _primaryScreen.useCellAt(cursorPosition).codepoints()
                                             : alternateScreen().useCellAt(cursorPosition).codepoints());
-        _indicatorStatusScreen.writeTextFromExternal(fmt::format(" | {}", text));
+        add(fmt::format(" | {}", text));
     }
 
     if (_state.inputHandler.isEditingSearch())
-        _indicatorStatusScreen.writeTextFromExternal(fmt::format(
-            " │ Search: {}█", unicode::convert_to<char>(u32string_view(_state.searchMode.pattern))));
-
-    auto rightString = ""s;
+    {
+        auto const& searchMode = _state.searchMode;
+        add(fmt::format(" │ {}: {}█",
+                        searchMode.isRegex() ? "Regex" : "Search",
+                        unicode::convert_to<char>(u32string_view(searchMode.pattern))));
+        if (!searchMode.regexError.empty())
+            add(fmt::format(" ({})", searchMode.regexError));
+    }
 
     if (isPrimaryScreen())
     {
         if (viewport().scrollOffset().value)
-            rightString += fmt::format(
+            line.right += fmt::format(
                 "{}/{} {:3}%",
                 viewport().scrollOffset(),
                 _primaryScreen.historyLineCount(),
                 int((double(viewport().scrollOffset()) / double(_primaryScreen.historyLineCount())) * 100));
         else
-            rightString += fmt::format("{}", _primaryScreen.historyLineCount());
+            line.right += fmt::format("{}", _primaryScreen.historyLineCount());
     }
 
-    if (!rightString.empty())
-        rightString += " │ ";
+    if (!line.right.empty())
+        line.right += " │ ";
+
+    // NB: Cannot use std::chrono::system_clock::now() here, because MSVC can't handle it.
+    line.right += fmt::format("{:%H:%M} ", fmt::localtime(std::time(nullptr)));
+
+    // Only the segments following the first one that has changed are written anew,
+    // such that an unchanged status line leaves the status screen (and thus its rendering) untouched.
+    auto& last = _indicatorStatusLine;
+    auto const sameLayout = last.valid && last.colors == line.colors && last.columns == line.columns;
+    if (sameLayout && last.left == line.left && last.right == line.right)
+        return;
+
+    auto first = size_t { 0 };
+    if (sameLayout)
+        while (first < last.left.size() && first < line.left.size() && last.left[first] == line.left[first])
+            ++first;
+    auto const resumeColumn = !sameLayout                 ? ColumnOffset(0)
+                              : first < last.left.size() ? last.leftColumns[first]
+                                                          : last.leftEnd;
+    line.leftColumns.assign(last.leftColumns.begin(),
+                            last.leftColumns.begin() + static_cast<ptrdiff_t>(first));
+
+    // Prepare old status line's cursor position and some other flags.
+    auto& rendition = _indicatorStatusScreen.cursor().graphicsRendition;
+    _indicatorStatusScreen.moveCursorTo({}, resumeColumn);
+    rendition.foregroundColor = line.colors.foreground;
+    rendition.backgroundColor = line.colors.background;
+    rendition.flags.disable(CellFlag::Bold);
+
+    // Run status-line update.
+    // We cannot use VT writing here, because we shall not interfere with the application's VT state.
+    // TODO: Future improvement would be to allow full VT sequence support for the Indicator-status-line,
+    // such that we can pass display-control partially over to some user/thirdparty configuration.
+    if (resumeColumn == ColumnOffset(0))
+        _indicatorStatusScreen.clearLine();
+    else
+        _indicatorStatusScreen.clearToEndOfLine();
+
+    for (auto i = first; i < line.left.size(); ++i)
+    {
+        auto const& segment = line.left[i];
+        line.leftColumns.push_back(_indicatorStatusScreen.cursor().position.column);
+        rendition.foregroundColor = segment.foregroundColor.value_or(Color(line.colors.foreground));
+        if (segment.bold)
+            rendition.flags.enable(CellFlag::Bold);
+        _indicatorStatusScreen.writeTextFromExternal(segment.text);
+        rendition.foregroundColor = line.colors.foreground;
+        rendition.flags.disable(CellFlag::Bold);
+    }
+    line.leftEnd = _indicatorStatusScreen.cursor().position.column;
 
-    // NB: Cannot use std::chrono::system_clock::now() here, because MSVC can't handle it.
-    rightString += fmt::format("{:%H:%M} ", fmt::localtime(std::time(nullptr)));
+    // The columns written at are only known for sure as long as the text has not reached the right margin.
+    line.valid = !_indicatorStatusScreen.cursor().wrapPending;
 
     auto const columnsAvailable = _indicatorStatusScreen.pageSize().columns.as<int>()
                                   - _indicatorStatusScreen.cursor().position.column.as<int>();
-    if (rightString.size() <= static_cast<size_t>(columnsAvailable))
+    if (line.right.size() <= static_cast<size_t>(columnsAvailable))
     {
-        _indicatorStatusScreen.cursor().position.column =
-            ColumnOffset::cast_from(_indicatorStatusScreen.pageSize().columns)
-            - ColumnOffset::cast_from(rightString.size()) - ColumnOffset(1);
+        auto const rightColumn = ColumnOffset::cast_from(_indicatorStatusScreen.pageSize().columns)
+                                 - ColumnOffset::cast_from(line.right.size()) - ColumnOffset(1);
+        line.valid = line.valid && line.leftEnd <= rightColumn;
+        _indicatorStatusScreen.cursor().position.column = rightColumn;
         _indicatorStatusScreen.updateCursorIterator();
 
-        _indicatorStatusScreen.writeTextFromExternal(rightString);
+        _indicatorStatusScreen.writeTextFromExternal(line.right);
     }
+
+    last = std::move(line);
 }
 
 bool Terminal::sendKeyEvent(Key key, Modifiers modifiers, KeyboardEventType eventType, Timestamp now)
 {
     _cursorBlinkState = 1;
     _lastCursorBlink = now;
+    _lastCursorActivity = now;
 
     if (allowInput() && eventType != KeyboardEventType::Release
         && _state.inputHandler.sendKeyPressEvent(key, modifiers))
@@ -656,7 +1522,12 @@ bool Terminal::sendKeyEvent(Key key, Modifiers modifiers, KeyboardEventType even
     bool const success = _state.inputGenerator.generate(key, modifiers, eventType);
     if (success)
     {
-        flushInput();
+        if (eventType != KeyboardEventType::Release)
+        {
+            _inputLatency.keySent(now);
+            unpredictableInputSent(key == Key::Enter || key == Key::Numpad_Enter);
+        }
+        inputGenerated();
         _viewport.scrollToBottom();
     }
     return success;
@@ -667,6 +1538,7 @@ bool Terminal::sendCharEvent(
 {
     _cursorBlinkState = 1;
     _lastCursorBlink = now;
+    _lastCursorActivity = now;
 
     // Early exit if KAM is enabled.
     if (isModeEnabled(AnsiMode::KeyboardAction))
@@ -678,7 +1550,12 @@ bool Terminal::sendCharEvent(
     auto const success = _state.inputGenerator.generate(ch, physicalKey, modifiers, eventType);
     if (success)
     {
-        flushInput();
+        if (eventType != KeyboardEventType::Release)
+        {
+            _inputLatency.keySent(now);
+            predictEcho(ch, modifiers, now);
+        }
+        inputGenerated();
         _viewport.scrollToBottom();
     }
     return success;
@@ -706,7 +1583,7 @@ bool Terminal::sendMousePressEvent(Modifiers modifiers,
 
     // TODO: Ctrl+(Left)Click's should still be catched by the terminal iff there's a hyperlink
     // under the current position
-    flushInput();
+    inputGenerated();
     return eventHandledByApp && !isModeEnabled(DECMode::MousePassiveTracking);
 }
 
@@ -867,7 +1744,7 @@ void Terminal::sendMouseMoveEvent(Modifiers modifiers,
     {
         if (_state.inputGenerator.generateMouseMove(
                 modifiers, relativePos, pixelPosition, uiHandledHint || !selectionAvailable()))
-            flushInput();
+            inputGenerated();
         if (!isModeEnabled(DECMode::MousePassiveTracking))
             return;
     }
@@ -922,7 +1799,7 @@ bool Terminal::sendMouseReleaseEvent(Modifiers modifiers,
         && _state.inputGenerator.generateMouseRelease(
             modifiers, button, _currentMousePosition, pixelPosition, uiHandledHint))
     {
-        flushInput();
+        inputGenerated();
 
         if (!isModeEnabled(DECMode::MousePassiveTracking))
             return true;
@@ -938,7 +1815,7 @@ bool Terminal::sendFocusInEvent()
 
     if (_state.inputGenerator.generateFocusInEvent())
     {
-        flushInput();
+        inputGenerated();
         return true;
     }
 
@@ -952,7 +1829,7 @@ bool Terminal::sendFocusOutEvent()
 
     if (_state.inputGenerator.generateFocusOutEvent())
     {
-        flushInput();
+        inputGenerated();
         return true;
     }
 
@@ -967,11 +1844,14 @@ void Terminal::sendPaste(string_view text)
     if (_state.inputHandler.isEditingSearch())
     {
         _state.searchMode.pattern += unicode::convert_to<char32_t>(text);
+        compileSearchPattern();
         screenUpdated();
         return;
     }
 
     _state.inputGenerator.generatePaste(text);
+    _pasteSize = pendingInputBytes();
+    unpredictableInputSent(false);
     flushInput();
 }
 
@@ -984,6 +1864,7 @@ void Terminal::sendRawInput(string_view text)
     {
         inputLog()("Sending raw input to search input: {}", crispy::escape(text));
         _state.searchMode.pattern += unicode::convert_to<char32_t>(text);
+        compileSearchPattern();
         screenUpdated();
         return;
     }
@@ -1004,10 +1885,68 @@ void Terminal::flushInput()
         return;
 
     // XXX Should be the only location that does write to the PTY's stdin to avoid race conditions.
+    _inputBatchStart.reset();
     auto const input = _state.inputGenerator.peek();
     auto const rv = _pty->write(input);
     if (rv > 0)
+    {
         _state.inputGenerator.consume(rv);
+        ++_inputWrites;
+        _inputWriteBytes += static_cast<uint64_t>(rv);
+        measureInputRates(chrono::steady_clock::now());
+    }
+}
+
+void Terminal::inputGenerated()
+{
+    if (!hasInput())
+        return;
+
+    ++_inputEvents;
+    if (!_inputBatching)
+    {
+        flushInput();
+        return;
+    }
+
+    auto const now = chrono::steady_clock::now();
+    if (!_inputBatchStart)
+    {
+        _inputBatchStart = now;
+        _eventListener.scheduleInputFlush();
+    }
+    else if (now - *_inputBatchStart >= MaxInputBatchDelay)
+        flushInput();
+}
+
+void Terminal::measureInputRates(chrono::steady_clock::time_point now)
+{
+    auto const elapsed = chrono::duration<double>(now - _inputRateStart).count();
+    if (elapsed < 1.0)
+        return;
+
+    // Rates are only measured when writing, over at least a second, such that pauses lower them.
+    auto const events = _inputEvents.load();
+    auto const writes = _inputWrites.load();
+    _inputEventsPerSecond = static_cast<double>(events - _inputEventsAtRateStart) / elapsed;
+    _inputWritesPerSecond = static_cast<double>(writes - _inputWritesAtRateStart) / elapsed;
+    _inputRateStart = now;
+    _inputEventsAtRateStart = events;
+    _inputWritesAtRateStart = writes;
+}
+
+Terminal::InputWriteStats Terminal::inputWriteStats() const noexcept
+{
+    return { .events = _inputEvents.load(),
+             .writes = _inputWrites.load(),
+             .bytes = _inputWriteBytes.load(),
+             .eventsPerSecond = _inputEventsPerSecond.load(),
+             .writesPerSecond = _inputWritesPerSecond.load() };
+}
+
+size_t Terminal::pendingInputBytes() const noexcept
+{
+    return _state.inputGenerator.peek().size() + _pty->pendingWriteBytes();
 }
 
 void Terminal::writeToScreen(string_view vtStream)
@@ -1016,26 +1955,42 @@ void Terminal::writeToScreen(string_view vtStream)
         auto const l = std::lock_guard { *this };
         while (!vtStream.empty())
         {
-            if (_currentPtyBuffer->bytesAvailable() < 64
-                && _currentPtyBuffer->bytesAvailable() < vtStream.size())
-                _currentPtyBuffer = _ptyBufferPool.allocateBufferObject();
+            preparePtyBufferForWrite(vtStream.size());
             auto const chunk =
                 vtStream.substr(0, std::min(vtStream.size(), _currentPtyBuffer->bytesAvailable()));
             vtStream.remove_prefix(chunk.size());
             _state.parser.parseFragment(_currentPtyBuffer->writeAtEnd(chunk));
         }
+        reconcilePredictedEcho();
     }
 
-    if (!_state.modes.enabled(DECMode::BatchedRendering))
-    {
+    if (_renderBufferUpdateEnabled)
         screenUpdated();
+    else
+        ++_deferredScreenUpdates;
+}
+
+void Terminal::preparePtyBufferForWrite(size_t size)
+{
+    if (_settings.ptyReaderThread)
+    {
+        // The reader thread owns the hot end of the buffers it reads into. Use a buffer of our own.
+        if (!_localPtyBuffer)
+            _localPtyBuffer = _ptyBufferPool.allocateBufferObject();
+        _currentPtyBuffer = _localPtyBuffer;
+    }
+
+    if (_currentPtyBuffer->bytesAvailable() < 64 && _currentPtyBuffer->bytesAvailable() < size)
+    {
+        _currentPtyBuffer = _ptyBufferPool.allocateBufferObject();
+        if (_settings.ptyReaderThread)
+            _localPtyBuffer = _currentPtyBuffer;
     }
 }
 
 string_view Terminal::lockedWriteToPtyBuffer(string_view data)
 {
-    if (_currentPtyBuffer->bytesAvailable() < 64 && _currentPtyBuffer->bytesAvailable() < data.size())
-        _currentPtyBuffer = _ptyBufferPool.allocateBufferObject();
+    preparePtyBufferForWrite(data.size());
 
     auto const chunk = data.substr(0, std::min(data.size(), _currentPtyBuffer->bytesAvailable()));
     auto const _ = std::scoped_lock { *_currentPtyBuffer };
@@ -1043,6 +1998,21 @@ string_view Terminal::lockedWriteToPtyBuffer(string_view data)
     return string_view(ref.data(), ref.size());
 }
 
+std::optional<crispy::BufferFragment<char>> Terminal::storeTranslatedText(string_view head, string_view tail)
+{
+    auto const size = head.size() + tail.size();
+    if (!_translatedTextBuffer || _translatedTextBuffer->bytesAvailable() < size)
+    {
+        _translatedTextBuffer = _ptyBufferPool.allocateBufferObject(size);
+        if (_translatedTextBuffer->bytesAvailable() < size)
+            return std::nullopt;
+    }
+
+    auto const text = _translatedTextBuffer->writeAtEnd(head);
+    (void) _translatedTextBuffer->writeAtEnd(tail);
+    return crispy::BufferFragment<char>(_translatedTextBuffer, gsl::span<char const>(text.data(), size));
+}
+
 void Terminal::writeToScreenInternal(std::string_view vtStream)
 {
     while (!vtStream.empty())
@@ -1062,10 +2032,103 @@ void Terminal::updateCursorVisibilityState() const noexcept
     if (passed < _settings.cursorBlinkInterval)
         return;
 
+    if (cursorBlinkExpired())
+    {
+        // Stays visible until the next keyboard input.
+        _cursorBlinkState = 1;
+        return;
+    }
+
     _lastCursorBlink = _currentTime;
     _cursorBlinkState = (_cursorBlinkState + 1) % 2;
 }
 
+void Terminal::predictEcho(char32_t ch, Modifiers modifiers, Timestamp now)
+{
+    if (!_settings.predictiveEcho)
+        return;
+
+    auto const _ = std::lock_guard { *this };
+
+    // Full-screen applications draw the characters typed wherever they like, if at all.
+    if (!isPrimaryScreen())
+    {
+        _predictiveEcho.rollback();
+        predictedEchoChanged();
+        return;
+    }
+
+    // Only printable US-ASCII characters are predicted, as they occupy exactly one column.
+    auto const& cursor = _primaryScreen.cursor();
+    auto const printable = U' ' <= ch && ch < 0x7F && modifiers.without(Modifier::Shift).none();
+    auto const position =
+        printable && !cursor.wrapPending ? _predictiveEcho.nextPosition(cursor.position) : nullopt;
+
+    // Printing into the last column does not move the cursor past it, which is what confirms a prediction.
+    if (!position || position->column + 1 >= boxed_cast<ColumnOffset>(pageSize().columns))
+    {
+        _predictiveEcho.inputSent(false);
+        return;
+    }
+
+    _predictiveEcho.predict(ch, *position, now);
+    predictedEchoChanged();
+    screenUpdated();
+}
+
+void Terminal::unpredictableInputSent(bool lineEntered)
+{
+    if (!_settings.predictiveEcho)
+        return;
+
+    auto const _ = std::lock_guard { *this };
+    _predictiveEcho.inputSent(lineEntered);
+}
+
+void Terminal::reconcilePredictedEcho()
+{
+    if (!_settings.predictiveEcho || _predictiveEcho.idle())
+        return;
+
+    if (!isPrimaryScreen())
+        _predictiveEcho.rollback();
+    else
+    {
+        auto const codepointAt = [&](CellLocation position) -> char32_t {
+            if (!(position < _primaryScreen.pageSize()))
+                return 0;
+            return _primaryScreen.leadingCodepointAt(position).first;
+        };
+        (void) _predictiveEcho.reconcile(codepointAt, _primaryScreen.cursor().position);
+    }
+    predictedEchoChanged();
+}
+
+void Terminal::predictedEchoChanged() noexcept
+{
+    _predictedEchoExpiry = _predictiveEcho.expiry().value_or(Timestamp::max());
+}
+
+std::optional<Terminal::Timestamp> Terminal::synchronizedOutputDeadline() const noexcept
+{
+    if (_renderBufferUpdateEnabled || _settings.synchronizedOutputTimeout.count() == 0)
+        return std::nullopt;
+    return _synchronizedOutputStart.load() + _settings.synchronizedOutputTimeout;
+}
+
+bool Terminal::endSynchronizedOutputBatch() noexcept
+{
+    auto expected = false;
+    if (!_renderBufferUpdateEnabled.compare_exchange_strong(expected, true))
+        return false;
+
+    auto const updates = _deferredScreenUpdates.exchange(0);
+    ++_synchronizedOutputBatches;
+    if (updates > 1)
+        _synchronizedOutputFramesSaved += updates - 1;
+    return true;
+}
+
 void Terminal::updateHoveringHyperlinkState()
 {
     auto const newState =
@@ -1081,17 +2144,28 @@ void Terminal::updateHoveringHyperlinkState()
 
 optional<chrono::milliseconds> Terminal::nextRender() const
 {
+    if (_detached)
+        return nullopt;
+
     auto nextBlink = chrono::milliseconds::max();
-    if ((isModeEnabled(DECMode::VisibleCursor) && _settings.cursorDisplay == CursorDisplay::Blink)
-        || isBlinkOnScreen())
+
+    // A cursor that has stopped blinking is only to be woken up for if currently hidden, to show it again.
+    auto const cursorBlinking = isModeEnabled(DECMode::VisibleCursor)
+                                && _settings.cursorDisplay == CursorDisplay::Blink
+                                && (!cursorBlinkExpired() || !_cursorBlinkState);
+    if (cursorBlinking)
     {
         auto const passedCursor =
             chrono::duration_cast<chrono::milliseconds>(_currentTime - _lastCursorBlink);
+        if (passedCursor <= _settings.cursorBlinkInterval)
+            nextBlink = std::min(nextBlink, _settings.cursorBlinkInterval - passedCursor);
+    }
+
+    if (isBlinkOnScreen())
+    {
         auto const passedSlowBlink = chrono::duration_cast<chrono::milliseconds>(_currentTime - _lastBlink);
         auto const passedRapidBlink =
             chrono::duration_cast<chrono::milliseconds>(_currentTime - _lastRapidBlink);
-        if (passedCursor <= _settings.cursorBlinkInterval)
-            nextBlink = std::min(nextBlink, _settings.cursorBlinkInterval - passedCursor);
         if (passedSlowBlink <= _slowBlinker.interval)
             nextBlink = std::min(nextBlink, _slowBlinker.interval - passedSlowBlink);
         if (passedRapidBlink <= _rapidBlinker.interval)
@@ -1108,6 +2182,23 @@ optional<chrono::milliseconds> Terminal::nextRender() const
         nextBlink = std::min(nextBlink, millisUntilNextMinute);
     }
 
+    // Predictions of the echo not confirmed in time are to disappear.
+    if (auto const expiry = _predictedEchoExpiry.load(); expiry != Timestamp::max())
+        nextBlink = std::min(nextBlink,
+                             std::max(chrono::milliseconds(0),
+                                      chrono::ceil<chrono::milliseconds>(expiry - _currentTime)));
+
+    // Synchronized output not ended in time is to be rendered anyway.
+    if (auto const deadline = synchronizedOutputDeadline())
+        nextBlink = std::min(
+            nextBlink,
+            std::max(chrono::milliseconds(0), chrono::ceil<chrono::milliseconds>(*deadline - _currentTime)));
+
+    // Pending screen updates are to be rendered just in time for the next vertical blank.
+    if (_screenDirty || _renderBuffer.state != RenderBufferState::WaitingForRefresh)
+        if (auto const delay = nextRefreshDelay())
+            nextBlink = std::min(nextBlink, *delay);
+
     if (nextBlink == chrono::milliseconds::max())
         return nullopt;
 
@@ -1121,6 +2212,13 @@ void Terminal::tick(chrono::steady_clock::time_point now) noexcept
     // TODO: update render buffer if  (changes != 0)
 
     _currentTime = now;
+    if (now - _lastPtyBufferTrim >= PtyBufferTrimInterval)
+    {
+        _lastPtyBufferTrim = now;
+        _ptyBufferPool.trimUnusedBuffers();
+    }
+    if (_detached)
+        return;
     updateCursorVisibilityState();
     if (isBlinkOnScreen())
     {
@@ -1129,6 +2227,16 @@ void Terminal::tick(chrono::steady_clock::time_point now) noexcept
     }
 }
 
+void Terminal::setDetached(bool detached)
+{
+    if (_detached.exchange(detached) == detached)
+        return;
+
+    terminalLog()("{} display.", detached ? "Detaching from" : "Attaching to");
+    if (!detached)
+        breakLoopAndRefreshRenderBuffer();
+}
+
 void Terminal::resizeScreen(PageSize totalPageSize, optional<ImageSize> pixels)
 {
     // NOTE: This will only resize the currently active buffer.
@@ -1151,7 +2259,13 @@ void Terminal::resizeScreen(PageSize totalPageSize, optional<ImageSize> pixels)
 
     applyPageSizeToCurrentBuffer();
 
+    // The lines and columns predicted at may have moved.
+    _predictiveEcho.rollback();
+    predictedEchoChanged();
+
     _pty->resizeScreen(mainDisplayPageSize, pixels);
+    if (_recorder)
+        _recorder->resize(mainDisplayPageSize, std::chrono::steady_clock::now());
 
     // Adjust Normal-mode's cursor in order to avoid drift when growing/shrinking in main page line count.
     if (mainDisplayPageSize.lines > oldMainDisplayPageSize.lines)
@@ -1210,98 +2324,185 @@ void Terminal::setWordDelimiters(string const& wordDelimiters)
 
 namespace
 {
-    template <typename Cell>
-    struct SelectionRenderer
+    // A selected line, identified by its grid line id such that it can still be found
+    // after having been scrolled while the terminal was not locked.
+    struct SelectedLine
     {
-        gsl::not_null<Terminal const*> term;
-        ColumnOffset rightPage {};
-        ColumnOffset lastColumn {};
-        string text {};
-        string currentLine {};
+        uint64_t id;
+        ColumnOffset fromColumn;
+        ColumnOffset toColumn;
+    };
 
-        SelectionRenderer(Terminal const& term, ColumnOffset rightPage): term(&term), rightPage(rightPage) {}
+    // Number of selected lines whose text is extracted at once while holding the terminal lock.
+    constexpr auto SelectionExtractionBatchSize = size_t { 1024 };
 
-        void operator()(CellLocation pos, Cell const& cell)
+    template <typename Cell>
+    void streamSelectedLines(Terminal const& term,
+                             Screen<Cell> const& screen,
+                             bool isPrimaryScreen,
+                             std::vector<SelectedLine> const& lines,
+                             uint64_t lineIdGeneration,
+                             bool fullLines,
+                             std::function<void(std::string_view)> const& sink)
+    {
+        auto const rightPage = boxed_cast<ColumnOffset>(screen.pageSize().columns) - 1;
+        auto text = string {};
+        auto currentLine = string {};
+
+        for (size_t first = 0; first < lines.size(); first += SelectionExtractionBatchSize)
         {
-            auto const isNewLine = pos.column < lastColumn || (pos.column == lastColumn && !text.empty());
-            bool const touchesRightPage = term->isSelected({ pos.line, rightPage });
-            if (isNewLine && (!term->isLineWrapped(pos.line) || !touchesRightPage))
             {
-                // TODO: handle logical line in word-selection (don't include LF in wrapped lines)
-                trimSpaceRight(currentLine);
-                text += currentLine;
-                text += '\n';
-                currentLine.clear();
+                auto const _ = std::scoped_lock { term };
+                if (term.isPrimaryScreen() != isPrimaryScreen
+                    || screen.grid().lineIdGeneration() != lineIdGeneration)
+                {
+                    errorLog()("Selection text extraction aborted, as the selected lines have been moved.");
+                    return;
+                }
+
+                auto const last = std::min(first + SelectionExtractionBatchSize, lines.size());
+                for (auto i = first; i < last; ++i)
+                {
+                    auto const& selected = lines[i];
+                    auto const line = screen.grid().lineOffsetOf(selected.id);
+                    if (line < -boxed_cast<LineOffset>(screen.historyLineCount()))
+                    {
+                        errorLog()("Selection text extraction aborted, as the selected lines are gone.");
+                        return;
+                    }
+
+                    // Wrapped lines are joined with the line they continue, if selected up to the right page.
+                    auto const continuesLine =
+                        isPrimaryScreen && screen.isLineWrapped(line) && selected.toColumn >= rightPage;
+                    if (i != 0 && !continuesLine)
+                    {
+                        // TODO: handle logical line in word-selection (don't include LF in wrapped lines)
+                        trimSpaceRight(currentLine);
+                        text += currentLine;
+                        text += '\n';
+                        currentLine.clear();
+                    }
+
+                    for (auto column = selected.fromColumn; column <= selected.toColumn; ++column)
+                    {
+                        auto const& cell = screen.at(CellLocation { line, column });
+                        if (cell.empty())
+                            currentLine += ' ';
+                        else
+                            currentLine += cell.toUtf8();
+                    }
+                }
             }
-            if (cell.empty())
-                currentLine += ' ';
-            else
-                currentLine += cell.toUtf8();
-            lastColumn = pos.column;
+            if (!text.empty())
+                sink(text);
+            text.clear();
         }
 
-        std::string finish()
-        {
-            trimSpaceRight(currentLine);
-            text += currentLine;
-            if (dynamic_cast<FullLineSelection const*>(term->selector()))
-                text += '\n';
-            return std::move(text);
-        }
-    };
+        trimSpaceRight(currentLine);
+        if (fullLines)
+            currentLine += '\n';
+        if (!currentLine.empty())
+            sink(currentLine);
+    }
 } // namespace
 
-string Terminal::extractSelectionText() const
+void Terminal::extractSelectionText(std::function<void(std::string_view)> const& sink) const
 {
-    auto const _ = std::scoped_lock { *this };
+    auto lines = std::vector<SelectedLine> {};
+    auto lineIdGeneration = uint64_t { 0 };
+    auto fullLines = false;
+    auto primaryScreen = true;
 
-    if (!_selection || _selection->state() == Selection::State::Waiting)
-        return "";
+    auto const collect = [&](auto const& screen) {
+        for (Selection::Range const& range: _selection->ranges())
+            lines.emplace_back(
+                SelectedLine { screen.grid().lineId(range.line), range.fromColumn, range.toColumn });
+        lineIdGeneration = screen.grid().lineIdGeneration();
+    };
 
-    if (isPrimaryScreen())
     {
-        auto se = SelectionRenderer<PrimaryScreenCell> { *this, pageSize().columns.as<ColumnOffset>() - 1 };
-        vtbackend::renderSelection(*_selection, [&](CellLocation pos) { se(pos, _primaryScreen.at(pos)); });
-        return se.finish();
+        auto const _ = std::scoped_lock { *this };
+        if (!_selection || _selection->state() == Selection::State::Waiting)
+            return;
+        fullLines = dynamic_cast<FullLineSelection const*>(_selection.get()) != nullptr;
+        primaryScreen = isPrimaryScreen();
+        if (primaryScreen)
+            collect(_primaryScreen);
+        else
+            collect(_alternateScreen);
     }
+
+    // The lock is only held while extracting a batch of lines, such that the terminal is not blocked
+    // for the duration of extracting a huge selection, and the sink is called without holding it.
+    if (primaryScreen)
+        streamSelectedLines(*this, _primaryScreen, true, lines, lineIdGeneration, fullLines, sink);
     else
-    {
-        auto se = SelectionRenderer<AlternateScreenCell> { *this, pageSize().columns.as<ColumnOffset>() - 1 };
-        vtbackend::renderSelection(*_selection, [&](CellLocation pos) { se(pos, _alternateScreen.at(pos)); });
-        return se.finish();
-    }
+        streamSelectedLines(*this, _alternateScreen, false, lines, lineIdGeneration, fullLines, sink);
+}
+
+string Terminal::extractSelectionText() const
+{
+    auto text = string {};
+    extractSelectionText([&](std::string_view chunk) { text += chunk; });
+    return text;
 }
 
 string Terminal::extractLastMarkRange() const
 {
-    auto const _ = std::lock_guard { *this };
+    auto const lines = [this]() -> std::vector<LineTextSnapshot> {
+        auto const _ = std::lock_guard { *this };
+
+        // -1 because we always want to start extracting one line above the cursor by default.
+        auto const bottomLine =
+            _currentScreen->cursor().position.line + LineOffset(-1) + _settings.copyLastMarkRangeOffset;
+
+        // Shells with shell integration (OSC 133) tell where the output of the last command is.
+        if (auto const* block = _primaryScreen.grid().lastCommandBlock())
+            return _primaryScreen.grid().commandOutputSnapshot(*block, bottomLine);
 
-    // -1 because we always want to start extracting one line above the cursor by default.
-    auto const bottomLine =
-        _currentScreen->cursor().position.line + LineOffset(-1) + _settings.copyLastMarkRangeOffset;
+        auto const marker1 = optional { bottomLine };
 
-    auto const marker1 = optional { bottomLine };
+        auto const marker0 = _primaryScreen.findMarkerUpwards(marker1.value());
+        if (!marker0.has_value())
+            return {};
 
-    auto const marker0 = _primaryScreen.findMarkerUpwards(marker1.value());
-    if (!marker0.has_value())
-        return {};
+        // +1 each for offset change from 0 to 1 and because we only want to start at the line *after* the
+        // mark.
+        auto const firstLine = *marker0 + 1;
+        auto const lastLine = *marker1;
 
-    // +1 each for offset change from 0 to 1 and because we only want to start at the line *after* the mark.
-    auto const firstLine = *marker0 + 1;
-    auto const lastLine = *marker1;
+        return _primaryScreen.grid().textSnapshot(firstLine, lastLine);
+    }();
 
     string text;
 
-    for (auto lineNum = firstLine; lineNum <= lastLine; ++lineNum)
+    for (auto const& line: lines)
     {
-        auto const lineText = _primaryScreen.grid().lineAt(lineNum).toUtf8Trimmed();
-        text += _primaryScreen.grid().lineAt(lineNum).toUtf8Trimmed();
+        text += line.trimmedText();
         text += '\n';
     }
 
     return text;
 }
 
+std::optional<LineOffset> Terminal::toggleCommandOutputFold(LineOffset line)
+{
+    if (!isPrimaryScreen())
+        return std::nullopt;
+
+    auto const promptLine = _primaryScreen.grid().toggleCommandOutputFold(line);
+    if (!promptLine)
+        return std::nullopt;
+
+    // Folding shrinks the history, possibly below the viewport's scroll offset.
+    auto const historyLineCount = boxed_cast<ScrollOffset>(_primaryScreen.historyLineCount());
+    if (_viewport.scrollOffset() > historyLineCount)
+        _viewport.scrollTo(historyLineCount);
+
+    screenUpdated();
+    return promptLine;
+}
+
 // {{{ ScreenEvents overrides
 void Terminal::requestCaptureBuffer(LineCount lines, bool logical)
 {
@@ -1327,6 +2528,7 @@ void Terminal::bufferChanged(ScreenType type)
 
 void Terminal::scrollbackBufferCleared()
 {
+    _discardedLinesPending = true;
     clearSelection();
     _viewport.scrollToBottom();
     breakLoopAndRefreshRenderBuffer();
@@ -1339,7 +2541,8 @@ void Terminal::screenUpdated()
 
     if (_renderBuffer.state == RenderBufferState::TrySwapBuffers)
     {
-        _renderBuffer.swapBuffers(_renderBuffer.lastUpdate);
+        if (_renderBuffer.swapBuffers(_renderBuffer.lastUpdate))
+            _inputLatency.frameSwapped(_lastFrameID, std::chrono::steady_clock::now());
         return;
     }
 
@@ -1352,9 +2555,16 @@ void Terminal::renderBufferUpdated()
     if (!_renderBufferUpdateEnabled)
         return;
 
+    if (_detached)
+    {
+        _screenDirty = true;
+        return;
+    }
+
     if (_renderBuffer.state == RenderBufferState::TrySwapBuffers)
     {
-        _renderBuffer.swapBuffers(_renderBuffer.lastUpdate);
+        if (_renderBuffer.swapBuffers(_renderBuffer.lastUpdate))
+            _inputLatency.frameSwapped(_lastFrameID, std::chrono::steady_clock::now());
         return;
     }
 
@@ -1804,6 +3014,9 @@ void Terminal::hardReset()
     _alternateScreen.hardReset();
     _hostWritableStatusLineScreen.hardReset();
     _indicatorStatusScreen.hardReset();
+    _discardedLinesPending = true;
+    wakeupPtyChunkConsumer();
+    _indicatorStatusLine = {};
 
     _state.imagePool.clear();
     _state.tabs.clear();
@@ -1873,6 +3086,7 @@ void Terminal::setScreen(ScreenType type)
     }
 
     _state.screenType = type;
+    updateSequenceHandler();
 
     // Ensure correct screen buffer size for the buffer we've just switched to.
     applyPageSizeToCurrentBuffer();
@@ -1951,8 +3165,20 @@ void Terminal::markRegionDirty(Rect area) noexcept
 
 void Terminal::synchronizedOutput(bool enabled)
 {
-    _renderBufferUpdateEnabled = !enabled;
     if (enabled)
+    {
+        _synchronizedOutputStart = chrono::steady_clock::now();
+        _deferredScreenUpdates = 0;
+        _renderBufferUpdateEnabled = false;
+
+        // Gives the display the chance to schedule the render the timeout may force, see nextRender().
+        if (_settings.synchronizedOutputTimeout.count() != 0)
+            _eventListener.screenUpdated();
+        return;
+    }
+
+    // The accumulated screen updates are rendered in a single frame from here on.
+    if (!endSynchronizedOutputBatch())
         return;
 
     tick(chrono::steady_clock::now());
@@ -1999,6 +3225,46 @@ LineCount Terminal::maxHistoryLineCount() const noexcept
     return _primaryScreen.grid().maxHistoryLineCount();
 }
 
+void Terminal::setHistorySpill(bool enabled, size_t memoryBudget)
+{
+    _settings.historySpillToDisk = enabled;
+    _settings.historyMemoryBudget = memoryBudget;
+    _primaryScreen.grid().setHistorySpill(enabled, memoryBudget);
+}
+
+void Terminal::setHistorySearchIndex(bool enabled)
+{
+    _settings.historySearchIndex = enabled;
+    _primaryScreen.grid().setSearchIndexEnabled(enabled);
+}
+
+TrimmedMemory Terminal::trimMemory()
+{
+    // Memory held by the lines, along with the pooled storage not used by any line right now.
+    auto const heldBytesOf = [](GridMemoryStats const& stats) {
+        auto const usedCellPoolBytes = std::min(stats.cellPoolUsedBytes, stats.cellPoolBytes);
+        return stats.bytes() + (stats.cellPoolBytes - usedCellPoolBytes) + stats.scrollbackText.unusedBytes;
+    };
+    auto const heldBytes = [&]() {
+        return heldBytesOf(_primaryScreen.grid().memoryStats())
+               + heldBytesOf(_alternateScreen.grid().memoryStats()) + _ptyBufferPool.stats().unusedBytes;
+    };
+    auto const reclaimedLines = [&]() {
+        return _primaryScreen.grid().reclaimedLineCount() + _alternateScreen.grid().reclaimedLineCount();
+    };
+
+    auto const bytesBefore = heldBytes();
+    auto const linesBefore = reclaimedLines();
+
+    _primaryScreen.grid().trimMemory();
+    _alternateScreen.grid().trimMemory();
+    _ptyBufferPool.releaseUnusedBuffers();
+
+    auto const bytesAfter = heldBytes();
+    return TrimmedMemory { .compactedLines = reclaimedLines() - linesBefore,
+                           .releasedBytes = bytesBefore > bytesAfter ? bytesBefore - bytesAfter : 0 };
+}
+
 void Terminal::setTerminalId(VTType id) noexcept
 {
     _state.terminalId = id;
@@ -2051,6 +3317,8 @@ void Terminal::setActiveStatusDisplay(ActiveStatusDisplay activeDisplay)
             break;
     }
     // clang-format on
+
+    updateSequenceHandler();
 }
 
 void Terminal::pushStatusDisplay(StatusDisplayType type)
@@ -2083,10 +3351,27 @@ bool Terminal::setNewSearchTerm(std::u32string text, bool initiatedByDoubleClick
     if (_state.searchMode.pattern == text)
         return false;
 
+    cancelSearch();
     _state.searchMode.pattern = std::move(text);
+    compileSearchPattern();
     return true;
 }
 
+void Terminal::compileSearchPattern()
+{
+    auto& searchMode = _state.searchMode;
+    searchMode.regex.reset();
+    searchMode.regexError.clear();
+    if (!_settings.searchRegex || searchMode.pattern.empty())
+        return;
+
+    auto regex = crispy::regex_dfa::compile(searchMode.pattern);
+    if (regex)
+        searchMode.regex = std::make_shared<crispy::regex_dfa const>(std::move(regex).value());
+    else
+        searchMode.regexError = std::move(regex).error();
+}
+
 optional<CellLocation> Terminal::searchReverse(u32string text, CellLocation searchPosition)
 {
     if (!setNewSearchTerm(std::move(text), false))
@@ -2107,8 +3392,12 @@ optional<CellLocation> Terminal::search(std::u32string text,
 
 optional<CellLocation> Terminal::search(CellLocation searchPosition)
 {
-    auto const searchText = u32string_view(_state.searchMode.pattern);
-    auto const matchLocation = currentScreen().search(searchText, searchPosition);
+    auto const& searchMode = _state.searchMode;
+    auto matchLocation = optional<CellLocation> {};
+    if (searchMode.regex)
+        matchLocation = currentScreen().search(*searchMode.regex, searchPosition);
+    else if (!searchMode.isRegex())
+        matchLocation = currentScreen().search(u32string_view(searchMode.pattern), searchPosition);
 
     if (matchLocation)
         viewport().makeVisibleWithinSafeArea(matchLocation.value().line);
@@ -2119,8 +3408,194 @@ optional<CellLocation> Terminal::search(CellLocation searchPosition)
 
 void Terminal::clearSearch()
 {
+    cancelSearch();
     _state.searchMode.pattern.clear();
     _state.searchMode.initiatedByDoubleClick = false;
+    compileSearchPattern();
+}
+
+bool Terminal::startSearch(std::u32string text,
+                           CellLocation searchPosition,
+                           SearchDirection direction,
+                           SearchMatchHandler onMatch)
+{
+    if (!setNewSearchTerm(std::move(text), false))
+        return false;
+
+    // Nothing can be found for neither an empty search term nor an invalid regular expression.
+    if (_state.searchMode.pattern.empty() || !_state.searchMode.regexError.empty())
+        return true;
+
+    {
+        auto const _ = std::lock_guard { _searchMutex };
+        _pendingSearch = SearchJob {
+            .id = _searchId,
+            .pattern = _state.searchMode.pattern,
+            .regex = _state.searchMode.regex,
+            .direction = direction,
+            .onMatch = std::move(onMatch),
+            .primaryScreen = isPrimaryScreen(),
+            .startPosition = searchPosition,
+        };
+        if (!_searchThread.joinable())
+            _searchThread = std::thread(&Terminal::searchLoop, this);
+    }
+    _searchCondition.notify_all();
+    return true;
+}
+
+void Terminal::cancelSearch()
+{
+    ++_searchId;
+    auto const _ = std::lock_guard { _searchMutex };
+    _pendingSearch.reset();
+}
+
+void Terminal::stopSearchThread()
+{
+    if (!_searchThread.joinable())
+        return;
+
+    ++_searchId;
+    {
+        auto const _ = std::lock_guard { _searchMutex };
+        _searchQuit = true;
+    }
+    _searchCondition.notify_all();
+    _searchThread.join();
+}
+
+void Terminal::searchLoop()
+{
+    // Searching the history may take long, but must not delay processing input or rendering.
+    crispy::set_current_thread_qos(crispy::thread_qos::Utility);
+
+    auto job = std::optional<SearchJob> {};
+    while (true)
+    {
+        {
+            auto lock = std::unique_lock { _searchMutex };
+            _searchCondition.wait(lock, [&]() { return _searchQuit || _pendingSearch || job; });
+            if (_searchQuit)
+                return;
+            if (_pendingSearch)
+            {
+                job = std::move(_pendingSearch);
+                _pendingSearch.reset();
+            }
+        }
+
+        // The terminal is unlocked between steps, letting the terminal thread process PTY output.
+        auto const _ = std::lock_guard { *this };
+        if (job->id != _searchId)
+            job.reset(); // cancelled
+        else if (!(isPrimaryScreen() ? searchStep(_primaryScreen, *job) : searchStep(_alternateScreen, *job)))
+            job.reset();
+    }
+}
+
+template <typename Cell>
+bool Terminal::searchStep(Screen<Cell>& screen, SearchJob& job)
+{
+    if (job.primaryScreen != isPrimaryScreen())
+        return false;
+
+    auto& grid = screen.grid();
+    auto const forward = job.direction == SearchDirection::Forward;
+
+    auto position = CellLocation {};
+    if (job.startPosition)
+    {
+        position = *job.startPosition;
+        job.startPosition.reset();
+
+        // Reflowing moves lines around, so get it done before determining the lines to search.
+        if (forward)
+            grid.reflowHistoryFrom(position.line);
+        else
+            grid.reflowHistory();
+    }
+    else if (job.lineIdGeneration != grid.lineIdGeneration())
+        return false; // Lines have been moved around since the last step.
+    else
+        position = CellLocation { grid.lineOffsetOf(job.line), job.column };
+
+    auto const historyTop = -boxed_cast<LineOffset>(grid.historyLineCount());
+    auto const pageBottom = boxed_cast<LineOffset>(grid.pageSize().lines) - 1;
+    auto const lastColumn = boxed_cast<ColumnOffset>(grid.pageSize().columns) - 1;
+    // Continuing right behind (or in front of) the last match may find it again, which is skipped then.
+    auto lastMatch = std::optional<CellLocation> {};
+    if (job.lastMatch)
+        lastMatch = CellLocation { grid.lineOffsetOf(job.lastMatch->first), job.lastMatch->second };
+
+    auto next = CellLocation {};
+    auto match = std::optional<CellLocation> {};
+    if (forward)
+    {
+        // The lines to continue with may have been dropped from the history in the meantime.
+        if (position.line < historyTop)
+            position = CellLocation { historyTop, ColumnOffset(0) };
+
+        // Each step ends with a logical line, such that the next step starts with a new one.
+        auto bottom = std::min(position.line + boxed_cast<LineOffset>(SearchLinesPerStep) - 1, pageBottom);
+        while (bottom < pageBottom && grid.isLineWrapped(bottom + 1))
+            ++bottom;
+
+        match = job.regex ? screen.search(*job.regex, position, bottom)
+                          : screen.search(job.pattern, position, bottom);
+        auto const repeated = match && lastMatch && *match <= *lastMatch;
+        if (match && !repeated && match->column < lastColumn)
+            next = CellLocation { match->line, match->column + 1 };
+        else if (match)
+            next = CellLocation { match->line + 1, ColumnOffset(0) };
+        else
+            next = CellLocation { bottom + 1, ColumnOffset(0) };
+
+        if (repeated)
+            match.reset();
+    }
+    else
+    {
+        if (position.line < historyTop)
+            return false;
+
+        // Each step starts with a logical line, such that the next step ends with a new one.
+        auto top = std::max(position.line - boxed_cast<LineOffset>(SearchLinesPerStep) + 1, historyTop);
+        while (top > historyTop && grid.isLineWrapped(top))
+            --top;
+
+        match = job.regex ? screen.searchReverse(*job.regex, position, top)
+                          : screen.searchReverse(job.pattern, position, top);
+        auto const repeated = match && lastMatch && *lastMatch <= *match;
+        if (match && !repeated && match->column > ColumnOffset(0))
+            next = CellLocation { match->line, match->column - 1 };
+        else if (match)
+            next = CellLocation { match->line - 1, lastColumn };
+        else
+            next = CellLocation { top - 1, lastColumn };
+
+        if (repeated)
+            match.reset();
+    }
+
+    if (match)
+    {
+        viewport().makeVisibleWithinSafeArea(match->line);
+        auto const continueSearch = job.onMatch(*match);
+        screenUpdated();
+        _eventListener.updateHighlights();
+        if (!continueSearch)
+            return false;
+        job.lastMatch = std::pair { grid.lineId(match->line), match->column };
+    }
+
+    if (next.line < historyTop || next.line > pageBottom)
+        return false;
+
+    job.line = grid.lineId(next.line);
+    job.column = next.column;
+    job.lineIdGeneration = grid.lineIdGeneration();
+    return true;
 }
 
 bool Terminal::wordDelimited(CellLocation position) const noexcept
@@ -2153,8 +3628,12 @@ std::tuple<std::u32string, CellLocationRange> Terminal::extractWordUnderCursor(
 
 optional<CellLocation> Terminal::searchReverse(CellLocation searchPosition)
 {
-    auto const searchText = u32string_view(_state.searchMode.pattern);
-    auto const matchLocation = currentScreen().searchReverse(searchText, searchPosition);
+    auto const& searchMode = _state.searchMode;
+    auto matchLocation = optional<CellLocation> {};
+    if (searchMode.regex)
+        matchLocation = currentScreen().searchReverse(*searchMode.regex, searchPosition);
+    else if (!searchMode.isRegex())
+        matchLocation = currentScreen().searchReverse(u32string_view(searchMode.pattern), searchPosition);
 
     if (matchLocation)
         viewport().makeVisibleWithinSafeArea(matchLocation.value().line);
@@ -2338,7 +3817,7 @@ void TraceHandler::flushOne(PendingSequence const& pendingSequence)
 {
     if (auto const* seq = std::get_if<Sequence>(&pendingSequence))
     {
-        if (auto const* functionDefinition = seq->functionDefinition(_terminal->activeSequences()))
+        if (auto const* functionDefinition = seq->functionDefinition(_terminal->supportedSequences()))
             fmt::print("\t{:<20} ; {:<18} ; {}\n",
                        seq->text(),
                        functionDefinition->documentation.mnemonic,
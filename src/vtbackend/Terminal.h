@@ -1,12 +1,18 @@
 // SPDX-License-Identifier: Apache-2.0
 #pragma once
 
+#include <vtbackend/FloodControl.h>
+#include <vtbackend/FramePacer.h>
 #include <vtbackend/InputGenerator.h>
 #include <vtbackend/InputHandler.h>
+#include <vtbackend/InputLatencyTracker.h>
+#include <vtbackend/PredictiveEcho.h>
+#include <vtbackend/PtyReadSizer.h>
 #include <vtbackend/RenderBuffer.h>
 #include <vtbackend/ScreenEvents.h>
 #include <vtbackend/Selector.h>
 #include <vtbackend/Sequence.h>
+#include <vtbackend/SessionRecorder.h>
 #include <vtbackend/Settings.h>
 #include <vtbackend/TerminalState.h>
 #include <vtbackend/ViInputHandler.h>
@@ -18,20 +24,31 @@
 #include <vtpty/Pty.h>
 
 #include <crispy/BufferObject.h>
+#include <crispy/allocation_counter.h>
 #include <crispy/assert.h>
 #include <crispy/defines.h>
+#include <crispy/spsc_queue.h>
+#include <crispy/thread_qos.h>
 
 #include <fmt/format.h>
 
 #include <gsl/pointers>
 
+#include <array>
 #include <atomic>
+#include <bit>
 #include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <vector>
 
 namespace vtbackend
 {
@@ -40,6 +57,9 @@ template <typename Cell>
 CRISPY_REQUIRES(CellConcept<Cell>)
 class Screen;
 
+template <typename Cell>
+class RenderBufferBuilder;
+
 /// Helping information to visualize IME text that has not been comitted yet.
 struct InputMethodData
 {
@@ -48,6 +68,19 @@ struct InputMethodData
     std::string preeditString;
 };
 
+/// Memory given back by Terminal::trimMemory().
+struct TrimmedMemory
+{
+    size_t compactedLines = 0; // history lines packed back into trivial line buffers
+    size_t releasedBytes = 0;  // of line storage and pooled buffers returned to the system
+};
+
+enum class SearchDirection
+{
+    Forward,
+    Backward,
+};
+
 // Implements Trace mode handling for the given controls.
 //
 // It either directly forwards the sequences to the actually current main display,
@@ -125,6 +158,9 @@ class Terminal
         virtual void playSound(Sequence::Parameters const&) {}
         virtual void cursorPositionChanged() {}
         virtual void onScrollOffsetChanged(ScrollOffset) {}
+        /// Asks the host to call Terminal::flushInput() once its event loop is done with the events
+        /// currently pending, see Terminal::setInputBatching().
+        virtual void scheduleInputFlush() {}
     };
 
     class NullEvents: public Events
@@ -161,15 +197,46 @@ class Terminal
              std::unique_ptr<vtpty::Pty> pty,
              Settings factorySettings,
              std::chrono::steady_clock::time_point now /* = std::chrono::steady_clock::now()*/);
-    ~Terminal() = default;
+    ~Terminal();
 
     void start();
 
     void setRefreshRate(RefreshRate refreshRate);
+    [[nodiscard]] RefreshInterval refreshInterval() const noexcept { return _refreshInterval; }
+    void setVsyncFramePacing(bool enabled) noexcept { _settings.vsyncFramePacing = enabled; }
+    void setSynchronizedOutputTimeout(std::chrono::milliseconds timeout) noexcept
+    {
+        _settings.synchronizedOutputTimeout = timeout;
+    }
+
+    /// Sets the scheduling classes of the threads reading and processing the PTY's output, while attached
+    /// to a display, and while detached from it. The threads apply them when processing their next input.
+    void setInputThreadQos(crispy::thread_qos attached, crispy::thread_qos detached) noexcept
+    {
+        _inputThreadQos = attached;
+        _detachedInputThreadQos = detached;
+    }
+
+    /// Informs the terminal about the display having presented a frame at @p now,
+    /// i.e. at a vertical blank, for pacing the refreshes of the render buffer to them.
+    ///
+    /// May be invoked from the render thread.
+    void vsyncPresented(std::chrono::steady_clock::time_point now) noexcept
+    {
+        _framePacer.vsyncPresented(now);
+    }
     void setLastMarkRangeOffset(LineOffset value) noexcept;
 
     void setMaxHistoryLineCount(MaxHistoryLineCount maxHistoryLineCount);
     LineCount maxHistoryLineCount() const noexcept;
+    void setHistorySpill(bool enabled, size_t memoryBudget);
+    void setHistorySearchIndex(bool enabled);
+
+    /// Releases the memory that is not needed for the terminal's contents right now,
+    /// at the expense of having to recreate it once needed again, e.g. when running low on memory.
+    ///
+    /// Must be invoked with the terminal locked.
+    TrimmedMemory trimMemory();
 
     void setTerminalId(VTType id) noexcept;
 
@@ -181,6 +248,12 @@ class Terminal
         _settings.maxImageSize = limit;
     }
 
+    void setMaxImageMemory(size_t bytes) noexcept
+    {
+        _settings.maxImageMemory = bytes;
+        _state.imagePool.setMemoryBudget(bytes);
+    }
+
     bool isModeEnabled(AnsiMode m) const noexcept { return _state.modes.enabled(m); }
     bool isModeEnabled(DECMode m) const noexcept { return _state.modes.enabled(m); }
     void setMode(AnsiMode mode, bool enable);
@@ -313,6 +386,32 @@ class Terminal
     bool hasInput() const noexcept;
     void flushInput();
 
+    /// Batches the input generated by key, mouse, and focus events into a single write to the PTY
+    /// per iteration of the host's event loop, rather than writing the input of each event on its own.
+    ///
+    /// The first event of a batch calls Events::scheduleInputFlush(). Events arriving once the batch is
+    /// older than MaxInputBatchDelay flush it right away, bounding the latency added by batching
+    /// even while the host's event loop is busy.
+    void setInputBatching(bool enabled) noexcept { _inputBatching = enabled; }
+
+    static constexpr auto MaxInputBatchDelay = std::chrono::milliseconds(4);
+
+    /// Counters of the input written to the PTY since the terminal started.
+    struct InputWriteStats
+    {
+        uint64_t events = 0;        // key, mouse, and focus events having generated input
+        uint64_t writes = 0;        // to the PTY, of any input
+        uint64_t bytes = 0;         // written to the PTY
+        double eventsPerSecond = 0; // within the last full second measured
+        double writesPerSecond = 0; // within the last full second measured
+    };
+
+    [[nodiscard]] InputWriteStats inputWriteStats() const noexcept;
+
+    /// @returns the number of bytes of input not yet written to the PTY device,
+    ///          including those the PTY has queued for writing.
+    [[nodiscard]] size_t pendingInputBytes() const noexcept;
+
     std::string_view peekInput() const noexcept { return _state.inputGenerator.peek(); }
     // }}}
 
@@ -333,6 +432,14 @@ class Terminal
     /// and ensures internal time-dependant state is updated.
     void tick(std::chrono::steady_clock::time_point now) noexcept;
     void tick(std::chrono::milliseconds delta) { tick(_currentTime + delta); }
+
+    /// Detaches the terminal from its display, e.g. while it is not visible, or attaches it again.
+    ///
+    /// A detached terminal keeps processing its input at full speed, but neither refreshes its render
+    /// buffer, nor ticks the cursor and text blinking, nor updates the indicator status line.
+    /// Attaching it again refreshes the render buffer once.
+    void setDetached(bool detached);
+    [[nodiscard]] bool detached() const noexcept { return _detached; }
     // }}}
 
     // {{{ RenderBuffer synchronization API
@@ -351,14 +458,14 @@ class Terminal
     ///
     /// @retval true   front buffer now contains the refreshed render buffer.
     /// @retval false  back buffer contains the refreshed render buffer,
-    ///                and RenderDoubleBuffer::swapBuffers() must again
+    ///                and RenderTripleBuffer::swapBuffers() must again
     ///                be successfully invoked to swap back/front buffers
     ///                in order to access the refreshed render buffer.
     ///
     /// @note The current time must have been updated in order to get the
     ///       correct cursor blinking state drawn.
     ///
-    /// @see RenderDoubleBuffer::swapBuffers()
+    /// @see RenderTripleBuffer::swapBuffers()
     /// @see renderBuffer()
     ///
     bool refreshRenderBuffer(bool locked = false);
@@ -371,14 +478,13 @@ class Terminal
     /// @param now    the current time
     /// @param locked whether or not the Terminal object's lock is already held by the caller.
     ///
-    /// @see RenderDoubleBuffer::swapBuffers()
+    /// @see RenderTripleBuffer::swapBuffers()
     /// @see renderBuffer()
     bool ensureFreshRenderBuffer(bool locked = false);
 
-    /// Aquuires read-access handle to front render buffer.
+    /// Acquires read-access handle to the most recently completed render buffer.
     ///
-    /// This also acquires the reader lock and releases it automatically
-    /// upon RenderBufferRef destruction.
+    /// May only be invoked by a single reader thread at a time, i.e. the render thread.
     ///
     /// @see ensureFreshRenderBuffer()
     /// @see refreshRenderBuffer()
@@ -405,6 +511,9 @@ class Terminal
 
     [[nodiscard]] ColorPalette const& colorPalette() const noexcept { return _state.colorPalette; }
     [[nodiscard]] ColorPalette& colorPalette() noexcept { return _state.colorPalette; }
+
+    /// @returns the colors of the palette as of the current frame being built, for fast lookup.
+    [[nodiscard]] ColorLookupTable const& colorLookupTable() const noexcept { return _colorLookupTable; }
     [[nodiscard]] ColorPalette& defaultColorPalette() noexcept { return _state.defaultColorPalette; }
 
     void setColorPalette(ColorPalette const& palette) noexcept;
@@ -429,18 +538,9 @@ class Terminal
         crispy::unreachable();
     }
 
-    [[nodiscard]] SequenceHandler& sequenceHandler() noexcept
-    {
-        // TODO: avoid double-switch by introducing a `SequenceHandler& sequenceHandler` member.
-        switch (_state.executionMode.load())
-        {
-            case ExecutionMode::Normal: return activeDisplay();
-            case ExecutionMode::BreakAtEmptyQueue:
-            case ExecutionMode::Waiting: [[fallthrough]];
-            case ExecutionMode::SingleStep: return _traceHandler;
-        }
-        crispy::unreachable();
-    }
+    /// @returns the handler the parser dispatches to, that is, the active display,
+    ///          or the trace handler while the execution is being traced.
+    [[nodiscard]] SequenceHandler& sequenceHandler() noexcept { return *_sequenceHandler; }
 
     bool isPrimaryScreen() const noexcept { return _state.screenType == ScreenType::Primary; }
     bool isAlternateScreen() const noexcept { return _state.screenType == ScreenType::Alternate; }
@@ -513,6 +613,20 @@ class Terminal
     {
         return _settings.cursorBlinkInterval;
     }
+
+    /// Sets the time without keyboard input after which a blinking cursor is shown steadily.
+    /// Zero lets the cursor blink forever.
+    void setCursorBlinkTimeout(std::chrono::milliseconds value) noexcept
+    {
+        _settings.cursorBlinkTimeout = value;
+    }
+
+    /// Tests whether the cursor has stopped blinking due to the lack of keyboard input.
+    bool cursorBlinkExpired() const noexcept
+    {
+        return _settings.cursorBlinkTimeout.count() != 0
+               && _currentTime - _lastCursorActivity >= _settings.cursorBlinkTimeout;
+    }
     // }}}
 
     // {{{ selection management
@@ -568,6 +682,7 @@ class Terminal
     }
 
     bool isHighlighted(CellLocation cell) const noexcept;
+    bool hasHighlight() const noexcept { return _highlightRange.has_value(); }
     bool blinkState() const noexcept { return _slowBlinker.state; }
     bool rapidBlinkState() const noexcept { return _rapidBlinker.state; }
 
@@ -582,8 +697,21 @@ class Terminal
     // }}}
 
     [[nodiscard]] std::string extractSelectionText() const;
+
+    /// Streams the text of the current selection to @p sink, in chunks of whole lines.
+    ///
+    /// The terminal is only locked while extracting each chunk, and not while passing it to @p sink,
+    /// such that extracting a huge selection does not block the terminal. Extraction stops early
+    /// if the selected lines are rearranged in the meantime, e.g. by a resize.
+    void extractSelectionText(std::function<void(std::string_view)> const& sink) const;
     [[nodiscard]] std::string extractLastMarkRange() const;
 
+    /// Folds the output of the shell command @p line belongs to, or unfolds it if folded already,
+    /// see Grid::toggleCommandOutputFold().
+    ///
+    /// @returns the prompt line of the command, if its output has been folded or unfolded.
+    std::optional<LineOffset> toggleCommandOutputFold(LineOffset line);
+
     /// Tests whether or not the mouse is currently hovering a hyperlink.
     [[nodiscard]] bool isMouseHoveringHyperlink() const noexcept
     {
@@ -604,10 +732,121 @@ class Terminal
 
     bool processInputOnce();
 
+    /// Processes the output available from the PTY without waiting for more, for having many terminals
+    /// served by the threads of a reactor (see crispy::io_reactor), instead of a processInputOnce()
+    /// loop per terminal. Requires the PTY reader thread to be disabled.
+    ///
+    /// @param budget  Number of bytes after which no more output is read, leaving the rest for the
+    ///                next invocation, so that other terminals take their turn in the meantime.
+    ///
+    /// @returns false if the PTY has been closed, true otherwise.
+    bool processAvailableInput(size_t budget);
+
     void markScreenDirty() noexcept { _screenDirty = true; }
 
     [[nodiscard]] uint64_t lastFrameID() const noexcept { return _lastFrameID.load(); }
 
+    /// Informs the terminal about the render buffer frame @p frameID having been presented at @p now,
+    /// completing the measurement of the input latency.
+    void framePresented(uint64_t frameID, Timestamp now) { _inputLatency.framePresented(frameID, now); }
+
+    /// @returns the latency from key events to the presentation of their effect, if measured yet.
+    [[nodiscard]] std::optional<InputLatencyTracker::Summary> inputLatency() const
+    {
+        return _inputLatency.summary();
+    }
+
+    /// Tests whether the primary screen is flooded with output, in which case only few frames are built,
+    /// such that rendering does not hold off parsing. Full-screen applications on the alternate screen
+    /// are never considered flooded.
+    [[nodiscard]] bool flooded() const noexcept;
+
+    /// @returns how long to wait before building the next frame, which is zero unless flooded.
+    [[nodiscard]] std::chrono::milliseconds frameThrottleDelay() const noexcept;
+
+    /// @returns the output rate and parse time per frame, along with whether the terminal is flooded.
+    [[nodiscard]] FloodControl::Stats floodStats() const noexcept;
+
+    /// @returns the number of bytes of PTY output parsed since the terminal started.
+    [[nodiscard]] uint64_t parsedBytes() const noexcept
+    {
+        return _parsedBytes.load(std::memory_order_relaxed);
+    }
+
+    /// @returns the CPU time spent parsing PTY output since the terminal started,
+    ///          on whichever thread it has been processed.
+    [[nodiscard]] std::chrono::nanoseconds parseCpuTime() const noexcept
+    {
+        return std::chrono::nanoseconds(_parseCpuTime.load(std::memory_order_relaxed));
+    }
+
+    /// Starts recording everything the PTY delivers into @p path, replacing any recording in progress.
+    ///
+    /// The output is referenced in the buffer objects it has been read into until written on
+    /// a background thread. These bytes are therefore claimed from the buffer objects as they are read,
+    /// just as with Settings::ptyReaderThread, rather than reused by the next read.
+    ///
+    /// @returns false if @p path could not be created.
+    bool startRecording(std::filesystem::path const& path, RecordingFormat format);
+
+    /// Stops recording, once everything recorded has been written.
+    ///
+    /// @returns the counters of the recording stopped, if any.
+    std::optional<SessionRecorder::Stats> stopRecording();
+
+    /// @returns the path being recorded into, if any.
+    [[nodiscard]] std::optional<std::filesystem::path> recordingPath() const;
+
+    /// @returns the allocation counters of the buffer objects the PTY output is read into.
+    [[nodiscard]] crispy::buffer_object_pool_stats ptyBufferStats() const noexcept
+    {
+        return _ptyBufferPool.stats();
+    }
+
+    /// Heap allocations made while processing the PTY output and while building frames,
+    /// only counted when built with CONTOUR_COUNT_ALLOCATIONS.
+    struct AllocationStats
+    {
+        crispy::allocation_counter::snapshot input;  // per processInputOnce()
+        crispy::allocation_counter::snapshot frames; // per render buffer filled
+        uint64_t parsedBytes;                        // of PTY output processed
+    };
+
+    [[nodiscard]] AllocationStats allocationStats() const noexcept
+    {
+        return { .input = _inputAllocations.stats(),
+                 .frames = _frameAllocations.stats(),
+                 .parsedBytes = _parsedBytes.load(std::memory_order_relaxed) };
+    }
+
+    /// Writes the execution counters of the VT sequences processed and the parser's throughput
+    /// to @p output. Writes nothing unless built with LIBTERMINAL_SEQUENCE_STATS.
+    void inspectSequenceStats(std::ostream& output) const;
+
+    /// @returns the number and the decoded size of the images held by the image pool.
+    [[nodiscard]] ImagePoolStats const& imagePoolStats() const noexcept { return _state.imagePool.stats(); }
+
+    /// Counters of the frames synchronized output (DEC mode 2026) has saved since the terminal started.
+    struct SynchronizedOutputStats
+    {
+        uint64_t batches = 0;     // number of times synchronized output has ended, or timed out
+        uint64_t framesSaved = 0; // number of screen updates folded into the single frame of their batch
+        uint64_t timeouts = 0;    // number of batches rendered due to the synchronized output timeout
+    };
+
+    [[nodiscard]] SynchronizedOutputStats synchronizedOutputStats() const noexcept
+    {
+        return { _synchronizedOutputBatches.load(),
+                 _synchronizedOutputFramesSaved.load(),
+                 _synchronizedOutputTimeouts.load() };
+    }
+
+    /// Frees the hyperlinks no longer referenced by any screen, e.g. since their lines left the history.
+    void collectHyperlinks();
+
+    /// @returns the number of hyperlinks currently stored.
+    [[nodiscard]] size_t hyperlinkCount() const noexcept { return _state.hyperlinks.size(); }
+
     // Screen's EventListener implementation
     //
     void requestCaptureBuffer(LineCount lines, bool logical);
@@ -683,6 +922,19 @@ class Terminal
         return _currentPtyBuffer;
     }
 
+    /// Stores @p head followed by @p tail in the buffer object for text not stored as received from
+    /// the PTY (e.g. as translated by a charset), such that trivial lines can refer to it.
+    ///
+    /// @returns the stored text, or nothing if it does not fit into a single buffer object.
+    [[nodiscard]] std::optional<crispy::BufferFragment<char>> storeTranslatedText(std::string_view head,
+                                                                                std::string_view tail = {});
+
+    /// @returns the buffer object storeTranslatedText() stores into next, if any.
+    [[nodiscard]] crispy::buffer_object_ptr<char> const& translatedTextBuffer() const noexcept
+    {
+        return _translatedTextBuffer;
+    }
+
     [[nodiscard]] vtbackend::SelectionHelper& selectionHelper() noexcept { return _selectionHelper; }
 
     [[nodiscard]] Selection::OnSelectionUpdated selectionUpdatedHelper()
@@ -730,6 +982,26 @@ class Terminal
     bool setNewSearchTerm(std::u32string text, bool initiatedByDoubleClick);
     void clearSearch();
 
+    /// Invoked for each match found by startSearch(), with the terminal locked.
+    /// Returning false stops the search.
+    using SearchMatchHandler = std::function<bool(CellLocation)>;
+
+    /// Sets the current search term and searches for it on a background thread, cancelling any search
+    /// still running. The current screen is searched starting at @p searchPosition, and the viewport is
+    /// moved to make each match visible before it is reported.
+    ///
+    /// The terminal is locked only for short periods of time while searching, such that PTY output keeps
+    /// being processed. The search is stopped once lines have been moved (e.g. by reflow) however.
+    ///
+    /// @retval false the search term did not change, so that no search has been started.
+    bool startSearch(std::u32string text,
+                     CellLocation searchPosition,
+                     SearchDirection direction,
+                     SearchMatchHandler onMatch);
+
+    /// Stops the search started by startSearch(), if still running.
+    void cancelSearch();
+
     // Tests if the grid cell at the given location does contain a word delimiter.
     [[nodiscard]] bool wordDelimited(CellLocation position) const noexcept;
 
@@ -752,15 +1024,82 @@ class Terminal
         return _supportedVTSequences.activeSequences();
     }
 
+    SupportedSequences const& supportedSequences() const noexcept { return _supportedVTSequences; }
+
   private:
     void mainLoop();
     void fillRenderBufferInternal(RenderBuffer& output, bool includeSelection);
+    template <typename Cell>
+    RenderPassHints fillRenderBufferMainDisplay(Screen<Cell>& screen,
+                                                RenderBuffer& output,
+                                                LineOffset baseLine,
+                                                bool reverseVideo,
+                                                HighlightSearchMatches highlightSearchMatches,
+                                                std::optional<CellLocation> cursorPosition,
+                                                bool includeSelection);
     LineCount fillRenderBufferStatusLine(RenderBuffer& output, bool includeSelection, LineOffset base);
+    void fillRenderBufferStatusDisplay(Screen<StatusDisplayCell>& screen,
+                                       RenderBuffer& output,
+                                       bool includeSelection,
+                                       LineOffset base);
+
+    // {{{ background search
+    struct SearchJob
+    {
+        uint64_t id = 0;
+        std::u32string pattern;
+        std::shared_ptr<crispy::regex_dfa const> regex; // the compiled pattern, if searching for a regex
+        SearchDirection direction = SearchDirection::Backward;
+        SearchMatchHandler onMatch;
+        bool primaryScreen = true;
+
+        // Where the first step starts searching.
+        std::optional<CellLocation> startPosition;
+
+        // Where the next step continues searching, in terms of Grid::lineId() as of lineIdGeneration.
+        uint64_t line = 0;
+        ColumnOffset column {};
+        uint64_t lineIdGeneration = 0;
+
+        // The most recent match reported, in terms of Grid::lineId().
+        std::optional<std::pair<uint64_t, ColumnOffset>> lastMatch;
+    };
+
+    // Number of lines searched per step, i.e. without unlocking the terminal.
+    static constexpr auto SearchLinesPerStep = LineCount(1000);
+
+    void searchLoop();
+    void stopSearchThread();
+
+    // Updates the compiled regular expression of the search term, if searching for regular expressions.
+    void compileSearchPattern();
+
+    // Runs the next step of the given search. Returns whether or not the search is to be continued.
+    template <typename Cell>
+    bool searchStep(Screen<Cell>& screen, SearchJob& job);
+    // }}}
     void updateIndicatorStatusLine();
     void updateCursorVisibilityState() const noexcept;
     void updateHoveringHyperlinkState();
     bool handleMouseSelection(Modifiers modifiers);
 
+    // Predicts the echo of the given character typed, see Settings::predictiveEcho.
+    void predictEcho(char32_t ch, Modifiers modifiers, Timestamp now);
+    // Informs the echo prediction about input that cannot be predicted having been sent.
+    void unpredictableInputSent(bool lineEntered);
+
+    // Writes the input generated by an event, or leaves it to the batch it is part of.
+    void inputGenerated();
+    void measureInputRates(std::chrono::steady_clock::time_point now);
+    // Reconciles the predicted echo with the output parsed, with the terminal being locked.
+    void reconcilePredictedEcho();
+    void predictedEchoChanged() noexcept;
+    // Returns the time the screen is rendered at anyway while synchronized output is active, if any.
+    [[nodiscard]] std::optional<Timestamp> synchronizedOutputDeadline() const noexcept;
+    // Stops deferring screen updates for the current synchronized output batch, accounting for it.
+    // Returns false if the batch has already been ended, i.e. by its timeout.
+    bool endSynchronizedOutputBatch() noexcept;
+
     /// Tests if the text selection should be extended by the given mouse position or not.
     ///
     /// @retval false if either no selection is available, selection is complete, or the new pixel position is
@@ -792,8 +1131,68 @@ class Terminal
         return { !blinker.state, _currentTime };
     }
 
+    // Handles the execution mode, flushing traced sequences or waiting (if it may block) while halted.
+    // Returns whether to go on reading input.
+    bool prepareToReadInput(bool mayBlock);
+    void updateSequenceHandler() noexcept;
+
+    // Parses what has been read from the PTY, closing it on failure or end of output.
+    // Returns the number of bytes parsed, being 0 if nothing has been read, or nothing if closed.
+    std::optional<size_t> parsePtyRead(std::optional<vtpty::Pty::ScatteredRead> const& readResult);
+
+    // Parses the given PTY output, with the terminal lock held, though released and re-acquired
+    // after every Settings::parseSliceSize bytes.
+    void parseInSlices(std::string_view data);
+
+    // Records the PTY output @p data read into @p buffer, claiming its bytes.
+    void recordPtyOutput(crispy::buffer_object_ptr<char> const& buffer, std::string_view data);
+
+    // Lets the screen be updated after input has been processed.
+    void inputProcessed();
+
     // Reads from PTY.
-    [[nodiscard]] vtpty::Pty::ReadResult readFromPty();
+    [[nodiscard]] std::optional<vtpty::Pty::ScatteredRead> readFromPty();
+
+    // Reads into the given buffer object, continuing into nextBuffer (allocated as needed)
+    // if the read size exceeds what is left in the former.
+    [[nodiscard]] std::optional<vtpty::Pty::ScatteredRead> readFromPty(
+        crispy::buffer_object_ptr<char> const& buffer,
+        crispy::buffer_object_ptr<char>& nextBuffer,
+        std::optional<std::chrono::milliseconds> timeout);
+    void adaptPtyReadSize(size_t bytesRead);
+    [[nodiscard]] crispy::buffer_object_ptr<char> allocatePtyBuffer();
+    [[nodiscard]] std::optional<std::chrono::milliseconds> ptyReadTimeout() const noexcept;
+
+    // Destroys the next batch of the lines discarded by clearing the history, with the terminal locked.
+    void releaseDiscardedLines();
+
+    // Returns when to refresh the render buffer next if paced to the display's vertical blanks,
+    // or std::nullopt if refreshed at the fixed refresh rate.
+    [[nodiscard]] std::optional<std::chrono::steady_clock::time_point> nextRefreshDeadline() const noexcept;
+    [[nodiscard]] std::optional<std::chrono::milliseconds> nextRefreshDelay() const noexcept;
+
+    // {{{ PTY reader thread
+    struct PtyChunk
+    {
+        crispy::buffer_object_ptr<char> buffer; // the buffer object the data has been read into
+        std::string_view data;                  // empty on end of stream
+        bool fromStdoutFastPipe = false;
+        int errorCode = 0; // errno of the failed read that ended the stream, if any
+    };
+
+    // Parses all PTY chunks the reader thread has enqueued so far, starting that thread if needed.
+    bool processPtyChunks();
+    void ptyReaderLoop();
+
+    // Applies the scheduling class requested for input threads to the calling one, unless already applied.
+    void applyInputThreadQos(std::optional<crispy::thread_qos>& applied) const;
+    void pushPtyChunk(PtyChunk chunk);
+    void wakeupPtyChunkConsumer();
+    void stopPtyReader();
+    // }}}
+
+    // Ensures the current PTY buffer object can be written to by the parser thread.
+    void preparePtyBufferForWrite(size_t size);
 
     // Writes partially or all input data to the PTY buffer object and returns a string view to it.
     [[nodiscard]] std::string_view lockedWriteToPtyBuffer(std::string_view data);
@@ -816,10 +1215,57 @@ class Terminal
     std::chrono::steady_clock::time_point _currentTime;
 
     // {{{ PTY and PTY read buffer management
+    // The read size adapts between MinPtyReadSize and MaxPtyReadSizeFactor times the configured one.
+    static constexpr size_t MinPtyReadSize = 4096;
+    static constexpr size_t MaxPtyReadSizeFactor = 16;
+
+    // Buffer objects holding fewer reads than this are allocated from the larger size classes of the pool,
+    // the largest of which is LargePtyBufferFactor times the size of the configured buffer objects.
+    static constexpr size_t MinPtyReadsPerBuffer = 16;
+    static constexpr size_t LargePtyBufferFactor = 4;
+    static constexpr size_t PtyBufferSizeClasses = std::bit_width(LargePtyBufferFactor);
+
+    // Unused buffer objects beyond the recent demand are released this often.
+    static constexpr auto PtyBufferTrimInterval = std::chrono::seconds(10);
+
     crispy::buffer_object_pool<char> _ptyBufferPool;
+    std::chrono::steady_clock::time_point _lastPtyBufferTrim;
     crispy::buffer_object_ptr<char> _currentPtyBuffer;
-    size_t _ptyReadBufferSize;
+    crispy::buffer_object_ptr<char> _nextPtyBuffer; // the buffer object reads continue into, if any
+    PtyReadSizer _ptyReadSizer;
     std::unique_ptr<vtpty::Pty> _pty;
+
+    // Pastes from this size on show their progress in the indicator status line.
+    static constexpr size_t PasteProgressThreshold = 1024 * 1024;
+    std::atomic<size_t> _pasteSize = 0; // number of bytes pending at the start of the last paste
+
+    // Lines discarded by clearing the history are destroyed in batches of this many lines,
+    // one batch whenever there is no input to be processed.
+    static constexpr size_t DiscardedLinesPerTurn = 16 * 1024;
+    std::atomic<bool> _discardedLinesPending = false;
+    // }}}
+
+    // {{{ PTY reader thread state (only used when Settings::ptyReaderThread is enabled)
+    static constexpr size_t PtyChunkQueueCapacity = 64;
+    crispy::spsc_queue<PtyChunk, PtyChunkQueueCapacity> _ptyChunks;
+    std::mutex _ptyChunkMutex; // only taken to sleep on or to signal _ptyChunkCondition
+    std::condition_variable _ptyChunkCondition;
+    bool _ptyChunkConsumerWakeup = false;
+    std::atomic<bool> _ptyReaderQuit = false;
+    // Buffer object for writeToScreen(), as the reader thread owns the hot end of the buffers it reads into.
+    crispy::buffer_object_ptr<char> _localPtyBuffer;
+    // Buffer object for storeTranslatedText().
+    crispy::buffer_object_ptr<char> _translatedTextBuffer;
+    std::thread _ptyReaderThread;
+    // }}}
+
+    // {{{ background search state, see startSearch()
+    std::atomic<uint64_t> _searchId = 0; // id of the current search, advanced to cancel it
+    std::mutex _searchMutex;             // guards _pendingSearch and _searchQuit
+    std::condition_variable _searchCondition;
+    std::optional<SearchJob> _pendingSearch;
+    bool _searchQuit = false;
+    std::thread _searchThread;
     // }}}
 
     // {{{ mouse related state (helpers for detecting double/tripple clicks)
@@ -833,6 +1279,7 @@ class Terminal
 
     // {{{ blinking state helpers
     mutable std::chrono::steady_clock::time_point _lastCursorBlink;
+    std::chrono::steady_clock::time_point _lastCursorActivity; // last keyboard input, see cursorBlinkTimeout
     mutable unsigned _cursorBlinkState = 1;
     struct BlinkerState
     {
@@ -854,9 +1301,40 @@ class Terminal
     gsl::not_null<ScreenBase*> _currentScreen;
     Viewport _viewport;
     TraceHandler _traceHandler;
+
+    // The handler sequenceHandler() returns, which is only re-selected in updateSequenceHandler()
+    // on the parser's thread (when switching displays or before reading PTY input),
+    // rather than deciding on the execution mode and active display for each sequence parsed.
+    gsl::not_null<SequenceHandler*> _sequenceHandler;
     // clang-format on
     // }}}
 
+    // {{{ indicator status line
+    // A run of uniformly styled text on the indicator status line.
+    struct IndicatorStatusSegment
+    {
+        std::string text;
+        std::optional<Color> foregroundColor; // std::nullopt for the status line's own color
+        bool bold = false;
+
+        bool operator==(IndicatorStatusSegment const&) const = default;
+    };
+
+    // The contents the indicator status line has last been written with, such that only the segments
+    // that have changed since are written anew.
+    struct IndicatorStatusLine
+    {
+        RGBColorPair colors {};
+        ColumnCount columns {};
+        std::vector<IndicatorStatusSegment> left {};
+        std::string right {};
+        std::vector<ColumnOffset> leftColumns {}; // column each left segment has been written at
+        ColumnOffset leftEnd {};                  // column following the last left segment
+        bool valid = false;
+    };
+    IndicatorStatusLine _indicatorStatusLine {};
+    // }}}
+
     // {{{ selection states
     std::unique_ptr<Selection> _selection;
     struct SelectionHelper: public vtbackend::SelectionHelper
@@ -877,14 +1355,106 @@ class Terminal
     mutable std::atomic<uint64_t> _changes { 0 };
     bool _screenDirty = false; // TODO: just inc _changes and delete this instead.
     RefreshInterval _refreshInterval;
-    RenderDoubleBuffer _renderBuffer {};
+    RenderTripleBuffer _renderBuffer {};
     std::atomic<uint64_t> _lastFrameID = 0;
+    InputLatencyTracker _inputLatency;
+
+    // {{{ input batching state, see setInputBatching()
+    bool _inputBatching = false;
+    std::optional<std::chrono::steady_clock::time_point> _inputBatchStart;
+    std::atomic<uint64_t> _inputEvents = 0;
+    std::atomic<uint64_t> _inputWrites = 0;
+    std::atomic<uint64_t> _inputWriteBytes = 0;
+    std::chrono::steady_clock::time_point _inputRateStart {}; // of the second being measured
+    uint64_t _inputEventsAtRateStart = 0;
+    uint64_t _inputWritesAtRateStart = 0;
+    std::atomic<double> _inputEventsPerSecond = 0;
+    std::atomic<double> _inputWritesPerSecond = 0;
+    // }}}
+
+    FramePacer _framePacer;
+    FloodControl _floodControl;
+    crispy::allocation_counter _inputAllocations;
+    crispy::allocation_counter _frameAllocations;
+    std::atomic<uint64_t> _parsedBytes = 0; // see parsedBytes()
+    std::unique_ptr<SessionRecorder> _recorder; // if recording, guarded by the terminal lock
+    std::atomic<std::chrono::nanoseconds::rep> _parseCpuTime = 0; // see parseCpuTime()
+    std::atomic<std::chrono::steady_clock::time_point> _lastRefreshStart {}; // Start of the last refresh.
     RenderPassHints _lastRenderPassHints {};
+
+    // Describes what a render buffer has last been filled with, such that the next frame
+    // rendered into it only needs to render the screen lines that have changed in the meantime.
+    //
+    // Lines are identified by their grid line ids, such that they can also be taken over
+    // after having been scrolled to another screen line.
+    struct RenderedFrame
+    {
+        bool reusable = false;
+        bool primaryScreen = true;
+        ScrollOffset scrollOffset {};
+        uint64_t lineIdGeneration = 0;
+        uint64_t topLineId = 0; // grid line id of the top screen line
+        PageSize pageSize {};
+        LineOffset baseLine {};
+        bool reverseVideo = false;
+        bool blink = false;
+        bool rapidBlink = false;
+        ColorPalette colors {};
+        std::vector<RenderedLineLocation> lineLocations {};
+        std::vector<bool> staleLines {}; // Screen lines that have changed, or must be rendered anew anyway.
+        HyperlinkId hoveringHyperlink {}; // Hyperlink rendered as being hovered by the mouse, if any.
+        std::vector<RenderedHyperlinkSpan> hyperlinkSpans {}; // Ordered by screen line.
+
+        [[nodiscard]] bool rendersLike(RenderedFrame const& other) const noexcept;
+    };
+    std::array<RenderedFrame, RenderTripleBuffer::BufferCount> _renderedFrames {};
+    RenderBuffer _previousFrame {}; // Former contents of the render buffer currently being filled.
+
+    // Describes what a render buffer's status line has last been filled with, see RenderedFrame.
+    struct RenderedStatusLine
+    {
+        bool reusable = false;
+        StatusDisplayType type = StatusDisplayType::None;
+        PageSize pageSize {};
+        LineOffset baseLine {};
+        bool reverseVideo = false;
+        bool blink = false;
+        bool rapidBlink = false;
+        ColorPalette colors {};
+        std::vector<RenderedLineLocation> lineLocations {};
+        std::vector<bool> staleLines {};
+
+        [[nodiscard]] bool rendersLike(RenderedStatusLine const& other) const noexcept;
+    };
+    std::array<RenderedStatusLine, RenderTripleBuffer::BufferCount> _renderedStatusLines {};
+
+    // Large pages are rendered in bands of consecutive screen lines concurrently. All but the first band
+    // are rendered into these scratch buffers first, and then appended to the frame in order.
+    struct RenderBand
+    {
+        RenderBuffer buffer {};
+        std::vector<RenderedLineLocation> lineLocations {};
+        std::vector<RenderedHyperlinkSpan> hyperlinkSpans {};
+    };
+    std::vector<RenderBand> _renderBands {};
     // }}}
 
+    ColorLookupTable _colorLookupTable {}; // rebuilt from the color palette as needed for each frame
     InputMethodData _inputMethodData {};
+    PredictiveEcho _predictiveEcho {}; // guarded by the terminal lock
+    std::atomic<Timestamp> _predictedEchoExpiry = Timestamp::max(); // see PredictiveEcho::expiry()
     std::atomic<HyperlinkId> _hoveringHyperlinkId = HyperlinkId {};
     std::atomic<bool> _renderBufferUpdateEnabled = true; // for "Synchronized Updates" feature
+    std::atomic<Timestamp> _synchronizedOutputStart = Timestamp {};
+    std::atomic<uint64_t> _deferredScreenUpdates = 0; // screen updates in the current batch
+    std::atomic<uint64_t> _synchronizedOutputBatches = 0;
+    std::atomic<uint64_t> _synchronizedOutputFramesSaved = 0;
+    std::atomic<uint64_t> _synchronizedOutputTimeouts = 0;
+    std::atomic<bool> _detached = false;                 // see setDetached()
+    std::atomic<crispy::thread_qos> _inputThreadQos;
+    std::atomic<crispy::thread_qos> _detachedInputThreadQos;
+    // Scheduling class applied to the thread calling processInputOnce(), if any yet.
+    std::optional<crispy::thread_qos> _processingThreadQos;
     std::optional<HighlightRange> _highlightRange = std::nullopt;
     SupportedSequences _supportedVTSequences;
 };
@@ -23,12 +23,12 @@ TerminalState::TerminalState(Terminal& terminal):
     imagePool { [te = &terminal](Image const* image) {
         te->discardImage(*image);
     } },
-    hyperlinks { HyperlinkCache { 1024 } },
     sequencer { terminal },
     parser { std::ref(sequencer) },
     viCommands { terminal },
     inputHandler { viCommands, ViMode::Insert }
 {
+    imagePool.setMemoryBudget(settings.maxImageMemory);
 }
 
 /// Applies a FunctionDefinition to a given context, emitting the respective command.
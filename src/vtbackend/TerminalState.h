@@ -9,6 +9,7 @@
 #include <vtbackend/InputGenerator.h>
 #include <vtbackend/InputHandler.h>
 #include <vtbackend/ScreenEvents.h> // ScreenType
+#include <vtbackend/SequenceStats.h>
 #include <vtbackend/Sequencer.h>
 #include <vtbackend/Settings.h>
 #include <vtbackend/ViCommands.h>
@@ -19,6 +20,8 @@
 
 #include <vtparser/Parser.h>
 
+#include <crispy/regex_dfa.h>
+
 #include <libunicode/utf8.h>
 
 #include <fmt/format.h>
@@ -137,6 +140,13 @@ struct Search
     std::u32string pattern;
     ScrollOffset initialScrollOffset {};
     bool initiatedByDoubleClick = false;
+
+    // The compiled pattern, if searching for regular expressions (see Settings::searchRegex),
+    // or nullptr along with the reason in regexError, if the pattern is not a valid one.
+    std::shared_ptr<crispy::regex_dfa const> regex;
+    std::string regexError;
+
+    [[nodiscard]] bool isRegex() const noexcept { return regex || !regexError.empty(); }
 };
 
 // Mandates what execution mode the terminal will take to process VT sequences.
@@ -241,6 +251,9 @@ struct TerminalState
     Sequencer sequencer;
     vtparser::Parser<Sequencer, false> parser;
     uint64_t instructionCounter = 0;
+#if defined(LIBTERMINAL_SEQUENCE_STATS)
+    SequenceStats sequenceStats;
+#endif
 
     InputGenerator inputGenerator {};
 
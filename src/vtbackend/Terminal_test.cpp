@@ -13,6 +13,10 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <string>
 #include <vector>
 
@@ -83,6 +87,32 @@ TEST_CASE("Terminal.BlinkingCursor", "[terminal]")
         terminal.ensureFreshRenderBuffer();
         CHECK(terminal.cursorCurrentlyVisible());
     }
+
+    SECTION("stop blinking without keyboard input")
+    {
+        auto constexpr BlinkTimeout = chrono::milliseconds(2000);
+        terminal.setCursorBlinkTimeout(BlinkTimeout);
+
+        // Hidden for the last time right before the timeout, and shown again at the turn after it.
+        terminal.tick(clockBase + BlinkTimeout - BlinkInterval + chrono::milliseconds(1));
+        CHECK(!terminal.cursorCurrentlyVisible());
+        REQUIRE(terminal.nextRender().has_value());
+
+        terminal.tick(clockBase + BlinkTimeout + chrono::milliseconds(2));
+        CHECK(terminal.cursorBlinkExpired());
+        CHECK(terminal.cursorCurrentlyVisible());
+        CHECK(!terminal.nextRender().has_value());
+
+        terminal.tick(clockBase + BlinkTimeout + 3 * BlinkInterval);
+        CHECK(terminal.cursorCurrentlyVisible());
+
+        // Keyboard input makes it blink again.
+        auto const clockAtInputEvent = clockBase + BlinkTimeout + 4 * BlinkInterval;
+        mc.sendCharEvent('x', vtbackend::Modifier {}, clockAtInputEvent);
+        terminal.tick(clockAtInputEvent + BlinkInterval + chrono::milliseconds(1));
+        CHECK(!terminal.cursorBlinkExpired());
+        CHECK(!terminal.cursorCurrentlyVisible());
+    }
 }
 
 TEST_CASE("Terminal.DECCARA", "[terminal]")
@@ -222,6 +252,110 @@ TEST_CASE("Terminal.SynchronizedOutput", "[terminal]")
     mc.terminal.tick(now);
     mc.terminal.ensureFreshRenderBuffer();
     CHECK("Hello  World" == trimmedTextScreenshot(mc));
+
+    // Both screen updates have been rendered in a single frame.
+    auto const stats = mc.terminal.synchronizedOutputStats();
+    CHECK(stats.batches == 1);
+    CHECK(stats.framesSaved >= 1);
+    CHECK(stats.timeouts == 0);
+}
+
+TEST_CASE("Terminal.SynchronizedOutput.timeout", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount(20), LineCount(1) };
+    mc.terminal.setSynchronizedOutputTimeout(chrono::milliseconds(100));
+
+    mc.writeToScreen("\033[?2026hHello");
+    auto const start = chrono::steady_clock::now();
+    mc.terminal.tick(start);
+    mc.terminal.ensureFreshRenderBuffer();
+    CHECK(trimmedTextScreenshot(mc).empty());
+    REQUIRE(mc.terminal.nextRender().has_value());
+    CHECK(*mc.terminal.nextRender() <= chrono::milliseconds(100));
+
+    // The application never ends synchronized output, so its output is shown once the timeout has passed.
+    mc.terminal.tick(start + chrono::milliseconds(200));
+    mc.terminal.ensureFreshRenderBuffer();
+    CHECK("Hello" == trimmedTextScreenshot(mc));
+    CHECK(mc.terminal.synchronizedOutputStats().timeouts == 1);
+
+    // Further output is shown right away, until the application ends synchronized output.
+    mc.writeToScreen(" World");
+    mc.terminal.tick(start + chrono::milliseconds(400));
+    mc.terminal.ensureFreshRenderBuffer();
+    CHECK("Hello World" == trimmedTextScreenshot(mc));
+
+    mc.writeToScreen("\033[?2026l");
+    CHECK(mc.terminal.synchronizedOutputStats().batches == 1);
+}
+
+TEST_CASE("Terminal.Detached", "[terminal]")
+{
+    auto const now = chrono::steady_clock::now();
+    auto mc = MockTerm { ColumnCount(20), LineCount(1) };
+    mc.terminal.setCursorDisplay(vtbackend::CursorDisplay::Blink);
+
+    // Output is still processed while detached, but not rendered.
+    mc.terminal.setDetached(true);
+    mc.writeToScreen("Hello");
+    mc.terminal.tick(now);
+    mc.terminal.ensureFreshRenderBuffer();
+    CHECK(mainPageText(mc.terminal.primaryScreen()).starts_with("Hello"));
+    CHECK(trimmedTextScreenshot(mc).empty());
+    CHECK(!mc.terminal.nextRender().has_value());
+
+    // Attaching refreshes the render buffer right away.
+    mc.terminal.setDetached(false);
+    mc.terminal.ensureFreshRenderBuffer();
+    CHECK("Hello" == trimmedTextScreenshot(mc));
+    CHECK(mc.terminal.nextRender().has_value());
+}
+
+TEST_CASE("Terminal.processAvailableInput", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount(20), LineCount(1) };
+
+    // Having exhausted its budget, it returns rather than reading on.
+    mc.mockPty().appendStdOutBuffer("Hello");
+    CHECK(mc.terminal.processAvailableInput(1));
+    CHECK(mainPageText(mc.terminal.primaryScreen()).starts_with("Hello"));
+    CHECK(!mc.mockPty().isClosed());
+
+    // The mock PTY tells the end of its output by reading nothing.
+    CHECK(!mc.terminal.processAvailableInput(4096));
+    CHECK(mc.mockPty().isClosed());
+}
+
+TEST_CASE("Terminal.recording", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount(20), LineCount(2) };
+    auto const path = std::filesystem::temp_directory_path() / "contour-terminal-recording-test.rec";
+    REQUIRE(mc.terminal.startRecording(path, vtbackend::RecordingFormat::Binary));
+    CHECK(mc.terminal.recordingPath() == path);
+
+    // The text following the SGR would be moved next to the line's text, if the bytes were not claimed.
+    mc.mockPty().appendStdOutBuffer("Hello\033[1mWorld");
+    CHECK(mc.terminal.processAvailableInput(4096));
+    mc.terminal.resizeScreen(PageSize { LineCount(3), ColumnCount(30) });
+    mc.mockPty().appendStdOutBuffer("\r\n!");
+    CHECK(mc.terminal.processAvailableInput(4096));
+    CHECK(mainPageText(mc.terminal.primaryScreen()).starts_with("HelloWorld"));
+
+    auto const stats = mc.terminal.stopRecording();
+    REQUIRE(stats.has_value());
+    CHECK(stats->bytes == 17);
+    CHECK(!mc.terminal.recordingPath().has_value());
+
+    auto file = std::ifstream(path, std::ios::binary);
+    auto const contents = std::string(std::istreambuf_iterator<char>(file), {});
+    std::filesystem::remove(path);
+    auto const recording = vtbackend::decodeRecording(contents);
+    REQUIRE(recording.has_value());
+    CHECK(recording->pageSize == PageSize { LineCount(2), ColumnCount(20) });
+    REQUIRE(recording->events.size() == 3);
+    CHECK(recording->events[0].output == "Hello\033[1mWorld");
+    CHECK(recording->events[1].resize == PageSize { LineCount(3), ColumnCount(30) });
+    CHECK(recording->events[2].output == "\r\n!");
 }
 
 TEST_CASE("Terminal.XTPUSHCOLORS_and_XTPOPCOLORS", "[terminal]")
@@ -364,6 +498,299 @@ TEST_CASE("Terminal.CurlyUnderline", "[terminal]")
     CHECK(!screen.at(LineOffset(0), ColumnOffset(3)).isFlagEnabled(CellFlag::Italic));
 }
 
+TEST_CASE("Terminal.RenderBufferCodepoints", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount(6), LineCount(2) };
+    mc.terminal.tick(chrono::steady_clock::now());
+
+    // Lines with multiple attribute spans are rendered cell-wise.
+    mc.writeToScreen("\033[1mA\033[me\u0301X\r\n\033[1mB\033[m");
+    mc.terminal.refreshRenderBuffer();
+    CHECK("AéX" == trimRight(textScreenshot(mc.terminal).at(0)));
+
+    // The first line is taken over from an earlier frame, along with its codepoints.
+    for (auto i = 0; i < 4; ++i)
+    {
+        mc.writeToScreen(fmt::format("\033[2;2H{}", i));
+        mc.terminal.refreshRenderBuffer();
+        auto const renderBuffer = mc.terminal.renderBuffer();
+        for (auto const& cell: renderBuffer.get().cells)
+        {
+            if (cell.position == vtbackend::CellLocation { LineOffset(0), ColumnOffset(1) })
+                CHECK(renderBuffer.get().codepointsOf(cell) == U"e\u0301");
+            if (cell.position == vtbackend::CellLocation { LineOffset(1), ColumnOffset(1) })
+                CHECK(renderBuffer.get().codepointsOf(cell) == std::u32string(1, U'0' + char32_t(i)));
+        }
+    }
+}
+
+TEST_CASE("Terminal.RenderBufferBlankCells", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount(80), LineCount(3) };
+    mc.terminal.tick(chrono::steady_clock::now());
+
+    auto const cellsOfLine = [&](int line) {
+        auto const renderBuffer = mc.terminal.renderBuffer();
+        return std::count_if(
+            renderBuffer.get().cells.begin(), renderBuffer.get().cells.end(), [line](auto const& cell) {
+                return cell.position.line == LineOffset(line);
+            });
+    };
+
+    // The blank cells past the text of lines rendered cell-wise are not rendered at all,
+    // neither of trivial lines with multiple attribute spans, nor of partially rewritten lines.
+    mc.writeToScreen("\033[1mA\033[mB\r\nCD\rX\r\n");
+    mc.terminal.refreshRenderBuffer();
+    CHECK(trimRight(textScreenshot(mc.terminal).at(0)) == "AB");
+    CHECK(trimRight(textScreenshot(mc.terminal).at(1)) == "XD");
+    CHECK(cellsOfLine(0) == 2);
+    CHECK(cellsOfLine(1) == 2);
+
+    // Unless they show other than the default background, such as with reverse video.
+    mc.writeToScreen("\033[?5h");
+    mc.terminal.refreshRenderBuffer();
+    CHECK(cellsOfLine(0) == 80);
+    CHECK(cellsOfLine(1) == 80);
+}
+
+TEST_CASE("Terminal.RenderBufferLineBands", "[terminal]")
+{
+    // Large enough a page to be rendered in multiple bands of lines, given multiple hardware threads.
+    auto constexpr PageLines = 240;
+    auto mc = MockTerm { ColumnCount(160), LineCount(PageLines) };
+    mc.terminal.tick(chrono::steady_clock::now());
+
+    // Every other line has multiple attribute spans and is thus rendered cell-wise.
+    for (auto i = 0; i < PageLines; ++i)
+        mc.writeToScreen(fmt::format(i % 2 ? "\033[{};1H\033[1mL\033[m{}" : "\033[{};1HL{}", i + 1, i));
+
+    for (auto frame = 0; frame < 4; ++frame)
+    {
+        mc.writeToScreen(fmt::format("\033[{};10H{}", 1 + frame * 70, frame));
+        mc.terminal.refreshRenderBuffer();
+
+        auto const screenshot = textScreenshot(mc.terminal);
+        for (auto i = 0; i < PageLines; ++i)
+        {
+            auto const expectedFrame = i % 70 == 0 && i / 70 <= frame ? fmt::format("{}", i / 70) : "";
+            auto const expected = fmt::format("L{:<8}{}", i, expectedFrame);
+            CHECK(trimRight(screenshot.at(static_cast<size_t>(i))) == trimRight(expected));
+        }
+
+        // The bands are concatenated in order of their lines.
+        auto const renderBuffer = mc.terminal.renderBuffer();
+        auto const& cells = renderBuffer.get().cells;
+        for (size_t i = 1; i < cells.size(); ++i)
+            CHECK(cells[i - 1].position.line <= cells[i].position.line);
+
+        REQUIRE(renderBuffer.get().cursor.has_value());
+        CHECK(renderBuffer.get().cursor->position.line == LineOffset(frame * 70));
+    }
+}
+
+TEST_CASE("Terminal.RenderBufferScrolledViewport", "[terminal]")
+{
+    auto constexpr LineCountTotal = 20;
+    auto mc = MockTerm { PageSize { LineCount(5), ColumnCount(10) }, LineCount(100) };
+    mc.terminal.tick(chrono::steady_clock::now());
+
+    // Every other line has multiple attribute spans and is thus rendered cell-wise.
+    for (auto i = 0; i < LineCountTotal; ++i)
+        mc.writeToScreen(fmt::format(i % 2 ? "{}\033[1mL\033[m{}" : "{}L{}", i ? "\r\n" : "", i));
+
+    // Each frame takes over the lines still in view from the frame rendered into the same buffer before.
+    for (auto const offset: { 0, 1, 2, 3, 5, 4, 2, 7, 6, 0 })
+    {
+        mc.terminal.viewport().scrollTo(vtbackend::ScrollOffset(offset));
+        mc.terminal.refreshRenderBuffer();
+
+        auto const screenshot = textScreenshot(mc.terminal);
+        for (auto i = 0; i < 5; ++i)
+        {
+            INFO(fmt::format("scroll offset {}, line {}", offset, i));
+            CHECK(trimRight(screenshot.at(static_cast<size_t>(i)))
+                  == fmt::format("L{}", LineCountTotal - 5 - offset + i));
+        }
+    }
+}
+
+TEST_CASE("Terminal.RenderBufferHyperlinkHover", "[terminal]")
+{
+    using namespace vtbackend;
+    auto mc = MockTerm { PageSize { LineCount(4), ColumnCount(10) }, LineCount(10) };
+    mc.terminal.tick(chrono::steady_clock::now());
+
+    // The lines are partially rewritten, such that they are rendered cell-wise along with their hyperlinks.
+    mc.writeToScreen("X\033]8;;https://a\033\\AB\033]8;;\033\\CD\rX\r\n");
+    mc.writeToScreen("no link\rn\r\n");
+    mc.writeToScreen("X\033]8;;https://b\033\\EF\033]8;;\033\\\rX");
+
+    auto const isHovered = [&](int line) {
+        auto const renderBuffer = mc.terminal.renderBuffer();
+        for (auto const& cell: renderBuffer.get().cells)
+            if (cell.position == CellLocation { LineOffset(line), ColumnOffset(1) })
+                return cell.attributes.flags.test(CellFlag::Underline);
+        return false;
+    };
+
+    // Each frame takes over the lines not showing the hyperlink hovered before or now.
+    for (auto const line: { 1, 0, 0, 2, 1, 2 })
+    {
+        mc.terminal.sendMouseMoveEvent(
+            Modifier::None, CellLocation { LineOffset(line), ColumnOffset(1) }, PixelCoordinate {}, false);
+        for (auto i = 0; i < 4; ++i)
+        {
+            INFO(fmt::format("hovering line {}, frame {}", line, i));
+            mc.terminal.refreshRenderBuffer();
+            CHECK(isHovered(0) == (line == 0));
+            CHECK(isHovered(2) == (line == 2));
+        }
+    }
+}
+
+TEST_CASE("Terminal.HyperlinkCollection", "[terminal]")
+{
+    using namespace vtbackend;
+    auto mc = MockTerm { PageSize { LineCount(4), ColumnCount(10) }, LineCount(10) };
+
+    // Far more hyperlinks than the storage is collected at, most of them leaving the history again.
+    auto constexpr LinkCount = 3 * HyperlinkStorage::InitialCollectThreshold;
+    for (auto i = 0u; i < LinkCount; ++i)
+        mc.writeToScreen(fmt::format("\r\n\033]8;;https://{}\033\\L\033]8;;\033\\", i));
+
+    CHECK(mc.terminal.hyperlinkCount() <= HyperlinkStorage::InitialCollectThreshold);
+
+    // The hyperlinks still on the screen, or in the history, keep their targets.
+    auto const& screen = mc.terminal.primaryScreen();
+    auto const bottom = screen.hyperlinkAt(CellLocation { LineOffset(3), ColumnOffset(0) });
+    REQUIRE(bottom);
+    CHECK(bottom->uri == fmt::format("https://{}", LinkCount - 1));
+    auto const oldest = screen.hyperlinkAt(CellLocation { LineOffset(-10), ColumnOffset(0) });
+    REQUIRE(oldest);
+    CHECK(oldest->uri == fmt::format("https://{}", LinkCount - 14));
+}
+
+TEST_CASE("Terminal.PredictiveEcho", "[terminal]")
+{
+    using namespace vtbackend;
+    auto mc = MockTerm { PageSize { LineCount(2), ColumnCount(10) }, LineCount(10) };
+    mc.terminal.settings().predictiveEcho = true;
+    auto const now = chrono::steady_clock::now();
+    mc.terminal.tick(now);
+    mc.writeToScreen("$ ");
+
+    auto const predictedText = [&]() {
+        mc.terminal.refreshRenderBuffer();
+        auto const renderBuffer = mc.terminal.renderBuffer();
+        auto text = std::string {};
+        for (auto const& cell: renderBuffer.get().cells)
+        {
+            auto const codepoints = renderBuffer.get().codepointsOf(cell);
+            if (cell.attributes.flags.test(CellFlag::Underline) && !codepoints.empty())
+                text += static_cast<char>(codepoints.front());
+        }
+        return text;
+    };
+
+    mc.terminal.sendCharEvent('l', 0, Modifier::None, KeyboardEventType::Press, now);
+    mc.terminal.sendCharEvent('s', 0, Modifier::None, KeyboardEventType::Press, now);
+    CHECK(predictedText() == "ls");
+
+    // The cursor is shown past the predicted characters.
+    auto const cursor = mc.terminal.renderBuffer().get().cursor;
+    REQUIRE(cursor.has_value());
+    CHECK(cursor->position.column == ColumnOffset(4));
+
+    mc.writeToScreen("l");
+    CHECK(predictedText() == "s");
+
+    // The application's output shows otherwise.
+    mc.writeToScreen("x");
+    CHECK(predictedText().empty());
+
+    // Nothing is predicted until the next line has been entered.
+    mc.terminal.sendCharEvent('a', 0, Modifier::None, KeyboardEventType::Press, now);
+    CHECK(predictedText().empty());
+    mc.terminal.sendKeyEvent(Key::Enter, Modifier::None, KeyboardEventType::Press, now);
+    mc.writeToScreen("\r\n$ ");
+    mc.terminal.sendCharEvent('b', 0, Modifier::None, KeyboardEventType::Press, now);
+    CHECK(predictedText() == "b");
+}
+
+TEST_CASE("Terminal.IndicatorStatusLine", "[terminal]")
+{
+    auto mc = MockTerm { PageSize { LineCount(3), ColumnCount(40) }, LineCount(10) };
+    mc.terminal.tick(chrono::steady_clock::now());
+    mc.terminal.setStatusDisplay(vtbackend::StatusDisplayType::Indicator);
+
+    auto const statusLineText = [&]() {
+        auto const renderBuffer = mc.terminal.renderBuffer();
+        auto text = std::u32string(40, U' ');
+        for (auto const& cell: renderBuffer.get().cells)
+            if (cell.position.line == mc.terminal.pageSize().lines.as<LineOffset>()
+                && !renderBuffer.get().codepointsOf(cell).empty())
+                text[unbox<size_t>(cell.position.column)] = renderBuffer.get().codepointsOf(cell).front();
+        for (auto const& line: renderBuffer.get().lines)
+            if (line.lineOffset == mc.terminal.pageSize().lines.as<LineOffset>())
+                return std::string(line.text);
+        return unicode::convert_to<char>(std::u32string_view(text));
+    };
+
+    mc.terminal.refreshRenderBuffer();
+    auto const initialText = statusLineText();
+    CHECK(initialText.find("INSERT") != std::string::npos);
+
+    // An unchanged status line is taken over by the frames rendered into each of the render buffers.
+    for (auto i = 0; i < 4; ++i)
+    {
+        mc.terminal.refreshRenderBuffer();
+        CHECK(statusLineText() == initialText);
+    }
+
+    // Only the history line count changes.
+    mc.writeToScreen("A\r\nB\r\nC\r\nD");
+    for (auto i = 0; i < 4; ++i)
+    {
+        mc.terminal.refreshRenderBuffer();
+        auto const text = statusLineText();
+        CHECK(text.find("INSERT") != std::string::npos);
+        CHECK(text.find("2 │") != std::string::npos);
+    }
+}
+
+TEST_CASE("Terminal.PtyReadContinuesIntoNextBuffer", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount(20), LineCount(2) };
+    auto const firstBuffer = mc.terminal.currentPtyBuffer();
+
+    // Leaves fewer bytes in the current buffer object than the text to be read next.
+    mc.writeToScreen(std::string(firstBuffer->bytesAvailable() - 5, '\0'));
+    REQUIRE(mc.terminal.currentPtyBuffer() == firstBuffer);
+
+    // The read fills up the tail of the buffer object, rather than wasting it.
+    mc.writeToScreen("0123456789");
+    CHECK(firstBuffer->bytesAvailable() == 0);
+    CHECK(mc.terminal.currentPtyBuffer() != firstBuffer);
+    CHECK("0123456789" == trimmedTextScreenshot(mc));
+}
+
+TEST_CASE("Terminal.OSC52Clipboard", "[terminal]")
+{
+    auto mc = MockTerm { ColumnCount(20), LineCount(2) };
+    mc.writeToScreen("\033]52;c;SGVs");
+    mc.writeToScreen("bG8=\033\\");
+    CHECK(mc.clipboardData == "Hello");
+
+    // Contents exceeding the limit are rejected as a whole, rather than truncated.
+    mc.terminal.settings().maxClipboardSize = 4;
+    mc.writeToScreen("\033]52;c;V29ybGQ=\033\\ok");
+    CHECK(mc.clipboardData == "Hello");
+    CHECK("ok" == trimmedTextScreenshot(mc));
+
+    mc.writeToScreen("\033]52;c;T0s=\033\\");
+    CHECK(mc.clipboardData == "OK");
+}
+
 TEST_CASE("Terminal.TextSelection", "[terminal]")
 {
     // Create empty TE
@@ -422,3 +849,143 @@ TEST_CASE("Terminal.TextSelection", "[terminal]")
     mock.terminal.sendMouseReleaseEvent(Modifier::None, MouseButton::Left, PixelCoordinate, UiHandledHint);
     CHECK(mock.terminal.extractSelectionText().empty());
 }
+
+TEST_CASE("Terminal.ExtractSelectionTextInChunks", "[terminal]")
+{
+    using vtbackend::CellLocation;
+    using vtbackend::LinearSelection;
+
+    auto constexpr LineCountTotal = 3000;
+    auto mock = MockTerm { PageSize { LineCount(4), ColumnCount(10) }, LineCount(LineCountTotal) };
+    for (auto i = 0; i < LineCountTotal; ++i)
+        mock.writeToScreen(fmt::format("{}{} ", i ? "\r\n" : "", i));
+
+    auto const historyTop = -mock.terminal.primaryScreen().historyLineCount().as<LineOffset>();
+    mock.terminal.setSelector(std::make_unique<LinearSelection>(
+        mock.terminal.selectionHelper(), CellLocation { historyTop, ColumnOffset(0) }, []() {}));
+    (void) mock.terminal.selector()->extend(CellLocation { LineOffset(3), ColumnOffset(9) });
+
+    auto chunks = std::vector<std::string> {};
+    mock.terminal.extractSelectionText([&](std::string_view chunk) { chunks.emplace_back(chunk); });
+    CHECK(chunks.size() > 1);
+
+    auto expected = std::string {};
+    for (auto i = 0; i < LineCountTotal; ++i)
+        expected += fmt::format("{}{}", i ? "\n" : "", i);
+
+    auto text = std::string {};
+    for (auto const& chunk: chunks)
+        text += chunk;
+    CHECK(text == expected);
+    CHECK(mock.terminal.extractSelectionText() == expected);
+}
+
+TEST_CASE("Terminal.SearchHighlight", "[terminal]")
+{
+    auto mock = MockTerm { ColumnCount(10), LineCount(2) };
+    mock.writeToScreen("\033[?25lfoo barfoo\r\nfofoo");
+    mock.terminal.setNewSearchTerm(U"foo", false);
+
+    mock.terminal.tick(chrono::steady_clock::time_point());
+    mock.terminal.ensureFreshRenderBuffer();
+
+    auto const renderBuffer = mock.terminal.renderBuffer();
+    auto highlighted = std::vector<std::string>(2, std::string(10, '.'));
+    auto const plainBackground = [&]() {
+        for (auto const& cell: renderBuffer.get().cells)
+            if (cell.position.line == LineOffset(0) && cell.position.column == ColumnOffset(4))
+                return cell.attributes.backgroundColor;
+        return vtbackend::RGBColor {};
+    }();
+    for (auto const& cell: renderBuffer.get().cells)
+        if (cell.attributes.backgroundColor != plainBackground)
+            highlighted.at(cell.position.line.as<size_t>()).at(cell.position.column.as<size_t>()) = '#';
+
+    CHECK(highlighted[0] == "###....###");
+    CHECK(highlighted[1] == "..###.....");
+}
+
+TEST_CASE("Terminal.startSearch", "[terminal]")
+{
+    auto mock = MockTerm { PageSize { LineCount(3), ColumnCount(10) }, LineCount(100) };
+    mock.writeToScreen("first\r\nneedle\r\n");
+    for (auto i = 0; i < 20; ++i)
+        mock.writeToScreen("filler\r\n");
+
+    auto matches = std::promise<vtbackend::CellLocation>();
+    auto const started = mock.terminal.startSearch(
+        U"needle",
+        vtbackend::CellLocation { LineOffset(2), ColumnOffset(0) },
+        vtbackend::SearchDirection::Backward,
+        [&](vtbackend::CellLocation match) {
+            matches.set_value(match);
+            return false;
+        });
+    REQUIRE(started);
+
+    auto result = matches.get_future();
+    REQUIRE(result.wait_for(5s) == std::future_status::ready);
+    auto const match = result.get();
+    CHECK(match.column == ColumnOffset(0));
+
+    auto const _ = std::lock_guard { mock.terminal };
+    CHECK(mock.terminal.primaryScreen().grid().lineText(match.line).starts_with("needle"));
+
+    // Searching for the same term again does not start another search.
+    CHECK(!mock.terminal.startSearch(U"needle",
+                                     vtbackend::CellLocation {},
+                                     vtbackend::SearchDirection::Backward,
+                                     [](vtbackend::CellLocation) { return false; }));
+}
+
+TEST_CASE("Terminal.InputBatching", "[terminal]")
+{
+    using namespace vtbackend;
+    auto mc = MockTerm { PageSize { LineCount(2), ColumnCount(10) }, LineCount(10) };
+    auto const now = chrono::steady_clock::now();
+
+    // Without batching, each event is written on its own.
+    mc.terminal.sendCharEvent('a', 0, Modifier::None, KeyboardEventType::Press, now);
+    CHECK(mc.mockPty().stdinBuffer() == "a");
+    CHECK(mc.terminal.inputWriteStats().writes == 1);
+
+    // The events of a batch are written at once, when the host flushes them.
+    mc.terminal.setInputBatching(true);
+    mc.terminal.sendCharEvent('b', 0, Modifier::None, KeyboardEventType::Press, now);
+    mc.terminal.sendCharEvent('c', 0, Modifier::None, KeyboardEventType::Press, now);
+    mc.terminal.sendFocusInEvent(); // not reported, as focus reporting is disabled
+    CHECK(mc.mockPty().stdinBuffer() == "a");
+    CHECK(mc.inputFlushesScheduled == 1);
+
+    mc.terminal.flushInput();
+    CHECK(mc.mockPty().stdinBuffer() == "abc");
+    auto const stats = mc.terminal.inputWriteStats();
+    CHECK(stats.events == 3);
+    CHECK(stats.writes == 2);
+    CHECK(stats.bytes == 3);
+
+    // The next batch is scheduled anew.
+    mc.terminal.sendCharEvent('d', 0, Modifier::None, KeyboardEventType::Press, now);
+    CHECK(mc.inputFlushesScheduled == 2);
+}
+
+#if defined(CONTOUR_COUNT_ALLOCATIONS)
+TEST_CASE("Terminal.processInputOnce.ascii_does_not_allocate", "[terminal]")
+{
+    // The PTY read buffer is large enough to not need another one while measuring.
+    auto mock = MockTerm { PageSize { LineCount(4), ColumnCount(40) }, LineCount(10), 1024 * 1024 };
+    auto const text = "\rThe quick brown fox jumps over the lazy"sv;
+
+    // Warm up, such that the line written to is inflated and the parser's buffers are sized.
+    for (auto i = 0; i < 10; ++i)
+        mock.writeToScreen(text);
+
+    auto const before = mock.terminal.allocationStats().input.total;
+    for (auto i = 0; i < 100; ++i)
+        mock.writeToScreen(text);
+    auto const allocations = mock.terminal.allocationStats().input.total - before;
+
+    CHECK(allocations.count == 0);
+    CHECK(mock.terminal.primaryScreen().grid().lineText(LineOffset(0)) == text.substr(1));
+}
+#endif
@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/UnicodeTable.h>
+
+#include <libunicode/codepoint_properties.h>
+
+#include <algorithm>
+
+namespace vtbackend::UnicodeTable
+{
+
+namespace
+{
+    std::array<uint8_t, detail::TableSize> buildTable() noexcept
+    {
+        auto table = std::array<uint8_t, detail::TableSize> {};
+        for (char32_t codepoint = 0; codepoint < detail::TableSize; ++codepoint)
+        {
+            auto const& properties = unicode::codepoint_properties::get(codepoint);
+            auto entry = static_cast<uint8_t>(std::clamp(unicode::width(codepoint), 0, 3));
+            if (properties.emoji_presentation())
+                entry |= detail::EmojiPresentationFlag;
+            if (properties.grapheme_cluster_break == unicode::Grapheme_Cluster_Break::Undefined
+                && !properties.extended_pictographic())
+                entry |= detail::PlainGraphemeFlag;
+            table[codepoint] = entry;
+        }
+        return table;
+    }
+} // namespace
+
+namespace detail
+{
+    std::array<uint8_t, TableSize> const table = buildTable();
+}
+
+bool emojiPresentation(char32_t codepoint) noexcept
+{
+    if (codepoint < detail::TableSize)
+        return detail::table[codepoint] & detail::EmojiPresentationFlag;
+    return unicode::codepoint_properties::get(codepoint).emoji_presentation();
+}
+
+} // namespace vtbackend::UnicodeTable
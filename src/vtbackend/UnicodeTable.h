@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <libunicode/grapheme_segmenter.h>
+#include <libunicode/width.h>
+
+#include <array>
+#include <cstdint>
+
+namespace vtbackend::UnicodeTable
+{
+
+/**
+ * Flat lookup table of the codepoint properties queried for every character written to the screen,
+ * holding one byte per codepoint of the basic multilingual plane (which covers Latin, box drawing,
+ * as well as CJK), such that these are answered by a single load rather than libunicode's multi-stage
+ * property lookups. Codepoints of the astral planes are passed on to libunicode.
+ *
+ * The table is computed from libunicode at start-up, and therefore always agrees with it.
+ */
+
+namespace detail
+{
+    // Bit layout of a table entry.
+    constexpr uint8_t WidthMask = 0x03;
+    constexpr uint8_t EmojiPresentationFlag = 0x04;
+
+    // Neither of the grapheme cluster break rules but GB999 applies to this codepoint,
+    // i.e. its Grapheme_Cluster_Break property is Other and it is not Extended_Pictographic.
+    constexpr uint8_t PlainGraphemeFlag = 0x08;
+
+    constexpr char32_t TableSize = 0x10000;
+
+    extern std::array<uint8_t, TableSize> const table;
+} // namespace detail
+
+/// @returns the number of columns the given codepoint occupies, same as unicode::width().
+[[nodiscard]] inline int width(char32_t codepoint) noexcept
+{
+    if (codepoint < detail::TableSize)
+        return detail::table[codepoint] & detail::WidthMask;
+    return unicode::width(codepoint);
+}
+
+/// @returns whether the given codepoint defaults to emoji presentation (Emoji_Presentation property).
+[[nodiscard]] bool emojiPresentation(char32_t codepoint) noexcept;
+
+/// @returns whether a grapheme cluster boundary lies between the two given codepoints,
+///          same as unicode::grapheme_segmenter::breakable().
+[[nodiscard]] inline bool breakable(char32_t a, char32_t b) noexcept
+{
+    if (a < detail::TableSize && b < detail::TableSize
+        && (detail::table[a] & detail::table[b] & detail::PlainGraphemeFlag))
+        return true;
+    return unicode::grapheme_segmenter::breakable(a, b);
+}
+
+} // namespace vtbackend::UnicodeTable
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtbackend/UnicodeTable.h>
+
+#include <libunicode/grapheme_segmenter.h>
+#include <libunicode/width.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+
+namespace UnicodeTable = vtbackend::UnicodeTable;
+
+TEST_CASE("UnicodeTable.width", "[UnicodeTable]")
+{
+    // Exhaustively over the table, plus a few astral plane codepoints passed on to libunicode.
+    auto mismatches = 0;
+    for (char32_t codepoint = 0; codepoint < 0x10000; ++codepoint)
+        if (UnicodeTable::width(codepoint) != unicode::width(codepoint))
+            ++mismatches;
+    CHECK(mismatches == 0);
+
+    CHECK(UnicodeTable::width(U'A') == 1);
+    CHECK(UnicodeTable::width(0x0301) == 0); // COMBINING ACUTE ACCENT
+    CHECK(UnicodeTable::width(0x4E2D) == 2); // CJK UNIFIED IDEOGRAPH
+    CHECK(UnicodeTable::width(U'\U0001F600') == unicode::width(U'\U0001F600'));
+    CHECK(UnicodeTable::width(U'\U00020000') == unicode::width(U'\U00020000'));
+}
+
+TEST_CASE("UnicodeTable.emojiPresentation", "[UnicodeTable]")
+{
+    CHECK(!UnicodeTable::emojiPresentation(U'A'));
+    CHECK(!UnicodeTable::emojiPresentation(0x2764)); // HEAVY BLACK HEART, text by default
+    CHECK(UnicodeTable::emojiPresentation(0x231A));  // WATCH
+    CHECK(UnicodeTable::emojiPresentation(U'\U0001F600'));
+}
+
+TEST_CASE("UnicodeTable.breakable", "[UnicodeTable]")
+{
+    // Controls, Latin, combining marks, ZWJ, emoji, Hangul, Devanagari, CJK, regional indicators.
+    auto const samples = std::array<char32_t, 20> {
+        0x00,   0x09,   0x0D,   0x0A,   U'A',   U'~',    0xE9,    0x0301,  0x200D,  0x2764,
+        0xFE0F, 0xAC01, 0x1100, 0x0915, 0x094D, 0x4E2D, 0x1F1E6, 0x1F1E8, 0x1F600, 0x1F3FB,
+    };
+    for (auto const a: samples)
+        for (auto const b: samples)
+        {
+            INFO(static_cast<uint32_t>(a) << ", " << static_cast<uint32_t>(b));
+            CHECK(UnicodeTable::breakable(a, b) == unicode::grapheme_segmenter::breakable(a, b));
+        }
+}
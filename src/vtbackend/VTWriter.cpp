@@ -1,17 +1,19 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <vtbackend/VTWriter.h>
 
-#include <numeric>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 
 using std::string;
 using std::string_view;
 using std::vector;
 
+using namespace std::string_view_literals;
+
 namespace vtbackend
 {
 
-// TODO: compare with old sgr value set instead to be more generic in reusing stuff
-
 VTWriter::VTWriter(Writer writer): _writer { std::move(writer) }
 {
 }
@@ -30,6 +32,18 @@ VTWriter::VTWriter(std::vector<char>& output):
 {
 }
 
+VTWriter::VTWriter(std::string& output):
+    VTWriter { [&](char const* d, size_t n) {
+        output.append(d, n);
+    } }
+{
+}
+
+VTWriter::~VTWriter()
+{
+    flush();
+}
+
 void VTWriter::write(char32_t v)
 {
     sgrFlush();
@@ -42,46 +56,68 @@ void VTWriter::write(char32_t v)
 void VTWriter::write(string_view s)
 {
     sgrFlush();
-    _writer(s.data(), s.size());
+    writeRaw(s);
 }
 
-void VTWriter::sgrFlush()
+void VTWriter::writeRaw(string_view s)
 {
-    if (_sgr.empty())
-        return;
+    if (s.size() > _buffer.size() - _bufferSize)
+    {
+        _writer(_buffer.data(), _bufferSize);
+        _bufferSize = 0;
+    }
 
-    auto const f = sgrFlush(_sgr);
-    if (_sgr != _lastSGR)
-        _writer(f.data(), f.size());
+    if (s.size() >= _buffer.size())
+    {
+        _writer(s.data(), s.size());
+        return;
+    }
 
-    sgrRewind();
+    std::memcpy(_buffer.data() + _bufferSize, s.data(), s.size());
+    _bufferSize += s.size();
 }
 
-string VTWriter::sgrFlush(vector<unsigned> const& sgr)
+void VTWriter::flush()
 {
-    if (sgr.empty())
-        return "";
+    sgrFlush();
+    if (_bufferSize == 0)
+        return;
 
-    auto const params =
-        sgr.size() != 1 || sgr[0] != 0 ? accumulate(
-            begin(sgr),
-            end(sgr),
-            string {},
-            [](auto a, auto b) { return a.empty() ? fmt::format("{}", b) : fmt::format("{};{}", a, b); })
-                                       : string();
+    _writer(_buffer.data(), _bufferSize);
+    _bufferSize = 0;
+}
 
-    return fmt::format("\033[{}m", params);
+void VTWriter::resetGraphicsRendition()
+{
+    if (_currentBold || !isDefaultColor(_currentForegroundColor) || !isDefaultColor(_currentBackgroundColor)
+        || !isDefaultColor(_currentUnderlineColor))
+        sgrAdd(0);
 }
 
-void VTWriter::sgrAddExplicit(unsigned n)
+void VTWriter::sgrFlush()
 {
-    if (n == 0)
+    if (_sgr.empty())
+        return;
+
+    writeRaw("\033["sv);
+    if (_sgr.size() != 1 || _sgr[0] != 0)
     {
-        _currentForegroundColor = DefaultColor();
-        _currentBackgroundColor = DefaultColor();
-        _currentUnderlineColor = DefaultColor();
+        for (size_t i = 0; i < _sgr.size(); ++i)
+        {
+            char buf[12];
+            buf[0] = ';';
+            auto const* const end = std::to_chars(buf + 1, buf + sizeof(buf), _sgr[i]).ptr;
+            auto const* const begin = i == 0 ? buf + 1 : buf;
+            writeRaw(string_view(begin, static_cast<size_t>(end - begin)));
+        }
     }
+    writeRaw("m"sv);
 
+    sgrRewind();
+}
+
+void VTWriter::sgrAddExplicit(unsigned n)
+{
     _sgr.push_back(n);
 }
 
@@ -89,27 +125,23 @@ void VTWriter::sgrAdd(unsigned n)
 {
     if (n == 0)
     {
+        // Supersedes whatever is pending.
         _sgr.clear();
         _sgr.push_back(n);
+        _currentBold = false;
         _currentForegroundColor = DefaultColor();
         _currentBackgroundColor = DefaultColor();
         _currentUnderlineColor = DefaultColor();
+        return;
     }
-    else
-    {
-        if (_sgr.empty() || _sgr.back() != n)
-            _sgr.push_back(n);
 
-        if (_sgr.size() == MaxParameterCount)
-        {
-            sgrFlush();
-        }
-    }
+    _sgr.push_back(n);
+    if (_sgr.size() == MaxParameterCount)
+        sgrFlush();
 }
 
 void VTWriter::sgrRewind()
 {
-    swap(_lastSGR, _sgr);
     _sgr.clear();
 }
 
@@ -118,10 +150,19 @@ void VTWriter::sgrAdd(GraphicsRendition m)
     sgrAdd(static_cast<unsigned>(m));
 }
 
+void VTWriter::setBold(bool bold)
+{
+    if (bold == _currentBold)
+        return;
+
+    _currentBold = bold;
+    sgrAdd(bold ? GraphicsRendition::Bold : GraphicsRendition::Normal);
+}
+
 void VTWriter::setForegroundColor(Color color)
 {
-    // if (color == _currentForegroundColor)
-    //     return;
+    if (color == _currentForegroundColor)
+        return;
 
     _currentForegroundColor = color;
     switch (color.type())
@@ -153,8 +194,8 @@ void VTWriter::setForegroundColor(Color color)
 
 void VTWriter::setBackgroundColor(Color color)
 {
-    // if (color == _currentBackgroundColor)
-    //     return;
+    if (color == _currentBackgroundColor)
+        return;
 
     _currentBackgroundColor = color;
     switch (color.type())
@@ -164,22 +205,18 @@ void VTWriter::setBackgroundColor(Color color)
             if (static_cast<unsigned>(color.index()) < 8)
                 sgrAdd(40 + static_cast<unsigned>(color.index()));
             else
-            {
-                sgrAdd(48);
-                sgrAdd(5);
-                sgrAdd(static_cast<unsigned>(color.index()));
-            }
+                sgrAdd(48, 5, static_cast<unsigned>(color.index()));
             break;
         case ColorType::Bright:
             //.
             sgrAdd(100 + static_cast<unsigned>(getBrightColor(color)));
             break;
         case ColorType::RGB:
-            sgrAdd(48);
-            sgrAdd(2);
-            sgrAdd(static_cast<unsigned>(color.rgb().red));
-            sgrAdd(static_cast<unsigned>(color.rgb().green));
-            sgrAdd(static_cast<unsigned>(color.rgb().blue));
+            // clang-format off
+            sgrAdd(48, 2, static_cast<unsigned>(color.rgb().red),
+                          static_cast<unsigned>(color.rgb().green),
+                          static_cast<unsigned>(color.rgb().blue));
+            // clang-format on
             break;
         case ColorType::Undefined:
             //.
@@ -193,33 +230,51 @@ void VTWriter::write(Line<Cell> const& line)
     if (line.isTrivialBuffer())
     {
         TrivialLineBuffer const& lineBuffer = line.trivialBuffer();
-        setForegroundColor(lineBuffer.textAttributes.foregroundColor);
-        setBackgroundColor(lineBuffer.textAttributes.backgroundColor);
         // TODO: hyperlinks, underlineColor and other flags (curly underline etc.)
-        write(line.toUtf8());
-        // TODO: Write fill columns.
+        lineBuffer.forEachRun([this](ColumnOffset /*start*/,
+                                     std::string_view text,
+                                     GraphicsAttributes const& attributes,
+                                     HyperlinkId /*hyperlink*/) {
+            setBold(static_cast<bool>(attributes.flags & CellFlag::Bold));
+            setForegroundColor(attributes.foregroundColor);
+            setBackgroundColor(attributes.backgroundColor);
+            write(text);
+        });
+
+        // The fill columns are written only if they are visible.
+        if (lineBuffer.usedColumns < lineBuffer.displayWidth
+            && !isDefaultColor(lineBuffer.fillAttributes.backgroundColor))
+        {
+            setBackgroundColor(lineBuffer.fillAttributes.backgroundColor);
+            write(std::string(unbox<size_t>(lineBuffer.displayWidth - lineBuffer.usedColumns), ' '));
+        }
     }
     else
     {
-        for (Cell const& cell: line.inflatedBuffer())
-        {
-            if (cell.flags() & CellFlag::Bold)
-                sgrAdd(GraphicsRendition::Bold);
-            else
-                sgrAdd(GraphicsRendition::Normal);
+        auto const& cells = line.inflatedBuffer();
 
+        auto end = cells.size();
+        while (end > 0 && cells[end - 1].empty() && isDefaultColor(cells[end - 1].backgroundColor()))
+            --end;
+
+        for (size_t i = 0; i < end; ++i)
+        {
+            Cell const& cell = cells[i];
+            setBold(static_cast<bool>(cell.flags() & CellFlag::Bold));
             setForegroundColor(cell.foregroundColor());
             setBackgroundColor(cell.backgroundColor());
             // TODO: other flags (such as underline), hyperlinks, image fragments.
 
             if (!cell.codepointCount())
-                write(' ');
+                write(" "sv);
             else
+            {
                 write(cell.toUtf8());
+                // Skips the cells covered by a wide character.
+                i += static_cast<size_t>(std::max(static_cast<int>(cell.width()), 1) - 1);
+            }
         }
     }
-
-    sgrAdd(GraphicsRendition::Reset);
 }
 
 } // namespace vtbackend
@@ -229,3 +284,6 @@ template void vtbackend::VTWriter::write<vtbackend::CompactCell>(Line<CompactCel
 
 #include <vtbackend/cell/SimpleCell.h>
 template void vtbackend::VTWriter::write<vtbackend::SimpleCell>(Line<SimpleCell> const&);
+
+#include <vtbackend/cell/FlatCell.h>
+template void vtbackend::VTWriter::write<vtbackend::FlatCell>(Line<FlatCell> const&);
@@ -9,29 +9,46 @@
 
 #include <fmt/format.h>
 
+#include <array>
 #include <functional>
 #include <ostream>
-#include <sstream>
+#include <string>
 #include <vector>
 
 namespace vtbackend
 {
 
 // Serializes text and SGR attributes into a valid VT stream.
+//
+// The output is collected in a fixed-size buffer and passed on to the writer whenever that is full,
+// or when flushed (at the latest when destroyed).
+//
+// The SGR state written is tracked across lines, so that only what changes is written.
 class VTWriter
 {
   public:
     using Writer = std::function<void(char const*, size_t)>;
 
     static constexpr inline auto MaxParameterCount = 16;
+    static constexpr inline size_t BufferSize = 4096;
 
     explicit VTWriter(Writer writer);
     explicit VTWriter(std::ostream& output);
     explicit VTWriter(std::vector<char>& output);
+    explicit VTWriter(std::string& output);
+
+    VTWriter(VTWriter const&) = delete;
+    VTWriter(VTWriter&&) = delete;
+    VTWriter& operator=(VTWriter const&) = delete;
+    VTWriter& operator=(VTWriter&&) = delete;
+    ~VTWriter();
 
     void crlf();
 
-    // Writes the given Line<> to the output stream without the trailing newline.
+    // Writes the given Line<> to the output stream without the trailing newline,
+    // and without trailing blank cells of the default background color.
+    //
+    // The line's last graphics rendition stays in effect.
     template <typename Cell>
     void write(Line<Cell> const& line);
 
@@ -40,10 +57,17 @@ class VTWriter
     void write(std::string_view s);
     void write(char32_t v);
 
+    /// Passes everything written so far on to the writer.
+    void flush();
+
+    /// Resets the graphics rendition, unless it is the default one already.
+    void resetGraphicsRendition();
+
     void sgrFlush();
     void sgrAdd(unsigned n);
     void sgrRewind();
     void sgrAdd(GraphicsRendition m);
+    void setBold(bool bold);
     void setForegroundColor(Color color);
     void setBackgroundColor(Color color);
 
@@ -60,12 +84,14 @@ class VTWriter
     }
 
   private:
-    static std::string sgrFlush(std::vector<unsigned> const& sgr);
+    void writeRaw(std::string_view s);
 
     Writer _writer;
+    std::array<char, BufferSize> _buffer {};
+    size_t _bufferSize = 0;
+
     std::vector<unsigned> _sgr;
-    std::stringstream _sstr;
-    std::vector<unsigned> _lastSGR;
+    bool _currentBold = false;
     Color _currentForegroundColor = DefaultColor();
     Color _currentUnderlineColor = DefaultColor();
     Color _currentBackgroundColor = DefaultColor();
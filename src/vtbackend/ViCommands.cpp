@@ -9,6 +9,7 @@
 #include <fmt/format.h>
 
 #include <memory>
+#include <utility>
 
 namespace vtbackend
 {
@@ -75,13 +76,13 @@ namespace
             return WordSkipClass::Other;
     }
 
-    WordSkipClass wordSkipClass(std::string text) noexcept
+    // Classifies a cell by its leading codepoint and codepoint count, see ScreenBase::leadingCodepointAt().
+    constexpr WordSkipClass wordSkipClass(std::pair<char32_t, size_t> cell) noexcept
     {
-        auto const s32 = unicode::convert_to<char32_t>(std::string_view(text.data(), text.size()));
-        switch (s32.size())
+        switch (cell.second)
         {
             case 0: return WordSkipClass::Whitespace;
-            case 1: return wordSkipClass(s32[0]);
+            case 1: return wordSkipClass(cell.first);
             default: return WordSkipClass::Other;
         }
     }
@@ -188,7 +189,7 @@ void ViCommands::searchDone()
 
 void ViCommands::searchCancel()
 {
-    _terminal->state().searchMode.pattern.clear();
+    _terminal->clearSearch();
     _terminal->screenUpdated();
 }
 
@@ -238,8 +239,11 @@ bool ViCommands::jumpToPreviousMatch(unsigned count)
 
 void ViCommands::updateSearchTerm(std::u32string const& text)
 {
-    if (auto const newLocation = _terminal->searchReverse(text, cursorPosition))
-        moveCursorTo(newLocation.value());
+    // Searching a large history takes a while, which must not stall the terminal while typing.
+    _terminal->startSearch(text, cursorPosition, SearchDirection::Backward, [this](CellLocation match) {
+        moveCursorTo(match);
+        return false;
+    });
 }
 
 void ViCommands::modeChanged(ViMode mode)
@@ -307,7 +311,7 @@ void ViCommands::reverseSearchCurrentWord()
     assert(range.contains(cursorPosition));
     cursorPosition = range.first;
 
-    updateSearchTerm(wordUnderCursor);
+    _terminal->setNewSearchTerm(wordUnderCursor, false);
     jumpToPreviousMatch(1);
 }
 
@@ -318,12 +322,18 @@ void ViCommands::toggleLineMark()
         cursorPosition.line, LineFlag::Marked, !(currentLineFlags & LineFlag::Marked));
 }
 
+void ViCommands::toggleCommandOutputFold()
+{
+    if (auto const promptLine = _terminal->toggleCommandOutputFold(cursorPosition.line))
+        moveCursorTo(CellLocation { *promptLine, ColumnOffset(0) });
+}
+
 void ViCommands::searchCurrentWord()
 {
     auto const [wordUnderCursor, range] = _terminal->extractWordUnderCursor(cursorPosition);
     assert(range.contains(cursorPosition));
     cursorPosition = range.second;
-    updateSearchTerm(wordUnderCursor);
+    _terminal->setNewSearchTerm(wordUnderCursor, false);
     jumpToNextMatch(1);
 }
 
@@ -702,15 +712,17 @@ CellLocation ViCommands::findBeginOfWordAt(CellLocation location, JumpOver jumpO
 
     auto current = location;
     auto leftLocation = prev(current);
-    auto leftClass = wordSkipClass(_terminal->currentScreen().cellTextAt(leftLocation));
-    auto continuationClass =
-        jumpOver == JumpOver::Yes ? leftClass : wordSkipClass(_terminal->currentScreen().cellTextAt(current));
+    auto const classAt = [&](CellLocation position) {
+        return wordSkipClass(_terminal->currentScreen().leadingCodepointAt(position));
+    };
+    auto leftClass = classAt(leftLocation);
+    auto continuationClass = jumpOver == JumpOver::Yes ? leftClass : classAt(current);
 
     while (current != firstAddressableLocation && leftClass == continuationClass)
     {
         current = leftLocation;
         leftLocation = prev(current);
-        leftClass = wordSkipClass(_terminal->currentScreen().cellTextAt(leftLocation));
+        leftClass = classAt(leftLocation);
         if (continuationClass == WordSkipClass::Whitespace && leftClass != WordSkipClass::Whitespace)
             continuationClass = leftClass;
     }
@@ -930,6 +942,36 @@ CellLocation ViCommands::translateToCellLocation(ViMotion motion, unsigned count
             }
             return result;
         }
+        case ViMotion::FailedCommandUp: // [f
+        {
+            if (!_terminal->isPrimaryScreen())
+                return cursorPosition;
+            auto result = CellLocation { cursorPosition.line, ColumnOffset(0) };
+            for (; count > 0; --count)
+            {
+                auto const line = _terminal->primaryScreen().grid().findFailedCommandAbove(result.line);
+                if (!line)
+                    break;
+                result.line = *line;
+            }
+            return result;
+        }
+        case ViMotion::FailedCommandDown: // ]f
+        {
+            if (!_terminal->isPrimaryScreen())
+                return cursorPosition;
+            auto const pageBottom = _terminal->pageSize().lines.as<LineOffset>() - 1;
+            auto result = CellLocation { cursorPosition.line, ColumnOffset(0) };
+            for (; count > 0; --count)
+            {
+                auto const line =
+                    _terminal->primaryScreen().grid().findFailedCommandBelow(result.line, pageBottom);
+                if (!line)
+                    break;
+                result.line = *line;
+            }
+            return result;
+        }
         case ViMotion::ParagraphForward: // }
         {
             auto const pageBottom = _terminal->pageSize().lines.as<LineOffset>() - 1;
@@ -1046,14 +1088,16 @@ CellLocation ViCommands::translateToCellLocation(ViMotion motion, unsigned count
             auto const lastAddressableLocation =
                 CellLocation { LineOffset::cast_from(_terminal->pageSize().lines - 1),
                                ColumnOffset::cast_from(_terminal->pageSize().columns - 1) };
+            auto const classAt = [&](CellLocation position) {
+                return wordSkipClass(_terminal->currentScreen().leadingCodepointAt(position));
+            };
             auto result = cursorPosition;
             while (count > 0)
             {
-                auto initialClass = wordSkipClass(_terminal->currentScreen().cellTextAt(result));
+                auto initialClass = classAt(result);
                 result = next(result);
                 while (result != lastAddressableLocation
-                       && shouldSkipForUntilWordBegin(
-                           wordSkipClass(_terminal->currentScreen().cellTextAt(result)), initialClass))
+                       && shouldSkipForUntilWordBegin(classAt(result), initialClass))
                     result = next(result);
                 --count;
             }
@@ -30,6 +30,7 @@ class ViCommands: public ViInputHandler::Executor
     void modeChanged(ViMode mode) override;
     void reverseSearchCurrentWord() override;
     void toggleLineMark() override;
+    void toggleCommandOutputFold() override;
     void searchCurrentWord() override;
     void execute(ViOperator op, ViMotion motion, unsigned count, char32_t lastChar = U'\0') override;
     void moveCursor(ViMotion motion, unsigned count, char32_t lastChar = U'\0') override;
@@ -71,7 +71,7 @@ void ViInputHandler::registerAllCommands()
         std::array<std::pair<char, TextObjectScope>, 2> { { std::pair { 'i', TextObjectScope::Inner },
                                                             std::pair { 'a', TextObjectScope::A } } };
 
-    auto constexpr MotionMappings = std::array<std::pair<std::string_view, ViMotion>, 43> { {
+    auto constexpr MotionMappings = std::array<std::pair<std::string_view, ViMotion>, 45> { {
         // clang-format off
         { "$", ViMotion::LineEnd },
         { "%", ViMotion::ParenthesisMatching },
@@ -99,9 +99,11 @@ void ViInputHandler::registerAllCommands()
         { "W", ViMotion::BigWordForward },
         { "[[", ViMotion::GlobalCurlyOpenUp },
         { "[]", ViMotion::GlobalCurlyCloseUp },
+        { "[f", ViMotion::FailedCommandUp },
         { "[m", ViMotion::LineMarkUp },
         { "][", ViMotion::GlobalCurlyCloseDown },
         { "]]", ViMotion::GlobalCurlyOpenDown },
+        { "]f", ViMotion::FailedCommandDown },
         { "]m", ViMotion::LineMarkDown },
         { "^", ViMotion::LineTextBegin },
         { "b", ViMotion::WordBackward },
@@ -169,6 +171,7 @@ void ViInputHandler::registerAllCommands()
     registerCommand(ModeSelect::Normal, "/", [this]() { startSearch(); });
     registerCommand(ModeSelect::Normal, "#", [this]() { _executor->reverseSearchCurrentWord(); });
     registerCommand(ModeSelect::Normal, "mm", [this]() { _executor->toggleLineMark(); });
+    registerCommand(ModeSelect::Normal, "za", [this]() { _executor->toggleCommandOutputFold(); });
     registerCommand(ModeSelect::Normal, "*", [this]() { _executor->searchCurrentWord(); });
     registerCommand(ModeSelect::Normal, "p", [this]() { _executor->paste(count(), false); });
     registerCommand(ModeSelect::Normal, "P", [this]() { _executor->paste(count(), true); });
@@ -84,6 +84,8 @@ enum class ViMotion
     GlobalCurlyOpenDown,   // ]]
     LineMarkUp,            // [m
     LineMarkDown,          // ]m
+    FailedCommandUp,       // [f
+    FailedCommandDown,     // ]f
     ParenthesisMatching,   // %
     SearchResultBackward,  // N
     SearchResultForward,   // n
@@ -181,6 +183,9 @@ class ViInputHandler: public InputHandler
         // Toggle line mark (see LineFlags::Flagged).
         virtual void toggleLineMark() = 0;
 
+        // Folds (or unfolds) the output of the shell command at the cursor.
+        virtual void toggleCommandOutputFold() = 0;
+
         // Similar to reverse search, but searching forward.
         virtual void searchCurrentWord() = 0;
     };
@@ -368,6 +373,8 @@ struct fmt::formatter<vtbackend::ViMotion>: formatter<std::string_view>
             case ViMotion::GlobalCurlyOpenDown: name = "GlobalCurlyOpenDown"; break;
             case ViMotion::LineMarkUp: name = "LineMarkUp"; break;
             case ViMotion::LineMarkDown: name = "LineMarkDown"; break;
+            case ViMotion::FailedCommandUp: name = "FailedCommandUp"; break;
+            case ViMotion::FailedCommandDown: name = "FailedCommandDown"; break;
         }
         return formatter<string_view>::format(name, ctx);
     }
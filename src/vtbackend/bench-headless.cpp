@@ -1,75 +1,1199 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <vtbackend/MockTerm.h>
+#include <vtbackend/SessionRecorder.h>
 #include <vtbackend/Terminal.h>
 #include <vtbackend/cell/CellConfig.h>
 #include <vtbackend/logging.h>
 
+#include <vtrasterizer/RenderResources.h>
+#include <vtrasterizer/RenderStats.h>
+#include <vtrasterizer/RenderTarget.h>
+#include <vtrasterizer/Renderer.h>
+#include <vtrasterizer/SoftwareRenderTarget.h>
+
 #include <vtpty/MockViewPty.h>
+#include <vtpty/Process.h>
+#include <vtpty/Pty.h>
+
+#if !defined(_WIN32)
+    #include <vtpty/UnixPty.h>
+
+    #include <sys/resource.h>
+
+    #include <termios.h>
+    #include <unistd.h>
+#endif
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    #include <malloc.h>
+    #define BENCH_HEADLESS_HAVE_MALLINFO2
+#endif
 
 #include <crispy/App.h>
 #include <crispy/BufferObject.h>
 #include <crispy/CLI.h>
+#include <crispy/allocation_counter.h>
+#include <crispy/thread_pool.h>
 #include <crispy/utils.h>
 
 #include <fmt/format.h>
 
+#include <libunicode/convert.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <optional>
+#include <sstream>
 #include <thread>
+#include <vector>
 
 #include <libtermbench/termbench.h>
 
-using namespace std;
+using namespace std;
+
+#if !defined(CONTOUR_BUILD_WITH_MIMALLOC) && !defined(CONTOUR_COUNT_ALLOCATIONS)
+namespace
+{
+std::atomic<uint64_t> allocationCount = 0;
+}
+
+// Counts the allocations made while benchmarking, unless the allocator is replaced already,
+// or counted by crispy (which also counts the bytes requested).
+void* operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+#endif
+
+namespace
+{
+
+/// @returns the number of allocations made so far, if counted.
+std::optional<uint64_t> allocations() noexcept
+{
+#if defined(CONTOUR_COUNT_ALLOCATIONS)
+    return crispy::process_allocations().count;
+#elif !defined(CONTOUR_BUILD_WITH_MIMALLOC)
+    return allocationCount.load(std::memory_order_relaxed);
+#else
+    return std::nullopt;
+#endif
+}
+
+/// @returns the current resident set size of the process in bytes, if known.
+std::optional<uint64_t> residentSetSize()
+{
+#if defined(__linux__)
+    auto statm = std::ifstream("/proc/self/statm");
+    auto pages = uint64_t { 0 };
+    auto residentPages = uint64_t { 0 };
+    if (!(statm >> pages >> residentPages))
+        return std::nullopt;
+    return residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#else
+    return std::nullopt;
+#endif
+}
+
+/// Heap usage as reported by the allocator.
+struct HeapUsage
+{
+    size_t inUse = 0;    // allocated by the application
+    size_t reserved = 0; // obtained from the system
+};
+
+std::optional<HeapUsage> heapUsage() noexcept
+{
+#if defined(BENCH_HEADLESS_HAVE_MALLINFO2)
+    auto const info = mallinfo2();
+    return HeapUsage { info.uordblks + info.hblkhd, info.arena + info.hblkhd };
+#else
+    return std::nullopt;
+#endif
+}
+
+/// @returns the peak resident set size of the process in bytes, if known.
+std::optional<uint64_t> peakResidentSetSize() noexcept
+{
+#if !defined(_WIN32)
+    auto usage = rusage {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return std::nullopt;
+    #if defined(__APPLE__)
+    return static_cast<uint64_t>(usage.ru_maxrss);
+    #else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+    #endif
+#else
+    return std::nullopt;
+#endif
+}
+
+std::string createText(size_t bytes)
+{
+    std::string text;
+    while (text.size() < bytes)
+    {
+        text += char('A' + (rand() % 26));
+        if ((text.size() % 65) == 0)
+            text += '\n';
+    }
+    return text;
+}
+
+std::optional<std::string> readFile(std::string const& path)
+{
+    auto file = std::ifstream(path, std::ios::binary);
+    if (!file.good())
+        return std::nullopt;
+    auto contents = std::stringstream {};
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+/// Reads the PTY output recorded in @p path, either by a SessionRecorder or as raw bytes.
+std::optional<std::string> readRecording(std::string const& path)
+{
+    auto contents = readFile(path);
+    if (!contents)
+        return std::nullopt;
+    auto const recording = vtbackend::decodeRecording(*contents);
+    if (!recording)
+        return contents;
+    auto output = std::string {};
+    for (auto const& event: recording->events)
+        output += event.output;
+    return output;
+}
+
+/// Parser events listener that just counts the VT sequences being parsed.
+class SequenceCounter: public vtparser::NullParserEvents
+{
+  public:
+    uint64_t sequences = 0;
+    uint64_t textRuns = 0;
+
+    void print(char32_t) override { ++textRuns; }
+    size_t print(std::string_view, size_t) override
+    {
+        ++textRuns;
+        return 0;
+    }
+    void execute(char) override { ++sequences; }
+    void dispatchESC(char) override { ++sequences; }
+    void dispatchCSI(char) override { ++sequences; }
+    void dispatchOSC() override { ++sequences; }
+    void hook(char) override { ++sequences; }
+    void dispatchAPC() override { ++sequences; }
+    void dispatchPM() override { ++sequences; }
+};
+
+template <typename F>
+std::chrono::nanoseconds measure(F&& f)
+{
+    auto const start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::steady_clock::now() - start;
+}
+
+long double perSecond(long double amount, std::chrono::nanoseconds duration)
+{
+    auto const secs = std::chrono::duration<long double>(duration).count();
+    return secs > 0 ? amount / secs : 0;
+}
+
+std::string formatDuration(std::chrono::nanoseconds duration)
+{
+    auto const msecs = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    return fmt::format("{}.{:03} ms", msecs / 1000, msecs % 1000);
+}
+
+/// Writes @p json to the file at @p path, or to stdout if @p path is "-".
+bool writeJson(std::string const& path, std::string const& json)
+{
+    if (path == "-")
+        cout << '\n' << json;
+    else if (auto file = std::ofstream(path); file.good())
+        file << json;
+    else
+    {
+        cerr << fmt::format("Could not write JSON results to: {}\n", path);
+        return false;
+    }
+    return true;
+}
+
+std::string jsonNumber(std::optional<uint64_t> value)
+{
+    return value ? std::to_string(*value) : "null"s;
+}
+
+/// @returns the value of @p key within the flat JSON object @p object, without any quotes,
+///          as written by baseBenchmark().
+std::optional<std::string_view> jsonValue(std::string_view object, std::string_view key)
+{
+    auto const needle = fmt::format("\"{}\":", key);
+    auto const keyStart = object.find(needle);
+    if (keyStart == std::string_view::npos)
+        return std::nullopt;
+    auto value = object.substr(keyStart + needle.size());
+    value.remove_prefix(std::min(value.size(), value.find_first_not_of(' ')));
+    if (value.starts_with('"'))
+    {
+        value.remove_prefix(1);
+        return value.substr(0, value.find('"'));
+    }
+    return value.substr(0, value.find_first_of(",}"));
+}
+
+/// Measures the raw cell access patterns of the grid (writing styled text, and reading back the text
+/// as well as the background colors, as done when rendering) for the given cell type.
+template <typename Cell>
+void benchCells(std::string_view name, size_t cellCount)
+{
+    auto constexpr Passes = 16;
+    auto cells = std::vector<Cell>(cellCount);
+    auto const plain = vtbackend::GraphicsAttributes {};
+    auto styled = vtbackend::GraphicsAttributes {};
+    styled.foregroundColor = vtbackend::Color::Indexed(vtbackend::IndexedColor::Red);
+    styled.backgroundColor = vtbackend::Color::Indexed(vtbackend::IndexedColor::Blue);
+    styled.flags = vtbackend::CellFlag::Bold;
+
+    auto const writeTime = measure([&]() {
+        for (auto pass = 0; pass < Passes; ++pass)
+            for (size_t i = 0; i < cells.size(); ++i)
+                cells[i].write(i % 8 < 3 ? styled : plain, char32_t('A' + (i + pass) % 26), 1);
+    });
+
+    auto checksum = uint64_t { 0 };
+    auto const textTime = measure([&]() {
+        for (auto pass = 0; pass < Passes; ++pass)
+            for (auto const& cell: cells)
+                checksum += cell.codepoint(0) + cell.width();
+    });
+
+    auto const colorTime = measure([&]() {
+        for (auto pass = 0; pass < Passes; ++pass)
+            for (auto const& cell: cells)
+                checksum += cell.backgroundColor() != vtbackend::DefaultColor()
+                            || cell.isFlagEnabled(vtbackend::CellFlag::Bold);
+    });
+
+    auto const totalCells = static_cast<long double>(cellCount * Passes);
+    cout << fmt::format("{:>22}: {} bytes per cell (checksum {})\n", name, sizeof(Cell), checksum);
+    cout << fmt::format("{:>22}: {} ({:.2f} MCells/s)\n",
+                        "write styled",
+                        formatDuration(writeTime),
+                        static_cast<double>(perSecond(totalCells, writeTime) / 1e6));
+    cout << fmt::format("{:>22}: {} ({:.2f} MCells/s)\n",
+                        "read text",
+                        formatDuration(textTime),
+                        static_cast<double>(perSecond(totalCells, textTime) / 1e6));
+    cout << fmt::format("{:>22}: {} ({:.2f} MCells/s)\n\n",
+                        "read colors",
+                        formatDuration(colorTime),
+                        static_cast<double>(perSecond(totalCells, colorTime) / 1e6));
+}
+
+/// Parses a comma separated list of positive numbers, each multiplied by @p unit.
+std::vector<size_t> parseSizes(std::string_view list, size_t unit)
+{
+    auto sizes = std::vector<size_t> {};
+    for (auto const item: crispy::split(list, ','))
+        if (auto const value = crispy::to_integer<10, size_t>(item); value && *value)
+            sizes.push_back(*value * unit);
+    return sizes;
+}
+
+/// One configuration of the PTY benchmark matrix.
+struct PtyBenchConfig
+{
+    size_t readSize;
+    size_t bufferObjectSize;
+    bool stdoutFastPipe;
+    unsigned sessions;
+};
+
+struct PtyBenchResult
+{
+    PtyBenchConfig config;
+    uint64_t bytes = 0;
+    std::chrono::nanoseconds elapsed {};
+    std::vector<std::chrono::nanoseconds> latencies; // of all sessions, sorted
+};
+
+std::chrono::nanoseconds percentile(std::vector<std::chrono::nanoseconds> const& sorted, double p)
+{
+    if (sorted.empty())
+        return {};
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())))];
+}
+
+/// A terminal reading and parsing the output written to a real PTY, i.e. the production read path.
+///
+/// The output is interleaved with probes, window titles carrying increasing numbers, which tell
+/// when processInputOnce() has seen all output written up to them.
+class PtyBenchSession: public vtbackend::Terminal::NullEvents
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    explicit PtyBenchSession(PtyBenchConfig const& config):
+        _stdoutFastPipe { config.stdoutFastPipe },
+        _terminal { *this,
+                    createStartedPty(),
+                    [&]() {
+                        auto settings = vtbackend::Settings {};
+                        settings.pageSize = vtbackend::PageSize { vtbackend::LineCount(25),
+                                                                  vtbackend::ColumnCount(80) };
+                        settings.maxHistoryLineCount = vtbackend::LineCount(4000);
+                        settings.ptyReadBufferSize = config.readSize;
+                        settings.ptyBufferObjectSize = config.bufferObjectSize;
+                        return settings;
+                    }(),
+                    clock::now() }
+    {
+        (void) _terminal.device().slave().configure();
+        _reader = std::thread { [this]() {
+            while (!_done && _terminal.processInputOnce())
+                ;
+        } };
+    }
+
+    PtyBenchSession(PtyBenchSession const&) = delete;
+    PtyBenchSession& operator=(PtyBenchSession const&) = delete;
+    PtyBenchSession(PtyBenchSession&&) = delete;
+    PtyBenchSession& operator=(PtyBenchSession&&) = delete;
+
+    ~PtyBenchSession() override
+    {
+        _done = true;
+        _terminal.device().close();
+        _reader.join();
+    }
+
+    /// Writes @p data as the child process would, to the PTY slave or the stdout fastpipe.
+    bool write(std::string_view data)
+    {
+        while (!data.empty())
+        {
+            auto const rv = writeSome(data);
+            if (rv <= 0)
+                return false;
+            data.remove_prefix(static_cast<size_t>(rv));
+        }
+        return true;
+    }
+
+    /// Writes a probe and waits for it to be seen by the terminal.
+    ///
+    /// @returns the time it has been seen, or nothing on timeout.
+    std::optional<clock::time_point> probe()
+    {
+        auto const id = ++_lastProbe;
+        if (!write(fmt::format("\033]2;{}\007", id)))
+            return std::nullopt;
+
+        auto lock = std::unique_lock { _probeMutex };
+        if (!_probeSeen.wait_for(lock, std::chrono::seconds(5), [&]() { return _seenProbe >= id; }))
+            return std::nullopt;
+        return _seenAt;
+    }
+
+    void setWindowTitle(std::string_view title) override
+    {
+        auto const id = crispy::to_integer<10, uint64_t>(title);
+        if (!id)
+            return;
+        auto const _ = std::lock_guard { _probeMutex };
+        _seenProbe = *id;
+        _seenAt = clock::now();
+        _probeSeen.notify_all();
+    }
+
+  private:
+    static std::unique_ptr<vtpty::Pty> createStartedPty()
+    {
+        auto pty =
+            vtpty::createPty(vtpty::PageSize { vtpty::LineCount(25), vtpty::ColumnCount(80) }, std::nullopt);
+        pty->start();
+        return pty;
+    }
+
+    [[nodiscard]] long writeSome(std::string_view data)
+    {
+#if !defined(_WIN32)
+        if (_stdoutFastPipe)
+            if (auto* unixPty = dynamic_cast<vtpty::UnixPty*>(&_terminal.device()))
+            {
+                auto const fd = unixPty->stdoutFastPipe().writer();
+                return static_cast<long>(::write(fd, data.data(), data.size()));
+            }
+#endif
+        return _terminal.device().slave().write(data);
+    }
+
+    bool _stdoutFastPipe;
+    vtbackend::Terminal _terminal;
+    std::atomic<bool> _done = false;
+    std::thread _reader;
+
+    uint64_t _lastProbe = 0;
+    std::mutex _probeMutex;
+    std::condition_variable _probeSeen;
+    uint64_t _seenProbe = 0;
+    clock::time_point _seenAt {};
+};
+
+/// Measures the throughput of the given configuration, followed by the wakeup latency
+/// of @p probeCount probes in between idle periods, as with interactive use.
+PtyBenchResult benchPtyConfig(PtyBenchConfig const& config,
+                              std::chrono::milliseconds benchTime,
+                              unsigned probeCount)
+{
+    using clock = PtyBenchSession::clock;
+
+    auto sessions = std::vector<std::unique_ptr<PtyBenchSession>> {};
+    for (unsigned i = 0; i < config.sessions; ++i)
+        sessions.emplace_back(std::make_unique<PtyBenchSession>(config));
+
+    auto const text = createText(64 * 1024);
+    auto result = PtyBenchResult { config };
+    auto resultMutex = std::mutex {};
+    auto writers = std::vector<std::thread> {};
+    for (auto& session: sessions)
+    {
+        writers.emplace_back([&, &session = *session]() {
+            auto bytes = uint64_t { 0 };
+            auto const start = clock::now();
+            while (clock::now() - start < benchTime && session.write(text))
+                bytes += text.size();
+            auto const end = session.probe().value_or(clock::now());
+
+            auto latencies = std::vector<std::chrono::nanoseconds> {};
+            for (unsigned i = 0; i < probeCount; ++i)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                auto const sentAt = clock::now();
+                if (auto const seenAt = session.probe())
+                    latencies.emplace_back(*seenAt - sentAt);
+            }
+
+            auto const _ = std::lock_guard { resultMutex };
+            result.bytes += bytes;
+            result.elapsed = std::max(result.elapsed, std::chrono::nanoseconds(end - start));
+            result.latencies.insert(result.latencies.end(), latencies.begin(), latencies.end());
+        });
+    }
+    for (auto& writer: writers)
+        writer.join();
+
+    std::sort(result.latencies.begin(), result.latencies.end());
+    return result;
+}
+
+std::string formatLatency(std::chrono::nanoseconds duration)
+{
+    return fmt::format("{:.1f} us", std::chrono::duration<double, std::micro>(duration).count());
+}
+
+#if !defined(_WIN32)
+/// Path of this program, as passed to main().
+char const* programPath = "bench-headless";
+
+/// Echoes the input read from stdin in raw mode, optionally wrapped in synchronized output,
+/// until Ctrl-D has been read. This is the application run by the latency benchmark.
+int runEcho(bool batched)
+{
+    auto tio = termios {};
+    tcgetattr(STDIN_FILENO, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(STDIN_FILENO, TCSANOW, &tio);
+
+    auto buffer = std::array<char, 256> {};
+    while (true)
+    {
+        auto const n = ::read(STDIN_FILENO, buffer.data(), buffer.size());
+        if (n <= 0)
+            return EXIT_SUCCESS;
+        auto const input = std::string_view(buffer.data(), static_cast<size_t>(n));
+        auto const output = batched ? fmt::format("\033[?2026h{}\033[?2026l", input) : std::string(input);
+        if (::write(STDOUT_FILENO, output.data(), output.size()) < 0)
+            return EXIT_FAILURE;
+        if (input.find('\x04') != std::string_view::npos)
+            return EXIT_SUCCESS;
+    }
+}
+
+struct LatencyBenchConfig
+{
+    double refreshRate;
+    bool batched;
+    size_t readSize;
+};
+
+struct LatencyBenchResult
+{
+    LatencyBenchConfig config;
+    unsigned timeouts = 0;
+    // Time from sending the key event until its echo has been written, parsed and made visible, sorted.
+    std::vector<std::chrono::nanoseconds> written;
+    std::vector<std::chrono::nanoseconds> parsed;
+    std::vector<std::chrono::nanoseconds> visible;
+};
+
+/// @returns whether @p renderBuffer shows @p ch at the given position.
+bool showsCharacter(vtbackend::RenderBuffer const& renderBuffer, vtbackend::CellLocation position, char ch)
+{
+    for (auto const& cell: renderBuffer.cells)
+        if (cell.position == position)
+        {
+            auto const codepoints = renderBuffer.codepointsOf(cell);
+            return codepoints.size() == 1 && codepoints[0] == char32_t(ch);
+        }
+    for (auto const& line: renderBuffer.lines)
+        if (line.lineOffset == position.line)
+            return unbox<size_t>(position.column) < line.text.size()
+                   && line.text[unbox<size_t>(position.column)] == ch;
+    return false;
+}
+
+/// A terminal attached to a real PTY running `bench-headless echo`, typing into it key by key.
+///
+/// Each key is sent as a key event, as the GUI would, and followed through until its echo has been
+/// parsed onto the screen and until it is shown by the front render buffer. The calling thread refreshes
+/// the render buffer, as the render thread would, polling every 50 microseconds.
+class LatencyBenchSession: public vtbackend::Terminal::NullEvents
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    explicit LatencyBenchSession(LatencyBenchConfig const& config):
+        _terminal { *this,
+                    createEchoProcess(config.batched),
+                    [&]() {
+                        auto settings = vtbackend::Settings {};
+                        settings.pageSize = PageSize;
+                        settings.refreshRate = vtbackend::RefreshRate { config.refreshRate };
+                        settings.ptyReadBufferSize = config.readSize;
+                        return settings;
+                    }(),
+                    clock::now() }
+    {
+        _reader = std::thread { [this]() {
+            while (!_done && _terminal.processInputOnce())
+                ;
+        } };
+    }
+
+    LatencyBenchSession(LatencyBenchSession const&) = delete;
+    LatencyBenchSession& operator=(LatencyBenchSession const&) = delete;
+    LatencyBenchSession(LatencyBenchSession&&) = delete;
+    LatencyBenchSession& operator=(LatencyBenchSession&&) = delete;
+
+    ~LatencyBenchSession() override
+    {
+        _done = true;
+        (void) _terminal.sendCharEvent(
+            U'\x04', 0, vtbackend::Modifiers {}, vtbackend::KeyboardEventType::Press, clock::now());
+        _terminal.device().close();
+        _reader.join();
+    }
+
+    /// Types a key and measures until its echo is visible.
+    ///
+    /// @returns the latencies until written, parsed and visible, or std::nullopt on timeout.
+    std::optional<std::array<std::chrono::nanoseconds, 3>> probe()
+    {
+        if (cursorPosition().column >= vtbackend::ColumnOffset::cast_from(PageSize.columns - 1))
+        {
+            // Start over at the beginning of the line, rather than wrapping.
+            if (!type('\r', [&]() { return cursorPosition().column == vtbackend::ColumnOffset(0); }))
+                return std::nullopt;
+        }
+
+        auto const position = cursorPosition();
+        auto const ch = [&]() {
+            auto const _ = std::lock_guard { _terminal };
+            auto const& line = _terminal.primaryScreen().grid().lineAt(position.line);
+            return line.leadingCodepointAt(position.column).first == U'a' ? 'b' : 'a';
+        }();
+
+        auto const start = clock::now();
+        auto written = clock::time_point {};
+        auto parsed = std::optional<clock::time_point> {};
+        auto const visible = type(ch, [&]() {
+            if (!parsed)
+            {
+                auto const _ = std::lock_guard { _terminal };
+                auto const& line = _terminal.primaryScreen().grid().lineAt(position.line);
+                if (line.leadingCodepointAt(position.column).first == char32_t(ch))
+                    parsed = clock::now();
+            }
+            _terminal.tick(clock::now());
+            _terminal.ensureFreshRenderBuffer();
+            return parsed && showsCharacter(_terminal.renderBuffer().get(), position, ch);
+        }, &written);
+        if (!visible)
+            return std::nullopt;
+        return std::array<std::chrono::nanoseconds, 3> {
+            written - start, *parsed - start, *visible - start
+        };
+    }
+
+  private:
+    static constexpr auto PageSize =
+        vtbackend::PageSize { vtbackend::LineCount(25), vtbackend::ColumnCount(80) };
+
+    static std::unique_ptr<vtpty::Pty> createEchoProcess(bool batched)
+    {
+        auto error = std::error_code {};
+        auto path = std::filesystem::read_symlink("/proc/self/exe", error);
+        if (error)
+            path = programPath;
+        auto arguments = std::vector<std::string> { "echo" };
+        if (batched)
+            arguments.emplace_back("batched");
+        auto process = std::make_unique<vtpty::Process>(
+            path.string(),
+            arguments,
+            std::filesystem::current_path(),
+            vtpty::Process::Environment {},
+            false,
+            vtpty::createPty(vtpty::PageSize { vtpty::LineCount(25), vtpty::ColumnCount(80) }, std::nullopt));
+        process->start();
+        return process;
+    }
+
+    [[nodiscard]] vtbackend::CellLocation cursorPosition() const
+    {
+        auto const _ = std::lock_guard { _terminal };
+        return _terminal.primaryScreen().cursor().position;
+    }
+
+    /// Sends @p ch as a key event and polls @p done until it returns true.
+    ///
+    /// @returns the time @p done returned true at, or std::nullopt on timeout.
+    template <typename Done>
+    std::optional<clock::time_point> type(char ch, Done const& done, clock::time_point* written = nullptr)
+    {
+        auto const start = clock::now();
+        (void) _terminal.sendCharEvent(
+            char32_t(ch), 0, vtbackend::Modifiers {}, vtbackend::KeyboardEventType::Press, start);
+        if (written)
+            *written = clock::now();
+        while (clock::now() - start < std::chrono::seconds(2))
+        {
+            if (done())
+                return clock::now();
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        return std::nullopt;
+    }
+
+    vtbackend::Terminal _terminal;
+    std::atomic<bool> _done = false;
+    std::thread _reader;
+};
+
+/// Measures the closed-loop keystroke latency of @p probeCount keys, typed with idle periods in between.
+LatencyBenchResult benchLatencyConfig(LatencyBenchConfig const& config, unsigned probeCount)
+{
+    auto session = LatencyBenchSession { config };
+    auto result = LatencyBenchResult { config };
+
+    // Waits for the echo program to be up and running.
+    (void) session.probe();
+
+    for (unsigned i = 0; i < probeCount; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        if (auto const latencies = session.probe())
+        {
+            result.written.push_back((*latencies)[0]);
+            result.parsed.push_back((*latencies)[1]);
+            result.visible.push_back((*latencies)[2]);
+        }
+        else
+            ++result.timeouts;
+    }
+
+    std::sort(result.written.begin(), result.written.end());
+    std::sort(result.parsed.begin(), result.parsed.end());
+    std::sort(result.visible.begin(), result.visible.end());
+    return result;
+}
+#endif
+
+/// Render target (and texture atlas backend) that only records what would be uploaded to and rendered
+/// on the GPU, such that the rasterizer pipeline can be measured on its own.
+///
+/// The render commands are forwarded to the rasterizer, if set, to measure rasterizing on the CPU as well.
+class MockRenderTarget final: public vtrasterizer::RenderTarget, public vtrasterizer::atlas::AtlasBackend
+{
+  public:
+    vtrasterizer::SoftwareRenderTarget* rasterizer = nullptr;
+
+    uint64_t tileUploads = 0;
+    uint64_t uploadedBytes = 0;
+    uint64_t tileRenders = 0;
+    uint64_t rectangles = 0;
+    uint64_t images = 0;
+
+    void resetCounters() noexcept
+    {
+        tileUploads = 0;
+        uploadedBytes = 0;
+        tileRenders = 0;
+        rectangles = 0;
+        images = 0;
+    }
+
+    // RenderTarget
+    void setRenderSize(vtbackend::ImageSize size) override
+    {
+        if (rasterizer)
+            rasterizer->setRenderSize(size);
+    }
+    void setMargin(vtrasterizer::PageMargin) override {}
+    vtrasterizer::atlas::AtlasBackend& textureScheduler() override { return *this; }
+    void renderRectangle(int x, int y, Width width, Height height, RGBAColor color) override
+    {
+        ++rectangles;
+        if (rasterizer)
+            rasterizer->renderRectangle(x, y, width, height, color);
+    }
+    void renderImage(std::shared_ptr<vtbackend::Image const> image,
+                     int x,
+                     int y,
+                     Width width,
+                     Height height,
+                     vtrasterizer::atlas::NormalizedTileLocation source) override
+    {
+        ++images;
+        if (rasterizer)
+            rasterizer->renderImage(std::move(image), x, y, width, height, source);
+    }
+    void discardImage(vtbackend::ImageId) override {}
+    void setDamage(std::optional<vtrasterizer::DamagedArea> damage) override
+    {
+        if (rasterizer)
+            rasterizer->setDamage(damage);
+    }
+    void scheduleScreenshot(ScreenshotCallback, vtbackend::ImageSize) override {}
+    void execute(std::chrono::steady_clock::time_point now) override
+    {
+        if (rasterizer)
+            rasterizer->execute(now);
+    }
+    void clearCache() override {}
+    std::optional<vtrasterizer::AtlasTextureScreenshot> readAtlas() override { return std::nullopt; }
+    void inspect(std::ostream&) const override {}
+
+    // AtlasBackend
+    [[nodiscard]] vtbackend::ImageSize atlasSize() const noexcept override { return _atlasSize; }
+    void configureAtlas(vtrasterizer::atlas::ConfigureAtlas atlas) override
+    {
+        _atlasSize = atlas.size;
+        if (rasterizer)
+            rasterizer->configureAtlas(atlas);
+    }
+    void uploadTile(vtrasterizer::atlas::UploadTile tile) override
+    {
+        ++tileUploads;
+        uploadedBytes += tile.bitmap.size();
+        if (rasterizer)
+            rasterizer->uploadTile(std::move(tile));
+    }
+    void renderTile(vtrasterizer::atlas::RenderTile tile) override
+    {
+        ++tileRenders;
+        if (rasterizer)
+            rasterizer->renderTile(tile);
+    }
+
+  private:
+    vtbackend::ImageSize _atlasSize {};
+};
+
+/// Built-in screen content to render, whose lines are scrolled through by one line per frame.
+struct BuiltinScreen
+{
+    std::string_view name;
+    std::string (*line)(int number, int columns);
+};
+
+// Syntax highlighted source code, as shown by vim.
+std::string vimLine(int number, int columns)
+{
+    static constexpr auto Tokens = std::array {
+        std::pair { "\033[1;34m", "auto " }, std::pair { "", "result " },   std::pair { "", "= " },
+        std::pair { "\033[33m", "compute" }, std::pair { "", "(" },         std::pair { "\033[32m", "\"s\"" },
+        std::pair { "", ", " },              std::pair { "\033[35m", "42" }, std::pair { "", "); " },
+        std::pair { "\033[3;90m", "// " },   std::pair { "\033[3;90m", "note " },
+    };
+    auto line = fmt::format("\033[33m{:>4} \033[m", number);
+    auto width = 5;
+    for (auto i = number % 3; width < columns; ++i)
+    {
+        auto const& [sgr, text] = Tokens[static_cast<size_t>(i) % Tokens.size()];
+        auto const length = std::min(static_cast<int>(std::string_view(text).size()), columns - width);
+        line += fmt::format("{}{}\033[m", sgr, std::string_view(text).substr(0, static_cast<size_t>(length)));
+        width += length;
+    }
+    return line;
+}
+
+// Process list with meters, as shown by htop, which makes use of block and box drawing characters.
+std::string htopLine(int number, int columns)
+{
+    auto const load = (number * 37) % 100;
+    auto line = fmt::format("\033[1m{:>7}\033[m │ user     │ {:>3}% ", 1000 + number, load);
+    auto width = 26;
+    auto const barWidth = std::max(0, columns - width - 2);
+    auto const filled = barWidth * load / 100;
+    line += "\033[32m";
+    for (auto i = 0; i < barWidth; ++i)
+        line += i < filled ? "█" : i == filled ? "▌" : " ";
+    line += "\033[m │";
+    return line;
+}
+
+// Emoji, each two columns wide.
+std::string emojiLine(int number, int columns)
+{
+    auto text = std::u32string {};
+    for (auto i = 0; i + 2 <= columns; i += 2)
+        text += static_cast<char32_t>(0x1F600 + (number * 7 + i) % 80);
+    return unicode::convert_to<char>(std::u32string_view(text));
+}
+
+// Chinese text, each ideograph being two columns wide.
+std::string cjkLine(int number, int columns)
+{
+    auto text = std::u32string {};
+    for (auto i = 0; i + 2 <= columns; i += 2)
+        text += i % 20 == 18 ? U'。' : static_cast<char32_t>(0x4E00 + (number * 31 + i * 13) % 2000);
+    return unicode::convert_to<char>(std::u32string_view(text));
+}
+
+constexpr auto BuiltinScreens = std::array {
+    BuiltinScreen { "vim", &vimLine },
+    BuiltinScreen { "htop", &htopLine },
+    BuiltinScreen { "emoji", &emojiLine },
+    BuiltinScreen { "CJK", &cjkLine },
+};
+
+void printRenderStats(vtrasterizer::RenderStats const& stats, MockRenderTarget const& target)
+{
+    if (!stats.frames)
+        return;
+
+    auto const frames = stats.frames;
+    auto const perFrame = [&](std::chrono::nanoseconds duration) {
+        return formatLatency(duration / static_cast<int64_t>(frames));
+    };
+    auto const accounted = stats.text + stats.background + stats.decoration + stats.image + stats.cursor
+                           + stats.lineCache + stats.execute;
+
+    cout << fmt::format("{:>22}: {} frames ({:.0f} frames/s)\n",
+                        "frames",
+                        frames,
+                        static_cast<double>(perSecond(static_cast<long double>(frames), stats.total)));
+    cout << fmt::format("{:>22}: {}\n", "per frame", perFrame(stats.total));
+    cout << fmt::format("{:>22}: {}\n", "text", perFrame(stats.text - stats.boxDrawing));
+    cout << fmt::format("{:>22}: {}\n", "- shaping", perFrame(stats.shaping));
+    cout << fmt::format("{:>22}: {}\n", "- rasterization", perFrame(stats.rasterization));
+    cout << fmt::format("{:>22}: {}\n", "box drawing", perFrame(stats.boxDrawing));
+    cout << fmt::format("{:>22}: {}\n", "background", perFrame(stats.background));
+    cout << fmt::format("{:>22}: {}\n", "decoration", perFrame(stats.decoration));
+    cout << fmt::format("{:>22}: {}\n", "image", perFrame(stats.image));
+    cout << fmt::format("{:>22}: {}\n", "cursor", perFrame(stats.cursor));
+    cout << fmt::format("{:>22}: {}\n", "line cache replay", perFrame(stats.lineCache));
+    cout << fmt::format("{:>22}: {}\n", "render target", perFrame(stats.execute));
+    cout << fmt::format("{:>22}: {}\n",
+                        "other (render buffer)",
+                        perFrame(std::max(stats.total - accounted, std::chrono::nanoseconds(0))));
+    cout << fmt::format("{:>22}: {:.1f} per frame ({}/frame)\n",
+                        "tile uploads",
+                        static_cast<double>(target.tileUploads) / static_cast<double>(frames),
+                        crispy::humanReadableBytes(target.uploadedBytes / frames));
+    cout << fmt::format("{:>22}: {:.1f} per frame\n",
+                        "tile renders",
+                        static_cast<double>(target.tileRenders) / static_cast<double>(frames));
+    cout << fmt::format("{:>22}: {:.1f} per frame\n\n",
+                        "rectangles",
+                        static_cast<double>(target.rectangles) / static_cast<double>(frames));
+}
+
+
+/// Termbench test writing full lines of random graphemes, as produced by @c Generator,
+/// such that the non-ASCII paths of the terminal get measured as well.
+class UnicodeLinesTest final: public contour::termbench::Test
+{
+  public:
+    /// Appends a random grapheme to the given text, returning its width in columns.
+    using Generator = int (*)(std::u32string& text);
+
+    UnicodeLinesTest(char const* name, char const* description, Generator generator):
+        contour::termbench::Test(name, description), _generator { generator }
+    {
+    }
+
+    void setup(size_t width, size_t /*height*/) override
+    {
+        auto text = std::u32string {};
+        auto const columns = static_cast<int>(width);
+        while (text.size() < 1024 * 1024)
+        {
+            auto column = 0;
+            while (true)
+            {
+                auto grapheme = std::u32string {};
+                auto const graphemeWidth = _generator(grapheme);
+                if (column + graphemeWidth > columns)
+                    break;
+                text += grapheme;
+                column += graphemeWidth;
+            }
+            text += U"\r\n";
+        }
+        _text = unicode::convert_to<char>(std::u32string_view(text));
+    }
+
+    void run(contour::termbench::Buffer& buffer) noexcept override
+    {
+        while (buffer.good())
+            (void) buffer.write(_text);
+    }
+
+  private:
+    Generator _generator;
+    std::string _text;
+};
+
+char32_t randomCodepoint(char32_t first, char32_t last)
+{
+    return first + static_cast<char32_t>(rand()) % (last - first + 1);
+}
+
+// CJK ideographs and kana, each two columns wide.
+int cjkGrapheme(std::u32string& text)
+{
+    text += rand() % 4 ? randomCodepoint(0x4E00, 0x9FFF) : randomCodepoint(0x3041, 0x3096);
+    return 2;
+}
+
+// Latin letters with one or two combining marks.
+int combiningGrapheme(std::u32string& text)
+{
+    text += static_cast<char32_t>('a' + rand() % 26);
+    for (auto i = 0, count = 1 + rand() % 2; i < count; ++i)
+        text += randomCodepoint(0x0300, 0x036F);
+    return 1;
+}
+
+// Emoji, including skin tone modifiers, flags and ZWJ sequences, each two columns wide.
+int emojiGrapheme(std::u32string& text)
+{
+    static constexpr auto Sequences = std::array<std::u32string_view, 6> {
+        U"\U0001F468\u200D\U0001F469\u200D\U0001F467", // family
+        U"\U0001F3F3\uFE0F\u200D\U0001F308",           // rainbow flag
+        U"\U0001F9D1\U0001F3FD\u200D\U0001F4BB",        // technologist with skin tone
+        U"\U0001F44D\U0001F3FD",                        // thumbs up with skin tone
+        U"\U0001F1E9\U0001F1EA",                        // flag
+        U"\u2764\uFE0F",                                // emoji presentation
+    };
+    if (rand() % 2)
+        text += randomCodepoint(0x1F600, 0x1F64F);
+    else
+        text += Sequences[static_cast<size_t>(rand()) % Sequences.size()];
+    return 2;
+}
+
+// Box drawing characters and block elements.
+int boxDrawingGrapheme(std::u32string& text)
+{
+    text += randomCodepoint(0x2500, 0x259F);
+    return 1;
+}
+
+// Private use area glyphs as provided by Nerd Fonts (Powerline, Font Awesome, Material Design).
+int nerdFontGrapheme(std::u32string& text)
+{
+    switch (rand() % 3)
+    {
+        case 0: text += randomCodepoint(0xE0A0, 0xE0D4); break;
+        case 1: text += randomCodepoint(0xF000, 0xF2E0); break;
+        default: text += randomCodepoint(0xF0001, 0xF1AF0); break;
+    }
+    return 1;
+}
+
+
+/// Content filling the history in the memory benchmark.
+struct MemoryWorkload
+{
+    std::string_view name;
+    std::string (*line)(int number, int columns);
+};
+
+std::string plainLogLine(int number, int /*columns*/)
+{
+    return fmt::format("2024-05-01 12:{:02}:{:02}.{:03} INFO  [worker-{}] processed request #{} in {} ms",
+                       number / 60 % 60,
+                       number % 60,
+                       number * 7 % 1000,
+                       number % 8,
+                       number,
+                       number * 13 % 250);
+}
+
+// Log lines with a few differently colored runs, as written by colored loggers and compilers.
+std::string coloredLogLine(int number, int /*columns*/)
+{
+    static constexpr auto Levels = std::array<std::string_view, 4> { "DEBUG", "INFO ", "WARN ", "ERROR" };
+    static constexpr auto Colors = std::array { 34, 32, 33, 31 };
+    auto const level = Levels[static_cast<size_t>(number) % Levels.size()];
+    auto const color = Colors[static_cast<size_t>(number) % Colors.size()];
+    return fmt::format("\033[2m2024-05-01 12:{:02}:{:02}\033[m \033[{}m{}\033[m \033[36m[worker-{}]\033[m "
+                       "processed request \033[1m#{}\033[m in {} ms",
+                       number / 60 % 60,
+                       number % 60,
+                       color,
+                       level,
+                       number % 8,
+                       number,
+                       number * 13 % 250);
+}
 
-namespace
+// Lines being edited cell-wise after having been written, as done by TUI applications redrawing parts
+// of the screen, which leaves these lines inflated.
+std::string tuiLine(int number, int columns)
 {
+    auto const width = std::max(columns - 2, 10);
+    auto const text = fmt::format("task {:>6}: running", number);
+    auto line = fmt::format("\033[44m│ {:<{}}│\033[m", text, width - 2);
+    line += fmt::format("\r\033[{}C\033[1;32m✔\033[m\033[{}C\033[7m{:>3}%\033[m",
+                        2,
+                        width / 2,
+                        number * 3 % 101);
+    return line;
+}
 
-std::string createText(size_t bytes)
+std::string emojiHistoryLine(int /*number*/, int columns)
 {
-    std::string text;
-    while (text.size() < bytes)
-    {
-        text += char('A' + (rand() % 26));
-        if ((text.size() % 65) == 0)
-            text += '\n';
-    }
-    return text;
+    auto text = std::u32string {};
+    for (auto column = 0; column + 2 <= columns;)
+        column += emojiGrapheme(text);
+    return unicode::convert_to<char>(std::u32string_view(text));
 }
 
+constexpr auto MemoryWorkloads = std::array {
+    MemoryWorkload { "plain", &plainLogLine },
+    MemoryWorkload { "colored", &coloredLogLine },
+    MemoryWorkload { "tui", &tuiLine },
+    MemoryWorkload { "emoji", &emojiHistoryLine },
+};
+
 } // namespace
 
 struct BenchOptions
 {
+    std::string kind;
     unsigned testSizeMB = 64;
     bool manyLines = false;
     bool longLines = false;
     bool sgr = false;
     bool binary = false;
+    bool cjk = false;
+    bool combining = false;
+    bool emoji = false;
+    bool boxDrawing = false;
+    bool nerdFont = false;
+    std::string jsonPath;
 };
 
-template <typename Writer>
-int baseBenchmark(Writer&& writer, BenchOptions options, string_view title)
+/// Results of a termbench test, measured around the writes of its data only.
+struct BenchTestResult
+{
+    std::string name;
+    uint64_t bytes = 0;
+    std::chrono::nanoseconds elapsed {};
+    std::optional<uint64_t> allocations;
+    std::optional<uint64_t> allocatedBytes;      // only known when built with CONTOUR_COUNT_ALLOCATIONS
+    std::optional<uint64_t> peakResidentSetSize; // of the process, up to the end of the test
+};
+
+std::string benchResultsJson(std::string_view kind, std::vector<BenchTestResult> const& results)
+{
+    auto json = fmt::format("{{\n"
+                            "  \"benchmark\": \"{}\",\n"
+                            "  \"version\": \"{}\",\n"
+                            "  \"gitSha\": \"{}\",\n"
+                            "  \"buildFlags\": \"{}\",\n"
+                            "  \"tests\": [\n",
+                            kind,
+                            CONTOUR_VERSION_STRING,
+                            CONTOUR_GIT_SHA,
+                            CONTOUR_BUILD_FLAGS);
+    for (auto const& result: results)
+    {
+        // One test per line, as expected by the compare command.
+        auto const seconds = std::chrono::duration<double>(result.elapsed).count();
+        json += fmt::format("    {{\"name\": \"{}\", \"bytes\": {}, \"seconds\": {:.6f}, "
+                            "\"mbPerSecond\": {:.3f}, \"peakRssBytes\": {}, \"allocations\": {}, "
+                            "\"allocatedBytes\": {}}}{}\n",
+                            result.name,
+                            result.bytes,
+                            seconds,
+                            static_cast<double>(perSecond(result.bytes, result.elapsed)) / (1024 * 1024),
+                            jsonNumber(result.peakResidentSetSize),
+                            jsonNumber(result.allocations),
+                            jsonNumber(result.allocatedBytes),
+                            &result == &results.back() ? "" : ",");
+    }
+    json += "  ]\n}\n";
+    return json;
+}
+
+void selectDefaultTests(BenchOptions& options)
 {
-    if (!(options.binary || options.longLines || options.manyLines || options.sgr))
+    if (!(options.binary || options.longLines || options.manyLines || options.sgr || options.cjk
+          || options.combining || options.emoji || options.boxDrawing || options.nerdFont))
     {
         cout << "No test cases specified. Defaulting to: cat, long, sgr.\n";
         options.manyLines = true;
         options.longLines = true;
         options.sgr = true;
     }
+}
 
-    auto const titleText = fmt::format("Running benchmark: {} (test size: {} MB)", title, options.testSizeMB);
-
-    cout << titleText << '\n' << string(titleText.size(), '=') << '\n';
-
-    auto tbp = contour::termbench::Benchmark { std::forward<Writer>(writer),
-                                               options.testSizeMB,
-                                               80,
-                                               24,
-                                               [&](contour::termbench::Test const& test) {
-                                                   cout << fmt::format("Running test {} ...\n", test.name);
-                                               } };
-
+void addBenchTests(contour::termbench::Benchmark& tbp, BenchOptions const& options)
+{
     if (options.manyLines)
         tbp.add(contour::termbench::tests::many_lines());
 
@@ -85,7 +1209,70 @@ int baseBenchmark(Writer&& writer, BenchOptions options, string_view title)
     if (options.binary)
         tbp.add(contour::termbench::tests::binary());
 
+    if (options.cjk)
+        tbp.add(std::make_unique<UnicodeLinesTest>("cjk_lines", "CJK ideographs and kana", &cjkGrapheme));
+
+    if (options.combining)
+        tbp.add(std::make_unique<UnicodeLinesTest>(
+            "combining_lines", "Latin letters with combining marks", &combiningGrapheme));
+
+    if (options.emoji)
+        tbp.add(std::make_unique<UnicodeLinesTest>(
+            "emoji_lines", "Emoji including ZWJ sequences and modifiers", &emojiGrapheme));
+
+    if (options.boxDrawing)
+        tbp.add(std::make_unique<UnicodeLinesTest>(
+            "box_drawing_lines", "Box drawing characters and block elements", &boxDrawingGrapheme));
+
+    if (options.nerdFont)
+        tbp.add(std::make_unique<UnicodeLinesTest>(
+            "nerd_font_lines", "Private use area glyphs of Nerd Fonts", &nerdFontGrapheme));
+}
+
+template <typename Writer>
+int baseBenchmark(Writer&& writer, BenchOptions options, string_view title)
+{
+    selectDefaultTests(options);
+
+    auto const titleText = fmt::format("Running benchmark: {} (test size: {} MB)", title, options.testSizeMB);
+
+    cout << titleText << '\n' << string(titleText.size(), '=') << '\n';
+
+    auto results = std::vector<BenchTestResult> {};
+    auto const finishTest = [&]() {
+        if (!results.empty())
+            results.back().peakResidentSetSize = peakResidentSetSize();
+    };
+    auto const measuredWriter = [&](char const* data, size_t size) -> bool {
+        if (results.empty())
+            results.emplace_back();
+        auto& result = results.back();
+        auto const allocationsBefore = allocations();
+        auto const bytesBefore = crispy::process_allocations().bytes;
+        auto rv = false;
+        result.elapsed += measure([&]() { rv = writer(data, size); });
+        if (auto const allocationsAfter = allocations(); allocationsBefore && allocationsAfter)
+            result.allocations = result.allocations.value_or(0) + *allocationsAfter - *allocationsBefore;
+        if constexpr (crispy::allocations_counted)
+            result.allocatedBytes =
+                result.allocatedBytes.value_or(0) + crispy::process_allocations().bytes - bytesBefore;
+        result.bytes += size;
+        return rv;
+    };
+
+    auto tbp = contour::termbench::Benchmark { measuredWriter,
+                                               options.testSizeMB,
+                                               80,
+                                               24,
+                                               [&](contour::termbench::Test const& test) {
+                                                   finishTest();
+                                                   results.emplace_back().name = std::string(test.name);
+                                                   cout << fmt::format("Running test {} ...\n", test.name);
+                                               } };
+
+    addBenchTests(tbp, options);
     tbp.runAll();
+    finishTest();
 
     cout << '\n';
     cout << "Results\n";
@@ -93,9 +1280,209 @@ int baseBenchmark(Writer&& writer, BenchOptions options, string_view title)
     tbp.summarize(cout);
     cout << '\n';
 
+    if (!options.jsonPath.empty() && !writeJson(options.jsonPath, benchResultsJson(options.kind, results)))
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
+
+/// Compares the results of two runs, as written by baseBenchmark(), by the throughput of each test.
+///
+/// @returns EXIT_FAILURE if any test of @p oldPath got slower by more than @p thresholdPercent.
+int compareBenchResults(std::string const& oldPath, std::string const& newPath, double thresholdPercent)
+{
+    struct Run
+    {
+        std::string gitSha;
+        std::vector<std::pair<std::string, double>> tests; // name and MB/s, in order
+    };
+
+    auto const load = [](std::string const& path) -> std::optional<Run> {
+        auto const contents = readFile(path);
+        if (!contents)
+            return std::nullopt;
+        auto run = Run {};
+        run.gitSha = std::string(jsonValue(*contents, "gitSha").value_or("unknown"));
+        auto lines = std::istringstream(*contents);
+        for (auto line = std::string {}; std::getline(lines, line);)
+        {
+            auto const name = jsonValue(line, "name");
+            auto const throughput = jsonValue(line, "mbPerSecond");
+            if (name && throughput)
+                run.tests.emplace_back(std::string(*name),
+                                       std::strtod(std::string(*throughput).c_str(), nullptr));
+        }
+        return run;
+    };
+
+    auto const oldRun = load(oldPath);
+    auto const newRun = load(newPath);
+    for (auto const& [path, run]: { std::pair { &oldPath, &oldRun }, std::pair { &newPath, &newRun } })
+    {
+        if (!*run)
+        {
+            cerr << fmt::format("Could not read benchmark results: {}\n", *path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto const title = fmt::format("Comparing {} ({}) to {} ({}), threshold: {:.1f} %",
+                                   oldPath,
+                                   oldRun->gitSha,
+                                   newPath,
+                                   newRun->gitSha,
+                                   thresholdPercent);
+    cout << title << '\n' << string(title.size(), '=') << '\n';
+    cout << fmt::format("{:<20} {:>14} {:>14} {:>9}\n", "test", "old MB/s", "new MB/s", "delta");
+
+    auto regressions = 0;
+    for (auto const& [name, oldThroughput]: oldRun->tests)
+    {
+        auto const i = std::find_if(newRun->tests.begin(), newRun->tests.end(), [&](auto const& test) {
+            return test.first == name;
+        });
+        if (i == newRun->tests.end())
+        {
+            cout << fmt::format("{:<20} {:>14.3f} {:>14} {:>9}\n", name, oldThroughput, "-", "missing");
+            continue;
+        }
+        auto const delta = oldThroughput > 0 ? (i->second - oldThroughput) / oldThroughput * 100 : 0.0;
+        auto const regressed = delta < -thresholdPercent;
+        if (regressed)
+            ++regressions;
+        cout << fmt::format("{:<20} {:>14.3f} {:>14.3f} {:>+7.1f} %{}\n",
+                            name,
+                            oldThroughput,
+                            i->second,
+                            delta,
+                            regressed ? "  REGRESSION" : "");
+    }
+
+    if (regressions)
+    {
+        cout << fmt::format("\n{} test(s) regressed by more than {:.1f} %.\n", regressions, thresholdPercent);
+        return EXIT_FAILURE;
+    }
     return EXIT_SUCCESS;
 }
 
+/// The output of a termbench test, generated once up front, such that all sessions replay the same bytes,
+/// and generating them is not measured.
+struct RecordedBenchTest
+{
+    std::string name;
+    std::string output;
+};
+
+std::vector<RecordedBenchTest> recordBenchTests(BenchOptions const& options)
+{
+    auto tests = std::vector<RecordedBenchTest> {};
+    auto tbp = contour::termbench::Benchmark {
+        [&](char const* data, size_t size) -> bool {
+            if (tests.empty())
+                tests.emplace_back();
+            tests.back().output.append(data, size);
+            return true;
+        },
+        options.testSizeMB,
+        80,
+        24,
+        [&](contour::termbench::Test const& test) { tests.emplace_back().name = std::string(test.name); }
+    };
+    addBenchTests(tbp, options);
+    tbp.runAll();
+    return tests;
+}
+
+struct MultiSessionResult
+{
+    std::string test;
+    unsigned sessions = 0;
+    uint64_t bytes = 0;                                 // processed by each session
+    std::chrono::nanoseconds elapsed {};                // from the first session starting to the last ending
+    std::vector<std::chrono::nanoseconds> sessionTimes; // of each session, sorted
+};
+
+/// @returns the throughput of all sessions together.
+long double aggregateThroughput(MultiSessionResult const& result)
+{
+    return perSecond(static_cast<long double>(result.bytes) * result.sessions, result.elapsed);
+}
+
+/// @returns Jain's fairness index of the sessions' throughputs, 1 if all sessions got the same share.
+double fairnessIndex(MultiSessionResult const& result)
+{
+    auto sum = 0.0L;
+    auto sumOfSquares = 0.0L;
+    for (auto const time: result.sessionTimes)
+    {
+        auto const throughput = perSecond(result.bytes, time);
+        sum += throughput;
+        sumOfSquares += throughput * throughput;
+    }
+    if (sumOfSquares == 0)
+        return 1.0;
+    auto const count = static_cast<long double>(result.sessionTimes.size());
+    return static_cast<double>(sum * sum / (count * sumOfSquares));
+}
+
+using MultiSessionTerminal = vtbackend::MockTerm<vtpty::MockViewPty>;
+
+/// Lets each terminal process @p test on a thread of its own, all of them starting at once.
+MultiSessionResult benchSessions(std::vector<std::unique_ptr<MultiSessionTerminal>>& terminals,
+                                 RecordedBenchTest const& test)
+{
+    using clock = std::chrono::steady_clock;
+
+    auto startMutex = std::mutex {};
+    auto startCondition = std::condition_variable {};
+    auto started = false;
+    auto times = std::vector<std::pair<clock::time_point, clock::time_point>>(terminals.size());
+
+    auto threads = std::vector<std::thread> {};
+    for (size_t i = 0; i < terminals.size(); ++i)
+    {
+        threads.emplace_back([&, i]() {
+            {
+                auto lock = std::unique_lock { startMutex };
+                startCondition.wait(lock, [&]() { return started; });
+            }
+            auto& vt = *terminals[i];
+            auto& pty = vt.mockPty();
+            auto const start = clock::now();
+            pty.setReadData(test.output);
+            while (!pty.stdoutBuffer().empty())
+                vt.terminal.processInputOnce();
+            times[i] = { start, clock::now() };
+            vt.resetReplyData();
+        });
+    }
+    {
+        auto const _ = std::lock_guard { startMutex };
+        started = true;
+    }
+    startCondition.notify_all();
+    for (auto& thread: threads)
+        thread.join();
+
+    auto result = MultiSessionResult {
+        .test = test.name,
+        .sessions = static_cast<unsigned>(terminals.size()),
+        .bytes = test.output.size(),
+        .sessionTimes = {},
+    };
+    auto const first = std::min_element(times.begin(), times.end())->first;
+    auto last = first;
+    for (auto const& [start, end]: times)
+    {
+        last = std::max(last, end);
+        result.sessionTimes.emplace_back(end - start);
+    }
+    result.elapsed = last - first;
+    std::sort(result.sessionTimes.begin(), result.sessionTimes.end());
+    return result;
+}
+
 namespace CLI = crispy::cli;
 
 class ContourHeadlessBench: public crispy::app
@@ -115,7 +1502,16 @@ class ContourHeadlessBench: public crispy::app
             Project { "fmt", "MIT", "https://github.com/fmtlib/fmt" });
         link("bench-headless.parser", bind(&ContourHeadlessBench::benchParserOnly, this));
         link("bench-headless.grid", bind(&ContourHeadlessBench::benchGrid, this));
-        link("bench-headless.pty", bind(&ContourHeadlessBench::benchPTY));
+        link("bench-headless.pty", bind(&ContourHeadlessBench::benchPTY, this));
+        link("bench-headless.replay", bind(&ContourHeadlessBench::benchReplay, this));
+        link("bench-headless.multi", bind(&ContourHeadlessBench::benchMulti, this));
+        link("bench-headless.render", bind(&ContourHeadlessBench::benchRender, this));
+#if !defined(_WIN32)
+        link("bench-headless.latency", bind(&ContourHeadlessBench::benchLatency, this));
+        link("bench-headless.echo", bind(&ContourHeadlessBench::echo, this));
+#endif
+        link("bench-headless.memory", bind(&ContourHeadlessBench::benchMemory, this));
+        link("bench-headless.compare", bind(&ContourHeadlessBench::benchCompare, this));
         link("bench-headless.meta", bind(&ContourHeadlessBench::showMetaInfo));
 
         char const* logFilterString = getenv("LOG");
@@ -134,8 +1530,31 @@ class ContourHeadlessBench: public crispy::app
             CLI::option { "long", CLI::value { false }, "Enable long-line ASCII stream test." },
             CLI::option { "sgr", CLI::value { false }, "Enable SGR stream test." },
             CLI::option { "binary", CLI::value { false }, "Enable binary stream test." },
+            CLI::option { "cjk", CLI::value { false }, "Enable CJK (double width) text test." },
+            CLI::option { "combining", CLI::value { false }, "Enable combining marks test." },
+            CLI::option { "emoji", CLI::value { false }, "Enable emoji (including ZWJ sequences) test." },
+            CLI::option { "box", CLI::value { false }, "Enable box drawing and block elements test." },
+            CLI::option { "nerd-font", CLI::value { false }, "Enable Nerd Font (private use area) test." },
+            CLI::option { "json",
+                          CLI::value { ""s },
+                          "Writes the results as JSON to the given file, or - for stdout.",
+                          "FILE" },
         };
 
+        auto multiOptions = perfOptions;
+        multiOptions.insert(
+            multiOptions.end(),
+            {
+                CLI::option { "sessions",
+                              CLI::value { "1,4,16"s },
+                              "Comma separated numbers of concurrent sessions, each measured against one.",
+                              "LIST" },
+                CLI::option { "columns", CLI::value { 80u }, "Number of columns of the screen." },
+                CLI::option { "lines", CLI::value { 25u }, "Number of lines of the screen." },
+                CLI::option { "history", CLI::value { 4000u }, "Maximum number of history lines." },
+                CLI::option { "read-size", CLI::value { 4096u }, "Number of bytes per simulated PTY read." },
+            });
+
         return CLI::command {
             "bench-headless",
             "Contour Terminal Emulator " CONTOUR_VERSION_STRING
@@ -154,7 +1573,139 @@ class ContourHeadlessBench: public crispy::app
                     "parser", "Performs performance tests utilizing the VT parser only.", perfOptions },
                 CLI::command {
                     "pty",
-                    "Performs performance tests utilizing the underlying operating system's PTY only." },
+                    "Measures the throughput and wakeup latency of reading the underlying operating system's "
+                    "PTY through the terminal, for every combination of the given settings.",
+                    CLI::option_list {
+                        CLI::option {
+                            "time", CLI::value { 2000u }, "Milliseconds to measure throughput for.", "MS" },
+                        CLI::option { "probes",
+                                      CLI::value { 200u },
+                                      "Number of probes to measure the wakeup latency with, per session." },
+                        CLI::option { "read-sizes",
+                                      CLI::value { "4096,65536"s },
+                                      "Comma separated PTY read buffer sizes in bytes.",
+                                      "LIST" },
+                        CLI::option { "buffer-object-sizes",
+                                      CLI::value { "1024,4096"s },
+                                      "Comma separated buffer object sizes in KB.",
+                                      "LIST" },
+                        CLI::option { "fastpipe",
+                                      CLI::value { true },
+                                      "Also measure writing to the stdout fastpipe, where supported." },
+                        CLI::option { "sessions",
+                                      CLI::value { "1,4"s },
+                                      "Comma separated numbers of concurrent sessions.",
+                                      "LIST" },
+                        CLI::option { "json",
+                                      CLI::value { ""s },
+                                      "Writes the results as JSON to the given file, or - for stdout.",
+                                      "FILE" },
+                    } },
+                CLI::command {
+                    "replay",
+                    "Replays recorded PTY output through the full terminal at maximum speed.",
+                    CLI::option_list {
+                        CLI::option { "columns", CLI::value { 80u }, "Number of columns of the screen." },
+                        CLI::option { "lines", CLI::value { 25u }, "Number of lines of the screen." },
+                        CLI::option { "history", CLI::value { 4000u }, "Maximum number of history lines." },
+                        CLI::option {
+                            "read-size", CLI::value { 4096u }, "Number of bytes per simulated PTY read." },
+                        CLI::option { "frame-size",
+                                      CLI::value { 65536u },
+                                      "Number of bytes to process before rendering a frame (0 disables "
+                                      "rendering)." },
+                        CLI::option { "repeat", CLI::value { 1u }, "Number of times to replay each file." },
+                    },
+                    CLI::command_list {},
+                    CLI::command_select::Explicit,
+                    CLI::verbatim { "FILE...",
+                                    "PTY output recordings to replay, raw or recorded by contour "
+                                    "(terminal record FILE)." } },
+                CLI::command {
+                    "multi",
+                    "Runs the grid tests in many terminals at once, each on a thread of its own, and reports "
+                    "how the throughput scales with the number of sessions.",
+                    multiOptions },
+                CLI::command {
+                    "render",
+                    "Renders screens through the full rasterizer pipeline, including text shaping and the "
+                    "texture atlas, but without a GPU.",
+                    CLI::option_list {
+                        CLI::option { "columns", CLI::value { 80u }, "Number of columns of the screen." },
+                        CLI::option { "lines", CLI::value { 25u }, "Number of lines of the screen." },
+                        CLI::option { "frames",
+                                      CLI::value { 300u },
+                                      "Number of frames to render per built-in screen, scrolling by one line "
+                                      "each." },
+                        CLI::option { "frame-size",
+                                      CLI::value { 4096u },
+                                      "Number of bytes of a recording to process before rendering a frame." },
+                        CLI::option { "font", CLI::value { "monospace"s }, "Font family to render with." },
+                        CLI::option { "font-size", CLI::value { 12u }, "Font size in points." },
+                        CLI::option { "dpi", CLI::value { 96u }, "DPI to render the font for." },
+                        CLI::option { "software",
+                                      CLI::value { false },
+                                      "Rasterizes the frames on the CPU, on as many threads as there are CPU "
+                                      "cores, to measure what hosts without a GPU render at." },
+                    },
+                    CLI::command_list {},
+                    CLI::command_select::Explicit,
+                    CLI::verbatim { "FILE...",
+                                    "PTY output recordings to render, instead of the built-in screens "
+                                    "(vim, htop, emoji, CJK)." } },
+                CLI::command {
+                    "latency",
+                    "Measures the closed-loop keystroke latency through a real PTY running an echo program, "
+                    "for every combination of the given settings.",
+                    CLI::option_list {
+                        CLI::option {
+                            "probes", CLI::value { 200u }, "Number of keys to type per configuration." },
+                        CLI::option { "refresh-rates",
+                                      CLI::value { "60,120,240"s },
+                                      "Comma separated refresh rates in Hz.",
+                                      "LIST" },
+                        CLI::option { "read-sizes",
+                                      CLI::value { "4096,65536"s },
+                                      "Comma separated PTY read buffer sizes in bytes.",
+                                      "LIST" },
+                        CLI::option { "batched",
+                                      CLI::value { true },
+                                      "Also measure the echo being wrapped in synchronized output "
+                                      "(BatchedRendering mode)." },
+                    } },
+                CLI::command {
+                    "echo",
+                    "Echoes its input in raw mode, as used by the latency benchmark.",
+                    CLI::option_list {
+                        CLI::option {
+                            "batched", CLI::value { false }, "Wraps each echo in synchronized output." },
+                    } },
+                CLI::command {
+                    "memory",
+                    "Fills the history with typical content and reports the memory used per line.",
+                    CLI::option_list {
+                        CLI::option { "columns", CLI::value { 80u }, "Number of columns of the screen." },
+                        CLI::option { "lines", CLI::value { 25u }, "Number of lines of the screen." },
+                        CLI::option {
+                            "history", CLI::value { 100000u }, "Number of history lines to fill.", "COUNT" },
+                        CLI::option { "content",
+                                      CLI::value { "plain,colored,tui,emoji"s },
+                                      "Comma separated content to fill the history with, each on its own.",
+                                      "LIST" },
+                    } },
+                CLI::command {
+                    "compare",
+                    "Compares the JSON results of two grid or parser runs, and fails if any test's "
+                    "throughput dropped by more than the threshold.",
+                    CLI::option_list {
+                        CLI::option { "threshold",
+                                      CLI::value { 5.0 },
+                                      "Maximum tolerated throughput drop in percent.",
+                                      "PERCENT" },
+                    },
+                    CLI::command_list {},
+                    CLI::command_select::Explicit,
+                    CLI::verbatim { "OLD NEW", "JSON result files of the baseline and the new run." } },
             }
         };
     }
@@ -165,6 +1716,8 @@ class ContourHeadlessBench: public crispy::app
         fmt::print("SimpleCell  : {} bytes\n", sizeof(vtbackend::SimpleCell));
         fmt::print("CompactCell : {} bytes\n", sizeof(vtbackend::CompactCell));
         fmt::print("CellExtra   : {} bytes\n", sizeof(vtbackend::CellExtra));
+        fmt::print("FlatCell    : {} bytes\n", sizeof(vtbackend::FlatCell));
+        fmt::print("FlatCellExtra: {} bytes\n", sizeof(vtbackend::FlatCellExtra));
         fmt::print("CellFlags   : {} bytes\n", sizeof(vtbackend::CellFlags));
         fmt::print("Color       : {} bytes\n", sizeof(vtbackend::Color));
         return EXIT_SUCCESS;
@@ -174,11 +1727,18 @@ class ContourHeadlessBench: public crispy::app
     {
         auto const prefix = fmt::format("bench-headless.{}.", kind);
         auto opts = BenchOptions {};
+        opts.kind = std::string(kind);
         opts.testSizeMB = parameters().uint(prefix + "size");
         opts.manyLines = parameters().boolean(prefix + "cat");
         opts.longLines = parameters().boolean(prefix + "long");
         opts.sgr = parameters().boolean(prefix + "sgr");
         opts.binary = parameters().boolean(prefix + "binary");
+        opts.cjk = parameters().boolean(prefix + "cjk");
+        opts.combining = parameters().boolean(prefix + "combining");
+        opts.emoji = parameters().boolean(prefix + "emoji");
+        opts.boxDrawing = parameters().boolean(prefix + "box");
+        opts.nerdFont = parameters().boolean(prefix + "nerd-font");
+        opts.jsonPath = parameters().str(prefix + "json");
         return opts;
     }
 
@@ -205,94 +1765,693 @@ class ContourHeadlessBench: public crispy::app
             },
             benchOptionsFor("grid"),
             "terminal with screen buffer");
-        if (rv == EXIT_SUCCESS)
-            cout << fmt::format("{:>12}: {}\n\n", "history size", *vt.terminal.maxHistoryLineCount());
+        if (rv != EXIT_SUCCESS)
+            return rv;
+
+        cout << fmt::format("{:>12}: {}\n\n", "history size", *vt.terminal.maxHistoryLineCount());
+        if constexpr (crispy::allocations_counted)
+        {
+            auto const allocations = vt.terminal.allocationStats();
+            cout << fmt::format(
+                "{:>12}: {:.1f} per MB parsed\n\n",
+                "allocations",
+                crispy::allocations_per_mb(allocations.input.total.count, allocations.parsedBytes));
+        }
+        vt.terminal.inspectSequenceStats(cout);
+
+        // Compare the cell types on their own, for a grid of the same dimensions.
+        auto const cellCount = pageSize.columns.as<size_t>()
+                               * (pageSize.lines.as<size_t>() + maxHistoryLineCount.as<size_t>());
+        benchCells<vtbackend::SimpleCell>("SimpleCell", cellCount);
+        benchCells<vtbackend::CompactCell>("CompactCell", cellCount);
+        benchCells<vtbackend::FlatCell>("FlatCell", cellCount);
         return rv;
     }
 
-    static int benchPTY()
-    {
-        using std::chrono::steady_clock;
-        using vtpty::ColumnCount;
-        using vtpty::createPty;
-        using vtpty::LineCount;
-        using vtpty::PageSize;
-        using vtpty::Pty;
-
-        // Benchmark configuration
-        // TODO make these values CLI configurable.
-        auto constexpr WritesPerLoop = 1;
-        auto constexpr PtyWriteSize = 4096;
-        auto constexpr PtyReadSize = 4096;
-        auto const benchTime = chrono::seconds(10);
-
-        // Setup benchmark
-        std::string const text = createText(PtyWriteSize);
-        unique_ptr<Pty> ptyObject = createPty(PageSize { LineCount(25), ColumnCount(80) }, std::nullopt);
-        auto& pty = *ptyObject;
-        auto& ptySlave = pty.slave();
-        (void) ptySlave.configure();
-
-        auto bufferObjectPool = crispy::buffer_object_pool<char>(4llu * 1024 * 1024);
-        auto bufferObject = bufferObjectPool.allocateBufferObject();
-
-        auto bytesTransferred = uint64_t { 0 };
-        auto loopIterations = uint64_t { 0 };
-        auto ptyStdoutReaderThread = std::thread { [&]() {
-            while (!pty.isClosed())
+    int benchPTY()
+    {
+        auto const& flags = parameters();
+        auto const benchTime = std::chrono::milliseconds(flags.uint("bench-headless.pty.time"));
+        auto const probeCount = flags.uint("bench-headless.pty.probes");
+        auto const readSizes = parseSizes(flags.str("bench-headless.pty.read-sizes"), 1);
+        auto const bufferObjectSizes = parseSizes(flags.str("bench-headless.pty.buffer-object-sizes"), 1024);
+        auto const sessionCounts = parseSizes(flags.str("bench-headless.pty.sessions"), 1);
+        auto channels = std::vector<bool> { false };
+#if !defined(_WIN32)
+        if (flags.boolean("bench-headless.pty.fastpipe"))
+            channels.push_back(true);
+#endif
+
+        auto configs = std::vector<PtyBenchConfig> {};
+        for (auto const readSize: readSizes)
+            for (auto const bufferObjectSize: bufferObjectSizes)
+                for (auto const stdoutFastPipe: channels)
+                    for (auto const sessions: sessionCounts)
+                        configs.push_back(PtyBenchConfig {
+                            readSize, bufferObjectSize, stdoutFastPipe, static_cast<unsigned>(sessions) });
+        if (configs.empty())
+        {
+            cerr << "No benchmark configurations specified.\n";
+            return EXIT_FAILURE;
+        }
+
+        auto const title = fmt::format("PTY benchmark ({} configurations, {} ms each, {} probes)",
+                                       configs.size(),
+                                       benchTime.count(),
+                                       probeCount);
+        cout << title << '\n' << string(title.size(), '=') << "\n\n";
+        cout << fmt::format("{:>10} {:>14} {:>9} {:>8} {:>14} {:>12} {:>12} {:>12}\n",
+                            "read size",
+                            "buffer object",
+                            "channel",
+                            "sessions",
+                            "throughput",
+                            "p50 latency",
+                            "p99 latency",
+                            "max latency");
+
+        auto results = std::vector<PtyBenchResult> {};
+        for (auto const& config: configs)
+        {
+            auto const& result = results.emplace_back(benchPtyConfig(config, benchTime, probeCount));
+            cout << fmt::format("{:>10} {:>14} {:>9} {:>8} {:>12}/s {:>12} {:>12} {:>12}\n",
+                                crispy::humanReadableBytes(config.readSize),
+                                crispy::humanReadableBytes(config.bufferObjectSize),
+                                config.stdoutFastPipe ? "fastpipe" : "pty",
+                                config.sessions,
+                                crispy::humanReadableBytes(perSecond(result.bytes, result.elapsed)),
+                                formatLatency(percentile(result.latencies, 0.5)),
+                                formatLatency(percentile(result.latencies, 0.99)),
+                                formatLatency(result.latencies.empty() ? std::chrono::nanoseconds {}
+                                                                       : result.latencies.back()));
+        }
+
+        if (auto const& jsonPath = flags.str("bench-headless.pty.json"); !jsonPath.empty())
+        {
+            auto json = std::string { "[\n" };
+            for (auto const& result: results)
             {
-                auto const readResult = pty.read(*bufferObject, std::chrono::seconds(2), PtyReadSize);
-                if (!readResult)
-                    break;
-                auto const dataChunk = get<string_view>(readResult.value());
-                if (dataChunk.empty())
-                    break;
-                bytesTransferred += dataChunk.size();
-                loopIterations++;
+                auto const micros = [](std::chrono::nanoseconds duration) {
+                    return std::chrono::duration<double, std::micro>(duration).count();
+                };
+                json += fmt::format(
+                    "  {{\"readSize\": {}, \"bufferObjectSize\": {}, \"stdoutFastPipe\": {}, "
+                    "\"sessions\": {}, "
+                    "\"bytes\": {}, \"seconds\": {:.3f}, \"bytesPerSecond\": {:.0f}, "
+                    "\"latencyMicroseconds\": {{\"p50\": {:.1f}, \"p99\": {:.1f}, \"max\": {:.1f}}}}}{}\n",
+                    result.config.readSize,
+                    result.config.bufferObjectSize,
+                    result.config.stdoutFastPipe,
+                    result.config.sessions,
+                    result.bytes,
+                    std::chrono::duration<double>(result.elapsed).count(),
+                    static_cast<double>(perSecond(result.bytes, result.elapsed)),
+                    micros(percentile(result.latencies, 0.5)),
+                    micros(percentile(result.latencies, 0.99)),
+                    micros(result.latencies.empty() ? std::chrono::nanoseconds {} : result.latencies.back()),
+                    &result == &results.back() ? "" : ",");
             }
-        } };
-        auto cleanupReader = crispy::finally { [&]() {
-            pty.close();
-            ptyStdoutReaderThread.join();
-        } };
+            json += "]\n";
+
+            if (!writeJson(jsonPath, json))
+                return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int benchReplay()
+    {
+        auto const& flags = parameters();
+        if (flags.verbatim.empty())
+        {
+            cerr << "No recordings specified.\n";
+            return EXIT_FAILURE;
+        }
+
+        auto const pageSize =
+            vtbackend::PageSize { vtbackend::LineCount::cast_from(flags.uint("bench-headless.replay.lines")),
+                                  vtbackend::ColumnCount::cast_from(flags.uint("bench-headless.replay.columns")) };
+        auto const maxHistoryLineCount =
+            vtbackend::LineCount::cast_from(flags.uint("bench-headless.replay.history"));
+        auto const readSize = std::max(size_t { 1 }, size_t { flags.uint("bench-headless.replay.read-size") });
+        auto const frameSize = size_t { flags.uint("bench-headless.replay.frame-size") };
+        auto const repeatCount = std::max(1u, flags.uint("bench-headless.replay.repeat"));
+
+        for (auto const& fileName: flags.verbatim)
+        {
+            auto const recording = readRecording(std::string(fileName));
+            if (!recording)
+            {
+                cerr << fmt::format("Could not read recording: {}\n", fileName);
+                return EXIT_FAILURE;
+            }
+            auto const replaySize = recording->size() * repeatCount;
+
+            // Phase 1: parser only, also counting the sequences contained in the recording.
+            auto counter = SequenceCounter {};
+            auto parser = vtparser::Parser<vtparser::ParserEvents> { counter };
+            auto const parseTime = measure([&]() {
+                for (unsigned i = 0; i < repeatCount; ++i)
+                    parser.parseFragment(*recording);
+            });
+
+            // Phase 2 and 3: full terminal (parser and screen), and render buffer updates.
+            auto vt = vtbackend::MockTerm<vtpty::MockViewPty>(pageSize, maxHistoryLineCount, readSize);
+            auto& pty = vt.mockPty();
+            auto terminalTime = std::chrono::nanoseconds(0);
+            auto renderTime = std::chrono::nanoseconds(0);
+            auto frameCount = uint64_t { 0 };
+            for (unsigned i = 0; i < repeatCount; ++i)
+            {
+                auto input = string_view(*recording);
+                while (!input.empty())
+                {
+                    auto const chunk = input.substr(0, frameSize ? frameSize : input.size());
+                    input.remove_prefix(chunk.size());
+                    terminalTime += measure([&]() {
+                        pty.setReadData(chunk);
+                        while (!pty.stdoutBuffer().empty())
+                            vt.terminal.processInputOnce();
+                    });
+                    if (frameSize)
+                    {
+                        renderTime += measure([&]() { vt.terminal.refreshRenderBuffer(); });
+                        ++frameCount;
+                    }
+                }
+            }
+
+            auto const sequenceCount = counter.sequences;
+            auto const title = fmt::format("Replay: {}", fileName);
+            cout << title << '\n' << string(title.size(), '=') << '\n';
+            cout << fmt::format("{:>22}: {} x {}\n",
+                                "recording size",
+                                crispy::humanReadableBytes(recording->size()),
+                                repeatCount);
+            cout << fmt::format("{:>22}: {}\n", "VT sequences", sequenceCount);
+            cout << fmt::format("{:>22}: {}\n", "text runs", counter.textRuns);
+            cout << fmt::format("{:>22}: {} ({}/s, {:.0f} sequences/s)\n",
+                                "parser only",
+                                formatDuration(parseTime),
+                                crispy::humanReadableBytes(perSecond(replaySize, parseTime)),
+                                static_cast<double>(perSecond(sequenceCount, parseTime)));
+            cout << fmt::format(
+                "{:>22}: {} ({}/s, {:.0f} sequences/s)\n",
+                "terminal",
+                formatDuration(terminalTime),
+                crispy::humanReadableBytes(perSecond(replaySize, terminalTime)),
+                static_cast<double>(perSecond(sequenceCount, terminalTime)));
+            cout << fmt::format("{:>22}: {}\n",
+                                "screen (w/o parser)",
+                                formatDuration(std::max(terminalTime - parseTime, std::chrono::nanoseconds(0))));
+            if (frameCount)
+                cout << fmt::format("{:>22}: {} ({} frames, {} per frame)\n",
+                                    "render buffer",
+                                    formatDuration(renderTime),
+                                    frameCount,
+                                    formatDuration(renderTime / frameCount));
+            cout << fmt::format("{:>22}: {}\n\n", "total", formatDuration(terminalTime + renderTime));
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int benchMulti()
+    {
+        auto const& flags = parameters();
+        auto const pageSize = vtbackend::PageSize {
+            vtbackend::LineCount::cast_from(flags.uint("bench-headless.multi.lines")),
+            vtbackend::ColumnCount::cast_from(flags.uint("bench-headless.multi.columns")),
+        };
+        auto const maxHistoryLineCount =
+            vtbackend::LineCount::cast_from(flags.uint("bench-headless.multi.history"));
+        auto const readSize = std::max(size_t { 1 }, size_t { flags.uint("bench-headless.multi.read-size") });
+
+        // A single session is always measured first, as the baseline of the scaling efficiency.
+        auto sessionCounts = parseSizes(flags.str("bench-headless.multi.sessions"), 1);
+        sessionCounts.push_back(1);
+        std::sort(sessionCounts.begin(), sessionCounts.end());
+        sessionCounts.erase(std::unique(sessionCounts.begin(), sessionCounts.end()), sessionCounts.end());
+        sessionCounts.erase(std::remove(sessionCounts.begin(), sessionCounts.end(), 0), sessionCounts.end());
+
+        auto options = benchOptionsFor("multi");
+        selectDefaultTests(options);
+        auto const tests = recordBenchTests(options);
+
+        auto const title =
+            fmt::format("Multi-session benchmark ({} MB per test and session, {} hardware threads)",
+                        options.testSizeMB,
+                        std::thread::hardware_concurrency());
+        cout << title << '\n' << string(title.size(), '=') << "\n\n";
+        cout << fmt::format("{:<18} {:>8} {:>14} {:>14} {:>14} {:>14} {:>8} {:>10}\n",
+                            "test",
+                            "sessions",
+                            "aggregate",
+                            "p50 session",
+                            "slowest",
+                            "fastest",
+                            "fairness",
+                            "efficiency");
+
+        auto results = std::vector<MultiSessionResult> {};
+        auto baselines = std::vector<long double>(tests.size()); // aggregate throughput of a single session
+        for (auto const sessionCount: sessionCounts)
+        {
+            // Created up front, as sessions are, such that only processing their output runs concurrently.
+            auto terminals = std::vector<std::unique_ptr<MultiSessionTerminal>> {};
+            for (size_t i = 0; i < sessionCount; ++i)
+            {
+                auto& vt = *terminals.emplace_back(
+                    std::make_unique<MultiSessionTerminal>(pageSize, maxHistoryLineCount, readSize));
+                vt.terminal.setMode(vtbackend::DECMode::AutoWrap, true);
+            }
+
+            for (size_t testIndex = 0; testIndex < tests.size(); ++testIndex)
+            {
+                auto const& result = results.emplace_back(benchSessions(terminals, tests[testIndex]));
+                auto const throughput = aggregateThroughput(result);
+                if (sessionCount == 1)
+                    baselines[testIndex] = throughput;
+                auto const perSession = [&](std::chrono::nanoseconds time) {
+                    return fmt::format("{}/s", crispy::humanReadableBytes(perSecond(result.bytes, time)));
+                };
+                cout << fmt::format(
+                    "{:<18} {:>8} {:>14} {:>14} {:>14} {:>14} {:>8.3f} {:>8.1f} %\n",
+                    result.test,
+                    result.sessions,
+                    fmt::format("{}/s", crispy::humanReadableBytes(throughput)),
+                    perSession(percentile(result.sessionTimes, 0.5)),
+                    perSession(result.sessionTimes.back()),
+                    perSession(result.sessionTimes.front()),
+                    fairnessIndex(result),
+                    static_cast<double>(throughput / (baselines[testIndex] * sessionCount)) * 100);
+            }
+            cout << '\n';
+        }
+
+        if (!options.jsonPath.empty())
+        {
+            auto json = std::string { "[\n" };
+            for (auto const& result: results)
+            {
+                auto const testIndex = static_cast<size_t>(&result - results.data()) % tests.size();
+                auto const throughput = aggregateThroughput(result);
+                json += fmt::format(
+                    "  {{\"test\": \"{}\", \"sessions\": {}, \"bytesPerSession\": {}, \"seconds\": {:.6f}, "
+                    "\"bytesPerSecond\": {:.0f}, \"slowestSessionBytesPerSecond\": {:.0f}, "
+                    "\"fairness\": {:.4f}, \"scalingEfficiency\": {:.4f}}}{}\n",
+                    result.test,
+                    result.sessions,
+                    result.bytes,
+                    std::chrono::duration<double>(result.elapsed).count(),
+                    static_cast<double>(throughput),
+                    static_cast<double>(perSecond(result.bytes, result.sessionTimes.back())),
+                    fairnessIndex(result),
+                    static_cast<double>(throughput / (baselines[testIndex] * result.sessions)),
+                    &result == &results.back() ? "" : ",");
+            }
+            json += "]\n";
+
+            if (!writeJson(options.jsonPath, json))
+                return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int benchRender()
+    {
+        auto const& flags = parameters();
+        auto const pageSize =
+            vtbackend::PageSize { vtbackend::LineCount::cast_from(flags.uint("bench-headless.render.lines")),
+                                  vtbackend::ColumnCount::cast_from(flags.uint("bench-headless.render.columns")) };
+        auto const frameCount = std::max(1u, flags.uint("bench-headless.render.frames"));
+        auto const frameSize =
+            std::max(size_t { 1 }, size_t { flags.uint("bench-headless.render.frame-size") });
+        auto const dpi = static_cast<int>(flags.uint("bench-headless.render.dpi"));
+        auto threadPool = std::optional<crispy::thread_pool> {};
+        if (flags.boolean("bench-headless.render.software"))
+            threadPool.emplace();
+
+        auto fonts = vtrasterizer::FontDescriptions {};
+        fonts.dpi = text::DPI { dpi, dpi };
+        fonts.size = text::font_size { static_cast<double>(flags.uint("bench-headless.render.font-size")) };
+        fonts.regular = text::font_description::parse(flags.str("bench-headless.render.font"));
+        fonts.bold = fonts.regular;
+        fonts.bold.weight = text::font_weight::bold;
+        fonts.italic = fonts.regular;
+        fonts.italic.slant = text::font_slant::italic;
+        fonts.boldItalic = fonts.bold;
+        fonts.boldItalic.slant = text::font_slant::italic;
+        fonts.emoji.familyName = "emoji";
+        fonts.emoji.spacing = text::font_spacing::mono;
+        fonts.renderMode = text::render_mode::gray;
+
+        auto resourcePool = vtrasterizer::RenderResourcePool {};
+
+        // Renders the frames fed by feed(write), which writes the output of the next frame,
+        // or returns false once done.
+        auto const renderFrames = [&](std::string_view title, auto&& feed) {
+            auto vt = vtbackend::MockTerm<vtpty::MockViewPty>(pageSize, vtbackend::LineCount(4000), 4096);
+            auto& pty = vt.mockPty();
+            auto const write = [&](std::string_view data) {
+                pty.setReadData(data);
+                while (!pty.stdoutBuffer().empty())
+                    vt.terminal.processInputOnce();
+            };
+
+            auto renderTarget = MockRenderTarget {};
+            auto rasterizer = vtrasterizer::SoftwareRenderTarget { threadPool ? &*threadPool : nullptr };
+            if (threadPool)
+                renderTarget.rasterizer = &rasterizer;
+            auto renderer = vtrasterizer::Renderer { pageSize,
+                                                     fonts,
+                                                     resourcePool,
+                                                     vt.terminal.colorPalette(),
+                                                     crispy::strong_hashtable_size { 4096 },
+                                                     crispy::lru_capacity { 4000 },
+                                                     64 * 1024 * 1024,
+                                                     true,
+                                                     vtrasterizer::Decorator::DottedUnderline,
+                                                     vtrasterizer::Decorator::Underline };
+            renderer.setRenderTarget(renderTarget);
+            renderTarget.setRenderSize(vtbackend::ImageSize {
+                vtbackend::Width::cast_from(unbox(renderer.cellSize().width) * unbox(pageSize.columns)),
+                vtbackend::Height::cast_from(unbox(renderer.cellSize().height) * unbox(pageSize.lines)) });
+
+            // The first frame fills the caches of the text shaper and the texture atlas.
+            (void) feed(write);
+            auto const firstFrameTime = measure([&]() { renderer.render(vt.terminal, false); });
+            auto const firstFrameUploads = renderTarget.tileUploads;
+
+            auto stats = vtrasterizer::RenderStats {};
+            auto const renderAllocationsBefore = renderer.allocationStats().total;
+            auto const frameAllocationsBefore = vt.terminal.allocationStats().frames.total;
+            renderer.setRenderStats(&stats);
+            renderTarget.resetCounters();
+            while (feed(write))
+                renderer.render(vt.terminal, false);
+            renderer.setRenderStats(nullptr);
+
+            auto const heading = fmt::format("Render: {} ({}, {} font, cell size {})",
+                                             title,
+                                             pageSize,
+                                             fonts.size,
+                                             renderer.cellSize());
+            cout << heading << '\n' << string(heading.size(), '=') << '\n';
+            cout << fmt::format("{:>22}: {} ({} tile uploads)\n",
+                                "first frame",
+                                formatDuration(firstFrameTime),
+                                firstFrameUploads);
+            printRenderStats(stats, renderTarget);
+            if constexpr (crispy::allocations_counted)
+            {
+                auto const frames = static_cast<double>(std::max(stats.frames, uint64_t { 1 }));
+                auto const rendered = renderer.allocationStats().total - renderAllocationsBefore;
+                auto const built = vt.terminal.allocationStats().frames.total - frameAllocationsBefore;
+                cout << fmt::format("{:>22}: {:.1f} per frame ({:.1f} of them building the render buffer)\n",
+                                    "allocations",
+                                    static_cast<double>(rendered.count) / frames,
+                                    static_cast<double>(built.count) / frames);
+            }
+        };
+
+        if (flags.verbatim.empty())
+        {
+            for (auto const& screen: BuiltinScreens)
+            {
+                // Each frame shows the document one line further down.
+                auto document = std::vector<std::string> {};
+                for (auto i = 0; i < static_cast<int>(frameCount) + unbox<int>(pageSize.lines); ++i)
+                    document.emplace_back(screen.line(i, unbox<int>(pageSize.columns)));
+
+                auto frame = 0u;
+                renderFrames(screen.name, [&](auto const& write) {
+                    if (frame > frameCount)
+                        return false;
+                    auto page = std::string { "\033[H" };
+                    for (auto line = 0; line < unbox<int>(pageSize.lines); ++line)
+                    {
+                        if (line)
+                            page += "\r\n";
+                        page += document[frame + static_cast<unsigned>(line)];
+                        page += "\033[K";
+                    }
+                    write(page);
+                    ++frame;
+                    return true;
+                });
+            }
+            return EXIT_SUCCESS;
+        }
+
+        for (auto const& fileName: flags.verbatim)
+        {
+            auto const recording = readRecording(std::string(fileName));
+            if (!recording)
+            {
+                cerr << fmt::format("Could not read recording: {}\n", fileName);
+                return EXIT_FAILURE;
+            }
+            auto input = std::string_view(*recording);
+            renderFrames(fileName, [&](auto const& write) {
+                if (input.empty())
+                    return false;
+                auto const chunk = input.substr(0, frameSize);
+                input.remove_prefix(chunk.size());
+                write(chunk);
+                return true;
+            });
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+#if !defined(_WIN32)
+    int echo() { return runEcho(parameters().boolean("bench-headless.echo.batched")); }
+
+    int benchLatency()
+    {
+        auto const& flags = parameters();
+        auto const probeCount = flags.uint("bench-headless.latency.probes");
+        auto const readSizes = parseSizes(flags.str("bench-headless.latency.read-sizes"), 1);
+        auto refreshRates = std::vector<double> {};
+        for (auto const rate: parseSizes(flags.str("bench-headless.latency.refresh-rates"), 1))
+            refreshRates.push_back(static_cast<double>(rate));
+        auto batchedModes = std::vector<bool> { false };
+        if (flags.boolean("bench-headless.latency.batched"))
+            batchedModes.push_back(true);
 
-        // Perform benchmark
-        fmt::print("Running PTY benchmark ...\n");
-        auto const startTime = steady_clock::now();
-        auto stopTime = startTime;
-        while (stopTime - startTime < benchTime)
+        auto configs = std::vector<LatencyBenchConfig> {};
+        for (auto const refreshRate: refreshRates)
+            for (auto const batched: batchedModes)
+                for (auto const readSize: readSizes)
+                    configs.push_back(LatencyBenchConfig { refreshRate, batched, readSize });
+        if (configs.empty())
         {
-            for (int i = 0; i < WritesPerLoop; ++i)
-                (void) ptySlave.write(text);
-            stopTime = steady_clock::now();
+            cerr << "No benchmark configurations specified.\n";
+            return EXIT_FAILURE;
         }
 
-        cleanupReader.run();
-
-        // Create summary
-        auto const elapsedTime = stopTime - startTime;
-        auto const msecs = std::chrono::duration_cast<std::chrono::milliseconds>(elapsedTime);
-        auto const secs = std::chrono::duration_cast<std::chrono::seconds>(elapsedTime);
-        auto const mbPerSecs =
-            static_cast<long double>(bytesTransferred) / static_cast<long double>(secs.count());
-
-        fmt::print("\n");
-        fmt::print("PTY stdout throughput bandwidth test\n");
-        fmt::print("====================================\n\n");
-        fmt::print("Writes per loop        : {}\n", WritesPerLoop);
-        fmt::print("PTY write size         : {}\n", PtyWriteSize);
-        fmt::print("PTY read size          : {}\n", PtyReadSize);
-        fmt::print("Test time              : {}.{:03} seconds\n", msecs.count() / 1000, msecs.count() % 1000);
-        fmt::print("Data transferred       : {}\n", crispy::humanReadableBytes(bytesTransferred));
-        fmt::print("Reader loop iterations : {}\n", loopIterations);
-        fmt::print("Average size per read  : {}\n",
-                   crispy::humanReadableBytes(static_cast<long double>(bytesTransferred)
-                                              / static_cast<long double>(loopIterations)));
-        fmt::print("Transfer speed         : {} per second\n", crispy::humanReadableBytes(mbPerSecs));
+        auto const title =
+            fmt::format("Keystroke latency ({} configurations, {} keys each)", configs.size(), probeCount);
+        cout << title << '\n' << string(title.size(), '=') << "\n\n";
+        cout << fmt::format("{:>8} {:>8} {:>10} {:>12} {:>12} {:>12} {:>12} {:>12} {:>9}\n",
+                            "refresh",
+                            "batched",
+                            "read size",
+                            "p50 written",
+                            "p50 parsed",
+                            "p50 visible",
+                            "p99 visible",
+                            "max visible",
+                            "timeouts");
+
+        auto results = std::vector<LatencyBenchResult> {};
+        for (auto const& config: configs)
+        {
+            auto const& result = results.emplace_back(benchLatencyConfig(config, probeCount));
+            cout << fmt::format("{:>6} Hz {:>8} {:>10} {:>12} {:>12} {:>12} {:>12} {:>12} {:>9}\n",
+                                config.refreshRate,
+                                config.batched ? "yes" : "no",
+                                crispy::humanReadableBytes(config.readSize),
+                                formatLatency(percentile(result.written, 0.5)),
+                                formatLatency(percentile(result.parsed, 0.5)),
+                                formatLatency(percentile(result.visible, 0.5)),
+                                formatLatency(percentile(result.visible, 0.99)),
+                                formatLatency(result.visible.empty() ? std::chrono::nanoseconds {}
+                                                                     : result.visible.back()),
+                                result.timeouts);
+        }
+
+        // Histogram of the key-to-visible latency, with bucket upper bounds in milliseconds.
+        static constexpr auto Buckets = std::array { 0.5, 1.0, 2.0, 4.0, 8.0, 16.0, 33.0, 50.0, 100.0 };
+        cout << "\nKey-to-visible latency histogram (number of keys per bucket)\n\n";
+        cout << fmt::format("{:>8} {:>8} {:>10}", "refresh", "batched", "read size");
+        for (auto const bound: Buckets)
+            cout << fmt::format(" {:>7}", fmt::format("<{}ms", bound));
+        cout << fmt::format(" {:>7}\n", fmt::format(">{}ms", Buckets.back()));
+        for (auto const& result: results)
+        {
+            auto counts = std::array<size_t, Buckets.size() + 1> {};
+            for (auto const latency: result.visible)
+            {
+                auto const ms = std::chrono::duration<double, std::milli>(latency).count();
+                auto const bucket = std::find_if(Buckets.begin(), Buckets.end(), [&](double bound) {
+                    return ms < bound;
+                });
+                ++counts[static_cast<size_t>(std::distance(Buckets.begin(), bucket))];
+            }
+            cout << fmt::format("{:>6} Hz {:>8} {:>10}",
+                                result.config.refreshRate,
+                                result.config.batched ? "yes" : "no",
+                                crispy::humanReadableBytes(result.config.readSize));
+            for (auto const count: counts)
+                cout << fmt::format(" {:>7}", count);
+            cout << '\n';
+        }
+
+        return EXIT_SUCCESS;
+    }
+#endif
+
+    int benchMemory()
+    {
+        auto const& flags = parameters();
+        auto const pageSize =
+            vtbackend::PageSize { vtbackend::LineCount::cast_from(flags.uint("bench-headless.memory.lines")),
+                                  vtbackend::ColumnCount::cast_from(flags.uint("bench-headless.memory.columns")) };
+        auto const historyLines = static_cast<int>(flags.uint("bench-headless.memory.history"));
+        auto const& content = flags.str("bench-headless.memory.content");
+
+        auto const bytes = [](std::optional<long double> count) {
+            return count ? crispy::humanReadableBytes(*count) : "n/a"s;
+        };
+        auto const delta = [](auto const& before,
+                              auto const& after,
+                              auto member) -> std::optional<long double> {
+            if (!before || !after)
+                return std::nullopt;
+            return static_cast<long double>(member(*after)) - static_cast<long double>(member(*before));
+        };
+
+        for (auto const& workload: MemoryWorkloads)
+        {
+            if (content.find(workload.name) == std::string::npos)
+                continue;
+
+            vtbackend::releaseUnusedCellExtras();
+            auto const heapBefore = heapUsage();
+            auto const rssBefore = residentSetSize();
+            auto const extrasBefore = vtbackend::cellExtraPoolStats();
+
+            auto vt = vtbackend::MockTerm<vtpty::MockViewPty>(
+                pageSize, vtbackend::LineCount::cast_from(historyLines), 4096);
+            auto& pty = vt.mockPty();
+            auto const lineCount = historyLines + unbox<int>(pageSize.lines);
+            auto const fillTime = measure([&]() {
+                auto chunk = std::string {};
+                for (auto i = 0; i < lineCount; ++i)
+                {
+                    chunk += workload.line(i, unbox<int>(pageSize.columns));
+                    chunk += "\r\n";
+                    if (chunk.size() >= 64 * 1024 || i + 1 == lineCount)
+                    {
+                        pty.setReadData(chunk);
+                        while (!pty.stdoutBuffer().empty())
+                            vt.terminal.processInputOnce();
+                        chunk.clear();
+                    }
+                }
+            });
+
+            auto const heapAfter = heapUsage();
+            auto const rssAfter = residentSetSize();
+            auto const extras = vtbackend::cellExtraPoolStats();
+            auto const grid = vt.terminal.primaryScreen().grid().memoryStats();
+            auto const ptyBuffers = vt.terminal.ptyBufferStats();
+            auto const& images = vt.terminal.imagePoolStats();
+
+            auto const heapInUse = delta(heapBefore, heapAfter, [](HeapUsage u) { return u.inUse; });
+            auto const heapReserved = delta(heapBefore, heapAfter, [](HeapUsage u) { return u.reserved; });
+            auto const rss = delta(rssBefore, rssAfter, [](uint64_t value) { return value; });
+            auto const perLine = [](std::optional<long double> total,
+                                    size_t count) -> std::optional<long double> {
+                if (!total)
+                    return std::nullopt;
+                return *total / static_cast<long double>(std::max(count, size_t { 1 }));
+            };
+
+            auto const title =
+                fmt::format("Memory: {} ({} history lines, {})", workload.name, historyLines, pageSize);
+            cout << title << '\n' << string(title.size(), '=') << '\n';
+            cout << fmt::format("{:>22}: {}\n", "fill time", formatDuration(fillTime));
+            cout << fmt::format("{:>22}: {} ({} trivial, {} inflated)\n",
+                                "lines",
+                                grid.lines(),
+                                grid.trivialLines,
+                                grid.inflatedLines);
+            auto const trivialBytes = grid.trivialLineBytes + grid.trivialTextBytes;
+            cout << fmt::format("{:>22}: {} ({} text), {} per line\n",
+                                "trivial lines",
+                                bytes(trivialBytes),
+                                bytes(grid.trivialTextBytes),
+                                bytes(perLine(trivialBytes, grid.trivialLines)));
+            cout << fmt::format("{:>22}: {}, {} per line\n",
+                                "inflated lines",
+                                bytes(grid.inflatedLineBytes),
+                                bytes(perLine(grid.inflatedLineBytes, grid.inflatedLines)));
+            cout << fmt::format("{:>22}: {} in inflated lines, {} more in use, {} reserved in total\n",
+                                "cell extras",
+                                grid.cellExtras,
+                                extras.extrasInUse - std::min(extras.extrasInUse, extrasBefore.extrasInUse),
+                                bytes(extras.bytesReserved));
+            cout << fmt::format("{:>22}: {} reserved, {} used\n",
+                                "cell pool",
+                                bytes(grid.cellPoolBytes),
+                                bytes(grid.cellPoolUsedBytes));
+            cout << fmt::format("{:>22}: {}\n", "retired line buffers", bytes(grid.retiredLineBytes));
+            cout << fmt::format("{:>22}: {} pinned, {} unused, {} spilled (scrollback text)\n",
+                                "buffer fragments",
+                                bytes(grid.scrollbackText.pinnedBytes),
+                                bytes(grid.scrollbackText.unusedBytes),
+                                bytes(grid.spilledBytes));
+            cout << fmt::format("{:>22}: {} pinned, {} unused (PTY buffers)\n",
+                                "",
+                                bytes(ptyBuffers.pinnedBytes),
+                                bytes(ptyBuffers.unusedBytes));
+            cout << fmt::format("{:>22}: {} images, {}\n", "image pool", images.images, bytes(images.bytes));
+            cout << fmt::format("{:>22}: {}, {} per line\n",
+                                "heap in use",
+                                bytes(heapInUse),
+                                bytes(perLine(heapInUse, grid.lines())));
+            cout << fmt::format("{:>22}: {}\n",
+                                "allocator overhead",
+                                bytes(heapInUse && heapReserved ? std::optional { *heapReserved - *heapInUse }
+                                                                : std::nullopt));
+            cout << fmt::format("{:>22}: {}, {} per line\n\n",
+                                "RSS growth",
+                                bytes(rss),
+                                bytes(perLine(rss, grid.lines())));
+        }
 
         return EXIT_SUCCESS;
     }
 
+    int benchCompare()
+    {
+        auto const& flags = parameters();
+        if (flags.verbatim.size() != 2)
+        {
+            cerr << "Expected exactly two result files to compare.\n";
+            return EXIT_FAILURE;
+        }
+        return compareBenchResults(std::string(flags.verbatim[0]),
+                                   std::string(flags.verbatim[1]),
+                                   flags.real("bench-headless.compare.threshold"));
+    }
+
     int benchParserOnly()
     {
         auto po = vtparser::NullParserEvents {};
@@ -311,6 +2470,10 @@ int main(int argc, char const* argv[])
 {
     srand(static_cast<unsigned int>(time(nullptr))); // initialize rand(). No strong seed required.
 
+#if !defined(_WIN32)
+    programPath = argv[0];
+#endif
+
     ContourHeadlessBench app;
     return app.run(argc, argv);
 }
@@ -2,11 +2,17 @@
 #pragma once
 
 #include <vtbackend/cell/CompactCell.h>
+#include <vtbackend/cell/FlatCell.h>
 #include <vtbackend/cell/SimpleCell.h>
 
 namespace vtbackend
 {
 
+// Any of CompactCell, FlatCell, or SimpleCell may be chosen below.
+// CompactCell uses the least memory for plain text, whereas FlatCell avoids heap allocations
+// (and the indirection that comes with them) for styled and wide text, at the cost of 4 more bytes per cell.
+// Use `bench-headless meta grid` to compare them.
+
 /// Type of cell to be used with the primary screen.
 using PrimaryScreenCell = CompactCell;
 
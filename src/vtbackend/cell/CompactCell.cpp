@@ -1,9 +1,64 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <vtbackend/cell/CompactCell.h>
 
+#include <crispy/slab_resource.h>
+
+#include <mutex>
+
 namespace vtbackend
 {
 
+namespace
+{
+    constexpr size_t ExtrasPerSlab = 256;
+
+    /// The pool shared by the cells of all grids, as cells are free to be copied across grids and threads.
+    struct CellExtraPool
+    {
+        std::mutex lock;
+        crispy::slab_resource slabs { sizeof(CellExtra), ExtrasPerSlab };
+    };
+
+    CellExtraPool& cellExtraPool()
+    {
+        // Intentionally never destroyed, as cells may outlive static destruction (e.g. in global objects).
+        static auto* pool = new CellExtraPool(); // NOLINT(cppcoreguidelines-owning-memory)
+        return *pool;
+    }
+} // namespace
+
+void* CellExtra::operator new(std::size_t size)
+{
+    auto& pool = cellExtraPool();
+    auto const _ = std::lock_guard { pool.lock };
+    return pool.slabs.allocate(size, alignof(CellExtra));
+}
+
+void CellExtra::operator delete(void* p, std::size_t size) noexcept
+{
+    auto& pool = cellExtraPool();
+    auto const _ = std::lock_guard { pool.lock };
+    pool.slabs.deallocate(p, size, alignof(CellExtra));
+}
+
+CellExtraPoolStats cellExtraPoolStats() noexcept
+{
+    auto& pool = cellExtraPool();
+    auto const _ = std::lock_guard { pool.lock };
+    return CellExtraPoolStats {
+        .extrasInUse = pool.slabs.blocks_in_use(),
+        .slabCount = pool.slabs.slab_count(),
+        .bytesReserved = pool.slabs.bytes_reserved(),
+    };
+}
+
+void releaseUnusedCellExtras()
+{
+    auto& pool = cellExtraPool();
+    auto const _ = std::lock_guard { pool.lock };
+    pool.slabs.release_unused();
+}
+
 std::u32string CompactCell::codepoints() const
 {
     std::u32string s;
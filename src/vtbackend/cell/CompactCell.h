@@ -7,6 +7,7 @@
 #include <vtbackend/GraphicsAttributes.h>
 #include <vtbackend/Hyperlink.h>
 #include <vtbackend/Image.h>
+#include <vtbackend/UnicodeTable.h>
 #include <vtbackend/primitives.h>
 
 #include <crispy/Owned.h>
@@ -15,7 +16,6 @@
 
 #include <libunicode/capi.h>
 #include <libunicode/convert.h>
-#include <libunicode/width.h>
 
 #include <memory>
 #include <string>
@@ -37,6 +37,9 @@ struct CellExtra
     ///
     /// Since MOST content in the terminal is US-ASCII, all codepoints except the first one of a grapheme
     /// cluster is stored in CellExtra.
+    ///
+    /// Short clusters (such as an emoji with its variation selector) fit into the string's inline buffer,
+    /// and thus do not require any further allocation.
     std::u32string codepoints = {};
 
     /// Color for underline decoration (such as curly underline).
@@ -56,8 +59,25 @@ struct CellExtra
     /// Since most graphical characters in a terminal will be US-ASCII, this width property
     /// will be only used when NOT being 1.
     uint8_t width = 1;
+
+    // CellExtra records are served from a shared slab pool rather than individually from the heap.
+    [[nodiscard]] static void* operator new(std::size_t size);
+    static void operator delete(void* p, std::size_t size) noexcept;
+};
+
+/// Usage statistics of the slab pool that all CellExtra records are allocated from.
+struct CellExtraPoolStats
+{
+    size_t extrasInUse = 0;
+    size_t slabCount = 0;
+    size_t bytesReserved = 0;
 };
 
+[[nodiscard]] CellExtraPoolStats cellExtraPoolStats() noexcept;
+
+/// Returns the slabs of the CellExtra pool that are not used by any cell anymore back to the system.
+void releaseUnusedCellExtras();
+
 /// Grid cell with character and graphics rendition information.
 ///
 /// TODO(perf): ensure POD'ness so that we can SIMD-copy it.
@@ -130,6 +150,9 @@ class CRISPY_PACKED CompactCell
 
     [[nodiscard]] bool empty() const noexcept;
 
+    /// @returns whether a CellExtra record has been allocated for this cell.
+    [[nodiscard]] bool hasExtra() const noexcept { return static_cast<bool>(_extra); }
+
     void setGraphicsRendition(GraphicsRendition sgr) noexcept;
 
   private:
@@ -194,6 +217,8 @@ inline CompactCell& CompactCell::operator=(CompactCell const& v) noexcept
     _backgroundColor = v._backgroundColor;
     if (v._extra)
         createExtra(*v._extra);
+    else
+        _extra.reset();
     return *this;
 }
 // }}}
@@ -312,7 +337,7 @@ inline void CompactCell::setCharacter(char32_t codepoint) noexcept
         _extra->imageFragment = {};
     }
     if (codepoint)
-        setWidth(static_cast<uint8_t>(std::max(unicode::width(codepoint), 1)));
+        setWidth(static_cast<uint8_t>(std::max(UnicodeTable::width(codepoint), 1)));
     else
         setWidth(1);
 }
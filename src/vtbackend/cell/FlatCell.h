@@ -0,0 +1,338 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <vtbackend/CellFlags.h>
+#include <vtbackend/CellUtil.h>
+#include <vtbackend/Color.h>
+#include <vtbackend/ColorPalette.h>
+#include <vtbackend/GraphicsAttributes.h>
+#include <vtbackend/Hyperlink.h>
+#include <vtbackend/Image.h>
+#include <vtbackend/UnicodeTable.h>
+#include <vtbackend/primitives.h>
+
+#include <crispy/Owned.h>
+#include <crispy/times.h>
+
+#include <libunicode/convert.h>
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <string>
+
+namespace vtbackend
+{
+
+/// Rarely needed extra cell data of a FlatCell.
+struct FlatCellExtra
+{
+    static uint8_t constexpr MaxCodepoints = 7;
+
+    /// The codepoints following the primary one, forming a grapheme cluster with it.
+    std::u32string codepoints = {};
+
+    Color underlineColor = DefaultColor();
+    HyperlinkId hyperlink = {};
+    std::shared_ptr<ImageFragment> imageFragment = nullptr;
+};
+
+/// Grid cell keeping all data that is needed for text and color passes in place.
+///
+/// Unlike CompactCell, which moves the width and the flags out into its (heap allocated) CellExtra
+/// as soon as they differ from their defaults, this cell stores the primary codepoint, width, flags,
+/// and colors inline, packed into 16 bytes. So neither wide characters nor SGR styled text
+/// (e.g. bold compiler diagnostics) cause per-cell allocations, nor pointer chasing when rendering.
+/// Only grapheme clusters, underline colors, hyperlinks, and images require FlatCellExtra.
+class FlatCell
+{
+  public:
+    FlatCell() noexcept = default;
+    explicit FlatCell(GraphicsAttributes attributes, HyperlinkId hyperlink = {}) noexcept;
+    FlatCell(FlatCell const& v) noexcept;
+    FlatCell& operator=(FlatCell const& v) noexcept;
+    FlatCell(FlatCell&&) noexcept = default;
+    FlatCell& operator=(FlatCell&&) noexcept = default;
+    ~FlatCell() = default;
+
+    void reset() noexcept;
+    void reset(GraphicsAttributes const& attributes) noexcept;
+    void reset(GraphicsAttributes const& attributes, HyperlinkId hyperlink) noexcept;
+
+    void write(GraphicsAttributes const& attributes, char32_t ch, uint8_t width) noexcept;
+    void write(GraphicsAttributes const& attributes,
+               char32_t ch,
+               uint8_t width,
+               HyperlinkId hyperlink) noexcept;
+    void writeTextOnly(char32_t ch, uint8_t width) noexcept;
+
+    [[nodiscard]] std::u32string codepoints() const;
+    [[nodiscard]] char32_t codepoint(size_t i) const noexcept;
+    [[nodiscard]] std::size_t codepointCount() const noexcept;
+
+    void setCharacter(char32_t codepoint) noexcept;
+    [[nodiscard]] int appendCharacter(char32_t codepoint) noexcept;
+    [[nodiscard]] std::string toUtf8() const;
+
+    [[nodiscard]] uint8_t width() const noexcept { return static_cast<uint8_t>(_text >> WidthShift); }
+    void setWidth(uint8_t width) noexcept;
+
+    [[nodiscard]] CellFlags flags() const noexcept { return _flags; }
+    [[nodiscard]] bool isFlagEnabled(CellFlags testFlags) const noexcept
+    {
+        return _flags.contains(testFlags);
+    }
+    void resetFlags(CellFlags flags = CellFlag::None) noexcept { _flags = flags; }
+
+    void setGraphicsRendition(GraphicsRendition sgr) noexcept
+    {
+        CellUtil::applyGraphicsRendition(sgr, *this);
+    }
+    [[nodiscard]] Color foregroundColor() const noexcept { return _foregroundColor; }
+    void setForegroundColor(Color color) noexcept { _foregroundColor = color; }
+    [[nodiscard]] Color backgroundColor() const noexcept { return _backgroundColor; }
+    void setBackgroundColor(Color color) noexcept { _backgroundColor = color; }
+    [[nodiscard]] Color underlineColor() const noexcept;
+    void setUnderlineColor(Color color) noexcept;
+
+    [[nodiscard]] std::shared_ptr<ImageFragment> imageFragment() const noexcept;
+    void setImageFragment(std::shared_ptr<RasterizedImage> rasterizedImage, CellLocation offset);
+
+    [[nodiscard]] HyperlinkId hyperlink() const noexcept;
+    void setHyperlink(HyperlinkId hyperlink);
+
+    [[nodiscard]] bool empty() const noexcept { return CellUtil::empty(*this); }
+
+  private:
+    // Codepoints take up to 21 bits, leaving the upper 8 bits for the width.
+    static constexpr unsigned WidthShift = 24;
+    static constexpr char32_t CodepointMask = (1u << WidthShift) - 1;
+
+    [[nodiscard]] char32_t primaryCodepoint() const noexcept { return _text & CodepointMask; }
+    void setPrimaryCodepoint(char32_t codepoint) noexcept { _text = (_text & ~CodepointMask) | codepoint; }
+
+    [[nodiscard]] FlatCellExtra& extra();
+
+    char32_t _text = char32_t { 1 } << WidthShift; // primary codepoint and width
+    CellFlags _flags {};
+    Color _foregroundColor = DefaultColor();
+    Color _backgroundColor = DefaultColor();
+    crispy::owned<FlatCellExtra> _extra = {};
+};
+
+// {{{ impl: ctor's
+inline FlatCell::FlatCell(GraphicsAttributes attributes, HyperlinkId hyperlink) noexcept:
+    _flags { attributes.flags },
+    _foregroundColor { attributes.foregroundColor },
+    _backgroundColor { attributes.backgroundColor }
+{
+    setUnderlineColor(attributes.underlineColor);
+    setHyperlink(hyperlink);
+}
+
+inline FlatCell::FlatCell(FlatCell const& v) noexcept:
+    _text { v._text },
+    _flags { v._flags },
+    _foregroundColor { v._foregroundColor },
+    _backgroundColor { v._backgroundColor }
+{
+    if (v._extra)
+        _extra.reset(new FlatCellExtra(*v._extra));
+}
+
+inline FlatCell& FlatCell::operator=(FlatCell const& v) noexcept
+{
+    _text = v._text;
+    _flags = v._flags;
+    _foregroundColor = v._foregroundColor;
+    _backgroundColor = v._backgroundColor;
+    if (v._extra)
+        _extra.reset(new FlatCellExtra(*v._extra));
+    else
+        _extra.reset();
+    return *this;
+}
+// }}}
+// {{{ impl: reset and write
+inline void FlatCell::reset() noexcept
+{
+    *this = FlatCell {};
+}
+
+inline void FlatCell::reset(GraphicsAttributes const& attributes) noexcept
+{
+    *this = FlatCell { attributes };
+}
+
+inline void FlatCell::reset(GraphicsAttributes const& attributes, HyperlinkId hyperlink) noexcept
+{
+    *this = FlatCell { attributes, hyperlink };
+}
+
+inline void FlatCell::write(GraphicsAttributes const& attributes, char32_t ch, uint8_t width) noexcept
+{
+    writeTextOnly(ch, width);
+    if (_extra)
+        _extra->imageFragment = {};
+    _flags = attributes.flags;
+    _foregroundColor = attributes.foregroundColor;
+    _backgroundColor = attributes.backgroundColor;
+    setUnderlineColor(attributes.underlineColor);
+}
+
+inline void FlatCell::write(GraphicsAttributes const& attributes,
+                            char32_t ch,
+                            uint8_t width,
+                            HyperlinkId hyperlink) noexcept
+{
+    write(attributes, ch, width);
+    setHyperlink(hyperlink);
+}
+
+inline void FlatCell::writeTextOnly(char32_t ch, uint8_t width) noexcept
+{
+    _text = ch | (char32_t { width } << WidthShift);
+    if (_extra)
+        _extra->codepoints.clear();
+}
+// }}}
+// {{{ impl: character
+inline std::u32string FlatCell::codepoints() const
+{
+    auto text = std::u32string {};
+    if (auto const codepoint = primaryCodepoint(); codepoint)
+    {
+        text += codepoint;
+        if (_extra)
+            text += _extra->codepoints;
+    }
+    return text;
+}
+
+inline char32_t FlatCell::codepoint(size_t i) const noexcept
+{
+    if (i == 0)
+        return primaryCodepoint();
+    if (!_extra || i > _extra->codepoints.size())
+        return 0;
+    return _extra->codepoints[i - 1];
+}
+
+inline std::size_t FlatCell::codepointCount() const noexcept
+{
+    if (!primaryCodepoint())
+        return 0;
+    return 1 + (_extra ? _extra->codepoints.size() : 0);
+}
+
+inline void FlatCell::setCharacter(char32_t codepoint) noexcept
+{
+    setPrimaryCodepoint(codepoint);
+    if (_extra)
+    {
+        _extra->codepoints.clear();
+        _extra->imageFragment = {};
+    }
+    if (codepoint)
+        setWidth(static_cast<uint8_t>(std::max(UnicodeTable::width(codepoint), 1)));
+    else
+        setWidth(1);
+}
+
+inline int FlatCell::appendCharacter(char32_t codepoint) noexcept
+{
+    assert(codepoint != 0);
+
+    auto& ext = extra();
+    if (ext.codepoints.size() < FlatCellExtra::MaxCodepoints - 1)
+    {
+        ext.codepoints.push_back(codepoint);
+        if (auto const diff = CellUtil::computeWidthChange(*this, codepoint))
+        {
+            setWidth(static_cast<uint8_t>(static_cast<int>(width()) + diff));
+            return diff;
+        }
+    }
+    return 0;
+}
+
+inline std::string FlatCell::toUtf8() const
+{
+    if (!primaryCodepoint())
+        return {};
+
+    auto text = unicode::convert_to<char>(primaryCodepoint());
+    if (_extra)
+        text += unicode::convert_to<char>(std::u32string_view(_extra->codepoints));
+    return text;
+}
+
+inline void FlatCell::setWidth(uint8_t width) noexcept
+{
+    assert(width < 8);
+    _text = primaryCodepoint() | (char32_t { width } << WidthShift);
+}
+// }}}
+// {{{ impl: extra
+inline FlatCellExtra& FlatCell::extra()
+{
+    if (!_extra)
+        _extra.reset(new FlatCellExtra());
+    return *_extra;
+}
+
+inline Color FlatCell::underlineColor() const noexcept
+{
+    return _extra ? _extra->underlineColor : DefaultColor();
+}
+
+inline void FlatCell::setUnderlineColor(Color color) noexcept
+{
+    if (_extra)
+        _extra->underlineColor = color;
+    else if (color != DefaultColor())
+        extra().underlineColor = color;
+}
+
+inline std::shared_ptr<ImageFragment> FlatCell::imageFragment() const noexcept
+{
+    return _extra ? _extra->imageFragment : nullptr;
+}
+
+inline void FlatCell::setImageFragment(std::shared_ptr<RasterizedImage> rasterizedImage, CellLocation offset)
+{
+    extra().imageFragment = std::make_shared<ImageFragment>(std::move(rasterizedImage), offset);
+}
+
+inline HyperlinkId FlatCell::hyperlink() const noexcept
+{
+    return _extra ? _extra->hyperlink : HyperlinkId {};
+}
+
+inline void FlatCell::setHyperlink(HyperlinkId hyperlink)
+{
+    if (!!hyperlink)
+        extra().hyperlink = hyperlink;
+    else if (_extra)
+        _extra->hyperlink = {};
+}
+// }}}
+
+} // namespace vtbackend
+
+template <>
+struct fmt::formatter<vtbackend::FlatCell>: fmt::formatter<std::string>
+{
+    auto format(vtbackend::FlatCell const& cell, format_context& ctx) -> format_context::iterator
+    {
+        std::string codepoints;
+        for (auto const i: crispy::times(cell.codepointCount()))
+        {
+            if (i)
+                codepoints += ", ";
+            codepoints += fmt::format("{:02X}", static_cast<unsigned>(cell.codepoint(i)));
+        }
+        return formatter<std::string>::format(fmt::format("(chars={}, width={})", codepoints, cell.width()),
+                                              ctx);
+    }
+};
@@ -8,9 +8,9 @@
 #include <vtbackend/GraphicsAttributes.h>
 #include <vtbackend/Hyperlink.h>
 #include <vtbackend/Image.h>
+#include <vtbackend/UnicodeTable.h>
 
 #include <libunicode/convert.h>
-#include <libunicode/width.h>
 
 #include <string>
 #include <utility>
@@ -158,7 +158,7 @@ inline void SimpleCell::setCharacter(char32_t codepoint)
     if (codepoint)
     {
         _codepoints.push_back(codepoint);
-        setWidth(static_cast<uint8_t>(std::max(unicode::width(codepoint), 1)));
+        setWidth(static_cast<uint8_t>(std::max(UnicodeTable::width(codepoint), 1)));
     }
     else
         setWidth(1);
@@ -14,9 +14,11 @@ auto const inline vtParserLog = logstore::category("vt.parser",
                                                    logstore::category::visibility::Hidden);
 
 #if defined(LIBTERMINAL_LOG_TRACE)
-auto const inline vtTraceSequenceLog = logstore::category("vt.trace.sequence", "Logs terminal screen trace.");
+auto const inline vtTraceSequenceLog =
+    logstore::trace_category("vt.trace.sequence", "Logs terminal screen trace.");
 #endif
 
 auto const inline renderBufferLog = logstore::category("vt.renderbuffer", "Render Buffer Objects");
+auto const inline imageLog = logstore::category("vt.image", "Logs image pool memory usage and evictions.");
 
 } // namespace vtbackend
@@ -5,19 +5,31 @@
 #include <crispy/assert.h>
 #include <crispy/escape.h>
 #include <crispy/logstore.h>
+#include <crispy/trace.h>
 #include <crispy/utils.h>
 
 #include <libunicode/utf8.h>
 
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cstring>
 #include <string_view>
 #include <tuple>
 
+#if defined(__x86_64__) || defined(_M_AMD64)
+    #include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+#endif
+
 namespace vtparser
 {
 
 auto const inline vtTraceParserLog =
-    logstore::category("vt.trace.parser", "Logs terminal parser instruction trace.");
+    logstore::trace_category("vt.trace.parser", "Logs terminal parser instruction trace.");
 
 namespace
 {
@@ -29,6 +41,80 @@ namespace
     // clang-format on
 } // namespace
 
+namespace detail
+{
+    /// Tests whether the given byte is a printable US-ASCII character (0x20 .. 0x7E).
+    constexpr bool isPrintableAscii(uint8_t ch) noexcept
+    {
+        return 0x20 <= ch && ch < 0x7F;
+    }
+
+    /// Scans the given range for the first byte that is not printable US-ASCII,
+    /// that is, any C0 control (including ESC), DEL, or any byte of a UTF-8 multibyte sequence.
+    ///
+    /// The scan is vectorized, processing 32 (AVX2) or 16 (SSE2, NEON) bytes at a time,
+    /// with a scalar loop for the remaining tail.
+    ///
+    /// @returns pointer to the first non-printable byte or @p end if there is none.
+    inline char const* findFirstNonPrintableAscii(char const* begin, char const* end) noexcept
+    {
+        auto const* input = begin;
+
+#if defined(__AVX2__)
+        auto const controlUpperBound = _mm256_set1_epi8(0x20);
+        auto const del = _mm256_set1_epi8(0x7F);
+        while (end - input >= 32)
+        {
+            auto const batch = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(input));
+            // Signed comparison: bytes >= 0x80 are negative and thus also less than 0x20.
+            auto const nonPrintable =
+                _mm256_or_si256(_mm256_cmpgt_epi8(controlUpperBound, batch), _mm256_cmpeq_epi8(batch, del));
+            auto const mask = static_cast<uint32_t>(_mm256_movemask_epi8(nonPrintable));
+            if (mask)
+                return input + std::countr_zero(mask);
+            input += 32;
+        }
+#endif
+
+#if defined(__SSE2__) || defined(__x86_64__) || defined(_M_AMD64)
+        auto const controlUpperBound128 = _mm_set1_epi8(0x20);
+        auto const del128 = _mm_set1_epi8(0x7F);
+        while (end - input >= 16)
+        {
+            auto const batch = _mm_loadu_si128(reinterpret_cast<__m128i const*>(input));
+            // Signed comparison: bytes >= 0x80 are negative and thus also less than 0x20.
+            auto const nonPrintable =
+                _mm_or_si128(_mm_cmplt_epi8(batch, controlUpperBound128), _mm_cmpeq_epi8(batch, del128));
+            auto const mask = static_cast<uint32_t>(_mm_movemask_epi8(nonPrintable));
+            if (mask)
+                return input + std::countr_zero(mask);
+            input += 16;
+        }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+        auto const controlUpperBound = vdupq_n_u8(0x20);
+        auto const del = vdupq_n_u8(0x7F);
+        while (end - input >= 16)
+        {
+            auto const batch = vld1q_u8(reinterpret_cast<uint8_t const*>(input));
+            auto const nonPrintable = vorrq_u8(vcltq_u8(batch, controlUpperBound), vcgeq_u8(batch, del));
+            if (vmaxvq_u8(nonPrintable))
+            {
+                // Narrow each 8-bit lane to 4 bits, yielding a 64-bit mask with one nibble per byte.
+                auto const mask = vget_lane_u64(
+                    vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(nonPrintable), 4)), 0);
+                return input + (std::countr_zero(mask) / 4);
+            }
+            input += 16;
+        }
+#endif
+
+        while (input != end && isPrintableAscii(static_cast<uint8_t>(*input)))
+            ++input;
+
+        return input;
+    }
+} // namespace detail
+
 struct ParserTable
 {
     //! State transition map from (State, Byte) to (State).
@@ -48,6 +134,39 @@ struct ParserTable
     //! Standard state machine tables parsing VT225 to VT525.
     static constexpr ParserTable get();
 
+    //! Precomputed outcome of feeding a single byte into a given state.
+    struct Entry
+    {
+        State target = State::Undefined; //!< Target state, or Undefined if no transition is taken.
+        Action exit = Action::Undefined;  //!< Action upon leaving the current state (transitions only).
+        Action event = Action::Undefined; //!< Action for the (State, Byte) pair.
+        Action entry = Action::Undefined; //!< Action upon entering the target state (transitions only).
+    };
+
+    //! Packed (State, Byte) -> (Actions, State) map, so that the parser needs only a single lookup per byte.
+    using PackedTable = std::array<std::array<Entry, 256>, std::numeric_limits<State>::size()>;
+
+    //! Flattens the above tables into a PackedTable.
+    [[nodiscard]] constexpr PackedTable pack() const noexcept
+    {
+        auto packed = PackedTable {};
+        for (size_t state = 0; state < packed.size(); ++state)
+        {
+            for (size_t ch = 0; ch < 256; ++ch)
+            {
+                auto& e = packed[state][ch];
+                e.target = transitions[state][ch];
+                e.event = events[state][ch];
+                if (e.target != State::Undefined)
+                {
+                    e.exit = exitEvents[state];
+                    e.entry = entryEvents[static_cast<size_t>(e.target)];
+                }
+            }
+        }
+        return packed;
+    }
+
     // {{{ implementation detail
     struct Range
     {
@@ -325,24 +444,39 @@ constexpr ParserTable ParserTable::get() // {{{
     return t;
 } // }}}
 
+//! The standard state machine table, packed at compile time.
+inline constexpr ParserTable::PackedTable PackedParserTable = ParserTable::get().pack();
+
 template <typename EventListener, bool TraceStateChanges>
 void Parser<EventListener, TraceStateChanges>::parseFragment(gsl::span<char const> data)
 {
+    auto const _ = crispy::trace_span("Parser.parseFragment");
+
     const auto* input = data.data();
     const auto* const end = data.data() + data.size();
 
     while (input != end)
     {
-        auto const [processKind, processedByteCount] = parseBulkText(input, end);
+#if defined(LIBTERMINAL_SEQUENCE_STATS)
+        auto& bulkBytes = _state == State::Ground ? _stats.bulkTextBytes : _stats.bulkControlStringBytes;
+#endif
+        auto const [processKind, processedByteCount] =
+            _state == State::Ground ? parseBulkText(input, end) : parseBulkControlString(input, end);
         switch (processKind)
         {
             case ProcessKind::ContinueBulk:
                 // clang-format off
                 input += processedByteCount;
+#if defined(LIBTERMINAL_SEQUENCE_STATS)
+                bulkBytes += processedByteCount;
+#endif
                 break;
                 // clang-format on
             case ProcessKind::FallbackToFSM:
                 processOnceViaStateMachine(static_cast<uint8_t>(*input++));
+#if defined(LIBTERMINAL_SEQUENCE_STATS)
+                ++_stats.stateMachineBytes;
+#endif
                 break;
         }
     }
@@ -351,19 +485,18 @@ void Parser<EventListener, TraceStateChanges>::parseFragment(gsl::span<char cons
 template <typename EventListener, bool TraceStateChanges>
 void Parser<EventListener, TraceStateChanges>::processOnceViaStateMachine(uint8_t ch)
 {
-    auto const s = static_cast<size_t>(_state);
-    ParserTable static constexpr Table = ParserTable::get();
+    auto const& e = PackedParserTable[static_cast<size_t>(_state)][ch];
 
-    if (auto const t = Table.transitions[s][static_cast<uint8_t>(ch)]; t != State::Undefined)
+    if (e.target != State::Undefined)
     {
-        // fmt::print("VTParser: Transitioning from {} to {}", _state, t);
-        handle(ActionClass::Leave, Table.exitEvents[s], ch);
-        handle(ActionClass::Transition, Table.events[s][static_cast<size_t>(ch)], ch);
-        _state = t;
-        handle(ActionClass::Enter, Table.entryEvents[static_cast<size_t>(t)], ch);
+        // fmt::print("VTParser: Transitioning from {} to {}", _state, e.target);
+        handle(ActionClass::Leave, e.exit, ch);
+        handle(ActionClass::Transition, e.event, ch);
+        _state = e.target;
+        handle(ActionClass::Enter, e.entry, ch);
     }
-    else if (Action const a = Table.events[s][ch]; a != Action::Undefined)
-        handle(ActionClass::Event, a, ch);
+    else if (e.event != Action::Undefined)
+        handle(ActionClass::Event, e.event, ch);
     else
         _eventListener.error("Parser error: Unknown action for state/input pair.");
 }
@@ -380,6 +513,41 @@ auto Parser<EventListener, TraceStateChanges>::parseBulkText(char const* begin,
     if (!maxCharCount)
         return { ProcessKind::FallbackToFSM, 0 };
 
+    // Fast path for plain US-ASCII text, which is by far the most common input (build logs, `cat`, ...).
+    // Each printable US-ASCII character occupies exactly one grid cell and forms a grapheme
+    // cluster on its own, so we can skip the Unicode scanner entirely as long as the preceding
+    // codepoint cannot be joined with it (and no UTF-8 sequence is pending).
+    if (_scanState.utf8.expectedLength == 0 && _scanState.lastCodepointHint < 0x80)
+    {
+        auto const* const asciiEnd = detail::findFirstNonPrintableAscii(input, end);
+        auto asciiCount = std::min(static_cast<size_t>(std::distance(input, asciiEnd)), maxCharCount);
+
+        // If non-ASCII text follows, leave the last character to the Unicode scanner,
+        // as it may start a grapheme cluster (e.g. a base character followed by a combining mark).
+        if (asciiCount != 0 && input + asciiCount != end && static_cast<uint8_t>(input[asciiCount]) >= 0x80)
+            --asciiCount;
+
+        if (asciiCount != 0)
+        {
+#if defined(LIBTERMINAL_LOG_TRACE)
+            if (vtTraceParserLog)
+                vtTraceParserLog()("[ASCII] Scanned text: maxCharCount {}; cells {}; \"{}\"",
+                                   maxCharCount,
+                                   asciiCount,
+                                   crispy::escape(std::string_view { input, asciiCount }));
+#endif
+            _eventListener.print(std::string_view { input, asciiCount }, asciiCount);
+            _scanState.lastCodepointHint = static_cast<char32_t>(input[asciiCount - 1]);
+
+            // Bypass the FSM for the `(TEXT LF+)+`-case, too.
+            auto count = asciiCount;
+            if (input + count != end && input[count] == '\n')
+                _eventListener.execute(input[count++]);
+
+            return { ProcessKind::ContinueBulk, count };
+        }
+    }
+
     _scanState.next = nullptr;
     auto const chunk = std::string_view(input, static_cast<size_t>(std::distance(input, end)));
     auto const [cellCount, subStart, subEnd] = unicode::scan_text(_scanState, chunk, maxCharCount);
@@ -430,6 +598,56 @@ auto Parser<EventListener, TraceStateChanges>::parseBulkText(char const* begin,
     return { ProcessKind::ContinueBulk, count };
 }
 
+template <typename EventListener, bool TraceStateChanges>
+auto Parser<EventListener, TraceStateChanges>::parseBulkControlString(char const* begin, char const* end)
+    -> std::tuple<ProcessKind, size_t>
+{
+    // Only OSC strings and DCS data strings are passed through in bulk, as these
+    // can carry large payloads (clipboard data, hyperlinks, Sixel images, ...).
+    auto const putAction = [state = _state]() {
+        switch (state)
+        {
+            case State::OSC_String: return Action::OSC_Put;
+            case State::DCS_PassThrough: return Action::Put;
+            default: return Action::Undefined;
+        }
+    }();
+
+    if (putAction == Action::Undefined)
+        return { ProcessKind::FallbackToFSM, 0 };
+
+    // Consume all bytes that neither leave the current state nor cause anything but a put action.
+    auto const& row = PackedParserTable[static_cast<size_t>(_state)];
+    auto const* input = begin;
+    while (input != end)
+    {
+        auto const& e = row[static_cast<uint8_t>(*input)];
+        if (e.target != State::Undefined || e.event != putAction)
+            break;
+        ++input;
+    }
+
+    auto const count = static_cast<size_t>(std::distance(begin, input));
+    if (count == 0)
+        return { ProcessKind::FallbackToFSM, 0 };
+
+#if defined(LIBTERMINAL_LOG_TRACE)
+    if (vtTraceParserLog)
+        vtTraceParserLog()("[{}] Scanned {} bytes: \"{}\"",
+                           _state,
+                           count,
+                           crispy::escape(std::string_view { begin, count }));
+#endif
+
+    auto const text = std::string_view { begin, count };
+    if (putAction == Action::OSC_Put)
+        _eventListener.putOSC(text);
+    else
+        _eventListener.put(text);
+
+    return { ProcessKind::ContinueBulk, count };
+}
+
 template <typename EventListener, bool TraceStateChanges>
 void Parser<EventListener, TraceStateChanges>::printUtf8Byte(char ch)
 {
@@ -20,14 +20,14 @@ void parserTableDot(std::ostream& os) // {{{
     using Range = ParserTable::Range;
     using RangeSet = std::vector<Range>;
 
-    ParserTable const& table = ParserTable::get();
     // (State, Byte) -> State
     auto transitions = std::map<Transition, RangeSet> {};
-    for ([[maybe_unused]] auto const&& [sourceState, sourceTransitions]: crispy::indexed(table.transitions))
+    for ([[maybe_unused]] auto const&& [sourceState, sourceTransitions]: crispy::indexed(PackedParserTable))
     {
-        for (auto const [i, targetState]: crispy::indexed(sourceTransitions))
+        for (auto const [i, entry]: crispy::indexed(sourceTransitions))
         {
             auto const ch = static_cast<uint8_t>(i);
+            auto const targetState = entry.target;
             if (targetState != State::Undefined)
             {
                 // os << fmt::format("({}, 0x{:0X}) -> {}\n", static_cast<State>(sourceState), ch,
@@ -498,6 +498,21 @@ struct fmt::formatter<vtparser::Action>: formatter<std::string_view>
 namespace vtparser
 {
 
+/// Bytes consumed by the parser, broken down by how they have been processed.
+///
+/// Only counted when built with LIBTERMINAL_SEQUENCE_STATS.
+struct ParserStats
+{
+    uint64_t bulkTextBytes = 0;          //!< printable text scanned in bulk in ground state
+    uint64_t bulkControlStringBytes = 0; //!< OSC, DCS, APC, PM payloads scanned in bulk
+    uint64_t stateMachineBytes = 0;      //!< bytes fed through the state machine one by one
+
+    [[nodiscard]] uint64_t total() const noexcept
+    {
+        return bulkTextBytes + bulkControlStringBytes + stateMachineBytes;
+    }
+};
+
 /**
  * Terminal Parser.
  *
@@ -537,6 +552,10 @@ class Parser
 
     void printUtf8Byte(char ch);
 
+#if defined(LIBTERMINAL_SEQUENCE_STATS)
+    [[nodiscard]] ParserStats const& stats() const noexcept { return _stats; }
+#endif
+
   private:
     enum class ProcessKind
     {
@@ -547,6 +566,7 @@ class Parser
     };
 
     std::tuple<ProcessKind, size_t> parseBulkText(char const* begin, char const* end) noexcept;
+    std::tuple<ProcessKind, size_t> parseBulkControlString(char const* begin, char const* end);
     void processOnceViaStateMachine(uint8_t ch);
 
     void handle(ActionClass actionClass, Action action, uint8_t codepoint);
@@ -556,6 +576,9 @@ class Parser
     State _state = State::Ground;
     EventListener& _eventListener;
     unicode::scan_state _scanState {};
+#if defined(LIBTERMINAL_SEQUENCE_STATS)
+    ParserStats _stats {};
+#endif
 };
 
 /// @returns parsed tuple with OSC code and offset to first data parameter byte.
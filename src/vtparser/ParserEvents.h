@@ -123,6 +123,11 @@ class ParserEvents
      */
     virtual void putOSC(char value) = 0;
 
+    /**
+     * Bulk variant of putOSC(char), passing a contiguous run of OSC string characters at once.
+     */
+    virtual void putOSC(std::string_view text) = 0;
+
     /**
      * This action is called when the OSC string is terminated by ST, CAN, SUB or ESC,
      * to allow the OSC handler to finish neatly.
@@ -146,6 +151,11 @@ class ParserEvents
      */
     virtual void put(char value) = 0;
 
+    /**
+     * Bulk variant of put(char), passing a contiguous run of device control string characters at once.
+     */
+    virtual void put(std::string_view text) = 0;
+
     /**
      * When a device control string is terminated by ST, CAN, SUB or ESC, this action calls the
      * previously selected handler function with an “end of data” parameter. This allows the
@@ -184,9 +194,11 @@ class NullParserEvents: public ParserEvents
     void dispatchCSI(char) override {}
     void startOSC() override {}
     void putOSC(char) override {}
+    void putOSC(std::string_view) override {}
     void dispatchOSC() override {}
     void hook(char) override {}
     void put(char) override {}
+    void put(std::string_view) override {}
     void unhook() override {}
     void startAPC() override {}
     void putAPC(char) override {}
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <crispy/BufferObject.h>
+
 #include <functional>
 #include <string>
+#include <string_view>
 
 namespace vtbackend
 {
@@ -17,6 +20,20 @@ class ParserExtension
     virtual ~ParserExtension() = default;
 
     virtual void pass(char ch) = 0;
+
+    /// Bulk variant of pass(char), passing a contiguous run of characters at once.
+    virtual void pass(std::string_view chars)
+    {
+        for (char const ch: chars)
+            pass(ch);
+    }
+
+    /// Passes a contiguous run of characters that is backed by a PTY buffer object.
+    ///
+    /// Extensions that need to retain the data until finalize() may keep a reference
+    /// to the fragment instead of copying the characters.
+    virtual void pass(crispy::BufferFragment<char> const& fragment) { pass(fragment.view()); }
+
     virtual void finalize() = 0;
 };
 
@@ -25,17 +42,71 @@ class SimpleStringCollector: public ParserExtension
   public:
     explicit SimpleStringCollector(std::function<void(std::string_view)> done): _done { std::move(done) } {}
 
-    void pass(char ch) override { _data.push_back(ch); }
+    void pass(char ch) override
+    {
+        materialize();
+        _data.push_back(ch);
+    }
+
+    void pass(std::string_view chars) override
+    {
+        materialize();
+        _data.append(chars);
+    }
+
+    void pass(crispy::BufferFragment<char> const& fragment) override
+    {
+        if (_data.empty())
+        {
+            if (_fragment.empty())
+            {
+                _fragment = fragment;
+                retain(fragment);
+                return;
+            }
+
+            if (_fragment.owner() == fragment.owner() && _fragment.data() + _fragment.size() == fragment.data())
+            {
+                // The payload continues contiguously within the same buffer object.
+                _fragment.growBy(fragment.size());
+                retain(fragment);
+                return;
+            }
+        }
+
+        // The payload spans multiple buffer objects, fall back to copying.
+        pass(fragment.view());
+    }
 
     void finalize() override
     {
         if (_done)
-            _done(_data);
+            _done(_fragment.empty() ? std::string_view(_data) : _fragment.view());
         _data.clear();
+        _fragment = {};
     }
 
   private:
+    /// Ensures the buffer object's hot end is moved past the fragment, so that
+    /// subsequent PTY reads will not overwrite the referenced data.
+    static void retain(crispy::BufferFragment<char> const& fragment)
+    {
+        auto const* fragmentEnd = fragment.data() + fragment.size();
+        if (fragment.owner()->hotEnd() < fragmentEnd)
+            fragment.owner()->advanceHotEndUntil(fragmentEnd);
+    }
+
+    /// Moves any referenced payload into the local string buffer.
+    void materialize()
+    {
+        if (_fragment.empty())
+            return;
+        _data.assign(_fragment.view());
+        _fragment = {};
+    }
+
     std::string _data;
+    crispy::BufferFragment<char> _fragment;
     std::function<void(std::string_view)> _done;
 };
 
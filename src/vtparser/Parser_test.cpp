@@ -1,6 +1,9 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <vtparser/Parser.h>
 #include <vtparser/ParserEvents.h>
+#include <vtparser/ParserExtension.h>
+
+#include <crispy/BufferObject.h>
 
 #include <libunicode/convert.h>
 
@@ -14,6 +17,8 @@ class MockParserEvents final: public vtparser::NullParserEvents
     std::string text;
     std::string apc;
     std::string pm;
+    std::string osc;
+    std::string dcs;
     size_t maxCharCount = 80;
 
     void error(string_view const& msg) override { INFO(fmt::format("Parser error received. {}", msg)); }
@@ -28,6 +33,16 @@ class MockParserEvents final: public vtparser::NullParserEvents
     void putAPC(char ch) override { apc += ch; }
     void dispatchAPC() override { apc += "}"; }
 
+    void startOSC() override { osc += "{"; }
+    void putOSC(char ch) override { osc += ch; }
+    void putOSC(std::string_view chars) override { osc += fmt::format("[{}]", chars); }
+    void dispatchOSC() override { osc += "}"; }
+
+    void hook(char ch) override { dcs += fmt::format("{}{{", ch); }
+    void put(char ch) override { dcs += ch; }
+    void put(std::string_view chars) override { dcs += fmt::format("[{}]", chars); }
+    void unhook() override { dcs += "}"; }
+
     void startPM() override { pm += "{"; }
     void putPM(char ch) override { pm += ch; }
     void dispatchPM() override { pm += "}"; }
@@ -65,3 +80,117 @@ TEST_CASE("Parser.APC")
     REQUIRE(listener.apc == "{Gi=1,a=q;}");
     REQUIRE(listener.text == "ABCDEF");
 }
+
+TEST_CASE("Parser.ascii_bulk_text")
+{
+    MockParserEvents listener;
+    auto p = vtparser::Parser<vtparser::ParserEvents>(listener);
+
+    // Long enough to span multiple SIMD batches, terminated by various C0 controls.
+    auto const line = std::string(100, 'x');
+    p.parseFragment(line + "\r" + line + "\033[m" + line + "\x7F" + line);
+    CHECK(p.state() == vtparser::State::Ground);
+    CHECK(listener.text == line + line + line + "\x7F" + line);
+}
+
+TEST_CASE("Parser.ascii_bulk_text_followed_by_combining_mark")
+{
+    MockParserEvents listener;
+    auto p = vtparser::Parser<vtparser::ParserEvents>(listener);
+
+    // e + COMBINING ACUTE ACCENT must be kept together by the Unicode scanner.
+    p.parseFragment("ABCDEFGHIJKLMNOPQRSTUVWXYZe\xCC\x81!"sv);
+    CHECK(p.state() == vtparser::State::Ground);
+    CHECK(listener.text == "ABCDEFGHIJKLMNOPQRSTUVWXYZe\xCC\x81!");
+}
+
+TEST_CASE("ParserTable.pack")
+{
+    using vtparser::Action;
+    using vtparser::State;
+
+    static constexpr auto Table = vtparser::ParserTable::get().pack();
+    auto const entryOf = [](State state, uint8_t ch) {
+        return Table[static_cast<size_t>(state)][ch];
+    };
+
+    // Ground --ESC--> Escape, emitting PrintEnd when leaving Ground and Clear when entering Escape.
+    auto const esc = entryOf(State::Ground, 0x1B);
+    CHECK(esc.target == State::Escape);
+    CHECK(esc.exit == Action::PrintEnd);
+    CHECK(esc.entry == Action::Clear);
+
+    // Ground --'A'--> (no transition), printing.
+    auto const print = entryOf(State::Ground, 'A');
+    CHECK(print.target == State::Undefined);
+    CHECK(print.event == Action::Print);
+    CHECK(print.exit == Action::Undefined);
+    CHECK(print.entry == Action::Undefined);
+
+    // CSI_Param --'m'--> Ground, dispatching the CSI.
+    auto const sgr = entryOf(State::CSI_Param, 'm');
+    CHECK(sgr.target == State::Ground);
+    CHECK(sgr.event == Action::CSI_Dispatch);
+    CHECK(sgr.entry == Action::GroundStart);
+}
+
+TEST_CASE("Parser.OSC_bulk")
+{
+    MockParserEvents listener;
+    auto p = vtparser::Parser<vtparser::ParserEvents>(listener);
+    p.parseFragment("\033]8;;https://example.com/\033\\"sv);
+    CHECK(p.state() == vtparser::State::Ground);
+    CHECK(listener.osc == "{[8;;https://example.com/]}");
+
+    // Split across multiple fragments.
+    listener.osc.clear();
+    p.parseFragment("\033]2;Hello"sv);
+    p.parseFragment(" World\a"sv);
+    CHECK(p.state() == vtparser::State::Ground);
+    CHECK(listener.osc == "{[2;Hello][ World]}");
+}
+
+TEST_CASE("Parser.DCS_bulk")
+{
+    MockParserEvents listener;
+    auto p = vtparser::Parser<vtparser::ParserEvents>(listener);
+    p.parseFragment("\033P$qm\033\\"sv);
+    CHECK(p.state() == vtparser::State::Ground);
+    CHECK(listener.dcs == "q{[m]}");
+}
+
+TEST_CASE("SimpleStringCollector.zero_copy")
+{
+    auto pool = crispy::buffer_object_pool<char>(1024);
+    auto buffer = pool.allocateBufferObject();
+    auto const payload = buffer->writeAtEnd("abcdef"sv);
+
+    std::string_view result;
+    auto collector = vtbackend::SimpleStringCollector([&](std::string_view data) { result = data; });
+
+    collector.pass(crispy::BufferFragment<char> { buffer, payload.subspan(0, 3) });
+    collector.pass(crispy::BufferFragment<char> { buffer, payload.subspan(3, 3) });
+    CHECK(buffer->hotEnd() == payload.data() + payload.size());
+    collector.finalize();
+
+    // The contiguous payload must have been referenced, not copied.
+    CHECK(result == "abcdef");
+    CHECK(result.data() == payload.data());
+}
+
+TEST_CASE("SimpleStringCollector.fallback_copy")
+{
+    auto pool = crispy::buffer_object_pool<char>(1024);
+    auto buffer = pool.allocateBufferObject();
+    auto const payload = buffer->writeAtEnd("abcdef"sv);
+
+    std::string collected;
+    auto collector = vtbackend::SimpleStringCollector([&](std::string_view data) { collected = data; });
+
+    collector.pass(crispy::BufferFragment<char> { buffer, payload.subspan(0, 2) });
+    collector.pass('-');
+    collector.pass(crispy::BufferFragment<char> { buffer, payload.subspan(4, 2) });
+    collector.finalize();
+
+    CHECK(collected == "ab-ef");
+}
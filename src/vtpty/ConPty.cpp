@@ -3,6 +3,9 @@
 
 #include <crispy/BufferObject.h>
 
+#include <fmt/format.h>
+
+#include <atomic>
 #include <utility>
 
 #include <Windows.h>
@@ -11,6 +14,9 @@ using namespace std;
 
 namespace
 {
+// Size of the buffer of the pipe the pseudo console's output is read from.
+constexpr DWORD PipeBufferSize = 128 * 1024;
+
 string GetLastErrorAsString()
 {
     DWORD errorMessageID = GetLastError();
@@ -59,6 +65,8 @@ ConPty::ConPty(PageSize const& windowSize): _size { windowSize }
     _master = INVALID_HANDLE_VALUE;
     _input = INVALID_HANDLE_VALUE;
     _output = INVALID_HANDLE_VALUE;
+    _readEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    _wakeupEvent = CreateEventA(nullptr, FALSE, FALSE, nullptr);
     _buffer.resize(10240);
 }
 
@@ -66,6 +74,8 @@ ConPty::~ConPty()
 {
     ptyLog()("~ConPty()");
     close();
+    CloseHandle(_wakeupEvent);
+    CloseHandle(_readEvent);
 }
 
 bool ConPty::isClosed() const noexcept
@@ -87,7 +97,28 @@ void ConPty::start()
     if (!CreatePipe(&hPipePTYIn, &_output, NULL, 0))
         throw runtime_error { GetLastErrorAsString() };
 
-    if (!CreatePipe(&_input, &hPipePTYOut, NULL, 0))
+    // The output is read via a named pipe, as anonymous ones do not support overlapped I/O,
+    // which is required for reads to time out and to be woken up early.
+    static auto pipeCounter = std::atomic<unsigned> { 0 };
+    auto const pipeName =
+        fmt::format("\\\\.\\pipe\\contour-conpty-{}-{}", GetCurrentProcessId(), pipeCounter++);
+    _input = CreateNamedPipeA(pipeName.c_str(),
+                              PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                              PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                              1,
+                              0,
+                              PipeBufferSize,
+                              0,
+                              nullptr);
+    if (_input == INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(hPipePTYIn);
+        throw runtime_error { GetLastErrorAsString() };
+    }
+
+    hPipePTYOut = CreateFileA(
+        pipeName.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hPipePTYOut == INVALID_HANDLE_VALUE)
     {
         CloseHandle(hPipePTYIn);
         throw runtime_error { GetLastErrorAsString() };
@@ -126,6 +157,8 @@ void ConPty::close()
 
     if (_input != INVALID_HANDLE_VALUE)
     {
+        CancelIoEx(_input, nullptr);
+        SetEvent(_wakeupEvent);
         CloseHandle(_input);
         _input = INVALID_HANDLE_VALUE;
     }
@@ -141,14 +174,31 @@ Pty::ReadResult ConPty::read(crispy::buffer_object<char>& buffer,
                              std::optional<std::chrono::milliseconds> timeout,
                              size_t size)
 {
-    // TODO: wait for timeout time at most AND got woken up upon wakeupReader() invokcation.
-    (void) timeout;
-
     auto const n = static_cast<DWORD>(min(size, buffer.bytesAvailable()));
 
+    auto overlapped = OVERLAPPED {};
+    overlapped.hEvent = _readEvent;
+    if (!ReadFile(_input, buffer.hotEnd(), n, nullptr, &overlapped))
+    {
+        if (GetLastError() != ERROR_IO_PENDING)
+            return nullopt;
+
+        HANDLE const handles[] = { _readEvent, _wakeupEvent };
+        auto const waitTime = timeout ? static_cast<DWORD>(timeout->count()) : INFINITE;
+        auto const waitResult = WaitForMultipleObjects(2, handles, FALSE, waitTime);
+
+        // The read may still complete before being cancelled, in which case its data is not to be lost.
+        if (waitResult != WAIT_OBJECT_0)
+            CancelIoEx(_input, &overlapped);
+    }
+
     DWORD nread {};
-    if (!ReadFile(_input, buffer.hotEnd(), n, &nread, nullptr))
+    if (!GetOverlappedResult(_input, &overlapped, &nread, TRUE))
+    {
+        if (GetLastError() == ERROR_OPERATION_ABORTED)
+            errno = EAGAIN; // timed out or woken up
         return nullopt;
+    }
 
     if (ptyInLog)
         ptyInLog()("{} received: \"{}\"", "master", crispy::escape(buffer.hotEnd(), buffer.hotEnd() + nread));
@@ -158,8 +208,7 @@ Pty::ReadResult ConPty::read(crispy::buffer_object<char>& buffer,
 
 void ConPty::wakeupReader()
 {
-    // TODO: Windows ConPTY does *NOT* support non-blocking / overlapped I/O.
-    // How can we make ReadFile() return early? We could maybe WriteFile() to it?
+    SetEvent(_wakeupEvent);
 }
 
 int ConPty::write(std::string_view data)
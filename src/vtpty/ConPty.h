@@ -41,8 +41,10 @@ class ConPty: public Pty
     std::mutex _mutex; // used to guard close()
     PageSize _size;
     HPCON _master;
-    HANDLE _input;
+    HANDLE _input; // read with overlapped I/O, to be waited for with a timeout along with _wakeupEvent
     HANDLE _output;
+    HANDLE _readEvent;   // signaled on completion of an overlapped read from _input
+    HANDLE _wakeupEvent; // signaled by wakeupReader()
     std::vector<char> _buffer;
     std::unique_ptr<PtySlave> _slave;
 };
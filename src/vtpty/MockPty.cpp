@@ -32,6 +32,17 @@ Pty::ReadResult MockPty::read(crispy::buffer_object<char>& storage,
     return { tuple { string_view(pooled.data(), pooled.size()), false } };
 }
 
+optional<Pty::ScatteredRead> MockPty::readScattered(crispy::buffer_object<char>& storage,
+                                                     crispy::buffer_object<char>& overflow,
+                                                     std::optional<std::chrono::milliseconds> timeout,
+                                                     size_t size)
+{
+    auto const headSize = min(size, storage.bytesAvailable());
+    auto const head = std::get<0>(*read(storage, timeout, headSize));
+    auto const tail = std::get<0>(*read(overflow, timeout, size - head.size()));
+    return ScatteredRead { head, tail, false };
+}
+
 void MockPty::wakeupReader()
 {
     // No-op. as we're a mock-pty.
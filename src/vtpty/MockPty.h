@@ -21,6 +21,10 @@ class MockPty: public Pty
     [[nodiscard]] ReadResult read(crispy::buffer_object<char>& storage,
                                   std::optional<std::chrono::milliseconds> timeout,
                                   size_t size) override;
+    [[nodiscard]] std::optional<ScatteredRead> readScattered(crispy::buffer_object<char>& storage,
+                                                             crispy::buffer_object<char>& overflow,
+                                                             std::optional<std::chrono::milliseconds> timeout,
+                                                             size_t size) override;
     void wakeupReader() override;
     int write(std::string_view data) override;
     [[nodiscard]] PageSize pageSize() const noexcept override;
@@ -40,6 +40,8 @@ class [[nodiscard]] Process: public Pty
         std::filesystem::path workingDirectory;
         Environment env;
         bool escapeSandbox = true;
+
+        bool operator==(ExecInfo const&) const = default;
     };
 
     //! Returns login shell of current user.
@@ -94,12 +96,17 @@ class [[nodiscard]] Process: public Pty
     [[nodiscard]] PtySlave& slave() noexcept override { return pty().slave(); }
     void close() override { pty().close(); }
     void waitForClosed() override;
+    [[nodiscard]] int closedHandle() const noexcept override;
     [[nodiscard]] bool isClosed() const noexcept override { return pty().isClosed(); }
     [[nodiscard]] ReadResult read(crispy::buffer_object<char>& storage, std::optional<std::chrono::milliseconds> timeout, size_t n) override { return pty().read(storage, timeout, n); }
+    [[nodiscard]] std::optional<ScatteredRead> readScattered(crispy::buffer_object<char>& storage, crispy::buffer_object<char>& overflow, std::optional<std::chrono::milliseconds> timeout, size_t n) override { return pty().readScattered(storage, overflow, timeout, n); }
+    [[nodiscard]] int readinessHandle() const noexcept override { return pty().readinessHandle(); }
     void wakeupReader() override { return pty().wakeupReader(); }
     [[nodiscard]] int write(std::string_view data) override { return pty().write(data); }
+    [[nodiscard]] size_t pendingWriteBytes() const noexcept override { return pty().pendingWriteBytes(); }
     [[nodiscard]] PageSize pageSize() const noexcept override { return pty().pageSize(); }
     void resizeScreen(PageSize cells, std::optional<ImageSize> pixels = std::nullopt) override { pty().resizeScreen(cells, pixels); }
+    void inspect(std::ostream& output) const override { pty().inspect(output); }
     // clang-format on
 
   private:
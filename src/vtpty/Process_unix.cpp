@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <vtpty/Process.h>
 #include <vtpty/Pty.h>
+#include <vtpty/StdoutRing.h>
 #include <vtpty/UnixPty.h>
 
 #include <crispy/overloaded.h>
@@ -8,6 +9,7 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
 #include <cstddef>
@@ -31,14 +33,26 @@
     #include <pty.h>
 #endif
 
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
 #include <csignal>
 
+#include <fcntl.h>
 #include <pwd.h>
+#include <spawn.h>
 #include <unistd.h>
 
+// posix_spawn() can set up a PTY as controlling terminal of the new session (by opening it after setsid(),
+// which Linux' semantics of opening terminals ensure), change directory, and close inherited file
+// descriptors, only with glibc 2.34 or newer.
+#if defined(__linux__) && defined(__GLIBC__) && defined(POSIX_SPAWN_SETSID)
+    #if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34)
+        #define VTPTY_POSIX_SPAWN 1
+    #endif
+#endif
+
 using namespace std;
 using namespace std::string_view_literals;
 using crispy::trimRight;
@@ -54,6 +68,11 @@ namespace
     constexpr auto StdoutFastPipeFdStr = "3"sv;
     constexpr auto StdoutFastPipeEnvironmentName = "STDOUT_FASTPIPE"sv;
 
+    // The stdout ring's memory and doorbell, as inherited by the child (see StdoutRingHeader).
+    constexpr auto StdoutRingFd = 4;
+    constexpr auto StdoutRingDoorbellFd = 5;
+    constexpr auto StdoutRingFdsStr = "4:5"sv;
+
     string getLastErrorAsString()
     {
         return strerror(errno);
@@ -75,6 +94,13 @@ namespace
         return argv;
     }
 
+    void deleteArgv(char** argv)
+    {
+        for (auto** arg = argv; *arg; ++arg)
+            free(*arg);
+        delete[] argv;
+    }
+
     void saveDup2(int a, int b)
     {
         while (dup2(a, b) == -1 && (errno == EBUSY || errno == EINTR))
@@ -94,8 +120,32 @@ struct Process::Private
     mutable pid_t pid {};
     mutable std::mutex exitStatusMutex {};
     mutable std::optional<Process::ExitStatus> exitStatus {};
+    crispy::file_descriptor pidFd {}; // readable once the process exited, if supported (Linux 5.3)
 
     [[nodiscard]] std::optional<ExitStatus> checkStatus(bool waitForExit) const;
+
+    [[nodiscard]] std::optional<UnixPty::StdoutRingHandles> stdoutRing() const
+    {
+        if (auto const* unixPty = dynamic_cast<UnixPty const*>(pty.get()))
+            return unixPty->stdoutRing();
+        return std::nullopt;
+    }
+
+    /// @returns the first file descriptor not to be inherited by the child process.
+    [[nodiscard]] int firstUninheritedFd() const
+    {
+        return stdoutRing() ? StdoutRingDoorbellFd + 1 : StdoutFastPipeFd + 1;
+    }
+
+    /// @returns the command line to execute in the child process, to be freed via deleteArgv().
+    [[nodiscard]] char** createChildArgv(UnixPipe const* stdoutFastPipe) const;
+
+    /// Starts the child process via posix_spawn(), which, unlike fork(), does not copy the page tables
+    /// of this process, which grow along with the scrollback and texture atlases of all tabs.
+    ///
+    /// @returns the child's process ID, or nothing if the child is to be forked instead, because
+    ///          posix_spawn() is unsupported or failed to start it.
+    [[nodiscard]] std::optional<pid_t> spawn(UnixPipe const* stdoutFastPipe);
 };
 
 Process::Process(string const& path,
@@ -114,11 +164,147 @@ bool Process::isFlatpak()
     return check;
 }
 
+char** Process::Private::createChildArgv(UnixPipe const* stdoutFastPipe) const
+{
+    if (!isFlatpak() || !escapeSandbox)
+        return createArgv(path, args, 0);
+
+    auto const terminfoBaseDirectory =
+        homeDirectory() / ".var/app/org.contourterminal.Contour/terminfo";
+
+    // Prepend flatpak to jump out of sandbox:
+    // flatpak-spawn --host --watch-bus --env=TERM=$TERM /bin/zsh
+    auto realArgs = std::vector<string> {};
+    realArgs.emplace_back("--host");
+    realArgs.emplace_back("--watch-bus");
+    realArgs.emplace_back(
+        fmt::format("--env=TERMINFO={}", terminfoBaseDirectory.generic_string()));
+    if (stdoutFastPipe)
+    {
+        realArgs.emplace_back(
+            fmt::format("--env={}={}", StdoutFastPipeEnvironmentName, StdoutFastPipeFdStr));
+        realArgs.emplace_back(fmt::format("--forward-fd={}", StdoutFastPipeFdStr));
+    }
+    if (stdoutRing())
+    {
+        realArgs.emplace_back(fmt::format("--env={}={}", StdoutRingEnvironmentName, StdoutRingFdsStr));
+        realArgs.emplace_back(fmt::format("--forward-fd={}", StdoutRingFd));
+        realArgs.emplace_back(fmt::format("--forward-fd={}", StdoutRingDoorbellFd));
+    }
+    if (!cwd.empty())
+        realArgs.emplace_back(fmt::format("--directory={}", cwd.generic_string()));
+    realArgs.emplace_back(fmt::format("--env=TERM={}", "contour"));
+    for (auto&& [name, value]: env)
+        realArgs.emplace_back(fmt::format("--env={}={}", name, value));
+    if (stdoutFastPipe)
+        realArgs.emplace_back(
+            fmt::format("--env={}={}", StdoutFastPipeEnvironmentName, StdoutFastPipeFd));
+    realArgs.push_back(path);
+    for (auto const& arg: args)
+        realArgs.push_back(arg);
+
+    return createArgv("/usr/bin/flatpak-spawn", realArgs, 0);
+}
+
+std::optional<pid_t> Process::Private::spawn(UnixPipe const* stdoutFastPipe)
+{
+#if defined(VTPTY_POSIX_SPAWN)
+    auto* unixPty = dynamic_cast<UnixPty*>(pty.get());
+    if (!unixPty)
+        return std::nullopt;
+
+    auto const slaveFd = unbox<int>(unixPty->slaveHandle());
+    char slaveName[256];
+    if (ttyname_r(slaveFd, slaveName, sizeof(slaveName)) != 0)
+        return std::nullopt;
+
+    // What the forked child does in the child, except for login() and chdir(), is done upfront.
+    (void) pty->slave().configure();
+
+    auto const escapesSandbox = isFlatpak() && escapeSandbox;
+    auto environment = std::vector<string> {};
+    for (auto** entry = environ; *entry; ++entry)
+        environment.emplace_back(*entry);
+    auto const setEnvironment = [&](std::string_view name, std::string_view value) {
+        auto const entry = fmt::format("{}={}", name, value);
+        auto i = std::find_if(environment.begin(), environment.end(), [&](string const& e) {
+            return e.size() > name.size() && e.starts_with(name) && e[name.size()] == '=';
+        });
+        if (i != environment.end())
+            *i = entry;
+        else
+            environment.push_back(entry);
+    };
+    if (!escapesSandbox)
+    {
+        if (isFlatpak() && !escapeSandbox)
+            setEnvironment("TERMINFO", "/app/share/terminfo");
+        for (auto&& [name, value]: env)
+            setEnvironment(name, value);
+        if (stdoutFastPipe)
+            setEnvironment(StdoutFastPipeEnvironmentName, StdoutFastPipeFdStr);
+        if (stdoutRing())
+            setEnvironment(StdoutRingEnvironmentName, StdoutRingFdsStr);
+    }
+    auto envp = std::vector<char*> {};
+    for (auto& entry: environment)
+        envp.push_back(entry.data());
+    envp.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    auto const _ = crispy::finally { [&]() { posix_spawn_file_actions_destroy(&actions); } };
+
+    // Opened in the child's new session, the slave becomes its controlling terminal.
+    posix_spawn_file_actions_addopen(&actions, 0, slaveName, O_RDWR, 0);
+    posix_spawn_file_actions_adddup2(&actions, 0, 1);
+    posix_spawn_file_actions_adddup2(&actions, 0, 2);
+    if (stdoutFastPipe && stdoutFastPipe->writer() != -1)
+        posix_spawn_file_actions_adddup2(&actions, stdoutFastPipe->writer(), StdoutFastPipeFd);
+    if (auto const ring = stdoutRing())
+    {
+        posix_spawn_file_actions_adddup2(&actions, ring->memory, StdoutRingFd);
+        posix_spawn_file_actions_adddup2(&actions, ring->doorbell, StdoutRingDoorbellFd);
+    }
+    posix_spawn_file_actions_addclosefrom_np(&actions, firstUninheritedFd());
+    if (!escapesSandbox && !cwd.empty())
+        posix_spawn_file_actions_addchdir_np(&actions, cwd.c_str());
+
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    auto const __ = crispy::finally { [&]() { posix_spawnattr_destroy(&attributes); } };
+    sigset_t defaultSignals;
+    sigemptyset(&defaultSignals);
+    sigaddset(&defaultSignals, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attributes, &defaultSignals);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSID | POSIX_SPAWN_SETSIGDEF);
+
+    char** argv = createChildArgv(stdoutFastPipe);
+    auto childPid = pid_t {};
+    auto const rv = posix_spawnp(&childPid, argv[0], &actions, &attributes, argv, envp.data());
+    if (rv != 0)
+    {
+        // Leaving it to fork() to report the error and to fall back to the login shell.
+        ptyLog()("posix_spawn() of {} failed. {}", argv[0], strerror(rv));
+        deleteArgv(argv);
+        return std::nullopt;
+    }
+
+    deleteArgv(argv);
+    return childPid;
+#else
+    (void) stdoutFastPipe;
+    return std::nullopt;
+#endif
+}
+
 void Process::start()
 {
-    _d->pty->start();
+    // Already started, e.g. when spawned in advance, before being handed to a terminal.
+    if (_d->pid > 0)
+        return;
 
-    _d->pid = fork();
+    _d->pty->start();
 
     UnixPipe* stdoutFastPipe = [this]() -> UnixPipe* {
         if (auto* p = dynamic_cast<UnixPty*>(_d->pty.get()))
@@ -126,12 +312,21 @@ void Process::start()
         return nullptr;
     }();
 
+    if (auto const pid = _d->spawn(stdoutFastPipe); pid.has_value())
+        _d->pid = *pid;
+    else
+        _d->pid = fork();
+
     switch (_d->pid)
     {
         default: // in parent
             _d->pty->slave().close();
             if (stdoutFastPipe)
                 stdoutFastPipe->closeWriter();
+#if defined(SYS_pidfd_open)
+            if (auto const fd = static_cast<int>(syscall(SYS_pidfd_open, _d->pid, 0)); fd != -1)
+                _d->pidFd = crispy::file_descriptor::from_native(fd);
+#endif
             break;
         case -1: // fork error
             throw runtime_error { getLastErrorAsString() };
@@ -156,42 +351,12 @@ void Process::start()
 
                 if (stdoutFastPipe)
                     setenv(StdoutFastPipeEnvironmentName.data(), StdoutFastPipeFdStr.data(), true);
-            }
-
-            char** argv = [stdoutFastPipe, this]() -> char** {
-                if (!isFlatpak() || !_d->escapeSandbox)
-                    return createArgv(_d->path, _d->args, 0);
 
-                auto const terminfoBaseDirectory =
-                    homeDirectory() / ".var/app/org.contourterminal.Contour/terminfo";
-
-                // Prepend flatpak to jump out of sandbox:
-                // flatpak-spawn --host --watch-bus --env=TERM=$TERM /bin/zsh
-                auto realArgs = std::vector<string> {};
-                realArgs.emplace_back("--host");
-                realArgs.emplace_back("--watch-bus");
-                realArgs.emplace_back(
-                    fmt::format("--env=TERMINFO={}", terminfoBaseDirectory.generic_string()));
-                if (stdoutFastPipe)
-                {
-                    realArgs.emplace_back(
-                        fmt::format("--env={}={}", StdoutFastPipeEnvironmentName, StdoutFastPipeFdStr));
-                    realArgs.emplace_back(fmt::format("--forward-fd={}", StdoutFastPipeFdStr));
-                }
-                if (!_d->cwd.empty())
-                    realArgs.emplace_back(fmt::format("--directory={}", _d->cwd.generic_string()));
-                realArgs.emplace_back(fmt::format("--env=TERM={}", "contour"));
-                for (auto&& [name, value]: _d->env)
-                    realArgs.emplace_back(fmt::format("--env={}={}", name, value));
-                if (stdoutFastPipe)
-                    realArgs.emplace_back(
-                        fmt::format("--env={}={}", StdoutFastPipeEnvironmentName, StdoutFastPipeFd));
-                realArgs.push_back(_d->path);
-                for (auto const& arg: _d->args)
-                    realArgs.push_back(arg);
+                if (_d->stdoutRing())
+                    setenv(StdoutRingEnvironmentName.data(), StdoutRingFdsStr.data(), true);
+            }
 
-                return createArgv("/usr/bin/flatpak-spawn", realArgs, 0);
-            }();
+            char** argv = _d->createChildArgv(stdoutFastPipe);
 
             if (auto* pty = dynamic_cast<UnixPty*>(_d->pty.get()))
             {
@@ -200,12 +365,18 @@ void Process::start()
                     saveDup2(pty->stdoutFastPipe().writer(), StdoutFastPipeFd);
                     pty->stdoutFastPipe().close();
                 }
+
+                if (auto const ring = pty->stdoutRing())
+                {
+                    saveDup2(ring->memory, StdoutRingFd);
+                    saveDup2(ring->doorbell, StdoutRingDoorbellFd);
+                }
             }
 
             // maybe close any leaked/inherited file descriptors from parent process
             // TODO: But be a little bit more clever in iterating only over those that are actually still
             // open.
-            for (int i = StdoutFastPipeFd + 1; i < 256; ++i)
+            for (int i = _d->firstUninheritedFd(); i < 256; ++i)
                 ::close(i);
 
             // reset signal(s) to default that may have been changed in the parent process.
@@ -257,6 +428,11 @@ void Process::waitForClosed()
     (void) wait();
 }
 
+int Process::closedHandle() const noexcept
+{
+    return _d->pidFd.get();
+}
+
 optional<Process::ExitStatus> Process::checkStatus() const
 {
     return _d->checkStatus(false);
@@ -250,6 +250,11 @@ void Process::start()
     });
 }
 
+int Process::closedHandle() const noexcept
+{
+    return -1;
+}
+
 void Process::waitForClosed()
 {
     Require(static_cast<ConPty const*>(_d->pty.get()));
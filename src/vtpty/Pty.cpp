@@ -8,18 +8,39 @@
 #endif
 
 using std::make_unique;
+using std::nullopt;
 using std::optional;
 using std::unique_ptr;
 
 namespace vtpty
 {
 
-unique_ptr<Pty> createPty(PageSize pageSize, optional<ImageSize> viewSize)
+optional<Pty::ScatteredRead> Pty::readScattered(crispy::buffer_object<char>& storage,
+                                                 crispy::buffer_object<char>& overflow,
+                                                 std::optional<std::chrono::milliseconds> timeout,
+                                                 size_t size)
+{
+    auto const intoOverflow = storage.bytesAvailable() == 0;
+    auto const result = read(intoOverflow ? overflow : storage, timeout, size);
+    if (!result)
+        return nullopt;
+
+    auto const [data, fromStdoutFastPipe] = *result;
+    if (intoOverflow)
+        return ScatteredRead { {}, data, fromStdoutFastPipe };
+    return ScatteredRead { data, {}, fromStdoutFastPipe };
+}
+
+unique_ptr<Pty> createPty(PageSize pageSize,
+                          optional<ImageSize> viewSize,
+                          [[maybe_unused]] bool ioRing,
+                          [[maybe_unused]] size_t writeQueueSize,
+                          [[maybe_unused]] size_t stdoutRingSize)
 {
 #if defined(_MSC_VER)
     return make_unique<ConPty>(pageSize /*TODO: , viewSize*/);
 #else
-    return make_unique<UnixPty>(pageSize, viewSize);
+    return make_unique<UnixPty>(pageSize, viewSize, ioRing, writeQueueSize, stdoutRingSize);
 #endif
 }
 
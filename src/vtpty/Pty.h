@@ -8,6 +8,7 @@
 #include <crispy/logstore.h>
 
 #include <chrono>
+#include <iosfwd>
 #include <optional>
 #include <string_view>
 
@@ -54,6 +55,14 @@ class Pty
   public:
     using ReadResult = std::optional<std::tuple<std::string_view, bool>>;
 
+    /// Result of readScattered(), with the data read into either of the two buffer objects.
+    struct ScatteredRead
+    {
+        std::string_view head; // read into the tail of the storage
+        std::string_view tail; // read into the overflow buffer, once the storage got full
+        bool fromStdoutFastPipe = false;
+    };
+
     virtual ~Pty() = default;
 
     /// Starts the PTY instance.
@@ -86,6 +95,19 @@ class Pty
                                           std::optional<std::chrono::milliseconds> timeout,
                                           size_t size) = 0;
 
+    /// Reads like read(), but fills up the remaining bytes of @p storage first,
+    /// continuing into @p overflow within the same read.
+    ///
+    /// This way, the tail of a buffer object is used up, rather than wasted by a read
+    /// into a fresh buffer object. The default implementation reads into only either of them.
+    ///
+    /// @returns the views to the data read into @p storage and @p overflow, respectively.
+    [[nodiscard]] virtual std::optional<ScatteredRead> readScattered(
+        crispy::buffer_object<char>& storage,
+        crispy::buffer_object<char>& overflow,
+        std::optional<std::chrono::milliseconds> timeout,
+        size_t size);
+
     /// Inerrupts the read() operation on this PTY if a read() is currently in progress.
     ///
     /// If no read() is currently being in progress, then this call
@@ -94,24 +116,55 @@ class Pty
     /// @notice This is typically implemented using non-blocking I/O.
     virtual void wakeupReader() = 0;
 
+    /// @returns a handle that becomes readable whenever read() would not block, for waiting on many
+    ///          PTYs at once (e.g. via epoll), or -1 if not supported.
+    [[nodiscard]] virtual int readinessHandle() const noexcept { return -1; }
+
+    /// @returns a handle that becomes readable once the other end has exited,
+    ///          instead of blocking in waitForClosed(), or -1 if not supported.
+    [[nodiscard]] virtual int closedHandle() const noexcept { return -1; }
+
     /// Writes to the PTY device, so the other end can read from it.
     ///
+    /// Implementations may queue what the device does not accept right away, to be written
+    /// in the background, rather than blocking the caller.
+    ///
     /// @param buf      Buffer of data to be written.
     ///
-    /// @returns Number of bytes written or -1 on error.
+    /// @returns Number of bytes written or queued, which may be less than given
+    ///          (e.g. when the queue is full), or -1 on error.
     [[nodiscard]] virtual int write(std::string_view buf) = 0;
 
+    /// @returns the number of bytes accepted by write() which are yet to be written to the PTY device.
+    [[nodiscard]] virtual size_t pendingWriteBytes() const noexcept { return 0; }
+
     /// @returns current underlying window size in characters width and height.
     [[nodiscard]] virtual PageSize pageSize() const noexcept = 0;
 
     /// Resizes underlying window buffer by given character width and height.
     virtual void resizeScreen(PageSize cells, std::optional<ImageSize> pixels = std::nullopt) = 0;
+
+    /// Writes implementation specific state, e.g. statistics, for debugging purposes.
+    virtual void inspect(std::ostream& /*output*/) const {}
 };
 
-[[nodiscard]] std::unique_ptr<Pty> createPty(PageSize pageSize, std::optional<ImageSize> viewSize);
+/// Default number of bytes of input a PTY queues at most, while the other end is not reading it.
+constexpr inline size_t DefaultWriteQueueSize = 1024 * 1024;
+
+/// Creates the platform's PTY.
+///
+/// @param ioRing          Reads the PTY via io_uring where available (Linux), polling it otherwise.
+/// @param writeQueueSize  Number of bytes of input queued at most, where supported (Unix).
+/// @param stdoutRingSize  Size of the shared memory ring offered to cooperating clients for their output,
+///                        or 0 to not offer any, where supported (Linux).
+[[nodiscard]] std::unique_ptr<Pty> createPty(PageSize pageSize,
+                                             std::optional<ImageSize> viewSize,
+                                             bool ioRing = false,
+                                             size_t writeQueueSize = DefaultWriteQueueSize,
+                                             size_t stdoutRingSize = 0);
 
 auto const inline ptyLog = logstore::category("pty", "Logs general PTY informations.");
-auto const inline ptyInLog = logstore::category("pty.input", "Logs PTY raw input.");
-auto const inline ptyOutLog = logstore::category("pty.output", "Logs PTY raw output.");
+auto const inline ptyInLog = logstore::trace_category("pty.input", "Logs PTY raw input.");
+auto const inline ptyOutLog = logstore::trace_category("pty.output", "Logs PTY raw output.");
 
 } // namespace vtpty
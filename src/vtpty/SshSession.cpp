@@ -22,7 +22,12 @@
 #include <crispy/escape.h>
 #include <crispy/utils.h>
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <memory>
+#include <ostream>
+#include <tuple>
 
 #include <libssh2.h>
 #include <libssh2_publickey.h>
@@ -212,6 +217,7 @@ std::string SshHostConfig::toString() const
         add(fmt::format("known hosts: {}", knownHostsFile.string()));
 
     add(fmt::format("ForwardAgent: {}", forwardAgent ? "Yes" : "No"));
+    add(fmt::format("Compression: {}", compression ? "Yes" : "No"));
 
     return result;
 }
@@ -235,6 +241,8 @@ std::string SshHostConfig::toConfigString(std::string const& host) const
     if (!knownHostsFile.empty())
         result += fmt::format("{}KnownHostsFile {}\n", prefix, knownHostsFile.string());
     result += fmt::format("{}ForwardAgent {}\n", prefix, forwardAgent);
+    if (compression)
+        result += fmt::format("{}Compression yes\n", prefix);
     result += fmt::format("\n");
     return result;
 }
@@ -294,6 +302,8 @@ crispy::result<SshHostConfigMap> loadSshConfig(std::filesystem::path const& conf
                 config.privateKeyFile = value;
             else if (key == "ForwardAgent")
                 config.forwardAgent = (value == "yes");
+            else if (key == "Compression")
+                config.compression = (value == "yes");
             else
                 errorLog()("Unknown SSH config key: {}", key);
             // Add additional options here as needed
@@ -309,14 +319,180 @@ crispy::result<SshHostConfigMap> loadSshConfig()
     return loadSshConfig(configFilePath);
 }
 
+// {{{ SshConnection
+namespace
+{
+#if defined(SSH_SESSION_NB_IO)
+    constexpr auto StateMachineBlocking = 0;
+#else
+    constexpr auto StateMachineBlocking = 1;
+#endif
+
+    /// An SSH connection, which, once authenticated, is shared by all sessions to the same host, user,
+    /// and port, each of them using its own channel on it, much like OpenSSH's ControlMaster.
+    ///
+    /// libssh2 sessions must not be used by multiple threads at the same time, so any use of it
+    /// is serialized via the mutex, which may be locked recursively by the session's state machine.
+    struct SshConnection
+    {
+        using Key = std::tuple<std::string, std::string, int>; // host, user, and port
+
+        static constexpr auto SocketWaitSlice = std::chrono::milliseconds(100);
+
+        LIBSSH2_SESSION* session = nullptr;
+        LIBSSH2_AGENT* agent = nullptr;
+        socket_handle socket;
+        bool wsaStarted = false;
+
+        std::recursive_mutex mutex;
+        std::condition_variable_any dataArrived; // notified whenever data may have been received
+        bool waitingForSocket = false;           // whether any reader waits for the socket on behalf of all
+
+        SshConnection() = default;
+        SshConnection(SshConnection const&) = delete;
+        SshConnection& operator=(SshConnection const&) = delete;
+        SshConnection(SshConnection&&) = delete;
+        SshConnection& operator=(SshConnection&&) = delete;
+
+        ~SshConnection()
+        {
+            if (agent)
+            {
+                libssh2_agent_disconnect(agent);
+                libssh2_agent_free(agent);
+            }
+
+            if (session)
+            {
+                if (socket.is_open())
+                    libssh2_session_disconnect(session, "Normal shutdown");
+                libssh2_session_free(session);
+            }
+
+#if defined(_WIN32)
+            if (wsaStarted)
+                WSACleanup();
+#endif
+        }
+
+        /// Waits, with the mutex locked once by @p lock, for data to be received for any of the channels.
+        ///
+        /// Only one of the readers waits for the socket at a time, while the others wait for being told
+        /// about anything being received, as data for their channels is received along with its own.
+        ///
+        /// The socket is waited for in slices of SocketWaitSlice, as other threads' writes may have received
+        /// this channel's data in the meantime, without the socket becoming readable again.
+        ///
+        /// @returns false on timeout.
+        bool waitForData(std::unique_lock<std::recursive_mutex>& lock,
+                         std::optional<std::chrono::steady_clock::time_point> deadline)
+        {
+            if (waitingForSocket)
+            {
+                if (!deadline)
+                {
+                    dataArrived.wait(lock);
+                    return true;
+                }
+                return dataArrived.wait_until(lock, *deadline) == std::cv_status::no_timeout;
+            }
+
+            waitingForSocket = true;
+            auto const directions = libssh2_session_block_directions(session);
+            lock.unlock();
+            auto const slice = std::chrono::steady_clock::now() + SocketWaitSlice;
+            auto const ready = waitForSocket(directions, deadline ? std::min(*deadline, slice) : slice);
+            lock.lock();
+            waitingForSocket = false;
+            dataArrived.notify_all(); // hands over waiting for the socket to the next reader
+            return ready || !deadline || std::chrono::steady_clock::now() < *deadline;
+        }
+
+        [[nodiscard]] bool waitForSocket(int directions, std::chrono::steady_clock::time_point deadline) const
+        {
+            fd_set readable;
+            fd_set writable;
+            FD_ZERO(&readable);
+            FD_ZERO(&writable);
+            auto const outbound = (directions & LIBSSH2_SESSION_BLOCK_OUTBOUND) != 0;
+            if (outbound)
+                FD_SET(socket, &writable);
+            if ((directions & LIBSSH2_SESSION_BLOCK_INBOUND) || !outbound)
+                FD_SET(socket, &readable);
+
+            auto const remaining = std::max(std::chrono::duration_cast<std::chrono::microseconds>(
+                                                deadline - std::chrono::steady_clock::now()),
+                                            std::chrono::microseconds(0));
+            auto tv = timeval {};
+            tv.tv_sec = static_cast<decltype(tv.tv_sec)>(remaining.count() / 1'000'000);
+            tv.tv_usec = static_cast<decltype(tv.tv_usec)>(remaining.count() % 1'000'000);
+
+            return ::select((int) (socket + 1), &readable, &writable, nullptr, &tv) > 0;
+        }
+    };
+
+    // Authenticated connections, released along with the last session using them.
+    std::mutex sharedConnectionsMutex;
+
+    std::map<SshConnection::Key, std::weak_ptr<SshConnection>>& sharedConnections()
+    {
+        static auto connections = std::map<SshConnection::Key, std::weak_ptr<SshConnection>> {};
+        return connections;
+    }
+
+    SshConnection::Key connectionKey(SshHostConfig const& config)
+    {
+        return SshConnection::Key { config.hostname, config.username, config.port };
+    }
+
+    /// @returns the connection established by another session to the same destination, if still open.
+    std::shared_ptr<SshConnection> findSharedConnection(SshHostConfig const& config)
+    {
+        auto const _ = std::scoped_lock { sharedConnectionsMutex };
+        auto& connections = sharedConnections();
+        std::erase_if(connections, [](auto const& entry) { return entry.second.expired(); });
+
+        auto const i = connections.find(connectionKey(config));
+        if (i == connections.end())
+            return nullptr;
+
+        auto connection = i->second.lock();
+        if (!connection || !connection->socket.is_open())
+            return nullptr;
+        return connection;
+    }
+} // namespace
+// }}}
+
 struct SshSession::Private
 {
-    LIBSSH2_SESSION* sshSession = nullptr;
+    std::shared_ptr<SshConnection> connection = std::make_shared<SshConnection>();
     LIBSSH2_CHANNEL* sshChannel = nullptr;
-    LIBSSH2_AGENT* sshAgent = nullptr;
+    bool sharedConnection = false; // whether the connection was established by another session
     bool wantsWaitForSocket = false;
 
-    socket_handle sshSocket;
+    // Channel throughput, as reported by inspect().
+    static constexpr auto ThroughputSampleInterval = std::chrono::seconds(1);
+    std::chrono::steady_clock::time_point operationalSince {};
+    std::chrono::steady_clock::time_point sampleStart {};
+    uint64_t sampleBytes = 0;
+    uint64_t peakBytesPerSecond = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t bytesSent = 0;
+
+    void received(size_t n, std::chrono::steady_clock::time_point now) noexcept
+    {
+        bytesReceived += n;
+        sampleBytes += n;
+        if (auto const elapsed = now - sampleStart; elapsed >= ThroughputSampleInterval)
+        {
+            auto const seconds = std::chrono::duration<double>(elapsed).count();
+            auto const bytesPerSecond = static_cast<uint64_t>(static_cast<double>(sampleBytes) / seconds);
+            peakBytesPerSecond = std::max(peakBytesPerSecond, bytesPerSecond);
+            sampleStart = now;
+            sampleBytes = 0;
+        }
+    }
 };
 
 SshSession::SshSession(SshHostConfig config):
@@ -329,42 +505,27 @@ SshSession::SshSession(SshHostConfig config):
     libssh2_init(0); // TODO: call only once?
 
 #if defined(SSH_SESSION_NB_IO)
-    libssh2_session_set_blocking(_p->sshSession, 0);
+    libssh2_session_set_blocking(_p->connection->session, 0);
 #endif
 
     std::atexit([]() { libssh2_exit(); });
 
-    _p->sshSession = libssh2_session_init();
+    _p->connection->session = libssh2_session_init();
 }
 
 SshSession::~SshSession()
 {
     close();
 
-    if (_p->sshAgent)
-    {
-        libssh2_agent_disconnect(_p->sshAgent);
-        libssh2_agent_free(_p->sshAgent);
-        _p->sshAgent = nullptr;
-    }
-
     if (_p->sshChannel)
     {
-        libssh2_channel_send_eof(_p->sshChannel);
-        libssh2_channel_close(_p->sshChannel);
+        auto const _ = std::scoped_lock { _p->connection->mutex };
+        libssh2_session_set_blocking(_p->connection->session, 1);
+        libssh2_channel_free(_p->sshChannel);
         _p->sshChannel = nullptr;
     }
 
-    if (_p->sshSession)
-    {
-        libssh2_session_disconnect(_p->sshSession, "Normal shutdown");
-        libssh2_session_free(_p->sshSession);
-        _p->sshSession = nullptr;
-    }
-
-#if defined(_WIN32)
-    WSACleanup();
-#endif
+    // The connection itself is disconnected along with the last session using it.
 }
 
 void SshSession::setState(State nextState)
@@ -376,6 +537,12 @@ void SshSession::setState(State nextState)
 
     _state = nextState;
 
+    if (_state == State::Operational && _p->operationalSince == std::chrono::steady_clock::time_point {})
+    {
+        _p->operationalSince = std::chrono::steady_clock::now();
+        _p->sampleStart = _p->operationalSince;
+    }
+
     if (_state == State::Closed || _state == State::Failure)
     {
         auto const _ = std::lock_guard { _closedMutex };
@@ -385,6 +552,15 @@ void SshSession::setState(State nextState)
 
 void SshSession::processState()
 {
+    if (_state == State::Operational)
+        return;
+
+    // The state machine's I/O may receive data for the other channels on the connection, too.
+    auto& connection = *_p->connection;
+    auto const notify = crispy::finally { [&]() { connection.dataArrived.notify_all(); } };
+    auto const lock = std::scoped_lock { connection.mutex };
+    libssh2_session_set_blocking(connection.session, StateMachineBlocking);
+
     waitForSocket();
     while (true)
     {
@@ -400,10 +576,12 @@ void SshSession::processState()
             case State::Connect:
                 if (!connect(_config.hostname, _config.port))
                     return;
+                if (_config.compression)
+                    libssh2_session_flag(_p->connection->session, LIBSSH2_FLAG_COMPRESS, 1);
                 setState(State::Handshake);
                 [[fallthrough]];
             case State::Handshake: {
-                int const rc = LIBSSH2_HANDSHAKE_FUNCTION(_p->sshSession, _p->sshSocket);
+                int const rc = LIBSSH2_HANDSHAKE_FUNCTION(_p->connection->session, _p->connection->socket);
                 if (rc == LIBSSH2_ERROR_EAGAIN)
                 {
                     _p->wantsWaitForSocket = true;
@@ -455,8 +633,22 @@ void SshSession::processState()
                 break;
             }
             case State::OpenChannel: {
-                _p->sshChannel = libssh2_channel_open_session(_p->sshSession);
-                auto const rc = libssh2_session_last_errno(_p->sshSession);
+                if (!_p->sharedConnection)
+                {
+                    // Being authenticated, let other sessions to the same destination use the connection.
+                    auto const _ = std::scoped_lock { sharedConnectionsMutex };
+                    sharedConnections()[connectionKey(_config)] = _p->connection;
+                }
+
+                // libssh2 tops up the window relative to the initial one, as the channel is read from.
+                _p->sshChannel = libssh2_channel_open_ex(_p->connection->session,
+                                                         "session",
+                                                         sizeof("session") - 1,
+                                                         _config.windowSize,
+                                                         _config.packetSize,
+                                                         nullptr,
+                                                         0);
+                auto const rc = libssh2_session_last_errno(_p->connection->session);
                 if (rc == LIBSSH2_ERROR_EAGAIN)
                 {
                     _p->wantsWaitForSocket = true;
@@ -612,6 +804,15 @@ void SshSession::start()
     assert(_state == State::Initial);
     // auto const _ = std::lock_guard { _mutex };
     setState(State::Started);
+
+    if (auto connection = findSharedConnection(_config))
+    {
+        logInfo("Opening a channel on the existing connection to {}.", _config.hostname);
+        _p->connection = std::move(connection);
+        _p->sharedConnection = true;
+        setState(State::OpenChannel);
+    }
+
     processState();
 
     /*
@@ -659,20 +860,26 @@ void SshSession::close()
 {
     setState(State::Closed);
 
+    auto& connection = *_p->connection;
+    auto const notify = crispy::finally { [&]() { connection.dataArrived.notify_all(); } };
+    auto const lock = std::scoped_lock { connection.mutex };
+
     if (_p->sshChannel)
     {
+        libssh2_session_set_blocking(connection.session, 1);
         libssh2_channel_send_eof(_p->sshChannel);
         libssh2_channel_close(_p->sshChannel);
         libssh2_channel_wait_closed(_p->sshChannel);
     }
 
-    if (_p->sshSocket.is_open())
-        _p->sshSocket.close();
+    // Other sessions may still use the connection, in which case only this session's channel is closed.
+    if (_p->connection.use_count() == 1 && connection.socket.is_open())
+        connection.socket.close();
 }
 
 bool SshSession::isClosed() const noexcept
 {
-    return _p->sshSocket.is_closed() || _state == State::Closed || _state == State::Failure;
+    return _p->connection->socket.is_closed() || _state == State::Closed || _state == State::Failure;
 }
 
 void SshSession::waitForClosed()
@@ -712,17 +919,29 @@ SshSession::ReadResult SshSession::read(crispy::buffer_object<char>& storage,
         return std::nullopt;
     }
 
-    waitForSocket(timeout);
-    // auto _ = std::unique_lock { _mutex };
-    auto const rc =
-        libssh2_channel_read(_p->sshChannel, storage.hotEnd(), std::min(storage.bytesAvailable(), size));
-
-    if (rc == LIBSSH2_ERROR_EAGAIN)
+    // The connection may be shared with other sessions, so it's read from without blocking while
+    // having it locked, and waited for with it unlocked.
+    auto& connection = *_p->connection;
+    auto deadline = std::optional<std::chrono::steady_clock::time_point> {};
+    if (timeout)
+        deadline = std::chrono::steady_clock::now() + *timeout;
+    auto lock = std::unique_lock { connection.mutex };
+    auto rc = ssize_t {};
+    while (true)
     {
-        _p->wantsWaitForSocket = true;
-        errno = EAGAIN;
-        return std::nullopt;
+        libssh2_session_set_blocking(connection.session, 0);
+        rc = libssh2_channel_read(_p->sshChannel, storage.hotEnd(), std::min(storage.bytesAvailable(), size));
+        connection.dataArrived.notify_all(); // may have received data for the other channels, too
+        if (rc != LIBSSH2_ERROR_EAGAIN)
+            break;
+
+        if (!connection.waitForData(lock, deadline))
+        {
+            errno = EAGAIN;
+            return std::nullopt;
+        }
     }
+    lock.unlock();
 
     if (rc < 0)
     {
@@ -731,6 +950,8 @@ SshSession::ReadResult SshSession::read(crispy::buffer_object<char>& storage,
         return std::nullopt;
     }
 
+    _p->received(static_cast<size_t>(rc), std::chrono::steady_clock::now());
+
     auto const target = std::string_view { (char const*) storage.hotEnd(), static_cast<size_t>(rc) };
     auto const isStdFastPipe = false; // can never be, because it's an SSH network connection
     if (ptyInLog)
@@ -796,12 +1017,18 @@ int SshSession::write(std::string_view buf)
         return static_cast<int>(buf.size()); // Make the caller believe that we have written all bytes.
     }
 
-    waitForSocket();
-    auto const rv = libssh2_channel_write(_p->sshChannel, buf.data(), buf.size());
+    // Never blocks, not to stall the other sessions on the connection, leaving it to the caller to retry.
+    auto& connection = *_p->connection;
+    auto rv = ssize_t {};
+    {
+        auto const lock = std::scoped_lock { connection.mutex };
+        libssh2_session_set_blocking(connection.session, 0);
+        rv = libssh2_channel_write(_p->sshChannel, buf.data(), buf.size());
+        connection.dataArrived.notify_all();
+    }
 
     if (rv == LIBSSH2_ERROR_EAGAIN)
     {
-        _p->wantsWaitForSocket = true;
         errno = EAGAIN;
         return -1;
     }
@@ -813,6 +1040,8 @@ int SshSession::write(std::string_view buf)
         return -1;
     }
 
+    _p->bytesSent += static_cast<uint64_t>(rv);
+
     if (ptyOutLog)
     {
         if (rv >= 0)
@@ -848,6 +1077,31 @@ void SshSession::resizeScreen(PageSize cells, std::optional<ImageSize> pixels)
     }
 }
 
+void SshSession::inspect(std::ostream& output) const
+{
+    auto constexpr MB = 1024.0 * 1024.0;
+    auto const seconds =
+        _p->operationalSince == std::chrono::steady_clock::time_point {}
+            ? 0.0
+            : std::chrono::duration<double>(std::chrono::steady_clock::now() - _p->operationalSince).count();
+    auto const averageBytesPerSecond = seconds > 0.0 ? static_cast<double>(_p->bytesReceived) / seconds : 0.0;
+
+    output << fmt::format("SSH session: {} ({})\n", _config.toString(), _state);
+    output << fmt::format("SSH connection: {}, used by {} session(s)\n",
+                          _p->sharedConnection ? "shared" : "own",
+                          _p->connection.use_count());
+    output << fmt::format("SSH channel: window {} KB, packets of up to {} bytes\n",
+                          _config.windowSize / 1024,
+                          _config.packetSize);
+    output << fmt::format("SSH throughput: received {:.1f} MB ({:.2f} MB/s average, {:.2f} MB/s peak), "
+                          "sent {} bytes, over {:.0f} s\n",
+                          static_cast<double>(_p->bytesReceived) / MB,
+                          averageBytesPerSecond / MB,
+                          static_cast<double>(_p->peakBytesPerSecond) / MB,
+                          _p->bytesSent,
+                          seconds);
+}
+
 bool SshSession::isOperational() const noexcept
 {
     // clang-format off
@@ -863,6 +1117,7 @@ bool SshSession::isOperational() const noexcept
 
 std::optional<SshSession::ExitStatus> SshSession::exitStatus() const
 {
+    auto const _ = std::scoped_lock { _p->connection->mutex };
     auto exitcode = libssh2_channel_get_exit_status(_p->sshChannel);
 
     char* exitSignalStr = nullptr;
@@ -911,6 +1166,7 @@ bool SshSession::connect(std::string_view host, int port)
         logError("WSAStartup failed with error: %d", wsaStartupCode);
         return false;
     }
+    _p->connection->wsaStarted = true;
 #endif
 
     try
@@ -952,10 +1208,10 @@ bool SshSession::connect(std::string_view host, int port)
                     break;
             }
 
-            _p->sshSocket = socket_handle::from_native(
+            _p->connection->socket = socket_handle::from_native(
                 socket(addrEntry->ai_family, addrEntry->ai_socktype, addrEntry->ai_protocol));
 
-            if (::connect(_p->sshSocket, addrEntry->ai_addr, addrEntry->ai_addrlen) == 0)
+            if (::connect(_p->connection->socket, addrEntry->ai_addr, addrEntry->ai_addrlen) == 0)
             {
                 auto const addrAndPort =
                     port == 22 ? std::string(addrStr) : fmt::format("{}:{}", addrStr, port);
@@ -977,7 +1233,7 @@ bool SshSession::connect(std::string_view host, int port)
     }
 
     logError("Failed to connect to {}:{}", host, port);
-    _p->sshSocket.close(); // Explicitly close socket, to indicate that we're not connected
+    _p->connection->socket.close(); // Explicitly close socket, to indicate that we're not connected
     return false;
 }
 
@@ -989,7 +1245,7 @@ bool SshSession::verifyHostKey()
         return true;
     }
 
-    LIBSSH2_KNOWNHOSTS* knownHosts = libssh2_knownhost_init(_p->sshSession);
+    LIBSSH2_KNOWNHOSTS* knownHosts = libssh2_knownhost_init(_p->connection->session);
     if (!knownHosts)
     {
         logError("Failed to initialize known_hosts file.");
@@ -1009,7 +1265,7 @@ bool SshSession::verifyHostKey()
 
     int hostkeyType = 0;
     size_t hostkeyLength = 0;
-    char const* hostkeyRaw = libssh2_session_hostkey(_p->sshSession, &hostkeyLength, &hostkeyType);
+    char const* hostkeyRaw = libssh2_session_hostkey(_p->connection->session, &hostkeyLength, &hostkeyType);
     int knownhostType = LIBSSH2_KNOWNHOST_KEY_UNKNOWN;
     switch (hostkeyType)
     {
@@ -1089,7 +1345,7 @@ void SshSession::logErrorWithDetails(int libssl2ErrorCode, std::string_view mess
 {
     char* errorMessageBuffer = nullptr;
     int errorMessageLength = 0;
-    libssh2_session_last_error(_p->sshSession, &errorMessageBuffer, &errorMessageLength, 0);
+    libssh2_session_last_error(_p->connection->session, &errorMessageBuffer, &errorMessageLength, 0);
     auto libssl2Message = std::string_view { errorMessageBuffer, static_cast<size_t>(errorMessageLength) };
 
     logError("{}: {}", message, libssl2ErrorString(libssl2ErrorCode));
@@ -1118,12 +1374,12 @@ int SshSession::waitForSocket(std::optional<std::chrono::milliseconds> timeout)
     // TODO: also watch for break signal, so we can abort waiting for socket
 
     FD_ZERO(&fd);
-    FD_SET(_p->sshSocket, &fd);
+    FD_SET(_p->connection->socket, &fd);
 
-    assert(_p->sshSession);
+    assert(_p->connection->session);
 
-    auto const dir =
-        libssh2_session_block_directions(_p->sshSession); // now make sure we wait in the correct direction
+    // now make sure we wait in the correct direction
+    auto const dir = libssh2_session_block_directions(_p->connection->session);
 
     if (dir & LIBSSH2_SESSION_BLOCK_INBOUND)
     {
@@ -1137,12 +1393,13 @@ int SshSession::waitForSocket(std::optional<std::chrono::milliseconds> timeout)
         fmt::print("({}) SshSession: waiting for socket to become readable\n", crispy::threadName());
     }
 
-    auto const rc = ::select((int) (_p->sshSocket + 1), readfd, writefd, nullptr, timeout ? &tv : nullptr);
+    auto const rc =
+        ::select((int) (_p->connection->socket + 1), readfd, writefd, nullptr, timeout ? &tv : nullptr);
     fmt::print("({}) SshSession: select() returned {}{}{}\n",
                crispy::threadName(),
                rc,
-               readfd && FD_ISSET(_p->sshSocket, readfd) ? " [readable]" : "",
-               writefd && FD_ISSET(_p->sshSocket, writefd) ? " [writable]" : "");
+               readfd && FD_ISSET(_p->connection->socket, readfd) ? " [readable]" : "",
+               writefd && FD_ISSET(_p->connection->socket, writefd) ? " [writable]" : "");
     return rc;
 #else
     crispy::ignore_unused(timeout);
@@ -1154,7 +1411,7 @@ void SshSession::authenticateWithPrivateKey()
 {
     auto const password = _injectedWrite;
     auto const rc = libssh2_userauth_publickey_fromfile_ex(
-        _p->sshSession,
+        _p->connection->session,
         _config.username.data(),
         _config.username.size(),
         _config.publicKeyFile.empty() ? nullptr : _config.publicKeyFile.string().data(),
@@ -1188,7 +1445,7 @@ void SshSession::authenticateWithPassword()
     auto const password = std::move(_injectedWrite);
     _injectedWrite = {};
 
-    int const rc = libssh2_userauth_password_ex(_p->sshSession,
+    int const rc = libssh2_userauth_password_ex(_p->connection->session,
                                                 _config.username.data(),
                                                 _config.username.size(),
                                                 password.data(),
@@ -1223,23 +1480,23 @@ void SshSession::authenticateWithPassword()
 
 bool SshSession::authenticateWithAgent()
 {
-    if (!_p->sshAgent)
+    if (!_p->connection->agent)
     {
-        _p->sshAgent = libssh2_agent_init(_p->sshSession);
-        if (!_p->sshAgent)
+        _p->connection->agent = libssh2_agent_init(_p->connection->session);
+        if (!_p->connection->agent)
         {
             logError("Failed to initialize SSH agent.");
             return false;
         }
 
-        int rc = libssh2_agent_connect(_p->sshAgent);
+        int rc = libssh2_agent_connect(_p->connection->agent);
         if (rc != LIBSSH2_ERROR_NONE)
         {
             logError("Failed to connect to SSH agent. {}", libssl2ErrorString(rc));
             return false;
         }
 
-        rc = libssh2_agent_list_identities(_p->sshAgent);
+        rc = libssh2_agent_list_identities(_p->connection->agent);
         if (rc != LIBSSH2_ERROR_NONE)
         {
             logError("Failed to list SSH identities. {}", libssl2ErrorString(rc));
@@ -1253,7 +1510,7 @@ bool SshSession::authenticateWithAgent()
     libssh2_agent_publickey* prevIdentity = nullptr;
     int rc = 0;
     int i = 0;
-    while ((rc = libssh2_agent_get_identity(_p->sshAgent, &identity, prevIdentity)) == 0)
+    while ((rc = libssh2_agent_get_identity(_p->connection->agent, &identity, prevIdentity)) == 0)
     {
         prevIdentity = identity;
         if (i < _walkIndex)
@@ -1262,7 +1519,7 @@ bool SshSession::authenticateWithAgent()
             continue;
         }
 
-        rc = libssh2_agent_userauth(_p->sshAgent, _config.username.data(), identity);
+        rc = libssh2_agent_userauth(_p->connection->agent, _config.username.data(), identity);
         if (rc == LIBSSH2_ERROR_EAGAIN)
         {
             _p->wantsWaitForSocket = true;
@@ -21,6 +21,13 @@ struct SshHostConfig
 {
     using Environment = std::map<std::string, std::string>;
 
+    /// Number of bytes the server may send ahead of them being read, which is what keeps data
+    /// in flight on links with a high latency. libssh2 defaults to a much smaller window.
+    static constexpr unsigned DefaultWindowSize = 8 * 1024 * 1024;
+
+    /// Maximum number of bytes of payload for each packet, as also used by OpenSSH.
+    static constexpr unsigned DefaultPacketSize = 32 * 1024;
+
     std::string hostname;
     int port = 22;
     std::string username;
@@ -28,6 +35,9 @@ struct SshHostConfig
     std::filesystem::path publicKeyFile;
     std::filesystem::path knownHostsFile;
     bool forwardAgent = false;
+    bool compression = false; // zlib compression, trading CPU time for bandwidth on slow links
+    unsigned windowSize = DefaultWindowSize;
+    unsigned packetSize = DefaultPacketSize;
     Environment env;
 
     [[nodiscard]] std::string toString() const;
@@ -66,6 +76,7 @@ class SshSession: public Pty
     [[nodiscard]] int write(std::string_view buf) override;
     [[nodiscard]] PageSize pageSize() const noexcept override;
     void resizeScreen(PageSize cells, std::optional<ImageSize> pixels = std::nullopt) override;
+    void inspect(std::ostream& output) const override;
 
     [[nodiscard]] bool isOperational() const noexcept;
 
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace vtpty
+{
+
+/**
+ * Layout of the shared memory ring that cooperating clients may write their output into,
+ * rather than copying it through the kernel via the stdout fastpipe.
+ *
+ * The ring is a memfd, handed to the child process along with an eventfd as its doorbell,
+ * both advertised via the environment variable STDOUT_RING, as "<memfd>:<eventfd>".
+ * A client maps the memfd, verifies magic and version, and for each chunk of output:
+ *
+ *  - waits for room, i.e. capacity - (tail - head) bytes, polling head while the ring is full,
+ *  - copies the chunk to data + tail % capacity, wrapping around at the end of the data,
+ *  - stores tail + size to tail with release semantics,
+ *  - and rings the doorbell by writing 1 as 64-bit integer to the eventfd.
+ *
+ * The terminal consumes the output in order, storing the new head with release semantics,
+ * and handles it like output written to the stdout fastpipe.
+ */
+struct StdoutRingHeader
+{
+    static constexpr uint32_t Magic = 0x524f4443; // "CDOR"
+    static constexpr uint32_t Version = 1;
+
+    /// Offset of the data from the start of the mapping.
+    static constexpr size_t DataOffset = 4096;
+
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity; // size of the data in bytes, a power of two
+
+    // Total numbers of bytes consumed by the terminal, and produced by the client.
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(sizeof(StdoutRingHeader) <= StdoutRingHeader::DataOffset);
+
+constexpr inline std::string_view StdoutRingEnvironmentName = "STDOUT_RING";
+
+} // namespace vtpty
@@ -1,17 +1,23 @@
 // SPDX-License-Identifier: Apache-2.0
+#include <vtpty/StdoutRing.h>
 #include <vtpty/UnixPty.h>
 #include <vtpty/UnixUtils.h>
 
 #include <crispy/BufferObject.h>
 #include <crispy/deferred.h>
 #include <crispy/escape.h>
+#include <crispy/io_ring.h>
 #include <crispy/logstore.h>
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <limits>
+#include <new>
 #include <stdexcept>
 #include <string>
 #include <thread>
@@ -29,13 +35,19 @@
     #include <utmp.h>
 #endif
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/select.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 
 #include <pwd.h>
 #include <unistd.h>
 
+#if defined(__linux__)
+    #include <sys/eventfd.h>
+#endif
+
 #if defined(__linux__) && !defined(FLATPAK)
     #include <utempter.h>
 #endif
@@ -98,6 +110,233 @@ namespace
 #endif
 } // namespace
 
+// {{{ UnixPty::RingReader
+/// Keeps a read posted via io_uring against each of the master, the stdout fastpipe,
+/// and an eventfd for waking up the reader, each landing in its own region of a single mapping.
+/// Queued input is written to the master from yet another region, one chunk at a time.
+///
+/// Data is not read into the caller's buffer object directly, as other threads may write at its hot end
+/// while a read is posted, e.g. when writing to the screen locally.
+struct UnixPty::RingReader
+{
+    enum Source : uint8_t
+    {
+        Master,
+        StdoutFastPipe,
+        Wakeup,
+        StdoutRingDoorbell,
+        SourceCount
+    };
+
+    struct PostedRead
+    {
+        int fd = -1; // -1 once the source has been closed
+        char* data = nullptr;
+        unsigned capacity = 0;
+        bool posted = false;
+        size_t size = 0;   // number of bytes received
+        size_t offset = 0; // number of received bytes already handed out
+    };
+
+    static constexpr unsigned ReadSize = 64 * 1024;
+
+    /// User data of the completions of writes to the master.
+    static constexpr uint64_t MasterWrite = SourceCount;
+
+    static std::unique_ptr<RingReader> create(int masterFd, int stdoutFastPipeFd, int stdoutRingDoorbellFd);
+
+    RingReader() = default;
+    RingReader(RingReader const&) = delete;
+    RingReader& operator=(RingReader const&) = delete;
+    RingReader(RingReader&&) = delete;
+    RingReader& operator=(RingReader&&) = delete;
+    ~RingReader();
+
+    void post(Source source) noexcept;
+
+    std::unique_ptr<crispy::io_ring> ring;
+    file_descriptor wakeupFd;
+    void* memory = nullptr;
+    size_t memorySize = 0;
+    bool fixedBuffers = false;
+    std::array<PostedRead, SourceCount> reads {};
+    char* writeData = nullptr;
+    bool writePosted = false;
+};
+
+std::unique_ptr<UnixPty::RingReader> UnixPty::RingReader::create([[maybe_unused]] int masterFd,
+                                                                [[maybe_unused]] int stdoutFastPipeFd,
+                                                                [[maybe_unused]] int stdoutRingDoorbellFd)
+{
+#if defined(__linux__)
+    auto reader = make_unique<RingReader>();
+    reader->ring = crispy::io_ring::create(2 * SourceCount);
+    if (!reader->ring)
+        return nullptr;
+
+    auto const wakeupFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeupFd < 0)
+        return nullptr;
+    reader->wakeupFd = file_descriptor::from_native(wakeupFd);
+
+    // Mapped rather than heap memory, as posted reads may still land in it after the ring is gone.
+    reader->memorySize = 2 * size_t { ReadSize } + WriteChunkSize + 2 * sizeof(uint64_t);
+    reader->memory =
+        mmap(nullptr, reader->memorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reader->memory == MAP_FAILED)
+    {
+        reader->memory = nullptr;
+        return nullptr;
+    }
+
+    // Registered memory saves the kernel from mapping it on every read, but is limited by RLIMIT_MEMLOCK.
+    reader->fixedBuffers = reader->ring->register_buffer(reader->memory, reader->memorySize);
+
+    auto* const data = static_cast<char*>(reader->memory);
+    reader->reads[Master] = { masterFd, data, ReadSize };
+    reader->reads[StdoutFastPipe] = { stdoutFastPipeFd, data + ReadSize, ReadSize };
+    reader->writeData = data + 2 * ReadSize;
+    reader->reads[Wakeup] = { reader->wakeupFd.get(), reader->writeData + WriteChunkSize, sizeof(uint64_t) };
+    reader->reads[StdoutRingDoorbell] = { stdoutRingDoorbellFd,
+                                          reader->reads[Wakeup].data + sizeof(uint64_t),
+                                          sizeof(uint64_t) };
+    for (auto const source: { Master, StdoutFastPipe, Wakeup, StdoutRingDoorbell })
+        reader->post(source);
+    return reader;
+#else
+    return nullptr;
+#endif
+}
+
+UnixPty::RingReader::~RingReader()
+{
+    // The ring must be gone before the memory its posted reads land in.
+    ring.reset();
+    if (memory)
+        munmap(memory, memorySize);
+}
+
+void UnixPty::RingReader::post(Source source) noexcept
+{
+    auto& read = reads[source];
+    if (read.fd < 0 || read.posted)
+        return;
+
+    read.size = 0;
+    read.offset = 0;
+    read.posted = fixedBuffers ? ring->read_fixed(read.fd, read.data, read.capacity, source)
+                               : ring->read(read.fd, read.data, read.capacity, source);
+}
+// }}}
+
+// {{{ UnixPty::StdoutRing
+/// The terminal's end of the shared memory ring laid out as described by StdoutRingHeader.
+struct UnixPty::StdoutRing
+{
+    /// Largest ring offered, which also keeps the offsets within the data representable as int.
+    static constexpr size_t MaxCapacity = size_t { 1 } << 30;
+
+    /// First file descriptor the ring's ones are moved to, above the ones the child inherits them as,
+    /// so that handing them over cannot clobber them.
+    static constexpr int MinFd = 16;
+
+    static std::unique_ptr<StdoutRing> create(size_t capacity);
+
+    StdoutRing() = default;
+    StdoutRing(StdoutRing const&) = delete;
+    StdoutRing& operator=(StdoutRing const&) = delete;
+    StdoutRing(StdoutRing&&) = delete;
+    StdoutRing& operator=(StdoutRing&&) = delete;
+    ~StdoutRing();
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return header->tail.load(std::memory_order_acquire) == header->head.load(std::memory_order_relaxed);
+    }
+
+    /// Moves up to @p limit bytes of output to @p target.
+    ///
+    /// @returns the number of bytes moved.
+    size_t take(char* target, size_t limit) noexcept;
+
+    void clearDoorbell() noexcept
+    {
+        uint64_t value = 0;
+        [[maybe_unused]] auto const _ = ::read(doorbellFd, &value, sizeof(value));
+    }
+
+    file_descriptor memoryFd;
+    file_descriptor doorbellFd;
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    StdoutRingHeader* header = nullptr;
+    char* data = nullptr;
+};
+
+std::unique_ptr<UnixPty::StdoutRing> UnixPty::StdoutRing::create([[maybe_unused]] size_t capacity)
+{
+#if defined(__linux__)
+    auto const moveAboveInherited = [](int fd) {
+        if (fd < 0)
+            return fd;
+        auto const movedFd = fcntl(fd, F_DUPFD_CLOEXEC, MinFd);
+        ::close(fd);
+        return movedFd;
+    };
+
+    auto ring = make_unique<StdoutRing>();
+    ring->memoryFd =
+        file_descriptor::from_native(moveAboveInherited(memfd_create("contour-stdout-ring", MFD_CLOEXEC)));
+    ring->doorbellFd =
+        file_descriptor::from_native(moveAboveInherited(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)));
+    if (ring->memoryFd.is_closed() || ring->doorbellFd.is_closed())
+        return nullptr;
+
+    capacity = std::bit_ceil(std::clamp(capacity, size_t { 4096 }, MaxCapacity));
+    ring->mappingSize = StdoutRingHeader::DataOffset + capacity;
+    if (ftruncate(ring->memoryFd, static_cast<off_t>(ring->mappingSize)) != 0)
+        return nullptr;
+
+    ring->mapping = mmap(nullptr, ring->mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, ring->memoryFd, 0);
+    if (ring->mapping == MAP_FAILED)
+    {
+        ring->mapping = nullptr;
+        return nullptr;
+    }
+
+    ring->header = new (ring->mapping)
+        StdoutRingHeader { StdoutRingHeader::Magic, StdoutRingHeader::Version, capacity, { 0 }, { 0 } };
+    ring->data = static_cast<char*>(ring->mapping) + StdoutRingHeader::DataOffset;
+    return ring;
+#else
+    return nullptr;
+#endif
+}
+
+UnixPty::StdoutRing::~StdoutRing()
+{
+    if (mapping)
+        munmap(mapping, mappingSize);
+}
+
+size_t UnixPty::StdoutRing::take(char* target, size_t limit) noexcept
+{
+    auto const capacity = header->capacity;
+    auto const head = header->head.load(std::memory_order_relaxed);
+    auto const tail = header->tail.load(std::memory_order_acquire);
+
+    // The tail is written by the client, which must not make the terminal read beyond the data.
+    auto const n = static_cast<size_t>(std::min({ tail - head, uint64_t { capacity }, uint64_t { limit } }));
+    auto const offset = static_cast<size_t>(head & (capacity - 1));
+    auto const untilEnd = std::min(n, static_cast<size_t>(capacity) - offset);
+    std::memcpy(target, data + offset, untilEnd);
+    std::memcpy(target + untilEnd, data, n - untilEnd);
+
+    header->head.store(head + n, std::memory_order_release);
+    return n;
+}
+// }}}
+
 // {{{ UnixPty::Slave
 UnixPty::Slave::~Slave()
 {
@@ -186,7 +425,13 @@ int UnixPty::Slave::write(std::string_view text) noexcept
 }
 // }}}
 
-UnixPty::UnixPty(PageSize pageSize, optional<ImageSize> pixels): _pageSize { pageSize }, _pixels { pixels }
+UnixPty::UnixPty(
+    PageSize pageSize, optional<ImageSize> pixels, bool ioRing, size_t writeQueueSize, size_t stdoutRingSize):
+    _pageSize { pageSize },
+    _pixels { pixels },
+    _ioRing { ioRing },
+    _stdoutRingSize { stdoutRingSize },
+    _writeQueueSize { writeQueueSize }
 {
 }
 
@@ -205,6 +450,31 @@ void UnixPty::start()
     _readSelector.want_read(_masterFd);
     _readSelector.want_read(_stdoutFastPipe.reader());
 
+    if (_stdoutRingSize != 0)
+    {
+        _stdoutRing = StdoutRing::create(_stdoutRingSize);
+        if (_stdoutRing)
+        {
+            _readSelector.want_read(_stdoutRing->doorbellFd);
+            ptyLog()("stdout ring: {} bytes, memory {}, doorbell {}",
+                     _stdoutRing->header->capacity,
+                     _stdoutRing->memoryFd,
+                     _stdoutRing->doorbellFd);
+        }
+        else
+            ptyLog()("stdout ring is not available. {}", strerror(errno));
+    }
+
+    if (_ioRing)
+    {
+        _ringReader = RingReader::create(
+            _masterFd, _stdoutFastPipe.reader(), _stdoutRing ? _stdoutRing->doorbellFd.get() : -1);
+        if (_ringReader)
+            ptyLog()("Reading PTY via io_uring{}.", _ringReader->fixedBuffers ? " (registered buffers)" : "");
+        else
+            ptyLog()("io_uring is not available. Falling back to polling the PTY.");
+    }
+
 #if defined(__linux__) && !defined(FLATPAK)
     utempter_add_record(_masterFd, hostnameForUtmp());
 #endif
@@ -226,6 +496,13 @@ PtyMasterHandle UnixPty::handle() const noexcept
     return PtyMasterHandle::cast_from(_masterFd.get());
 }
 
+optional<UnixPty::StdoutRingHandles> UnixPty::stdoutRing() const noexcept
+{
+    if (!_stdoutRing)
+        return nullopt;
+    return StdoutRingHandles { _stdoutRing->memoryFd.get(), _stdoutRing->doorbellFd.get() };
+}
+
 void UnixPty::close()
 {
     auto const _ = std::scoped_lock { _mutex };
@@ -237,7 +514,12 @@ void UnixPty::close()
 
     ptyLog()("PTY closing master from thread {} (file descriptor {}).", crispy::threadName(), _masterFd);
     _readSelector.cancel_read(_masterFd);
+    _readSelector.cancel_write(_masterFd);
     _masterFd.close();
+    {
+        auto const _ = scoped_lock { _writeMutex };
+        clearWriteQueue();
+    }
     wakeupReader();
 }
 
@@ -248,12 +530,31 @@ bool UnixPty::isClosed() const noexcept
 
 void UnixPty::wakeupReader() noexcept
 {
-    _readSelector.wakeup();
+    if (_ringReader)
+    {
+        uint64_t const value = 1;
+        [[maybe_unused]] auto const _ = ::write(_ringReader->wakeupFd, &value, sizeof(value));
+    }
+    else
+        _readSelector.wakeup();
+}
+
+int UnixPty::readinessHandle() const noexcept
+{
+#if defined(__linux__)
+    // The selector's epoll instance covers the master, the stdout fastpipe, the stdout ring's doorbell,
+    // wakeups, and the master becoming writable while input is queued.
+    if (started() && !_ringReader)
+        return _readSelector.native_handle();
+#endif
+    return -1;
 }
 
-optional<string_view> UnixPty::readSome(int fd, char* target, size_t n) noexcept
+optional<std::pair<string_view, string_view>> UnixPty::readSome(
+    int fd, char* head, size_t headSize, char* tail, size_t tailSize) noexcept
 {
-    auto const rv = static_cast<int>(::read(fd, target, n));
+    auto const iov = std::array { iovec { head, headSize }, iovec { tail, tailSize } };
+    auto const rv = static_cast<int>(tailSize != 0 ? ::readv(fd, iov.data(), 2) : ::read(fd, head, headSize));
     if (rv < 0)
     {
         if (errno != EAGAIN && errno != EINTR)
@@ -261,10 +562,15 @@ optional<string_view> UnixPty::readSome(int fd, char* target, size_t n) noexcept
         return nullopt;
     }
 
+    auto const headBytes = min(static_cast<size_t>(rv), headSize);
+    auto const result = std::pair { string_view { head, headBytes },
+                                    string_view { tail, static_cast<size_t>(rv) - headBytes } };
+
     if (ptyInLog)
-        ptyInLog()("{} received: \"{}\"",
+        ptyInLog()("{} received: \"{}{}\"",
                    fd == _masterFd ? "master" : "stdout-fastpipe",
-                   crispy::escape(target, target + rv));
+                   crispy::escape(result.first),
+                   crispy::escape(result.second));
 
     if (rv == 0 && fd == _stdoutFastPipe.reader())
     {
@@ -275,62 +581,336 @@ optional<string_view> UnixPty::readSome(int fd, char* target, size_t n) noexcept
         return nullopt;
     }
 
-    return string_view { target, static_cast<size_t>(rv) };
+    return result;
 }
 
 Pty::ReadResult UnixPty::read(crispy::buffer_object<char>& storage,
                               std::optional<std::chrono::milliseconds> timeout,
                               size_t size)
 {
+    if (_ringReader)
+    {
+        auto const result = readFromRing(storage, nullptr, timeout, size);
+        if (!result)
+            return nullopt;
+        return { tuple { result->head, result->fromStdoutFastPipe } };
+    }
+
     assert(_readSelector.size() > 0);
 
-    if (auto const fd = _readSelector.wait_one(timeout); fd.has_value())
+    if (auto const x = takeFromStdoutRing(storage, nullptr, size))
+        return { tuple { x->head, x->fromStdoutFastPipe } };
+
+    if (auto const fd = waitForReadable(timeout); fd.has_value())
     {
+        if (isStdoutRingDoorbell(*fd))
+        {
+            _stdoutRing->clearDoorbell();
+            if (auto const x = takeFromStdoutRing(storage, nullptr, size))
+                return { tuple { x->head, x->fromStdoutFastPipe } };
+            errno = EAGAIN;
+            return nullopt;
+        }
+
         auto const l = scoped_lock { storage };
         if (auto x = readSome(*fd, storage.hotEnd(), min(size, storage.bytesAvailable())))
-            return { tuple { x.value(), *fd == _stdoutFastPipe.reader() } };
+            return { tuple { x->first, *fd == _stdoutFastPipe.reader() } };
     }
     else
         errno = EAGAIN;
     return nullopt;
 }
 
+optional<Pty::ScatteredRead> UnixPty::readScattered(crispy::buffer_object<char>& storage,
+                                                    crispy::buffer_object<char>& overflow,
+                                                    std::optional<std::chrono::milliseconds> timeout,
+                                                    size_t size)
+{
+    if (_ringReader)
+        return readFromRing(storage, &overflow, timeout, size);
+
+    assert(_readSelector.size() > 0);
+
+    if (auto x = takeFromStdoutRing(storage, &overflow, size))
+        return x;
+
+    if (auto const fd = waitForReadable(timeout); fd.has_value())
+    {
+        if (isStdoutRingDoorbell(*fd))
+        {
+            _stdoutRing->clearDoorbell();
+            if (auto x = takeFromStdoutRing(storage, &overflow, size))
+                return x;
+            errno = EAGAIN;
+            return nullopt;
+        }
+
+        // Locked one by one, as locking both at once requires try_lock(), which buffer objects lack.
+        auto const storageLock = scoped_lock { storage };
+        auto const overflowLock = scoped_lock { overflow };
+        auto const headSize = min(size, storage.bytesAvailable());
+        auto const tailSize = min(size - headSize, overflow.bytesAvailable());
+        if (auto x = readSome(*fd, storage.hotEnd(), headSize, overflow.hotEnd(), tailSize))
+            return ScatteredRead { x->first, x->second, *fd == _stdoutFastPipe.reader() };
+    }
+    else
+        errno = EAGAIN;
+    return nullopt;
+}
+
+optional<Pty::ScatteredRead> UnixPty::takeFromStdoutRing(crispy::buffer_object<char>& storage,
+                                                         crispy::buffer_object<char>* overflow,
+                                                         size_t size) noexcept
+{
+    if (!_stdoutRing || _stdoutRing->empty())
+        return nullopt;
+
+    auto const takeInto = [&](crispy::buffer_object<char>& target, size_t limit) {
+        auto const l = scoped_lock { target };
+        auto const n = _stdoutRing->take(target.hotEnd(), min(limit, target.bytesAvailable()));
+        return string_view { target.hotEnd(), n };
+    };
+
+    auto result = ScatteredRead {};
+    result.fromStdoutFastPipe = true;
+    result.head = takeInto(storage, size);
+    if (overflow && result.head.size() < size)
+        result.tail = takeInto(*overflow, size - result.head.size());
+
+    if (ptyInLog)
+        ptyInLog()(
+            "stdout-ring received: \"{}{}\"", crispy::escape(result.head), crispy::escape(result.tail));
+    return result;
+}
+
+bool UnixPty::isStdoutRingDoorbell(int fd) const noexcept
+{
+    return _stdoutRing && fd == _stdoutRing->doorbellFd.get();
+}
+
+optional<Pty::ScatteredRead> UnixPty::readFromRing(crispy::buffer_object<char>& storage,
+                                                   crispy::buffer_object<char>* overflow,
+                                                   std::optional<std::chrono::milliseconds> timeout,
+                                                   size_t size)
+{
+    auto& reader = *_ringReader;
+    auto& master = reader.reads[RingReader::Master];
+    if (master.fd >= 0 && _masterFd.is_closed())
+        master.fd = -1;
+
+    while (true)
+    {
+        if (auto result = takeFromStdoutRing(storage, overflow, size))
+            return result;
+
+        // Hands out what has been received already, before posting the next read for that source.
+        for (auto const source: { RingReader::Master, RingReader::StdoutFastPipe })
+        {
+            auto& read = reader.reads[source];
+            if (read.fd < 0 || read.posted || read.offset == read.size)
+                continue;
+
+            auto const copyInto = [&](crispy::buffer_object<char>& target, size_t limit) {
+                auto const l = scoped_lock { target };
+                auto const n = min({ read.size - read.offset, limit, target.bytesAvailable() });
+                std::memcpy(target.hotEnd(), read.data + read.offset, n);
+                read.offset += n;
+                return string_view { target.hotEnd(), n };
+            };
+
+            auto result = ScatteredRead {};
+            result.fromStdoutFastPipe = source == RingReader::StdoutFastPipe;
+            result.head = copyInto(storage, size);
+            if (overflow && result.head.size() < size)
+                result.tail = copyInto(*overflow, size - result.head.size());
+            if (read.offset == read.size)
+                reader.post(source);
+
+            if (ptyInLog)
+                ptyInLog()("{} received: \"{}{}\"",
+                           result.fromStdoutFastPipe ? "stdout-fastpipe" : "master",
+                           crispy::escape(result.head),
+                           crispy::escape(result.tail));
+            return result;
+        }
+
+        // Submits the reads posted since, along with waiting for any of them to complete.
+        postQueuedWrite();
+        if (auto const rv = reader.ring->submit_and_wait(timeout); rv < 0)
+        {
+            errno = rv == -ETIME ? EAGAIN : -rv;
+            return nullopt;
+        }
+
+        auto wokenUp = false;
+        while (auto const completion = reader.ring->pop_completion())
+        {
+            if (completion->user_data == RingReader::MasterWrite)
+            {
+                auto const _ = scoped_lock { _writeMutex };
+                reader.writePosted = false;
+                if (completion->result > 0)
+                    consumeWriteQueue(static_cast<size_t>(completion->result));
+                else if (completion->result != -EAGAIN && completion->result != -EINTR)
+                {
+                    errorLog()("master write failed: {}", strerror(-completion->result));
+                    clearWriteQueue();
+                }
+                continue;
+            }
+
+            auto const source = static_cast<RingReader::Source>(completion->user_data);
+            auto& read = reader.reads[source];
+            read.posted = false;
+            if (source == RingReader::Wakeup || source == RingReader::StdoutRingDoorbell
+                || completion->result == -EAGAIN || completion->result == -EINTR)
+            {
+                wokenUp = wokenUp || source == RingReader::Wakeup;
+                reader.post(source);
+            }
+            else if (completion->result < 0)
+            {
+                errorLog()("{} read failed: {}",
+                           source == RingReader::Master ? "master" : "stdout-fastpipe",
+                           strerror(-completion->result));
+                if (source == RingReader::Master)
+                {
+                    errno = -completion->result;
+                    return nullopt;
+                }
+                read.fd = -1;
+            }
+            else if (completion->result == 0 && source == RingReader::StdoutFastPipe)
+            {
+                ptyInLog()("Closing stdout-fastpipe.");
+                read.fd = -1;
+                _stdoutFastPipe.closeReader();
+            }
+            else if (completion->result == 0)
+            {
+                // End of stream, reported as an empty read, as when reading directly.
+                return ScatteredRead {};
+            }
+            else
+                read.size = static_cast<size_t>(completion->result);
+        }
+
+        if (wokenUp)
+        {
+            errno = EAGAIN;
+            return nullopt;
+        }
+    }
+}
+
 int UnixPty::write(std::string_view data)
 {
-    auto const* buf = data.data();
-    auto const size = data.size();
+    auto const _ = scoped_lock { _writeMutex };
+    auto written = size_t { 0 };
 
-    ssize_t rv = ::write(_masterFd, buf, size);
-    if (ptyOutLog)
+    // Earlier input still being queued must be written first.
+    if (_writeQueueOffset == _writeQueue.size())
     {
-        if (rv >= 0)
-            ptyOutLog()("Sending bytes: \"{}\"", crispy::escape(buf, buf + rv));
-
-        if (rv < 0)
-            // errorlog()("PTY write failed: {}", strerror(errno));
-            ptyOutLog()("PTY write of {} bytes failed. {}\n", size, strerror(errno));
-        else if (0 <= rv && static_cast<size_t>(rv) < size)
-            // clang-format off
-            ptyOutLog()("Partial write. {} bytes written and {} bytes left.",
-                        rv,
-                        size - static_cast<size_t>(rv));
-        // clang-format on
+        auto const rv = ::write(_masterFd, data.data(), data.size());
+        if (rv < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            ptyOutLog()("PTY write of {} bytes failed. {}", data.size(), strerror(errno));
+            return -1;
+        }
+        written = static_cast<size_t>(max(rv, ssize_t { 0 }));
+        if (ptyOutLog && written != 0)
+            ptyOutLog()("Sending bytes: \"{}\"", crispy::escape(data.substr(0, written)));
     }
 
-    if (0 <= rv && static_cast<size_t>(rv) < size)
+    // The rest is written by the reader once the master is writable again, rather than blocking here.
+    auto const pending = _writeQueue.size() - _writeQueueOffset;
+    auto const queued = min(data.size() - written, _writeQueueSize - min(_writeQueueSize, pending));
+    if (queued != 0)
     {
-        util::setFileBlocking(_masterFd, true);
-        auto const rv2 = ::write(_masterFd, buf + rv, size - rv);
-        util::setFileBlocking(_masterFd, false);
-        if (rv2 >= 0)
+        _writeQueue.erase(0, _writeQueueOffset);
+        _writeQueueOffset = 0;
+        _writeQueue.append(data.substr(written, queued));
+        ptyOutLog()("Queued {} bytes, {} bytes pending.", queued, _writeQueue.size());
+        wakeupReader();
+    }
+
+    return static_cast<int>(written + queued);
+}
+
+size_t UnixPty::pendingWriteBytes() const noexcept
+{
+    auto const _ = scoped_lock { _writeMutex };
+    return _writeQueue.size() - _writeQueueOffset;
+}
+
+optional<int> UnixPty::waitForReadable(std::optional<std::chrono::milliseconds> timeout)
+{
+    flushWriteQueue();
+
+    // Having become writable only, the caller is told to try again, which keeps flushing the queue.
+    return _readSelector.wait_one(timeout);
+}
+
+void UnixPty::flushWriteQueue() noexcept
+{
+    auto const _ = scoped_lock { _writeMutex };
+    if (auto const pending = string_view { _writeQueue }.substr(_writeQueueOffset); !pending.empty())
+    {
+        auto const rv = ::write(_masterFd, pending.data(), min(pending.size(), WriteChunkSize));
+        if (rv > 0)
+            consumeWriteQueue(static_cast<size_t>(rv));
+        else if (rv < 0 && errno != EAGAIN && errno != EINTR)
         {
-            if (ptyOutLog)
-                ptyOutLog()("Sending bytes: \"{}\"", crispy::escape(buf + rv, buf + rv + rv2));
-            return static_cast<int>(rv + rv2);
+            errorLog()("master write failed: {}", strerror(errno));
+            clearWriteQueue();
         }
     }
 
-    return static_cast<int>(rv);
+    auto const waitForWritable = _writeQueueOffset != _writeQueue.size() && !_masterFd.is_closed();
+    if (waitForWritable == _waitingForWritable)
+        return;
+
+    if (waitForWritable)
+        _readSelector.want_write(_masterFd);
+    else if (!_masterFd.is_closed())
+        _readSelector.cancel_write(_masterFd);
+    _waitingForWritable = waitForWritable;
+}
+
+void UnixPty::postQueuedWrite() noexcept
+{
+    auto& reader = *_ringReader;
+    if (reader.writePosted || _masterFd.is_closed())
+        return;
+
+    auto const _ = scoped_lock { _writeMutex };
+    auto const pending = string_view { _writeQueue }.substr(_writeQueueOffset);
+    if (pending.empty())
+        return;
+
+    // The chunk is copied, as write() may reallocate the queue while the write is posted.
+    auto const size = static_cast<unsigned>(min(pending.size(), WriteChunkSize));
+    std::memcpy(reader.writeData, pending.data(), size);
+    reader.writePosted =
+        reader.fixedBuffers
+            ? reader.ring->write_fixed(_masterFd, reader.writeData, size, RingReader::MasterWrite)
+            : reader.ring->write(_masterFd, reader.writeData, size, RingReader::MasterWrite);
+}
+
+void UnixPty::consumeWriteQueue(size_t n) noexcept
+{
+    if (ptyOutLog)
+        ptyOutLog()("Sending bytes: \"{}\"",
+                    crispy::escape(string_view { _writeQueue }.substr(_writeQueueOffset, n)));
+    _writeQueueOffset += n;
+    if (_writeQueueOffset == _writeQueue.size())
+        clearWriteQueue();
+}
+
+void UnixPty::clearWriteQueue() noexcept
+{
+    _writeQueue.clear();
+    _writeQueueOffset = 0;
 }
 
 PageSize UnixPty::pageSize() const noexcept
@@ -11,6 +11,8 @@
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <string>
+#include <utility>
 
 #if defined(__APPLE__)
     #include <util.h>
@@ -48,7 +50,21 @@ class UnixPty final: public Pty
         PtySlaveHandle slave;
     };
 
-    UnixPty(PageSize pageSize, std::optional<ImageSize> pixels);
+    struct StdoutRingHandles
+    {
+        int memory;
+        int doorbell;
+    };
+
+    /// @param ioRing          Reads the master and the stdout fastpipe via io_uring, if supported.
+    /// @param writeQueueSize  Number of bytes of input that write() queues at most, if the master is busy.
+    /// @param stdoutRingSize  Size of the shared memory ring offered to the child process for its output
+    ///                        (see StdoutRingHeader), or 0 to not offer any. Only supported on Linux.
+    UnixPty(PageSize pageSize,
+            std::optional<ImageSize> pixels,
+            bool ioRing = false,
+            size_t writeQueueSize = DefaultWriteQueueSize,
+            size_t stdoutRingSize = 0);
     ~UnixPty() override;
 
     PtySlave& slave() noexcept override;
@@ -62,14 +78,51 @@ class UnixPty final: public Pty
     [[nodiscard]] ReadResult read(crispy::buffer_object<char>& storage,
                                   std::optional<std::chrono::milliseconds> timeout,
                                   size_t size) override;
+    [[nodiscard]] std::optional<ScatteredRead> readScattered(crispy::buffer_object<char>& storage,
+                                                             crispy::buffer_object<char>& overflow,
+                                                             std::optional<std::chrono::milliseconds> timeout,
+                                                             size_t size) override;
+    [[nodiscard]] int readinessHandle() const noexcept override;
     int write(std::string_view data) override;
+    [[nodiscard]] size_t pendingWriteBytes() const noexcept override;
     [[nodiscard]] PageSize pageSize() const noexcept override;
     void resizeScreen(PageSize cells, std::optional<ImageSize> pixels = std::nullopt) override;
 
     UnixPipe& stdoutFastPipe() noexcept { return _stdoutFastPipe; }
 
+    /// @returns the slave's file descriptor, as long as it is open, i.e. after start().
+    [[nodiscard]] PtySlaveHandle slaveHandle() const noexcept { return _slave->handle(); }
+
+    /// @returns the file descriptors of the stdout ring to be inherited by the child process, if offered.
+    [[nodiscard]] std::optional<StdoutRingHandles> stdoutRing() const noexcept;
+
   private:
-    std::optional<std::string_view> readSome(int fd, char* target, size_t n) noexcept;
+    struct RingReader;
+    struct StdoutRing;
+
+    /// Number of queued bytes written to the master at once, so that reading is not held up by writing.
+    static constexpr size_t WriteChunkSize = 64 * 1024;
+
+    // Reads up to headSize bytes into head, and any more up to tailSize bytes into tail.
+    std::optional<std::pair<std::string_view, std::string_view>> readSome(
+        int fd, char* head, size_t headSize, char* tail = nullptr, size_t tailSize = 0) noexcept;
+    // Moves the output available in the stdout ring, if any, into storage and then into overflow.
+    [[nodiscard]] std::optional<ScatteredRead> takeFromStdoutRing(crispy::buffer_object<char>& storage,
+                                                                  crispy::buffer_object<char>* overflow,
+                                                                  size_t size) noexcept;
+    [[nodiscard]] bool isStdoutRingDoorbell(int fd) const noexcept;
+    [[nodiscard]] std::optional<ScatteredRead> readFromRing(crispy::buffer_object<char>& storage,
+                                                            crispy::buffer_object<char>* overflow,
+                                                            std::optional<std::chrono::milliseconds> timeout,
+                                                            size_t size);
+
+    // Writes what the master accepts of the write queue, and waits for the master to become readable,
+    // or writable while anything still is queued.
+    [[nodiscard]] std::optional<int> waitForReadable(std::optional<std::chrono::milliseconds> timeout);
+    void flushWriteQueue() noexcept;
+    void postQueuedWrite() noexcept; // via io_uring
+    void consumeWriteQueue(size_t n) noexcept; // with _writeMutex locked
+    void clearWriteQueue() noexcept;           // with _writeMutex locked
 
     [[nodiscard]] bool started() const noexcept { return _masterFd != -1; }
 
@@ -80,6 +133,18 @@ class UnixPty final: public Pty
     std::optional<ImageSize> _pixels;
     std::unique_ptr<Slave> _slave;
     std::mutex _mutex;
+    bool _ioRing;
+    std::unique_ptr<RingReader> _ringReader; // only set while reading via io_uring
+    size_t _stdoutRingSize;
+    std::unique_ptr<StdoutRing> _stdoutRing; // only set while offered to the child process
+
+    // Input accepted by write() that the master did not take yet, written by the reader
+    // as soon as the master becomes writable.
+    mutable std::mutex _writeMutex;
+    std::string _writeQueue;
+    size_t _writeQueueOffset = 0; // number of bytes at the front of _writeQueue written already
+    size_t _writeQueueSize;
+    bool _waitingForWritable = false; // only accessed by the reader
 };
 
 } // namespace vtpty
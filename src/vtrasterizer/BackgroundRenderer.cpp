@@ -23,54 +23,138 @@ void BackgroundRenderer::setRenderTarget(RenderTarget& renderTarget,
     Renderable::setRenderTarget(renderTarget, directMappingAllocator);
 }
 
+void BackgroundRenderer::beginFrame()
+{
+    _spans.clear();
+}
+
+void BackgroundRenderer::addSpan(vtbackend::LineOffset line,
+                                 vtbackend::ColumnOffset column,
+                                 int columns,
+                                 vtbackend::RGBColor color)
+{
+    if (columns <= 0 || color == _defaultColor)
+        return;
+
+    // Cells arrive in reading order, so extending the most recent span catches most runs right away.
+    if (!_spans.empty())
+    {
+        auto& last = _spans.back();
+        if (last.line == line && last.color == color && *last.column + last.columns == *column)
+        {
+            last.columns += columns;
+            return;
+        }
+    }
+
+    _spans.emplace_back(Span { line, column, columns, 1, color });
+}
+
 void BackgroundRenderer::renderLine(vtbackend::RenderLine const& line)
 {
-    if (line.textAttributes.backgroundColor != _defaultColor)
+    auto const usedColumns = unbox<int>(line.usedColumns);
+    addSpan(line.lineOffset, vtbackend::ColumnOffset(0), usedColumns, line.textAttributes.backgroundColor);
+    addSpan(line.lineOffset,
+            vtbackend::ColumnOffset::cast_from(usedColumns),
+            unbox<int>(line.displayWidth) - usedColumns,
+            line.fillAttributes.backgroundColor);
+}
+
+void BackgroundRenderer::renderCell(vtbackend::RenderCell const& cell)
+{
+    addSpan(cell.position.line, cell.position.column, cell.width, cell.attributes.backgroundColor);
+}
+
+void BackgroundRenderer::mergeSpans()
+{
+    // Cells and lines are queued separately, so bring all spans back into reading order first.
+    auto const readingOrder = [](Span const& a, Span const& b) {
+        return a.line != b.line ? a.line < b.line : a.column < b.column;
+    };
+    if (!std::is_sorted(_spans.begin(), _spans.end(), readingOrder))
+        std::sort(_spans.begin(), _spans.end(), readingOrder);
+
+    // Joins horizontally adjacent spans of the same color.
+    // Spans that got merged into another one are marked by having no columns.
+    size_t runIndex = 0;
+    for (size_t i = 1; i < _spans.size(); ++i)
     {
-        auto const position = vtbackend::CellLocation { line.lineOffset, vtbackend::ColumnOffset(0) };
-        auto const pos = _gridMetrics.mapTopLeft(position);
-        auto const width = _gridMetrics.cellSize.width * vtbackend::Width::cast_from(line.usedColumns);
-
-        renderTarget().renderRectangle(pos.x,
-                                       pos.y,
-                                       width,
-                                       _gridMetrics.cellSize.height,
-                                       vtbackend::RGBAColor(line.textAttributes.backgroundColor, _opacity));
+        auto& run = _spans[runIndex];
+        auto& span = _spans[i];
+        if (run.line == span.line && run.color == span.color && *run.column + run.columns == *span.column)
+        {
+            run.columns += span.columns;
+            span.columns = 0;
+        }
+        else
+            runIndex = i;
     }
 
-    if (line.fillAttributes.backgroundColor != _defaultColor)
+    // Grows a span downwards for as long as the line below has a span of the same extent and color.
+    _previousLineSpans.clear();
+    _currentLineSpans.clear();
+    size_t previousIndex = 0;
+    auto currentLine = vtbackend::LineOffset(-1);
+    for (size_t i = 0; i < _spans.size(); ++i)
     {
-        auto const position =
-            vtbackend::CellLocation { line.lineOffset,
-                                      boxed_cast<vtbackend::ColumnOffset>(line.usedColumns) };
-        auto const pos = _gridMetrics.mapTopLeft(position);
-        auto const width =
-            _gridMetrics.cellSize.width * vtbackend::Width::cast_from(line.displayWidth - line.usedColumns);
-
-        renderTarget().renderRectangle(pos.x,
-                                       pos.y,
-                                       width,
-                                       _gridMetrics.cellSize.height,
-                                       vtbackend::RGBAColor(line.fillAttributes.backgroundColor, _opacity));
+        auto& span = _spans[i];
+        if (span.columns == 0)
+            continue;
+
+        if (span.line != currentLine)
+        {
+            if (currentLine + 1 == span.line)
+                std::swap(_previousLineSpans, _currentLineSpans);
+            else
+                _previousLineSpans.clear();
+            _currentLineSpans.clear();
+            previousIndex = 0;
+            currentLine = span.line;
+        }
+
+        while (previousIndex < _previousLineSpans.size()
+               && _spans[_previousLineSpans[previousIndex]].column < span.column)
+            ++previousIndex;
+
+        if (previousIndex < _previousLineSpans.size())
+        {
+            auto const aboveIndex = _previousLineSpans[previousIndex];
+            auto& above = _spans[aboveIndex];
+            if (above.column == span.column && above.columns == span.columns && above.color == span.color)
+            {
+                ++above.lines;
+                span.columns = 0;
+                _currentLineSpans.push_back(aboveIndex);
+                continue;
+            }
+        }
+        _currentLineSpans.push_back(i);
     }
 }
 
-void BackgroundRenderer::renderCell(vtbackend::RenderCell const& cell)
+void BackgroundRenderer::endFrame()
 {
-    if (cell.attributes.backgroundColor == _defaultColor)
-        return;
+    mergeSpans();
 
-    auto const pos = _gridMetrics.mapTopLeft(cell.position);
+    _renderedRectangles = 0;
+    for (auto const& span: _spans)
+    {
+        if (span.columns == 0)
+            continue;
 
-    renderTarget().renderRectangle(pos.x,
-                                   pos.y,
-                                   _gridMetrics.cellSize.width * vtbackend::Width::cast_from(cell.width),
-                                   _gridMetrics.cellSize.height,
-                                   vtbackend::RGBAColor(cell.attributes.backgroundColor, _opacity));
+        auto const pos = _gridMetrics.mapTopLeft(vtbackend::CellLocation { span.line, span.column });
+        auto const width = _gridMetrics.cellSize.width * vtbackend::Width::cast_from(span.columns);
+        auto const height = _gridMetrics.cellSize.height * vtbackend::Height::cast_from(span.lines);
+        renderTarget().renderRectangle(
+            pos.x, pos.y, width, height, vtbackend::RGBAColor(span.color, _opacity));
+        ++_renderedRectangles;
+    }
+    _spans.clear();
 }
 
-void BackgroundRenderer::inspect(std::ostream& /*output*/) const
+void BackgroundRenderer::inspect(std::ostream& output) const
 {
+    output << "BackgroundRenderer: " << _renderedRectangles << " rectangles in last frame\n";
 }
 
 } // namespace vtrasterizer
@@ -7,6 +7,7 @@
 #include <vtrasterizer/RenderTarget.h>
 
 #include <memory>
+#include <vector>
 
 namespace vtrasterizer
 {
@@ -30,17 +31,43 @@ class BackgroundRenderer: public Renderable
     // TODO: pass background color directly (instead of whole grid cell),
     // because there is no need to detect bg/fg color more than once per grid cell!
 
+    void beginFrame();
+
     /// Queues up a render with given background
     void renderCell(vtbackend::RenderCell const& cell);
 
     void renderLine(vtbackend::RenderLine const& line);
 
+    /// Coalesces all backgrounds queued up since beginFrame() into as few rectangles as possible
+    /// and renders them.
+    void endFrame();
+
     void inspect(std::ostream& output) const override;
 
   private:
+    /// A rectangular area of the grid that is filled with a single background color.
+    struct Span
+    {
+        vtbackend::LineOffset line;
+        vtbackend::ColumnOffset column;
+        int columns = 0;
+        int lines = 1;
+        vtbackend::RGBColor color;
+    };
+
+    void addSpan(vtbackend::LineOffset line,
+                 vtbackend::ColumnOffset column,
+                 int columns,
+                 vtbackend::RGBColor color);
+    void mergeSpans();
+
     // private data
     vtbackend::RGBColor const& _defaultColor;
     uint8_t _opacity = 255;
+    std::vector<Span> _spans;
+    std::vector<size_t> _previousLineSpans;
+    std::vector<size_t> _currentLineSpans;
+    size_t _renderedRectangles = 0;
 };
 
 } // namespace vtrasterizer
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <vtrasterizer/BoxDrawingRenderer.h>
 #include <vtrasterizer/Pixmap.h>
+#include <vtrasterizer/shared_defines.h>
 #include <vtrasterizer/utils.h>
 
 #include <crispy/logstore.h>
@@ -11,7 +12,9 @@
 #include <range/v3/view/iota.hpp>
 #include <range/v3/view/zip.hpp>
 
+#include <algorithm>
 #include <array>
+#include <optional>
 
 using namespace std::string_view_literals;
 
@@ -910,24 +913,93 @@ void BoxDrawingRenderer::clearCache()
     // to clear here anything. It's done for us already.
 }
 
+constexpr inline bool containsNonCanonicalLines(char32_t codepoint)
+{
+    if (codepoint < 0x2500 || codepoint > 0x257F)
+        return false;
+    auto const& box = detail::BoxDrawingDefinitions[codepoint - 0x2500];
+    return box.diagonalval != detail::NoDiagonal || box.arcval != NoArc;
+}
+
+/// Describes the given codepoint as a primitive that the fragment shader renders procedurally
+/// (see FRAGMENT_SELECTOR_BOX_DRAWING), or returns nullopt if it must be rasterized into the atlas.
+constexpr optional<atlas::NormalizedTileLocation> proceduralPrimitive(char32_t codepoint, int lineThickness)
+{
+    auto const describe = [lineThickness](int kind, unsigned parameters) {
+        return atlas::NormalizedTileLocation {
+            static_cast<float>(kind), static_cast<float>(parameters), static_cast<float>(lineThickness), 0.f
+        };
+    };
+
+    if (0x2500 <= codepoint && codepoint <= 0x257F)
+    {
+        auto const weight = [](detail::Line line) -> unsigned {
+            switch (line)
+            {
+                case detail::NoLine: return 0;
+                case detail::Light: return 1;
+                case detail::Heavy: return 2;
+                default: return 3; // dashed and double lines are not supported
+            }
+        };
+        auto const& box = detail::BoxDrawingDefinitions[codepoint - 0x2500];
+        auto const arms = std::array { weight(box.leftval), weight(box.rightval), weight(box.upval),
+                                       weight(box.downval) };
+        if (containsNonCanonicalLines(codepoint) || std::find(arms.begin(), arms.end(), 3) != arms.end())
+            return nullopt;
+        return describe(BOX_DRAWING_LINES, arms[0] | arms[1] << 2 | arms[2] << 4 | arms[3] << 6);
+    }
+
+    // x0, y0, x1, y1 in eighths of the cell, counted from its top left
+    auto const block = [&](unsigned x0, unsigned y0, unsigned x1, unsigned y1) {
+        return describe(BOX_DRAWING_BLOCK, x0 | y0 << 4 | x1 << 8 | y1 << 12);
+    };
+
+    if (0x2581 <= codepoint && codepoint <= 0x2588) // lower 1/8 .. 8/8 block
+        return block(0, 0x2588 - codepoint, 8, 8);
+
+    if (0x2589 <= codepoint && codepoint <= 0x258F) // left 7/8 .. 1/8 block
+        return block(0, 0, 0x2590 - codepoint, 8);
+
+    switch (codepoint)
+    {
+        case 0x2580: return block(0, 0, 8, 4);            // ▀ UPPER HALF BLOCK
+        case 0x2590: return block(4, 0, 8, 8);            // ▐ RIGHT HALF BLOCK
+        case 0x2594: return block(0, 0, 8, 1);            // ▔ UPPER ONE EIGHTH BLOCK
+        case 0x2595: return block(7, 0, 8, 8);            // ▕ RIGHT ONE EIGHTH BLOCK
+        case 0xE0B0: return describe(BOX_DRAWING_TRIANGLE, 0); // 
+        case 0xE0B2: return describe(BOX_DRAWING_TRIANGLE, 1); // 
+        default: return nullopt;
+    }
+}
+
 bool BoxDrawingRenderer::render(vtbackend::LineOffset line,
                                 vtbackend::ColumnOffset column,
                                 char32_t codepoint,
                                 vtbackend::RGBColor color)
 {
+    auto const pos = _gridMetrics.map(line, column);
+
+    auto renderTile = atlas::RenderTile {};
+    renderTile.x = atlas::RenderTile::X { pos.x };
+    renderTile.y = atlas::RenderTile::Y { pos.y };
+    renderTile.color = atlas::normalize(color);
+
+    // Rendered by the fragment shader for any cell size, without occupying an atlas tile.
+    if (auto const primitive = proceduralPrimitive(codepoint, _gridMetrics.underline.thickness))
+    {
+        renderTile.bitmapSize = _gridMetrics.cellSize;
+        renderTile.normalizedLocation = *primitive;
+        renderTile.fragmentShaderSelector = FRAGMENT_SELECTOR_BOX_DRAWING;
+        textureScheduler().renderTile(renderTile);
+        return true;
+    }
+
     Renderable::AtlasTileAttributes const* data = getOrCreateCachedTileAttributes(codepoint);
     if (!data)
         return false;
 
-    auto const pos = _gridMetrics.map(line, column);
-    auto const x = pos.x;
-    auto const y = pos.y;
-
-    auto renderTile = atlas::RenderTile {};
-    renderTile.x = atlas::RenderTile::X { x };
-    renderTile.y = atlas::RenderTile::Y { y };
     renderTile.bitmapSize = data->bitmapSize;
-    renderTile.color = atlas::normalize(color);
     renderTile.normalizedLocation = data->metadata.normalizedLocation;
     renderTile.tileLocation = data->location;
 
@@ -935,12 +1007,10 @@ bool BoxDrawingRenderer::render(vtbackend::LineOffset line,
     return true;
 }
 
-constexpr inline bool containsNonCanonicalLines(char32_t codepoint)
+void BoxDrawingRenderer::prewarm(char32_t codepoint)
 {
-    if (codepoint < 0x2500 || codepoint > 0x257F)
-        return false;
-    auto const& box = detail::BoxDrawingDefinitions[codepoint - 0x2500];
-    return box.diagonalval != detail::NoDiagonal || box.arcval != NoArc;
+    if (!proceduralPrimitive(codepoint, _gridMetrics.underline.thickness))
+        (void) getOrCreateCachedTileAttributes(codepoint);
 }
 
 auto BoxDrawingRenderer::createTileData(char32_t codepoint, atlas::TileLocation tileLocation)
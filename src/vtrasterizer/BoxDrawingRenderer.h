@@ -39,6 +39,10 @@ class BoxDrawingRenderer: public Renderable
                               char32_t codepoint,
                               vtbackend::RGBColor color);
 
+    /// Rasterizes the given boxdrawing character into the texture atlas ahead of rendering it,
+    /// unless it is rendered procedurally.
+    void prewarm(char32_t codepoint);
+
     void inspect(std::ostream& output) const override;
 
   private:
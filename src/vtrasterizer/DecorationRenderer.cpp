@@ -45,7 +45,38 @@ namespace
         pair { vtbackend::CellFlag::Framed, Decorator::Framed },
         pair { vtbackend::CellFlag::Encircled, Decorator::Encircle },
     };
-}
+
+    // Tests whether the decoration's tile is the same in every pixel column, such that a single tile
+    // stretched over a run of cells renders the same as one tile per cell.
+    constexpr bool isHorizontallyUniform(Decorator decoration) noexcept
+    {
+        switch (decoration)
+        {
+            case Decorator::Underline:
+            case Decorator::DoubleUnderline:
+            case Decorator::Overline:
+            case Decorator::CrossedOut:
+            case Decorator::Encircle: return true;
+            case Decorator::CurlyUnderline:
+            case Decorator::DottedUnderline:
+            case Decorator::DashedUnderline:
+            case Decorator::Framed: return false;
+        }
+        return false;
+    }
+
+    // Tests whether the cell directly follows the previous one on the same line,
+    // being decorated the same way.
+    bool continuesRun(vtbackend::RenderCell const& previous,
+                      vtbackend::RenderCell const& cell,
+                      vtbackend::CellFlag flag) noexcept
+    {
+        auto const nextColumn = previous.position.column + vtbackend::ColumnOffset::cast_from(previous.width);
+        return cell.position.line == previous.position.line && cell.position.column == nextColumn
+               && (cell.attributes.flags & flag)
+               && cell.attributes.decorationColor == previous.attributes.decorationColor;
+    }
+} // namespace
 
 DecorationRenderer::DecorationRenderer(GridMetrics const& gridMetrics,
                                        Decorator hyperlinkNormal,
@@ -101,14 +132,28 @@ void DecorationRenderer::renderLine(vtbackend::RenderLine const& line)
                              line.textAttributes.decorationColor);
 }
 
-void DecorationRenderer::renderCell(vtbackend::RenderCell const& cell)
+void DecorationRenderer::renderCells(gsl::span<vtbackend::RenderCell const> cells)
 {
     for (auto const& mapping: CellFlagDecorationMappings)
-        if (cell.attributes.flags & mapping.first)
+    {
+        for (size_t i = 0; i < cells.size();)
+        {
+            auto const& first = cells[i++];
+            if (!(first.attributes.flags & mapping.first))
+                continue;
+
+            auto columnCount = vtbackend::ColumnCount::cast_from(first.width);
+            if (isHorizontallyUniform(mapping.second))
+            {
+                while (i < cells.size() && continuesRun(cells[i - 1], cells[i], mapping.first))
+                    columnCount += vtbackend::ColumnCount::cast_from(cells[i++].width);
+            }
             renderDecoration(mapping.second,
-                             _gridMetrics.mapBottomLeft(cell.position),
-                             vtbackend::ColumnCount(1),
-                             cell.attributes.decorationColor);
+                             _gridMetrics.mapBottomLeft(first.position),
+                             columnCount,
+                             first.attributes.decorationColor);
+        }
+    }
 }
 
 auto DecorationRenderer::createTileData(Decorator decoration, atlas::TileLocation tileLocation)
@@ -295,17 +340,24 @@ void DecorationRenderer::renderDecoration(Decorator decoration,
                                           vtbackend::ColumnCount columnCount,
                                           vtbackend::RGBColor const& color)
 {
-    for (auto i = vtbackend::ColumnCount(0); i < columnCount; ++i)
+    auto const tileIndex = _directMapping.toTileIndex(static_cast<uint32_t>(decoration));
+    AtlasTileAttributes const& tileAttributes = _textureAtlas->directMapped(tileIndex);
+    auto const y = atlas::RenderTile::Y { pos.y - unbox<int>(tileAttributes.bitmapSize.height) };
+    auto const cellWidth = unbox<int>(_gridMetrics.cellSize.width);
+
+    if (isHorizontallyUniform(decoration))
     {
-        auto const tileIndex = _directMapping.toTileIndex(static_cast<uint32_t>(decoration));
-        auto const tileLocation = _textureAtlas->tileLocation(tileIndex);
-        TextureAtlas::TileCreateData tileData = createTileData(decoration, tileLocation);
-        AtlasTileAttributes const& tileAttributes = _textureAtlas->directMapped(tileIndex);
-        renderTile({ pos.x + unbox(i) * unbox<int>(_gridMetrics.cellSize.width) },
-                   { pos.y - unbox<int>(tileAttributes.bitmapSize.height) },
-                   color,
-                   tileAttributes);
+        // The atlas is sampled without filtering, so stretching the tile is exact.
+        auto tile = createRenderTile({ pos.x }, y, color, tileAttributes);
+        if (!*tile.targetSize.height)
+            tile.targetSize.height = tile.bitmapSize.height;
+        tile.targetSize.width = vtbackend::Width::cast_from(cellWidth * unbox<int>(columnCount));
+        textureScheduler().renderTile(std::move(tile));
+        return;
     }
+
+    for (auto i = vtbackend::ColumnCount(0); i < columnCount; ++i)
+        renderTile({ pos.x + (unbox<int>(i) * cellWidth) }, y, color, tileAttributes);
 }
 
 } // namespace vtrasterizer
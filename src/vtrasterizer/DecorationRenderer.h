@@ -8,6 +8,8 @@
 #include <vtrasterizer/RenderTarget.h>
 #include <vtrasterizer/TextureAtlas.h>
 
+#include <gsl/span>
+
 namespace vtrasterizer
 {
 
@@ -35,7 +37,9 @@ class DecorationRenderer: public Renderable
         _hyperlinkHover = hover;
     }
 
-    void renderCell(vtbackend::RenderCell const& cell);
+    /// Renders the decorations of the given cells, with the solid ones (e.g. underline)
+    /// being rendered as a single tile per run of equally decorated adjacent cells.
+    void renderCells(gsl::span<vtbackend::RenderCell const> cells);
     void renderLine(vtbackend::RenderLine const& line);
 
     void renderDecoration(Decorator decoration,
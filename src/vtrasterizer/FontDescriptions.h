@@ -77,6 +77,23 @@ constexpr bool operator<(TextStyle a, TextStyle b) noexcept
     return static_cast<unsigned>(a) < static_cast<unsigned>(b);
 }
 
+/// Inclusive range of codepoints.
+struct CodepointRange
+{
+    char32_t first;
+    char32_t last;
+
+    [[nodiscard]] constexpr bool contains(char32_t codepoint) const noexcept
+    {
+        return first <= codepoint && codepoint <= last;
+    }
+};
+
+constexpr bool operator==(CodepointRange a, CodepointRange b) noexcept
+{
+    return a.first == b.first && a.last == b.last;
+}
+
 } // namespace vtrasterizer
 
 // {{{ fmt formatter
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtrasterizer/GlyphWorker.h>
+#include <vtrasterizer/utils.h>
+
+#include <exception>
+#include <utility>
+
+namespace vtrasterizer
+{
+
+GlyphWorker::GlyphWorker(std::mutex& shaperMutex, std::function<void()> onCompleted):
+    _onCompleted { std::move(onCompleted) }, _shaperMutex { shaperMutex }, _thread { [this]() { run(); } }
+{
+}
+
+GlyphWorker::~GlyphWorker()
+{
+    {
+        auto const _ = std::lock_guard { _mutex };
+        _quit = true;
+        _queue.clear();
+        _lowPriorityQueue.clear();
+    }
+    _condition.notify_all();
+    _thread.join();
+}
+
+void GlyphWorker::post(crispy::strong_hash const& hash, Job job, Priority priority)
+{
+    {
+        auto const _ = std::lock_guard { _mutex };
+        if (!_pending.insert(hash).second)
+            return;
+        auto& queue = priority == Priority::Low ? _lowPriorityQueue : _queue;
+        queue.emplace_back(Task { hash, std::move(job), priority });
+    }
+    _condition.notify_all();
+}
+
+bool GlyphWorker::pending(crispy::strong_hash const& hash) const
+{
+    auto const _ = std::lock_guard { _mutex };
+    return _pending.count(hash) != 0;
+}
+
+size_t GlyphWorker::applyCompleted()
+{
+    auto results = std::vector<Result> {};
+    {
+        auto const _ = std::lock_guard { _mutex };
+        if (_results.empty())
+            return 0;
+        results.swap(_results);
+        for (Result const& result: results)
+            _pending.erase(result.hash);
+    }
+
+    for (Result& result: results)
+        if (result.completion)
+            result.completion();
+
+    return results.size();
+}
+
+void GlyphWorker::cancel()
+{
+    auto lock = std::unique_lock { _mutex };
+    _queue.clear();
+    _lowPriorityQueue.clear();
+    _condition.wait(lock, [this]() { return !_running; });
+    _results.clear();
+    _pending.clear();
+}
+
+void GlyphWorker::run()
+{
+    auto lock = std::unique_lock { _mutex };
+    while (true)
+    {
+        _condition.wait(lock, [this]() { return _quit || !_queue.empty() || !_lowPriorityQueue.empty(); });
+        if (_quit)
+            break;
+
+        auto& queue = !_queue.empty() ? _queue : _lowPriorityQueue;
+        auto task = std::move(queue.front());
+        queue.pop_front();
+        _running = true;
+        lock.unlock();
+
+        auto completion = Completion {};
+        try
+        {
+            auto const _ = lockShaper();
+            completion = task.job();
+        }
+        catch (std::exception const& e)
+        {
+            rasterizerLog()("Glyph worker job failed. {}", e.what());
+        }
+
+        lock.lock();
+        _results.emplace_back(Result { task.hash, std::move(completion) });
+        _running = false;
+        _condition.notify_all(); // wakes up cancel()
+
+        if (_quit || !_onCompleted || task.priority == Priority::Low)
+            continue;
+
+        lock.unlock();
+        _onCompleted();
+        lock.lock();
+    }
+}
+
+} // namespace vtrasterizer
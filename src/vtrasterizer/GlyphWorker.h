@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <crispy/StrongHash.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace vtrasterizer
+{
+
+/// Runs text shaping and glyph rasterization off the render thread.
+///
+/// A job runs on the worker thread while holding the shaper lock, and returns a completion
+/// that is run on the render thread by the next call to applyCompleted(), e.g. to insert the result
+/// into a cache. Jobs are identified by a hash, so that a job that is still pending is not queued twice.
+///
+/// Low priority jobs are only run while no other job is queued, and their completion does not notify.
+///
+/// The text shaper is not thread-safe and is therefore shared with the render thread under a lock,
+/// which is why a single worker thread is used. The lock is the one of the RenderResources the shaper
+/// belongs to, as the shaper is shared with other renderers, too.
+class GlyphWorker
+{
+  public:
+    using Completion = std::function<void()>;
+    using Job = std::function<Completion()>;
+
+    enum class Priority
+    {
+        Normal, //!< needed for the frames currently being rendered
+        Low,    //!< speculative work, such as pre-warming caches
+    };
+
+    /// Hash function for keeping job hashes in unordered containers.
+    struct Hasher
+    {
+        size_t operator()(crispy::strong_hash const& hash) const noexcept { return hash.d(); }
+    };
+
+    /// @param shaperMutex guards the text shaper used by the jobs, see RenderResources::lockShaper().
+    /// @param onCompleted invoked on the worker thread whenever a job has completed,
+    ///                    e.g. to schedule another frame to be rendered.
+    GlyphWorker(std::mutex& shaperMutex, std::function<void()> onCompleted);
+    ~GlyphWorker();
+
+    GlyphWorker(GlyphWorker const&) = delete;
+    GlyphWorker(GlyphWorker&&) = delete;
+    GlyphWorker& operator=(GlyphWorker const&) = delete;
+    GlyphWorker& operator=(GlyphWorker&&) = delete;
+
+    /// Queues the given job, unless a job with the same hash is pending already.
+    void post(crispy::strong_hash const& hash, Job job, Priority priority = Priority::Normal);
+
+    /// Tests whether a job with the given hash is queued, running, or awaiting its completion.
+    [[nodiscard]] bool pending(crispy::strong_hash const& hash) const;
+
+    /// Runs the completions of all jobs completed since the last call.
+    ///
+    /// @returns the number of completions run.
+    size_t applyCompleted();
+
+    /// Discards all queued jobs and waits for the running one, if any, to finish.
+    /// Completions of discarded or finished jobs are not run.
+    ///
+    /// Must be invoked before the shaper, fonts, or caches the jobs refer to are changed.
+    void cancel();
+
+    /// Locks the text shaper for exclusive use of the calling thread.
+    [[nodiscard]] std::unique_lock<std::mutex> lockShaper() { return std::unique_lock { _shaperMutex }; }
+
+  private:
+    struct Task
+    {
+        crispy::strong_hash hash;
+        Job job;
+        Priority priority;
+    };
+
+    struct Result
+    {
+        crispy::strong_hash hash;
+        Completion completion;
+    };
+
+    void run();
+
+    std::function<void()> _onCompleted;
+
+    mutable std::mutex _mutex; // guards all members below, except for the shaper mutex
+    std::condition_variable _condition;
+    std::deque<Task> _queue;
+    std::deque<Task> _lowPriorityQueue;
+    std::vector<Result> _results;
+    std::unordered_set<crispy::strong_hash, Hasher> _pending;
+    bool _running = false; // whether a job is being run right now
+    bool _quit = false;
+
+    std::mutex& _shaperMutex;
+    std::thread _thread;
+};
+
+} // namespace vtrasterizer
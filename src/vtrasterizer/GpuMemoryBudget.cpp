@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtrasterizer/GpuMemoryBudget.h>
+#include <vtrasterizer/utils.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <numeric>
+#include <ranges>
+#include <string_view>
+
+using std::string;
+
+namespace vtrasterizer
+{
+
+namespace
+{
+    std::string_view nameOf(GpuEviction eviction) noexcept
+    {
+        switch (eviction)
+        {
+            case GpuEviction::None: return "none";
+            case GpuEviction::RetainedAtlas: return "retained atlas";
+            case GpuEviction::IdleImages: return "idle images";
+            case GpuEviction::RetainedFrame: return "retained frame";
+        }
+        return "unknown";
+    }
+
+    std::string formatMiB(size_t bytes)
+    {
+        return fmt::format("{:.2f} MiB", static_cast<double>(bytes) / (1024.0 * 1024.0));
+    }
+} // namespace
+
+GpuMemoryUsage& GpuMemoryUsage::operator+=(GpuMemoryUsage const& other) noexcept
+{
+    for (size_t i = 0; i < GpuMemoryUseCount; ++i)
+        bytes[i] += other.bytes[i];
+    idleImageBytes += other.idleImageBytes;
+    retainedAtlasBytes += other.retainedAtlasBytes;
+    return *this;
+}
+
+size_t GpuMemoryUsage::total() const noexcept
+{
+    return std::accumulate(bytes.begin(), bytes.end(), size_t { 0 });
+}
+
+size_t GpuMemoryUsage::evictable(GpuEviction eviction) const noexcept
+{
+    switch (eviction)
+    {
+        case GpuEviction::None: return 0;
+        case GpuEviction::RetainedAtlas: return retainedAtlasBytes;
+        case GpuEviction::IdleImages: return idleImageBytes;
+        case GpuEviction::RetainedFrame: return (*this)[GpuMemoryUse::Framebuffers];
+    }
+    return 0;
+}
+
+void GpuMemoryBudget::setLimit(size_t limit)
+{
+    auto const _ = std::lock_guard { _mutex };
+    _limit = limit;
+    planEvictions();
+}
+
+std::unique_ptr<GpuMemoryBudget::Account> GpuMemoryBudget::open(string name)
+{
+    auto account = std::unique_ptr<Account>(new Account(*this, std::move(name)));
+    auto const _ = std::lock_guard { _mutex };
+    account->_lastReport = std::chrono::steady_clock::now();
+    _accounts.push_back(account.get());
+    return account;
+}
+
+void GpuMemoryBudget::close(Account& account)
+{
+    auto const _ = std::lock_guard { _mutex };
+    _accounts.erase(std::remove(_accounts.begin(), _accounts.end(), &account), _accounts.end());
+    planEvictions();
+}
+
+void GpuMemoryBudget::report(Account& account, GpuMemoryUsage const& usage)
+{
+    auto const _ = std::lock_guard { _mutex };
+    account._usage = usage;
+    account._lastReport = std::chrono::steady_clock::now();
+    planEvictions();
+}
+
+bool GpuMemoryBudget::Account::fits(size_t bytes) const
+{
+    auto const _ = std::lock_guard { _budget._mutex };
+    if (!_budget._limit)
+        return true;
+
+    auto total = bytes;
+    for (auto const* account: _budget._accounts)
+        total += account->_usage.total();
+    return total <= _budget._limit;
+}
+
+GpuMemoryUsage GpuMemoryBudget::usage() const
+{
+    auto const _ = std::lock_guard { _mutex };
+    auto usage = GpuMemoryUsage {};
+    for (auto const* account: _accounts)
+        usage += account->_usage;
+    return usage;
+}
+
+GpuMemoryUsage GpuMemoryBudget::usage(std::string_view name) const
+{
+    auto const _ = std::lock_guard { _mutex };
+    auto usage = GpuMemoryUsage {};
+    for (auto const* account: _accounts)
+        if (account->_name == name)
+            usage += account->_usage;
+    return usage;
+}
+
+void GpuMemoryBudget::planEvictions()
+{
+    auto const setEviction = [](Account& account, GpuEviction eviction, size_t evictedBytes) {
+        if (account._eviction.load(std::memory_order_relaxed) == eviction)
+            return;
+        rendererLog()("GPU memory budget: {} evicts {} ({} released).",
+                      account._name,
+                      nameOf(eviction),
+                      formatMiB(evictedBytes));
+        account._eviction.store(eviction, std::memory_order_relaxed);
+    };
+
+    if (!_limit)
+    {
+        for (auto* account: _accounts)
+        {
+            setEviction(*account, GpuEviction::None, 0);
+            account->_evictedBytes = 0;
+        }
+        return;
+    }
+
+    auto total = size_t { 0 };
+    for (auto const* account: _accounts)
+        total += account->_usage.total();
+
+    // Render targets that have not been rendering for the longest are the first to release memory,
+    // as they are the least likely to need it again soon, and the last to get it back.
+    auto accounts = _accounts;
+    std::ranges::sort(accounts, [](auto const* a, auto const* b) { return a->_lastReport < b->_lastReport; });
+
+    if (total > _limit)
+    {
+        auto excess = total - _limit;
+        for (auto const eviction:
+             { GpuEviction::RetainedAtlas, GpuEviction::IdleImages, GpuEviction::RetainedFrame })
+        {
+            for (auto* account: accounts)
+            {
+                if (excess == 0)
+                    return;
+                if (account->eviction() >= eviction)
+                    continue;
+                auto const released = account->_usage.evictable(eviction);
+                if (!released)
+                    continue;
+                setEviction(*account, eviction, released);
+                account->_evictedBytes += released;
+                excess -= std::min(excess, released);
+            }
+        }
+        if (excess)
+            rendererLog()("GPU memory budget of {} exceeded by {}, with nothing left to evict.",
+                          formatMiB(_limit),
+                          formatMiB(excess));
+        return;
+    }
+
+    // Give memory back only where all of what was released fits in again, for the render targets
+    // not to keep on allocating and releasing the same memory.
+    auto headroom = _limit - total;
+    for (auto* account: accounts | std::views::reverse)
+    {
+        if (account->eviction() == GpuEviction::None || account->_evictedBytes > headroom)
+            continue;
+        headroom -= account->_evictedBytes;
+        account->_evictedBytes = 0;
+        setEviction(*account, GpuEviction::None, 0);
+    }
+}
+
+void GpuMemoryBudget::inspect(std::ostream& output) const
+{
+    auto const _ = std::lock_guard { _mutex };
+
+    auto total = size_t { 0 };
+    for (auto const* account: _accounts)
+        total += account->_usage.total();
+
+    output << fmt::format("GPU memory: {} of {}\n",
+                          formatMiB(total),
+                          _limit ? formatMiB(_limit) : string("unlimited"));
+    for (auto const* account: _accounts)
+    {
+        auto const& usage = account->_usage;
+        output << fmt::format("  {}: {} (atlas {} of which retained {}, images {} of which idle {}, "
+                              "framebuffers {}), evicting {}\n",
+                              account->_name,
+                              formatMiB(usage.total()),
+                              formatMiB(usage[GpuMemoryUse::Atlas]),
+                              formatMiB(usage.retainedAtlasBytes),
+                              formatMiB(usage[GpuMemoryUse::Images]),
+                              formatMiB(usage.idleImageBytes),
+                              formatMiB(usage[GpuMemoryUse::Framebuffers]),
+                              nameOf(account->eviction()));
+    }
+}
+
+} // namespace vtrasterizer
@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace vtrasterizer
+{
+
+/// What the GPU memory of a render target is used for.
+enum class GpuMemoryUse : uint8_t
+{
+    Atlas,        //!< texture atlas of glyphs and box drawing characters
+    Images,       //!< textures of the images shown
+    Framebuffers, //!< retained frame, redrawn only where damaged
+};
+
+constexpr size_t GpuMemoryUseCount = 3;
+
+/// GPU memory that render targets release when over budget, from first to last resort.
+///
+/// The texture atlas in use is never evicted, as the glyphs it holds are needed for every frame.
+enum class GpuEviction : uint8_t
+{
+    None,
+    RetainedAtlas, //!< the atlas of the fonts rendered with before, e.g. with another DPI, rasterized again
+    IdleImages,    //!< textures of the images not drawn with the last frame, uploaded again once drawn
+    RetainedFrame, //!< the retained frame, rendering the full frame each time instead
+};
+
+/// GPU memory used by a render target, as reported to GpuMemoryBudget.
+struct GpuMemoryUsage
+{
+    std::array<size_t, GpuMemoryUseCount> bytes {}; // indexed by GpuMemoryUse
+    size_t idleImageBytes = 0;                      // of the image textures not drawn with the last frame
+    size_t retainedAtlasBytes = 0;                  // of the atlas retained next to the one in use
+
+    [[nodiscard]] size_t& operator[](GpuMemoryUse use) noexcept { return bytes[static_cast<size_t>(use)]; }
+    [[nodiscard]] size_t operator[](GpuMemoryUse use) const noexcept
+    {
+        return bytes[static_cast<size_t>(use)];
+    }
+
+    GpuMemoryUsage& operator+=(GpuMemoryUsage const& other) noexcept;
+
+    [[nodiscard]] size_t total() const noexcept;
+
+    // Returns the bytes released by evicting at the given level, on top of the levels before.
+    [[nodiscard]] size_t evictable(GpuEviction eviction) const noexcept;
+};
+
+/**
+ * A single budget for the GPU memory of all render targets of the process.
+ *
+ * Render targets open an account with it, to which they report their memory usage after each frame.
+ * Whenever the total exceeds the budget, the budget decides which of them is to release what,
+ * starting with the render targets that have been rendering the least recently, and with the
+ * memory that is cheapest to recreate, see GpuEviction. The render targets then evict accordingly
+ * with their next frame, as they can only do so from within their own graphics context.
+ *
+ * All member functions may be invoked from any thread.
+ */
+class GpuMemoryBudget
+{
+  public:
+    class Account;
+
+    /// @param limit maximum bytes of GPU memory all render targets together should use, or 0 for no limit.
+    explicit GpuMemoryBudget(size_t limit = 0): _limit { limit } {}
+
+    GpuMemoryBudget(GpuMemoryBudget const&) = delete;
+    GpuMemoryBudget(GpuMemoryBudget&&) = delete;
+    GpuMemoryBudget& operator=(GpuMemoryBudget const&) = delete;
+    GpuMemoryBudget& operator=(GpuMemoryBudget&&) = delete;
+    ~GpuMemoryBudget() = default;
+
+    [[nodiscard]] size_t limit() const noexcept { return _limit; }
+    void setLimit(size_t limit);
+
+    /// Opens an account for a render target, named after what it renders (e.g. the terminal session).
+    /// The account must not outlive this budget.
+    [[nodiscard]] std::unique_ptr<Account> open(std::string name);
+
+    /// @returns the GPU memory usage of all accounts together.
+    [[nodiscard]] GpuMemoryUsage usage() const;
+
+    /// @returns the GPU memory usage of the accounts named @p name together.
+    [[nodiscard]] GpuMemoryUsage usage(std::string_view name) const;
+
+    /// Writes the GPU memory usage broken down by account and use to @p output.
+    void inspect(std::ostream& output) const;
+
+  private:
+    void close(Account& account);
+    void report(Account& account, GpuMemoryUsage const& usage);
+
+    // Determines the eviction of each account bringing the total back within the limit.
+    void planEvictions();
+
+    mutable std::mutex _mutex;
+    size_t _limit;
+    std::vector<Account*> _accounts;
+};
+
+/// The account of a single render target in a GpuMemoryBudget.
+class GpuMemoryBudget::Account
+{
+  public:
+    Account(Account const&) = delete;
+    Account(Account&&) = delete;
+    Account& operator=(Account const&) = delete;
+    Account& operator=(Account&&) = delete;
+    ~Account() { _budget.close(*this); }
+
+    [[nodiscard]] std::string const& name() const noexcept { return _name; }
+
+    /// Reports the render target's current GPU memory usage, to be invoked after each frame rendered.
+    void report(GpuMemoryUsage const& usage) { _budget.report(*this, usage); }
+
+    /// @returns what the render target is to release with its next frame to stay within the budget,
+    ///          and not to allocate again for as long as it is requested to.
+    [[nodiscard]] GpuEviction eviction() const noexcept { return _eviction.load(std::memory_order_relaxed); }
+
+    /// Tests whether allocating @p bytes more keeps all render targets within the budget.
+    [[nodiscard]] bool fits(size_t bytes) const;
+
+  private:
+    friend class GpuMemoryBudget;
+
+    Account(GpuMemoryBudget& budget, std::string name): _budget { budget }, _name { std::move(name) } {}
+
+    GpuMemoryBudget& _budget;
+    std::string _name;
+    std::atomic<GpuEviction> _eviction = GpuEviction::None;
+
+    // guarded by the budget's mutex
+    GpuMemoryUsage _usage {};
+    size_t _evictedBytes = 0; // released for the eviction requested, to be fit in again before relaxing it
+    std::chrono::steady_clock::time_point _lastReport {};
+};
+
+} // namespace vtrasterizer
@@ -1,17 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0
 #include <vtrasterizer/ImageRenderer.h>
 
-#include <crispy/StrongHash.h>
-#include <crispy/algorithm.h>
-#include <crispy/times.h>
-
-#include <array>
-
-using crispy::times;
-
-using std::array;
-using std::nullopt;
-using std::optional;
+#include <algorithm>
 
 namespace vtrasterizer
 {
@@ -31,22 +21,38 @@ void ImageRenderer::setRenderTarget(RenderTarget& renderTarget,
 void ImageRenderer::setCellSize(ImageSize cellSize)
 {
     _cellSize = cellSize;
-    // TODO: recompute rasterized images slices here?
 }
 
 void ImageRenderer::renderImage(crispy::point pos, vtbackend::ImageFragment const& fragment)
 {
-    // std::cout << fmt::format("ImageRenderer.renderImage: {}\n", fragment);
-
-    AtlasTileAttributes const* tileAttributes = getOrCreateCachedTileAttributes(fragment);
-    if (!tileAttributes)
-        return;
-
-    // clang-format off
-    _pendingRenderTilesAboveText.emplace_back(createRenderTile(atlas::RenderTile::X { pos.x },
-                                                               atlas::RenderTile::Y { pos.y },
-                                                               vtbackend::RGBAColor::White, *tileAttributes));
-    // clang-format on
+    auto const& rasterizedImage = fragment.rasterizedImage();
+    auto const& image = rasterizedImage.image();
+
+    // The fragment's pixel rectangle within the image, as sliced by the grid the image was placed onto.
+    auto const sourceCellSize = rasterizedImage.cellSize();
+    auto const sourceX = fragment.offset().column.value * unbox<int>(sourceCellSize.width);
+    auto const sourceY = fragment.offset().line.value * unbox<int>(sourceCellSize.height);
+    auto const sourceWidth =
+        std::min(unbox<int>(sourceCellSize.width), unbox<int>(image.width()) - sourceX);
+    auto const sourceHeight =
+        std::min(unbox<int>(sourceCellSize.height), unbox<int>(image.height()) - sourceY);
+    if (sourceWidth <= 0 || sourceHeight <= 0)
+        return; // gap beyond the right or bottom border of the image
+
+    // Cells only partially covered by the image leave the uncovered part (the gap) untouched.
+    auto const targetWidth = vtbackend::Width::cast_from(unbox<int>(_cellSize.width) * sourceWidth
+                                                         / unbox<int>(sourceCellSize.width));
+    auto const targetHeight = vtbackend::Height::cast_from(unbox<int>(_cellSize.height) * sourceHeight
+                                                           / unbox<int>(sourceCellSize.height));
+
+    auto source = atlas::NormalizedTileLocation {};
+    source.x = static_cast<float>(sourceX) / unbox<float>(image.width());
+    source.y = static_cast<float>(sourceY) / unbox<float>(image.height());
+    source.width = static_cast<float>(sourceWidth) / unbox<float>(image.width());
+    source.height = static_cast<float>(sourceHeight) / unbox<float>(image.height());
+
+    renderTarget().renderImage(
+        rasterizedImage.imagePointer(), pos.x, pos.y, targetWidth, targetHeight, source);
 }
 
 void ImageRenderer::onBeforeRenderingText()
@@ -56,67 +62,18 @@ void ImageRenderer::onBeforeRenderingText()
 
 void ImageRenderer::onAfterRenderingText()
 {
-    // We render here the images that should go above text.
-
-    for (auto const& tile: _pendingRenderTilesAboveText)
-        textureScheduler().renderTile(tile);
-
-    _pendingRenderTilesAboveText.clear();
-}
-
-void ImageRenderer::beginFrame()
-{
-    assert(_pendingRenderTilesAboveText.empty());
-}
-
-void ImageRenderer::endFrame()
-{
-    if (!_pendingRenderTilesAboveText.empty())
-    {
-        // In case some image tiles are still pending but no text had to be rendered.
-
-        for (auto& tile: _pendingRenderTilesAboveText)
-            textureScheduler().renderTile(tile);
-        _pendingRenderTilesAboveText.clear();
-    }
-}
-
-Renderable::AtlasTileAttributes const* ImageRenderer::getOrCreateCachedTileAttributes(
-    vtbackend::ImageFragment const& fragment)
-{
-    // using crispy::StrongHash;
-    // auto const hash = StrongHash::compute(fragment.rasterizedImage().image().id().value)
-    //                   * fragment.offset().column.value * fragment.offset().line.value
-    //                   * fragment.rasterizedImage().cellSize().width.value
-    //                   * fragment.rasterizedImage().cellSize().height.value;
-    auto const key = ImageFragmentKey { fragment.rasterizedImage().image().id(),
-                                        fragment.offset(),
-                                        fragment.rasterizedImage().cellSize() };
-    auto const hash = crispy::strong_hash::compute(key);
-
-    return textureAtlas().get_or_try_emplace(
-        hash, [&](atlas::TileLocation tileLocation) -> optional<TextureAtlas::TileCreateData> {
-            return createTileData(tileLocation,
-                                  fragment.data(),
-                                  atlas::Format::RGBA,
-                                  fragment.rasterizedImage().cellSize(),
-                                  _cellSize,
-                                  RenderTileAttributes::X { 0 },
-                                  RenderTileAttributes::Y { 0 },
-                                  FRAGMENT_SELECTOR_IMAGE_BGRA);
-        });
+    // Images are rendered by the render target above all text, after the atlas tiles have been drawn.
 }
 
-void ImageRenderer::discardImage(vtbackend::ImageId /*imageId*/)
+void ImageRenderer::discardImage(vtbackend::ImageId imageId)
 {
-    // We currently don't really discard.
-    // Because the GPU texture atlas is resource-guarded by an LRU hashtable.
+    if (renderTargetAvailable())
+        renderTarget().discardImage(imageId);
 }
 
 void ImageRenderer::clearCache()
 {
-    // We currently don't really clean up anything.
-    // Because the GPU texture atlas is resource-guarded by an LRU hashtable.
+    // Image textures do not depend on the cell size, and are released via discardImage() only.
 }
 
 void ImageRenderer::inspect(std::ostream& /*output*/) const
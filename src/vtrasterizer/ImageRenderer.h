@@ -6,38 +6,19 @@
 #include <vtrasterizer/RenderTarget.h>
 #include <vtrasterizer/TextRenderer.h>
 
-#include <crispy/FNV.h>
 #include <crispy/point.h>
 #include <crispy/size.h>
 
-#include <vector>
-
 namespace vtrasterizer
 {
 
-// NB: Ensure this struct does NOT contain padding (or adapt strong hash creation).
-struct ImageFragmentKey
-{
-    vtbackend::ImageId imageId;
-    vtbackend::CellLocation offset;
-    ImageSize size;
-
-    bool operator==(ImageFragmentKey const& b) const noexcept
-    {
-        return imageId == b.imageId && offset == b.offset && size == b.size;
-    }
-
-    bool operator!=(ImageFragmentKey const& b) const noexcept { return !(*this == b); }
-
-    bool operator<(ImageFragmentKey const& b) const noexcept
-    {
-        return (imageId < b.imageId) || (imageId == b.imageId && offset < b.offset);
-    }
-};
-
 /// Image Rendering API.
 ///
 /// Can render any arbitrary RGBA image (for example Sixel Graphics images).
+///
+/// Images are uploaded by the render target once, as standalone textures at their native resolution.
+/// Each grid cell is rendered as the sub-rectangle of that texture it displays, scaled to the current cell
+/// size by the GPU. Changing the cell size therefore does not require images to be sliced or uploaded again.
 class ImageRenderer: public Renderable, public TextRendererEvents
 {
   public:
@@ -57,16 +38,10 @@ class ImageRenderer: public Renderable, public TextRendererEvents
 
     void inspect(std::ostream& output) const override;
 
-    void beginFrame();
-    void endFrame();
-
     void onBeforeRenderingText() override;
     void onAfterRenderingText() override;
 
   private:
-    AtlasTileAttributes const* getOrCreateCachedTileAttributes(vtbackend::ImageFragment const& fragment);
-    std::vector<atlas::RenderTile> _pendingRenderTilesAboveText;
-
     // private data
     //
     ImageSize _cellSize;
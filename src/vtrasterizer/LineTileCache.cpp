@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtrasterizer/LineTileCache.h>
+
+#include <fmt/format.h>
+
+namespace vtrasterizer
+{
+
+void LineTileCache::configureAtlas(atlas::ConfigureAtlas atlas)
+{
+    invalidate();
+    _backend->configureAtlas(std::move(atlas));
+}
+
+bool LineTileCache::restoreAtlas()
+{
+    invalidate();
+    return _backend->restoreAtlas();
+}
+
+void LineTileCache::uploadTile(atlas::UploadTile tile)
+{
+    invalidate();
+    _backend->uploadTile(std::move(tile));
+}
+
+void LineTileCache::renderTile(atlas::RenderTile tile)
+{
+    if (_recording)
+        _recording->tiles.emplace_back(tile);
+    _backend->renderTile(std::move(tile));
+}
+
+bool LineTileCache::replay(vtbackend::LineOffset line, crispy::strong_hash const& hash)
+{
+    auto const index = unbox<size_t>(line);
+    if (index >= _lines.size() || !_lines[index].valid || _lines[index].hash != hash)
+    {
+        ++_misses;
+        return false;
+    }
+
+    ++_hits;
+    for (auto const& tile: _lines[index].tiles)
+        _backend->renderTile(tile);
+    return true;
+}
+
+void LineTileCache::beginRecording(vtbackend::LineOffset line, crispy::strong_hash const& hash)
+{
+    auto const index = unbox<size_t>(line);
+    if (index >= _lines.size())
+        _lines.resize(index + 1);
+
+    _recording = &_lines[index];
+    _recording->valid = false;
+    _recording->hash = hash;
+    _recording->tiles.clear();
+}
+
+void LineTileCache::endRecording()
+{
+    // Tile uploads while recording only invalidate what was recorded before, not this line.
+    _recording->valid = true;
+    _recording = nullptr;
+}
+
+void LineTileCache::invalidate() noexcept
+{
+    for (auto& line: _lines)
+        line.valid = false;
+}
+
+void LineTileCache::inspect(std::ostream& output) const
+{
+    output << fmt::format("LineTileCache: {} lines, {} hits, {} misses\n", _lines.size(), _hits, _misses);
+}
+
+} // namespace vtrasterizer
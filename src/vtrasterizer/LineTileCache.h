@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <vtbackend/primitives.h>
+
+#include <vtrasterizer/TextureAtlas.h>
+
+#include <crispy/StrongHash.h>
+
+#include <ostream>
+#include <vector>
+
+namespace vtrasterizer
+{
+
+/// Retains the render tiles generated for each grid line across frames.
+///
+/// The cache sits between the renderables and the render target's atlas backend, forwarding all
+/// operations to it. While a line is being recorded, every tile rendered is also captured for that line,
+/// so that the next frame can replay them straight to the backend if the line's content hash is unchanged.
+///
+/// Any atlas (re-)configuration or tile upload may reuse tile locations that are referenced
+/// by recorded tiles, and therefore invalidates all lines.
+class LineTileCache: public atlas::AtlasBackend
+{
+  public:
+    void setBackend(atlas::AtlasBackend& backend) noexcept { _backend = &backend; }
+
+    [[nodiscard]] vtbackend::ImageSize atlasSize() const noexcept override { return _backend->atlasSize(); }
+    void configureAtlas(atlas::ConfigureAtlas atlas) override;
+    void uploadTile(atlas::UploadTile tile) override;
+    void renderTile(atlas::RenderTile tile) override;
+    [[nodiscard]] bool retainAtlas() override { return _backend->retainAtlas(); }
+    [[nodiscard]] bool restoreAtlas() override;
+    void discardRetainedAtlas() override { _backend->discardRetainedAtlas(); }
+
+    /// Renders the tiles recorded for the given line, if they were recorded for the same content hash.
+    ///
+    /// @retval true  the line's tiles have been rendered.
+    /// @retval false the line needs to be rendered from scratch.
+    [[nodiscard]] bool replay(vtbackend::LineOffset line, crispy::strong_hash const& hash);
+
+    /// Starts capturing all rendered tiles for the given line and content hash.
+    void beginRecording(vtbackend::LineOffset line, crispy::strong_hash const& hash);
+
+    /// Stops capturing and retains the captured tiles.
+    void endRecording();
+
+    /// Forgets about all recorded lines.
+    void invalidate() noexcept;
+
+    void inspect(std::ostream& output) const;
+
+    [[nodiscard]] uint64_t hits() const noexcept { return _hits; }
+    [[nodiscard]] uint64_t misses() const noexcept { return _misses; }
+
+  private:
+    struct Line
+    {
+        bool valid = false;
+        crispy::strong_hash hash {};
+        std::vector<atlas::RenderTile> tiles;
+    };
+
+    atlas::AtlasBackend* _backend = nullptr;
+    std::vector<Line> _lines;
+    Line* _recording = nullptr;
+    uint64_t _hits = 0;
+    uint64_t _misses = 0;
+};
+
+} // namespace vtrasterizer
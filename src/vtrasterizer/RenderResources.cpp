@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtrasterizer/RenderResources.h>
+#include <vtrasterizer/TextRenderer.h>
+#include <vtrasterizer/utils.h>
+
+#include <text_shaper/font_locator.h>
+#include <text_shaper/open_shaper.h>
+
+#if defined(_WIN32)
+    #include <text_shaper/directwrite_shaper.h>
+#endif
+
+#include <algorithm>
+
+using std::make_unique;
+using std::unique_ptr;
+
+namespace vtrasterizer
+{
+
+namespace
+{
+    unique_ptr<text::shaper> createTextShaper(TextShapingEngine engine, DPI dpi, text::font_locator& locator)
+    {
+        switch (engine)
+        {
+            case TextShapingEngine::DWrite:
+#if defined(_WIN32)
+                rendererLog()("Using DirectWrite text shaping engine.");
+                // TODO: do we want to use custom font locator here?
+                return make_unique<text::directwrite_shaper>(dpi, locator);
+#else
+                rendererLog()("DirectWrite not available on this platform.");
+                break;
+#endif
+
+            case TextShapingEngine::CoreText:
+#if defined(__APPLE__)
+                rendererLog()("CoreText not yet implemented.");
+                break;
+#else
+                rendererLog()("CoreText not available on this platform.");
+                break;
+#endif
+
+            case TextShapingEngine::OpenShaper: break;
+        }
+
+        rendererLog()("Using OpenShaper text shaping engine.");
+        return make_unique<text::open_shaper>(dpi, locator);
+    }
+} // namespace
+
+RenderResources::RenderResources(TextShapingEngine engine, DPI dpi, FontLocatorEngine fontLocator):
+    _engine { engine },
+    _dpi { dpi },
+    _fontLocator { fontLocator },
+    _textShaper { createTextShaper(engine, dpi, createFontLocator(fontLocator)) }
+{
+    rendererLog()("Creating render resources for DPI {}.", dpi);
+}
+
+RenderResources::~RenderResources()
+{
+    rendererLog()("Releasing render resources for DPI {}.", _dpi);
+}
+
+std::shared_ptr<RenderResources> RenderResourcePool::acquire(FontDescriptions const& fontDescriptions)
+{
+    auto const _ = std::lock_guard { _mutex };
+
+    // Forget about the resources released in the meantime.
+    std::erase_if(_resources, [](auto const& resources) { return resources.expired(); });
+
+    for (auto const& weakResources: _resources)
+        if (auto resources = weakResources.lock(); resources && resources->matches(fontDescriptions))
+            return resources;
+
+    auto resources = std::make_shared<RenderResources>(
+        fontDescriptions.textShapingEngine, fontDescriptions.dpi, fontDescriptions.fontLocator);
+    _resources.emplace_back(resources);
+    return resources;
+}
+
+size_t RenderResourcePool::size() const
+{
+    auto const _ = std::lock_guard { _mutex };
+    return static_cast<size_t>(std::count_if(
+        _resources.begin(), _resources.end(), [](auto const& resources) { return !resources.expired(); }));
+}
+
+} // namespace vtrasterizer
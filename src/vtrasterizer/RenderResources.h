@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <vtrasterizer/FontDescriptions.h>
+
+#include <text_shaper/shaper.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vtrasterizer
+{
+
+/**
+ * Rendering resources that do not depend on a particular terminal or render target,
+ * and are therefore shared by all renderers using the same configuration.
+ *
+ * This is the text shaper along with all fonts it has loaded, which is thus located,
+ * opened, and parsed only once, no matter how many terminal sessions are rendering with it.
+ * The texture atlases are kept per render target, as they live in the render target's graphics context.
+ */
+class RenderResources
+{
+  public:
+    RenderResources(TextShapingEngine engine, DPI dpi, FontLocatorEngine fontLocator);
+
+    RenderResources(RenderResources const&) = delete;
+    RenderResources(RenderResources&&) = delete;
+    RenderResources& operator=(RenderResources const&) = delete;
+    RenderResources& operator=(RenderResources&&) = delete;
+    ~RenderResources();
+
+    /// Tests whether these resources can be used for rendering with the given fonts.
+    [[nodiscard]] bool matches(FontDescriptions const& fontDescriptions) const noexcept
+    {
+        return _engine == fontDescriptions.textShapingEngine && _dpi == fontDescriptions.dpi
+               && _fontLocator == fontDescriptions.fontLocator;
+    }
+
+    /// The text shaper may only be used while holding the lock returned by lockShaper().
+    [[nodiscard]] text::shaper& textShaper() noexcept { return *_textShaper; }
+
+    /// Locks the text shaper for exclusive use of the calling thread,
+    /// as it is not thread-safe, but shared with all renderers and their worker threads.
+    [[nodiscard]] std::unique_lock<std::mutex> lockShaper() { return std::unique_lock { _shaperMutex }; }
+
+    /// Returns the mutex guarding the text shaper, see lockShaper().
+    [[nodiscard]] std::mutex& shaperMutex() noexcept { return _shaperMutex; }
+
+  private:
+    TextShapingEngine _engine;
+    DPI _dpi;
+    FontLocatorEngine _fontLocator;
+    std::mutex _shaperMutex;
+    std::unique_ptr<text::shaper> _textShaper;
+};
+
+/**
+ * Hands out the RenderResources to all renderers of the application,
+ * sharing them among all renderers of the same configuration, e.g. all terminal sessions.
+ *
+ * Resources are reference-counted by the renderers using them,
+ * and released as soon as the last renderer using them is gone or has switched to others.
+ */
+class RenderResourcePool
+{
+  public:
+    /// @returns the resources for rendering with the given fonts, shared with the renderers using them.
+    [[nodiscard]] std::shared_ptr<RenderResources> acquire(FontDescriptions const& fontDescriptions);
+
+    /// @returns the number of resources currently in use.
+    [[nodiscard]] size_t size() const;
+
+  private:
+    mutable std::mutex _mutex;
+    std::vector<std::weak_ptr<RenderResources>> _resources;
+};
+
+} // namespace vtrasterizer
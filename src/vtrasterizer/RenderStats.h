@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace vtrasterizer
+{
+
+/**
+ * CPU time spent within the render subsystems, accumulated over the frames rendered while being collected.
+ *
+ * Stats are only collected on request, e.g. for benchmarking, see Renderer::setRenderStats().
+ */
+struct RenderStats
+{
+    using clock = std::chrono::steady_clock;
+    using Duration = std::chrono::nanoseconds;
+
+    uint64_t frames = 0;
+    Duration total {}; // all of Renderer::render(), including the render target's execution
+    Duration background {};
+    Duration image {};
+    Duration decoration {};
+    Duration text {}; // including boxDrawing, shaping, and rasterization
+    Duration boxDrawing {};
+    Duration shaping {};       // text runs missing in the shaping cache
+    Duration rasterization {}; // glyphs missing in the texture atlas
+    Duration cursor {};
+    Duration lineCache {}; // replaying the tiles retained for unchanged lines
+    Duration execute {};   // RenderTarget::execute()
+};
+
+/**
+ * Adds the time spent within its scope to one of the durations of the given stats, if being collected.
+ */
+class RenderStatsScope
+{
+  public:
+    RenderStatsScope(RenderStats* stats, RenderStats::Duration RenderStats::*duration) noexcept:
+        _duration { stats ? &(stats->*duration) : nullptr }
+    {
+        if (_duration)
+            _start = RenderStats::clock::now();
+    }
+
+    ~RenderStatsScope()
+    {
+        if (_duration)
+            *_duration += RenderStats::clock::now() - _start;
+    }
+
+    RenderStatsScope(RenderStatsScope const&) = delete;
+    RenderStatsScope(RenderStatsScope&&) = delete;
+    RenderStatsScope& operator=(RenderStatsScope const&) = delete;
+    RenderStatsScope& operator=(RenderStatsScope&&) = delete;
+
+  private:
+    RenderStats::Duration* _duration;
+    RenderStats::clock::time_point _start {};
+};
+
+} // namespace vtrasterizer
@@ -3,6 +3,7 @@
 
 #include <vtbackend/Color.h>
 #include <vtbackend/Grid.h> // cell attribs
+#include <vtbackend/Image.h>
 #include <vtbackend/primitives.h>
 
 #include <vtrasterizer/GridMetrics.h>
@@ -11,6 +12,7 @@
 
 #include <crispy/size.h>
 
+#include <memory>
 #include <optional>
 #include <vector>
 
@@ -79,6 +81,16 @@ struct RenderTileAttributes
     ImageSize targetSize {};
 };
 
+/**
+ * Full-width band of the render target, in the coordinates of RenderTarget::renderRectangle(),
+ * whose contents changed since the previously rendered frame.
+ */
+struct DamagedArea
+{
+    int y = 0;
+    vtbackend::Height height {};
+};
+
 /**
  * Terminal render target interface, for example OpenGL, DirectX, or software-rasterization.
  *
@@ -105,11 +117,35 @@ class RenderTarget
     /// Fills a rectangular area with the given solid color.
     virtual void renderRectangle(int x, int y, Width, Height, RGBAColor color) = 0;
 
+    /// Renders the sub-rectangle @p source (in normalized texture coordinates) of the given image
+    /// scaled onto the given rectangular area, above any text.
+    ///
+    /// The image is uploaded once, as a standalone texture at its native resolution, and kept on the GPU
+    /// until discardImage() is invoked for it.
+    virtual void renderImage(std::shared_ptr<vtbackend::Image const> image,
+                             int x,
+                             int y,
+                             Width width,
+                             Height height,
+                             atlas::NormalizedTileLocation source) = 0;
+
+    /// Releases any GPU resources held for the given image.
+    virtual void discardImage(vtbackend::ImageId imageId) = 0;
+
+    /// Informs the render target about the area that changed since the previous frame.
+    ///
+    /// A render target that retains the previous frame may restrict the next execute() to redraw
+    /// only that area. No value means that the whole frame must be redrawn.
+    virtual void setDamage(std::optional<DamagedArea> damage) = 0;
+
     using ScreenshotCallback =
         std::function<void(std::vector<uint8_t> const& /*_rgbaBuffer*/, ImageSize /*_pixelSize*/)>;
 
     /// Schedules taking a screenshot of the current scene and forwards it to the given callback.
-    virtual void scheduleScreenshot(ScreenshotCallback callback) = 0;
+    ///
+    /// The callback may be invoked a few frames later, once the screenshot has been read back.
+    /// If @p size is not empty, the screenshot is scaled to that size before it is read back.
+    virtual void scheduleScreenshot(ScreenshotCallback callback, ImageSize size) = 0;
 
     /// Executes all previously scheduled render commands.
     virtual void execute(std::chrono::steady_clock::time_point now) = 0;
@@ -144,6 +180,10 @@ class Renderable
     virtual void setRenderTarget(RenderTarget& renderTarget, DirectMappingAllocator& directMappingAllocator);
     virtual void setTextureAtlas(TextureAtlas& atlas) { _textureAtlas = &atlas; }
 
+    /// Redirects the tiles rendered by this renderable to the given scheduler,
+    /// instead of the render target's one.
+    virtual void setTextureScheduler(atlas::AtlasBackend& scheduler) { _textureScheduler = &scheduler; }
+
     [[nodiscard]] TextureAtlas::TileCreateData createTileData(atlas::TileLocation tileLocation,
                                                               std::vector<uint8_t> bitmap,
                                                               atlas::Format bitmapFormat,
@@ -3,17 +3,16 @@
 #include <vtrasterizer/TextRenderer.h>
 #include <vtrasterizer/utils.h>
 
-#include <text_shaper/font_locator.h>
-#include <text_shaper/open_shaper.h>
-
 #include <crispy/StrongLRUHashtable.h>
+#include <crispy/trace.h>
 
-#if defined(_WIN32)
-    #include <text_shaper/directwrite_shaper.h>
-#endif
-
+#include <algorithm>
 #include <array>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <utility>
 
 using std::array;
 using std::get;
@@ -25,7 +24,6 @@ using std::nullopt;
 using std::optional;
 using std::scoped_lock;
 using std::tuple;
-using std::unique_ptr;
 using std::vector;
 using std::chrono::steady_clock;
 
@@ -48,88 +46,126 @@ namespace
         rendererLog()("Loading grid metrics {}", gm);
     }
 
-    GridMetrics loadGridMetrics(text::font_key font, vtbackend::PageSize pageSize, text::shaper& textShaper)
+    GridMetrics loadGridMetrics(text::font_key font, vtbackend::PageSize pageSize, RenderResources& resources)
     {
+        auto const _ = crispy::trace_scope("Renderer.loadGridMetrics");
         auto gm = GridMetrics {};
 
         gm.pageSize = pageSize;
         gm.cellMargin = { 0, 0, 0, 0 }; // TODO (pass as args, and make use of them)
         gm.pageMargin = { 0, 0, 0 };    // TODO (fill early)
 
-        loadGridMetricsFromFont(font, gm, textShaper);
+        auto const lock = resources.lockShaper();
+        loadGridMetricsFromFont(font, gm, resources.textShaper());
 
         return gm;
     }
 
-    FontKeys loadFontKeys(FontDescriptions const& fd, text::shaper& shaper)
+    FontKeys loadFontKeys(FontDescriptions const& fd, RenderResources& resources)
     {
+        auto const _ = crispy::trace_scope("Renderer.loadFontKeys");
+        auto const lock = resources.lockShaper();
+        auto& shaper = resources.textShaper();
         FontKeys output {};
         auto const regularOpt = shaper.load_font(fd.regular, fd.size);
         Require(regularOpt.has_value());
         output.regular = regularOpt.value();
-        output.bold = shaper.load_font(fd.bold, fd.size).value_or(output.regular);
-        output.italic = shaper.load_font(fd.italic, fd.size).value_or(output.regular);
-        output.boldItalic = shaper.load_font(fd.boldItalic, fd.size).value_or(output.regular);
-        output.emoji = shaper.load_font(fd.emoji, fd.size).value_or(output.regular);
+        // All other fonts are only located and loaded once they are used.
+        output.bold = shaper.load_font_deferred(fd.bold, fd.size, output.regular);
+        output.italic = shaper.load_font_deferred(fd.italic, fd.size, output.regular);
+        output.boldItalic = shaper.load_font_deferred(fd.boldItalic, fd.size, output.regular);
+        output.emoji = shaper.load_font_deferred(fd.emoji, fd.size, output.regular);
 
         return output;
     }
 
-    unique_ptr<text::shaper> createTextShaper(TextShapingEngine engine, DPI dpi, text::font_locator& locator)
+    // Tests whether both describe the same fonts, except for possibly being scaled for another DPI.
+    bool equalExceptDpi(FontDescriptions const& a, FontDescriptions const& b) noexcept
+    {
+        // clang-format off
+        return a == b
+            && a.dpiScale == b.dpiScale
+            && a.textShapingEngine == b.textShapingEngine
+            && a.fontLocator == b.fontLocator
+            && a.builtinBoxDrawing == b.builtinBoxDrawing;
+        // clang-format on
+    }
+
+    constexpr uint32_t packedColor(vtbackend::RGBColor color) noexcept
+    {
+        return (uint32_t(color.red) << 16) | (uint32_t(color.green) << 8) | uint32_t(color.blue);
+    }
+
+    // Only mixes in what affects the generated tiles, hence not the background color.
+    void hashAttributes(crispy::strong_hash_stream& hash, vtbackend::RenderAttributes const& attributes)
     {
-        switch (engine)
+        hash.update(packedColor(attributes.foregroundColor))
+            .update(packedColor(attributes.decorationColor))
+            .update(static_cast<uint32_t>(attributes.flags.value()));
+    }
+
+    void hashCell(crispy::strong_hash_stream& hash,
+                  vtbackend::RenderCell const& cell,
+                  std::u32string_view codepoints)
+    {
+        auto const groupFlags = (cell.groupStart ? 1u : 0u) | (cell.groupEnd ? 2u : 0u);
+        hash.update(static_cast<uint32_t>(codepoints.size())).update(codepoints);
+        hashAttributes(hash, cell.attributes);
+        hash.update(static_cast<uint32_t>(unbox(cell.position.column)))
+            .update(static_cast<uint32_t>(cell.width))
+            .update(groupFlags);
+    }
+
+    // Mixes in what a cell contributes to the frame besides its tiles.
+    void hashCellBackground(crispy::strong_hash_stream& hash,
+                            vtbackend::RenderCell const& cell,
+                            vtbackend::ImageFragment const* image)
+    {
+        hash.update(packedColor(cell.attributes.backgroundColor));
+        if (image)
         {
-            case TextShapingEngine::DWrite:
-#if defined(_WIN32)
-                rendererLog()("Using DirectWrite text shaping engine.");
-                // TODO: do we want to use custom font locator here?
-                return make_unique<text::directwrite_shaper>(dpi, locator);
-#else
-                rendererLog()("DirectWrite not available on this platform.");
-                break;
-#endif
-
-            case TextShapingEngine::CoreText:
-#if defined(__APPLE__)
-                rendererLog()("CoreText not yet implemented.");
-                break;
-#else
-                rendererLog()("CoreText not available on this platform.");
-                break;
-#endif
-
-            case TextShapingEngine::OpenShaper: break;
+            auto const offset = image->offset();
+            hash.update(static_cast<uint32_t>(image->rasterizedImage().image().id().value))
+                .update(static_cast<uint32_t>(unbox(offset.line)))
+                .update(static_cast<uint32_t>(unbox(offset.column)));
         }
+    }
 
-        rendererLog()("Using OpenShaper text shaping engine.");
-        return make_unique<text::open_shaper>(dpi, locator);
+    crispy::strong_hash hashLine(vtbackend::RenderLine const& line)
+    {
+        auto hash = crispy::strong_hash_stream {};
+        hash.update(line.text);
+        hashAttributes(hash, line.textAttributes);
+        return hash.update(unbox<uint32_t>(line.usedColumns)).finish();
     }
 
 } // namespace
 
 Renderer::Renderer(vtbackend::PageSize pageSize,
                    FontDescriptions fontDescriptions,
+                   RenderResourcePool& resourcePool,
                    vtbackend::ColorPalette const& colorPalette,
                    crispy::strong_hashtable_size atlasHashtableSlotCount,
                    crispy::lru_capacity atlasTileCount,
+                   size_t atlasMemoryBudget,
                    bool atlasDirectMapping,
                    Decorator hyperlinkNormal,
                    Decorator hyperlinkHover):
     _atlasHashtableSlotCount { crispy::nextPowerOfTwo(atlasHashtableSlotCount.value) },
     _atlasTileCount { std::max(atlasTileCount.value, static_cast<uint32_t>(pageSize.area())) },
+    _atlasMemoryBudget { atlasMemoryBudget },
     _atlasDirectMapping { atlasDirectMapping },
     //.
     _fontDescriptions { std::move(fontDescriptions) },
-    _textShaper { createTextShaper(_fontDescriptions.textShapingEngine,
-                                   _fontDescriptions.dpi,
-                                   createFontLocator(_fontDescriptions.fontLocator)) },
-    _fonts { loadFontKeys(_fontDescriptions, *_textShaper) },
-    _gridMetrics { loadGridMetrics(_fonts.regular, pageSize, *_textShaper) },
+    _resourcePool { resourcePool },
+    _resources { resourcePool.acquire(_fontDescriptions) },
+    _fonts { loadFontKeys(_fontDescriptions, *_resources) },
+    _gridMetrics { loadGridMetrics(_fonts.regular, pageSize, *_resources) },
     //.
     _colorPalette { colorPalette },
     _backgroundRenderer { _gridMetrics, colorPalette.defaultBackground },
     _imageRenderer { _gridMetrics, cellSize() },
-    _textRenderer { _gridMetrics, *_textShaper, _fontDescriptions, _fonts, _imageRenderer },
+    _textRenderer { _gridMetrics, *_resources, _fontDescriptions, _fonts, _imageRenderer },
     _decorationRenderer { _gridMetrics, hyperlinkNormal, hyperlinkHover },
     _cursorRenderer { _gridMetrics, vtbackend::CursorShape::Block }
 {
@@ -163,6 +199,12 @@ void Renderer::setRenderTarget(RenderTarget& renderTarget)
     _directMappingAllocator.enabled = _atlasDirectMapping;
     _textRenderer.setRenderTarget(renderTarget, _directMappingAllocator);
 
+    // Text and decorations are retained per line, so their tiles are rendered through the line cache.
+    _lineTileCache.setBackend(renderTarget.textureScheduler());
+    invalidateLines();
+    _textRenderer.setTextureScheduler(_lineTileCache);
+    _decorationRenderer.setTextureScheduler(_lineTileCache);
+
     configureTextureAtlas();
 }
 
@@ -171,15 +213,29 @@ void Renderer::configureTextureAtlas()
     Require(_renderTarget);
 
     auto const atlasCellSize = _gridMetrics.cellSize;
+
+    // Keep the atlas within its GPU memory budget, but never below what is needed to render a full page.
+    auto const tileBytes =
+        std::max(size_t { 1 }, atlasCellSize.area() * atlas::element_count(atlas::Format::RGBA));
+    auto const budgetTileCount = static_cast<uint32_t>(
+        std::min(_atlasMemoryBudget / tileBytes, size_t { std::numeric_limits<uint32_t>::max() }));
+    auto const pageTileCount = static_cast<uint32_t>(_gridMetrics.pageSize.area());
+    auto const tileCount =
+        crispy::lru_capacity { std::max(std::min(_atlasTileCount.value, budgetTileCount), pageTileCount) };
+    if (tileCount.value < _atlasTileCount.value)
+        rendererLog()("Reducing atlas tile count to {} to stay within the atlas memory budget of {} KiB.",
+                      tileCount.value,
+                      _atlasMemoryBudget / 1024);
+
     auto atlasProperties = atlas::AtlasProperties { atlas::Format::RGBA,
                                                     atlasCellSize,
                                                     _atlasHashtableSlotCount,
-                                                    _atlasTileCount,
+                                                    tileCount,
                                                     _directMappingAllocator.currentlyAllocatedCount };
 
     Require(atlasProperties.tileCount.value > 0);
 
-    _textureAtlas = make_unique<Renderable::TextureAtlas>(_renderTarget->textureScheduler(), atlasProperties);
+    _textureAtlas = make_unique<Renderable::TextureAtlas>(_lineTileCache, atlasProperties);
 
     // clang-format off
     rendererLog()("Configuring texture atlas.\n", atlasProperties);
@@ -218,6 +274,7 @@ void Renderer::clearCache()
         return;
 
     _renderTarget->clearCache();
+    invalidateLines();
 
     // TODO(?): below functions are actually doing the same again and again and again. delete them (and their
     // functions for that) either that, or only the render target is allowed to clear the actual atlas caches.
@@ -227,20 +284,33 @@ void Renderer::clearCache()
 
 void Renderer::setFonts(FontDescriptions fontDescriptions)
 {
-    if (_fontDescriptions.textShapingEngine == fontDescriptions.textShapingEngine)
+    _textRenderer.cancelAsyncGlyphs();
+
+    // Fonts differing in their DPI only, as with the window moved to another monitor, are likely to be
+    // switched back to, so the current ones are kept along with their atlas rather than rasterized again.
+    if (equalExceptDpi(_fontDescriptions, fontDescriptions) && _fontDescriptions.dpi != fontDescriptions.dpi)
     {
-        _textShaper->clear_cache();
-        _textShaper->set_dpi(fontDescriptions.dpi);
-        if (_fontDescriptions.fontLocator != fontDescriptions.fontLocator)
-            _textShaper->set_locator(createFontLocator(fontDescriptions.fontLocator));
+        if (_retainedFonts && equalExceptDpi(_retainedFonts->fontDescriptions, fontDescriptions)
+            && _retainedFonts->fontDescriptions.dpi == fontDescriptions.dpi)
+        {
+            restoreRetainedFonts();
+            return;
+        }
+        retainFonts();
     }
     else
-        _textShaper = createTextShaper(fontDescriptions.textShapingEngine,
-                                       fontDescriptions.dpi,
-                                       createFontLocator(fontDescriptions.fontLocator));
+    {
+        discardRetainedFonts();
+        _textRenderer.discardRetainedTextShapingCaches();
+    }
+
+    // The shaper may be shared with other renderers, so rather than reconfiguring it, switch to the
+    // resources matching the new fonts, keeping the previous ones until the text renderer has switched, too.
+    auto const previousResources = std::exchange(_resources, _resourcePool.acquire(fontDescriptions));
+    _textRenderer.setRenderResources(*_resources);
 
     _fontDescriptions = std::move(fontDescriptions);
-    _fonts = loadFontKeys(_fontDescriptions, *_textShaper);
+    _fonts = loadFontKeys(_fontDescriptions, *_resources);
     updateFontMetrics();
 }
 
@@ -252,35 +322,134 @@ bool Renderer::setFontSize(text::font_size fontSize)
     if (fontSize.pt > 200.)
         return false;
 
+    // Font keys are specific to the font size, so text shaped with the previous size is kept separately,
+    // for switching back to it without shaping everything again.
+    _textRenderer.cancelAsyncGlyphs();
+    _textRenderer.retainTextShapingCache();
     _fontDescriptions.size = fontSize;
-    _fonts = loadFontKeys(_fontDescriptions, *_textShaper);
+    _fonts = loadFontKeys(_fontDescriptions, *_resources);
     updateFontMetrics();
+    _textRenderer.restoreTextShapingCache();
 
     return true;
 }
 
+void Renderer::retainFonts()
+{
+    discardRetainedFonts();
+    _textRenderer.retainTextShapingCache();
+
+    auto const atlasRetained = _textureAtlas && _lineTileCache.retainAtlas();
+    _retainedFonts = RetainedFonts {
+        .fontDescriptions = _fontDescriptions,
+        .resources = _resources,
+        .fonts = _fonts,
+        .textureAtlas = atlasRetained ? std::move(_textureAtlas) : nullptr,
+    };
+    rendererLog()("Retaining fonts of DPI {} ({}).",
+                  _fontDescriptions.dpi,
+                  atlasRetained ? "with atlas" : "without atlas");
+}
+
+void Renderer::restoreRetainedFonts()
+{
+    _textRenderer.retainTextShapingCache();
+
+    auto& retained = *_retainedFonts;
+    std::swap(_fontDescriptions, retained.fontDescriptions);
+    std::swap(_resources, retained.resources);
+    std::swap(_fonts, retained.fonts);
+    _textRenderer.setRenderResources(*_resources);
+
+    // The retained atlas may have been evicted meanwhile to stay within the GPU memory budget,
+    // in which case the fonts switched away from are retained without an atlas, too.
+    auto const atlasRestored = retained.textureAtlas && _lineTileCache.restoreAtlas();
+    if (atlasRestored)
+        std::swap(_textureAtlas, retained.textureAtlas);
+    else
+    {
+        if (retained.textureAtlas)
+            _lineTileCache.discardRetainedAtlas();
+        auto const atlasRetained = _textureAtlas && _lineTileCache.retainAtlas();
+        retained.textureAtlas = atlasRetained ? std::move(_textureAtlas) : nullptr;
+    }
+    rendererLog()("Restoring retained fonts of DPI {} ({}).",
+                  _fontDescriptions.dpi,
+                  atlasRestored ? "with atlas" : "without atlas");
+
+    _gridMetrics = loadGridMetrics(_fonts.regular, _gridMetrics.pageSize, *_resources);
+    if (atlasRestored)
+    {
+        for (gsl::not_null<Renderable*>& renderable: renderables())
+            renderable->setTextureAtlas(*_textureAtlas);
+    }
+    else if (_renderTarget)
+        configureTextureAtlas();
+
+    applyGridMetrics();
+    _textRenderer.restoreTextShapingCache();
+}
+
+void Renderer::discardRetainedFonts()
+{
+    if (!_retainedFonts)
+        return;
+
+    if (_retainedFonts->resources != _resources)
+        _textRenderer.discardRetainedTextShapingCaches(*_retainedFonts->resources);
+    if (_retainedFonts->textureAtlas)
+        _lineTileCache.discardRetainedAtlas();
+    _retainedFonts.reset();
+}
+
 void Renderer::updateFontMetrics()
 {
+    _textRenderer.cancelAsyncGlyphs();
     rendererLog()("Updating grid metrics: {}", _gridMetrics);
 
-    _gridMetrics = loadGridMetrics(_fonts.regular, _gridMetrics.pageSize, *_textShaper);
+    _gridMetrics = loadGridMetrics(_fonts.regular, _gridMetrics.pageSize, *_resources);
 
     if (_renderTarget)
         configureTextureAtlas();
 
+    applyGridMetrics();
+}
+
+void Renderer::applyGridMetrics()
+{
     _textRenderer.updateFontMetrics();
     _imageRenderer.setCellSize(cellSize());
+    invalidateLines();
 
     clearCache();
 }
 
 void Renderer::render(vtbackend::Terminal& terminal, bool pressure)
 {
+    auto const _ = crispy::trace_span("Renderer.render");
+    auto const measured = RenderStatsScope(_stats, &RenderStats::total);
+    auto const allocations = crispy::allocation_scope { _allocations };
+    if (_stats)
+        ++_stats->frames;
+
+    auto firstFrameTrace = optional<crispy::trace_scope> {};
+    if (!std::exchange(_firstFrameRendered, true))
+        firstFrameTrace.emplace("Renderer.render (first frame)");
+
     auto const statusLineHeight = terminal.statusLineHeight();
     _gridMetrics.pageSize = terminal.pageSize() + statusLineHeight;
 
     executeImageDiscards();
 
+    if (_cacheTrimRequested.exchange(false))
+    {
+        discardRetainedFonts();
+        rendererLog()("Trimmed caches: {} text shaping results evicted.", _textRenderer.trimCaches());
+    }
+
+    if (_textRenderer.applyAsyncGlyphs())
+        invalidateLines(); // lines rendered before may lack the glyphs just added
+
 #if !defined(LIBTERMINAL_PASSIVE_RENDER_BUFFER_UPDATE) // {{{
     // Windows 10 (ConPTY) workaround. ConPTY can't handle non-blocking I/O,
     // so we have to explicitly refresh the render buffer
@@ -288,18 +457,35 @@ void Renderer::render(vtbackend::Terminal& terminal, bool pressure)
     terminal.refreshRenderBuffer();
 #endif // }}}
 
+    _previousLineHashes.swap(_lineHashes);
+    _lineHashes.assign(unbox<size_t>(_gridMetrics.pageSize.lines), crispy::strong_hash {});
+
     optional<vtbackend::RenderCursor> cursorOpt;
-    _imageRenderer.beginFrame();
-    _textRenderer.beginFrame();
+    auto frameID = uint64_t { 0 };
+    {
+        auto const _ = RenderStatsScope(_stats, &RenderStats::background);
+        _backgroundRenderer.beginFrame();
+    }
+    {
+        auto const _ = RenderStatsScope(_stats, &RenderStats::text);
+        _textRenderer.beginFrame();
+    }
     _textRenderer.setPressure(pressure && terminal.isPrimaryScreen());
     {
         vtbackend::RenderBufferRef const renderBuffer = terminal.renderBuffer();
         cursorOpt = renderBuffer.get().cursor;
-        renderCells(renderBuffer.get().cells);
+        frameID = renderBuffer.get().frameID;
+        renderCells(renderBuffer.get());
         renderLines(renderBuffer.get().lines);
     }
-    _textRenderer.endFrame();
-    _imageRenderer.endFrame();
+    {
+        auto const _ = RenderStatsScope(_stats, &RenderStats::background);
+        _backgroundRenderer.endFrame();
+    }
+    {
+        auto const _ = RenderStatsScope(_stats, &RenderStats::text);
+        _textRenderer.endFrame();
+    }
 
     if (cursorOpt && cursorOpt.value().shape != vtbackend::CursorShape::Block)
     {
@@ -314,21 +500,129 @@ void Renderer::render(vtbackend::Terminal& terminal, bool pressure)
             else
                 return get<vtbackend::RGBColor>(_colorPalette.cursor.color);
         }();
-        _cursorRenderer.render(_gridMetrics.map(cursor.position), cursor.width, cursorColor);
+        {
+            auto const _ = RenderStatsScope(_stats, &RenderStats::cursor);
+            _cursorRenderer.render(_gridMetrics.map(cursor.position), cursor.width, cursorColor);
+        }
+        damageLine(cursor.position.line,
+                   crispy::strong_hash(static_cast<uint32_t>(unbox(cursor.position.column)),
+                                       static_cast<uint32_t>(cursor.shape),
+                                       static_cast<uint32_t>(cursor.width),
+                                       packedColor(cursorColor)));
+    }
+
+    _renderTarget->setDamage(computeDamage());
+    {
+        auto const _ = RenderStatsScope(_stats, &RenderStats::execute);
+        _renderTarget->execute(terminal.currentTime());
+    }
+    terminal.framePresented(frameID, std::chrono::steady_clock::now());
+}
+
+void Renderer::damageLine(vtbackend::LineOffset line, crispy::strong_hash const& hash)
+{
+    auto const index = unbox<size_t>(line);
+    if (line >= vtbackend::LineOffset(0) && index < _lineHashes.size())
+        _lineHashes[index] = _lineHashes[index] * hash;
+}
+
+optional<DamagedArea> Renderer::computeDamage()
+{
+    if (std::exchange(_fullDamage, false) || _lineHashes.size() != _previousLineHashes.size())
+        return nullopt;
+
+    auto const first = std::mismatch(_lineHashes.begin(), _lineHashes.end(), _previousLineHashes.begin());
+    if (first.first == _lineHashes.end())
+        return DamagedArea { 0, vtbackend::Height(0) };
+
+    auto const last = std::mismatch(_lineHashes.rbegin(), _lineHashes.rend(), _previousLineHashes.rbegin());
+    auto const firstLine = std::distance(_lineHashes.begin(), first.first);
+    auto const lineCount = std::distance(first.first, last.first.base());
+
+    return DamagedArea {
+        _gridMetrics.mapTopLeft(vtbackend::LineOffset::cast_from(firstLine), vtbackend::ColumnOffset(0)).y,
+        _gridMetrics.cellSize.height * vtbackend::Height::cast_from(lineCount),
+    };
+}
+
+void Renderer::renderCells(vtbackend::RenderBuffer const& renderBuffer)
+{
+    auto const& renderableCells = renderBuffer.cells;
+    auto lineBegin = renderableCells.begin();
+    while (lineBegin != renderableCells.end())
+    {
+        auto const line = lineBegin->position.line;
+        auto const lineEnd = std::find_if(lineBegin, renderableCells.end(), [line](auto const& cell) {
+            return cell.position.line != line;
+        });
+        renderCellsOfLine(renderBuffer, lineBegin, lineEnd);
+        lineBegin = lineEnd;
+    }
+}
+
+void Renderer::renderCellsOfLine(vtbackend::RenderBuffer const& renderBuffer,
+                                 vector<vtbackend::RenderCell>::const_iterator begin,
+                                 vector<vtbackend::RenderCell>::const_iterator end)
+{
+    // Backgrounds are coalesced across lines and images are rendered from their own textures,
+    // so only text and decorations are retained by the line cache.
+    auto cellsHash = crispy::strong_hash_stream {};
+    auto backgroundHash = crispy::strong_hash_stream {};
+    for (auto cell = begin; cell != end; ++cell)
+    {
+        auto const* image = renderBuffer.imageOf(*cell);
+        {
+            auto const _ = RenderStatsScope(_stats, &RenderStats::background);
+            _backgroundRenderer.renderCell(*cell);
+        }
+        if (image)
+        {
+            auto const _ = RenderStatsScope(_stats, &RenderStats::image);
+            _imageRenderer.renderImage(_gridMetrics.map(cell->position), *image);
+        }
+        hashCell(cellsHash, *cell, renderBuffer.codepointsOf(*cell));
+        hashCellBackground(backgroundHash, *cell, image);
+    }
+
+    auto const hash = cellsHash.finish();
+    auto const line = begin->position.line;
+    damageLine(line, hash * backgroundHash.finish());
+    if (line < vtbackend::LineOffset(0))
+    {
+        renderTextAndDecorationsOfCells(renderBuffer, begin, end);
+        return;
     }
 
-    _renderTarget->execute(terminal.currentTime());
+    {
+        auto const _ = RenderStatsScope(_stats, &RenderStats::lineCache);
+        if (_lineTileCache.replay(line, hash))
+            return;
+    }
+
+    _lineTileCache.beginRecording(line, hash);
+    renderTextAndDecorationsOfCells(renderBuffer, begin, end);
+    {
+        auto const _ = RenderStatsScope(_stats, &RenderStats::text);
+        _textRenderer.flush();
+    }
+    _lineTileCache.endRecording();
 }
 
-void Renderer::renderCells(vector<vtbackend::RenderCell> const& renderableCells)
+void Renderer::renderTextAndDecorationsOfCells(vtbackend::RenderBuffer const& renderBuffer,
+                                               vector<vtbackend::RenderCell>::const_iterator begin,
+                                               vector<vtbackend::RenderCell>::const_iterator end)
 {
-    for (vtbackend::RenderCell const& cell: renderableCells)
+    if (begin == end)
+        return;
+
     {
-        _backgroundRenderer.renderCell(cell);
-        _decorationRenderer.renderCell(cell);
-        _textRenderer.renderCell(cell);
-        if (cell.image)
-            _imageRenderer.renderImage(_gridMetrics.map(cell.position), *cell.image);
+        auto const _ = RenderStatsScope(_stats, &RenderStats::decoration);
+        _decorationRenderer.renderCells(gsl::span(&*begin, static_cast<size_t>(end - begin)));
+    }
+    for (auto cell = begin; cell != end; ++cell)
+    {
+        auto const _ = RenderStatsScope(_stats, &RenderStats::text);
+        _textRenderer.renderCell(*cell, renderBuffer.codepointsOf(*cell));
     }
 }
 
@@ -336,17 +630,55 @@ void Renderer::renderLines(vector<vtbackend::RenderLine> const& renderableLines)
 {
     for (vtbackend::RenderLine const& line: renderableLines)
     {
-        _backgroundRenderer.renderLine(line);
-        _decorationRenderer.renderLine(line);
-        _textRenderer.renderLine(line);
+        {
+            auto const _ = RenderStatsScope(_stats, &RenderStats::background);
+            _backgroundRenderer.renderLine(line);
+        }
+
+        auto const hash = hashLine(line);
+        damageLine(line.lineOffset,
+                   hash * packedColor(line.textAttributes.backgroundColor)
+                       * packedColor(line.fillAttributes.backgroundColor)
+                       * unbox<uint32_t>(line.displayWidth));
+        {
+            auto const _ = RenderStatsScope(_stats, &RenderStats::lineCache);
+            if (_lineTileCache.replay(line.lineOffset, hash))
+                continue;
+        }
+
+        _lineTileCache.beginRecording(line.lineOffset, hash);
+        {
+            auto const _ = RenderStatsScope(_stats, &RenderStats::decoration);
+            _decorationRenderer.renderLine(line);
+        }
+        {
+            auto const _ = RenderStatsScope(_stats, &RenderStats::text);
+            _textRenderer.renderLine(line);
+        }
+        _lineTileCache.endRecording();
     }
 }
 
+Renderer::CacheStats Renderer::cacheStats() const noexcept
+{
+    auto const& shaping = _textRenderer.shapingStats();
+    auto const atlas = _textureAtlas ? _textureAtlas->tileCacheStats() : crispy::lru_hashtable_stats {};
+    return CacheStats { .shapingLookups = shaping.lookups,
+                        .shapingMisses = shaping.misses,
+                        .atlasHits = atlas.hits,
+                        .atlasMisses = atlas.misses,
+                        .lineTileHits = _lineTileCache.hits(),
+                        .lineTileMisses = _lineTileCache.misses() };
+}
+
 void Renderer::inspect(std::ostream& textOutput) const
 {
     _textureAtlas->inspect(textOutput);
+    _lineTileCache.inspect(textOutput);
     for (auto const& renderable: renderables())
         renderable->inspect(textOutput);
+    if constexpr (crispy::allocations_counted)
+        textOutput << fmt::format("Allocations per frame rendered: {}\n", _allocations.stats());
 }
 
 } // namespace vtrasterizer
@@ -11,17 +11,24 @@
 #include <vtrasterizer/Decorator.h>
 #include <vtrasterizer/GridMetrics.h>
 #include <vtrasterizer/ImageRenderer.h>
+#include <vtrasterizer/LineTileCache.h>
+#include <vtrasterizer/RenderResources.h>
+#include <vtrasterizer/RenderStats.h>
 #include <vtrasterizer/RenderTarget.h>
 #include <vtrasterizer/TextRenderer.h>
 
 #include <crispy/StrongLRUHashtable.h>
+#include <crispy/allocation_counter.h>
 #include <crispy/size.h>
 
 #include <fmt/format.h>
 
 #include <gsl/pointers>
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <vector>
 
 namespace vtrasterizer
@@ -48,16 +55,21 @@ class Renderer
     /** Constructs a Renderer instances.
      *
      * @p fonts              Reference to the set of loaded fonts to be used for rendering text.
+     * @p resourcePool       Pool of resources shared with other renderers, such as the text shaper.
      * @p colorPalette       User-configurable color profile to use to map terminal colors to.
      * @p projectionMatrix   Projection matrix to apply to the rendered scene when rendering the screen.
      * @p atlasDirectMapping Indicates whether or not direct mapped tiles are allowed.
      * @p atlasTileCount     Number of tiles guaranteed to be available in LRU cache.
+     * @p atlasMemoryBudget  Maximum number of bytes of GPU memory the texture atlas may occupy,
+     *                       unless required to render a full page.
      */
     Renderer(vtbackend::PageSize pageSize,
              FontDescriptions fontDescriptions,
+             RenderResourcePool& resourcePool,
              vtbackend::ColorPalette const& colorPalette,
              crispy::strong_hashtable_size atlasHashtableSlotCount,
              crispy::lru_capacity atlasTileCount,
+             size_t atlasMemoryBudget,
              bool atlasDirectMapping,
              Decorator hyperlinkNormal,
              Decorator hyperlinkHover);
@@ -78,9 +90,26 @@ class Renderer
 
     [[nodiscard]] GridMetrics const& gridMetrics() const noexcept { return _gridMetrics; }
 
+    /// Enables or disables shaping and rasterizing glyphs asynchronously.
+    ///
+    /// @p glyphsReady is invoked from a worker thread whenever glyphs became available,
+    /// which then should cause another frame to be rendered.
+    void setAsyncGlyphs(bool enabled, std::function<void()> glyphsReady)
+    {
+        _textRenderer.setAsyncGlyphs(enabled, std::move(glyphsReady));
+    }
+
+    /// Sets the codepoints to be shaped and rasterized in the background,
+    /// before they are rendered for the first time.
+    void setPrewarmedCodepoints(std::vector<CodepointRange> ranges)
+    {
+        _textRenderer.setPrewarmedCodepoints(std::move(ranges));
+    }
+
     void setHyperlinkDecoration(Decorator normal, Decorator hover)
     {
         _decorationRenderer.setHyperlinkDecoration(normal, hover);
+        invalidateLines();
     }
 
     void setPageSize(vtbackend::PageSize screenSize) noexcept { _gridMetrics.pageSize = screenSize; }
@@ -90,6 +119,7 @@ class Renderer
         if (_renderTarget)
             _renderTarget->setMargin(margin);
         _gridMetrics.pageMargin = margin;
+        invalidateLines();
     }
 
     /**
@@ -105,10 +135,41 @@ class Renderer
      */
     void render(vtbackend::Terminal& terminal, bool pressureHint);
 
+    /// Accumulates the time spent by the render subsystems into @p stats, or stops doing so if nullptr.
+    void setRenderStats(RenderStats* stats) noexcept
+    {
+        _stats = stats;
+        _textRenderer.setRenderStats(stats);
+    }
+
+    /// Lookups of the caches of the renderer since it has been created, e.g. for exporting metrics.
+    struct CacheStats
+    {
+        uint64_t shapingLookups = 0; // text cluster groups looking up their shaping result
+        uint64_t shapingMisses = 0;  // of which were shaped, as not cached
+        uint64_t atlasHits = 0;      // glyph tiles found in the texture atlas
+        uint64_t atlasMisses = 0;    // glyph tiles rasterized, as not found in the texture atlas
+        uint64_t lineTileHits = 0;   // lines replayed from the tiles recorded, as unchanged
+        uint64_t lineTileMisses = 0; // lines rendered from scratch
+    };
+
+    /// @returns the lookups of the caches so far. Must be invoked on the thread rendering.
+    [[nodiscard]] CacheStats cacheStats() const noexcept;
+
+    /// @returns the heap allocations made per frame rendered, if counted (see CONTOUR_COUNT_ALLOCATIONS).
+    [[nodiscard]] crispy::allocation_counter::snapshot allocationStats() const noexcept
+    {
+        return _allocations.stats();
+    }
+
     void discardImage(vtbackend::Image const& image);
 
     void clearCache();
 
+    /// Schedules the cold cache entries to be evicted at the start of the next render(),
+    /// e.g. when running low on memory. May be invoked from any thread.
+    void trimCaches() noexcept { _cacheTrimRequested = true; }
+
     void inspect(std::ostream& textOutput) const;
 
     std::array<gsl::not_null<Renderable*>, 5> renderables()
@@ -127,27 +188,71 @@ class Renderer
 
   private:
     void configureTextureAtlas();
-    void renderCells(std::vector<vtbackend::RenderCell> const& renderableCells);
+    void applyGridMetrics();
+    void retainFonts();
+    void restoreRetainedFonts();
+    void discardRetainedFonts();
+    void renderCells(vtbackend::RenderBuffer const& renderBuffer);
+    void renderCellsOfLine(vtbackend::RenderBuffer const& renderBuffer,
+                           std::vector<vtbackend::RenderCell>::const_iterator begin,
+                           std::vector<vtbackend::RenderCell>::const_iterator end);
+    void renderTextAndDecorationsOfCells(vtbackend::RenderBuffer const& renderBuffer,
+                                         std::vector<vtbackend::RenderCell>::const_iterator begin,
+                                         std::vector<vtbackend::RenderCell>::const_iterator end);
     void renderLines(std::vector<vtbackend::RenderLine> const& renderableLines);
     void executeImageDiscards();
+    void damageLine(vtbackend::LineOffset line, crispy::strong_hash const& hash);
+    [[nodiscard]] std::optional<DamagedArea> computeDamage();
+
+    /// Forgets about everything retained from previous frames.
+    void invalidateLines() noexcept
+    {
+        _lineTileCache.invalidate();
+        _fullDamage = true;
+    }
 
     crispy::strong_hashtable_size _atlasHashtableSlotCount;
     crispy::lru_capacity _atlasTileCount;
+    size_t _atlasMemoryBudget;
     bool _atlasDirectMapping;
 
     RenderTarget* _renderTarget = nullptr;
+    RenderStats* _stats = nullptr;
+    crispy::allocation_counter _allocations;
 
     Renderable::DirectMappingAllocator _directMappingAllocator;
+    LineTileCache _lineTileCache;
+
+    // Hashes of everything rendered for each line, of the current and the previous frame,
+    // used to determine the damaged area.
+    std::vector<crispy::strong_hash> _lineHashes;
+    std::vector<crispy::strong_hash> _previousLineHashes;
+    bool _fullDamage = true;
+    bool _firstFrameRendered = false;
     std::unique_ptr<Renderable::TextureAtlas> _textureAtlas;
 
     FontDescriptions _fontDescriptions;
-    std::unique_ptr<text::shaper> _textShaper;
+    RenderResourcePool& _resourcePool;
+    std::shared_ptr<RenderResources> _resources;
     FontKeys _fonts;
 
+    // The fonts rendered with before, differing in their DPI only, along with their resources and atlas,
+    // kept for switching back to them, e.g. when the window is moved back to the previous monitor.
+    struct RetainedFonts
+    {
+        FontDescriptions fontDescriptions;
+        std::shared_ptr<RenderResources> resources;
+        FontKeys fonts;
+        std::unique_ptr<Renderable::TextureAtlas> textureAtlas; // if its texture is retained by the backend
+    };
+    std::optional<RetainedFonts> _retainedFonts;
+
     GridMetrics _gridMetrics;
 
     vtbackend::ColorPalette const& _colorPalette;
 
+    std::atomic<bool> _cacheTrimRequested = false;
+
     std::mutex _imageDiscardLock;                       //!< Lock guard for accessing _discardImageQueue.
     std::vector<vtbackend::ImageId> _discardImageQueue; //!< List of images to be discarded.
 
@@ -0,0 +1,588 @@
+// SPDX-License-Identifier: Apache-2.0
+#include <vtrasterizer/SoftwareRenderTarget.h>
+
+#include <crispy/thread_pool.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_AMD64)
+    #include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+#endif
+
+namespace vtrasterizer
+{
+
+namespace
+{
+    // Rows of pixels per band at least, such that scheduling a band costs little compared to rasterizing it.
+    constexpr int MinimumBandHeight = 32;
+
+    uint8_t toByte(float value) noexcept
+    {
+        return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    // Divides by 255, rounding to the nearest, for values up to 255 * 255.
+    constexpr unsigned div255(unsigned value) noexcept
+    {
+        auto const t = value + 128;
+        return (t + (t >> 8)) >> 8;
+    }
+
+    constexpr uint8_t mul255(unsigned a, unsigned b) noexcept
+    {
+        return static_cast<uint8_t>(div255(a * b));
+    }
+
+    void fillPixels(uint8_t* target, std::array<uint8_t, 4> color, size_t count) noexcept
+    {
+        for (size_t i = 0; i < count; ++i)
+            std::memcpy(target + (i * 4), color.data(), 4);
+    }
+
+    // Blends a pixel of straight alpha onto the target the way the OpenGL render target does,
+    // i.e. color = source * alpha + target * (1 - alpha), and alpha = source alpha + target alpha.
+    void blendPixel(uint8_t* target, uint8_t const* source) noexcept
+    {
+        auto const alpha = unsigned { source[3] };
+        for (auto i = 0; i < 3; ++i)
+            target[i] = static_cast<uint8_t>(div255((source[i] * alpha) + (target[i] * (255 - alpha))));
+        target[3] = static_cast<uint8_t>(std::min(255u, alpha + target[3]));
+    }
+
+    // Blends @p count RGBA pixels of @p source onto @p target, four at a time where SIMD is available.
+    void blendPixels(uint8_t* target, uint8_t const* source, size_t count) noexcept
+    {
+        size_t i = 0;
+
+#if defined(__SSE2__) || defined(__x86_64__) || defined(_M_AMD64)
+        auto const zero = _mm_setzero_si128();
+        auto const opaque = _mm_set1_epi16(255);
+        auto const half = _mm_set1_epi16(128);
+        auto const alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        auto const blendHalf = [&](__m128i source16, __m128i target16, __m128i alpha16) {
+            auto const sum = _mm_add_epi16(_mm_mullo_epi16(source16, alpha16),
+                                           _mm_mullo_epi16(target16, _mm_sub_epi16(opaque, alpha16)));
+            auto const t = _mm_add_epi16(sum, half);
+            return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+        };
+        for (; i + 4 <= count; i += 4)
+        {
+            auto const s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + (i * 4)));
+            auto const d = _mm_loadu_si128(reinterpret_cast<__m128i const*>(target + (i * 4)));
+
+            // The alpha of each pixel, broadcast to all four of its bytes.
+            auto alpha = _mm_srli_epi32(s, 24);
+            alpha = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 8));
+            alpha = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 16));
+
+            auto const low = blendHalf(
+                _mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(alpha, zero));
+            auto const high = blendHalf(
+                _mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(alpha, zero));
+            auto const blended = _mm_packus_epi16(low, high);
+            auto const result = _mm_or_si128(_mm_andnot_si128(alphaMask, blended),
+                                             _mm_and_si128(alphaMask, _mm_adds_epu8(d, alpha)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target + (i * 4)), result);
+        }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+        static constexpr uint8_t AlphaIndices[16] = {
+            3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15,
+        };
+        auto const alphaIndices = vld1q_u8(AlphaIndices);
+        auto const alphaMask = vreinterpretq_u8_u32(vdupq_n_u32(0xFF000000u));
+        auto const divide = [](uint16x8_t sum) {
+            auto const t = vaddq_u16(sum, vdupq_n_u16(128));
+            return vshrn_n_u16(vsraq_n_u16(t, t, 8), 8);
+        };
+        for (; i + 4 <= count; i += 4)
+        {
+            auto const s = vld1q_u8(source + (i * 4));
+            auto const d = vld1q_u8(target + (i * 4));
+            auto const alpha = vqtbl1q_u8(s, alphaIndices);
+            auto const inverse = vmvnq_u8(alpha);
+            auto const low = divide(vmlal_u8(
+                vmull_u8(vget_low_u8(s), vget_low_u8(alpha)), vget_low_u8(d), vget_low_u8(inverse)));
+            auto const high = divide(vmlal_u8(
+                vmull_u8(vget_high_u8(s), vget_high_u8(alpha)), vget_high_u8(d), vget_high_u8(inverse)));
+            vst1q_u8(target + (i * 4), vbslq_u8(alphaMask, vqaddq_u8(d, alpha), vcombine_u8(low, high)));
+        }
+#endif
+
+        for (; i < count; ++i)
+            blendPixel(target + (i * 4), source + (i * 4));
+    }
+
+    // The coverages of box drawing characters below match the fragment shader's (see text.frag).
+
+    float boxDrawingLines(int x, int y, int width, int height, int arms, int thickness) noexcept
+    {
+        // Heavy horizontal lines are twice as thick, heavy vertical lines three times.
+        auto const horizontalWeight = x < width / 2 ? arms & 3 : (arms >> 2) & 3;
+        auto const horizontalThickness = horizontalWeight == 2 ? 2 * thickness : thickness;
+        auto const y0 = (height / 2) - (horizontalThickness / 2);
+        auto const horizontal = horizontalWeight != 0 && y >= y0 && y < y0 + horizontalThickness;
+
+        auto const verticalWeight = y < height / 2 ? (arms >> 6) & 3 : (arms >> 4) & 3;
+        auto const verticalThickness = verticalWeight == 2 ? 3 * thickness : thickness;
+        auto const x0 = (width / 2) - (verticalThickness / 2);
+        auto const vertical = verticalWeight != 0 && x >= x0 && x < x0 + verticalThickness;
+
+        return horizontal || vertical ? 1.0f : 0.0f;
+    }
+
+    float boxDrawingBlock(int x, int y, int width, int height, int rect) noexcept
+    {
+        auto const x0 = (rect & 15) * width / 8;
+        auto const y0 = ((rect >> 4) & 15) * height / 8;
+        auto const x1 = ((rect >> 8) & 15) * width / 8;
+        auto const y1 = ((rect >> 12) & 15) * height / 8;
+        return x >= x0 && y >= y0 && x < x1 && y < y1 ? 1.0f : 0.0f;
+    }
+
+    float boxDrawingTriangle(int x, int y, int width, int height, int direction) noexcept
+    {
+        auto const u = (static_cast<float>(x) + 0.5f) / static_cast<float>(width);
+        auto const v = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+        auto const distance = (0.5f * (1.0f - (direction == 0 ? u : 1.0f - u))) - std::abs(v - 0.5f);
+        auto const fwidth = (0.5f / static_cast<float>(width)) + (1.0f / static_cast<float>(height));
+        return std::clamp((distance / fwidth) + 0.5f, 0.0f, 1.0f);
+    }
+
+    std::array<uint8_t, 4> toBytes(vtbackend::RGBAColor color) noexcept
+    {
+        return { color.red(), color.green(), color.blue(), color.alpha() };
+    }
+
+    // Maps the target column (or row) @p position of a rectangle at @p offset with size @p extent to the
+    // source column (or row) sampled for it, given the normalized @p start and @p length of the source area
+    // within @p sourceExtent.
+    int sourceIndex(
+        int position, int offset, int extent, float start, float length, int sourceExtent) noexcept
+    {
+        auto const u =
+            start + ((static_cast<float>(position - offset) + 0.5f) / static_cast<float>(extent) * length);
+        return std::clamp(static_cast<int>(u * static_cast<float>(sourceExtent)), 0, sourceExtent - 1);
+    }
+
+    void mapColumns(std::vector<int>& columns,
+                    int from,
+                    int to,
+                    int offset,
+                    int extent,
+                    float start,
+                    float length,
+                    int sourceExtent)
+    {
+        columns.resize(static_cast<size_t>(to - from));
+        for (auto x = from; x < to; ++x)
+            columns[static_cast<size_t>(x - from)] =
+                sourceIndex(x, offset, extent, start, length, sourceExtent);
+    }
+} // namespace
+
+SoftwareRenderTarget::SoftwareRenderTarget(crispy::thread_pool* threadPool): _threadPool { threadPool }
+{
+}
+
+void SoftwareRenderTarget::setClearColor(RGBAColor color) noexcept
+{
+    auto const clearColor = toBytes(color);
+    if (clearColor == _clearColor)
+        return;
+    _clearColor = clearColor;
+    _framebufferValid = false;
+}
+
+void SoftwareRenderTarget::setRenderSize(ImageSize size)
+{
+    if (size == _renderSize)
+        return;
+    _renderSize = size;
+    _framebuffer.assign(size.area() * 4, 0);
+    _framebufferValid = false;
+}
+
+void SoftwareRenderTarget::renderRectangle(int x, int y, Width width, Height height, RGBAColor color)
+{
+    _rectangles.emplace_back(Rectangle { .x = x,
+                                         .y = y,
+                                         .width = unbox<int>(width),
+                                         .height = unbox<int>(height),
+                                         .color = toBytes(color) });
+}
+
+void SoftwareRenderTarget::renderImage(std::shared_ptr<vtbackend::Image const> image,
+                                       int x,
+                                       int y,
+                                       Width width,
+                                       Height height,
+                                       atlas::NormalizedTileLocation source)
+{
+    if (!image || !*image->width() || !*image->height())
+        return;
+
+    _images.emplace_back(ImageCommand { .image = std::move(image),
+                                        .x = x,
+                                        .y = y,
+                                        .width = unbox<int>(width),
+                                        .height = unbox<int>(height),
+                                        .source = source });
+}
+
+void SoftwareRenderTarget::discardImage(vtbackend::ImageId /*imageId*/)
+{
+    // Images are read from where they are, and held only until the frame showing them is executed.
+}
+
+void SoftwareRenderTarget::scheduleScreenshot(ScreenshotCallback callback, ImageSize size)
+{
+    _pendingScreenshots.emplace_back(std::move(callback), size);
+}
+
+void SoftwareRenderTarget::execute(std::chrono::steady_clock::time_point /*now*/)
+{
+    auto const height = unbox<int>(_renderSize.height);
+    auto top = 0;
+    auto bottom = _renderSize.area() ? height : 0;
+    if (_framebufferValid && _damage)
+    {
+        top = std::clamp(_damage->y, 0, bottom);
+        bottom = std::clamp(_damage->y + unbox<int>(_damage->height), top, bottom);
+    }
+
+    ++_stats.frames;
+    if (top < bottom)
+    {
+        auto const rows = bottom - top;
+        auto const threadCount = _threadPool ? static_cast<int>(_threadPool->threadCount()) + 1 : 1;
+        // More bands than threads balance the bands taking longer than others, e.g. by showing more text.
+        auto const bandCount = std::clamp(rows / MinimumBandHeight, 1, 2 * threadCount);
+        if (_scratch.size() < static_cast<size_t>(bandCount))
+            _scratch.resize(static_cast<size_t>(bandCount));
+
+        auto const rasterize = [&](size_t first, size_t last) {
+            for (auto band = static_cast<int>(first); band < static_cast<int>(last); ++band)
+                rasterizeBand(top + (rows * band / bandCount),
+                              top + (rows * (band + 1) / bandCount),
+                              _scratch[static_cast<size_t>(band)]);
+        };
+        if (_threadPool && bandCount > 1)
+            _threadPool->parallel_for(0, static_cast<size_t>(bandCount), 1, rasterize);
+        else
+            rasterize(0, static_cast<size_t>(bandCount));
+
+        _framebufferValid = true;
+        _stats.rows += static_cast<uint64_t>(rows);
+        _stats.tiles += _tiles.size();
+        _stats.rectangles += _rectangles.size();
+        _stats.images += _images.size();
+    }
+    else
+        ++_stats.framesSkipped;
+
+    for (auto const& [callback, size]: _pendingScreenshots)
+        takeScreenshot(callback, size);
+    _pendingScreenshots.clear();
+
+    _rectangles.clear();
+    _tiles.clear();
+    _images.clear();
+    _damage.reset();
+}
+
+void SoftwareRenderTarget::rasterizeBand(int top, int bottom, Scratch& scratch)
+{
+    auto const stride = unbox<size_t>(_renderSize.width) * 4;
+    for (auto y = top; y < bottom; ++y)
+        fillPixels(_framebuffer.data() + (static_cast<size_t>(y) * stride), _clearColor, stride / 4);
+
+    for (auto const& rectangle: _rectangles)
+        drawRectangle(rectangle, top, bottom, scratch);
+    for (auto const& tile: _tiles)
+        drawTile(tile, top, bottom, scratch);
+    for (auto const& image: _images)
+        drawImage(image, top, bottom, scratch);
+}
+
+void SoftwareRenderTarget::drawRectangle(Rectangle const& rectangle, int top, int bottom, Scratch& scratch)
+{
+    auto const x0 = std::max(rectangle.x, 0);
+    auto const x1 = std::min(rectangle.x + rectangle.width, unbox<int>(_renderSize.width));
+    auto const y0 = std::max(rectangle.y, top);
+    auto const y1 = std::min(rectangle.y + rectangle.height, bottom);
+    if (x0 >= x1 || y0 >= y1 || rectangle.color[3] == 0)
+        return;
+
+    auto const count = static_cast<size_t>(x1 - x0);
+    auto const stride = unbox<size_t>(_renderSize.width) * 4;
+    auto* target = _framebuffer.data() + (static_cast<size_t>(y0) * stride) + (static_cast<size_t>(x0) * 4);
+    if (rectangle.color[3] == 255)
+    {
+        for (auto y = y0; y < y1; ++y, target += stride)
+            fillPixels(target, rectangle.color, count);
+        return;
+    }
+
+    scratch.source.resize(count * 4);
+    fillPixels(scratch.source.data(), rectangle.color, count);
+    for (auto y = y0; y < y1; ++y, target += stride)
+        blendPixels(target, scratch.source.data(), count);
+}
+
+void SoftwareRenderTarget::drawTile(atlas::RenderTile const& tile, int top, int bottom, Scratch& scratch)
+{
+    auto const size = tile.targetSize.area() ? tile.targetSize : tile.bitmapSize;
+    auto const width = unbox<int>(size.width);
+    auto const height = unbox<int>(size.height);
+    auto const x0 = std::max(tile.x.value, 0);
+    auto const x1 = std::min(tile.x.value + width, unbox<int>(_renderSize.width));
+    auto const y0 = std::max(tile.y.value, top);
+    auto const y1 = std::min(tile.y.value + height, bottom);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    auto const selector = tile.fragmentShaderSelector;
+    auto const& location = tile.normalizedLocation;
+    auto const color = std::array<uint8_t, 4> {
+        toByte(tile.color[0]), toByte(tile.color[1]), toByte(tile.color[2]), toByte(tile.color[3])
+    };
+    auto const atlasWidth = unbox<int>(_atlasSize.width);
+    auto const atlasHeight = unbox<int>(_atlasSize.height);
+    if (selector != FRAGMENT_SELECTOR_BOX_DRAWING && _atlas.empty())
+        return;
+
+    auto const count = static_cast<size_t>(x1 - x0);
+    auto const stride = unbox<size_t>(_renderSize.width) * 4;
+    scratch.source.resize(count * 4);
+    if (selector != FRAGMENT_SELECTOR_BOX_DRAWING)
+        mapColumns(scratch.columns, x0, x1, tile.x.value, width, location.x, location.width, atlasWidth);
+
+    // The derivative of the distance field per target pixel, in units of its texels.
+    auto const texelsPerPixel = location.width * static_cast<float>(atlasWidth) / static_cast<float>(width);
+    auto const texel = [&](int column, int row) {
+        return _atlas.data() + (static_cast<size_t>((row * atlasWidth) + column) * 4);
+    };
+
+    for (auto y = y0; y < y1; ++y)
+    {
+        auto* source = scratch.source.data();
+        auto const row = sourceIndex(y, tile.y.value, height, location.y, location.height, atlasHeight);
+
+        for (auto x = x0; x < x1; ++x, source += 4)
+        {
+            if (selector == FRAGMENT_SELECTOR_BOX_DRAWING)
+            {
+                auto const kind = static_cast<int>(location.x);
+                auto const parameters = static_cast<int>(location.y);
+                auto const thickness = static_cast<int>(location.width);
+                auto const px = x - tile.x.value;
+                auto const py = y - tile.y.value;
+                auto coverage = 0.0f;
+                if (kind == BOX_DRAWING_LINES)
+                    coverage = boxDrawingLines(px, height - 1 - py, width, height, parameters, thickness);
+                else if (kind == BOX_DRAWING_BLOCK)
+                    coverage = boxDrawingBlock(px, py, width, height, parameters);
+                else if (kind == BOX_DRAWING_TRIANGLE)
+                    coverage = boxDrawingTriangle(px, py, width, height, parameters);
+                source[0] = color[0];
+                source[1] = color[1];
+                source[2] = color[2];
+                source[3] = toByte(coverage * tile.color[3]);
+                continue;
+            }
+
+            auto const column = scratch.columns[static_cast<size_t>(x - x0)];
+            auto const* t = texel(column, row);
+            switch (selector)
+            {
+                case FRAGMENT_SELECTOR_IMAGE_BGRA: std::memcpy(source, t, 4); break;
+                case FRAGMENT_SELECTOR_GLYPH_LCD_SIMPLE:
+                    source[0] = mul255(t[0], color[0]);
+                    source[1] = mul255(t[1], color[1]);
+                    source[2] = mul255(t[2], color[2]);
+                    source[3] = static_cast<uint8_t>((t[0] + t[1] + t[2]) / 3);
+                    break;
+                case FRAGMENT_SELECTOR_GLYPH_LCD: {
+                    // Rougier's formula, as in the fragment shader, without subpixel shift.
+                    auto const r = static_cast<float>(t[0]) / 255.0f;
+                    auto const g = static_cast<float>(t[1]) / 255.0f;
+                    auto const b = static_cast<float>(t[2]) / 255.0f;
+                    auto const rgbMax = std::max({ r, g, b });
+                    auto const complement = 1.0f - rgbMax;
+                    source[0] = toByte((tile.color[0] * rgbMax) + (r * complement));
+                    source[1] = toByte((tile.color[1] * rgbMax) + (g * complement));
+                    source[2] = toByte((tile.color[2] * rgbMax) + (b * complement));
+                    auto const alpha = ((r + g + b) / 3.0f * rgbMax) + (std::min({ r, g, b }) * complement);
+                    source[3] = toByte(alpha * tile.color[3]);
+                    break;
+                }
+                case FRAGMENT_SELECTOR_GLYPH_SDF: {
+                    auto const distance = static_cast<float>(t[0]) / 255.0f - 0.5f;
+                    auto const right = texel(std::min(column + 1, atlasWidth - 1), row)[0];
+                    auto const below = texel(column, std::min(row + 1, atlasHeight - 1))[0];
+                    auto const fwidth = (std::abs(static_cast<float>(right - t[0]))
+                                         + std::abs(static_cast<float>(below - t[0])))
+                                        / 255.0f * texelsPerPixel;
+                    auto const coverage = std::clamp((distance / std::max(fwidth, 1e-5f)) + 0.5f, 0.0f, 1.0f);
+                    std::memcpy(source, color.data(), 3);
+                    source[3] = toByte(coverage * tile.color[3]);
+                    break;
+                }
+                case FRAGMENT_SELECTOR_GLYPH_ALPHA:
+                default:
+                    std::memcpy(source, color.data(), 3);
+                    source[3] = mul255(t[0], color[3]);
+                    break;
+            }
+        }
+
+        blendPixels(_framebuffer.data() + (static_cast<size_t>(y) * stride) + (static_cast<size_t>(x0) * 4),
+                    scratch.source.data(),
+                    count);
+    }
+}
+
+void SoftwareRenderTarget::drawImage(ImageCommand const& command, int top, int bottom, Scratch& scratch)
+{
+    auto const& image = *command.image;
+    auto const x0 = std::max(command.x, 0);
+    auto const x1 = std::min(command.x + command.width, unbox<int>(_renderSize.width));
+    auto const y0 = std::max(command.y, top);
+    auto const y1 = std::min(command.y + command.height, bottom);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    auto const imageWidth = unbox<int>(image.width());
+    auto const imageHeight = unbox<int>(image.height());
+    auto const channels = image.format() == vtbackend::ImageFormat::RGBA ? 4 : 3;
+    if (image.data().size() < static_cast<size_t>(imageWidth * imageHeight * channels))
+        return;
+
+    auto const count = static_cast<size_t>(x1 - x0);
+    auto const stride = unbox<size_t>(_renderSize.width) * 4;
+    auto const& source = command.source;
+    scratch.source.resize(count * 4);
+    mapColumns(scratch.columns, x0, x1, command.x, command.width, source.x, source.width, imageWidth);
+
+    for (auto y = y0; y < y1; ++y)
+    {
+        auto const row = sourceIndex(y, command.y, command.height, source.y, source.height, imageHeight);
+        auto const* pixels = image.data().data() + (static_cast<size_t>(row * imageWidth) * channels);
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto const* pixel = pixels + (static_cast<size_t>(scratch.columns[i]) * channels);
+            std::memcpy(scratch.source.data() + (i * 4), pixel, 3);
+            scratch.source[(i * 4) + 3] = channels == 4 ? pixel[3] : uint8_t { 255 };
+        }
+        blendPixels(_framebuffer.data() + (static_cast<size_t>(y) * stride) + (static_cast<size_t>(x0) * 4),
+                    scratch.source.data(),
+                    count);
+    }
+}
+
+void SoftwareRenderTarget::takeScreenshot(ScreenshotCallback const& callback, ImageSize size) const
+{
+    auto const sourceWidth = unbox<size_t>(_renderSize.width);
+    auto const sourceHeight = unbox<size_t>(_renderSize.height);
+    if (!size.area())
+        size = _renderSize;
+    auto const width = unbox<size_t>(size.width);
+    auto const height = unbox<size_t>(size.height);
+
+    // Rows from bottom to top, just as read back from OpenGL, scaled to the requested size if need be.
+    auto buffer = std::vector<uint8_t>(size.area() * 4);
+    if (_renderSize.area())
+    {
+        for (size_t y = 0; y < height; ++y)
+        {
+            auto const sourceRow = sourceHeight - 1 - (y * sourceHeight / height);
+            auto const* sourcePixels = _framebuffer.data() + (sourceRow * sourceWidth * 4);
+            for (size_t x = 0; x < width; ++x)
+                std::memcpy(
+                    buffer.data() + (((y * width) + x) * 4), sourcePixels + (x * sourceWidth / width * 4), 4);
+        }
+    }
+    callback(buffer, size);
+}
+
+void SoftwareRenderTarget::clearCache()
+{
+    _framebufferValid = false;
+}
+
+std::optional<AtlasTextureScreenshot> SoftwareRenderTarget::readAtlas()
+{
+    return AtlasTextureScreenshot {
+        .atlasInstanceId = _atlasInstanceId,
+        .size = _atlasSize,
+        .format = atlas::Format::RGBA,
+        .buffer = _atlas,
+    };
+}
+
+void SoftwareRenderTarget::inspect(std::ostream& output) const
+{
+    output << "SoftwareRenderTarget:\n";
+    output << fmt::format("  render size    : {}x{}\n", _renderSize.width, _renderSize.height);
+    output << fmt::format("  atlas size     : {}x{}\n", _atlasSize.width, _atlasSize.height);
+    output << fmt::format("  threads        : {}\n", _threadPool ? _threadPool->threadCount() + 1 : 1);
+    output << fmt::format("  frames         : {} ({} without damage)\n", _stats.frames, _stats.framesSkipped);
+    output << fmt::format("  rows redrawn   : {}\n", _stats.rows);
+    output << fmt::format("  tiles rendered : {}\n", _stats.tiles);
+    output << fmt::format("  rectangles     : {}\n", _stats.rectangles);
+    output << fmt::format("  images         : {}\n", _stats.images);
+}
+
+void SoftwareRenderTarget::configureAtlas(atlas::ConfigureAtlas atlas)
+{
+    _atlasSize = atlas.size;
+    _atlas.assign(atlas.size.area() * 4, 0);
+    ++_atlasInstanceId;
+}
+
+void SoftwareRenderTarget::uploadTile(atlas::UploadTile tile)
+{
+    // Stored as RGBA, just as sampled from the OpenGL texture, i.e. missing channels as zero and opaque.
+    auto const channels = atlas::element_count(tile.bitmapFormat);
+    auto const alignment = static_cast<size_t>(std::max(tile.rowAlignment, 1));
+    auto const bitmapWidth = unbox<size_t>(tile.bitmapSize.width);
+    auto const bitmapRowSize = (((bitmapWidth * channels) + alignment - 1) / alignment) * alignment;
+    auto const atlasWidth = unbox<size_t>(_atlasSize.width);
+    auto const atlasHeight = unbox<size_t>(_atlasSize.height);
+    auto const x0 = static_cast<size_t>(tile.location.x.value);
+    auto const y0 = static_cast<size_t>(tile.location.y.value);
+    auto const width = std::min(bitmapWidth, atlasWidth - std::min(x0, atlasWidth));
+    auto const height =
+        std::min(unbox<size_t>(tile.bitmapSize.height), atlasHeight - std::min(y0, atlasHeight));
+
+    for (size_t y = 0; y < height; ++y)
+    {
+        if (((y * bitmapRowSize) + (width * channels)) > tile.bitmap.size())
+            break;
+        auto const* source = tile.bitmap.data() + (y * bitmapRowSize);
+        auto* target = _atlas.data() + ((((y0 + y) * atlasWidth) + x0) * 4);
+        for (size_t x = 0; x < width; ++x, source += channels, target += 4)
+        {
+            target[0] = source[0];
+            target[1] = channels >= 3 ? source[1] : uint8_t { 0 };
+            target[2] = channels >= 3 ? source[2] : uint8_t { 0 };
+            target[3] = channels == 4 ? source[3] : uint8_t { 255 };
+        }
+    }
+}
+
+void SoftwareRenderTarget::renderTile(atlas::RenderTile tile)
+{
+    _tiles.emplace_back(tile);
+}
+
+} // namespace vtrasterizer
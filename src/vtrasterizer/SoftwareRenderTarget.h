@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+#include <vtbackend/Image.h>
+#include <vtbackend/primitives.h>
+
+#include <vtrasterizer/RenderTarget.h>
+#include <vtrasterizer/TextureAtlas.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <vector>
+
+namespace crispy
+{
+class thread_pool;
+}
+
+namespace vtrasterizer
+{
+
+/**
+ * Render target rasterizing on the CPU into a framebuffer in memory, for hosts without a (usable) GPU.
+ *
+ * The render commands of a frame are recorded, and composited by execute(), just like the OpenGL
+ * render target does: rectangles first, then the atlas tiles, then the images, each blended
+ * by its alpha onto what is below.
+ *
+ * The framebuffer is retained across frames, such that only the damaged area is redrawn (see setDamage()).
+ * That area is split into bands of pixel rows, which are rasterized concurrently on the thread pool given.
+ */
+class SoftwareRenderTarget final: public RenderTarget, public atlas::AtlasBackend
+{
+  public:
+    struct Stats
+    {
+        uint64_t frames = 0;        // executed
+        uint64_t framesSkipped = 0; // executed while nothing was damaged
+        uint64_t rows = 0;          // of pixels redrawn
+        uint64_t tiles = 0;         // rendered from the atlas
+        uint64_t rectangles = 0;
+        uint64_t images = 0;
+    };
+
+    /// @param threadPool pool to rasterize the bands of each frame on, or none to rasterize all of them
+    ///                   on the thread invoking execute().
+    explicit SoftwareRenderTarget(crispy::thread_pool* threadPool = nullptr);
+
+    /// Sets the color the damaged area is cleared to before drawing, transparent black by default.
+    void setClearColor(RGBAColor color) noexcept;
+
+    [[nodiscard]] ImageSize renderSize() const noexcept { return _renderSize; }
+
+    /// @returns the pixels of the frame executed last, rows from top to bottom, 4 bytes per pixel
+    ///          in the order red, green, blue, and alpha (i.e. QImage::Format_RGBA8888).
+    [[nodiscard]] std::span<uint8_t const> framebuffer() const noexcept { return _framebuffer; }
+
+    [[nodiscard]] Stats const& stats() const noexcept { return _stats; }
+
+    // RenderTarget
+    void setRenderSize(ImageSize size) override;
+    void setMargin(PageMargin /*margin*/) override {} // as render commands include the margin already
+    atlas::AtlasBackend& textureScheduler() override { return *this; }
+    void renderRectangle(int x, int y, Width width, Height height, RGBAColor color) override;
+    void renderImage(std::shared_ptr<vtbackend::Image const> image,
+                     int x,
+                     int y,
+                     Width width,
+                     Height height,
+                     atlas::NormalizedTileLocation source) override;
+    void discardImage(vtbackend::ImageId imageId) override;
+    void setDamage(std::optional<DamagedArea> damage) override { _damage = damage; }
+    void scheduleScreenshot(ScreenshotCallback callback, ImageSize size) override;
+    void execute(std::chrono::steady_clock::time_point now) override;
+    void clearCache() override;
+    std::optional<AtlasTextureScreenshot> readAtlas() override;
+    void inspect(std::ostream& output) const override;
+
+    // AtlasBackend
+    [[nodiscard]] ImageSize atlasSize() const noexcept override { return _atlasSize; }
+    void configureAtlas(atlas::ConfigureAtlas atlas) override;
+    void uploadTile(atlas::UploadTile tile) override;
+    void renderTile(atlas::RenderTile tile) override;
+
+  private:
+    struct Rectangle
+    {
+        int x;
+        int y;
+        int width;
+        int height;
+        std::array<uint8_t, 4> color; // RGBA
+    };
+
+    struct ImageCommand
+    {
+        std::shared_ptr<vtbackend::Image const> image;
+        int x;
+        int y;
+        int width;
+        int height;
+        atlas::NormalizedTileLocation source;
+    };
+
+    // Per band of pixel rows, reused across frames, such that rasterizing does not allocate once warmed up.
+    struct Scratch
+    {
+        std::vector<uint8_t> source; // the RGBA pixels of a row to be blended onto the framebuffer
+        std::vector<int> columns;    // the source column of each target column
+    };
+
+    void rasterizeBand(int top, int bottom, Scratch& scratch);
+    void drawRectangle(Rectangle const& rectangle, int top, int bottom, Scratch& scratch);
+    void drawTile(atlas::RenderTile const& tile, int top, int bottom, Scratch& scratch);
+    void drawImage(ImageCommand const& command, int top, int bottom, Scratch& scratch);
+    void takeScreenshot(ScreenshotCallback const& callback, ImageSize size) const;
+
+    crispy::thread_pool* _threadPool;
+    ImageSize _renderSize {};
+    std::array<uint8_t, 4> _clearColor {};
+    std::vector<uint8_t> _framebuffer;
+    bool _framebufferValid = false; // holds the previous frame, such that only damaged areas are redrawn
+    std::optional<DamagedArea> _damage;
+
+    ImageSize _atlasSize {};
+    std::vector<uint8_t> _atlas; // RGBA
+    int _atlasInstanceId = 0;
+
+    // Render commands of the next frame.
+    std::vector<Rectangle> _rectangles;
+    std::vector<atlas::RenderTile> _tiles;
+    std::vector<ImageCommand> _images;
+
+    std::vector<std::pair<ScreenshotCallback, ImageSize>> _pendingScreenshots;
+    std::vector<Scratch> _scratch;
+    Stats _stats;
+};
+
+} // namespace vtrasterizer
@@ -139,6 +139,7 @@ Making use of reserved glyph slots
 #include <crispy/indexed.h>
 #include <crispy/range.h>
 
+#include <libunicode/codepoint_properties.h>
 #include <libunicode/convert.h>
 #include <libunicode/utf8_grapheme_segmenter.h>
 
@@ -151,6 +152,7 @@ Making use of reserved glyph slots
 
 using crispy::point;
 using crispy::strong_hash;
+using crispy::strong_hash_stream;
 
 using unicode::out;
 
@@ -183,22 +185,75 @@ namespace
     constexpr auto LastReservedChar = char32_t { 0x7E };
     constexpr auto DirectMappedCharsCount = LastReservedChar - FirstReservedChar + 1;
 
+    constexpr std::array<TextStyle, 4> DirectMappedStyles = {
+        TextStyle::Regular, TextStyle::Bold, TextStyle::Italic, TextStyle::BoldItalic
+    };
+
+    // Styles in which the configured codepoints are pre-warmed, as the most frequently used ones.
+    constexpr std::array<TextStyle, 2> PrewarmedStyles = { TextStyle::Regular, TextStyle::Bold };
+
+    // Number of codepoints shaped and rasterized by a single pre-warming job.
+    constexpr auto PrewarmBatchSize = char32_t { 32 };
+
+    // Returns the class of text that text cluster groups are split between, such that each word and each
+    // run of punctuation is shaped, and cached, independent of its neighbors, e.g. within paths and URLs.
+    //
+    // Programming ligatures (such as "->", "!=", or "...") consist of punctuation only, and are thus never
+    // split. Words are split by their script as well, as the text shaper would split them anyway.
+    uint32_t segmentClassOf(char32_t codepoint) noexcept
+    {
+        constexpr auto Punctuation = uint32_t { 0 };
+        constexpr auto Word = uint32_t { 1 }; // plus the script
+
+        if (codepoint < 0x80)
+        {
+            auto const isWord = (codepoint >= 'a' && codepoint <= 'z')
+                                || (codepoint >= 'A' && codepoint <= 'Z')
+                                || (codepoint >= '0' && codepoint <= '9') || codepoint == '_';
+            return isWord ? Word + static_cast<uint32_t>(unicode::Script::Latin) : Punctuation;
+        }
+
+        auto const script = unicode::codepoint_properties::get(codepoint).script;
+        if (script == unicode::Script::Common || script == unicode::Script::Inherited)
+            return Punctuation;
+        return Word + static_cast<uint32_t>(script);
+    }
+
+    /// Returns the index of the given style's range of direct-mapped tiles.
+    constexpr std::optional<size_t> directMappedStyleIndex(TextStyle style) noexcept
+    {
+        switch (style)
+        {
+            case TextStyle::Invalid: break;
+            case TextStyle::Regular: return 0;
+            case TextStyle::Bold: return 1;
+            case TextStyle::Italic: return 2;
+            case TextStyle::BoldItalic: return 3;
+        }
+        return std::nullopt;
+    }
+
     strong_hash hashGlyphKeyAndPresentation(text::glyph_key const& glyphKey,
                                             unicode::PresentationStyle presentation) noexcept
     {
-        // return StrongHash::compute(key) * static_cast<uint32_t>(presentation);
-        // clang-format off
-        return strong_hash::compute(glyphKey.font.value)
-               * static_cast<uint32_t>(glyphKey.index.value)
-               * strong_hash::compute(glyphKey.size.pt)
-               * static_cast<uint32_t>(presentation)
-               ;
-        // clang-format on
+        return strong_hash_stream {}
+            .update(glyphKey.font.value)
+            .update(static_cast<uint32_t>(glyphKey.index.value))
+            .update(glyphKey.size.pt)
+            .update(static_cast<uint32_t>(presentation))
+            .finish();
+    }
+
+    strong_hash hashFontKeys(FontKeys const& fonts) noexcept
+    {
+        auto const styledFonts =
+            strong_hash { fonts.regular.value, fonts.bold.value, fonts.italic.value, fonts.boldItalic.value };
+        return styledFonts * static_cast<uint32_t>(fonts.emoji.value);
     }
 
     strong_hash hashTextAndStyle(u32string_view text, TextStyle style) noexcept
     {
-        return strong_hash::compute(text) * static_cast<uint32_t>(style);
+        return strong_hash_stream {}.update(text).update(static_cast<uint32_t>(style)).finish();
     }
 
     text::font_key getFontForStyle(FontKeys const& fonts, TextStyle style)
@@ -219,6 +274,7 @@ namespace
         switch (format)
         {
             case text::bitmap_format::alpha_mask: return atlas::Format::Red;
+            case text::bitmap_format::distance_field: return atlas::Format::Red;
             case text::bitmap_format::rgb: return atlas::Format::RGB;
             case text::bitmap_format::rgba: return atlas::Format::RGBA;
         }
@@ -234,6 +290,7 @@ namespace
         switch (glyphFormat)
         {
             case text::bitmap_format::alpha_mask: return FRAGMENT_SELECTOR_GLYPH_ALPHA;
+            case text::bitmap_format::distance_field: return FRAGMENT_SELECTOR_GLYPH_SDF;
             case text::bitmap_format::rgb: return lcdShaderId;
             case text::bitmap_format::rgba: return FRAGMENT_SELECTOR_IMAGE_BGRA;
         }
@@ -296,8 +353,13 @@ text::font_locator& createFontLocator(FontLocatorEngine engine)
 // or even computed based on memory resources available?
 constexpr uint32_t TextShapingCacheSize = 4000;
 
+// Number of text shaping caches retained for previously used fonts, such as other font sizes,
+// and the memory they may occupy in total.
+constexpr size_t RetainedShapingCacheCount = 4;
+constexpr size_t RetainedShapingCacheMemory = 32 * 1024 * 1024;
+
 TextRenderer::TextRenderer(GridMetrics const& gridMetrics,
-                           text::shaper& textShaper,
+                           RenderResources& resources,
                            FontDescriptions& fontDescriptions,
                            FontKeys const& fontKeys,
                            TextRendererEvents& eventHandler):
@@ -305,17 +367,36 @@ TextRenderer::TextRenderer(GridMetrics const& gridMetrics,
     _textRendererEvents { eventHandler },
     _fontDescriptions { fontDescriptions },
     _fonts { fontKeys },
-    _textShapingCache { ShapingResultCache::create(crispy::strong_hashtable_size { 16384 },
-                                                   crispy::lru_capacity { TextShapingCacheSize },
-                                                   "Text shaping cache") },
-    _textShaper { textShaper },
+    _textShapingCache { createTextShapingCache() },
+    _resources { &resources },
     _boxDrawingRenderer { gridMetrics }
 {
 }
 
+auto TextRenderer::createTextShapingCache() -> ShapingResultCachePtr
+{
+    return ShapingResultCache::create(crispy::strong_hashtable_size { 16384 },
+                                      crispy::lru_capacity { TextShapingCacheSize },
+                                      "Text shaping cache");
+}
+
 void TextRenderer::inspect(ostream& textOutput) const
 {
     textOutput << "TextRenderer:\n";
+    textOutput << fmt::format("direct mapped glyph tiles: {} ({} styles)\n",
+                              _directMapping.count,
+                              _directMapping ? DirectMappedStyleCount : 0);
+    textOutput << fmt::format("asynchronous glyphs: {}\n", _asyncGlyphs ? "enabled" : "disabled");
+    textOutput << fmt::format("pre-warmed codepoint ranges: {}\n", _prewarmedCodepoints.size());
+    textOutput << fmt::format("retained text shaping caches: {}\n", _retainedShapingCaches.size());
+    textOutput << fmt::format(
+        "text shaping: {} lookups, {} misses, {:.1f}% hit rate ({} runs split at word boundaries)\n",
+        _shapingStats.lookups,
+        _shapingStats.misses,
+        _shapingStats.lookups ? 100.0 * static_cast<double>(_shapingStats.lookups - _shapingStats.misses)
+                                    / static_cast<double>(_shapingStats.lookups)
+                              : 0.0,
+        _shapingStats.segments);
     _textShapingCache->inspect(textOutput);
     _boxDrawingRenderer.inspect(textOutput);
 }
@@ -323,7 +404,7 @@ void TextRenderer::inspect(ostream& textOutput) const
 void TextRenderer::setRenderTarget(
     RenderTarget& renderTarget, atlas::DirectMappingAllocator<RenderTileAttributes>& directMappingAllocator)
 {
-    _directMapping = directMappingAllocator.allocate(DirectMappedCharsCount);
+    _directMapping = directMappingAllocator.allocate(DirectMappedStyleCount * DirectMappedCharsCount);
     Renderable::setRenderTarget(renderTarget, directMappingAllocator);
     _boxDrawingRenderer.setRenderTarget(renderTarget, directMappingAllocator);
     clearCache();
@@ -336,16 +417,252 @@ void TextRenderer::setTextureAtlas(TextureAtlas& atlas)
 
     if (_directMapping)
         initializeDirectMapping();
+
+    schedulePrewarming();
+}
+
+void TextRenderer::setTextureScheduler(atlas::AtlasBackend& scheduler)
+{
+    Renderable::setTextureScheduler(scheduler);
+    _boxDrawingRenderer.setTextureScheduler(scheduler);
+}
+
+void TextRenderer::setAsyncGlyphs(bool enabled, std::function<void()> glyphsReady)
+{
+    if (enabled == _asyncGlyphs)
+        return;
+
+    _asyncGlyphs = enabled;
+    _glyphsReady = std::move(glyphsReady);
+    updateGlyphWorker();
+}
+
+void TextRenderer::setPrewarmedCodepoints(vector<CodepointRange> ranges)
+{
+    if (ranges == _prewarmedCodepoints)
+        return;
+
+    _prewarmedCodepoints = std::move(ranges);
+    updateGlyphWorker();
+}
+
+void TextRenderer::setRenderResources(RenderResources& resources)
+{
+    if (_resources.get() == &resources)
+        return;
+
+    // The worker must be gone before switching, as its jobs use the shaper of the current resources.
+    _glyphWorker.reset();
+    _resources = &resources;
+    updateGlyphWorker();
+}
+
+void TextRenderer::updateGlyphWorker()
+{
+    _glyphWorker.reset();
+    _unrasterizableGlyphs.clear();
+
+    if (_asyncGlyphs || !_prewarmedCodepoints.empty())
+        _glyphWorker = std::make_unique<GlyphWorker>(_resources->shaperMutex(), _glyphsReady);
+
+    schedulePrewarming();
+}
+
+void TextRenderer::schedulePrewarming()
+{
+    if (!_glyphWorker || !_textureAtlas)
+        return;
+
+    auto const renderMode = _fontDescriptions.renderMode;
+    auto const builtinBoxDrawing = _fontDescriptions.builtinBoxDrawing;
+
+    for (CodepointRange const& range: _prewarmedCodepoints)
+    {
+        for (auto first = range.first; first <= range.last; first += PrewarmBatchSize)
+        {
+            auto const last = static_cast<char32_t>(first + PrewarmBatchSize - 1);
+            auto const batch = CodepointRange { first, min(range.last, last) };
+            auto job = [this, batch, renderMode, builtinBoxDrawing]() -> GlyphWorker::Completion {
+                return [this, prewarmed = prewarmCodepoints(batch, renderMode, builtinBoxDrawing)]() {
+                    insertPrewarmedGlyphs(prewarmed);
+                };
+            };
+            auto const hash = strong_hash { 0x70, 0x77, batch.first, batch.last };
+            _glyphWorker->post(hash, std::move(job), GlyphWorker::Priority::Low);
+        }
+    }
+}
+
+auto TextRenderer::prewarmCodepoints(CodepointRange range,
+                                     text::render_mode renderMode,
+                                     bool builtinBoxDrawing) -> PrewarmedGlyphs
+{
+    auto prewarmed = PrewarmedGlyphs {};
+
+    for (auto codepoint = range.first; codepoint <= range.last; ++codepoint)
+    {
+        if (builtinBoxDrawing && BoxDrawingRenderer::renderable(codepoint))
+        {
+            prewarmed.boxDrawingCodepoints.push_back(codepoint);
+            continue;
+        }
+
+        // Shaped exactly like a cluster group of a single codepoint, so that both caches get hit.
+        auto const text = u32string_view(&codepoint, 1);
+        auto cluster = 0u;
+        for (auto const style: PrewarmedStyles)
+        {
+            auto glyphPositions = createTextShapedGlyphPositions(text, gsl::span(&cluster, 1), style);
+            for (text::glyph_position const& glyphPosition: glyphPositions)
+            {
+                if (!glyphPosition.glyph.index.value) // missing glyph
+                    continue;
+                if (auto glyph = textShaper().rasterize(glyphPosition.glyph, renderMode))
+                    prewarmed.glyphs.emplace_back(PrewarmedGlyph { style, glyphPosition, std::move(*glyph) });
+            }
+            prewarmed.glyphPositions.emplace_back(hashTextAndStyle(text, style), std::move(glyphPositions));
+        }
+    }
+
+    return prewarmed;
+}
+
+void TextRenderer::insertPrewarmedGlyphs(PrewarmedGlyphs const& prewarmed)
+{
+    // Pre-warming must not evict what has actually been rendered, so it never fills more than half a cache.
+    for (auto const& [hash, glyphPositions]: prewarmed.glyphPositions)
+    {
+        if (_textShapingCache->size() >= TextShapingCacheSize / 2)
+            break;
+        (void) _textShapingCache->try_emplace(hash, [&](auto) { return glyphPositions; });
+    }
+
+    auto const atlasFull = [this]() { return textureAtlas().size() >= textureAtlas().capacity() / 2; };
+
+    for (PrewarmedGlyph const& glyph: prewarmed.glyphs)
+    {
+        if (auto const tileIndex = directMappedTileIndex(glyph.position.glyph, glyph.style))
+        {
+            if (!_textureAtlas->directMapped(tileIndex).bitmapSize.width.value)
+                (void) setDirectMappedGlyph(tileIndex, glyph.position.glyph, glyph.bitmap);
+            continue;
+        }
+
+        if (atlasFull())
+            break;
+
+        auto const presentation = glyph.position.presentation;
+        insertRasterizedGlyph(hashGlyphKeyAndPresentation(glyph.position.glyph, presentation),
+                              glyph.position.glyph,
+                              presentation,
+                              glyph.bitmap);
+    }
+
+    for (auto const codepoint: prewarmed.boxDrawingCodepoints)
+    {
+        if (atlasFull())
+            break;
+        _boxDrawingRenderer.prewarm(codepoint);
+    }
+}
+
+bool TextRenderer::applyAsyncGlyphs()
+{
+    return _glyphWorker && _glyphWorker->applyCompleted() != 0;
+}
+
+void TextRenderer::cancelAsyncGlyphs()
+{
+    if (_glyphWorker)
+        _glyphWorker->cancel();
 }
 
 void TextRenderer::clearCache()
 {
+    cancelAsyncGlyphs();
+    _unrasterizableGlyphs.clear();
+
     if (_textureAtlas && _directMapping)
         initializeDirectMapping();
 
     _textShapingCache->clear();
 
     _boxDrawingRenderer.clearCache();
+
+    schedulePrewarming();
+}
+
+void TextRenderer::retainTextShapingCache()
+{
+    if (!_textShapingCache->size())
+        return;
+
+    auto const fonts = hashFontKeys(_fonts);
+    auto const entryCount = _textShapingCache->size();
+    auto memoryUsage = _textShapingCache->storageSize();
+    for (strong_hash const& hash: _textShapingCache->hashes())
+        memoryUsage += _textShapingCache->peek(hash).capacity() * sizeof(text::glyph_position);
+
+    std::erase_if(_retainedShapingCaches, [&](auto const& retained) {
+        return retained.resources == _resources.get() && retained.fonts == fonts;
+    });
+    _retainedShapingCaches.insert(
+        _retainedShapingCaches.begin(),
+        RetainedShapingCache { _resources.get(), fonts, std::move(_textShapingCache), memoryUsage });
+    _textShapingCache = createTextShapingCache();
+
+    // Evict the least recently used caches beyond the count or memory limit.
+    auto totalMemoryUsage = size_t { 0 };
+    for (auto i = _retainedShapingCaches.begin(); i != _retainedShapingCaches.end(); ++i)
+    {
+        totalMemoryUsage += i->memoryUsage;
+        auto const count = static_cast<size_t>(std::distance(_retainedShapingCaches.begin(), i)) + 1;
+        if (count > RetainedShapingCacheCount || totalMemoryUsage > RetainedShapingCacheMemory)
+        {
+            _retainedShapingCaches.erase(i, _retainedShapingCaches.end());
+            break;
+        }
+    }
+
+    rasterizerLog()("Retaining text shaping cache of {} entries ({} KiB), {} caches retained.",
+                    entryCount,
+                    memoryUsage / 1024,
+                    _retainedShapingCaches.size());
+}
+
+void TextRenderer::restoreTextShapingCache()
+{
+    auto const fonts = hashFontKeys(_fonts);
+    auto const i = std::find_if(
+        _retainedShapingCaches.begin(), _retainedShapingCaches.end(), [&](auto const& retained) {
+            return retained.resources == _resources.get() && retained.fonts == fonts;
+        });
+    if (i == _retainedShapingCaches.end())
+        return;
+
+    rasterizerLog()("Restoring retained text shaping cache of {} entries.", i->cache->size());
+    _textShapingCache = std::move(i->cache);
+    _retainedShapingCaches.erase(i);
+}
+
+void TextRenderer::discardRetainedTextShapingCaches()
+{
+    _retainedShapingCaches.clear();
+}
+
+void TextRenderer::discardRetainedTextShapingCaches(RenderResources const& resources)
+{
+    std::erase_if(_retainedShapingCaches,
+                  [&](auto const& retained) { return retained.resources == &resources; });
+}
+
+size_t TextRenderer::trimCaches()
+{
+    auto trimmed = size_t { 0 };
+    for (auto const& retained: _retainedShapingCaches)
+        trimmed += retained.cache->size();
+    discardRetainedTextShapingCaches();
+    return trimmed + _textShapingCache->trim();
 }
 
 void TextRenderer::restrictToTileSize(TextureAtlas::TileCreateData& tileCreateData)
@@ -395,40 +712,90 @@ void TextRenderer::restrictToTileSize(TextureAtlas::TileCreateData& tileCreateDa
 void TextRenderer::initializeDirectMapping()
 {
     Require(_textureAtlas);
-    Require(_directMapping.count == DirectMappedCharsCount);
+    Require(_directMapping.count == DirectMappedStyleCount * DirectMappedCharsCount);
+    static_assert(DirectMappedStyles.size() == DirectMappedStyleCount);
+
+    // The printable ASCII range of every text style is permanently reserved in the atlas,
+    // so that rendering ordinary text never has to go through the LRU hashtable.
+    // Each style's glyphs are only mapped once that style is used though,
+    // so that its font does not need to be loaded before.
+    for (auto& glyphKeyToTileIndex: _directMappedGlyphKeyToTileIndex)
+        glyphKeyToTileIndex.clear();
+    _directMappedStyles.fill(false);
+}
+
+void TextRenderer::mapDirectMappedGlyphs(TextStyle style)
+{
+    auto const styleIndex = directMappedStyleIndex(style).value();
+    auto const font = getFontForStyle(_fonts, style);
+    auto& glyphKeyToTileIndex = _directMappedGlyphKeyToTileIndex[styleIndex];
 
-    _directMappedGlyphKeyToTileIndex.clear();
-    _directMappedGlyphKeyToTileIndex.resize(LastReservedChar + 1);
+    glyphKeyToTileIndex.clear();
+    glyphKeyToTileIndex.resize(LastReservedChar + 1);
+    _directMappedStyles[styleIndex] = true;
 
+    auto const _ = lockShaper();
     for (char32_t codepoint = FirstReservedChar; codepoint <= LastReservedChar; ++codepoint)
     {
-        if (optional<text::glyph_position> gposOpt = _textShaper.shape(_fonts.regular, codepoint))
+        if (optional<text::glyph_position> gposOpt = textShaper().shape(font, codepoint))
         {
             text::glyph_key const& glyph = gposOpt.value().glyph;
-            if (glyph.index.value >= _directMappedGlyphKeyToTileIndex.size())
-                _directMappedGlyphKeyToTileIndex.resize(glyph.index.value
-                                                        + (LastReservedChar - codepoint + 1));
-            _directMappedGlyphKeyToTileIndex[glyph.index.value] =
-                _directMapping.toTileIndex(codepoint - FirstReservedChar);
+            if (glyph.index.value >= glyphKeyToTileIndex.size())
+                glyphKeyToTileIndex.resize(glyph.index.value + (LastReservedChar - codepoint + 1));
+            auto const slot = styleIndex * DirectMappedCharsCount + (codepoint - FirstReservedChar);
+            glyphKeyToTileIndex[glyph.index.value] = _directMapping.toTileIndex(static_cast<uint32_t>(slot));
         }
     }
 }
 
+uint32_t TextRenderer::directMappedTileIndex(text::glyph_key const& glyph, TextStyle style)
+{
+    if (!_directMapping) // Is direct mapping enabled?
+        return 0;
+
+    auto const styleIndex = directMappedStyleIndex(style);
+    if (!styleIndex || !(glyph.font == getFontForStyle(_fonts, style))) // e.g. a fallback font's glyph
+        return 0;
+
+    if (!_directMappedStyles[*styleIndex])
+        mapDirectMappedGlyphs(style);
+
+    auto const& glyphKeyToTileIndex = _directMappedGlyphKeyToTileIndex[*styleIndex];
+    if (glyph.index.value >= glyphKeyToTileIndex.size())
+        return 0;
+
+    return glyphKeyToTileIndex[glyph.index.value];
+}
+
 Renderable::AtlasTileAttributes const* TextRenderer::ensureRasterizedIfDirectMapped(
-    text::glyph_key const& glyph)
+    text::glyph_key const& glyph, TextStyle style)
 {
-    if (!isGlyphDirectMapped(glyph))
+    auto const tileIndex = directMappedTileIndex(glyph, style);
+    if (!tileIndex)
         return nullptr;
 
-    auto const tileIndex = _directMappedGlyphKeyToTileIndex[glyph.index.value];
-
     if (_textureAtlas->directMapped(tileIndex).bitmapSize.width.value)
         // TODO: Find a better way to test if the glyph was rasterized&uploaded already.
         // like: if (_textureAtlas->isDirectMappingSet(tileIndex)) ...
         return &_textureAtlas->directMapped(tileIndex);
 
+    auto rasterizedGlyph = [&]() {
+        auto const _ = lockShaper();
+        return textShaper().rasterize(glyph, _fontDescriptions.renderMode);
+    }();
+    if (!rasterizedGlyph)
+        return nullptr;
+
+    return setDirectMappedGlyph(tileIndex, glyph, std::move(*rasterizedGlyph));
+}
+
+Renderable::AtlasTileAttributes const* TextRenderer::setDirectMappedGlyph(uint32_t tileIndex,
+                                                                          text::glyph_key const& glyph,
+                                                                          text::rasterized_glyph bitmap)
+{
     auto const tileLocation = _textureAtlas->tileLocation(tileIndex);
-    auto tileCreateData = createRasterizedGlyph(tileLocation, glyph, unicode::PresentationStyle::Text);
+    auto tileCreateData =
+        createRasterizedGlyph(tileLocation, glyph, unicode::PresentationStyle::Text, std::move(bitmap));
     if (!tileCreateData)
         return nullptr;
 
@@ -497,13 +864,13 @@ void TextRenderer::renderLine(vtbackend::RenderLine const& renderLine)
         flushTextClusterGroup();
 }
 
-void TextRenderer::renderCell(vtbackend::RenderCell const& cell)
+void TextRenderer::renderCell(vtbackend::RenderCell const& cell, std::u32string_view codepoints)
 {
     if (cell.groupStart)
         _updateInitialPenPosition = true;
 
     renderCell(cell.position,
-               cell.codepoints,
+               codepoints,
                makeTextStyle(cell.attributes.flags),
                cell.attributes.foregroundColor);
 
@@ -527,8 +894,11 @@ void TextRenderer::renderCell(vtbackend::CellLocation position,
 
     if (isBoxDrawingCharacter)
     {
-        auto const success =
-            _boxDrawingRenderer.render(position.line, position.column, graphemeCluster[0], foregroundColor);
+        auto const success = [&]() {
+            auto const _ = RenderStatsScope(_stats, &RenderStats::boxDrawing);
+            return _boxDrawingRenderer.render(
+                position.line, position.column, graphemeCluster[0], foregroundColor);
+        }();
         if (success)
         {
             if (!_updateInitialPenPosition)
@@ -616,15 +986,23 @@ void TextRenderer::appendCellTextToClusterGroup(u32string_view codepoints,
     bool const hasText = !codepoints.empty() && codepoints[0] != 0x20;
     bool const noText = !hasText;
     bool const textStartFound = !_textStartFound && hasText;
+    auto const segmentClass = hasText ? segmentClassOf(codepoints[0]) : 0;
+    bool const segmentChanged = _textStartFound && hasText && segmentClass != _textClusterGroup.segmentClass;
     if (noText)
         _textStartFound = false;
-    if (attribsChanged || textStartFound || noText)
+    if (attribsChanged || textStartFound || noText || segmentChanged)
     {
         if (_textClusterGroup.cellCount)
+        {
+            if (segmentChanged && !attribsChanged)
+                ++_shapingStats.segments;
             flushTextClusterGroup(); // also increments text start position
+        }
         _textClusterGroup.color = color;
         _textClusterGroup.style = style;
-        _textStartFound = textStartFound;
+        _textClusterGroup.segmentClass = segmentClass;
+        // Text continuing with other attributes or of another class starts the next group right away.
+        _textStartFound = hasText;
     }
 
     for (char32_t const codepoint: codepoints)
@@ -655,7 +1033,8 @@ void TextRenderer::flushTextClusterGroup()
 
         for (text::glyph_position const& glyphPosition: glyphPositions)
         {
-            if (AtlasTileAttributes const* attributes = ensureRasterizedIfDirectMapped(glyphPosition.glyph))
+            if (AtlasTileAttributes const* attributes =
+                    ensureRasterizedIfDirectMapped(glyphPosition.glyph, _textClusterGroup.style))
             {
                 auto const pen1 = applyGlyphPositionToPen(pen, *attributes, glyphPosition);
                 renderRasterizedGlyph(pen1, _textClusterGroup.color, *attributes);
@@ -703,13 +1082,68 @@ void TextRenderer::flushTextClusterGroup()
 Renderable::AtlasTileAttributes const* TextRenderer::getOrCreateRasterizedMetadata(
     strong_hash const& hash, text::glyph_key const& glyphKey, unicode::PresentationStyle presentationStyle)
 {
+    if (_asyncGlyphs)
+        return getOrRequestRasterizedMetadata(hash, glyphKey, presentationStyle);
+
     // clang-format off
     return textureAtlas().get_or_try_emplace(
         hash,
         [&](atlas::TileLocation tileLocation)
         -> optional<TextureAtlas::TileCreateData>
         {
-            return createSlicedRasterizedGlyph(tileLocation, glyphKey, presentationStyle, hash);
+            auto const _ = RenderStatsScope(_stats, &RenderStats::rasterization);
+            auto glyph = [&]() {
+                auto const _ = lockShaper();
+                return textShaper().rasterize(glyphKey, _fontDescriptions.renderMode);
+            }();
+            if (!glyph)
+                return nullopt;
+            return createSlicedRasterizedGlyph(
+                tileLocation, glyphKey, presentationStyle, hash, std::move(*glyph));
+        }
+    );
+    // clang-format on
+}
+
+Renderable::AtlasTileAttributes const* TextRenderer::getOrRequestRasterizedMetadata(
+    strong_hash const& hash, text::glyph_key const& glyphKey, unicode::PresentationStyle presentationStyle)
+{
+    if (AtlasTileAttributes const* attributes = textureAtlas().try_get(hash))
+        return attributes;
+
+    if (_unrasterizableGlyphs.count(hash))
+        return nullptr;
+
+    // Rasterize on the worker thread, and render nothing for this glyph until then.
+    auto const renderMode = _fontDescriptions.renderMode;
+    auto job = [this, hash, glyphKey, presentationStyle, renderMode]() -> GlyphWorker::Completion {
+        auto glyph = textShaper().rasterize(glyphKey, renderMode);
+        return [this, hash, glyphKey, presentationStyle, glyph = std::move(glyph)]() {
+            insertRasterizedGlyph(hash, glyphKey, presentationStyle, glyph);
+        };
+    };
+    _glyphWorker->post(hash, std::move(job));
+    return nullptr;
+}
+
+void TextRenderer::insertRasterizedGlyph(strong_hash const& hash,
+                                         text::glyph_key const& glyphKey,
+                                         unicode::PresentationStyle presentationStyle,
+                                         optional<text::rasterized_glyph> const& glyph)
+{
+    if (!glyph)
+    {
+        _unrasterizableGlyphs.insert(hash);
+        return;
+    }
+
+    // clang-format off
+    (void) textureAtlas().get_or_try_emplace(
+        hash,
+        [&](atlas::TileLocation tileLocation)
+        -> optional<TextureAtlas::TileCreateData>
+        {
+            return createSlicedRasterizedGlyph(tileLocation, glyphKey, presentationStyle, hash, *glyph);
         }
     );
     // clang-format on
@@ -718,10 +1152,11 @@ Renderable::AtlasTileAttributes const* TextRenderer::getOrCreateRasterizedMetada
 auto TextRenderer::createSlicedRasterizedGlyph(atlas::TileLocation tileLocation,
                                                text::glyph_key const& glyphKey,
                                                unicode::PresentationStyle presentation,
-                                               strong_hash const& hash)
+                                               strong_hash const& hash,
+                                               text::rasterized_glyph glyph)
     -> optional<TextureAtlas::TileCreateData>
 {
-    auto result = createRasterizedGlyph(tileLocation, glyphKey, presentation);
+    auto result = createRasterizedGlyph(tileLocation, glyphKey, presentation, std::move(glyph));
     if (!result)
         return result;
 
@@ -794,14 +1229,10 @@ auto TextRenderer::createSlicedRasterizedGlyph(atlas::TileLocation tileLocation,
 
 auto TextRenderer::createRasterizedGlyph(atlas::TileLocation tileLocation,
                                          text::glyph_key const& glyphKey,
-                                         unicode::PresentationStyle presentation)
+                                         unicode::PresentationStyle presentation,
+                                         text::rasterized_glyph glyph)
     -> optional<TextureAtlas::TileCreateData>
 {
-    auto theGlyphOpt = _textShaper.rasterize(glyphKey, _fontDescriptions.renderMode);
-    if (!theGlyphOpt.has_value())
-        return nullopt;
-
-    text::rasterized_glyph& glyph = theGlyphOpt.value();
     Require(glyph.bitmap.size()
             == text::pixel_size(glyph.format) * unbox<size_t>(glyph.bitmapSize.width)
                    * unbox<size_t>(glyph.bitmapSize.height));
@@ -832,7 +1263,13 @@ auto TextRenderer::createRasterizedGlyph(atlas::TileLocation tileLocation,
                     glyph.position,
                     emojiBoundingBox,
                     numCells);
-            auto [scaledGlyph, scaleFactor] = text::scale(glyph, emojiBoundingBox);
+            // The mip chain is shared across font sizes, so that zooming reuses what is decoded already.
+            auto const chain = [&]() {
+                auto const _ = lockShaper();
+                return textShaper().mip_chain(glyphKey, _fontDescriptions.renderMode);
+            }();
+            auto [scaledGlyph, scaleFactor] =
+                chain ? text::scale(*chain, emojiBoundingBox) : text::scale(glyph, emojiBoundingBox);
 
             glyph = std::move(scaledGlyph);
             rasterizerLog()(" ==> scaled: {}/{}, factor {}", scaledGlyph, emojiBoundingBox, scaleFactor);
@@ -909,18 +1346,51 @@ auto TextRenderer::createRasterizedGlyph(atlas::TileLocation tileLocation,
 
 text::shape_result const& TextRenderer::getOrCreateCachedGlyphPositions(strong_hash hash)
 {
-    return _textShapingCache->get_or_emplace(hash, [this](auto) { return createTextShapedGlyphPositions(); });
+    auto const codepoints =
+        u32string_view(_textClusterGroup.codepoints.data(), _textClusterGroup.codepoints.size());
+    auto const clusters = gsl::span(_textClusterGroup.clusters.data(), _textClusterGroup.clusters.size());
+    auto const style = _textClusterGroup.style;
+
+    ++_shapingStats.lookups;
+    if (!_asyncGlyphs)
+        return _textShapingCache->get_or_emplace(hash, [&](auto) {
+            ++_shapingStats.misses;
+            auto const _ = lockShaper();
+            auto const measured = RenderStatsScope(_stats, &RenderStats::shaping);
+            return createTextShapedGlyphPositions(codepoints, clusters, style);
+        });
+
+    if (auto const* glyphPositions = _textShapingCache->try_get(hash))
+        return *glyphPositions;
+
+    ++_shapingStats.misses;
+
+    // Shape a copy of the text on the worker thread, and render nothing for it until then.
+    _glyphWorker->post(hash,
+                       [this,
+                        hash,
+                        codepoints = vector<char32_t>(codepoints.begin(), codepoints.end()),
+                        clusters = vector<unsigned>(clusters.begin(), clusters.end()),
+                        style]() mutable -> GlyphWorker::Completion {
+                           auto glyphPositions = createTextShapedGlyphPositions(
+                               u32string_view(codepoints.data(), codepoints.size()), clusters, style);
+                           return [this, hash, glyphPositions = std::move(glyphPositions)]() {
+                               _textShapingCache->emplace(hash, glyphPositions);
+                           };
+                       });
+    return _pendingGlyphPositions;
 }
 
-text::shape_result TextRenderer::createTextShapedGlyphPositions()
+text::shape_result TextRenderer::createTextShapedGlyphPositions(u32string_view codepoints,
+                                                                gsl::span<unsigned> clusters,
+                                                                TextStyle style)
 {
     auto glyphPositions = text::shape_result {};
 
     auto run = unicode::run_segmenter::range {};
-    auto rs = unicode::run_segmenter(
-        u32string_view(_textClusterGroup.codepoints.data(), _textClusterGroup.codepoints.size()));
+    auto rs = unicode::run_segmenter(codepoints);
     while (rs.consume(out(run)))
-        for (text::glyph_position& glyphPosition: shapeTextRun(run))
+        for (text::glyph_position& glyphPosition: shapeTextRun(run, codepoints, clusters, style))
             glyphPositions.emplace_back(std::move(glyphPosition));
 
     return glyphPositions;
@@ -934,20 +1404,23 @@ text::shape_result TextRenderer::createTextShapedGlyphPositions()
  *  - same language tag
  *  - same SGR attributes (font style, color)
  */
-text::shape_result TextRenderer::shapeTextRun(unicode::run_segmenter::range const& run)
+text::shape_result TextRenderer::shapeTextRun(unicode::run_segmenter::range const& run,
+                                              u32string_view text,
+                                              gsl::span<unsigned> textClusters,
+                                              TextStyle style)
 {
     // TODO(where to apply cell-advances) auto const advanceX = _gridMetrics.cellSize.width;
     auto const count = static_cast<size_t>(run.end - run.start);
-    auto const codepoints = u32string_view(_textClusterGroup.codepoints.data() + run.start, count);
-    auto const clusters = gsl::span(_textClusterGroup.clusters.data() + run.start, count);
+    auto const codepoints = text.substr(static_cast<size_t>(run.start), count);
+    auto const clusters = textClusters.subspan(static_cast<size_t>(run.start), count);
     auto const script = get<unicode::Script>(run.properties);
     auto const presentationStyle = get<unicode::PresentationStyle>(run.properties);
     auto const isEmojiPresentation = presentationStyle == unicode::PresentationStyle::Emoji;
-    auto const font = isEmojiPresentation ? _fonts.emoji : getFontForStyle(_fonts, _textClusterGroup.style);
+    auto const font = isEmojiPresentation ? _fonts.emoji : getFontForStyle(_fonts, style);
 
     text::shape_result glyphPosition;
     glyphPosition.reserve(clusters.size());
-    _textShaper.shape(font,
+    textShaper().shape(font,
                       codepoints,
                       clusters,
                       script,            // get<unicode::Script>(run.properties),
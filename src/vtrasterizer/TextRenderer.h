@@ -7,6 +7,9 @@
 
 #include <vtrasterizer/BoxDrawingRenderer.h>
 #include <vtrasterizer/FontDescriptions.h>
+#include <vtrasterizer/GlyphWorker.h>
+#include <vtrasterizer/RenderResources.h>
+#include <vtrasterizer/RenderStats.h>
 #include <vtrasterizer/RenderTarget.h>
 #include <vtrasterizer/TextureAtlas.h>
 
@@ -15,16 +18,23 @@
 
 #include <crispy/FNV.h>
 #include <crispy/StrongHash.h>
-#include <crispy/StrongLRUHashtable.h>
+#include <crispy/StrongLRUFlatHashtable.h>
 #include <crispy/point.h>
 #include <crispy/size.h>
 
 #include <libunicode/convert.h>
 #include <libunicode/run_segmenter.h>
 
+#include <gsl/pointers>
 #include <gsl/span>
 #include <gsl/span_ext>
 
+#include <array>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace vtrasterizer
@@ -54,28 +64,84 @@ class TextRenderer: public Renderable
 {
   public:
     TextRenderer(GridMetrics const& gridMetrics,
-                 text::shaper& textShaper,
+                 RenderResources& resources,
                  FontDescriptions& fontDescriptions,
                  FontKeys const& fontKeys,
                  TextRendererEvents& eventHandler);
 
     void setRenderTarget(RenderTarget& renderTarget, DirectMappingAllocator& directMappingAllocator) override;
     void setTextureAtlas(TextureAtlas& atlas) override;
+    void setTextureScheduler(atlas::AtlasBackend& scheduler) override;
 
     void inspect(std::ostream& textOutput) const override;
 
+    /// Text shaping cache statistics, across all fonts.
+    struct ShapingStats
+    {
+        uint64_t lookups = 0;  // text cluster groups, each looking up its shaping result
+        uint64_t misses = 0;   // of which were shaped, as not cached
+        uint64_t segments = 0; // text cluster groups ended at a change between words and punctuation
+    };
+
+    [[nodiscard]] ShapingStats const& shapingStats() const noexcept { return _shapingStats; }
+
     void clearCache() override;
 
     void updateFontMetrics();
 
+    /// Switches to the given resources, e.g. when the fonts changed to ones shaped by a different shaper.
+    /// The caches of the previous resources must have been cleared or discarded already.
+    void setRenderResources(RenderResources& resources);
+
     void setPressure(bool pressure) noexcept { _pressure = pressure; }
 
+    /// Collects the time spent on box drawing, shaping, and rasterizing into @p stats, unless nullptr.
+    void setRenderStats(RenderStats* stats) noexcept { _stats = stats; }
+
+    /// Enables or disables shaping and rasterizing glyphs on a worker thread.
+    ///
+    /// While enabled, text that is not shaped or rasterized yet is left out of the frame,
+    /// and @p glyphsReady is invoked from the worker thread once it is, so that another frame gets rendered.
+    void setAsyncGlyphs(bool enabled, std::function<void()> glyphsReady);
+
+    /// Sets the codepoints to shape and rasterize with low priority on a worker thread
+    /// whenever the fonts or caches have been reset, so that they are cached before they are first rendered.
+    void setPrewarmedCodepoints(std::vector<CodepointRange> ranges);
+
+    /// Keeps the text shaping cache of the current fonts for when they are used again,
+    /// e.g. when switching back to a recently used font size, and continues with an empty cache.
+    void retainTextShapingCache();
+
+    /// Continues with the text shaping cache retained for the current fonts, if any.
+    void restoreTextShapingCache();
+
+    /// Discards all retained text shaping caches. Must be invoked when the fonts are reloaded.
+    void discardRetainedTextShapingCaches();
+
+    /// Discards the text shaping caches retained for the fonts of @p resources, e.g. as they are released.
+    void discardRetainedTextShapingCaches(RenderResources const& resources);
+
+    /// Discards the retained text shaping caches, and evicts the text shaping results not used since
+    /// the previous trim, e.g. when running low on memory.
+    ///
+    /// @returns the number of text shaping results evicted.
+    size_t trimCaches();
+
+    /// Puts the glyphs shaped and rasterized on the worker thread since the last call into the caches.
+    ///
+    /// @retval true glyphs have been added, which previously rendered frames have been lacking.
+    bool applyAsyncGlyphs();
+
+    /// Discards all glyphs queued to be shaped or rasterized asynchronously.
+    /// Must be invoked before changing the fonts.
+    void cancelAsyncGlyphs();
+
     /// Must be invoked before a new terminal frame is rendered.
     void beginFrame();
 
     /// Renders a given terminal's grid cell that has been
-    /// transformed into a RenderCell.
-    void renderCell(vtbackend::RenderCell const& cell);
+    /// transformed into a RenderCell, showing the given codepoints.
+    void renderCell(vtbackend::RenderCell const& cell, std::u32string_view codepoints);
 
     void renderCell(vtbackend::CellLocation position,
                     std::u32string_view graphemeCluster,
@@ -85,27 +151,80 @@ class TextRenderer: public Renderable
     void renderLine(vtbackend::RenderLine const& renderLine);
 
     /// Must be invoked when rendering the terminal's text has finished for this frame.
+    /// Renders any text that is still pending, e.g. at the end of a line.
+    void flush() { flushTextClusterGroup(); }
+
     void endFrame();
 
   private:
     void initializeDirectMapping();
 
+    /// (Re-)creates the worker thread, if asynchronous glyphs or pre-warming is enabled.
+    void updateGlyphWorker();
+
+    // glyphs shaped and rasterized ahead of being rendered
+    struct PrewarmedGlyph
+    {
+        TextStyle style;
+        text::glyph_position position;
+        text::rasterized_glyph bitmap;
+    };
+
+    struct PrewarmedGlyphs
+    {
+        std::vector<std::pair<crispy::strong_hash, text::shape_result>> glyphPositions;
+        std::vector<PrewarmedGlyph> glyphs;
+        std::vector<char32_t> boxDrawingCodepoints;
+    };
+
+    /// Queues jobs on the worker thread for pre-warming the caches with the configured codepoints.
+    void schedulePrewarming();
+
+    /// Shapes and rasterizes the given codepoints. Runs on the worker thread.
+    PrewarmedGlyphs prewarmCodepoints(CodepointRange range,
+                                      text::render_mode renderMode,
+                                      bool builtinBoxDrawing);
+
+    void insertPrewarmedGlyphs(PrewarmedGlyphs const& prewarmed);
+
     /// Puts a sequence of codepoints that belong to the same grid cell at @p _pos
     /// at the end of the currently filled line.
     void appendCellTextToClusterGroup(std::u32string_view codepoints,
                                       TextStyle style,
                                       vtbackend::RGBColor color);
 
-    /// Gets the text shaping result of the current text cluster group
+    /// Gets the text shaping result of the current text cluster group,
+    /// which is empty while it is being shaped asynchronously.
     text::shape_result const& getOrCreateCachedGlyphPositions(crispy::strong_hash hash);
-    text::shape_result createTextShapedGlyphPositions();
-    text::shape_result shapeTextRun(unicode::run_segmenter::range const& run);
+    text::shape_result createTextShapedGlyphPositions(std::u32string_view codepoints,
+                                                      gsl::span<unsigned> clusters,
+                                                      TextStyle style);
+    text::shape_result shapeTextRun(unicode::run_segmenter::range const& run,
+                                    std::u32string_view codepoints,
+                                    gsl::span<unsigned> clusters,
+                                    TextStyle style);
     void flushTextClusterGroup();
 
     AtlasTileAttributes const* getOrCreateRasterizedMetadata(crispy::strong_hash const& hash,
                                                              text::glyph_key const& glyphKey,
                                                              unicode::PresentationStyle presentationStyle);
 
+    /// Returns the glyph's tile if present, otherwise requests it to be rasterized asynchronously.
+    AtlasTileAttributes const* getOrRequestRasterizedMetadata(crispy::strong_hash const& hash,
+                                                              text::glyph_key const& glyphKey,
+                                                              unicode::PresentationStyle presentationStyle);
+
+    void insertRasterizedGlyph(crispy::strong_hash const& hash,
+                               text::glyph_key const& glyphKey,
+                               unicode::PresentationStyle presentationStyle,
+                               std::optional<text::rasterized_glyph> const& glyph);
+
+    /// Locks the text shaper against the worker thread and any other renderer sharing it.
+    /// The render thread must hold this lock while using the shaper.
+    [[nodiscard]] std::unique_lock<std::mutex> lockShaper() { return _resources->lockShaper(); }
+
+    [[nodiscard]] text::shaper& textShaper() noexcept { return _resources->textShaper(); }
+
     /**
      * Creates (and rasterizes) a single glyph and returns its
      * render tile attributes required for the render step.
@@ -114,12 +233,14 @@ class TextRenderer: public Renderable
         atlas::TileLocation tileLocation,
         text::glyph_key const& glyphKey,
         unicode::PresentationStyle presentation,
-        crispy::strong_hash const& hash);
+        crispy::strong_hash const& hash,
+        text::rasterized_glyph glyph);
 
     std::optional<TextureAtlas::TileCreateData> createRasterizedGlyph(
         atlas::TileLocation tileLocation,
         text::glyph_key const& glyphKey,
-        unicode::PresentationStyle presentation);
+        unicode::PresentationStyle presentation,
+        text::rasterized_glyph glyph);
 
     void restrictToTileSize(TextureAtlas::TileCreateData& tileCreateData);
 
@@ -140,28 +261,52 @@ class TextRenderer: public Renderable
     // performance optimizations
     //
     bool _pressure = false;
+    RenderStats* _stats = nullptr;
 
-    using ShapingResultCache = crispy::strong_lru_hashtable<text::shape_result>;
+    // Shaping results are looked up for every run of every frame, and hit far more often than they miss,
+    // so they are kept in the open addressing table, for which approximate LRU eviction is good enough.
+    using ShapingResultCache = crispy::strong_lru_flat_hashtable<text::shape_result>;
     using ShapingResultCachePtr = ShapingResultCache::ptr;
 
+    [[nodiscard]] static ShapingResultCachePtr createTextShapingCache();
+
     ShapingResultCachePtr _textShapingCache;
-    // TODO: make unique_ptr, get owned, export cref for other users in Renderer impl.
-    text::shaper& _textShaper;
+
+    // text shaping cache of fonts that have been used before
+    struct RetainedShapingCache
+    {
+        RenderResources const* resources; // font keys are specific to the shaper that loaded them
+        crispy::strong_hash fonts;
+        ShapingResultCachePtr cache;
+        size_t memoryUsage;
+    };
+    std::vector<RetainedShapingCache> _retainedShapingCaches {}; // most recently used first
+    gsl::not_null<RenderResources*> _resources;
 
     DirectMapping _directMapping {};
 
-    // Maps from glyph index to tile index.
-    std::vector<uint32_t> _directMappedGlyphKeyToTileIndex {};
+    // Regular, bold, italic, and bold-italic each get their own range of direct-mapped tiles.
+    static constexpr size_t DirectMappedStyleCount = 4;
 
-    [[nodiscard]] bool isGlyphDirectMapped(text::glyph_key const& glyph) const noexcept
-    {
-        return _directMapping                  // Is direct mapping enabled?
-               && glyph.font == _fonts.regular // Only regular font is direct-mapped for now.
-               && glyph.index.value < _directMappedGlyphKeyToTileIndex.size()
-               && _directMappedGlyphKeyToTileIndex[glyph.index.value] != 0;
-    }
+    // Maps from glyph index to tile index, for each direct-mapped text style.
+    std::array<std::vector<uint32_t>, DirectMappedStyleCount> _directMappedGlyphKeyToTileIndex {};
+
+    // Whether the glyphs of each direct-mapped text style have been mapped to their tiles yet.
+    std::array<bool, DirectMappedStyleCount> _directMappedStyles {};
+
+    /// Maps the direct-mapped glyphs of the given style to their tiles.
+    void mapDirectMappedGlyphs(TextStyle style);
+
+    /// Returns the tile index of the given glyph rendered in the given style,
+    /// or 0 if that glyph is not direct-mapped.
+    [[nodiscard]] uint32_t directMappedTileIndex(text::glyph_key const& glyph, TextStyle style);
 
-    AtlasTileAttributes const* ensureRasterizedIfDirectMapped(text::glyph_key const& glyphKey);
+    AtlasTileAttributes const* ensureRasterizedIfDirectMapped(text::glyph_key const& glyphKey,
+                                                              TextStyle style);
+
+    AtlasTileAttributes const* setDirectMappedGlyph(uint32_t tileIndex,
+                                                    text::glyph_key const& glyphKey,
+                                                    text::rasterized_glyph glyph);
 
     // sub-renderer
     //
@@ -189,6 +334,9 @@ class TextRenderer: public Renderable
         // number of grid cells processed
         int cellCount = 0; // FIXME: EA width vs actual cells
 
+        // class of the text (word of a script, or punctuation), see segmentClassOf()
+        uint32_t segmentClass = 0;
+
         void resetAndMovePenForward(int penIncrementInX)
         {
             codepoints.clear();
@@ -200,7 +348,18 @@ class TextRenderer: public Renderable
     TextClusterGroup _textClusterGroup {};
 
     bool _textStartFound = false;
+
+    ShapingStats _shapingStats {};
     bool _updateInitialPenPosition = false;
+
+    // asynchronous shaping and rasterization
+    //
+    bool _asyncGlyphs = false;
+    std::function<void()> _glyphsReady {};
+    std::vector<CodepointRange> _prewarmedCodepoints {};
+    text::shape_result _pendingGlyphPositions {}; // rendered for text while it is being shaped
+    std::unordered_set<crispy::strong_hash, GlyphWorker::Hasher> _unrasterizableGlyphs {};
+    std::unique_ptr<GlyphWorker> _glyphWorker; // last member, so its thread is joined first
 };
 
 } // namespace vtrasterizer
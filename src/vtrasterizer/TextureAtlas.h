@@ -199,6 +199,21 @@ class AtlasBackend
 
     /// Renders given texture from the atlas with the given target position parameters.
     virtual void renderTile(RenderTile tile) = 0;
+
+    /// Moves the atlas aside instead of destroying it with the next configureAtlas(),
+    /// replacing any atlas retained before, e.g. to keep the glyphs of another DPI.
+    ///
+    /// @retval true  the atlas is retained, until restored or discarded.
+    /// @retval false the backend cannot retain it, e.g. as it would not fit into the GPU memory budget.
+    [[nodiscard]] virtual bool retainAtlas() { return false; }
+
+    /// Swaps the atlas in use with the retained one, keeping the one in use retained instead.
+    ///
+    /// @retval false nothing is retained (anymore), e.g. as it has been evicted to stay within budget.
+    [[nodiscard]] virtual bool restoreAtlas() { return false; }
+
+    /// Destroys the retained atlas, if any.
+    virtual void discardRetainedAtlas() {}
 };
 
 // Defines location of the tile in the atlas and its associated metadata
@@ -301,8 +316,17 @@ class TextureAtlas
     // Retrieves the number of total tiles that can be stored.
     [[nodiscard]] size_t capacity() const noexcept { return _tileLocations.size(); }
 
+    // Retrieves the number of tiles currently stored in the LRU cache.
+    [[nodiscard]] size_t size() const noexcept { return _tileCache->size(); }
+
     void inspect(std::ostream& output) const;
 
+    // Retrieves the hits and misses of looking up tiles in the LRU cache.
+    [[nodiscard]] crispy::lru_hashtable_stats const& tileCacheStats() const noexcept
+    {
+        return _tileCache->stats();
+    }
+
     [[nodiscard]] uint32_t tilesInX() const noexcept { return _tilesInX; }
     [[nodiscard]] uint32_t tilesInY() const noexcept { return _tilesInY; }
 
@@ -451,14 +475,18 @@ inline vtbackend::ImageSize computeAtlasSize(AtlasProperties const& atlasPropert
     using std::ceil;
     using std::sqrt;
 
+    // Only the texture's edges are rounded up to a power of two, and the number of tile rows is
+    // derived from the resulting number of tiles per row, so that no more GPU memory is allocated than
+    // needed to hold the requested tiles (plus one for the LRU-sentinel entry).
     // clang-format off
-    auto const totalTileCount = crispy::nextPowerOfTwo(1 + atlasProperties.tileCount.value + atlasProperties.directMappingCount);
-    //auto const totalTileCount = atlasProperties.tileCount.value + atlasProperties.directMappingCount;
+    auto const totalTileCount = 1 + atlasProperties.tileCount.value + atlasProperties.directMappingCount;
     auto const squareEdgeCount = static_cast<uint32_t>(ceil(sqrt(totalTileCount)));
     auto const width = vtbackend::Width::cast_from(crispy::nextPowerOfTwo(static_cast<uint32_t>(
         squareEdgeCount * unbox(atlasProperties.tileSize.width))));
+    auto const tilesInX = unbox(width) / unbox(atlasProperties.tileSize.width);
+    auto const tilesInY = (totalTileCount + tilesInX - 1) / tilesInX;
     auto const height = vtbackend::Height::cast_from(crispy::nextPowerOfTwo(static_cast<uint32_t>(
-        squareEdgeCount * unbox(atlasProperties.tileSize.height))));
+        tilesInY * unbox(atlasProperties.tileSize.height))));
     // clang-format on
 
     // fmt::print("computeAtlasSize: tiles {}+{}={} -> texture size {}x{} (tile size {})\n",
@@ -671,6 +699,11 @@ void TextureAtlas<Metadata>::inspect(std::ostream& output) const
     output << fmt::format("atlas size     : {}\n", _atlasSize);
     output << fmt::format("tile size      : {}\n", _atlasProperties.tileSize);
     output << fmt::format("direct mapped  : {}\n", _atlasProperties.directMappingCount);
+    output << fmt::format("tile capacity  : {} ({} requested)\n",
+                          _tileCache->capacity(),
+                          _atlasProperties.tileCount.value);
+    output << fmt::format("GPU memory     : {} KiB in 1 atlas page, evicted tiles are reused in place\n",
+                          _atlasSize.area() * element_count(_atlasProperties.format) / 1024);
     output << '\n';
     _tileCache->inspect(output);
 }
@@ -16,4 +16,21 @@
 // Render an LCD-subpixel antialiased glyph (advanced algorithm)
 #define FRAGMENT_SELECTOR_GLYPH_LCD 3
 
+// Render a box drawing character procedurally, without a texture atlas tile.
+// The tile's normalized texture location then describes the primitive to render:
+// (BOX_DRAWING_* kind, kind-specific parameters, line thickness in pixels, unused).
+#define FRAGMENT_SELECTOR_BOX_DRAWING 4
+
+// Straight light and heavy lines, with 2 bits weight per arm: left, right, up, down.
+#define BOX_DRAWING_LINES 1
+
+// Filled rectangle, with 4 bits per coordinate in eighths of the cell from its top left: x0, y0, x1, y1.
+#define BOX_DRAWING_BLOCK 2
+
+// Solid Powerline triangle, pointing right (0) or left (1).
+#define BOX_DRAWING_TRIANGLE 3
+
+// Render a glyph from its signed distance field, anti-aliased at whatever scale it is drawn.
+#define FRAGMENT_SELECTOR_GLYPH_SDF 5
+
 // NOLINTEND(modernize-macro-to-enum)